@@ -43,6 +43,20 @@ GOOGLE_TEST_GIT_BRANCH="release-1.11.0"
 GOOGLE_TEST_CMAKE_ARGS=""
 standard_build_and_install $GOOGLE_TEST_DIR_NAME $GOOGLE_TEST_GIT_REPO $GOOGLE_TEST_GIT_BRANCH "$GOOGLE_TEST_CMAKE_ARGS"
 
+# Install Google Benchmark, used by the McfCoreBenchmarks target
+GOOGLE_BENCHMARK_DIR_NAME="benchmark"
+GOOGLE_BENCHMARK_GIT_REPO="https://github.com/google/benchmark.git"
+GOOGLE_BENCHMARK_GIT_BRANCH="v1.8.3"
+GOOGLE_BENCHMARK_CMAKE_ARGS="-DBENCHMARK_ENABLE_TESTING=OFF"
+standard_build_and_install $GOOGLE_BENCHMARK_DIR_NAME $GOOGLE_BENCHMARK_GIT_REPO $GOOGLE_BENCHMARK_GIT_BRANCH "$GOOGLE_BENCHMARK_CMAKE_ARGS"
+
+# Install pybind11, used by the native backing of mcf_py
+PYBIND11_DIR_NAME="pybind11"
+PYBIND11_GIT_REPO="https://github.com/pybind/pybind11.git"
+PYBIND11_GIT_BRANCH="v2.11.1"
+PYBIND11_CMAKE_ARGS="-DPYBIND11_TEST=OFF"
+standard_build_and_install $PYBIND11_DIR_NAME $PYBIND11_GIT_REPO $PYBIND11_GIT_BRANCH "$PYBIND11_CMAKE_ARGS"
+
 # Install libzmq
 if [ ! -d "$SCRIPT_DIR/deps/libzmq" ] ; then
     git clone --depth 1 --branch v4.3.4 https://github.com/zeromq/libzmq.git $SCRIPT_DIR/deps/libzmq
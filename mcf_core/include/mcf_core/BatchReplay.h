@@ -0,0 +1,184 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_BATCHREPLAY_H_
+#define MCF_BATCHREPLAY_H_
+
+#include "mcf_core/ComponentType.h"
+#include "mcf_core/RecordingEventSource.h"
+#include "mcf_core/ReplayEventController.h"
+#include "mcf_core/ThreadAffinity.h"
+#include "mcf_core/TypeRegistry.h"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mcf {
+
+class ComponentInstantiator;
+class ComponentManager;
+class Plugin;
+class PluginLoader;
+class ValueStore;
+
+/**
+ * Replays a batch of recordings, each through an isolated pipeline, concurrently in one process
+ *
+ * Each scenario gets its own ValueStore, ComponentManager, ReplayEventController and
+ * RecordingEventSource, so scenarios do not see each other's values. The plugins are loaded and
+ * the value types are registered only once for the whole batch, which saves the process startup
+ * of replaying each scenario on its own.
+ *
+ * Scenarios are run by one worker thread per core set, each taking the next scenario when it has
+ * finished the previous one. A worker pins itself to its core set before it sets up a pipeline,
+ * the threads of the pipeline (components, event timing, reading the recording) inherit the
+ * affinity. Note that process wide facilities like logging and tracing are shared by all
+ * pipelines.
+ */
+class BatchReplay
+{
+public:
+
+    /**
+     * A component to instantiate from the registered component types
+     */
+    struct ComponentInstance {
+        std::string typeName;      // qualified name of the component type
+        std::string instanceName;
+    };
+
+    /**
+     * A recording to replay
+     *
+     * @param name        Name of the scenario, used in the results and log messages
+     *
+     * @param recording   The record file to replay
+     *
+     * @param configDirs  Configuration directories of the component manager of the pipeline
+     *
+     * @param components  Components to instantiate from the types of the plugins
+     */
+    struct Scenario {
+        std::string name;
+        std::string recording;
+        std::vector<std::string> configDirs;
+        std::vector<ComponentInstance> components;
+    };
+
+    /**
+     * The objects of a pipeline, handed to the setup function
+     */
+    struct Pipeline {
+        const Scenario& scenario;
+        ValueStore& valueStore;
+        ComponentManager& componentManager;
+        ComponentInstantiator& componentInstantiator;
+        ReplayEventController& replayEventController;
+        /// the core set the pipeline runs on, the empty mask if not pinned
+        CpuMask cpus;
+    };
+
+    /**
+     * Function called for each pipeline after the components of the scenario have been
+     * instantiated and before they are configured, e.g. to register further components
+     */
+    using SetupFunction = std::function<void(Pipeline&)>;
+
+    /**
+     * Parameter structure
+     *
+     * @param coreSets           One worker per core set runs scenarios concurrently. Without core
+     *                           sets, scenarios run one after the other on an unpinned worker.
+     *
+     * @param executorThreads    If true, the components of a pipeline run on an executor with one
+     *                           worker per core of its core set, see
+     *                           ComponentManager::setExecutorThreads(). Otherwise each component
+     *                           has its own thread.
+     *
+     * @param replayParams       Playback parameters of the pipelines, set unthrottled to replay as
+     *                           fast as the pipelines process. The recording is added to the
+     *                           ReplayEventController as event source RECORDING_EVENT_SOURCE.
+     *
+     * @param recordingParams    Parameters of the recording event sources
+     */
+    struct Params {
+        std::vector<CpuMask> coreSets;
+        bool executorThreads = true;
+        ReplayEventController::Params replayParams;
+        RecordingEventSource::Params recordingParams;
+    };
+
+    /**
+     * The outcome of a scenario
+     */
+    struct Result {
+        std::string name;
+        bool success = false;
+        /// the message of the exception which failed the scenario
+        std::string error;
+        std::chrono::microseconds wallTime{0};
+        /// simulation time per wall clock time, see ReplayEventController::getAchievedSpeedup()
+        float achievedSpeedup = 0.f;
+    };
+
+    static constexpr const char* RECORDING_EVENT_SOURCE = "recording";
+
+    explicit BatchReplay(Params params = Params());
+
+    ~BatchReplay();
+
+    BatchReplay(const BatchReplay&) = delete;
+    BatchReplay& operator=(const BatchReplay&) = delete;
+
+    /**
+     * The value types of all pipelines, register types here before calling run()
+     *
+     * Referenced by the value stores of the pipelines, types must not be registered while running.
+     */
+    TypeRegistry& typeRegistry() { return fTypeRegistry; }
+
+    /**
+     * Add the component types of a plugin, shared by all pipelines
+     */
+    void addPlugin(const Plugin& plugin);
+
+    /**
+     * Load a plugin from a shared object, which stays loaded for the lifetime of this object,
+     * and add its component types
+     *
+     * @throws PluginError if the plugin cannot be loaded
+     */
+    void loadPlugin(const std::string& fileName);
+
+    /**
+     * Set the function called for each pipeline, see SetupFunction
+     */
+    void setSetupFunction(SetupFunction setup);
+
+    /**
+     * Replay the scenarios and wait until all of them have finished
+     *
+     * A scenario failing to set up or to replay does not affect the others.
+     *
+     * @return the results in the order of the scenarios
+     */
+    std::vector<Result> run(const std::vector<Scenario>& scenarios);
+
+private:
+
+    Result runScenario(const Scenario& scenario, CpuMask cpus);
+
+    const Params fParams;
+    TypeRegistry fTypeRegistry;
+    std::vector<ComponentType> fComponentTypes;
+    SetupFunction fSetup;
+    std::unique_ptr<PluginLoader> fPluginLoader;
+};
+
+} // namespace mcf
+
+#endif // MCF_BATCHREPLAY_H_
@@ -0,0 +1,219 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_BATCHINGRECEIVERPORT_H
+#define MCF_BATCHINGRECEIVERPORT_H
+
+#include "mcf_core/Port.h"
+#include "mcf_core/PortTriggerHandler.h"
+#include "mcf_core/ErrorMacros.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * A value of a batch delivered by BatchingReceiverPort
+ */
+template<typename T>
+struct BatchEntry {
+    /// index of the input the value was received by
+    size_t input;
+    std::shared_ptr<const T> value;
+};
+
+/**
+ * A receiver port collecting the values of several topics, or consecutive values of one topic,
+ * into batches, e.g. to run one GPU inference over the images of several cameras instead of one
+ * small inference per image
+ *
+ * Each input is a queued receiver port of its own, to be registered with its topic, e.g.
+ *
+ *     BatchingReceiverPort<Image> fBatch(*this, "Batch", 8, 8, std::chrono::milliseconds(5));
+ *     for (size_t i = 0; i < 8; ++i) {
+ *         config.registerPort(fBatch.input(i), "/camera" + std::to_string(i));
+ *     }
+ *
+ * A batch is handed to the handler once it holds maxBatchSize values, or once its oldest value
+ * has waited for maxLatency, whichever comes first. The values of a batch are in the order they
+ * were taken from the inputs, each with the index of its input, so that the handler can send
+ * its results to the sender port belonging to the input, see mcf_cuda/CudaBatch.h for gathering
+ * the ext mem of a batch into one contiguous gen_array and splitting the result.
+ *
+ * The queues of the inputs are as long as a batch by default, values overwritten there before
+ * the handler ran are lost, see ValueQueue::getDropped().
+ *
+ * The port must not move, as its inputs and deadlines refer to it.
+ */
+template<typename T>
+class BatchingReceiverPort {
+public:
+    using Entry = BatchEntry<T>;
+    using Batch = std::vector<Entry>;
+    using Handler = std::function<void(const Batch&)>;
+
+    /**
+     * @param component     the component this port is part of
+     * @param name          the name of the port, the inputs are named name[0], name[1], ...
+     * @param inputs        the number of inputs, must be > 0
+     * @param maxBatchSize  the number of values of a full batch, must be > 0
+     * @param maxLatency    the time the oldest value of a batch waits at most for the batch to fill
+     * @param queueLength   the queue length of each input, 0 for maxBatchSize
+     */
+    BatchingReceiverPort(IComponent& component, const std::string& name, size_t inputs, size_t maxBatchSize,
+                         std::chrono::microseconds maxLatency, size_t queueLength = 0)
+    : fComponent(component)
+    , fName(name)
+    , fMaxBatchSize(maxBatchSize)
+    , fMaxLatency(maxLatency)
+    {
+        MCF_ASSERT(inputs > 0, "Batching receiver port requires at least one input");
+        MCF_ASSERT(maxBatchSize > 0, "Batching receiver port requires a batch size > 0");
+        for (size_t i = 0; i < inputs; ++i) {
+            // new values overwrite the oldest ones if the component falls behind
+            fInputs.emplace_back(new QueuedReceiverPort<T>(
+                component, name + "[" + std::to_string(i) + "]", queueLength > 0 ? queueLength : maxBatchSize));
+        }
+        fBatch.reserve(maxBatchSize);
+    }
+
+    BatchingReceiverPort(const BatchingReceiverPort&) = delete;
+    BatchingReceiverPort& operator=(const BatchingReceiverPort&) = delete;
+
+    size_t inputs() const {
+        return fInputs.size();
+    }
+
+    /**
+     * The port of an input, to be registered with its topic
+     */
+    QueuedReceiverPort<T>& input(size_t index) {
+        return *fInputs.at(index);
+    }
+
+    /**
+     * Register the handler for batches
+     *
+     * All inputs share one activation, so the handler runs on the component thread with the
+     * usual options, but it must not be concurrent. Batches delivered at their deadline are
+     * handed over by a function posted to the component, see IComponent::postAfter().
+     */
+    void registerHandler(Handler handler, const PortTriggerHandlerOptions& options = PortTriggerHandlerOptions()) {
+        MCF_ASSERT(!options.concurrent, "Batching receiver port handler must not be concurrent");
+        fHandler = std::move(handler);
+        fPortHandler = std::make_shared<PortTriggerHandler>(
+            [this] { receive(); }, fName, fComponent.getComponentTraceEventGenerator(), options);
+        for (auto& input : fInputs) {
+            input->registerHandler(fPortHandler);
+        }
+    }
+
+    /**
+     * Number of batches delivered to the handler
+     */
+    uint64_t getBatches() const {
+        return fBatches.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of values delivered in batches
+     */
+    uint64_t getBatchedValues() const {
+        return fBatchedValues.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of batches delivered at their deadline before they were full
+     */
+    uint64_t getPartialBatches() const {
+        return fPartialBatches.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Pending {
+        Entry entry;
+        std::chrono::steady_clock::time_point received;
+    };
+
+    void receive() {
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < fInputs.size(); ++i) {
+            fInputs[i]->drain([this, i, now](const std::shared_ptr<const T>& value) {
+                if (value) {
+                    fPending.push_back(Pending{Entry{i, value}, now});
+                }
+            });
+        }
+        while (fPending.size() >= fMaxBatchSize) {
+            deliver();
+        }
+        armDeadline();
+    }
+
+    /**
+     * Deliver the pending values whose oldest one has waited for maxLatency, runs at a deadline
+     */
+    void expire() {
+        fDeadlineArmed = false;
+        while (!fPending.empty()
+               && std::chrono::steady_clock::now() - fPending.front().received >= fMaxLatency) {
+            if (fPending.size() < fMaxBatchSize) {
+                fPartialBatches.fetch_add(1, std::memory_order_relaxed);
+            }
+            deliver();
+        }
+        armDeadline();
+    }
+
+    void armDeadline() {
+        if (fPending.empty() || fDeadlineArmed) {
+            return;
+        }
+        fDeadlineArmed = true;
+        const auto delay = fPending.front().received + fMaxLatency - std::chrono::steady_clock::now();
+        fComponent.postAfter(std::max(delay, std::chrono::steady_clock::duration::zero()), [this] { expire(); });
+    }
+
+    void deliver() {
+        const size_t count = std::min(fPending.size(), fMaxBatchSize);
+        fBatch.clear();
+        for (size_t i = 0; i < count; ++i) {
+            fBatch.push_back(std::move(fPending.front().entry));
+            fPending.pop_front();
+        }
+        fBatches.fetch_add(1, std::memory_order_relaxed);
+        fBatchedValues.fetch_add(count, std::memory_order_relaxed);
+        if (fHandler) {
+            fHandler(fBatch);
+        }
+        // release the values right away
+        fBatch.clear();
+    }
+
+    IComponent& fComponent;
+    const std::string fName;
+    const size_t fMaxBatchSize;
+    const std::chrono::microseconds fMaxLatency;
+    std::vector<std::unique_ptr<QueuedReceiverPort<T>>> fInputs;
+    Handler fHandler;
+    std::shared_ptr<PortTriggerHandler> fPortHandler;
+    // accessed on the component thread only
+    std::deque<Pending> fPending;
+    Batch fBatch;
+    bool fDeadlineArmed = false;
+    std::atomic<uint64_t> fBatches{0};
+    std::atomic<uint64_t> fBatchedValues{0};
+    std::atomic<uint64_t> fPartialBatches{0};
+};
+
+} // namespace mcf
+
+#endif // MCF_BATCHINGRECEIVERPORT_H
@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_BULKARRAY_H
+#define MCF_BULKARRAY_H
+
+#include "mcf_core/ErrorMacros.h"
+
+#include "msgpack.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Bulk wire format of generated value types, selected per package with "WireFormat": "bulk" in
+ * ProjectDefinitions.json
+ *
+ * Values are packed as msgpack array of their attributes like in the default format, except for
+ * vectors of numbers (other than bool and uint8, which msgpack already packs as bin): these are
+ * packed as a single msgpack bin holding the little endian elements, instead of one msgpack number
+ * per element. Packing and unpacking copy the elements with a single memcpy on little endian
+ * hosts, big endian hosts swap the bytes of every element.
+ */
+namespace bulk {
+
+namespace detail {
+
+constexpr bool LITTLE_ENDIAN_HOST =
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    false;
+#else
+    true;
+#endif
+
+template<typename T>
+void swapBytes(char* data, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        std::reverse(data + i * sizeof(T), data + (i + 1) * sizeof(T));
+    }
+}
+
+} // namespace detail
+
+/**
+ * Packs a vector of numbers as msgpack bin
+ */
+template<typename Packer, typename T>
+void pack(Packer& packer, const std::vector<T>& value) {
+    static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+                  "bulk arrays hold numbers");
+    MCF_ASSERT(value.size() <= UINT32_MAX / sizeof(T), "bulk array exceeds 4 GiB");
+    const uint32_t size = static_cast<uint32_t>(value.size() * sizeof(T));
+    packer.pack_bin(size);
+    if (detail::LITTLE_ENDIAN_HOST || sizeof(T) == 1) {
+        packer.pack_bin_body(reinterpret_cast<const char*>(value.data()), size);
+        return;
+    }
+    std::vector<char> swapped(reinterpret_cast<const char*>(value.data()),
+                              reinterpret_cast<const char*>(value.data()) + size);
+    detail::swapBytes<T>(swapped.data(), value.size());
+    packer.pack_bin_body(swapped.data(), size);
+}
+
+/**
+ * Unpacks a vector of numbers packed by pack(), throws msgpack::type_error if the object is not
+ * a bin of whole elements
+ */
+template<typename T>
+void unpack(const msgpack::object& object, std::vector<T>& value) {
+    static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+                  "bulk arrays hold numbers");
+    if (object.type != msgpack::type::BIN || object.via.bin.size % sizeof(T) != 0) {
+        throw msgpack::type_error();
+    }
+    value.resize(object.via.bin.size / sizeof(T));
+    if (!value.empty()) {
+        std::memcpy(value.data(), object.via.bin.ptr, object.via.bin.size);
+        if (!detail::LITTLE_ENDIAN_HOST && sizeof(T) > 1) {
+            detail::swapBytes<T>(reinterpret_cast<char*>(value.data()), value.size());
+        }
+    }
+}
+
+/**
+ * Reads the attributes of a value packed in the bulk format, like MSGPACK_DEFINE attributes
+ * missing at the end of the array keep their value
+ */
+class Reader {
+public:
+    /**
+     * Throws msgpack::type_error if the object is not an array
+     */
+    explicit Reader(const msgpack::object& object) : fObject(object) {
+        if (object.type != msgpack::type::ARRAY) {
+            throw msgpack::type_error();
+        }
+    }
+
+    template<typename T>
+    void attribute(std::size_t index, T& value) const {
+        if (index < fObject.via.array.size) {
+            fObject.via.array.ptr[index].convert(value);
+        }
+    }
+
+    template<typename T>
+    void array(std::size_t index, std::vector<T>& value) const {
+        if (index < fObject.via.array.size) {
+            unpack(fObject.via.array.ptr[index], value);
+        }
+    }
+
+private:
+    const msgpack::object& fObject;
+};
+
+} // namespace bulk
+
+} // namespace mcf
+
+#endif // MCF_BULKARRAY_H
@@ -7,10 +7,18 @@
 #include <atomic>
 #include <thread>
 #include <chrono>
+#include <condition_variable>
+#include <future>
+#include <limits>
+#include <map>
 #include <string>
 #include <memory>
+#include <mutex>
 
 #include "mcf_core/ValueStore.h"
+#include "mcf_core/ComponentExecutor.h"
+#include "mcf_core/HandlerReadyList.h"
+#include "mcf_core/PeriodicTimer.h"
 #include "mcf_core/Messages.h"
 #include "mcf_core/IComponent.h"
 #include "mcf_core/Port.h"
@@ -35,7 +43,8 @@ class ComponentTraceEventGenerator;
  * - shutdown() is called on component shutdown
  *
  * Further handlers can be registered.
- * All activations of these functions will be done in the same thread.
+ * All activations of these functions will be done in the same thread, or, if an executor is set,
+ * one after another on the executor's worker threads.
  *
  **/
 class Component : public IComponent {
@@ -44,6 +53,7 @@ public:
 
     static constexpr const char* DEFAULT_CONFIG_NAME_SUFFIX = ".json";
     static constexpr const char* DEFAULT_CONFIG_TOPIC_PATH = "mcf/configs/";
+    static constexpr int64_t DEFAULT_STATISTICS_INTERVAL_MS = 1000;
 
     Component(const std::string& name, int priority = 1);
 
@@ -78,6 +88,44 @@ public:
 
     void ctrlStop() override;
 
+    /**
+     * @brief Run the component on a shared worker pool instead of a dedicated thread
+     *
+     * Takes effect on the next ctrlStart(). While running on an executor, the scheduling
+     * parameters of the component are not applied, as the worker threads are shared.
+     *
+     * @param executor The executor, or nullptr for a dedicated component thread
+     */
+    void ctrlSetExecutor(const std::shared_ptr<ComponentExecutor>& executor) override {
+        fExecutor = executor;
+    }
+
+    /**
+     * @brief Runs all port handlers inline on the threads writing their values
+     *
+     * The same as registering every port handler with PortTriggerHandlerOptions::fused. A handler
+     * runs inline only while the component is running and no other handler of the component is
+     * running, otherwise the component is woken as usual. All handlers of the component are still
+     * serialized, on its own thread or the writers' threads. Concurrent handlers on an executor
+     * are never run inline.
+     *
+     * @param fused true to run handlers inline whenever possible
+     */
+    void ctrlSetFused(bool fused) override;
+
+    /**
+     * @brief Pre-faults the stack of the component thread before startup(), see RealtimeMemoryOptions
+     *
+     * In executor mode, the stack of the worker running the startup is pre-faulted.
+     */
+    void ctrlSetStackPrefault(size_t bytes) override {
+        fStackPrefaultBytes = bytes;
+    }
+
+    void post(std::function<void()> function) override;
+
+    void postAfter(std::chrono::nanoseconds delay, std::function<void()> function) override;
+
     /**
      * @brief Sets the scheduling parameters of the component thread, checking them for plausibility
      *
@@ -91,6 +139,81 @@ public:
      */
     void ctrlSetSchedulingParameters(const SchedulingParameters& parameters) override;
 
+    /**
+     * The scheduling parameters last set with ctrlSetSchedulingParameters()
+     */
+    SchedulingParameters getSchedulingParameters() const {
+        std::lock_guard<std::mutex> lk(fSchedulingMutex);
+        return fThreadSchedulingParameters;
+    }
+
+    /**
+     * The CPUs the dedicated component thread may currently run on, i.e. its effective placement
+     *
+     * @return the CPU mask, or the empty mask if the component is not running on a thread of its own
+     */
+    CpuMask getEffectiveCpuAffinity() const;
+
+    /**
+     * Number of handler runs which took longer than the deadline of the scheduling parameters
+     *
+     * Counted while a deadline is set, per port handler (by port name) and per trigger handler
+     * (as "*", "*1", ... in registration order), see IComponent::SchedulingParameters::deadline.
+     */
+    std::map<std::string, uint64_t> getDeadlineMisses() const;
+
+    /**
+     * Response of a component to exceeding its overload budget, see OverloadBudget
+     *
+     * ALARM:       only publish a msg::OverloadAlarm
+     * DROP_OLDEST: drop the values queued for the handler which are older than the maximum queue
+     *              age, or all but the newest one after the handler overran its time budget
+     * SKIP:        drop all values queued for the handler and skip its run
+     * FALLBACK:    run the fallback of the handler instead, see PortTriggerHandlerOptions::fallback
+     *
+     * All policies publish an alarm on each violation.
+     */
+    enum class OverloadPolicy {
+        ALARM,
+        DROP_OLDEST,
+        SKIP,
+        FALLBACK
+    };
+
+    /**
+     * Limits beyond which a component sheds load instead of falling further behind
+     *
+     * A port handler is overloaded if a value of its queued receiver ports has been waiting for
+     * longer than maxQueueAge, or if its own previous run took longer than maxHandlerTime. The
+     * policy applies to the overloaded handler only, the other handlers of the component run as
+     * usual. Trigger handlers only raise alarms. Zero disables the respective limit.
+     */
+    struct OverloadBudget {
+        std::chrono::nanoseconds maxHandlerTime{0};
+        std::chrono::nanoseconds maxQueueAge{0};
+        OverloadPolicy policy = OverloadPolicy::ALARM;
+    };
+
+    struct OverloadStatistics {
+        uint64_t handlerTimeViolations = 0;
+        uint64_t queueAgeViolations = 0;
+        uint64_t droppedValues = 0;
+        uint64_t skippedRuns = 0;
+        uint64_t fallbackRuns = 0;
+    };
+
+    /**
+     * Set the overload budget, which applies to the handler runs from now on
+     *
+     * Dropping values from a full blocking queue releases the senders blocked on it, so a
+     * component falling behind does not stall its upstream components.
+     */
+    void setOverloadBudget(const OverloadBudget& budget);
+
+    OverloadBudget getOverloadBudget() const;
+
+    OverloadStatistics getOverloadStatistics() const;
+
     std::string getName() const {
         return fName;
     }
@@ -99,14 +222,67 @@ public:
         return fConfigName;
     }
 
-    msg::RuntimeStats getStatistics() const {
-        return fRuntimeStats;
+    /**
+     * Run time statistics of the handlers in the current statistics window, see
+     * msg::HandlerStats for the percentiles published at the end of each window
+     */
+    msg::RuntimeStats getStatistics() const;
+
+    /**
+     * Length of the statistics windows, the statistics of a window are published when the first
+     * handler run after its end has finished
+     */
+    void setStatisticsInterval(std::chrono::milliseconds interval) {
+        fStatisticsInterval = interval.count();
+    }
+
+    /**
+     * Discard the statistics of the current window and start a new one
+     */
+    void resetStatistics();
+
+    /**
+     * Count cycles, instructions, cache misses, branch misses and context switches of the
+     * handler runs from now on, see ThreadPerfCounters
+     *
+     * The counts are summed per handler in the statistics windows of msg::HandlerStats and traced
+     * as perf counter events following the handler execution events. Runs on threads without
+     * perf counters are not counted.
+     */
+    void enablePerfCounters(bool enable) {
+        fPerfCountersEnabled = enable;
+    }
+
+    bool perfCountersEnabled() const {
+        return fPerfCountersEnabled;
     }
 
+    /**
+     * Performance counter sums of the handlers in the current statistics window
+     */
+    std::map<std::string, PerfCounterTotals::Summary> getPerfCounterStatistics() const;
+
     IComponent::StateType getState() const {
         return fState;
     }
 
+    /**
+     * @sa IComponent::waitStarted()
+     */
+    void waitStarted() override;
+
+    /**
+     * Duration of the last call of startup()
+     */
+    std::chrono::microseconds getStartupDuration() const override {
+        return fStartupDuration;
+    }
+
+    int getNumaNode() const override {
+        std::lock_guard<std::mutex> lk(fSchedulingMutex);
+        return fThreadSchedulingParameters.numaNode;
+    }
+
     virtual void ctrlSetLogLevels(
         LogSeverity consoleLevel, LogSeverity valueStoreLevel)
     {
@@ -212,15 +388,53 @@ protected:
     virtual void readConfig();
 
     /*
-     * Register a handler which runs everytime the component thread is triggered.
+     * Register a handler which runs everytime the component thread is triggered by trigger().
+     * Port events only run the handlers of the ports which received a value.
      */
     void registerTriggerHandler(std::function<void()> handler);
 
+    /**
+     * Register a handler which runs periodically while the component is running
+     *
+     * The timers of all components are served by one shared thread, see PeriodicTimerService.
+     * Like a port handler, the handler runs on the component thread, with the given options.
+     * Expiries while the handler is still pending are merged and counted as overruns.
+     *
+     * @param period    the period, must be > 0
+     * @param handler   the handler to run
+     * @param phase     offset of the expiries from the multiples of the period on the monotonic
+     *                  clock, timers with equal period and phase expire at the same time
+     * @param options   options of the handler, e.g. its priority
+     *
+     * @return the timer, e.g. to query its overruns
+     */
+    std::shared_ptr<PeriodicTimer> registerPeriodicHandler(
+        std::chrono::nanoseconds period,
+        std::function<void()> handler,
+        std::chrono::nanoseconds phase = std::chrono::nanoseconds(0),
+        const PortTriggerHandlerOptions& options = PortTriggerHandlerOptions());
+
     /*
      * Trigger the components thread.
      */
     void trigger();
 
+    /**
+     * Block until the component has left the STARTED state, for helper threads created in startup()
+     *
+     * @return true if the component is RUNNING, false if it is shutting down without having run
+     */
+    bool waitRunning();
+
+    /**
+     * Run the ready port handlers of higher priority than the running handler
+     *
+     * Long running handlers may call this between steps of their work, so that handlers of
+     * higher priority do not wait for them to finish, see PortTriggerHandlerOptions::priority.
+     * Has no effect outside of handlers and in concurrent handlers.
+     */
+    void preemptionPoint();
+
     void registerHandler(std::shared_ptr<PortTriggerHandler> handler) override;
 
     void unregisterHandler(std::shared_ptr<PortTriggerHandler> handler) override;
@@ -238,9 +452,118 @@ private:
 
     void main();
 
+    /**
+     * One activation of the component on the executor, the equivalent of an iteration of main()
+     */
+    void executorStep();
+
+    /**
+     * Run the registered trigger handlers and all port trigger handlers with an active event flag
+     */
+    void runHandlers();
+
+    /**
+     * Run a port trigger handler if its event flag is active
+     *
+     * @return the end of the handler run, or the default time point if the handler did not run
+     */
+    std::chrono::high_resolution_clock::time_point runPortHandler(PortTriggerHandler& handler);
+
+    /**
+     * Shed load if the handler is overloaded and call it, see runPortHandler()
+     */
+    std::chrono::high_resolution_clock::time_point callPortHandler(PortTriggerHandler& handler);
+
+    /**
+     * Leave a ready handler with stamped inputs to runLogicalHandlers(), see LogicalClock
+     *
+     * @return true if the handler has stamped inputs
+     */
+    bool deferToLogicalTime(PortTriggerHandler& handler);
+
+    /**
+     * Run the handlers with stamped inputs in the order of logical time, the handler registered
+     * first for equal times, until the earliest input is not safe yet
+     *
+     * Each handler runs at most once per call, the component is triggered again if inputs remain.
+     *
+     * @param lastEnd  set to the end of the last handler run
+     */
+    void runLogicalHandlers(std::chrono::high_resolution_clock::time_point& lastEnd);
+
+    /**
+     * Run a handler for its earliest stamped input, which must be safe
+     */
+    std::chrono::high_resolution_clock::time_point runLogicalHandler(PortTriggerHandler& handler,
+                                                                     const LogicalClock::Stamp& input);
+
+    /**
+     * Run a concurrent handler as a task, in logical time if its inputs are stamped
+     *
+     * @param wake  the trigger of the task
+     */
+    void runConcurrentHandler(PortTriggerHandler& handler, const std::weak_ptr<TaskTrigger>& wake);
+
+    /**
+     * Move the ready port handlers to fPendingHandlers, ordered by priority
+     */
+    void collectReadyHandlers();
+
+    /**
+     * Run pending and newly ready port handlers of a priority above the given one, highest first
+     *
+     * @param lastEnd  set to the end of the last handler run
+     */
+    void runPrioritizedHandlers(int above, std::chrono::high_resolution_clock::time_point& lastEnd);
+
+    /**
+     * Run the handler of a fused ready list entry on the calling thread
+     *
+     * @return false if the component is not running or busy and must be woken instead
+     */
+    bool runInline(HandlerReadyList::Entry& entry);
+
+    /**
+     * Run the functions posted so far, see post()
+     */
+    void runPostedFunctions();
+
+    /**
+     * Make the calling worker thread log and trace on behalf of this component
+     */
+    void injectThreadLocals();
+
+    /**
+     * Run a concurrent port trigger handler as a task of its own, see PortTriggerHandlerOptions
+     */
+    void attachConcurrentHandler(const std::shared_ptr<PortTriggerHandler>& handler);
+
+    /**
+     * Give a concurrent handler back to the component trigger
+     *
+     * @param wait  wait until a run of the handler in progress has finished
+     */
+    void detachConcurrentHandler(const std::shared_ptr<PortTriggerHandler>& handler, bool wait);
+
+    /**
+     * The ready list entry of a registered port trigger handler, or nullptr
+     */
+    std::shared_ptr<HandlerReadyList::Entry> findReadyEntry(const std::shared_ptr<PortTriggerHandler>& handler) const;
+
+    void runStartup();
+
+    void runShutdown();
+
+    /**
+     * Change fState and wake all threads waiting for a lifecycle transition
+     */
+    void setState(StateType state);
+
     typedef struct {
         std::function<void(void)> handler;
-        msg::RuntimeStatsEntry statistics;
+        std::string name;
+        std::shared_ptr<LatencyHistogram> latency;
+        std::shared_ptr<PerfCounterTotals> perfCounters;
     } HandlerMapEntry;
 
     typedef struct {
@@ -248,9 +571,40 @@ private:
         msg::RuntimeStatsEntry statistics;
     } ValueHandlerMapEntry;
 
-    static void initStats(msg::RuntimeStatsEntry& stats);
+    /**
+     * Account a handler run in the statistics, the deadline misses and the overload budget
+     *
+     * @return true if the run exceeded the maximum handler time of the overload budget
+     */
+    bool recordHandlerRun(LatencyHistogram& latency,
+                          const std::string& name,
+                          std::chrono::high_resolution_clock::time_point start,
+                          std::chrono::high_resolution_clock::time_point end);
+
+    /**
+     * Publish the handler statistics if the current window has ended by now
+     */
+    void publishStatisticsIfDue(std::chrono::high_resolution_clock::time_point now);
+
+    void statisticsControlUpdate();
+
+    void accountDeadline(const std::string& handler,
+                         std::chrono::high_resolution_clock::duration duration,
+                         std::chrono::nanoseconds deadline);
+
+    /**
+     * Apply the overload policy before a port handler run
+     *
+     * @param fallback set to true if the fallback of the handler shall run instead
+     * @return false if the run shall be skipped
+     */
+    bool shedLoad(PortTriggerHandler& handler, bool& fallback);
 
-    void calcStats(msg::RuntimeStatsEntry& stats, const std::string& topic, std::chrono::high_resolution_clock::time_point start);
+    void publishOverloadAlarm(const std::string& handler,
+                              const char* reason,
+                              std::chrono::nanoseconds measured,
+                              std::chrono::nanoseconds budget,
+                              size_t dropped);
 
     void traceTriggerHandlerExec(const std::chrono::high_resolution_clock::time_point& start,
                                  const std::chrono::high_resolution_clock::time_point& end,
@@ -260,6 +614,10 @@ private:
                                      const std::chrono::high_resolution_clock::time_point& end,
                                      const PortTriggerHandler& handler);
 
+    void tracePerfCounters(const std::chrono::high_resolution_clock::time_point& end,
+                           const std::string& handlerName,
+                           const PerfCounterValues& counts);
+
     void logControlUpdate();
 
     /**
@@ -279,14 +637,64 @@ private:
     std::thread fThread;
     // The pthread handle to the thread, populated when the component thread becomes active
     pthread_t fThreadHandle;
+    // The kernel thread id, required for SCHED_DEADLINE
+    std::atomic<pid_t> fThreadId;
     // The component thread scheduling parameters
-    std::atomic<SchedulingParameters> fThreadSchedulingParameters;
+    SchedulingParameters fThreadSchedulingParameters;
+    mutable std::mutex fSchedulingMutex;
+    // The deadline of fThreadSchedulingParameters in ns, read by the handler loop
+    std::atomic<int64_t> fHandlerDeadline;
+    // The parallelThreads of fThreadSchedulingParameters, applied to the thread running the handlers
+    std::atomic<size_t> fParallelThreads{0};
     std::atomic<bool> fRunRequest;
     std::atomic<bool> fStopRequest;
     std::atomic<IComponent::StateType> fState;
-    std::shared_ptr<Trigger> fTrigger;
+    std::atomic<std::chrono::microseconds> fStartupDuration;
+    // guards the lifecycle transitions of fState, fRunRequest and fStopRequest
+    std::mutex fLifecycleMutex;
+    std::condition_variable fLifecycleCondition;
+    std::shared_ptr<TaskTrigger> fTrigger;
+    // set by trigger(), so that port events do not run the trigger handlers
+    std::atomic<bool> fTriggerRequested;
+    std::shared_ptr<HandlerReadyList> fReadyList;
+    std::shared_ptr<ComponentExecutor> fExecutor;
+    // the task running the component while started on fExecutor, nullptr otherwise
+    std::shared_ptr<ExecutorTask> fExecutorTask;
+    std::promise<void> fExecutorStopped;
+
+    struct ConcurrentHandler {
+        std::shared_ptr<PortTriggerHandler> handler;
+        std::shared_ptr<TaskTrigger> trigger;
+        std::shared_ptr<ExecutorTask> task;
+    };
+    std::vector<ConcurrentHandler> fConcurrentHandlers;
     std::vector<HandlerMapEntry> fTriggerHandlers;
-    std::vector<std::shared_ptr<PortTriggerHandler>> fPortTriggerHandlers;
+    std::vector<std::shared_ptr<HandlerReadyList::Entry>> fPortTriggerHandlers;
+    // the timers of periodic handlers, armed while the component is running
+    std::vector<std::shared_ptr<PeriodicTimer>> fPeriodicTimers;
+    std::shared_ptr<PeriodicTimerService> fTimerService;
+    // functions posted to the component thread, shared with pending postAfter() timers
+    struct PostedFunctions {
+        std::mutex mutex;
+        std::vector<std::function<void()>> functions;
+    };
+    std::shared_ptr<PostedFunctions> fPosted;
+    // set once a handler with a non-default priority is registered
+    std::atomic<bool> fPrioritized{false};
+    // ready handlers in the order to run them, accessed only while holding fHandlerMutex
+    std::vector<std::shared_ptr<HandlerReadyList::Entry>> fPendingHandlers;
+    // set while port handlers have stamped inputs, accessed only while holding fHandlerMutex
+    bool fLogicalInputs = false;
+    // the priority of the running handler
+    int fRunningPriority = std::numeric_limits<int>::min();
+    // set by ctrlSetFused()
+    std::atomic<bool> fFused{false};
+    // set by ctrlSetStackPrefault()
+    size_t fStackPrefaultBytes = 0;
+    // serializes handler runs of the component with inline runs on other threads
+    std::mutex fHandlerMutex;
+    // the thread holding fHandlerMutex, as the mutex is not recursive
+    std::atomic<std::thread::id> fHandlerThread{std::thread::id()};
 
     std::shared_ptr<ComponentTraceEventGenerator> fComponentTraceEventGenerator;
 
@@ -294,11 +702,29 @@ private:
     ReceiverPort<msg::LogControl> fLogControlPort;
     SenderPort<msg::String> fConfigOutPort;
     ReceiverPort<msg::String> fConfigInPort;
+    SenderPort<msg::HandlerStats> fStatsPort;
+    ReceiverPort<msg::HandlerStatsControl> fStatsControlPort;
+    SenderPort<msg::OverloadAlarm> fOverloadPort;
 
     std::shared_ptr<IidGenerator> fIdGenerator = nullptr;
     ValueFactory fValueFactory;
 
-    msg::RuntimeStats fRuntimeStats;
+    // start of the current statistics window in ns since the clock's epoch
+    std::atomic<int64_t> fStatisticsWindowStart;
+    std::atomic<int64_t> fStatisticsInterval;
+    std::atomic<bool> fPerfCountersEnabled{false};
+    std::map<std::string, uint64_t> fDeadlineMisses;
+    mutable std::mutex fDeadlineMutex;
+
+    // the overload budget in ns, read by the handler loop and concurrent handlers
+    std::atomic<int64_t> fMaxHandlerTime{0};
+    std::atomic<int64_t> fMaxQueueAge{0};
+    std::atomic<OverloadPolicy> fOverloadPolicy{OverloadPolicy::ALARM};
+    std::atomic<uint64_t> fHandlerTimeViolations{0};
+    std::atomic<uint64_t> fQueueAgeViolations{0};
+    std::atomic<uint64_t> fDroppedValues{0};
+    std::atomic<uint64_t> fSkippedRuns{0};
+    std::atomic<uint64_t> fFallbackRuns{0};
 
     /**
      * The component configuration (or null, if not yet obtained)
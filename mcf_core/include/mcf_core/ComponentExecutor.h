@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_COMPONENTEXECUTOR_H
+#define MCF_COMPONENTEXECUTOR_H
+
+#include "mcf_core/ThreadAffinity.h"
+#include "mcf_core/Trigger.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mcf {
+
+class ComponentExecutor;
+
+/**
+ * A unit of work which is run on a ComponentExecutor whenever it is scheduled
+ *
+ * Scheduling a task which is already queued has no effect, scheduling a running task runs it once
+ * more after the current run has finished. A task never runs on two workers at the same time.
+ */
+class ExecutorTask : public std::enable_shared_from_this<ExecutorTask> {
+public:
+    /**
+     * @param executor  the executor running the task, must outlive the task
+     * @param func      the function to run
+     */
+    ExecutorTask(ComponentExecutor& executor, std::function<void()> func);
+
+    /**
+     * Queue the task for running on one of the executor's workers
+     */
+    void schedule();
+
+    /**
+     * Stop running the task, later calls to schedule() have no effect
+     *
+     * @param wait  wait until a run in progress has finished, must be false when called from
+     *              within the task
+     */
+    void cancel(bool wait = true);
+
+private:
+    friend class ComponentExecutor;
+
+    enum State : int {
+        IDLE,
+        QUEUED,
+        RUNNING,
+        RERUN      // scheduled again while running
+    };
+
+    ComponentExecutor& fExecutor;
+    const std::function<void()> fFunc;
+    std::atomic<int> fState{IDLE};
+    std::atomic<bool> fCancelled{false};
+};
+
+
+/**
+ * A pool of worker threads shared by components, see ComponentManager::setExecutorThreads()
+ *
+ * Instead of waking a dedicated thread, a trigger of a component queues the component's task,
+ * which runs the triggered handlers on the next free worker.
+ *
+ * Each worker has a deque of its own. Tasks scheduled by a worker go to its own deque, tasks
+ * scheduled by other threads are distributed round robin. Workers take tasks from the front of
+ * their own deque and, when it is empty, steal from the back of the other workers' deques.
+ */
+class ComponentExecutor {
+public:
+    /**
+     * @param numWorkers    number of worker threads, must be > 0
+     * @param name          prefix of the worker thread names
+     * @param cpuAffinity   the CPUs the workers may run on, the empty mask leaves them unpinned
+     */
+    explicit ComponentExecutor(size_t numWorkers,
+                               const std::string& name = "mcf_worker",
+                               CpuMask cpuAffinity = 0);
+
+    /**
+     * Stops the workers after their current task, queued tasks are discarded
+     */
+    ~ComponentExecutor();
+
+    ComponentExecutor(const ComponentExecutor&) = delete;
+    ComponentExecutor& operator=(const ComponentExecutor&) = delete;
+
+    size_t getNumWorkers() const {
+        return fWorkers.size();
+    }
+
+    /**
+     * Number of tasks taken from the deque of another worker since construction
+     */
+    uint64_t getStealCount() const {
+        return fStealCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    friend class ExecutorTask;
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<ExecutorTask>> tasks;
+    };
+
+    void schedule(ExecutorTask& task);
+
+    void cancel(ExecutorTask& task, bool wait);
+
+    void push(std::shared_ptr<ExecutorTask> task);
+
+    std::shared_ptr<ExecutorTask> pop(size_t index);
+
+    void run(ExecutorTask& task);
+
+    void work(size_t index);
+
+    std::vector<std::unique_ptr<WorkerQueue>> fQueues;
+    std::atomic<size_t> fQueued{0};
+    std::atomic<size_t> fNextQueue{0};
+    std::atomic<int> fSleeping{0};
+    std::atomic<uint64_t> fStealCount{0};
+    std::atomic<bool> fStopRequest{false};
+    // guards sleeping workers and cancel()
+    std::mutex fMutex;
+    std::condition_variable fWorkAvailable;
+    std::condition_variable fTaskFinished;
+    std::vector<std::thread> fWorkers;
+};
+
+
+/**
+ * A Trigger which schedules an ExecutorTask instead of waking a waiting thread while a task is set
+ */
+class TaskTrigger : public Trigger {
+public:
+    ~TaskTrigger() override { detachTriggerSources(); }
+
+    /**
+     * Set the task to schedule on trigger(), nullptr switches back to waking wait()
+     */
+    void setTask(std::shared_ptr<ExecutorTask> task) {
+        std::atomic_store(&fTask, std::move(task));
+    }
+
+    void trigger() override {
+        auto task = std::atomic_load(&fTask);
+        if (task) {
+            task->schedule();
+        }
+        else {
+            Trigger::trigger();
+        }
+    }
+
+private:
+    std::shared_ptr<ExecutorTask> fTask;
+};
+
+} // namespace mcf
+
+#endif // MCF_COMPONENTEXECUTOR_H
@@ -80,6 +80,20 @@ public:
      */
     ComponentProxy reloadComponent(const std::string& instanceName);
 
+    /**
+     * @brief Reloads a running component without dropping the values sent to it meanwhile
+     *
+     * The new instance is started right away, taking over the queues of the previous one, see
+     * ComponentManager::replaceComponent().
+     *
+     * @param instanceName The instance name of the component
+     * @param transferState Optional hand over of the state of the previous instance
+     * @return The ComponentProxy for the new instance
+     */
+    ComponentProxy hotReloadComponent(
+        const std::string& instanceName,
+        const ComponentManager::StateTransfer& transferState = nullptr);
+
     std::vector<std::string> listComponentTypes() const;
     std::vector<std::string> listComponentTypes(const std::string& nameSpace) const;
 };
@@ -23,15 +23,63 @@ class LogMessage;
 using LogSeverity = spdlog::level::level_enum;
 template<typename T> class SenderPort;
 
+/**
+ * Settings of asynchronous logging, see ComponentLogger::enableAsyncLogging()
+ */
+struct AsyncLogConfig {
+    /// messages in the preallocated queue of the log thread
+    size_t queueSize = 8192;
+    /// overwrite the oldest queued message if the queue is full, instead of waiting for room
+    bool dropWhenFull = true;
+};
+
+/**
+ * Counters of asynchronous logging
+ */
+struct AsyncLogStatistics {
+    bool enabled = false;
+    size_t queueSize = 0;
+    /// messages overwritten since the queue was full
+    uint64_t dropped = 0;
+};
+
 class ComponentLogger {
 
     public:
 
         ComponentLogger(std::string name, SenderPort<msg::LogMessage>& logMessagePort);
 
+        ~ComponentLogger();
+
+        ComponentLogger(const ComponentLogger&) = delete;
+        ComponentLogger& operator=(const ComponentLogger&) = delete;
+
+        /**
+         * Log asynchronously with the component loggers created from now on
+         *
+         * A log call then only formats the message and copies it into a preallocated queue,
+         * messages of up to 250 characters without allocation. A log thread applies the pattern
+         * and passes the messages to the console and value store sinks, so that publishing log
+         * messages does not delay the handlers. The queue and the log thread are created by the
+         * first call and kept for the lifetime of the process, later calls keep their settings.
+         */
+        static void enableAsyncLogging(const AsyncLogConfig& config = AsyncLogConfig());
+
+        /**
+         * Log synchronously with the component loggers created from now on
+         */
+        static void disableAsyncLogging();
+
+        static AsyncLogStatistics getAsyncLogStatistics();
+
         static bool hasComponentLogger();
 
-        static std::shared_ptr<spdlog::logger> getLocalLogger();
+        /**
+         * The logger of the component running on the calling thread, the global MCF logger if none
+         *
+         * Returned by reference, so that the logging macros do not touch the reference count.
+         */
+        static const std::shared_ptr<spdlog::logger>& getLocalLogger();
 
         /**
          * Sets the log level for the value store sink (integer log level overload)
@@ -53,6 +101,18 @@ class ComponentLogger {
 
         void injectLocalLogger();
 
+        /**
+         * Make this the logger of the calling thread, even if it has one already
+         *
+         * @return the previous logger of the thread, nullptr if it had none
+         */
+        std::shared_ptr<spdlog::logger> replaceLocalLogger();
+
+        /**
+         * Set the logger of the calling thread to one returned by replaceLocalLogger()
+         */
+        static void restoreLocalLogger(std::shared_ptr<spdlog::logger> logger);
+
         LogSeverity getConsoleLogLevel() const;
 
         LogSeverity getValueStoreLogLevel() const;
@@ -61,6 +121,13 @@ class ComponentLogger {
 
 private:
 
+        /// the log message port, detached when the logger is destroyed
+        struct LogMessagePortRef;
+
+        std::shared_ptr<spdlog::logger> createLogger() const;
+
+        void updateLoggerLevel();
+
         /*
          * Shared pointers to the component logger and sinks
          */
@@ -78,7 +145,7 @@ private:
 
         std::string fName;
 
-        SenderPort<msg::LogMessage>& fLogMessagePort;
+        std::shared_ptr<LogMessagePortRef> fLogMessagePort;
 };
 
 }  // namespace mcf
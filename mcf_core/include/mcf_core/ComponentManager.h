@@ -6,11 +6,21 @@
 
 #include <thread>
 #include <chrono>
+#include <functional>
 #include <string>
+#include <set>
+#include <vector>
 
 #include "mcf_core/IComponentConfig.h"
 #include "mcf_core/Port.h"
 #include "mcf_core/DefaultIdGenerator.h"
+#include "mcf_core/LineageTracker.h"
+#include "mcf_core/Mutexes.h"
+#include "mcf_core/Numa.h"
+#include "mcf_core/RealtimeMemory.h"
+#include "mcf_core/ThreadAffinity.h"
+#include "mcf_core/ValueSnapshot.h"
+#include "mcf_core/PreviewService.h"
 
 namespace mcf {
 /**
@@ -70,6 +80,11 @@ public:
     void setMaxQueueLength(std::size_t length);
 
     bool isQueued() const;
+
+    /**
+     * The value queue of a queued port, nullptr for other ports
+     */
+    std::shared_ptr<ValueQueue> queue() const;
 };
 
 /**
@@ -187,6 +202,13 @@ public:
 
     void setSchedulingParameters(const IComponent::SchedulingParameters& parameters);
 
+    /**
+     * @brief Keeps a dedicated thread for the component in executor mode
+     *
+     * @sa ComponentManager::setDedicatedThread()
+     */
+    void setDedicatedThread(bool dedicated);
+
 private:
     std::string _name;
     std::string _typeName;
@@ -194,6 +216,7 @@ private:
     ComponentManager& _componentManager;
 };
 
+class ComponentExecutor;
 class ComponentTraceController;
 class ValueStore;
 
@@ -287,14 +310,31 @@ public:
      */
     class Config : public IComponentConfig {
     public:
-        explicit Config(ComponentManager& componentManager, std::string instanceName) ;
+        /**
+         * @param deferRegistration collect port registrations for applyRegistrations() instead of
+         *                          registering them right away (parallel configuration)
+         */
+        explicit Config(ComponentManager& componentManager, std::string instanceName, bool deferRegistration = false) ;
         void registerPort(Port& port) override;
         void registerPort(Port& port, const std::string& topic) override;
         std::string instanceName() const { return fInstanceName; }
 
+        /**
+         * Register the collected ports with the component manager
+         */
+        void applyRegistrations();
+
     private:
+        struct DeferredPort {
+            Port* port;
+            bool mapped;
+            std::string topic;
+        };
+
         ComponentManager& fComponentManager;
         std::string fInstanceName;
+        bool fDeferRegistration;
+        std::vector<DeferredPort> fDeferredPorts;
     };
 
     /*
@@ -347,7 +387,8 @@ public:
      * Shuts down components
      *
      * This method stops all currently running components such that no component participates in
-     * message exchange afterwards.
+     * message exchange afterwards. The components are stopped in parallel, see
+     * setShutdownOptions().
      */
     void shutdown();
 
@@ -363,6 +404,64 @@ public:
      */
     void eraseComponent(const ComponentProxy& descriptor);
 
+    /**
+     * @brief Hands the state of a component instance being replaced over to its successor
+     *
+     * Called with the previous instance stopped and the new one configured but not started.
+     */
+    using StateTransfer = std::function<void(IComponent& previous, IComponent& next)>;
+
+    /**
+     * @brief Timing of a replaceComponent() call, see getReloadStatistics()
+     */
+    struct ReloadStatistics
+    {
+        std::string component;
+        /// from the registration of the new instance until the previous one is erased
+        std::chrono::microseconds duration;
+        /// from stopping the previous instance until the new one runs, no handler runs meanwhile
+        std::chrono::microseconds stall;
+        /// queued receiver ports taken over by the new instance and the values they held
+        size_t handedOverQueues = 0;
+        size_t handedOverValues = 0;
+    };
+
+    /**
+     * @brief Replaces a running component by a new instance without losing values sent to it
+     *
+     * The new instance is registered under the name of the previous one and configured while the
+     * previous one still runs. Then the previous instance is stopped and its queued receiver
+     * ports keep buffering the values of their topics, until the ports of the same name of the
+     * new instance take their queues over, see GenericQueuedReceiverPort::takeOverQueue(). The
+     * other ports of the new instance are connected as usual. The new instance is started right
+     * away and the previous one is erased.
+     *
+     * Writers to full blocking queues wait for the new instance, values beyond the length of
+     * non-blocking queues are dropped as usual. Non-queued receivers read the latest value of
+     * their topics anyway.
+     *
+     * @param previous The running component to replace
+     * @param component The new instance
+     * @param typeName The type name of the new instance
+     * @param configName The config name of the new instance, see registerComponent()
+     * @param transferState Optional hand over of the state of the previous instance
+     * @return The descriptor of the new instance
+     * @throws std::runtime_error if previous is not running
+     * @throws the error of configuring the new instance, which is then erased again while the
+     *         previous one keeps running
+     */
+    ComponentProxy replaceComponent(
+        const ComponentProxy& previous,
+        std::shared_ptr<IComponent> component,
+        const std::string& typeName,
+        const std::string* configName = nullptr,
+        const StateTransfer& transferState = nullptr);
+
+    /**
+     * @brief Timing of the replaceComponent() calls so far, oldest first
+     */
+    std::vector<ReloadStatistics> getReloadStatistics() const;
+
     /**
      * @brief Sets a component's scheduling options
      *
@@ -371,11 +470,251 @@ public:
      * scheduling policies.
      *
      * @param proxy A component descriptor object
-     * @param parameters Scheduling parameters: scheduling policy and priority.
+     * @param parameters Scheduling parameters: scheduling policy, priority and CPU affinity.
      */
     void setSchedulingParameters(
         const ComponentProxy& proxy, const IComponent::SchedulingParameters& parameters);
 
+    /**
+     * @brief Runs components on a shared pool of worker threads (executor mode)
+     *
+     * In executor mode, components do not get a thread of their own. Instead, each trigger of a
+     * component queues the component on the pool, where its handlers run on the next free worker.
+     * The handlers of one component still never run concurrently. Components excluded by
+     * setDedicatedThread() keep their own thread, so that scheduling parameters can be applied.
+     *
+     * The setting takes effect for components started afterwards.
+     *
+     * @param numWorkers Number of worker threads, 0 disables executor mode
+     * @param cpuAffinity The CPUs the worker threads may run on, the empty mask leaves them unpinned
+     */
+    void setExecutorThreads(size_t numWorkers, CpuMask cpuAffinity = 0);
+
+    /**
+     * @brief Number of worker threads in executor mode, 0 if executor mode is disabled
+     */
+    size_t getExecutorThreads() const;
+
+    /**
+     * @brief Lets a component keep a dedicated thread in executor mode
+     *
+     * Use this for components which need real-time scheduling parameters or which block in their
+     * handlers. Takes effect on the next startup of the component.
+     *
+     * @param proxy A component descriptor object
+     * @param dedicated true to run the component on its own thread
+     */
+    void setDedicatedThread(const ComponentProxy& proxy, bool dedicated);
+
+    /**
+     * @brief Configures and starts components in parallel on a pool of bring-up threads
+     *
+     * configure() then calls the components' configure() methods concurrently, honoring the
+     * dependencies declared with addDependency(). startup() runs their startup() methods
+     * concurrently, honoring the declared dependencies and, if enabled, the port connections:
+     * a component receiving on a topic is started after the components sending on it.
+     * Dependency cycles are broken with a warning. All components are set running together once
+     * all of them have started, as in sequential mode.
+     *
+     * Components must not access the component manager from configure() in this mode, port
+     * registrations are applied when all configure() calls have finished.
+     *
+     * @param numThreads Number of bring-up threads, 0 for sequential configuration (default)
+     * @param portDependencies Derive startup ordering constraints from port connections
+     */
+    void setLifecycleThreads(size_t numThreads, bool portDependencies = true);
+
+    /**
+     * @brief Settings of shutdown(), see setShutdownOptions()
+     */
+    struct ShutdownOptions
+    {
+        /// threads stopping components concurrently, 0 to stop them one by one
+        size_t numThreads = 8;
+        /// stop the components receiving a topic before the components sending on it
+        bool portDependencies = true;
+        /// components taking longer to stop are reported, 0 for no deadline
+        std::chrono::milliseconds stopDeadline{5000};
+    };
+
+    /**
+     * @brief Sets how shutdown() stops the components
+     *
+     * shutdown() stops the running components concurrently in the reverse order of startup(): a
+     * component is stopped after the components which depend on it by addDependency() and, if
+     * enabled, after the components receiving its topics. A slow shutdown() of one component
+     * thus only delays the components it depends on, not all of them. Dependency cycles are
+     * broken with a warning.
+     *
+     * A component which has not stopped within the stop deadline is logged with what keeps it,
+     * e.g. a handler which does not return or its shutdown(), and again with its stop duration
+     * once it has stopped. shutdown() still waits for it, its threads cannot be abandoned safely.
+     * The stop durations are part of getLifecycleTimeline().
+     *
+     * @param options The shutdown settings
+     */
+    void setShutdownOptions(const ShutdownOptions& options);
+
+    /**
+     * @brief Declares that a component must be configured and started after another one
+     *
+     * Only has an effect with setLifecycleThreads() > 0. shutdown() stops the dependency after
+     * the component.
+     *
+     * @param component The dependent component
+     * @param dependency The component to configure and start first
+     */
+    void addDependency(const ComponentProxy& component, const ComponentProxy& dependency);
+
+    /**
+     * @brief Declares a chain of components as a fused pipeline
+     *
+     * The port handlers of all components but the first one run inline on the thread of their
+     * predecessor, right inside its setValue(), instead of waking a thread of their own. This
+     * saves a thread wakeup per stage for chains which do not need to run in parallel. A stage
+     * which is busy, e.g. with a value from another sender, is woken as usual.
+     *
+     * Handlers running inline delay the sender, fuse only stages with short handlers.
+     *
+     * @param chain The components in the order values flow through them
+     * @param fused false to give the components their own threads back
+     */
+    void fuse(const std::vector<ComponentProxy>& chain, bool fused = true);
+
+    /**
+     * @brief Applies process wide memory settings against page faults in real-time components
+     *
+     * Locks the process memory and pre-faults heap memory right away, if enabled. The stacks of
+     * component threads are pre-faulted before the startup() of components started afterwards,
+     * so that no major page faults occur once the components are running. The locked memory
+     * size is logged.
+     *
+     * The settings are global to the process: locking the memory or pre-faulting the heap also
+     * disables heap trimming with mallopt() for all code of the process, which stays disabled
+     * when the settings are changed again. Set them once, from the system configuration (see
+     * ComponentSystemConfigurator::configureFromJSONNode()), rather than per component.
+     *
+     * @param options The memory settings
+     * @return The size of the memory locked by the process, see getLockedMemorySize()
+     * @throws std::runtime_error if the memory cannot be locked, e.g. due to RLIMIT_MEMLOCK
+     */
+    size_t setRealtimeMemory(const RealtimeMemoryOptions& options);
+
+    /**
+     * @brief Selects where the memory of values sent between NUMA nodes is placed
+     *
+     * With NumaPlacement::CONSUMER, each sender port migrates the external memory of its values
+     * to the node of the majority of the components receiving its topic, see
+     * IComponent::SchedulingParameters::numaNode. Takes effect when ports are connected.
+     *
+     * @param placement The placement policy, NumaPlacement::PRODUCER by default
+     */
+    void setNumaPlacement(NumaPlacement placement);
+
+    /**
+     * @brief Tracks end-to-end latencies from source to sink topics while the system runs
+     *
+     * The statistics are published to /mcf/lineage<sink topic> of the value store of the
+     * manager, see LineageTracker.
+     *
+     * @param config The source and sink topics, tracking is disabled if there is no sink
+     */
+    void enableLineageTracking(const LineageConfig& config);
+
+    /**
+     * @brief Keeps the latest values of selected topics across restarts
+     *
+     * The first startup() afterwards writes the values of the snapshot file to the value store
+     * after the components have started and before they run, so that they find the state of the
+     * previous run, e.g. maps and calibrations, without waiting for these topics to be published
+     * again. While the system runs, snapshots are written every config.interval, and shutdown()
+     * writes one before stopping the components. See ValueSnapshot.
+     *
+     * @param config The snapshot settings, snapshots are disabled if config.file is empty
+     */
+    void enableValueSnapshot(const ValueSnapshotConfig& config);
+
+    /**
+     * @brief Publishes downscaled previews of selected image topics for remote viewers
+     *
+     * The previews are published to /mcf/preview<image topic> of the value store of the manager
+     * from now on, see PreviewService. Their image types must be registered with
+     * PreviewService::registerImageType().
+     *
+     * @param config The preview settings, previews are disabled if config.topics is empty
+     */
+    void enablePreviews(const PreviewConfig& config);
+
+    /**
+     * @brief Sets the QoS profiles of the topics of the value store of the manager
+     *
+     * The profiles are applied by the ports when they are connected, by remote services when
+     * their send rules are added and by value recorders, see TopicQos. Set them before configure().
+     *
+     * @param config The profiles and the topics they apply to
+     * @throws std::runtime_error if a topic refers to an unknown profile
+     */
+    void setTopicQos(const TopicQosConfig& config);
+
+    /**
+     * @brief An entry of the bring-up timeline, see getLifecycleTimeline()
+     */
+    struct LifecycleTimelineEntry
+    {
+        std::string component;
+        /// "configure", "startup" or "shutdown"
+        std::string phase;
+        /// relative to the beginning of the phase
+        std::chrono::microseconds begin;
+        std::chrono::microseconds end;
+        /// the component is on the critical path of the phase
+        bool critical;
+    };
+
+    /**
+     * @brief Timing of the components in the last configure(), startup() and shutdown() calls
+     *
+     * The critical path is the chain of dependencies which determined the duration of the phase.
+     * A summary is logged at the end of each phase.
+     */
+    std::vector<LifecycleTimelineEntry> getLifecycleTimeline() const;
+
+    /**
+     * @brief An entry of the routing table, see getRoutingTable()
+     */
+    struct Route
+    {
+        std::string topic;
+        /// "component.port" of the valid sender and receiver ports mapped to the topic
+        std::vector<std::string> senders;
+        std::vector<std::string> receivers;
+        /// receivers registered in the value store for the topic, e.g. queued ports or remote senders
+        size_t fanOut = 0;
+        /// values written to the topic only reach the all topic receivers, see setTopicElision()
+        bool elided = false;
+    };
+
+    /**
+     * @brief Elides the topics no one reads
+     *
+     * At startup, topics with neither receiver ports nor receivers in the value store nor a
+     * history are elided, see ValueStore::setElided(): writing them neither keeps the latest value
+     * nor notifies receivers, only all topic receivers like a recorder get the values. Enable this
+     * only if no one reads such topics by name, e.g. through remote control or python.
+     * Takes effect at the next startup().
+     *
+     * @param enable true to elide unread topics, false by default
+     */
+    void setTopicElision(bool enable);
+
+    /**
+     * @brief The routing table compiled by the last startup(), one entry per topic of a port
+     *
+     * startup() also logs a warning for each topic without a sender port and each topic which
+     * is sent but not received.
+     */
+    std::vector<Route> getRoutingTable() const;
+
     /*
      * Sets the logging level for a component, if available
      */
@@ -428,6 +767,17 @@ public:
      */
     PortProxy getPort(const ComponentProxy& descriptor, const std::string& name);
 
+    /**
+     * @brief Counter of changes to the registered components, their ports and port topics
+     *
+     * Lets clients cache what they query from the component manager and refresh it only when the
+     * counter has changed. Changes of the port connection states are not counted.
+     *
+     * @return A value which changes whenever a component is registered or erased, a port is
+     *         registered or mapped to a topic via the component manager
+     */
+    uint64_t getTopologyGeneration() const { return fTopologyGeneration.load(); }
+
     void
     mapPort(const ComponentProxy& proxy, const std::string& portName, const std::string& topicName);
 
@@ -470,8 +820,25 @@ private:
 
     void connectPorts();
 
+    /**
+     * Set the NUMA nodes of the sender ports according to fNumaPlacement
+     */
+    void applyNumaPlacement();
+
+    /**
+     * Compile fRoutingTable from the valid ports and elide unread topics if enabled
+     *
+     * @param warn log the topology warnings
+     */
+    void compileRoutingTable(bool warn);
+
     void callConfigure();
 
+    /**
+     * Write the configs parsed by the components to the config cache file, if there is one
+     */
+    void saveConfigCache();
+
     static bool isTopicValid(const std::string& topicName);
 
     struct PortMapEntry {
@@ -483,17 +850,51 @@ private:
         ComponentProxy descriptor;
         std::shared_ptr<IComponent> component;
         ComponentState state;
+        bool dedicatedThread = false;
     };
 
+    void applyExecutor(ComponentMapEntry& entry);
+
+    /**
+     * Disconnects the ports of a running component and stops it, reporting a stop exceeding the
+     * stop deadline
+     */
+    void stopComponent(const ComponentMapEntry& entry, const std::vector<Port*>& ports);
+
+    /**
+     * Indices into ids of the components each component has to wait for
+     */
+    std::vector<std::vector<size_t>> lifecycleDependencies(const std::vector<uint64_t>& ids, bool withPorts);
+
+    void reportTimeline(const std::string& phase,
+                        const std::vector<uint64_t>& ids,
+                        const std::vector<std::vector<size_t>>& dependencies,
+                        const std::vector<std::pair<std::chrono::microseconds, std::chrono::microseconds>>& timings);
+
     ValueStore& fValueStore;
     ComponentTraceController* fComponentTraceController;
+    std::shared_ptr<ComponentExecutor> fExecutor;
     std::map<uint64_t, ComponentMapEntry> fComponents;
     std::map<uint64_t, std::map<std::string, PortMapEntry>> fComponentPortMap;
+    std::map<uint64_t, std::set<uint64_t>> fDependencies;
+    size_t fLifecycleThreads = 0;
+    bool fPortDependencies = true;
+    ShutdownOptions fShutdownOptions;
+    std::vector<LifecycleTimelineEntry> fLifecycleTimeline;
+    std::vector<ReloadStatistics> fReloadStatistics;
 
     std::vector<std::string> fConfigDirs;
+    RealtimeMemoryOptions fRealtimeMemory;
+    NumaPlacement fNumaPlacement = NumaPlacement::PRODUCER;
+    bool fTopicElision = false;
+    std::vector<Route> fRoutingTable;
+    std::unique_ptr<ValueSnapshot> fValueSnapshot;
+    bool fValueSnapshotRestored = false;
+    std::unique_ptr<PreviewService> fPreviewService;
 
     std::shared_ptr<IidGenerator> fIdGenerator;
     std::atomic<uint64_t> fNextComponentId;
+    std::atomic<uint64_t> fTopologyGeneration{0};
 
     /**
      * @brief A mutex to lock the ComponentManager
@@ -510,6 +911,15 @@ private:
      * CompoenentManager::registerPort() (public, requires unchanged component list)
      */
     mutable std::recursive_mutex fMutex;
+
+    /**
+     * @brief Protects the structure of fComponents and fComponentPortMap for getPorts()
+     *
+     * Port lists are read far more often than components are added or removed, hence readers
+     * locking it shared do not need fMutex. Insertions and erasures happen with fMutex and this
+     * mutex locked exclusively, in this order.
+     */
+    mutable mutex::PriorityInheritanceSharedMutex fRegistryMutex;
 };
 
 } // namespace mcf
@@ -4,9 +4,14 @@
 #ifndef MCF_COMPONENTTRACECONTROLLER_H
 #define MCF_COMPONENTTRACECONTROLLER_H
 
+#include "mcf_core/TraceCollector.h"
+#include "mcf_core/TraceFilter.h"
+
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace mcf
 {
@@ -21,8 +26,12 @@ class ValueStore;
 
 /**
  * Controller of trace event generation on value store with given topic
+ *
+ * The event generators write binary trace records to the TraceCollector. The controller is the
+ * sink of their records and publishes them as trace event values on its topic. Further sinks,
+ * e.g. a CtfTraceWriter, receive the records as well, see addTraceSink().
  */
-class ComponentTraceController
+class ComponentTraceController : private ITraceSink
 {
 public:
 
@@ -32,12 +41,15 @@ public:
                                       ValueStore &valueStore,
                                       std::string topic = DEFAULT_TRACE_EVENTS_TOPIC);
 
+    ~ComponentTraceController();
+
     /**
      * Enable or disable event tracing globally
+     *
+     * Also maintains the process wide count of enabled controllers checked by TracePolicy.
      * @param onOff
      */
-    void enableTrace(bool onOff)  // initial state: off
-    { fIsTraceEnabled = onOff; }
+    void enableTrace(bool onOff);  // initial state: off
 
     /**
      * Check if event tracing is enabled
@@ -46,12 +58,62 @@ public:
     bool isTraceEnabled() const
     { return fIsTraceEnabled; }
 
+    /**
+     * Trace only the events selected by the given rules, see TraceFilterRule
+     *
+     * An event is traced if any rule selects it, no rules trace all events (initial state). The
+     * event generators apply the rules to their component once, when they generate their next
+     * event. Throws std::runtime_error if there are more than TraceSelection::MAX_RULES rules.
+     */
+    void setTraceFilter(std::vector<TraceFilterRule> rules);
+
+    /**
+     * Get the rules of the trace filter
+     */
+    std::vector<TraceFilterRule> getTraceFilter() const;
+
+    /**
+     * Get the number of changes of the trace filter, for event generators to detect changes
+     */
+    uint64_t getTraceFilterGeneration() const
+    { return fFilterGeneration.load(std::memory_order_acquire); }
+
+    /**
+     * Apply the trace filter to a component
+     */
+    std::shared_ptr<TraceSelection> createTraceSelection(const std::string& component) const;
+
     /**
      * Get the value store used by this trace controller
      */
     ValueStore& getValueStore()
     { return fValueStore; }
 
+    /**
+     * Get the id of the TraceCollector sink receiving the records of the event generators
+     */
+    uint32_t getSinkId() const
+    { return fSinkId; }
+
+    /**
+     * Publish the trace events generated so far, which is otherwise done by the collector thread
+     */
+    void flush();
+
+    /**
+     * Pass the trace records of the event generators also to the given sink
+     *
+     * The sink is kept until the controller is destroyed, after its last records were passed on.
+     */
+    void addTraceSink(std::shared_ptr<ITraceSink> sink);
+
+    /**
+     * Enable or disable publishing trace events on the value store, e.g. if a CtfTraceWriter
+     * replaces the recording of the trace topic
+     * @param onOff
+     */
+    void enableValueStoreOutput(bool onOff);  // initial state: on
+
     /**
      * Create a new event generator instance
      *
@@ -73,10 +135,21 @@ public:
 
 private:
 
+    void consume(const TraceRecord* records, size_t count) override;
+
     std::string fTraceId;
     ValueStore &fValueStore;
     const std::string fTopic;
     std::atomic_bool fIsTraceEnabled;
+    // input value ids of INPUT_IDS records, added to the next event
+    std::vector<uint64_t> fPendingInputIds;
+    std::atomic_bool fValueStoreOutput;
+    mutable std::mutex fFilterMutex;
+    std::vector<TraceFilterRule> fFilterRules;
+    std::atomic<uint64_t> fFilterGeneration{0};
+    std::mutex fTraceSinksMutex;
+    std::vector<std::shared_ptr<ITraceSink>> fTraceSinks;
+    uint32_t fSinkId;
 };
 
 } // namespace mcf
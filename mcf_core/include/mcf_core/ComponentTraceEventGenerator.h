@@ -4,7 +4,11 @@
 #ifndef MCF_COMPONENTTRACEEVENTGENERATOR_H
 #define MCF_COMPONENTTRACEEVENTGENERATOR_H
 
+#include "mcf_core/TraceBuffer.h"
+
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -20,6 +24,8 @@ using ValuePtr = std::shared_ptr<const Value>;
 
 class PortTriggerHandler;
 class ComponentTraceController;
+struct PerfCounterValues;
+class TraceSelection;
 
 class ComponentTraceEventGenerator {
 
@@ -122,6 +128,17 @@ public:
                               const std::chrono::high_resolution_clock::time_point& end,
                               const PortTriggerHandler& triggerHandler) const;
 
+    /**
+     * Trace event of the performance counters of a handler run
+     *
+     * @param end          end time of the run
+     * @param handlerName  the name of the handler
+     * @param counts       the counts of the run, see Component::enablePerfCounters()
+     */
+    void tracePerfCounters(const std::chrono::high_resolution_clock::time_point& end,
+                           const std::string& handlerName,
+                           const PerfCounterValues& counts) const;
+
     /**
      * Trace event of trigger activation
      *
@@ -158,6 +175,12 @@ public:
      */
     bool isGloballyEnabled() const;
 
+    /**
+     * Check if writes of a port to topic are traced, regardless of the sampling of the trace
+     * filter
+     */
+    bool isTracingPortWrites(const std::string& topic) const;
+
     /**
      * @brief Checks if a topic is a tracing topic (to avoid recursion)
      * 
@@ -182,17 +205,29 @@ public:
 private:
 
     /**
-     * Non-virtual helper method writing the given trace event to the value store
-     * @param event
+     * Check if the trace filter of the controller selects an event
+     *
+     * @param type   the type of the event
+     * @param topic  the topic of the event, nullptr for events without topic
+     */
+    bool isSelected(TraceEventType type, const std::string* topic) const;
+
+    /**
+     * The selection of the current trace filter, nullptr if no filter is set
      */
-    template <typename T>
-    void writeTraceEvent(T&& event) const;
+    std::shared_ptr<TraceSelection> currentSelection() const;
 
     const ComponentTraceController& fTraceController;
-    ValueStore& fValueStore;
+    // the trace filter applied to the component, and the filter generation it was created for
+    mutable std::shared_ptr<TraceSelection> fSelection;
+    mutable std::atomic<uint64_t> fSelectionGeneration;
     const std::string fTopic;
     const std::string fTraceId;
     const std::string fName;
+    // sink of the trace controller and interned strings of the records, see TraceCollector
+    const uint32_t fSink;
+    const uint32_t fTraceIdString;
+    const uint32_t fNameString;
     std::atomic_bool fIsEnabled;  // enabled by default in the constructor
 };
 
@@ -142,6 +142,23 @@ public:
     MSGPACK_DEFINE(traceId, time, componentName, eventName, inputValueIds, threadId, cpuId)
 };
 
+/**
+ * Value holding the performance counters of a handler run, see Component::enablePerfCounters()
+ */
+class ComponentTracePerfCounters : public ComponentTraceEvent {
+public:
+
+    std::string handlerName;   // name of the handler, "*", "*1", ... for trigger handlers
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cacheMisses = 0;
+    uint64_t branchMisses = 0;
+    uint64_t contextSwitches = 0;
+
+    MSGPACK_DEFINE(traceId, time, componentName, handlerName, cycles, instructions, cacheMisses,
+                   branchMisses, contextSwitches, threadId, cpuId)
+};
+
 template<typename T>
 inline void registerComponentTraceValueTypes(T& r) {
     r.template registerType<ComponentTracePortWrite>("mcf::ComponentTracePortWrite");
@@ -152,6 +169,7 @@ inline void registerComponentTraceValueTypes(T& r) {
     r.template registerType<ComponentTracePortTriggerActivation>("mcf::ComponentTracePortTriggerActivation");
     r.template registerType<ComponentTracePortTriggerExec>("mcf::ComponentTracePortTriggerExec");
     r.template registerType<ComponentTraceProgramFlowEvent>("mcf::ComponentTraceProgramFlowEvent");
+    r.template registerType<ComponentTracePerfCounters>("mcf::ComponentTracePerfCounters");
 }
 
 } // namespace msg
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_COROUTINE_H
+#define MCF_COROUTINE_H
+
+/**
+ * Awaitables on top of ReceiverPort::next() and IComponent::postAfter()
+ *
+ * Only available when compiling with C++20 coroutine support. A coroutine started from a
+ * handler runs on the component thread, each co_await suspends it until the component is
+ * activated with the result, so no further threads or locks are involved:
+ *
+ *     mcf::AsyncTask request(int value) {
+ *         fRequestPort.setValue(Request(value));
+ *         auto reply = co_await mcf::nextValue(fReplyPort, std::chrono::milliseconds(50));
+ *         co_await mcf::sleepFor(*this, std::chrono::milliseconds(10));
+ *     }
+ */
+#if defined(__cpp_impl_coroutine) && __cplusplus >= 202002L
+
+#include "mcf_core/IComponent.h"
+#include "mcf_core/Port.h"
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <memory>
+
+namespace mcf {
+
+/**
+ * A coroutine started eagerly and not awaited by its caller
+ *
+ * The frame is destroyed when the coroutine returns. A coroutine waiting without timeout for
+ * the next value of a port which disconnects is never resumed, and its frame is not freed.
+ */
+class AsyncTask {
+public:
+    struct promise_type {
+        AsyncTask get_return_object() noexcept {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+};
+
+template<typename T>
+class NextValueAwaiter {
+public:
+    NextValueAwaiter(ReceiverPort<T>& port, std::chrono::nanoseconds timeout)
+    : fPort(port), fTimeout(timeout)
+    {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        // the continuation is posted to the component, it never runs within this call
+        fPort.next([this, handle](std::shared_ptr<const T> value) {
+            fValue = std::move(value);
+            handle.resume();
+        }, fTimeout);
+    }
+
+    /**
+     * @return the value, nullptr on timeout
+     */
+    std::shared_ptr<const T> await_resume() noexcept {
+        return std::move(fValue);
+    }
+
+private:
+    ReceiverPort<T>& fPort;
+    std::chrono::nanoseconds fTimeout;
+    std::shared_ptr<const T> fValue;
+};
+
+class DelayAwaiter {
+public:
+    DelayAwaiter(IComponent& component, std::chrono::nanoseconds delay)
+    : fComponent(component), fDelay(delay)
+    {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        fComponent.postAfter(fDelay, [handle]() { handle.resume(); });
+    }
+
+    void await_resume() noexcept {}
+
+private:
+    IComponent& fComponent;
+    std::chrono::nanoseconds fDelay;
+};
+
+/**
+ * Await the next value of a port, see ReceiverPort::next()
+ */
+template<typename T>
+NextValueAwaiter<T> nextValue(ReceiverPort<T>& port,
+                              std::chrono::nanoseconds timeout = std::chrono::nanoseconds(0)) {
+    return NextValueAwaiter<T>(port, timeout);
+}
+
+/**
+ * Resume on the component thread after a delay, see IComponent::postAfter()
+ */
+inline DelayAwaiter sleepFor(IComponent& component, std::chrono::nanoseconds delay) {
+    return DelayAwaiter(component, delay);
+}
+
+} // namespace mcf
+
+#endif // __cpp_impl_coroutine
+
+#endif // MCF_COROUTINE_H
@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_CTFTRACEWRITER_H
+#define MCF_CTFTRACEWRITER_H
+
+#include "mcf_core/TraceCollector.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Trace sink writing the records of the event generators as Common Trace Format
+ *
+ * The writer creates a CTF trace directory with the metadata of
+ * mcf_tools/component_tracing/ctf_metadata.py and a stream file holding the events in the format
+ * of trace_2_ctf.py, so that Trace Compass and its MCF analyses can open the trace without the
+ * offline conversion of a recording. Add it to a ComponentTraceController with addTraceSink().
+ *
+ * CTF requires the events of a stream to be ordered by time, while exec time events start before
+ * the events of the code they measure are written. Events are therefore held back for the
+ * reorder window after the latest event time seen. Events arriving later than that are written
+ * with the time of the last written event and counted, see lateEvents().
+ *
+ * Records are written on the thread of the TraceCollector, see ITraceSink::consume().
+ */
+class CtfTraceWriter : public ITraceSink {
+public:
+    /**
+     * Create the trace directory and its metadata, and open the stream file
+     *
+     * Throws std::runtime_error if the files cannot be created.
+     *
+     * @param directory      the trace directory, created if not existing
+     * @param channel        the name of the stream file, use different channels for the traces of
+     *                       different processes in one directory
+     * @param reorderWindow  the time events are held back for ordering them by time
+     */
+    explicit CtfTraceWriter(const std::string& directory,
+                            const std::string& channel = "channel0_0",
+                            std::chrono::microseconds reorderWindow = std::chrono::seconds(1));
+
+    ~CtfTraceWriter() override;
+
+    CtfTraceWriter(const CtfTraceWriter&) = delete;
+    CtfTraceWriter& operator=(const CtfTraceWriter&) = delete;
+
+    void consume(const TraceRecord* records, size_t count) override;
+
+    /**
+     * Write the held back events and close the stream, records consumed later are ignored
+     */
+    void close();
+
+    /// number of CTF events written
+    uint64_t eventsWritten() const;
+
+    /// number of events written with a corrected time, see the class description
+    uint64_t lateEvents() const;
+
+    /**
+     * The CTF metadata of MCF traces, identical to ctf_metadata.py
+     */
+    static const char* metadata();
+
+private:
+    struct PendingEvent {
+        uint64_t time;
+        uint64_t sequence;
+        std::string data;
+
+        bool operator>(const PendingEvent& other) const
+        {
+            return time > other.time || (time == other.time && sequence > other.sequence);
+        }
+    };
+
+    // called with fMutex held
+    void addEvent(uint16_t id, uint64_t time, const TraceRecord& record, bool withTrigger,
+                  bool withDuration);
+    void addPortEvent(uint16_t id, const TraceRecord& record);
+    void addPerfCountersEvent(const TraceRecord& record);
+    void writeEvents(uint64_t maxTime);
+    const std::string& qualified(uint32_t traceId, uint32_t string);
+    const std::string& plain(uint32_t string);
+
+    mutable std::mutex fMutex;
+    std::ofstream fStream;
+    const uint64_t fReorderWindow;
+    std::priority_queue<PendingEvent, std::vector<PendingEvent>, std::greater<PendingEvent>> fPending;
+    uint64_t fNextSequence = 0;
+    uint64_t fLatestTime = 0;
+    uint64_t fFirstWrittenTime = 0;
+    uint64_t fLastWrittenTime = 0;
+    uint64_t fEventsWritten = 0;
+    uint64_t fLateEvents = 0;
+    bool fClosed = false;
+    // strings of interned ids, with and without the "<trace id>:" prefix of trace_2_ctf.py
+    std::unordered_map<uint64_t, std::string> fQualifiedStrings;
+    std::unordered_map<uint32_t, std::string> fPlainStrings;
+};
+
+} // namespace mcf
+
+#endif // MCF_CTFTRACEWRITER_H
@@ -6,14 +6,18 @@
 #define MCF_EVENTTIMINGCONTROLLER_H_
 
 #include "mcf_core/IEventTimingController.h"
+#include "mcf_core/LatencyHistogram.h"
+#include "mcf_core/LogicalClock.h"
 #include "mcf_core/TimestampType.h"
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <vector>
 #include <thread>
 #include <condition_variable>
 #include <functional>
+#include <unordered_map>
 
 namespace mcf
 {
@@ -24,10 +28,17 @@ class IDynamicEventSource;
 class EventTimingController : public IEventTimingController
 {
 
+    static constexpr std::size_t NOT_IN_HEAP = SIZE_MAX;
+
     struct EventSourceControl
     {
         std::string eventSourceName;
         std::shared_ptr<IDynamicEventSource> eventSource;
+        /// the next event when the source was last queried, valid while the source is in the heap
+        TimestampType nextEventTime;
+        std::string nextEventTopic;
+        /// position in fSourceHeap, NOT_IN_HEAP if the source had no event
+        std::size_t heapPosition = NOT_IN_HEAP;
     };
 
     public:
@@ -83,6 +94,61 @@ class EventTimingController : public IEventTimingController
          */
         void setSpeed(float speed);
 
+        /**
+         * Enable or disable unthrottled playback
+         *
+         * When unthrottled, events are fired as soon as the previous one has been fired, without
+         * waiting for the simulation time. The simulation time is the time of the last fired
+         * event. Playback is only held back by pauses and waits for push events (e.g. the pipeline
+         * end of a ReplayEventController running without drops). When disabled again, the
+         * simulation time continues from the last fired event.
+         */
+        void setUnthrottled(bool unthrottled);
+
+        bool isUnthrottled() const;
+
+        /**
+         * Get the simulation time played back per wall clock time since the first event,
+         * excluding the time spent paused with pause(). Returns 0 before the first event.
+         */
+        float getAchievedSpeedup() const;
+
+        /**
+         * Start measuring the latency of a step, e.g. when a single step is requested. The
+         * measurement ends when the next event is fired, see getStepLatency().
+         */
+        void beginStepLatency();
+
+        /**
+         * Latency from each beginStepLatency() to the first event fired after it
+         */
+        LatencyHistogram::Summary getStepLatency() const;
+
+        /**
+         * Replay in logical time, see LogicalClock, nullptr to disable
+         *
+         * Fired events are stamped with their event time, and the time of the next event is held
+         * in the clock. An event is only fired once it is within the lookahead of the earliest
+         * time held by queued values and running handlers.
+         */
+        void setLogicalClock(std::shared_ptr<LogicalClock> clock);
+
+        std::shared_ptr<LogicalClock> getLogicalClock() const;
+
+        /**
+         * Reposition all event sources to a simulation time
+         *
+         * The event sources seek to time - preRoll, see IDynamicEventSource::seek(). The events
+         * before time are then fired without waiting for the simulation time, e.g. to let the
+         * components build up their state, and playback continues at time. Sources which do not
+         * implement seeking keep their events. Waits for the sources to seek and must not be
+         * called from a thread the event sources wait for, e.g. a thread firing events.
+         *
+         * @return false if playback has finished or no source supports seeking
+         */
+        bool seek(const TimestampType& time,
+                  std::chrono::microseconds preRoll = std::chrono::microseconds(0));
+
         /**
          * Check if next event is from a specific source.
          */
@@ -177,6 +243,29 @@ class EventTimingController : public IEventTimingController
          */
         bool allEventSourcesFinished() const;
 
+        /**
+         * Continue the simulation time at the given time (fFireMutex should be locked by caller)
+         */
+        void rebaseSimulationTimeImpl(const TimestampType& time);
+
+        /**
+         * Query the next event of a source and move it in the heap accordingly (fFireMutex should be
+         * locked by caller)
+         */
+        void updateEventSourceImpl(std::size_t index);
+
+        /**
+         * Query all sources and rebuild the heap and the index of the sources (fFireMutex should be
+         * locked by caller)
+         */
+        void rebuildSourceHeapImpl();
+
+        bool earlierInHeap(std::size_t lhsPosition, std::size_t rhsPosition) const;
+        void swapInHeap(std::size_t lhsPosition, std::size_t rhsPosition);
+        void siftUp(std::size_t position);
+        void siftDown(std::size_t position);
+        void removeFromHeap(std::size_t position);
+
         /**
          * Return the next event to send and its sending time (thread-safe)
          */
@@ -240,6 +329,18 @@ class EventTimingController : public IEventTimingController
          */
         std::chrono::microseconds calcCurrentRunTime() const;
 
+        /**
+         * Hold the time of the next event in the logical clock instead of the previous one
+         * (fFireMutex should be locked by caller)
+         */
+        void holdNextEventImpl(bool hasNextEvent);
+
+        /**
+         * Wake the eventProcessing() thread to re-check its conditions (fFireMutex should be
+         * locked by caller)
+         */
+        void notifyEventProcessingImpl();
+
         /**
          * Thread which fires events at the correct time until there are no more events or playback
          * is manually finished.
@@ -250,6 +351,19 @@ class EventTimingController : public IEventTimingController
         TimestampType fPreviousRunningStartTime;
         TimestampType fPauseStartTime;
 
+        /**
+         * Time of the last fired event, the simulation time when unthrottled
+         */
+        TimestampType fUnthrottledTime;
+
+        /**
+         * Time of the first event and wall clock time it was found, for getAchievedSpeedup()
+         */
+        TimestampType fPlaybackStartTime;
+        std::chrono::steady_clock::time_point fWallStartTime;
+        std::chrono::steady_clock::time_point fUserPauseStartTime;
+        std::chrono::steady_clock::duration fUserPauseElapsed;
+
         std::chrono::microseconds fRunTimeElapsed;
         std::chrono::microseconds fPauseTimeElapsed;
 
@@ -259,9 +373,45 @@ class EventTimingController : public IEventTimingController
         bool fIsInitialised       = false;   // flag determining whether event sources have been initialised
         bool fShouldCheckNextEvent = false;  // flag indicating whether we should re-check the next event
         bool fEnd                 = false;   // flag determining whether we have reached end of recording while in pause mode
+        bool fUnthrottled         = false;   // flag determining whether events are fired without waiting for simulation time
+        bool fSeeking             = false;   // flag indicating that the event sources are being repositioned by seek()
+        bool fPreRolling          = false;   // flag indicating that events before fSeekTarget are fired without waiting
+
+        /**
+         * Time to continue playback at after the pre-roll of seek()
+         */
+        TimestampType fSeekTarget;
+
+        /**
+         * Start of the step being measured if fStepPending, see beginStepLatency()
+         */
+        std::chrono::steady_clock::time_point fStepStartTime;
+        bool fStepPending = false;
+        LatencyHistogram fStepLatency;
+
+        /**
+         * Logical clock of a deterministic replay, see setLogicalClock(), and the clock holding
+         * fHeldEventTime, if any
+         */
+        std::shared_ptr<LogicalClock> fLogicalClock;
+        std::shared_ptr<LogicalClock> fHeldEventClock;
+        LogicalTime fHeldEventTime;
 
         std::vector<EventSourceControl> fEventSources;
 
+        /**
+         * Min-heap of the indices of the sources with an event, by the time of their next event
+         * and then by index. The cached times are kept up to date by triggerNewEventPushed(), and
+         * the time of the top source is checked before it is fired. Sources without an event are
+         * queried again when they push an event or when no source has one.
+         */
+        std::vector<std::size_t> fSourceHeap;
+
+        /**
+         * Index of each source in fEventSources
+         */
+        std::unordered_map<const IDynamicEventSource*, std::size_t> fSourceIndices;
+
         /**
          * Time of the current next event to be fired.
          */
@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_EXTMEMPOOL_H
+#define MCF_EXTMEMPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Pool recycling the external memory buffers of ExtMemValues
+ *
+ * Buffers are grouped in size classes, four per power of two, so that a buffer is at most a
+ * quarter larger than requested and values of similar size (e.g. images of one camera) share
+ * their buffers. Freed buffers are kept for reuse until the configured number of cached bytes
+ * is reached, further buffers go back to the heap.
+ *
+ * The config also selects how buffers are allocated: their alignment, e.g. for SIMD kernels,
+ * and whether buffers of at least HUGE_PAGE_SIZE use huge pages, reducing the TLB misses of
+ * kernels walking multi-MB buffers.
+ *
+ * Pools are created on first use and live until the end of the process, since values may
+ * still be freed during static destruction. ExtMemValues use the default pool, value types
+ * select another pool per type by overriding ExtMemValue::extMemPool().
+ */
+class ExtMemPool {
+public:
+    /// size of the huge pages used for large buffers, see HugePages
+    static constexpr uint64_t HUGE_PAGE_SIZE = 2 << 20;
+
+    enum class HugePages {
+        NONE,         ///< regular pages
+        TRANSPARENT,  ///< buffers aligned to huge pages and advised to use transparent huge pages
+        EXPLICIT      ///< buffers mapped from the reserved huge pages (MAP_HUGETLB), falling back
+                      ///< to TRANSPARENT if none are available
+    };
+
+    struct Config {
+        /// freed buffers are kept while the pool caches less bytes, 0 disables recycling
+        uint64_t maxCachedBytes = 0;
+        /// zero recycled buffers like fresh ones, may be disabled if producers overwrite
+        /// the whole buffer anyway
+        bool zeroRecycled = true;
+        /// alignment of the buffers, a power of two of at least sizeof(void*)
+        std::size_t alignment = 64;
+        /// pages of buffers of at least HUGE_PAGE_SIZE, smaller buffers use regular pages
+        HugePages hugePages = HugePages::NONE;
+    };
+
+    struct Statistics {
+        uint64_t hits = 0;               ///< buffers served from recycled memory
+        uint64_t misses = 0;             ///< buffers which had to go to the heap
+        uint64_t dropped = 0;            ///< freed buffers returned to the heap, since the cache was full
+        uint64_t cachedBytes = 0;        ///< bytes of the buffers currently kept for reuse
+        uint64_t hugePageFallbacks = 0;  ///< EXPLICIT buffers allocated as TRANSPARENT ones
+    };
+
+    /**
+     * A buffer drawn from a pool, returned to the pool on destruction
+     */
+    class Buffer {
+    public:
+        Buffer() = default;
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+        ~Buffer();
+
+        void* data() const { return fData; }
+        uint64_t capacity() const { return fCapacity; }
+
+        /**
+         * The NUMA node the buffer has been migrated to, -1 if it was not, see
+         * placeOnNumaNode(). Kept while the buffer is recycled.
+         */
+        int numaNode() const { return fNumaNode; }
+        void setNumaNode(int node) { fNumaNode = node; }
+
+    private:
+        friend class ExtMemPool;
+        Buffer(ExtMemPool* pool, void* data, uint64_t capacity, bool mapped, int numaNode)
+        : fPool(pool), fData(data), fCapacity(capacity), fMapped(mapped), fNumaNode(numaNode) {}
+
+        void release() noexcept;
+
+        ExtMemPool* fPool = nullptr;
+        void* fData = nullptr;
+        uint64_t fCapacity = 0;
+        // mapped with mmap() instead of allocated from the heap
+        bool fMapped = false;
+        int fNumaNode = -1;
+    };
+
+    ExtMemPool(const ExtMemPool&) = delete;
+    ExtMemPool& operator=(const ExtMemPool&) = delete;
+
+    /**
+     * The pool used by ExtMemValues which do not select another one
+     */
+    static ExtMemPool& defaultPool();
+
+    /**
+     * The pool with the given name, created with the default config on first use
+     */
+    static ExtMemPool& named(const std::string& name);
+
+    /**
+     * Change the config, buffers cached beyond a lowered limit are returned to the heap
+     *
+     * If the alignment or huge pages change, all cached buffers are returned to the heap, so
+     * that later buffers follow the new config. Throws std::runtime_error for an invalid
+     * alignment.
+     */
+    void configure(const Config& config);
+
+    Config config() const;
+
+    /**
+     * Draw a buffer of at least len bytes, zeroed if zero is set
+     */
+    Buffer allocate(uint64_t len, bool zero=true);
+
+    Statistics statistics() const;
+
+    /**
+     * Return all cached buffers to the heap
+     */
+    void trim();
+
+    /**
+     * The capacity of the buffers serving requests of len bytes, with regular pages
+     */
+    static uint64_t sizeClass(uint64_t len);
+
+private:
+    struct Block {
+        void* data;
+        bool mapped;
+        int numaNode;
+    };
+
+    ExtMemPool() = default;
+
+    void recycle(void* data, uint64_t capacity, bool mapped, int numaNode) noexcept;
+
+    // called with fMutex held
+    void shrink(uint64_t maxCachedBytes);
+
+    mutable std::mutex fMutex;
+    Config fConfig;
+    Statistics fStatistics;
+    std::map<uint64_t, std::vector<Block>> fFree;
+};
+
+} // namespace mcf
+
+#endif // MCF_EXTMEMPOOL_H
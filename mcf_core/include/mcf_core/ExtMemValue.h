@@ -5,6 +5,7 @@
 #ifndef MCF_EXTMEMVALUE_H_
 #define MCF_EXTMEMVALUE_H_
 
+#include "mcf_core/ExtMemPool.h"
 #include "mcf_core/IExtMemValue.h"
 
 #include <memory>
@@ -84,6 +85,40 @@ public:
      */
     void extMemInit(const void *src, uint64_t len, int dstDevice=-1, int srcDevice=-1);
 
+    /**
+     * initialize ext mem value with read-only memory kept alive by owner, without copying
+     * the memory is copied on the first call of a non-const extMemPtr()
+     * returns false if ptr is not aligned for T
+     * shall not be called after sharing on value store (no thread protection)
+     */
+    bool extMemShare(std::shared_ptr<const void> owner, const void* ptr, uint64_t len) override;
+
+    /**
+     * initialize ext mem value as a view onto len bytes of the ext mem of parent from offset on,
+     * without copying, e.g. to split a batch into per-camera values
+     * the parent is kept alive by the view, the view is read-only like with extMemShare()
+     * returns false if the region is not aligned for T, throws if it exceeds the parent
+     * shall not be called after sharing on value store (no thread protection)
+     */
+    bool extMemInitView(std::shared_ptr<const IExtMemValue> parent, uint64_t offset, uint64_t len);
+
+    /**
+     * initialize ext mem value as a view onto rows of rowLen bytes, which are stride bytes apart
+     * in the ext mem of parent, starting at offset, e.g. a region of interest of an image
+     * the view holds rows * rowLen bytes: extMemPtr() and serialization return them packed, which
+     * are gathered from the parent on first access, extMemRow() refers to the parent without copying
+     * returns false if the region is not aligned for T, throws if it exceeds the parent
+     * shall not be called after sharing on value store (no thread protection)
+     */
+    bool extMemInitView(std::shared_ptr<const IExtMemValue> parent, uint64_t offset, uint64_t rowLen,
+                        uint64_t stride, uint64_t rows);
+
+    /**
+     * @return pointer to row of a view in the memory of its parent, the whole ext mem is a single
+     *         row for other values
+     */
+    const T* extMemRow(uint64_t row) const;
+
     /**
      * query size of the ext mem value in bytes
      */
@@ -114,6 +149,19 @@ public:
      */
     bool extMemInitialized() const;
 
+    /**
+     * migrate the memory to a NUMA node unless it has been placed there before
+     */
+    bool extMemPlace(int numaNode) const override;
+
+protected:
+
+    /**
+     * the pool the memory allocated by extMemInit(len) is drawn from, the default pool unless
+     * overridden by the value type, e.g. to recycle the buffers of a camera type separately
+     */
+    virtual ExtMemPool& extMemPool() const;
+
 private:
 
     class ExtMem;
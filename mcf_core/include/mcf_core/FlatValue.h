@@ -0,0 +1,217 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_FLATVALUE_H
+#define MCF_FLATVALUE_H
+
+#include "mcf_core/ErrorMacros.h"
+
+#include "msgpack.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Flat wire format of generated value types, selected per package with "WireFormat": "flat" in
+ * ProjectDefinitions.json
+ *
+ * A value is packed as a single msgpack bin, so that transports and recordings handle it like
+ * any other value. The bin starts with a fixed part, in which every attribute has a slot at an
+ * offset computed by the types generator, followed by the variable part:
+ *   - scalars (numbers, bool, enums as int32) are stored in their slot, aligned to their size
+ *   - strings and vectors of numbers are stored in the variable part, their slot holds a
+ *     uint32 offset into the bin and a uint32 size in bytes respectively elements
+ *   - all other attributes (maps, sets, nested structs, ...) are msgpack packed into the
+ *     variable part, referenced like strings
+ * All numbers are little endian. Generated views read the attributes in place from a received
+ * bin, without unpacking the value.
+ */
+namespace flat {
+
+/// size of the slot of a string, vector or msgpack packed attribute
+constexpr std::size_t REF_SIZE = 8;
+
+/**
+ * A string in a flat packed value, refers to the bin it was read from
+ */
+struct String {
+    const char* data = nullptr;
+    std::size_t size = 0;
+
+    std::string str() const { return std::string(data, size); }
+};
+
+/**
+ * A vector of numbers in a flat packed value, refers to the bin it was read from
+ *
+ * Elements are read with memcpy, since the bin need not be aligned in the received message.
+ */
+template<typename T>
+class Array {
+public:
+    Array() = default;
+    Array(const char* data, std::size_t size) : fData(data), fSize(size) {}
+
+    std::size_t size() const { return fSize; }
+    bool empty() const { return fSize == 0; }
+
+    T operator[](std::size_t i) const {
+        T result;
+        std::memcpy(&result, fData + i * sizeof(T), sizeof(T));
+        return result;
+    }
+
+    std::vector<T> vec() const {
+        std::vector<T> result(fSize);
+        if (fSize > 0) {
+            std::memcpy(result.data(), fData, fSize * sizeof(T));
+        }
+        return result;
+    }
+
+private:
+    const char* fData = nullptr;
+    std::size_t fSize = 0;
+};
+
+/**
+ * Builds the bin of a flat packed value
+ */
+class Writer {
+public:
+    explicit Writer(std::size_t fixedSize) : fBuffer(fixedSize, 0) {}
+
+    template<typename T>
+    void scalar(std::size_t offset, T value) {
+        static_assert(std::is_arithmetic<T>::value, "flat scalars are numbers");
+        std::memcpy(&fBuffer[offset], &value, sizeof(T));
+    }
+
+    void string(std::size_t offset, const std::string& value) {
+        reference(offset, append(value.data(), value.size(), 1), value.size());
+    }
+
+    template<typename T>
+    void array(std::size_t offset, const std::vector<T>& value) {
+        static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+                      "flat arrays hold numbers");
+        const char* data = value.empty() ? nullptr : reinterpret_cast<const char*>(value.data());
+        reference(offset, append(data, value.size() * sizeof(T), sizeof(T)), value.size());
+    }
+
+    template<typename T>
+    void packed(std::size_t offset, const T& value) {
+        msgpack::sbuffer buffer;
+        msgpack::pack(buffer, value);
+        reference(offset, append(buffer.data(), buffer.size(), 1), buffer.size());
+    }
+
+    const char* data() const { return fBuffer.data(); }
+    std::size_t size() const { return fBuffer.size(); }
+
+    /**
+     * Packs the built value as msgpack bin
+     */
+    template<typename Packer>
+    void pack(Packer& packer) const {
+        packer.pack_bin(static_cast<uint32_t>(fBuffer.size()));
+        packer.pack_bin_body(fBuffer.data(), static_cast<uint32_t>(fBuffer.size()));
+    }
+
+private:
+    std::size_t append(const char* data, std::size_t size, std::size_t alignment) {
+        const std::size_t offset = (fBuffer.size() + alignment - 1) / alignment * alignment;
+        fBuffer.resize(offset + size);
+        if (size > 0) {
+            std::memcpy(&fBuffer[offset], data, size);
+        }
+        return offset;
+    }
+
+    void reference(std::size_t offset, std::size_t target, std::size_t size) {
+        MCF_ASSERT(target <= UINT32_MAX && size <= UINT32_MAX, "flat value exceeds 4 GiB");
+        scalar(offset, static_cast<uint32_t>(target));
+        scalar(offset + 4, static_cast<uint32_t>(size));
+    }
+
+    std::vector<char> fBuffer;
+};
+
+/**
+ * Reads the attributes of a flat packed value in place, the bin must outlive the reader and
+ * everything read from it
+ *
+ * Offsets and sizes are checked against the bin, throws std::runtime_error if they exceed it.
+ */
+class Reader {
+public:
+    Reader(const char* data, std::size_t size, std::size_t fixedSize) : fData(data), fSize(size) {
+        MCF_ASSERT(size >= fixedSize, "flat value shorter than its fixed part");
+    }
+
+    /**
+     * Reader of the bin of the passed msgpack object
+     */
+    Reader(const msgpack::object& object, std::size_t fixedSize)
+    : Reader(binData(object), object.via.bin.size, fixedSize) {}
+
+    template<typename T>
+    T scalar(std::size_t offset) const {
+        T result;
+        std::memcpy(&result, fData + offset, sizeof(T));
+        return result;
+    }
+
+    String string(std::size_t offset) const {
+        String result;
+        const std::size_t size = scalar<uint32_t>(offset + 4);
+        result.data = target(offset, size);
+        result.size = size;
+        return result;
+    }
+
+    template<typename T>
+    Array<T> array(std::size_t offset) const {
+        const std::size_t size = scalar<uint32_t>(offset + 4);
+        return Array<T>(target(offset, size * sizeof(T)), size);
+    }
+
+    /**
+     * Unpacks a msgpack packed attribute
+     */
+    template<typename T>
+    T unpacked(std::size_t offset) const {
+        const std::size_t size = scalar<uint32_t>(offset + 4);
+        const msgpack::object_handle handle = msgpack::unpack(target(offset, size), size);
+        return handle.get().as<T>();
+    }
+
+private:
+    static const char* binData(const msgpack::object& object) {
+        if (object.type != msgpack::type::BIN) {
+            throw msgpack::type_error();
+        }
+        return object.via.bin.ptr;
+    }
+
+    const char* target(std::size_t offset, std::size_t size) const {
+        const std::size_t start = scalar<uint32_t>(offset);
+        MCF_ASSERT(start <= fSize && size <= fSize - start, "flat value reference out of bounds");
+        return fData + start;
+    }
+
+    const char* fData;
+    std::size_t fSize;
+};
+
+} // namespace flat
+
+} // namespace mcf
+
+#endif // MCF_FLATVALUE_H
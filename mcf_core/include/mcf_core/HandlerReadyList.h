@@ -0,0 +1,194 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_HANDLERREADYLIST_H
+#define MCF_HANDLERREADYLIST_H
+
+#include "mcf_core/ITriggerable.h"
+#include "mcf_core/PortTriggerHandler.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace mcf {
+
+/**
+ * Lock-free list of the port trigger handlers of a component whose event flag fired
+ *
+ * Each registered handler gets an Entry, which is added to the handler's event flag as a
+ * triggerable. When the flag is activated, the entry pushes itself onto the list (unless it is
+ * queued already) and wakes the component, which then visits only the handlers which actually
+ * fired instead of checking the event flags of all ports.
+ *
+ * Any number of threads may push, only one thread at a time may drain the list.
+ *
+ * Entries marked inline are offered to the list's inline runner on the activating thread instead,
+ * see InlineDispatch. They are queued as usual if the runner declines.
+ */
+class HandlerReadyList {
+public:
+    class Entry : public ITriggerable, public std::enable_shared_from_this<Entry> {
+    public:
+        Entry(std::shared_ptr<HandlerReadyList> list, std::shared_ptr<PortTriggerHandler> handler)
+        : fList(std::move(list))
+        , fHandler(std::move(handler))
+        {}
+
+        ~Entry() override {
+            detachTriggerSources();
+        }
+
+        void trigger() override {
+            if (fList->push(*this)) {
+                fList->fWake->trigger();
+            }
+        }
+
+        /**
+         * Pushing an entry which is queued already has no effect
+         */
+        bool isCoalescable() const override { return true; }
+
+        bool isInline() const override {
+            return fInline.load(std::memory_order_relaxed);
+        }
+
+        void triggerInline() override {
+            if (fRemoved) {
+                return;
+            }
+            if (!fList->runInline(*this)) {
+                trigger();
+            }
+        }
+
+        /**
+         * Offer activations to the inline runner of the list, see InlineDispatch
+         */
+        void setInline(bool isInline) {
+            fInline.store(isInline, std::memory_order_relaxed);
+        }
+
+        const std::shared_ptr<PortTriggerHandler>& getHandler() const {
+            return fHandler;
+        }
+
+        /**
+         * Never pass the entry to a drain function again, even if it is queued already
+         */
+        void remove() {
+            fRemoved = true;
+        }
+
+        bool isRemoved() const {
+            return fRemoved;
+        }
+
+    private:
+        friend class HandlerReadyList;
+
+        const std::shared_ptr<HandlerReadyList> fList;
+        const std::shared_ptr<PortTriggerHandler> fHandler;
+        std::atomic<bool> fQueued{false};
+        std::atomic<bool> fRemoved{false};
+        std::atomic<bool> fInline{false};
+        Entry* fNext = nullptr;
+        // keeps the entry alive while it is queued
+        std::shared_ptr<Entry> fPinned;
+    };
+
+    /**
+     * @param wake  triggered whenever an entry gets queued by its event flag
+     */
+    explicit HandlerReadyList(std::shared_ptr<ITriggerable> wake)
+    : fWake(std::move(wake))
+    {}
+
+    /**
+     * Set the function running handlers of inline entries on the activating thread
+     *
+     * The runner returns false if it cannot run the handler now, which queues the entry instead.
+     * Must be set before any entry is marked inline. Setting nullptr waits for a runner call in
+     * progress on another thread, so that the owner of the runner may be destroyed afterwards.
+     */
+    void setInlineRunner(std::function<bool(Entry&)> runner) {
+        std::lock_guard<std::recursive_mutex> lk(fInlineMutex);
+        fInlineRunner = std::move(runner);
+    }
+
+    /**
+     * Queue an entry without waking the component
+     *
+     * @return false if the entry was queued already
+     */
+    bool push(Entry& entry) {
+        if (entry.fQueued.exchange(true, std::memory_order_acq_rel)) {
+            return false;
+        }
+        entry.fPinned = entry.shared_from_this();
+        Entry* head = fHead.load(std::memory_order_relaxed);
+        do {
+            entry.fNext = head;
+        } while (!fHead.compare_exchange_weak(head, &entry, std::memory_order_release,
+                                              std::memory_order_relaxed));
+        return true;
+    }
+
+    /**
+     * Take all queued entries and call func for each of them in the order they were pushed
+     *
+     * An entry is dequeued before func is called, so that an activation during func queues it
+     * again. If func returns false, the entry is queued again for the next drain.
+     */
+    template<typename Func>
+    void drain(Func&& func) {
+        Entry* entry = fHead.exchange(nullptr, std::memory_order_acquire);
+        // the list is a stack, restore the order of activation
+        Entry* ordered = nullptr;
+        while (entry != nullptr) {
+            Entry* next = entry->fNext;
+            entry->fNext = ordered;
+            ordered = entry;
+            entry = next;
+        }
+        while (ordered != nullptr) {
+            Entry* next = ordered->fNext;
+            std::shared_ptr<Entry> pinned = std::move(ordered->fPinned);
+            ordered->fQueued.store(false, std::memory_order_release);
+            if (!ordered->fRemoved && !func(*ordered)) {
+                push(*ordered);
+            }
+            ordered = next;
+        }
+    }
+
+    /**
+     * Dequeue all entries without visiting them
+     */
+    void clear() {
+        drain([](Entry&) { return true; });
+    }
+
+private:
+    /**
+     * Offer an entry to the inline runner, returns false if it is not run
+     */
+    bool runInline(Entry& entry) {
+        // another thread running an inline handler declines as the runner would, a handler
+        // activating an entry of its own list on this thread reaches the runner again
+        std::unique_lock<std::recursive_mutex> lk(fInlineMutex, std::try_to_lock);
+        return lk.owns_lock() && fInlineRunner && fInlineRunner(entry);
+    }
+
+    const std::shared_ptr<ITriggerable> fWake;
+    // guards fInlineRunner against being reset while it runs
+    std::recursive_mutex fInlineMutex;
+    std::function<bool(Entry&)> fInlineRunner;
+    std::atomic<Entry*> fHead{nullptr};
+};
+
+} // namespace mcf
+
+#endif // MCF_HANDLERREADYLIST_H
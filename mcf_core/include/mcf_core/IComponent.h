@@ -4,16 +4,21 @@
 #ifndef MCF_ICOMPONENT_H
 #define MCF_ICOMPONENT_H
 
+#include <chrono>
+#include <functional>
 #include <string>
+#include <thread>
 #include <memory>
 
 #include "mcf_core/Messages.h"
 #include "mcf_core/ComponentLogger.h"
+#include "mcf_core/ThreadAffinity.h"
 
 #include "json/forwards.h"
 
 namespace mcf {
 
+class ComponentExecutor;
 class ComponentTraceEventGenerator;
 class GenericReceiverPort;
 class IComponentConfig;
@@ -43,12 +48,34 @@ public:
     virtual void ctrlSetComponentTraceEventGenerator(
             const std::shared_ptr<mcf::ComponentTraceEventGenerator>& eventGenerator) = 0;
 
+    /**
+     * Set the executor to run the component on, takes effect on the next ctrlStart()
+     *
+     * @param executor  the shared worker pool, or nullptr for a dedicated component thread
+     */
+    virtual void ctrlSetExecutor(const std::shared_ptr<ComponentExecutor>& executor) {}
+
+    /**
+     * Run the port handlers of the component inline on the threads writing their values
+     *
+     * @param fused  true to run handlers inline whenever possible, false to always wake the component
+     */
+    virtual void ctrlSetFused(bool fused) {}
+
+    /**
+     * Touch the given number of bytes of the component thread's stack before startup()
+     *
+     * @param bytes  the number of bytes, 0 to disable pre-faulting
+     */
+    virtual void ctrlSetStackPrefault(size_t bytes) {}
+
     /**
      * @brief An enum of supported scheduling policies for component threads
      *
      * Represents a sensible subset of POSIX thread priorities as an C++ enum. The values correspond
      * to those defined in <pthread.h>. Currently, FIFO and round-robin are supported as real-time
-     * priorities, Other is the non-realtime best-effort policy of the OS.
+     * priorities, Deadline as earliest-deadline-first scheduling (Linux only), Other is the
+     * non-realtime best-effort policy of the OS.
      *
      * @sa sched(7)
      */
@@ -60,6 +87,8 @@ public:
         Fifo = SCHED_FIFO,
         /// same as FIFO but with time slices
         RoundRobin = SCHED_RR,
+        /// earliest deadline first with a runtime budget per period, SCHED_DEADLINE of <linux/sched.h>
+        Deadline = 6,
         /// Special value to represent no change in the current policy
         Default = 1 + SCHED_OTHER + SCHED_FIFO + SCHED_RR
     };
@@ -73,6 +102,24 @@ public:
         SchedulingPolicy policy;
         /// The static scheduling priority for real-time schedulers
         int priority;
+        /// The CPUs the component thread may run on, the empty mask leaves the affinity unchanged
+        CpuMask cpuAffinity = 0;
+        /// Deadline policy: execution time granted to the thread in each period
+        std::chrono::nanoseconds runtime{0};
+        /// Deadline policy: time from the start of a period by which the runtime is granted.
+        /// With any policy, a handler running longer than this counts as a deadline miss.
+        std::chrono::nanoseconds deadline{0};
+        /// Deadline policy: length of a period, zero means equal to the deadline
+        std::chrono::nanoseconds period{0};
+        /// Time the idle component thread busy-polls for events before blocking, for components
+        /// on dedicated CPUs. Zero blocks right away. Has no effect on executor workers.
+        std::chrono::nanoseconds spin{0};
+        /// The NUMA node the component thread runs on and preferably allocates memory from, -1
+        /// for no preference. Without a CPU affinity, the thread is pinned to the CPUs of the node.
+        int numaNode = -1;
+        /// The threads the handlers may use in parallelFor() calls, including the handler's own
+        /// thread, see setParallelForThreadLimit(). Zero leaves the number unlimited.
+        size_t parallelThreads = 0;
     };
 
     /**
@@ -87,10 +134,14 @@ public:
      * @note To use this functionality, the executable must have CAP_SYS_NICE in its set of
      * effective capabilities.
      *
+     * @note The kernel refuses to pin SCHED_DEADLINE threads to a subset of the CPUs of their
+     * root domain, use cpusets or isolated CPUs instead of a CPU affinity for them.
+     *
      * @sa sched(7), pthread_getschedparam(3)
      *
      * @param parameters The scheduling policy and priority as defined in <pthread.h>; currently
-     * only SCHED_FIFO, SCHED_RR, SCHED_OTHER are supported.
+     * only SCHED_FIFO, SCHED_RR, SCHED_DEADLINE, SCHED_OTHER are supported. With policy Default,
+     * only the CPU affinity and the deadline for deadline miss accounting are changed, if given.
      */
     virtual void ctrlSetSchedulingParameters(const SchedulingParameters& parameters) = 0;
 
@@ -141,11 +192,54 @@ public:
 
     virtual StateType getState() const = 0;
 
+    /**
+     * Block until the component has finished startup() after ctrlStart(), i.e. until it has left
+     * the states INIT and STARTING_UP
+     *
+     * The default implementation polls getState().
+     */
+    virtual void waitStarted() {
+        while (getState() == INIT || getState() == STARTING_UP) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    /**
+     * Duration of the last startup of the component, zero if unknown
+     */
+    virtual std::chrono::microseconds getStartupDuration() const {
+        return std::chrono::microseconds(0);
+    }
+
+    /**
+     * The NUMA node of the component thread, see SchedulingParameters::numaNode
+     */
+    virtual int getNumaNode() const {
+        return -1;
+    }
+
     virtual void setIdGenerator(std::shared_ptr<IidGenerator> idGenerator) = 0;
 
     virtual const IidGenerator& idGenerator() const = 0;
     virtual const ValueFactory& valueFactory() const = 0;
 
+    /**
+     * Run a function on the component thread, at its next activation
+     *
+     * May be called from any thread. Posted functions run after the handlers of the activation,
+     * serialized with them, in the order they were posted. Functions posted while the component
+     * is stopped run once it is running again.
+     */
+    virtual void post(std::function<void()> function) = 0;
+
+    /**
+     * Run a function on the component thread, after a delay
+     *
+     * The delay is served by the shared PeriodicTimerService, the function is dropped if the
+     * component is destroyed before.
+     */
+    virtual void postAfter(std::chrono::nanoseconds delay, std::function<void()> function) = 0;
+
 
 protected:
     friend GenericReceiverPort;
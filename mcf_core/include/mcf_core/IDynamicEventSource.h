@@ -62,6 +62,21 @@ class IDynamicEventSource
         virtual bool dropEvent()
         { return false; }
 
+        /**
+         * Seek
+         *
+         * Implementation of this method is optional. If implemented, it shall discard the current
+         * events and continue with the first event at or after the given time, also if it is
+         * earlier than events already fired, and return true. If the event source has been
+         * waiting for new events, it shall notify the event timing controller once it has one.
+         * If not implemented, it shall be a no-op and return false.
+         *
+         * @return true,  if implemented
+         *         false, if not implemented
+         */
+        virtual bool seek(const TimestampType& time)
+        { return false; }
+
         /**
          * Returns true if the event source has no further events to publish.
          */
@@ -8,9 +8,28 @@
 #include "mcf_core/Value.h"
 
 #include <cstdint>
+#include <memory>
+#include <string>
 
 namespace mcf {
 
+/**
+ * Host copy of ext mem data in progress, see IExtMemValue::extMemStage()
+ */
+class IExtMemStaging {
+public:
+    virtual ~IExtMemStaging() = default;
+
+    /**
+     * Wait for the copy to complete
+     *
+     * @return the host copy, valid while this object lives
+     */
+    virtual const uint8_t* data() = 0;
+
+    virtual uint64_t size() const = 0;
+};
+
 /**
  * ExtMemValue interface
  */
@@ -28,6 +47,98 @@ public:
 
     virtual uint8_t* extMemPtr() = 0;
 
+    /**
+     * Refer to read-only memory kept alive by owner instead of allocating and copying, e.g. to
+     * a mapped record file. Implementations copy the memory before it is written.
+     *
+     * @return false if the value cannot refer to the memory, e.g. since it is not on the device
+     *         of the value or not aligned for its elements, or if this is not implemented
+     */
+    virtual bool extMemShare(std::shared_ptr<const void> owner, const void* ptr, uint64_t len)
+    {
+        return false;
+    }
+
+    /**
+     * Export the ext mem part as a handle which another process on the same machine can import
+     * without copying the memory through host memory, e.g. device memory as CUDA IPC handle.
+     * The exported memory stays valid until the importing process released it, or until the
+     * handle is withdrawn, see extMemWithdraw().
+     *
+     * @return false if the ext mem part cannot be exported, e.g. since it is not device
+     *         resident, or if this is not implemented
+     */
+    virtual bool extMemExport(std::string& handle) const
+    {
+        return false;
+    }
+
+    /**
+     * Refer to ext mem exported by extMemExport() in another process instead of allocating and
+     * copying it.
+     *
+     * @return false if the handle cannot be imported, e.g. since it was exported by a value of
+     *         a different kind, or if this is not implemented
+     */
+    virtual bool extMemImport(const std::string& handle)
+    {
+        return false;
+    }
+
+    /**
+     * Withdraw a handle returned by extMemExport() which will not be imported, e.g. since the
+     * receiver rejected its message, so that the exported memory is released. Has no effect
+     * once the handle has been imported.
+     */
+    virtual void extMemWithdraw(const std::string& handle) const
+    {
+    }
+
+    /**
+     * Migrate host resident ext mem to a NUMA node, see placeOnNumaNode(). Implementations
+     * remember the node of their memory, including recycled buffers, so that memory already on
+     * the node is not migrated again.
+     *
+     * Shall not be called after the value has been shared on the value store.
+     *
+     * @return false if this is not implemented, the caller migrates the memory then
+     */
+    virtual bool extMemPlace(int numaNode) const
+    {
+        return false;
+    }
+
+    /**
+     * Start copying device resident ext mem to host memory, without blocking the caller or
+     * the work of the device, e.g. on a stream of its own into pinned memory. The ValueRecorder
+     * stages the values of a batch at once and serializes each one when its copy has arrived.
+     *
+     * @return nullptr if the ext mem is host resident (extMemPtr() does not copy then), or if
+     *         this is not implemented
+     */
+    virtual std::shared_ptr<IExtMemStaging> extMemStage() const
+    {
+        return nullptr;
+    }
+
+    /**
+     * Start copying host resident ext mem to a device ahead of its use, without blocking the
+     * caller, e.g. from pinned memory on a stream of its own. Readers of the value on the device
+     * wait for the copy. The RecordingEventSource uploads the values of
+     * RecordingEventSource::Params::prefetchTopics while it reads ahead.
+     *
+     * Shall not be called after the value has been shared on the value store.
+     *
+     * @param device    the device to copy to, e.g. a cuda device id
+     *
+     * @return false if the ext mem cannot be copied to the device, e.g. since the value holds no
+     *         device memory, or if this is not implemented
+     */
+    virtual bool extMemUpload(int device) const
+    {
+        return false;
+    }
+
 protected:
 
     IExtMemValue() = default;
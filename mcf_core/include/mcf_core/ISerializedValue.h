@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_ISERIALIZEDVALUE_H_
+#define MCF_ISERIALIZEDVALUE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mcf {
+
+/**
+ * Interface of values which keep the form they were packed in by TypeRegistry::packValue(),
+ * e.g. values received by a remote service and kept in their wire format
+ *
+ * The value recorder writes the serialized form of such values to the recording as it is,
+ * instead of decoding the value and packing it again. Implementations derive from Value as well.
+ */
+class ISerializedValue {
+public:
+    /**
+     * The serialized form of a value, valid as long as the value exists
+     */
+    struct Serialized {
+        /// id of the type of the value, empty if it was serialized with its numeric id only
+        std::string typeId;
+        /// numeric id of the type, see TypeRegistry::TypemapEntry::numericId, 0 if unknown
+        uint64_t numericTypeId = 0;
+        /// the value as packed by TypeRegistry::packValue()
+        const char* data = nullptr;
+        size_t size = 0;
+        /// the ext mem data of the value, nullptr if it has none
+        const char* extMem = nullptr;
+        size_t extMemSize = 0;
+    };
+
+    virtual ~ISerializedValue() = default;
+
+    /**
+     * The serialized form of the value, nullptr if it cannot be told, e.g. since it is malformed
+     *
+     * Thread safe.
+     */
+    virtual const Serialized* serializedForm() const = 0;
+};
+
+} // namespace mcf
+
+#endif // MCF_ISERIALIZEDVALUE_H_
@@ -4,21 +4,76 @@
 #ifndef MCF_ITRIGGERABLE_H
 #define MCF_ITRIGGERABLE_H
 
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
 namespace mcf {
 
+class TriggerSource;
+
 /**
  *  An ITriggerable object is an object that can be registered to be triggered by a TriggerSource
+ *
+ *  The object knows the sources it is registered with and removes itself from them when it is
+ *  destroyed, so that the sources can notify it without taking a reference, see TriggerSource.
  */
 class ITriggerable {
 public:
+    virtual ~ITriggerable() { detachTriggerSources(); }
 
     /**
      * Method to be called when trigger event occurs
      */
     virtual void trigger() = 0;
 
+    /**
+     * Whether several trigger events may be merged into a single call of trigger()
+     *
+     * If true, trigger() may be deferred to the end of a batch of value store updates and is
+     * then called only once for the whole batch, see TriggerBatch.
+     */
+    virtual bool isCoalescable() const { return false; }
+
+    /**
+     * Whether the trigger event may be handled on the notifying thread
+     *
+     * If true and an InlineDispatch is active on the notifying thread, the event is deferred to
+     * the end of the dispatch, i.e. until the notifying value store write has released its locks,
+     * and then passed to triggerInline() instead of trigger().
+     */
+    virtual bool isInline() const { return false; }
+
+    /**
+     * Handle a trigger event on the calling thread, see isInline()
+     */
+    virtual void triggerInline() { trigger(); }
+
 protected:
     ITriggerable() = default;
+
+    /**
+     * Copies are not registered with the sources of the original
+     */
+    ITriggerable(const ITriggerable&) {}
+    ITriggerable& operator=(const ITriggerable&) { return *this; }
+
+    /**
+     * Remove the object from all trigger sources it is registered with, waiting for notifications
+     * in progress
+     *
+     * Derived classes whose trigger() uses members call it first thing in their destructor, so
+     * that no notification reaches a partly destroyed object. ~ITriggerable() calls it anyway.
+     */
+    void detachTriggerSources();
+
+private:
+    friend class TriggerSource;
+
+    // the sources the object is registered with, guarded by the registration mutex of
+    // TriggerSource, the count is read without it
+    std::vector<TriggerSource*> fSources;
+    std::atomic<size_t> fSourceCount{0};
 };
 
 }
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_LATENCYHISTOGRAM_H
+#define MCF_LATENCYHISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mcf {
+
+/**
+ * Lock-free histogram of durations in nanoseconds with HDR (high dynamic range) style buckets
+ *
+ * Each power of two is split into SUB_BUCKETS / 2 linear sub-buckets, so reported values are
+ * accurate to about 3% over the whole range from 1 ns to MAX_VALUE. Larger durations are counted
+ * as MAX_VALUE.
+ *
+ * Recording is wait-free: one relaxed increment of a bucket, one of the sum and a compare-exchange
+ * of the maximum only when it grows. Any number of threads may record and read concurrently.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 6;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t(1) << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_VALUE_BITS = 36;
+    /// about 68 seconds
+    static constexpr uint64_t MAX_VALUE = (uint64_t(1) << MAX_VALUE_BITS) - 1;
+    static constexpr size_t NUM_BUCKETS
+        = SUB_BUCKETS + (MAX_VALUE_BITS - SUB_BUCKET_BITS) * (SUB_BUCKETS / 2);
+
+    /**
+     * Percentiles of the recorded durations in nanoseconds
+     */
+    struct Summary {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = 0;
+        uint64_t p50 = 0;
+        uint64_t p99 = 0;
+        uint64_t p999 = 0;
+        uint64_t max = 0;
+    };
+
+    void record(uint64_t ns) {
+        if (ns > MAX_VALUE) {
+            ns = MAX_VALUE;
+        }
+        fBuckets[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+        fSum.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t max = fMax.load(std::memory_order_relaxed);
+        while (ns > max && !fMax.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * Summary of all durations recorded since construction or the last reset
+     */
+    Summary summary() const;
+
+    /**
+     * Summary of the durations recorded so far, clearing the histogram at the same time
+     *
+     * Durations recorded concurrently end up either in the returned summary or in the next one.
+     */
+    Summary takeSummary();
+
+    void reset();
+
+    static size_t bucketIndex(uint64_t ns) {
+        if (ns < SUB_BUCKETS) {
+            return static_cast<size_t>(ns);
+        }
+        const unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(ns));
+        const unsigned shift = msb - (SUB_BUCKET_BITS - 1);
+        return static_cast<size_t>(
+            SUB_BUCKETS + (shift - 1) * (SUB_BUCKETS / 2) + ((ns >> shift) - SUB_BUCKETS / 2));
+    }
+
+    /**
+     * The lowest and the highest duration counted in a bucket
+     */
+    static uint64_t bucketLowerBound(size_t index);
+    static uint64_t bucketUpperBound(size_t index);
+
+    /**
+     * Summary of bucket counts collected by the caller, e.g. of several histograms merged
+     */
+    static Summary summarize(const std::array<uint64_t, NUM_BUCKETS>& counts, uint64_t sum, uint64_t max);
+
+private:
+
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> fBuckets{};
+    std::atomic<uint64_t> fSum{0};
+    std::atomic<uint64_t> fMax{0};
+};
+
+} // namespace mcf
+
+#endif // MCF_LATENCYHISTOGRAM_H
@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_LATESTVALUE_H
+#define MCF_LATESTVALUE_H
+
+#include "mcf_core/Trigger.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace mcf {
+
+class Value;
+
+/**
+ * The latest value of a topic, read lock-free by any number of threads
+ *
+ * std::atomic_load() of a std::shared_ptr is not lock-free with libstdc++, it takes a mutex of a
+ * global pool shared by all shared pointers. Instead, the value is kept in one of two slots, each
+ * with a count of the readers copying it. A reader announces itself on the current slot and copies
+ * the value if the slot is still current, otherwise it retries, which only happens if a write has
+ * completed meanwhile. Readers thus never block, neither each other nor writers.
+ *
+ * Writers must be serialized by the caller. A writer fills the spare slot, makes it current and
+ * then waits for the readers still copying the replaced value, i.e. for a reference count increment
+ * each. The replaced value is handed to the writer, the spare slot stays empty.
+ */
+class LatestValue {
+public:
+    using ValuePtr = std::shared_ptr<const Value>;
+
+    LatestValue() = default;
+
+    LatestValue(const LatestValue&) = delete;
+    LatestValue& operator=(const LatestValue&) = delete;
+
+    /**
+     * A copy of the latest value, nullptr if none
+     */
+    ValuePtr load() const {
+        while (true) {
+            const unsigned slot = fCurrent.load();
+            fReaders[slot].fetch_add(1);
+            // seq_cst, paired with the fence in exchange(): either the writer switching the slots
+            // sees the reader or the reader sees the switch
+            if (fCurrent.load() == slot) {
+                ValuePtr value = fSlots[slot];
+                fReaders[slot].fetch_sub(1, std::memory_order_release);
+                return value;
+            }
+            fReaders[slot].fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    /**
+     * Whether there is a value, without copying it
+     */
+    bool hasValue() const {
+        return fRaw.load(std::memory_order_acquire) != nullptr;
+    }
+
+    /**
+     * Replace the value and return the previous one, writers must be serialized by the caller
+     */
+    ValuePtr exchange(ValuePtr value) {
+        const unsigned current = fCurrent.load(std::memory_order_relaxed);
+        const unsigned spare = 1 - current;
+        // readers which announced themselves on the spare slot before the previous write leave it
+        // without touching the value
+        waitForReaders(spare);
+        fSlots[spare] = std::move(value);
+        fRaw.store(fSlots[spare].get(), std::memory_order_release);
+        fCurrent.store(spare);
+        // keeps the load of the reader counts from moving before the switch, which a seq_cst
+        // store followed by an acquire load of another atomic does not
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        waitForReaders(current);
+        return std::move(fSlots[current]);
+    }
+
+private:
+    void waitForReaders(unsigned slot) const {
+        for (unsigned spins = 0; fReaders[slot].load(std::memory_order_acquire) != 0; ++spins) {
+            if (spins < 64) {
+                detail::cpuRelax();
+            }
+            else {
+                // the reader may have been preempted, let it run even if it has a lower priority
+                std::this_thread::sleep_for(std::chrono::microseconds(1));
+            }
+        }
+    }
+
+    std::array<ValuePtr, 2> fSlots;
+    mutable std::array<std::atomic<uint32_t>, 2> fReaders{{{0}, {0}}};
+    std::atomic<unsigned> fCurrent{0};
+    std::atomic<const Value*> fRaw{nullptr};
+};
+
+} // namespace mcf
+
+#endif // MCF_LATESTVALUE_H
@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_LAZYVALUE_H
+#define MCF_LAZYVALUE_H
+
+#include "mcf_core/Value.h"
+
+#include <memory>
+#include <mutex>
+#include <typeinfo>
+
+namespace mcf {
+
+using ValuePtr = std::shared_ptr<const Value>;
+
+/**
+ * A value kept in serialized form, which is only decoded when it is read as its type
+ *
+ * Typed reads from the value store and its queues (e.g. getValue<T>(), ports of T) return the
+ * decoded value, see castValue(). Reads as Value return the LazyValue itself, so that consumers
+ * which only forward or serialize values, e.g. remote senders, can use the serialized form.
+ * The value is decoded at most once, by the first typed read.
+ */
+class LazyValue : public Value
+{
+public:
+    /**
+     * The decoded value, nullptr if it cannot be decoded
+     *
+     * Thread safe. If decoding throws, the exception is passed on and the next call tries again.
+     */
+    ValuePtr decoded() const
+    {
+        std::call_once(fDecodeOnce, [this]() { fDecoded = decode(); });
+        return fDecoded;
+    }
+
+protected:
+    /**
+     * Decodes the value, with the id of this value
+     */
+    virtual ValuePtr decode() const = 0;
+
+private:
+    mutable std::once_flag fDecodeOnce;
+    mutable ValuePtr fDecoded;
+};
+
+/**
+ * Cast a value to T, decoding it first if it is a LazyValue which is not a T itself
+ *
+ * Values of exactly type T, as read by typed ports in the common case, are identified by
+ * comparing their type_info and cast statically. Only other values pay for the dynamic cast.
+ */
+template<typename T>
+std::shared_ptr<const T> castValue(const ValuePtr& value)
+{
+    if (value != nullptr && typeid(*value) == typeid(T)) {
+        return std::static_pointer_cast<const T>(value);
+    }
+    auto result = std::dynamic_pointer_cast<const T>(value);
+    if (result == nullptr) {
+        if (const auto* lazy = dynamic_cast<const LazyValue*>(value.get())) {
+            result = std::dynamic_pointer_cast<const T>(lazy->decoded());
+        }
+    }
+    return result;
+}
+
+/**
+ * The value to serialize for a value: the decoded value of a LazyValue, the value itself
+ * otherwise
+ */
+inline ValuePtr decodedValue(const ValuePtr& value)
+{
+    const auto* lazy = dynamic_cast<const LazyValue*>(value.get());
+    return lazy != nullptr ? lazy->decoded() : value;
+}
+
+} // namespace mcf
+
+#endif // MCF_LAZYVALUE_H
@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_LINEAGETRACKER_H
+#define MCF_LINEAGETRACKER_H
+
+#include "mcf_core/LatencyHistogram.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace mcf {
+
+class Value;
+class ValueStore;
+
+/**
+ * Set while a LineageTracker is enabled (maintained by LineageTracker)
+ */
+extern std::atomic<bool> gLineageTrackingActive;
+
+/**
+ * Settings of the end-to-end latency tracking, see LineageTracker::enable()
+ */
+struct LineageConfig {
+    /// glob patterns of the topics whose values start a lineage, e.g. sensor topics
+    std::vector<std::string> sources{"*"};
+    /// topics whose values end a lineage, e.g. actuator topics
+    std::vector<std::string> sinks;
+    /// values whose origins are remembered, rounded up to a power of two
+    size_t tableSize = 65536;
+    /// length of the windows of the published latency statistics
+    std::chrono::milliseconds publishInterval{1000};
+};
+
+/**
+ * Online end-to-end latency tracking through the input value ids of sender ports
+ *
+ * A value written to a source topic without input ids is an origin: its write time is
+ * remembered under its value id. A value written with input ids inherits the origins of its
+ * inputs, keeping the oldest time per source topic and up to MAX_ORIGINS sources. When a value
+ * with origins is written to a sink topic, the time since each origin is recorded in the latency
+ * histogram of the path from the source to the sink.
+ *
+ * At the end of each publish interval, the next sink write publishes the percentiles of the
+ * paths of its sink as msg::LineageLatency on /mcf/lineage<sink topic>, so that end-to-end
+ * latencies can be monitored while the system runs, without recording a trace. Nothing is
+ * published for sinks without values in a window.
+ *
+ * The origins are kept in a table of fixed size indexed by value id. A value whose slot has been
+ * taken over by a later value has lost its lineage, values derived from it start none.
+ * Lineages therefore need values to be consumed within about tableSize writes of lineage values.
+ *
+ * Value ids are generated by the components, so lineages need components with id generators
+ * producing unique ids, e.g. DefaultIdGenerator, see SenderPort::setValue().
+ */
+class LineageTracker {
+public:
+    static constexpr size_t MAX_ORIGINS = 4;
+
+    /**
+     * The tracker of the process
+     */
+    static LineageTracker& instance();
+
+    /**
+     * Cost of the hook in the sender ports while tracking is disabled: one relaxed atomic load
+     */
+    static bool active() {
+        return gLineageTrackingActive.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Start tracking with the given settings, publishing to the given value store
+     *
+     * Replaces the settings and clears the origins and statistics of a previous enable().
+     */
+    void enable(ValueStore& valueStore, const LineageConfig& config);
+
+    void disable();
+
+    /**
+     * Record the write of a value, called by the sender ports
+     *
+     * @param topic     the topic written
+     * @param value     the value, with its id generated
+     * @param inputIds  the ids of the values it was computed from
+     */
+    void recordWrite(const std::string& topic, const Value& value, const std::vector<uint64_t>& inputIds);
+
+    /**
+     * Latency percentiles of a source to sink path
+     */
+    struct PathStatistics {
+        std::string source;
+        std::string sink;
+        LatencyHistogram::Summary latency;
+    };
+
+    /**
+     * The statistics of all paths in their current windows
+     */
+    std::vector<PathStatistics> statistics() const;
+
+private:
+    struct Origin {
+        uint32_t source;     // index into fSourceNames
+        uint64_t timeNs;
+    };
+
+    struct Entry {
+        uint64_t valueId = 0;
+        uint8_t numOrigins = 0;
+        Origin origins[MAX_ORIGINS];
+    };
+
+    // the settings and the table of an enable(), replaced as a whole
+    struct State {
+        ValueStore* valueStore;
+        LineageConfig config;
+        std::unordered_set<std::string> sinks;
+        size_t mask;
+        std::unique_ptr<Entry[]> entries;
+    };
+
+    struct SinkState {
+        int64_t windowStartNs = 0;
+        std::map<uint32_t, std::unique_ptr<LatencyHistogram>> paths;
+    };
+
+    static constexpr size_t NUM_STRIPES = 64;
+
+    LineageTracker() = default;
+
+    // the index of a source topic, false if the topic is no source
+    bool sourceIndex(const State& state, const std::string& topic, uint32_t& index);
+    void recordSink(const State& state, const std::string& topic, const Entry& entry, int64_t nowNs);
+
+    std::shared_ptr<State> fState;
+    // guard the table slots with index % NUM_STRIPES
+    mutable std::mutex fStripes[NUM_STRIPES];
+    mutable std::mutex fSourcesMutex;
+    std::vector<std::string> fSourceNames;
+    // the indices of topics matched against the source globs, -1 for topics which are no source
+    std::unordered_map<std::string, int64_t> fSourceTopics;
+    mutable std::mutex fSinksMutex;
+    std::unordered_map<std::string, SinkState> fSinks;
+};
+
+} // namespace mcf
+
+#endif // MCF_LINEAGETRACKER_H
@@ -7,30 +7,93 @@
 #include "mcf_core/ComponentLogger.h"
 #include "spdlog/spdlog.h"
 
+/*
+ * Lowest severity compiled in, as a value of spdlog::level::level_enum (0 trace ... 6 off)
+ *
+ * Logging macros below this level expand to nothing, their arguments are not evaluated. Define it
+ * for a build, e.g. -DMCF_COMPILE_TIME_LOG_LEVEL=2 to remove MCF_TRACE and MCF_DEBUG.
+ */
+#ifndef MCF_COMPILE_TIME_LOG_LEVEL
+#define MCF_COMPILE_TIME_LOG_LEVEL 0
+#endif
+
+#if defined(__GNUC__)
+#define MCF_LOG_UNLIKELY(condition) __builtin_expect(static_cast<bool>(condition), 0)
+#else
+#define MCF_LOG_UNLIKELY(condition) (condition)
+#endif
+
+#define MCF_LOG_ELIDED(...) static_cast<void>(0)
+
 namespace mcf
 {
 // Convenience macros for logging with __FILE__ and __LINE__
+// The arguments are evaluated only if the local logger takes messages of the level.
 #define MCF_LOG(level, ...) \
-    (mcf::ComponentLogger::getLocalLogger()->log( \
-        spdlog::source_loc{" at " __FILE__, __LINE__, SPDLOG_FUNCTION}, level, __VA_ARGS__))
-// #define MCF_LOG(level, ...)
-#define MCF_TRACE(...) MCF_LOG(mcf::LogSeverity::trace, __VA_ARGS__)
-#define MCF_DEBUG(...) MCF_LOG(mcf::LogSeverity::debug, __VA_ARGS__)
-#define MCF_INFO(...) MCF_LOG(mcf::LogSeverity::info, __VA_ARGS__)
-#define MCF_WARN(...) MCF_LOG(mcf::LogSeverity::warn, __VA_ARGS__)
-#define MCF_ERROR(...) MCF_LOG(mcf::LogSeverity::err, __VA_ARGS__)
-#define MCF_FATAL(...) MCF_LOG(mcf::LogSeverity::critical, __VA_ARGS__)
+    do { \
+        spdlog::logger& mcfLocalLogger_ = *mcf::ComponentLogger::getLocalLogger(); \
+        if (MCF_LOG_UNLIKELY(mcfLocalLogger_.should_log(level))) { \
+            mcfLocalLogger_.log( \
+                spdlog::source_loc{" at " __FILE__, __LINE__, SPDLOG_FUNCTION}, level, __VA_ARGS__); \
+        } \
+    } while (false)
 
 // Convenience macros for logging without __FILE__ and __LINE__
 #define MCF_LOG_NOFILELINE(level, ...) \
-    (mcf::ComponentLogger::getLocalLogger()->log(level, __VA_ARGS__))
-// #define MCF_LOG_NOFILELINE(level, ...)
+    do { \
+        spdlog::logger& mcfLocalLogger_ = *mcf::ComponentLogger::getLocalLogger(); \
+        if (MCF_LOG_UNLIKELY(mcfLocalLogger_.should_log(level))) { \
+            mcfLocalLogger_.log(level, __VA_ARGS__); \
+        } \
+    } while (false)
+
+#if MCF_COMPILE_TIME_LOG_LEVEL <= 0
+#define MCF_TRACE(...) MCF_LOG(mcf::LogSeverity::trace, __VA_ARGS__)
 #define MCF_TRACE_NOFILELINE(...) MCF_LOG_NOFILELINE(mcf::LogSeverity::trace, __VA_ARGS__)
+#else
+#define MCF_TRACE(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#define MCF_TRACE_NOFILELINE(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#endif
+
+#if MCF_COMPILE_TIME_LOG_LEVEL <= 1
+#define MCF_DEBUG(...) MCF_LOG(mcf::LogSeverity::debug, __VA_ARGS__)
 #define MCF_DEBUG_NOFILELINE(...) MCF_LOG_NOFILELINE(mcf::LogSeverity::debug, __VA_ARGS__)
+#else
+#define MCF_DEBUG(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#define MCF_DEBUG_NOFILELINE(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#endif
+
+#if MCF_COMPILE_TIME_LOG_LEVEL <= 2
+#define MCF_INFO(...) MCF_LOG(mcf::LogSeverity::info, __VA_ARGS__)
 #define MCF_INFO_NOFILELINE(...) MCF_LOG_NOFILELINE(mcf::LogSeverity::info, __VA_ARGS__)
+#else
+#define MCF_INFO(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#define MCF_INFO_NOFILELINE(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#endif
+
+#if MCF_COMPILE_TIME_LOG_LEVEL <= 3
+#define MCF_WARN(...) MCF_LOG(mcf::LogSeverity::warn, __VA_ARGS__)
 #define MCF_WARN_NOFILELINE(...) MCF_LOG_NOFILELINE(mcf::LogSeverity::warn, __VA_ARGS__)
+#else
+#define MCF_WARN(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#define MCF_WARN_NOFILELINE(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#endif
+
+#if MCF_COMPILE_TIME_LOG_LEVEL <= 4
+#define MCF_ERROR(...) MCF_LOG(mcf::LogSeverity::err, __VA_ARGS__)
 #define MCF_ERROR_NOFILELINE(...) MCF_LOG_NOFILELINE(mcf::LogSeverity::err, __VA_ARGS__)
+#else
+#define MCF_ERROR(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#define MCF_ERROR_NOFILELINE(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#endif
+
+#if MCF_COMPILE_TIME_LOG_LEVEL <= 5
+#define MCF_FATAL(...) MCF_LOG(mcf::LogSeverity::critical, __VA_ARGS__)
 #define MCF_FATAL_NOFILELINE(...) MCF_LOG_NOFILELINE(mcf::LogSeverity::critical, __VA_ARGS__)
+#else
+#define MCF_FATAL(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#define MCF_FATAL_NOFILELINE(...) MCF_LOG_ELIDED(__VA_ARGS__)
+#endif
 } // namespace mcf
 
 #endif // MCF_LOGGINGMACROS_H_
\ No newline at end of file
@@ -0,0 +1,179 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_LOGICALCLOCK_H
+#define MCF_LOGICALCLOCK_H
+
+#include "mcf_core/ITriggerable.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Logical time of a value in a replay with a LogicalClock
+ *
+ * A replayed event has the logical time (event time, 0). A value written by a port handler
+ * processing an input of logical time (t, n) has the logical time (t, n + 1). Unlike the order in
+ * which threads happen to write values, the order by (time, step) is the same on every run.
+ */
+struct LogicalTime {
+    /// time of the replayed event in microseconds
+    uint64_t time = 0;
+    /// number of handlers the value has passed since the event
+    uint32_t step = 0;
+
+    bool operator<(const LogicalTime& other) const {
+        return time < other.time || (time == other.time && step < other.step);
+    }
+    bool operator==(const LogicalTime& other) const {
+        return time == other.time && step == other.step;
+    }
+};
+
+/**
+ * Orders the processing of replayed values by logical time, see LogicalTime
+ *
+ * Every value queued in a ValueQueue which was written in the scope of a logical time is stamped
+ * with it and holds its time in the clock until it is popped. A port handler is run for its
+ * earliest stamped input only once no earlier time is held anywhere, i.e. once all inputs which
+ * may still lead to earlier values have been processed. Handlers of different components
+ * processing inputs of the same time run in parallel, the result does not depend on the thread
+ * timing.
+ *
+ * The event timing controller holds the time of the next event and fires it only if it is
+ * within the lookahead of the earliest held time, which bounds how far the event sources run
+ * ahead of the components.
+ *
+ * Values are only ordered in queued receiver ports. Latest-value reads, non-queued ports and
+ * values written outside of a handler or event (e.g. by timers) are not ordered. Port handlers
+ * must consume their queued inputs, as an unconsumed input holds back the replay.
+ */
+class LogicalClock : public std::enable_shared_from_this<LogicalClock> {
+public:
+
+    /**
+     * A logical time of a clock, empty if a value has not been written in a logical time scope
+     */
+    struct Stamp {
+        std::shared_ptr<LogicalClock> clock;
+        LogicalTime time;
+
+        explicit operator bool() const { return clock != nullptr; }
+    };
+
+    /**
+     * Stamps the values written by the calling thread with a logical time while alive
+     *
+     * Scopes may be nested, the previous scope is restored on destruction. A scope without clock
+     * writes unstamped values.
+     */
+    class Scope {
+    public:
+        Scope(LogicalClock* clock, const LogicalTime& time);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        LogicalClock* fPreviousClock;
+        LogicalTime fPreviousTime;
+    };
+
+    /**
+     * Processing of an input by a port handler
+     *
+     * Holds the time of the input while alive, so that values written by the handler, which get
+     * the next step, become visible only after the handler has returned.
+     */
+    class Run {
+    public:
+        explicit Run(const Stamp& input);
+        ~Run();
+
+        Run(const Run&) = delete;
+        Run& operator=(const Run&) = delete;
+
+    private:
+        const Stamp fInput;
+        Scope fScope;
+    };
+
+    /**
+     * @param lookaheadMicroSeconds how far event times may be ahead of the earliest held time
+     */
+    explicit LogicalClock(uint64_t lookaheadMicroSeconds = 0);
+
+    /**
+     * The logical time of the calling thread, empty outside of a scope
+     */
+    static Stamp current();
+
+    uint64_t getLookahead() const { return fLookahead; }
+
+    void hold(const LogicalTime& time);
+
+    void release(const LogicalTime& time);
+
+    /**
+     * Whether no time earlier than the given one is held, i.e. values of this time may be processed
+     */
+    bool isSafe(const LogicalTime& time) const;
+
+    /**
+     * Like isSafe(), but if not, trigger wake once the earliest held time has advanced
+     */
+    bool isSafeOrWake(const LogicalTime& time, const std::weak_ptr<ITriggerable>& wake);
+
+    /**
+     * Whether an event of the given time in microseconds is within the lookahead
+     */
+    bool admits(uint64_t eventTime) const;
+
+    /**
+     * Counter of advances and interrupts, see waitForAdmission()
+     */
+    uint64_t getGeneration() const;
+
+    /**
+     * Wait until an event of the given time is admitted or the generation has changed
+     */
+    void waitForAdmission(uint64_t eventTime, uint64_t generation);
+
+    /**
+     * Wake threads waiting in waitForAdmission(), e.g. to stop the replay
+     */
+    void interrupt();
+
+    /**
+     * Number of held times, i.e. of queued stamped values and running handlers
+     */
+    size_t getHeldCount() const;
+
+private:
+
+    bool admitsUnlocked(uint64_t eventTime) const;
+    bool isSafeUnlocked(const LogicalTime& time) const;
+
+    /*
+     * Wake the waiters after the earliest held time has advanced, must be called unlocked
+     */
+    void advanced(std::vector<std::weak_ptr<ITriggerable>>& wakes);
+
+    const uint64_t fLookahead;
+    mutable std::mutex fMutex;
+    std::condition_variable fAdvanced;
+    std::multiset<LogicalTime> fHeld;
+    std::vector<std::weak_ptr<ITriggerable>> fWakes;
+    uint64_t fGeneration = 0;
+};
+
+} // namespace mcf
+
+#endif // MCF_LOGICALCLOCK_H
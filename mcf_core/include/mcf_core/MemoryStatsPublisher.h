@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_MEMORYSTATSPUBLISHER_H
+#define MCF_MEMORYSTATSPUBLISHER_H
+
+#include "mcf_core/Mcf.h"
+#include "mcf_core/Mutexes.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace mcf {
+
+class ComponentManager;
+class ValueRecorder;
+
+/**
+ * Component periodically publishing the memory held by the values of a value store
+ *
+ * Publishes a msg::MemoryStats value on DEFAULT_TOPIC (or the topic the port is mapped to) with
+ * an entry per topic (latest value and history), per value queue receiving values from the store,
+ * per component owning queued ports, for the write queue of a recorder, for the memory waiting in
+ * the ValueReclaimer and for the total. Each entry carries the high-water mark of its bytes and
+ * is flagged as alert while it exceeds its threshold, crossing a threshold is also logged as a
+ * warning.
+ *
+ * The serialized size of each value is estimated once and cached as long as the value lives, so
+ * steady state collection costs a lookup per held value and one lock per topic and queue.
+ */
+class MemoryStatsPublisher : public Component {
+
+public:
+    static constexpr const char* DEFAULT_TOPIC = "/mcf/memory/stats";
+
+    /**
+     * Constructor
+     *
+     * @param valueStore The value store to account the values of, the reference is stored
+     * @param interval   Time between two statistics messages
+     */
+    explicit MemoryStatsPublisher(ValueStore& valueStore,
+                                  std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+
+    /**
+     * Attribute the queues of the queued ports of all components of a manager to the components
+     *
+     * Takes a snapshot of the ports, to be called by the thread controlling the manager after
+     * configure(). Queues of ports registered later are reported by topic only.
+     */
+    void addComponentQueues(ComponentManager& manager);
+
+    /**
+     * Account the write queue of a recorder, which must outlive the publisher (nullptr for none)
+     */
+    void setRecorder(const ValueRecorder* recorder);
+
+    /**
+     * Set the alert threshold of all entries of a kind, e.g. "queue", 0 removes the threshold
+     */
+    void setThreshold(const std::string& kind, uint64_t bytes);
+
+    /**
+     * Set the alert threshold of a single entry, overriding the threshold of its kind
+     */
+    void setThreshold(const std::string& kind, const std::string& name, uint64_t bytes);
+
+    /**
+     * Collect the memory usage now, updating the high-water marks and alerts
+     */
+    std::unique_ptr<msg::MemoryStats> collect();
+
+    void configure(IComponentConfig& config) override;
+    void startup() override;
+
+private:
+    struct ComponentQueue {
+        std::string component;
+        std::string port;
+        std::weak_ptr<ValueQueue> queue;
+    };
+
+    struct Estimate {
+        // expired if the address was reused by another value; as the weak reference keeps the
+        // allocation of a value made with make_shared, entries are dropped once it is not held
+        std::weak_ptr<const Value> value;
+        uint64_t bytes = 0;
+        uint64_t extMemBytes = 0;
+        uint64_t collection = 0;            // the collect() the value was last seen in
+    };
+
+    struct Mark {
+        uint64_t highWaterBytes = 0;
+        bool alert = false;
+    };
+
+    void tick();
+
+    /**
+     * Add the estimated size of a value to usage and to the total if it was not counted yet
+     */
+    void account(const ValuePtr& value, msg::MemoryUsage& usage, msg::MemoryUsage& total,
+                 std::unordered_set<const Value*>& counted);
+
+    const Estimate& estimate(const ValuePtr& value);
+
+    /**
+     * Set the high-water mark, threshold and alert of an entry and append it to stats
+     */
+    void finish(msg::MemoryUsage&& usage, msg::MemoryStats& stats);
+
+    ValueStore& fValueStore;
+    std::chrono::milliseconds fInterval;
+    std::chrono::steady_clock::time_point fLastPublish;
+
+    // protects the configuration and the state of collect(), which may be called by any thread
+    mutex::PriorityInheritanceMutex fStateMutex;
+    const ValueRecorder* fRecorder = nullptr;
+    std::vector<ComponentQueue> fComponentQueues;
+    std::map<std::string, uint64_t> fKindThresholds;
+    std::map<std::pair<std::string, std::string>, uint64_t> fThresholds;
+    std::map<std::pair<std::string, std::string>, Mark> fMarks;
+    std::unordered_map<const Value*, Estimate> fEstimates;
+    uint64_t fCollection = 0;
+
+    SenderPort<msg::MemoryStats> fStatsPort;
+};
+
+} // namespace mcf
+
+#endif // MCF_MEMORYSTATSPUBLISHER_H
@@ -5,6 +5,7 @@
 #define MCF_MESSAGES_H
 
 #include "mcf_core/ComponentTraceMessages.h"
+#include "mcf_core/ExtMemValue.h"
 
 #include <msgpack.hpp>
 
@@ -103,6 +104,378 @@ public:
         dropFlag, errorFlag, errorDescs)
 };
 
+/**
+ * Time to offset checkpoints of a record file, written periodically by the ValueRecorder
+ * on /mcf/recorder/index
+ */
+class RecordIndexBlock : public Value {
+public:
+    /**
+     * File offset of the previous index block, UINT64_MAX for the first one
+     */
+    uint64_t previousBlock;
+    /**
+     * Checkpoints since the previous block: the record at offsets[i] and all records after it
+     * were recorded at times[i] (in milliseconds) or later
+     */
+    std::vector<uint64_t> times;
+    std::vector<uint64_t> offsets;
+
+    MSGPACK_DEFINE(previousBlock, times, offsets)
+};
+
+/**
+ * Index of a complete record file, written by the ValueRecorder as the last record on
+ * /mcf/recorder/footer
+ *
+ * The ext mem data of the footer record is a trailer of 16 bytes at the very end of the file:
+ * the file offset of the footer record as little endian uint64 and the magic "MCFINDX1".
+ */
+class RecordFooter : public Value {
+public:
+    std::vector<std::string> topics;
+    /**
+     * Number of records per topic, in the order of topics
+     */
+    std::vector<uint64_t> counts;
+    /**
+     * Times of the first and the last record in milliseconds
+     */
+    uint64_t startTime;
+    uint64_t endTime;
+    /**
+     * All checkpoints of the file, see RecordIndexBlock
+     */
+    std::vector<uint64_t> times;
+    std::vector<uint64_t> offsets;
+    /**
+     * File offsets of the index blocks
+     */
+    std::vector<uint64_t> indexBlocks;
+
+    MSGPACK_DEFINE(topics, counts, startTime, endTime, times, offsets, indexBlocks)
+};
+
+/**
+ * Compressed records, written by the ValueRecorder on /mcf/recorder/chunk
+ *
+ * The ext mem data of the chunk record is the compressed stream of records, its ext mem header
+ * holds the compressed and the uncompressed size.
+ */
+class RecordChunk : public Value {
+public:
+    /**
+     * Compression format of the ext mem data, "deflate" for the zlib format
+     */
+    std::string codec;
+    uint32_t records;
+
+    MSGPACK_DEFINE(codec, records)
+};
+
+/**
+ * A value of a topic with delta encoding, recorded by the ValueRecorder in place of the value
+ *
+ * The payload of a value is its msgpack serialization followed by its ext mem data if that is
+ * recorded. The ext mem data of a keyframe record is the payload itself. The ext mem data of
+ * other records is the difference to the payload of the previous record of the topic: a
+ * sequence of runs covering the payload, each consisting of the number of unchanged bytes taken
+ * from the same position of the previous payload, the number of changed bytes (both as LEB128
+ * varints) and the changed bytes.
+ */
+class RecordDelta : public Value {
+public:
+    /**
+     * Type id of the recorded value
+     */
+    std::string tid;
+    bool keyframe;
+    /**
+     * Size of the msgpack serialization at the start of the payload
+     */
+    uint32_t valueSize;
+    /**
+     * Ext mem header of the recorded value, the ext mem data is part of the payload if present
+     */
+    uint32_t extmemSize;
+    bool extmemPresent;
+
+    MSGPACK_DEFINE(tid, keyframe, valueSize, extmemSize, extmemPresent)
+};
+
+/**
+ * Sync marker of a record file, written by the ValueRecorder on /mcf/recorder/sync after a sync
+ * of its durability policy, see ValueRecorder::setDurability()
+ *
+ * The ext mem data of the marker record is a trailer of 16 bytes: the file offset of the marker
+ * record as little endian uint64 and the magic "MCFSYNC1", so that the last marker is found
+ * from the end of the file.
+ */
+class RecordSyncMarker : public Value {
+public:
+    /**
+     * Size of the file which had reached the disk when the marker was recorded, the end of a
+     * record
+     */
+    uint64_t syncedSize;
+
+    MSGPACK_DEFINE(syncedSize)
+};
+
+/**
+ * Statistics of a single value store topic, see ValueStore::getStatistics()
+ */
+class ValueStoreTopicStats {
+public:
+    std::string topic;
+    /**
+     * Number of values written since statistics were enabled
+     */
+    unsigned long writes;
+    /**
+     * Writes per second since the previous statistics message
+     */
+    float writeRate;
+    /**
+     * Median and 99th percentile of the time writers waited for the topic lock in nanoseconds
+     */
+    unsigned long lockWaitP50Ns;
+    unsigned long lockWaitP99Ns;
+    /**
+     * Median and 99th percentile of the time taken to notify all receivers in nanoseconds
+     */
+    unsigned long fanOutP50Ns;
+    unsigned long fanOutP99Ns;
+    unsigned long receivers;
+    /**
+     * Number of writes which waited for blocked receivers and total waiting time in nanoseconds
+     */
+    unsigned long blockedWrites;
+    unsigned long blockedTimeNs;
+
+    MSGPACK_DEFINE(topic, writes, writeRate,
+        lockWaitP50Ns, lockWaitP99Ns,
+        fanOutP50Ns, fanOutP99Ns,
+        receivers, blockedWrites, blockedTimeNs)
+};
+
+/**
+ * Per topic statistics of the value store, published by ValueStoreStatsPublisher
+ */
+class ValueStoreStats : public Value {
+public:
+    std::vector<ValueStoreTopicStats> topics;
+    MSGPACK_DEFINE(topics)
+};
+
+/**
+ * Latency percentiles of a handler within one statistics window, see HandlerStats
+ */
+class HandlerLatency {
+public:
+    std::string handler;    // port name of a port handler, "*", "*1", ... for trigger handlers
+    uint64_t count;         // number of runs in the window
+    uint64_t p50Ns;
+    uint64_t p99Ns;
+    uint64_t p999Ns;
+    uint64_t maxNs;
+    // performance counter sums of the runs counted in the window, see Component::enablePerfCounters()
+    uint64_t countedRuns = 0;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cacheMisses = 0;
+    uint64_t branchMisses = 0;
+    uint64_t contextSwitches = 0;
+    MSGPACK_DEFINE(handler, count, p50Ns, p99Ns, p999Ns, maxNs,
+                   countedRuns, cycles, instructions, cacheMisses, branchMisses, contextSwitches)
+};
+
+/**
+ * A change of the maximum length of an adaptive queue of a handler, see
+ * ValueQueue::enableAdaptiveLength() and HandlerStats
+ */
+class QueueLengthDecision {
+public:
+    std::string handler;    // port name of the handler
+    uint64_t previousLength;
+    uint64_t length;
+    double arrivalRate;     // values received per second in the window which led to the change
+    double serviceRate;     // values popped per second
+    double dropRate;        // fraction of the received values dropped, or received into a full blocking queue
+    uint64_t maxWaitNs;     // longest wait of a popped value
+    MSGPACK_DEFINE(handler, previousLength, length, arrivalRate, serviceRate, dropRate, maxWaitNs)
+};
+
+/**
+ * Handler latency statistics of a component, published at the end of each statistics window
+ * on /mcf/stats/<instance>/handlers
+ */
+class HandlerStats : public Value {
+public:
+    std::string component;
+    uint64_t windowUs;      // length of the window
+    std::vector<HandlerLatency> handlers;
+    // length changes of the adaptive queues of the handlers in the window
+    std::vector<QueueLengthDecision> queueDecisions;
+    MSGPACK_DEFINE(component, windowUs, handlers, queueDecisions)
+};
+
+/**
+ * Control of the handler statistics of a component, written to /mcf/stats/<instance>/control
+ */
+class HandlerStatsControl : public Value {
+public:
+    bool reset = false;         // discard the current window and start a new one
+    uint32_t intervalMs = 0;    // new window length, 0 keeps the current one
+    MSGPACK_DEFINE(reset, intervalMs)
+};
+
+/**
+ * Published to /mcf/overload/<instance> whenever a component exceeds its overload budget,
+ * see Component::setOverloadBudget()
+ */
+class OverloadAlarm : public Value {
+public:
+    std::string component;
+    std::string handler;    // port name of the handler, "*", "*1", ... for trigger handlers
+    std::string reason;     // "handlerTime" or "queueAge"
+    uint64_t measuredNs;    // the handler run time or the age of the oldest queued value
+    uint64_t budgetNs;
+    uint64_t dropped;       // values dropped in response
+    MSGPACK_DEFINE(component, handler, reason, measuredNs, budgetNs, dropped)
+};
+
+/**
+ * Memory held by the values of a topic, a value queue, a component or the recorder, see MemoryStats
+ *
+ * The bytes of a value are estimated as its ext mem size plus its serialized size, which is only
+ * known for registered types.
+ */
+class MemoryUsage {
+public:
+    std::string kind;           // "topic", "queue", "component", "recorder", "reclaimer" or "total"
+    std::string name;           // the topic, "<component>.<port>" or "<topic>#<n>" of a queue
+    uint64_t values;            // number of values held, the same value may be held repeatedly
+    uint64_t bytes;
+    uint64_t extMemBytes;       // part of bytes held in ext mem
+    uint64_t highWaterBytes;    // maximum of bytes since the publisher started
+    uint64_t thresholdBytes;    // alert threshold, 0 if none is set
+    bool alert;                 // bytes exceed thresholdBytes
+    MSGPACK_DEFINE(kind, name, values, bytes, extMemBytes, highWaterBytes, thresholdBytes, alert)
+};
+
+/**
+ * Memory held by the values of a process, published by MemoryStatsPublisher
+ *
+ * The "total" entry counts each value once, even if it is held by several topics and queues. The
+ * "recorder" entry reports the write queue of a ValueRecorder as counted for its byte limit, it
+ * is not part of the total and its number of values is not known. Both have an empty name.
+ */
+class MemoryStats : public Value {
+public:
+    std::vector<MemoryUsage> entries;
+    MSGPACK_DEFINE(entries)
+};
+
+/**
+ * End-to-end latency percentiles of the values of a source topic within one window
+ */
+class LineagePathLatency {
+public:
+    std::string source;     // the source topic
+    uint64_t count;         // number of sink values derived from the source in the window
+    uint64_t p50Ns;
+    uint64_t p99Ns;
+    uint64_t p999Ns;
+    uint64_t maxNs;
+    MSGPACK_DEFINE(source, count, p50Ns, p99Ns, p999Ns, maxNs)
+};
+
+/**
+ * End-to-end latencies of the values written to a sink topic, published at the end of each
+ * window on /mcf/lineage<sink topic>, see LineageTracker
+ */
+class LineageLatency : public Value {
+public:
+    std::string sink;
+    uint64_t windowUs;      // length of the window
+    std::vector<LineagePathLatency> paths;
+    MSGPACK_DEFINE(sink, windowUs, paths)
+};
+
+/**
+ * Duration percentiles of the scopes of an MCF_PERF_SCOPE tag within one window
+ */
+class PerfScopeLatency {
+public:
+    std::string name;       // the tag
+    uint64_t count;         // number of scopes left in the window
+    uint64_t p50Ns;
+    uint64_t p99Ns;
+    uint64_t p999Ns;
+    uint64_t maxNs;
+    MSGPACK_DEFINE(name, count, p50Ns, p99Ns, p999Ns, maxNs)
+};
+
+/**
+ * Scope durations of a process, published at the end of each window, see
+ * PerfScopes::startPublishing()
+ */
+class PerfScopeStats : public Value {
+public:
+    uint64_t windowUs;      // length of the window
+    std::vector<PerfScopeLatency> scopes;
+    MSGPACK_DEFINE(windowUs, scopes)
+};
+
+/**
+ * Contention statistics of all mutexes sharing a name, see mutex::MutexProfile
+ */
+class MutexStatsEntry {
+public:
+    std::string name;
+    uint64_t locks;
+    uint64_t contentions;   // contended lock() calls and failed try_lock() calls
+    uint64_t waitP50Ns;
+    uint64_t waitP99Ns;
+    uint64_t waitMaxNs;
+    uint64_t waitTotalNs;
+    uint64_t holdP50Ns;
+    uint64_t holdP99Ns;
+    uint64_t holdMaxNs;
+    std::vector<std::string> callSites;     // most contending call sites first
+    std::vector<uint64_t> callSiteContentions;
+    MSGPACK_DEFINE(name, locks, contentions,
+        waitP50Ns, waitP99Ns, waitMaxNs, waitTotalNs,
+        holdP50Ns, holdP99Ns, holdMaxNs,
+        callSites, callSiteContentions)
+};
+
+/**
+ * Mutex contention statistics, published by MutexProfilePublisher, longest total wait first
+ */
+class MutexStats : public Value {
+public:
+    std::vector<MutexStatsEntry> mutexes;
+    MSGPACK_DEFINE(mutexes)
+};
+
+/**
+ * Downscaled copy of an image, published by PreviewService to /mcf/preview<image topic>
+ *
+ * The ext mem holds the pixels row by row without padding, or a JPEG file if encoding is "jpeg".
+ */
+class PreviewImage : public ExtMemValue<uint8_t> {
+public:
+    std::string topic;      // the image topic
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;      // interleaved 8 bit channels, e.g. 1 for gray or 3 for rgb
+    uint32_t factor;        // the image is factor times as wide and high
+    std::string encoding;   // "raw" or "jpeg"
+    MSGPACK_DEFINE(topic, width, height, channels, factor, encoding)
+};
+
 /**
  * Value which holds configuration directory string
  */
@@ -138,6 +511,20 @@ inline void registerValueTypes(T& r) {
     r.template registerType<LogMessage>("mcf::LogMessage");
     r.template registerType<LogControl>("mcf::LogControl");
     r.template registerType<RecorderStatus>("mcf::RecorderStatus");
+    r.template registerType<RecordIndexBlock>("mcf::RecordIndexBlock");
+    r.template registerType<RecordFooter>("mcf::RecordFooter");
+    r.template registerType<RecordChunk>("mcf::RecordChunk");
+    r.template registerType<RecordDelta>("mcf::RecordDelta");
+    r.template registerType<RecordSyncMarker>("mcf::RecordSyncMarker");
+    r.template registerType<ValueStoreStats>("mcf::ValueStoreStats");
+    r.template registerType<HandlerStats>("mcf::HandlerStats");
+    r.template registerType<HandlerStatsControl>("mcf::HandlerStatsControl");
+    r.template registerType<OverloadAlarm>("mcf::OverloadAlarm");
+    r.template registerType<MemoryStats>("mcf::MemoryStats");
+    r.template registerType<LineageLatency>("mcf::LineageLatency");
+    r.template registerType<PerfScopeStats>("mcf::PerfScopeStats");
+    r.template registerType<MutexStats>("mcf::MutexStats");
+    r.template registerType<PreviewImage>("mcf::PreviewImage");
     r.template registerType<ConfigDir>("mcf::ConfigDir");
     r.template registerType<ConfigDirs>("mcf::ConfigDirs");
 
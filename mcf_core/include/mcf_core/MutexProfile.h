@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_MUTEXPROFILE_H
+#define MCF_MUTEXPROFILE_H
+
+#include "mcf_core/LatencyHistogram.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mcf {
+namespace mutex {
+
+/**
+ * @brief Contention statistics shared by all mutexes of the same name
+ *
+ * Only collected if mcf_core is built with the CMake option MCF_ENABLE_MUTEX_PROFILING, for
+ * mutexes named with AbstractPosixThreadMutex::setName(). Recording is lock-free, so that the
+ * profile does not add contention of its own.
+ */
+class MutexProfile {
+public:
+    /// Number of distinct contending call sites tracked per profile, further ones are merged
+    static constexpr size_t CALL_SITE_SLOTS = 64;
+
+    struct CallSite {
+        /// Symbol and offset of the code which locked the mutex, or its address
+        std::string location;
+        uint64_t contentions = 0;
+    };
+
+    struct Snapshot {
+        std::string name;
+        /// Successful lock() and try_lock() calls
+        uint64_t locks = 0;
+        /// lock() calls which had to wait and try_lock() calls which failed
+        uint64_t contentions = 0;
+        /// Waiting times of the contended lock() calls
+        LatencyHistogram::Summary wait;
+        /// Times the mutex was held
+        LatencyHistogram::Summary hold;
+        /// The most contending call sites, most contentions first
+        std::vector<CallSite> callSites;
+    };
+
+    explicit MutexProfile(std::string name);
+
+    MutexProfile(const MutexProfile&) = delete;
+    MutexProfile& operator=(const MutexProfile&) = delete;
+
+    /**
+     * The profile of a name, created on first use and never destroyed
+     */
+    static MutexProfile& get(const std::string& name);
+
+    /**
+     * Snapshots of all profiles, the ones with the longest total waiting time first
+     *
+     * @param maxCallSites the number of call sites reported per profile
+     */
+    static std::vector<Snapshot> snapshots(size_t maxCallSites = 5);
+
+    /**
+     * Human readable table of snapshots(), e.g. for a log at shutdown
+     */
+    static std::string report(size_t maxCallSites = 5);
+
+    static void resetAll();
+
+    /**
+     * Time base of the profiles, ns of the steady clock
+     */
+    static uint64_t now();
+
+    void recordAcquisition() {
+        fLocks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void recordContention(uint64_t waitNs, const void* callSite);
+
+    void recordHold(uint64_t holdNs) {
+        fHold.record(holdNs);
+    }
+
+    Snapshot snapshot(size_t maxCallSites) const;
+
+    void reset();
+
+private:
+    const std::string fName;
+    std::atomic<uint64_t> fLocks{0};
+    std::atomic<uint64_t> fContentions{0};
+    LatencyHistogram fWait;
+    LatencyHistogram fHold;
+    // open addressing table of call site addresses, 0 marks a free slot
+    std::array<std::atomic<uintptr_t>, CALL_SITE_SLOTS> fCallSites{};
+    std::array<std::atomic<uint64_t>, CALL_SITE_SLOTS> fCallSiteContentions{};
+    // contentions of call sites not fitting into the table
+    std::atomic<uint64_t> fOtherContentions{0};
+};
+
+} // namespace mutex
+} // namespace mcf
+
+#endif // MCF_MUTEXPROFILE_H
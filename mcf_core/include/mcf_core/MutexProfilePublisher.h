@@ -0,0 +1,45 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_MUTEXPROFILEPUBLISHER_H
+#define MCF_MUTEXPROFILEPUBLISHER_H
+
+#include "mcf_core/Mcf.h"
+
+#include <chrono>
+
+namespace mcf {
+
+/**
+ * Component periodically publishing the contention statistics of the named mcf mutexes
+ *
+ * Publishes a msg::MutexStats value on DEFAULT_TOPIC (or the topic the port is mapped to). The
+ * statistics are only collected if mcf_core is built with MCF_ENABLE_MUTEX_PROFILING, otherwise
+ * the published list is empty.
+ */
+class MutexProfilePublisher : public Component {
+
+public:
+    static constexpr const char* DEFAULT_TOPIC = "/mcf/mutex/stats";
+
+    /**
+     * Constructor
+     *
+     * @param interval     Time between two statistics messages
+     * @param maxCallSites Number of contending call sites published per mutex name
+     */
+    explicit MutexProfilePublisher(std::chrono::milliseconds interval = std::chrono::milliseconds(1000),
+                                   size_t maxCallSites = 5);
+
+    void configure(IComponentConfig& config) override;
+
+private:
+    void publish();
+
+    size_t fMaxCallSites;
+    SenderPort<msg::MutexStats> fStatsPort;
+};
+
+} // namespace mcf
+
+#endif // MCF_MUTEXPROFILEPUBLISHER_H
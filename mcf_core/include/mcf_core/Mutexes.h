@@ -5,9 +5,15 @@
 #ifndef MCF_MUTEXES_H
 #define MCF_MUTEXES_H
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <pthread.h>
 
+#ifndef MCF_ENABLE_MUTEX_PROFILING
+#define MCF_ENABLE_MUTEX_PROFILING 0
+#endif
+
 namespace mcf
 {
 /**
@@ -30,6 +36,18 @@ namespace mutex
  */
 bool realtimeCapabilityAvailable();
 
+/**
+ * @brief Announces that the scheduling policy of a thread has been changed
+ *
+ * Priority ceiling mutexes cache per thread whether it is already scheduled in real-time, so that
+ * locking them makes no system calls for real-time threads. Code changing the scheduling policy
+ * of a thread with pthread_setschedparam() or sched_setattr() calls this function afterwards to
+ * invalidate the caches of all threads.
+ */
+void schedulingPolicyChanged();
+
+class MutexProfile;
+
 /**
  * @brief An abstract wrapper around pthread_mutex_t
  *
@@ -73,15 +91,44 @@ public:
 
     pthread_mutex_t* native_handle() { return &_mutex; }
 
+    /**
+     * @brief Names the mutex for contention profiling
+     *
+     * All mutexes of the same name share one MutexProfile. Does nothing unless mcf_core is built
+     * with MCF_ENABLE_MUTEX_PROFILING. Must be called before the mutex is used.
+     *
+     * @param name A string literal or another string outliving the call
+     */
+#if MCF_ENABLE_MUTEX_PROFILING
+    void setName(const char* name);
+#else
+    void setName(const char*) {}
+#endif
+
 protected:
     AbstractPosixThreadMutex() = default;
 
-    int lockInternal() noexcept { return pthread_mutex_lock(&_mutex); }
+    /**
+     * The lock functions of the derived classes pass the address they were called from as
+     * callSite, so that profiling attributes contentions to the code locking the mutex
+     */
+#if MCF_ENABLE_MUTEX_PROFILING
+    int lockInternal(const void* callSite = nullptr) noexcept;
+    int unlockInternal() noexcept;
+    int tryLockInternal(const void* callSite = nullptr) noexcept;
+#else
+    int lockInternal(const void* = nullptr) noexcept { return pthread_mutex_lock(&_mutex); }
     int unlockInternal() noexcept { return pthread_mutex_unlock(&_mutex); }
-    int tryLockInternal() noexcept { return pthread_mutex_trylock(&_mutex); }
+    int tryLockInternal(const void* = nullptr) noexcept { return pthread_mutex_trylock(&_mutex); }
+#endif
 
 private:
     pthread_mutex_t _mutex{};
+#if MCF_ENABLE_MUTEX_PROFILING
+    MutexProfile* _profile = nullptr;
+    /// Profile time the mutex has been acquired at, only accessed by the owner
+    uint64_t _lockedAt = 0;
+#endif
 };
 
 /**
@@ -128,6 +175,54 @@ public:
     PriorityInheritanceMutex();
 };
 
+/**
+ * @brief A reader/writer lock for read-mostly data built on a priority inheritance mutex
+ *
+ * Satisfies the `SharedMutex` named requirement (in C++14 usable with std::shared_lock). Readers
+ * only touch an atomic reader count, so concurrent readers do not serialize. A writer holds an
+ * internal PriorityInheritanceMutex for its whole critical section: readers and writers blocked
+ * by a writer boost its priority. While a writer waits for the active readers to leave, it does
+ * not boost them, so shared sections are meant to be short, e.g. map lookups.
+ *
+ * Writers are preferred, new readers queue behind a pending writer. The lock is not recursive,
+ * a thread owning it exclusively must not lock it shared.
+ */
+class PriorityInheritanceSharedMutex
+{
+public:
+    PriorityInheritanceSharedMutex();
+    PriorityInheritanceSharedMutex(PriorityInheritanceSharedMutex&) = delete;
+    PriorityInheritanceSharedMutex(PriorityInheritanceSharedMutex&&) = delete;
+    ~PriorityInheritanceSharedMutex();
+
+    /// Acquires exclusive ownership, waits for the active readers to leave
+    void lock();
+    /// Acquires exclusive ownership if neither a writer nor a reader owns the mutex
+    bool try_lock();
+    void unlock() noexcept;
+
+    /// Acquires shared ownership, blocks only while a writer owns or waits for the mutex
+    void lock_shared();
+    /// Acquires shared ownership if no writer owns or waits for the mutex
+    bool try_lock_shared() noexcept;
+    void unlock_shared() noexcept;
+
+    /// @see AbstractPosixThreadMutex::setName(), profiles the writers and the blocked readers
+    void setName(const char* name) { _mutex.setName(name); }
+
+private:
+    /// Wakes up a writer waiting in lock() if a reader has just left
+    void readerLeft(int remainingReaders) noexcept;
+
+    /// Held by the writer for its whole critical section
+    PriorityInheritanceMutex _mutex;
+    /// Protects the wait for the readers to drain
+    PriorityInheritanceMutex _drainMutex;
+    pthread_cond_t _drained{};
+    std::atomic<int> _readers{0};
+    std::atomic<bool> _writer{false};
+};
+
 /**
  * @brief A priority ceiling mutex wrapper
  *
@@ -210,11 +305,15 @@ private:
      * _threadSchedulingState.needReset = true. If this does not succeed, the original scheduling
      * is restored and the error code will be returned.
      *
+     * Threads known to be real-time from a previous call lock right away, without querying their
+     * scheduling state, see schedulingPolicyChanged().
+     *
      * @param lockFunction The function performing the locking (for example,
      * PriorityCeilingMutex::tryLockInternal)
      * @return int The return code of the locking function
      */
-    int lockWithReschedule(const std::function<int()>& lockFunction);
+    template<typename LockFunction>
+    int lockWithReschedule(LockFunction lockFunction);
 
     bool _realtimeCapable = false;
 };
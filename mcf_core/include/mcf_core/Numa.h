@@ -0,0 +1,122 @@
+/**
+ * Helpers for NUMA aware placement of component threads and value memory.
+ *
+ * Copyright (c) 2024 Accenture
+ *
+ */
+#ifndef MCF_NUMA_H
+#define MCF_NUMA_H
+
+#include "mcf_core/ThreadAffinity.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mcf
+{
+class Value;
+
+/**
+ * @brief Where the memory of values sent between NUMA nodes is placed
+ *
+ * PRODUCER: memory stays on the node of the thread which allocated it (the kernel's first touch
+ *           policy, the default)
+ * CONSUMER: the external memory of values is migrated to the node of the majority of the
+ *           receiving components, before the values are published
+ *
+ * See ComponentManager::setNumaPlacement()
+ */
+enum class NumaPlacement
+{
+    PRODUCER,
+    CONSUMER
+};
+
+/**
+ * @brief Per node counters of value memory, in bytes or pages since process start
+ *
+ * Bandwidths follow from the difference of two snapshots.
+ */
+struct NumaNodeStatistics
+{
+    int node = 0;
+    /// External memory of values allocated by threads running on the node
+    uint64_t allocatedBytes = 0;
+    /// External memory of values migrated to the node, see NumaPlacement::CONSUMER
+    uint64_t migratedBytes = 0;
+    /// Pages the kernel allocated on the node for threads running on it (system wide)
+    uint64_t localPages = 0;
+    /// Pages the kernel allocated on the node for threads running on other nodes (system wide)
+    uint64_t remotePages = 0;
+};
+
+/**
+ * @brief The number of NUMA nodes of the system, 1 if the system is not NUMA
+ */
+int getNumaNodeCount();
+
+/**
+ * @brief The CPUs of a NUMA node
+ *
+ * @return the CPU mask, or the empty mask if the node does not exist
+ */
+CpuMask getNumaNodeCpus(int node);
+
+/**
+ * @brief The NUMA node of the CPU the calling thread currently runs on, 0 if unknown
+ */
+int getCurrentNumaNode();
+
+/**
+ * @brief Let the calling thread allocate memory from the given node, preferably
+ *
+ * @param node The node, -1 to restore the default policy of allocating on the local node
+ * @return 0 on success, an error number as returned by set_mempolicy(2) otherwise
+ */
+int setThreadNumaNode(int node);
+
+/**
+ * @brief The NUMA node of the memory page holding an address, -1 if unknown or not faulted in
+ */
+int getMemoryNumaNode(const void* address);
+
+/**
+ * @brief Migrate the memory pages of a buffer to a NUMA node
+ *
+ * Only pages lying entirely within the buffer are migrated, so that no unrelated data is moved.
+ *
+ * @return the number of bytes migrated
+ */
+size_t migrateToNumaNode(const void* address, size_t length, int node);
+
+/**
+ * @brief Migrate the external memory of a value to a NUMA node, see NumaPlacement::CONSUMER
+ *
+ * Has no effect for values without external memory. Memory already placed on the node, e.g. a
+ * recycled ExtMemPool buffer, is not migrated again, see IExtMemValue::extMemPlace().
+ */
+void placeOnNumaNode(const Value& value, int node);
+
+/**
+ * @brief Account for external memory allocated by the calling thread
+ */
+void recordNumaAllocation(size_t bytes);
+
+/**
+ * @brief The node receiving most of the values, -1 if there is no consumer on a known node
+ *
+ * Ties are resolved in favor of the lower node.
+ *
+ * @param consumerNodes The nodes of the consumers of a topic, -1 for unknown nodes
+ */
+int dominantNumaNode(const std::vector<int>& consumerNodes);
+
+/**
+ * @brief Snapshot of the counters of all nodes
+ */
+std::vector<NumaNodeStatistics> getNumaStatistics();
+
+} // namespace mcf
+
+#endif // MCF_NUMA_H
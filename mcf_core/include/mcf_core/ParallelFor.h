@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_PARALLELFOR_H
+#define MCF_PARALLELFOR_H
+
+#include "mcf_core/ThreadAffinity.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Settings of the worker pool of parallelFor(), see configureParallelFor()
+ */
+struct ParallelForConfig {
+    /// threads running chunks, including the calling thread, 0 for one per CPU of cpuAffinity
+    size_t numThreads = 0;
+    /// the CPUs the workers may run on, the empty mask allows the CPUs of the process
+    CpuMask cpuAffinity = 0;
+};
+
+/**
+ * Replace the worker pool of parallelFor()
+ *
+ * On NUMA systems, the workers are spread over the nodes of their CPUs and pinned to the CPUs of
+ * their node, so that each worker prefers chunks of callers on its own node. Workers of the
+ * previous pool exit after their current chunk, calls in progress are completed by their callers.
+ */
+void configureParallelFor(const ParallelForConfig& config);
+
+/**
+ * Limit the threads running the chunks of parallelFor() calls made by the calling thread,
+ * including the calling thread itself
+ *
+ * Components set the limit from SchedulingParameters::parallelThreads before running their
+ * handlers, so that a component does not take more than its share of the pool. 0 removes the
+ * limit.
+ */
+void setParallelForThreadLimit(size_t maxThreads);
+
+/**
+ * The limit of the calling thread, see setParallelForThreadLimit()
+ */
+size_t getParallelForThreadLimit();
+
+/**
+ * Run body(chunkBegin, chunkEnd) on the chunks of [begin, end), in parallel
+ *
+ * The range is split into chunks of grain indices, the last one may be shorter. The chunks run on
+ * the calling thread and a pool of worker threads shared by the process, see
+ * configureParallelFor(). The call returns when all chunks have finished, so that the body may
+ * refer to locals of the caller. Components use it for data parallel kernels, e.g. to process the
+ * rows of an image, instead of adding threads of their own.
+ *
+ * Workers take chunks of the calls of callers with the highest real-time priority first and
+ * run them with the caller's real-time scheduling policy, so that a high priority component does
+ * not wait for workers preempted by lower priority threads. Calls may be nested: the calling
+ * thread works on its own chunks while it waits, so that the call completes even if all workers
+ * are busy. If the body throws, the remaining chunks still run and the first exception is
+ * rethrown to the caller.
+ *
+ * @param begin  first index
+ * @param end    index behind the last index
+ * @param grain  indices per chunk, 0 splits the range into a few chunks per thread
+ * @param body   the function run on each chunk
+ */
+void parallelFor(size_t begin, size_t end, size_t grain,
+                 const std::function<void(size_t, size_t)>& body);
+
+/**
+ * Number of threads running the chunks of parallelFor(), including the calling thread, not
+ * taking the limit of the calling thread into account
+ */
+size_t parallelForThreads();
+
+/**
+ * The grain parallelFor() uses for count indices and the given grain
+ */
+size_t parallelForGrain(size_t count, size_t grain);
+
+/**
+ * Reduce the chunks of [begin, end) in parallel, see parallelFor()
+ *
+ * map(chunkBegin, chunkEnd) computes the result of a chunk. The results of the chunks are
+ * combined with reduce(accumulated, chunkResult) in the order of the chunks, starting with
+ * identity, so that the result does not depend on the number of threads for a given grain.
+ */
+template<typename T, typename Map, typename Reduce>
+T parallelReduce(size_t begin, size_t end, size_t grain, T identity, Map map, Reduce reduce)
+{
+    if (begin >= end) {
+        return identity;
+    }
+    grain = parallelForGrain(end - begin, grain);
+    // wrapped, so that the results of e.g. bool chunks do not share bytes
+    struct Slot {
+        T value;
+    };
+    std::vector<Slot> results((end - begin + grain - 1) / grain, Slot{identity});
+    parallelFor(0, results.size(), 1, [&](size_t chunkBegin, size_t chunkEnd) {
+        for (size_t chunk = chunkBegin; chunk < chunkEnd; ++chunk) {
+            const size_t first = begin + chunk * grain;
+            results[chunk].value = map(first, std::min(first + grain, end));
+        }
+    });
+    T result = std::move(identity);
+    for (auto& slot : results) {
+        result = reduce(std::move(result), std::move(slot.value));
+    }
+    return result;
+}
+
+} // namespace mcf
+
+#endif // MCF_PARALLELFOR_H
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_PARTITIONEDRECORDHANDOFF_H
+#define MCF_PARTITIONEDRECORDHANDOFF_H
+
+#include "mcf_core/RecordHandoff.h"
+#include "mcf_core/ValueRecorder.h"
+#include "mcf_core/ValueStore.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Records the values of a ValueRecorder into one record file per group of topics, see
+ * ValueRecorder::setHandoff()
+ *
+ * Readers of a few topics only map the files of their partitions, and partitions can be read in
+ * parallel with one RecordReader per thread. Each partition is recorded by a ValueRecorder of its
+ * own into a file named after the filename passed to start() with the partition name before the
+ * extension, e.g. record_lidar.bin. All partitions record the time the value was queued by the
+ * handing recorder, so their footers share a time base and RecordReader::seek() finds the same
+ * moment in each of them.
+ *
+ * The values of a topic are recorded in the first partition with a matching pattern, see
+ * ValueStore::matchesPattern(). Topics matching no partition are recorded in OTHER_PARTITION,
+ * which is added unless a partition without patterns already takes them.
+ *
+ * A manifest, see manifestFilename(), lists the partitions with their patterns and files. It is
+ * written by open() and rewritten by close(), when all files of rotating partitions are known.
+ */
+class PartitionedRecordHandoff : public IRecordHandoff {
+public:
+    static constexpr const char* OTHER_PARTITION = "other";
+
+    struct Partition {
+        std::string name;
+        /// topic patterns, empty for all topics not taken by another partition
+        std::vector<std::string> topics;
+        /// the files of the partition, only filled by readManifest()
+        std::vector<std::string> files;
+    };
+
+    /**
+     * Constructor, throws std::runtime_error on invalid or duplicate partition names
+     *
+     * @param typeRegistry  the types of the values, usually the value store of the handing
+     *                      recorder, must outlive the handoff
+     */
+    PartitionedRecordHandoff(const TypeRegistry& typeRegistry, std::vector<Partition> partitions);
+
+    ~PartitionedRecordHandoff() override;
+
+    /**
+     * The recorder of a partition, e.g. to configure compression or rotation before the handing
+     * recorder is started, throws std::out_of_range for unknown partitions
+     */
+    ValueRecorder& getRecorder(const std::string& partition);
+
+    int open(const std::string& filename) override;
+
+    int handOff(const std::string& topic,
+                std::chrono::high_resolution_clock::time_point time,
+                const ValuePtr& value,
+                uint64_t seq,
+                const TypeRegistry::TypemapEntry& typeInfo,
+                bool extMem) override;
+
+    int close() override;
+
+    /**
+     * The manifest of a recording started with filename, e.g. record.partitions.json for
+     * record.bin
+     */
+    static std::string manifestFilename(const std::string& filename);
+
+    /**
+     * Read a manifest, with the files relative to the working directory, throws
+     * std::runtime_error on failure
+     */
+    static std::vector<Partition> readManifest(const std::string& manifest);
+
+    /**
+     * The files holding the given topics according to a manifest, in the order of the partitions
+     */
+    static std::vector<std::string> selectFiles(const std::string& manifest,
+                                                const std::vector<std::string>& topics);
+
+private:
+    struct PartitionRecorder {
+        explicit PartitionRecorder(const TypeRegistry& types) : valueStore(types), recorder(valueStore) {}
+
+        Partition partition;
+        // only receives the status of the recorder, types are looked up in the handing value store
+        ValueStore valueStore;
+        ValueRecorder recorder;
+    };
+
+    struct Route {
+        PartitionRecorder* partition = nullptr;
+        bool extMem = false;
+    };
+
+    /**
+     * The partition recording a topic, the first one with a matching pattern
+     */
+    PartitionRecorder& findPartition(const std::string& topic) const;
+
+    /**
+     * @return 0 on success, an errno value otherwise
+     */
+    int writeManifest() const;
+
+    std::vector<std::unique_ptr<PartitionRecorder>> fPartitions;
+    std::string fFilename;
+    // the partitions of the topics seen so far, only used by the write thread
+    std::unordered_map<std::string, Route> fRoutes;
+};
+
+} // namespace mcf
+
+#endif // MCF_PARTITIONEDRECORDHANDOFF_H
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_PERFCOUNTERS_H
+#define MCF_PERFCOUNTERS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mcf {
+
+/**
+ * Counts of the performance counters of a thread, or their differences over a handler run
+ */
+struct PerfCounterValues {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cacheMisses = 0;
+    uint64_t branchMisses = 0;
+    uint64_t contextSwitches = 0;
+};
+
+/**
+ * The performance counters of the calling thread, opened with perf_event_open
+ *
+ * Cycles, instructions, cache misses and branch misses are opened as one group counting user
+ * space, so that they are scheduled onto the PMU together and their ratios are consistent. Where
+ * the kernel allows it (/sys/bus/event_source/devices/cpu/rdpmc), the hardware counters are read
+ * with rdpmc without a system call. Otherwise the group is read with a single read(). Context
+ * switches are a software event, read with read() in either case.
+ *
+ * Counters the CPU or the virtual machine does not provide read as 0. Without any hardware
+ * counter, e.g. if perf_event_paranoid forbids them, the counters of the thread are not available.
+ */
+class ThreadPerfCounters {
+public:
+    /**
+     * The counters of the calling thread, opened on first use, nullptr if not available
+     */
+    static ThreadPerfCounters* current();
+
+    ~ThreadPerfCounters();
+
+    ThreadPerfCounters(const ThreadPerfCounters&) = delete;
+    ThreadPerfCounters& operator=(const ThreadPerfCounters&) = delete;
+
+    /**
+     * Read the current counts, returns false if reading failed
+     */
+    bool read(PerfCounterValues& values) const;
+
+    /// the hardware counters are read with rdpmc
+    bool usesRdpmc() const { return fRdpmc; }
+
+private:
+    static constexpr size_t NUM_HARDWARE = 4;
+
+    ThreadPerfCounters() = default;
+
+    bool open();
+    bool readHardware(uint64_t* counts) const;
+
+    // cycles (the group leader), instructions, cache misses, branch misses, -1 if not opened
+    int fHardware[NUM_HARDWARE] = {-1, -1, -1, -1};
+    // position of the counters in a group read, the opened ones are numbered consecutively
+    size_t fGroupIndex[NUM_HARDWARE] = {};
+    size_t fGroupSize = 0;
+    // the mmap()ed pages of the hardware counters
+    void* fPages[NUM_HARDWARE] = {};
+    int fContextSwitches = -1;
+    bool fRdpmc = false;
+};
+
+/**
+ * Counter differences over a piece of code run on the calling thread
+ *
+ * A sample constructed disabled, or on a thread without counters, costs a branch.
+ */
+class PerfCounterSample {
+public:
+    explicit PerfCounterSample(bool enabled)
+    : fCounters(enabled ? ThreadPerfCounters::current() : nullptr)
+    {
+        if (fCounters != nullptr && !fCounters->read(fStart)) {
+            fCounters = nullptr;
+        }
+    }
+
+    /**
+     * Compute the differences since construction, returns false if nothing was counted
+     */
+    bool stop(PerfCounterValues& delta) const;
+
+private:
+    ThreadPerfCounters* fCounters;
+    PerfCounterValues fStart;
+};
+
+/**
+ * Counter sums of the runs of a handler, see Component::enablePerfCounters()
+ *
+ * Like LatencyHistogram, recording takes relaxed atomic increments only and the sums may be read
+ * and taken concurrently.
+ */
+class PerfCounterTotals {
+public:
+    struct Summary {
+        uint64_t runs = 0;
+        PerfCounterValues sum;
+    };
+
+    void record(const PerfCounterValues& delta) {
+        fRuns.fetch_add(1, std::memory_order_relaxed);
+        fCycles.fetch_add(delta.cycles, std::memory_order_relaxed);
+        fInstructions.fetch_add(delta.instructions, std::memory_order_relaxed);
+        fCacheMisses.fetch_add(delta.cacheMisses, std::memory_order_relaxed);
+        fBranchMisses.fetch_add(delta.branchMisses, std::memory_order_relaxed);
+        fContextSwitches.fetch_add(delta.contextSwitches, std::memory_order_relaxed);
+    }
+
+    /**
+     * Sums of the runs recorded since construction or the last reset
+     */
+    Summary summary() const;
+
+    /**
+     * Sums of the runs recorded so far, clearing them at the same time
+     */
+    Summary takeSummary();
+
+    void reset() { takeSummary(); }
+
+private:
+    std::atomic<uint64_t> fRuns{0};
+    std::atomic<uint64_t> fCycles{0};
+    std::atomic<uint64_t> fInstructions{0};
+    std::atomic<uint64_t> fCacheMisses{0};
+    std::atomic<uint64_t> fBranchMisses{0};
+    std::atomic<uint64_t> fContextSwitches{0};
+};
+
+} // namespace mcf
+
+#endif // MCF_PERFCOUNTERS_H
@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_PERFSCOPE_H
+#define MCF_PERFSCOPE_H
+
+#include "mcf_core/LatencyHistogram.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MCF_PERF_SCOPE_TSC 1
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mcf {
+
+class ValueStore;
+
+/**
+ * Time the enclosing scope under a static tag, e.g. MCF_PERF_SCOPE("RemoteSender::pack")
+ *
+ * The tag is registered once per call site, scopes with the same name share their statistics.
+ * See PerfScopes.
+ */
+#define MCF_PERF_SCOPE(name) \
+    MCF_PERF_SCOPE_IMPL(name, MCF_PERF_SCOPE_CONCAT(mcfPerfScopeTag, __LINE__), \
+                        MCF_PERF_SCOPE_CONCAT(mcfPerfScope, __LINE__))
+
+#define MCF_PERF_SCOPE_CONCAT_IMPL(a, b) a##b
+#define MCF_PERF_SCOPE_CONCAT(a, b) MCF_PERF_SCOPE_CONCAT_IMPL(a, b)
+#define MCF_PERF_SCOPE_IMPL(name, tag, scope) \
+    static const ::mcf::PerfScopeTag tag(name); \
+    const ::mcf::PerfScope scope(tag)
+
+/**
+ * Process wide duration statistics of the scopes timed with MCF_PERF_SCOPE
+ *
+ * Each thread records into histograms of its own, one per tag, which only that thread writes:
+ * a scope costs two reads of the clock and a few plain loads and stores, without atomic
+ * read-modify-write instructions or locks, so that scopes can stay enabled in production builds.
+ * The histogram of a tag is allocated the first time a thread leaves one of its scopes.
+ *
+ * On x86 CPUs with an invariant TSC, the clock is the TSC, converted to nanoseconds when the
+ * histograms are summarized. Otherwise it is std::chrono::steady_clock.
+ *
+ * The statistics are summarized on request, or published periodically as msg::PerfScopeStats,
+ * see startPublishing().
+ */
+class PerfScopes {
+public:
+    /// tags beyond this number are not recorded
+    static constexpr size_t MAX_TAGS = 256;
+
+    /**
+     * Durations of the scopes of a tag
+     */
+    struct TagSummary {
+        std::string name;
+        LatencyHistogram::Summary latency;  ///< in nanoseconds
+    };
+
+    /**
+     * The id of a tag name, registered on first use, MAX_TAGS if there are too many tags
+     */
+    static uint32_t registerTag(const std::string& name);
+
+    /**
+     * The current time of the scope clock in ticks
+     */
+    static uint64_t now() {
+#ifdef MCF_PERF_SCOPE_TSC
+        if (fUseTsc) {
+            return __rdtsc();
+        }
+#endif
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /**
+     * Record a duration in ticks of the scope clock for a tag on the calling thread
+     */
+    static void record(uint32_t tag, uint64_t ticks);
+
+    /**
+     * Durations of all tags recorded since the start of the process
+     */
+    static std::vector<TagSummary> summaries();
+
+    /**
+     * Durations of all tags recorded since the last call, tags without scopes in between are
+     * left out
+     *
+     * The maximum of a window is the upper bound of the highest histogram bucket counted.
+     */
+    static std::vector<TagSummary> takeSummaries();
+
+    /**
+     * Publish the statistics of each interval as msg::PerfScopeStats to a topic
+     *
+     * Starts a thread of its own, which runs until stopPublishing() or the end of the process.
+     * Calling it again changes the value store, the interval and the topic. The value store must
+     * outlive publishing.
+     */
+    static void startPublishing(ValueStore& valueStore,
+                                std::chrono::milliseconds interval = std::chrono::seconds(1),
+                                const std::string& topic = "/mcf/stats/scopes");
+
+    static void stopPublishing();
+
+private:
+    // whether now() reads the TSC, fixed at static initialization
+    static const bool fUseTsc;
+};
+
+/**
+ * A tag of MCF_PERF_SCOPE, static per call site
+ */
+class PerfScopeTag {
+public:
+    explicit PerfScopeTag(const char* name) : fId(PerfScopes::registerTag(name)) {}
+
+    uint32_t id() const { return fId; }
+
+private:
+    const uint32_t fId;
+};
+
+/**
+ * Records the time from its construction to its destruction, see MCF_PERF_SCOPE
+ */
+class PerfScope {
+public:
+    explicit PerfScope(const PerfScopeTag& tag) : fTag(tag.id()), fStart(PerfScopes::now()) {}
+
+    ~PerfScope() {
+        PerfScopes::record(fTag, PerfScopes::now() - fStart);
+    }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    const uint32_t fTag;
+    const uint64_t fStart;
+};
+
+} // namespace mcf
+
+#endif // MCF_PERFSCOPE_H
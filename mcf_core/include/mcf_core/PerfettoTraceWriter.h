@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_PERFETTOTRACEWRITER_H
+#define MCF_PERFETTOTRACEWRITER_H
+
+#include "mcf_core/TraceCollector.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Trace sink writing the records of the event generators as a Perfetto protobuf trace
+ *
+ * The trace file can be opened in the Perfetto UI (ui.perfetto.dev) without any conversion. It
+ * holds a process track per trace id and a thread track per component thread, with
+ * - slices of the trigger handler runs and of traceExecutionTime() durations,
+ * - instant events of port writes, reads and peeks, trigger activations, program flow events and
+ *   performance counts,
+ * - flow arrows from each port write to the reads of the written value, matched by value id,
+ * - a counter track per reading component and topic with the number of values written to the
+ *   topic after the value read, i.e. the backlog of a queued port when it reads,
+ * - a track per component with the spans of traceRemoteTransferTime().
+ *
+ * The protobuf messages are encoded by the writer itself, no Perfetto library is needed. Like
+ * CtfTraceWriter, events are held back for a reorder window, so that slices are written in time
+ * order and reads can be matched with writes recorded by other threads. Events arriving later
+ * than that are written with the time of the last written event and counted, see lateEvents().
+ *
+ * Records are written on the thread of the TraceCollector, see ITraceSink::consume().
+ */
+class PerfettoTraceWriter : public ITraceSink {
+public:
+    /**
+     * Create the trace file
+     *
+     * Throws std::runtime_error if the file cannot be created.
+     *
+     * @param filename       the trace file, by convention with the extension .perfetto-trace
+     * @param reorderWindow  the time events are held back for ordering them by time
+     */
+    explicit PerfettoTraceWriter(const std::string& filename,
+                                 std::chrono::microseconds reorderWindow = std::chrono::seconds(1));
+
+    ~PerfettoTraceWriter() override;
+
+    PerfettoTraceWriter(const PerfettoTraceWriter&) = delete;
+    PerfettoTraceWriter& operator=(const PerfettoTraceWriter&) = delete;
+
+    void consume(const TraceRecord* records, size_t count) override;
+
+    /**
+     * Write the held back events and close the file, records consumed later are ignored
+     */
+    void close();
+
+    /// number of track events written, including counter values
+    uint64_t eventsWritten() const;
+
+    /// number of events written with a corrected time, see the class description
+    uint64_t lateEvents() const;
+
+    /// number of flow arrows from port writes to port reads
+    uint64_t flowsWritten() const;
+
+private:
+    enum class EventKind : uint8_t { OTHER, WRITE, READ };
+
+    // slice ends and instants at the same time are ordered as recorded, slice begins after them,
+    // outer slices first
+    struct EventKey {
+        uint64_t time;
+        uint8_t rank;
+        uint64_t order;
+
+        bool operator<(const EventKey& other) const
+        {
+            return std::tie(time, rank, order) < std::tie(other.time, other.rank, other.order);
+        }
+    };
+
+    struct Event {
+        EventKind kind = EventKind::OTHER;
+        uint32_t type = 0;              // TrackEvent.Type
+        uint64_t track = 0;
+        std::string name;
+        std::string topic;
+        uint64_t valueId = 0;
+        uint64_t counterValue = 0;
+        std::vector<std::pair<const char*, uint64_t>> counts;
+        std::vector<uint64_t> flowIds;
+        std::vector<uint64_t> terminatingFlowIds;
+        // the topic of writes and reads, and the backlog track of reads
+        uint64_t topicKey = 0;
+        uint64_t backlogTrack = 0;
+    };
+
+    // the value ids of the recent writes to a topic, numbered in write order
+    struct TopicWrites {
+        uint64_t written = 0;
+        std::unordered_map<uint64_t, uint64_t> sequences;
+        std::deque<uint64_t> valueIds;
+    };
+
+    using LinkKey = std::pair<uint64_t, uint64_t>;     // value id, topic key
+
+    // called with fMutex held
+    Event& addEvent(uint64_t time, uint32_t type, uint64_t track, std::string name);
+    void addPortEvent(EventKind kind, const char* prefix, const TraceRecord& record);
+    void link(Event& write, Event& read);
+    void writeEvents(uint64_t maxTime);
+    void writeEvent(uint64_t time, const Event& event);
+    void writePacket(std::string packet);
+    uint64_t processTrack(uint32_t traceId);
+    uint64_t threadTrack(const TraceRecord& record);
+    uint64_t transferTrack(const TraceRecord& record);
+    uint64_t backlogTrack(const TraceRecord& record);
+    uint64_t childTrack(uint32_t traceId, const std::string& name, bool counter);
+    const std::string& plain(uint32_t string);
+
+    mutable std::mutex fMutex;
+    std::ofstream fStream;
+    const uint64_t fReorderWindow;
+    std::map<EventKey, Event> fPending;
+    uint64_t fNextSequence = 0;
+    uint64_t fLatestTime = 0;
+    uint64_t fLastWrittenTime = 0;
+    uint64_t fEventsWritten = 0;
+    uint64_t fLateEvents = 0;
+    uint64_t fFlowsWritten = 0;
+    bool fFirstPacket = true;
+    bool fClosed = false;
+    // pending writes and reads not matched yet, see link()
+    std::map<LinkKey, Event*> fPendingWrites;
+    std::map<LinkKey, std::vector<Event*>> fPendingReads;
+    std::unordered_map<uint64_t, TopicWrites> fTopicWrites;
+    uint64_t fNextUuid = 1;
+    std::map<uint32_t, uint64_t> fProcessTracks;
+    std::map<std::pair<uint32_t, int32_t>, uint64_t> fThreadTracks;
+    std::map<std::pair<uint32_t, uint32_t>, uint64_t> fTransferTracks;
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, uint64_t> fBacklogTracks;
+    std::unordered_map<uint32_t, std::string> fPlainStrings;
+};
+
+} // namespace mcf
+
+#endif // MCF_PERFETTOTRACEWRITER_H
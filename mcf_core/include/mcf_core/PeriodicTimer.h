@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_PERIODICTIMER_H
+#define MCF_PERIODICTIMER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mcf {
+
+class EventFlag;
+
+/**
+ * A timer activating an event flag periodically, see Component::registerPeriodicHandler()
+ *
+ * Expiries are aligned to the monotonic clock: the timer expires at phase + k * period for
+ * integer k, so timers with the same period and phase expire together, in all components.
+ */
+class PeriodicTimer {
+public:
+    /**
+     * @param period    the period, must be > 0
+     * @param phase     the offset of the expiries from the multiples of the period
+     * @param flag      the event flag to activate on expiry
+     * @param name      the name of the timer, reported as the topic of its activations
+     */
+    PeriodicTimer(std::chrono::nanoseconds period,
+                  std::chrono::nanoseconds phase,
+                  std::shared_ptr<EventFlag> flag,
+                  std::string name);
+
+    std::chrono::nanoseconds getPeriod() const {
+        return fPeriod;
+    }
+
+    std::chrono::nanoseconds getPhase() const {
+        return fPhase;
+    }
+
+    const std::string& getName() const {
+        return fName;
+    }
+
+    /**
+     * Number of periods elapsed while the timer was armed
+     */
+    uint64_t getExpirations() const {
+        return fExpirations.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of expirations which did not lead to a handler run of their own
+     *
+     * Counts expirations while the handler had not yet run for the previous one, as well as
+     * periods missed entirely due to a late timer thread.
+     */
+    uint64_t getOverruns() const {
+        return fOverruns.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * The first expiry after the given time of the monotonic clock, in ns
+     */
+    int64_t nextExpiry(int64_t nowNs) const;
+
+private:
+    friend class PeriodicTimerService;
+
+    /**
+     * Account for the expirations up to now and activate the event flag
+     */
+    void expire(uint64_t expirations);
+
+    const std::chrono::nanoseconds fPeriod;
+    const std::chrono::nanoseconds fPhase;
+    const std::shared_ptr<EventFlag> fFlag;
+    const std::string fName;
+    std::atomic<uint64_t> fExpirations{0};
+    std::atomic<uint64_t> fOverruns{0};
+    // next expiry in ns of the monotonic clock, accessed by the service only
+    int64_t fNext = 0;
+};
+
+
+/**
+ * A thread serving any number of periodic timers, based on timerfd
+ *
+ * The thread sleeps until the earliest expiry of its timers, using an absolute expiry time, so
+ * that the periods do not drift. Expiring timers only activate event flags, handlers run on
+ * the threads of their components.
+ */
+class PeriodicTimerService {
+public:
+    PeriodicTimerService();
+
+    ~PeriodicTimerService();
+
+    PeriodicTimerService(const PeriodicTimerService&) = delete;
+    PeriodicTimerService& operator=(const PeriodicTimerService&) = delete;
+
+    /**
+     * The service shared by all components, created on first use and stopped when unused
+     */
+    static std::shared_ptr<PeriodicTimerService> shared();
+
+    /**
+     * Arm a timer, starting at its next expiry from now, adding an armed timer has no effect
+     */
+    void add(const std::shared_ptr<PeriodicTimer>& timer);
+
+    /**
+     * Disarm a timer, the timer may still expire once while this call is in progress
+     */
+    void remove(const std::shared_ptr<PeriodicTimer>& timer);
+
+    /**
+     * Call a function once after a delay
+     *
+     * The function is called on the service thread, it must return quickly, e.g. by posting the
+     * actual work to a component, see IComponent::postAfter().
+     */
+    void addOneShot(std::chrono::nanoseconds delay, std::function<void()> callback);
+
+private:
+    void run();
+
+    /**
+     * Set the timerfd to the earliest expiry of fTimers, fMutex must be locked
+     */
+    void arm();
+
+    /**
+     * Wake the service thread to re-evaluate its timers
+     */
+    void wake();
+
+    std::mutex fMutex;
+    std::vector<std::shared_ptr<PeriodicTimer>> fTimers;
+    // expiry in ns of the monotonic clock and callback of the one-shot timers
+    std::vector<std::pair<int64_t, std::function<void()>>> fOneShots;
+    int fTimerFd;
+    int fWakeFd;
+    std::atomic<bool> fStopRequest{false};
+    std::thread fThread;
+};
+
+} // namespace mcf
+
+#endif // MCF_PERIODICTIMER_H
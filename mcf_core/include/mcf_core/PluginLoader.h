@@ -6,12 +6,48 @@
 
 #include "mcf_core/Plugin.h"
 
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <iostream>
 
 namespace mcf
 {
+/**
+ * @brief The contents of a plugin DSO, needed to register its component types without loading it
+ */
+struct PluginManifest
+{
+    /// Path to plugin file
+    std::string filePath;
+
+    /// Name of the plugin
+    std::string name;
+
+    /// Qualified names of the component types of the plugin
+    std::vector<std::string> typeNames;
+};
+
+/**
+ * @brief The time spent loading a plugin DSO
+ */
+struct PluginLoadTime
+{
+    /// Path to plugin file
+    std::string filePath;
+
+    /// dlopen(), i.e. mapping the DSO, the relocations and its static initializers
+    std::chrono::nanoseconds open{0};
+
+    /// the entry point of the plugin creating its component types
+    std::chrono::nanoseconds initialize{0};
+
+    /// whether the DSO was loaded on the first creation of one of its components
+    bool deferred = false;
+};
+
 class PluginLoader
 {
 
@@ -32,6 +68,53 @@ public:
      */
     Plugin load(const std::string& fileName);
 
+    /**
+     * @brief Loads plugins from multiple shared objects in parallel, see load()
+     *
+     * The shared objects are opened on the threads of parallelFor(), so that reading the files and
+     * running their static initializers overlap. The load times are logged per plugin.
+     *
+     * @param fileNames The names of the shared object files
+     * @return The plugins in the order of the file names
+     */
+    std::vector<Plugin> loadAll(const std::vector<std::string>& fileNames);
+
+    /**
+     * @brief Creates a plugin from its manifest, the shared object is loaded on first use
+     *
+     * The component types of the returned plugin load the shared object with RTLD_LAZY when the
+     * first component of any of them is created, so that plugins which are not used by a system
+     * cost no startup time. A PluginError is thrown by the component creation if the shared object
+     * cannot be loaded or does not contain the type.
+     *
+     * @param manifest The plugin file, its name and its component types, see manifest()
+     * @return A Plugin object that contains component factories.
+     */
+    Plugin loadDeferred(const PluginManifest& manifest);
+
+    /**
+     * @brief The manifest of a loaded plugin, to be stored with writeManifests()
+     */
+    static PluginManifest manifest(const std::string& fileName, const Plugin& plugin);
+
+    /**
+     * @brief Reads plugin manifests from a JSON file
+     *
+     * The file has the form `{"plugins": [{"file": "...", "name": "...", "types": ["..."]}]}`.
+     * Throws a PluginError if the file cannot be read.
+     */
+    static std::vector<PluginManifest> readManifests(const std::string& fileName);
+
+    /**
+     * @brief Writes plugin manifests to a JSON file, see readManifests()
+     */
+    static void writeManifests(const std::string& fileName, const std::vector<PluginManifest>& manifests);
+
+    /**
+     * @brief The load times of the plugins loaded by this object, in the order of loading
+     */
+    std::vector<PluginLoadTime> loadTimes() const;
+
     /**
      * @brief Destroy the Plugin Loader object
      *
@@ -53,9 +136,32 @@ private:
         Plugin plugin;
     };
 
+    // a plugin loaded on the first creation of one of its components
+    struct DeferredPlugin;
+
+    // a shared object opened and initialized, not registered yet
+    struct OpenedPlugin
+    {
+        void* handle = nullptr;
+        Plugin plugin{"", {}};
+        PluginLoadTime loadTime;
+    };
+
     /// Plugin information
     std::vector<PluginDescriptor> _pluginDescs;
 
+    std::vector<std::shared_ptr<DeferredPlugin>> _deferredPlugins;
+
+    std::vector<PluginLoadTime> _loadTimes;
+
+    /// Guards the members, deferred plugins are loaded by the threads creating components
+    mutable std::mutex _mutex;
+
+    static OpenedPlugin open(const std::string& fileName, int mode);
+
+    // called with _mutex held
+    void unloadPrevious(const std::string& fileName);
+
     static void unloadHandle(void* handle);
 
 };
@@ -46,6 +46,18 @@ public:
      */
     std::vector<ComponentProxy> reloadPlugin(const std::string& pluginName);
 
+    /**
+     * @brief Reloads the running components instantiated from a plugin without dropping the
+     * values sent to them meanwhile, see ComponentInstantiator::hotReloadComponent()
+     *
+     * @param pluginName The name of the plugin
+     * @param transferState Optional hand over of the state of each previous instance
+     * @return The ComponentProxy objects of the new instances
+     */
+    std::vector<ComponentProxy> hotReloadPlugin(
+        const std::string& pluginName,
+        const ComponentManager::StateTransfer& transferState = nullptr);
+
     /**
      * @brief Removes the plugin and all components that have been instantiated in it.
      * 
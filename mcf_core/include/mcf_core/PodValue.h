@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_PODVALUE_H
+#define MCF_PODVALUE_H
+
+#include "msgpack.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace mcf {
+
+/**
+ * POD wire format of generated value types consisting of numbers, bools and enums only, selected
+ * per type with "Pod": true in its type definition
+ *
+ * A value is packed as a single msgpack bin of fixed size: a uint64 hash of the type name and
+ * layout, followed by the attributes at offsets computed by the types generator, each aligned to
+ * its size (bools as uint8, enums as int32). All numbers are little endian. Packing and unpacking
+ * copy the attributes with memcpy, without any per attribute msgpack encoding. A receiver with a
+ * different layout of the type rejects the value because of the mismatching hash.
+ */
+namespace pod {
+
+/// size of the layout hash in front of the attributes
+constexpr std::size_t HEADER_SIZE = 8;
+
+/**
+ * Builds the bin of a POD packed value with attributes of the passed size
+ */
+template<std::size_t Size>
+class Writer {
+public:
+    explicit Writer(uint64_t layoutHash) : fBuffer{} {
+        std::memcpy(fBuffer.data(), &layoutHash, HEADER_SIZE);
+    }
+
+    template<typename T>
+    void put(std::size_t offset, T value) {
+        static_assert(std::is_arithmetic<T>::value, "POD attributes are numbers");
+        std::memcpy(fBuffer.data() + HEADER_SIZE + offset, &value, sizeof(T));
+    }
+
+    /**
+     * Packs the built value as msgpack bin
+     */
+    template<typename Packer>
+    void pack(Packer& packer) const {
+        packer.pack_bin(static_cast<uint32_t>(fBuffer.size()));
+        packer.pack_bin_body(fBuffer.data(), static_cast<uint32_t>(fBuffer.size()));
+    }
+
+private:
+    std::array<char, HEADER_SIZE + Size> fBuffer;
+};
+
+/**
+ * Reads the attributes of a POD packed value, the bin must outlive the reader
+ *
+ * Throws msgpack::type_error if the object is no bin of the expected size and layout hash, like
+ * the unpacking of any other mismatching msgpack object.
+ */
+class Reader {
+public:
+    Reader(const msgpack::object& object, uint64_t layoutHash, std::size_t size) {
+        if (object.type != msgpack::type::BIN || object.via.bin.size != HEADER_SIZE + size) {
+            throw msgpack::type_error();
+        }
+        uint64_t hash;
+        std::memcpy(&hash, object.via.bin.ptr, HEADER_SIZE);
+        if (hash != layoutHash) {
+            throw msgpack::type_error();
+        }
+        fData = object.via.bin.ptr + HEADER_SIZE;
+    }
+
+    template<typename T>
+    T get(std::size_t offset) const {
+        T result;
+        std::memcpy(&result, fData + offset, sizeof(T));
+        return result;
+    }
+
+private:
+
+    const char* fData;
+};
+
+/**
+ * Tells whether T is a generated type packed in the POD format, i.e. it defines POD_SIZE
+ */
+template<typename T, typename = void>
+struct IsPod : std::false_type {};
+
+template<typename T>
+struct IsPod<T, decltype(void(T::POD_SIZE))> : std::true_type {};
+
+constexpr std::size_t binSize(std::size_t size) {
+    return size + (size < 256 ? 2 : (size < 65536 ? 3 : 5));
+}
+
+/**
+ * Size of the msgpack bin of a POD packed T, 0 if T is not packed in the POD format
+ */
+template<typename T, typename = void>
+struct PackedSize : std::integral_constant<std::size_t, 0> {};
+
+template<typename T>
+struct PackedSize<T, typename std::enable_if<IsPod<T>::value>::type>
+: std::integral_constant<std::size_t, binSize(HEADER_SIZE + T::POD_SIZE)> {};
+
+} // namespace pod
+
+} // namespace mcf
+
+#endif // MCF_PODVALUE_H
@@ -10,12 +10,21 @@
 #include "mcf_core/Messages.h"
 #include "mcf_core/IComponent.h"
 #include "mcf_core/ComponentTraceEventGenerator.h"
+#include "mcf_core/TracePolicy.h"
+#include "mcf_core/LineageTracker.h"
 #include "mcf_core/PortTriggerHandler.h"
 #include "mcf_core/LoggingMacros.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/Numa.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <iterator>
 #include <thread>
 #include <memory>
+#include <vector>
 
 namespace mcf {
 
@@ -24,8 +33,10 @@ class ComponentManager;
 namespace detail
 {
 /**
- * @brief Control if port access should be synchronized
+ * @brief Control if changes of the port configuration should be synchronized
  *
+ * Covers connecting, remapping and registering handlers. Value accesses never lock, they read
+ * the connection state published by these changes, see Port::ConnectionState.
  */
 constexpr bool synchronizePorts = true;
 template <typename Mutex>
@@ -36,13 +47,72 @@ struct NullLock
 
 template <typename Mutex>
 using Lock = std::conditional_t<synchronizePorts, std::lock_guard<Mutex>, NullLock<Mutex>>;
+
+/**
+ * Receives the next value of a topic once, see ReceiverPort::next()
+ *
+ * The continuation is posted to the component, with the value or with nullptr on timeout.
+ * Whichever comes first completes the receiver, later completions have no effect.
+ */
+template<typename T>
+class NextValueReceiver : public IValueReceiver, public std::enable_shared_from_this<NextValueReceiver<T>> {
+public:
+    using Continuation = std::function<void(std::shared_ptr<const T>)>;
+
+    NextValueReceiver(IComponent& component, ValueStore& valueStore, std::string key, Continuation continuation)
+    : fComponent(component)
+    , fValueStore(valueStore)
+    , fKey(std::move(key))
+    , fContinuation(std::move(continuation))
+    {}
+
+    void receive(const std::string& topic, ValuePtr& value) override {
+        complete(castQueuedValue<T>(value));
+    }
+
+    void complete(std::shared_ptr<const T> value) {
+        if (fDone.exchange(true)) {
+            return;
+        }
+        auto self = this->shared_from_this();
+        fComponent.post([self, value]() {
+            if (!self->fCancelled) {
+                self->fValueStore.removeReceiver(self->fKey, self);
+                self->fContinuation(value);
+            }
+        });
+    }
+
+    /**
+     * Drop the receiver without calling the continuation, e.g. when its port disconnects
+     */
+    void cancel() {
+        fCancelled = true;
+        fDone = true;
+        fValueStore.removeReceiver(fKey, this->shared_from_this());
+    }
+
+    bool isDone() const {
+        return fDone;
+    }
+
+private:
+    IComponent& fComponent;
+    ValueStore& fValueStore;
+    const std::string fKey;
+    Continuation fContinuation;
+    std::atomic<bool> fDone{false};
+    std::atomic<bool> fCancelled{false};
+};
 } // namespace detail
 
 class Port {
 public:
     explicit Port(IComponent& component, std::string name)
     : fComponent(component), fValueStore(nullptr), fName(std::move(name)), fConnected(false)
-    {}
+    {
+        publishState();
+    }
 
     /**
      * @brief Move constructor
@@ -64,8 +134,11 @@ public:
     : fComponent(port.fComponent)
     , fValueStore(port.fValueStore)
     , fKey(std::move(port.fKey))
+    , fTopicHandle(port.fTopicHandle)
     , fName(std::move(port.fName))
     , fConnected(port.fConnected.load())
+    , fStates(std::move(port.fStates))
+    , fState(port.fState.load())
     {
     }
 
@@ -101,8 +174,7 @@ public:
     }
 
     std::string getTopic() const {
-        detail::Lock<std::mutex> lk(fMutex);
-        return fKey;
+        return connectionState().key;
     }
 
     std::string getName() const {
@@ -127,21 +199,48 @@ public:
 protected:
     friend ComponentManager;
 
+    /**
+     * Connection state of a port, published as an immutable snapshot on every change
+     *
+     * Value accesses read the current snapshot with a single atomic load instead of locking
+     * fMutex, so that remapping a port at runtime is safe while its component accesses it.
+     * Snapshots are kept until the port is destroyed, as a concurrent access may still use a
+     * replaced one. Equal snapshots are reused, so remapping back and forth does not accumulate.
+     */
+    struct ConnectionState {
+        ValueStore* valueStore = nullptr;
+        std::string key;
+        ValueStore::TopicHandle topicHandle;
+        bool connected = false;
+    };
+
+    /**
+     * The current connection state, lock-free
+     */
+    const ConnectionState& connectionState() const {
+        return *fState.load(std::memory_order_acquire);
+    }
+
     virtual std::type_index getTypeIndex() = 0;
 
     virtual void setup(ValueStore& valueStore) {
         detail::Lock<std::mutex> lk(fMutex);
         fValueStore = &valueStore;
+        publishState();
     }
 
     virtual void connectUnsafe() {
         if (fValueStore != nullptr) {
+            // resolve the topic once, value accesses of connected ports use the handle
+            fTopicHandle = fValueStore->getTopicHandle(fKey);
             fConnected = true;
+            publishState();
         }
     }
 
     virtual void disconnectUnsafe() {
         fConnected = false;
+        publishState();
     }
 
     void mapToTopic(const std::string& topic) {
@@ -154,6 +253,31 @@ protected:
         if (wasConnected) {
             connectUnsafe();
         }
+        else {
+            publishState();
+        }
+    }
+
+    /**
+     * Publish the members below as the connection state, with fMutex locked
+     */
+    void publishState() {
+        auto sameState = [this](const std::unique_ptr<const ConnectionState>& state) {
+            return state->valueStore == fValueStore && state->key == fKey && state->connected == fConnected
+                && state->topicHandle.valid() == fTopicHandle.valid()
+                && (!fTopicHandle.valid() || &state->topicHandle.topic() == &fTopicHandle.topic());
+        };
+        auto it = std::find_if(fStates.begin(), fStates.end(), sameState);
+        if (it == fStates.end()) {
+            auto state = std::make_unique<ConnectionState>();
+            state->valueStore = fValueStore;
+            state->key = fKey;
+            state->topicHandle = fTopicHandle;
+            state->connected = fConnected;
+            fStates.push_back(std::move(state));
+            it = std::prev(fStates.end());
+        }
+        fState.store(it->get(), std::memory_order_release);
     }
 
     virtual void setComponentTraceEventGenerator(
@@ -165,6 +289,7 @@ protected:
     IComponent& fComponent;
     ValueStore* fValueStore;
     std::string fKey;
+    ValueStore::TopicHandle fTopicHandle;
     std::string fName;
     std::atomic<bool> fConnected;
     std::shared_ptr<ComponentTraceEventGenerator> fComponentTraceEventGenerator = nullptr;
@@ -173,6 +298,10 @@ protected:
      * As long as the mutex is locked, the inner state cannot be changed in a different thread.
      */
     mutable std::mutex fMutex;
+
+private:
+    std::vector<std::unique_ptr<const ConnectionState>> fStates;
+    std::atomic<const ConnectionState*> fState{nullptr};
 };
 
 class GenericReceiverPort : public Port {
@@ -192,10 +321,30 @@ public:
      * and register it with all the ports.
      */
     void registerHandler(const std::function<void()>& handler) {
-        registerHandler(std::make_shared<PortTriggerHandler>(handler, "",
+        registerHandler(std::make_shared<PortTriggerHandler>(handler, getName(),
                                                              getComponent().getComponentTraceEventGenerator()));
     }
 
+    /*
+     * Register a handler with options, e.g. to let it run concurrently with the other handlers
+     * of the component, see PortTriggerHandlerOptions
+     */
+    void registerHandler(const std::function<void()>& handler, const PortTriggerHandlerOptions& options) {
+        registerHandler(std::make_shared<PortTriggerHandler>(handler, getName(),
+                                                             getComponent().getComponentTraceEventGenerator(),
+                                                             options));
+    }
+
+    /*
+     * Register a handler which runs before lower priority handlers of the component that are
+     * ready at the same time, see PortTriggerHandlerOptions::priority
+     */
+    void registerHandler(const std::function<void()>& handler, int priority) {
+        PortTriggerHandlerOptions options;
+        options.priority = priority;
+        registerHandler(handler, options);
+    }
+
     /*
      * Register a handler which will be called when the port receives a value.
      *
@@ -209,13 +358,20 @@ public:
      */
     void registerHandler(std::shared_ptr<PortTriggerHandler> handler) {
         detail::Lock<std::mutex> lk(fMutex);
+        auto queue = getHandlerQueue();
         if (fHandler != nullptr) {
             fComponent.unregisterHandler(fHandler);
             if (fValueStore != nullptr && isConnected()) {
                 fValueStore->removeReceiver(fKey, fHandler->getEventFlag());
             }
+            if (queue) {
+                fHandler->removeQueue(queue);
+            }
         }
         fHandler = std::move(handler);
+        if (queue) {
+            fHandler->addQueue(queue);
+        }
         fComponent.registerHandler(fHandler);
         if (fValueStore != nullptr && isConnected()) {
             fValueStore->addReceiver(fKey, fHandler->getEventFlag());
@@ -227,6 +383,32 @@ public:
     }
 
 protected:
+    /**
+     * The queue whose values the handler processes, see PortTriggerHandler::addQueue()
+     */
+    virtual std::shared_ptr<ValueQueue> getHandlerQueue() const {
+        return nullptr;
+    }
+
+    /**
+     * Let the handler process queue instead of previous, with fMutex locked
+     */
+    void replaceHandlerQueue(const std::shared_ptr<ValueQueue>& previous, const std::shared_ptr<ValueQueue>& queue) {
+        if (fHandler != nullptr) {
+            fHandler->removeQueue(previous);
+            fHandler->addQueue(queue);
+        }
+    }
+
+    /**
+     * Activate the handler without a value, e.g. for values queued before it was connected
+     */
+    void activateHandler() {
+        if (fHandler != nullptr) {
+            fHandler->getEventFlag()->activate(fKey);
+        }
+    }
+
     void connectUnsafe() override {
         Port::connectUnsafe();
         if (fValueStore != nullptr && fHandler != nullptr) {
@@ -243,17 +425,17 @@ protected:
 
 protected:
 
-    void tracePortPeek(const Value* vp) const {
-        if (fComponentTraceEventGenerator)
+    void tracePortPeek(const ConnectionState& state, const Value* vp) const {
+        if (TracePolicy::active() && fComponentTraceEventGenerator)
         {
-            fComponentTraceEventGenerator->tracePeekPortValue(fKey, fConnected, vp);
+            fComponentTraceEventGenerator->tracePeekPortValue(state.key, state.connected, vp);
         }
     }
 
-    void tracePortAccess(const Value* vp) const {
-        if (fComponentTraceEventGenerator)
+    void tracePortAccess(const ConnectionState& state, const Value* vp) const {
+        if (TracePolicy::active() && fComponentTraceEventGenerator)
         {
-            fComponentTraceEventGenerator->traceGetPortValue(fKey, fConnected, vp);
+            fComponentTraceEventGenerator->traceGetPortValue(state.key, state.connected, vp);
         }
     }
 
@@ -273,8 +455,7 @@ public:
      * Returns true if a value as ever been received.
      */
     bool hasValue() const {
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
+        if (connectionState().connected) {
             return fEventFlag->active();
         }
         else {
@@ -284,14 +465,14 @@ public:
 
     std::shared_ptr<const Value>getValue() const {
         std::shared_ptr<const Value> vp;
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
-            vp = std::move(fValueStore->getValue<Value>(fKey));
+        const ConnectionState& state = connectionState();
+        if (state.connected) {
+            vp = std::move(state.valueStore->getValue<Value>(state.topicHandle));
         }
         else {
-            vp = std::make_shared<const Value>();
+            vp = defaultValue<Value>();
         }
-        tracePortAccess(vp.get());
+        tracePortAccess(state, vp.get());
         return vp;
     }
 protected:
@@ -337,16 +518,63 @@ public:
      */
     std::shared_ptr<const T>getValue() const {
         std::shared_ptr<const T> vp;
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
-            vp = std::move(fValueStore->getValue<T>(fKey));
+        const ConnectionState& state = connectionState();
+        if (state.connected) {
+            vp = std::move(state.valueStore->getValue<T>(state.topicHandle));
         }
         else {
-            vp = std::make_shared<const T>();
+            vp = defaultValue<T>();
         }
-        tracePortAccess(vp.get());
+        tracePortAccess(state, vp.get());
         return vp;
     }
+
+    /**
+     * Call a continuation with the next value received by the port
+     *
+     * The continuation runs on the component thread, like a handler, so that a sequence of
+     * requests and replies can be written as a chain of continuations without blocking the
+     * component. Values received before the call are not considered.
+     *
+     * @param continuation  called with the value, or with nullptr on timeout
+     * @param timeout       the time to wait for the value, 0 waits until the port disconnects,
+     *                      in which case the continuation is not called
+     */
+    void next(std::function<void(std::shared_ptr<const T>)> continuation,
+              std::chrono::nanoseconds timeout = std::chrono::nanoseconds(0)) {
+        std::shared_ptr<detail::NextValueReceiver<T>> receiver;
+        {
+            detail::Lock<std::mutex> lk(fMutex);
+            if (!isConnected()) {
+                MCF_THROW_RUNTIME(fmt::format("Port {} must be connected to wait for its next value", fName));
+            }
+            fPending.erase(std::remove_if(fPending.begin(), fPending.end(),
+                                          [](const std::shared_ptr<detail::NextValueReceiver<T>>& r) {
+                                              return r->isDone();
+                                          }),
+                           fPending.end());
+            receiver = std::make_shared<detail::NextValueReceiver<T>>(
+                fComponent, *fValueStore, fKey, std::move(continuation));
+            fPending.push_back(receiver);
+            fValueStore->addReceiver(fKey, receiver);
+        }
+        if (timeout.count() > 0) {
+            fComponent.postAfter(timeout, [receiver]() { receiver->complete(nullptr); });
+        }
+    }
+
+protected:
+    void disconnectUnsafe() override {
+        for (const auto& receiver : fPending) {
+            receiver->cancel();
+        }
+        fPending.clear();
+        GenericNonQueuedReceiverPort::disconnectUnsafe();
+    }
+
+private:
+    // receivers of next(), cancelled on disconnect
+    std::vector<std::shared_ptr<detail::NextValueReceiver<T>>> fPending;
 };
 
 
@@ -361,15 +589,46 @@ public:
      *  queueSize   the maximum length of the queue, 0 means infinite
      *  blocking    if true, a sender on the same topic will
      *              block as long as the queue is full
+     *  storage     the storage of the queue, see ValueQueue::Storage
+     *              (RING_BUFFER requires queueSize > 0)
      */
-    GenericQueuedReceiverPort(IComponent& component, const std::string& name, size_t queueSize, bool blocking=false) :
+    GenericQueuedReceiverPort(IComponent& component, const std::string& name, size_t queueSize, bool blocking=false,
+                              ValueQueue::Storage storage=ValueQueue::Storage::DYNAMIC) :
         GenericReceiverPort(component, name),
-        fQueue(std::make_shared<mcf::ValueQueue>(queueSize, blocking))
+        fQueue(std::make_shared<mcf::ValueQueue>(queueSize, blocking, storage))
     {}
 
+    /**
+     * Construct a queued receiver port with a conflating queue, see ValueQueue::Storage::CONFLATING
+     *
+     * Arguments:
+     *
+     *  component     the component this port is part of
+     *  conflationKey function extracting the key of a value, only the newest value per key is kept
+     *  queueSize     the maximum number of distinct keys in the queue, 0 means infinite
+     *  blocking      if true, a sender on the same topic will
+     *                block as long as the queue is full
+     */
+    GenericQueuedReceiverPort(IComponent& component, const std::string& name,
+                              ValueQueue::ConflationKey conflationKey, size_t queueSize=0,
+                              bool blocking=false) :
+        GenericReceiverPort(component, name),
+        fQueue(std::make_shared<mcf::ValueQueue>(std::move(conflationKey), queueSize, blocking))
+    {}
+
+    /**
+     * Move constructor, see Port::Port(Port&&)
+     */
+    GenericQueuedReceiverPort(GenericQueuedReceiverPort&& port) noexcept
+    : GenericReceiverPort(std::move(port))
+    , fQueue(std::move(port.fQueue))
+    , fDeadlineNs(port.fDeadlineNs.load())
+    {
+    }
+
     bool hasValue() const {
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
+        if (connectionState().connected) {
+            dropStale();
             return !fQueue->empty();
         }
         else {
@@ -378,8 +637,8 @@ public:
     }
 
     size_t getQueueSize() const {
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
+        if (connectionState().connected) {
+            dropStale();
             return fQueue->size();
         }
         else {
@@ -389,30 +648,67 @@ public:
 
     std::shared_ptr<const Value>peekValue() const {
         std::shared_ptr<const Value> vp;
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
+        const ConnectionState& state = connectionState();
+        if (state.connected) {
+            dropStale();
             vp = std::move(fQueue->peek<Value>());
         }
         else {
-            vp = std::make_shared<const Value>();
+            vp = defaultValue<Value>();
         }
-        tracePortPeek(vp.get());
+        tracePortPeek(state, vp.get());
         return vp;
     }
 
     std::shared_ptr<const Value>getValue() const {
         std::shared_ptr<const Value> vp;
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
+        const ConnectionState& state = connectionState();
+        if (state.connected) {
             vp = std::move(fQueue->pop<Value>());
         }
         else {
-            vp = std::make_shared<const Value>();
+            vp = defaultValue<Value>();
         }
-        tracePortAccess(vp.get());
+        tracePortAccess(state, vp.get());
         return vp;
     }
 
+    /**
+     * Sequence number of the write of the value a preceding peekValue() returned, 0 if the port
+     * is not connected or the queue is empty, see ValueQueue::peekSequence()
+     */
+    uint64_t peekSequence() const {
+        return connectionState().connected ? fQueue->peekSequence() : 0;
+    }
+
+    /**
+     * Pop up to maxCount values (all queued values if maxCount is 0) at once
+     *
+     * Takes the queue lock once per batch and emits a single trace event for the newest
+     * value of the batch. Returns an empty vector if the port is not connected or the queue is empty.
+     */
+    std::vector<std::shared_ptr<const Value>> getValues(size_t maxCount=0) const {
+        std::vector<std::shared_ptr<const Value>> values;
+        popValues(values, maxCount);
+        return values;
+    }
+
+    /**
+     * Pop up to maxCount values like getValues() and call callback for each of them in queue order
+     *
+     * The callback is called without the port lock held, so it may access the port.
+     *
+     * @return the number of values passed to callback
+     */
+    template<typename Callback>
+    size_t drain(Callback&& callback, size_t maxCount=0) const {
+        const auto values = getValues(maxCount);
+        for (const auto& value : values) {
+            callback(value);
+        }
+        return values.size();
+    }
+
     bool getBlocking() {
         return fQueue->getBlocking();
     }
@@ -429,12 +725,97 @@ public:
         fQueue->setMaxLength(maxLength);
     }
 
+    /**
+     * Let the queue adjust its maximum length to the observed rates, see
+     * ValueQueue::enableAdaptiveLength()
+     *
+     * The changes are published with the handler statistics of the component if a handler is
+     * registered with the port, see msg::HandlerStats.
+     */
+    void setAdaptiveQueueLength(const ValueQueue::AdaptiveLength& adaptive) {
+        fQueue->enableAdaptiveLength(adaptive);
+    }
+
+    /**
+     * The queue of the port, e.g. for accounting the memory held by its values
+     */
+    std::shared_ptr<ValueQueue> getQueue() const {
+        return fQueue;
+    }
+
+    /**
+     * Take over the queue of previous, the port of a component instance this one replaces, see
+     * ComponentManager::replaceComponent()
+     *
+     * The queue stays registered with the value store, so that the values received while the
+     * components are swapped are not lost, and the handler of this port processes the values
+     * queued for previous first. The queue takes the length and blocking flag of this port.
+     * previous is left disconnected with the unused queue of this port. Neither component may
+     * run meanwhile.
+     *
+     * @return false if this port is connected already, previous is not connected or the ports
+     *         differ in topic or queue storage. Both ports are left unchanged then.
+     */
+    bool takeOverQueue(GenericQueuedReceiverPort& previous) {
+        detail::Lock<std::mutex> previousLock(previous.fMutex);
+        detail::Lock<std::mutex> lk(fMutex);
+        if (fConnected || !previous.fConnected || fValueStore != previous.fValueStore || fKey != previous.fKey
+            || fQueue->getStorage() != previous.fQueue->getStorage()) {
+            return false;
+        }
+        std::shared_ptr<ValueQueue> queue = previous.fQueue;
+        // only the trigger of previous is removed, the queue keeps receiving
+        previous.GenericReceiverPort::disconnectUnsafe();
+        queue->setMaxLength(fQueue->getMaxLength());
+        queue->setBlocking(fQueue->getBlocking());
+        previous.replaceHandlerQueue(queue, fQueue);
+        replaceHandlerQueue(fQueue, queue);
+        std::swap(fQueue, previous.fQueue);
+        applyQos(fValueStore->getTopicQos().find(fKey));
+        GenericReceiverPort::connectUnsafe();
+        if (!fQueue->empty()) {
+            activateHandler();
+        }
+        return true;
+    }
+
 protected:
+    std::shared_ptr<ValueQueue> getHandlerQueue() const override {
+        return fQueue;
+    }
+
+    template<typename T>
+    void popValues(std::vector<std::shared_ptr<const T>>& values, size_t maxCount) const {
+        const ConnectionState& state = connectionState();
+        if (state.connected) {
+            dropStale();
+            fQueue->popMany<T>(values, maxCount);
+        }
+        if (!values.empty()) {
+            tracePortAccess(state, values.back().get());
+        }
+    }
+
+    /**
+     * Drop the values waiting longer than the deadline of the QoS profile of the topic, the
+     * newest value is kept in any case
+     *
+     * Called when the queue is inspected, i.e. by hasValue(), getQueueSize(), peekValue() and
+     * getValues(), but not by getValue(), which takes the value a preceding peekValue() returned.
+     */
+    void dropStale() const {
+        const int64_t deadlineNs = fDeadlineNs.load(std::memory_order_relaxed);
+        if (deadlineNs > 0) {
+            fQueue->dropOlderThan(std::chrono::nanoseconds(deadlineNs), 1);
+        }
+    }
+
     void connectUnsafe() override {
         // add queue receiver _before_ trigger event receiver
         // this ensures that the queue entry is already there when the
         // handler gets called
         if (fValueStore != nullptr) {
+            applyQos(fValueStore->getTopicQos().find(fKey));
             fValueStore->addReceiver(fKey, fQueue);
         }
         GenericReceiverPort::connectUnsafe();
@@ -452,14 +833,52 @@ protected:
     }
 
     std::shared_ptr<ValueQueue> fQueue;
+
+private:
+    /**
+     * Take over the queue settings of the QoS profile of the topic, see TopicQos
+     *
+     * Without a profile, the settings of the port are kept.
+     */
+    void applyQos(const std::shared_ptr<const QosProfile>& profile) {
+        if (profile == nullptr) {
+            fDeadlineNs = 0;
+            return;
+        }
+        // a ring buffer cannot be unbounded
+        if (profile->depth > 0 || fQueue->getStorage() != ValueQueue::Storage::RING_BUFFER) {
+            fQueue->setMaxLength(profile->depth);
+        }
+        fQueue->setBlocking(profile->reliability == QosProfile::Reliability::RELIABLE);
+        fDeadlineNs = std::chrono::duration_cast<std::chrono::nanoseconds>(profile->deadline).count();
+    }
+
+    std::atomic<int64_t> fDeadlineNs{0};
 };
 
 
 template<typename T>
 class QueuedReceiverPort : public GenericQueuedReceiverPort {
 public:
-    QueuedReceiverPort(IComponent& component, const std::string& name, size_t queueSize, bool blocking=false) :
-        GenericQueuedReceiverPort(component, name, queueSize, blocking)
+    QueuedReceiverPort(IComponent& component, const std::string& name, size_t queueSize, bool blocking=false,
+                       ValueQueue::Storage storage=ValueQueue::Storage::DYNAMIC) :
+        GenericQueuedReceiverPort(component, name, queueSize, blocking, storage)
+    {}
+
+    /**
+     * Construct a port keeping only the newest value per key, e.g. per object id
+     *
+     * Values received from the topic which are not of type T are queued under key 0.
+     *
+     * @param conflationKey function extracting the key of a value
+     * @param queueSize     the maximum number of distinct keys in the queue, 0 means infinite
+     * @param blocking      if true, a sender on the same topic will block as long as the queue is full
+     */
+    QueuedReceiverPort(IComponent& component, const std::string& name,
+                       std::function<uint64_t(const T&)> conflationKey, size_t queueSize=0,
+                       bool blocking=false) :
+        GenericQueuedReceiverPort(component, name, typedConflationKey(std::move(conflationKey)),
+                                  queueSize, blocking)
     {}
 
     std::type_index getTypeIndex() override {
@@ -469,48 +888,98 @@ public:
     /*
      * Get the next value from the queue. The queue is not modified
      *
-     * Silently creates a default instance of the type T if port is not connected
+     * Silently returns a default instance of the type T if port is not connected
      * or the queue is empty. Call hasValue() to check if there are values.
      */
     std::shared_ptr<const T>peekValue() const {
         std::shared_ptr<const T> vp;
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
+        const ConnectionState& state = connectionState();
+        if (state.connected) {
+            dropStale();
             vp = std::move(fQueue->peek<T>());
         }
         else {
-            vp = std::make_shared<const T>();
+            vp = defaultValue<T>();
         }
-        tracePortPeek(vp.get());
+        tracePortPeek(state, vp.get());
         return vp;
     }
     /*
      * Pop end return the next value from the queue.
      *
-     * Silently creates a default instance of the type T if port is not connected
+     * Silently returns a default instance of the type T if port is not connected
      * or the queue is empty. Call hasValue() to check if there are values.
      */
     std::shared_ptr<const T>getValue() const {
         std::shared_ptr<const T> vp;
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
+        const ConnectionState& state = connectionState();
+        if (state.connected) {
             vp = std::move(fQueue->pop<T>());
         }
         else {
-            vp = std::make_shared<const T>();
+            vp = defaultValue<T>();
         }
-        tracePortAccess(vp.get());
+        tracePortAccess(state, vp.get());
         return vp;
     }
+
+    /*
+     * Pop up to maxCount values (all queued values if maxCount is 0) at once,
+     * see GenericQueuedReceiverPort::getValues()
+     */
+    std::vector<std::shared_ptr<const T>> getValues(size_t maxCount=0) const {
+        std::vector<std::shared_ptr<const T>> values;
+        popValues(values, maxCount);
+        return values;
+    }
+
+    /*
+     * Pop up to maxCount values and call callback for each of them,
+     * see GenericQueuedReceiverPort::drain()
+     */
+    template<typename Callback>
+    size_t drain(Callback&& callback, size_t maxCount=0) const {
+        const auto values = getValues(maxCount);
+        for (const auto& value : values) {
+            callback(value);
+        }
+        return values.size();
+    }
+
+private:
+    static ValueQueue::ConflationKey typedConflationKey(std::function<uint64_t(const T&)> key) {
+        MCF_ASSERT(key, "Conflating queued receiver port requires a conflation key");
+        return [key](const Value& value) -> uint64_t {
+            const T* typed = dynamic_cast<const T*>(&value);
+            return typed != nullptr ? key(*typed) : 0;
+        };
+    }
 };
 
 
+class SenderPortGroup;
+
 class GenericSenderPort : public Port {
 public:
     explicit GenericSenderPort(IComponent& component, const std::string& name) :
         Port(component, name)
     {}
 
+    /**
+     * Move constructor, see Port::Port(Port&&)
+     */
+    GenericSenderPort(GenericSenderPort&& port) noexcept
+    : Port(std::move(port))
+    , fBlockingTimeoutMs(port.fBlockingTimeoutMs.load())
+    , fNumaNode(port.fNumaNode.load())
+    , fSubscriptionCallback(std::move(port.fSubscriptionCallback))
+    {
+    }
+
+    ~GenericSenderPort() override {
+        removeSubscriptionObserver();
+    }
+
     /**
      * Writes a ValuePtr to the topic associated with this Port
      *
@@ -526,36 +995,243 @@ public:
      *         ENOTCONN:  The Port is currently not connected an no value has been written
      *         ECANCELED: The Port has been disconnected while setValue() was in progress. May
      *                    happen independently of whether 'blocking' is set to true or false.
+     *         ETIMEDOUT: vp was not written, because the topic was still blocked when the
+     *                    timeout set by setBlockingTimeout() expired
      */
     int setValue(ValuePtr vp, bool blocking=true, const std::vector<uint64_t>& inputIds = std::vector<uint64_t>()) {
         int retVal = ENOTCONN;
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected())
+        const ConnectionState& state = connectionState();
+        if (state.connected)
         {
-            retVal = fValueStore->setValue(fKey, vp, blocking, [this] { return !isConnected(); });
+            retVal = write(state, vp, blocking);
         }
-        tracePortAccess(vp.get(), inputIds); // TODO: Since ports may block now until receiver queues are ready,
+        tracePortAccess(state, vp.get(), inputIds); // TODO: Since ports may block now until receiver queues are ready,
                                              //       we may want to trace blocking time periods as well
         return retVal;
     }
 
+    /**
+     * Writes a value received from outside of the process, e.g. by a remote link, to the topic
+     * associated with this Port, see ValueStore::injectValue()
+     *
+     * @param origin   The origin of the value and its sequence number there
+     * @return See setValue()
+     */
+    int injectValue(ValuePtr vp, const ValueOrigin& origin, bool blocking=true) {
+        int retVal = ENOTCONN;
+        const ConnectionState& state = connectionState();
+        if (state.connected)
+        {
+            retVal = write(state, vp, blocking, &origin);
+        }
+        tracePortAccess(state, vp.get(), std::vector<uint64_t>());
+        return retVal;
+    }
+
     Direction getDirection() override {
         return sender;
     }
 
     void disconnect() override {
-        disconnectUnsafe();  // atomically sets fConnected to false => no extra mutex needed,
-                             // => any blocked call of setValue() will abort after polling interval
+        // setValue() does not lock fMutex, so this does not wait for a blocked write
+        detail::Lock<std::mutex> lk(fMutex);
+        disconnectUnsafe();
+        // wake a blocked call of setValue(), so that it notices the disconnect and aborts
+        if (fValueStore != nullptr) {
+            fValueStore->wakeBlockedWriters(fTopicHandle);
+        }
+    }
+
+    /**
+     * Wait until the connected topic can be written without blocking, see
+     * ValueStore::waitUnblocked()
+     *
+     * @param checkAbort waiting is aborted when this function returns true
+     * @param deadline   waiting is aborted when this point in time is reached
+     * @return true if the topic is not blocked, false if waiting has been aborted, timed out
+     *         or the port is not connected
+     */
+    bool waitUnblocked(const std::function<bool()>& checkAbort,
+                       std::chrono::steady_clock::time_point deadline
+                           = std::chrono::steady_clock::time_point::max()) {
+        const ConnectionState& state = connectionState();
+        if (!state.connected) {
+            return false;
+        }
+        return state.valueStore->waitUnblocked(
+            state.topicHandle,
+            [this, &checkAbort] { return !isConnected() || checkAbort(); },
+            deadline) && isConnected();
+    }
+
+    /**
+     * Wake the callers of setValue() and waitUnblocked() waiting for the connected topic, so
+     * that they re-evaluate their abort condition
+     */
+    void wakeBlockedWriters() {
+        const ConnectionState& state = connectionState();
+        if (state.valueStore != nullptr && state.topicHandle.valid()) {
+            state.valueStore->wakeBlockedWriters(state.topicHandle);
+        }
+    }
+
+    /**
+     * Limit the time blocking calls of setValue() wait for blocked receivers
+     *
+     * When the timeout expires, setValue() returns ETIMEDOUT without writing the value.
+     *
+     * @param timeout The timeout, zero (default) lets setValue() wait without limit
+     */
+    void setBlockingTimeout(std::chrono::milliseconds timeout) {
+        fBlockingTimeoutMs = timeout.count();
+    }
+
+    std::chrono::milliseconds getBlockingTimeout() const {
+        return std::chrono::milliseconds(fBlockingTimeoutMs.load());
+    }
+
+    /**
+     * Migrate the external memory of sent values to a NUMA node before publishing them
+     *
+     * Set by the ComponentManager, see NumaPlacement::CONSUMER.
+     *
+     * @param node The node, -1 (default) leaves the memory where it was allocated
+     */
+    void setNumaNode(int node) {
+        fNumaNode = node;
+    }
+
+    int getNumaNode() const {
+        return fNumaNode;
+    }
+
+    /**
+     * Whether a value written now reaches anyone, i.e. the connected topic has subscribers (see
+     * ValueStore::hasSubscribers()) or writes of the port are traced
+     *
+     * Lets components skip producing values nobody consumes, e.g. debug images. Always false while
+     * the port is not connected.
+     */
+    bool hasSubscribers() const {
+        const ConnectionState& state = connectionState();
+        if (!state.connected) {
+            return false;
+        }
+        if (TracePolicy::active() && fComponentTraceEventGenerator
+            && fComponentTraceEventGenerator->isTracingPortWrites(state.key)) {
+            return true;
+        }
+        return state.valueStore->hasSubscribers(state.topicHandle);
+    }
+
+    /**
+     * Call callback with the result of hasSubscribers() whenever the subscribers of the connected
+     * topic change, see ValueStore::addSubscriptionObserver(), when the port is connected, and
+     * with false when it is disconnected
+     *
+     * Tracing being switched on or off is not reported, hasSubscribers() reflects it. The callback
+     * runs on the thread changing the subscriptions, so it should only take note of the state,
+     * e.g. in an atomic flag or by triggering the component. nullptr removes the callback.
+     */
+    void setSubscriptionCallback(std::function<void(bool)> callback) {
+        detail::Lock<std::mutex> lk(fMutex);
+        removeSubscriptionObserver();
+        fSubscriptionCallback = callback ? std::make_shared<const std::function<void(bool)>>(std::move(callback))
+                                         : nullptr;
+        if (fConnected) {
+            addSubscriptionObserver();
+        }
     }
 
 protected:
+    friend SenderPortGroup;
 
-    void tracePortAccess(const Value* vp, const std::vector<uint64_t>& inputIds) const {
-        if (fComponentTraceEventGenerator)
+    void connectUnsafe() override {
+        Port::connectUnsafe();
+        if (fConnected) {
+            // the values of the topic expire after the lifespan of its QoS profile, see TopicQos
+            const auto profile = fValueStore->getTopicQos().find(fKey);
+            if (profile != nullptr && profile->lifespan.count() > 0) {
+                fValueStore->setRetention(fKey, ValueStore::Retention::TIMED, profile->lifespan);
+            }
+            addSubscriptionObserver();
+        }
+    }
+
+    void disconnectUnsafe() override {
+        const bool observed = fSubscriptionObserver != 0;
+        removeSubscriptionObserver();
+        Port::disconnectUnsafe();
+        if (observed) {
+            (*fSubscriptionCallback)(false);
+        }
+    }
+
+    /**
+     * Write a value to the topic of a connected state
+     *
+     * @param origin   The origin of an injected value, see injectValue(), nullptr for local values
+     */
+    int write(const ConnectionState& state, const ValuePtr& vp, bool blocking,
+              const ValueOrigin* origin = nullptr) {
+        const int numaNode = fNumaNode.load(std::memory_order_relaxed);
+        if (numaNode >= 0 && vp) {
+            placeOnNumaNode(*vp, numaNode);
+        }
+        // aborted if the port is disconnected or remapped while waiting for blocked receivers
+        auto checkAbort = [this, &state] { return &connectionState() != &state; };
+        const auto timeoutMs = fBlockingTimeoutMs.load();
+        if (blocking && timeoutMs > 0) {
+            const auto timeout = std::chrono::milliseconds(timeoutMs);
+            return origin != nullptr
+                ? state.valueStore->injectValue(state.topicHandle, vp, *origin, timeout, checkAbort)
+                : state.valueStore->setValue(state.topicHandle, vp, timeout, checkAbort);
+        }
+        return origin != nullptr
+            ? state.valueStore->injectValue(state.topicHandle, vp, *origin, blocking, checkAbort)
+            : state.valueStore->setValue(state.topicHandle, vp, blocking, checkAbort);
+    }
+
+    std::atomic<int64_t> fBlockingTimeoutMs{0};
+    std::atomic<int> fNumaNode{-1};
+
+    void tracePortAccess(const ConnectionState& state, const Value* vp, const std::vector<uint64_t>& inputIds) const {
+        if (TracePolicy::active() && fComponentTraceEventGenerator)
+        {
+            fComponentTraceEventGenerator->traceSetPortValue(state.key, state.connected, inputIds, vp);
+        }
+        if (LineageTracker::active() && state.connected && vp != nullptr)
         {
-            fComponentTraceEventGenerator->traceSetPortValue(fKey, fConnected, inputIds, vp);
+            LineageTracker::instance().recordWrite(state.key, *vp, inputIds);
         }
     }
+
+private:
+    /**
+     * Observe the subscribers of the connected topic with fMutex locked, if there is a callback
+     */
+    void addSubscriptionObserver() {
+        if (fSubscriptionCallback == nullptr || fSubscriptionObserver != 0) {
+            return;
+        }
+        // the observer keeps the callback, as the store may call it while it is replaced
+        std::shared_ptr<const std::function<void(bool)>> callback = fSubscriptionCallback;
+        fSubscriptionStore = fValueStore;
+        fSubscriptionObserver = fValueStore->addSubscriptionObserver(
+            fTopicHandle, [callback](bool subscribed) { (*callback)(subscribed); });
+    }
+
+    void removeSubscriptionObserver() {
+        if (fSubscriptionObserver != 0) {
+            fSubscriptionStore->removeSubscriptionObserver(fSubscriptionObserver);
+            fSubscriptionObserver = 0;
+        }
+    }
+
+    // guarded by fMutex
+    std::shared_ptr<const std::function<void(bool)>> fSubscriptionCallback;
+    ValueStore* fSubscriptionStore = nullptr;
+    ValueStore::ObserverId fSubscriptionObserver = 0;
 };
 
 
@@ -575,10 +1251,10 @@ public:
      */
     int setValue(ValuePtr vp, bool blocking=true, const std::vector<uint64_t>& inputIds = std::vector<uint64_t>()) {
         int retVal = ENOTCONN;
-        tracePortAccess(vp.get(), inputIds);
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
-            retVal = fValueStore->setValue(fKey, vp, blocking, [this] { return !isConnected(); });
+        const ConnectionState& state = connectionState();
+        tracePortAccess(state, vp.get(), inputIds);
+        if (state.connected) {
+            retVal = write(state, vp, blocking);
         }
         return retVal;
     }
@@ -596,15 +1272,15 @@ public:
         const std::vector<uint64_t>& inputIds = std::vector<uint64_t>())
     {
         int retVal = ENOTCONN;
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
+        const ConnectionState& state = connectionState();
+        if (state.connected) {
             fComponent.idGenerator().injectId(*vp);
-            tracePortAccess(vp.get(), inputIds);  // if connected, trace port access after ID generation
-            retVal = fValueStore->setValue(fKey, std::shared_ptr<const T>(vp.release()), blocking, [this] { return !isConnected(); });
+            tracePortAccess(state, vp.get(), inputIds);  // if connected, trace port access after ID generation
+            retVal = write(state, std::shared_ptr<const T>(vp.release()), blocking);
         }
         else
         {
-            tracePortAccess(vp.get(), inputIds);  // if unconnected, trace port access with original value
+            tracePortAccess(state, vp.get(), inputIds);  // if unconnected, trace port access with original value
         }
         return retVal;
     }
@@ -630,35 +1306,106 @@ public:
 
     int setValue(T& value, bool blocking=true, const std::vector<uint64_t>& inputIds = std::vector<uint64_t>()) {
         int retVal = ENOTCONN;
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
+        const ConnectionState& state = connectionState();
+        if (state.connected) {
             fComponent.idGenerator().injectId(value);
-            tracePortAccess(&value, inputIds);  // if connected, trace port access after ID generation
+            tracePortAccess(state, &value, inputIds);  // if connected, trace port access after ID generation
             ValuePtr vp = fComponent.valueFactory().createValue(value);
-            retVal = fValueStore->setValue(fKey, vp, blocking, [this] { return !isConnected(); });
+            retVal = write(state, vp, blocking);
         }
         else
         {
-            tracePortAccess(&value, inputIds);  // if unconnected, trace port access with original value
+            tracePortAccess(state, &value, inputIds);  // if unconnected, trace port access with original value
         }
         return retVal;
     }
 
     int setValue(T&& value, bool blocking=true, const std::vector<uint64_t>& inputIds = std::vector<uint64_t>()) {
         int retVal = ENOTCONN;
-        detail::Lock<std::mutex> lk(fMutex);
-        if (isConnected()) {
+        const ConnectionState& state = connectionState();
+        if (state.connected) {
             fComponent.idGenerator().injectId(value);
-            tracePortAccess(&value, inputIds);  // if connected, trace port access after ID generation
+            tracePortAccess(state, &value, inputIds);  // if connected, trace port access after ID generation
             ValuePtr vp = fComponent.valueFactory().createValue(std::forward<T>(value));
-            retVal = fValueStore->setValue(fKey, vp, blocking, [this] { return !isConnected(); });
+            retVal = write(state, vp, blocking);
         }
         else
         {
-            tracePortAccess(&value, inputIds);  // if unconnected, trace port access with original value
+            tracePortAccess(state, &value, inputIds);  // if unconnected, trace port access with original value
+        }
+        return retVal;
+    }
+};
+
+
+/**
+ * Writes the values of several sender ports at once, see ValueStore::setValues()
+ *
+ * Values are staged with setValue() and written together by publish(). Components listening
+ * to more than one of the topics are triggered only once per publish().
+ * All ports of a group must be connected to the same value store.
+ */
+class SenderPortGroup {
+public:
+    /**
+     * Stage a value to be written to the topic of the given port by the next publish()
+     */
+    void setValue(GenericSenderPort& port, ValuePtr vp) {
+        fStaged.emplace_back(&port, std::move(vp));
+    }
+
+    /**
+     * Write all staged values and clear the staging area
+     *
+     * @param blocking See GenericSenderPort::setValue()
+     * @param inputIds A vector of value ids which will be written to the trace events.
+     * @return An integer indicating either success or an error code:
+     *         0:         Success, all values have been written to the value store
+     *         EAGAIN:    no value was written, because a topic is currently blocked
+     *                    and the argument blocking set to false
+     *         ENOTCONN:  At least one port is not connected, the values for all
+     *                    connected ports have been written
+     *         ECANCELED: A port has been disconnected while publish() was in progress,
+     *                    no value was written
+     */
+    int publish(bool blocking=true, const std::vector<uint64_t>& inputIds = std::vector<uint64_t>()) {
+        int retVal = 0;
+        ValueStore* valueStore = nullptr;
+        ValueStore::ValueBatch batch;
+        std::vector<GenericSenderPort*> ports;
+        batch.reserve(fStaged.size());
+        ports.reserve(fStaged.size());
+        for (const auto& staged : fStaged) {
+            GenericSenderPort& port = *staged.first;
+            const auto& state = port.connectionState();
+            if (state.connected) {
+                MCF_ASSERT(valueStore == nullptr || valueStore == state.valueStore,
+                           "All ports of a SenderPortGroup must be connected to the same value store");
+                valueStore = state.valueStore;
+                batch.emplace_back(state.topicHandle, staged.second);
+                ports.push_back(&port);
+            }
+            else {
+                retVal = ENOTCONN;
+            }
+            port.tracePortAccess(state, staged.second.get(), inputIds);
+        }
+        fStaged.clear();
+
+        if (valueStore != nullptr) {
+            int ret = valueStore->setValues(batch, blocking, [&ports] {
+                return std::any_of(ports.begin(), ports.end(),
+                                   [](const GenericSenderPort* port) { return !port->isConnected(); });
+            });
+            if (ret != 0) {
+                retVal = ret;
+            }
         }
         return retVal;
     }
+
+private:
+    std::vector<std::pair<GenericSenderPort*, ValuePtr>> fStaged;
 };
 
 } // namespace mcf
@@ -5,21 +5,72 @@
 #define MCF_PORTTRIGGERHANDLER_H
 
 #include "mcf_core/ITriggerable.h"
+#include "mcf_core/LatencyHistogram.h"
+#include "mcf_core/PerfCounters.h"
+#include "mcf_core/LogicalClock.h"
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 namespace mcf {
 
 class EventFlag;
 class ComponentTraceEventGenerator;
+class ValueQueue;
+
+/**
+ * Options of a port trigger handler, see GenericReceiverPort::registerHandler()
+ */
+struct PortTriggerHandlerOptions {
+    /**
+     * The handler is safe to run concurrently with the other handlers of its component
+     *
+     * If the component runs on an executor, such a handler becomes a task of its own, which
+     * runs in parallel to the component's other handlers on any free worker. Activations of the
+     * handler itself are still serialized and coalesced. Without an executor, this has no effect.
+     */
+    bool concurrent = false;
+
+    /**
+     * The handler runs inline on the thread writing the value which activates it
+     *
+     * The handler then runs inside the writer's setValue(), right after the value store has
+     * released its locks, instead of waking the component. If the component is not running or
+     * busy with another handler, the activation falls back to waking the component as usual.
+     * See also ComponentManager::fuse().
+     */
+    bool fused = false;
+
+    /**
+     * Handlers of higher priority run first when several handlers of a component are ready
+     *
+     * Handlers of equal priority run in the order they were activated. Between two handler runs,
+     * handlers activated meanwhile are ranked with the remaining ready ones, so a ready handler
+     * waits for at most one handler run of lower priority, or less if that handler calls
+     * Component::preemptionPoint().
+     */
+    int priority = 0;
+
+    /**
+     * Run instead of the handler while its component is overloaded
+     *
+     * Only used with Component::OverloadPolicy::FALLBACK, see Component::setOverloadBudget().
+     * The values queued for the handler are left to the fallback, which should consume them at
+     * a lower cost, e.g. skip expensive processing steps.
+     */
+    std::function<void()> fallback;
+};
 
 class PortTriggerHandler {
 public:
     explicit PortTriggerHandler(std::function<void()> func,
                                 std::string name="",
-                                const std::shared_ptr<ComponentTraceEventGenerator>& eventGenerator = nullptr);
+                                const std::shared_ptr<ComponentTraceEventGenerator>& eventGenerator = nullptr,
+                                const PortTriggerHandlerOptions& options = PortTriggerHandlerOptions());
 
     std::shared_ptr<EventFlag> getEventFlag() const {
         return fEventFlag;
@@ -32,10 +83,105 @@ public:
         fFunc();
     }
 
+    bool hasFallback() const {
+        return static_cast<bool>(fOptions.fallback);
+    }
+
+    /**
+     * Run the fallback handler, see PortTriggerHandlerOptions::fallback
+     */
+    void callFallback() {
+        fOptions.fallback();
+    }
+
+    /**
+     * Mark the handler as overloaded after a run exceeded the time budget of its component, see
+     * Component::OverloadBudget::maxHandlerTime
+     */
+    void setOverrun() {
+        fOverrun.store(true, std::memory_order_relaxed);
+    }
+
+    /**
+     * @return true if the handler overran since the previous call, which resets the mark
+     */
+    bool takeOverrun() {
+        return fOverrun.exchange(false, std::memory_order_relaxed);
+    }
+
     const std::string& getName() const {
         return fName;
     }
 
+    bool isConcurrent() const {
+        return fOptions.concurrent;
+    }
+
+    bool isFused() const {
+        return fOptions.fused;
+    }
+
+    int getPriority() const {
+        return fOptions.priority;
+    }
+
+    /**
+     * Run times of the handler in the current statistics window of its component
+     */
+    LatencyHistogram& getLatencyHistogram() {
+        return fLatency;
+    }
+
+    const LatencyHistogram& getLatencyHistogram() const {
+        return fLatency;
+    }
+
+    /**
+     * Performance counter sums of the handler runs in the current statistics window
+     */
+    PerfCounterTotals& getPerfCounters() {
+        return fPerfCounters;
+    }
+
+    const PerfCounterTotals& getPerfCounters() const {
+        return fPerfCounters;
+    }
+
+    /**
+     * Let the queue of a queued receiver port count for the overload budget of the handler
+     *
+     * Called by the port when the handler is registered with it.
+     */
+    void addQueue(const std::shared_ptr<ValueQueue>& queue);
+
+    void removeQueue(const std::shared_ptr<ValueQueue>& queue);
+
+    /**
+     * The age of the oldest value in the queues of the handler, see ValueQueue::getAge()
+     */
+    std::chrono::nanoseconds getQueueAge() const;
+
+    /**
+     * Drop old values from the queues of the handler, see ValueQueue::dropOlderThan()
+     *
+     * @return the number of values dropped from all queues
+     */
+    size_t dropQueuedValues(std::chrono::nanoseconds minAge, size_t keep);
+
+    /**
+     * The queues of the handler which still exist, e.g. to collect the length changes of
+     * adaptive queues, see ValueQueue::takeLengthDecisions()
+     */
+    std::vector<std::shared_ptr<ValueQueue>> getQueues() const;
+
+    /**
+     * The earliest logical time at the front of the queues of the handler, see
+     * ValueQueue::frontStamp()
+     *
+     * @return false if no queue has a stamped value at its front
+     */
+    bool getFrontStamp(LogicalClock::Stamp& stamp) const;
+
 private:
 
     /**
@@ -48,6 +194,10 @@ private:
         TriggerTracer(std::shared_ptr<EventFlag> eventFlag,
                       std::shared_ptr<ComponentTraceEventGenerator> eventGenerator);
 
+        ~TriggerTracer() override {
+            detachTriggerSources();
+        }
+
         /**
          * Method that will be triggered by the EventFlag when it gets activated.
          * We use it to trace trigger activations
@@ -63,7 +213,13 @@ private:
     std::function<void()> fFunc;
     std::shared_ptr<EventFlag> fEventFlag;
     std::string fName;
+    PortTriggerHandlerOptions fOptions;
+    LatencyHistogram fLatency;
+    PerfCounterTotals fPerfCounters;
     std::shared_ptr<TriggerTracer> fTriggerTracer;
+    mutable std::mutex fQueueMutex;
+    std::vector<std::weak_ptr<ValueQueue>> fQueues;
+    std::atomic<bool> fOverrun{false};
 };
 
 } // namespace mcf
@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_PREVIEWSERVICE_H
+#define MCF_PREVIEWSERVICE_H
+
+#include "mcf_core/Value.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <typeindex>
+#include <typeinfo>
+#include <vector>
+
+namespace mcf {
+
+class ValueStore;
+
+/**
+ * Settings of the previews of image topics, see PreviewService
+ */
+struct PreviewConfig {
+    /// glob patterns of the image topics, see ValueStore::matchesPattern(), previews are disabled
+    /// if empty
+    std::vector<std::string> topics;
+    /// time between two previews of a topic, the images written in between are skipped
+    std::chrono::milliseconds interval{200};
+    /// the previews fit into this size, 0 for no limit
+    uint32_t maxWidth = 320;
+    uint32_t maxHeight = 240;
+    /// JPEG quality from 1 to 100, 0 to publish the pixels uncompressed. Needs mcf_core built with
+    /// MCF_ENABLE_JPEG_PREVIEWS, the pixels are published uncompressed otherwise.
+    int jpegQuality = 0;
+};
+
+/**
+ * The pixels of an image value, see PreviewService::registerImageType()
+ */
+struct ImageView {
+    const uint8_t* data = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    /// bytes from the start of one row to the next, at least width * channels
+    uint32_t pitch = 0;
+    /// interleaved 8 bit channels per pixel, e.g. 1 for gray or 3 for rgb
+    uint32_t channels = 0;
+};
+
+/**
+ * Previews of image topics for remote viewers
+ *
+ * Viewers displaying thumbnails would otherwise pull the images in full resolution, loading the
+ * network and the process producing them. Every config.interval, a thread of low priority reads
+ * the latest image of each topic matching config.topics, if it was written since the previous
+ * preview, downscales it by the smallest integer factor fitting config.maxWidth and
+ * config.maxHeight and publishes it as msg::PreviewImage to TOPIC_PREFIX<image topic>. The
+ * writers of the images are not involved, the images in between are simply not read.
+ *
+ * The pixels of an image are found by the accessor registered for its type, images of other
+ * types are skipped. ComponentManager::enablePreviews() runs the service for the value store of
+ * the manager.
+ */
+class PreviewService {
+public:
+    static constexpr const char* TOPIC_PREFIX = "/mcf/preview";
+
+    /**
+     * Finds the pixels of an image, returns false if it holds none, e.g. since it is empty
+     */
+    using ImageAccessor = std::function<bool(const Value& value, ImageView& image)>;
+
+    /**
+     * Let the previews read the pixels of values of type T, e.g. from their ext mem and their
+     * width, height and pitch attributes. Applies to all preview services of the process.
+     */
+    template<typename T>
+    static void registerImageType(std::function<bool(const T& value, ImageView& image)> accessor) {
+        registerImageAccessor(std::type_index(typeid(T)),
+            [accessor](const Value& value, ImageView& image) {
+                // only called for values of type T
+                return accessor(static_cast<const T&>(value), image);
+            });
+    }
+
+    static void registerImageAccessor(std::type_index type, ImageAccessor accessor);
+
+    /**
+     * @param valueStore The value store of the images and previews, the reference is stored
+     * @param config     The settings
+     */
+    PreviewService(ValueStore& valueStore, const PreviewConfig& config);
+
+    /**
+     * Stops the previews
+     */
+    ~PreviewService();
+
+    PreviewService(const PreviewService&) = delete;
+    PreviewService& operator=(const PreviewService&) = delete;
+
+    const PreviewConfig& config() const {
+        return fConfig;
+    }
+
+    /**
+     * Start publishing previews every config.interval
+     */
+    void start();
+
+    void stop();
+
+    /**
+     * Publish the previews of the images written since the previous update
+     *
+     * @return The number of previews published
+     */
+    size_t update();
+
+    /**
+     * Downscale an image by averaging blocks of factor x factor pixels
+     *
+     * @param out Receives (image.width / factor) * (image.height / factor) * image.channels
+     *            bytes, the pixels of incomplete blocks at the right and bottom edges are dropped
+     */
+    static void downscale(const ImageView& image, uint32_t factor, uint8_t* out);
+
+private:
+    void run();
+
+    uint32_t scaleFactor(const ImageView& image) const;
+
+    ValueStore& fValueStore;
+    const PreviewConfig fConfig;
+    bool fJpeg = false;
+
+    // serializes update(), the value of the latest preview by image topic
+    std::mutex fUpdateMutex;
+    std::map<std::string, std::weak_ptr<const Value>> fPreviewed;
+
+    std::mutex fMutex;
+    std::condition_variable fCv;
+    bool fStopRequest = false;
+    std::thread fThread;
+};
+
+} // namespace mcf
+
+#endif // MCF_PREVIEWSERVICE_H
@@ -6,10 +6,12 @@
 #define MCF_QUEUEDEVENTSOURCE_H_
 
 #include "mcf_core/IDynamicEventSource.h"
+#include "mcf_core/TimestampType.h"
 #include "mcf_core/ValueStore.h"
+#include <deque>
 #include <mutex>
-#include <map>
-#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 namespace mcf {
 
@@ -19,6 +21,11 @@ class ComponentTraceEventGenerator;
 
 /**
  * Event source which manages a dynamic queue of events
+ *
+ * Events with the same timestamp are fired in the order they were pushed. The queue is a ring
+ * buffer while events are pushed in time order and becomes a binary heap when an event is pushed
+ * before the last one, until it runs empty. Topic, component and port names are interned, so
+ * that pushing and firing do not allocate once the queue has grown to its working size.
  */
 class QueuedEventSource : public IDynamicEventSource
 {
@@ -26,6 +33,18 @@ public:
 
     using IntTimestamp = uint64_t;  // Unix time in microsecs
 
+    /**
+     * An event to be pushed by pushNewEvents()
+     */
+    struct NewEvent
+    {
+        TimestampType timestamp;
+        std::string topic;
+        ValuePtr value;
+        std::string component;
+        std::string port;
+    };
+
     /**
      * Constructor
      *
@@ -55,6 +74,14 @@ public:
      */
     bool isFinished() override;
 
+    /**
+     * Drops the queued events before time, see seekQueuedEvent()
+     *
+     * Events which have already been fired or dropped cannot be restored, a seek to a time before
+     * the latest of them returns false and keeps the queue as is.
+     */
+    bool seek(const TimestampType& time) override;
+
     /**
      * Pushes a new event into the event source queue.
      */
@@ -64,6 +91,12 @@ public:
                       std::string component="",
                       std::string port="");
 
+    /**
+     * Pushes several events into the event source queue under a single lock, the event timing
+     * controller is notified once. The events are moved from.
+     */
+    void pushNewEvents(std::vector<NewEvent>& events);
+
     /**
      * Clears any events currently in the event queue.
      */
@@ -95,8 +128,32 @@ public:
 
 private:
 
-    template<typename T>
-    using ValueTopicComponentPortTuple = std::tuple<ValueTopicTuple<T>, std::string, std::string>;
+    struct QueuedEvent {
+        IntTimestamp time = 0;
+        /// push order, orders events with the same timestamp
+        uint64_t sequence = 0;
+        ValuePtr value;
+        /// ids of the names in fNames
+        uint32_t topic = 0;
+        uint32_t component = 0;
+        uint32_t port = 0;
+    };
+
+    /**
+     * Get the id of a name, adding it to fNames if needed (fEventQueueMutex should be locked by caller)
+     */
+    uint32_t internName(std::string&& name);
+
+    /**
+     * Append an event to the ring or push it to the heap (fEventQueueMutex should be locked by caller)
+     */
+    void enqueue(QueuedEvent&& event);
+
+    /**
+     * Remove the next event from the queue, which must not be empty (fEventQueueMutex should be 
+     * locked by caller)
+     */
+    QueuedEvent dequeue();
 
     /**
      * Find next event timestamp and topic
@@ -123,9 +180,26 @@ private:
     mutable std::mutex fEventQueueMutex;
 
     /**
-     * Event queue which can contain multiple entries for a single timestamp.
+     * Event queue which can contain multiple entries for a single timestamp. The fQueueSize events
+     * start at fQueueHead of the ring (the capacity of fEventQueue is a power of 2) or form a heap at
+     * the start of fEventQueue if fHeapOrder is set.
+     */
+    std::vector<QueuedEvent> fEventQueue;
+    std::size_t fQueueHead = 0;
+    std::size_t fQueueSize = 0;
+    bool fHeapOrder = false;
+    uint64_t fNextSequence = 0;
+    IntTimestamp fLastTime = 0;
+    /// time of the latest event fired or dropped, valid if fDequeued is set
+    IntTimestamp fDequeuedTime = 0;
+    bool fDequeued = false;
+
+    /**
+     * Interned names of topics, components and ports, a deque so that references stay valid
+     * while events are fired.
      */
-    std::multimap<IntTimestamp, ValueTopicComponentPortTuple<Value>> fEventQueue;
+    std::deque<std::string> fNames;
+    std::unordered_map<std::string, uint32_t> fNameIds;
     
     /**
      * Bool value which stores whether the event source has any more events to publish.
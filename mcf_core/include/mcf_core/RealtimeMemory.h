@@ -0,0 +1,92 @@
+/**
+ * Helpers against page faults in real-time processes: memory locking and pre-faulting.
+ *
+ * Copyright (c) 2024 Accenture
+ *
+ */
+#ifndef MCF_REALTIMEMEMORY_H
+#define MCF_REALTIMEMEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mcf
+{
+/**
+ * @brief Process wide memory settings for real-time components
+ *
+ * The settings are global: lockMemory and heapPrefaultBytes change the malloc tuning of the whole
+ * process, including libraries and code outside of MCF, and they are part of the system
+ * configuration instead of the configuration of a component for this reason. See
+ * ComponentManager::setRealtimeMemory().
+ */
+struct RealtimeMemoryOptions
+{
+    /**
+     * Lock all current and future pages of the process into RAM, see lockProcessMemory()
+     */
+    bool lockMemory = false;
+
+    /**
+     * Bytes of stack each component thread touches before its startup(), 0 to disable
+     */
+    size_t stackPrefaultBytes = 0;
+
+    /**
+     * Bytes of heap faulted in once when the options are applied, 0 to disable. Disables heap
+     * trimming for the process like lockMemory, see prefaultHeap()
+     */
+    size_t heapPrefaultBytes = 0;
+
+    /**
+     * Ext mem of at least this many bytes is freed by the ValueReclaimer instead of the thread
+     * releasing the last reference to its value, 0 to disable
+     */
+    size_t deferredFreeBytes = 0;
+};
+
+/**
+ * @brief Lock all current and future pages of the process into RAM
+ *
+ * Calls mlockall(MCL_CURRENT | MCL_FUTURE). Freed heap memory is no longer returned to the system
+ * afterwards, so that it stays locked and faulted in for later allocations: with glibc, heap
+ * trimming and mmap() allocations are disabled with mallopt(), which applies to all allocations of
+ * the process and is not undone by unlockProcessMemory().
+ *
+ * @return 0 on success, an error number as returned by mlockall(2) otherwise, e.g. EPERM or
+ *         ENOMEM if RLIMIT_MEMLOCK is too small
+ */
+int lockProcessMemory();
+
+/**
+ * @brief Undo lockProcessMemory(), heap memory is still not returned to the system
+ */
+void unlockProcessMemory();
+
+/**
+ * @brief Touch the given number of bytes of the calling thread's stack
+ *
+ * The size is limited to the stack size of the thread, minus a safety margin.
+ */
+void prefaultStack(size_t bytes);
+
+/**
+ * @brief Fault in the given number of bytes of heap memory and keep them for later allocations
+ *
+ * Disables heap trimming and mmap() allocations for the whole process like lockProcessMemory().
+ */
+void prefaultHeap(size_t bytes);
+
+/**
+ * @brief The size of the memory locked by the process (VmLck), 0 if it cannot be determined
+ */
+size_t getLockedMemorySize();
+
+/**
+ * @brief The number of major page faults of the process so far
+ */
+uint64_t getMajorPageFaults();
+
+} // namespace mcf
+
+#endif // MCF_REALTIMEMEMORY_H
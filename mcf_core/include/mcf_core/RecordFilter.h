@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_RECORDFILTER_H
+#define MCF_RECORDFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Copies the records of a record file selected by topic, type and time into a new record file
+ *
+ * The input is streamed with a RecordReader, the values are never deserialized. Records which
+ * are stored as they are in the input file, including their possibly compressed ext mem data,
+ * are copied inside the kernel with copy_file_range(), adjacent ones with a single call.
+ * Records of chunks and of delta encoded topics are written as ordinary records with their
+ * reconstructed values.
+ *
+ * Index blocks, footers and sync markers of the input are dropped, as their offsets do not
+ * apply to the output. With Options::reindex, a new footer is written. With
+ * Options::compressionLevel, all records are collected into compressed chunks instead, which
+ * needs HAVE_ZLIB.
+ */
+class RecordFilter {
+public:
+    struct Options {
+        /// topics to copy, all topics if empty
+        std::vector<std::string> topics;
+        /// type ids to copy, all types if empty
+        std::vector<std::string> types;
+        /// times of the records to copy in milliseconds, both inclusive
+        uint64_t startTime = 0;
+        uint64_t endTime = UINT64_MAX;
+        /// write a footer with checkpoints for seeking, see msg::RecordFooter
+        bool reindex = false;
+        /// zlib level of chunks, 0 to copy the records without chunks
+        int compressionLevel = 0;
+        /// uncompressed size at which a chunk is written
+        size_t chunkSize = 1024 * 1024;
+    };
+
+    struct Statistics {
+        uint64_t records = 0;
+        /// bytes copied from the input file as they are
+        uint64_t copiedBytes = 0;
+        /// bytes of records, chunks and the footer serialized by the filter
+        uint64_t writtenBytes = 0;
+    };
+
+    /**
+     * Records of the input may be slightly out of time order (e.g. records of chunks), reading
+     * stops at the first record this long after the end time
+     */
+    static constexpr uint64_t END_MARGIN_MS = 2000;
+
+    /**
+     * Copy the selected records of input into output, throws std::runtime_error on failure
+     */
+    static Statistics run(const std::string& input, const std::string& output, const Options& options);
+};
+
+} // namespace mcf
+
+#endif // MCF_RECORDFILTER_H
@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_RECORDHANDOFF_H
+#define MCF_RECORDHANDOFF_H
+
+#include "mcf_core/TypeRegistry.h"
+
+#include <chrono>
+#include <string>
+
+namespace mcf {
+
+/**
+ * Hands the values taken by a ValueRecorder to a recorder outside of it, e.g. in another process,
+ * instead of recording them into a file
+ *
+ * All functions are called from the write thread of the recorder. The receiving recorder does
+ * the compression, indexing and I/O, so these are configured there and not on the handing
+ * ValueRecorder.
+ */
+class IRecordHandoff {
+public:
+    virtual ~IRecordHandoff() = default;
+
+    /**
+     * Let the receiving recorder start recording into filename
+     *
+     * @return 0 on success, an errno value otherwise
+     */
+    virtual int open(const std::string& filename) = 0;
+
+    /**
+     * Hand over a value, must not block on the receiving recorder
+     *
+     * @param time    the time the value was queued, recorded instead of the time it is received
+     * @param seq     the sequence number of the write of the value, see IValueReceiver::receive()
+     * @param extMem  whether the ext mem data of the value is recorded
+     * @return 0 on success, EAGAIN if the value is dropped because the receiving recorder does
+     *         not keep up, another errno value otherwise
+     */
+    virtual int handOff(const std::string& topic,
+                        std::chrono::high_resolution_clock::time_point time,
+                        const ValuePtr& value,
+                        uint64_t seq,
+                        const TypeRegistry::TypemapEntry& typeInfo,
+                        bool extMem) = 0;
+
+    /**
+     * Let the receiving recorder stop after the values handed over so far
+     *
+     * @return 0 on success, an errno value otherwise
+     */
+    virtual int close() = 0;
+};
+
+} // namespace mcf
+
+#endif // MCF_RECORDHANDOFF_H
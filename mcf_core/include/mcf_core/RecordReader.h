@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_RECORDREADER_H
+#define MCF_RECORDREADER_H
+
+#include "mcf_core/Messages.h"
+#include "mcf_core/TypeRegistry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Reads record files written by the ValueRecorder
+ *
+ * The file is mapped into memory and the records are returned as views into the mapping, the
+ * values are only deserialized on request with getValue(). Records in chunks are expanded and
+ * values of delta encoded topics reconstructed, see ValueRecorder. Their views refer to buffers
+ * of the reader instead and stay valid until the next call of next(), seek() or close().
+ *
+ * Files of a running recorder can be read up to their last complete record. A file with a
+ * footer is read from its index checkpoints when seeking.
+ *
+ * With setShareExtMem(), the ext mem data of values returned by getValue() refers to the
+ * mapping instead of a copy, see IExtMemValue::extMemShare().
+ */
+class RecordReader {
+public:
+    /**
+     * A range of bytes in the mapping or a buffer of the reader
+     */
+    struct View {
+        const char* data = nullptr;
+        size_t size = 0;
+
+        std::string str() const { return std::string(data, size); }
+        bool operator==(const std::string& other) const {
+            return size == other.size() && other.compare(0, size, data, size) == 0;
+        }
+        bool operator!=(const std::string& other) const { return !(*this == other); }
+        bool operator==(const char* other) const {
+            return std::strlen(other) == size && std::memcmp(data, other, size) == 0;
+        }
+        bool operator!=(const char* other) const { return !(*this == other); }
+    };
+
+    struct Record {
+        /// receive time in milliseconds
+        uint64_t time = 0;
+        View topic;
+        View tid;
+        uint64_t vid = 0;
+        /// sequence number of the write to its topic, 0 in recordings which do not have it
+        uint64_t seq = 0;
+        /// msgpack serialization of the value
+        View value;
+        /// size of the ext mem data of the value, also if it was not recorded
+        uint32_t extMemSize = 0;
+        /// the uncompressed ext mem data if it was recorded, empty otherwise
+        View extMem;
+        /// file offset of the record, or of the chunk holding it
+        uint64_t offset = 0;
+        /// bytes of the record at offset, 0 if it was expanded from a chunk or reconstructed
+        /// from a delta record, so that it cannot be copied from the file as it is
+        uint64_t size = 0;
+        /// keeps the mapping alive if the ext mem data can be shared, see setShareExtMem()
+        std::shared_ptr<const void> extMemOwner;
+    };
+
+    RecordReader() = default;
+    ~RecordReader();
+
+    RecordReader(const RecordReader&) = delete;
+    RecordReader& operator=(const RecordReader&) = delete;
+
+    /**
+     * Map a record file and read its footer if present, throws std::runtime_error on failure
+     */
+    void open(const std::string& filename);
+
+    void close();
+
+    size_t size() const { return fSize; }
+
+    /**
+     * The footer of the file, nullptr for files of an older or still running recorder
+     */
+    std::shared_ptr<const msg::RecordFooter> getFooter() const { return fFooter; }
+
+    /**
+     * Only return records of the given topics, all records for an empty list
+     *
+     * Delta encoded topics which were filtered out before continue with their next keyframe.
+     */
+    void setTopicFilter(std::vector<std::string> topics);
+
+    /**
+     * Let the values returned by getValue() refer to the ext mem data in the mapping instead of
+     * copying it, if it is recorded uncompressed and outside of chunks and delta records
+     *
+     * The values keep the mapping alive, also after close(). The file must not be truncated
+     * while they exist, as accessing their data would then raise SIGBUS.
+     */
+    void setShareExtMem(bool share) { fShareExtMem = share; }
+
+    /**
+     * Continue with the first record at or after time (in milliseconds)
+     *
+     * With a footer, reading starts at the last checkpoint not after time, otherwise at the
+     * start of the file.
+     */
+    void seek(uint64_t time);
+
+    /**
+     * Continue with the first record of the file
+     */
+    void rewind() { seek(0); }
+
+    /**
+     * Read the next record, throws std::runtime_error on malformed records
+     *
+     * @return false at the end of the file, or if the last record is incomplete
+     */
+    bool next(Record& record);
+
+    /**
+     * Deserialize the value of a record, with its ext mem data and recorded id
+     *
+     * @return nullptr if the type is not registered
+     */
+    static ValuePtr getValue(const Record& record, const TypeRegistry& registry);
+
+    /**
+     * Truncate the file of a crashed recorder to the size synced before its last sync marker,
+     * see ValueRecorder::setDurability(), throws std::runtime_error on failure
+     *
+     * The marker is searched from the end of the file, so only the data behind it is scanned.
+     * Files with a footer or without sync markers are not changed.
+     *
+     * @return the size of the file
+     */
+    static uint64_t recover(const std::string& filename);
+
+private:
+    struct DeltaState {
+        std::string tid;
+        std::vector<char> payload;
+    };
+
+    void readFooter();
+
+    /**
+     * The synced size of the last sync marker, the file size if there is none
+     */
+    uint64_t findSyncedSize();
+
+    /**
+     * Parse the record at offset of data into record, advancing offset
+     *
+     * @return false if data ends within the record
+     */
+    bool parse(const char* data, size_t size, size_t& offset, Record& record);
+
+    /**
+     * Expand a chunk record into fChunk
+     */
+    void openChunk(const Record& chunk);
+
+    /**
+     * Reconstruct the value of a delta record, false if its topic has no keyframe yet
+     *
+     * The buffers of a topic are reused, so that it only allocates for the first keyframe of a
+     * topic and for payloads larger than the ones before.
+     */
+    bool applyDelta(Record& record);
+
+    bool accepted(const View& topic) const;
+
+    int fFile = -1;
+    // unmapped when the last record or value referring to it is gone
+    std::shared_ptr<const char> fMapping;
+    const char* fData = nullptr;
+    size_t fSize = 0;
+    size_t fOffset = 0;
+    uint64_t fStartTime = 0;
+    bool fShareExtMem = false;
+    std::shared_ptr<msg::RecordFooter> fFooter;
+    // sorted
+    std::vector<std::string> fTopics;
+
+    // the records of the current chunk
+    std::vector<char> fChunk;
+    uint64_t fChunkOffset = 0;
+    size_t fChunkPosition = 0;
+    uint32_t fChunkRecords = 0;
+
+    std::vector<char> fExtMem;
+    std::unordered_map<std::string, DeltaState> fDeltas;
+    // lookup key of fDeltas, see applyDelta()
+    std::string fDeltaTopic;
+};
+
+} // namespace mcf
+
+#endif // MCF_RECORDREADER_H
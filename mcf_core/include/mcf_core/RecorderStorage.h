@@ -0,0 +1,181 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_RECORDERSTORAGE_H
+#define MCF_RECORDERSTORAGE_H
+
+#include "mcf_core/Mutexes.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace mcf {
+
+/**
+ * Storage backend of the ValueRecorder, receives the serialized stream of records
+ *
+ * All functions are called from the write thread of the recorder, except bytesWritten() and
+ * sync().
+ */
+class IRecorderStorage {
+public:
+    virtual ~IRecorderStorage() = default;
+
+    /**
+     * Create or truncate the file
+     *
+     * @return 0 on success, an errno value otherwise
+     */
+    virtual int open(const std::string& filename) = 0;
+
+    /**
+     * Append data to the file, may return before the data has reached the file
+     *
+     * @return 0 on success, an errno value of this or of an earlier asynchronous write otherwise
+     */
+    virtual int write(const iovec* iov, size_t count) = 0;
+
+    /**
+     * Reserve disk space for the file opened last without changing its size, so that extending
+     * the file does not allocate on each write. Unused space is released by close().
+     *
+     * @return 0 on success or if the storage does not reserve space, an errno value otherwise
+     */
+    virtual int preallocate(uint64_t bytes) {
+        (void)bytes;
+        return 0;
+    }
+
+    /**
+     * Make the data passed to write() before the call durable on disk
+     *
+     * Called from the sync thread of the recorder, concurrently with write() but not with
+     * open() or close().
+     *
+     * @return 0 on success, an errno value otherwise, ENOTSUP if the storage cannot sync
+     */
+    virtual int sync() {
+        return ENOTSUP;
+    }
+
+    /**
+     * Write outstanding data and close the file
+     *
+     * @return 0 on success, an errno value otherwise
+     */
+    virtual int close() = 0;
+
+    /**
+     * Total number of bytes which have reached the file since open()
+     */
+    virtual uint64_t bytesWritten() const = 0;
+};
+
+/**
+ * Storage writing with writev() through the page cache, the default of the ValueRecorder
+ */
+class BufferedFileStorage : public IRecorderStorage {
+public:
+    ~BufferedFileStorage() override;
+
+    int open(const std::string& filename) override;
+    int write(const iovec* iov, size_t count) override;
+    int preallocate(uint64_t bytes) override;
+    int sync() override;
+    int close() override;
+    uint64_t bytesWritten() const override { return fBytesWritten; }
+
+private:
+    int fFile = -1;
+    uint64_t fReserved = 0;
+    std::atomic<uint64_t> fBytesWritten{0};
+};
+
+/**
+ * Storage bypassing the page cache with O_DIRECT and writing asynchronously with io_uring
+ *
+ * The data is copied into aligned segments of segmentSize bytes. Full segments are submitted
+ * as one write each while the next segment is filled, with up to queueDepth writes in flight.
+ * The last segment is padded to the alignment and the file truncated to its real size on close.
+ *
+ * open() fails if the file system does not support O_DIRECT or io_uring is not available
+ * (e.g. old kernels or restricted containers), the ValueRecorder then falls back to
+ * BufferedFileStorage.
+ *
+ * sync() waits for the writes in flight, writes the data of the current segment up to the next
+ * alignment with a blocking write and then calls fdatasync(). The write thread waits for this
+ * if it writes meanwhile, the fdatasync() itself runs without blocking it. The padding written
+ * by sync() is overwritten once the segment is full or truncated on close.
+ */
+class DirectFileStorage : public IRecorderStorage {
+public:
+    /// Alignment of the segments, their size and the file offsets, as needed by O_DIRECT
+    static constexpr size_t ALIGNMENT = 4096;
+
+    /**
+     * Constructor
+     *
+     * @param segmentSize Size of a write, rounded up to ALIGNMENT
+     * @param queueDepth  Number of writes in flight, there are queueDepth + 1 segments
+     */
+    explicit DirectFileStorage(size_t segmentSize = 4 * 1024 * 1024, size_t queueDepth = 2);
+    ~DirectFileStorage() override;
+
+    DirectFileStorage(const DirectFileStorage&) = delete;
+    DirectFileStorage& operator=(const DirectFileStorage&) = delete;
+
+    int open(const std::string& filename) override;
+    int write(const iovec* iov, size_t count) override;
+    int preallocate(uint64_t bytes) override;
+    int sync() override;
+    int close() override;
+    uint64_t bytesWritten() const override { return fBytesWritten; }
+
+private:
+    struct Segment {
+        char* data = nullptr;
+        /// bytes of record data in the segment
+        size_t used = 0;
+        /// file offset and length of the pending write, the length may include padding
+        uint64_t offset = 0;
+        size_t length = 0;
+        bool inFlight = false;
+    };
+
+    struct Ring;
+
+    /// Submit the current segment and switch to the next one, waiting for it to be free
+    int submitCurrent();
+    /// Write the unsynced data of the current segment, padded to the alignment
+    int writeTail();
+    int submit(Segment& segment, size_t index);
+    /// Wait for at least one completion and process all available ones
+    int reap();
+    void release();
+
+    const size_t fSegmentSize;
+    const size_t fQueueDepth;
+    std::vector<Segment> fSegments;
+    size_t fCurrent = 0;
+    size_t fInFlight = 0;
+    uint64_t fOffset = 0;
+    int fFile = -1;
+    int fError = 0;
+    uint64_t fReserved = 0;
+    /// bytes at the start of the current segment already written by sync()
+    size_t fSyncedTail = 0;
+    Ring* fRing = nullptr;
+    /// serializes write() and sync(), which share the segments and the ring
+    mutex::PriorityInheritanceMutex fMutex;
+    std::atomic<uint64_t> fBytesWritten{0};
+};
+
+} // namespace mcf
+
+#endif // MCF_RECORDERSTORAGE_H
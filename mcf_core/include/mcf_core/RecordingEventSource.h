@@ -0,0 +1,254 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_RECORDINGEVENTSOURCE_H_
+#define MCF_RECORDINGEVENTSOURCE_H_
+
+#include "mcf_core/IDynamicEventSource.h"
+#include "mcf_core/ValueStore.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace mcf {
+
+class IEventTimingController;
+class RecordReader;
+
+/**
+ * Event source replaying record files written by the ValueRecorder
+ *
+ * A thread reads the file with a RecordReader and deserializes the values ahead of playback
+ * into a buffer sorted by record time, until the buffered events span Params::bufferDuration or
+ * hold Params::bufferBytes of serialized values. Fired events make room for the thread to read
+ * on, so playback does not wait for the disk or the deserialization unless the buffer runs
+ * empty. The timestamp of an event is the receive time of its record.
+ *
+ * Several recordings, e.g. of the hosts of a vehicle, are replayed together by merging them on
+ * the fly: each file is read ahead by a thread and into a buffer of its own, with the limits
+ * above, and the next event is the earliest one of all buffers. The record times of a file are
+ * corrected by the clock offset of its host. Playback waits while the buffer of a file which is
+ * not read to its end is empty, since its next event may be the earliest one.
+ *
+ * Values of types not registered in the value store are skipped, as are the index, footer and
+ * sync marker records of the recorder.
+ *
+ * The ext mem of the values of Params::prefetchTopics is uploaded to Params::prefetchDevice by
+ * the thread as well, see IExtMemValue::extMemUpload(), so that e.g. recorded images of a type
+ * derived from CudaExtMemValue arrive valid on the device instead of being uploaded by the first
+ * component reading them. The buffered values then hold up to Params::bufferBytes of device
+ * memory.
+ */
+class RecordingEventSource : public IDynamicEventSource
+{
+public:
+
+    using IntTimestamp = uint64_t;  // Unix time in microsecs
+
+    /**
+     * Parameter structure
+     *
+     * @param topics          Topics to replay, all recorded topics if empty
+     *
+     * @param startTime       Record time to start replaying at in milliseconds, the start of the
+     *                        recording if 0
+     *
+     * @param bufferDuration  Read ahead until the buffered events span this time
+     *
+     * @param bufferBytes     Read ahead until the buffered events hold this many bytes of
+     *                        serialized values, including their ext mem data
+     *
+     * @param shareExtMem     Let the ext mem data of the values refer to the mapped file instead
+     *                        of copying it, see RecordReader::setShareExtMem(). The file must not
+     *                        be truncated while the values are in use.
+     *
+     * @param prefetchTopics  Topics whose ext mem is uploaded to prefetchDevice ahead of playback,
+     *                        patterns as of ValueStore::matchesPattern(), none if empty
+     *
+     * @param prefetchDevice  The device to upload to, e.g. the cuda device id of the pipeline
+     */
+    struct Params {
+        std::vector<std::string> topics;
+        uint64_t startTime = 0;
+        std::chrono::microseconds bufferDuration = std::chrono::seconds(2);
+        size_t bufferBytes = 256 * 1024 * 1024;
+        bool shareExtMem = true;
+        std::vector<std::string> prefetchTopics;
+        int prefetchDevice = 0;
+    };
+
+    /**
+     * Constructor, starts reading ahead, throws std::runtime_error if the file cannot be opened
+     *
+     * @param valueStore            The value store the events are written to, also used to
+     *                              deserialize the values (A reference will be stored, the user
+     *                              must keep that object alive)
+     * @param filename              The record file
+     * @param eventTimingController The eventTimingController which is notified when the buffer
+     *                              was empty and an event has been read.
+     * @param params                See Params
+     */
+    RecordingEventSource(ValueStore& valueStore,
+                         const std::string& filename,
+                         std::weak_ptr<mcf::IEventTimingController> eventTimingController,
+                         Params params = Params());
+
+    /**
+     * A record file replayed together with others, see the constructor taking recordings
+     */
+    struct Recording {
+        std::string filename;
+        /// added to the record times of the file, e.g. the offset of the clock of the recording
+        /// host to the clock of a reference host
+        std::chrono::microseconds clockOffset{0};
+    };
+
+    /**
+     * Constructor merging several recordings, starts reading each of them ahead, throws
+     * std::runtime_error if a file cannot be opened
+     *
+     * Params::startTime and seek() refer to the corrected record times. The other parameters
+     * apply to each recording.
+     */
+    RecordingEventSource(ValueStore& valueStore,
+                         const std::vector<Recording>& recordings,
+                         std::weak_ptr<mcf::IEventTimingController> eventTimingController,
+                         Params params = Params());
+
+    ~RecordingEventSource() override;
+
+    RecordingEventSource(const RecordingEventSource&) = delete;
+    RecordingEventSource& operator=(const RecordingEventSource&) = delete;
+
+    /**
+     * See base class documentation
+     */
+    bool getNextEventInfo(TimestampType &nextEventTimestamp, std::string &nextEventTopic) override;
+
+    /**
+     * See base class documentation
+     */
+    void fireEvent() override;
+
+    /**
+     * See base class documentation
+     */
+    bool dropEvent() override;
+
+    /**
+     * Returns true when the whole files have been read and all events have been fired or dropped.
+     */
+    bool isFinished() override;
+
+    /**
+     * Discards the buffered events and reads on from the first record at or after time, using
+     * the index of the files if they have a footer. Waits for the read threads to stop, which
+     * must not be blocked by the caller.
+     */
+    bool seek(const TimestampType& time) override;
+
+    /**
+     * Returns the number of buffered events and their bytes of serialized values, of all
+     * recordings.
+     */
+    void getBufferInfo(std::size_t& events, std::size_t& bytes) const;
+
+    /**
+     * Returns the number of values of Params::prefetchTopics uploaded to the device so far
+     */
+    std::size_t getPrefetchedCount() const;
+
+private:
+
+    struct Event {
+        IntTimestamp time;
+        /// interned in fTopicNames
+        const std::string* topic;
+        ValuePtr value;
+        /// sequence number of the write recorded with the value, see ValueStore::injectValue()
+        uint64_t seq;
+        size_t bytes;
+    };
+
+    /**
+     * A recording with its read thread and buffer
+     */
+    struct Stream {
+        std::unique_ptr<RecordReader> reader;
+        std::chrono::microseconds clockOffset;
+        // only inserted to by the read thread, the nodes and thus the event topics are stable
+        std::unordered_set<std::string> topicNames;
+
+        // guarded by fMutex
+        std::deque<Event> buffer;
+        std::size_t bufferedBytes = 0;
+        bool readFinished = false;
+        std::condition_variable bufferSpace;
+
+        std::thread readThread;
+    };
+
+    /**
+     * Thread reading the file of a stream into its buffer
+     */
+    void readAhead(Stream& stream);
+
+    /**
+     * Start a read thread per stream
+     */
+    void startReading();
+
+    /**
+     * Stop the read threads and wait for them
+     */
+    void stopReading();
+
+    /**
+     * Seek the reader of a stream to a corrected record time in milliseconds
+     */
+    static void seekStream(Stream& stream, uint64_t time);
+
+    /**
+     * The stream holding the earliest event of all streams, nullptr if it is not known yet
+     * (fMutex should be locked by caller)
+     */
+    Stream* nextStream();
+
+    /**
+     * Remove the next event from the buffer of a stream (fMutex should be locked by caller)
+     */
+    Event takeNextEvent(Stream& stream);
+
+    /**
+     * True if the buffer of a stream has reached its duration or size (fMutex should be locked
+     * by caller)
+     */
+    bool bufferFull(const Stream& stream) const;
+
+    /**
+     * True if the values of the topic are uploaded, see Params::prefetchTopics
+     */
+    bool isPrefetched(const std::string& topic) const;
+
+    ValueStore& fValueStore;
+    std::weak_ptr<mcf::IEventTimingController> fEventTimingController;
+    const Params fParams;
+
+    // in the order of the recordings, which also orders events of the same time
+    std::vector<std::unique_ptr<Stream>> fStreams;
+
+    mutable std::mutex fMutex;
+    std::size_t fPrefetched = 0;
+    bool fStop = false;
+};
+
+} // namespace mcf
+
+#endif // MCF_RECORDINGEVENTSOURCE_H_
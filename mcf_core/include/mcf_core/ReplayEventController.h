@@ -4,9 +4,11 @@
 #ifndef MCF_REPLAYEVENTCONTROLLER_H_
 #define MCF_REPLAYEVENTCONTROLLER_H_
 
+#include "mcf_core/LatencyHistogram.h"
 #include "mcf_core/TopicTriggerFlags.h"
 #include "json/forwards.h"
 
+#include <chrono>
 #include <vector>
 #include <string>
 #include <mutex>
@@ -111,6 +113,18 @@ public:
      * @param stepTimeMicroSeconds     Length of time period in seconds at which we step simulation time while in 
      *                                 STEPTIME mode.
      * 
+     * @param unthrottled              If true, events are fired as fast as possible instead of at speedFactor 
+     *                                 times real time, see EventTimingController::setUnthrottled(). Combined 
+     *                                 with runWithoutDrops, replay runs as fast as the pipeline finishes. 
+     *                                 Ignored in STEPTIME mode.
+     * 
+     * @param deterministic            If true, queued values are processed in the logical time of the events
+     *                                 they result from, so that a replay gives the same results on every run
+     *                                 while components still run in parallel, see LogicalClock.
+     * 
+     * @param lookaheadMicroSeconds    How far in event time the event sources may run ahead of the processing
+     *                                 of the earliest event when deterministic.
+     * 
      */  
     struct Params {
         RunMode runMode = CONTINUOUS;
@@ -120,6 +134,9 @@ public:
         std::string waitInputEventName = "";
         std::string waitInputTopicName = "";
         uint64_t stepTimeMicroSeconds = 0;
+        bool unthrottled = false;
+        bool deterministic = false;
+        uint64_t lookaheadMicroSeconds = 0;
     };
 
     /**
@@ -253,6 +270,28 @@ public:
      */
     bool getTime(TimestampType& simulationTime) const;
 
+    /**
+     * Get the simulation time played back per wall clock time, excluding pauses, see
+     * EventTimingController::getAchievedSpeedup().
+     */
+    float getAchievedSpeedup() const;
+
+    /**
+     * Get the latency of the steps requested with STEPONCE in SINGLESTEP or STEPTIME mode, from
+     * the request to the first event fired after it, see EventTimingController::getStepLatency().
+     */
+    LatencyHistogram::Summary getStepLatency() const;
+
+    /**
+     * Jump to a simulation time, e.g. to scrub through a recording.
+     * The event sources are repositioned to time - preRoll, the events before time are fired
+     * right away to warm up the state of the components, see EventTimingController::seek().
+     * Playback is resumed if paused.
+     *
+     * @return false if playback has finished or no event source supports seeking
+     */
+    bool seek(const TimestampType& time, std::chrono::microseconds preRoll = std::chrono::microseconds(0));
+
 private:
 
     /**
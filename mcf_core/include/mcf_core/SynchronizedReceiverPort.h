@@ -0,0 +1,411 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_SYNCHRONIZEDRECEIVERPORT_H
+#define MCF_SYNCHRONIZEDRECEIVERPORT_H
+
+#include "mcf_core/Port.h"
+#include "mcf_core/PortTriggerHandler.h"
+#include "mcf_core/ErrorMacros.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * How a SynchronizedReceiverPort matches the values of its inputs
+ *
+ * EXACT:       all values of a tuple have the same timestamp
+ * APPROXIMATE: the timestamps of a tuple differ by at most the tolerance, each value is
+ *              delivered in at most one tuple
+ * NEAREST:     every value of the first input is delivered with the value of each other input
+ *              nearest to it, if that is within the tolerance. Values of the other inputs may be
+ *              delivered in several tuples.
+ */
+enum class SyncPolicy {
+    EXACT,
+    APPROXIMATE,
+    NEAREST
+};
+
+namespace detail {
+
+class TimestampRingBase {
+public:
+    virtual ~TimestampRingBase() = default;
+
+    virtual size_t size() const = 0;
+
+    /**
+     * The timestamp of an entry, 0 being the oldest one
+     */
+    virtual uint64_t timestamp(size_t index) const = 0;
+
+    virtual void popFront(size_t count) = 0;
+
+    bool empty() const {
+        return size() == 0;
+    }
+};
+
+/**
+ * A fixed capacity ring of timestamped values, evicting the oldest one when full
+ */
+template<typename T>
+class TimestampRing : public TimestampRingBase {
+public:
+    struct Entry {
+        uint64_t timestamp = 0;
+        std::shared_ptr<const T> value;
+    };
+
+    explicit TimestampRing(size_t capacity) : fEntries(capacity) {}
+
+    /**
+     * @return false if the oldest entry was evicted to make room
+     */
+    bool push(uint64_t timestamp, std::shared_ptr<const T> value) {
+        bool evicted = false;
+        if (fSize == fEntries.size()) {
+            popFront(1);
+            evicted = true;
+        }
+        Entry& entry = fEntries[(fHead + fSize) % fEntries.size()];
+        entry.timestamp = timestamp;
+        entry.value = std::move(value);
+        ++fSize;
+        return !evicted;
+    }
+
+    const Entry& at(size_t index) const {
+        return fEntries[(fHead + index) % fEntries.size()];
+    }
+
+    size_t size() const override {
+        return fSize;
+    }
+
+    uint64_t timestamp(size_t index) const override {
+        return at(index).timestamp;
+    }
+
+    void popFront(size_t count) override {
+        for (size_t i = 0; i < count && fSize > 0; ++i) {
+            // release the value right away
+            fEntries[fHead].value.reset();
+            fHead = (fHead + 1) % fEntries.size();
+            --fSize;
+        }
+    }
+
+private:
+    std::vector<Entry> fEntries;
+    size_t fHead = 0;
+    size_t fSize = 0;
+};
+
+} // namespace detail
+
+/**
+ * A receiver port combining several topics into tuples of values which belong together in time
+ *
+ * Each input is a queued receiver port of its own, to be registered with its topic, e.g.
+ *
+ *     SynchronizedReceiverPort<Image, PointCloud> fSync(*this, "Sync", SyncPolicy::APPROXIMATE,
+ *         std::chrono::milliseconds(5), 10, imageTimestamp, cloudTimestamp);
+ *     config.registerPort(fSync.input<0>(), "/camera");
+ *     config.registerPort(fSync.input<1>(), "/lidar");
+ *
+ * Received values are buffered per input in a ring of the given size, values are expected in
+ * the order of their timestamps. The handler runs on the component thread for every matched
+ * tuple, see SyncPolicy. Values which can no longer be matched are evicted from the rings and
+ * counted as dropped, as are values overwritten in a full ring and values older than their
+ * predecessor. The queues of the inputs are as long as the rings, values overwritten there
+ * before the handler ran are lost without being counted.
+ *
+ * The port must not move, as its inputs refer to it.
+ */
+template<typename... Ts>
+class SynchronizedReceiverPort {
+public:
+    static constexpr size_t SIZE = sizeof...(Ts);
+    static_assert(SIZE >= 2, "Synchronizing requires at least two inputs");
+
+    using Values = std::tuple<std::shared_ptr<const Ts>...>;
+    using Handler = std::function<void(const Values&)>;
+
+    template<size_t I>
+    using InputType = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    /**
+     * @param component     the component this port is part of
+     * @param name          the name of the port, the inputs are named name[0], name[1], ...
+     * @param policy        the policy to match values
+     * @param tolerance     the maximum timestamp difference of matched values, ignored by EXACT
+     * @param ringSize      the number of values buffered per input, must be > 0
+     * @param timestamps    functions extracting the timestamp of a value per input, in us
+     */
+    SynchronizedReceiverPort(IComponent& component, const std::string& name, SyncPolicy policy,
+                             std::chrono::microseconds tolerance, size_t ringSize,
+                             std::function<uint64_t(const Ts&)>... timestamps)
+    : fComponent(component)
+    , fName(name)
+    , fPolicy(policy)
+    , fTolerance(static_cast<uint64_t>(std::max<int64_t>(0, tolerance.count())))
+    , fInputs(makeInputs(component, name, ringSize, std::index_sequence_for<Ts...>()))
+    , fTimestamps(std::move(timestamps)...)
+    , fRings(detail::TimestampRing<Ts>(ringSize)...)
+    {
+        MCF_ASSERT(ringSize > 0, "Synchronized receiver port requires a ring size > 0");
+        setRingPointers(std::index_sequence_for<Ts...>());
+    }
+
+    SynchronizedReceiverPort(const SynchronizedReceiverPort&) = delete;
+    SynchronizedReceiverPort& operator=(const SynchronizedReceiverPort&) = delete;
+
+    /**
+     * The port of an input, to be registered with its topic
+     */
+    template<size_t I>
+    QueuedReceiverPort<InputType<I>>& input() {
+        return *std::get<I>(fInputs);
+    }
+
+    /**
+     * Register the handler for matched tuples
+     *
+     * All inputs share one activation, so the handler runs on the component thread with the
+     * usual options, but it must not be concurrent.
+     */
+    void registerHandler(Handler handler, const PortTriggerHandlerOptions& options = PortTriggerHandlerOptions()) {
+        MCF_ASSERT(!options.concurrent, "Synchronized receiver port handler must not be concurrent");
+        fHandler = std::move(handler);
+        fPortHandler = std::make_shared<PortTriggerHandler>(
+            [this] { receive(std::index_sequence_for<Ts...>()); },
+            fName, fComponent.getComponentTraceEventGenerator(), options);
+        registerInputHandlers(std::index_sequence_for<Ts...>());
+    }
+
+    /**
+     * Number of tuples delivered to the handler
+     */
+    uint64_t getMatched() const {
+        return fMatched.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Number of values evicted without being delivered
+     */
+    uint64_t getDropped() const {
+        return fDropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    using Inputs = std::tuple<std::unique_ptr<QueuedReceiverPort<Ts>>...>;
+    using Indices = std::array<size_t, SIZE>;
+
+    template<size_t... Is>
+    static Inputs makeInputs(IComponent& component, const std::string& name, size_t ringSize,
+                             std::index_sequence<Is...>) {
+        // new values overwrite the oldest ones if the component falls behind
+        return Inputs(std::unique_ptr<QueuedReceiverPort<Ts>>(new QueuedReceiverPort<Ts>(
+            component, name + "[" + std::to_string(Is) + "]", ringSize, false,
+            ValueQueue::Storage::RING_BUFFER))...);
+    }
+
+    template<size_t... Is>
+    void setRingPointers(std::index_sequence<Is...>) {
+        fRingPointers = {{&std::get<Is>(fRings)...}};
+    }
+
+    template<size_t... Is>
+    void registerInputHandlers(std::index_sequence<Is...>) {
+        (void)std::initializer_list<int>{(std::get<Is>(fInputs)->registerHandler(fPortHandler), 0)...};
+    }
+
+    template<size_t... Is>
+    void receive(std::index_sequence<Is...>) {
+        (void)std::initializer_list<int>{(drainInput<Is>(), 0)...};
+        while (match()) {
+        }
+    }
+
+    template<size_t I>
+    void drainInput() {
+        auto& ring = std::get<I>(fRings);
+        const auto& timestamp = std::get<I>(fTimestamps);
+        std::get<I>(fInputs)->drain([&](const std::shared_ptr<const InputType<I>>& value) {
+            if (!value) {
+                // not of the input type
+                return;
+            }
+            const uint64_t ts = timestamp(*value);
+            if (!ring.empty() && ts < ring.timestamp(ring.size() - 1)) {
+                fDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (!ring.push(ts, value)) {
+                fDropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    /**
+     * Deliver the next tuple, if any
+     *
+     * @return true if the rings changed, so that matching should be retried
+     */
+    bool match() {
+        for (const auto* ring : fRingPointers) {
+            if (ring->empty()) {
+                return false;
+            }
+        }
+        switch (fPolicy) {
+        case SyncPolicy::EXACT:
+            return matchWithin(0);
+        case SyncPolicy::APPROXIMATE:
+            return matchWithin(fTolerance);
+        case SyncPolicy::NEAREST:
+            return matchNearest();
+        }
+        return false;
+    }
+
+    /**
+     * Match the newest of the oldest values with the values of the other inputs preceding it,
+     * evicting values too old to be matched with it
+     */
+    bool matchWithin(uint64_t tolerance) {
+        uint64_t pivot = 0;
+        for (const auto* ring : fRingPointers) {
+            pivot = std::max(pivot, ring->timestamp(0));
+        }
+        bool evicted = false;
+        for (auto* ring : fRingPointers) {
+            while (!ring->empty() && ring->timestamp(0) + tolerance < pivot) {
+                drop(*ring, 1);
+                evicted = true;
+            }
+            if (ring->empty()) {
+                return false;
+            }
+        }
+        if (evicted) {
+            // the pivot may have changed
+            return true;
+        }
+        // the latest value not after the pivot is the closest one
+        Indices chosen;
+        for (size_t i = 0; i < SIZE; ++i) {
+            const auto* ring = fRingPointers[i];
+            size_t index = 0;
+            while (index + 1 < ring->size() && ring->timestamp(index + 1) <= pivot) {
+                ++index;
+            }
+            chosen[i] = index;
+        }
+        deliver(chosen);
+        for (size_t i = 0; i < SIZE; ++i) {
+            drop(*fRingPointers[i], chosen[i]);
+            fRingPointers[i]->popFront(1);
+        }
+        return true;
+    }
+
+    /**
+     * Match the oldest value of the first input once every other input received a value
+     * not before it
+     */
+    bool matchNearest() {
+        auto* reference = fRingPointers[0];
+        const uint64_t ts = reference->timestamp(0);
+        Indices chosen;
+        chosen[0] = 0;
+        bool inTolerance = true;
+        for (size_t i = 1; i < SIZE; ++i) {
+            const auto* ring = fRingPointers[i];
+            if (ring->timestamp(ring->size() - 1) < ts) {
+                // a nearer value may still arrive
+                return false;
+            }
+            // the first value not before the reference, or its predecessor
+            size_t lo = 0;
+            size_t hi = ring->size() - 1;
+            while (lo < hi) {
+                const size_t mid = lo + (hi - lo) / 2;
+                if (ring->timestamp(mid) < ts) {
+                    lo = mid + 1;
+                }
+                else {
+                    hi = mid;
+                }
+            }
+            if (lo > 0 && ts - ring->timestamp(lo - 1) <= ring->timestamp(lo) - ts) {
+                --lo;
+            }
+            chosen[i] = lo;
+            const uint64_t candidate = ring->timestamp(lo);
+            inTolerance = inTolerance && (candidate > ts ? candidate - ts : ts - candidate) <= fTolerance;
+        }
+        if (inTolerance) {
+            deliver(chosen);
+        }
+        else {
+            fDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        reference->popFront(1);
+        // older values are not nearer to any later reference value, they were delivered or skipped
+        for (size_t i = 1; i < SIZE; ++i) {
+            fRingPointers[i]->popFront(chosen[i]);
+        }
+        return true;
+    }
+
+    void deliver(const Indices& chosen) {
+        fMatched.fetch_add(1, std::memory_order_relaxed);
+        if (fHandler) {
+            fHandler(values(chosen, std::index_sequence_for<Ts...>()));
+        }
+    }
+
+    template<size_t... Is>
+    Values values(const Indices& chosen, std::index_sequence<Is...>) const {
+        return Values(std::get<Is>(fRings).at(chosen[Is]).value...);
+    }
+
+    void drop(detail::TimestampRingBase& ring, size_t count) {
+        ring.popFront(count);
+        fDropped.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    IComponent& fComponent;
+    const std::string fName;
+    const SyncPolicy fPolicy;
+    const uint64_t fTolerance;
+    Inputs fInputs;
+    std::tuple<std::function<uint64_t(const Ts&)>...> fTimestamps;
+    std::tuple<detail::TimestampRing<Ts>...> fRings;
+    std::array<detail::TimestampRingBase*, SIZE> fRingPointers;
+    Handler fHandler;
+    std::shared_ptr<PortTriggerHandler> fPortHandler;
+    std::atomic<uint64_t> fMatched{0};
+    std::atomic<uint64_t> fDropped{0};
+};
+
+template<typename... Ts>
+constexpr size_t SynchronizedReceiverPort<Ts...>::SIZE;
+
+} // namespace mcf
+
+#endif // MCF_SYNCHRONIZEDRECEIVERPORT_H
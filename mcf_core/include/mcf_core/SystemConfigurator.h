@@ -6,6 +6,7 @@
 
 #include "mcf_core/ComponentInstantiator.h"
 #include "mcf_core/ComponentManager.h"
+#include "mcf_core/ParallelFor.h"
 
 #include "json/forwards.h"
 
@@ -17,12 +18,65 @@ namespace mcf
 /*
 {
     "SystemConfiguration": {
+        "RealtimeMemory": {
+            "lockMemory": true,
+            "stackPrefaultKiB": 256,
+            "heapPrefaultKiB": 16384,
+            "deferredFreeKiB": 1024
+        },
+        "NumaPlacement": "consumer",
+        "ParallelFor": {
+            "numThreads": 6,
+            "cpuAffinity": "4-9"
+        },
+        "Lineage": {
+            "sources": ["/vehicle/*"],
+            "sinks": ["/control/trajectory"],
+            "tableSize": 65536,
+            "publishIntervalMs": 1000
+        },
+        "ConfigCache": "cache/configs.bin",
+        "ValueSnapshot": {
+            "file": "/var/lib/mcf/values.snapshot",
+            "topics": ["/map/*", "/calibration/*"],
+            "intervalMs": 10000,
+            "maxAgeMs": 3600000
+        },
+        "Previews": {
+            "topics": ["/camera/front/*"],
+            "intervalMs": 200,
+            "maxWidth": 320,
+            "maxHeight": 240,
+            "jpegQuality": 75
+        },
+        "Qos": {
+            "profiles": {
+                "sensor": {
+                    "depth": 1,
+                    "reliability": "best_effort",
+                    "deadlineMs": 10,
+                    "lifespanMs": 100,
+                    "priority": 2
+                },
+                "command": {
+                    "depth": 0,
+                    "reliability": "reliable"
+                }
+            },
+            "topics": [
+                {"pattern": "/vehicle/*", "profile": "sensor"},
+                {"pattern": "/control/*", "profile": "command"}
+            ]
+        },
         "Components": {
             "slamMot" : {
                 "type": "SlamMot",
                 "schedulingParameters": {
                     "policy": "fifo",
-                    "priority": 7
+                    "priority": 7,
+                    "cpuAffinity": "2-3",
+                    "numaNode": 0,
+                    "parallelThreads": 4
                 },
                 "portMapping": {
                     "GPS": "/vehicle/GPS",
@@ -122,6 +176,85 @@ public:
      */
     system_configuration::ComponentSystem readSystemConfiguration(const Json::Value& node);
 
+    /**
+     * @brief Reads the process wide memory settings from a JSON (sub-)node
+     *
+     * The sub-node may contain an optional "RealtimeMemory" object, see the example above and
+     * RealtimeMemoryOptions. All settings are disabled if it is absent.
+     *
+     * @param node JSON object of the component configuration
+     * @return The memory settings
+     */
+    RealtimeMemoryOptions readRealtimeMemoryConfiguration(const Json::Value& node);
+
+    /**
+     * @brief Reads the settings of the parallelFor() worker pool from a JSON (sub-)node
+     *
+     * The sub-node may contain an optional "ParallelFor" object, see the example above and
+     * ParallelForConfig. The default pool settings are returned if it is absent.
+     *
+     * @param node JSON object of the component configuration
+     * @return The pool settings
+     */
+    ParallelForConfig readParallelForConfiguration(const Json::Value& node);
+
+    /**
+     * @brief Reads the settings of the end-to-end latency tracking from a JSON (sub-)node
+     *
+     * The sub-node may contain an optional "Lineage" object, see the example above and
+     * LineageConfig. Settings without sinks are returned if it is absent.
+     *
+     * @param node JSON object of the component configuration
+     * @return The tracking settings
+     */
+    LineageConfig readLineageConfiguration(const Json::Value& node);
+
+    /**
+     * @brief Reads the binary cache file of the component configs from a JSON (sub-)node
+     *
+     * The sub-node may contain an optional "ConfigCache" string, see the example above and
+     * util::json::ConfigCache::open(). An empty string is returned if it is absent.
+     *
+     * @param node JSON object of the component configuration
+     * @return The cache file
+     */
+    std::string readConfigCacheConfiguration(const Json::Value& node);
+
+    /**
+     * @brief Reads the settings of the value snapshots for warm restarts from a JSON (sub-)node
+     *
+     * The sub-node may contain an optional "ValueSnapshot" object, see the example above and
+     * ValueSnapshotConfig. Settings without a file are returned if it is absent.
+     *
+     * @param node JSON object of the component configuration
+     * @return The snapshot settings
+     */
+    ValueSnapshotConfig readValueSnapshotConfiguration(const Json::Value& node);
+
+    /**
+     * @brief Reads the settings of the previews of image topics from a JSON (sub-)node
+     *
+     * The sub-node may contain an optional "Previews" object, see the example above and
+     * PreviewConfig. Absent parameters take the defaults of PreviewConfig. Settings without
+     * topics are returned if it is absent.
+     *
+     * @param node JSON object of the component configuration
+     * @return The preview settings
+     */
+    PreviewConfig readPreviewConfiguration(const Json::Value& node);
+
+    /**
+     * @brief Reads the QoS profiles of the topics from a JSON (sub-)node
+     *
+     * The sub-node may contain an optional "Qos" object, see the example above and TopicQos.
+     * Profiles take the defaults of QosProfile for absent parameters. The first pattern of
+     * "topics" matching a topic selects its profile. No profiles are returned if it is absent.
+     *
+     * @param node JSON object of the component configuration
+     * @return The profiles and the topics they apply to
+     */
+    TopicQosConfig readQosConfiguration(const Json::Value& node);
+
     /**
      * @brief Configures the controlled system according to the description object
      *
@@ -161,7 +294,16 @@ public:
     /**
      * @brief Configures a system from a JSON node
      *
-     * Uses internally ComponentSystemConfigurator::readSystemConfiguration(const Json::Value&)
+     * Uses internally ComponentSystemConfigurator::readSystemConfiguration(const Json::Value&).
+     * If the node contains "RealtimeMemory" settings, they are applied with
+     * ComponentManager::setRealtimeMemory() before any component is instantiated. The optional
+     * "NumaPlacement" ("producer" or "consumer") is passed to ComponentManager::setNumaPlacement().
+     * "ParallelFor" settings replace the worker pool of parallelFor(), see configureParallelFor().
+     * A "ConfigCache" file is opened by the config cache of the process before the components
+     * read their configs, see util::json::ConfigCache. "ValueSnapshot" settings are passed to
+     * ComponentManager::enableValueSnapshot(). "Previews" settings are passed to
+     * ComponentManager::enablePreviews(). "Qos" profiles are set with
+     * ComponentManager::setTopicQos() before any component is configured.
      *
      * @param node JSON object with "Components": {...} structure
      */
@@ -0,0 +1,55 @@
+/**
+ * Helpers for pinning threads to CPUs via pthread_setaffinity_np.
+ *
+ * Copyright (c) 2024 Accenture
+ *
+ */
+#ifndef MCF_THREADAFFINITY_H
+#define MCF_THREADAFFINITY_H
+
+#include <pthread.h>
+
+#include <cstdint>
+#include <string>
+
+namespace mcf
+{
+/**
+ * @brief A set of CPUs, bit i stands for CPU i
+ *
+ * The empty mask means "no restriction" and leaves the affinity of a thread unchanged. CPUs with
+ * an index above 63 cannot be addressed.
+ */
+using CpuMask = uint64_t;
+
+/**
+ * @brief Restrict a thread to the CPUs of a mask
+ *
+ * @param thread The thread to pin
+ * @param mask   The CPUs the thread may run on, the empty mask has no effect
+ * @return 0 on success, an error number as returned by pthread_setaffinity_np(3) otherwise
+ */
+int setThreadCpuAffinity(pthread_t thread, CpuMask mask);
+
+/**
+ * @brief The CPUs a thread may currently run on, i.e. its effective placement
+ *
+ * @return the CPU mask, or the empty mask if it cannot be determined
+ */
+CpuMask getThreadCpuAffinity(pthread_t thread);
+
+/**
+ * @brief Format a CPU mask as CPU list, e.g. "0-3,6"
+ */
+std::string formatCpuMask(CpuMask mask);
+
+/**
+ * @brief Parse a CPU list in the format of cpuset(7), e.g. "0-3,6"
+ *
+ * @throws std::invalid_argument if the list is malformed or refers to a CPU above 63
+ */
+CpuMask parseCpuList(const std::string& list);
+
+} // namespace mcf
+
+#endif // MCF_THREADAFFINITY_H
@@ -14,7 +14,9 @@ public:
     TimeService() :
         mcf::Component("TimeService"),
         fPort10ms(*this, "10ms")
-    {}
+    {
+        registerPeriodicHandler(std::chrono::milliseconds(10), std::bind(&TimeService::tick, this));
+    }
 
     void configure(IComponentConfig& config) {
         config.registerPort(fPort10ms, "/time/10ms");
@@ -23,8 +25,6 @@ public:
     void startup() {
         fTimeMs = nowMs();
         publishTimestamp();
-        registerTriggerHandler(std::bind(&TimeService::tick, this));
-        trigger();
     }
 
     void tick() {
@@ -34,8 +34,6 @@ public:
             delta -= 10;
             publishTimestamp();
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        trigger();
     }
 
 private:
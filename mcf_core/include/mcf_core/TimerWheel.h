@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_TIMERWHEEL_H
+#define MCF_TIMERWHEEL_H
+
+#include "mcf_core/Mutexes.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <thread>
+#include <unordered_map>
+
+namespace mcf {
+
+/**
+ * Runs the callbacks of many timers on a single thread, e.g. the ping and freshness timeouts of
+ * all remote links of a process
+ *
+ * The timers are kept in a hierarchical timing wheel of LEVELS levels of SLOTS slots each: a
+ * slot of level 0 holds the timers of one tick, a slot of level n those of SLOTS^n ticks, which
+ * are moved to the lower levels as their time comes closer. Scheduling and cancelling take
+ * constant time. Deadlines are rounded up to the next tick, so that timers of close deadlines
+ * share one wakeup of the thread. The thread sleeps until the next occupied slot of level 0, or
+ * until the next cascade, and not at all while no timer is scheduled.
+ *
+ * Callbacks are run without holding the lock of the wheel, so they may schedule or cancel timers,
+ * also their own. They should be short, e.g. trigger a component, as they delay the other timers.
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;
+
+    /// Resolution of the wheel of the process, see instance()
+    static constexpr std::chrono::milliseconds DEFAULT_TICK{5};
+    static constexpr size_t LEVELS = 4;
+    static constexpr size_t SLOTS = 64;
+    /// Never returned by schedule()
+    static constexpr TimerId INVALID_TIMER = 0;
+
+    struct Statistics {
+        uint64_t scheduled = 0;    ///< timers scheduled
+        uint64_t fired = 0;        ///< callbacks run
+        uint64_t cancelled = 0;    ///< timers cancelled before they fired
+        uint64_t wakeups = 0;      ///< wakeups of the thread which ran at least one callback
+        size_t pending = 0;        ///< timers waiting to fire
+    };
+
+    /**
+     * The wheel of the process, whose thread is started with the first timer and lives until the
+     * end of the process
+     */
+    static TimerWheel& instance();
+
+    explicit TimerWheel(std::chrono::milliseconds tick = DEFAULT_TICK);
+
+    /**
+     * Stops the thread, pending timers do not fire
+     */
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * Run callback on the thread of the wheel at the first tick not before deadline
+     *
+     * @return the id of the timer, to cancel it
+     */
+    TimerId schedule(Clock::time_point deadline, std::function<void()> callback);
+
+    /**
+     * Run callback after delay, see schedule()
+     */
+    TimerId scheduleAfter(Clock::duration delay, std::function<void()> callback) {
+        return schedule(Clock::now() + delay, std::move(callback));
+    }
+
+    /**
+     * Cancel a timer, waiting for its callback to return if it is running on another thread,
+     * so that the objects used by the callback may be destroyed afterwards
+     *
+     * @return true if the timer was cancelled before its callback started
+     */
+    bool cancel(TimerId id);
+
+    Statistics statistics() const;
+
+    std::chrono::milliseconds tick() const { return fTick; }
+
+private:
+    struct Timer {
+        uint64_t expiry = 0;
+        std::function<void()> callback;
+        size_t level = 0;
+        size_t slot = 0;
+        std::list<TimerId>::iterator position;
+    };
+
+    using Slot = std::list<TimerId>;
+
+    /**
+     * Put a timer into the slot for its expiry tick, relative to fCurrentTick
+     */
+    void insert(TimerId id, Timer& timer);
+
+    /**
+     * Move the timers of a slot of a higher level to the lower levels
+     */
+    void cascade(size_t level);
+
+    /**
+     * The tick up to which the thread may sleep, UINT64_MAX without timers
+     */
+    uint64_t nextWakeupTick() const;
+
+    uint64_t tickOf(Clock::time_point time) const;
+
+    void run();
+
+    const std::chrono::milliseconds fTick;
+    const Clock::time_point fStart;
+
+    // protects all members below
+    mutable mutex::PriorityInheritanceMutex fMutex;
+    std::condition_variable_any fCv;
+    // signalled when a callback has returned
+    std::condition_variable_any fCallbackDoneCv;
+    std::array<std::array<Slot, SLOTS>, LEVELS> fWheel;
+    std::unordered_map<TimerId, Timer> fTimers;
+    // the next tick to process, all timers of earlier ticks have fired
+    uint64_t fCurrentTick = 0;
+    TimerId fNextId = INVALID_TIMER + 1;
+    // the timer whose callback is running, INVALID_TIMER if none
+    TimerId fRunning = INVALID_TIMER;
+    Statistics fStatistics;
+    bool fStopRequest = false;
+    std::thread fThread;
+};
+
+} // namespace mcf
+
+#endif // MCF_TIMERWHEEL_H
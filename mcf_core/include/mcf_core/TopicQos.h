@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_TOPICQOS_H
+#define MCF_TOPICQOS_H
+
+#include "mcf_core/Mutexes.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Delivery behaviour of a topic, see TopicQos
+ */
+struct QosProfile {
+    enum class Reliability {
+        /// writers wait for full receiver queues, the recorder never drops the values
+        RELIABLE,
+        /// full receiver queues drop new values, the recorder drops them when its queue is full
+        BEST_EFFORT
+    };
+
+    /// maximum number of values queued per receiver, 0 for no limit
+    size_t depth = 1;
+    Reliability reliability = Reliability::BEST_EFFORT;
+    /// values waiting longer in a receiver queue are dropped as stale, 0 for no limit
+    std::chrono::milliseconds deadline{0};
+    /// time the topic keeps its latest value for readers, 0 until it is replaced, see
+    /// ValueStore::setRetention()
+    std::chrono::milliseconds lifespan{0};
+    /// priority of the send rules of remote services, higher priorities are served first
+    uint8_t priority = 0;
+};
+
+/**
+ * Named QoS profiles and the topics they apply to, e.g. from the "Qos" section of the system
+ * configuration
+ */
+struct TopicQosConfig {
+    struct Assignment {
+        /// glob pattern of topics, see ValueStore::matchesPattern()
+        std::string pattern;
+        std::string profile;
+    };
+
+    std::map<std::string, QosProfile> profiles;
+    /// the first assignment matching a topic applies
+    std::vector<Assignment> assignments;
+};
+
+/**
+ * The QoS profiles of the topics of a value store, see ValueStore::getTopicQos()
+ *
+ * A profile replaces the per use settings of a topic, so that its delivery is tuned in one place:
+ * - queued receiver ports, including the send rules of remote services, take depth and
+ *   reliability as their queue length and blocking flag, and drop values older than deadline
+ * - sender ports set the retention of their topic to lifespan
+ * - remote send rules take depth, reliability and priority as their queue length, blocking flag
+ *   and priority
+ * - the value recorder records reliable topics as Priority::CRITICAL, unless a priority is set
+ *   for the topic
+ * Profiles are applied when ports are connected and send rules are added, so they should be set
+ * before the components are configured.
+ */
+class TopicQos {
+public:
+    /**
+     * Replace all profiles and assignments
+     *
+     * Throws std::runtime_error if an assignment refers to an unknown profile.
+     */
+    void configure(const TopicQosConfig& config);
+
+    /**
+     * The profile of a topic, nullptr if none applies
+     */
+    std::shared_ptr<const QosProfile> find(const std::string& topic) const;
+
+    bool empty() const;
+
+private:
+    mutable mutex::PriorityInheritanceSharedMutex fMutex;
+    std::vector<std::pair<std::string, std::shared_ptr<const QosProfile>>> fAssignments;
+    // looked up profiles by topic, including topics without profile
+    mutable std::unordered_map<std::string, std::shared_ptr<const QosProfile>> fTopics;
+};
+
+} // namespace mcf
+
+#endif // MCF_TOPICQOS_H
@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_TRACEBUFFER_H
+#define MCF_TRACEBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Kinds of trace records, one per trace event of ComponentTraceEventGenerator
+ */
+enum class TraceEventType : uint8_t {
+    PORT_WRITE,
+    PORT_PEEK,
+    PORT_READ,
+    EXEC_TIME,
+    REMOTE_TRANSFER_TIME,
+    TRIGGER_ACTIVATION,
+    TRIGGER_EXEC,
+    PROGRAM_FLOW,
+    PERF_COUNTERS, ///< counts of a handler run, see TraceRecord::inputIds
+    INPUT_IDS      ///< further input value ids of the following PORT_WRITE or PROGRAM_FLOW record
+};
+
+/**
+ * A trace event in binary form, with its strings interned in the TraceStringTable
+ *
+ * Records have a fixed size, so that they can be written to a ring buffer without allocation.
+ * Events with more than MAX_INPUT_IDS input value ids are preceded by INPUT_IDS records holding
+ * the ids beyond the first MAX_INPUT_IDS, so that a sink has collected them when the event
+ * arrives. The records of an event are written at once and reach a sink in consecutive order.
+ *
+ * PERF_COUNTERS records carry the cycles, instructions, cache misses and branch misses of a
+ * handler run in inputIds (numInputIds is 0) and its context switches in valueId.
+ */
+struct TraceRecord {
+    static constexpr size_t MAX_INPUT_IDS = 4;
+
+    uint64_t time;              ///< time of the event (end time of durations) in microseconds since 1970
+    uint64_t valueId;           ///< id of the value written or read, 0 if none
+    uint64_t triggerTime;       ///< time of the trigger in microseconds since 1970
+    uint32_t sink;              ///< the sink receiving the record, see TraceCollector::addSink()
+    uint32_t traceId;           ///< interned strings
+    uint32_t component;
+    uint32_t topic;             ///< port topic or trigger topic
+    uint32_t name;              ///< description, handler or event name
+    float executionTime;        ///< duration in seconds
+    int32_t threadId;
+    int32_t cpuId;
+    TraceEventType type;
+    uint8_t connected;
+    uint8_t numInputIds;        ///< number of valid inputIds
+    uint8_t tscTime;            ///< time is in TSC ticks, converted by the TraceCollector, see TraceClock
+    uint64_t inputIds[MAX_INPUT_IDS];
+};
+
+/**
+ * Process wide table of the strings of trace records
+ *
+ * Strings get consecutive ids starting with 1, id 0 is the empty string. Interning is lock-free
+ * for strings the calling thread has interned before.
+ */
+class TraceStringTable {
+public:
+    static TraceStringTable& instance();
+
+    /**
+     * The id of a string, which is added to the table on first use
+     */
+    uint32_t intern(const std::string& string);
+
+    /**
+     * The string of an id, the empty string for unknown ids
+     */
+    std::string lookup(uint32_t id) const;
+
+    /**
+     * Number of ids, including the empty string
+     */
+    uint32_t size() const;
+
+private:
+    TraceStringTable() = default;
+
+    mutable std::mutex fMutex;
+    std::unordered_map<std::string, uint32_t> fIds;
+    std::vector<std::string> fStrings{std::string()};
+};
+
+/**
+ * Single producer, single consumer ring buffer of trace records
+ *
+ * The producer is the thread owning the buffer, the consumer the TraceCollector. Neither side
+ * blocks: records which do not fit are dropped and counted.
+ */
+class TraceBuffer {
+public:
+    /**
+     * @param capacity  number of records, rounded up to a power of two
+     */
+    explicit TraceBuffer(size_t capacity);
+
+    TraceBuffer(const TraceBuffer&) = delete;
+    TraceBuffer& operator=(const TraceBuffer&) = delete;
+
+    /**
+     * Append count records, all of them or none (producer side)
+     *
+     * @return false if the records did not fit and were dropped
+     */
+    bool push(const TraceRecord* records, size_t count);
+
+    /**
+     * Move up to maxCount records to out, oldest first (consumer side)
+     *
+     * @return the number of records moved
+     */
+    size_t pop(TraceRecord* out, size_t maxCount);
+
+    size_t capacity() const { return fMask + 1; }
+
+    /// number of records currently in the buffer
+    size_t size() const;
+
+    /// number of records dropped since construction
+    uint64_t dropped() const { return fDropped.load(std::memory_order_relaxed); }
+
+    /// mark the buffer as abandoned by its producer, it is released when empty
+    void close() { fClosed = true; }
+
+    bool isClosed() const { return fClosed; }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    std::unique_ptr<TraceRecord[]> fRecords;
+    const size_t fMask;
+    // the indices written by producer and consumer on cache lines of their own
+    char fPadding0[CACHE_LINE_SIZE];
+    std::atomic<size_t> fHead{0};
+    std::atomic<uint64_t> fDropped{0};
+    char fPadding1[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(std::atomic<uint64_t>)];
+    std::atomic<size_t> fTail{0};
+    std::atomic<bool> fClosed{false};
+};
+
+} // namespace mcf
+
+#endif // MCF_TRACEBUFFER_H
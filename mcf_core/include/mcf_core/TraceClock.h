@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_TRACECLOCK_H
+#define MCF_TRACECLOCK_H
+
+#include "mcf_core/TraceBuffer.h"
+
+#include <cstdint>
+
+namespace mcf {
+
+/**
+ * Timestamps, thread and CPU ids of trace records, taken without system calls
+ *
+ * The thread id is cached per thread, the CPU id is read with the vDSO sched_getcpu(). With the
+ * TSC source, records are stamped with the time stamp counter read by rdtscp, which also yields
+ * the CPU id. The TraceCollector converts the ticks to microseconds since 1970 before passing
+ * the records to the sinks, using a calibration of the TSC against the system clock which it
+ * refines while draining.
+ */
+class TraceClock {
+public:
+    enum class Source {
+        SYSTEM,     ///< the system clock (default)
+        TSC         ///< the time stamp counter, if invariant
+    };
+
+    /**
+     * Calibration of the TSC against the system clock
+     */
+    struct Calibration {
+        uint64_t ticks = 0;                 ///< TSC at the reference time
+        uint64_t microseconds = 0;          ///< reference time in microseconds since 1970
+        double ticksPerMicrosecond = 0.;
+    };
+
+    /**
+     * Select the clock of later records
+     *
+     * Selecting the TSC measures its frequency for a few milliseconds.
+     *
+     * @return false if the TSC is not available or not invariant, the clock is unchanged then
+     */
+    static bool setSource(Source source);
+
+    static Source source();
+
+    /**
+     * Whether the CPU has an invariant TSC usable for timestamps
+     */
+    static bool tscAvailable();
+
+    /**
+     * Set the time, thread and CPU id of a record to the current ones
+     */
+    static void stamp(TraceRecord& record);
+
+    /**
+     * Set the thread and CPU id of a record whose time is given by the caller
+     */
+    static void stampThread(TraceRecord& record);
+
+    /**
+     * The id of the calling thread, as returned by gettid()
+     */
+    static int32_t threadId();
+
+    /**
+     * Convert TSC ticks to microseconds since 1970
+     */
+    static uint64_t toMicroseconds(uint64_t ticks);
+
+    /**
+     * Convert TSC ticks to microseconds since 1970 with the given calibration
+     */
+    static uint64_t toMicroseconds(uint64_t ticks, const Calibration& calibration);
+
+    /**
+     * Refine the frequency of the TSC with the time passed since the first calibration, called
+     * by the TraceCollector
+     */
+    static void recalibrate();
+
+    static Calibration calibration();
+};
+
+} // namespace mcf
+
+#endif // MCF_TRACECLOCK_H
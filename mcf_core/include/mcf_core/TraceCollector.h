@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_TRACECOLLECTOR_H
+#define MCF_TRACECOLLECTOR_H
+
+#include "mcf_core/TraceBuffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Receiver of the trace records drained by the TraceCollector
+ */
+class ITraceSink {
+public:
+    virtual ~ITraceSink() = default;
+
+    /**
+     * Called on the collector thread, or the thread calling TraceCollector::flush(), with
+     * records addressed to the sink, in the order each thread wrote them
+     *
+     * Must not add or remove sinks.
+     */
+    virtual void consume(const TraceRecord* records, size_t count) = 0;
+};
+
+/**
+ * Collects the trace records of all threads, see ComponentTraceEventGenerator
+ *
+ * Each thread writes its records to a TraceBuffer of its own, so that tracing takes no lock,
+ * allocates nothing and wakes no other thread. A collector thread drains the buffers in batches
+ * every drain interval, or earlier when a buffer is half full, and passes the records to the sinks
+ * they are addressed to. Records are dropped if a buffer is full, see statistics(). Times in TSC
+ * ticks are converted to microseconds before, see TraceClock.
+ *
+ * The collector is created on first use and lives until the end of the process.
+ */
+class TraceCollector {
+public:
+    struct Statistics {
+        uint64_t records = 0;   ///< records passed to sinks
+        uint64_t dropped = 0;   ///< records dropped since their buffer was full
+        size_t buffers = 0;     ///< thread buffers currently registered
+    };
+
+    static TraceCollector& instance();
+
+    /**
+     * Register a sink, returns the id to write into TraceRecord::sink
+     */
+    uint32_t addSink(ITraceSink& sink);
+
+    /**
+     * Pass the pending records to the sinks and unregister a sink
+     */
+    void removeSink(uint32_t id);
+
+    /**
+     * Write records to the buffer of the calling thread
+     *
+     * @return false if the records were dropped
+     */
+    bool write(const TraceRecord* records, size_t count);
+
+    /**
+     * Pass all records written so far to the sinks, on the calling thread
+     */
+    void flush();
+
+    /**
+     * Set the interval of the collector thread, and the capacity in records of thread buffers
+     * created later
+     */
+    void configure(std::chrono::milliseconds drainInterval, size_t bufferCapacity);
+
+    Statistics statistics() const;
+
+private:
+    TraceCollector();
+
+    TraceBuffer& localBuffer();
+
+    // called with fMutex held
+    void drain();
+
+    void run();
+
+    mutable std::mutex fMutex;
+    std::condition_variable fWake;
+    std::map<uint32_t, ITraceSink*> fSinks;
+    uint32_t fNextSinkId = 1;
+    std::vector<std::shared_ptr<TraceBuffer>> fBuffers;
+    // buffers of new threads, guarded by a mutex of their own, so that sinks may trace
+    mutable std::mutex fNewBuffersMutex;
+    std::vector<std::shared_ptr<TraceBuffer>> fNewBuffers;
+    std::vector<TraceRecord> fBatch;
+    std::chrono::milliseconds fDrainInterval{10};
+    std::atomic<size_t> fBufferCapacity{4096};
+    uint64_t fRecords = 0;
+    // dropped records of released buffers
+    uint64_t fReleasedDropped = 0;
+};
+
+} // namespace mcf
+
+#endif // MCF_TRACECOLLECTOR_H
@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_TRACEFILTER_H
+#define MCF_TRACEFILTER_H
+
+#include "mcf_core/TraceBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * A rule of the trace filter of a ComponentTraceController
+ *
+ * Events are traced if they match a rule, i.e. their component and topic match the glob patterns
+ * of the rule and their type is one of its event types. Events without topic, e.g. exec times,
+ * only match rules with the topic "*". Of the matching events, every sampling-th is traced, e.g.
+ * 1 in 100 trigger executions of a busy component.
+ */
+struct TraceFilterRule {
+    static constexpr uint32_t ALL_EVENT_TYPES = 0xffffffffu;
+
+    std::string component = "*";            ///< glob pattern of component instance names
+    std::string topic = "*";                ///< glob pattern of port and trigger topics
+    uint32_t eventTypes = ALL_EVENT_TYPES;  ///< bits of traceEventTypeBit()
+    uint32_t sampling = 1;                  ///< trace every sampling-th matching event
+};
+
+/**
+ * The bit of an event type in TraceFilterRule::eventTypes
+ */
+inline uint32_t traceEventTypeBit(TraceEventType type)
+{
+    return 1u << static_cast<uint32_t>(type);
+}
+
+/**
+ * The event type bits of the given names, e.g. "port_write" or "trigger_exec"
+ *
+ * Throws std::runtime_error for unknown names.
+ */
+uint32_t traceEventTypeMask(const std::vector<std::string>& names);
+
+/**
+ * The names of the event types of a mask
+ */
+std::vector<std::string> traceEventTypeNames(uint32_t mask);
+
+/**
+ * The rules of a trace filter applying to one component, compiled when an event generator
+ * starts using the filter
+ */
+class TraceSelection {
+public:
+    /// maximum number of rules of a filter
+    static constexpr size_t MAX_RULES = 64;
+
+    /**
+     * @param rules      the rules of the filter, no rules select all events
+     * @param component  the component instance name
+     */
+    TraceSelection(const std::vector<TraceFilterRule>& rules, const std::string& component);
+
+    /**
+     * Whether to trace an event, counting the events of the rule for sampling
+     *
+     * @param type   the type of the event
+     * @param topic  the topic of the event, nullptr for events without topic
+     */
+    bool select(TraceEventType type, const std::string* topic);
+
+    /**
+     * Whether a rule matches an event, regardless of its sampling
+     */
+    bool matches(TraceEventType type, const std::string* topic);
+
+private:
+    // index of the first rule matching an event, fRules.size() if none
+    size_t findRule(TraceEventType type, const std::string* topic);
+
+    // bits of the rules whose topic pattern matches the topic
+    uint64_t topicMatches(const std::string& topic);
+
+    const bool fAll;
+    std::vector<TraceFilterRule> fRules;
+    std::unique_ptr<std::atomic<uint64_t>[]> fCounters;
+    bool fTopicRules = false;
+    std::mutex fTopicMutex;
+    std::unordered_map<std::string, uint64_t> fTopicMatches;
+};
+
+} // namespace mcf
+
+#endif // MCF_TRACEFILTER_H
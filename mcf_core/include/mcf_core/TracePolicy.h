@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_TRACEPOLICY_H
+#define MCF_TRACEPOLICY_H
+
+#include <atomic>
+
+/**
+ * Set to 0 (CMake option MCF_ENABLE_TRACING=OFF) to compile all component tracing hooks out of
+ * ValueStore, ports, components and port trigger handlers
+ */
+#ifndef MCF_ENABLE_TRACING
+#define MCF_ENABLE_TRACING 1
+#endif
+
+namespace mcf {
+
+/**
+ * Number of ComponentTraceControllers which currently have tracing enabled
+ * (defined in the logger/tracer shared library, maintained by ComponentTraceController)
+ */
+extern std::atomic<int> gActiveTraceControllers;
+
+/**
+ * Trace policy with tracing hooks compiled in
+ *
+ * While no trace controller has tracing enabled, each hook costs a single relaxed atomic load.
+ */
+struct TracingCompiledIn {
+    static constexpr bool COMPILED = true;
+
+    static bool active() {
+        return gActiveTraceControllers.load(std::memory_order_relaxed) > 0;
+    }
+};
+
+/**
+ * Trace policy with tracing hooks compiled out
+ */
+struct TracingCompiledOut {
+    static constexpr bool COMPILED = false;
+
+    static constexpr bool active() {
+        return false;
+    }
+};
+
+/**
+ * Trace policy used by the MCF hot paths, selected by MCF_ENABLE_TRACING
+ */
+#if MCF_ENABLE_TRACING
+using TracePolicy = TracingCompiledIn;
+#else
+using TracePolicy = TracingCompiledOut;
+#endif
+
+} // namespace mcf
+
+#endif // MCF_TRACEPOLICY_H
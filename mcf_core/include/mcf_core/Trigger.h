@@ -8,66 +8,210 @@
 #include "mcf_core/Mutexes.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <vector>
 
 namespace mcf {
 
 
+namespace detail {
+
+/**
+ * Hint to the CPU that the calling thread is busy-waiting
+ */
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+} // namespace detail
+
+
 /**
  *  A Trigger object is used to unblock threads waiting on it
+ *
+ *  The state is a single futex word. trigger() only issues a wake system call if a waiter is
+ *  actually sleeping, triggering a running or spinning waiter costs a single atomic exchange.
+ *
+ *  With a spin duration set, wait() first busy-polls for a trigger for up to that duration before
+ *  blocking, which saves the wakeup latency of a blocked thread at the cost of CPU time.
  */
 class Trigger : public ITriggerable {
 public:
-    Trigger() : fActive(false)
-    {}
+    Trigger() = default;
+
+    ~Trigger() override { detachTriggerSources(); }
 
     void wait() {
-        std::unique_lock<std::mutex> lk(fMutex);
-        fCv.wait(lk, [this]{return fActive;});
-        fActive = false;
+        const int64_t spin = fSpinNs.load(std::memory_order_relaxed);
+        if (spin > 0 && spinWait(spin)) {
+            return;
+        }
+        waitBlocking();
     }
 
     void trigger() override {
         // TODO: add component trace event
-        std::lock_guard<std::mutex> lk(fMutex);
-        fActive = true;
-        fCv.notify_all();
+        if (fState.exchange(ACTIVE, std::memory_order_acq_rel) == SLEEPING) {
+            wakeSleepers();
+        }
     }
 
+    /**
+     * Repeated triggers before wait() returns are merged anyway
+     */
+    bool isCoalescable() const override { return true; }
+
+    /**
+     * Set the time wait() busy-polls before blocking, zero (the default) blocks right away
+     */
+    void setSpinDuration(std::chrono::nanoseconds duration) {
+        fSpinNs.store(std::max<int64_t>(0, duration.count()), std::memory_order_relaxed);
+    }
+
+    std::chrono::nanoseconds getSpinDuration() const {
+        return std::chrono::nanoseconds(fSpinNs.load(std::memory_order_relaxed));
+    }
+
+private:
+    /**
+     * Poll for a trigger for the given time, returns true if triggered
+     */
+    bool spinWait(int64_t spinNs) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(spinNs);
+        while (true) {
+            // reading the clock is more expensive than polling
+            for (int i = 0; i < 64; ++i) {
+                uint32_t state = ACTIVE;
+                if (fState.load(std::memory_order_relaxed) == ACTIVE
+                    && fState.compare_exchange_strong(state, IDLE, std::memory_order_acquire)) {
+                    return true;
+                }
+                detail::cpuRelax();
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * Sleep on the futex word until triggered
+     */
+    void waitBlocking();
+
+    void wakeSleepers();
+
+    // values of the futex word: not triggered, triggered, not triggered with waiters sleeping
+    static constexpr uint32_t IDLE = 0;
+    static constexpr uint32_t ACTIVE = 1;
+    static constexpr uint32_t SLEEPING = 2;
+
+    std::atomic<uint32_t> fState{IDLE};
+    std::atomic<int64_t> fSpinNs{0};
+};
+
+
+/**
+ *  A TriggerBatch collects coalescable trigger events of the current thread while it is alive.
+ *  Each collected triggerable is called exactly once when the batch is destroyed.
+ *
+ *  Batches may be nested, in which case the outermost batch collects all events.
+ */
+class TriggerBatch {
+public:
+    TriggerBatch();
+    ~TriggerBatch();
+
+    TriggerBatch(const TriggerBatch&) = delete;
+    TriggerBatch& operator=(const TriggerBatch&) = delete;
+
+    /**
+     * The batch currently collecting trigger events of the calling thread, or nullptr
+     */
+    static TriggerBatch* current();
+
+    /**
+     * Add a triggerable to be called at the end of the batch, duplicates are ignored
+     */
+    void add(const std::shared_ptr<ITriggerable>& triggerable);
+
 private:
-    std::mutex fMutex;
-    std::condition_variable fCv;
-    bool fActive;
+    bool fOutermost;
+    std::vector<std::shared_ptr<ITriggerable>> fTriggerables;
+};
+
+
+/**
+ *  An InlineDispatch collects inline trigger events of the current thread while it is alive,
+ *  see ITriggerable::isInline(). The owner calls run() once it holds no more locks, which calls
+ *  triggerInline() for each collected triggerable exactly once.
+ *
+ *  Dispatches may be nested, each one collecting the events raised while it is the innermost.
+ *  Events not run when the dispatch is destroyed, e.g. due to an exception, fall back to trigger().
+ */
+class InlineDispatch {
+public:
+    InlineDispatch();
+    ~InlineDispatch();
+
+    InlineDispatch(const InlineDispatch&) = delete;
+    InlineDispatch& operator=(const InlineDispatch&) = delete;
+
+    /**
+     * The dispatch currently collecting inline trigger events of the calling thread, or nullptr
+     */
+    static InlineDispatch* current();
+
+    /**
+     * Add a triggerable to be run inline at the end of the dispatch, duplicates are ignored
+     */
+    void add(const std::shared_ptr<ITriggerable>& triggerable);
+
+    /**
+     * Stop collecting and run the collected triggerables on the calling thread
+     */
+    void run();
+
+private:
+    void close();
+
+    InlineDispatch* fPrevious;
+    bool fOpen;
+    std::vector<std::shared_ptr<ITriggerable>> fTriggerables;
 };
 
 
 /**
  *  A TriggerSource can be setup to notify Triggerable objects when
  *  some event happens.
+ *
+ *  Sources and triggerables are linked both ways: a triggerable removes itself from its sources
+ *  when it is destroyed, and a source from its triggerables, see ITriggerable. Notifying thus
+ *  calls the triggerables through plain pointers, without taking a reference to them. Only
+ *  triggers deferred to a TriggerBatch or an InlineDispatch are passed on as shared pointers.
+ *  The source keeps weak references only, it does not keep its triggerables alive.
  */
 class TriggerSource {
 public:
     TriggerSource() = default;
 
-    void addTrigger(const std::shared_ptr<ITriggerable>& triggerable) {
-        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-        auto it = std::find_if(fTriggerables.begin(),
-                               fTriggerables.end(),
-                               [triggerable](const std::weak_ptr<ITriggerable>& e) { return e.lock() == triggerable; });
-        if (it == fTriggerables.end()) {
-            fTriggerables.push_back(triggerable);
-        }
-    }
+    TriggerSource(const TriggerSource&) = delete;
+    TriggerSource& operator=(const TriggerSource&) = delete;
 
-    void removeTrigger(const std::shared_ptr<ITriggerable>& triggerable) {
-        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-        fTriggerables.erase(std::remove_if(fTriggerables.begin(),
-                                           fTriggerables.end(),
-                                           [triggerable](const std::weak_ptr<ITriggerable>& e) { return e.lock() == triggerable; }),
-                            fTriggerables.end());
-    }
+    ~TriggerSource();
+
+    void addTrigger(const std::shared_ptr<ITriggerable>& triggerable);
+
+    void removeTrigger(const std::shared_ptr<ITriggerable>& triggerable);
 
 protected:
 
@@ -76,29 +220,50 @@ protected:
      * Note: fMutex must be locked by the caller before calling this method
      */
     void notifyTriggers() {
-        bool found_expired = false;
-        for (const auto& trigger : fTriggerables) {
-            auto sp_trigger = trigger.lock();
-            if (sp_trigger != nullptr) {
-                sp_trigger->trigger();
+        for (const auto& registration : fTriggerables) {
+            // safe to call while registered: a triggerable unlinks itself first thing in its
+            // destructor, which waits for fMutex and thus for this notification to finish
+            ITriggerable* triggerable = registration.triggerable;
+            // the last owner is gone, the triggerable is about to unlink itself
+            if (registration.owner.expired()) {
+                continue;
+            }
+            InlineDispatch* dispatch = triggerable->isInline() ? InlineDispatch::current() : nullptr;
+            if (dispatch != nullptr) {
+                if (auto owner = registration.owner.lock()) {
+                    dispatch->add(owner);
+                }
+                continue;
+            }
+            TriggerBatch* batch = triggerable->isCoalescable() ? TriggerBatch::current() : nullptr;
+            if (batch != nullptr) {
+                if (auto owner = registration.owner.lock()) {
+                    batch->add(owner);
+                }
             }
             else {
-                found_expired = true;
+                triggerable->trigger();
             }
         }
-        // cleanup expired weak pointers
-        if (found_expired) {
-            fTriggerables.erase(std::remove_if(fTriggerables.begin(),
-                                               fTriggerables.end(),
-                                               [](const std::weak_ptr<ITriggerable>& ptr) { return ptr.expired(); }),
-                                fTriggerables.end());
-        }
     }
 
     mutex::PriorityInheritanceMutex fMutex;
 
 private:
-    std::vector<std::weak_ptr<ITriggerable>> fTriggerables;
+    friend class ITriggerable;
+
+    struct Registration {
+        ITriggerable* triggerable;
+        // for deferred triggers, which need to keep the triggerable alive
+        std::weak_ptr<ITriggerable> owner;
+    };
+
+    /**
+     * Remove the registration of triggerable, with the registration mutex locked
+     */
+    void unlink(ITriggerable* triggerable);
+
+    std::vector<Registration> fTriggerables;
 };
 
 }
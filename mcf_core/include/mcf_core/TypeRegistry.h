@@ -6,29 +6,111 @@
 
 #include "mcf_core/Value.h"
 #include "mcf_core/IExtMemValue.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/PodValue.h"
+#include "mcf_core/ValuePool.h"
 
 #include "msgpack.hpp"
 
+#include <cstdint>
+#include <cstring>
 #include <functional>
-#include <map>
 #include <memory>
 #include <string>
 #include <typeindex>
 #include <typeinfo>
+#include <unordered_map>
+#include <vector>
 
 namespace mcf {
 
 using ValuePtr = std::shared_ptr<const Value>;
 
+/**
+ * The serialization of a value, computed once and shared by all consumers of the value
+ */
+struct PackedValue {
+    std::vector<char> data;
+    /// ext mem data of the value, as returned by the pack function
+    const void* extMem = nullptr;
+    size_t extMemSize = 0;
+};
+
+/**
+ * msgpack stream writing into a preallocated buffer, e.g. the data of a 0MQ message or a region
+ * of shared memory. Throws std::runtime_error if the buffer is too small.
+ */
+class SpanWriter {
+public:
+    SpanWriter(void* data, size_t size) : fData(static_cast<char*>(data)), fSize(size) {}
+
+    void write(const char* buf, size_t len) {
+        MCF_ASSERT(len <= fSize - fPos, "SpanWriter: buffer too small for packed value");
+        std::memcpy(fData + fPos, buf, len);
+        fPos += len;
+    }
+
+    /// number of bytes written so far
+    size_t size() const { return fPos; }
+
+private:
+    char* fData;
+    size_t fSize;
+    size_t fPos = 0;
+};
+
+/**
+ * msgpack stream only counting the written bytes, to size a buffer before packing into it
+ */
+class SizeCounter {
+public:
+    void write(const char*, size_t len) { fSize += len; }
+
+    size_t size() const { return fSize; }
+
+private:
+    size_t fSize = 0;
+};
+
 class TypeRegistry {
 public:
     using UnpackFunc = std::function<Value*(msgpack::object&, const void*, size_t, bool& isExtMem)>;
     using PackFunc = std::function<void(msgpack::packer<msgpack::sbuffer>&, ValuePtr, const void*&, size_t&, bool getPtr)>;
 
+    /**
+     * Statically dispatched serialization of one registered type
+     *
+     * Generated by registerType<T>() with one pack function per supported stream, see pack().
+     * Unlike PackFunc and UnpackFunc, calls are not type erased and the value is not checked
+     * for its type: entries are looked up by the dynamic type of the value.
+     */
+    struct Codec {
+        void (*packBuffer)(msgpack::packer<msgpack::sbuffer>&, const Value&);
+        void (*packSpan)(msgpack::packer<SpanWriter>&, const Value&);
+        void (*packSize)(msgpack::packer<SizeCounter>&, const Value&);
+        /// ext mem data of the value, nullptr and 0 for types without ext mem
+        const void* (*extMemPtr)(const Value&);
+        size_t (*extMemSize)(const Value&);
+        Value* (*unpack)(const msgpack::object&, const void* extMem, size_t len);
+        /// like unpack, decoding into a shared value which is taken from its value pool if it uses one
+        std::shared_ptr<Value> (*unpackShared)(const msgpack::object&, const void* extMem, size_t len);
+        bool isExtMem;
+        /// packed size of types in the POD format (see mcf_core/PodValue.h), 0 for other types
+        size_t podSize;
+    };
+
     struct TypemapEntry {
         std::string id;
+        /// stable 64 bit id of the type, sent instead of the id where the peer supports it, see numericTypeId()
+        uint64_t numericId = 0;
         PackFunc packFunc;
         UnpackFunc unpackFunc;
+        /// set for types registered with registerType(), which pack and unpack through it
+        const Codec* codec = nullptr;
+        /// the C++ type the entry was registered for
+        const std::type_info* type = nullptr;
+        /// values are serialized once for all consumers, see enableSerializationCache()
+        bool cacheSerialization = false;
     };
 
     template<typename T, typename=void>
@@ -45,17 +127,198 @@ public:
         static UnpackFunc unpackFunc(const std::string&);
     };
 
+    template<typename T, typename=void>
+    class CodecGen {
+    public:
+        static const Codec codec;
+
+        template<typename Stream>
+        static void pack(msgpack::packer<Stream>& packer, const Value& value) {
+            packer.pack(static_cast<const T&>(value));
+        }
+        static const void* extMemPtr(const Value&) { return nullptr; }
+        static size_t extMemSize(const Value&) { return 0; }
+        static Value* unpack(const msgpack::object& obj, const void*, size_t) { return new T(obj.as<T>()); }
+        static std::shared_ptr<Value> unpackShared(const msgpack::object& obj, const void*, size_t) {
+            return createUnpacked<T>(obj);
+        }
+    };
+
+    template<typename T>
+    class CodecGen<T, typename std::enable_if<std::is_base_of<IExtMemValue, T>::value>::type> {
+    public:
+        static const Codec codec;
+
+        template<typename Stream>
+        static void pack(msgpack::packer<Stream>& packer, const Value& value) {
+            packer.pack(static_cast<const T&>(value));
+        }
+        static const void* extMemPtr(const Value& value) {
+            return static_cast<const void*>(static_cast<const T&>(value).extMemPtr());
+        }
+        static size_t extMemSize(const Value& value) { return static_cast<const T&>(value).extMemSize(); }
+        static Value* unpack(const msgpack::object& obj, const void* ptr, size_t len);
+        static std::shared_ptr<Value> unpackShared(const msgpack::object& obj, const void* ptr, size_t len);
+    };
+
+    /**
+     * Numeric id of a type registered with the passed id: T::MCF_TYPE_ID for generated types,
+     * which is a hash of the type name and its attributes computed by the types generator, the
+     * FNV-1a hash of the id for all other types
+     *
+     * Both ends of a connection compute the same numeric id for a type of the same definition,
+     * so it can replace the type name on the wire without exchanging a table of types.
+     */
+    template<typename T>
+    static uint64_t numericTypeId(const std::string& id);
+
+    static uint64_t hashTypeId(const std::string& id);
+
+    /**
+     * Register a type under the passed id
+     *
+     * Throws std::runtime_error if the numeric id of the type collides with the one of another
+     * registered type.
+     */
     template<typename T>
     void registerType(const std::string& str);
 
+    /**
+     * Register all types of another registry which are not registered in this one yet
+     *
+     * Lets several value stores share the types registered once, e.g. by the plugins of a
+     * process. Types registered afterwards in the other registry are not taken over.
+     */
+    void registerTypes(const TypeRegistry& other);
+
+    /**
+     * Look up types which are not registered in this registry in base as well, without copying
+     * them
+     *
+     * Lets many registries, e.g. the value stores of tests or of a parallel replay, share types
+     * registered once per process instead of building the entries of all types for each of them.
+     * Bases are searched after this registry, in the order they were added. Types registered in
+     * this registry take precedence over the ones of the bases.
+     *
+     * base must outlive this registry and must not register further types while it is referenced.
+     */
+    void addBase(const TypeRegistry& base);
+
+    /**
+     * Return a copy of the type info of the given value or nullptr, if the type is not registered
+     *
+     * Note: this allocates, prefer findTypeInfo() on frequently called paths.
+     */
     std::unique_ptr<TypemapEntry> getTypeInfo(const Value& value) const;
     std::unique_ptr<TypemapEntry> getTypeInfo(const std::string& id) const;
 
+    /**
+     * Look up the type info of the given value without allocating
+     *
+     * The returned pointer stays valid for the lifetime of the registry, also if further types
+     * are registered. Returns nullptr if the type is not registered.
+     */
+    const TypemapEntry* findTypeInfo(const Value& value) const;
+    const TypemapEntry* findTypeInfo(const std::string& id) const;
+    const TypemapEntry* findTypeInfo(uint64_t numericId) const;
+
+    /**
+     * Serialize the values of a registered type only once
+     *
+     * The first consumer of a value (e.g. the recorder, the remote sender or
+     * getValueMsgpackHandle()) attaches its serialization to the value, the others reuse it.
+     * This pays off for types which are large to serialize and consumed more than once, the
+     * serialization is kept in memory as long as the value. Enable before values of the type
+     * are published, throws std::runtime_error if the type is not registered.
+     */
+    void enableSerializationCache(const std::string& id);
+
+    /**
+     * Append the serialization of a value to buffer, like typeInfo.packFunc, reusing the cached
+     * serialization if the type has the serialization cache enabled
+     *
+     * @param ptr, len receive the ext mem data of the value if getPtr is set, nullptr and 0
+     *                 otherwise
+     */
+    static void packValue(msgpack::sbuffer& buffer, const ValuePtr& value, const TypemapEntry& typeInfo,
+                          const void*& ptr, size_t& len, bool getPtr);
+
+    /**
+     * Pack a value of the type of typeInfo, without its ext mem data, directly into the stream
+     * of the packer. Bypasses the serialization cache.
+     */
+    static void pack(msgpack::packer<msgpack::sbuffer>& packer, const Value& value, const TypemapEntry& typeInfo);
+    static void pack(msgpack::packer<SpanWriter>& packer, const Value& value, const TypemapEntry& typeInfo);
+
+    /**
+     * Return the number of bytes pack() writes for the value, e.g. to pack it into a SpanWriter
+     */
+    static size_t packedSize(const Value& value, const TypemapEntry& typeInfo);
+
+    /**
+     * Unpack a value of the type of typeInfo, like typeInfo.unpackFunc
+     *
+     * @param ptr, len    ext mem data copied into the value, if the type has ext mem
+     * @param isExtMem    receives whether the type has ext mem
+     */
+    static Value* unpackValue(const TypemapEntry& typeInfo, msgpack::object& obj, const void* ptr, size_t len,
+                              bool& isExtMem);
+
+    /**
+     * Unpack a value like unpackValue() into a shared value, in a single allocation for the value
+     * and its reference count
+     *
+     * Values of types using a value pool (see UseValuePool) are decoded directly into memory
+     * recycled by the pool, so that receiving values of such types does not allocate in steady
+     * state. The value is not const yet, e.g. to inject its id.
+     */
+    static std::shared_ptr<Value> unpackSharedValue(const TypemapEntry& typeInfo, msgpack::object& obj,
+                                                    const void* ptr, size_t len, bool& isExtMem);
+
 private:
-    std::map<std::type_index, TypemapEntry> fByTypeIndex;
-    std::map<std::string, TypemapEntry> fByTypeId;
+    /**
+     * Pack a value like typeInfo.packFunc, through the codec of the type if there is one
+     */
+    static void packUncached(msgpack::packer<msgpack::sbuffer>& packer, const ValuePtr& value,
+                             const TypemapEntry& typeInfo, const void*& ptr, size_t& len, bool getPtr);
+
+    const TypemapEntry* findByTypeIndex(std::type_index type) const;
+
+    /**
+     * Add a copy of an entry, e.g. of a base registry
+     */
+    TypemapEntry& addEntry(std::type_index type, const TypemapEntry& entry);
+
+    // node based containers: references to elements are not invalidated by insertion
+    std::unordered_map<std::type_index, TypemapEntry> fByTypeIndex;
+    std::unordered_map<std::string, const TypemapEntry*> fByTypeId;
+    std::unordered_map<uint64_t, const TypemapEntry*> fByNumericId;
+    // shared registries searched for types not registered here, see addBase()
+    std::vector<const TypeRegistry*> fBases;
+
+    template<typename T, typename=void>
+    struct HasTypeId : std::false_type {};
+
+    /**
+     * Allocate a value of type T, from its value pool if it uses one, and convert the msgpack
+     * object directly into it
+     */
+    template<typename T>
+    static std::shared_ptr<T> createUnpacked(const msgpack::object& obj);
+    template<typename T>
+    static std::shared_ptr<T> allocateUnpacked(std::true_type);
+    template<typename T>
+    static std::shared_ptr<T> allocateUnpacked(std::false_type);
+
+    template<typename T>
+    static uint64_t numericTypeId(const std::string& id, std::true_type);
+    template<typename T>
+    static uint64_t numericTypeId(const std::string& id, std::false_type);
 };
 
+template<typename T>
+struct TypeRegistry::HasTypeId<T, decltype(void(T::MCF_TYPE_ID))> : std::true_type {};
+
 
 
 template<typename T, typename U>
@@ -111,36 +374,295 @@ TypeRegistry::FuncGen<T, typename std::enable_if<std::is_base_of<IExtMemValue, T
 }
 
 
+template<typename T, typename U>
+const TypeRegistry::Codec TypeRegistry::CodecGen<T, U>::codec = {
+    &CodecGen<T, U>::template pack<msgpack::sbuffer>,
+    &CodecGen<T, U>::template pack<SpanWriter>,
+    &CodecGen<T, U>::template pack<SizeCounter>,
+    &CodecGen<T, U>::extMemPtr,
+    &CodecGen<T, U>::extMemSize,
+    &CodecGen<T, U>::unpack,
+    &CodecGen<T, U>::unpackShared,
+    false,
+    pod::PackedSize<T>::value
+};
+
+template<typename T>
+const TypeRegistry::Codec
+TypeRegistry::CodecGen<T, typename std::enable_if<std::is_base_of<IExtMemValue, T>::value>::type>::codec = {
+    &CodecGen<T>::template pack<msgpack::sbuffer>,
+    &CodecGen<T>::template pack<SpanWriter>,
+    &CodecGen<T>::template pack<SizeCounter>,
+    &CodecGen<T>::extMemPtr,
+    &CodecGen<T>::extMemSize,
+    &CodecGen<T>::unpack,
+    &CodecGen<T>::unpackShared,
+    true,
+    pod::PackedSize<T>::value
+};
+
+template<typename T>
+Value*
+TypeRegistry::CodecGen<T, typename std::enable_if<std::is_base_of<IExtMemValue, T>::value>::type>::unpack(
+    const msgpack::object& obj, const void* ptr, size_t len) {
+    T* valptr = new T(obj.as<T>());
+    if (len > 0 && ptr != nullptr) {
+        valptr->extMemInit(len);
+        memcpy(static_cast<void*>(valptr->extMemPtr()), ptr, len);
+    }
+    return valptr;
+}
+
+template<typename T>
+std::shared_ptr<Value>
+TypeRegistry::CodecGen<T, typename std::enable_if<std::is_base_of<IExtMemValue, T>::value>::type>::unpackShared(
+    const msgpack::object& obj, const void* ptr, size_t len) {
+    std::shared_ptr<T> value = createUnpacked<T>(obj);
+    if (len > 0 && ptr != nullptr) {
+        value->extMemInit(len);
+        memcpy(static_cast<void*>(value->extMemPtr()), ptr, len);
+    }
+    return value;
+}
+
+template<typename T>
+std::shared_ptr<T> TypeRegistry::createUnpacked(const msgpack::object& obj) {
+    std::shared_ptr<T> value = allocateUnpacked<T>(UseValuePool<T>());
+    obj.convert(*value);
+    return value;
+}
+
+template<typename T>
+std::shared_ptr<T> TypeRegistry::allocateUnpacked(std::true_type) {
+    return std::allocate_shared<T>(ValuePoolAllocator<T>());
+}
+
+template<typename T>
+std::shared_ptr<T> TypeRegistry::allocateUnpacked(std::false_type) {
+    return std::make_shared<T>();
+}
+
+inline uint64_t TypeRegistry::hashTypeId(const std::string& id) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char c : id) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+template<typename T>
+uint64_t TypeRegistry::numericTypeId(const std::string& id) {
+    return numericTypeId<T>(id, HasTypeId<T>());
+}
+
+template<typename T>
+uint64_t TypeRegistry::numericTypeId(const std::string&, std::true_type) {
+    return T::MCF_TYPE_ID;
+}
+
+template<typename T>
+uint64_t TypeRegistry::numericTypeId(const std::string& id, std::false_type) {
+    return hashTypeId(id);
+}
+
 template<typename T>
 void TypeRegistry::registerType(const std::string& str) {
-    TypemapEntry e;
+    // assert to prevent having twice the same type
+    assert( fByTypeIndex.find(std::type_index(typeid(T))) == fByTypeIndex.end() );
+    const uint64_t numericId = numericTypeId<T>(str);
+    const TypemapEntry* other = findTypeInfo(numericId);
+    MCF_ASSERT(other == nullptr || other->id == str,
+               "Numeric id of type " + str + " collides with the one of " + (other ? other->id : ""));
+    TypemapEntry& e = fByTypeIndex[std::type_index(typeid(T))];
     e.id = str;
+    e.numericId = numericId;
     e.packFunc = FuncGen<T>::packFunc(str);
     e.unpackFunc = FuncGen<T>::unpackFunc(str);
-    // assert to prevent having twice the same type
-    assert( fByTypeIndex.find(std::type_index(typeid(T))) == fByTypeIndex.end() );
-    fByTypeIndex[std::type_index(typeid(T))] = e;
-    fByTypeId[e.id] = e;
+    e.codec = &CodecGen<T>::codec;
+    e.type = &typeid(T);
+    fByTypeId[e.id] = &e;
+    fByNumericId[e.numericId] = &e;
 }
 
 inline std::unique_ptr<TypeRegistry::TypemapEntry> TypeRegistry::getTypeInfo(const Value& value) const {
-    try {
-        return std::make_unique<TypemapEntry>(fByTypeIndex.at((std::type_index(typeid(value)))));
-    }
-    catch (std::out_of_range& e) {
+    const TypemapEntry* entry = findTypeInfo(value);
+    if (entry == nullptr) {
         return std::unique_ptr<TypemapEntry>();
     }
+    return std::make_unique<TypemapEntry>(*entry);
 }
 
 inline std::unique_ptr<TypeRegistry::TypemapEntry> TypeRegistry::getTypeInfo(const std::string& id) const {
-    try {
-        return std::make_unique<TypemapEntry>(fByTypeId.at(id));
-    }
-    catch (std::out_of_range& e) {
+    const TypemapEntry* entry = findTypeInfo(id);
+    if (entry == nullptr) {
         return std::unique_ptr<TypemapEntry>();
     }
+    return std::make_unique<TypemapEntry>(*entry);
+}
+
+inline const TypeRegistry::TypemapEntry* TypeRegistry::findTypeInfo(const Value& value) const {
+    return findByTypeIndex(std::type_index(typeid(value)));
+}
+
+inline const TypeRegistry::TypemapEntry* TypeRegistry::findByTypeIndex(std::type_index type) const {
+    auto it = fByTypeIndex.find(type);
+    if (it != fByTypeIndex.end()) {
+        return &it->second;
+    }
+    for (const TypeRegistry* base : fBases) {
+        const TypemapEntry* entry = base->findByTypeIndex(type);
+        if (entry != nullptr) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+inline const TypeRegistry::TypemapEntry* TypeRegistry::findTypeInfo(const std::string& id) const {
+    auto it = fByTypeId.find(id);
+    if (it != fByTypeId.end()) {
+        return it->second;
+    }
+    for (const TypeRegistry* base : fBases) {
+        const TypemapEntry* entry = base->findTypeInfo(id);
+        if (entry != nullptr) {
+            return entry;
+        }
+    }
+    return nullptr;
 }
 
+inline const TypeRegistry::TypemapEntry* TypeRegistry::findTypeInfo(uint64_t numericId) const {
+    auto it = fByNumericId.find(numericId);
+    if (it != fByNumericId.end()) {
+        return it->second;
+    }
+    for (const TypeRegistry* base : fBases) {
+        const TypemapEntry* entry = base->findTypeInfo(numericId);
+        if (entry != nullptr) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+inline TypeRegistry::TypemapEntry& TypeRegistry::addEntry(std::type_index type, const TypemapEntry& entry) {
+    TypemapEntry& e = fByTypeIndex[type];
+    e = entry;
+    fByTypeId[e.id] = &e;
+    fByNumericId[e.numericId] = &e;
+    return e;
+}
+
+inline void TypeRegistry::registerTypes(const TypeRegistry& other) {
+    for (const auto& entry : other.fByTypeIndex) {
+        if (findByTypeIndex(entry.first) == nullptr) {
+            addEntry(entry.first, entry.second);
+        }
+    }
+    for (const TypeRegistry* base : other.fBases) {
+        registerTypes(*base);
+    }
+}
+
+inline void TypeRegistry::addBase(const TypeRegistry& base) {
+    MCF_ASSERT(&base != this, "A type registry cannot be its own base");
+    fBases.push_back(&base);
+}
+
+inline void TypeRegistry::enableSerializationCache(const std::string& id) {
+    const TypemapEntry* entry = findTypeInfo(id);
+    if (entry == nullptr) {
+        MCF_THROW_RUNTIME("Cannot cache serializations of unregistered type " + id);
+    }
+    const std::type_index type(*entry->type);
+    auto it = fByTypeIndex.find(type);
+    if (it == fByTypeIndex.end()) {
+        // the entries of a base are shared with other registries, cache for this one only
+        addEntry(type, *entry).cacheSerialization = true;
+        return;
+    }
+    it->second.cacheSerialization = true;
+}
+
+inline void TypeRegistry::packValue(msgpack::sbuffer& buffer, const ValuePtr& value, const TypemapEntry& typeInfo,
+                                    const void*& ptr, size_t& len, bool getPtr) {
+    if (!typeInfo.cacheSerialization) {
+        msgpack::packer<msgpack::sbuffer> pk(&buffer);
+        packUncached(pk, value, typeInfo, ptr, len, getPtr);
+        return;
+    }
+    std::shared_ptr<const PackedValue> packed = std::atomic_load(&value->_packed);
+    if (packed == nullptr) {
+        static thread_local msgpack::sbuffer packBuffer;
+        packBuffer.clear();
+        msgpack::packer<msgpack::sbuffer> pk(&packBuffer);
+        auto created = std::make_shared<PackedValue>();
+        packUncached(pk, value, typeInfo, created->extMem, created->extMemSize, true);
+        created->data.assign(packBuffer.data(), packBuffer.data() + packBuffer.size());
+        // consumers packing concurrently agree on the first serialization
+        packed = created;
+        std::shared_ptr<const PackedValue> expected;
+        if (!std::atomic_compare_exchange_strong(&value->_packed, &expected, packed)) {
+            packed = expected;
+        }
+    }
+    buffer.write(packed->data.data(), packed->data.size());
+    ptr = getPtr ? packed->extMem : nullptr;
+    len = getPtr ? packed->extMemSize : 0;
+}
+
+inline void TypeRegistry::packUncached(msgpack::packer<msgpack::sbuffer>& packer, const ValuePtr& value,
+                                       const TypemapEntry& typeInfo, const void*& ptr, size_t& len, bool getPtr) {
+    if (typeInfo.codec == nullptr) {
+        typeInfo.packFunc(packer, value, ptr, len, getPtr);
+        return;
+    }
+    typeInfo.codec->packBuffer(packer, *value);
+    ptr = getPtr ? typeInfo.codec->extMemPtr(*value) : nullptr;
+    len = getPtr ? typeInfo.codec->extMemSize(*value) : 0;
+}
+
+inline void TypeRegistry::pack(msgpack::packer<msgpack::sbuffer>& packer, const Value& value,
+                               const TypemapEntry& typeInfo) {
+    MCF_ASSERT(typeInfo.codec != nullptr, "No codec for type " + typeInfo.id);
+    typeInfo.codec->packBuffer(packer, value);
+}
+
+inline void TypeRegistry::pack(msgpack::packer<SpanWriter>& packer, const Value& value,
+                               const TypemapEntry& typeInfo) {
+    MCF_ASSERT(typeInfo.codec != nullptr, "No codec for type " + typeInfo.id);
+    typeInfo.codec->packSpan(packer, value);
+}
+
+inline size_t TypeRegistry::packedSize(const Value& value, const TypemapEntry& typeInfo) {
+    MCF_ASSERT(typeInfo.codec != nullptr, "No codec for type " + typeInfo.id);
+    if (typeInfo.codec->podSize > 0) {
+        return typeInfo.codec->podSize;
+    }
+    SizeCounter counter;
+    msgpack::packer<SizeCounter> packer(&counter);
+    typeInfo.codec->packSize(packer, value);
+    return counter.size();
+}
+
+inline Value* TypeRegistry::unpackValue(const TypemapEntry& typeInfo, msgpack::object& obj, const void* ptr,
+                                        size_t len, bool& isExtMem) {
+    if (typeInfo.codec == nullptr) {
+        return typeInfo.unpackFunc(obj, ptr, len, isExtMem);
+    }
+    isExtMem = typeInfo.codec->isExtMem;
+    return typeInfo.codec->unpack(obj, ptr, len);
+}
+
+inline std::shared_ptr<Value> TypeRegistry::unpackSharedValue(const TypemapEntry& typeInfo, msgpack::object& obj,
+                                                              const void* ptr, size_t len, bool& isExtMem) {
+    if (typeInfo.codec == nullptr) {
+        return std::shared_ptr<Value>(typeInfo.unpackFunc(obj, ptr, len, isExtMem));
+    }
+    isExtMem = typeInfo.codec->isExtMem;
+    return typeInfo.codec->unpackShared(obj, ptr, len);
+}
 
 } // namespace mcf
 
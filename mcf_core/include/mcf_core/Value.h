@@ -5,23 +5,37 @@
 #define MCF_VALUE_H_
 
 #include <cstdint>
+#include <memory>
 
 namespace mcf
 {
 
 class TypeRegistry;
+struct PackedValue;
 
 class Value
 {
     friend class IidGenerator;
+    friend class TypeRegistry;
 public:
     Value() = default;
-    Value(const Value& v) = default;
-    Value(Value&& v) = default;
+    // the cached serialization belongs to the original value and is not copied
+    Value(const Value& v) : _id(v._id) {}
+    Value(Value&& v) noexcept : _id(v._id) {}
     virtual ~Value()      = default;
 
-    Value& operator=(const Value& v) = default;
-    Value& operator=(Value&& v) = default;
+    Value& operator=(const Value& v)
+    {
+        _id = v._id;
+        _packed.reset();
+        return *this;
+    }
+    Value& operator=(Value&& v) noexcept
+    {
+        _id = v._id;
+        _packed.reset();
+        return *this;
+    }
 
     uint64_t id() const
     {
@@ -30,8 +44,21 @@ public:
 
 private:
     uint64_t _id = 0;
+    // serialization shared by the consumers of the value, see TypeRegistry::packValue()
+    mutable std::shared_ptr<const PackedValue> _packed;
 };
 
+/**
+ * A default constructed T shared by all reads which have no value to return, e.g. getValue() of
+ * an unconnected port, so that such reads do not allocate
+ */
+template<typename T>
+const std::shared_ptr<const T>& defaultValue()
+{
+    static const std::shared_ptr<const T> instance = std::make_shared<const T>();
+    return instance;
+}
+
 } // namespace mcf
 
 #endif
@@ -5,7 +5,11 @@
 #ifndef MCF_VALUEFACTORY_H_
 #define MCF_VALUEFACTORY_H_
 
+#include "mcf_core/ValuePool.h"
+
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 namespace mcf
 {
@@ -13,6 +17,9 @@ namespace mcf
 /**
  * Factory class for "standard" values, designed to be used with a child class of mcf::Value.
  * It creates a value from an instance of such a class and wrapping it into a std::shared_ptr to a const.
+ *
+ * Values of types selected by UseValuePool are allocated from a per type, thread caching pool
+ * (see ValuePool.h), other values by std::make_shared().
  */
 class ValueFactory
 {
@@ -22,7 +29,8 @@ public:
     template<typename T>
     std::shared_ptr<const std::remove_reference_t<T>> createValue(T&& value) const
     {
-        return std::make_shared<const std::remove_reference_t<T>>(std::forward<T>(value));
+        using ValueType = std::remove_cv_t<std::remove_reference_t<T>>;
+        return createShared<ValueType>(UseValuePool<ValueType>(), std::forward<T>(value));
     }
 
     template<typename T>
@@ -31,8 +39,59 @@ public:
         return std::shared_ptr<const T>(value.release());
     }
 
+    /**
+     * Pool hit/miss statistics of a value type, all zero if the type does not use a pool
+     */
+    template<typename T>
+    static ValuePoolStatistics poolStatistics()
+    {
+        return valuePoolStatistics<T>();
+    }
+
+    /**
+     * Allocate and release the given number of default constructed pooled values of type T
+     *
+     * The pool then holds faulted-in memory for them, so that creating the first values does
+     * not allocate, e.g. after locking the process memory (see RealtimeMemoryOptions). Call this
+     * from the thread creating the values, e.g. in startup(), as released memory is cached per
+     * thread first. Has no effect if the type does not use a pool.
+     */
+    template<typename T>
+    static void reservePool(size_t count)
+    {
+        reservePool<T>(UseValuePool<T>(), count);
+    }
+
+private:
+    template<typename V>
+    static void reservePool(std::true_type, size_t count)
+    {
+        std::vector<std::shared_ptr<const V>> values;
+        values.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            values.push_back(std::allocate_shared<const V>(ValuePoolAllocator<V>()));
+        }
+    }
+
+    template<typename V>
+    static void reservePool(std::false_type, size_t count)
+    {
+    }
+
+    template<typename V, typename T>
+    static std::shared_ptr<const V> createShared(std::true_type, T&& value)
+    {
+        return std::allocate_shared<const V>(ValuePoolAllocator<V>(), std::forward<T>(value));
+    }
+
+    template<typename V, typename T>
+    static std::shared_ptr<const V> createShared(std::false_type, T&& value)
+    {
+        return std::make_shared<const V>(std::forward<T>(value));
+    }
+
 };
 
 } // end namespace mcf
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,227 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_VALUEPOOL_H
+#define MCF_VALUEPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+namespace mcf {
+
+/**
+ * Allocation statistics of a value pool, see ValueFactory::poolStatistics()
+ */
+struct ValuePoolStatistics {
+    uint64_t hits = 0;    ///< allocations served from recycled memory blocks
+    uint64_t misses = 0;  ///< allocations which had to go to the heap
+};
+
+namespace detail {
+
+template<typename...>
+struct MakeVoid { using type = void; };
+
+template<typename T, typename=void>
+struct HasValuePoolTag : std::false_type {};
+
+template<typename T>
+struct HasValuePoolTag<T, typename MakeVoid<typename T::McfUseValuePool>::type> : std::true_type {};
+
+struct ValuePoolCounters {
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+};
+
+template<typename Tag>
+ValuePoolCounters& valuePoolCounters() {
+    static ValuePoolCounters instance;
+    return instance;
+}
+
+} // namespace detail
+
+/**
+ * Statistics of all pool allocations made with the given tag, see ValuePoolAllocator
+ */
+template<typename Tag>
+ValuePoolStatistics valuePoolStatistics() {
+    const detail::ValuePoolCounters& counters = detail::valuePoolCounters<Tag>();
+    ValuePoolStatistics result;
+    result.hits = counters.hits.load(std::memory_order_relaxed);
+    result.misses = counters.misses.load(std::memory_order_relaxed);
+    return result;
+}
+
+/**
+ * Trait selecting whether values of type T are allocated from a value pool by the ValueFactory
+ *
+ * Pooling is enabled for a type either by declaring a member type
+ *
+ *     using McfUseValuePool = void;
+ *
+ * in the value class (this is what types_generator emits for types with "Pooled": true), or by
+ * specializing this template for the type.
+ */
+template<typename T>
+struct UseValuePool : detail::HasValuePoolTag<T> {};
+
+namespace detail {
+
+/**
+ * Free lists of memory blocks of a given size, shared by all allocators with the same Tag
+ *
+ * Each thread keeps a small cache of free blocks, so that in steady state allocating and freeing
+ * a value does not take any lock. Blocks freed by a thread with a full cache (typically the
+ * consumer of the values) are handed over in batches to a global list, where they are picked up
+ * by threads with an empty cache (typically the producer). Blocks are never returned to the heap.
+ */
+template<std::size_t Size, std::size_t Align, typename Tag>
+class ValuePoolStorage {
+public:
+    static void* allocate() {
+        Cache& local = cache();
+        if (local.head == nullptr) {
+            refill(local);
+        }
+        if (local.head != nullptr) {
+            Block* block = local.head;
+            local.head = block->next;
+            --local.count;
+            valuePoolCounters<Tag>().hits.fetch_add(1, std::memory_order_relaxed);
+            return block;
+        }
+        valuePoolCounters<Tag>().misses.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(sizeof(Block));
+    }
+
+    static void deallocate(void* ptr) noexcept {
+        Cache& local = cache();
+        Block* block = static_cast<Block*>(ptr);
+        block->next = local.head;
+        local.head = block;
+        ++local.count;
+        if (local.count > LOCAL_CAPACITY) {
+            release(local, TRANSFER_BATCH);
+        }
+    }
+
+private:
+    static constexpr std::size_t LOCAL_CAPACITY = 64;
+    static constexpr std::size_t TRANSFER_BATCH = 32;
+
+    static_assert(Align <= alignof(std::max_align_t), "over-aligned values cannot be pooled");
+
+    union Block {
+        Block* next;
+        typename std::aligned_storage<Size, Align>::type storage;
+    };
+
+    struct FreeList {
+        Block* head = nullptr;
+        std::size_t count = 0;
+    };
+
+    struct Global : FreeList {
+        std::mutex mutex;
+    };
+
+    struct Cache : FreeList {
+        ~Cache() { release(*this, this->count); }
+    };
+
+    static Global& global() {
+        // intentionally leaked: values may still be freed during static destruction
+        static Global* instance = new Global();
+        return *instance;
+    }
+
+    static Cache& cache() {
+        static thread_local Cache instance;
+        return instance;
+    }
+
+    static void refill(FreeList& local) {
+        Global& shared = global();
+        std::lock_guard<std::mutex> lk(shared.mutex);
+        while (shared.head != nullptr && local.count < TRANSFER_BATCH) {
+            Block* block = shared.head;
+            shared.head = block->next;
+            --shared.count;
+            block->next = local.head;
+            local.head = block;
+            ++local.count;
+        }
+    }
+
+    static void release(FreeList& local, std::size_t count) {
+        Global& shared = global();
+        std::lock_guard<std::mutex> lk(shared.mutex);
+        while (local.head != nullptr && count > 0) {
+            Block* block = local.head;
+            local.head = block->next;
+            --local.count;
+            block->next = shared.head;
+            shared.head = block;
+            ++shared.count;
+            --count;
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * Standard allocator drawing single objects from a value pool, meant for std::allocate_shared()
+ *
+ * std::allocate_shared() rebinds the allocator to its internal type holding both the control
+ * block and the value, so control blocks are recycled together with the values. All allocators
+ * with the same Tag share their statistics.
+ */
+template<typename T, typename Tag=T>
+class ValuePoolAllocator {
+public:
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = ValuePoolAllocator<U, Tag>;
+    };
+
+    ValuePoolAllocator() noexcept = default;
+
+    template<typename U>
+    ValuePoolAllocator(const ValuePoolAllocator<U, Tag>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n != 1) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(Storage::allocate());
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept {
+        if (n != 1) {
+            ::operator delete(ptr);
+            return;
+        }
+        Storage::deallocate(ptr);
+    }
+
+    template<typename U>
+    bool operator==(const ValuePoolAllocator<U, Tag>&) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const ValuePoolAllocator<U, Tag>&) const noexcept { return false; }
+
+private:
+    using Storage = detail::ValuePoolStorage<sizeof(T), alignof(T), Tag>;
+};
+
+} // namespace mcf
+
+#endif // MCF_VALUEPOOL_H
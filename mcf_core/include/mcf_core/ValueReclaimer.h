@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_VALUERECLAIMER_H
+#define MCF_VALUERECLAIMER_H
+
+#include "mcf_core/Mutexes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mcf {
+
+/**
+ * Set while the ValueReclaimer is enabled (maintained by ValueReclaimer)
+ */
+extern std::atomic<bool> gValueReclaimerActive;
+
+/**
+ * Frees the external memory of values on a low priority thread
+ *
+ * The last reference to a value is often dropped by a real-time thread, e.g. by a handler after
+ * popping the value from its queue or by the value store replacing the latest value of a topic.
+ * Freeing a large ext mem buffer there (munmap, or returning it to its ExtMemPool) shows as a
+ * latency spike of the handler. While the reclaimer is enabled, ExtMemValues with at least
+ * Config::minBytes of ext mem hand their memory to the reclaimer thread instead, which frees it,
+ * or returns it to its pool, in the background.
+ *
+ * Memory waiting to be freed is kept in a queue of fixed capacity, so handing it over does not
+ * allocate. If the queue is full, the memory is freed by the releasing thread as before, which is
+ * counted as an overflow. The queue depth is published by MemoryStatsPublisher.
+ *
+ * The reclaimer thread runs with the default scheduling policy at a low nice value, below all
+ * real-time threads, independent of the thread enabling it.
+ */
+class ValueReclaimer {
+public:
+    struct Config {
+        /// ext mem of at least this many bytes is freed by the reclaimer, 0 for all ext mem
+        uint64_t minBytes = 1 << 20;
+        /// number of memory blocks waiting to be freed, further blocks are freed right away
+        size_t capacity = 1024;
+    };
+
+    struct Statistics {
+        uint64_t deferred = 0;         ///< memory blocks handed to the reclaimer thread
+        uint64_t deferredBytes = 0;    ///< bytes of these blocks
+        uint64_t overflows = 0;        ///< blocks freed by the releasing thread as the queue was full
+        size_t queueDepth = 0;         ///< blocks waiting to be freed
+        uint64_t queueBytes = 0;       ///< bytes waiting to be freed
+        size_t maxQueueDepth = 0;      ///< high-water mark of queueDepth
+    };
+
+    /**
+     * Memory to be freed, by destroying it
+     */
+    class Garbage {
+    public:
+        virtual ~Garbage() = default;
+    };
+
+    /**
+     * The reclaimer of the process, which lives until the end of the process, since values
+     * may still be freed during static destruction
+     */
+    static ValueReclaimer& instance();
+
+    /**
+     * Cost of the check in the ext mem values while the reclaimer is disabled: one relaxed
+     * atomic load
+     */
+    static bool active() {
+        return gValueReclaimerActive.load(std::memory_order_relaxed);
+    }
+
+    ValueReclaimer(const ValueReclaimer&) = delete;
+    ValueReclaimer& operator=(const ValueReclaimer&) = delete;
+
+    /**
+     * Start the reclaimer thread, or change the config of the running one
+     */
+    void enable(const Config& config);
+
+    /**
+     * Free the memory waiting in the queue and stop the reclaimer thread
+     */
+    void disable();
+
+    Config config() const;
+
+    /**
+     * Hand memory of the given size to the reclaimer thread
+     *
+     * The memory is freed right away, by destroying garbage on the calling thread, if the
+     * reclaimer is disabled, bytes is below Config::minBytes or the queue is full.
+     *
+     * @return true if the memory is freed by the reclaimer thread
+     */
+    bool reclaim(std::unique_ptr<Garbage> garbage, uint64_t bytes);
+
+    /**
+     * Wait until the memory handed over so far has been freed
+     */
+    void flush();
+
+    Statistics statistics() const;
+
+private:
+    struct Entry {
+        std::unique_ptr<Garbage> garbage;
+        uint64_t bytes = 0;
+    };
+
+    ValueReclaimer() = default;
+
+    void run();
+
+    // Config::minBytes, read without locking to pass small blocks on right away
+    std::atomic<uint64_t> fMinBytes{0};
+
+    // protects all members below, priority inheritance as it is locked by real-time threads
+    mutable mutex::PriorityInheritanceMutex fMutex;
+    std::condition_variable_any fCv;
+    // signalled when the queue has been emptied
+    std::condition_variable_any fFlushedCv;
+    Config fConfig;
+    Statistics fStatistics;
+    std::vector<Entry> fQueue;
+    size_t fHead = 0;
+    // set while the reclaimer thread destroys garbage taken from the queue
+    bool fBusy = false;
+    bool fRunning = false;
+    bool fStopRequest = false;
+    std::thread fThread;
+};
+
+} // namespace mcf
+
+#endif // MCF_VALUERECLAIMER_H
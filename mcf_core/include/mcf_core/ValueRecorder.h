@@ -4,9 +4,20 @@
 #ifndef MCF_VALUE_RECORDER_H
 #define MCF_VALUE_RECORDER_H
 
+#include "IExtMemValue.h"
+#include "RecordHandoff.h"
+#include "RecorderStorage.h"
 #include "ValueStore.h"
+#include "ThreadAffinity.h"
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <unistd.h>
 #include <fcntl.h>
 #include <thread>
@@ -15,9 +26,108 @@
 
 namespace mcf {
 
+/**
+ * Records all values of a value store into a file
+ *
+ * The file is a stream of records, each consisting of a msgpack PacketHeader, the msgpack
+ * value and a msgpack ExtMemHeader, optionally followed by the ext mem data. For seeking,
+ * a msg::RecordIndexBlock is recorded on INDEX_TOPIC about every INDEX_BLOCK_CHECKPOINTS
+ * checkpoints, and a msg::RecordFooter on FOOTER_TOPIC when stopping. A footer is located via
+ * its trailer at the end of the file, see msg::RecordFooter.
+ *
+ * Records of topics with chunk compression are collected into chunks, which are recorded as
+ * a single record on CHUNK_TOPIC: a msg::RecordChunk value with the compressed records as ext
+ * mem data. Decompressed, a chunk is a stream of ordinary records.
+ *
+ * Values of topics with delta encoding are recorded as msg::RecordDelta values, which hold
+ * either the complete serialized value (a keyframe) or its difference to the previous value of
+ * the topic as ext mem data. The first value of a topic after each index checkpoint is a
+ * keyframe, so that reading can start at any checkpoint.
+ *
+ * With a durability policy, see setDurability(), msg::RecordSyncMarker records on SYNC_TOPIC
+ * tell how much of the file has reached the disk.
+ *
+ * With a handoff, see setHandoff(), the values are passed to a recorder in another process,
+ * which records them with recordValue().
+ */
 class ValueRecorder {
 
 public:
+    static constexpr const char* INDEX_TOPIC = "/mcf/recorder/index";
+    static constexpr const char* FOOTER_TOPIC = "/mcf/recorder/footer";
+    /// Last 8 bytes of a file with footer
+    static constexpr const char* FOOTER_MAGIC = "MCFINDX1";
+    /// Minimum record time between two checkpoints
+    static constexpr uint64_t CHECKPOINT_INTERVAL_MS = 1000;
+    static constexpr size_t INDEX_BLOCK_CHECKPOINTS = 60;
+    static constexpr const char* CHUNK_TOPIC = "/mcf/recorder/chunk";
+    /// Uncompressed size at which a chunk is recorded
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+    /// Compression levels of chunks, from fast to dense
+    static constexpr int CHUNK_LEVEL_FAST = 1;
+    static constexpr int CHUNK_LEVEL_DENSE = 9;
+    /// Values between two keyframes of delta encoded topics, including the keyframe
+    static constexpr uint32_t DEFAULT_KEYFRAME_INTERVAL = 100;
+    static constexpr const char* SYNC_TOPIC = "/mcf/recorder/sync";
+    /// Last 8 bytes of a sync marker record
+    static constexpr const char* SYNC_MAGIC = "MCFSYNC1";
+
+    /**
+     * Priority class of a topic when the write queue is full
+     *
+     * BULK values are dropped when the queue reaches half of a limit, NORMAL values when it
+     * reaches the limit and CRITICAL values are never dropped. The recorder status is CRITICAL.
+     */
+    enum class Priority {
+        BULK,
+        NORMAL,
+        CRITICAL
+    };
+
+    /**
+     * Which values of a topic are recorded, applied before they are queued
+     */
+    struct RecordPolicy {
+        enum class Mode {
+            /// every value
+            ALL,
+            /// every n-th value, starting with the first one
+            EVERY_NTH,
+            /// at most rateHz values per second
+            MAX_RATE,
+            /// values whose serialization, including ext mem data, differs from the previous one
+            ON_CHANGE
+        };
+
+        Mode mode = Mode::ALL;
+        uint32_t n = 1;
+        double rateHz = 0.0;
+
+        static RecordPolicy everyNth(uint32_t n) { return RecordPolicy{Mode::EVERY_NTH, n, 0.0}; }
+        static RecordPolicy maxRate(double rateHz) { return RecordPolicy{Mode::MAX_RATE, 1, rateHz}; }
+        static RecordPolicy onChange() { return RecordPolicy{Mode::ON_CHANGE, 1, 0.0}; }
+    };
+
+    /// Bytes accounted per queued value in addition to its ext mem data
+    static constexpr size_t QUEUE_ENTRY_BYTES = 128;
+
+    /**
+     * Flight recorder mode, see setFlightRecorder()
+     */
+    struct FlightRecorderConfig {
+        /// topic patterns kept in memory, all topics if empty, see ValueStore::matchesPattern()
+        std::vector<std::string> topics;
+        /// values up to this long before a trigger are recorded
+        std::chrono::milliseconds preTrigger{30000};
+        /// bytes kept in memory, counted like setWriteQueueByteLimit()
+        uint64_t maxBytes = 256 * 1024 * 1024;
+        /// a value published on this topic triggers a dump, e.g. written with RemoteControl
+        /// (none if empty)
+        std::string triggerTopic;
+        /// values up to this long after a trigger are recorded
+        std::chrono::milliseconds postTrigger{10000};
+    };
+
     explicit ValueRecorder(ValueStore& valueStore);
 
     ~ValueRecorder();
@@ -34,8 +144,24 @@ public:
      *
      * @return true if the queue is empty, false otherwise
      */
-    bool writeQueueEmpty() { return fQueue->size() == 0ul; }
+    bool writeQueueEmpty() { return fQueue->empty(); }
+
+    /**
+     * Check if start() has succeeded and stop() has not been called since
+     */
+    bool isStarted() const { return fStarted; }
 
+    /**
+     * Stop recording without waiting for the queued values to be written
+     *
+     * The recording thread writes them and finishes the file in the background, stop() waits for
+     * it. Lets several recorders flush in parallel. Has no effect if the recorder is not started.
+     */
+    void requestStop();
+
+    /**
+     * Stop recording after the queued values are written and the file is finished
+     */
     void stop();
 
     /**
@@ -49,16 +175,185 @@ public:
      */
     void enableExtMemCompression(const std::string& topic);
 
+    /**
+     * enable chunk compression for a specific topic
+     *
+     * The records of the topic, including their ext mem data if serialization is enabled, are
+     * compressed together with the records of other topics of the same level. Their ext mem data
+     * is not compressed separately. Chunks are recorded when they reach the chunk size, before
+     * each index checkpoint and when stopping.
+     *
+     * @param level  deflate compression level, CHUNK_LEVEL_FAST to CHUNK_LEVEL_DENSE
+     */
+    void enableChunkCompression(const std::string& topic, int level = CHUNK_LEVEL_FAST);
+
+    /**
+     * set the uncompressed size at which chunks are recorded (the default is DEFAULT_CHUNK_SIZE)
+     */
+    void setChunkSize(size_t size);
+
+    /**
+     * enable delta encoding for a specific topic, for values which change little between two
+     * publications
+     *
+     * Each value is recorded as the difference of its serialization, including its ext mem data
+     * if serialization is enabled, to the previous value of the topic. Every keyframeInterval-th
+     * value, the first value after each index checkpoint and values whose difference is not
+     * smaller than the value itself are recorded completely. The ext mem data of the topic is
+     * not compressed separately, chunk compression may be combined with delta encoding.
+     *
+     * @param keyframeInterval  values between two keyframes, including the keyframe, 1 records
+     *                          keyframes only
+     */
+    void enableDeltaEncoding(const std::string& topic,
+                             uint32_t keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
     /**
      * set a hard limit for the number of elements in the write buffer queue
      */
     void setWriteQueueSizeLimit(uint32_t limit);
 
+    /**
+     * set a limit for the bytes held by the write buffer queue, counted as the ext mem sizes of
+     * the queued values plus QUEUE_ENTRY_BYTES per value (0, the default, disables the limit)
+     *
+     * Unlike the size limit, values are dropped when they are published, so that the limit also
+     * bounds the memory held by the queue.
+     */
+    void setWriteQueueByteLimit(uint64_t bytes);
+
+    /**
+     * the bytes currently held by the write buffer queue, counted like setWriteQueueByteLimit()
+     */
+    uint64_t getWriteQueueBytes() const;
+
+    /**
+     * set the priority class of a topic, the default is CRITICAL for topics with a reliable QoS
+     * profile (see TopicQos) and NORMAL for all others
+     */
+    void setTopicPriority(const std::string& topic, Priority priority);
+
     /**
      * disable serialization for a specific topic
+     *
+     * While recording, the topic does not count as subscribed by the recorder any more, see
+     * ValueStore::hasSubscribers().
      */
     void disableSerialization(const std::string& topic);
 
+    /**
+     * set which values of a topic are recorded, RecordPolicy() records all values
+     *
+     * The policy is applied when a value is published, values not taken are neither queued nor
+     * counted as dropped. ON_CHANGE only skips republished values there (the same value
+     * object), the content is compared by the write thread, which skips unchanged values before
+     * they are written. Setting a policy restarts its counting, e.g. of EVERY_NTH.
+     */
+    void setRecordPolicy(const std::string& topic, const RecordPolicy& policy);
+
+    /**
+     * set the storage backend, only while not started (the default is BufferedFileStorage)
+     *
+     * If the storage cannot open the record file, start() falls back to a BufferedFileStorage.
+     */
+    void setStorage(std::unique_ptr<IRecorderStorage> storage);
+
+    /**
+     * hand the values over to a recorder outside of this one instead of recording them, only
+     * while not started (nullptr records into files again)
+     *
+     * The write thread then only applies the queue limits and the disabled topics, and passes
+     * each value together with the ext mem serialization setting of its topic. start() and
+     * stop() open and close the handoff instead of a file. Compression, delta encoding, rotation
+     * and the index are configured on the receiving recorder, which records the values with
+     * recordValue(). Values the handoff cannot take are counted as dropped.
+     */
+    void setHandoff(std::unique_ptr<IRecordHandoff> handoff);
+
+    /**
+     * record a value handed over by another recorder, only while started
+     *
+     * The value is queued like a published value, but recorded with the given time and sequence
+     * number. Record policies are not applied, they are applied by the handing recorder.
+     */
+    void recordValue(const std::string& topic, const ValuePtr& value,
+                     std::chrono::high_resolution_clock::time_point time, uint64_t seq = 0);
+
+    /**
+     * rotate the record file when it reaches maxBytes or maxDuration, 0 disables a limit, only
+     * while not started
+     *
+     * With rotation, start() records into segments named after its filename with a four digit
+     * segment number before the extension, e.g. record_0000.bin. Each segment has its own index
+     * and footer, so segments can be processed independently. The write thread switches to the
+     * next segment between two records while values keep being queued, so none are dropped.
+     * Segments are preallocated with maxBytes.
+     */
+    void setRotation(uint64_t maxBytes,
+                     std::chrono::milliseconds maxDuration = std::chrono::milliseconds(0));
+
+    /**
+     * sync the record file to disk in groups, only while not started (0 for both, the default,
+     * leaves writing back to the operating system)
+     *
+     * A separate thread syncs the file with the storage (fdatasync) when syncBytes have been
+     * written or syncInterval has passed since the previous sync, so that the write thread does
+     * not wait for the disk. After each sync, a msg::RecordSyncMarker with the synced size is
+     * recorded on SYNC_TOPIC. After a crash, RecordReader::recover() truncates the file to the
+     * size of its last marker. Files are synced before they are closed, the storage must
+     * support IRecorderStorage::sync().
+     */
+    void setDurability(uint64_t syncBytes,
+                       std::chrono::milliseconds syncInterval = std::chrono::milliseconds(0));
+
+    /**
+     * record only the values around triggers, only while not started
+     *
+     * The write thread keeps the values of the selected topics of the last preTrigger in memory
+     * instead of recording them, holding the values themselves, until maxBytes are reached. A
+     * value on the trigger topic or triggerDump() records the values kept and all values of the
+     * selected topics and the trigger topic taken until postTrigger after the trigger. A trigger
+     * within this window extends it. Values kept when stopping are not recorded.
+     *
+     * Record policies and queue limits apply before the values are kept.
+     */
+    void setFlightRecorder(const FlightRecorderConfig& config);
+
+    /**
+     * record all values again, only while not started
+     */
+    void disableFlightRecorder();
+
+    /**
+     * trigger a dump of the flight recorder, see setFlightRecorder(), from any thread
+     */
+    void triggerDump();
+
+    /**
+     * the files written since the last start(), the current one last
+     */
+    std::vector<std::string> getRecordFiles() const;
+
+    /**
+     * set the number of threads serializing and compressing values in parallel, only while
+     * not started (the default 0 serializes on the write thread)
+     *
+     * The write thread still writes the records in the order of the queue, so the file order
+     * and the order per topic do not depend on the number of threads.
+     */
+    void setWorkerThreads(size_t count);
+
+    /**
+     * set the CPUs the write thread may run on, takes effect on the next start()
+     * (the empty mask leaves it unpinned)
+     */
+    void setCpuAffinity(CpuMask cpuAffinity);
+
+    /**
+     * the CPUs the write thread may currently run on, the empty mask if not started
+     */
+    CpuMask getEffectiveCpuAffinity() const { return fEffectiveCpuAffinity; }
+
 private:
 
     struct PacketHeader {
@@ -66,7 +361,9 @@ private:
         std::string topic;
         std::string tid;
         uint64_t vid;
-        MSGPACK_DEFINE(time, topic, tid, vid)
+        /// appended to the header, readers of older recordings find 4 elements, see IValueReceiver::receive()
+        uint64_t seq = 0;
+        MSGPACK_DEFINE(time, topic, tid, vid, seq)
     };
 
     struct ExtMemHeader {
@@ -76,45 +373,446 @@ private:
         MSGPACK_DEFINE(extmemSize, extmemPresent, extmemSizeCompressed)
     };
 
+    /**
+     * The content last recorded on a topic with an ON_CHANGE policy, only used by the write thread
+     */
+    struct ChangeState {
+        bool recorded = false;
+        uint64_t lastHash = 0;
+    };
+
     struct QueueEntry {
         std::chrono::high_resolution_clock::time_point time;
-        std::string topic = "";
+        /// the key of the value store, see IValueReceiver::receive()
+        const std::string* topic = nullptr;
         ValuePtr value = nullptr;
+        /// sequence number of the write, see IValueReceiver::receive()
+        uint64_t seq = 0;
+        /// host copy of device resident ext mem in progress, see IExtMemValue::extMemStage()
+        std::shared_ptr<IExtMemStaging> staged;
+        /// set if the topic has an ON_CHANGE policy, see applyChangePolicies()
+        ChangeState* change = nullptr;
+    };
+
+    /**
+     * A chunk of the pending output: either a range of fWriteBuffer (data == nullptr) or
+     * ext mem data outside of it, kept alive by the current batch or fCompressed
+     */
+    struct Segment {
+        const char* data;
+        size_t offset;
+        size_t size;
     };
 
     void writeThread();
 
+    /**
+     * Open a record file with the storage and preallocate it if rotating
+     */
+    int openFile(const std::string& filename);
+
+    /**
+     * Write the pending chunks and the footer of the current file
+     */
+    void finishFile();
+
+    bool rotationDue() const;
+
+    /**
+     * Finish the current file and continue with the next segment
+     */
+    void rotate();
+
+    static std::string segmentFilename(const std::string& filename, size_t segment);
+
+    /**
+     * Serialize a batch of values taken from the queue and write it with few system calls
+     */
+    void writeBatch(std::deque<QueueEntry>& batch);
+
+    /**
+     * Start the host copies of the device resident ext mem to be recorded of a batch, so that
+     * they overlap each other and the serialization of the values before them
+     */
+    void stageExtMem(std::deque<QueueEntry>& batch) const;
+
+    /**
+     * Remove the values of ON_CHANGE topics from a batch whose content equals the one recorded
+     * before on their topic
+     */
+    void applyChangePolicies(std::deque<QueueEntry>& batch);
+
+    /**
+     * Hash of the serialized value including its ext mem data, 0 if it cannot be serialized
+     */
+    uint64_t hashValue(const ValuePtr& value);
+
+    /**
+     * Keep the values of a batch in fFlightRing, leaving those to be recorded in the batch
+     */
+    void applyFlightRecorder(std::deque<QueueEntry>& batch);
+
+    /**
+     * Move the values kept before a trigger at time to output and start the post trigger window
+     */
+    void startDump(std::deque<QueueEntry>& output, std::chrono::high_resolution_clock::time_point time);
+
+    bool isFlightTopic(const std::string& topic);
+
+    /**
+     * Pass a batch of values taken from the queue to the handoff
+     */
+    void handOffBatch(std::deque<QueueEntry>& batch, size_t queueSizeLimit);
+
+    /**
+     * Write the pending segments to the storage and reset the write buffer
+     */
+    void flush();
+
+    /**
+     * Append the record packed into fWriteBuffer from bufferOffset on, and its ext mem data
+     *
+     * @return the file offset of the record
+     */
+    uint64_t appendRecord(size_t bufferOffset, const char* extMem, size_t extMemSize);
+
+    /**
+     * Record an index block, the footer or a sync marker, which are not queued in the value store
+     *
+     * @param trailerMagic  if not nullptr, the record ends with a trailer of its offset and the
+     *                      magic, see msg::RecordFooter
+     */
+    void writeIndexRecord(const char* topic, const ValuePtr& value, const char* trailerMagic);
+
+    /**
+     * Record a marker for a completed sync and request the next sync when it is due
+     */
+    void syncIfDue();
+
+    /**
+     * Syncs the record file with the storage on request of the write thread
+     */
+    class SyncThread {
+    public:
+        explicit SyncThread(IRecorderStorage& storage);
+        ~SyncThread();
+
+        /**
+         * Sync the data written up to size in the background
+         *
+         * @return false if the previous sync has not completed yet
+         */
+        bool request(uint64_t size);
+
+        /**
+         * Wait for a requested sync to complete
+         */
+        void wait();
+
+        /**
+         * Take the result of the last completed sync
+         *
+         * @return false if no sync has completed since the last call
+         */
+        bool takeResult(uint64_t& syncedSize, int& error);
+
+    private:
+        void run();
+
+        IRecorderStorage& fStorage;
+        std::mutex fMutex;
+        std::condition_variable fCondition;
+        bool fRequested = false;
+        bool fRunning = false;
+        bool fCompleted = false;
+        bool fStop = false;
+        uint64_t fSize = 0;
+        uint64_t fSyncedSize = 0;
+        int fError = 0;
+        std::thread fThread;
+    };
+
+    struct Chunk {
+        msgpack::sbuffer buffer;
+        uint32_t records = 0;
+        uint64_t startTime = 0;
+    };
+
+    /**
+     * Compress and record a chunk, and reset it
+     */
+    void writeChunk(int level, Chunk& chunk);
+
+    void writeChunks();
+
+    /**
+     * The chunk compression level of a topic, CHUNK_LEVEL_NONE if not compressed in chunks
+     */
+    int chunkLevel(const std::string& topic) const;
+
+    static constexpr int CHUNK_LEVEL_NONE = -1;
+
+    /**
+     * The keyframe interval of a topic, 0 if it is not delta encoded
+     */
+    uint32_t keyframeInterval(const std::string& topic) const;
+
     bool isExtMemEnabled(const std::string& topic) const;
 
     bool isExtMemCompressionEnabled(const std::string& topic) const;
 
     bool isTopicEnabled(const std::string& topic) const;
 
-    void serialize(QueueEntry& qe);
+    /**
+     * A value serialized for recording, without its ext mem data
+     */
+    struct Prepared {
+        msgpack::sbuffer buffer;
+        const char* extMem = nullptr;
+        size_t extMemSize = 0;
+        std::unique_ptr<unsigned char[]> compressed;
+        uint64_t time = 0;
+        uint64_t seq = 0;
+        int chunkLevel = CHUNK_LEVEL_NONE;
+        /// for delta encoding: the serialized value in buffer and the ext mem header
+        uint32_t keyframeInterval = 0;
+        const std::string* tid = nullptr;
+        size_t valueOffset = 0;
+        size_t valueSize = 0;
+        ExtMemHeader extMemHeader{};
+        bool valid = false;
+        std::string error;
+    };
+
+    /**
+     * Serialize and compress a value, called by the worker threads concurrently
+     */
+    void prepare(const QueueEntry& qe, Prepared& prepared) const;
+
+    /**
+     * Append a prepared value to the output, in queue order on the write thread
+     */
+    void emit(QueueEntry& qe, Prepared& prepared, size_t queueSize);
+
+    /**
+     * Replace a prepared value of a delta encoded topic by its msg::RecordDelta record
+     */
+    void encodeDelta(const QueueEntry& qe, Prepared& prepared);
+
+    struct DeltaState {
+        std::string tid;
+        std::vector<char> payload;
+        uint32_t deltas = 0;
+    };
+
+    /**
+     * Check if a value is dropped with queued values before it, given the limit of a priority
+     * class NORMAL
+     */
+    static bool isDropped(uint64_t queued, uint64_t limit, Priority priority);
+
+    /**
+     * Threads preparing the values of a batch ahead of the write thread
+     *
+     * Values are taken in queue order and prepared into a ring of REORDER_WINDOW slots, which
+     * the write thread consumes in the same order.
+     */
+    class WorkerPool {
+    public:
+        static constexpr size_t REORDER_WINDOW = 256;
+
+        WorkerPool(ValueRecorder& recorder, size_t count, CpuMask cpuAffinity);
+        ~WorkerPool();
+
+        void begin(std::deque<QueueEntry>& batch, size_t queueSizeLimit);
+
+        /**
+         * Wait for the value at index of the batch to be prepared
+         */
+        Prepared& wait(size_t index);
+
+        /**
+         * Hand the slot of the value at index to the next value
+         */
+        void release(size_t index);
+
+        void end();
+
+    private:
+        void run(size_t worker, CpuMask cpuAffinity);
+
+        ValueRecorder& fRecorder;
+        std::mutex fMutex;
+        std::condition_variable fWork;
+        std::condition_variable fReady;
+        std::deque<QueueEntry>* fBatch = nullptr;
+        size_t fQueueSizeLimit = 0;
+        size_t fNext = 0;
+        size_t fConsumed = 0;
+        std::vector<Prepared> fSlots;
+        std::vector<bool> fSlotReady;
+        bool fStop = false;
+        std::vector<std::thread> fThreads;
+    };
 
     class Queue : public IValueReceiver {
     public:
-        Queue();
+        explicit Queue(const ValueStore& valueStore);
+        ~Queue();
 
+        /**
+         * Lock-free, called by all threads writing to the value store
+         */
         void receive(const std::string& topic, ValuePtr& value) override;
+        void receive(const std::string& topic, ValuePtr& value, uint64_t seq) override;
+
+        /**
+         * Queue a value with the time it was published, topic must outlive the queued value
+         */
+        void enqueue(const std::string& topic, const ValuePtr& value, uint64_t seq,
+                     std::chrono::high_resolution_clock::time_point time,
+                     ChangeState* change = nullptr);
+
+        /**
+         * Take all queued values at once, waiting up to timeout for the first one
+         *
+         * @param entries receives the values, must be empty
+         * @return the number of values taken
+         */
+        size_t popAll(std::deque<QueueEntry>& entries, std::chrono::milliseconds timeout);
+
+        /**
+         * Wake up a pending popAll(), e.g. to stop
+         */
+        void wakeUp();
+
+        bool empty() const;
 
-        size_t pop(QueueEntry& qe);
+        void setByteLimit(uint64_t bytes) { fByteLimit = bytes; }
 
-        size_t size();
+        uint64_t queuedBytes() const { return fQueuedBytes.load(std::memory_order_relaxed); }
+
+        void setPriority(const std::string& topic, Priority priority);
+
+        Priority getPriority(const std::string& topic) const;
+
+        void setPolicy(const std::string& topic, const RecordPolicy& policy);
+
+        /**
+         * Exclude a topic from wantsTopic(), see disableSerialization()
+         */
+        void disableTopic(const std::string& topic);
+
+        bool wantsTopic(const std::string& topic) const override;
+
+        /**
+         * The number of values dropped by receive() since the last call
+         */
+        uint32_t takeDropped() { return fDropped.exchange(0); }
 
     private:
-        struct QueueValue {
-            std::chrono::high_resolution_clock::time_point time;
-            std::size_t topicId;
-            ValuePtr value;
+        struct Node {
+            std::atomic<Node*> next{nullptr};
+            QueueEntry entry;
+            uint64_t bytes = 0;
         };
 
+        void push(Node* node);
+
+        struct PolicyState {
+            explicit PolicyState(const RecordPolicy& policy) : policy(policy) {}
+
+            const RecordPolicy policy;
+            std::atomic<uint64_t> count{0};
+            std::atomic<int64_t> nextTimeNs{0};
+            // the value queued last on an ON_CHANGE topic, kept so that its address is not reused
+            ValuePtr last;
+            ChangeState change;
+        };
+
+        /**
+         * The policies of the topics with a policy other than ALL, never changed once published
+         */
+        using PolicyMap = std::unordered_map<std::string, std::shared_ptr<PolicyState>>;
+
+        /**
+         * Apply a policy to a value, true if it is queued
+         */
+        bool admit(PolicyState& state, const ValuePtr& value);
+
+        /**
+         * Take the oldest node, nullptr if the queue is empty or the oldest push is incomplete
+         */
+        Node* pop();
+
+        // intrusive multi producer single consumer queue: producers exchange fHead and then
+        // link the previous node to theirs, the write thread pops at fTail. fStub keeps the
+        // list non-empty and is pushed again when the last node is taken.
+        std::atomic<Node*> fHead;
+        std::atomic<Node*> fTail;
+        Node fStub;
+
+        // only for waiting, never locked by producers unless the write thread waits
         mutex::PriorityInheritanceMutex fMutex;
-        std::deque<QueueValue> fDeque;
-        std::map<std::size_t, std::string> fTopicIdMap;
+        std::condition_variable fNotEmpty;
+        std::atomic<bool> fWaiting{false};
+
+        std::atomic<uint64_t> fByteLimit{0};
+        std::atomic<uint64_t> fQueuedBytes{0};
+        std::atomic<uint32_t> fDropped{0};
+        mutable mutex::PriorityInheritanceSharedMutex fPriorityMutex;
+        std::unordered_map<std::string, Priority> fPriorities;
+
+        const ValueStore& fValueStore;
+        // read by the publishers without locking, nullptr if no topic has a policy
+        std::atomic<const PolicyMap*> fPolicies{nullptr};
+        // all maps published, kept until destruction since publishers may still read old ones,
+        // so that the policy states may be referenced by queued values as well
+        std::vector<std::unique_ptr<const PolicyMap>> fPolicyMaps;
+        mutable mutex::PriorityInheritanceSharedMutex fPolicyMutex;
+        // the topics disabled on the recorder, guarded by fPolicyMutex
+        std::unordered_set<std::string> fDisabledTopics;
+        bool fWakeUp = false;
     };
 
 
+    /**
+     * Topic counts and time to offset checkpoints of the records written so far
+     */
+    class RecordIndex {
+    public:
+        void reset();
+
+        /**
+         * Check if a record at time would become a checkpoint
+         */
+        bool checkpointDue(uint64_t time) const;
+
+        /**
+         * Account a record
+         *
+         * @return true if an index block is due
+         */
+        bool add(const std::string& topic, uint64_t time, uint64_t offset);
+
+        /**
+         * The checkpoints since the previous block, to be written at blockOffset
+         */
+        std::shared_ptr<msg::RecordIndexBlock> takeBlock(uint64_t blockOffset);
+
+        std::shared_ptr<msg::RecordFooter> footer() const;
+
+    private:
+        std::map<std::string, uint64_t> fCounts;
+        std::vector<uint64_t> fTimes;
+        std::vector<uint64_t> fOffsets;
+        size_t fBlockStart = 0;
+        std::vector<uint64_t> fBlocks;
+        uint64_t fStartTime = 0;
+        uint64_t fEndTime = 0;
+        bool fEmpty = true;
+    };
+
     class StatusMonitor {
     public:
         explicit StatusMonitor(ValueStore& valueStore);
@@ -131,7 +829,7 @@ private:
 
         void reportWriteError(const std::string& error);
 
-        void reportDropped();
+        void reportDropped(uint32_t count = 1);
 
         void incBytesWritten(size_t num) {
             fBytesWritten += num;
@@ -157,13 +855,67 @@ private:
     ValueStore& fValueStore;
     std::shared_ptr<Queue> fQueue;
     std::thread fThread;
-    int fFile;
+    std::unique_ptr<IRecorderStorage> fStorage;
+    std::unique_ptr<IRecordHandoff> fHandoff;
+    // keys of the values recorded with recordValue(), node based for stable addresses
+    std::unordered_set<std::string> fHandedOverTopics;
+    bool fStarted = false;
     std::atomic<bool> fStopRequest;
     std::unordered_set<std::string> fDisabledTopics;
     std::unordered_set<std::string> fEnabledExtMemTopics;
     std::unordered_set<std::string> fCompressExtMemTopics;
+    std::unordered_map<std::string, int> fChunkTopics;
+    std::unordered_map<std::string, uint32_t> fDeltaTopics;
+    size_t fChunkSize = DEFAULT_CHUNK_SIZE;
     StatusMonitor fStatusMonitor;
     uint32_t fQueueSizeLimit = UINT_MAX;
+    CpuMask fCpuAffinity = 0;
+    std::atomic<CpuMask> fEffectiveCpuAffinity{0};
+    size_t fWorkerCount = 0;
+    std::unique_ptr<WorkerPool> fWorkers;
+    uint64_t fRotationBytes = 0;
+    std::chrono::milliseconds fRotationDuration{0};
+    std::string fFilename;
+    size_t fSegment = 0;
+    std::chrono::steady_clock::time_point fSegmentStart;
+    std::vector<std::string> fRecordFiles;
+    uint64_t fSyncBytes = 0;
+    std::chrono::milliseconds fSyncInterval{0};
+    std::unique_ptr<SyncThread> fSync;
+    // stream offsets of the last sync request and after the last sync marker
+    uint64_t fSyncRequested = 0;
+    uint64_t fMarkerEnd = 0;
+    std::chrono::steady_clock::time_point fLastSyncRequest;
+    std::unique_ptr<FlightRecorderConfig> fFlightConfig;
+    std::atomic<bool> fDumpRequested{false};
+
+    // flight recorder state of the write thread: the values kept, with their bytes
+    std::deque<std::pair<QueueEntry, uint64_t>> fFlightRing;
+    uint64_t fFlightBytes = 0;
+    bool fDumping = false;
+    std::chrono::high_resolution_clock::time_point fDumpEnd;
+    // whether a topic is kept, by the address of the value store key
+    std::unordered_map<const std::string*, bool> fFlightTopics;
+
+    // output state of the write thread, reused across batches
+    msgpack::sbuffer fWriteBuffer;
+    std::vector<Segment> fSegments;
+    std::vector<std::unique_ptr<unsigned char[]>> fCompressed;
+    size_t fPendingBytes = 0;
+    uint64_t fReportedBytes = 0;
+    // file offset of the next record
+    uint64_t fStreamOffset = 0;
+    RecordIndex fIndex;
+    // open chunks by compression level
+    std::map<int, Chunk> fChunks;
+    // reused without worker threads
+    Prepared fPrepared;
+    // reused by hashValue()
+    msgpack::sbuffer fHashBuffer;
+    // previous payloads of the delta encoded topics, cleared to start with keyframes
+    std::unordered_map<std::string, DeltaState> fDeltas;
+    std::vector<char> fDeltaPayload;
+    std::vector<char> fDeltaRuns;
 
     mutable mutex::PriorityInheritanceMutex fMutex;
     
@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_VALUESNAPSHOT_H
+#define MCF_VALUESNAPSHOT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mcf {
+
+class ValueStore;
+
+/**
+ * Settings of the snapshots of retained values, see ValueSnapshot
+ */
+struct ValueSnapshotConfig {
+    /// the snapshot file, snapshots are disabled if empty
+    std::string file;
+    /// glob patterns of the topics whose latest values are kept, see ValueStore::matchesPattern()
+    std::vector<std::string> topics;
+    /// time between two snapshots while the system runs, zero to write one at shutdown only
+    std::chrono::milliseconds interval{0};
+    /// snapshots older than this are not restored, zero to restore snapshots of any age
+    std::chrono::milliseconds maxAge{0};
+};
+
+/**
+ * Snapshots of the latest values of selected topics for a warm restart
+ *
+ * Components rebuilding their state from slowly published topics (maps, calibrations, track
+ * histories) cannot act after a restart until these topics have been published again. A
+ * snapshot keeps the values such topics hold in a file, serialized with the type registry of the
+ * value store, so that they can be written back to the value store when the process starts
+ * again. ComponentManager::enableValueSnapshot() restores the snapshot after the components
+ * have started, but before they run, and writes one at shutdown.
+ *
+ * The file is written through a memory mapping into a temporary file, which then replaces the
+ * snapshot file, so that a crash while writing keeps the previous snapshot. It starts with
+ * MAGIC, the size of the records and the time of the snapshot, followed by a msgpack array
+ * [topic, type id, value, ext mem data] per value. Values of unregistered types are skipped.
+ */
+class ValueSnapshot {
+public:
+    static constexpr const char* MAGIC = "MCFSNAP1";
+
+    /**
+     * @param valueStore The value store whose values are kept and restored, the reference is stored
+     * @param config     The settings, config.file must not be empty
+     */
+    ValueSnapshot(ValueStore& valueStore, const ValueSnapshotConfig& config);
+
+    /**
+     * Stops the periodic snapshots without writing a final one
+     */
+    ~ValueSnapshot();
+
+    ValueSnapshot(const ValueSnapshot&) = delete;
+    ValueSnapshot& operator=(const ValueSnapshot&) = delete;
+
+    const ValueSnapshotConfig& config() const {
+        return fConfig;
+    }
+
+    /**
+     * Write the values the selected topics hold now to the snapshot file
+     *
+     * @return The number of values written, errors are logged
+     */
+    size_t write();
+
+    /**
+     * Write the values of the snapshot file to the value store
+     *
+     * Topics which hold a value already, e.g. one received since the process started, keep it.
+     * Nothing is restored if the file does not exist, is invalid or older than config.maxAge.
+     *
+     * @return The number of values restored
+     */
+    size_t restore();
+
+    /**
+     * Start writing a snapshot every config.interval, if the interval is not zero
+     */
+    void start();
+
+    /**
+     * Stop the periodic snapshots and write a final snapshot
+     */
+    void stop();
+
+private:
+    void run();
+
+    std::vector<std::string> selectedTopics() const;
+
+    ValueStore& fValueStore;
+    const ValueSnapshotConfig fConfig;
+
+    // serializes writing the file
+    std::mutex fWriteMutex;
+
+    std::mutex fMutex;
+    std::condition_variable fCv;
+    bool fStopRequest = false;
+    std::thread fThread;
+};
+
+} // namespace mcf
+
+#endif // MCF_VALUESNAPSHOT_H
@@ -5,6 +5,10 @@
 #define MCF_VALUE_STORE_H
 
 #include "mcf_core/IExtMemValue.h"
+#include "mcf_core/LatestValue.h"
+#include "mcf_core/LazyValue.h"
+#include "mcf_core/LogicalClock.h"
+#include "mcf_core/TopicQos.h"
 #include "mcf_core/Value.h"
 #include "mcf_core/TypeRegistry.h"
 #include "mcf_core/ValueFactory.h"
@@ -12,20 +16,27 @@
 #include "msgpack.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>
 #include <deque>
 #include <functional>
 #include <iostream>
+#include <list>
 #include <map>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <typeindex>
 #include <typeinfo>
+#include <unordered_map>
 #include <vector>
 
 #include "mcf_core/ComponentTraceController.h"
 #include "mcf_core/ComponentTraceEventGenerator.h"
 #include "mcf_core/Messages.h"
+#include "mcf_core/TracePolicy.h"
 #include "mcf_core/Trigger.h"
 
 namespace mcf {
@@ -41,26 +52,68 @@ public:
     const char* what() const noexcept override;
 };
 
+/**
+ * Origin of a value injected into the value store from outside of the process, e.g. by a remote
+ * link, a shared memory topic or the replay of a recording, see ValueStore::injectValue()
+ */
+struct ValueOrigin {
+    /// tells the origins feeding a topic apart, e.g. the address of the injecting object
+    const void* source = nullptr;
+    /// sequence number of the value at its origin, 0 if unknown
+    uint64_t sequence = 0;
+};
+
 /**
  *  An IValueReceiver is a objects that can be registered
  *  with the ValueStore to be called when a value update is made.
  */
 class IValueReceiver {
 public:
+    /**
+     * Called on every value update
+     *
+     * The ValueStore passes its own key of the topic, which is never removed while the
+     * ValueStore exists. Receivers may thus keep the address of topic instead of a copy.
+     */
     virtual void receive(const std::string& topic, ValuePtr& value) = 0;
 
+    /**
+     * Called on every value update together with the sequence number of the write
+     *
+     * The value store numbers the writes to each topic from 1 on, see ValueStore::injectValue().
+     * Receivers which need the number override this function, the default ignores it.
+     */
+    virtual void receive(const std::string& topic, ValuePtr& value, uint64_t /* seq */) { receive(topic, value); }
+
     virtual bool isBlocked(const std::string& topic) { return false; }
 
+    /**
+     * Whether the receiver processes values of topic, asked by ValueStore::hasSubscribers() of
+     * all topic receivers which filter the topics they process
+     */
+    virtual bool wantsTopic(const std::string& topic) const { return true; }
+
     /**
      * Wait until the given topic can be written to (is unblocked)
      *
+     * Implementations should wake waiting writers as soon as the topic becomes unblocked and
+     * when wakeBlocked() is called, rather than polling.
+     *
      * Note: in order to abort waiting, the function 'checkAbort()' must return true.
      *
      * @param topic         the topic
      * @param checkAbort    waiting is aborted when this function returns true
+     * @param deadline      waiting is aborted when this point in time is reached
      */
     virtual void waitBlocked(const std::string& topic,
-                             const std::function<bool()>& checkAbort) {};
+                             const std::function<bool()>& checkAbort,
+                             std::chrono::steady_clock::time_point deadline
+                                 = std::chrono::steady_clock::time_point::max()) {};
+
+    /**
+     * Wake all writers waiting in waitBlocked(), so that they re-evaluate their abort condition
+     */
+    virtual void wakeBlocked() {};
 };
 
 /**
@@ -69,15 +122,91 @@ public:
  *
  *  The queue holds both, the actual value and the topic it came from.
  *
+ *  Values written in the scope of a LogicalClock are stamped with their logical time. Stamped
+ *  values are queued in the order of (logical time, topic), and a stamped value at the front of
+ *  the queue is hidden from empty(), size(), peek() and the pops until its time is safe, see
+ *  LogicalClock::isSafe(). Unstamped values keep the order of receipt.
+ *
  *  Can act as a TriggerSource.
  */
 class ValueQueue : public TriggerSource, public IValueReceiver {
 
 public:
-    explicit ValueQueue(int maxLength=0, bool blocking=false)
-        : fMaxLength(maxLength),
-          fBlocking(blocking)
-    {}
+    /**
+     * Storage used for the queue entries
+     *
+     * DYNAMIC:     entries are kept in a std::deque, maxLength 0 (unbounded) is allowed
+     * RING_BUFFER: entries are kept in a ring buffer preallocated to maxLength entries, so that
+     *              pushing and popping values never allocates memory. Topics are interned per
+     *              queue, so the topic string is not copied on every receive().
+     *              Requires maxLength > 0.
+     * CONFLATING:  the queue keeps only the newest value per key, see ConflationKey. A value whose
+     *              key is already queued replaces the queued value in place (keeping its position
+     *              in the queue), other values are appended. maxLength limits the number of
+     *              distinct keys, 0 means unbounded. Set by the ConflationKey constructor.
+     */
+    enum class Storage {
+        DYNAMIC,
+        RING_BUFFER,
+        CONFLATING
+    };
+
+    /**
+     * Function extracting the conflation key of a received value, see Storage::CONFLATING
+     *
+     * The function is called by the writing thread without any lock held. Empty value pointers
+     * are queued under key 0.
+     */
+    using ConflationKey = std::function<uint64_t(const Value&)>;
+
+    /**
+     * Bounds and targets of the adaptive maximum length, see enableAdaptiveLength()
+     */
+    struct AdaptiveLength {
+        size_t minLength = 1;
+        size_t maxLength = 1024;
+        /// longest time values should wait in the queue, zero for no target
+        std::chrono::nanoseconds targetLatency{0};
+        /// fraction of the received values the queue may drop, or for blocking queues may be full at
+        double targetDropRate = 0.0;
+        /// the rates are measured over windows of this length
+        std::chrono::milliseconds window{1000};
+    };
+
+    /**
+     * A change of the maximum length by the adaptive mode, with the rates measured in the window
+     * which led to it
+     */
+    struct LengthDecision {
+        size_t previousLength = 0;
+        size_t length = 0;
+        double arrivalRate = 0.0;             ///< values received per second
+        double serviceRate = 0.0;             ///< values popped per second
+        double dropRate = 0.0;                ///< fraction of the received values dropped
+        std::chrono::nanoseconds maxWait{0};  ///< longest wait of a popped value
+    };
+
+    /// Number of decisions kept until takeLengthDecisions(), older ones are discarded
+    static constexpr size_t MAX_LENGTH_DECISIONS = 32;
+
+    /**
+     * Interval in which writers waiting for a blocked queue re-evaluate their abort condition,
+     * unless they are woken by wakeBlocked() before
+     */
+    static constexpr std::chrono::milliseconds ABORT_POLL_INTERVAL{100};
+
+    explicit ValueQueue(int maxLength=0, bool blocking=false, Storage storage=Storage::DYNAMIC);
+
+    /**
+     * Construct a conflating queue keeping only the newest value per key
+     *
+     * @param conflationKey function extracting the key of a value
+     * @param maxLength     the maximum number of distinct keys in the queue, 0 means infinite
+     * @param blocking      if true, writers block as long as the queue is full
+     */
+    explicit ValueQueue(ConflationKey conflationKey, int maxLength=0, bool blocking=false);
+
+    ~ValueQueue();
 
     bool empty();
 
@@ -91,6 +220,8 @@ public:
 
     void setMaxLength(size_t maxLength);
 
+    Storage getStorage() const { return fStorage; }
+
     template<typename T>
     std::shared_ptr<const T> peek();
 
@@ -100,23 +231,213 @@ public:
     template<typename T>
     ValueTopicTuple<T> popWithTopic();
 
+    template<typename T>
+    ValueTopicTuple<T> peekWithTopic();
+
+    /**
+     * Pop up to maxCount values (all values if maxCount is 0) under a single lock
+     *
+     * The values are appended to out in queue order. Blocked writers are woken once.
+     *
+     * @return the number of values popped
+     */
+    template<typename T>
+    size_t popMany(std::vector<std::shared_ptr<const T>>& out, size_t maxCount=0);
+
+    /**
+     * Time the oldest value has been waiting in the queue, zero if the queue is empty
+     *
+     * For Storage::CONFLATING, a key waits from the receipt of its first value on, replacing
+     * the value does not reset its age.
+     */
+    std::chrono::nanoseconds getAge();
+
+    /**
+     * Drop the values which have been waiting for at least minAge, oldest first
+     *
+     * Blocked writers are woken if values were dropped.
+     *
+     * @param minAge the minimum age of dropped values, zero drops all values
+     * @param keep   the number of newest values kept in any case
+     * @return the number of values dropped
+     */
+    size_t dropOlderThan(std::chrono::nanoseconds minAge, size_t keep=0);
+
+    /**
+     * The logical time of the value at the front of the queue, whether visible or not
+     *
+     * @return false if the queue is empty or the front value is not stamped
+     */
+    bool frontStamp(LogicalClock::Stamp& stamp);
+
+    /**
+     * Append the queued values to values in queue order without removing them, e.g. for
+     * accounting the memory they hold
+     *
+     * Only the pointers are copied, invisible stamped values are included.
+     */
+    void copyValues(std::vector<ValuePtr>& values);
+
+    /**
+     * Sequence number of the write of the value at the front of the queue within its topic,
+     * 0 if the queue is empty, see IValueReceiver::receive()
+     */
+    uint64_t peekSequence();
+
+    /**
+     * Number of values which never reached the queue, as told by gaps in the sequence numbers of
+     * the writes received per topic
+     *
+     * Values lost before they were injected into the value store, e.g. by a remote link, are
+     * counted, values which were written before the queue was added are not. See
+     * ValueStore::injectValue().
+     */
+    uint64_t getGaps();
+
+    /**
+     * Number of values the queue dropped itself, when a value was received at its maximum length
+     * or by dropOlderThan() and setMaxLength(). Values replaced by conflation are not counted.
+     */
+    uint64_t getDropped();
+
+    /**
+     * Let the queue adjust its maximum length to the observed arrival and service rates
+     *
+     * At the end of each window, the queue
+     * - shrinks to the length the consumer works off within targetLatency, if a popped value
+     *   waited longer than that
+     * - otherwise doubles its length if it dropped more than targetDropRate of the received values,
+     *   but not beyond the length meeting targetLatency
+     * - otherwise halves the slack of a length it never filled to a quarter of
+     * always within minLength and maxLength. Shrinking drops the oldest values exceeding the new
+     * length. A ring buffer is reallocated on each change. The current length is clamped to the
+     * bounds right away.
+     *
+     * Throws std::runtime_error unless 0 < minLength <= maxLength, 0 <= targetDropRate <= 1 and
+     * window > 0.
+     */
+    void enableAdaptiveLength(const AdaptiveLength& adaptive);
+
+    /**
+     * Keep the current maximum length from now on
+     */
+    void disableAdaptiveLength();
+
+    /**
+     * The length changes made by the adaptive mode since the last call, oldest first
+     */
+    std::vector<LengthDecision> takeLengthDecisions();
+
 protected:
 
     void receive(const std::string& topic, ValuePtr& value) override;
+    void receive(const std::string& topic, ValuePtr& value, uint64_t seq) override;
     bool isBlocked(const std::string& topic) override;
-    void waitBlocked(const std::string& topic, const std::function<bool()>& checkAbort) override;
+    void waitBlocked(const std::string& topic,
+                     const std::function<bool()>& checkAbort,
+                     std::chrono::steady_clock::time_point deadline
+                         = std::chrono::steady_clock::time_point::max()) override;
+    void wakeBlocked() override;
 
 private:
     bool isBlockedInternal() {
-        return fBlocking && fMaxLength > 0 && fQueue.size() >= fMaxLength;
+        return fBlocking && fMaxLength > 0 && sizeUnlocked() >= fMaxLength;
     }
 
-    typedef std::tuple<ValuePtr, const std::string> QueueEntry;
+    void setMaxLengthUnlocked(size_t maxLength);
+
+    /*
+     * Adaptive length, see enableAdaptiveLength(), must be called with fMutex locked
+     */
+    void countReceivedUnlocked();
+    void countPoppedUnlocked(size_t count);
+    void adaptLengthUnlocked(int64_t nowNs);
+
+    /*
+     * Storage independent queue access, must be called with fMutex locked
+     */
+    size_t sizeUnlocked() const;
+    const ValuePtr& frontValueUnlocked() const;
+    const std::string& frontTopicUnlocked() const;
+    int64_t frontReceivedUnlocked() const;
+    const LogicalClock::Stamp& frontStampUnlocked() const;
+    void popFrontUnlocked();
+    uint64_t frontSequenceUnlocked() const;
+    void pushBackUnlocked(const std::string& topic, const ValuePtr& value, uint64_t seq,
+                          LogicalClock::Stamp stamp);
+    void resizeRingUnlocked(size_t capacity);
+    size_t internTopicUnlocked(const std::string& topic);
+
+    /*
+     * Count the values missing before a received write of a topic, see getGaps()
+     */
+    void countGapsUnlocked(const std::string& topic, uint64_t seq);
+
+    /*
+     * Replace the queued value with the same key or insert the value
+     */
+    void conflateUnlocked(const std::string& topic, const ValuePtr& value, uint64_t key,
+                          uint64_t seq, LogicalClock::Stamp stamp);
+
+    /*
+     * Visibility of stamped values, see LogicalClock, must be called with fMutex locked
+     */
+    bool frontVisibleUnlocked() const;
+    size_t visibleSizeUnlocked() const;
+
+    // value, topic, time of receipt in ns of the steady clock, logical time and sequence number
+    typedef std::tuple<ValuePtr, std::string, int64_t, LogicalClock::Stamp, uint64_t> QueueEntry;
+
+    struct RingEntry {
+        ValuePtr value;
+        size_t topicId = 0;  // index into fTopics
+        int64_t received = 0;
+        LogicalClock::Stamp stamp;
+        uint64_t seq = 0;
+    };
+
+    struct ConflatedEntry {
+        ValuePtr value;
+        size_t topicId = 0;  // index into fTopics
+        uint64_t key = 0;
+        int64_t received = 0;
+        LogicalClock::Stamp stamp;
+        uint64_t seq = 0;
+    };
+    using ConflatedList = std::list<ConflatedEntry>;
 
     size_t fMaxLength;
     bool fBlocking;
+    const Storage fStorage;
     std::deque<QueueEntry> fQueue;
+    std::vector<RingEntry> fRing;
+    size_t fRingHead = 0;
+    size_t fRingCount = 0;
+    std::vector<std::string> fTopics;
+    const ConflationKey fConflationKey;
+    ConflatedList fConflated;
+    ConflatedList fConflatedFree;  // recycled list nodes, spliced to avoid reallocation
+    std::unordered_map<uint64_t, ConflatedList::iterator> fConflatedIndex;
+    size_t fStamped = 0;  // number of stamped values in the queue
+    // latest sequence number received per topic, the entry of the latest topic is cached
+    std::unordered_map<std::string, uint64_t> fLastSeqs;
+    std::pair<const std::string, uint64_t>* fLastSeq = nullptr;
+    uint64_t fGaps = 0;
+    uint64_t fDropped = 0;
     std::condition_variable fUnblockCv;
+    // adaptive length, see enableAdaptiveLength()
+    bool fAdaptive = false;
+    AdaptiveLength fAdaptiveLength;
+    struct {
+        int64_t startNs = 0;
+        uint64_t received = 0;
+        uint64_t popped = 0;
+        uint64_t full = 0;            // values received into a full blocking queue
+        uint64_t droppedAtStart = 0;  // fDropped at the start of the window
+        int64_t maxWaitNs = 0;
+        size_t peakSize = 0;
+    } fWindow;
+    std::deque<LengthDecision> fLengthDecisions;
 };
 
 
@@ -159,6 +480,13 @@ public:
 
     void reset();
 
+    /**
+     * Activate the flag without a value, e.g. on expiry of a timer
+     *
+     * @return false if the flag was active already
+     */
+    bool activate(const std::string& topic);
+
     /**
      * Get topic of current (if active) or previous (if not active) trigger activation
      */
@@ -209,26 +537,305 @@ class ValueStore : public TypeRegistry {
 public:
     constexpr static int VALUE_STORE_PRIORITY = 32;
 
-    ValueStore() : fMutex(VALUE_STORE_PRIORITY) {
-        mcf::msg::registerValueTypes(*this);
+    ValueStore() {
+        fMutex.setName("ValueStore");
+        addBase(messageTypes());
+    }
+
+    /**
+     * Value store looking up types in types, e.g. the generated types of a project registered
+     * once for all value stores of a process, before the mcf message types
+     *
+     * types must outlive the value store, see TypeRegistry::addBase().
+     */
+    explicit ValueStore(const TypeRegistry& types) {
+        fMutex.setName("ValueStore");
+        addBase(types);
+        addBase(messageTypes());
     }
 
+    /**
+     * The types of mcf::msg, registered once per process on first use and shared by all value
+     * stores
+     */
+    static const TypeRegistry& messageTypes();
+
+    ~ValueStore();
+
+    /**
+     * How long a topic keeps its latest value, see setRetention()
+     */
+    enum class Retention {
+        ALWAYS,     // until the next value is written (default)
+        TIMED,      // for a duration after writing
+        NEVER       // not at all, values are only delivered to receivers and the history
+    };
+
+    /**
+     * Receiver lists are immutable snapshots which are replaced as a whole (copy-on-write) when
+     * receivers are added or removed. Notification iterates over a snapshot without holding the
+     * store or entry locks. Receiver list pointers must only be accessed by means of
+     * std::atomic_load(), std::atomic_store() and std::atomic_compare_exchange_strong(), which are
+     * not lock-free: libstdc++ guards them with a mutex of a global pool, held for the copy of the
+     * pointer only. Unlike values (see LatestValue), the lists are replaced rarely.
+     */
+    using ReceiverList = std::vector<std::weak_ptr<IValueReceiver>>;
+    using ReceiverListPtr = std::shared_ptr<const ReceiverList>;
+
+    /**
+     * A value kept in the history of a topic, see enableHistory()
+     */
+    struct HistoryEntry {
+        uint64_t time;      // time of writing the value in microseconds since epoch
+        ValuePtr value;
+    };
+
+    /**
+     * Ring buffer holding the most recent values of a topic, ordered by time of writing
+     */
+    struct History {
+        explicit History(size_t maxCount, std::chrono::milliseconds maxAge)
+        : ring(maxCount), maxAge(maxAge) {}
+
+        const HistoryEntry& at(size_t index) const { return ring[(head + index) % ring.size()]; }
+        void push(uint64_t time, const ValuePtr& value);
+
+        std::vector<HistoryEntry> ring;
+        size_t head = 0;
+        size_t count = 0;
+        std::chrono::milliseconds maxAge;
+    };
+
+    /**
+     * Histogram of durations with power of two buckets, used for the topic statistics
+     *
+     * Recording is a single relaxed atomic increment. Percentiles are reported as the upper bound
+     * of the bucket they fall into, i.e. they are accurate to a factor of two.
+     */
+    struct DurationHistogram {
+        static constexpr size_t NUM_BUCKETS = 40;
+
+        void record(uint64_t ns);
+        uint64_t percentile(double p) const;
+
+        std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+    };
+
+    /**
+     * Counters collected per topic while statistics are enabled, see enableStatistics()
+     */
+    struct EntryStatistics {
+        std::atomic<uint64_t> writes{0};
+        std::atomic<uint64_t> blockedWrites{0};
+        std::atomic<uint64_t> blockedTimeNs{0};
+        DurationHistogram lockWait;
+        DurationHistogram fanOut;
+    };
+
+    /**
+     * Snapshot of the statistics of a topic, see getStatistics()
+     */
+    struct TopicStatistics {
+        std::string topic;
+        uint64_t writes;            // number of values written
+        uint64_t lockWaitP50Ns;     // time writers waited for the topic lock
+        uint64_t lockWaitP99Ns;
+        uint64_t fanOutP50Ns;       // time taken to notify the receivers of a value
+        uint64_t fanOutP99Ns;
+        size_t receivers;           // number of receivers registered for the topic
+        uint64_t blockedWrites;     // number of writes which waited for blocked receivers
+        uint64_t blockedTimeNs;     // total time writers waited for blocked receivers
+    };
+
+    /**
+     * The values held by a topic and the value queues receiving it, see getHeldValues()
+     */
+    struct HeldValues {
+        std::string topic;                                  // empty for the all topic receivers
+        ValuePtr value;                                     // the latest value, may be empty
+        std::vector<ValuePtr> history;                      // see enableHistory()
+        std::vector<std::shared_ptr<ValueQueue>> queues;    // value queues receiving the topic
+    };
+
     struct MapEntry {
-        MapEntry() : mutex(VALUE_STORE_PRIORITY) {}
+        MapEntry() : receivers(std::make_shared<const ReceiverList>()), mutex(VALUE_STORE_PRIORITY) {
+            mutex.setName("ValueStore::MapEntry");
+        }
 
         MapEntry(const MapEntry&) = delete; // disallow copy constructors
         MapEntry& operator=(const MapEntry&) = delete; // also disallow copy assignment
 
-        ValuePtr value;
-        std::vector<std::weak_ptr<IValueReceiver>> receivers;
+        /**
+         * The latest value of the topic
+         *
+         * Writers hold 'mutex' while publishing a new value, readers do not take any lock,
+         * see LatestValue.
+         */
+        LatestValue value;
+        ReceiverListPtr receivers;
+        std::unique_ptr<History> history; // optional, guarded by 'mutex'
+        EntryStatistics statistics;
+        /// type info of the last value serialized from this topic, see findTypeInfo()
+        mutable std::atomic<const TypemapEntry*> typeInfo{nullptr};
+        /// writes neither keep the value nor notify the receivers of the topic, see setElided()
+        std::atomic<bool> elided{false};
+        /// nanoseconds the value is kept, negative until it is replaced, see setRetention()
+        std::atomic<int64_t> retentionNs{-1};
+        /// steady clock time the value was written in nanoseconds, maintained for timed retention
+        std::atomic<int64_t> writtenNs{0};
+        /// sequence number of the latest write to this topic, guarded by 'mutex'
+        uint64_t sequence = 0;
+        /// latest sequence number per origin of injected values, guarded by 'mutex'
+        std::vector<std::pair<const void*, uint64_t>> originSequences;
         mutable mutex::PriorityCeilingMutex mutex;
     };
 
+    /**
+     * Handle to a topic of the value store, as returned by getTopicHandle()
+     *
+     * A handle points directly at the map entry of its topic, so that reads and writes via the
+     * handle neither hash the topic string nor take the global map lock. Map entries are never
+     * removed, hence a handle stays valid for the lifetime of the value store it was obtained from.
+     */
+    class TopicHandle {
+    public:
+        TopicHandle() = default;
+
+        /**
+         * A default constructed handle does not refer to any topic
+         */
+        bool valid() const { return fEntry != nullptr; }
+
+        /**
+         * The topic name, must only be called on valid handles
+         */
+        const std::string& topic() const { return *fTopic; }
+
+    private:
+        friend ValueStore;
+
+        TopicHandle(const std::string* topic, MapEntry* entry) : fTopic(topic), fEntry(entry) {}
+
+        const std::string* fTopic = nullptr;
+        MapEntry* fEntry = nullptr;
+    };
+
+    /**
+     * Resolve a topic name into a handle, creating the topic entry if it does not exist yet
+     *
+     * This is meant to be called once at setup time (e.g. when a port is connected), the
+     * handle based overloads of setValue(), getValue() and hasValue() are then lock-free with
+     * respect to the global map.
+     *
+     * @param key   The name of the topic
+     * @return A valid handle to the topic
+     */
+    TopicHandle getTopicHandle(const std::string& key);
+
+    using TypeRegistry::findTypeInfo;
+
+    /**
+     * Look up the type info of a value published on the topic of the given handle
+     *
+     * The type info is cached per topic, so in steady state this neither hashes nor allocates.
+     */
+    const TypemapEntry* findTypeInfo(const TopicHandle& handle, const Value& value) const;
+
+    /**
+     * Number of receivers registered for the topic of a handle, without the all topic receivers
+     */
+    size_t getReceiverCount(const TopicHandle& handle) const;
+
+    /**
+     * Whether values written to the topic of a handle reach anyone: the receivers of the topic
+     * (e.g. receiver ports and the send rules of remote services), its history, or an all topic
+     * receiver wanting the topic (e.g. a recorder not excluding it), see IValueReceiver::wantsTopic()
+     *
+     * Readers polling the topic with getValue() are not known to the value store.
+     */
+    bool hasSubscribers(const TopicHandle& handle) const;
+
+    using SubscriptionObserver = std::function<void(bool subscribed)>;
+    using ObserverId = uint64_t;
+
+    /**
+     * Call observer with the result of hasSubscribers() for the topic of a handle, once right
+     * away and then whenever it changes because receivers are added or removed, a history is
+     * enabled or notifySubscriptionsChanged() is called
+     *
+     * Observers are called on the thread making the change, serialized by a lock of the value
+     * store. They must not add or remove receivers or observers.
+     *
+     * @return The id to remove the observer with
+     */
+    ObserverId addSubscriptionObserver(const TopicHandle& handle, SubscriptionObserver observer);
+
+    /**
+     * Remove an observer, it is not called any more when this returns
+     */
+    void removeSubscriptionObserver(ObserverId id);
+
+    /**
+     * Re-evaluate the subscription observers, e.g. after an all topic receiver changed the topics
+     * it wants
+     */
+    void notifySubscriptionsChanged();
+
+    /**
+     * Let writes to a topic skip keeping its latest value and notifying its receivers
+     *
+     * Meant for topics no one reads, see ComponentManager::setTopicElision(): a value written to
+     * an elided topic only reaches the all topic receivers (e.g. a recorder or a tracer), while
+     * hasValue() and getValue() keep returning the value written before elision. Elision is
+     * refused for topics with receivers or a history, and ends as soon as a receiver is added to
+     * the topic or its history is enabled.
+     *
+     * @return Whether the topic is elided now
+     */
+    bool setElided(const TopicHandle& handle, bool elided);
+
+    bool isElided(const TopicHandle& handle) const;
+
+    /**
+     * The QoS profiles of the topics, applied by the ports, remote services and recorders using
+     * this value store, see TopicQos
+     */
+    TopicQos& getTopicQos() { return fTopicQos; }
+    const TopicQos& getTopicQos() const { return fTopicQos; }
+
     void addReceiver(const std::string& key, const std::shared_ptr<IValueReceiver>& receiver);
     void removeReceiver(const std::string& key, const std::shared_ptr<IValueReceiver>& receiver);
     void addAllTopicReceiver(const std::shared_ptr<IValueReceiver>& receiver);
     void removeAllTopicReceiver(const std::shared_ptr<IValueReceiver>& receiver);
 
+    /**
+     * Register a receiver for all topics matching a glob pattern
+     *
+     * In patterns, '*' matches any sequence of characters (including '/') and '?' matches a
+     * single character, e.g. "/sensors/*". Patterns are matched once per topic, when the topic
+     * entry is created or when the receiver is added. The receiver is then stored with the
+     * matching topics, so writes to other topics do not cost anything for this receiver.
+     *
+     * @param pattern   glob pattern the topics must match
+     * @param receiver  the receiver
+     * @param excludes  glob patterns of topics to be excluded, even if they match 'pattern'
+     */
+    void addPatternReceiver(const std::string& pattern,
+                            const std::shared_ptr<IValueReceiver>& receiver,
+                            const std::vector<std::string>& excludes = std::vector<std::string>());
+
+    /**
+     * Unregister a receiver from all topics it was registered to by addPatternReceiver()
+     *
+     * Note: this also removes the receiver from matching topics it was added to by addReceiver().
+     */
+    void removePatternReceiver(const std::shared_ptr<IValueReceiver>& receiver);
+
+    /**
+     * Match a topic against a glob pattern as used by addPatternReceiver()
+     */
+    static bool matchesPattern(const std::string& pattern, const std::string& topic);
+
     template<typename T, typename = std::enable_if_t<std::is_base_of<Value, T>::value>>
     int setValue(const std::string& key,
                  T&& value,
@@ -244,8 +851,10 @@ public:
     /**
      * Write a ValuePtr to the value store at the specified topic
      *
-     * Note: in order to abort waiting, the function 'checkAbort()' must return true. The abort
-     *       will occur at the end of the current ~10ms polling interval.
+     * Note: in order to abort waiting, the function 'checkAbort()' must return true. Waiting
+     *       writers are woken as soon as a blocking receiver is popped. An abort is noticed
+     *       immediately after wakeBlockedWriters() has been called for the topic, otherwise at
+     *       the end of the current abort polling interval (see ValueQueue::ABORT_POLL_INTERVAL).
      *
      * @param key      The name of the topic
      * @param vp       A shared_ptr to the value to be written to the value store
@@ -270,20 +879,362 @@ public:
                  bool blocking=true,
                  const std::function<bool()>& checkAbort = [](){ return false; });
 
+    /**
+     * Write a ValuePtr to the topic referred to by a handle
+     *
+     * Same as setValue(const std::string&, ...), but without the topic lookup.
+     *
+     * @param handle   A valid handle obtained from getTopicHandle() of this value store
+     */
+    int setValue(const TopicHandle& handle,
+                 const ValuePtr& vp,
+                 bool blocking=true,
+                 const std::function<bool()>& checkAbort = [](){ return false; });
+
+    /**
+     * Write a ValuePtr to the topic referred to by a handle, waiting at most 'timeout' for
+     * blocked receivers
+     *
+     * @return See setValue(), additionally
+     *         ETIMEDOUT: vp was not written to the value store because receivers were still
+     *                    blocked when the timeout expired
+     */
+    int setValue(const TopicHandle& handle,
+                 const ValuePtr& vp,
+                 std::chrono::nanoseconds timeout,
+                 const std::function<bool()>& checkAbort = [](){ return false; });
+
+    /**
+     * Write a value received from outside of the process, e.g. by a remote link
+     *
+     * Same as setValue(), but the value is numbered with regard to its origin: the value store
+     * numbers the writes to a topic from 1 on and passes the number to the receivers, see
+     * IValueReceiver::receive(). An injected value advances the number of the topic by as many
+     * as its origin's number advanced since the previous value of the same origin, so that values
+     * lost on the way show as gaps, see ValueQueue::getGaps(). A lower origin number, e.g. after
+     * a restart of the origin, and an unknown origin number (0) advance it by one.
+     *
+     * @param origin   The origin of the value and its sequence number there
+     */
+    int injectValue(const std::string& key,
+                    const ValuePtr& vp,
+                    const ValueOrigin& origin,
+                    bool blocking=true,
+                    const std::function<bool()>& checkAbort = [](){ return false; });
+
+    int injectValue(const TopicHandle& handle,
+                    const ValuePtr& vp,
+                    const ValueOrigin& origin,
+                    bool blocking=true,
+                    const std::function<bool()>& checkAbort = [](){ return false; });
+
+    int injectValue(const TopicHandle& handle,
+                    const ValuePtr& vp,
+                    const ValueOrigin& origin,
+                    std::chrono::nanoseconds timeout,
+                    const std::function<bool()>& checkAbort = [](){ return false; });
+
+    /**
+     * Wake all writers waiting for blocked receivers of the topic, e.g. after their abort
+     * condition has changed
+     */
+    void wakeBlockedWriters(const TopicHandle& handle);
+
+    /**
+     * Wait until no receiver of the topic is blocked any more, without writing a value
+     *
+     * Like a blocking setValue(), the wait ends as soon as a blocked receiver is popped. Abort
+     * conditions are re-evaluated after wakeBlockedWriters() has been called for the topic.
+     *
+     * @param handle     A valid handle obtained from getTopicHandle() of this value store
+     * @param checkAbort waiting is aborted when this function returns true
+     * @param deadline   waiting is aborted when this point in time is reached
+     * @return true if no receiver of the topic is blocked
+     */
+    bool waitUnblocked(const TopicHandle& handle,
+                       const std::function<bool()>& checkAbort,
+                       std::chrono::steady_clock::time_point deadline
+                           = std::chrono::steady_clock::time_point::max());
+
+    /**
+     * A batch of values to be written by setValues()
+     */
+    using ValueBatch = std::vector<std::pair<TopicHandle, ValuePtr>>;
+
+    /**
+     * Write several values to the value store at once
+     *
+     * The entries of all topics in the batch are locked in a defined order before any value is
+     * written and receivers are notified only after all values have been written. Coalescable
+     * triggers (e.g. the triggers of components) fire once per batch instead of once per value.
+     * If a topic occurs more than once in the batch, its values are written in batch order.
+     *
+     * @param batch    Pairs of valid topic handles and values to be written
+     * @param blocking See setValue(), applies to the receivers of all topics in the batch
+     * @param checkAbort    waiting is aborted when this function returns true
+     * @return See setValue(). If an error code is returned, no value of the batch has been written.
+     */
+    int setValues(const ValueBatch& batch,
+                  bool blocking=true,
+                  const std::function<bool()>& checkAbort = [](){ return false; });
+
+    /**
+     * Check if a value has been written to the given topic
+     */
     bool hasValue(const std::string& key) const;
 
+    /**
+     * Check if a value has been written to the topic referred to by a handle
+     */
+    bool hasValue(const TopicHandle& handle) const;
+
     template<typename T>
     std::shared_ptr<const T> getValue(const std::string& key) const;
 
+    /**
+     * Read the value of the topic referred to by a handle
+     *
+     * Same as getValue(const std::string&), but without the topic lookup.
+     */
+    template<typename T>
+    std::shared_ptr<const T> getValue(const TopicHandle& handle) const;
+
+    /**
+     * Keep a history of the most recent values written to a topic
+     *
+     * The history is shared by all readers of the topic, values are not copied.
+     *
+     * @param key      The name of the topic
+     * @param maxCount The maximum number of values to keep, 0 disables the history
+     * @param maxAge   If non-zero, values older than maxAge with respect to the most recent value
+     *                 are dropped from the history
+     */
+    void enableHistory(const std::string& key,
+                       size_t maxCount,
+                       std::chrono::milliseconds maxAge = std::chrono::milliseconds(0));
+
+    /**
+     * Set how long a topic keeps its latest value for hasValue() and getValue()
+     *
+     * By default the latest value is kept until it is replaced, so that e.g. the ext mem buffer of
+     * a camera frame stays allocated after all queued receivers have processed it. With
+     * Retention::NEVER a value is only delivered to the receivers and the history of the topic,
+     * with Retention::TIMED it is released 'duration' after writing by a thread of the value
+     * store. Released values are absent for readers. A value the topic holds when the retention
+     * is changed is released at once for Retention::NEVER and kept for 'duration' from now for
+     * Retention::TIMED.
+     *
+     * @param key       The name of the topic
+     * @param retention The retention policy
+     * @param duration  The time a value is kept for Retention::TIMED, zero is the same as
+     *                  Retention::NEVER
+     */
+    void setRetention(const std::string& key,
+                      Retention retention,
+                      std::chrono::milliseconds duration = std::chrono::milliseconds(0));
+
+    /**
+     * Get the most recent n values in the history of a topic, the most recent value last
+     *
+     * @return Up to n entries, empty if the topic has no history
+     */
+    std::vector<HistoryEntry> getHistory(const std::string& key, size_t n) const;
+
+    /**
+     * Get the value of a topic at the given point in time (i.e. the last value written at or
+     * before that time) from the history of the topic
+     *
+     * Returns a default constructed value, if the history of the topic does not reach back to
+     * the given time or the value is not of type T.
+     *
+     * @param key       The name of the topic
+     * @param timestamp Microseconds since epoch
+     */
+    template<typename T>
+    std::shared_ptr<const T> getValueAt(const std::string& key, uint64_t timestamp) const;
+
+    /**
+     * Get the value of a topic as msgpack object
+     *
+     * Note: the zone of the returned object is not kept alive, so objects referring to zone memory
+     * (e.g. strings, arrays, maps) must not be accessed. Prefer getValueMsgpackHandle() or
+     * getValuePacked().
+     */
     msgpack::object getValueMsgpack(const std::string& key) const ;
+
+    /**
+     * Get the value of a topic as msgpack object together with the zone owning its memory
+     *
+     * The value is serialized once and unpacked directly from the serialization buffer.
+     * The object is nil if the topic has no value, and the string "serialization error" if the
+     * type of the value is not registered.
+     */
+    msgpack::object_handle getValueMsgpackHandle(const std::string& key) const;
+
+    /**
+     * Serialize the value of a topic into the given buffer, e.g. for sending it as is
+     *
+     * @param key    The name of the topic
+     * @param buffer The buffer the packed value is appended to
+     * @return false, if the topic has no value or the type of the value is not registered
+     */
+    bool getValuePacked(const std::string& key, msgpack::sbuffer& buffer) const;
     std::vector<std::string> getKeys() const;
 
+    /**
+     * Enable or disable collecting per topic statistics (disabled by default)
+     *
+     * While disabled, writes only pay for a relaxed atomic load of the flag. While enabled, each
+     * write additionally takes three clock readings and a few relaxed atomic increments.
+     */
+    void enableStatistics(bool enable) { fStatisticsEnabled.store(enable, std::memory_order_relaxed); }
+    bool statisticsEnabled() const { return fStatisticsEnabled.load(std::memory_order_relaxed); }
+
+    /**
+     * Snapshot of the statistics of all topics which have been written since statistics were
+     * first enabled
+     */
+    std::vector<TopicStatistics> getStatistics() const;
+
+    /**
+     * Snapshot of the values held by all topics and of the value queues receiving them
+     *
+     * Only the pointers are copied, so the values are kept alive until the result is discarded.
+     * The value queues receiving all topics are returned as a last entry with an empty topic.
+     */
+    std::vector<HeldValues> getHeldValues() const;
+
 private:
 
+    int setValueImpl(const std::string& key,
+                     MapEntry& entry,
+                     const ValuePtr& vp,
+                     const ValueOrigin* origin,
+                     bool blocking,
+                     const std::function<bool()>& checkAbort,
+                     std::chrono::steady_clock::time_point deadline
+                         = std::chrono::steady_clock::time_point::max());
+
+    ValuePtr getHistoryValueAt(const std::string& key, uint64_t timestamp) const;
+
+    /**
+     * Keep a written value as the latest value of its topic according to the retention of the
+     * topic, the entry must be locked by the caller
+     *
+     * @param wakeExpiry set if the expiry thread must be woken after unlocking the entry
+     * @return The previous value, to be released outside of the critical section
+     */
+    ValuePtr retainValue(MapEntry& entry, const ValuePtr& vp, bool& wakeExpiry);
+
+    /**
+     * Take the sequence number of a write to a topic, see injectValue(). The entry must be locked
+     * by the caller.
+     *
+     * @param origin The origin of an injected value, nullptr for local writes
+     */
+    static uint64_t nextSequence(MapEntry& entry, const ValueOrigin* origin);
+
+    /**
+     * Check whether the value of a topic with timed retention is past its retention, i.e. about
+     * to be released by the expiry thread. Must be called after loading the value.
+     */
+    static bool isExpired(const MapEntry& entry) {
+        const int64_t retentionNs = entry.retentionNs.load(std::memory_order_relaxed);
+        return retentionNs > 0
+               && steadyNanoseconds() - entry.writtenNs.load(std::memory_order_acquire) >= retentionNs;
+    }
+
+    static int64_t steadyNanoseconds() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void wakeExpiryThread();
+
+    /**
+     * Body of the expiry thread, releases the values of topics with timed retention
+     */
+    void releaseExpiredValues();
+
+    struct SubscriptionObserverEntry {
+        ObserverId id;
+        TopicHandle handle;
+        SubscriptionObserver observer;
+        bool subscribed;
+    };
+
+    struct PatternReceiver {
+        std::string pattern;
+        std::vector<std::string> excludes;
+        std::weak_ptr<IValueReceiver> receiver;
+
+        bool matches(const std::string& topic) const;
+    };
+
+    /**
+     * Find or create the entry of a topic, fMutex must be locked exclusively by the caller
+     *
+     * Newly created entries get the pattern receivers matching the topic.
+     */
+    std::pair<const std::string, MapEntry>& getEntryUnlocked(const std::string& key);
+
+    /**
+     * Find or create the entry of a topic, locks fMutex exclusively only to create the entry
+     */
+    std::pair<const std::string, MapEntry>& getEntry(const std::string& key);
+
+    /**
+     * Look up the type info of a value of the given topic, using the type info cached in the entry
+     */
+    const TypemapEntry* findTypeInfo(const MapEntry& entry, const Value& value) const;
+
+    /**
+     * Read the value of a topic and look up its type info, returns nullptr if there is no value
+     */
+    ValuePtr getValueWithTypeInfo(const std::string& key, const TypemapEntry*& typeInfo) const;
+
+    /**
+     * Start time of a traced read, or a default constructed time point if tracing is off
+     */
+    static std::chrono::high_resolution_clock::time_point readTraceTime() {
+        return TracePolicy::active() ? std::chrono::high_resolution_clock::now()
+                                     : std::chrono::high_resolution_clock::time_point();
+    }
+
+    template<typename T>
+    std::shared_ptr<const T> getValueImpl(const std::string& key, const MapEntry& entry,
+            std::chrono::high_resolution_clock::time_point entryTime) const;
+
     ValueFactory fValueFactory;
     std::unordered_map<std::string, MapEntry> fMap;
-    std::vector<std::weak_ptr<IValueReceiver>> fAllTopicReceivers;
-    mutable mutex::PriorityCeilingMutex fMutex;
+    ReceiverListPtr fAllTopicReceivers = std::make_shared<const ReceiverList>();
+    std::vector<PatternReceiver> fPatternReceivers;
+    std::atomic<bool> fStatisticsEnabled{false};
+    TopicQos fTopicQos;
+    /**
+     * Protects fMap, fAllTopicReceivers and fPatternReceivers. Lookups in fMap lock it shared,
+     * creating entries and changing receivers lock it exclusively.
+     */
+    mutable mutex::PriorityInheritanceSharedMutex fMutex;
+
+    /**
+     * Topics with timed retention and the expiry thread, started by the first call to
+     * setRetention() with Retention::TIMED. fExpiryMutex is never held while locking an entry.
+     */
+    std::mutex fExpiryMutex;
+    std::condition_variable fExpiryCv;
+    std::vector<MapEntry*> fTimedEntries;
+    uint64_t fExpiryWakeups = 0;
+    bool fStopExpiry = false;
+    std::thread fExpiryThread;
+
+    /**
+     * Observers of hasSubscribers(), see addSubscriptionObserver(). fObserverMutex is locked
+     * after the receivers have been changed, never while holding fMutex.
+     */
+    std::mutex fObserverMutex;
+    std::vector<SubscriptionObserverEntry> fObservers;
+    ObserverId fNextObserverId = 1;
 };
 
 
@@ -291,9 +1242,8 @@ private:
 template<typename T>
 std::shared_ptr<const T> ValueQueue::peek() {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    if (!fQueue.empty()) {
-        ValuePtr ptr = std::get<0>(fQueue.front());
-        return std::dynamic_pointer_cast<const T>(ptr);
+    if (frontVisibleUnlocked()) {
+        return castValue<T>(frontValueUnlocked());
     }
     else {
         throw QueueEmptyException();
@@ -303,11 +1253,27 @@ std::shared_ptr<const T> ValueQueue::peek() {
 template<typename T>
 std::shared_ptr<const T> ValueQueue::pop() {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    if (!fQueue.empty()) {
-        ValuePtr ptr = std::get<0>(fQueue.front());
-        fQueue.pop_front();
-        fUnblockCv.notify_all();
-        return std::dynamic_pointer_cast<const T>(ptr);
+    if (frontVisibleUnlocked()) {
+        ValuePtr ptr = frontValueUnlocked();
+        const bool wasBlocked = isBlockedInternal();
+        countPoppedUnlocked(1);
+        popFrontUnlocked();
+        if (wasBlocked) {
+            // only writers parked on a full queue wait for the condition
+            fUnblockCv.notify_all();
+        }
+        return castValue<T>(ptr);
+    }
+    else {
+        throw QueueEmptyException();
+    }
+}
+
+template<typename T>
+ValueTopicTuple<T> ValueQueue::peekWithTopic() {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    if (frontVisibleUnlocked()) {
+        return ValueTopicTuple<T>(castValue<T>(frontValueUnlocked()), frontTopicUnlocked());
     }
     else {
         throw QueueEmptyException();
@@ -317,17 +1283,56 @@ std::shared_ptr<const T> ValueQueue::pop() {
 template<typename T>
 ValueTopicTuple<T> ValueQueue::popWithTopic() {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    if (!fQueue.empty()) {
-        auto e = fQueue.front();
-        fQueue.pop_front();
-        fUnblockCv.notify_all();
-        return ValueTopicTuple<T>(std::dynamic_pointer_cast<const T>(std::get<0>(e)), std::get<1>(e));
+    if (frontVisibleUnlocked()) {
+        ValueTopicTuple<T> e(castValue<T>(frontValueUnlocked()), frontTopicUnlocked());
+        const bool wasBlocked = isBlockedInternal();
+        countPoppedUnlocked(1);
+        popFrontUnlocked();
+        if (wasBlocked) {
+            fUnblockCv.notify_all();
+        }
+        return e;
     }
     else {
         throw QueueEmptyException();
     }
 }
 
+namespace detail {
+
+template<typename T>
+inline std::shared_ptr<const T> castQueuedValue(const ValuePtr& value) {
+    return castValue<T>(value);
+}
+
+template<>
+inline std::shared_ptr<const Value> castQueuedValue<Value>(const ValuePtr& value) {
+    return value;
+}
+
+} // namespace detail
+
+template<typename T>
+size_t ValueQueue::popMany(std::vector<std::shared_ptr<const T>>& out, size_t maxCount) {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    const size_t available = visibleSizeUnlocked();
+    const size_t count = maxCount == 0 ? available : std::min(maxCount, available);
+    if (count == 0) {
+        return 0;
+    }
+    const bool wasBlocked = isBlockedInternal();
+    countPoppedUnlocked(count);
+    out.reserve(out.size() + count);
+    for (size_t i = 0; i < count; ++i) {
+        out.push_back(detail::castQueuedValue<T>(frontValueUnlocked()));
+        popFrontUnlocked();
+    }
+    if (wasBlocked) {
+        fUnblockCv.notify_all();
+    }
+    return count;
+}
+
 template<typename T, typename>
 inline int ValueStore::setValue(const std::string& key,
                                 T&& value,
@@ -352,33 +1357,63 @@ inline int ValueStore::setValue(const std::string& key,
 
 template<typename T>
 inline std::shared_ptr<const T> ValueStore::getValue(const std::string& key) const {
-    const auto entryTime = std::chrono::high_resolution_clock::now();
-    std::unique_lock<mutex::PriorityCeilingMutex> lk(fMutex);
+    const auto entryTime = readTraceTime();
+    std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
     auto entry = fMap.find(key);
 
     if (entry != fMap.end())
     {
-        std::unique_lock<mutex::PriorityCeilingMutex> topicLock(entry->second.mutex);
         lk.unlock();
-        auto val = std::dynamic_pointer_cast<const T>(entry->second.value);
-        topicLock.unlock();
+        return getValueImpl<T>(key, entry->second, entryTime);
+    }
+    return defaultValue<T>();
+}
+
+template<typename T>
+inline std::shared_ptr<const T> ValueStore::getValue(const TopicHandle& handle) const {
+    const auto entryTime = readTraceTime();
+    if (handle.valid())
+    {
+        return getValueImpl<T>(*handle.fTopic, *handle.fEntry, entryTime);
+    }
+    return defaultValue<T>();
+}
+
+template<typename T>
+inline std::shared_ptr<const T> ValueStore::getValueAt(const std::string& key, uint64_t timestamp) const {
+    auto val = castValue<T>(getHistoryValueAt(key, timestamp));
+    if (val != nullptr) {
+        return val;
+    }
+    return defaultValue<T>();
+}
+
+template<typename T>
+inline std::shared_ptr<const T> ValueStore::getValueImpl(const std::string& key,
+        const MapEntry& entry, std::chrono::high_resolution_clock::time_point entryTime) const {
+    // lock-free read, see MapEntry::value
+    auto val = castValue<T>(entry.value.load());
+    if (val != nullptr && isExpired(entry)) {
+        val = nullptr;
+    }
+    if (entryTime != std::chrono::high_resolution_clock::time_point())
+    {
         const auto exitTime = std::chrono::high_resolution_clock::now();
         auto generator = ComponentTraceController::getLocalEventGenerator();
         if (generator && !generator->isTracingTopic(key)) // do not trace tracing events
         {
             generator->traceExecutionTime(entryTime, exitTime, "valueStoreRead");
         }
-        if (val != nullptr) {
-            return val;
-        }
-        else {
-            // map entry contains empty shared ptr
-        }
     }
-    return std::make_shared<const T>();
+    if (val != nullptr) {
+        return val;
+    }
+    else {
+        // map entry contains empty shared ptr
+    }
+    return defaultValue<T>();
 }
 
-
 }
 
 #endif
@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_VALUESTORESTATSPUBLISHER_H
+#define MCF_VALUESTORESTATSPUBLISHER_H
+
+#include "mcf_core/Mcf.h"
+
+#include <chrono>
+#include <map>
+#include <string>
+
+namespace mcf {
+
+/**
+ * Component periodically publishing the per topic statistics of a value store
+ *
+ * Enables statistics collection on the value store while running and publishes a
+ * msg::ValueStoreStats value on DEFAULT_TOPIC (or the topic the port is mapped to).
+ */
+class ValueStoreStatsPublisher : public Component {
+
+public:
+    static constexpr const char* DEFAULT_TOPIC = "/mcf/valuestore/stats";
+
+    /**
+     * Constructor
+     *
+     * @param valueStore The value store to publish the statistics of, the reference is stored
+     * @param interval   Time between two statistics messages
+     */
+    explicit ValueStoreStatsPublisher(ValueStore& valueStore,
+                                      std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+
+    void configure(IComponentConfig& config) override;
+    void startup() override;
+    void shutdown() override;
+
+private:
+    void tick();
+    void publish();
+
+    ValueStore& fValueStore;
+    std::chrono::milliseconds fInterval;
+    std::chrono::steady_clock::time_point fLastPublish;
+    std::map<std::string, uint64_t> fLastWrites;
+    bool fWasEnabled = false;
+    SenderPort<msg::ValueStoreStats> fStatsPort;
+};
+
+} // namespace mcf
+
+#endif // MCF_VALUESTORESTATSPUBLISHER_H
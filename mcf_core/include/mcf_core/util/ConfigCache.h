@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_UTIL_CONFIGCACHE_H
+#define MCF_UTIL_CONFIGCACHE_H
+
+#include "json/json.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mcf
+{
+namespace util
+{
+namespace json
+{
+
+/**
+ * Cache of parsed and merged Json config files
+ *
+ * Each file is parsed at most once per process, however many components merge it into their
+ * configs, and as long as the file does not change. A file is identified by its path, and it is
+ * considered unchanged while its modification time and size are the same.
+ *
+ * Optionally, the parsed files are stored in a binary cache file, see open(). Files found there
+ * with the same modification time and size are decoded from the memory mapped cache file instead
+ * of being read and parsed. Files whose modification time changed but whose contents hash to the
+ * same value are decoded as well, e.g. after a checkout touched them.
+ *
+ * The methods are thread safe.
+ */
+class ConfigCache
+{
+public:
+    /**
+     * The cache of the process, used by Component::readConfig() and the replay configuration
+     */
+    static ConfigCache& instance();
+
+    ConfigCache() = default;
+
+    ConfigCache(const ConfigCache&) = delete;
+    ConfigCache& operator=(const ConfigCache&) = delete;
+
+    /**
+     * Use a binary cache file, which is read if it exists and written by save()
+     *
+     * A cache file that cannot be read or was written by an incompatible version is ignored.
+     */
+    void open(const std::string& cacheFile);
+
+    /**
+     * The binary cache file, empty if open() was not called
+     */
+    std::string cacheFile() const;
+
+    /**
+     * Write the binary cache file if files were parsed since it was opened
+     *
+     * The file is replaced atomically, entries of files not used by this process are kept.
+     * Throws Json::RuntimeError if the file cannot be written.
+     */
+    void save();
+
+    /**
+     * The contents of a Json file
+     *
+     * Throws Json::RuntimeError if the file cannot be opened or parsed.
+     */
+    Json::Value loadFile(const std::string& filePath);
+
+    /**
+     * Create value from multiple Json files merged in the given order, like
+     * mcf::util::json::mergeFiles()
+     */
+    Json::Value mergeFiles(const std::vector<std::string>& filePaths, bool skipMissing = false);
+
+    /// number of files read and parsed
+    uint64_t filesParsed() const;
+
+    /// number of files decoded from the binary cache file
+    uint64_t filesDecoded() const;
+
+private:
+    using ValuePtr = std::shared_ptr<const Json::Value>;
+
+    struct FileEntry
+    {
+        int64_t mtime = 0;
+        uint64_t size = 0;
+        uint64_t hash = 0;
+        ValuePtr value;
+        bool loading = false;
+    };
+
+    // the location of a file in the binary cache file
+    struct StoredEntry
+    {
+        int64_t mtime = 0;
+        uint64_t size = 0;
+        uint64_t hash = 0;
+        uint64_t offset = 0;
+        uint64_t length = 0;
+    };
+
+    struct MergedEntry
+    {
+        std::vector<ValuePtr> files;
+        ValuePtr value;
+    };
+
+    // called with fMutex held
+    ValuePtr lookup(std::unique_lock<std::mutex>& lk, const std::string& filePath, bool skipMissing);
+    void readCacheFile();
+    void closeCacheFile();
+
+    static FileEntry load(const std::string& filePath,
+                          int64_t mtime,
+                          uint64_t size,
+                          const char* mapping,
+                          const StoredEntry* stored,
+                          bool& decoded);
+    static ValuePtr decode(const std::string& filePath, const char* mapping, const StoredEntry& stored);
+
+    mutable std::mutex fMutex;
+    std::condition_variable fLoaded;
+    std::map<std::string, FileEntry> fFiles;
+    std::map<std::vector<std::string>, MergedEntry> fMerged;
+    std::string fCacheFile;
+    std::shared_ptr<const char> fMapping;
+    size_t fMappingSize = 0;
+    std::map<std::string, StoredEntry> fStored;
+    bool fDirty = false;
+    uint64_t fFilesParsed = 0;
+    uint64_t fFilesDecoded = 0;
+};
+
+} // namespace json
+} // namespace util
+} // namespace mcf
+
+#endif // MCF_UTIL_CONFIGCACHE_H
@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/BatchReplay.h"
+#include "mcf_core/ComponentInstantiator.h"
+#include "mcf_core/ComponentManager.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/LoggingMacros.h"
+#include "mcf_core/Plugin.h"
+#include "mcf_core/PluginLoader.h"
+#include "mcf_core/ThreadName.h"
+#include "mcf_core/ValueStore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace mcf {
+
+constexpr const char* BatchReplay::RECORDING_EVENT_SOURCE;
+
+BatchReplay::BatchReplay(Params params)
+: fParams(std::move(params))
+{
+}
+
+BatchReplay::~BatchReplay() = default;
+
+void BatchReplay::addPlugin(const Plugin& plugin)
+{
+    const auto types = plugin.types();
+    fComponentTypes.insert(fComponentTypes.end(), types.begin(), types.end());
+}
+
+void BatchReplay::loadPlugin(const std::string& fileName)
+{
+    if (!fPluginLoader)
+    {
+        fPluginLoader = std::make_unique<PluginLoader>();
+    }
+    addPlugin(fPluginLoader->load(fileName));
+}
+
+void BatchReplay::setSetupFunction(SetupFunction setup)
+{
+    fSetup = std::move(setup);
+}
+
+std::vector<BatchReplay::Result> BatchReplay::run(const std::vector<Scenario>& scenarios)
+{
+    std::vector<Result> results(scenarios.size());
+    std::atomic<size_t> nextScenario(0);
+
+    auto worker = [&](CpuMask cpus)
+    {
+        setThreadName("BatchReplay");
+        if (cpus != 0)
+        {
+            const int error = setThreadCpuAffinity(pthread_self(), cpus);
+            if (error != 0)
+            {
+                MCF_WARN_NOFILELINE("Cannot pin batch replay worker to CPUs {}, error {}",
+                                    formatCpuMask(cpus), error);
+            }
+        }
+        for (size_t i = nextScenario++; i < scenarios.size(); i = nextScenario++)
+        {
+            results[i] = runScenario(scenarios[i], cpus);
+        }
+    };
+
+    const std::vector<CpuMask> coreSets =
+        fParams.coreSets.empty() ? std::vector<CpuMask>(1, 0) : fParams.coreSets;
+    std::vector<std::thread> workers;
+    for (CpuMask cpus : coreSets)
+    {
+        workers.emplace_back(worker, cpus);
+    }
+    for (auto& thread : workers)
+    {
+        thread.join();
+    }
+    return results;
+}
+
+BatchReplay::Result BatchReplay::runScenario(const Scenario& scenario, CpuMask cpus)
+{
+    Result result;
+    result.name = scenario.name;
+    const auto startTime = std::chrono::steady_clock::now();
+    try
+    {
+        // declared in the order of their dependencies, destroyed in reverse
+        // the types are shared by the value stores of all scenarios instead of copied into each
+        ValueStore valueStore(fTypeRegistry);
+
+        ComponentManager componentManager(
+            valueStore,
+            scenario.configDirs.empty()
+                ? std::vector<std::string>(1, ComponentManager::DEFAULT_CONFIG_DIR)
+                : scenario.configDirs);
+        if (fParams.executorThreads)
+        {
+            const size_t cores = cpus != 0 ? __builtin_popcountll(cpus) : std::thread::hardware_concurrency();
+            componentManager.setExecutorThreads(std::max<size_t>(cores, 1), cpus);
+        }
+
+        ComponentInstantiator componentInstantiator(componentManager);
+        for (const auto& type : fComponentTypes)
+        {
+            componentInstantiator.addComponentType(type);
+        }
+        for (const auto& component : scenario.components)
+        {
+            componentInstantiator.createComponent(component.typeName, component.instanceName);
+        }
+
+        ReplayEventController replayEventController(valueStore, fParams.replayParams);
+        auto eventSource = std::make_shared<RecordingEventSource>(
+            valueStore,
+            scenario.recording,
+            replayEventController.getEventTimingController(),
+            fParams.recordingParams);
+        replayEventController.addEventSource(eventSource, RECORDING_EVENT_SOURCE);
+
+        if (fSetup)
+        {
+            Pipeline pipeline{scenario, valueStore, componentManager, componentInstantiator, replayEventController, cpus};
+            fSetup(pipeline);
+        }
+
+        if (!componentManager.configure())
+        {
+            MCF_THROW_RUNTIME("Invalid component configuration");
+        }
+        componentManager.startup();
+
+        replayEventController.run();
+        while (!replayEventController.isFinished())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        result.achievedSpeedup = replayEventController.getAchievedSpeedup();
+        componentManager.shutdown();
+        result.success = true;
+    }
+    catch (const std::exception& e)
+    {
+        MCF_ERROR_NOFILELINE("Replay of scenario {} failed: {}", scenario.name, e.what());
+        result.error = e.what();
+    }
+    result.wallTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime);
+    return result;
+}
+
+} // namespace mcf
@@ -4,23 +4,31 @@
 
 #include "mcf_core/Component.h"
 #include "mcf_core/ComponentTraceEventGenerator.h"
+#include "mcf_core/TracePolicy.h"
 #include "mcf_core/ComponentLogger.h"
 #include "mcf_core/ComponentTimer.h"
 #include "mcf_core/IComponent.h"
 #include "mcf_core/Messages.h"
+#include "mcf_core/Numa.h"
+#include "mcf_core/ParallelFor.h"
 #include "mcf_core/Port.h"
+#include "mcf_core/RealtimeMemory.h"
 #include "mcf_core/ValueStore.h"
 #include "mcf_core/ThreadName.h"
 
 #include "json/json.h"
-#include "mcf_core/util/MergeValues.h"
+#include "mcf_core/util/ConfigCache.h"
 #include "mcf_core/ErrorMacros.h"
 
+#include <algorithm>
 #include <chrono>
 #include <fstream>
 #include <stdexcept>
 #include <thread>
 
+#include <sys/syscall.h>
+#include <unistd.h>
+
 namespace mcf {
 
 namespace
@@ -32,6 +40,108 @@ namespace
     constexpr const char PATH_SEP = '/';
 #endif
 
+    // struct sched_attr of sched_setattr(2), not provided by all C libraries
+    struct SchedAttr
+    {
+        uint32_t size;
+        uint32_t schedPolicy;
+        uint64_t schedFlags;
+        int32_t schedNice;
+        uint32_t schedPriority;
+        uint64_t schedRuntime;
+        uint64_t schedDeadline;
+        uint64_t schedPeriod;
+    };
+
+    /*
+     * Switch the thread with the given kernel thread id to SCHED_DEADLINE, returns an errno value
+     */
+    int setThreadDeadlineScheduling(pid_t threadId, const IComponent::SchedulingParameters& parameters)
+    {
+#ifdef SYS_sched_setattr
+        SchedAttr attr{};
+        attr.size = sizeof(attr);
+        attr.schedPolicy = IComponent::SchedulingPolicy::Deadline;
+        attr.schedRuntime = parameters.runtime.count();
+        attr.schedDeadline = parameters.deadline.count();
+        attr.schedPeriod = parameters.period.count();
+        if (syscall(SYS_sched_setattr, threadId, &attr, 0u) != 0)
+        {
+            return errno;
+        }
+        return 0;
+#else
+        return ENOSYS;
+#endif
+    }
+
+    /*
+     * Lock serializing the handlers of a component, remembering the thread which holds it
+     */
+    class HandlerLock
+    {
+    public:
+        HandlerLock(std::mutex& mutex, std::atomic<std::thread::id>& owner)
+        : fLock(mutex)
+        , fOwner(owner)
+        {
+            fOwner = std::this_thread::get_id();
+        }
+
+        HandlerLock(std::mutex& mutex, std::atomic<std::thread::id>& owner, std::try_to_lock_t)
+        : fLock(mutex, std::defer_lock)
+        , fOwner(owner)
+        {
+            // the calling thread may hold the lock already, e.g. in a cycle of fused components
+            if (fOwner.load() != std::this_thread::get_id() && fLock.try_lock())
+            {
+                fOwner = std::this_thread::get_id();
+            }
+        }
+
+        ~HandlerLock()
+        {
+            if (fLock.owns_lock())
+            {
+                fOwner = std::thread::id();
+            }
+        }
+
+        bool ownsLock() const
+        {
+            return fLock.owns_lock();
+        }
+
+    private:
+        std::unique_lock<std::mutex> fLock;
+        std::atomic<std::thread::id>& fOwner;
+    };
+
+    /*
+     * Lets the calling thread log and trace on behalf of a component while in scope
+     */
+    class ThreadLocalsScope
+    {
+    public:
+        ThreadLocalsScope(ComponentLogger& logger,
+                          const std::shared_ptr<ComponentTraceEventGenerator>& eventGenerator)
+        : fPreviousLogger(logger.replaceLocalLogger())
+        , fPreviousEventGenerator(ComponentTraceEventGenerator::getLocalInstance())
+        {
+            ComponentTraceEventGenerator::setLocalInstance(eventGenerator);
+        }
+
+        ~ThreadLocalsScope()
+        {
+            ComponentLogger::restoreLocalLogger(std::move(fPreviousLogger));
+            ComponentTraceEventGenerator::setLocalInstance(fPreviousEventGenerator);
+        }
+
+    private:
+        std::shared_ptr<spdlog::logger> fPreviousLogger;
+        std::shared_ptr<ComponentTraceEventGenerator> fPreviousEventGenerator;
+    };
+
 } // anonymous namespace
 
 
@@ -45,32 +155,53 @@ Component::Component(const std::string& name, int priority)
   fInstanceName(name),
   fConfigOutPortTopic(std::string(DEFAULT_CONFIG_TOPIC_PATH) + name),
   fConfigInPortTopic(std::string(DEFAULT_CONFIG_TOPIC_PATH) + name),
+  fThreadId(0),
   fThreadSchedulingParameters(SchedulingParameters{IComponent::SchedulingPolicy::Fifo, priority}),
+  fHandlerDeadline(0),
   fRunRequest(false),
   fStopRequest(false),
   fState(INIT),
-  fTrigger(std::make_shared<Trigger>()),
+  fStartupDuration(std::chrono::microseconds(0)),
+  fTrigger(std::make_shared<TaskTrigger>()),
+  fTriggerRequested(false),
+  fReadyList(std::make_shared<HandlerReadyList>(fTrigger)),
+  fPosted(std::make_shared<PostedFunctions>()),
   fLogMessagePort(*this, "LogMessage"),
   fLogControlPort(*this, "LogControl"),
   fConfigOutPort(*this, "ConfigOut"),
   fConfigInPort(*this, "ConfigIn"),
+  fStatsPort(*this, "HandlerStats"),
+  fStatsControlPort(*this, "HandlerStatsControl"),
+  fOverloadPort(*this, "Overload"),
+  fStatisticsWindowStart(std::chrono::high_resolution_clock::now().time_since_epoch().count()),
+  fStatisticsInterval(DEFAULT_STATISTICS_INTERVAL_MS),
   fConfig(),
   fComponentLogger(fName, fLogMessagePort)
 {
+    fReadyList->setInlineRunner([this](HandlerReadyList::Entry& entry) { return runInline(entry); });
 }
 
 /*
  * Destructor
  */
-Component::~Component() = default;
+Component::~Component() {
+    // entries may outlive the component in a writer's InlineDispatch, waits for an inline run
+    fReadyList->setInlineRunner(nullptr);
+    // queued entries keep themselves alive
+    fReadyList->clear();
+}
 
 void Component::ctrlConfigure(IComponentConfig& config) {
     fLogControlPort.registerHandler([this] { logControlUpdate(); });
+    fStatsControlPort.registerHandler([this] { statisticsControlUpdate(); });
     fInstanceName = config.instanceName();
     fComponentLogger.setName(fInstanceName);
 
     config.registerPort(fLogMessagePort, "/mcf/log/"+fInstanceName+"/message");
     config.registerPort(fLogControlPort, "/mcf/log/"+fInstanceName+"/control");
+    config.registerPort(fStatsPort, "/mcf/stats/"+fInstanceName+"/handlers");
+    config.registerPort(fStatsControlPort, "/mcf/stats/"+fInstanceName+"/control");
+    config.registerPort(fOverloadPort, "/mcf/overload/"+fInstanceName);
     config.registerPort(fConfigOutPort, fConfigOutPortTopic);
     config.registerPort(fConfigInPort, fConfigInPortTopic);
     configure(config);
@@ -80,38 +211,118 @@ void Component::ctrlStart() {
     if (fState == INIT || fState == STOPPED) {
         fRunRequest = false;
         fStopRequest = false;
-        fState = STARTING_UP;
-        fThread      = std::thread([this] { main(); });
+        setState(STARTING_UP);
+        if (fExecutor) {
+            fExecutorStopped = std::promise<void>();
+            fExecutorTask = std::make_shared<ExecutorTask>(*fExecutor, [this] { executorStep(); });
+            for (const auto& entry : fPortTriggerHandlers) {
+                if (entry->getHandler()->isConcurrent()) {
+                    attachConcurrentHandler(entry->getHandler());
+                }
+            }
+            fTrigger->setTask(fExecutorTask);
+            fExecutorTask->schedule();
+        }
+        else {
+            fThread = std::thread([this] { main(); });
+        }
     }
 }
 
 void Component::ctrlRun() {
     if (fState == STARTED) {
-        fRunRequest = true;
+        {
+            std::lock_guard<std::mutex> lk(fLifecycleMutex);
+            fRunRequest = true;
+        }
+        fLifecycleCondition.notify_all();
+        for (const auto& timer : fPeriodicTimers) {
+            fTimerService->add(timer);
+        }
+        if (fExecutorTask) {
+            fExecutorTask->schedule();
+            // process values which arrived before the run request
+            for (const auto& concurrent : fConcurrentHandlers) {
+                concurrent.task->schedule();
+            }
+        }
     }
 }
 
 void Component::ctrlStop() {
     if (fState != INIT && fState != STOPPED) {
-        fStopRequest = true;
+        {
+            std::lock_guard<std::mutex> lk(fLifecycleMutex);
+            fStopRequest = true;
+        }
+        fLifecycleCondition.notify_all();
+        for (const auto& timer : fPeriodicTimers) {
+            fTimerService->remove(timer);
+        }
+        // concurrent handlers must have finished before shutdown() is called, they are cancelled
+        // together rather than waiting for one after another
+        for (const auto& concurrent : fConcurrentHandlers) {
+            concurrent.task->cancel(false);
+        }
+        while (!fConcurrentHandlers.empty()) {
+            detachConcurrentHandler(fConcurrentHandlers.back().handler, true);
+        }
         fTrigger->trigger();
-        fThread.join();
-        fState = STOPPED;
+        if (fExecutorTask) {
+            fExecutorStopped.get_future().wait();
+            fTrigger->setTask(nullptr);
+            fExecutorTask->cancel();
+            fExecutorTask.reset();
+        }
+        else {
+            fThread.join();
+        }
+        setState(STOPPED);
+    }
+}
+
+void Component::ctrlSetFused(bool fused) {
+    fFused = fused;
+    for (const auto& entry : fPortTriggerHandlers) {
+        entry->setInline(fused || entry->getHandler()->isFused());
     }
 }
 
 
 void Component::ctrlSetSchedulingParameters(const SchedulingParameters& parameters)
 {
-    // Do nothing if the policy is "Default"
-    if (parameters.policy == Default)
+    // Do nothing if the policy is "Default" and neither CPU affinity, deadline, spinning, NUMA node nor
+    // parallel threads are given
+    if (parameters.policy == Default && parameters.cpuAffinity == 0 && parameters.deadline.count() == 0
+        && parameters.spin.count() == 0 && parameters.numaNode < 0 && parameters.parallelThreads == 0)
     {
         return;
     }
+    if (parameters.numaNode >= getNumaNodeCount())
+    {
+        MCF_THROW_RUNTIME(fmt::format("NUMA node {} out of range 0-{}", parameters.numaNode, getNumaNodeCount() - 1));
+    }
+    if (parameters.spin.count() < 0)
+    {
+        MCF_THROW_RUNTIME(fmt::format("Spin duration {} ns must not be negative", parameters.spin.count()));
+    }
     // Otherwise, validate the input
-    if (parameters.policy == Other && parameters.priority != 0)
+    if ((parameters.policy == Other || parameters.policy == Deadline) && parameters.priority != 0)
     {
-        MCF_THROW_RUNTIME(fmt::format("Priority {} is not valid for SCHED_OTHER", parameters.priority));
+        MCF_THROW_RUNTIME(fmt::format("Priority {} is not valid for policy {}", parameters.priority, parameters.policy));
+    }
+    if (parameters.policy == Deadline)
+    {
+        const auto period = parameters.period.count() > 0 ? parameters.period : parameters.deadline;
+        if (!(0 < parameters.runtime.count() && parameters.runtime <= parameters.deadline
+              && parameters.deadline <= period))
+        {
+            MCF_THROW_RUNTIME(fmt::format(
+                "Deadline parameters must satisfy 0 < runtime ({} ns) <= deadline ({} ns) <= period ({} ns)",
+                parameters.runtime.count(),
+                parameters.deadline.count(),
+                period.count()));
+        }
     }
     if (parameters.policy == Fifo || parameters.policy == RoundRobin)
     {
@@ -128,9 +339,42 @@ void Component::ctrlSetSchedulingParameters(const SchedulingParameters& paramete
                 parameters.policy));
         }
     }
-    fThreadSchedulingParameters = parameters;
+    {
+        std::lock_guard<std::mutex> lk(fSchedulingMutex);
+        if (parameters.policy != Default)
+        {
+            fThreadSchedulingParameters.policy = parameters.policy;
+            fThreadSchedulingParameters.priority = parameters.priority;
+            fThreadSchedulingParameters.runtime = parameters.runtime;
+            fThreadSchedulingParameters.period = parameters.period;
+        }
+        if (parameters.cpuAffinity != 0)
+        {
+            fThreadSchedulingParameters.cpuAffinity = parameters.cpuAffinity;
+        }
+        if (parameters.policy != Default || parameters.deadline.count() > 0)
+        {
+            fThreadSchedulingParameters.deadline = parameters.deadline;
+            fHandlerDeadline = parameters.deadline.count();
+        }
+        if (parameters.policy != Default || parameters.spin.count() > 0)
+        {
+            fThreadSchedulingParameters.spin = parameters.spin;
+            fTrigger->setSpinDuration(parameters.spin);
+        }
+        if (parameters.numaNode >= 0)
+        {
+            fThreadSchedulingParameters.numaNode = parameters.numaNode;
+        }
+        if (parameters.parallelThreads > 0)
+        {
+            fThreadSchedulingParameters.parallelThreads = parameters.parallelThreads;
+            fParallelThreads = parameters.parallelThreads;
+        }
+    }
 
-    if (fState == STARTED || fState == RUNNING)
+    // worker threads of an executor are shared, only a dedicated thread is changed
+    if ((fState == STARTED || fState == RUNNING) && !fExecutorTask)
     {
         setSchedulingPolicy();
     }
@@ -182,8 +426,9 @@ void Component::readConfig()
         std::cout << path << std::endl;
     }
 
-    // obtain merged config
-    fConfig = std::make_unique<Json::Value>(mcf::util::json::mergeFiles(configFilePaths, true));
+    // obtain merged config, files shared with other components are parsed once
+    fConfig = std::make_unique<Json::Value>(
+        mcf::util::json::ConfigCache::instance().mergeFiles(configFilePaths, true));
 
     // and write to config output port
     Json::StreamWriterBuilder builder;
@@ -253,31 +498,79 @@ void Component::registerTriggerHandler(std::function<void()> handler)
 {
     HandlerMapEntry e;
     e.handler = std::move(handler);
-    initStats(e.statistics);
+    e.name = fTriggerHandlers.empty() ? "*" : "*" + std::to_string(fTriggerHandlers.size());
+    e.latency = std::make_shared<LatencyHistogram>();
+    e.perfCounters = std::make_shared<PerfCounterTotals>();
     fTriggerHandlers.push_back(e);
 }
 
+std::shared_ptr<PeriodicTimer> Component::registerPeriodicHandler(std::chrono::nanoseconds period,
+                                                                 std::function<void()> handler,
+                                                                 std::chrono::nanoseconds phase,
+                                                                 const PortTriggerHandlerOptions& options)
+{
+    const std::string name = "@" + std::to_string(fPeriodicTimers.size());
+    auto portHandler = std::make_shared<PortTriggerHandler>(
+        std::move(handler), name, fComponentTraceEventGenerator, options);
+    auto timer = std::make_shared<PeriodicTimer>(period, phase, portHandler->getEventFlag(), name);
+    if (!fTimerService) {
+        fTimerService = PeriodicTimerService::shared();
+    }
+    registerHandler(portHandler);
+    fPeriodicTimers.push_back(timer);
+    if (fRunRequest && !fStopRequest) {
+        fTimerService->add(timer);
+    }
+    return timer;
+}
+
 /*
  * Trigger the components thread.
  */
 void Component::trigger()
 {
+    fTriggerRequested = true;
     fTrigger->trigger();
 }
 
 void Component::registerHandler(std::shared_ptr<PortTriggerHandler> handler)
 {
-    auto it = std::find_if(fPortTriggerHandlers.begin(), fPortTriggerHandlers.end(), [handler](std::weak_ptr<PortTriggerHandler> e){ return e.lock() == handler;});
-    if (it == fPortTriggerHandlers.end()) {
-        fPortTriggerHandlers.push_back(handler);
+    auto entry = findReadyEntry(handler);
+    if (!entry) {
+        entry = std::make_shared<HandlerReadyList::Entry>(fReadyList, handler);
+        entry->setInline(fFused || handler->isFused());
+        fPortTriggerHandlers.push_back(entry);
+    }
+    if (handler->getPriority() != 0) {
+        fPrioritized = true;
+    }
+    handler->getEventFlag()->addTrigger(entry);
+    if (fExecutorTask && handler->isConcurrent()) {
+        attachConcurrentHandler(handler);
+    }
+    else if (handler->getEventFlag()->active()) {
+        // a value arrived before registration
+        entry->trigger();
     }
-    handler->getEventFlag()->addTrigger(fTrigger);
 }
 
 void Component::unregisterHandler(std::shared_ptr<PortTriggerHandler> handler)
 {
-    fPortTriggerHandlers.erase(std::remove_if(fPortTriggerHandlers.begin(), fPortTriggerHandlers.end(), [handler](std::weak_ptr<PortTriggerHandler> e){ return e.lock() == handler;}), fPortTriggerHandlers.end());
-    handler->getEventFlag()->removeTrigger(fTrigger);
+    // may be called from within the handler, so do not wait for it
+    detachConcurrentHandler(handler, false);
+    auto entry = findReadyEntry(handler);
+    if (entry) {
+        handler->getEventFlag()->removeTrigger(entry);
+        entry->remove();
+        fPortTriggerHandlers.erase(std::find(fPortTriggerHandlers.begin(), fPortTriggerHandlers.end(), entry));
+    }
+}
+
+std::shared_ptr<HandlerReadyList::Entry> Component::findReadyEntry(const std::shared_ptr<PortTriggerHandler>& handler) const
+{
+    auto it = std::find_if(fPortTriggerHandlers.begin(), fPortTriggerHandlers.end(),
+                           [&handler](const std::shared_ptr<HandlerReadyList::Entry>& e) { return e->getHandler() == handler; });
+    return it != fPortTriggerHandlers.end() ? *it : nullptr;
 }
 
 /*
@@ -290,83 +583,701 @@ void Component::log(LogSeverity severity, const std::string& message)
 
 void Component::main() {
 
-    MCF_INFO_NOFILELINE("Component [{}]: startup", fInstanceName);
     // set scheduling class to SCHED_FIFO with default priority
     fThreadHandle = pthread_self();
+    fThreadId = static_cast<pid_t>(syscall(SYS_gettid));
     setThreadName(fmt::format("{}", fInstanceName));
     setSchedulingPolicy();
     fComponentLogger.injectLocalLogger();
     ComponentTraceEventGenerator::setLocalInstance(fComponentTraceEventGenerator); // enable use of tracing macros for this thread
-    startup();
+    setParallelForThreadLimit(fParallelThreads);
+    runStartup();
 
-    fState = STARTED;
-
-    while(!fStopRequest && !fRunRequest) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    {
+        std::unique_lock<std::mutex> lk(fLifecycleMutex);
+        fLifecycleCondition.wait(lk, [this] { return fStopRequest || fRunRequest; });
     }
 
     if (fRunRequest) {
 
-        fState = RUNNING;
+        setState(RUNNING);
         while (!fStopRequest) {
             fTrigger->wait();
-            if (!fStopRequest) {
-                for (auto& th : fTriggerHandlers) {
-                    // call the handler
-                    auto start = std::chrono::high_resolution_clock::now();
-                    (th.handler)();
-                    auto end = std::chrono::high_resolution_clock::now();
-                    calcStats(th.statistics, "*", start);
-                    traceTriggerHandlerExec(start, end, th);
-                }
+            // the parameters may have changed while waiting
+            setParallelForThreadLimit(fParallelThreads);
+            runHandlers();
+        }
+    }
+
+    runShutdown();
+}
+
+void Component::executorStep() {
+    if (fState == WAIT_STOP) {
+        // stray activation between shutdown and ctrlStop()
+        return;
+    }
+    injectThreadLocals();
+
+    if (fState == STARTING_UP) {
+        runStartup();
+    }
+    if (fStopRequest) {
+        runShutdown();
+        fExecutorStopped.set_value();
+    }
+    else if (fRunRequest) {
+        setState(RUNNING);
+        runHandlers();
+    }
+}
+
+void Component::runHandlers() {
+    HandlerLock lock(fHandlerMutex, fHandlerThread);
+    std::chrono::high_resolution_clock::time_point lastEnd;
+    if (!fStopRequest && fTriggerRequested.exchange(false)) {
+        for (auto& th : fTriggerHandlers) {
+            // call the handler
+            auto start = std::chrono::high_resolution_clock::now();
+            PerfCounterSample counters(fPerfCountersEnabled.load(std::memory_order_relaxed));
+            (th.handler)();
+            PerfCounterValues counts;
+            const bool counted = counters.stop(counts);
+            auto end = std::chrono::high_resolution_clock::now();
+            recordHandlerRun(*th.latency, th.name, start, end);
+            if (counted) {
+                th.perfCounters->record(counts);
             }
-            for (const auto& handler : fPortTriggerHandlers) {
-                if (!fStopRequest && handler->getEventFlag()->active()) {
-                    handler->getEventFlag()->reset();
-                    auto start = std::chrono::high_resolution_clock::now();
-                    handler->call();
-                    auto end = std::chrono::high_resolution_clock::now();
-                    tracePortTriggerHandlerExec(start, end, *handler);
+            if (TracePolicy::active()) {
+                traceTriggerHandlerExec(start, end, th);
+                if (counted) {
+                    tracePerfCounters(end, th.name, counts);
                 }
             }
+            lastEnd = end;
         }
     }
+    if (fPrioritized) {
+        runPrioritizedHandlers(std::numeric_limits<int>::min(), lastEnd);
+    }
+    else {
+        // only visit the handlers whose event flag fired
+        fReadyList->drain([this, &lastEnd](HandlerReadyList::Entry& entry) {
+            if (fStopRequest) {
+                // keep it for a restart of the component
+                return false;
+            }
+            if (fExecutorTask && entry.getHandler()->isConcurrent()) {
+                // runs as a task of its own
+                return true;
+            }
+            if (deferToLogicalTime(*entry.getHandler())) {
+                return true;
+            }
+            auto end = runPortHandler(*entry.getHandler());
+            if (end != std::chrono::high_resolution_clock::time_point()) {
+                lastEnd = end;
+            }
+            return true;
+        });
+    }
+    if (fLogicalInputs) {
+        runLogicalHandlers(lastEnd);
+    }
+    runPostedFunctions();
+    if (lastEnd != std::chrono::high_resolution_clock::time_point()) {
+        publishStatisticsIfDue(lastEnd);
+    }
+}
 
-    fState = SHUTTING_DOWN;
-    MCF_INFO_NOFILELINE("shutting down");
-    shutdown();
+void Component::post(std::function<void()> function) {
+    {
+        std::lock_guard<std::mutex> lk(fPosted->mutex);
+        fPosted->functions.push_back(std::move(function));
+    }
+    fTrigger->trigger();
+}
+
+void Component::postAfter(std::chrono::nanoseconds delay, std::function<void()> function) {
+    if (!fTimerService) {
+        fTimerService = PeriodicTimerService::shared();
+    }
+    // the timer may outlive the component
+    std::weak_ptr<PostedFunctions> posted = fPosted;
+    std::weak_ptr<TaskTrigger> trigger = fTrigger;
+    fTimerService->addOneShot(delay, [posted, trigger, function]() {
+        auto p = posted.lock();
+        auto t = trigger.lock();
+        if (p && t) {
+            {
+                std::lock_guard<std::mutex> lk(p->mutex);
+                p->functions.push_back(function);
+            }
+            t->trigger();
+        }
+    });
+}
+
+void Component::runPostedFunctions() {
+    std::vector<std::function<void()>> functions;
+    {
+        std::lock_guard<std::mutex> lk(fPosted->mutex);
+        if (fStopRequest || fPosted->functions.empty()) {
+            return;
+        }
+        functions.swap(fPosted->functions);
+    }
+    // functions posted from here on run at the next activation
+    for (const auto& function : functions) {
+        function();
+    }
+}
+
+void Component::collectReadyHandlers() {
+    fReadyList->drain([this](HandlerReadyList::Entry& entry) {
+        if (fExecutorTask && entry.getHandler()->isConcurrent()) {
+            return true;
+        }
+        if (deferToLogicalTime(*entry.getHandler())) {
+            return true;
+        }
+        auto pending = entry.shared_from_this();
+        if (std::find(fPendingHandlers.begin(), fPendingHandlers.end(), pending) != fPendingHandlers.end()) {
+            return true;
+        }
+        // behind all handlers of the same or a higher priority
+        auto it = std::upper_bound(fPendingHandlers.begin(), fPendingHandlers.end(), pending,
+            [](const std::shared_ptr<HandlerReadyList::Entry>& a, const std::shared_ptr<HandlerReadyList::Entry>& b) {
+                return a->getHandler()->getPriority() > b->getHandler()->getPriority();
+            });
+        fPendingHandlers.insert(it, std::move(pending));
+        return true;
+    });
+}
+
+void Component::runPrioritizedHandlers(int above, std::chrono::high_resolution_clock::time_point& lastEnd) {
+    collectReadyHandlers();
+    while (!fPendingHandlers.empty() && fPendingHandlers.front()->getHandler()->getPriority() > above) {
+        if (fStopRequest) {
+            // keep them for a restart of the component
+            for (const auto& entry : fPendingHandlers) {
+                fReadyList->push(*entry);
+            }
+            fPendingHandlers.clear();
+            return;
+        }
+        auto entry = std::move(fPendingHandlers.front());
+        fPendingHandlers.erase(fPendingHandlers.begin());
+        if (entry->isRemoved()) {
+            continue;
+        }
+        const int previous = fRunningPriority;
+        fRunningPriority = entry->getHandler()->getPriority();
+        auto end = runPortHandler(*entry->getHandler());
+        fRunningPriority = previous;
+        if (end != std::chrono::high_resolution_clock::time_point()) {
+            lastEnd = end;
+        }
+        // rank the handlers activated meanwhile with the remaining ones
+        collectReadyHandlers();
+    }
+}
+
+void Component::preemptionPoint() {
+    if (!fPrioritized || fHandlerThread.load() != std::this_thread::get_id()) {
+        return;
+    }
+    std::chrono::high_resolution_clock::time_point lastEnd;
+    runPrioritizedHandlers(fRunningPriority, lastEnd);
+}
+
+bool Component::runInline(HandlerReadyList::Entry& entry) {
+    HandlerLock lock(fHandlerMutex, fHandlerThread, std::try_to_lock);
+    LogicalClock::Stamp stamp;
+    if (!lock.ownsLock() || !fRunRequest || fStopRequest || entry.getHandler()->getFrontStamp(stamp)) {
+        // stamped inputs wait for their logical time on the component
+        return false;
+    }
+    ThreadLocalsScope threadLocals(fComponentLogger, fComponentTraceEventGenerator);
+    fRunningPriority = entry.getHandler()->getPriority();
+    std::chrono::high_resolution_clock::time_point end;
+    // the handler runs on the writer's thread, its errors must not fail the writer's setValue()
+    try {
+        end = runPortHandler(*entry.getHandler());
+    } catch (const std::exception& e) {
+        MCF_ERROR_NOFILELINE("Component [{}]: inline handler {} failed: {}",
+                             fInstanceName, entry.getHandler()->getName(), e.what());
+    } catch (...) {
+        MCF_ERROR_NOFILELINE("Component [{}]: inline handler {} failed with an unknown exception",
+                             fInstanceName, entry.getHandler()->getName());
+    }
+    fRunningPriority = std::numeric_limits<int>::min();
+    if (end != std::chrono::high_resolution_clock::time_point()) {
+        publishStatisticsIfDue(end);
+    }
+    if (!fPendingHandlers.empty()) {
+        // collected by a preemption point of the handler, but of lower priority
+        fTrigger->trigger();
+    }
+    return true;
+}
+
+std::chrono::high_resolution_clock::time_point Component::runPortHandler(PortTriggerHandler& handler) {
+    if (fStopRequest || !handler.getEventFlag()->active()) {
+        return std::chrono::high_resolution_clock::time_point();
+    }
+    handler.getEventFlag()->reset();
+    return callPortHandler(handler);
+}
+
+std::chrono::high_resolution_clock::time_point Component::callPortHandler(PortTriggerHandler& handler) {
+    bool fallback = false;
+    if (!shedLoad(handler, fallback)) {
+        return std::chrono::high_resolution_clock::time_point();
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    PerfCounterSample counters(fPerfCountersEnabled.load(std::memory_order_relaxed));
+    if (fallback) {
+        handler.callFallback();
+    }
+    else {
+        handler.call();
+    }
+    PerfCounterValues counts;
+    const bool counted = counters.stop(counts);
+    auto end = std::chrono::high_resolution_clock::now();
+    if (recordHandlerRun(handler.getLatencyHistogram(), handler.getName(), start, end)) {
+        // sheds the next run of this handler only
+        handler.setOverrun();
+    }
+    if (counted) {
+        handler.getPerfCounters().record(counts);
+    }
+    if (TracePolicy::active()) {
+        tracePortTriggerHandlerExec(start, end, handler);
+        if (counted) {
+            tracePerfCounters(end, handler.getName(), counts);
+        }
+    }
+    return end;
+}
+
+bool Component::recordHandlerRun(LatencyHistogram& latency,
+                                 const std::string& name,
+                                 std::chrono::high_resolution_clock::time_point start,
+                                 std::chrono::high_resolution_clock::time_point end) {
+    const auto duration = end - start;
+    latency.record(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+    const std::chrono::nanoseconds deadline(fHandlerDeadline.load(std::memory_order_relaxed));
+    if (deadline.count() > 0) {
+        accountDeadline(name, duration, deadline);
+    }
+    const std::chrono::nanoseconds maxHandlerTime(fMaxHandlerTime.load(std::memory_order_relaxed));
+    if (maxHandlerTime.count() > 0 && duration > maxHandlerTime) {
+        ++fHandlerTimeViolations;
+        publishOverloadAlarm(name, "handlerTime",
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(duration), maxHandlerTime, 0);
+        return true;
+    }
+    return false;
+}
+
+bool Component::shedLoad(PortTriggerHandler& handler, bool& fallback) {
+    // taken in any case, so that an overrun does not outlive a change of the budget
+    bool overloaded = handler.takeOverrun();
+    const std::chrono::nanoseconds maxQueueAge(fMaxQueueAge.load(std::memory_order_relaxed));
+    if (maxQueueAge.count() == 0 && fMaxHandlerTime.load(std::memory_order_relaxed) == 0) {
+        return true;
+    }
+    const OverloadPolicy policy = fOverloadPolicy.load(std::memory_order_relaxed);
+    size_t dropped = 0;
+    if (maxQueueAge.count() > 0) {
+        const auto age = handler.getQueueAge();
+        if (age > maxQueueAge) {
+            overloaded = true;
+            ++fQueueAgeViolations;
+            if (policy == OverloadPolicy::DROP_OLDEST) {
+                // keep the newest value, so that the handler catches up with it
+                dropped = handler.dropQueuedValues(maxQueueAge, 1);
+            }
+            publishOverloadAlarm(handler.getName(), "queueAge", age, maxQueueAge, dropped);
+        }
+    }
+    if (!overloaded) {
+        return true;
+    }
+    switch (policy) {
+    case OverloadPolicy::DROP_OLDEST:
+        if (dropped == 0) {
+            dropped = handler.dropQueuedValues(std::chrono::nanoseconds(0), 1);
+        }
+        break;
+    case OverloadPolicy::SKIP:
+        dropped += handler.dropQueuedValues(std::chrono::nanoseconds(0), 0);
+        ++fSkippedRuns;
+        fDroppedValues += dropped;
+        return false;
+    case OverloadPolicy::FALLBACK:
+        if (handler.hasFallback()) {
+            fallback = true;
+            ++fFallbackRuns;
+        }
+        break;
+    case OverloadPolicy::ALARM:
+        break;
+    }
+    fDroppedValues += dropped;
+    return true;
+}
+
+void Component::publishOverloadAlarm(const std::string& handler,
+                                     const char* reason,
+                                     std::chrono::nanoseconds measured,
+                                     std::chrono::nanoseconds budget,
+                                     size_t dropped) {
+    auto alarm = std::make_unique<msg::OverloadAlarm>();
+    alarm->component = fInstanceName;
+    alarm->handler = handler;
+    alarm->reason = reason;
+    alarm->measuredNs = static_cast<uint64_t>(std::max<int64_t>(0, measured.count()));
+    alarm->budgetNs = static_cast<uint64_t>(budget.count());
+    alarm->dropped = dropped;
+    // never block a handler on a slow alarm receiver
+    fOverloadPort.setValue(std::move(alarm), false);
+}
+
+void Component::setOverloadBudget(const OverloadBudget& budget) {
+    if (budget.maxHandlerTime.count() < 0 || budget.maxQueueAge.count() < 0) {
+        MCF_THROW_RUNTIME("Overload budget must not be negative");
+    }
+    fOverloadPolicy = budget.policy;
+    fMaxQueueAge = budget.maxQueueAge.count();
+    fMaxHandlerTime = budget.maxHandlerTime.count();
+}
+
+Component::OverloadBudget Component::getOverloadBudget() const {
+    OverloadBudget budget;
+    budget.maxHandlerTime = std::chrono::nanoseconds(fMaxHandlerTime.load());
+    budget.maxQueueAge = std::chrono::nanoseconds(fMaxQueueAge.load());
+    budget.policy = fOverloadPolicy.load();
+    return budget;
+}
+
+Component::OverloadStatistics Component::getOverloadStatistics() const {
+    OverloadStatistics statistics;
+    statistics.handlerTimeViolations = fHandlerTimeViolations.load();
+    statistics.queueAgeViolations = fQueueAgeViolations.load();
+    statistics.droppedValues = fDroppedValues.load();
+    statistics.skippedRuns = fSkippedRuns.load();
+    statistics.fallbackRuns = fFallbackRuns.load();
+    return statistics;
+}
+
+void Component::publishStatisticsIfDue(std::chrono::high_resolution_clock::time_point now) {
+    const int64_t nowNs = now.time_since_epoch().count();
+    const int64_t windowStart = fStatisticsWindowStart.load(std::memory_order_relaxed);
+    const int64_t interval = fStatisticsInterval.load(std::memory_order_relaxed) * 1000000;
+    if (nowNs - windowStart < interval && nowNs >= windowStart) {
+        return;
+    }
+    fStatisticsWindowStart = nowNs;
+
+    auto stats = std::make_unique<msg::HandlerStats>();
+    stats->component = fInstanceName;
+    stats->windowUs = std::max<int64_t>(0, nowNs - windowStart) / 1000;
+    auto add = [&stats](const std::string& name, LatencyHistogram& latency, PerfCounterTotals& perfCounters) {
+        const auto summary = latency.takeSummary();
+        const auto counters = perfCounters.takeSummary();
+        msg::HandlerLatency entry;
+        entry.handler = name;
+        entry.count = summary.count;
+        entry.p50Ns = summary.p50;
+        entry.p99Ns = summary.p99;
+        entry.p999Ns = summary.p999;
+        entry.maxNs = summary.max;
+        entry.countedRuns = counters.runs;
+        entry.cycles = counters.sum.cycles;
+        entry.instructions = counters.sum.instructions;
+        entry.cacheMisses = counters.sum.cacheMisses;
+        entry.branchMisses = counters.sum.branchMisses;
+        entry.contextSwitches = counters.sum.contextSwitches;
+        stats->handlers.push_back(std::move(entry));
+    };
+    for (auto& th : fTriggerHandlers) {
+        add(th.name, *th.latency, *th.perfCounters);
+    }
+    for (auto& entry : fPortTriggerHandlers) {
+        add(entry->getHandler()->getName(), entry->getHandler()->getLatencyHistogram(),
+            entry->getHandler()->getPerfCounters());
+        for (const auto& queue : entry->getHandler()->getQueues()) {
+            for (const auto& decision : queue->takeLengthDecisions()) {
+                msg::QueueLengthDecision reported;
+                reported.handler = entry->getHandler()->getName();
+                reported.previousLength = decision.previousLength;
+                reported.length = decision.length;
+                reported.arrivalRate = decision.arrivalRate;
+                reported.serviceRate = decision.serviceRate;
+                reported.dropRate = decision.dropRate;
+                reported.maxWaitNs = decision.maxWait.count();
+                stats->queueDecisions.push_back(std::move(reported));
+            }
+        }
+    }
+    fStatsPort.setValue(std::move(stats));
+}
 
-    fState = WAIT_STOP;
+void Component::statisticsControlUpdate() {
+    auto control = fStatsControlPort.getValue();
+    if (control->intervalMs > 0) {
+        setStatisticsInterval(std::chrono::milliseconds(control->intervalMs));
+    }
+    if (control->reset) {
+        resetStatistics();
+    }
 }
 
+void Component::resetStatistics() {
+    for (auto& th : fTriggerHandlers) {
+        th.latency->reset();
+        th.perfCounters->reset();
+    }
+    for (auto& entry : fPortTriggerHandlers) {
+        entry->getHandler()->getLatencyHistogram().reset();
+        entry->getHandler()->getPerfCounters().reset();
+    }
+    fStatisticsWindowStart = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+}
 
-void Component::initStats(msg::RuntimeStatsEntry& stats) {
-    stats.start = 0;
-    stats.count = 0;
-    stats.total = 0;
-    stats.min = -1;
-    stats.max = 0;
+msg::RuntimeStats Component::getStatistics() const {
+    const int64_t windowStart = fStatisticsWindowStart.load(std::memory_order_relaxed);
+    const int64_t windowMs
+        = (std::chrono::high_resolution_clock::now().time_since_epoch().count() - windowStart) / 1000000;
+    msg::RuntimeStats stats;
+    auto add = [&stats, windowStart, windowMs](const std::string& name, const LatencyHistogram& latency) {
+        const auto summary = latency.summary();
+        msg::RuntimeStatsEntry entry;
+        entry.start = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::duration(windowStart)).count();
+        entry.total = summary.sum / 1000;
+        entry.count = static_cast<int>(summary.count);
+        entry.min = summary.count > 0 ? static_cast<int>(summary.min / 1000) : -1;
+        entry.max = static_cast<int>(summary.max / 1000);
+        entry.avg = summary.count > 0 ? static_cast<int>(summary.sum / summary.count / 1000) : 0;
+        entry.frq = windowMs > 0 ? static_cast<int>(summary.count * 1000 / windowMs) : 0;
+        stats.entries[name] = entry;
+    };
+    for (const auto& th : fTriggerHandlers) {
+        add(th.name, *th.latency);
+    }
+    for (const auto& entry : fPortTriggerHandlers) {
+        add(entry->getHandler()->getName(), entry->getHandler()->getLatencyHistogram());
+    }
+    return stats;
 }
 
-void Component::calcStats(msg::RuntimeStatsEntry& stats, const std::string& topic, std::chrono::high_resolution_clock::time_point start) {
-    auto dur = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
-    auto msecs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-    if (stats.start == 0) {
-        stats.start = msecs;
+std::map<std::string, PerfCounterTotals::Summary> Component::getPerfCounterStatistics() const {
+    std::map<std::string, PerfCounterTotals::Summary> stats;
+    for (const auto& th : fTriggerHandlers) {
+        stats[th.name] = th.perfCounters->summary();
     }
-    stats.count += 1;
-    stats.total += dur;
-    if (stats.min < 0 || dur < stats.min) {
-        stats.min = dur;
+    for (const auto& entry : fPortTriggerHandlers) {
+        stats[entry->getHandler()->getName()] = entry->getHandler()->getPerfCounters().summary();
     }
-    if (dur > stats.max) {
-        stats.max = dur;
+    return stats;
+}
+
+bool Component::deferToLogicalTime(PortTriggerHandler& handler) {
+    LogicalClock::Stamp stamp;
+    if (!handler.getFrontStamp(stamp)) {
+        return false;
+    }
+    // the event flag stays active until the handler runs
+    fLogicalInputs = true;
+    return true;
+}
+
+void Component::runLogicalHandlers(std::chrono::high_resolution_clock::time_point& lastEnd) {
+    fLogicalInputs = false;
+    std::vector<PortTriggerHandler*> ran;
+    while (!fStopRequest) {
+        std::shared_ptr<PortTriggerHandler> earliest;
+        LogicalClock::Stamp earliestStamp;
+        for (const auto& entry : fPortTriggerHandlers) {
+            const auto& handler = entry->getHandler();
+            LogicalClock::Stamp stamp;
+            if ((fExecutorTask && handler->isConcurrent()) || !handler->getFrontStamp(stamp)) {
+                continue;
+            }
+            if (!earliest || stamp.time < earliestStamp.time) {
+                earliest = handler;
+                earliestStamp = std::move(stamp);
+            }
+        }
+        if (!earliest) {
+            return;
+        }
+        fLogicalInputs = true;
+        if (std::find(ran.begin(), ran.end(), earliest.get()) != ran.end()) {
+            // more inputs of a handler which ran already
+            fTrigger->trigger();
+            return;
+        }
+        if (!earliestStamp.clock->isSafeOrWake(earliestStamp.time, fTrigger)) {
+            // woken when the earlier values have been processed
+            return;
+        }
+        ran.push_back(earliest.get());
+        auto end = runLogicalHandler(*earliest, earliestStamp);
+        if (end != std::chrono::high_resolution_clock::time_point()) {
+            lastEnd = end;
+        }
+    }
+}
+
+std::chrono::high_resolution_clock::time_point Component::runLogicalHandler(PortTriggerHandler& handler,
+                                                                            const LogicalClock::Stamp& input) {
+    handler.getEventFlag()->reset();
+    // values written by the handler get the next step of the input's logical time
+    LogicalClock::Run run(input);
+    return callPortHandler(handler);
+}
+
+void Component::runConcurrentHandler(PortTriggerHandler& handler, const std::weak_ptr<TaskTrigger>& wake) {
+    LogicalClock::Stamp stamp;
+    if (!handler.getFrontStamp(stamp)) {
+        runPortHandler(handler);
+        return;
+    }
+    if (fStopRequest || !stamp.clock->isSafeOrWake(stamp.time, wake)) {
+        return;
     }
-    if (msecs > stats.start) {
-        stats.frq = stats.count*1000/(msecs-stats.start);
+    runLogicalHandler(handler, stamp);
+    auto trigger = wake.lock();
+    if (trigger && handler.getFrontStamp(stamp)) {
+        // one input per run, like for the other handlers of the component
+        trigger->trigger();
     }
-    stats.avg = stats.total/stats.count;
-    fRuntimeStats.entries[topic] = stats;
+}
+
+void Component::injectThreadLocals() {
+    // the worker thread may have run another component before
+    fComponentLogger.replaceLocalLogger();
+    ComponentTraceEventGenerator::setLocalInstance(fComponentTraceEventGenerator);
+    setParallelForThreadLimit(fParallelThreads);
+}
+
+void Component::attachConcurrentHandler(const std::shared_ptr<PortTriggerHandler>& handler) {
+    auto it = std::find_if(fConcurrentHandlers.begin(), fConcurrentHandlers.end(),
+                           [&handler](const ConcurrentHandler& e) { return e.handler == handler; });
+    if (it != fConcurrentHandlers.end()) {
+        return;
+    }
+    ConcurrentHandler concurrent;
+    concurrent.handler = handler;
+    concurrent.trigger = std::make_shared<TaskTrigger>();
+    std::weak_ptr<TaskTrigger> wake = concurrent.trigger;
+    concurrent.task = std::make_shared<ExecutorTask>(*fExecutor, [this, handler, wake] {
+        if (fRunRequest) {
+            injectThreadLocals();
+            runConcurrentHandler(*handler, wake);
+        }
+    });
+    concurrent.trigger->setTask(concurrent.task);
+    handler->getEventFlag()->removeTrigger(findReadyEntry(handler));
+    handler->getEventFlag()->addTrigger(concurrent.trigger);
+    // a value may have arrived before
+    concurrent.task->schedule();
+    fConcurrentHandlers.push_back(std::move(concurrent));
+}
+
+void Component::detachConcurrentHandler(const std::shared_ptr<PortTriggerHandler>& handler, bool wait) {
+    auto it = std::find_if(fConcurrentHandlers.begin(), fConcurrentHandlers.end(),
+                           [&handler](const ConcurrentHandler& e) { return e.handler == handler; });
+    if (it == fConcurrentHandlers.end()) {
+        return;
+    }
+    handler->getEventFlag()->removeTrigger(it->trigger);
+    auto entry = findReadyEntry(handler);
+    if (entry) {
+        handler->getEventFlag()->addTrigger(entry);
+        if (handler->getEventFlag()->active()) {
+            entry->trigger();
+        }
+    }
+    it->trigger->setTask(nullptr);
+    it->task->cancel(wait);
+    fConcurrentHandlers.erase(it);
+}
+
+void Component::runStartup() {
+    MCF_INFO_NOFILELINE("Component [{}]: startup", fInstanceName);
+    if (fStackPrefaultBytes > 0) {
+        // fault in the stack before the handlers need it
+        prefaultStack(fStackPrefaultBytes);
+    }
+    auto start = std::chrono::steady_clock::now();
+    startup();
+    fStartupDuration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    MCF_INFO_NOFILELINE("Component [{}]: started in {:.1f} ms", fInstanceName, fStartupDuration.load().count() / 1000.0);
+    setState(STARTED);
+}
+
+void Component::setState(StateType state) {
+    {
+        std::lock_guard<std::mutex> lk(fLifecycleMutex);
+        fState = state;
+    }
+    fLifecycleCondition.notify_all();
+}
+
+void Component::waitStarted() {
+    std::unique_lock<std::mutex> lk(fLifecycleMutex);
+    fLifecycleCondition.wait(lk, [this] { return fState != INIT && fState != STARTING_UP; });
+}
+
+bool Component::waitRunning() {
+    std::unique_lock<std::mutex> lk(fLifecycleMutex);
+    fLifecycleCondition.wait(lk, [this] {
+        return fState != INIT && fState != STARTING_UP && fState != STARTED;
+    });
+    return fState == RUNNING;
+}
+
+void Component::runShutdown() {
+    // wait for inline handler runs on other threads
+    HandlerLock lock(fHandlerMutex, fHandlerThread);
+    setState(SHUTTING_DOWN);
+    MCF_INFO_NOFILELINE("shutting down");
+    shutdown();
+
+    setState(WAIT_STOP);
+}
+
+
+void Component::accountDeadline(const std::string& handler,
+                                std::chrono::high_resolution_clock::duration duration,
+                                std::chrono::nanoseconds deadline) {
+    if (deadline.count() == 0 || duration <= deadline) {
+        return;
+    }
+    uint64_t misses;
+    {
+        std::lock_guard<std::mutex> lk(fDeadlineMutex);
+        misses = ++fDeadlineMisses[handler];
+    }
+    if (misses == 1) {
+        MCF_WARN_NOFILELINE("Component [{}]: handler {} took {:.3f} ms, missing its deadline of {:.3f} ms",
+                            fInstanceName,
+                            handler,
+                            std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000.0,
+                            std::chrono::duration_cast<std::chrono::microseconds>(deadline).count() / 1000.0);
+    }
+}
+
+std::map<std::string, uint64_t> Component::getDeadlineMisses() const {
+    std::lock_guard<std::mutex> lk(fDeadlineMutex);
+    return fDeadlineMisses;
 }
 
 void Component::traceTriggerHandlerExec(const std::chrono::high_resolution_clock::time_point& start,
@@ -393,19 +1304,55 @@ void Component::tracePortTriggerHandlerExec(
     }
 }
 
+void Component::tracePerfCounters(const std::chrono::high_resolution_clock::time_point& end,
+                                  const std::string& handlerName,
+                                  const PerfCounterValues& counts)
+{
+    if (fComponentTraceEventGenerator)
+    {
+        fComponentTraceEventGenerator->tracePerfCounters(end, handlerName, counts);
+    }
+}
+
 void Component::logControlUpdate() {
     auto val = fLogControlPort.getValue();
     // This only changes the local logging level, not the global one.
     fComponentLogger.setValueStoreLogLevel(val->level);
 }
 
+CpuMask Component::getEffectiveCpuAffinity() const
+{
+    if ((fState == STARTED || fState == RUNNING) && !fExecutorTask)
+    {
+        return getThreadCpuAffinity(fThreadHandle);
+    }
+    return 0;
+}
+
 void Component::setSchedulingPolicy()
 {
-    auto parameters = fThreadSchedulingParameters.load();
+    SchedulingParameters parameters;
+    {
+        std::lock_guard<std::mutex> lk(fSchedulingMutex);
+        parameters = fThreadSchedulingParameters;
+    }
     if (parameters.policy != SCHED_OTHER && !mutex::realtimeCapabilityAvailable())
     {
         // do nothing
     }
+    else if (parameters.policy == Deadline)
+    {
+        int result = setThreadDeadlineScheduling(fThreadId, parameters);
+        if (result != 0)
+        {
+            MCF_ERROR_NOFILELINE(
+                "Could not set deadline scheduling: runtime {} ns, deadline {} ns, period {} ns, error: {}",
+                parameters.runtime.count(),
+                parameters.deadline.count(),
+                parameters.period.count(),
+                strerror(result));
+        }
+    }
     else
     {
         sched_param p{parameters.priority};
@@ -419,6 +1366,52 @@ void Component::setSchedulingPolicy()
                 strerror(result));
         }
     }
+    // the thread may have cached its previous policy for priority ceiling mutexes
+    mutex::schedulingPolicyChanged();
+    CpuMask cpuAffinity = parameters.cpuAffinity;
+    if (parameters.numaNode >= 0)
+    {
+        if (cpuAffinity == 0)
+        {
+            cpuAffinity = getNumaNodeCpus(parameters.numaNode);
+        }
+        // the memory policy only applies to the calling thread
+        const int node = parameters.numaNode;
+        auto setMemoryPolicy = [this, node] {
+            int result = setThreadNumaNode(node);
+            if (result != 0)
+            {
+                MCF_ERROR_NOFILELINE(
+                    "Component [{}]: could not prefer memory of NUMA node {}, error: {}",
+                    fInstanceName,
+                    node,
+                    strerror(result));
+            }
+        };
+        if (pthread_equal(pthread_self(), fThreadHandle))
+        {
+            setMemoryPolicy();
+        }
+        else
+        {
+            post(setMemoryPolicy);
+        }
+    }
+    if (cpuAffinity != 0)
+    {
+        int result = setThreadCpuAffinity(fThreadHandle, cpuAffinity);
+        if (result != 0)
+        {
+            MCF_ERROR_NOFILELINE(
+                "Could not set CPU affinity {}, error: {}",
+                formatCpuMask(cpuAffinity),
+                strerror(result));
+        }
+    }
+    MCF_INFO_NOFILELINE(
+        "Component [{}]: running on CPUs {}",
+        fInstanceName,
+        formatCpuMask(getThreadCpuAffinity(fThreadHandle)));
 }
 
 void Component::ctrlSetComponentTraceEventGenerator(
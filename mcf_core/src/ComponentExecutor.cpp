@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/ComponentExecutor.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/LoggingMacros.h"
+#include "mcf_core/ThreadName.h"
+
+#include <cstring>
+
+namespace mcf {
+
+namespace {
+
+// the executor and worker index of the calling thread, if it is a worker
+thread_local const ComponentExecutor* tCurrentExecutor = nullptr;
+thread_local size_t tWorkerIndex = 0;
+
+} // anonymous namespace
+
+ExecutorTask::ExecutorTask(ComponentExecutor& executor, std::function<void()> func)
+: fExecutor(executor)
+, fFunc(std::move(func))
+{
+}
+
+void ExecutorTask::schedule()
+{
+    fExecutor.schedule(*this);
+}
+
+void ExecutorTask::cancel(bool wait)
+{
+    fExecutor.cancel(*this, wait);
+}
+
+ComponentExecutor::ComponentExecutor(size_t numWorkers, const std::string& name, CpuMask cpuAffinity)
+{
+    MCF_ASSERT(numWorkers > 0, "Component executor requires at least one worker thread");
+    for (size_t i = 0; i < numWorkers; ++i)
+    {
+        fQueues.push_back(std::make_unique<WorkerQueue>());
+    }
+    fWorkers.reserve(numWorkers);
+    for (size_t i = 0; i < numWorkers; ++i)
+    {
+        const std::string threadName = name + "_" + std::to_string(i);
+        fWorkers.emplace_back([this, threadName, i, cpuAffinity] {
+            setThreadName(threadName);
+            int result = setThreadCpuAffinity(pthread_self(), cpuAffinity);
+            if (result != 0)
+            {
+                MCF_ERROR_NOFILELINE("Could not set CPU affinity {} of {}, error: {}",
+                                     formatCpuMask(cpuAffinity), threadName, strerror(result));
+            }
+            work(i);
+        });
+    }
+}
+
+ComponentExecutor::~ComponentExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        fStopRequest = true;
+        fWorkAvailable.notify_all();
+    }
+    for (auto& worker : fWorkers)
+    {
+        worker.join();
+    }
+}
+
+void ComponentExecutor::schedule(ExecutorTask& task)
+{
+    int state = task.fState.load();
+    while (!task.fCancelled)
+    {
+        if (state == ExecutorTask::IDLE)
+        {
+            if (task.fState.compare_exchange_weak(state, ExecutorTask::QUEUED))
+            {
+                push(task.shared_from_this());
+                return;
+            }
+        }
+        else if (state == ExecutorTask::RUNNING)
+        {
+            if (task.fState.compare_exchange_weak(state, ExecutorTask::RERUN))
+            {
+                return;
+            }
+        }
+        else
+        {
+            // already queued or due to run again
+            return;
+        }
+    }
+}
+
+void ComponentExecutor::cancel(ExecutorTask& task, bool wait)
+{
+    task.fCancelled = true;
+    if (!wait)
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lk(fMutex);
+    // a queued task is dropped by the worker taking it, see run()
+    fTaskFinished.wait(lk, [&task] {
+        const int state = task.fState.load();
+        return state != ExecutorTask::RUNNING && state != ExecutorTask::RERUN;
+    });
+}
+
+void ComponentExecutor::push(std::shared_ptr<ExecutorTask> task)
+{
+    const size_t index = tCurrentExecutor == this
+        ? tWorkerIndex
+        : fNextQueue.fetch_add(1, std::memory_order_relaxed) % fQueues.size();
+    {
+        std::lock_guard<std::mutex> lk(fQueues[index]->mutex);
+        fQueues[index]->tasks.push_back(std::move(task));
+    }
+    fQueued.fetch_add(1);
+    if (fSleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        fWorkAvailable.notify_one();
+    }
+}
+
+std::shared_ptr<ExecutorTask> ComponentExecutor::pop(size_t index)
+{
+    std::shared_ptr<ExecutorTask> task;
+    {
+        WorkerQueue& own = *fQueues[index];
+        std::lock_guard<std::mutex> lk(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+        }
+    }
+    for (size_t i = 1; !task && i < fQueues.size(); ++i)
+    {
+        WorkerQueue& victim = *fQueues[(index + i) % fQueues.size()];
+        std::lock_guard<std::mutex> lk(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            fStealCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (task)
+    {
+        fQueued.fetch_sub(1);
+    }
+    return task;
+}
+
+void ComponentExecutor::run(ExecutorTask& task)
+{
+    task.fState = ExecutorTask::RUNNING;
+    if (!task.fCancelled)
+    {
+        task.fFunc();
+    }
+    int state = ExecutorTask::RUNNING;
+    if (task.fState.compare_exchange_strong(state, ExecutorTask::IDLE))
+    {
+        // not scheduled again while running
+    }
+    else if (!task.fCancelled)
+    {
+        // append rather than run again right away, so that busy tasks do not starve others
+        task.fState = ExecutorTask::QUEUED;
+        push(task.shared_from_this());
+        return;
+    }
+    else
+    {
+        task.fState = ExecutorTask::IDLE;
+    }
+    if (task.fCancelled)
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        fTaskFinished.notify_all();
+    }
+}
+
+void ComponentExecutor::work(size_t index)
+{
+    tCurrentExecutor = this;
+    tWorkerIndex = index;
+    while (!fStopRequest)
+    {
+        std::shared_ptr<ExecutorTask> task = pop(index);
+        if (task)
+        {
+            run(*task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lk(fMutex);
+        ++fSleeping;
+        fWorkAvailable.wait(lk, [this] { return fStopRequest || fQueued.load() > 0; });
+        --fSleeping;
+    }
+}
+
+} // namespace mcf
@@ -119,6 +119,40 @@ ComponentInstantiator::reloadComponent(const std::string& instanceName)
     }
 }
 
+ComponentProxy
+ComponentInstantiator::hotReloadComponent(
+    const std::string& instanceName, const ComponentManager::StateTransfer& transferState)
+{
+    auto it
+        = std::find_if(_instances.begin(), _instances.end(), [&instanceName](const auto& instance) {
+              return instance.proxy.name() == instanceName;
+          });
+    if (it == _instances.end())
+    {
+        MCF_ERROR_NOFILELINE("Instance {} not found", instanceName);
+        throw ComponentInstantiationError("Component instance not found");
+    }
+    auto qualifiedName = it->type.qualifiedName();
+    if (_types.find(qualifiedName) == _types.end())
+    {
+        MCF_ERROR_NOFILELINE("Type {} not registered, cannot instantiate", qualifiedName);
+        throw ComponentInstantiationError("Type cannot be instantiated");
+    }
+    auto type                            = _types.at(qualifiedName);
+    std::shared_ptr<IComponent> instance = type.makeInstance();
+    std::string configName = instanceName + Component::DEFAULT_CONFIG_NAME_SUFFIX;
+    ComponentProxy proxy = _manager.replaceComponent(it->proxy,
+                                                     instance,
+                                                     qualifiedName,
+                                                     &configName,
+                                                     transferState);
+
+    _instances.emplace(it, proxy, instance, type);
+    _instances.erase(it);
+
+    return proxy;
+}
+
 std::vector<ComponentProxy>
 ComponentInstantiator::listComponents() const
 {
@@ -6,13 +6,17 @@
 #include "mcf_core/ComponentLogger.h"
 #include "mcf_core/LoggingMacros.h"
 #include "mcf_core/Port.h"
+#include "mcf_core/ThreadName.h"
 
 #include "spdlog/spdlog.h"
+#include "spdlog/async.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/sinks/dist_sink.h"
 
 #include "json/json.h"
 
+#include <algorithm>
+
 namespace mcf {
 
 constexpr const char* ComponentLogger::CONSOLE_LOG_LEVEL_KEY;
@@ -164,13 +168,29 @@ extern std::mutex loggerAccessMutex;
 extern std::shared_ptr<spdlog::logger> mcfLogger;
 extern std::shared_ptr<spdlog::sinks::stderr_color_sink_mt> consoleSink;
 
+extern std::shared_ptr<spdlog::details::thread_pool> asyncLogThreadPool;
+extern bool asyncLogEnabled;
+extern bool asyncLogDropWhenFull;
+extern size_t asyncLogQueueSize;
+
+/*
+ * The value store sink may run on the log thread after the component is gone, messages logged
+ * then are dropped.
+ */
+struct ComponentLogger::LogMessagePortRef {
+    std::mutex mutex;
+    SenderPort<msg::LogMessage>* port;
+};
+
 /*
  * Constructor
  */
 ComponentLogger::ComponentLogger(std::string name, SenderPort<msg::LogMessage>& logMessagePort)
 : fName(std::move(name)),
-  fLogMessagePort(logMessagePort)
+  fLogMessagePort(std::make_shared<LogMessagePortRef>())
 {
+    fLogMessagePort->port = &logMessagePort;
+
     {
         std::lock_guard<std::mutex> guard(loggerAccessMutex);
         spdlog::set_pattern(LOGGER_FORMAT);
@@ -183,20 +203,99 @@ ComponentLogger::ComponentLogger(std::string name, SenderPort<msg::LogMessage>&
     }
     fConsoleSink = std::make_shared<logger::SinkWrapper>(consoleSink);
     fValueStoreSink = std::make_shared<logger::LambdaLoggerSink>(
-        [this](spdlog::level::level_enum level, std::string message) {
+        [portRef = fLogMessagePort](spdlog::level::level_enum level, std::string message) {
             auto msg = std::make_unique<msg::LogMessage>();
             msg->message = std::move(message);
             msg->severity = logger::fromSpdLogLevel(level);
-            this->fLogMessagePort.setValue(std::move(msg));
+            std::lock_guard<std::mutex> guard(portRef->mutex);
+            if (portRef->port != nullptr)
+            {
+                portRef->port->setValue(std::move(msg));
+            }
         },
         LOGGER_FORMAT);
+    fConsoleSink->set_level(spdlog::level::debug);
+    fValueStoreSink->set_level(spdlog::level::err);
+    fLogger = createLogger();
+}
+
+ComponentLogger::~ComponentLogger()
+{
+    std::lock_guard<std::mutex> guard(fLogMessagePort->mutex);
+    fLogMessagePort->port = nullptr;
+}
+
+std::shared_ptr<spdlog::logger> ComponentLogger::createLogger() const
+{
     auto distSink = std::make_shared<spdlog::sinks::dist_sink_mt>();
     distSink->add_sink(fConsoleSink);
     distSink->add_sink(fValueStoreSink);
-    fLogger = std::make_shared<spdlog::logger>(fName, distSink);
-    fLogger->set_level(spdlog::level::trace);
-    fConsoleSink->set_level(spdlog::level::debug);
-    fValueStoreSink->set_level(spdlog::level::err);
+
+    std::shared_ptr<spdlog::logger> logger;
+    {
+        std::lock_guard<std::mutex> guard(loggerAccessMutex);
+        if (asyncLogEnabled)
+        {
+            logger = std::make_shared<spdlog::async_logger>(
+                fName, distSink, asyncLogThreadPool,
+                asyncLogDropWhenFull ? spdlog::async_overflow_policy::overrun_oldest
+                                     : spdlog::async_overflow_policy::block);
+        }
+    }
+    if (!logger)
+    {
+        logger = std::make_shared<spdlog::logger>(fName, distSink);
+    }
+    logger->set_level(std::min(fConsoleSink->level(), fValueStoreSink->level()));
+    return logger;
+}
+
+void ComponentLogger::updateLoggerLevel()
+{
+    // lets the logging macros skip messages no sink takes before formatting them
+    fLogger->set_level(std::min(fConsoleSink->level(), fValueStoreSink->level()));
+}
+
+void ComponentLogger::enableAsyncLogging(const AsyncLogConfig& config)
+{
+    std::lock_guard<std::mutex> guard(loggerAccessMutex);
+    if (asyncLogThreadPool)
+    {
+        if (config.queueSize != asyncLogQueueSize
+            || config.dropWhenFull != asyncLogDropWhenFull)
+        {
+            spdlog::warn("Asynchronous logging already enabled, keeping its settings");
+        }
+    }
+    else
+    {
+        asyncLogQueueSize = std::max<size_t>(config.queueSize, 1);
+        // leaked, loggers may still queue messages while the process exits
+        asyncLogThreadPool = std::shared_ptr<spdlog::details::thread_pool>(
+            new spdlog::details::thread_pool(asyncLogQueueSize, 1, [] { setThreadName("mcf_log"); }),
+            [](spdlog::details::thread_pool*) {});
+        asyncLogDropWhenFull = config.dropWhenFull;
+    }
+    asyncLogEnabled = true;
+}
+
+void ComponentLogger::disableAsyncLogging()
+{
+    std::lock_guard<std::mutex> guard(loggerAccessMutex);
+    asyncLogEnabled = false;
+}
+
+AsyncLogStatistics ComponentLogger::getAsyncLogStatistics()
+{
+    std::lock_guard<std::mutex> guard(loggerAccessMutex);
+    AsyncLogStatistics statistics;
+    statistics.enabled = asyncLogEnabled;
+    if (asyncLogThreadPool)
+    {
+        statistics.queueSize = asyncLogQueueSize;
+        statistics.dropped = asyncLogThreadPool->overrun_counter();
+    }
+    return statistics;
 }
 
 bool ComponentLogger::hasComponentLogger()
@@ -204,7 +303,7 @@ bool ComponentLogger::hasComponentLogger()
     return (componentLogger != nullptr);
 }
 
-std::shared_ptr<spdlog::logger> ComponentLogger::getLocalLogger()
+const std::shared_ptr<spdlog::logger>& ComponentLogger::getLocalLogger()
 {
     if (!componentLogger)
     {
@@ -230,6 +329,18 @@ void ComponentLogger::injectLocalLogger()
     }
 }
 
+std::shared_ptr<spdlog::logger> ComponentLogger::replaceLocalLogger()
+{
+    std::shared_ptr<spdlog::logger> previous = std::move(componentLogger);
+    componentLogger = fLogger;
+    return previous;
+}
+
+void ComponentLogger::restoreLocalLogger(std::shared_ptr<spdlog::logger> logger)
+{
+    componentLogger = std::move(logger);
+}
+
 void ComponentLogger::setLogLevelsFromConfig(const Json::Value& config)
 {
     std::string componentName;
@@ -250,6 +361,7 @@ void ComponentLogger::setLogLevelsFromConfig(const Json::Value& config)
             throw std::runtime_error("Invalid ConsoleLogLevel in "+componentName+" configuration");
         }
         fConsoleSink->set_level(logger::fromStringLogLevel(configValueJson[CONSOLE_LOG_LEVEL_KEY].asString()));
+        updateLoggerLevel();
     }
     else
     {
@@ -263,6 +375,7 @@ void ComponentLogger::setLogLevelsFromConfig(const Json::Value& config)
             throw std::runtime_error("Invalid ValueStoreLogLevel in "+componentName+" configuration");
         }
         fValueStoreSink->set_level(logger::fromStringLogLevel(configValueJson[VALUE_STORE_LOG_LEVEL_KEY].asString()));
+        updateLoggerLevel();
     }
     else
     {
@@ -273,26 +386,25 @@ void ComponentLogger::setLogLevelsFromConfig(const Json::Value& config)
 void ComponentLogger::setName(const std::string& name)
 {
     fName = name;
-    auto distSink = std::make_shared<spdlog::sinks::dist_sink_mt>();
-    distSink->add_sink(fConsoleSink);
-    distSink->add_sink(fValueStoreSink);
-    fLogger = std::make_shared<spdlog::logger>(fName, distSink);
-    fLogger->set_level(spdlog::level::trace);
+    fLogger = createLogger();
 }
 
 void ComponentLogger::setValueStoreLogLevel(const int level)
 {
     fValueStoreSink->set_level(logger::fromMcfLogLevel(level));
+    updateLoggerLevel();
 }
 
 void ComponentLogger::setValueStoreLogLevel(const LogSeverity level)
 {
     fValueStoreSink->set_level(level);
+    updateLoggerLevel();
 }
 
 void ComponentLogger::setConsoleLogLevel(const LogSeverity level)
 {
     fConsoleSink->set_level(level);
+    updateLoggerLevel();
 }
 
 
@@ -7,6 +7,9 @@
 
 namespace spdlog {
 class logger;
+namespace details {
+class thread_pool;
+}
 namespace sinks {
 class stderr_color_sink_mt;
 }
@@ -22,4 +25,12 @@ thread_local std::shared_ptr<spdlog::logger> componentLogger;
 std::mutex loggerAccessMutex;
 std::shared_ptr<spdlog::logger> mcfLogger = nullptr;
 std::shared_ptr<spdlog::sinks::stderr_color_sink_mt> consoleSink = nullptr;
+
+/**
+ * The queue and thread of asynchronous logging, and whether new loggers use them
+ */
+std::shared_ptr<spdlog::details::thread_pool> asyncLogThreadPool = nullptr;
+bool asyncLogEnabled = false;
+bool asyncLogDropWhenFull = true;
+size_t asyncLogQueueSize = 0;
 }
\ No newline at end of file
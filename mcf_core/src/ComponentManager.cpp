@@ -2,11 +2,171 @@
  * Copyright (c) 2024 Accenture
  */
 #include "mcf_core/ComponentManager.h"
+#include "mcf_core/ComponentExecutor.h"
 #include "mcf_core/ComponentTraceController.h"
 #include "mcf_core/ErrorMacros.h"
 #include "mcf_core/LoggingMacros.h"
+#include "mcf_core/MutexProfile.h"
+#include "mcf_core/TimerWheel.h"
+#include "mcf_core/ValueReclaimer.h"
+#include "mcf_core/util/ConfigCache.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
 
 namespace mcf {
+
+namespace {
+
+using Timing = std::pair<std::chrono::microseconds, std::chrono::microseconds>;
+
+/*
+ * Run task(i) for all nodes on numThreads threads, each node after all of its dependencies.
+ * Returns the begin and end time of each node relative to the call. If a task throws, no further
+ * nodes are started and the first exception is rethrown when the running tasks have finished.
+ */
+std::vector<Timing> runOrdered(
+    const std::vector<std::vector<size_t>>& dependencies,
+    size_t numThreads,
+    const std::function<void(size_t)>& task)
+{
+    const size_t numNodes = dependencies.size();
+    std::vector<size_t> pending(numNodes);
+    std::vector<std::vector<size_t>> dependents(numNodes);
+    std::deque<size_t> ready;
+    for (size_t i = 0; i < numNodes; ++i)
+    {
+        pending[i] = dependencies[i].size();
+        for (auto dependency : dependencies[i])
+        {
+            dependents[dependency].push_back(i);
+        }
+        if (pending[i] == 0)
+        {
+            ready.push_back(i);
+        }
+    }
+
+    std::vector<Timing> timings(numNodes);
+    size_t finished = 0;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable condition;
+    const auto origin = std::chrono::steady_clock::now();
+    auto elapsed = [&origin] {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - origin);
+    };
+
+    auto work = [&] {
+        std::unique_lock<std::mutex> lk(mutex);
+        while (true)
+        {
+            condition.wait(lk, [&] { return error || !ready.empty() || finished == numNodes; });
+            if (error || ready.empty())
+            {
+                return;
+            }
+            const size_t node = ready.front();
+            ready.pop_front();
+            lk.unlock();
+
+            const auto begin = elapsed();
+            std::exception_ptr taskError;
+            try
+            {
+                task(node);
+            }
+            catch (...)
+            {
+                taskError = std::current_exception();
+            }
+            const auto end = elapsed();
+
+            lk.lock();
+            timings[node] = Timing(begin, end);
+            ++finished;
+            if (taskError && !error)
+            {
+                error = taskError;
+            }
+            for (auto dependent : dependents[node])
+            {
+                if (--pending[dependent] == 0)
+                {
+                    ready.push_back(dependent);
+                }
+            }
+            condition.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::min(numThreads, numNodes); ++i)
+    {
+        threads.emplace_back(work);
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    return timings;
+}
+
+std::chrono::microseconds
+elapsedSince(const std::chrono::steady_clock::time_point& origin)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - origin);
+}
+
+/*
+ * The dependents of each node, i.e. the dependencies of the reverse order
+ */
+std::vector<std::vector<size_t>>
+reverseDependencies(const std::vector<std::vector<size_t>>& dependencies)
+{
+    std::vector<std::vector<size_t>> dependents(dependencies.size());
+    for (size_t i = 0; i < dependencies.size(); ++i)
+    {
+        for (auto dependency : dependencies[i])
+        {
+            dependents[dependency].push_back(i);
+        }
+    }
+    return dependents;
+}
+
+/*
+ * What keeps a component in the given state from stopping
+ */
+const char*
+stopBlocker(IComponent::StateType state)
+{
+    switch (state)
+    {
+    case IComponent::STARTING_UP:
+        return "it is still in its startup()";
+    case IComponent::STARTED:
+    case IComponent::RUNNING:
+        return "a handler has not returned";
+    case IComponent::SHUTTING_DOWN:
+        return "it is still in its shutdown()";
+    default:
+        return "its threads have not finished";
+    }
+}
+
+} // anonymous namespace
 void
 PortProxy::connect()
 {
@@ -126,6 +286,14 @@ PortProxy::isQueued() const
     return queuedPort != nullptr;
 }
 
+std::shared_ptr<ValueQueue>
+PortProxy::queue() const
+{
+    auto c          = _componentManager.getComponent(_componentId);
+    auto queuedPort = dynamic_cast<GenericQueuedReceiverPort*>(&_port);
+    return queuedPort != nullptr ? queuedPort->getQueue() : nullptr;
+}
+
 std::vector<PortProxy>
 ComponentProxy::ports()
 {
@@ -168,6 +336,12 @@ ComponentProxy::setSchedulingParameters(const IComponent::SchedulingParameters&
     _componentManager.setSchedulingParameters(*this, parameters);
 }
 
+void
+ComponentProxy::setDedicatedThread(bool dedicated)
+{
+    _componentManager.setDedicatedThread(*this, dedicated);
+}
+
 ComponentManager::ComponentManager(
         ValueStore& valueStore,
         const std::string& configDir,
@@ -267,9 +441,12 @@ ComponentManager::registerComponent(std::shared_ptr<IComponent> component, const
     auto descriptor  = ComponentProxy(instanceName, typeName, componentId, *this);
     {
         std::lock_guard<std::recursive_mutex> lk(fMutex);
+        std::lock_guard<mutex::PriorityInheritanceSharedMutex> registryLock(fRegistryMutex);
         fComponents.insert(std::make_pair(
             componentId, ComponentMapEntry{descriptor, component, ComponentState::REGISTERED}));
+        fComponentPortMap[componentId];
     }
+    ++fTopologyGeneration;
     return descriptor;
 }
 
@@ -287,7 +464,9 @@ void ComponentManager::registerPort(Port& port)
         MCF_WARN_NOFILELINE("A port with name {} is already present", port.getName());
         throw std::runtime_error("Attempt to register a port with the same name");
     }
+    std::lock_guard<mutex::PriorityInheritanceSharedMutex> registryLock(fRegistryMutex);
     fComponentPortMap[it->first].insert(std::make_pair(port.getName(), PortMapEntry{port, false}));
+    ++fTopologyGeneration;
 }
 
 void ComponentManager::registerPort(Port& port, const std::string& topic)
@@ -295,6 +474,7 @@ void ComponentManager::registerPort(Port& port, const std::string& topic)
     // Thread safety: registerPort() is thread safe, port mapping is handled at a different place
     registerPort(port);
     port.mapToTopic(topic);
+    ++fTopologyGeneration;
 }
 
 bool ComponentManager::configure()
@@ -303,6 +483,7 @@ bool ComponentManager::configure()
     // calls; the private methods can then assume that the lock exists.
     std::lock_guard<std::recursive_mutex> lk(fMutex);
     callConfigure();
+    saveConfigCache();
     setupPorts();
     return checkConfiguration();
 }
@@ -339,34 +520,80 @@ void ComponentManager::startup(bool connectPorts)
     {
         this->connectPorts();
     }
+    compileRoutingTable(true);
     auto componentsToStart = std::vector<uint64_t>();
+    auto components = std::vector<std::shared_ptr<IComponent>>();
     componentsToStart.reserve(fComponents.size());
     for (auto& c : fComponents)
     {
         if (c.second.state == ComponentState::CONFIGURED)
         {
             componentsToStart.push_back(c.first);
-            c.second.component->ctrlStart();
+            components.push_back(c.second.component);
+            applyExecutor(c.second);
+            c.second.component->ctrlSetStackPrefault(fRealtimeMemory.stackPrefaultBytes);
         }
     }
-    bool doWait = true;
-    while(doWait)
+
+    std::vector<std::vector<size_t>> dependencies;
+    std::vector<Timing> timings;
+    if (fLifecycleThreads > 0)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        doWait = false;
-        for (const auto& id: componentsToStart)
+        dependencies = lifecycleDependencies(componentsToStart, fPortDependencies);
+        std::vector<char> started(components.size(), 0);
+        try
+        {
+            timings = runOrdered(dependencies, fLifecycleThreads, [&components, &started](size_t i) {
+                components[i]->ctrlStart();
+                components[i]->waitStarted();
+                started[i] = 1;
+            });
+        }
+        catch (...)
         {
-            if (fComponents.at(id).component->getState() != IComponent::STARTED)
+            for (size_t i = 0; i < components.size(); ++i)
             {
-                doWait = true;
+                if (started[i])
+                {
+                    components[i]->ctrlStop();
+                }
             }
+            throw;
         }
     }
+    else
+    {
+        // all components start concurrently on their own threads
+        dependencies.resize(components.size());
+        const auto origin = std::chrono::steady_clock::now();
+        for (const auto& component : components)
+        {
+            timings.emplace_back(elapsedSince(origin), std::chrono::microseconds(0));
+            component->ctrlStart();
+        }
+        for (size_t i = 0; i < components.size(); ++i)
+        {
+            components[i]->waitStarted();
+            const auto duration = components[i]->getStartupDuration();
+            timings[i].second = duration.count() > 0 ? timings[i].first + duration : elapsedSince(origin);
+        }
+    }
+    if (fValueSnapshot)
+    {
+        // the ports are connected, so queued receivers get the restored values as well
+        if (!fValueSnapshotRestored)
+        {
+            fValueSnapshot->restore();
+            fValueSnapshotRestored = true;
+        }
+        fValueSnapshot->start();
+    }
     for (const auto& id : componentsToStart)
     {
         fComponents.at(id).component->ctrlRun();
         fComponents.at(id).state = ComponentState::RUNNING;
     }
+    reportTimeline("startup", componentsToStart, dependencies, timings);
 }
 
 void ComponentManager::startup(const ComponentProxy& descriptor, bool connectPorts)
@@ -392,14 +619,12 @@ void ComponentManager::startup(const ComponentProxy& descriptor, bool connectPor
                 me.second.port.connect();
             }
         }
+        applyNumaPlacement();
+        compileRoutingTable(false);
+        applyExecutor(entry);
+        component->ctrlSetStackPrefault(fRealtimeMemory.stackPrefaultBytes);
         component->ctrlStart();
-        bool doWait = true;
-        while (doWait) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            if (component->getState() == IComponent::STARTED) {
-                doWait = false;
-            }
-        }
+        component->waitStarted();
         component->ctrlRun();
         entry.state = ComponentState::RUNNING;
     }
@@ -418,18 +643,79 @@ void ComponentManager::startup(const ComponentProxy& descriptor, bool connectPor
 void ComponentManager::shutdown()
 {
     std::lock_guard<std::recursive_mutex> lk(fMutex);
+    // before startup() restored it, the snapshot file still holds the values of the previous run
+    if (fValueSnapshot && fValueSnapshotRestored)
+    {
+        fValueSnapshot->stop();
+    }
+    std::vector<uint64_t> ids;
+    std::vector<ComponentMapEntry*> entries;
+    // the stopping threads must not lock the manager, which PortProxy does
+    std::vector<std::vector<Port*>> ports;
     for (auto& c : fComponents) {
         if (c.second.state == ComponentState::RUNNING)
         {
-            MCF_INFO_NOFILELINE("Component Manager: stopping component {}", c.second.component->getName());
-            for (auto& p: getPorts(c.second.descriptor))
+            ids.push_back(c.first);
+            entries.push_back(&c.second);
+            ports.emplace_back();
+            auto it = fComponentPortMap.find(c.first);
+            if (it != fComponentPortMap.end())
             {
-                p.disconnect();
+                for (auto& nameEntryPair : it->second)
+                {
+                    ports.back().push_back(&nameEntryPair.second.port);
+                }
             }
-            c.second.component->ctrlStop();
-            c.second.state = ComponentState::CONFIGURED;
         }
     }
+
+    std::vector<std::vector<size_t>> dependencies(ids.size());
+    std::vector<Timing> timings;
+    auto stop = [this, &entries, &ports](size_t i) {
+        try
+        {
+            stopComponent(*entries[i], ports[i]);
+        }
+        catch (const std::exception& e)
+        {
+            // the other components are stopped anyway
+            MCF_ERROR_NOFILELINE(
+                "Component Manager: stopping component {} failed: {}", entries[i]->descriptor.name(), e.what());
+        }
+    };
+    if (fShutdownOptions.numThreads > 0)
+    {
+        // the reverse of the startup order, receivers stop before the senders of their topics
+        dependencies = reverseDependencies(lifecycleDependencies(ids, fShutdownOptions.portDependencies));
+        timings = runOrdered(dependencies, fShutdownOptions.numThreads, stop);
+    }
+    else
+    {
+        // each component waits for the previous one
+        const auto origin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            const auto begin = elapsedSince(origin);
+            stop(i);
+            timings.emplace_back(begin, elapsedSince(origin));
+            if (i > 0)
+            {
+                dependencies[i].push_back(i - 1);
+            }
+        }
+    }
+    for (auto* entry : entries)
+    {
+        entry->state = ComponentState::CONFIGURED;
+    }
+    reportTimeline("shutdown", ids, dependencies, timings);
+#if MCF_ENABLE_MUTEX_PROFILING
+    const std::string report = mutex::MutexProfile::report();
+    if (!report.empty())
+    {
+        MCF_INFO_NOFILELINE("Component Manager: mutex contention profile\n{}", report);
+    }
+#endif
 }
 
 void ComponentManager::shutdown(const ComponentProxy& descriptor)
@@ -438,17 +724,56 @@ void ComponentManager::shutdown(const ComponentProxy& descriptor)
     auto& entry    = fComponents.at(descriptor.id());
     if (entry.state == ComponentState::RUNNING)
     {
-        MCF_INFO_NOFILELINE("Component Manager: stopping component {}", entry.component->getName());
-        auto ports     = getPorts(descriptor);
-        for (auto& p: ports)
+        std::vector<Port*> ports;
+        auto it = fComponentPortMap.find(descriptor.id());
+        if (it != fComponentPortMap.end())
         {
-            p.disconnect();
+            for (auto& nameEntryPair : it->second)
+            {
+                ports.push_back(&nameEntryPair.second.port);
+            }
         }
-        entry.component->ctrlStop();
+        stopComponent(entry, ports);
         entry.state = ComponentState::CONFIGURED;
     }
 }
 
+void ComponentManager::stopComponent(const ComponentMapEntry& entry, const std::vector<Port*>& ports)
+{
+    // private method, no locking required, runs on the threads of shutdown()
+    const std::string name = entry.descriptor.name();
+    MCF_INFO_NOFILELINE("Component Manager: stopping component {}", name);
+    for (auto* port : ports)
+    {
+        port->disconnect();
+    }
+
+    const auto deadline = fShutdownOptions.stopDeadline;
+    TimerWheel::TimerId timer = TimerWheel::INVALID_TIMER;
+    if (deadline.count() > 0)
+    {
+        std::shared_ptr<IComponent> component = entry.component;
+        timer = TimerWheel::instance().scheduleAfter(deadline, [component, name, deadline] {
+            MCF_WARN_NOFILELINE(
+                "Component Manager: component {} has not stopped within {} ms, {}",
+                name,
+                deadline.count(),
+                stopBlocker(component->getState()));
+        });
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    entry.component->ctrlStop();
+    // a fired timer cannot be cancelled
+    if (timer != TimerWheel::INVALID_TIMER && !TimerWheel::instance().cancel(timer))
+    {
+        MCF_WARN_NOFILELINE(
+            "Component Manager: component {} stopped after {:.1f} ms, exceeding its stop deadline of {} ms",
+            name,
+            elapsedSince(begin).count() / 1000.0,
+            deadline.count());
+    }
+}
+
 void ComponentManager::eraseComponent(const ComponentProxy& descriptor)
 {
     std::lock_guard<std::recursive_mutex> lk(fMutex);
@@ -463,8 +788,136 @@ void ComponentManager::eraseComponent(const ComponentProxy& descriptor)
         component->ctrlStop();
     }
     // remove ports
-    fComponents.erase(descriptor.id());
-    fComponentPortMap.erase(descriptor.id());
+    {
+        std::lock_guard<mutex::PriorityInheritanceSharedMutex> registryLock(fRegistryMutex);
+        fComponents.erase(descriptor.id());
+        fComponentPortMap.erase(descriptor.id());
+    }
+    ++fTopologyGeneration;
+    fDependencies.erase(descriptor.id());
+    for (auto& dependencies : fDependencies)
+    {
+        dependencies.second.erase(descriptor.id());
+    }
+}
+
+ComponentProxy ComponentManager::replaceComponent(
+    const ComponentProxy& previous,
+    std::shared_ptr<IComponent> component,
+    const std::string& typeName,
+    const std::string* configName,
+    const StateTransfer& transferState)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    const auto begin = std::chrono::steady_clock::now();
+    auto previousIt = fComponents.find(previous.id());
+    if (previousIt == fComponents.end() || previousIt->second.state != ComponentState::RUNNING)
+    {
+        MCF_THROW_RUNTIME(fmt::format(
+            "Component {}:{} is not running and cannot be replaced", previous.name(), previous.typeName()));
+    }
+    MCF_INFO_NOFILELINE("Component Manager: replacing component {}", previous.name());
+
+    // the new instance is configured while the previous one still runs
+    const ComponentProxy descriptor = registerComponent(component, typeName, previous.name(), configName);
+    try
+    {
+        configure(descriptor);
+        checkConfiguration();
+    }
+    catch (...)
+    {
+        // the previous instance keeps running as if nothing happened
+        eraseComponent(descriptor);
+        throw;
+    }
+
+    ReloadStatistics statistics;
+    statistics.component = previous.name();
+
+    // stopped with its ports connected, so that the values written by its last handlers are not
+    // lost, and its queues keep receiving until they are taken over
+    const auto stopBegin = std::chrono::steady_clock::now();
+    auto& previousEntry = previousIt->second;
+    previousEntry.component->ctrlStop();
+    previousEntry.state = ComponentState::CONFIGURED;
+    if (transferState)
+    {
+        transferState(*previousEntry.component, *component);
+    }
+
+    auto& previousPorts = fComponentPortMap[previous.id()];
+    for (auto& nameEntryPair : fComponentPortMap[descriptor.id()])
+    {
+        auto& me = nameEntryPair.second;
+        if (!me.isValid)
+        {
+            continue;
+        }
+        auto* port = dynamic_cast<GenericQueuedReceiverPort*>(&me.port);
+        auto previousPort = previousPorts.find(nameEntryPair.first);
+        if (port != nullptr && previousPort != previousPorts.end())
+        {
+            auto* queuedPort = dynamic_cast<GenericQueuedReceiverPort*>(&previousPort->second.port);
+            const size_t queued = queuedPort != nullptr ? queuedPort->getQueue()->size() : 0;
+            if (queuedPort != nullptr && port->takeOverQueue(*queuedPort))
+            {
+                ++statistics.handedOverQueues;
+                statistics.handedOverValues += queued;
+                continue;
+            }
+        }
+        me.port.connect();
+    }
+    for (auto& nameEntryPair : previousPorts)
+    {
+        nameEntryPair.second.port.disconnect();
+    }
+
+    auto& entry = fComponents.at(descriptor.id());
+    applyNumaPlacement();
+    applyExecutor(entry);
+    component->ctrlSetStackPrefault(fRealtimeMemory.stackPrefaultBytes);
+    component->ctrlStart();
+    component->waitStarted();
+    component->ctrlRun();
+    entry.state = ComponentState::RUNNING;
+    statistics.stall = elapsedSince(stopBegin);
+
+    // the new instance takes the place of the previous one in the lifecycle
+    auto dependencies = fDependencies.find(previous.id());
+    if (dependencies != fDependencies.end())
+    {
+        fDependencies[descriptor.id()] = dependencies->second;
+    }
+    for (auto& idDependencies : fDependencies)
+    {
+        if (idDependencies.second.erase(previous.id()) > 0)
+        {
+            idDependencies.second.insert(descriptor.id());
+        }
+    }
+    eraseComponent(previous);
+    compileRoutingTable(false);
+
+    statistics.duration = elapsedSince(begin);
+    MCF_INFO_NOFILELINE(
+        "Component Manager: replaced component {} in {:.1f} ms, stalled for {:.1f} ms, "
+        "{} values handed over in {} queues",
+        statistics.component,
+        statistics.duration.count() / 1000.0,
+        statistics.stall.count() / 1000.0,
+        statistics.handedOverValues,
+        statistics.handedOverQueues);
+    fReloadStatistics.push_back(statistics);
+    return descriptor;
+}
+
+std::vector<ComponentManager::ReloadStatistics>
+ComponentManager::getReloadStatistics() const
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    return fReloadStatistics;
 }
 
 void
@@ -474,6 +927,359 @@ ComponentManager::setSchedulingParameters(
     fComponents.at(proxy.id()).component->ctrlSetSchedulingParameters(parameters);
 }
 
+void
+ComponentManager::setExecutorThreads(size_t numWorkers, CpuMask cpuAffinity)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    // components running on a previous executor keep it alive until they are stopped
+    fExecutor.reset();
+    if (numWorkers > 0)
+    {
+        fExecutor = std::make_shared<ComponentExecutor>(numWorkers, "mcf_worker", cpuAffinity);
+    }
+}
+
+size_t
+ComponentManager::getExecutorThreads() const
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    return fExecutor ? fExecutor->getNumWorkers() : 0;
+}
+
+void
+ComponentManager::setDedicatedThread(const ComponentProxy& proxy, bool dedicated)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    fComponents.at(proxy.id()).dedicatedThread = dedicated;
+}
+
+void
+ComponentManager::setLifecycleThreads(size_t numThreads, bool portDependencies)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    fLifecycleThreads = numThreads;
+    fPortDependencies = portDependencies;
+}
+
+void
+ComponentManager::setShutdownOptions(const ShutdownOptions& options)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    fShutdownOptions = options;
+}
+
+void
+ComponentManager::addDependency(const ComponentProxy& component, const ComponentProxy& dependency)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    // enforce existence of the components
+    fComponents.at(component.id());
+    fComponents.at(dependency.id());
+    if (component.id() != dependency.id())
+    {
+        fDependencies[component.id()].insert(dependency.id());
+    }
+}
+
+void
+ComponentManager::fuse(const std::vector<ComponentProxy>& chain, bool fused)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    // the head of the chain keeps running on its own thread
+    for (size_t i = 1; i < chain.size(); ++i)
+    {
+        fComponents.at(chain[i].id()).component->ctrlSetFused(fused);
+    }
+}
+
+void
+ComponentManager::setNumaPlacement(NumaPlacement placement)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    fNumaPlacement = placement;
+}
+
+void
+ComponentManager::enableLineageTracking(const LineageConfig& config)
+{
+    if (config.sinks.empty())
+    {
+        LineageTracker::instance().disable();
+        return;
+    }
+    LineageTracker::instance().enable(fValueStore, config);
+}
+
+void
+ComponentManager::enableValueSnapshot(const ValueSnapshotConfig& config)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    if (fValueSnapshot && fValueSnapshotRestored)
+    {
+        fValueSnapshot->stop();
+    }
+    fValueSnapshot = config.file.empty() ? nullptr : std::make_unique<ValueSnapshot>(fValueStore, config);
+    fValueSnapshotRestored = false;
+}
+
+void
+ComponentManager::enablePreviews(const PreviewConfig& config)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    fPreviewService.reset();
+    if (!config.topics.empty())
+    {
+        fPreviewService = std::make_unique<PreviewService>(fValueStore, config);
+        fPreviewService->start();
+    }
+}
+
+void
+ComponentManager::setTopicQos(const TopicQosConfig& config)
+{
+    fValueStore.getTopicQos().configure(config);
+}
+
+size_t
+ComponentManager::setRealtimeMemory(const RealtimeMemoryOptions& options)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    if (options.lockMemory)
+    {
+        const int error = lockProcessMemory();
+        if (error != 0)
+        {
+            MCF_THROW_RUNTIME(fmt::format("Could not lock process memory: {}", strerror(error)));
+        }
+    }
+    else if (fRealtimeMemory.lockMemory)
+    {
+        unlockProcessMemory();
+    }
+    prefaultHeap(options.heapPrefaultBytes);
+    if (options.deferredFreeBytes > 0)
+    {
+        ValueReclaimer::Config reclaimerConfig;
+        reclaimerConfig.minBytes = options.deferredFreeBytes;
+        ValueReclaimer::instance().enable(reclaimerConfig);
+    }
+    else if (fRealtimeMemory.deferredFreeBytes > 0)
+    {
+        ValueReclaimer::instance().disable();
+    }
+    fRealtimeMemory = options;
+    const size_t locked = getLockedMemorySize();
+    MCF_INFO_NOFILELINE("Real-time memory: {} KiB locked, {} major page faults so far",
+                        locked / 1024, getMajorPageFaults());
+    return locked;
+}
+
+std::vector<ComponentManager::LifecycleTimelineEntry>
+ComponentManager::getLifecycleTimeline() const
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    return fLifecycleTimeline;
+}
+
+std::vector<std::vector<size_t>>
+ComponentManager::lifecycleDependencies(const std::vector<uint64_t>& ids, bool withPorts)
+{
+    // private method, no locking required
+    std::map<uint64_t, size_t> indices;
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        indices[ids[i]] = i;
+    }
+    std::vector<std::set<size_t>> dependencySets(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        auto declared = fDependencies.find(ids[i]);
+        if (declared == fDependencies.end())
+        {
+            continue;
+        }
+        for (auto id : declared->second)
+        {
+            auto it = indices.find(id);
+            if (it != indices.end())
+            {
+                dependencySets[i].insert(it->second);
+            }
+        }
+    }
+
+    if (withPorts)
+    {
+        // receivers of a topic wait for its senders
+        std::map<std::string, std::pair<std::set<size_t>, std::set<size_t>>> topics;
+        for (const auto& idMapPair : fComponentPortMap)
+        {
+            auto it = indices.find(idMapPair.first);
+            if (it == indices.end())
+            {
+                continue;
+            }
+            for (const auto& nameEntryPair : idMapPair.second)
+            {
+                auto& port = nameEntryPair.second.port;
+                const auto topic = port.getTopic();
+                if (!nameEntryPair.second.isValid || topic.empty())
+                {
+                    continue;
+                }
+                auto& endpoints = topics[topic];
+                (port.getDirection() == Port::sender ? endpoints.first : endpoints.second)
+                    .insert(it->second);
+            }
+        }
+        for (const auto& topic : topics)
+        {
+            for (auto receiver : topic.second.second)
+            {
+                for (auto sender : topic.second.first)
+                {
+                    if (sender != receiver)
+                    {
+                        dependencySets[receiver].insert(sender);
+                    }
+                }
+            }
+        }
+    }
+
+    // break cycles: nodes not reached in topological order do not wait for each other
+    std::vector<size_t> pending(ids.size());
+    std::vector<std::vector<size_t>> dependents(ids.size());
+    std::deque<size_t> ready;
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        pending[i] = dependencySets[i].size();
+        for (auto dependency : dependencySets[i])
+        {
+            dependents[dependency].push_back(i);
+        }
+        if (pending[i] == 0)
+        {
+            ready.push_back(i);
+        }
+    }
+    std::vector<bool> reached(ids.size(), false);
+    while (!ready.empty())
+    {
+        const size_t node = ready.front();
+        ready.pop_front();
+        reached[node] = true;
+        for (auto dependent : dependents[node])
+        {
+            if (--pending[dependent] == 0)
+            {
+                ready.push_back(dependent);
+            }
+        }
+    }
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        if (reached[i])
+        {
+            continue;
+        }
+        MCF_WARN_NOFILELINE(
+            "Component Manager: ignoring cyclic dependencies of component {}",
+            fComponents.at(ids[i]).descriptor.name());
+        for (auto it = dependencySets[i].begin(); it != dependencySets[i].end();)
+        {
+            it = reached[*it] ? std::next(it) : dependencySets[i].erase(it);
+        }
+    }
+
+    std::vector<std::vector<size_t>> dependencies(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        dependencies[i].assign(dependencySets[i].begin(), dependencySets[i].end());
+    }
+    return dependencies;
+}
+
+void
+ComponentManager::reportTimeline(
+    const std::string& phase,
+    const std::vector<uint64_t>& ids,
+    const std::vector<std::vector<size_t>>& dependencies,
+    const std::vector<Timing>& timings)
+{
+    // private method, no locking required
+    fLifecycleTimeline.erase(
+        std::remove_if(
+            fLifecycleTimeline.begin(),
+            fLifecycleTimeline.end(),
+            [&phase](const LifecycleTimelineEntry& entry) { return entry.phase == phase; }),
+        fLifecycleTimeline.end());
+    if (ids.empty())
+    {
+        return;
+    }
+
+    // walk back from the component finishing last along the dependency finishing last
+    std::vector<bool> critical(ids.size(), false);
+    std::vector<size_t> path;
+    size_t last = 0;
+    for (size_t i = 1; i < ids.size(); ++i)
+    {
+        if (timings[i].second > timings[last].second)
+        {
+            last = i;
+        }
+    }
+    while (true)
+    {
+        critical[last] = true;
+        path.push_back(last);
+        if (dependencies[last].empty())
+        {
+            break;
+        }
+        last = *std::max_element(
+            dependencies[last].begin(), dependencies[last].end(), [&timings](size_t a, size_t b) {
+                return timings[a].second < timings[b].second;
+            });
+    }
+
+    std::string criticalPath;
+    for (auto it = path.rbegin(); it != path.rend(); ++it)
+    {
+        criticalPath += fmt::format(
+            "{}{} ({:.1f} ms)",
+            criticalPath.empty() ? "" : " -> ",
+            fComponents.at(ids[*it]).descriptor.name(),
+            (timings[*it].second - timings[*it].first).count() / 1000.0);
+    }
+    const auto total = std::max_element(timings.begin(), timings.end(), [](const Timing& a, const Timing& b) {
+        return a.second < b.second;
+    })->second;
+    MCF_INFO_NOFILELINE(
+        "Component Manager: {} of {} components took {:.1f} ms, critical path: {}",
+        phase,
+        ids.size(),
+        total.count() / 1000.0,
+        criticalPath);
+
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        fLifecycleTimeline.push_back(LifecycleTimelineEntry{
+            fComponents.at(ids[i]).descriptor.name(),
+            phase,
+            timings[i].first,
+            timings[i].second,
+            critical[i]});
+    }
+}
+
+void
+ComponentManager::applyExecutor(ComponentMapEntry& entry)
+{
+    entry.component->ctrlSetExecutor(entry.dedicatedThread ? nullptr : fExecutor);
+}
+
 void
 ComponentManager::setComponentLogLevels(
     const std::string& componentName,
@@ -527,9 +1333,10 @@ ComponentProxy ComponentManager::getComponent(uint64_t instanceId) const
 
 std::vector<PortProxy> ComponentManager::getPorts(const ComponentProxy& descriptor)
 {
-    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fRegistryMutex);
     auto result = std::vector<PortProxy>();
-    const ComponentMapEntry& entry = fComponents.at(descriptor.id());
+    // throws for unknown components
+    fComponents.at(descriptor.id());
     auto ports                     = fComponentPortMap.find(descriptor.id());
     if (ports != fComponentPortMap.end())
     {
@@ -572,6 +1379,12 @@ ComponentManager::mapPort(
     {
         entry.isValid = true;
     }
+    ++fTopologyGeneration;
+    // a port remapped at runtime may read a topic elided at startup
+    if (fTopicElision && !fRoutingTable.empty())
+    {
+        compileRoutingTable(false);
+    }
 }
 
 bool
@@ -635,23 +1448,14 @@ bool ComponentManager::checkConfiguration()
             perTopicResult = false;
         }
 
+        // topics without senders or receivers are reported with the routing table at startup
         int numSenders = std::count_if(ports.begin(), ports.end(),
             [](Port* port){return port->getDirection() == Port::sender ;});
 
-        int numReceivers = std::count_if(ports.begin(), ports.end(),
-            [](Port* port){return port->getDirection() == Port::receiver ;});
-
-        if (numSenders == 0) {
-            MCF_WARN_NOFILELINE("No sender for topic {}", topic);
-        }
-        else if (numSenders > 1) {
+        if (numSenders > 1) {
             MCF_WARN_NOFILELINE("More than one sender for topic {}", topic);
         }
 
-        if (numReceivers == 0) {
-            MCF_WARN_NOFILELINE("No receiver for topic {}", topic);
-        }
-
         if (perTopicResult) {
             // validate all ports connected to this topic
             for (auto pme : pmes) {
@@ -713,19 +1517,209 @@ void ComponentManager::connectPorts()
             }
         }
     }
+    applyNumaPlacement();
+}
+
+void ComponentManager::applyNumaPlacement()
+{
+    // private method, no locking required
+    auto nodeOf = [this](uint64_t id) {
+        auto it = fComponents.find(id);
+        return it != fComponents.end() ? it->second.component->getNumaNode() : -1;
+    };
+    std::map<std::string, std::vector<int>> consumerNodes;
+    if (fNumaPlacement == NumaPlacement::CONSUMER)
+    {
+        for (auto& idMapPair : fComponentPortMap)
+        {
+            const int node = nodeOf(idMapPair.first);
+            for (auto& nameEntryPair : idMapPair.second)
+            {
+                auto& me = nameEntryPair.second;
+                if (me.isValid && me.port.getDirection() == Port::receiver)
+                {
+                    consumerNodes[me.port.getTopic()].push_back(node);
+                }
+            }
+        }
+    }
+    for (auto& idMapPair : fComponentPortMap)
+    {
+        const int producerNode = nodeOf(idMapPair.first);
+        for (auto& nameEntryPair : idMapPair.second)
+        {
+            auto* sender = dynamic_cast<GenericSenderPort*>(&nameEntryPair.second.port);
+            if (sender == nullptr)
+            {
+                continue;
+            }
+            int node = -1;
+            auto consumers = consumerNodes.find(sender->getTopic());
+            if (consumers != consumerNodes.end())
+            {
+                node = dominantNumaNode(consumers->second);
+                if (node == producerNode)
+                {
+                    // already allocated there
+                    node = -1;
+                }
+            }
+            sender->setNumaNode(node);
+        }
+    }
+}
+
+void ComponentManager::compileRoutingTable(bool warn)
+{
+    // private method, no locking required
+    std::map<std::string, Route> routes;
+    for (auto& idMapPair : fComponentPortMap)
+    {
+        auto component = fComponents.find(idMapPair.first);
+        if (component == fComponents.end())
+        {
+            continue;
+        }
+        for (auto& nameEntryPair : idMapPair.second)
+        {
+            auto& me = nameEntryPair.second;
+            const std::string topic = me.port.getTopic();
+            if (!me.isValid || topic.empty())
+            {
+                continue;
+            }
+            Route& route = routes[topic];
+            auto& names = me.port.getDirection() == Port::sender ? route.senders : route.receivers;
+            names.push_back(component->second.descriptor.name() + "." + nameEntryPair.first);
+        }
+    }
+
+    auto join = [](const std::vector<std::string>& names) {
+        std::string joined;
+        for (const auto& name : names)
+        {
+            joined += joined.empty() ? name : ", " + name;
+        }
+        return joined;
+    };
+    fRoutingTable.clear();
+    fRoutingTable.reserve(routes.size());
+    for (auto& pair : routes)
+    {
+        Route& route = pair.second;
+        route.topic = pair.first;
+        const auto handle = fValueStore.getTopicHandle(route.topic);
+        route.fanOut = fValueStore.getReceiverCount(handle);
+        // receiver ports without a queue read the latest value instead of being notified
+        const bool unread = route.receivers.empty() && route.fanOut == 0;
+        route.elided = fValueStore.setElided(handle, fTopicElision && unread);
+        if (warn && route.senders.empty())
+        {
+            MCF_WARN_NOFILELINE("No sender for topic {}, received by {}", route.topic, join(route.receivers));
+        }
+        else if (warn && unread)
+        {
+            MCF_WARN_NOFILELINE("No receiver for topic {}, sent by {}", route.topic, join(route.senders));
+        }
+        fRoutingTable.push_back(std::move(route));
+    }
+}
+
+void ComponentManager::setTopicElision(bool enable)
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    fTopicElision = enable;
+}
+
+std::vector<ComponentManager::Route> ComponentManager::getRoutingTable() const
+{
+    std::lock_guard<std::recursive_mutex> lk(fMutex);
+    return fRoutingTable;
+}
+
+void ComponentManager::saveConfigCache()
+{
+    // a cache file that cannot be written only costs the next startup time
+    try
+    {
+        util::json::ConfigCache::instance().save();
+    }
+    catch (const std::exception& e)
+    {
+        MCF_WARN_NOFILELINE("Cannot save the config cache: {}", e.what());
+    }
 }
 
 void ComponentManager::callConfigure()
 {
     // private method, no locking required
+    std::vector<uint64_t> ids;
     for (auto& c : fComponents) {
         if (c.second.state == ComponentState::REGISTERED)
         {
-            Config config(*this, c.second.descriptor.name());
-            c.second.component->ctrlConfigure(config);
-            c.second.state = ComponentState::CONFIGURED;
+            ids.push_back(c.first);
         }
     }
+
+    std::vector<std::vector<size_t>> dependencies(ids.size());
+    std::vector<Timing> timings;
+    if (fLifecycleThreads > 0)
+    {
+        // only declared dependencies are known, ports are registered in configure()
+        dependencies = lifecycleDependencies(ids, false);
+        std::vector<std::shared_ptr<IComponent>> components;
+        std::vector<std::unique_ptr<Config>> configs;
+        for (auto id : ids)
+        {
+            auto& entry = fComponents.at(id);
+            components.push_back(entry.component);
+            configs.emplace_back(new Config(*this, entry.descriptor.name(), true));
+        }
+        std::vector<char> configured(ids.size(), 0);
+        std::exception_ptr error;
+        try
+        {
+            timings = runOrdered(dependencies, fLifecycleThreads, [&](size_t i) {
+                components[i]->ctrlConfigure(*configs[i]);
+                configured[i] = 1;
+            });
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            if (configured[i])
+            {
+                configs[i]->applyRegistrations();
+                fComponents.at(ids[i]).state = ComponentState::CONFIGURED;
+            }
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    else
+    {
+        // each component waits for the previous one
+        const auto origin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            auto& entry = fComponents.at(ids[i]);
+            const auto begin = elapsedSince(origin);
+            Config config(*this, entry.descriptor.name());
+            entry.component->ctrlConfigure(config);
+            entry.state = ComponentState::CONFIGURED;
+            timings.emplace_back(begin, elapsedSince(origin));
+            if (i > 0)
+            {
+                dependencies[i].push_back(i - 1);
+            }
+        }
+    }
+    reportTimeline("configure", ids, dependencies, timings);
 }
 
 bool ComponentManager::isTopicValid(const std::string& topicName)
@@ -738,8 +1732,8 @@ bool ComponentManager::isTopicValid(const std::string& topicName)
     return !empty && validCharacters;
 }
 
-ComponentManager::Config::Config(ComponentManager& componentManager, std::string instanceName)
-: fComponentManager(componentManager), fInstanceName(std::move(instanceName))
+ComponentManager::Config::Config(ComponentManager& componentManager, std::string instanceName, bool deferRegistration)
+: fComponentManager(componentManager), fInstanceName(std::move(instanceName)), fDeferRegistration(deferRegistration)
 {}
 
 void
@@ -747,13 +1741,40 @@ ComponentManager::Config::registerPort(Port& port)
 {
     port.setComponentTraceEventGenerator(
             port.getComponent().getComponentTraceEventGenerator());
+    if (fDeferRegistration)
+    {
+        fDeferredPorts.push_back(DeferredPort{&port, false, std::string()});
+        return;
+    }
     fComponentManager.registerPort(port);
 }
 
 void ComponentManager::Config::registerPort(Port& port, const std::string& key) {
     port.setComponentTraceEventGenerator(
             port.getComponent().getComponentTraceEventGenerator());
+    if (fDeferRegistration)
+    {
+        fDeferredPorts.push_back(DeferredPort{&port, true, key});
+        return;
+    }
     fComponentManager.registerPort(port, key);
 }
 
+void
+ComponentManager::Config::applyRegistrations()
+{
+    for (const auto& deferred : fDeferredPorts)
+    {
+        if (deferred.mapped)
+        {
+            fComponentManager.registerPort(*deferred.port, deferred.topic);
+        }
+        else
+        {
+            fComponentManager.registerPort(*deferred.port);
+        }
+    }
+    fDeferredPorts.clear();
+}
+
 }  // namespace mcf
\ No newline at end of file
@@ -5,13 +5,40 @@
 #include "mcf_core/ComponentTraceController.h"
 
 
+#include "mcf_core/ErrorMacros.h"
 #include "mcf_core/LoggingMacros.h"
 #include "mcf_core/Messages.h"
 #include "mcf_core/Port.h"
+#include "mcf_core/TracePolicy.h"
 #include "mcf_core/ValueStore.h"
 
 namespace mcf {
 
+namespace {
+
+template<typename T>
+void fillTraceEvent(const TraceRecord& record, T& event)
+{
+    const TraceStringTable& strings = TraceStringTable::instance();
+    event.traceId = strings.lookup(record.traceId);
+    event.time = record.time;
+    event.componentName = strings.lookup(record.component);
+    event.threadId = record.threadId;
+    event.cpuId = record.cpuId;
+}
+
+template<typename T>
+void fillPortEvent(const TraceRecord& record, T& event)
+{
+    fillTraceEvent(record, event);
+    event.portDescriptor.name = "unnamed";
+    event.portDescriptor.topic = TraceStringTable::instance().lookup(record.topic);
+    event.portDescriptor.connected = record.connected != 0;
+    event.valueId = record.valueId;
+}
+
+} // anonymous namespace
+
 /**
  * Thread-local component trace event generator
  */
@@ -24,7 +51,174 @@ ComponentTraceController::ComponentTraceController(std::string traceId,
 , fValueStore(valueStore)
 , fTopic(std::move(topic))
 , fIsTraceEnabled(false)
+, fValueStoreOutput(true)
+, fSinkId(TraceCollector::instance().addSink(*this))
+{
+}
+
+ComponentTraceController::~ComponentTraceController()
+{
+    enableTrace(false);
+    TraceCollector::instance().removeSink(fSinkId);
+}
+
+void ComponentTraceController::setTraceFilter(std::vector<TraceFilterRule> rules)
+{
+    MCF_ASSERT(rules.size() <= TraceSelection::MAX_RULES, "Too many trace filter rules");
+    std::lock_guard<std::mutex> lk(fFilterMutex);
+    fFilterRules = std::move(rules);
+    fFilterGeneration.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<TraceFilterRule> ComponentTraceController::getTraceFilter() const
+{
+    std::lock_guard<std::mutex> lk(fFilterMutex);
+    return fFilterRules;
+}
+
+std::shared_ptr<TraceSelection> ComponentTraceController::createTraceSelection(const std::string& component) const
+{
+    std::lock_guard<std::mutex> lk(fFilterMutex);
+    return std::make_shared<TraceSelection>(fFilterRules, component);
+}
+
+void ComponentTraceController::flush()
+{
+    TraceCollector::instance().flush();
+}
+
+void ComponentTraceController::addTraceSink(std::shared_ptr<ITraceSink> sink)
+{
+    std::lock_guard<std::mutex> lk(fTraceSinksMutex);
+    fTraceSinks.push_back(std::move(sink));
+}
+
+void ComponentTraceController::enableValueStoreOutput(bool onOff)
+{
+    fValueStoreOutput = onOff;
+}
+
+void ComponentTraceController::consume(const TraceRecord* records, size_t count)
+{
+    {
+        std::lock_guard<std::mutex> lk(fTraceSinksMutex);
+        for (const auto& sink : fTraceSinks)
+        {
+            sink->consume(records, count);
+        }
+    }
+    if (!fValueStoreOutput)
+    {
+        fPendingInputIds.clear();
+        return;
+    }
+
+    const TraceStringTable& strings = TraceStringTable::instance();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const TraceRecord& record = records[i];
+        switch (record.type)
+        {
+            case TraceEventType::INPUT_IDS:
+            {
+                fPendingInputIds.insert(fPendingInputIds.end(), record.inputIds, record.inputIds + record.numInputIds);
+                continue;
+            }
+            case TraceEventType::PORT_WRITE:
+            {
+                msg::ComponentTracePortWrite event;
+                fillPortEvent(record, event);
+                event.inputValueIds.assign(record.inputIds, record.inputIds + record.numInputIds);
+                event.inputValueIds.insert(event.inputValueIds.end(), fPendingInputIds.begin(), fPendingInputIds.end());
+                fValueStore.setValue(fTopic, std::move(event));
+                break;
+            }
+            case TraceEventType::PORT_PEEK:
+            {
+                msg::ComponentTracePortPeek event;
+                fillPortEvent(record, event);
+                fValueStore.setValue(fTopic, std::move(event));
+                break;
+            }
+            case TraceEventType::PORT_READ:
+            {
+                msg::ComponentTracePortRead event;
+                fillPortEvent(record, event);
+                fValueStore.setValue(fTopic, std::move(event));
+                break;
+            }
+            case TraceEventType::EXEC_TIME:
+            {
+                msg::ComponentTraceExecTime event;
+                fillTraceEvent(record, event);
+                event.description = strings.lookup(record.name);
+                event.executionTime = record.executionTime;
+                fValueStore.setValue(fTopic, std::move(event));
+                break;
+            }
+            case TraceEventType::REMOTE_TRANSFER_TIME:
+            {
+                msg::ComponentTraceRemoteTransferTime event;
+                fillTraceEvent(record, event);
+                event.description = strings.lookup(record.name);
+                event.executionTime = record.executionTime;
+                fValueStore.setValue(fTopic, std::move(event));
+                break;
+            }
+            case TraceEventType::TRIGGER_ACTIVATION:
+            {
+                msg::ComponentTracePortTriggerActivation event;
+                fillTraceEvent(record, event);
+                event.triggerDescriptor.topic = strings.lookup(record.topic);
+                event.triggerDescriptor.time = record.triggerTime;
+                fValueStore.setValue(fTopic, std::move(event));
+                break;
+            }
+            case TraceEventType::TRIGGER_EXEC:
+            {
+                msg::ComponentTracePortTriggerExec event;
+                fillTraceEvent(record, event);
+                event.triggerDescriptor.topic = strings.lookup(record.topic);
+                event.triggerDescriptor.time = record.triggerTime;
+                event.handlerName = strings.lookup(record.name);
+                event.executionTime = record.executionTime;
+                fValueStore.setValue(fTopic, std::move(event));
+                break;
+            }
+            case TraceEventType::PROGRAM_FLOW:
+            {
+                msg::ComponentTraceProgramFlowEvent event;
+                fillTraceEvent(record, event);
+                event.eventName = strings.lookup(record.name);
+                event.inputValueIds.assign(record.inputIds, record.inputIds + record.numInputIds);
+                event.inputValueIds.insert(event.inputValueIds.end(), fPendingInputIds.begin(), fPendingInputIds.end());
+                fValueStore.setValue(fTopic, std::move(event));
+                break;
+            }
+            case TraceEventType::PERF_COUNTERS:
+            {
+                msg::ComponentTracePerfCounters event;
+                fillTraceEvent(record, event);
+                event.handlerName = strings.lookup(record.name);
+                event.cycles = record.inputIds[0];
+                event.instructions = record.inputIds[1];
+                event.cacheMisses = record.inputIds[2];
+                event.branchMisses = record.inputIds[3];
+                event.contextSwitches = record.valueId;
+                fValueStore.setValue(fTopic, std::move(event));
+                break;
+            }
+        }
+        fPendingInputIds.clear();
+    }
+}
+
+void ComponentTraceController::enableTrace(bool onOff)
 {
+    if (fIsTraceEnabled.exchange(onOff) != onOff)
+    {
+        gActiveTraceControllers.fetch_add(onOff ? 1 : -1, std::memory_order_relaxed);
+    }
 }
 
 std::unique_ptr<ComponentTraceEventGenerator> ComponentTraceController::createEventGenerator(
@@ -7,92 +7,75 @@
 #include "mcf_core/ComponentTraceController.h"
 #include "mcf_core/LoggingMacros.h"
 #include "mcf_core/Messages.h"
+#include "mcf_core/PerfCounters.h"
 #include "mcf_core/Port.h"
+#include "mcf_core/TraceClock.h"
+#include "mcf_core/TraceCollector.h"
+#include "mcf_core/TraceFilter.h"
 #include "mcf_core/ValueStore.h"
-#include <unistd.h>
-#include <sys/syscall.h>
+#include <algorithm>
 
 namespace mcf {
 
 namespace {
 
-template<typename T>
-inline void fillCpuId(T& event)
+inline uint64_t toMicroseconds(const std::chrono::high_resolution_clock::time_point& time)
 {
-    #ifdef SYS_getcpu
-    int cpuId  = 0;
-    int status = syscall(SYS_getcpu, &cpuId, NULL, NULL);
-    if (status != -1)
-    {
-        event.cpuId = cpuId;
-    }
-    #endif
+    return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
 }
 
+inline float toSeconds(const std::chrono::high_resolution_clock::duration& duration)
+{
+    return (std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()) * 1.e-9f;
+}
 
-inline void fillPortWriteEvent(const std::string& traceId,
-                               const std::string& compName,
-                               const std::string& topic,
-                               const std::vector<uint64_t>& inputIds,
-                               bool isConnected,
-                               const Value* vp,
-                               msg::ComponentTracePortWrite& outEvent)
+inline TraceRecord makeRecord(TraceEventType type, uint32_t sink, uint32_t traceId, uint32_t component)
 {
-    auto time = std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-
-    msg::PortDescriptor portDesc;
-    portDesc.name = "unnamed";
-    portDesc.topic = topic;
-    portDesc.connected = isConnected;
-
-    outEvent.traceId = traceId;
-    outEvent.time = time;
-    outEvent.componentName = compName;
-    outEvent.portDescriptor = portDesc;
-    outEvent.threadId = syscall(SYS_gettid);
-    fillCpuId(outEvent);
-    if (vp != nullptr)
-    {
-        outEvent.valueId = vp->id();
-        outEvent.inputValueIds = inputIds;
-    }
-    else
-    {
-        outEvent.valueId = 0UL;
-    }
+    TraceRecord record{};
+    record.type = type;
+    record.sink = sink;
+    record.traceId = traceId;
+    record.component = component;
+    TraceClock::stampThread(record);
+    return record;
 }
 
-template<typename EventValueType>
-inline void fillPortReadEvent(const std::string& traceId,
-                              const std::string& compName,
-                              const std::string& topic,
-                              bool isConnected,
-                              const Value* vp,
-                              EventValueType& outEvent)
+inline void fillPortEvent(TraceRecord& record, const std::string& topic, bool isConnected, const Value* vp)
 {
-    auto time = std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-
-    msg::PortDescriptor portDesc;
-    portDesc.name = "unnamed";
-    portDesc.topic = topic;
-    portDesc.connected = isConnected;
-
-    outEvent.traceId = traceId;
-    outEvent.time = time;
-    outEvent.componentName = compName;
-    outEvent.portDescriptor = portDesc;
-    outEvent.threadId = syscall(SYS_gettid);
-    fillCpuId(outEvent);
-    if (vp != nullptr)
+    TraceClock::stamp(record);
+    record.topic = TraceStringTable::instance().intern(topic);
+    record.connected = isConnected;
+    record.valueId = vp != nullptr ? vp->id() : 0UL;
+}
+
+/*
+ * Write a record with its input value ids. Ids beyond the ones of the record go to preceding
+ * INPUT_IDS records, written together with the record.
+ */
+void writeRecord(TraceRecord& record, const std::vector<uint64_t>& inputIds)
+{
+    const size_t maxIds = TraceRecord::MAX_INPUT_IDS;
+    record.numInputIds = static_cast<uint8_t>(std::min(inputIds.size(), maxIds));
+    std::copy(inputIds.begin(), inputIds.begin() + record.numInputIds, record.inputIds);
+    if (inputIds.size() <= maxIds)
     {
-        outEvent.valueId = vp->id();
+        TraceCollector::instance().write(&record, 1);
+        return;
     }
-    else
+
+    std::vector<TraceRecord> records;
+    records.reserve((inputIds.size() - 1) / maxIds + 1);
+    for (size_t first = maxIds; first < inputIds.size(); first += maxIds)
     {
-        outEvent.valueId = 0UL;
+        TraceRecord ids{};
+        ids.type = TraceEventType::INPUT_IDS;
+        ids.sink = record.sink;
+        ids.numInputIds = static_cast<uint8_t>(std::min(inputIds.size() - first, maxIds));
+        std::copy(inputIds.begin() + first, inputIds.begin() + first + ids.numInputIds, ids.inputIds);
+        records.push_back(ids);
     }
+    records.push_back(record);
+    TraceCollector::instance().write(records.data(), records.size());
 }
 
 }
@@ -104,38 +87,35 @@ ComponentTraceEventGenerator::ComponentTraceEventGenerator(
         std::string traceId,
         std::string name,
         const ComponentTraceController& traceController,
-        ValueStore& valueStore,
+        ValueStore& /*valueStore*/,
         std::string topic)
 : fTraceController(traceController)
-, fValueStore(valueStore)
+, fSelectionGeneration(0)
 , fTopic(std::move(topic))
 , fTraceId(std::move(traceId))
 , fName(std::move(name))
+, fSink(traceController.getSinkId())
+, fTraceIdString(TraceStringTable::instance().intern(fTraceId))
+, fNameString(TraceStringTable::instance().intern(fName))
 , fIsEnabled(true)
 {
 }
 
-template <typename T>
-void ComponentTraceEventGenerator::writeTraceEvent(T&& event) const
-{
-    fValueStore.setValue(fTopic, std::forward<T>(event));
-}
-
 void ComponentTraceEventGenerator::traceSetPortValue(
         const std::string& topic, 
         bool isConnected, 
         const std::vector<uint64_t>& inputIds, 
         const Value* value) const
 {
-    // do nothing if event logging disabled
-    if (!isGloballyEnabled() || !isEnabled())
+    // do nothing if event logging disabled or the event is filtered
+    if (!isGloballyEnabled() || !isEnabled() || !isSelected(TraceEventType::PORT_WRITE, &topic))
     {
         return;
     }
 
-    msg::ComponentTracePortWrite event;
-    fillPortWriteEvent(fTraceId, fName, topic, inputIds, isConnected, value, event);
-    writeTraceEvent(std::move(event));
+    TraceRecord record = makeRecord(TraceEventType::PORT_WRITE, fSink, fTraceIdString, fNameString);
+    fillPortEvent(record, topic, isConnected, value);
+    writeRecord(record, value != nullptr ? inputIds : std::vector<uint64_t>());
 }
 
 void ComponentTraceEventGenerator::traceSetQueuedEventValue(
@@ -146,66 +126,62 @@ void ComponentTraceEventGenerator::traceSetQueuedEventValue(
         const std::string& component, 
         const std::string& port) const
 {
-    // do nothing if event logging disabled
-    if (!isGloballyEnabled() || !isEnabled())
+    // do nothing if event logging disabled or the event is filtered
+    if (!isGloballyEnabled() || !isEnabled() || !isSelected(TraceEventType::PORT_WRITE, &topic))
     {
         return;
     }
     
-    const std::string& componentName = component.empty() ? fName : component;
+    const uint32_t componentName = component.empty() ? fNameString : TraceStringTable::instance().intern(component);
 
-    msg::ComponentTracePortWrite event;
-    fillPortWriteEvent(fTraceId, componentName, topic, inputIds, isConnected, value, event);
-    writeTraceEvent(std::move(event));
+    TraceRecord record = makeRecord(TraceEventType::PORT_WRITE, fSink, fTraceIdString, componentName);
+    fillPortEvent(record, topic, isConnected, value);
+    writeRecord(record, value != nullptr ? inputIds : std::vector<uint64_t>());
 }
 
 void ComponentTraceEventGenerator::tracePeekPortValue(
         const std::string& topic, bool isConnected, const Value* value) const
 {
-    // do nothing if event logging disabled
-    if (!isGloballyEnabled() || !isEnabled())
+    // do nothing if event logging disabled or the event is filtered
+    if (!isGloballyEnabled() || !isEnabled() || !isSelected(TraceEventType::PORT_PEEK, &topic))
     {
         return;
     }
-    msg::ComponentTracePortPeek event;
-    fillPortReadEvent(fTraceId, fName, topic, isConnected, value, event);
-    writeTraceEvent(std::move(event));
+    TraceRecord record = makeRecord(TraceEventType::PORT_PEEK, fSink, fTraceIdString, fNameString);
+    fillPortEvent(record, topic, isConnected, value);
+    TraceCollector::instance().write(&record, 1);
 }
 
 void ComponentTraceEventGenerator::traceGetPortValue(
         const std::string& topic, bool isConnected, const Value* value) const
 {
-    // do nothing if event logging disabled
-    if (!isGloballyEnabled() || !isEnabled())
+    // do nothing if event logging disabled or the event is filtered
+    if (!isGloballyEnabled() || !isEnabled() || !isSelected(TraceEventType::PORT_READ, &topic))
     {
         return;
     }
-    msg::ComponentTracePortRead event;
-    fillPortReadEvent(fTraceId, fName, topic, isConnected, value, event);
-    writeTraceEvent(std::move(event));
+    TraceRecord record = makeRecord(TraceEventType::PORT_READ, fSink, fTraceIdString, fNameString);
+    fillPortEvent(record, topic, isConnected, value);
+    TraceCollector::instance().write(&record, 1);
 }
 
 
 void ComponentTraceEventGenerator::traceExecutionTime(
         uint64_t endTime, float duration, const std::string& name) const
 {
-    // do nothing if event logging disabled
-    if (!isGloballyEnabled() || !isEnabled())
+    // do nothing if event logging disabled or the event is filtered
+    if (!isGloballyEnabled() || !isEnabled() || !isSelected(TraceEventType::EXEC_TIME, nullptr))
     {
         return;
     }
 
-    msg::ComponentTraceExecTime event;
-    event.traceId = fTraceId;
-    event.time = endTime;
-    event.componentName = fName;
-    event.executionTime = duration;
-    event.description = name;
-    event.threadId = syscall(SYS_gettid);
-    fillCpuId(event);
+    TraceRecord record = makeRecord(TraceEventType::EXEC_TIME, fSink, fTraceIdString, fNameString);
+    record.time = endTime;
+    record.executionTime = duration;
+    record.name = TraceStringTable::instance().intern(name);
 
     // TODO: log ID of value
-    writeTraceEvent(std::move(event));
+    TraceCollector::instance().write(&record, 1);
 }
 
 void ComponentTraceEventGenerator::traceExecutionTime(
@@ -213,22 +189,18 @@ void ComponentTraceEventGenerator::traceExecutionTime(
         const std::chrono::high_resolution_clock::time_point& end,
         const std::string& name = "") const
 {
-    // do nothing if event logging disabled
-    if (!isGloballyEnabled() || !isEnabled())
+    // do nothing if event logging disabled or the event is filtered
+    if (!isGloballyEnabled() || !isEnabled() || !isSelected(TraceEventType::EXEC_TIME, nullptr))
     {
         return;
     }
 
-    msg::ComponentTraceExecTime event;
-    event.traceId = fTraceId;
-    event.time = std::chrono::duration_cast<std::chrono::microseconds>(end.time_since_epoch()).count();
-    event.componentName = fName;
-    event.executionTime = (std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) * 1.e-9f;
-    event.description = name;
-    event.threadId = syscall(SYS_gettid);
-    fillCpuId(event);
+    TraceRecord record = makeRecord(TraceEventType::EXEC_TIME, fSink, fTraceIdString, fNameString);
+    record.time = toMicroseconds(end);
+    record.executionTime = toSeconds(end - start);
+    record.name = TraceStringTable::instance().intern(name);
 
-    writeTraceEvent(std::move(event));
+    TraceCollector::instance().write(&record, 1);
 }
 
 void ComponentTraceEventGenerator::traceRemoteTransferTime(
@@ -236,47 +208,36 @@ void ComponentTraceEventGenerator::traceRemoteTransferTime(
         const std::chrono::high_resolution_clock::time_point& end,
         const std::string& name = "") const
 {
-    // do nothing if event logging disabled
-    if (!isGloballyEnabled() || !isEnabled())
+    // do nothing if event logging disabled or the event is filtered
+    if (!isGloballyEnabled() || !isEnabled() || !isSelected(TraceEventType::REMOTE_TRANSFER_TIME, nullptr))
     {
         return;
     }
 
-    msg::ComponentTraceRemoteTransferTime event;
-    event.traceId = fTraceId;
-    event.time = std::chrono::duration_cast<std::chrono::microseconds>(end.time_since_epoch()).count();
-    event.componentName = fName;
-    event.executionTime = (std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) * 1.e-9f;
-    event.description = name;
-    event.threadId = syscall(SYS_gettid);
-    fillCpuId(event);
-    
-    writeTraceEvent(std::move(event));
+    TraceRecord record = makeRecord(TraceEventType::REMOTE_TRANSFER_TIME, fSink, fTraceIdString, fNameString);
+    record.time = toMicroseconds(end);
+    record.executionTime = toSeconds(end - start);
+    record.name = TraceStringTable::instance().intern(name);
+
+    TraceCollector::instance().write(&record, 1);
 }
 
 void ComponentTraceEventGenerator::tracePortTriggerActivation(
         const std::chrono::high_resolution_clock::time_point &time,
         const std::string &topic) const
 {
-    // do nothing if event logging disabled
-    if (!isGloballyEnabled() || !isEnabled())
+    // do nothing if event logging disabled or the event is filtered
+    if (!isGloballyEnabled() || !isEnabled() || !isSelected(TraceEventType::TRIGGER_ACTIVATION, &topic))
     {
         return;
     }
 
-    msg::TriggerDescriptor triggerDesc;
-    triggerDesc.topic = topic;
-    triggerDesc.time = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    TraceRecord record = makeRecord(TraceEventType::TRIGGER_ACTIVATION, fSink, fTraceIdString, fNameString);
+    record.time = toMicroseconds(time);
+    record.triggerTime = record.time;
+    record.topic = TraceStringTable::instance().intern(topic);
 
-    msg::ComponentTracePortTriggerActivation event;
-    event.traceId = fTraceId;
-    event.time = triggerDesc.time;
-    event.componentName = fName;
-    event.triggerDescriptor = triggerDesc;
-    event.threadId = syscall(SYS_gettid);
-    fillCpuId(event);
-
-    writeTraceEvent(std::move(event));
+    TraceCollector::instance().write(&record, 1);
 }
 
 void ComponentTraceEventGenerator::tracePortTriggerExec(const std::chrono::high_resolution_clock::time_point& start,
@@ -289,50 +250,106 @@ void ComponentTraceEventGenerator::tracePortTriggerExec(const std::chrono::high_
         return;
     }
 
-    msg::TriggerDescriptor triggerDesc;
     std::chrono::high_resolution_clock::time_point time;
-    triggerHandler.getEventFlag()->getLastTrigger(&time, &triggerDesc.topic);
-    triggerDesc.time = std::chrono::duration_cast<std::chrono::microseconds>(
-            time.time_since_epoch()).count();
-
-    msg::ComponentTracePortTriggerExec event;
-    event.traceId = fTraceId;
-    event.time = std::chrono::duration_cast<std::chrono::microseconds>(end.time_since_epoch()).count();
-    event.componentName = fName;
-    event.executionTime = (std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) * 1.e-9f;
-    event.handlerName = triggerHandler.getName();
-    event.triggerDescriptor = triggerDesc;
-    event.threadId = syscall(SYS_gettid);
-    fillCpuId(event);
-
-    writeTraceEvent(std::move(event));
+    std::string triggerTopic;
+    triggerHandler.getEventFlag()->getLastTrigger(&time, &triggerTopic);
+    if (!isSelected(TraceEventType::TRIGGER_EXEC, &triggerTopic))
+    {
+        return;
+    }
+
+    TraceRecord record = makeRecord(TraceEventType::TRIGGER_EXEC, fSink, fTraceIdString, fNameString);
+    record.time = toMicroseconds(end);
+    record.executionTime = toSeconds(end - start);
+    record.name = TraceStringTable::instance().intern(triggerHandler.getName());
+    record.topic = TraceStringTable::instance().intern(triggerTopic);
+    record.triggerTime = toMicroseconds(time);
+
+    TraceCollector::instance().write(&record, 1);
+}
+
+
+void ComponentTraceEventGenerator::tracePerfCounters(const std::chrono::high_resolution_clock::time_point& end,
+                                                     const std::string& handlerName,
+                                                     const PerfCounterValues& counts) const
+{
+    // do nothing if event logging disabled or the event is filtered
+    if (!isGloballyEnabled() || !isEnabled() || !isSelected(TraceEventType::PERF_COUNTERS, nullptr))
+    {
+        return;
+    }
+
+    TraceRecord record = makeRecord(TraceEventType::PERF_COUNTERS, fSink, fTraceIdString, fNameString);
+    record.time = toMicroseconds(end);
+    record.name = TraceStringTable::instance().intern(handlerName);
+    record.inputIds[0] = counts.cycles;
+    record.inputIds[1] = counts.instructions;
+    record.inputIds[2] = counts.cacheMisses;
+    record.inputIds[3] = counts.branchMisses;
+    record.valueId = counts.contextSwitches;
+
+    TraceCollector::instance().write(&record, 1);
 }
 
 
 void ComponentTraceEventGenerator::traceProgramFlowEvent(const std::string& eventName,
                                                          const std::vector<uint64_t>& inputValueIds) const
 {
-    // do nothing if event logging disabled
-    if (!isGloballyEnabled() || !isEnabled())
+    // do nothing if event logging disabled or the event is filtered
+    if (!isGloballyEnabled() || !isEnabled() || !isSelected(TraceEventType::PROGRAM_FLOW, nullptr))
     {
         return;
     }
 
-    auto time = std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    TraceRecord record = makeRecord(TraceEventType::PROGRAM_FLOW, fSink, fTraceIdString, fNameString);
+    TraceClock::stamp(record);
+    record.name = TraceStringTable::instance().intern(eventName);
+
+    writeRecord(record, inputValueIds);
+}
 
-    msg::ComponentTraceProgramFlowEvent event;
-    event.traceId = fTraceId;
-    event.time = time;
-    event.componentName = fName;
-    event.eventName = eventName;
-    event.inputValueIds = inputValueIds;
-    event.threadId = syscall(SYS_gettid);
-    fillCpuId(event);
 
-    writeTraceEvent(std::move(event));
+/*
+ * Check if the trace filter selects an event, applying changed filters to the component first
+ */
+bool ComponentTraceEventGenerator::isSelected(TraceEventType type, const std::string* topic) const
+{
+    const std::shared_ptr<TraceSelection> selection = currentSelection();
+    return selection == nullptr || selection->select(type, topic);
+}
+
+bool ComponentTraceEventGenerator::isTracingPortWrites(const std::string& topic) const
+{
+    if (!isGloballyEnabled() || !isEnabled())
+    {
+        return false;
+    }
+    const std::shared_ptr<TraceSelection> selection = currentSelection();
+    return selection == nullptr || selection->matches(TraceEventType::PORT_WRITE, &topic);
 }
 
+std::shared_ptr<TraceSelection> ComponentTraceEventGenerator::currentSelection() const
+{
+    const uint64_t generation = fTraceController.getTraceFilterGeneration();
+    if (generation == 0)
+    {
+        // no filter set
+        return nullptr;
+    }
+    std::shared_ptr<TraceSelection> selection;
+    if (fSelectionGeneration.load(std::memory_order_acquire) == generation)
+    {
+        selection = std::atomic_load(&fSelection);
+    }
+    else
+    {
+        // concurrent events may create the selection twice, one of them is kept
+        selection = fTraceController.createTraceSelection(fName);
+        std::atomic_store(&fSelection, selection);
+        fSelectionGeneration.store(generation, std::memory_order_release);
+    }
+    return selection;
+}
 
 /*
  * Check if trace event generation is globally enabled
@@ -2,6 +2,7 @@
  * Copyright (c) 2024 Accenture
  */
 
+#include <atomic>
 #include <memory>
 
 namespace mcf {
@@ -13,4 +14,9 @@ class ComponentTraceEventGenerator;
  */
 thread_local std::shared_ptr<ComponentTraceEventGenerator> gComponentTraceEventGenerator(nullptr);
 
+/**
+ * Number of component trace controllers with tracing enabled, see TracePolicy
+ */
+std::atomic<int> gActiveTraceControllers(0);
+
 } // namespace mcf
@@ -0,0 +1,569 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/CtfTraceWriter.h"
+#include "mcf_core/ErrorMacros.h"
+
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace mcf {
+
+namespace {
+
+// kept identical to mcf_tools/component_tracing/ctf_metadata.py
+const char* const CTF_METADATA = R"CTF(/* CTF 1.8 */
+
+/*
+ * This file contains the metadata that will become part of an MCF trace
+ * after conversion to Common Trace Format.
+ *
+ * It describes the storage format of the corresponding stream file(s).
+ */
+ 
+typealias integer { size = 32; align = 8; signed = true; } := int32_t;
+
+typealias integer { size = 8; align = 8; signed = false; } := uint8_t;
+typealias integer { size = 16; align = 8; signed = false; } := uint16_t;
+typealias integer { size = 32; align = 8; signed = false; } := uint32_t;
+typealias integer { size = 64; align = 8; signed = false; } := uint64_t;
+
+typealias floating_point {
+    exp_dig = 8;         /* sizeof(float) * CHAR_BIT - FLT_MANT_DIG */
+    mant_dig = 24;       /* FLT_MANT_DIG */
+    align = 8;
+} := float;
+
+clock {
+    name = my_clock;
+    freq = 1000000;
+};
+
+typealias integer {
+    size = 64;
+    map = clock.my_clock.value;
+    align = 8;
+} := tstamp_us_t;
+
+struct port_desc {
+    string name;
+    string topic;
+    uint8_t connected;
+} align(8);
+
+struct trigger_desc {
+    string topic;
+    tstamp_us_t trigger_time;
+} align(8);
+
+
+trace {
+    major = 1;
+    minor = 8;
+    byte_order = le;
+    packet.header := struct {
+        uint32_t magic;
+        uint32_t stream_id;
+    };
+};
+
+stream {
+    id = 0;
+    packet.context := struct {
+        tstamp_us_t timestamp_begin;
+        tstamp_us_t timestamp_end;
+    };
+    event.header := struct {
+        uint16_t id;
+        tstamp_us_t timestamp;
+    };
+};
+
+event {
+    id = 10;
+    name = "port_write";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        struct port_desc port;
+        uint64_t value_id;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+event {
+    id = 20;
+    name = "port_read";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        struct port_desc port;
+        uint64_t value_id;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+event {
+    id = 25;
+    name = "port_peek";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        struct port_desc port;
+        uint64_t value_id;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+event {
+    id = 30;
+    name = "exec_start";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        string description;
+        float exec_time;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+event {
+    id = 35;
+    name = "exec_end";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        string description;
+        float exec_time;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+event {
+    id = 40;
+    name = "port_trigger_act";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        struct trigger_desc trigger;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+event {
+    id = 50;
+    name = "port_handler_start";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        struct trigger_desc trigger;
+        float exec_time;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+event {
+    id = 55;
+    name = "port_handler_end";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        struct trigger_desc trigger;
+        float exec_time;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+
+event {
+    id = 60;
+    name = "remote_transfer_start";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        string description;
+        float exec_time;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+event {
+    id = 65;
+    name = "remote_transfer_end";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        string description;
+        float exec_time;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+event {
+    id = 70;
+    name = "time_box_start";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string box_name;
+        uint32_t box_id;
+        
+        /* 
+         * completion_status: Should take the value of ['SAFE', 'TIME_VIOLATION' OR 'LOST']
+         * completion_status_id: is the index of the completion_status value in the above list 
+         */
+        uint32_t completion_status_id;
+        string completion_status;
+    };
+};
+
+
+event {
+    id = 75;
+    name = "time_box_end";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string box_name;
+        uint32_t box_id;
+        
+        /* 
+         * completion_status: Should take the value of ['SAFE', 'TIME_VIOLATION' OR 'LOST']
+         * completion_status_id: is the index of the completion_status value in the above list 
+         */
+        uint32_t completion_status_id;
+        string completion_status;
+    };
+};
+
+event {
+    id = 80;
+    name = "program_flow";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        string eventName;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+event {
+    id = 85;
+    name = "perf_counters";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        string handler;
+        uint64_t cycles;
+        uint64_t instructions;
+        uint64_t cache_misses;
+        uint64_t branch_misses;
+        uint64_t context_switches;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
+)CTF";
+
+const char CTF_MAGIC[] = {'\xc1', '\x1f', '\xfc', '\xc1'};
+
+// offset of the packet context in the stream file, behind magic and stream id
+constexpr std::streamoff PACKET_CONTEXT_OFFSET = 8;
+
+// event ids of ctf_metadata.py
+constexpr uint16_t PORT_WRITE = 10;
+constexpr uint16_t PORT_READ = 20;
+constexpr uint16_t PORT_PEEK = 25;
+constexpr uint16_t EXEC_START = 30;
+constexpr uint16_t EXEC_END = 35;
+constexpr uint16_t PORT_TRIGGER_ACT = 40;
+constexpr uint16_t PORT_HANDLER_START = 50;
+constexpr uint16_t PORT_HANDLER_END = 55;
+constexpr uint16_t REMOTE_TRANSFER_START = 60;
+constexpr uint16_t REMOTE_TRANSFER_END = 65;
+constexpr uint16_t PROGRAM_FLOW = 80;
+constexpr uint16_t PERF_COUNTERS = 85;
+
+// the fields are packed little endian, as the trace is declared with byte_order = le
+template<typename T>
+void append(std::string& data, T value)
+{
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "CTF traces are written little endian");
+    data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendString(std::string& data, const std::string& string)
+{
+    data.append(string.c_str(), string.size() + 1);
+}
+
+// start time of a duration event, rounded as by trace_2_ctf.py
+uint64_t startTime(const TraceRecord& record)
+{
+    return static_cast<uint64_t>(std::llround(record.time - record.executionTime * 1.e6));
+}
+
+} // anonymous namespace
+
+CtfTraceWriter::CtfTraceWriter(const std::string& directory,
+                               const std::string& channel,
+                               std::chrono::microseconds reorderWindow)
+: fReorderWindow(reorderWindow.count())
+{
+    if (mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST)
+    {
+        MCF_THROW_RUNTIME("Cannot create trace directory " + directory + ": " + strerror(errno));
+    }
+    std::ofstream metadataFile(directory + "/metadata", std::ios::out | std::ios::trunc);
+    metadataFile << CTF_METADATA;
+    metadataFile.close();
+    MCF_ASSERT(!metadataFile.fail(), "Cannot write CTF metadata to " + directory);
+
+    fStream.open(directory + "/" + channel, std::ios::out | std::ios::binary | std::ios::trunc);
+    MCF_ASSERT(fStream.is_open(), "Cannot open CTF stream " + directory + "/" + channel);
+
+    // packet header and context, the context is completed by close()
+    std::string header(CTF_MAGIC, sizeof(CTF_MAGIC));
+    append<uint32_t>(header, 0);
+    append<uint64_t>(header, 0);
+    append<uint64_t>(header, 0);
+    fStream.write(header.data(), header.size());
+}
+
+CtfTraceWriter::~CtfTraceWriter()
+{
+    close();
+}
+
+void CtfTraceWriter::consume(const TraceRecord* records, size_t count)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    if (fClosed)
+    {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        const TraceRecord& record = records[i];
+        switch (record.type)
+        {
+            case TraceEventType::PORT_WRITE:
+                addPortEvent(PORT_WRITE, record);
+                break;
+            case TraceEventType::PORT_READ:
+                addPortEvent(PORT_READ, record);
+                break;
+            case TraceEventType::PORT_PEEK:
+                addPortEvent(PORT_PEEK, record);
+                break;
+            case TraceEventType::EXEC_TIME:
+                addEvent(EXEC_START, startTime(record), record, false, true);
+                addEvent(EXEC_END, record.time, record, false, true);
+                break;
+            case TraceEventType::REMOTE_TRANSFER_TIME:
+                addEvent(REMOTE_TRANSFER_START, startTime(record), record, false, true);
+                addEvent(REMOTE_TRANSFER_END, record.time, record, false, true);
+                break;
+            case TraceEventType::TRIGGER_ACTIVATION:
+                addEvent(PORT_TRIGGER_ACT, record.time, record, true, false);
+                break;
+            case TraceEventType::TRIGGER_EXEC:
+                addEvent(PORT_HANDLER_START, startTime(record), record, true, true);
+                addEvent(PORT_HANDLER_END, record.time, record, true, true);
+                break;
+            case TraceEventType::PROGRAM_FLOW:
+                addEvent(PROGRAM_FLOW, record.time, record, false, false);
+                break;
+            case TraceEventType::PERF_COUNTERS:
+                addPerfCountersEvent(record);
+                break;
+            case TraceEventType::INPUT_IDS:
+                // not part of the CTF events
+                break;
+        }
+        fLatestTime = std::max(fLatestTime, record.time);
+    }
+    writeEvents(fLatestTime > fReorderWindow ? fLatestTime - fReorderWindow : 0);
+}
+
+void CtfTraceWriter::close()
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    if (fClosed)
+    {
+        return;
+    }
+    fClosed = true;
+    writeEvents(std::numeric_limits<uint64_t>::max());
+    std::string context;
+    append<uint64_t>(context, fFirstWrittenTime);
+    append<uint64_t>(context, fLastWrittenTime);
+    fStream.seekp(PACKET_CONTEXT_OFFSET);
+    fStream.write(context.data(), context.size());
+    fStream.close();
+}
+
+uint64_t CtfTraceWriter::eventsWritten() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return fEventsWritten;
+}
+
+uint64_t CtfTraceWriter::lateEvents() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return fLateEvents;
+}
+
+const char* CtfTraceWriter::metadata()
+{
+    return CTF_METADATA;
+}
+
+void CtfTraceWriter::addEvent(uint16_t id, uint64_t time, const TraceRecord& record, bool withTrigger,
+                              bool withDuration)
+{
+    PendingEvent event{time, fNextSequence++, std::string()};
+    std::string& data = event.data;
+    append(data, id);
+    append(data, time);
+    appendString(data, plain(record.traceId));
+    appendString(data, qualified(record.traceId, record.component));
+    if (withTrigger)
+    {
+        appendString(data, qualified(record.traceId, record.topic));
+        append(data, record.triggerTime);
+    }
+    else if (id == PROGRAM_FLOW)
+    {
+        appendString(data, qualified(record.traceId, record.name));
+    }
+    else
+    {
+        appendString(data, plain(record.name));
+    }
+    if (withDuration)
+    {
+        append(data, record.executionTime);
+    }
+    append(data, record.threadId);
+    append(data, record.cpuId);
+    fPending.push(std::move(event));
+}
+
+void CtfTraceWriter::addPortEvent(uint16_t id, const TraceRecord& record)
+{
+    static const uint32_t unnamed = TraceStringTable::instance().intern("unnamed");
+
+    PendingEvent event{record.time, fNextSequence++, std::string()};
+    std::string& data = event.data;
+    append(data, id);
+    append(data, record.time);
+    appendString(data, plain(record.traceId));
+    appendString(data, qualified(record.traceId, record.component));
+    appendString(data, qualified(record.traceId, unnamed));
+    appendString(data, qualified(record.traceId, record.topic));
+    append(data, record.connected);
+    append(data, record.valueId);
+    append(data, record.threadId);
+    append(data, record.cpuId);
+    fPending.push(std::move(event));
+}
+
+void CtfTraceWriter::addPerfCountersEvent(const TraceRecord& record)
+{
+    PendingEvent event{record.time, fNextSequence++, std::string()};
+    std::string& data = event.data;
+    append(data, PERF_COUNTERS);
+    append(data, record.time);
+    appendString(data, plain(record.traceId));
+    appendString(data, qualified(record.traceId, record.component));
+    appendString(data, plain(record.name));
+    for (uint64_t count : record.inputIds)
+    {
+        append(data, count);
+    }
+    append(data, record.valueId);
+    append(data, record.threadId);
+    append(data, record.cpuId);
+    fPending.push(std::move(event));
+}
+
+void CtfTraceWriter::writeEvents(uint64_t maxTime)
+{
+    while (!fPending.empty() && fPending.top().time <= maxTime)
+    {
+        const std::string& data = fPending.top().data;
+        uint64_t time = fPending.top().time;
+        if (time < fLastWrittenTime)
+        {
+            // arrived after later events were written
+            time = fLastWrittenTime;
+            ++fLateEvents;
+        }
+        if (fEventsWritten == 0)
+        {
+            fFirstWrittenTime = time;
+        }
+        fLastWrittenTime = time;
+        // the event header with the time written
+        constexpr size_t TIME_OFFSET = sizeof(uint16_t);
+        constexpr size_t PAYLOAD_OFFSET = TIME_OFFSET + sizeof(uint64_t);
+        fStream.write(data.data(), TIME_OFFSET);
+        fStream.write(reinterpret_cast<const char*>(&time), sizeof(time));
+        fStream.write(data.data() + PAYLOAD_OFFSET, data.size() - PAYLOAD_OFFSET);
+        ++fEventsWritten;
+        fPending.pop();
+    }
+}
+
+const std::string& CtfTraceWriter::qualified(uint32_t traceId, uint32_t string)
+{
+    const uint64_t key = (static_cast<uint64_t>(traceId) << 32) | string;
+    auto it = fQualifiedStrings.find(key);
+    if (it == fQualifiedStrings.end())
+    {
+        it = fQualifiedStrings.emplace(key, plain(traceId) + ":" + plain(string)).first;
+    }
+    return it->second;
+}
+
+const std::string& CtfTraceWriter::plain(uint32_t string)
+{
+    auto it = fPlainStrings.find(string);
+    if (it == fPlainStrings.end())
+    {
+        it = fPlainStrings.emplace(string, TraceStringTable::instance().lookup(string)).first;
+    }
+    return it->second;
+}
+
+} // namespace mcf
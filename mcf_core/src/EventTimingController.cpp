@@ -3,6 +3,7 @@
  */
 #include "mcf_core/ErrorMacros.h"
 #include "mcf_core/EventTimingController.h"
+#include "mcf_core/LoggingMacros.h"
 #include "mcf_core/ReplayEventController.h"
 #include "mcf_core/ThreadName.h"
 #include "mcf_core/SimpleEventSourceWrapper.h"
@@ -15,10 +16,23 @@
 namespace mcf
 {
 
+namespace
+{
+
+uint64_t logicalEventTime(TimestampType time)
+{
+    return static_cast<uint64_t>(time);
+}
+
+} // anonymous namespace
+
+constexpr std::size_t EventTimingController::NOT_IN_HEAP;
+
 EventTimingController::EventTimingController(float speed, ReplayEventController* replayEventController)
     : fSpeed(speed)
     , fRunTimeElapsed(0)
     , fPauseTimeElapsed(0)
+    , fUserPauseElapsed(0)
     , fNextEventTime(std::chrono::system_clock::from_time_t(0))
     , fReplayEventController(replayEventController) {}
 
@@ -27,6 +41,7 @@ EventTimingController::EventTimingController(std::function<void(const std::strin
     : fSpeed(speed)
     , fRunTimeElapsed(0)
     , fPauseTimeElapsed(0)
+    , fUserPauseElapsed(0)
     , fNextEventTime(std::chrono::system_clock::from_time_t(0))
     , fNextEventCallback(nextEventCallback)
     , fReplayEventController(replayEventController) {}
@@ -49,6 +64,7 @@ void EventTimingController::addEventSource(const std::shared_ptr<IDynamicEventSo
     // save control structure
     std::lock_guard<std::mutex> lock(fFireMutex);
     fEventSources.push_back(newSource);
+    fSourceIndices[eventSource.get()] = fEventSources.size() - 1;
 
     // Check if event source has a new event that should be fired next.
     triggerNewEventPushedImpl(eventSource.get());
@@ -65,10 +81,11 @@ void EventTimingController::removeEventSource(const std::string& eventName)
                                        fEventSources.end(),
                                        isTargetEvent),
                         fEventSources.end());
+    rebuildSourceHeapImpl();
 
     // Signal that the next event needs to be re-checked, in case it belongs to the deleted event source
     fShouldCheckNextEvent = true;
-    fFireCondVar.notify_all();
+    notifyEventProcessingImpl();
 }
 
 EventTimingController::~EventTimingController()
@@ -92,64 +109,188 @@ void EventTimingController::setSpeed(float speed)
     fSpeed = speed;
 }
 
-EventTimingController::EventSourceControl* EventTimingController::findNextEventSource(TimestampType &nextEventSendingTime, std::string &nextEventTopic)
+void EventTimingController::setUnthrottled(bool unthrottled)
 {
     std::lock_guard<std::mutex> lock(fFireMutex);
-    auto nextEventSource = findNextEventSourceImpl(nextEventSendingTime, nextEventTopic);
+    if (unthrottled == fUnthrottled)
+    {
+        return;
+    }
+    if (fIsInitialised)
+    {
+        if (unthrottled)
+        {
+            getTimeImpl(fUnthrottledTime);
+        }
+        else
+        {
+            // continue the simulation time from the last fired event
+            rebaseSimulationTimeImpl(fUnthrottledTime);
+        }
+    }
+    fUnthrottled = unthrottled;
+    notifyEventProcessingImpl();
+}
 
-    return nextEventSource;
+bool EventTimingController::isUnthrottled() const
+{
+    std::lock_guard<std::mutex> lock(fFireMutex);
+    return fUnthrottled;
 }
 
-EventTimingController::EventSourceControl* EventTimingController::findNextEventSourceImpl(TimestampType &nextEventSendingTime, std::string &nextEventTopic)
+float EventTimingController::getAchievedSpeedup() const
 {
-    // Next event to send has earliest timestamp
-    EventTimingController::EventSourceControl* nextEventSource = nullptr;
-    TimestampType earliestEventTime;
-    std::string earliestEventTopic;
+    std::lock_guard<std::mutex> lock(fFireMutex);
+    TimestampType currentSimulationTime;
+    if (!getTimeImpl(currentSimulationTime))
+    {
+        return 0.f;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    auto wallTime = now - fWallStartTime - fUserPauseElapsed;
+    if (fPaused)
+    {
+        wallTime -= now - fUserPauseStartTime;
+    }
+    const auto simulationTime = currentSimulationTime - fPlaybackStartTime;
+    if (wallTime.count() <= 0 || simulationTime.count() <= 0)
+    {
+        return 0.f;
+    }
+    return std::chrono::duration<float>(simulationTime).count() / std::chrono::duration<float>(wallTime).count();
+}
 
-    for (size_t i = 0; i < fEventSources.size(); ++i)
+void EventTimingController::beginStepLatency()
+{
+    std::lock_guard<std::mutex> lock(fFireMutex);
+    // a step requested while the previous one is pending is measured from the first request
+    if (!fStepPending)
     {
-        TimestampType sourceNextEventTime;
-        std::string sourceNextEventTopic;
-        bool sourceHasTime = fEventSources[i].eventSource->getNextEventInfo(sourceNextEventTime, sourceNextEventTopic);
-         
-        // skip event source, if it does not have any events currently
-        if (!sourceHasTime)
+        fStepStartTime = std::chrono::steady_clock::now();
+        fStepPending = true;
+    }
+}
+
+LatencyHistogram::Summary EventTimingController::getStepLatency() const
+{
+    return fStepLatency.summary();
+}
+
+bool EventTimingController::seek(const TimestampType& time, std::chrono::microseconds preRoll)
+{
+    std::vector<EventSourceControl> eventSources;
+    {
+        std::lock_guard<std::mutex> lock(fFireMutex);
+        if (fEnd || fSeeking)
         {
-            continue;
+            return false;
         }
+        // hold back firing until the sources have been repositioned
+        fSeeking = true;
+        fShouldCheckNextEvent = true;
+        notifyEventProcessingImpl();
+        eventSources = fEventSources;
+    }
 
-        // compare with earliest start time found so far, if any
-        if (nextEventSource)
+    // Copy seek time so we can use static_cast.
+    TimestampType seekTime(time);
+    const uint64_t targetTime = static_cast<uint64_t>(seekTime);
+    const uint64_t preRollTime = static_cast<uint64_t>(std::max<int64_t>(preRoll.count(), 0));
+    const TimestampType startTime(targetTime > preRollTime ? targetTime - preRollTime : 0);
+
+    // The sources are repositioned without holding fFireMutex, as they may wait for threads
+    // which push events.
+    bool seeked = false;
+    for (const auto& source : eventSources)
+    {
+        if (source.eventSource->seek(startTime))
         {
-            if (sourceNextEventTime < earliestEventTime)
-            {
-                earliestEventTime = sourceNextEventTime;
-                
-                nextEventSource = &fEventSources[i];
-                earliestEventTopic = sourceNextEventTopic;
-            }
+            seeked = true;
         }
-        // otherwise this is the first start time to remember
         else
         {
-            earliestEventTime = sourceNextEventTime;
+            MCF_WARN_NOFILELINE("Event source {} cannot seek to {} us", source.eventSourceName,
+                                static_cast<uint64_t>(TimestampType(startTime)));
+        }
+    }
 
-            nextEventSource = &fEventSources[i];
-            earliestEventTopic = sourceNextEventTopic;
+    std::lock_guard<std::mutex> lock(fFireMutex);
+    fSeeking = false;
+    if (seeked)
+    {
+        rebuildSourceHeapImpl();
+        fSeekTarget = seekTime;
+        fPreRolling = true;
+        if (fIsInitialised)
+        {
+            rebaseSimulationTimeImpl(startTime);
+        }
+    }
+    fShouldCheckNextEvent = true;
+    notifyEventProcessingImpl();
+    return seeked;
+}
+
+void EventTimingController::rebaseSimulationTimeImpl(const TimestampType& time)
+{
+    const TimestampType currentTime(std::chrono::system_clock::now());
+    fSimulationStartTime = time;
+    fUnthrottledTime = time;
+    fRunTimeElapsed = std::chrono::microseconds(0);
+    fPauseTimeElapsed = std::chrono::microseconds(0);
+    fPreviousRunningStartTime = currentTime;
+    if (fPaused || fWaitForPushEvent)
+    {
+        fPauseStartTime = currentTime;
+    }
+}
+
+EventTimingController::EventSourceControl* EventTimingController::findNextEventSource(TimestampType &nextEventSendingTime, std::string &nextEventTopic)
+{
+    std::lock_guard<std::mutex> lock(fFireMutex);
+    auto nextEventSource = findNextEventSourceImpl(nextEventSendingTime, nextEventTopic);
+
+    return nextEventSource;
+}
+
+EventTimingController::EventSourceControl* EventTimingController::findNextEventSourceImpl(TimestampType &nextEventSendingTime, std::string &nextEventTopic)
+{
+    // Next event to send has earliest timestamp. Sources without an event are only queried
+    // again when none has one, otherwise they are expected to trigger a new pushed event.
+    EventTimingController::EventSourceControl* nextEventSource = nullptr;
+    if (fSourceHeap.empty())
+    {
+        rebuildSourceHeapImpl();
+    }
+
+    // The event of the top source may have been fired, or dropped, since it was queried, so
+    // query it again until the top of the heap is up to date.
+    while (!fSourceHeap.empty())
+    {
+        const std::size_t index = fSourceHeap.front();
+        updateEventSourceImpl(index);
+        if (!fSourceHeap.empty() && fSourceHeap.front() == index)
+        {
+            nextEventSource = &fEventSources[index];
+            break;
         }
     }
 
     // if a valid event source has been found, output the corresponding event time
     if (nextEventSource)
     {
-        nextEventSendingTime = earliestEventTime;
-        nextEventTopic = earliestEventTopic;
-        
+        nextEventSendingTime = nextEventSource->nextEventTime;
+        nextEventTopic = nextEventSource->nextEventTopic;
+
         if (!fIsInitialised)
         {
+            const TimestampType earliestEventTime = nextEventSource->nextEventTime;
             fSimulationStartTime = earliestEventTime;
             fPreviousRunningStartTime = static_cast<TimestampType>(std::chrono::system_clock::now());
+            fUnthrottledTime = earliestEventTime;
+            fPlaybackStartTime = earliestEventTime;
+            fWallStartTime = std::chrono::steady_clock::now();
+            fUserPauseStartTime = fWallStartTime;
             fIsInitialised = true;
             fInitCondVar.notify_all();
         }
@@ -158,6 +299,110 @@ EventTimingController::EventSourceControl* EventTimingController::findNextEventS
     return nextEventSource;
 }
 
+void EventTimingController::updateEventSourceImpl(std::size_t index)
+{
+    EventSourceControl& source = fEventSources[index];
+    const bool hasEvent = source.eventSource->getNextEventInfo(source.nextEventTime, source.nextEventTopic);
+
+    if (!hasEvent)
+    {
+        if (source.heapPosition != NOT_IN_HEAP)
+        {
+            removeFromHeap(source.heapPosition);
+        }
+    }
+    else if (source.heapPosition == NOT_IN_HEAP)
+    {
+        source.heapPosition = fSourceHeap.size();
+        fSourceHeap.push_back(index);
+        siftUp(source.heapPosition);
+    }
+    else
+    {
+        // the time may have moved either way
+        siftUp(source.heapPosition);
+        siftDown(source.heapPosition);
+    }
+}
+
+void EventTimingController::rebuildSourceHeapImpl()
+{
+    fSourceHeap.clear();
+    fSourceIndices.clear();
+    for (std::size_t i = 0; i < fEventSources.size(); ++i)
+    {
+        fSourceIndices[fEventSources[i].eventSource.get()] = i;
+        fEventSources[i].heapPosition = NOT_IN_HEAP;
+        updateEventSourceImpl(i);
+    }
+}
+
+bool EventTimingController::earlierInHeap(std::size_t lhsPosition, std::size_t rhsPosition) const
+{
+    // ties are broken by the order in which the sources were added, as by the former linear search
+    const std::size_t lhsIndex = fSourceHeap[lhsPosition];
+    const std::size_t rhsIndex = fSourceHeap[rhsPosition];
+    const TimestampType& lhsTime = fEventSources[lhsIndex].nextEventTime;
+    const TimestampType& rhsTime = fEventSources[rhsIndex].nextEventTime;
+    return lhsTime < rhsTime || (!(rhsTime < lhsTime) && lhsIndex < rhsIndex);
+}
+
+void EventTimingController::swapInHeap(std::size_t lhsPosition, std::size_t rhsPosition)
+{
+    std::swap(fSourceHeap[lhsPosition], fSourceHeap[rhsPosition]);
+    fEventSources[fSourceHeap[lhsPosition]].heapPosition = lhsPosition;
+    fEventSources[fSourceHeap[rhsPosition]].heapPosition = rhsPosition;
+}
+
+void EventTimingController::siftUp(std::size_t position)
+{
+    while (position > 0)
+    {
+        const std::size_t parent = (position - 1) / 2;
+        if (!earlierInHeap(position, parent))
+        {
+            break;
+        }
+        swapInHeap(position, parent);
+        position = parent;
+    }
+}
+
+void EventTimingController::siftDown(std::size_t position)
+{
+    while (true)
+    {
+        std::size_t earliest = position;
+        for (std::size_t child = 2 * position + 1; child <= 2 * position + 2 && child < fSourceHeap.size(); ++child)
+        {
+            if (earlierInHeap(child, earliest))
+            {
+                earliest = child;
+            }
+        }
+        if (earliest == position)
+        {
+            break;
+        }
+        swapInHeap(position, earliest);
+        position = earliest;
+    }
+}
+
+void EventTimingController::removeFromHeap(std::size_t position)
+{
+    const std::size_t last = fSourceHeap.size() - 1;
+    swapInHeap(position, last);
+    fEventSources[fSourceHeap[last]].heapPosition = NOT_IN_HEAP;
+    fSourceHeap.pop_back();
+    if (position < fSourceHeap.size())
+    {
+        const std::size_t movedIndex = fSourceHeap[position];
+        siftUp(position);
+        siftDown(fEventSources[movedIndex].heapPosition);
+    }
+}
+
 void EventTimingController::triggerNewEventPushed(IDynamicEventSource* pushedEventSource)
 {
     std::lock_guard<std::mutex> lockFire(fFireMutex);
@@ -166,11 +411,26 @@ void EventTimingController::triggerNewEventPushed(IDynamicEventSource* pushedEve
 
 void EventTimingController::triggerNewEventPushedImpl(IDynamicEventSource* pushedEventSource)
 {
-    TimestampType pushedEventTime;
-    std::string pushedEventTopic;
+    const auto sourceIndex = fSourceIndices.find(pushedEventSource);
+    if (sourceIndex == fSourceIndices.end())
+    {
+        return;
+    }
 
-    // Get timestamp of next event from input source
-    pushedEventSource->getNextEventInfo(pushedEventTime, pushedEventTopic);
+    // Get timestamp of next event from input source and move the source in the heap
+    updateEventSourceImpl(sourceIndex->second);
+    const EventSourceControl& source = fEventSources[sourceIndex->second];
+    if (source.heapPosition == NOT_IN_HEAP)
+    {
+        // a source without events may have just finished, which can end playback
+        if (source.eventSource->isFinished())
+        {
+            fShouldCheckNextEvent = true;
+            notifyEventProcessingImpl();
+        }
+        return;
+    }
+    const TimestampType& pushedEventTime = source.nextEventTime;
 
     // If there is no next event or the next event time is after the pushed event, we indicate to the
     // eventProcessing() thread that it should re-check the event sources.
@@ -178,7 +438,7 @@ void EventTimingController::triggerNewEventPushedImpl(IDynamicEventSource* pushe
     {
         fShouldCheckNextEvent = true;
         endWaitForPushEventImpl();
-        fFireCondVar.notify_all();
+        notifyEventProcessingImpl();
     }
 }
 
@@ -189,9 +449,10 @@ void EventTimingController::eventProcessing()
     setThreadName("EventTiming");
 
     // Loop until there is no next event
-    while (!allEventSourcesFinished())
+    while (fSeeking || !allEventSourcesFinished())
     {
         EventTimingController::EventSourceControl* nextEventSource = findNextEventSourceImpl(fNextEventTime, nextEventTopic);
+        holdNextEventImpl(nextEventSource != nullptr);
 
         // Exit if end is signalled.
         if (fEnd)
@@ -199,12 +460,13 @@ void EventTimingController::eventProcessing()
             break;
         }
 
-        // If there is no next event source but all event sources haven't been marked as finished, we poll at a reduced 
-        // frequency until a new push event arrives or all event sources are marked as finished.
+        // If there is no next event source but all event sources haven't been marked as finished, we wait until 
+        // a source pushes a new event or reports that it has finished, see triggerNewEventPushed().
         if (!nextEventSource)
         {
-            std::chrono::duration<unsigned int, std::micro> pollPeriod(1000);
-            fFireCondVar.wait_for(lockFire, pollPeriod, [this] { return fShouldCheckNextEvent || fEnd; });
+            // any pushed event is earlier than no event
+            fNextEventTime = static_cast<TimestampType>(std::chrono::system_clock::from_time_t(0));
+            fFireCondVar.wait(lockFire, [this] { return fShouldCheckNextEvent || fEnd; });
             if (fEnd)
                 break;
         }
@@ -221,18 +483,30 @@ void EventTimingController::eventProcessing()
             // Wait for the 2 pause conditions: regular-pause which will not wake until unpaused or
             // wait-pause which will publish a new push event if it is has a timestamp before the wait
             // event.
-            fFireCondVar.wait(lockFire, [this]{ return (!fPaused && !fWaitForPushEvent) || fEnd; });
+            fFireCondVar.wait(lockFire, [this]{ return (!fPaused && !fWaitForPushEvent && !fSeeking) || fEnd; });
             if (fEnd)
             {
                 break;
             }
 
+            // After seek(), the events before the seek target are fired right away, the simulation
+            // time continues at the target with the first event not before it.
+            if (fPreRolling && !(fNextEventTime < fSeekTarget))
+            {
+                fPreRolling = false;
+                rebaseSimulationTimeImpl(fSeekTarget);
+                fPlaybackStartTime = fSeekTarget;
+                fWallStartTime = std::chrono::steady_clock::now();
+                fUserPauseStartTime = fWallStartTime;
+                fUserPauseElapsed = std::chrono::steady_clock::duration(0);
+            }
+
             // if next event is in the future, wait to fire it.
             TimestampType currentSimulationTime;
             bool timeStarted = getTimeImpl(currentSimulationTime);
             MCF_ASSERT(timeStarted, "EventTimingController must be started before beginning event processing.");
 
-            while (fNextEventTime > currentSimulationTime && !fShouldCheckNextEvent && !fEnd)
+            while (!fUnthrottled && !fPreRolling && fNextEventTime > currentSimulationTime && !fShouldCheckNextEvent && !fEnd)
             {
                 auto waitTime = std::chrono::duration_cast<std::chrono::microseconds>((fNextEventTime - currentSimulationTime) / fSpeed);
                 
@@ -241,6 +515,20 @@ void EventTimingController::eventProcessing()
                 getTimeImpl(currentSimulationTime);
             }
 
+            // In logical time, wait until the earlier events have been processed up to the
+            // lookahead. The clock is not waited for with fFireMutex locked, as writers of values
+            // may need it, e.g. to push events.
+            while (fLogicalClock && !fShouldCheckNextEvent && !fEnd
+                   && !fLogicalClock->admits(logicalEventTime(fNextEventTime)))
+            {
+                const auto clock = fLogicalClock;
+                const uint64_t eventTime = logicalEventTime(fNextEventTime);
+                const uint64_t generation = clock->getGeneration();
+                lockFire.unlock();
+                clock->waitForAdmission(eventTime, generation);
+                lockFire.lock();
+            }
+
             if (fEnd)
             {
                 break;
@@ -249,12 +537,26 @@ void EventTimingController::eventProcessing()
             // If we have received a new push event, we need to recheck the next event so we continue in the loop without firing.
             if (!fShouldCheckNextEvent)
             {
-                nextEventSource->eventSource->fireEvent();
+                if (fUnthrottled && fNextEventTime > fUnthrottledTime)
+                {
+                    fUnthrottledTime = fNextEventTime;
+                }
+                {
+                    LogicalClock::Scope scope(fLogicalClock.get(), LogicalTime{logicalEventTime(fNextEventTime), 0});
+                    nextEventSource->eventSource->fireEvent();
+                }
+                if (fStepPending)
+                {
+                    fStepPending = false;
+                    fStepLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - fStepStartTime).count());
+                }
             }
         }
         fShouldCheckNextEvent = false;
 
     }
+    holdNextEventImpl(false);
     finishImpl();
     lockFire.unlock();
 
@@ -265,6 +567,52 @@ void EventTimingController::eventProcessing()
     }
 }
 
+void EventTimingController::setLogicalClock(std::shared_ptr<LogicalClock> clock)
+{
+    std::lock_guard<std::mutex> lock(fFireMutex);
+    // the next event is held in the new clock from the next loop of eventProcessing() on
+    holdNextEventImpl(false);
+    notifyEventProcessingImpl();
+    fLogicalClock = std::move(clock);
+}
+
+std::shared_ptr<LogicalClock> EventTimingController::getLogicalClock() const
+{
+    std::lock_guard<std::mutex> lock(fFireMutex);
+    return fLogicalClock;
+}
+
+void EventTimingController::holdNextEventImpl(bool hasNextEvent)
+{
+    const LogicalTime next{hasNextEvent ? logicalEventTime(fNextEventTime) : 0, 0};
+    if (fHeldEventClock && hasNextEvent && fHeldEventClock == fLogicalClock && fHeldEventTime == next)
+    {
+        return;
+    }
+    // hold the next time before releasing the previous one, so that the earliest held time
+    // does not jump ahead meanwhile
+    if (fLogicalClock && hasNextEvent)
+    {
+        fLogicalClock->hold(next);
+    }
+    if (fHeldEventClock)
+    {
+        fHeldEventClock->release(fHeldEventTime);
+    }
+    fHeldEventClock = hasNextEvent ? fLogicalClock : nullptr;
+    fHeldEventTime = next;
+}
+
+void EventTimingController::notifyEventProcessingImpl()
+{
+    fFireCondVar.notify_all();
+    if (fLogicalClock)
+    {
+        // waiting for admission
+        fLogicalClock->interrupt();
+    }
+}
+
 bool EventTimingController::allEventSourcesFinished() const
 {
     bool allEventSourcesFinished = true;
@@ -311,6 +659,10 @@ void EventTimingController::pauseImpl()
     {
         fPauseStartTime = static_cast<TimestampType>(std::chrono::system_clock::now());
     }
+    if (!fPaused)
+    {
+        fUserPauseStartTime = std::chrono::steady_clock::now();
+    }
     fPaused = true;
 }
 
@@ -320,6 +672,10 @@ void EventTimingController::resumeImpl()
     {
         resumeSimTimeImpl();
     }
+    if (fPaused && fIsInitialised)
+    {
+        fUserPauseElapsed += std::chrono::steady_clock::now() - fUserPauseStartTime;
+    }
     fPaused = false;
 }
 
@@ -345,7 +701,7 @@ void EventTimingController::resumeSimTimeImpl()
 {
     updateTotalPauseTime();
     fPauseStartTime = static_cast<TimestampType>(std::chrono::system_clock::from_time_t(0));
-    fFireCondVar.notify_all();
+    notifyEventProcessingImpl();
 }
 
 void EventTimingController::updateTotalPauseTime()
@@ -397,7 +753,7 @@ void EventTimingController::finish()
 void EventTimingController::finishImpl()
 {
     fEnd = true;
-    fFireCondVar.notify_all();
+    notifyEventProcessingImpl();
     fFinishCondVar.notify_all();
     fInitCondVar.notify_all();
 }
@@ -439,6 +795,11 @@ bool EventTimingController::getTimeImpl(TimestampType& simulationTime) const
     {
         return false;
     }
+    else if (fUnthrottled)
+    {
+        simulationTime = fUnthrottledTime;
+        return true;
+    }
     else
     {
         // Calculate the time spent running and paused since the last time we updated fRunTimeElapsed
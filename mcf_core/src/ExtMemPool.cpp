@@ -0,0 +1,301 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#include "mcf_core/ExtMemPool.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/Numa.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+
+namespace mcf {
+
+constexpr uint64_t ExtMemPool::HUGE_PAGE_SIZE;
+
+namespace {
+
+// smallest size class, smaller buffers are not worth splitting further
+constexpr uint64_t MIN_CLASS = 4096;
+
+bool usesHugePages(uint64_t capacity, const ExtMemPool::Config& config)
+{
+    return config.hugePages != ExtMemPool::HugePages::NONE && capacity >= ExtMemPool::HUGE_PAGE_SIZE;
+}
+
+// capacity of the buffers serving requests of len bytes with the given config
+uint64_t bufferCapacity(uint64_t len, const ExtMemPool::Config& config)
+{
+    const uint64_t capacity = ExtMemPool::sizeClass(len);
+    if (!usesHugePages(capacity, config))
+    {
+        return capacity;
+    }
+    const uint64_t pageSize = ExtMemPool::HUGE_PAGE_SIZE;
+    return (capacity + pageSize - 1) / pageSize * pageSize;
+}
+
+// allocates from the heap, zeroed by the allocating thread, so that the pages are placed on its
+// NUMA node
+void* allocateAligned(uint64_t capacity, std::size_t alignment, bool zero)
+{
+    void* data = nullptr;
+    if (alignment <= alignof(std::max_align_t))
+    {
+        data = zero ? std::calloc(1, capacity) : std::malloc(capacity);
+    }
+    else if (posix_memalign(&data, alignment, capacity) != 0)
+    {
+        data = nullptr;
+    }
+    else if (zero)
+    {
+        std::memset(data, 0, capacity);
+    }
+    if (data == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return data;
+}
+
+void releaseBlock(void* data, uint64_t capacity, bool mapped) noexcept
+{
+    if (mapped)
+    {
+        munmap(data, capacity);
+    }
+    else
+    {
+        std::free(data);
+    }
+}
+
+} // anonymous namespace
+
+ExtMemPool::Buffer::Buffer(Buffer&& other) noexcept
+: fPool(other.fPool), fData(other.fData), fCapacity(other.fCapacity), fMapped(other.fMapped)
+, fNumaNode(other.fNumaNode)
+{
+    other.fPool = nullptr;
+    other.fData = nullptr;
+    other.fCapacity = 0;
+    other.fMapped = false;
+    other.fNumaNode = -1;
+}
+
+ExtMemPool::Buffer& ExtMemPool::Buffer::operator=(Buffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        fPool = other.fPool;
+        fData = other.fData;
+        fCapacity = other.fCapacity;
+        fMapped = other.fMapped;
+        fNumaNode = other.fNumaNode;
+        other.fPool = nullptr;
+        other.fData = nullptr;
+        other.fCapacity = 0;
+        other.fMapped = false;
+        other.fNumaNode = -1;
+    }
+    return *this;
+}
+
+ExtMemPool::Buffer::~Buffer()
+{
+    release();
+}
+
+void ExtMemPool::Buffer::release() noexcept
+{
+    if (fData != nullptr)
+    {
+        fPool->recycle(fData, fCapacity, fMapped, fNumaNode);
+        fPool = nullptr;
+        fData = nullptr;
+        fCapacity = 0;
+        fMapped = false;
+        fNumaNode = -1;
+    }
+}
+
+ExtMemPool& ExtMemPool::defaultPool()
+{
+    // intentionally leaked: values may still be freed during static destruction
+    static ExtMemPool* instance = new ExtMemPool();
+    return *instance;
+}
+
+ExtMemPool& ExtMemPool::named(const std::string& name)
+{
+    static std::mutex mutex;
+    static auto* pools = new std::map<std::string, std::unique_ptr<ExtMemPool>>();
+    std::lock_guard<std::mutex> lk(mutex);
+    auto& pool = (*pools)[name];
+    if (pool == nullptr)
+    {
+        pool.reset(new ExtMemPool());
+    }
+    return *pool;
+}
+
+void ExtMemPool::configure(const Config& config)
+{
+    MCF_ASSERT(config.alignment >= sizeof(void*) && (config.alignment & (config.alignment - 1)) == 0,
+               "ExtMemPool: alignment must be a power of two of at least sizeof(void*)");
+    std::lock_guard<std::mutex> lk(fMutex);
+    const bool layoutChanged = config.alignment != fConfig.alignment || config.hugePages != fConfig.hugePages;
+    fConfig = config;
+    shrink(layoutChanged ? 0 : fConfig.maxCachedBytes);
+}
+
+ExtMemPool::Config ExtMemPool::config() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return fConfig;
+}
+
+ExtMemPool::Buffer ExtMemPool::allocate(uint64_t len, bool zero)
+{
+    Config config;
+    uint64_t capacity = 0;
+    Block block{nullptr, false, -1};
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        config = fConfig;
+        capacity = bufferCapacity(len, config);
+        auto it = fFree.find(capacity);
+        if (it != fFree.end() && !it->second.empty())
+        {
+            block = it->second.back();
+            it->second.pop_back();
+            fStatistics.cachedBytes -= capacity;
+            ++fStatistics.hits;
+        }
+        else
+        {
+            ++fStatistics.misses;
+        }
+    }
+
+    if (block.data != nullptr)
+    {
+        if (zero && config.zeroRecycled)
+        {
+            std::memset(block.data, 0, len);
+        }
+        return Buffer(this, block.data, capacity, block.mapped, block.numaNode);
+    }
+
+    if (usesHugePages(capacity, config))
+    {
+        if (config.hugePages == HugePages::EXPLICIT)
+        {
+            // zeroed by the kernel
+            void* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (data != MAP_FAILED)
+            {
+                recordNumaAllocation(capacity);
+                return Buffer(this, data, capacity, true, -1);
+            }
+            std::lock_guard<std::mutex> lk(fMutex);
+            ++fStatistics.hugePageFallbacks;
+        }
+        void* data = allocateAligned(capacity, std::max<std::size_t>(config.alignment, HUGE_PAGE_SIZE), false);
+        // before touching the pages, so that they are faulted in as huge pages
+        madvise(data, capacity, MADV_HUGEPAGE);
+        if (zero)
+        {
+            std::memset(data, 0, capacity);
+        }
+        recordNumaAllocation(capacity);
+        return Buffer(this, data, capacity, false, -1);
+    }
+
+    void* data = allocateAligned(capacity, config.alignment, zero);
+    recordNumaAllocation(capacity);
+    return Buffer(this, data, capacity, false, -1);
+}
+
+ExtMemPool::Statistics ExtMemPool::statistics() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return fStatistics;
+}
+
+void ExtMemPool::trim()
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    shrink(0);
+}
+
+uint64_t ExtMemPool::sizeClass(uint64_t len)
+{
+    if (len <= MIN_CLASS)
+    {
+        return MIN_CLASS;
+    }
+    // power < len <= 2 * power, rounded up to a quarter of power
+    uint64_t power = MIN_CLASS;
+    while (power * 2 < len)
+    {
+        power *= 2;
+    }
+    const uint64_t step = power / 4;
+    return (len + step - 1) / step * step;
+}
+
+void ExtMemPool::recycle(void* data, uint64_t capacity, bool mapped, int numaNode) noexcept
+{
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        // buffers allocated before a change of the config are not reused
+        const bool matchesConfig = capacity == bufferCapacity(capacity, fConfig)
+            && reinterpret_cast<uintptr_t>(data) % fConfig.alignment == 0
+            && (!mapped || fConfig.hugePages == HugePages::EXPLICIT);
+        if (matchesConfig && fStatistics.cachedBytes + capacity <= fConfig.maxCachedBytes)
+        {
+            try
+            {
+                fFree[capacity].push_back(Block{data, mapped, numaNode});
+                fStatistics.cachedBytes += capacity;
+                return;
+            }
+            catch (const std::bad_alloc&)
+            {
+                // no room in the free list, the buffer goes back to the heap
+            }
+        }
+        if (fConfig.maxCachedBytes > 0)
+        {
+            ++fStatistics.dropped;
+        }
+    }
+    releaseBlock(data, capacity, mapped);
+}
+
+void ExtMemPool::shrink(uint64_t maxCachedBytes)
+{
+    // largest buffers first, releasing the memory with few frees
+    for (auto it = fFree.rbegin(); it != fFree.rend() && fStatistics.cachedBytes > maxCachedBytes; ++it)
+    {
+        while (!it->second.empty() && fStatistics.cachedBytes > maxCachedBytes)
+        {
+            const Block& block = it->second.back();
+            releaseBlock(block.data, it->first, block.mapped);
+            it->second.pop_back();
+            fStatistics.cachedBytes -= it->first;
+        }
+    }
+}
+
+} // namespace mcf
@@ -4,19 +4,45 @@
 
 #include "mcf_core/ExtMemValue.h"
 #include "mcf_core/ErrorMacros.h"
+#include "mcf_core/Numa.h"
+#include "mcf_core/ValueReclaimer.h"
 
+#include <atomic>
 #include <cstring>
+#include <mutex>
 #include <stdexcept>
 
 namespace mcf {
 
 template<typename T>
-class ExtMemValue<T>::ExtMem {
+class ExtMemValue<T>::ExtMem : public ValueReclaimer::Garbage {
 public:
     ExtMem(){};
 
+    ~ExtMem() override
+    {
+        // the pages of a recycled buffer stay where they are
+        buffer.setNumaNode(numaNode.load(std::memory_order_relaxed));
+    }
+
+    // memory passed to extMemInit(array, len)
     std::unique_ptr<T[]> ptr;
+    // memory drawn from extMemPool(), if there is no ptr
+    ExtMemPool::Buffer buffer;
     uint64_t len{0};
+
+    // memory referred to instead of ptr, kept alive by owner
+    std::shared_ptr<const void> owner;
+    const T* shared{nullptr};
+
+    // rows of a strided view, kept alive by owner, gathered into buffer on first access
+    const uint8_t* viewBase{nullptr};
+    uint64_t viewRowLen{0};
+    uint64_t viewStride{0};
+    std::once_flag gathered;
+
+    // the NUMA node the memory has been placed on, -1 if unknown, see extMemPlace()
+    std::atomic<int> numaNode{-1};
 };
 
 template<typename T>
@@ -26,7 +52,15 @@ ExtMemValue<T>::ExtMemValue()
 }
 
 template<typename T>
-ExtMemValue<T>::~ExtMemValue() = default;
+ExtMemValue<T>::~ExtMemValue()
+{
+    // freeing large buffers on the releasing thread, often a real-time one, is left to the reclaimer
+    if (ValueReclaimer::active() && fExtMem != nullptr && fExtMem->len > 0)
+    {
+        const uint64_t len = fExtMem->len;
+        ValueReclaimer::instance().reclaim(std::move(fExtMem), len);
+    }
+}
 
 template<typename T>
 ExtMemValue<T>::ExtMemValue(ExtMemValue&& o) noexcept
@@ -62,6 +96,63 @@ void ExtMemValue<T>::extMemInit(const void *src, uint64_t len, int dstDevice, in
     memcpy(this->extMemPtrImpl(), src, len);
 }
 
+template<typename T>
+bool ExtMemValue<T>::extMemShare(std::shared_ptr<const void> owner, const void* ptr, uint64_t len)
+{
+    if (reinterpret_cast<uintptr_t>(ptr) % alignof(T) != 0)
+    {
+        return false;
+    }
+    this->extMemInit(len);
+    fExtMem->owner = std::move(owner);
+    fExtMem->shared = static_cast<const T*>(ptr);
+    return true;
+}
+
+template<typename T>
+bool ExtMemValue<T>::extMemInitView(std::shared_ptr<const IExtMemValue> parent, uint64_t offset, uint64_t len)
+{
+    return extMemInitView(std::move(parent), offset, len, len, 1);
+}
+
+template<typename T>
+bool ExtMemValue<T>::extMemInitView(std::shared_ptr<const IExtMemValue> parent, uint64_t offset,
+                                    uint64_t rowLen, uint64_t stride, uint64_t rows)
+{
+    MCF_ASSERT(parent != nullptr, "ExtMemValue: view without parent");
+    MCF_ASSERT(rows > 0 && rowLen > 0, "ExtMemValue: empty view");
+    MCF_ASSERT((rows == 1 || stride >= rowLen)
+                   && offset + (rows - 1) * stride + rowLen <= parent->extMemSize(),
+               "ExtMemValue: view exceeds the ext mem of its parent");
+    const uint8_t* base = parent->extMemPtr() + offset;
+    if (reinterpret_cast<uintptr_t>(base) % alignof(T) != 0 || (rows > 1 && stride % alignof(T) != 0))
+    {
+        return false;
+    }
+    // aliasing: the view refers to the memory of the parent and keeps the parent alive
+    std::shared_ptr<const void> owner(parent, base);
+    if (rows <= 1 || stride == rowLen)
+    {
+        return extMemShare(std::move(owner), base, rows * rowLen);
+    }
+    this->extMemInit(rows * rowLen);
+    fExtMem->owner = std::move(owner);
+    fExtMem->viewBase = base;
+    fExtMem->viewRowLen = rowLen;
+    fExtMem->viewStride = stride;
+    return true;
+}
+
+template<typename T>
+const T* ExtMemValue<T>::extMemRow(uint64_t row) const
+{
+    if (fExtMem->viewBase != nullptr)
+    {
+        return reinterpret_cast<const T*>(fExtMem->viewBase + row * fExtMem->viewStride);
+    }
+    return row == 0 ? extMemPtrImpl() : nullptr;
+}
+
 template<typename T>
 uint64_t ExtMemValue<T>::extMemSize() const
 {
@@ -97,6 +188,23 @@ typename ExtMemValue<T>::Ptr ExtMemValue<T>::extMemPtr(int device)
     {
         MCF_THROW_RUNTIME("Device id should be -1 for CPU ext mem value");
     }
+    if (fExtMem->shared != nullptr)
+    {
+        // copy on write, shared memory is read-only
+        fExtMem->buffer = extMemPool().allocate(fExtMem->len, false);
+        fExtMem->numaNode = fExtMem->buffer.numaNode();
+        memcpy(fExtMem->buffer.data(), fExtMem->shared, fExtMem->len);
+        fExtMem->shared = nullptr;
+        fExtMem->owner.reset();
+    }
+    else if (fExtMem->viewBase != nullptr)
+    {
+        // the gathered rows become the own memory of the value
+        T* gathered = extMemPtrImpl();
+        fExtMem->viewBase = nullptr;
+        fExtMem->owner.reset();
+        return gathered;
+    }
     return extMemPtrImpl();
 }
 
@@ -106,10 +214,39 @@ T* ExtMemValue<T>::extMemPtrImpl() const {
     {
         return nullptr;
     }
-    if (fExtMem->ptr == nullptr) {
-        fExtMem->ptr = std::make_unique<T[]>(fExtMem->len/sizeof(T));
+    if (fExtMem->shared != nullptr)
+    {
+        return const_cast<T*>(fExtMem->shared);
+    }
+    if (fExtMem->viewBase != nullptr)
+    {
+        // thread safe, since values are read concurrently once shared on the value store
+        std::call_once(fExtMem->gathered, [this]() {
+            fExtMem->buffer = extMemPool().allocate(fExtMem->len, false);
+            fExtMem->numaNode = fExtMem->buffer.numaNode();
+            auto* dst = static_cast<uint8_t*>(fExtMem->buffer.data());
+            const uint8_t* src = fExtMem->viewBase;
+            for (uint64_t offset = 0; offset < fExtMem->len; offset += fExtMem->viewRowLen)
+            {
+                memcpy(dst + offset, src, fExtMem->viewRowLen);
+                src += fExtMem->viewStride;
+            }
+        });
+        return static_cast<T*>(fExtMem->buffer.data());
+    }
+    if (fExtMem->ptr != nullptr) {
+        return fExtMem->ptr.get();
     }
-    return const_cast<T*>(fExtMem->ptr.get());
+    if (fExtMem->buffer.data() == nullptr) {
+        fExtMem->buffer = extMemPool().allocate(fExtMem->len);
+        fExtMem->numaNode = fExtMem->buffer.numaNode();
+    }
+    return static_cast<T*>(fExtMem->buffer.data());
+}
+
+template<typename T>
+ExtMemPool& ExtMemValue<T>::extMemPool() const {
+    return ExtMemPool::defaultPool();
 }
 
 template<typename T>
@@ -117,6 +254,17 @@ bool ExtMemValue<T>::extMemInitialized() const {
     return fExtMem->len > 0;
 }
 
+template<typename T>
+bool ExtMemValue<T>::extMemPlace(int numaNode) const {
+    if (!extMemInitialized() || fExtMem->numaNode.load(std::memory_order_relaxed) == numaNode)
+    {
+        return true;
+    }
+    migrateToNumaNode(extMemPtr(), fExtMem->len, numaNode);
+    fExtMem->numaNode.store(numaNode, std::memory_order_relaxed);
+    return true;
+}
+
 /**
  * We only support a very limited number of ext mem types.
  * The reason for this is that ext mem is by definition not fed through the message pack
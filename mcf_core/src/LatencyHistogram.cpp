@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mcf {
+
+constexpr unsigned LatencyHistogram::SUB_BUCKET_BITS;
+constexpr uint64_t LatencyHistogram::SUB_BUCKETS;
+constexpr unsigned LatencyHistogram::MAX_VALUE_BITS;
+constexpr uint64_t LatencyHistogram::MAX_VALUE;
+constexpr size_t LatencyHistogram::NUM_BUCKETS;
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const uint64_t shift = (index - SUB_BUCKETS) / (SUB_BUCKETS / 2) + 1;
+    const uint64_t mantissa = (index - SUB_BUCKETS) % (SUB_BUCKETS / 2) + SUB_BUCKETS / 2;
+    return mantissa << shift;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const uint64_t shift = (index - SUB_BUCKETS) / (SUB_BUCKETS / 2) + 1;
+    return bucketLowerBound(index) + (uint64_t(1) << shift) - 1;
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const {
+    std::array<uint64_t, NUM_BUCKETS> counts;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        counts[i] = fBuckets[i].load(std::memory_order_relaxed);
+    }
+    return summarize(counts, fSum.load(std::memory_order_relaxed), fMax.load(std::memory_order_relaxed));
+}
+
+LatencyHistogram::Summary LatencyHistogram::takeSummary() {
+    std::array<uint64_t, NUM_BUCKETS> counts;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        counts[i] = fBuckets[i].exchange(0, std::memory_order_relaxed);
+    }
+    return summarize(counts, fSum.exchange(0, std::memory_order_relaxed), fMax.exchange(0, std::memory_order_relaxed));
+}
+
+void LatencyHistogram::reset() {
+    takeSummary();
+}
+
+LatencyHistogram::Summary LatencyHistogram::summarize(
+    const std::array<uint64_t, NUM_BUCKETS>& counts, uint64_t sum, uint64_t max)
+{
+    Summary summary;
+    for (auto count : counts) {
+        summary.count += count;
+    }
+    if (summary.count == 0) {
+        return summary;
+    }
+    summary.sum = sum;
+
+    const uint64_t ranks[] = {
+        static_cast<uint64_t>(std::ceil(0.5 * summary.count)),
+        static_cast<uint64_t>(std::ceil(0.99 * summary.count)),
+        static_cast<uint64_t>(std::ceil(0.999 * summary.count))};
+    uint64_t* const percentiles[] = {&summary.p50, &summary.p99, &summary.p999};
+    size_t next = 0;
+    uint64_t cumulative = 0;
+    bool first = true;
+    for (size_t i = 0; i < NUM_BUCKETS && next < 3; ++i) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        if (first) {
+            summary.min = bucketLowerBound(i);
+            first = false;
+        }
+        cumulative += counts[i];
+        while (next < 3 && cumulative >= ranks[next]) {
+            *percentiles[next] = bucketUpperBound(i);
+            ++next;
+        }
+    }
+    // a concurrent record may have counted the bucket but not yet raised the maximum
+    size_t highest = NUM_BUCKETS - 1;
+    while (counts[highest] == 0) {
+        --highest;
+    }
+    summary.max = std::max(max, bucketLowerBound(highest));
+    summary.p50 = std::min(summary.p50, summary.max);
+    summary.p99 = std::min(summary.p99, summary.max);
+    summary.p999 = std::min(summary.p999, summary.max);
+    return summary;
+}
+
+} // namespace mcf
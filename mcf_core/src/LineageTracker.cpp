@@ -0,0 +1,224 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/LineageTracker.h"
+#include "mcf_core/Messages.h"
+#include "mcf_core/ValueStore.h"
+
+#include <algorithm>
+
+namespace mcf {
+
+std::atomic<bool> gLineageTrackingActive{false};
+
+constexpr size_t LineageTracker::MAX_ORIGINS;
+constexpr size_t LineageTracker::NUM_STRIPES;
+
+namespace {
+
+// value ids of different components differ in their upper bits, mix them into the slot index
+size_t slotIndex(uint64_t valueId, size_t mask)
+{
+    return static_cast<size_t>((valueId * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+int64_t nowNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // anonymous namespace
+
+LineageTracker& LineageTracker::instance()
+{
+    // intentionally leaked: sender ports may record writes during static destruction
+    static LineageTracker* tracker = new LineageTracker();
+    return *tracker;
+}
+
+void LineageTracker::enable(ValueStore& valueStore, const LineageConfig& config)
+{
+    auto state = std::make_shared<State>();
+    state->valueStore = &valueStore;
+    state->config = config;
+    state->sinks.insert(config.sinks.begin(), config.sinks.end());
+    size_t size = 1;
+    while (size < config.tableSize) {
+        size <<= 1;
+    }
+    state->mask = size - 1;
+    state->entries.reset(new Entry[size]);
+
+    const int64_t now = nowNanoseconds();
+    {
+        std::lock_guard<std::mutex> lk(fSinksMutex);
+        fSinks.clear();
+        for (const auto& sink : state->sinks) {
+            fSinks[sink].windowStartNs = now;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lk(fSourcesMutex);
+        fSourceNames.clear();
+        fSourceTopics.clear();
+    }
+    std::atomic_store(&fState, std::shared_ptr<State>(std::move(state)));
+    gLineageTrackingActive.store(true);
+}
+
+void LineageTracker::disable()
+{
+    gLineageTrackingActive.store(false);
+    std::atomic_store(&fState, std::shared_ptr<State>());
+}
+
+void LineageTracker::recordWrite(const std::string& topic, const Value& value, const std::vector<uint64_t>& inputIds)
+{
+    const uint64_t valueId = value.id();
+    const std::shared_ptr<State> state = std::atomic_load(&fState);
+    if (valueId == 0 || !state) {
+        return;
+    }
+    const int64_t now = nowNanoseconds();
+
+    Entry entry;
+    entry.valueId = valueId;
+    if (inputIds.empty()) {
+        uint32_t source;
+        if (sourceIndex(*state, topic, source)) {
+            entry.origins[0] = Origin{source, static_cast<uint64_t>(now)};
+            entry.numOrigins = 1;
+        }
+    }
+    else {
+        for (uint64_t inputId : inputIds) {
+            const size_t slot = slotIndex(inputId, state->mask);
+            std::lock_guard<std::mutex> lk(fStripes[slot % NUM_STRIPES]);
+            const Entry& input = state->entries[slot];
+            if (input.valueId != inputId) {
+                // no lineage, or overwritten by a later value
+                continue;
+            }
+            for (uint8_t i = 0; i < input.numOrigins; ++i) {
+                const Origin& origin = input.origins[i];
+                Origin* end = entry.origins + entry.numOrigins;
+                Origin* known = std::find_if(entry.origins, end, [&origin](const Origin& o) {
+                    return o.source == origin.source;
+                });
+                if (known != end) {
+                    known->timeNs = std::min(known->timeNs, origin.timeNs);
+                }
+                else if (entry.numOrigins < MAX_ORIGINS) {
+                    entry.origins[entry.numOrigins++] = origin;
+                }
+            }
+        }
+    }
+    if (entry.numOrigins == 0) {
+        return;
+    }
+
+    if (state->sinks.count(topic) != 0) {
+        recordSink(*state, topic, entry, now);
+    }
+    const size_t slot = slotIndex(valueId, state->mask);
+    std::lock_guard<std::mutex> lk(fStripes[slot % NUM_STRIPES]);
+    state->entries[slot] = entry;
+}
+
+bool LineageTracker::sourceIndex(const State& state, const std::string& topic, uint32_t& index)
+{
+    std::lock_guard<std::mutex> lk(fSourcesMutex);
+    auto it = fSourceTopics.find(topic);
+    if (it == fSourceTopics.end()) {
+        const auto& sources = state.config.sources;
+        const bool isSource = std::any_of(sources.begin(), sources.end(), [&topic](const std::string& pattern) {
+            return ValueStore::matchesPattern(pattern, topic);
+        });
+        int64_t newIndex = -1;
+        if (isSource) {
+            newIndex = static_cast<int64_t>(fSourceNames.size());
+            fSourceNames.push_back(topic);
+        }
+        it = fSourceTopics.emplace(topic, newIndex).first;
+    }
+    if (it->second < 0) {
+        return false;
+    }
+    index = static_cast<uint32_t>(it->second);
+    return true;
+}
+
+void LineageTracker::recordSink(const State& state, const std::string& topic, const Entry& entry, int64_t nowNs)
+{
+    std::shared_ptr<msg::LineageLatency> latency;
+    {
+        std::lock_guard<std::mutex> lk(fSinksMutex);
+        auto it = fSinks.find(topic);
+        if (it == fSinks.end()) {
+            // enabled again with other sinks in the meantime
+            return;
+        }
+        SinkState& sink = it->second;
+        for (uint8_t i = 0; i < entry.numOrigins; ++i) {
+            const Origin& origin = entry.origins[i];
+            auto& histogram = sink.paths[origin.source];
+            if (!histogram) {
+                histogram.reset(new LatencyHistogram());
+            }
+            const int64_t latencyNs = nowNs - static_cast<int64_t>(origin.timeNs);
+            histogram->record(static_cast<uint64_t>(std::max<int64_t>(latencyNs, 0)));
+        }
+
+        const auto intervalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            state.config.publishInterval).count();
+        if (nowNs - sink.windowStartNs >= intervalNs) {
+            latency = std::make_shared<msg::LineageLatency>();
+            latency->sink = topic;
+            latency->windowUs = static_cast<uint64_t>(nowNs - sink.windowStartNs) / 1000;
+            std::lock_guard<std::mutex> sourcesLock(fSourcesMutex);
+            for (auto& path : sink.paths) {
+                const auto summary = path.second->takeSummary();
+                if (summary.count == 0 || path.first >= fSourceNames.size()) {
+                    continue;
+                }
+                msg::LineagePathLatency pathLatency;
+                pathLatency.source = fSourceNames[path.first];
+                pathLatency.count = summary.count;
+                pathLatency.p50Ns = summary.p50;
+                pathLatency.p99Ns = summary.p99;
+                pathLatency.p999Ns = summary.p999;
+                pathLatency.maxNs = summary.max;
+                latency->paths.push_back(std::move(pathLatency));
+            }
+            sink.windowStartNs = nowNs;
+        }
+    }
+    if (latency) {
+        // never block the writer of the sink value
+        state.valueStore->setValue("/mcf/lineage" + topic, ValuePtr(std::move(latency)), false);
+    }
+}
+
+std::vector<LineageTracker::PathStatistics> LineageTracker::statistics() const
+{
+    std::vector<PathStatistics> result;
+    std::lock_guard<std::mutex> lk(fSinksMutex);
+    std::lock_guard<std::mutex> sourcesLock(fSourcesMutex);
+    for (const auto& sink : fSinks) {
+        for (const auto& path : sink.second.paths) {
+            if (path.first >= fSourceNames.size()) {
+                continue;
+            }
+            PathStatistics statistics;
+            statistics.source = fSourceNames[path.first];
+            statistics.sink = sink.first;
+            statistics.latency = path.second->summary();
+            result.push_back(std::move(statistics));
+        }
+    }
+    return result;
+}
+
+} // namespace mcf
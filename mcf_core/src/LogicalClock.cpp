@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/LogicalClock.h"
+#include "mcf_core/ErrorMacros.h"
+
+#include <algorithm>
+
+namespace mcf {
+
+namespace {
+
+thread_local LogicalClock* tCurrentClock = nullptr;
+thread_local LogicalTime tCurrentTime;
+
+} // anonymous namespace
+
+LogicalClock::Scope::Scope(LogicalClock* clock, const LogicalTime& time)
+: fPreviousClock(tCurrentClock)
+, fPreviousTime(tCurrentTime)
+{
+    tCurrentClock = clock;
+    tCurrentTime = time;
+}
+
+LogicalClock::Scope::~Scope()
+{
+    tCurrentClock = fPreviousClock;
+    tCurrentTime = fPreviousTime;
+}
+
+LogicalClock::Run::Run(const Stamp& input)
+: fInput(input)
+, fScope(input.clock.get(), LogicalTime{input.time.time, input.time.step + 1})
+{
+    fInput.clock->hold(fInput.time);
+}
+
+LogicalClock::Run::~Run()
+{
+    fInput.clock->release(fInput.time);
+}
+
+LogicalClock::LogicalClock(uint64_t lookaheadMicroSeconds)
+: fLookahead(lookaheadMicroSeconds)
+{
+}
+
+LogicalClock::Stamp LogicalClock::current()
+{
+    if (tCurrentClock == nullptr)
+    {
+        return Stamp();
+    }
+    return Stamp{tCurrentClock->shared_from_this(), tCurrentTime};
+}
+
+void LogicalClock::hold(const LogicalTime& time)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    fHeld.insert(time);
+}
+
+void LogicalClock::release(const LogicalTime& time)
+{
+    std::vector<std::weak_ptr<ITriggerable>> wakes;
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        auto it = fHeld.find(time);
+        MCF_ASSERT(it != fHeld.end(), "Releasing a logical time which is not held");
+        const bool wasEarliest = it == fHeld.begin();
+        fHeld.erase(it);
+        if (!wasEarliest || (!fHeld.empty() && *fHeld.begin() == time))
+        {
+            // the earliest held time has not changed
+            return;
+        }
+        ++fGeneration;
+        wakes.swap(fWakes);
+    }
+    advanced(wakes);
+}
+
+bool LogicalClock::isSafe(const LogicalTime& time) const
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    return isSafeUnlocked(time);
+}
+
+bool LogicalClock::isSafeOrWake(const LogicalTime& time, const std::weak_ptr<ITriggerable>& wake)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (isSafeUnlocked(time))
+    {
+        return true;
+    }
+    const bool registered = std::any_of(fWakes.begin(), fWakes.end(),
+        [&wake](const std::weak_ptr<ITriggerable>& other)
+        {
+            return !other.owner_before(wake) && !wake.owner_before(other);
+        });
+    if (!registered)
+    {
+        fWakes.push_back(wake);
+    }
+    return false;
+}
+
+bool LogicalClock::admits(uint64_t eventTime) const
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    return admitsUnlocked(eventTime);
+}
+
+uint64_t LogicalClock::getGeneration() const
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fGeneration;
+}
+
+void LogicalClock::waitForAdmission(uint64_t eventTime, uint64_t generation)
+{
+    std::unique_lock<std::mutex> lock(fMutex);
+    fAdvanced.wait(lock, [&] { return admitsUnlocked(eventTime) || fGeneration != generation; });
+}
+
+void LogicalClock::interrupt()
+{
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        ++fGeneration;
+    }
+    fAdvanced.notify_all();
+}
+
+size_t LogicalClock::getHeldCount() const
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fHeld.size();
+}
+
+bool LogicalClock::admitsUnlocked(uint64_t eventTime) const
+{
+    return fHeld.empty() || eventTime <= fHeld.begin()->time + fLookahead;
+}
+
+bool LogicalClock::isSafeUnlocked(const LogicalTime& time) const
+{
+    return fHeld.empty() || !(*fHeld.begin() < time);
+}
+
+void LogicalClock::advanced(std::vector<std::weak_ptr<ITriggerable>>& wakes)
+{
+    fAdvanced.notify_all();
+    for (const auto& wake : wakes)
+    {
+        if (auto triggerable = wake.lock())
+        {
+            triggerable->trigger();
+        }
+    }
+}
+
+} // namespace mcf
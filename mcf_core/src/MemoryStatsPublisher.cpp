@@ -0,0 +1,253 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/MemoryStatsPublisher.h"
+
+#include "mcf_core/ComponentManager.h"
+#include "mcf_core/IExtMemValue.h"
+#include "mcf_core/LoggingMacros.h"
+#include "mcf_core/ValueReclaimer.h"
+#include "mcf_core/ValueRecorder.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+// granularity of the publishing loop, keeps shutdown responsive with long intervals
+constexpr std::chrono::milliseconds POLL_INTERVAL(10);
+
+msg::MemoryUsage makeUsage(const std::string& kind, const std::string& name) {
+    msg::MemoryUsage usage;
+    usage.kind = kind;
+    usage.name = name;
+    usage.values = 0;
+    usage.bytes = 0;
+    usage.extMemBytes = 0;
+    usage.highWaterBytes = 0;
+    usage.thresholdBytes = 0;
+    usage.alert = false;
+    return usage;
+}
+
+void addUsage(msg::MemoryUsage& usage, const msg::MemoryUsage& other) {
+    usage.values += other.values;
+    usage.bytes += other.bytes;
+    usage.extMemBytes += other.extMemBytes;
+}
+
+} // anonymous namespace
+
+MemoryStatsPublisher::MemoryStatsPublisher(ValueStore& valueStore, std::chrono::milliseconds interval)
+: Component("MemoryStatsPublisher")
+, fValueStore(valueStore)
+, fInterval(interval)
+, fStatsPort(*this, "Stats")
+{}
+
+void MemoryStatsPublisher::addComponentQueues(ComponentManager& manager) {
+    std::vector<ComponentQueue> queues;
+    for (const auto& component : manager.getComponents()) {
+        for (const auto& port : manager.getPorts(component)) {
+            auto queue = port.queue();
+            if (queue != nullptr) {
+                queues.push_back(ComponentQueue{component.name(), port.name(), queue});
+            }
+        }
+    }
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fStateMutex);
+    fComponentQueues.insert(fComponentQueues.end(), queues.begin(), queues.end());
+}
+
+void MemoryStatsPublisher::setRecorder(const ValueRecorder* recorder) {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fStateMutex);
+    fRecorder = recorder;
+}
+
+void MemoryStatsPublisher::setThreshold(const std::string& kind, uint64_t bytes) {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fStateMutex);
+    fKindThresholds[kind] = bytes;
+}
+
+void MemoryStatsPublisher::setThreshold(const std::string& kind, const std::string& name, uint64_t bytes) {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fStateMutex);
+    fThresholds[std::make_pair(kind, name)] = bytes;
+}
+
+void MemoryStatsPublisher::configure(IComponentConfig& config) {
+    config.registerPort(fStatsPort, DEFAULT_TOPIC);
+}
+
+void MemoryStatsPublisher::startup() {
+    fLastPublish = std::chrono::steady_clock::now();
+    registerTriggerHandler(std::bind(&MemoryStatsPublisher::tick, this));
+    trigger();
+}
+
+void MemoryStatsPublisher::tick() {
+    if (std::chrono::steady_clock::now() - fLastPublish >= fInterval) {
+        fLastPublish = std::chrono::steady_clock::now();
+        fStatsPort.setValue(collect());
+    }
+    std::this_thread::sleep_for(std::min(POLL_INTERVAL, fInterval));
+    trigger();
+}
+
+std::unique_ptr<msg::MemoryStats> MemoryStatsPublisher::collect() {
+    // declared before the lock, so that values only held by the snapshot are released without it
+    std::vector<ValueStore::HeldValues> held = fValueStore.getHeldValues();
+    std::vector<std::shared_ptr<ValueQueue>> queues;
+    std::vector<ValuePtr> values;
+
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fStateMutex);
+    ++fCollection;
+    auto stats = std::make_unique<msg::MemoryStats>();
+    msg::MemoryUsage total = makeUsage("total", "");
+    std::unordered_set<const Value*> counted;
+
+    // queues are named after the port of their component or after the first topic they receive
+    std::unordered_map<const ValueQueue*, std::string> queueNames;
+    std::map<std::string, std::vector<const ValueQueue*>> componentQueues;
+    for (const auto& componentQueue : fComponentQueues) {
+        auto queue = componentQueue.queue.lock();
+        if (queue == nullptr) {
+            continue;
+        }
+        componentQueues[componentQueue.component].push_back(queue.get());
+        if (queueNames.emplace(queue.get(), componentQueue.component + "." + componentQueue.port).second) {
+            queues.push_back(std::move(queue));
+        }
+    }
+
+    std::unordered_map<std::string, size_t> topicQueues;
+    for (const auto& topic : held) {
+        if (!topic.topic.empty()) {
+            msg::MemoryUsage usage = makeUsage("topic", topic.topic);
+            account(topic.value, usage, total, counted);
+            for (const auto& value : topic.history) {
+                account(value, usage, total, counted);
+            }
+            finish(std::move(usage), *stats);
+        }
+        for (const auto& queue : topic.queues) {
+            auto inserted = queueNames.emplace(queue.get(), std::string());
+            if (inserted.second) {
+                const std::string& prefix = topic.topic.empty() ? "*" : topic.topic;
+                inserted.first->second = prefix + "#" + std::to_string(topicQueues[topic.topic]++);
+                queues.push_back(queue);
+            }
+        }
+    }
+
+    std::unordered_map<const ValueQueue*, msg::MemoryUsage> queueUsages;
+    for (const auto& queue : queues) {
+        values.clear();
+        queue->copyValues(values);
+        msg::MemoryUsage usage = makeUsage("queue", queueNames[queue.get()]);
+        for (const auto& value : values) {
+            account(value, usage, total, counted);
+        }
+        queueUsages.emplace(queue.get(), usage);
+        finish(std::move(usage), *stats);
+    }
+
+    for (const auto& component : componentQueues) {
+        msg::MemoryUsage usage = makeUsage("component", component.first);
+        for (const auto* queue : component.second) {
+            addUsage(usage, queueUsages[queue]);
+        }
+        finish(std::move(usage), *stats);
+    }
+
+    if (fRecorder != nullptr) {
+        msg::MemoryUsage usage = makeUsage("recorder", "");
+        usage.bytes = fRecorder->getWriteQueueBytes();
+        finish(std::move(usage), *stats);
+    }
+    if (ValueReclaimer::active()) {
+        // ext mem of released values, waiting to be freed
+        const ValueReclaimer::Statistics reclaimer = ValueReclaimer::instance().statistics();
+        msg::MemoryUsage usage = makeUsage("reclaimer", "");
+        usage.values = reclaimer.queueDepth;
+        usage.bytes = reclaimer.queueBytes;
+        usage.extMemBytes = reclaimer.queueBytes;
+        finish(std::move(usage), *stats);
+    }
+    finish(std::move(total), *stats);
+
+    // forget the estimates of values no longer held
+    for (auto it = fEstimates.begin(); it != fEstimates.end();) {
+        if (it->second.collection != fCollection) {
+            it = fEstimates.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    return stats;
+}
+
+void MemoryStatsPublisher::account(const ValuePtr& value, msg::MemoryUsage& usage, msg::MemoryUsage& total,
+                                   std::unordered_set<const Value*>& counted) {
+    if (value == nullptr) {
+        return;
+    }
+    const Estimate& valueEstimate = estimate(value);
+    ++usage.values;
+    usage.bytes += valueEstimate.bytes;
+    usage.extMemBytes += valueEstimate.extMemBytes;
+    if (counted.insert(value.get()).second) {
+        ++total.values;
+        total.bytes += valueEstimate.bytes;
+        total.extMemBytes += valueEstimate.extMemBytes;
+    }
+}
+
+const MemoryStatsPublisher::Estimate& MemoryStatsPublisher::estimate(const ValuePtr& value) {
+    Estimate& entry = fEstimates[value.get()];
+    if (entry.collection == 0 || entry.value.expired()) {
+        entry.value = value;
+        const auto* typeInfo = fValueStore.findTypeInfo(*value);
+        if (typeInfo != nullptr && typeInfo->codec != nullptr) {
+            entry.extMemBytes = typeInfo->codec->extMemSize(*value);
+            entry.bytes = TypeRegistry::packedSize(*value, *typeInfo) + entry.extMemBytes;
+        }
+        else {
+            // unregistered types have no known serialized size
+            const auto* extMemValue = dynamic_cast<const IExtMemValue*>(value.get());
+            entry.extMemBytes = extMemValue != nullptr ? extMemValue->extMemSize() : 0;
+            entry.bytes = entry.extMemBytes;
+        }
+    }
+    entry.collection = fCollection;
+    return entry;
+}
+
+void MemoryStatsPublisher::finish(msg::MemoryUsage&& usage, msg::MemoryStats& stats) {
+    const auto key = std::make_pair(usage.kind, usage.name);
+    auto threshold = fThresholds.find(key);
+    if (threshold != fThresholds.end()) {
+        usage.thresholdBytes = threshold->second;
+    }
+    else {
+        auto kindThreshold = fKindThresholds.find(usage.kind);
+        usage.thresholdBytes = kindThreshold != fKindThresholds.end() ? kindThreshold->second : 0;
+    }
+    usage.alert = usage.thresholdBytes > 0 && usage.bytes > usage.thresholdBytes;
+
+    Mark& mark = fMarks[key];
+    mark.highWaterBytes = std::max(mark.highWaterBytes, usage.bytes);
+    usage.highWaterBytes = mark.highWaterBytes;
+    if (usage.alert && !mark.alert) {
+        MCF_WARN_NOFILELINE("MemoryStatsPublisher: {} holds {} bytes, above its threshold of {} bytes",
+                            usage.name.empty() ? usage.kind : usage.kind + " " + usage.name,
+                            usage.bytes, usage.thresholdBytes);
+    }
+    mark.alert = usage.alert;
+    stats.entries.push_back(std::move(usage));
+}
+
+} // namespace mcf
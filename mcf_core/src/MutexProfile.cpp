@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/MutexProfile.h"
+
+#include "spdlog/fmt/fmt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+
+namespace mcf {
+namespace mutex {
+
+constexpr size_t MutexProfile::CALL_SITE_SLOTS;
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<MutexProfile>> profiles;
+};
+
+Registry& registry()
+{
+    // never destroyed, mutexes may still be used during static destruction
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+std::string symbolize(uintptr_t address)
+{
+    Dl_info info{};
+    if (dladdr(reinterpret_cast<void*>(address), &info) == 0 || info.dli_sname == nullptr)
+    {
+        return fmt::format("0x{:x}", address);
+    }
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string name = status == 0 && demangled != nullptr ? demangled : info.dli_sname;
+    std::free(demangled);
+    return fmt::format("{}+0x{:x}", name, address - reinterpret_cast<uintptr_t>(info.dli_saddr));
+}
+
+uint64_t totalWait(const MutexProfile::Snapshot& snapshot)
+{
+    return snapshot.wait.sum;
+}
+
+} // anonymous namespace
+
+MutexProfile::MutexProfile(std::string name)
+: fName(std::move(name))
+{
+}
+
+MutexProfile& MutexProfile::get(const std::string& name)
+{
+    auto& r = registry();
+    std::lock_guard<std::mutex> lk(r.mutex);
+    auto& profile = r.profiles[name];
+    if (!profile)
+    {
+        profile = std::make_unique<MutexProfile>(name);
+    }
+    return *profile;
+}
+
+std::vector<MutexProfile::Snapshot> MutexProfile::snapshots(size_t maxCallSites)
+{
+    std::vector<Snapshot> result;
+    auto& r = registry();
+    {
+        std::lock_guard<std::mutex> lk(r.mutex);
+        for (const auto& profile : r.profiles)
+        {
+            result.push_back(profile.second->snapshot(maxCallSites));
+        }
+    }
+    std::stable_sort(result.begin(), result.end(), [](const Snapshot& a, const Snapshot& b) {
+        return totalWait(a) > totalWait(b);
+    });
+    return result;
+}
+
+std::string MutexProfile::report(size_t maxCallSites)
+{
+    std::string text;
+    for (const auto& snapshot : snapshots(maxCallSites))
+    {
+        text += fmt::format(
+            "{}: {} locks, {} contended, wait p50 {} ns p99 {} ns max {} ns total {:.3f} ms, "
+            "hold p50 {} ns p99 {} ns max {} ns\n",
+            snapshot.name,
+            snapshot.locks,
+            snapshot.contentions,
+            snapshot.wait.p50,
+            snapshot.wait.p99,
+            snapshot.wait.max,
+            snapshot.wait.sum / 1e6,
+            snapshot.hold.p50,
+            snapshot.hold.p99,
+            snapshot.hold.max);
+        for (const auto& site : snapshot.callSites)
+        {
+            text += fmt::format("    {} contentions at {}\n", site.contentions, site.location);
+        }
+    }
+    return text;
+}
+
+void MutexProfile::resetAll()
+{
+    auto& r = registry();
+    std::lock_guard<std::mutex> lk(r.mutex);
+    for (auto& profile : r.profiles)
+    {
+        profile.second->reset();
+    }
+}
+
+uint64_t MutexProfile::now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void MutexProfile::recordContention(uint64_t waitNs, const void* callSite)
+{
+    fContentions.fetch_add(1, std::memory_order_relaxed);
+    if (waitNs > 0)
+    {
+        fWait.record(waitNs);
+    }
+    const auto address = reinterpret_cast<uintptr_t>(callSite);
+    if (address == 0)
+    {
+        fOtherContentions.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    size_t slot = (address >> 4) % CALL_SITE_SLOTS;
+    for (size_t probe = 0; probe < CALL_SITE_SLOTS; ++probe)
+    {
+        uintptr_t current = fCallSites[slot].load(std::memory_order_relaxed);
+        if (current == 0
+            && fCallSites[slot].compare_exchange_strong(current, address, std::memory_order_relaxed))
+        {
+            current = address;
+        }
+        if (current == address)
+        {
+            fCallSiteContentions[slot].fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        slot = (slot + 1) % CALL_SITE_SLOTS;
+    }
+    fOtherContentions.fetch_add(1, std::memory_order_relaxed);
+}
+
+MutexProfile::Snapshot MutexProfile::snapshot(size_t maxCallSites) const
+{
+    Snapshot snapshot;
+    snapshot.name = fName;
+    snapshot.locks = fLocks.load(std::memory_order_relaxed);
+    snapshot.contentions = fContentions.load(std::memory_order_relaxed);
+    snapshot.wait = fWait.summary();
+    snapshot.hold = fHold.summary();
+
+    std::vector<std::pair<uint64_t, uintptr_t>> sites;
+    for (size_t slot = 0; slot < CALL_SITE_SLOTS; ++slot)
+    {
+        const uint64_t contentions = fCallSiteContentions[slot].load(std::memory_order_relaxed);
+        if (contentions > 0)
+        {
+            sites.emplace_back(contentions, fCallSites[slot].load(std::memory_order_relaxed));
+        }
+    }
+    std::sort(sites.begin(), sites.end(), std::greater<std::pair<uint64_t, uintptr_t>>());
+    for (size_t i = 0; i < sites.size() && i < maxCallSites; ++i)
+    {
+        snapshot.callSites.push_back(CallSite{symbolize(sites[i].second), sites[i].first});
+    }
+    const uint64_t other = fOtherContentions.load(std::memory_order_relaxed);
+    if (other > 0 && snapshot.callSites.size() < maxCallSites)
+    {
+        snapshot.callSites.push_back(CallSite{"<other>", other});
+    }
+    return snapshot;
+}
+
+void MutexProfile::reset()
+{
+    fLocks = 0;
+    fContentions = 0;
+    fWait.reset();
+    fHold.reset();
+    // the call site addresses stay allocated to their slots
+    for (auto& contentions : fCallSiteContentions)
+    {
+        contentions = 0;
+    }
+    fOtherContentions = 0;
+}
+
+} // namespace mutex
+} // namespace mcf
@@ -0,0 +1,46 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/MutexProfilePublisher.h"
+#include "mcf_core/MutexProfile.h"
+
+#include <memory>
+
+namespace mcf {
+
+MutexProfilePublisher::MutexProfilePublisher(std::chrono::milliseconds interval, size_t maxCallSites)
+: Component("MutexProfilePublisher")
+, fMaxCallSites(maxCallSites)
+, fStatsPort(*this, "Stats")
+{
+    registerPeriodicHandler(interval, std::bind(&MutexProfilePublisher::publish, this));
+}
+
+void MutexProfilePublisher::configure(IComponentConfig& config) {
+    config.registerPort(fStatsPort, DEFAULT_TOPIC);
+}
+
+void MutexProfilePublisher::publish() {
+    auto stats = std::make_unique<msg::MutexStats>();
+    for (const auto& snapshot : mutex::MutexProfile::snapshots(fMaxCallSites)) {
+        msg::MutexStatsEntry entry;
+        entry.name = snapshot.name;
+        entry.locks = snapshot.locks;
+        entry.contentions = snapshot.contentions;
+        entry.waitP50Ns = snapshot.wait.p50;
+        entry.waitP99Ns = snapshot.wait.p99;
+        entry.waitMaxNs = snapshot.wait.max;
+        entry.waitTotalNs = snapshot.wait.sum;
+        entry.holdP50Ns = snapshot.hold.p50;
+        entry.holdP99Ns = snapshot.hold.p99;
+        entry.holdMaxNs = snapshot.hold.max;
+        for (const auto& site : snapshot.callSites) {
+            entry.callSites.push_back(site.location);
+            entry.callSiteContentions.push_back(site.contentions);
+        }
+        stats->mutexes.push_back(std::move(entry));
+    }
+    fStatsPort.setValue(std::move(stats));
+}
+
+} // namespace mcf
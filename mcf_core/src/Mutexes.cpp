@@ -6,8 +6,12 @@
 
 #include "mcf_core/ErrorMacros.h"
 #include "mcf_core/LoggingMacros.h"
+#include "mcf_core/MutexProfile.h"
 #include "spdlog/fmt/fmt.h"
 
+#include <atomic>
+#include <cstdint>
+
 namespace mcf
 {
 namespace mutex
@@ -24,8 +28,39 @@ enum OptionalBool
     False,
     NotInitialized
 };
+
+/// Incremented by schedulingPolicyChanged(), invalidates the cached scheduling states
+std::atomic<uint64_t> schedulingGeneration(1);
+
+/**
+ * @brief The scheduling state of the calling thread as seen by the priority ceiling mutexes
+ */
+struct CachedSchedulingState
+{
+    /// The value of schedulingGeneration the state was queried at, 0 if never queried
+    uint64_t generation = 0;
+    /// Whether the thread's own policy is SCHED_FIFO or SCHED_RR
+    bool realtime = false;
+    /// Number of priority ceiling mutexes held with a temporary switch to SCHED_FIFO
+    int boosted = 0;
+};
+
+thread_local CachedSchedulingState cachedSchedulingState;
+
+bool
+cachedRealtime()
+{
+    return cachedSchedulingState.realtime
+           && cachedSchedulingState.generation == schedulingGeneration.load(std::memory_order_relaxed);
+}
 } // namespace
 
+void
+schedulingPolicyChanged()
+{
+    schedulingGeneration.fetch_add(1, std::memory_order_relaxed);
+}
+
 /**
  * @brief A singleton object wrapper that checks if real-time scheduling is available to us
  *
@@ -96,10 +131,74 @@ AbstractPosixThreadMutex::~AbstractPosixThreadMutex()
     }
 }
 
+#if MCF_ENABLE_MUTEX_PROFILING
+void
+AbstractPosixThreadMutex::setName(const char* name)
+{
+    _profile = &MutexProfile::get(name);
+}
+
+int
+AbstractPosixThreadMutex::lockInternal(const void* callSite) noexcept
+{
+    if (_profile == nullptr)
+    {
+        return pthread_mutex_lock(&_mutex);
+    }
+    // only a failing trylock makes the contended case pay for the clock reads
+    int ret = pthread_mutex_trylock(&_mutex);
+    if (ret == EBUSY)
+    {
+        const uint64_t start = MutexProfile::now();
+        ret = pthread_mutex_lock(&_mutex);
+        _lockedAt = MutexProfile::now();
+        _profile->recordContention(_lockedAt - start, callSite);
+    }
+    else if (ret == 0)
+    {
+        _lockedAt = MutexProfile::now();
+    }
+    if (ret == 0)
+    {
+        _profile->recordAcquisition();
+    }
+    return ret;
+}
+
+int
+AbstractPosixThreadMutex::unlockInternal() noexcept
+{
+    if (_profile != nullptr)
+    {
+        _profile->recordHold(MutexProfile::now() - _lockedAt);
+    }
+    return pthread_mutex_unlock(&_mutex);
+}
+
+int
+AbstractPosixThreadMutex::tryLockInternal(const void* callSite) noexcept
+{
+    int ret = pthread_mutex_trylock(&_mutex);
+    if (_profile != nullptr)
+    {
+        if (ret == 0)
+        {
+            _lockedAt = MutexProfile::now();
+            _profile->recordAcquisition();
+        }
+        else if (ret == EBUSY)
+        {
+            _profile->recordContention(0, callSite);
+        }
+    }
+    return ret;
+}
+#endif
+
 void
 SimpleAbstractPosixThreadMutex::lock()
 {
-    int ret = lockInternal();
+    int ret = lockInternal(__builtin_return_address(0));
 
     if (ret != 0)
     {
@@ -110,7 +209,7 @@ SimpleAbstractPosixThreadMutex::lock()
 bool
 SimpleAbstractPosixThreadMutex::try_lock()
 {
-    int ret = tryLockInternal();
+    int ret = tryLockInternal(__builtin_return_address(0));
     if (ret == EBUSY)
     {
         return false;
@@ -154,6 +253,107 @@ PriorityInheritanceMutex::PriorityInheritanceMutex()
     pthread_mutexattr_destroy(&attributes);
 }
 
+PriorityInheritanceSharedMutex::PriorityInheritanceSharedMutex()
+{
+    int ret = pthread_cond_init(&_drained, nullptr);
+    if (ret != 0)
+    {
+        MCF_THROW_RUNTIME(fmt::format("Could not initialize condition variable: {}", strerror(ret)));
+    }
+}
+
+PriorityInheritanceSharedMutex::~PriorityInheritanceSharedMutex()
+{
+    pthread_cond_destroy(&_drained);
+}
+
+void
+PriorityInheritanceSharedMutex::lock()
+{
+    _mutex.lock();
+    // sequentially consistent with the reader count, either a new reader sees the writer or
+    // the writer sees the reader
+    _writer.store(true);
+    if (_readers.load() != 0)
+    {
+        std::lock_guard<PriorityInheritanceMutex> lk(_drainMutex);
+        while (_readers.load() != 0)
+        {
+            pthread_cond_wait(&_drained, _drainMutex.native_handle());
+        }
+    }
+}
+
+bool
+PriorityInheritanceSharedMutex::try_lock()
+{
+    if (!_mutex.try_lock())
+    {
+        return false;
+    }
+    _writer.store(true);
+    if (_readers.load() != 0)
+    {
+        _writer.store(false);
+        _mutex.unlock();
+        return false;
+    }
+    return true;
+}
+
+void
+PriorityInheritanceSharedMutex::unlock() noexcept
+{
+    _writer.store(false);
+    _mutex.unlock();
+}
+
+void
+PriorityInheritanceSharedMutex::lock_shared()
+{
+    _readers.fetch_add(1);
+    if (!_writer.load())
+    {
+        return;
+    }
+    // a writer owns or waits for the mutex: back off and queue behind it on the inheritance mutex
+    readerLeft(_readers.fetch_sub(1) - 1);
+    std::lock_guard<PriorityInheritanceMutex> lk(_mutex);
+    // writers set _writer only while holding _mutex, so it is false now
+    _readers.fetch_add(1);
+}
+
+bool
+PriorityInheritanceSharedMutex::try_lock_shared() noexcept
+{
+    _readers.fetch_add(1);
+    if (!_writer.load())
+    {
+        return true;
+    }
+    readerLeft(_readers.fetch_sub(1) - 1);
+    return false;
+}
+
+void
+PriorityInheritanceSharedMutex::unlock_shared() noexcept
+{
+    readerLeft(_readers.fetch_sub(1) - 1);
+}
+
+void
+PriorityInheritanceSharedMutex::readerLeft(int remainingReaders) noexcept
+{
+    if (remainingReaders == 0 && _writer.load())
+    {
+        // signal under the mutex, so that the wake-up cannot get lost between the writer's check
+        // and its wait
+        pthread_mutex_lock(_drainMutex.native_handle());
+        pthread_cond_signal(&_drained);
+        pthread_mutex_unlock(_drainMutex.native_handle());
+    }
+}
+
 PriorityCeilingMutex::PriorityCeilingMutex(int ceiling)
 {
     // check if RT is available
@@ -200,15 +400,41 @@ PriorityCeilingMutex::PriorityCeilingMutex(int ceiling)
     }
 }
 
+template<typename LockFunction>
 int
-PriorityCeilingMutex::lockWithReschedule(const std::function<int()>& lockFunction)
+PriorityCeilingMutex::lockWithReschedule(LockFunction lockFunction)
 {
-    auto self = pthread_self();
     ThreadSchedulingState threadSchedulingState;
     threadSchedulingState.needReset = false;
 
+    if (!_realtimeCapable || cachedRealtime())
+    {
+        // no scheduling change needed, so there is no need to query the scheduling state
+        int ret = lockFunction();
+        if (ret == 0)
+        {
+            _threadSchedulingState = threadSchedulingState;
+            return ret;
+        }
+        if (!_realtimeCapable || ret != EINVAL)
+        {
+            return ret;
+        }
+        // the policy has been changed without schedulingPolicyChanged(), query it below
+        cachedSchedulingState.generation = 0;
+    }
+
+    auto self = pthread_self();
+    const uint64_t generation = schedulingGeneration.load(std::memory_order_relaxed);
     pthread_getschedparam(
         self, &threadSchedulingState.policy, &threadSchedulingState.parameters);
+    if (cachedSchedulingState.boosted == 0)
+    {
+        // while boosted, the queried policy is not the thread's own one
+        cachedSchedulingState.generation = generation;
+        cachedSchedulingState.realtime
+            = threadSchedulingState.policy == SCHED_FIFO || threadSchedulingState.policy == SCHED_RR;
+    }
 
     // When the current current scheduling scheme is not real-time, trying to acquire a
     // PTHREAD_PRIO_PROTECT mutex may lead to unexpected behavior
@@ -244,6 +470,10 @@ PriorityCeilingMutex::lockWithReschedule(const std::function<int()>& lockFunctio
     {
         // update threadSchedulingState
         _threadSchedulingState = threadSchedulingState;
+        if (threadSchedulingState.needReset)
+        {
+            ++cachedSchedulingState.boosted;
+        }
     }
 
     return ret;
@@ -252,7 +482,8 @@ PriorityCeilingMutex::lockWithReschedule(const std::function<int()>& lockFunctio
 void
 PriorityCeilingMutex::lock()
 {
-    auto lambda = [this]() { return lockInternal(); };
+    const void* callSite = __builtin_return_address(0);
+    auto lambda = [this, callSite]() { return lockInternal(callSite); };
     int ret     = lockWithReschedule(lambda);
 
     if (ret != 0)
@@ -266,7 +497,8 @@ PriorityCeilingMutex::lock()
 bool
 PriorityCeilingMutex::try_lock()
 {
-    auto lambda = [this]() { return tryLockInternal(); };
+    const void* callSite = __builtin_return_address(0);
+    auto lambda = [this, callSite]() { return tryLockInternal(callSite); };
     int ret     = lockWithReschedule(lambda);
 
     bool success = false;
@@ -298,6 +530,7 @@ PriorityCeilingMutex::unlock() noexcept
     // check if we own the mutex and if we have changed the thread's scheduling policy
     if (ret != EPERM && threadSchedulingState.needReset)
     {
+        --cachedSchedulingState.boosted;
         // reset the scheduling policy
         int error = resetScheduler(threadSchedulingState);
         if ((error != 0) && error != EINVAL)
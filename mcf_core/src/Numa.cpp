@@ -0,0 +1,296 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/Numa.h"
+#include "mcf_core/IExtMemValue.h"
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mcf
+{
+namespace
+{
+// node masks are a single unsigned long, like CPU masks
+constexpr int MAX_NUMA_NODES = 64;
+
+struct NodeCounters
+{
+    std::atomic<uint64_t> allocatedBytes{0};
+    std::atomic<uint64_t> migratedBytes{0};
+};
+
+std::array<NodeCounters, MAX_NUMA_NODES>&
+nodeCounters()
+{
+    static std::array<NodeCounters, MAX_NUMA_NODES> counters;
+    return counters;
+}
+
+std::string
+readFirstLine(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// the nodes of the system as mask, node 0 only if the system is not NUMA
+CpuMask
+onlineNodes()
+{
+    static const CpuMask nodes = [] {
+        try
+        {
+            const CpuMask mask = parseCpuList(readFirstLine("/sys/devices/system/node/online"));
+            return mask != 0 ? mask : CpuMask(1);
+        }
+        catch (const std::exception&)
+        {
+            return CpuMask(1);
+        }
+    }();
+    return nodes;
+}
+
+// the node of each CPU, -1 for unknown CPUs
+const std::array<int, 64>&
+cpuNodes()
+{
+    static const std::array<int, 64> nodes = [] {
+        std::array<int, 64> result;
+        result.fill(-1);
+        for (int node = 0; node < MAX_NUMA_NODES; ++node)
+        {
+            const CpuMask cpus = getNumaNodeCpus(node);
+            for (int cpu = 0; cpu < 64; ++cpu)
+            {
+                if (cpus & (CpuMask(1) << cpu))
+                {
+                    result[cpu] = node;
+                }
+            }
+        }
+        return result;
+    }();
+    return nodes;
+}
+
+long
+movePages(unsigned long count, void** pages, const int* nodes, int* status)
+{
+    return syscall(SYS_move_pages, 0, count, pages, nodes, status, MPOL_MF_MOVE);
+}
+
+size_t
+pageSize()
+{
+    const long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<size_t>(size) : 4096;
+}
+
+} // anonymous namespace
+
+int
+getNumaNodeCount()
+{
+    const CpuMask nodes = onlineNodes();
+    int count = 0;
+    for (int node = 0; node < MAX_NUMA_NODES; ++node)
+    {
+        if (nodes & (CpuMask(1) << node))
+        {
+            count = node + 1;
+        }
+    }
+    return count;
+}
+
+CpuMask
+getNumaNodeCpus(int node)
+{
+    if (node < 0 || node >= MAX_NUMA_NODES || !(onlineNodes() & (CpuMask(1) << node)))
+    {
+        return 0;
+    }
+    try
+    {
+        return parseCpuList(
+            readFirstLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+    }
+    catch (const std::exception&)
+    {
+        // e.g. a node beyond CPU 63, or no sysfs at all
+        return node == 0 ? getThreadCpuAffinity(pthread_self()) : 0;
+    }
+}
+
+int
+getCurrentNumaNode()
+{
+    const int cpu = sched_getcpu();
+    if (cpu < 0 || cpu >= 64)
+    {
+        return 0;
+    }
+    const int node = cpuNodes()[cpu];
+    return node >= 0 ? node : 0;
+}
+
+int
+setThreadNumaNode(int node)
+{
+    if (node >= MAX_NUMA_NODES)
+    {
+        return EINVAL;
+    }
+    long result = 0;
+    if (node < 0)
+    {
+        result = syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+    }
+    else
+    {
+        const unsigned long mask = 1UL << node;
+        result = syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, MAX_NUMA_NODES + 1);
+    }
+    return result == 0 ? 0 : errno;
+}
+
+int
+getMemoryNumaNode(const void* address)
+{
+    void* page = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(address) & ~(pageSize() - 1));
+    int status = -1;
+    // without target nodes, move_pages() only reports the node of each page
+    if (syscall(SYS_move_pages, 0, 1, &page, nullptr, &status, 0) != 0 || status < 0)
+    {
+        return -1;
+    }
+    return status;
+}
+
+size_t
+migrateToNumaNode(const void* address, size_t length, int node)
+{
+    if (node < 0 || node >= MAX_NUMA_NODES || length == 0)
+    {
+        return 0;
+    }
+    const size_t page = pageSize();
+    const uintptr_t begin = (reinterpret_cast<uintptr_t>(address) + page - 1) & ~(page - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(address) + length) & ~(page - 1);
+    if (end <= begin)
+    {
+        return 0;
+    }
+    const size_t count = (end - begin) / page;
+    std::vector<void*> pages(count);
+    std::vector<int> nodes(count, node);
+    std::vector<int> status(count, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        pages[i] = reinterpret_cast<void*>(begin + i * page);
+    }
+    if (movePages(count, pages.data(), nodes.data(), status.data()) < 0)
+    {
+        return 0;
+    }
+    size_t migrated = 0;
+    for (auto s : status)
+    {
+        if (s == node)
+        {
+            migrated += page;
+        }
+    }
+    nodeCounters()[node].migratedBytes.fetch_add(migrated, std::memory_order_relaxed);
+    return migrated;
+}
+
+void
+placeOnNumaNode(const Value& value, int node)
+{
+    const auto* extMem = dynamic_cast<const IExtMemValue*>(&value);
+    if (extMem != nullptr && extMem->extMemSize() > 0 && !extMem->extMemPlace(node))
+    {
+        migrateToNumaNode(extMem->extMemPtr(), extMem->extMemSize(), node);
+    }
+}
+
+void
+recordNumaAllocation(size_t bytes)
+{
+    nodeCounters()[getCurrentNumaNode()].allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+int
+dominantNumaNode(const std::vector<int>& consumerNodes)
+{
+    std::map<int, size_t> counts;
+    for (auto node : consumerNodes)
+    {
+        if (node >= 0)
+        {
+            ++counts[node];
+        }
+    }
+    int dominant = -1;
+    size_t maxCount = 0;
+    for (const auto& count : counts)
+    {
+        // ascending nodes, so ties keep the lower node
+        if (count.second > maxCount)
+        {
+            dominant = count.first;
+            maxCount = count.second;
+        }
+    }
+    return dominant;
+}
+
+std::vector<NumaNodeStatistics>
+getNumaStatistics()
+{
+    std::vector<NumaNodeStatistics> result;
+    const CpuMask nodes = onlineNodes();
+    for (int node = 0; node < MAX_NUMA_NODES; ++node)
+    {
+        if (!(nodes & (CpuMask(1) << node)))
+        {
+            continue;
+        }
+        NumaNodeStatistics statistics;
+        statistics.node = node;
+        statistics.allocatedBytes = nodeCounters()[node].allocatedBytes.load(std::memory_order_relaxed);
+        statistics.migratedBytes = nodeCounters()[node].migratedBytes.load(std::memory_order_relaxed);
+        std::ifstream numastat("/sys/devices/system/node/node" + std::to_string(node) + "/numastat");
+        std::string name;
+        uint64_t pages = 0;
+        while (numastat >> name >> pages)
+        {
+            if (name == "local_node")
+            {
+                statistics.localPages = pages;
+            }
+            else if (name == "other_node")
+            {
+                statistics.remotePages = pages;
+            }
+        }
+        result.push_back(statistics);
+    }
+    return result;
+}
+
+} // namespace mcf
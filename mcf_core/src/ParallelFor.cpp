@@ -0,0 +1,392 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/ParallelFor.h"
+#include "mcf_core/LoggingMacros.h"
+#include "mcf_core/Numa.h"
+#include "mcf_core/ThreadName.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+// chunks per thread if no grain is given, evening out chunks of different cost
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+// the limit of setParallelForThreadLimit(), passed on to the workers running chunks of the thread
+thread_local size_t tThreadLimit = 0;
+
+struct Job {
+    const std::function<void(size_t, size_t)>* body;
+    size_t begin;
+    size_t end;
+    size_t grain;
+    size_t numChunks;
+    // real-time policy and priority of the caller, SCHED_OTHER and 0 for other policies
+    int policy;
+    int priority;
+    // NUMA node of the caller
+    int node;
+    size_t threadLimit;
+    size_t maxHelpers;
+    // guarded by the mutex of the pool
+    size_t helpers = 0;
+    std::atomic<size_t> nextChunk{0};
+    std::atomic<size_t> doneChunks{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr error;
+};
+
+// runs chunks of the job until all of them are taken
+void runChunks(Job& job)
+{
+    for (size_t chunk = job.nextChunk++; chunk < job.numChunks; chunk = job.nextChunk++)
+    {
+        const size_t chunkBegin = job.begin + chunk * job.grain;
+        const size_t chunkEnd = std::min(chunkBegin + job.grain, job.end);
+        try
+        {
+            (*job.body)(chunkBegin, chunkEnd);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lk(job.mutex);
+            if (!job.error)
+            {
+                job.error = std::current_exception();
+            }
+        }
+        if (++job.doneChunks == job.numChunks)
+        {
+            std::lock_guard<std::mutex> lk(job.mutex);
+            job.finished.notify_all();
+        }
+    }
+}
+
+// switches a worker to the scheduling policy of a job for the lifetime of the object
+class SchedulingScope {
+public:
+    SchedulingScope(int policy, int priority)
+    {
+        int previousPolicy = SCHED_OTHER;
+        sched_param previous{};
+        if (policy == SCHED_OTHER
+            || pthread_getschedparam(pthread_self(), &previousPolicy, &previous) != 0
+            || (policy == previousPolicy && priority == previous.sched_priority))
+        {
+            return;
+        }
+        sched_param param{};
+        param.sched_priority = priority;
+        // without CAP_SYS_NICE the worker keeps its policy
+        if (pthread_setschedparam(pthread_self(), policy, &param) == 0)
+        {
+            fRestore = true;
+            fPolicy = previousPolicy;
+            fParam = previous;
+        }
+    }
+
+    ~SchedulingScope()
+    {
+        if (fRestore)
+        {
+            pthread_setschedparam(pthread_self(), fPolicy, &fParam);
+        }
+    }
+
+    SchedulingScope(const SchedulingScope&) = delete;
+    SchedulingScope& operator=(const SchedulingScope&) = delete;
+
+private:
+    bool fRestore = false;
+    int fPolicy = SCHED_OTHER;
+    sched_param fParam{};
+};
+
+class WorkerPool : public std::enable_shared_from_this<WorkerPool> {
+public:
+    explicit WorkerPool(size_t numWorkers)
+    : fNumWorkers(numWorkers)
+    {
+    }
+
+    /**
+     * Start a worker running on the given CPUs, preferring jobs of callers on the given node
+     */
+    void startWorker(size_t index, int node, CpuMask cpuAffinity)
+    {
+        auto self = shared_from_this();
+        std::thread([self, index, node, cpuAffinity] {
+            const std::string threadName = "mcf_parfor_" + std::to_string(index);
+            setThreadName(threadName);
+            int result = setThreadCpuAffinity(pthread_self(), cpuAffinity);
+            if (result != 0)
+            {
+                MCF_ERROR_NOFILELINE("Could not set CPU affinity {} of {}, error: {}",
+                                     formatCpuMask(cpuAffinity), threadName, strerror(result));
+            }
+            self->work(node);
+        }).detach();
+    }
+
+    size_t numWorkers() const
+    {
+        return fNumWorkers;
+    }
+
+    void stop()
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        fStopped = true;
+        fJobAvailable.notify_all();
+    }
+
+    void run(const std::shared_ptr<Job>& job)
+    {
+        {
+            std::lock_guard<std::mutex> lk(fMutex);
+            fJobs.push_back(job);
+        }
+        fJobAvailable.notify_all();
+
+        runChunks(*job);
+        {
+            std::unique_lock<std::mutex> lk(job->mutex);
+            job->finished.wait(lk, [&job] { return job->doneChunks == job->numChunks; });
+        }
+        {
+            // normally already removed by a worker
+            std::lock_guard<std::mutex> lk(fMutex);
+            auto it = std::find(fJobs.begin(), fJobs.end(), job);
+            if (it != fJobs.end())
+            {
+                fJobs.erase(it);
+            }
+        }
+    }
+
+private:
+    void work(int node)
+    {
+        std::unique_lock<std::mutex> lk(fMutex);
+        while (!fStopped)
+        {
+            std::shared_ptr<Job> job = takeJob(node);
+            if (job == nullptr)
+            {
+                fJobAvailable.wait(lk);
+                continue;
+            }
+            lk.unlock();
+            {
+                SchedulingScope scheduling(job->policy, job->priority);
+                tThreadLimit = job->threadLimit;
+                runChunks(*job);
+            }
+            lk.lock();
+        }
+    }
+
+    // the job of the highest priority caller which may take another helper, preferring callers
+    // on the given node and earlier calls, called with fMutex held
+    std::shared_ptr<Job> takeJob(int node)
+    {
+        // all chunks of these jobs are taken already
+        fJobs.erase(std::remove_if(fJobs.begin(), fJobs.end(),
+                                   [](const std::shared_ptr<Job>& job) { return job->nextChunk >= job->numChunks; }),
+                    fJobs.end());
+
+        std::shared_ptr<Job> best;
+        for (const auto& job : fJobs)
+        {
+            if (job->helpers < job->maxHelpers
+                && (best == nullptr || job->priority > best->priority
+                    || (job->priority == best->priority && job->node == node && best->node != node)))
+            {
+                best = job;
+            }
+        }
+        if (best != nullptr)
+        {
+            ++best->helpers;
+        }
+        return best;
+    }
+
+    const size_t fNumWorkers;
+    std::mutex fMutex;
+    std::condition_variable fJobAvailable;
+    std::vector<std::shared_ptr<Job>> fJobs;
+    bool fStopped = false;
+};
+
+std::shared_ptr<WorkerPool> createPool(const ParallelForConfig& config)
+{
+    size_t numThreads = config.numThreads;
+    if (numThreads == 0)
+    {
+        numThreads = config.cpuAffinity != 0 ? __builtin_popcountll(config.cpuAffinity)
+                                             : std::max(1u, std::thread::hardware_concurrency());
+    }
+    auto pool = std::make_shared<WorkerPool>(numThreads - 1);
+
+    // the CPUs of each node the workers may run on
+    std::vector<CpuMask> nodeCpus;
+    const int numNodes = getNumaNodeCount();
+    if (numNodes > 1)
+    {
+        for (int node = 0; node < numNodes; ++node)
+        {
+            const CpuMask cpus = getNumaNodeCpus(node) & (config.cpuAffinity != 0 ? config.cpuAffinity : ~CpuMask(0));
+            nodeCpus.push_back(cpus);
+        }
+        if (std::all_of(nodeCpus.begin(), nodeCpus.end(), [](CpuMask cpus) { return cpus == 0; }))
+        {
+            // the affinity names no CPU of the system, setting it fails for each worker
+            nodeCpus.clear();
+        }
+    }
+
+    size_t node = 0;
+    for (size_t i = 0; i + 1 < numThreads; ++i)
+    {
+        if (nodeCpus.empty())
+        {
+            pool->startWorker(i, 0, config.cpuAffinity);
+            continue;
+        }
+        // round robin over the nodes with allowed CPUs
+        while (nodeCpus[node % nodeCpus.size()] == 0)
+        {
+            ++node;
+        }
+        const size_t workerNode = node++ % nodeCpus.size();
+        pool->startWorker(i, static_cast<int>(workerNode), nodeCpus[workerNode]);
+    }
+    return pool;
+}
+
+// intentionally leaked: the workers are never joined and may still wait at process exit
+std::shared_ptr<WorkerPool>& poolInstance()
+{
+    static auto* pool = new std::shared_ptr<WorkerPool>(createPool(ParallelForConfig()));
+    return *pool;
+}
+
+std::shared_ptr<WorkerPool> currentPool()
+{
+    return std::atomic_load(&poolInstance());
+}
+
+} // anonymous namespace
+
+void configureParallelFor(const ParallelForConfig& config)
+{
+    auto previous = std::atomic_exchange(&poolInstance(), createPool(config));
+    previous->stop();
+}
+
+void setParallelForThreadLimit(size_t maxThreads)
+{
+    tThreadLimit = maxThreads;
+}
+
+size_t getParallelForThreadLimit()
+{
+    return tThreadLimit;
+}
+
+size_t parallelForThreads()
+{
+    return currentPool()->numWorkers() + 1;
+}
+
+size_t parallelForGrain(size_t count, size_t grain)
+{
+    if (grain > 0)
+    {
+        return grain;
+    }
+    size_t numThreads = parallelForThreads();
+    if (tThreadLimit > 0)
+    {
+        numThreads = std::min(numThreads, tThreadLimit);
+    }
+    const size_t numChunks = numThreads * CHUNKS_PER_THREAD;
+    return std::max<size_t>(1, (count + numChunks - 1) / numChunks);
+}
+
+void parallelFor(size_t begin, size_t end, size_t grain,
+                 const std::function<void(size_t, size_t)>& body)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    const size_t count = end - begin;
+    std::shared_ptr<WorkerPool> pool = currentPool();
+    grain = parallelForGrain(count, grain);
+    if (grain >= count || pool->numWorkers() == 0 || tThreadLimit == 1)
+    {
+        std::exception_ptr error;
+        for (size_t chunkBegin = begin; chunkBegin < end; chunkBegin += std::min(grain, end - chunkBegin))
+        {
+            try
+            {
+                body(chunkBegin, chunkBegin + std::min(grain, end - chunkBegin));
+            }
+            catch (...)
+            {
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->body = &body;
+    job->begin = begin;
+    job->end = end;
+    job->grain = grain;
+    job->numChunks = (count + grain - 1) / grain;
+    sched_param param{};
+    if (pthread_getschedparam(pthread_self(), &job->policy, &param) != 0
+        || (job->policy != SCHED_FIFO && job->policy != SCHED_RR))
+    {
+        job->policy = SCHED_OTHER;
+        param.sched_priority = 0;
+    }
+    job->priority = param.sched_priority;
+    job->node = getNumaNodeCount() > 1 ? getCurrentNumaNode() : 0;
+    job->threadLimit = tThreadLimit;
+    job->maxHelpers = tThreadLimit > 0 ? tThreadLimit - 1 : std::numeric_limits<size_t>::max();
+    pool->run(job);
+    if (job->error)
+    {
+        std::rethrow_exception(job->error);
+    }
+}
+
+} // namespace mcf
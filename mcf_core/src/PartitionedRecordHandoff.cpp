@@ -0,0 +1,293 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/PartitionedRecordHandoff.h"
+
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/LoggingMacros.h"
+
+#include "json/json.h"
+#include "spdlog/fmt/fmt.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <stdexcept>
+
+namespace mcf {
+
+namespace {
+
+/**
+ * Split filename before its extension, like the segments of a rotating recorder
+ */
+size_t extensionPosition(const std::string& filename)
+{
+    const size_t separator = filename.find_last_of('/');
+    const size_t extension = filename.find_last_of('.');
+    if (extension == std::string::npos
+        || (separator != std::string::npos && extension < separator)
+        || extension == (separator == std::string::npos ? 0 : separator + 1))
+    {
+        return filename.size();
+    }
+    return extension;
+}
+
+std::string partitionFilename(const std::string& filename, const std::string& partition)
+{
+    const size_t extension = extensionPosition(filename);
+    return fmt::format("{}_{}{}", filename.substr(0, extension), partition, filename.substr(extension));
+}
+
+std::string directoryOf(const std::string& filename)
+{
+    const size_t separator = filename.find_last_of('/');
+    return separator == std::string::npos ? std::string() : filename.substr(0, separator + 1);
+}
+
+std::string baseName(const std::string& filename)
+{
+    const size_t separator = filename.find_last_of('/');
+    return separator == std::string::npos ? filename : filename.substr(separator + 1);
+}
+
+bool matchesAny(const std::vector<std::string>& patterns, const std::string& topic)
+{
+    return std::any_of(patterns.begin(), patterns.end(),
+        [&topic](const std::string& pattern) { return ValueStore::matchesPattern(pattern, topic); });
+}
+
+} // anonymous namespace
+
+constexpr const char* PartitionedRecordHandoff::OTHER_PARTITION;
+
+PartitionedRecordHandoff::PartitionedRecordHandoff(const TypeRegistry& typeRegistry,
+                                                   std::vector<Partition> partitions)
+{
+    bool hasOther = false;
+    for (auto& partition : partitions)
+    {
+        MCF_ASSERT(!partition.name.empty() && partition.name.find('/') == std::string::npos,
+                   fmt::format("Invalid record partition name '{}'", partition.name));
+        MCF_ASSERT(std::none_of(fPartitions.begin(), fPartitions.end(),
+                       [&partition](const std::unique_ptr<PartitionRecorder>& other)
+                       { return other->partition.name == partition.name; }),
+                   fmt::format("Duplicate record partition name '{}'", partition.name));
+        hasOther = hasOther || partition.topics.empty();
+        fPartitions.push_back(std::make_unique<PartitionRecorder>(typeRegistry));
+        fPartitions.back()->partition = std::move(partition);
+        fPartitions.back()->partition.files.clear();
+    }
+    if (!hasOther)
+    {
+        MCF_ASSERT(std::none_of(fPartitions.begin(), fPartitions.end(),
+                       [](const std::unique_ptr<PartitionRecorder>& other)
+                       { return other->partition.name == OTHER_PARTITION; }),
+                   fmt::format("Record partition '{}' needs to take all remaining topics", OTHER_PARTITION));
+        fPartitions.push_back(std::make_unique<PartitionRecorder>(typeRegistry));
+        fPartitions.back()->partition.name = OTHER_PARTITION;
+    }
+}
+
+PartitionedRecordHandoff::~PartitionedRecordHandoff()
+{
+    close();
+}
+
+ValueRecorder& PartitionedRecordHandoff::getRecorder(const std::string& partition)
+{
+    for (auto& partitionRecorder : fPartitions)
+    {
+        if (partitionRecorder->partition.name == partition)
+        {
+            return partitionRecorder->recorder;
+        }
+    }
+    throw std::out_of_range("Unknown record partition " + partition);
+}
+
+int PartitionedRecordHandoff::open(const std::string& filename)
+{
+    fFilename = filename;
+    fRoutes.clear();
+    for (auto& partitionRecorder : fPartitions)
+    {
+        partitionRecorder->recorder.start(partitionFilename(filename, partitionRecorder->partition.name));
+        if (!partitionRecorder->recorder.isStarted())
+        {
+            close();
+            return EIO;
+        }
+    }
+    return writeManifest();
+}
+
+int PartitionedRecordHandoff::handOff(const std::string& topic,
+                                      std::chrono::high_resolution_clock::time_point time,
+                                      const ValuePtr& value,
+                                      uint64_t seq,
+                                      const TypeRegistry::TypemapEntry& /*typeInfo*/,
+                                      bool extMem)
+{
+    auto it = fRoutes.find(topic);
+    if (it == fRoutes.end())
+    {
+        it = fRoutes.emplace(topic, Route{&findPartition(topic), false}).first;
+    }
+    Route& route = it->second;
+    if (extMem && !route.extMem)
+    {
+        // the ext mem setting is made on the handing recorder, which may change it any time
+        route.partition->recorder.enableExtMemSerialization(topic);
+        route.extMem = true;
+    }
+    route.partition->recorder.recordValue(topic, value, time, seq);
+    return 0;
+}
+
+int PartitionedRecordHandoff::close()
+{
+    bool started = false;
+    // the partitions write the values handed over so far in parallel
+    for (auto& partitionRecorder : fPartitions)
+    {
+        started = started || partitionRecorder->recorder.isStarted();
+        partitionRecorder->recorder.requestStop();
+    }
+    for (auto& partitionRecorder : fPartitions)
+    {
+        partitionRecorder->recorder.stop();
+    }
+    return started ? writeManifest() : 0;
+}
+
+PartitionedRecordHandoff::PartitionRecorder& PartitionedRecordHandoff::findPartition(const std::string& topic) const
+{
+    PartitionRecorder* other = nullptr;
+    for (const auto& partitionRecorder : fPartitions)
+    {
+        if (partitionRecorder->partition.topics.empty())
+        {
+            other = other == nullptr ? partitionRecorder.get() : other;
+        }
+        else if (matchesAny(partitionRecorder->partition.topics, topic))
+        {
+            return *partitionRecorder;
+        }
+    }
+    return *other;
+}
+
+int PartitionedRecordHandoff::writeManifest() const
+{
+    Json::Value partitions(Json::arrayValue);
+    for (const auto& partitionRecorder : fPartitions)
+    {
+        Json::Value node;
+        node["name"] = partitionRecorder->partition.name;
+        node["topics"] = Json::Value(Json::arrayValue);
+        for (const auto& topic : partitionRecorder->partition.topics)
+        {
+            node["topics"].append(topic);
+        }
+        // relative to the manifest, so that recordings can be moved
+        node["files"] = Json::Value(Json::arrayValue);
+        for (const auto& file : partitionRecorder->recorder.getRecordFiles())
+        {
+            node["files"].append(baseName(file));
+        }
+        partitions.append(node);
+    }
+    Json::Value root;
+    root["partitions"] = partitions;
+
+    const std::string manifest = manifestFilename(fFilename);
+    std::ofstream stream(manifest, std::ios::trunc);
+    stream << Json::writeString(Json::StreamWriterBuilder(), root);
+    if (!stream)
+    {
+        MCF_ERROR_NOFILELINE("Cannot write record partition manifest {}", manifest);
+        return EIO;
+    }
+    return 0;
+}
+
+std::string PartitionedRecordHandoff::manifestFilename(const std::string& filename)
+{
+    return filename.substr(0, extensionPosition(filename)) + ".partitions.json";
+}
+
+std::vector<PartitionedRecordHandoff::Partition> PartitionedRecordHandoff::readManifest(const std::string& manifest)
+{
+    std::ifstream stream(manifest);
+    if (!stream)
+    {
+        MCF_THROW_RUNTIME("Cannot open record partition manifest " + manifest);
+    }
+    Json::CharReaderBuilder builder;
+    Json::Value root;
+    std::string errors;
+    if (!Json::parseFromStream(builder, stream, &root, &errors))
+    {
+        MCF_THROW_RUNTIME(fmt::format("Cannot parse record partition manifest {}: {}", manifest, errors));
+    }
+
+    const std::string directory = directoryOf(manifest);
+    std::vector<Partition> partitions;
+    for (const auto& node : root["partitions"])
+    {
+        Partition partition;
+        partition.name = node["name"].asString();
+        for (const auto& topic : node["topics"])
+        {
+            partition.topics.push_back(topic.asString());
+        }
+        for (const auto& file : node["files"])
+        {
+            partition.files.push_back(directory + file.asString());
+        }
+        partitions.push_back(std::move(partition));
+    }
+    return partitions;
+}
+
+std::vector<std::string> PartitionedRecordHandoff::selectFiles(const std::string& manifest,
+                                                               const std::vector<std::string>& topics)
+{
+    const std::vector<Partition> partitions = readManifest(manifest);
+    std::vector<bool> selected(partitions.size(), false);
+    for (const auto& topic : topics)
+    {
+        // the same choice as findPartition()
+        size_t match = partitions.size();
+        for (size_t i = 0; i < partitions.size(); ++i)
+        {
+            if (partitions[i].topics.empty())
+            {
+                match = match == partitions.size() ? i : match;
+            }
+            else if (matchesAny(partitions[i].topics, topic))
+            {
+                match = i;
+                break;
+            }
+        }
+        if (match < partitions.size())
+        {
+            selected[match] = true;
+        }
+    }
+
+    std::vector<std::string> files;
+    for (size_t i = 0; i < partitions.size(); ++i)
+    {
+        if (selected[i])
+        {
+            files.insert(files.end(), partitions[i].files.begin(), partitions[i].files.end());
+        }
+    }
+    return files;
+}
+
+} // namespace mcf
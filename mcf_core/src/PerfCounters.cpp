@@ -0,0 +1,226 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/PerfCounters.h"
+
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MCF_PERF_RDPMC 1
+#endif
+
+#include <cstring>
+#include <memory>
+
+namespace mcf {
+
+namespace {
+
+// the counters of the thread, and whether opening them was tried already
+thread_local std::unique_ptr<ThreadPerfCounters> tCounters;
+thread_local bool tOpened = false;
+
+int perfEventOpen(uint32_t type, uint64_t config, bool userOnly, int groupFd, bool group)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = userOnly ? 1 : 0;
+    attr.exclude_hv = 1;
+    if (group) {
+        attr.read_format = PERF_FORMAT_GROUP;
+    }
+    // the calling thread on any CPU
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+}
+
+#ifdef MCF_PERF_RDPMC
+// the count of an mmap()ed counter, see the description of perf_event_mmap_page
+bool readRdpmc(const void* page, uint64_t& count)
+{
+    const auto* pc = static_cast<const volatile perf_event_mmap_page*>(page);
+    uint32_t sequence;
+    do {
+        sequence = pc->lock;
+        __asm__ __volatile__("" ::: "memory");
+        const uint32_t index = pc->index;
+        if (!pc->cap_user_rdpmc || index == 0) {
+            // not on the PMU right now, e.g. multiplexed with other events
+            return false;
+        }
+        const uint16_t width = pc->pmc_width;
+        uint64_t pmc = __rdpmc(static_cast<int>(index - 1));
+        pmc <<= 64 - width;
+        pmc >>= 64 - width;
+        count = pc->offset + pmc;
+        __asm__ __volatile__("" ::: "memory");
+    } while (pc->lock != sequence);
+    return true;
+}
+#endif
+
+} // anonymous namespace
+
+ThreadPerfCounters* ThreadPerfCounters::current()
+{
+    if (!tOpened) {
+        tOpened = true;
+        std::unique_ptr<ThreadPerfCounters> counters(new ThreadPerfCounters());
+        if (counters->open()) {
+            tCounters = std::move(counters);
+        }
+    }
+    return tCounters.get();
+}
+
+ThreadPerfCounters::~ThreadPerfCounters()
+{
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < NUM_HARDWARE; ++i) {
+        if (fPages[i] != nullptr) {
+            munmap(fPages[i], pageSize);
+        }
+    }
+    // members of the group first
+    for (size_t i = NUM_HARDWARE; i-- > 0;) {
+        if (fHardware[i] >= 0) {
+            close(fHardware[i]);
+        }
+    }
+    if (fContextSwitches >= 0) {
+        close(fContextSwitches);
+    }
+}
+
+bool ThreadPerfCounters::open()
+{
+    const uint64_t hardware[NUM_HARDWARE] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES};
+    fHardware[0] = perfEventOpen(PERF_TYPE_HARDWARE, hardware[0], true, -1, true);
+    if (fHardware[0] < 0) {
+        return false;
+    }
+    fGroupIndex[0] = fGroupSize++;
+    for (size_t i = 1; i < NUM_HARDWARE; ++i) {
+        fHardware[i] = perfEventOpen(PERF_TYPE_HARDWARE, hardware[i], true, fHardware[0], true);
+        if (fHardware[i] >= 0) {
+            fGroupIndex[i] = fGroupSize++;
+        }
+    }
+    // switches happen in the kernel, so kernel events must be counted
+    fContextSwitches = perfEventOpen(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, false, -1, false);
+
+#ifdef MCF_PERF_RDPMC
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    fRdpmc = true;
+    for (size_t i = 0; i < NUM_HARDWARE; ++i) {
+        if (fHardware[i] < 0) {
+            continue;
+        }
+        void* page = mmap(nullptr, pageSize, PROT_READ, MAP_SHARED, fHardware[i], 0);
+        if (page == MAP_FAILED) {
+            fRdpmc = false;
+            continue;
+        }
+        fPages[i] = page;
+        if (!static_cast<const perf_event_mmap_page*>(page)->cap_user_rdpmc) {
+            fRdpmc = false;
+        }
+    }
+#endif
+    return true;
+}
+
+bool ThreadPerfCounters::read(PerfCounterValues& values) const
+{
+    uint64_t counts[NUM_HARDWARE] = {};
+    if (!readHardware(counts)) {
+        return false;
+    }
+    values.cycles = counts[0];
+    values.instructions = counts[1];
+    values.cacheMisses = counts[2];
+    values.branchMisses = counts[3];
+    values.contextSwitches = 0;
+    if (fContextSwitches >= 0
+        && ::read(fContextSwitches, &values.contextSwitches, sizeof(uint64_t)) != sizeof(uint64_t)) {
+        return false;
+    }
+    return true;
+}
+
+bool ThreadPerfCounters::readHardware(uint64_t* counts) const
+{
+#ifdef MCF_PERF_RDPMC
+    if (fRdpmc) {
+        bool complete = true;
+        for (size_t i = 0; i < NUM_HARDWARE && complete; ++i) {
+            if (fHardware[i] >= 0) {
+                complete = readRdpmc(fPages[i], counts[i]);
+            }
+        }
+        if (complete) {
+            return true;
+        }
+    }
+#endif
+    // number of counters followed by their counts, see PERF_FORMAT_GROUP
+    uint64_t group[1 + NUM_HARDWARE] = {};
+    const ssize_t size = static_cast<ssize_t>((1 + fGroupSize) * sizeof(uint64_t));
+    if (::read(fHardware[0], group, size) != size || group[0] != fGroupSize) {
+        return false;
+    }
+    for (size_t i = 0; i < NUM_HARDWARE; ++i) {
+        counts[i] = fHardware[i] >= 0 ? group[1 + fGroupIndex[i]] : 0;
+    }
+    return true;
+}
+
+bool PerfCounterSample::stop(PerfCounterValues& delta) const
+{
+    PerfCounterValues end;
+    if (fCounters == nullptr || !fCounters->read(end)) {
+        return false;
+    }
+    delta.cycles = end.cycles - fStart.cycles;
+    delta.instructions = end.instructions - fStart.instructions;
+    delta.cacheMisses = end.cacheMisses - fStart.cacheMisses;
+    delta.branchMisses = end.branchMisses - fStart.branchMisses;
+    delta.contextSwitches = end.contextSwitches - fStart.contextSwitches;
+    return true;
+}
+
+PerfCounterTotals::Summary PerfCounterTotals::summary() const
+{
+    Summary summary;
+    summary.runs = fRuns.load(std::memory_order_relaxed);
+    summary.sum.cycles = fCycles.load(std::memory_order_relaxed);
+    summary.sum.instructions = fInstructions.load(std::memory_order_relaxed);
+    summary.sum.cacheMisses = fCacheMisses.load(std::memory_order_relaxed);
+    summary.sum.branchMisses = fBranchMisses.load(std::memory_order_relaxed);
+    summary.sum.contextSwitches = fContextSwitches.load(std::memory_order_relaxed);
+    return summary;
+}
+
+PerfCounterTotals::Summary PerfCounterTotals::takeSummary()
+{
+    Summary summary;
+    summary.runs = fRuns.exchange(0, std::memory_order_relaxed);
+    summary.sum.cycles = fCycles.exchange(0, std::memory_order_relaxed);
+    summary.sum.instructions = fInstructions.exchange(0, std::memory_order_relaxed);
+    summary.sum.cacheMisses = fCacheMisses.exchange(0, std::memory_order_relaxed);
+    summary.sum.branchMisses = fBranchMisses.exchange(0, std::memory_order_relaxed);
+    summary.sum.contextSwitches = fContextSwitches.exchange(0, std::memory_order_relaxed);
+    return summary;
+}
+
+} // namespace mcf
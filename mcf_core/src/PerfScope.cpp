@@ -0,0 +1,351 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/PerfScope.h"
+#include "mcf_core/Messages.h"
+#include "mcf_core/ThreadName.h"
+#include "mcf_core/TraceClock.h"
+#include "mcf_core/ValueStore.h"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace mcf {
+
+constexpr size_t PerfScopes::MAX_TAGS;
+
+const bool PerfScopes::fUseTsc = TraceClock::tscAvailable();
+
+namespace {
+
+using Counts = std::array<uint64_t, LatencyHistogram::NUM_BUCKETS>;
+
+// time the TSC is measured against the steady clock before converting ticks
+constexpr std::chrono::milliseconds MIN_CALIBRATION_TIME{10};
+
+// a histogram written by a single thread, so that plain loads and stores suffice
+struct TickHistogram {
+    std::array<std::atomic<uint64_t>, LatencyHistogram::NUM_BUCKETS> buckets{};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+
+    void record(uint64_t ticks)
+    {
+        ticks = std::min(ticks, LatencyHistogram::MAX_VALUE);
+        auto& bucket = buckets[LatencyHistogram::bucketIndex(ticks)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+        if (ticks > max.load(std::memory_order_relaxed))
+        {
+            max.store(ticks, std::memory_order_relaxed);
+        }
+    }
+};
+
+// the histograms of a thread, handed on to a new thread when the thread exits
+struct ThreadHistograms {
+    std::array<std::atomic<TickHistogram*>, PerfScopes::MAX_TAGS> tags{};
+    std::atomic<bool> inUse{true};
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> names;
+    // never freed, the aggregation reads histograms of exited threads
+    std::vector<ThreadHistograms*> threads;
+    // the totals per tag at the last takeSummaries()
+    std::vector<Counts> takenCounts;
+    std::vector<uint64_t> takenSums;
+    // the reference of the conversion of ticks to nanoseconds
+    const uint64_t startTicks = PerfScopes::now();
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    // the publisher thread
+    std::condition_variable wake;
+    std::condition_variable published;
+    bool publisherStarted = false;
+    bool publishing = false;
+    // the value store is in use without the mutex held
+    bool inFlight = false;
+    ValueStore* valueStore = nullptr;
+    std::chrono::milliseconds interval{1000};
+    std::string topic;
+};
+
+Registry& registry()
+{
+    // intentionally leaked: threads may record scopes during static destruction
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+struct LocalHistograms {
+    ThreadHistograms* histograms = nullptr;
+
+    ~LocalHistograms()
+    {
+        if (histograms != nullptr)
+        {
+            histograms->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local LocalHistograms tLocalHistograms;
+
+ThreadHistograms* acquireThreadHistograms()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lk(r.mutex);
+    for (ThreadHistograms* histograms : r.threads)
+    {
+        bool inUse = false;
+        if (histograms->inUse.compare_exchange_strong(inUse, true, std::memory_order_acquire))
+        {
+            return histograms;
+        }
+    }
+    r.threads.push_back(new ThreadHistograms());
+    return r.threads.back();
+}
+
+// nanoseconds per tick of the scope clock, called with the registry mutex held
+double nanosecondsPerTick(const Registry& r, bool useTsc)
+{
+    if (!useTsc)
+    {
+        return 1.;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - r.startTime;
+    if (elapsed < MIN_CALIBRATION_TIME)
+    {
+        std::this_thread::sleep_for(MIN_CALIBRATION_TIME - elapsed);
+    }
+    const uint64_t ticks = PerfScopes::now();
+    elapsed = std::chrono::steady_clock::now() - r.startTime;
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+        / double(ticks - r.startTicks);
+}
+
+LatencyHistogram::Summary toNanoseconds(const LatencyHistogram::Summary& ticks, double scale)
+{
+    auto convert = [scale](uint64_t value) { return static_cast<uint64_t>(double(value) * scale + 0.5); };
+    LatencyHistogram::Summary summary;
+    summary.count = ticks.count;
+    summary.sum = convert(ticks.sum);
+    summary.min = convert(ticks.min);
+    summary.p50 = convert(ticks.p50);
+    summary.p99 = convert(ticks.p99);
+    summary.p999 = convert(ticks.p999);
+    summary.max = convert(ticks.max);
+    return summary;
+}
+
+// the totals of a tag over all threads, called with the registry mutex held
+void collect(const Registry& r, uint32_t tag, Counts& counts, uint64_t& sum, uint64_t& max)
+{
+    counts.fill(0);
+    sum = 0;
+    max = 0;
+    for (const ThreadHistograms* thread : r.threads)
+    {
+        const TickHistogram* histogram = thread->tags[tag].load(std::memory_order_acquire);
+        if (histogram == nullptr)
+        {
+            continue;
+        }
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            counts[i] += histogram->buckets[i].load(std::memory_order_relaxed);
+        }
+        sum += histogram->sum.load(std::memory_order_relaxed);
+        max = std::max(max, histogram->max.load(std::memory_order_relaxed));
+    }
+}
+
+void publish()
+{
+    Registry& r = registry();
+    std::unique_lock<std::mutex> lk(r.mutex);
+    auto windowStart = std::chrono::steady_clock::now();
+    for (;;)
+    {
+        r.wake.wait_for(lk, r.interval);
+        const auto now = std::chrono::steady_clock::now();
+        if (!r.publishing || now - windowStart < r.interval)
+        {
+            if (!r.publishing)
+            {
+                windowStart = now;
+            }
+            continue;
+        }
+        ValueStore* valueStore = r.valueStore;
+        const std::string topic = r.topic;
+        r.inFlight = true;
+        lk.unlock();
+        auto stats = std::make_shared<msg::PerfScopeStats>();
+        stats->windowUs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - windowStart).count());
+        for (const auto& tag : PerfScopes::takeSummaries())
+        {
+            msg::PerfScopeLatency latency;
+            latency.name = tag.name;
+            latency.count = tag.latency.count;
+            latency.p50Ns = tag.latency.p50;
+            latency.p99Ns = tag.latency.p99;
+            latency.p999Ns = tag.latency.p999;
+            latency.maxNs = tag.latency.max;
+            stats->scopes.push_back(std::move(latency));
+        }
+        valueStore->setValue(topic, ValuePtr(std::move(stats)), false);
+        windowStart = now;
+        lk.lock();
+        r.inFlight = false;
+        r.published.notify_all();
+    }
+}
+
+} // anonymous namespace
+
+uint32_t PerfScopes::registerTag(const std::string& name)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lk(r.mutex);
+    auto it = r.ids.find(name);
+    if (it != r.ids.end())
+    {
+        return it->second;
+    }
+    if (r.names.size() >= MAX_TAGS)
+    {
+        return MAX_TAGS;
+    }
+    const auto id = static_cast<uint32_t>(r.names.size());
+    r.names.push_back(name);
+    r.ids.emplace(name, id);
+    return id;
+}
+
+void PerfScopes::record(uint32_t tag, uint64_t ticks)
+{
+    if (tag >= MAX_TAGS)
+    {
+        return;
+    }
+    ThreadHistograms* histograms = tLocalHistograms.histograms;
+    if (histograms == nullptr)
+    {
+        histograms = acquireThreadHistograms();
+        tLocalHistograms.histograms = histograms;
+    }
+    TickHistogram* histogram = histograms->tags[tag].load(std::memory_order_relaxed);
+    if (histogram == nullptr)
+    {
+        histogram = new TickHistogram();
+        histograms->tags[tag].store(histogram, std::memory_order_release);
+    }
+    histogram->record(ticks);
+}
+
+std::vector<PerfScopes::TagSummary> PerfScopes::summaries()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lk(r.mutex);
+    const double scale = nanosecondsPerTick(r, fUseTsc);
+    std::vector<TagSummary> result;
+    Counts counts;
+    for (uint32_t tag = 0; tag < r.names.size(); ++tag)
+    {
+        uint64_t sum;
+        uint64_t max;
+        collect(r, tag, counts, sum, max);
+        TagSummary summary;
+        summary.name = r.names[tag];
+        summary.latency = toNanoseconds(LatencyHistogram::summarize(counts, sum, max), scale);
+        result.push_back(std::move(summary));
+    }
+    return result;
+}
+
+std::vector<PerfScopes::TagSummary> PerfScopes::takeSummaries()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lk(r.mutex);
+    const double scale = nanosecondsPerTick(r, fUseTsc);
+    r.takenCounts.resize(r.names.size(), Counts{});
+    r.takenSums.resize(r.names.size(), 0);
+    std::vector<TagSummary> result;
+    Counts counts;
+    for (uint32_t tag = 0; tag < r.names.size(); ++tag)
+    {
+        uint64_t sum;
+        uint64_t max;
+        collect(r, tag, counts, sum, max);
+        // the histograms only grow, the window is the difference to the last totals
+        Counts window;
+        size_t highest = 0;
+        uint64_t count = 0;
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            window[i] = counts[i] - r.takenCounts[tag][i];
+            if (window[i] != 0)
+            {
+                highest = i;
+                count += window[i];
+            }
+        }
+        const uint64_t windowSum = sum - r.takenSums[tag];
+        r.takenCounts[tag] = counts;
+        r.takenSums[tag] = sum;
+        if (count == 0)
+        {
+            continue;
+        }
+        const uint64_t windowMax = std::min(max, LatencyHistogram::bucketUpperBound(highest));
+        TagSummary summary;
+        summary.name = r.names[tag];
+        summary.latency = toNanoseconds(LatencyHistogram::summarize(window, windowSum, windowMax), scale);
+        result.push_back(std::move(summary));
+    }
+    return result;
+}
+
+void PerfScopes::startPublishing(ValueStore& valueStore, std::chrono::milliseconds interval, const std::string& topic)
+{
+    Registry& r = registry();
+    std::unique_lock<std::mutex> lk(r.mutex);
+    r.published.wait(lk, [&r] { return !r.inFlight; });
+    r.valueStore = &valueStore;
+    r.interval = interval;
+    r.topic = topic;
+    r.publishing = true;
+    if (!r.publisherStarted)
+    {
+        r.publisherStarted = true;
+        // intentionally detached, like the registry it lives until the end of the process
+        std::thread([] {
+            setThreadName("mcf_perf");
+            publish();
+        }).detach();
+    }
+    r.wake.notify_all();
+}
+
+void PerfScopes::stopPublishing()
+{
+    Registry& r = registry();
+    std::unique_lock<std::mutex> lk(r.mutex);
+    r.publishing = false;
+    r.wake.notify_all();
+    // the value store may be destroyed when returning
+    r.published.wait(lk, [&r] { return !r.inFlight; });
+}
+
+} // namespace mcf
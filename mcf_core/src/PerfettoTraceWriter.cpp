@@ -0,0 +1,532 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/PerfettoTraceWriter.h"
+#include "mcf_core/ErrorMacros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace mcf {
+
+namespace {
+
+// field numbers of perfetto/trace/trace_packet.proto and the messages it contains
+constexpr uint32_t TRACE_PACKET = 1;
+
+constexpr uint32_t PACKET_TIMESTAMP = 8;
+constexpr uint32_t PACKET_SEQUENCE_ID = 10;
+constexpr uint32_t PACKET_TRACK_EVENT = 11;
+constexpr uint32_t PACKET_SEQUENCE_FLAGS = 13;
+constexpr uint32_t PACKET_TRACK_DESCRIPTOR = 60;
+
+constexpr uint32_t EVENT_DEBUG_ANNOTATIONS = 4;
+constexpr uint32_t EVENT_TYPE = 9;
+constexpr uint32_t EVENT_TRACK_UUID = 11;
+constexpr uint32_t EVENT_CATEGORIES = 22;
+constexpr uint32_t EVENT_NAME = 23;
+constexpr uint32_t EVENT_COUNTER_VALUE = 30;
+constexpr uint32_t EVENT_FLOW_IDS = 47;
+constexpr uint32_t EVENT_TERMINATING_FLOW_IDS = 48;
+
+constexpr uint32_t ANNOTATION_UINT_VALUE = 3;
+constexpr uint32_t ANNOTATION_STRING_VALUE = 6;
+constexpr uint32_t ANNOTATION_NAME = 10;
+
+constexpr uint32_t TRACK_UUID = 1;
+constexpr uint32_t TRACK_NAME = 2;
+constexpr uint32_t TRACK_PROCESS = 3;
+constexpr uint32_t TRACK_THREAD = 4;
+constexpr uint32_t TRACK_PARENT_UUID = 5;
+constexpr uint32_t TRACK_COUNTER = 8;
+
+constexpr uint32_t PROCESS_PID = 1;
+constexpr uint32_t PROCESS_NAME = 6;
+
+constexpr uint32_t THREAD_PID = 1;
+constexpr uint32_t THREAD_TID = 2;
+constexpr uint32_t THREAD_NAME = 5;
+
+// TrackEvent.Type
+constexpr uint32_t SLICE_BEGIN = 1;
+constexpr uint32_t SLICE_END = 2;
+constexpr uint32_t INSTANT = 3;
+constexpr uint32_t COUNTER = 4;
+
+constexpr uint32_t SEQ_INCREMENTAL_STATE_CLEARED = 1;
+constexpr uint64_t SEQUENCE_ID = 1;
+
+// writes remembered per topic for computing backlogs
+constexpr size_t MAX_TOPIC_WRITES = 4096;
+
+enum WireType : uint32_t { VARINT = 0, FIXED64 = 1, LENGTH_DELIMITED = 2 };
+
+void appendVarint(std::string& data, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        data.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<char>(value));
+}
+
+void appendTag(std::string& data, uint32_t field, WireType type)
+{
+    appendVarint(data, (static_cast<uint64_t>(field) << 3) | type);
+}
+
+void appendUint(std::string& data, uint32_t field, uint64_t value)
+{
+    appendTag(data, field, VARINT);
+    appendVarint(data, value);
+}
+
+void appendFixed64(std::string& data, uint32_t field, uint64_t value)
+{
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "fixed64 fields are little endian");
+    appendTag(data, field, FIXED64);
+    data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendBytes(std::string& data, uint32_t field, const std::string& bytes)
+{
+    appendTag(data, field, LENGTH_DELIMITED);
+    appendVarint(data, bytes.size());
+    data.append(bytes);
+}
+
+uint64_t nanoseconds(uint64_t microseconds)
+{
+    return microseconds * 1000;
+}
+
+// start time of a duration event in nanoseconds
+uint64_t startTime(const TraceRecord& record)
+{
+    const auto duration = static_cast<uint64_t>(std::llround(std::max(record.executionTime, 0.f) * 1.e9));
+    return nanoseconds(record.time) - std::min(duration, nanoseconds(record.time));
+}
+
+uint64_t topicKey(const TraceRecord& record)
+{
+    return (static_cast<uint64_t>(record.traceId) << 32) | record.topic;
+}
+
+} // anonymous namespace
+
+PerfettoTraceWriter::PerfettoTraceWriter(const std::string& filename, std::chrono::microseconds reorderWindow)
+: fReorderWindow(nanoseconds(reorderWindow.count()))
+{
+    fStream.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    MCF_ASSERT(fStream.is_open(), "Cannot open Perfetto trace " + filename);
+}
+
+PerfettoTraceWriter::~PerfettoTraceWriter()
+{
+    close();
+}
+
+void PerfettoTraceWriter::consume(const TraceRecord* records, size_t count)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    if (fClosed)
+    {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        const TraceRecord& record = records[i];
+        switch (record.type)
+        {
+            case TraceEventType::PORT_WRITE:
+                addPortEvent(EventKind::WRITE, "write ", record);
+                break;
+            case TraceEventType::PORT_READ:
+                addPortEvent(EventKind::READ, "read ", record);
+                break;
+            case TraceEventType::PORT_PEEK:
+                addPortEvent(EventKind::OTHER, "peek ", record);
+                break;
+            case TraceEventType::EXEC_TIME:
+            {
+                const uint64_t track = threadTrack(record);
+                std::string name = record.name != 0 ? plain(record.name) : "execution time";
+                addEvent(startTime(record), SLICE_BEGIN, track, std::move(name));
+                addEvent(nanoseconds(record.time), SLICE_END, track, std::string());
+                break;
+            }
+            case TraceEventType::REMOTE_TRANSFER_TIME:
+            {
+                const uint64_t track = transferTrack(record);
+                std::string name = record.name != 0 ? plain(record.name) : "remote transfer";
+                addEvent(startTime(record), SLICE_BEGIN, track, std::move(name));
+                addEvent(nanoseconds(record.time), SLICE_END, track, std::string());
+                break;
+            }
+            case TraceEventType::TRIGGER_ACTIVATION:
+            {
+                Event& event = addEvent(nanoseconds(record.time), INSTANT, threadTrack(record), "trigger activation");
+                event.topic = plain(record.topic);
+                break;
+            }
+            case TraceEventType::TRIGGER_EXEC:
+            {
+                const uint64_t track = threadTrack(record);
+                std::string name = record.name != 0 ? plain(record.name) : plain(record.topic);
+                Event& begin = addEvent(startTime(record), SLICE_BEGIN, track, std::move(name));
+                begin.topic = plain(record.topic);
+                addEvent(nanoseconds(record.time), SLICE_END, track, std::string());
+                break;
+            }
+            case TraceEventType::PROGRAM_FLOW:
+                addEvent(nanoseconds(record.time), INSTANT, threadTrack(record), plain(record.name));
+                break;
+            case TraceEventType::PERF_COUNTERS:
+            {
+                Event& event = addEvent(nanoseconds(record.time), INSTANT, threadTrack(record),
+                                        "perf counters " + plain(record.name));
+                event.counts = {{"cycles", record.inputIds[0]},
+                                {"instructions", record.inputIds[1]},
+                                {"cache misses", record.inputIds[2]},
+                                {"branch misses", record.inputIds[3]},
+                                {"context switches", record.valueId}};
+                break;
+            }
+            case TraceEventType::INPUT_IDS:
+                // not part of the trace
+                break;
+        }
+        fLatestTime = std::max(fLatestTime, nanoseconds(record.time));
+    }
+    writeEvents(fLatestTime > fReorderWindow ? fLatestTime - fReorderWindow : 0);
+}
+
+void PerfettoTraceWriter::close()
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    if (fClosed)
+    {
+        return;
+    }
+    fClosed = true;
+    writeEvents(std::numeric_limits<uint64_t>::max());
+    fStream.close();
+}
+
+uint64_t PerfettoTraceWriter::eventsWritten() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return fEventsWritten;
+}
+
+uint64_t PerfettoTraceWriter::lateEvents() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return fLateEvents;
+}
+
+uint64_t PerfettoTraceWriter::flowsWritten() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return fFlowsWritten;
+}
+
+PerfettoTraceWriter::Event& PerfettoTraceWriter::addEvent(uint64_t time, uint32_t type, uint64_t track,
+                                                          std::string name)
+{
+    const uint64_t sequence = fNextSequence++;
+    EventKey key{time, 0, sequence};
+    if (type == SLICE_BEGIN)
+    {
+        // slices are recorded when they end, so outer slices are recorded after inner ones
+        key.rank = 1;
+        key.order = std::numeric_limits<uint64_t>::max() - sequence;
+    }
+    Event& event = fPending[key];
+    event.type = type;
+    event.track = track;
+    event.name = std::move(name);
+    return event;
+}
+
+void PerfettoTraceWriter::addPortEvent(EventKind kind, const char* prefix, const TraceRecord& record)
+{
+    const std::string& topic = plain(record.topic);
+    Event& event = addEvent(nanoseconds(record.time), INSTANT, threadTrack(record), prefix + topic);
+    event.topic = topic;
+    event.valueId = record.valueId;
+    if (record.valueId == 0 || !record.connected || kind == EventKind::OTHER)
+    {
+        return;
+    }
+    event.kind = kind;
+    event.topicKey = topicKey(record);
+    const LinkKey key(record.valueId, event.topicKey);
+    if (kind == EventKind::WRITE)
+    {
+        fPendingWrites[key] = &event;
+        auto reads = fPendingReads.find(key);
+        if (reads != fPendingReads.end())
+        {
+            for (Event* read : reads->second)
+            {
+                link(event, *read);
+            }
+            fPendingReads.erase(reads);
+        }
+    }
+    else
+    {
+        event.backlogTrack = backlogTrack(record);
+        auto write = fPendingWrites.find(key);
+        if (write != fPendingWrites.end())
+        {
+            link(*write->second, event);
+        }
+        else
+        {
+            // recorded by another thread, its write may still come
+            fPendingReads[key].push_back(&event);
+        }
+    }
+}
+
+void PerfettoTraceWriter::link(Event& write, Event& read)
+{
+    // one flow per read, so that the arrows fan out from the write
+    const uint64_t flowId = fNextSequence++;
+    write.flowIds.push_back(flowId);
+    read.terminatingFlowIds.push_back(flowId);
+}
+
+void PerfettoTraceWriter::writeEvents(uint64_t maxTime)
+{
+    while (!fPending.empty() && fPending.begin()->first.time <= maxTime)
+    {
+        auto it = fPending.begin();
+        const Event& event = it->second;
+        uint64_t time = it->first.time;
+        if (time < fLastWrittenTime)
+        {
+            // arrived after later events were written
+            time = fLastWrittenTime;
+            ++fLateEvents;
+        }
+        fLastWrittenTime = time;
+        fFlowsWritten += event.flowIds.size();
+        writeEvent(time, event);
+
+        const LinkKey key(event.valueId, event.topicKey);
+        if (event.kind == EventKind::WRITE)
+        {
+            auto write = fPendingWrites.find(key);
+            if (write != fPendingWrites.end() && write->second == &event)
+            {
+                fPendingWrites.erase(write);
+            }
+            TopicWrites& writes = fTopicWrites[event.topicKey];
+            writes.sequences[event.valueId] = ++writes.written;
+            writes.valueIds.push_back(event.valueId);
+            if (writes.valueIds.size() > MAX_TOPIC_WRITES)
+            {
+                writes.sequences.erase(writes.valueIds.front());
+                writes.valueIds.pop_front();
+            }
+        }
+        else if (event.kind == EventKind::READ)
+        {
+            auto reads = fPendingReads.find(key);
+            if (reads != fPendingReads.end())
+            {
+                auto& pending = reads->second;
+                pending.erase(std::remove(pending.begin(), pending.end(), &event), pending.end());
+                if (pending.empty())
+                {
+                    fPendingReads.erase(reads);
+                }
+            }
+            const TopicWrites& writes = fTopicWrites[event.topicKey];
+            auto sequence = writes.sequences.find(event.valueId);
+            if (sequence != writes.sequences.end())
+            {
+                // the values written after the value read
+                Event backlog;
+                backlog.type = COUNTER;
+                backlog.track = event.backlogTrack;
+                backlog.counterValue = writes.written - sequence->second;
+                writeEvent(time, backlog);
+            }
+        }
+        fPending.erase(it);
+    }
+}
+
+void PerfettoTraceWriter::writeEvent(uint64_t time, const Event& event)
+{
+    std::string trackEvent;
+    appendUint(trackEvent, EVENT_TYPE, event.type);
+    appendUint(trackEvent, EVENT_TRACK_UUID, event.track);
+    if (event.type == COUNTER)
+    {
+        appendUint(trackEvent, EVENT_COUNTER_VALUE, event.counterValue);
+    }
+    if (!event.name.empty())
+    {
+        appendBytes(trackEvent, EVENT_CATEGORIES, "mcf");
+        appendBytes(trackEvent, EVENT_NAME, event.name);
+    }
+    if (!event.topic.empty())
+    {
+        std::string annotation;
+        appendBytes(annotation, ANNOTATION_NAME, "topic");
+        appendBytes(annotation, ANNOTATION_STRING_VALUE, event.topic);
+        appendBytes(trackEvent, EVENT_DEBUG_ANNOTATIONS, annotation);
+    }
+    if (event.valueId != 0)
+    {
+        std::string annotation;
+        appendBytes(annotation, ANNOTATION_NAME, "value id");
+        appendUint(annotation, ANNOTATION_UINT_VALUE, event.valueId);
+        appendBytes(trackEvent, EVENT_DEBUG_ANNOTATIONS, annotation);
+    }
+    for (const auto& count : event.counts)
+    {
+        std::string annotation;
+        appendBytes(annotation, ANNOTATION_NAME, count.first);
+        appendUint(annotation, ANNOTATION_UINT_VALUE, count.second);
+        appendBytes(trackEvent, EVENT_DEBUG_ANNOTATIONS, annotation);
+    }
+    for (uint64_t flowId : event.flowIds)
+    {
+        appendFixed64(trackEvent, EVENT_FLOW_IDS, flowId);
+    }
+    for (uint64_t flowId : event.terminatingFlowIds)
+    {
+        appendFixed64(trackEvent, EVENT_TERMINATING_FLOW_IDS, flowId);
+    }
+
+    std::string packet;
+    appendUint(packet, PACKET_TIMESTAMP, time);
+    appendBytes(packet, PACKET_TRACK_EVENT, trackEvent);
+    writePacket(packet);
+    ++fEventsWritten;
+}
+
+void PerfettoTraceWriter::writePacket(std::string packet)
+{
+    appendUint(packet, PACKET_SEQUENCE_ID, SEQUENCE_ID);
+    if (fFirstPacket)
+    {
+        appendUint(packet, PACKET_SEQUENCE_FLAGS, SEQ_INCREMENTAL_STATE_CLEARED);
+        fFirstPacket = false;
+    }
+    std::string data;
+    appendBytes(data, TRACE_PACKET, packet);
+    fStream.write(data.data(), data.size());
+}
+
+uint64_t PerfettoTraceWriter::processTrack(uint32_t traceId)
+{
+    auto it = fProcessTracks.find(traceId);
+    if (it != fProcessTracks.end())
+    {
+        return it->second;
+    }
+    const uint64_t uuid = fNextUuid++;
+    fProcessTracks.emplace(traceId, uuid);
+
+    // the trace id does not tell the process id, number the processes by their tracks
+    std::string process;
+    appendUint(process, PROCESS_PID, uuid);
+    appendBytes(process, PROCESS_NAME, plain(traceId));
+    std::string track;
+    appendUint(track, TRACK_UUID, uuid);
+    appendBytes(track, TRACK_PROCESS, process);
+    std::string packet;
+    appendBytes(packet, PACKET_TRACK_DESCRIPTOR, track);
+    writePacket(packet);
+    return uuid;
+}
+
+uint64_t PerfettoTraceWriter::threadTrack(const TraceRecord& record)
+{
+    const auto key = std::make_pair(record.traceId, record.threadId);
+    auto it = fThreadTracks.find(key);
+    if (it != fThreadTracks.end())
+    {
+        return it->second;
+    }
+    const uint64_t pid = processTrack(record.traceId);
+    const uint64_t uuid = fNextUuid++;
+    fThreadTracks.emplace(key, uuid);
+
+    std::string thread;
+    appendUint(thread, THREAD_PID, pid);
+    appendUint(thread, THREAD_TID, static_cast<uint64_t>(record.threadId));
+    // component threads run a single component
+    appendBytes(thread, THREAD_NAME, plain(record.component));
+    std::string track;
+    appendUint(track, TRACK_UUID, uuid);
+    appendBytes(track, TRACK_THREAD, thread);
+    std::string packet;
+    appendBytes(packet, PACKET_TRACK_DESCRIPTOR, track);
+    writePacket(packet);
+    return uuid;
+}
+
+uint64_t PerfettoTraceWriter::transferTrack(const TraceRecord& record)
+{
+    const auto key = std::make_pair(record.traceId, record.component);
+    auto it = fTransferTracks.find(key);
+    if (it == fTransferTracks.end())
+    {
+        const uint64_t uuid = childTrack(record.traceId, plain(record.component) + " remote transfers", false);
+        it = fTransferTracks.emplace(key, uuid).first;
+    }
+    return it->second;
+}
+
+uint64_t PerfettoTraceWriter::backlogTrack(const TraceRecord& record)
+{
+    const auto key = std::make_tuple(record.traceId, record.component, record.topic);
+    auto it = fBacklogTracks.find(key);
+    if (it == fBacklogTracks.end())
+    {
+        const uint64_t uuid = childTrack(
+            record.traceId, plain(record.component) + " backlog " + plain(record.topic), true);
+        it = fBacklogTracks.emplace(key, uuid).first;
+    }
+    return it->second;
+}
+
+uint64_t PerfettoTraceWriter::childTrack(uint32_t traceId, const std::string& name, bool counter)
+{
+    const uint64_t parent = processTrack(traceId);
+    const uint64_t uuid = fNextUuid++;
+    std::string track;
+    appendUint(track, TRACK_UUID, uuid);
+    appendBytes(track, TRACK_NAME, name);
+    appendUint(track, TRACK_PARENT_UUID, parent);
+    if (counter)
+    {
+        appendBytes(track, TRACK_COUNTER, std::string());
+    }
+    std::string packet;
+    appendBytes(packet, PACKET_TRACK_DESCRIPTOR, track);
+    writePacket(packet);
+    return uuid;
+}
+
+const std::string& PerfettoTraceWriter::plain(uint32_t string)
+{
+    auto it = fPlainStrings.find(string);
+    if (it == fPlainStrings.end())
+    {
+        it = fPlainStrings.emplace(string, TraceStringTable::instance().lookup(string)).first;
+    }
+    return it->second;
+}
+
+} // namespace mcf
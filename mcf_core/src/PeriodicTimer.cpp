@@ -0,0 +1,251 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/PeriodicTimer.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/LoggingMacros.h"
+#include "mcf_core/ThreadName.h"
+#include "mcf_core/ValueStore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace mcf {
+
+namespace {
+
+int64_t monotonicNowNs()
+{
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+} // anonymous namespace
+
+PeriodicTimer::PeriodicTimer(std::chrono::nanoseconds period,
+                             std::chrono::nanoseconds phase,
+                             std::shared_ptr<EventFlag> flag,
+                             std::string name)
+: fPeriod(period)
+, fPhase(phase)
+, fFlag(std::move(flag))
+, fName(std::move(name))
+{
+    MCF_ASSERT(fPeriod.count() > 0, "Timer period must be positive");
+    MCF_ASSERT(fPhase.count() >= 0, "Timer phase must not be negative");
+}
+
+int64_t PeriodicTimer::nextExpiry(int64_t nowNs) const
+{
+    const int64_t period = fPeriod.count();
+    const int64_t phase = fPhase.count() % period;
+    const int64_t sincePhase = nowNs - phase;
+    // floor division, the phase may lie in the future
+    int64_t periods = sincePhase / period;
+    if (sincePhase % period < 0)
+    {
+        --periods;
+    }
+    return phase + (periods + 1) * period;
+}
+
+void PeriodicTimer::expire(uint64_t expirations)
+{
+    fExpirations.fetch_add(expirations, std::memory_order_relaxed);
+    uint64_t overruns = expirations - 1;
+    if (!fFlag->activate(fName))
+    {
+        // the handler has not yet run for the previous expiry
+        ++overruns;
+    }
+    if (overruns > 0)
+    {
+        fOverruns.fetch_add(overruns, std::memory_order_relaxed);
+    }
+}
+
+PeriodicTimerService::PeriodicTimerService()
+: fTimerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK))
+, fWakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+{
+    if (fTimerFd < 0 || fWakeFd < 0)
+    {
+        const int error = errno;
+        if (fTimerFd >= 0)
+        {
+            close(fTimerFd);
+        }
+        if (fWakeFd >= 0)
+        {
+            close(fWakeFd);
+        }
+        MCF_THROW_RUNTIME(fmt::format("Could not create timer: {}", strerror(error)));
+    }
+    fThread = std::thread([this] {
+        setThreadName("mcf_timer");
+        run();
+    });
+}
+
+PeriodicTimerService::~PeriodicTimerService()
+{
+    fStopRequest = true;
+    wake();
+    fThread.join();
+    close(fTimerFd);
+    close(fWakeFd);
+}
+
+std::shared_ptr<PeriodicTimerService> PeriodicTimerService::shared()
+{
+    static std::mutex mutex;
+    static std::weak_ptr<PeriodicTimerService> instance;
+    std::lock_guard<std::mutex> lk(mutex);
+    auto service = instance.lock();
+    if (!service)
+    {
+        service = std::make_shared<PeriodicTimerService>();
+        instance = service;
+    }
+    return service;
+}
+
+void PeriodicTimerService::add(const std::shared_ptr<PeriodicTimer>& timer)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    if (std::find(fTimers.begin(), fTimers.end(), timer) != fTimers.end())
+    {
+        return;
+    }
+    timer->fNext = timer->nextExpiry(monotonicNowNs());
+    fTimers.push_back(timer);
+    arm();
+}
+
+void PeriodicTimerService::remove(const std::shared_ptr<PeriodicTimer>& timer)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    fTimers.erase(std::remove(fTimers.begin(), fTimers.end(), timer), fTimers.end());
+    arm();
+}
+
+void PeriodicTimerService::addOneShot(std::chrono::nanoseconds delay, std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    fOneShots.emplace_back(monotonicNowNs() + std::max<int64_t>(0, delay.count()), std::move(callback));
+    arm();
+}
+
+void PeriodicTimerService::arm()
+{
+    // an all-zero expiry disarms the timer
+    itimerspec spec{};
+    if (!fTimers.empty() || !fOneShots.empty())
+    {
+        int64_t next = std::numeric_limits<int64_t>::max();
+        for (const auto& timer : fTimers)
+        {
+            next = std::min(next, timer->fNext);
+        }
+        for (const auto& oneShot : fOneShots)
+        {
+            next = std::min(next, oneShot.first);
+        }
+        spec.it_value.tv_sec = next / 1000000000;
+        spec.it_value.tv_nsec = next % 1000000000;
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+        {
+            spec.it_value.tv_nsec = 1;
+        }
+    }
+    if (timerfd_settime(fTimerFd, TFD_TIMER_ABSTIME, &spec, nullptr) != 0)
+    {
+        MCF_ERROR_NOFILELINE("Could not arm timer: {}", strerror(errno));
+    }
+}
+
+void PeriodicTimerService::wake()
+{
+    const uint64_t one = 1;
+    if (write(fWakeFd, &one, sizeof(one)) != sizeof(one))
+    {
+        MCF_ERROR_NOFILELINE("Could not wake timer thread: {}", strerror(errno));
+    }
+}
+
+void PeriodicTimerService::run()
+{
+    pollfd fds[2] = {{fTimerFd, POLLIN, 0}, {fWakeFd, POLLIN, 0}};
+    std::vector<std::pair<std::shared_ptr<PeriodicTimer>, uint64_t>> expired;
+    std::vector<std::function<void()>> callbacks;
+    while (!fStopRequest)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno != EINTR)
+            {
+                MCF_ERROR_NOFILELINE("Timer thread failed to wait: {}", strerror(errno));
+                return;
+            }
+            continue;
+        }
+        uint64_t count = 0;
+        if (fds[1].revents & POLLIN)
+        {
+            // stop request
+            (void)read(fWakeFd, &count, sizeof(count));
+            continue;
+        }
+        if (!(fds[0].revents & POLLIN))
+        {
+            continue;
+        }
+        (void)read(fTimerFd, &count, sizeof(count));
+        {
+            std::lock_guard<std::mutex> lk(fMutex);
+            const int64_t now = monotonicNowNs();
+            for (const auto& timer : fTimers)
+            {
+                if (timer->fNext <= now)
+                {
+                    const int64_t period = timer->fPeriod.count();
+                    const uint64_t expirations = static_cast<uint64_t>((now - timer->fNext) / period) + 1;
+                    timer->fNext += static_cast<int64_t>(expirations) * period;
+                    expired.emplace_back(timer, expirations);
+                }
+            }
+            auto due = std::partition(fOneShots.begin(), fOneShots.end(),
+                                      [now](const std::pair<int64_t, std::function<void()>>& oneShot) {
+                                          return oneShot.first > now;
+                                      });
+            for (auto it = due; it != fOneShots.end(); ++it)
+            {
+                callbacks.push_back(std::move(it->second));
+            }
+            fOneShots.erase(due, fOneShots.end());
+            arm();
+        }
+        // activate outside of the lock, so that handlers may add and remove timers
+        for (const auto& e : expired)
+        {
+            e.first->expire(e.second);
+        }
+        expired.clear();
+        for (const auto& callback : callbacks)
+        {
+            callback();
+        }
+        callbacks.clear();
+    }
+}
+
+} // namespace mcf
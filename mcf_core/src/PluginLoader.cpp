@@ -4,9 +4,15 @@
 #include "mcf_core/PluginLoader.h"
 
 #include "mcf_core/LoggingMacros.h"
+#include "mcf_core/ParallelFor.h"
+
+#include "json/json.h"
+#include "spdlog/fmt/fmt.h"
 
 #include <algorithm>
 #include <dlfcn.h>
+#include <exception>
+#include <fstream>
 #include <iostream>
 
 namespace mcf
@@ -26,27 +32,67 @@ void PluginLoader::unloadHandle(void* handle)
     }
 }
 
-Plugin PluginLoader::load(const std::string& fileName)
+struct PluginLoader::DeferredPlugin
 {
-    // check if the plugin has been already loaded
-    const auto preLoaded = std::find_if(_pluginDescs.begin(),
-                                        _pluginDescs.end(),
-                                        [fileName](const PluginDescriptor& p)
-                                        { return (p.filePath == fileName); });
-    if (preLoaded != _pluginDescs.end())
+    PluginManifest manifest;
+
+    std::mutex mutex;
+
+    /// DSO handle, null until the first component is created
+    void* handle = nullptr;
+
+    /// the types of the loaded plugin
+    std::vector<ComponentType> types;
+
+    PluginLoadTime loadTime;
+
+    /// set when the loader is destroyed
+    bool unloaded = false;
+
+    ComponentType type(const std::string& qualifiedName)
     {
-        // in this case, unload the library and then load it again
-        auto handle = preLoaded->sharedObjectHandle;
-        _pluginDescs.erase(preLoaded);
-        unloadHandle(handle);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (unloaded)
+        {
+            throw PluginError(fmt::format("Plugin loader of {} has been destroyed", manifest.filePath));
+        }
+        if (handle == nullptr)
+        {
+            OpenedPlugin opened = PluginLoader::open(manifest.filePath, RTLD_LAZY);
+            opened.loadTime.deferred = true;
+            MCF_INFO_NOFILELINE(
+                "Loaded deferred plugin {} in {:.1f} ms",
+                manifest.filePath,
+                (opened.loadTime.open + opened.loadTime.initialize).count() * 1.e-6);
+            handle   = opened.handle;
+            types    = opened.plugin.types();
+            loadTime = opened.loadTime;
+        }
+        auto it = std::find_if(types.begin(), types.end(), [&qualifiedName](const ComponentType& t) {
+            return t.qualifiedName() == qualifiedName;
+        });
+        if (it == types.end())
+        {
+            throw PluginError(fmt::format("Plugin {} does not contain the component type {}",
+                                          manifest.filePath, qualifiedName));
+        }
+        return *it;
     }
+};
 
-    void* handle = dlopen(fileName.c_str(), RTLD_NOW);
+PluginLoader::OpenedPlugin PluginLoader::open(const std::string& fileName, int mode)
+{
+    OpenedPlugin opened;
+    opened.loadTime.filePath = fileName;
+    const auto start = std::chrono::steady_clock::now();
+
+    void* handle = dlopen(fileName.c_str(), mode);
 
     if (handle == nullptr)
     {
         throw PluginError(dlerror());
     }
+    const auto initialization = std::chrono::steady_clock::now();
 
     dlerror(); // clear any existing error
 
@@ -56,21 +102,227 @@ Plugin PluginLoader::load(const std::string& fileName)
 
     if (error != nullptr)
     {
-        throw PluginError(error);
+        const std::string message = error;
+        unloadHandle(handle);
+        throw PluginError(message);
     }
 
     // cast to function pointer
     auto (*func)() = reinterpret_cast<Plugin (*)()>(symbol);
-    Plugin plugin    = func();
+    opened.handle  = handle;
+    opened.plugin  = func();
+
+    opened.loadTime.open       = initialization - start;
+    opened.loadTime.initialize = std::chrono::steady_clock::now() - initialization;
+    return opened;
+}
+
+void PluginLoader::unloadPrevious(const std::string& fileName)
+{
+    // check if the plugin has been already loaded
+    const auto preLoaded = std::find_if(_pluginDescs.begin(),
+                                        _pluginDescs.end(),
+                                        [fileName](const PluginDescriptor& p)
+                                        { return (p.filePath == fileName); });
+    if (preLoaded != _pluginDescs.end())
+    {
+        // in this case, unload the library and then load it again
+        auto handle = preLoaded->sharedObjectHandle;
+        _pluginDescs.erase(preLoaded);
+        unloadHandle(handle);
+    }
+}
 
-    _pluginDescs.push_back({fileName, handle, plugin});
+Plugin PluginLoader::load(const std::string& fileName)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    unloadPrevious(fileName);
+
+    OpenedPlugin opened = open(fileName, RTLD_NOW);
+    Plugin plugin = opened.plugin;
+    _loadTimes.push_back(opened.loadTime);
+    _pluginDescs.push_back({fileName, opened.handle, std::move(opened.plugin)});
     return plugin;
 }
 
+std::vector<Plugin> PluginLoader::loadAll(const std::vector<std::string>& fileNames)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& fileName : fileNames)
+    {
+        unloadPrevious(fileName);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<OpenedPlugin> opened(fileNames.size());
+    std::vector<std::exception_ptr> errors(fileNames.size());
+    parallelFor(0, fileNames.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            try
+            {
+                opened[i] = open(fileNames[i], RTLD_NOW);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        }
+    });
+
+    // all or nothing, like a sequence of load() calls that is aborted by the first error
+    const auto error = std::find_if(errors.begin(), errors.end(),
+                                    [](const std::exception_ptr& e) { return e != nullptr; });
+    if (error != errors.end())
+    {
+        for (const auto& plugin : opened)
+        {
+            unloadHandle(plugin.handle);
+        }
+        std::rethrow_exception(*error);
+    }
+
+    std::vector<Plugin> plugins;
+    for (size_t i = 0; i < fileNames.size(); ++i)
+    {
+        MCF_INFO_NOFILELINE(
+            "Loaded plugin {} in {:.1f} ms (open {:.1f} ms, initialize {:.1f} ms)",
+            fileNames[i],
+            (opened[i].loadTime.open + opened[i].loadTime.initialize).count() * 1.e-6,
+            opened[i].loadTime.open.count() * 1.e-6,
+            opened[i].loadTime.initialize.count() * 1.e-6);
+        plugins.push_back(opened[i].plugin);
+        _loadTimes.push_back(opened[i].loadTime);
+        _pluginDescs.push_back({fileNames[i], opened[i].handle, std::move(opened[i].plugin)});
+    }
+    MCF_INFO_NOFILELINE(
+        "Loaded {} plugins in {:.1f} ms",
+        fileNames.size(),
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return plugins;
+}
+
+Plugin PluginLoader::loadDeferred(const PluginManifest& manifest)
+{
+    auto deferred = std::make_shared<DeferredPlugin>();
+    deferred->manifest = manifest;
+
+    std::vector<ComponentType> types;
+    for (const auto& typeName : manifest.typeNames)
+    {
+        types.emplace_back(typeName, [deferred, typeName]()
+        {
+            return deferred->type(typeName).makeInstance();
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _deferredPlugins.push_back(deferred);
+    return Plugin(manifest.name, std::move(types));
+}
+
+PluginManifest PluginLoader::manifest(const std::string& fileName, const Plugin& plugin)
+{
+    PluginManifest manifest;
+    manifest.filePath = fileName;
+    manifest.name     = plugin.name();
+    for (const auto& type : plugin.types())
+    {
+        manifest.typeNames.push_back(type.qualifiedName());
+    }
+    return manifest;
+}
+
+std::vector<PluginManifest> PluginLoader::readManifests(const std::string& fileName)
+{
+    std::ifstream stream(fileName);
+    if (!stream)
+    {
+        throw PluginError("Cannot open plugin manifest " + fileName);
+    }
+    Json::CharReaderBuilder builder;
+    Json::Value root;
+    std::string errors;
+    if (!Json::parseFromStream(builder, stream, &root, &errors))
+    {
+        throw PluginError(fmt::format("Cannot parse plugin manifest {}: {}", fileName, errors));
+    }
+
+    std::vector<PluginManifest> manifests;
+    for (const auto& node : root["plugins"])
+    {
+        PluginManifest manifest;
+        manifest.filePath = node["file"].asString();
+        manifest.name     = node["name"].asString();
+        for (const auto& type : node["types"])
+        {
+            manifest.typeNames.push_back(type.asString());
+        }
+        if (manifest.filePath.empty() || manifest.name.empty())
+        {
+            throw PluginError("Plugin manifest " + fileName + " contains a plugin without file or name");
+        }
+        manifests.push_back(std::move(manifest));
+    }
+    return manifests;
+}
+
+void PluginLoader::writeManifests(const std::string& fileName, const std::vector<PluginManifest>& manifests)
+{
+    Json::Value plugins(Json::arrayValue);
+    for (const auto& manifest : manifests)
+    {
+        Json::Value node;
+        node["file"] = manifest.filePath;
+        node["name"] = manifest.name;
+        node["types"] = Json::Value(Json::arrayValue);
+        for (const auto& typeName : manifest.typeNames)
+        {
+            node["types"].append(typeName);
+        }
+        plugins.append(node);
+    }
+    Json::Value root;
+    root["plugins"] = plugins;
+
+    std::ofstream stream(fileName, std::ios::trunc);
+    stream << Json::writeString(Json::StreamWriterBuilder(), root);
+    if (!stream)
+    {
+        throw PluginError("Cannot write plugin manifest " + fileName);
+    }
+}
+
+std::vector<PluginLoadTime> PluginLoader::loadTimes() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<PluginLoadTime> loadTimes = _loadTimes;
+    for (const auto& deferred : _deferredPlugins)
+    {
+        std::lock_guard<std::mutex> deferredLock(deferred->mutex);
+        if (deferred->handle != nullptr)
+        {
+            loadTimes.push_back(deferred->loadTime);
+        }
+    }
+    return loadTimes;
+}
+
 PluginLoader::~PluginLoader()
 {
     MCF_INFO_NOFILELINE("Unloading libraries ...");
 
+    // deferred plugins may still be loaded by components created later, which then fail
+    for (const auto& deferred : _deferredPlugins)
+    {
+        std::lock_guard<std::mutex> lock(deferred->mutex);
+        deferred->unloaded = true;
+        deferred->types.clear();
+        unloadHandle(deferred->handle);
+        deferred->handle = nullptr;
+    }
+
     // keep names and handles of libraries to be unloaded
     std::vector<void*> handles;
     std::vector<std::string> names;
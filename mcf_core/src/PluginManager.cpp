@@ -69,6 +69,35 @@ PluginManager::reloadPlugin(const std::string& pluginName)
     return proxies;
 }
 
+std::vector<ComponentProxy>
+PluginManager::hotReloadPlugin(
+    const std::string& pluginName, const ComponentManager::StateTransfer& transferState)
+{
+    auto plugin = std::find_if(_plugins.begin(), _plugins.end(), [&pluginName](const auto& p) {
+        return p.name() == pluginName;
+    });
+    if (plugin == _plugins.end())
+    {
+        throw PluginError("Plugin not loaded");
+    }
+    const auto& types = plugin->types();
+    auto proxies      = std::vector<ComponentProxy>();
+
+    const auto components = _componentInstantiator.listComponents();
+    for (const auto& c : components)
+    {
+        auto it = std::find_if(types.begin(), types.end(), [&c](const ComponentType& type) {
+            return type.qualifiedName() == c.typeName();
+        });
+        if (it != types.end())
+        {
+            proxies.push_back(_componentInstantiator.hotReloadComponent(c.name(), transferState));
+        }
+    }
+
+    return proxies;
+}
+
 void
 PluginManager::erasePlugin(const std::string& pluginName)
 {
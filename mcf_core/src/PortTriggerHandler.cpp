@@ -4,8 +4,10 @@
 
 #include "mcf_core/ComponentTraceEventGenerator.h"
 #include "mcf_core/PortTriggerHandler.h"
+#include "mcf_core/TracePolicy.h"
 #include "mcf_core/ValueStore.h"
 
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <memory>
@@ -14,19 +16,89 @@ namespace mcf {
 
 PortTriggerHandler::PortTriggerHandler(std::function<void()> func,
                                        std::string name,
-                                       const std::shared_ptr<ComponentTraceEventGenerator>& eventGenerator)
+                                       const std::shared_ptr<ComponentTraceEventGenerator>& eventGenerator,
+                                       const PortTriggerHandlerOptions& options)
 : fFunc(std::move(func))
 , fEventFlag(std::make_shared<EventFlag>())
 , fName(std::move(name))
+, fOptions(options)
 {
     // if we have a valid event generator:
     // create TriggerTracer and register it to our event flag so as to trace activations
-    if (eventGenerator) {
+    if (TracePolicy::COMPILED && eventGenerator) {
         fTriggerTracer = std::make_shared<TriggerTracer>(fEventFlag, eventGenerator);
         fEventFlag->addTrigger(fTriggerTracer);
     }
 }
 
+void PortTriggerHandler::addQueue(const std::shared_ptr<ValueQueue>& queue)
+{
+    std::lock_guard<std::mutex> lk(fQueueMutex);
+    fQueues.push_back(queue);
+}
+
+void PortTriggerHandler::removeQueue(const std::shared_ptr<ValueQueue>& queue)
+{
+    std::lock_guard<std::mutex> lk(fQueueMutex);
+    fQueues.erase(std::remove_if(fQueues.begin(), fQueues.end(),
+                                 [&queue](const std::weak_ptr<ValueQueue>& q) {
+                                     auto locked = q.lock();
+                                     return !locked || locked == queue;
+                                 }),
+                  fQueues.end());
+}
+
+std::chrono::nanoseconds PortTriggerHandler::getQueueAge() const
+{
+    std::lock_guard<std::mutex> lk(fQueueMutex);
+    std::chrono::nanoseconds age(0);
+    for (const auto& q : fQueues) {
+        if (auto queue = q.lock()) {
+            age = std::max(age, queue->getAge());
+        }
+    }
+    return age;
+}
+
+size_t PortTriggerHandler::dropQueuedValues(std::chrono::nanoseconds minAge, size_t keep)
+{
+    std::lock_guard<std::mutex> lk(fQueueMutex);
+    size_t dropped = 0;
+    for (const auto& q : fQueues) {
+        if (auto queue = q.lock()) {
+            dropped += queue->dropOlderThan(minAge, keep);
+        }
+    }
+    return dropped;
+}
+
+std::vector<std::shared_ptr<ValueQueue>> PortTriggerHandler::getQueues() const
+{
+    std::lock_guard<std::mutex> lk(fQueueMutex);
+    std::vector<std::shared_ptr<ValueQueue>> queues;
+    for (const auto& q : fQueues) {
+        if (auto queue = q.lock()) {
+            queues.push_back(std::move(queue));
+        }
+    }
+    return queues;
+}
+
+bool PortTriggerHandler::getFrontStamp(LogicalClock::Stamp& stamp) const
+{
+    std::lock_guard<std::mutex> lk(fQueueMutex);
+    bool found = false;
+    for (const auto& q : fQueues) {
+        LogicalClock::Stamp front;
+        auto queue = q.lock();
+        if (queue && queue->frontStamp(front) && (!found || front.time < stamp.time)) {
+            stamp = std::move(front);
+            found = true;
+        }
+    }
+    return found;
+}
+
 PortTriggerHandler::TriggerTracer::TriggerTracer(std::shared_ptr<EventFlag> eventFlag,
                                                  std::shared_ptr<ComponentTraceEventGenerator> eventGenerator)
 : fEventFlag(std::move(eventFlag))
@@ -35,6 +107,9 @@ PortTriggerHandler::TriggerTracer::TriggerTracer(std::shared_ptr<EventFlag> even
 
 void PortTriggerHandler::TriggerTracer::trigger()
 {
+    if (!TracePolicy::active()) {
+        return;
+    }
     std::chrono::system_clock::time_point triggerTime;
     std::string triggerTopic;
     fEventFlag->getLastTriggerUnlocked(&triggerTime, &triggerTopic);
@@ -0,0 +1,289 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/PreviewService.h"
+
+#include "mcf_core/LazyValue.h"
+#include "mcf_core/LoggingMacros.h"
+#include "mcf_core/Messages.h"
+#include "mcf_core/ThreadName.h"
+#include "mcf_core/ValueStore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <set>
+#include <unordered_map>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if MCF_HAVE_JPEG
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <jpeglib.h>
+#endif
+
+namespace mcf {
+
+namespace {
+
+/// nice value of the preview thread
+constexpr int PREVIEW_NICE = 15;
+
+std::mutex& accessorMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::unordered_map<std::type_index, PreviewService::ImageAccessor>& accessors() {
+    static std::unordered_map<std::type_index, PreviewService::ImageAccessor> accessors;
+    return accessors;
+}
+
+PreviewService::ImageAccessor findAccessor(const Value& value) {
+    std::lock_guard<std::mutex> lk(accessorMutex());
+    auto it = accessors().find(std::type_index(typeid(value)));
+    return it != accessors().end() ? it->second : nullptr;
+}
+
+#if MCF_HAVE_JPEG
+struct JpegError {
+    jpeg_error_mgr manager;
+    std::jmp_buf jump;
+};
+
+/**
+ * Compress the pixels of a preview, returns false if they cannot be compressed
+ */
+bool compressJpeg(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, int quality,
+                  std::vector<uint8_t>& out) {
+    if (channels != 1 && channels != 3) {
+        return false;
+    }
+    jpeg_compress_struct info;
+    JpegError error;
+    info.err = jpeg_std_error(&error.manager);
+    // the default handler exits the process
+    error.manager.error_exit = [](j_common_ptr common) {
+        std::longjmp(reinterpret_cast<JpegError*>(common->err)->jump, 1);
+    };
+    unsigned char* buffer = nullptr;
+    unsigned long size = 0;
+    if (setjmp(error.jump)) {
+        jpeg_destroy_compress(&info);
+        std::free(buffer);
+        return false;
+    }
+    jpeg_create_compress(&info);
+    jpeg_mem_dest(&info, &buffer, &size);
+    info.image_width = width;
+    info.image_height = height;
+    info.input_components = static_cast<int>(channels);
+    info.in_color_space = channels == 1 ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&info);
+    jpeg_set_quality(&info, quality, TRUE);
+    jpeg_start_compress(&info, TRUE);
+    while (info.next_scanline < info.image_height) {
+        JSAMPROW row = const_cast<JSAMPROW>(pixels + static_cast<size_t>(info.next_scanline) * width * channels);
+        jpeg_write_scanlines(&info, &row, 1);
+    }
+    jpeg_finish_compress(&info);
+    jpeg_destroy_compress(&info);
+    out.assign(buffer, buffer + size);
+    std::free(buffer);
+    return true;
+}
+#endif
+
+} // anonymous namespace
+
+void PreviewService::registerImageAccessor(std::type_index type, ImageAccessor accessor) {
+    std::lock_guard<std::mutex> lk(accessorMutex());
+    accessors()[type] = std::move(accessor);
+}
+
+PreviewService::PreviewService(ValueStore& valueStore, const PreviewConfig& config)
+    : fValueStore(valueStore)
+    , fConfig(config) {
+#if MCF_HAVE_JPEG
+    fJpeg = fConfig.jpegQuality > 0;
+#else
+    if (fConfig.jpegQuality > 0) {
+        MCF_WARN_NOFILELINE("Previews: built without JPEG support, the previews are not compressed");
+    }
+#endif
+}
+
+PreviewService::~PreviewService() {
+    stop();
+}
+
+void PreviewService::start() {
+    std::lock_guard<std::mutex> lk(fMutex);
+    if (fThread.joinable()) {
+        return;
+    }
+    fStopRequest = false;
+    fThread = std::thread([this] { run(); });
+}
+
+void PreviewService::stop() {
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        fStopRequest = true;
+    }
+    fCv.notify_all();
+    if (fThread.joinable()) {
+        fThread.join();
+    }
+}
+
+uint32_t PreviewService::scaleFactor(const ImageView& image) const {
+    uint32_t factor = 1;
+    if (fConfig.maxWidth > 0) {
+        factor = std::max(factor, (image.width + fConfig.maxWidth - 1) / fConfig.maxWidth);
+    }
+    if (fConfig.maxHeight > 0) {
+        factor = std::max(factor, (image.height + fConfig.maxHeight - 1) / fConfig.maxHeight);
+    }
+    return factor;
+}
+
+size_t PreviewService::update() {
+    std::lock_guard<std::mutex> lk(fUpdateMutex);
+    size_t count = 0;
+    // the topics still previewed, the others are pruned from fPreviewed at the end
+    std::set<std::string> current;
+    for (const auto& topic : fValueStore.getKeys()) {
+        const bool selected = std::any_of(fConfig.topics.begin(), fConfig.topics.end(),
+            [&topic](const std::string& pattern) { return ValueStore::matchesPattern(pattern, topic); });
+        if (!selected || !fValueStore.hasValue(topic)) {
+            continue;
+        }
+        const ValuePtr value = decodedValue(fValueStore.getValue<Value>(topic));
+        if (value == nullptr) {
+            continue;
+        }
+        current.insert(topic);
+        // skipped while the topic holds the image of the previous preview
+        auto& previewed = fPreviewed[topic];
+        if (!previewed.owner_before(value) && !value.owner_before(previewed)) {
+            continue;
+        }
+        previewed = value;
+
+        const ImageAccessor accessor = findAccessor(*value);
+        ImageView image;
+        if (!accessor || !accessor(*value, image) || image.data == nullptr || image.channels == 0
+            || image.pitch < image.width * image.channels) {
+            continue;
+        }
+        const uint32_t factor = scaleFactor(image);
+        if (image.width < factor || image.height < factor) {
+            continue;
+        }
+
+        msg::PreviewImage preview;
+        preview.topic = topic;
+        preview.width = image.width / factor;
+        preview.height = image.height / factor;
+        preview.channels = image.channels;
+        preview.factor = factor;
+        preview.encoding = "raw";
+        const size_t bytes = static_cast<size_t>(preview.width) * preview.height * preview.channels;
+        preview.extMemInit(bytes);
+        downscale(image, factor, static_cast<uint8_t*>(preview.extMemPtr()));
+#if MCF_HAVE_JPEG
+        std::vector<uint8_t> jpeg;
+        if (fJpeg && compressJpeg(static_cast<const uint8_t*>(preview.extMemPtr()), preview.width,
+                                  preview.height, preview.channels, fConfig.jpegQuality, jpeg)) {
+            preview.extMemInit(jpeg.size());
+            std::memcpy(preview.extMemPtr(), jpeg.data(), jpeg.size());
+            preview.encoding = "jpeg";
+        }
+#endif
+        // a viewer which does not keep up must not stall the previews of the other topics
+        if (fValueStore.setValue(TOPIC_PREFIX + topic, std::move(preview), false) == 0) {
+            ++count;
+        }
+    }
+    for (auto it = fPreviewed.begin(); it != fPreviewed.end();) {
+        it = current.count(it->first) != 0 ? std::next(it) : fPreviewed.erase(it);
+    }
+    return count;
+}
+
+void PreviewService::downscale(const ImageView& image, uint32_t factor, uint8_t* out) {
+    const uint32_t width = image.width / factor;
+    const uint32_t height = image.height / factor;
+    const size_t rowBytes = static_cast<size_t>(width) * image.channels;
+    if (factor == 1) {
+        for (uint32_t y = 0; y < height; ++y) {
+            std::memcpy(out + y * rowBytes, image.data + static_cast<size_t>(y) * image.pitch, rowBytes);
+        }
+        return;
+    }
+
+    // the rows of a block are summed up first, in plain loops over contiguous bytes which the
+    // compiler vectorizes, so that only the sums are added up per pixel
+    const size_t blockBytes = rowBytes * factor;
+    const uint32_t area = factor * factor;
+    std::vector<uint32_t> sums(blockBytes);
+    for (uint32_t y = 0; y < height; ++y) {
+        uint32_t* const rowSums = sums.data();
+        std::fill(rowSums, rowSums + blockBytes, 0u);
+        for (uint32_t r = 0; r < factor; ++r) {
+            const uint8_t* const row = image.data + (static_cast<size_t>(y) * factor + r) * image.pitch;
+            for (size_t i = 0; i < blockBytes; ++i) {
+                rowSums[i] += row[i];
+            }
+        }
+        uint8_t* const outRow = out + y * rowBytes;
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint32_t* const block = rowSums + static_cast<size_t>(x) * factor * image.channels;
+            for (uint32_t c = 0; c < image.channels; ++c) {
+                uint32_t sum = 0;
+                for (uint32_t k = 0; k < factor; ++k) {
+                    sum += block[k * image.channels + c];
+                }
+                outRow[x * image.channels + c] = static_cast<uint8_t>((sum + area / 2) / area);
+            }
+        }
+    }
+}
+
+void PreviewService::run() {
+    setThreadName("PreviewService");
+    // the thread inherits the scheduling of the starting thread, which may be a real-time thread
+    sched_param parameters{};
+    parameters.sched_priority = 0;
+    int result = pthread_setschedparam(pthread_self(), SCHED_OTHER, &parameters);
+    if (result == 0 && setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), PREVIEW_NICE) != 0) {
+        result = errno;
+    }
+    if (result != 0) {
+        MCF_WARN_NOFILELINE("Previews: cannot lower the priority of the preview thread: {}", std::strerror(result));
+    }
+
+    std::unique_lock<std::mutex> lk(fMutex);
+    while (!fStopRequest) {
+        if (fCv.wait_for(lk, fConfig.interval, [this] { return fStopRequest; })) {
+            break;
+        }
+        lk.unlock();
+        try {
+            update();
+        } catch (const std::exception& e) {
+            MCF_ERROR_NOFILELINE("Previews: {}", e.what());
+        }
+        lk.lock();
+    }
+}
+
+} // namespace mcf
@@ -7,12 +7,30 @@
 #include "mcf_core/ComponentTraceEventGenerator.h"
 #include "mcf_core/ComponentTraceController.h"
 #include "mcf_core/ErrorMacros.h"
+#include <algorithm>
 #include <chrono>
 
 namespace mcf {
 
 using Microseconds = std::chrono::microseconds;
 
+namespace {
+
+constexpr std::size_t MIN_QUEUE_CAPACITY = 16;
+
+/**
+ * Heap order of the events, the next event to fire at the top
+ */
+struct FiredLater {
+    template<typename Event>
+    bool operator()(const Event& lhs, const Event& rhs) const
+    {
+        return lhs.time > rhs.time || (lhs.time == rhs.time && lhs.sequence > rhs.sequence);
+    }
+};
+
+} // anonymous namespace
+
 QueuedEventSource::QueuedEventSource(ValueStore& valueStore,
                                      std::weak_ptr<mcf::IEventTimingController> eventTimingController)
     : fValueStore(valueStore)
@@ -48,7 +66,86 @@ bool QueuedEventSource::isFinished()
 void QueuedEventSource::clearEventQueue()
 {
     std::lock_guard<std::mutex> lock(fEventQueueMutex);
-    fEventQueue.clear();
+    while (fQueueSize > 0)
+    {
+        dequeue();
+    }
+}
+
+uint32_t QueuedEventSource::internName(std::string&& name)
+{
+    auto it = fNameIds.find(name);
+    if (it != fNameIds.end())
+    {
+        return it->second;
+    }
+    const uint32_t id = static_cast<uint32_t>(fNames.size());
+    fNames.push_back(name);
+    fNameIds.emplace(std::move(name), id);
+    return id;
+}
+
+void QueuedEventSource::enqueue(QueuedEvent&& event)
+{
+    const std::size_t capacity = fEventQueue.size();
+    if (!fHeapOrder && fQueueSize > 0
+        && event.time < fEventQueue[(fQueueHead + fQueueSize - 1) & (capacity - 1)].time)
+    {
+        // pushed out of order, the ring in time order is already a valid heap once it starts at 0
+        std::rotate(fEventQueue.begin(), fEventQueue.begin() + fQueueHead, fEventQueue.end());
+        fQueueHead = 0;
+        fHeapOrder = true;
+    }
+
+    if (fQueueSize == capacity)
+    {
+        std::vector<QueuedEvent> grown(std::max(MIN_QUEUE_CAPACITY, 2 * capacity));
+        for (std::size_t i = 0; i < fQueueSize; ++i)
+        {
+            grown[i] = std::move(fEventQueue[(fQueueHead + i) & (capacity - 1)]);
+        }
+        fEventQueue.swap(grown);
+        fQueueHead = 0;
+    }
+
+    fLastTime = fQueueSize == 0 ? event.time : std::max(fLastTime, event.time);
+    if (fHeapOrder)
+    {
+        fEventQueue[fQueueSize] = std::move(event);
+        ++fQueueSize;
+        std::push_heap(fEventQueue.begin(), fEventQueue.begin() + fQueueSize, FiredLater());
+    }
+    else
+    {
+        fEventQueue[(fQueueHead + fQueueSize) & (fEventQueue.size() - 1)] = std::move(event);
+        ++fQueueSize;
+    }
+}
+
+QueuedEventSource::QueuedEvent QueuedEventSource::dequeue()
+{
+    QueuedEvent event;
+    if (fHeapOrder)
+    {
+        std::pop_heap(fEventQueue.begin(), fEventQueue.begin() + fQueueSize, FiredLater());
+        event = std::move(fEventQueue[fQueueSize - 1]);
+        fEventQueue[fQueueSize - 1].value.reset();
+    }
+    else
+    {
+        event = std::move(fEventQueue[fQueueHead]);
+        fEventQueue[fQueueHead].value.reset();
+        fQueueHead = (fQueueHead + 1) & (fEventQueue.size() - 1);
+    }
+    --fQueueSize;
+    if (fQueueSize == 0)
+    {
+        fQueueHead = 0;
+        fHeapOrder = false;
+    }
+    fDequeuedTime = fDequeued ? std::max(fDequeuedTime, event.time) : event.time;
+    fDequeued = true;
+    return event;
 }
 
 void QueuedEventSource::pushNewEvent(
@@ -60,9 +157,14 @@ void QueuedEventSource::pushNewEvent(
 {
     std::unique_lock<std::mutex> lock(fEventQueueMutex);
     
-    ValueTopicTuple<Value> valuetopicTuple {value, topic};
-    fEventQueue.insert({static_cast<IntTimestamp>(timestamp),
-                        ValueTopicComponentPortTuple<Value> {valuetopicTuple, component, port}});
+    QueuedEvent event;
+    event.time = static_cast<IntTimestamp>(timestamp);
+    event.sequence = fNextSequence++;
+    event.value = std::move(value);
+    event.topic = internName(std::move(topic));
+    event.component = internName(std::move(component));
+    event.port = internName(std::move(port));
+    enqueue(std::move(event));
     lock.unlock();
 
     auto eventTimingControllerSharedPtr = fEventTimingController.lock();
@@ -71,20 +173,46 @@ void QueuedEventSource::pushNewEvent(
     eventTimingControllerSharedPtr->triggerNewEventPushed(this);
 }
 
+void QueuedEventSource::pushNewEvents(std::vector<NewEvent>& events)
+{
+    if (events.empty())
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(fEventQueueMutex);
+    for (auto& newEvent : events)
+    {
+        QueuedEvent event;
+        event.time = static_cast<IntTimestamp>(newEvent.timestamp);
+        event.sequence = fNextSequence++;
+        event.value = std::move(newEvent.value);
+        event.topic = internName(std::move(newEvent.topic));
+        event.component = internName(std::move(newEvent.component));
+        event.port = internName(std::move(newEvent.port));
+        enqueue(std::move(event));
+    }
+    lock.unlock();
+
+    auto eventTimingControllerSharedPtr = fEventTimingController.lock();
+    MCF_ASSERT(eventTimingControllerSharedPtr, "EventTimingController no longer exists.");
+
+    eventTimingControllerSharedPtr->triggerNewEventPushed(this);
+}
+
 void QueuedEventSource::getEventQueueInfo(std::size_t& queueSize, IntTimestamp& firstTime, IntTimestamp& lastTime) const
 {
     std::lock_guard<std::mutex> lock(fEventQueueMutex);
-    queueSize = fEventQueue.size();
+    queueSize = fQueueSize;
 
-    if (fEventQueue.empty())
+    if (fQueueSize == 0)
     {
         firstTime = 0UL;
         lastTime = 0UL;
     }
     else
     {
-        firstTime = std::get<0>(*fEventQueue.begin());
-        lastTime = std::get<0>(*fEventQueue.rbegin());
+        firstTime = fEventQueue[fQueueHead].time;
+        lastTime = fLastTime;
     }
 }
 
@@ -92,80 +220,105 @@ bool QueuedEventSource::getNextQueuedEventInfo(IntTimestamp &nextEventTimestamp,
 {
     std::lock_guard<std::mutex> lock(fEventQueueMutex);
 
-    if (fEventQueue.empty())
+    if (fQueueSize == 0)
     {
         return false;
     }
 
-    nextEventTimestamp = std::get<0>(*fEventQueue.begin());
-    const auto& nextEvent = std::get<1>(*fEventQueue.begin());
-    nextEventTopic = std::get<1>(nextEvent);
+    const auto& nextEvent = fEventQueue[fQueueHead];
+    nextEventTimestamp = nextEvent.time;
+    nextEventTopic = fNames[nextEvent.topic];
 
     return true;
 }
 
 bool QueuedEventSource::fireQueuedEvent()
 {
-    std::shared_ptr<const Value> nextValue;
-    std::string nextTopic;
-    std::string nextEventComponent;
-    std::string nextEventPort;
+    ValuePtr nextValue;
+    // interned names are never modified or removed
+    const std::string* nextTopic = nullptr;
+    const std::string* nextEventComponent = nullptr;
+    const std::string* nextEventPort = nullptr;
     {
         std::lock_guard<std::mutex> lock(fEventQueueMutex);
-        if (fEventQueue.empty())
+        if (fQueueSize == 0)
         {
             return false;
         }
 
-        const auto& nextEvent = std::get<1>(*fEventQueue.begin());
-        const auto& nextEventValueTopic = std::get<0>(nextEvent);
-        
-        nextTopic = std::get<1>(nextEventValueTopic);
-        nextValue = std::get<0>(nextEventValueTopic);
-        nextEventComponent = std::get<1>(nextEvent);
-        nextEventPort = std::get<2>(nextEvent);
-
-        fEventQueue.erase(fEventQueue.begin());
+        QueuedEvent nextEvent = dequeue();
+        nextValue = std::move(nextEvent.value);
+        nextTopic = &fNames[nextEvent.topic];
+        nextEventComponent = &fNames[nextEvent.component];
+        nextEventPort = &fNames[nextEvent.port];
     }
 
     if (fComponentTraceEventGenerator)
     {
         fComponentTraceEventGenerator->traceSetQueuedEventValue(
-            nextTopic,
+            *nextTopic,
             true,
             std::vector<uint64_t>(),
             nextValue.get(),
-            nextEventComponent,
-            nextEventPort);
+            *nextEventComponent,
+            *nextEventPort);
     }
 
-    fValueStore.setValue(nextTopic, nextValue);
+    fValueStore.setValue(*nextTopic, nextValue);
     return true;
 }
 
 bool QueuedEventSource::seekQueuedEvent(IntTimestamp nextEventTimestamp)
 {
     std::lock_guard<std::mutex> lock(fEventQueueMutex);
-    if (fEventQueue.empty())
+    if (fQueueSize == 0)
     {
         return false;
     }
 
-    size_t sizeBefore = fEventQueue.size();
+    size_t sizeBefore = fQueueSize;
 
-    // find first element >= given time stamp
-    auto firstToKeep = fEventQueue.lower_bound(nextEventTimestamp);
-    fEventQueue.erase(fEventQueue.begin(), firstToKeep);
+    // drop all events before the given time stamp
+    while (fQueueSize > 0 && fEventQueue[fQueueHead].time < nextEventTimestamp)
+    {
+        dequeue();
+    }
 
-    size_t sizeAfter = fEventQueue.size();
+    size_t sizeAfter = fQueueSize;
 
     return (sizeBefore > sizeAfter);
 }
 
+bool QueuedEventSource::seek(const TimestampType& time)
+{
+    // copy so we can use static_cast
+    TimestampType seekTime(time);
+    const IntTimestamp target = static_cast<IntTimestamp>(seekTime);
+    {
+        std::lock_guard<std::mutex> lock(fEventQueueMutex);
+        if (fDequeued && target < fDequeuedTime)
+        {
+            // the events in between are gone
+            return false;
+        }
+    }
+    seekQueuedEvent(target);
+    return true;
+}
+
 void QueuedEventSource::setEventSourceFinished(bool eventSourceFinished)
 {
-    std::lock_guard<std::mutex> lock(fEventQueueMutex);
-    fIsEventSourceFinished = eventSourceFinished;
+    {
+        std::lock_guard<std::mutex> lock(fEventQueueMutex);
+        fIsEventSourceFinished = eventSourceFinished;
+    }
+
+    // wake up the event timing controller, which may be waiting for this source to finish
+    auto eventTimingControllerSharedPtr = fEventTimingController.lock();
+    if (eventTimingControllerSharedPtr)
+    {
+        eventTimingControllerSharedPtr->triggerNewEventPushed(this);
+    }
 }
 
 void QueuedEventSource::useTraceEventGenerator(ComponentTraceController* componentTraceController)
@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/RealtimeMemory.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace mcf
+{
+namespace
+{
+// keeps the stack of the caller which is not touched but still in use
+constexpr size_t STACK_SAFETY_MARGIN = 64 * 1024;
+
+size_t
+pageSize()
+{
+    const long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<size_t>(size) : 4096;
+}
+
+void
+keepHeapMemory()
+{
+#ifdef __GLIBC__
+    // serve all allocations from the heap and never trim it
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+#endif
+}
+
+} // anonymous namespace
+
+int
+lockProcessMemory()
+{
+    keepHeapMemory();
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        return errno;
+    }
+    return 0;
+}
+
+void
+unlockProcessMemory()
+{
+    munlockall();
+}
+
+__attribute__((noinline)) void
+prefaultStack(size_t bytes)
+{
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0)
+    {
+        size_t stackSize = 0;
+        pthread_attr_getstacksize(&attr, &stackSize);
+        pthread_attr_destroy(&attr);
+        bytes = std::min(bytes, stackSize > STACK_SAFETY_MARGIN ? stackSize - STACK_SAFETY_MARGIN : 0);
+    }
+    if (bytes == 0)
+    {
+        return;
+    }
+    volatile unsigned char* stack = static_cast<volatile unsigned char*>(alloca(bytes));
+    const size_t page = pageSize();
+    for (size_t offset = 0; offset < bytes; offset += page)
+    {
+        stack[offset] = 0;
+    }
+}
+
+void
+prefaultHeap(size_t bytes)
+{
+    if (bytes == 0)
+    {
+        return;
+    }
+    keepHeapMemory();
+    volatile unsigned char* heap = static_cast<volatile unsigned char*>(std::malloc(bytes));
+    if (heap == nullptr)
+    {
+        return;
+    }
+    const size_t page = pageSize();
+    for (size_t offset = 0; offset < bytes; offset += page)
+    {
+        heap[offset] = 0;
+    }
+    std::free(const_cast<unsigned char*>(heap));
+}
+
+size_t
+getLockedMemorySize()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmLck:") == 0)
+        {
+            std::istringstream fields(line.substr(6));
+            size_t kiB = 0;
+            fields >> kiB;
+            return kiB * 1024;
+        }
+    }
+    return 0;
+}
+
+uint64_t
+getMajorPageFaults()
+{
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(usage.ru_majflt);
+}
+
+} // namespace mcf
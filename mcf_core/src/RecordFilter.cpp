@@ -0,0 +1,416 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/RecordFilter.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/Messages.h"
+#include "mcf_core/RecordReader.h"
+#include "mcf_core/ValueRecorder.h"
+
+#include "spdlog/fmt/fmt.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace mcf {
+
+namespace {
+
+constexpr const char* CHUNK_TYPE_ID = "mcf::RecordChunk";
+constexpr const char* FOOTER_TYPE_ID = "mcf::RecordFooter";
+
+bool isRecorderTopic(const RecordReader::View& topic)
+{
+    return topic == ValueRecorder::INDEX_TOPIC
+        || topic == ValueRecorder::FOOTER_TOPIC
+        || topic == ValueRecorder::SYNC_TOPIC;
+}
+
+/**
+ * Pack a record header and its msgpack value in the format of the ValueRecorder
+ */
+void packHeader(msgpack::sbuffer& buffer, uint64_t time, const RecordReader::View& topic,
+                const RecordReader::View& tid, uint64_t vid, uint64_t seq, const char* value, size_t valueSize)
+{
+    msgpack::packer<msgpack::sbuffer> pk(&buffer);
+    pk.pack_array(5);
+    pk.pack(time);
+    pk.pack_str(static_cast<uint32_t>(topic.size));
+    pk.pack_str_body(topic.data, static_cast<uint32_t>(topic.size));
+    pk.pack_str(static_cast<uint32_t>(tid.size));
+    pk.pack_str_body(tid.data, static_cast<uint32_t>(tid.size));
+    pk.pack(vid);
+    pk.pack(seq);
+    buffer.write(value, valueSize);
+}
+
+void packExtMemHeader(msgpack::sbuffer& buffer, uint32_t size, bool present, uint32_t compressedSize)
+{
+    msgpack::packer<msgpack::sbuffer> pk(&buffer);
+    pk.pack_array(3);
+    pk.pack(size);
+    pk.pack(present);
+    pk.pack(compressedSize);
+}
+
+RecordReader::View view(const char* str)
+{
+    RecordReader::View result;
+    result.data = str;
+    result.size = std::strlen(str);
+    return result;
+}
+
+/**
+ * Writes the output file, collecting copies of adjacent input ranges into one
+ */
+class Writer {
+public:
+    Writer(const std::string& input, const std::string& output,
+           const RecordFilter::Options& options, RecordFilter::Statistics& statistics)
+    : fOptions(options)
+    , fStatistics(statistics)
+    {
+        fInput = ::open(input.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fInput < 0)
+        {
+            MCF_THROW_RUNTIME(fmt::format("Cannot open record file {}: {}", input, strerror(errno)));
+        }
+        struct stat inputStat;
+        struct stat outputStat;
+        if (fstat(fInput, &inputStat) == 0 && stat(output.c_str(), &outputStat) == 0
+            && inputStat.st_dev == outputStat.st_dev && inputStat.st_ino == outputStat.st_ino)
+        {
+            ::close(fInput);
+            MCF_THROW_RUNTIME(fmt::format("Output {} is the input record file", output));
+        }
+        fOutput = ::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fOutput < 0)
+        {
+            ::close(fInput);
+            MCF_THROW_RUNTIME(fmt::format("Cannot create record file {}: {}", output, strerror(errno)));
+        }
+    }
+
+    ~Writer()
+    {
+        ::close(fInput);
+        ::close(fOutput);
+    }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    void add(const RecordReader::Record& record)
+    {
+        if (fOptions.reindex)
+        {
+            index(record);
+        }
+        ++fStatistics.records;
+        if (fOptions.compressionLevel > 0)
+        {
+            if (fChunkRecords == 0)
+            {
+                fChunkTime = record.time;
+            }
+            pack(fChunk, record);
+            ++fChunkRecords;
+            if (fChunk.size() >= fOptions.chunkSize)
+            {
+                writeChunk();
+            }
+        }
+        else if (record.size > 0)
+        {
+            copy(record.offset, record.size);
+        }
+        else
+        {
+            flushCopy();
+            fBuffer.clear();
+            packHeader(fBuffer, record.time, record.topic, record.tid, record.vid, record.seq,
+                       record.value.data, record.value.size);
+            packExtMemHeader(fBuffer, record.extMemSize, record.extMem.data != nullptr, 0);
+            const iovec iov[] = {
+                iovec{fBuffer.data(), fBuffer.size()},
+                iovec{const_cast<char*>(record.extMem.data), record.extMem.size}
+            };
+            write(iov, 2);
+        }
+    }
+
+    void finish()
+    {
+        writeChunk();
+        flushCopy();
+        if (fOptions.reindex)
+        {
+            writeFooter();
+        }
+        if (::close(fOutput) != 0)
+        {
+            fOutput = -1;
+            MCF_THROW_RUNTIME(fmt::format("Cannot close record file: {}", strerror(errno)));
+        }
+        fOutput = -1;
+    }
+
+private:
+    /**
+     * Count the record and add a checkpoint like ValueRecorder::RecordIndex
+     */
+    void index(const RecordReader::Record& record)
+    {
+        ++fCounts[record.topic.str()];
+        if (fTimes.empty())
+        {
+            fStartTime = record.time;
+            fEndTime = record.time;
+        }
+        const bool checkpoint = fTimes.empty()
+            || std::max(fEndTime, record.time) >= fTimes.back() + ValueRecorder::CHECKPOINT_INTERVAL_MS;
+        fEndTime = std::max(fEndTime, record.time);
+        if (checkpoint)
+        {
+            // the record starts the next chunk
+            writeChunk();
+            fTimes.push_back(fEndTime);
+            fOffsets.push_back(fOffset);
+        }
+    }
+
+    static void pack(msgpack::sbuffer& buffer, const RecordReader::Record& record)
+    {
+        packHeader(buffer, record.time, record.topic, record.tid, record.vid, record.seq,
+                   record.value.data, record.value.size);
+        packExtMemHeader(buffer, record.extMemSize, record.extMem.data != nullptr, 0);
+        buffer.write(record.extMem.data, record.extMem.size);
+    }
+
+    void copy(uint64_t offset, uint64_t size)
+    {
+        if (fCopySize > 0 && fCopyOffset + fCopySize != offset)
+        {
+            flushCopy();
+        }
+        if (fCopySize == 0)
+        {
+            fCopyOffset = offset;
+        }
+        fCopySize += size;
+        fOffset += size;
+    }
+
+    void flushCopy()
+    {
+        while (fCopySize > 0)
+        {
+            loff_t inputOffset = static_cast<loff_t>(fCopyOffset);
+            ssize_t copied = copy_file_range(fInput, &inputOffset, fOutput, nullptr, fCopySize, 0);
+            if (copied < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP))
+            {
+                // e.g. different file systems on older kernels, still copied by the kernel
+                off_t sendOffset = static_cast<off_t>(fCopyOffset);
+                copied = sendfile(fOutput, fInput, &sendOffset, fCopySize);
+            }
+            if (copied < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (copied <= 0)
+            {
+                MCF_THROW_RUNTIME(fmt::format("Cannot copy records: {}",
+                    copied < 0 ? strerror(errno) : "unexpected end of the record file"));
+            }
+            fCopyOffset += copied;
+            fCopySize -= copied;
+            fStatistics.copiedBytes += copied;
+        }
+    }
+
+    void write(const iovec* iov, size_t count)
+    {
+        std::vector<iovec> pending(iov, iov + count);
+        size_t index = 0;
+        while (index < pending.size())
+        {
+            const ssize_t written = ::writev(fOutput, pending.data() + index, pending.size() - index);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                MCF_THROW_RUNTIME(fmt::format("Cannot write records: {}", strerror(errno)));
+            }
+            fOffset += written;
+            fStatistics.writtenBytes += written;
+            size_t remaining = static_cast<size_t>(written);
+            while (index < pending.size() && remaining >= pending[index].iov_len)
+            {
+                remaining -= pending[index].iov_len;
+                ++index;
+            }
+            if (remaining > 0)
+            {
+                pending[index].iov_base = static_cast<char*>(pending[index].iov_base) + remaining;
+                pending[index].iov_len -= remaining;
+            }
+        }
+    }
+
+    void writeChunk()
+    {
+        if (fChunkRecords == 0)
+        {
+            return;
+        }
+#if HAVE_ZLIB
+        msg::RecordChunk chunk;
+        chunk.codec = "deflate";
+        chunk.records = fChunkRecords;
+        msgpack::sbuffer value;
+        msgpack::pack(value, chunk);
+
+        const uLong uncompressedLen = fChunk.size();
+        uLongf compressedLen = compressBound(uncompressedLen);
+        auto compressed = std::make_unique<Bytef[]>(compressedLen);
+        if (compress2(compressed.get(), &compressedLen, reinterpret_cast<const Bytef*>(fChunk.data()),
+                uncompressedLen, fOptions.compressionLevel) != Z_OK)
+        {
+            MCF_THROW_RUNTIME("Cannot compress record chunk");
+        }
+
+        fBuffer.clear();
+        packHeader(fBuffer, fChunkTime, view(ValueRecorder::CHUNK_TOPIC), view(CHUNK_TYPE_ID), 0, 0,
+                   value.data(), value.size());
+        packExtMemHeader(fBuffer, static_cast<uint32_t>(uncompressedLen), true,
+                         static_cast<uint32_t>(compressedLen));
+        flushCopy();
+        const iovec iov[] = {
+            iovec{fBuffer.data(), fBuffer.size()},
+            iovec{compressed.get(), compressedLen}
+        };
+        write(iov, 2);
+#endif
+        fChunk.clear();
+        fChunkRecords = 0;
+    }
+
+    void writeFooter()
+    {
+        msg::RecordFooter footer;
+        for (const auto& count : fCounts)
+        {
+            footer.topics.push_back(count.first);
+            footer.counts.push_back(count.second);
+        }
+        footer.startTime = fStartTime;
+        footer.endTime = fEndTime;
+        footer.times = fTimes;
+        footer.offsets = fOffsets;
+        msgpack::sbuffer value;
+        msgpack::pack(value, footer);
+
+        const uint64_t time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+        fBuffer.clear();
+        packHeader(fBuffer, time, view(ValueRecorder::FOOTER_TOPIC), view(FOOTER_TYPE_ID), 0,
+                   value.data(), value.size());
+        // the trailer is the ext mem data, see msg::RecordFooter
+        packExtMemHeader(fBuffer, 16, true, 0);
+        char trailer[16];
+        for (int i = 0; i < 8; ++i)
+        {
+            trailer[i] = static_cast<char>((fOffset >> (8 * i)) & 0xff);
+        }
+        std::memcpy(trailer + 8, ValueRecorder::FOOTER_MAGIC, 8);
+        fBuffer.write(trailer, sizeof(trailer));
+        const iovec iov{fBuffer.data(), fBuffer.size()};
+        write(&iov, 1);
+    }
+
+    const RecordFilter::Options& fOptions;
+    RecordFilter::Statistics& fStatistics;
+    int fInput = -1;
+    int fOutput = -1;
+    /// size of the output including the pending copy
+    uint64_t fOffset = 0;
+    uint64_t fCopyOffset = 0;
+    uint64_t fCopySize = 0;
+    msgpack::sbuffer fBuffer;
+
+    msgpack::sbuffer fChunk;
+    uint32_t fChunkRecords = 0;
+    uint64_t fChunkTime = 0;
+
+    std::map<std::string, uint64_t> fCounts;
+    uint64_t fStartTime = 0;
+    uint64_t fEndTime = 0;
+    std::vector<uint64_t> fTimes;
+    std::vector<uint64_t> fOffsets;
+};
+
+} // anonymous namespace
+
+constexpr uint64_t RecordFilter::END_MARGIN_MS;
+
+RecordFilter::Statistics RecordFilter::run(const std::string& input, const std::string& output,
+                                           const Options& options)
+{
+#if !HAVE_ZLIB
+    if (options.compressionLevel > 0)
+    {
+        MCF_THROW_RUNTIME("Record chunks cannot be written. Make sure HAVE_ZLIB is set.");
+    }
+#endif
+    RecordReader reader;
+    reader.open(input);
+    reader.setTopicFilter(options.topics);
+    if (options.startTime > 0)
+    {
+        reader.seek(options.startTime);
+    }
+
+    Statistics statistics;
+    Writer writer(input, output, options, statistics);
+    RecordReader::Record record;
+    while (reader.next(record))
+    {
+        if (record.time > options.endTime)
+        {
+            if (record.time - options.endTime > END_MARGIN_MS)
+            {
+                break;
+            }
+            continue;
+        }
+        const auto& tid = record.tid;
+        if (isRecorderTopic(record.topic)
+            || (!options.types.empty()
+                && std::none_of(options.types.begin(), options.types.end(),
+                                [&tid](const std::string& type) { return tid == type; })))
+        {
+            continue;
+        }
+        writer.add(record);
+    }
+    writer.finish();
+    return statistics;
+}
+
+} // namespace mcf
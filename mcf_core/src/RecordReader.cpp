@@ -0,0 +1,731 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/RecordReader.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/IdGeneratorInterface.h"
+#include "mcf_core/ValueRecorder.h"
+
+#include "spdlog/fmt/fmt.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace mcf {
+
+namespace {
+
+constexpr const char* DELTA_TYPE_ID = "mcf::RecordDelta";
+
+/// Thrown by Cursor when the data ends within an object
+struct Truncated {};
+
+/**
+ * Minimal msgpack parser reading the record structure in place, without allocating
+ */
+class Cursor {
+public:
+    Cursor(const char* data, size_t size, size_t offset)
+    : fData(reinterpret_cast<const unsigned char*>(data)), fSize(size), fOffset(offset)
+    {
+    }
+
+    size_t offset() const { return fOffset; }
+
+    void need(size_t bytes) const
+    {
+        if (bytes > fSize - fOffset)
+        {
+            throw Truncated();
+        }
+    }
+
+    const char* take(size_t bytes)
+    {
+        need(bytes);
+        const char* data = reinterpret_cast<const char*>(fData + fOffset);
+        fOffset += bytes;
+        return data;
+    }
+
+    uint64_t readUint()
+    {
+        const unsigned char tag = byte();
+        if (tag <= 0x7f)
+        {
+            return tag;
+        }
+        switch (tag)
+        {
+        case 0xcc: case 0xd0: return checkSign(tag, bigEndian(1));
+        case 0xcd: case 0xd1: return checkSign(tag, bigEndian(2));
+        case 0xce: case 0xd2: return checkSign(tag, bigEndian(4));
+        case 0xcf: case 0xd3: return checkSign(tag, bigEndian(8));
+        default: malformed("unsigned integer");
+        }
+    }
+
+    bool readBool()
+    {
+        const unsigned char tag = byte();
+        if (tag != 0xc2 && tag != 0xc3)
+        {
+            malformed("boolean");
+        }
+        return tag == 0xc3;
+    }
+
+    RecordReader::View readStr()
+    {
+        const unsigned char tag = byte();
+        size_t length;
+        if ((tag & 0xe0) == 0xa0)
+        {
+            length = tag & 0x1f;
+        }
+        else if (tag == 0xd9 || tag == 0xc4)
+        {
+            length = bigEndian(1);
+        }
+        else if (tag == 0xda || tag == 0xc5)
+        {
+            length = bigEndian(2);
+        }
+        else if (tag == 0xdb || tag == 0xc6)
+        {
+            length = bigEndian(4);
+        }
+        else
+        {
+            malformed("string");
+        }
+        RecordReader::View view;
+        view.data = take(length);
+        view.size = length;
+        return view;
+    }
+
+    uint32_t readArray()
+    {
+        const unsigned char tag = byte();
+        if ((tag & 0xf0) == 0x90)
+        {
+            return tag & 0x0f;
+        }
+        if (tag == 0xdc)
+        {
+            return static_cast<uint32_t>(bigEndian(2));
+        }
+        if (tag == 0xdd)
+        {
+            return static_cast<uint32_t>(bigEndian(4));
+        }
+        malformed("array");
+    }
+
+    /**
+     * Skip count complete objects
+     */
+    void skip(uint64_t count = 1)
+    {
+        while (count > 0)
+        {
+            --count;
+            const unsigned char tag = byte();
+            if (tag <= 0x7f || tag >= 0xe0 || tag == 0xc0 || tag == 0xc2 || tag == 0xc3)
+            {
+                continue;
+            }
+            if ((tag & 0xf0) == 0x80)
+            {
+                count += 2 * static_cast<uint64_t>(tag & 0x0f);
+                continue;
+            }
+            if ((tag & 0xf0) == 0x90)
+            {
+                count += tag & 0x0f;
+                continue;
+            }
+            if ((tag & 0xe0) == 0xa0)
+            {
+                take(tag & 0x1f);
+                continue;
+            }
+            switch (tag)
+            {
+            case 0xc4: case 0xd9: take(bigEndian(1)); break;
+            case 0xc5: case 0xda: take(bigEndian(2)); break;
+            case 0xc6: case 0xdb: take(bigEndian(4)); break;
+            case 0xc7: take(bigEndian(1) + 1); break;
+            case 0xc8: take(bigEndian(2) + 1); break;
+            case 0xc9: take(bigEndian(4) + 1); break;
+            case 0xcc: case 0xd0: take(1); break;
+            case 0xcd: case 0xd1: take(2); break;
+            case 0xca: case 0xce: case 0xd2: take(4); break;
+            case 0xcb: case 0xcf: case 0xd3: take(8); break;
+            case 0xd4: take(2); break;
+            case 0xd5: take(3); break;
+            case 0xd6: take(5); break;
+            case 0xd7: take(9); break;
+            case 0xd8: take(17); break;
+            case 0xdc: count += bigEndian(2); break;
+            case 0xdd: count += bigEndian(4); break;
+            case 0xde: count += 2 * bigEndian(2); break;
+            case 0xdf: count += 2 * bigEndian(4); break;
+            default: malformed("object");
+            }
+        }
+    }
+
+private:
+    unsigned char byte()
+    {
+        need(1);
+        return fData[fOffset++];
+    }
+
+    uint64_t bigEndian(size_t bytes)
+    {
+        need(bytes);
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            value = (value << 8) | fData[fOffset++];
+        }
+        return value;
+    }
+
+    uint64_t checkSign(unsigned char tag, uint64_t value)
+    {
+        // msgpack packs non-negative integers unsigned, signed ones are accepted if positive
+        if (tag >= 0xd0 && (value >> (8 * (size_t(1) << (tag - 0xd0)) - 1)) != 0)
+        {
+            malformed("unsigned integer");
+        }
+        return value;
+    }
+
+    [[noreturn]] void malformed(const char* expected)
+    {
+        MCF_THROW_RUNTIME(fmt::format("Malformed record, expected {} at offset {}", expected, fOffset));
+    }
+
+    const unsigned char* fData;
+    size_t fSize;
+    size_t fOffset;
+};
+
+uint64_t readVarint(const char* data, size_t size, size_t& offset)
+{
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+        if (offset >= size)
+        {
+            break;
+        }
+        const auto byte = static_cast<unsigned char>(data[offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+    MCF_THROW_RUNTIME("Malformed delta record");
+}
+
+class IdInjector : public IidGenerator {
+public:
+    explicit IdInjector(uint64_t id) : fId(id) {}
+
+    void injectId(Value& value) const override
+    {
+        setId(value, fId);
+    }
+
+private:
+    const uint64_t fId;
+};
+
+// lets unpacked strings and binaries refer to the record instead of copying them into the zone
+bool referenceRecord(msgpack::type::object_type, size_t, void*)
+{
+    return true;
+}
+
+} // anonymous namespace
+
+RecordReader::~RecordReader()
+{
+    close();
+}
+
+void RecordReader::open(const std::string& filename)
+{
+    close();
+    fFile = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fFile < 0)
+    {
+        MCF_THROW_RUNTIME(fmt::format("Cannot open record file {}: {}", filename, strerror(errno)));
+    }
+    struct stat st{};
+    if (fstat(fFile, &st) != 0)
+    {
+        const int error = errno;
+        close();
+        MCF_THROW_RUNTIME(fmt::format("Cannot stat record file {}: {}", filename, strerror(error)));
+    }
+    fSize = static_cast<size_t>(st.st_size);
+    if (fSize > 0)
+    {
+        void* data = mmap(nullptr, fSize, PROT_READ, MAP_PRIVATE, fFile, 0);
+        if (data == MAP_FAILED)
+        {
+            const int error = errno;
+            close();
+            MCF_THROW_RUNTIME(fmt::format("Cannot map record file {}: {}", filename, strerror(error)));
+        }
+        // records are mostly read front to back
+        madvise(data, fSize, MADV_SEQUENTIAL);
+        fData = static_cast<const char*>(data);
+        const size_t size = fSize;
+        fMapping = std::shared_ptr<const char>(fData, [size](const char* mapping)
+        {
+            munmap(const_cast<char*>(mapping), size);
+        });
+    }
+    readFooter();
+    rewind();
+}
+
+void RecordReader::close()
+{
+    fMapping.reset();
+    fData = nullptr;
+    if (fFile >= 0)
+    {
+        ::close(fFile);
+        fFile = -1;
+    }
+    fSize = 0;
+    fOffset = 0;
+    fFooter.reset();
+    fChunk.clear();
+    fChunkRecords = 0;
+    fDeltas.clear();
+}
+
+void RecordReader::readFooter()
+{
+    fFooter.reset();
+    if (fSize < 16 || std::memcmp(fData + fSize - 8, ValueRecorder::FOOTER_MAGIC, 8) != 0)
+    {
+        return;
+    }
+    uint64_t footerOffset = 0;
+    for (int i = 7; i >= 0; --i)
+    {
+        footerOffset = (footerOffset << 8) | static_cast<unsigned char>(fData[fSize - 16 + i]);
+    }
+    if (footerOffset >= fSize)
+    {
+        return;
+    }
+    size_t offset = footerOffset;
+    Record record;
+    if (!parse(fData, fSize, offset, record) || record.topic != ValueRecorder::FOOTER_TOPIC)
+    {
+        return;
+    }
+    auto oh = msgpack::unpack(record.value.data, record.value.size);
+    fFooter = std::make_shared<msg::RecordFooter>(oh.get().as<msg::RecordFooter>());
+}
+
+uint64_t RecordReader::recover(const std::string& filename)
+{
+    uint64_t syncedSize;
+    {
+        RecordReader reader;
+        reader.open(filename);
+        if (reader.fFooter != nullptr)
+        {
+            return reader.fSize;
+        }
+        syncedSize = reader.findSyncedSize();
+        if (syncedSize == reader.fSize)
+        {
+            return syncedSize;
+        }
+    }
+    if (truncate(filename.c_str(), static_cast<off_t>(syncedSize)) != 0)
+    {
+        MCF_THROW_RUNTIME(fmt::format("Cannot truncate record file {}: {}", filename, strerror(errno)));
+    }
+    return syncedSize;
+}
+
+uint64_t RecordReader::findSyncedSize()
+{
+    for (size_t end = fSize; end >= 16; --end)
+    {
+        if (std::memcmp(fData + end - 8, ValueRecorder::SYNC_MAGIC, 8) != 0)
+        {
+            continue;
+        }
+        uint64_t markerOffset = 0;
+        for (int i = 7; i >= 0; --i)
+        {
+            markerOffset = (markerOffset << 8) | static_cast<unsigned char>(fData[end - 16 + i]);
+        }
+        if (markerOffset >= end - 16)
+        {
+            continue;
+        }
+        // the magic may also occur in recorded data, the marker record must end with it
+        size_t offset = markerOffset;
+        Record record;
+        try
+        {
+            if (!parse(fData, end, offset, record) || offset != end
+                || record.topic != ValueRecorder::SYNC_TOPIC)
+            {
+                continue;
+            }
+            auto oh = msgpack::unpack(record.value.data, record.value.size);
+            const auto marker = oh.get().as<msg::RecordSyncMarker>();
+            if (marker.syncedSize <= markerOffset)
+            {
+                return marker.syncedSize;
+            }
+        }
+        catch (const std::exception&)
+        {
+            // not a marker
+        }
+    }
+    return fSize;
+}
+
+void RecordReader::setTopicFilter(std::vector<std::string> topics)
+{
+    std::sort(topics.begin(), topics.end());
+    fTopics = std::move(topics);
+}
+
+void RecordReader::seek(uint64_t time)
+{
+    fOffset = 0;
+    if (fFooter != nullptr && time > 0)
+    {
+        // the last checkpoint not after time, records before it are older
+        auto it = std::upper_bound(fFooter->times.begin(), fFooter->times.end(), time);
+        if (it != fFooter->times.begin())
+        {
+            fOffset = fFooter->offsets[std::distance(fFooter->times.begin(), it) - 1];
+        }
+    }
+    fStartTime = time;
+    fChunk.clear();
+    fChunkRecords = 0;
+    // each checkpoint is followed by keyframes
+    fDeltas.clear();
+}
+
+bool RecordReader::next(Record& record)
+{
+    while (true)
+    {
+        if (fChunkRecords > 0)
+        {
+            --fChunkRecords;
+            if (!parse(fChunk.data(), fChunk.size(), fChunkPosition, record))
+            {
+                MCF_THROW_RUNTIME(fmt::format("Truncated chunk at offset {}", fChunkOffset));
+            }
+            record.offset = fChunkOffset;
+            record.size = 0;
+        }
+        else
+        {
+            size_t offset = fOffset;
+            if (fData == nullptr || !parse(fData, fSize, offset, record))
+            {
+                return false;
+            }
+            record.offset = fOffset;
+            record.size = offset - fOffset;
+            fOffset = offset;
+            if (record.topic == ValueRecorder::CHUNK_TOPIC)
+            {
+                openChunk(record);
+                continue;
+            }
+        }
+        if (!accepted(record.topic)
+            || (record.tid == DELTA_TYPE_ID && !applyDelta(record))
+            || record.time < fStartTime)
+        {
+            continue;
+        }
+        // only data in the file can be shared, not that in buffers of the reader
+        const bool mapped = record.extMem.size > 0 && record.extMem.data >= fData
+            && record.extMem.data < fData + fSize;
+        if (fShareExtMem && mapped)
+        {
+            record.extMemOwner = fMapping;
+        }
+        else
+        {
+            record.extMemOwner.reset();
+        }
+        return true;
+    }
+}
+
+ValuePtr RecordReader::getValue(const Record& record, const TypeRegistry& registry)
+{
+    const auto* typeinfoPtr = registry.findTypeInfo(record.tid.str());
+    if (typeinfoPtr == nullptr)
+    {
+        return nullptr;
+    }
+    // decoded into a zone reused by all records read by this thread, strings and binaries refer
+    // to the record, values of pooled types are decoded directly into memory of their pool
+    static thread_local msgpack::zone zone;
+    zone.clear();
+    size_t offset = 0;
+    bool referenced = false;
+    msgpack::object obj = msgpack::unpack(
+        zone, record.value.data, record.value.size, offset, referenced, &referenceRecord);
+    bool isExtMem = false;
+    std::shared_ptr<Value> value;
+    if (record.extMemOwner != nullptr)
+    {
+        // unpacked without ext mem data, which is then shared if the type supports it
+        value = TypeRegistry::unpackSharedValue(*typeinfoPtr, obj, nullptr, 0, isExtMem);
+        auto* extMemValue = dynamic_cast<IExtMemValue*>(value.get());
+        if (extMemValue == nullptr
+            || !extMemValue->extMemShare(record.extMemOwner, record.extMem.data, record.extMem.size))
+        {
+            value.reset();
+        }
+    }
+    if (value == nullptr)
+    {
+        value = TypeRegistry::unpackSharedValue(
+            *typeinfoPtr, obj, record.extMem.data, record.extMem.size, isExtMem);
+    }
+    IdInjector(record.vid).injectId(*value);
+    return ValuePtr(std::move(value));
+}
+
+bool RecordReader::parse(const char* data, size_t size, size_t& offset, Record& record)
+{
+    try
+    {
+        Cursor cursor(data, size, offset);
+        const uint32_t headerSize = cursor.readArray();
+        if (headerSize < 4)
+        {
+            MCF_THROW_RUNTIME(fmt::format("Malformed record header at offset {}", offset));
+        }
+        record.time = cursor.readUint();
+        record.topic = cursor.readStr();
+        record.tid = cursor.readStr();
+        record.vid = cursor.readUint();
+        record.seq = 0;
+        if (headerSize > 4)
+        {
+            // recorded since the header has 5 elements
+            record.seq = cursor.readUint();
+            cursor.skip(headerSize - 5);
+        }
+
+        const size_t valueStart = cursor.offset();
+        cursor.skip();
+        record.value.data = data + valueStart;
+        record.value.size = cursor.offset() - valueStart;
+
+        const uint32_t extMemHeaderSize = cursor.readArray();
+        if (extMemHeaderSize < 2)
+        {
+            MCF_THROW_RUNTIME(fmt::format("Malformed ext mem header at offset {}", offset));
+        }
+        record.extMemSize = static_cast<uint32_t>(cursor.readUint());
+        const bool present = cursor.readBool();
+        const uint64_t compressedSize = extMemHeaderSize > 2 ? cursor.readUint() : 0;
+        cursor.skip(extMemHeaderSize - std::min<uint32_t>(extMemHeaderSize, 3));
+
+        record.extMem = View();
+        if (present)
+        {
+            const char* extMem = cursor.take(compressedSize > 0 ? compressedSize : record.extMemSize);
+            if (compressedSize > 0)
+            {
+#if HAVE_ZLIB
+                fExtMem.resize(record.extMemSize);
+                uLongf length = record.extMemSize;
+                if (uncompress(reinterpret_cast<Bytef*>(fExtMem.data()), &length,
+                        reinterpret_cast<const Bytef*>(extMem), compressedSize) != Z_OK
+                    || length != record.extMemSize)
+                {
+                    MCF_THROW_RUNTIME(fmt::format("Cannot decompress ext mem data at offset {}", offset));
+                }
+                extMem = fExtMem.data();
+#else
+                MCF_THROW_RUNTIME("Compressed ext mem data cannot be read. Make sure HAVE_ZLIB is set.");
+#endif
+            }
+            record.extMem.data = extMem;
+            record.extMem.size = record.extMemSize;
+        }
+        offset = cursor.offset();
+        return true;
+    }
+    catch (const Truncated&)
+    {
+        return false;
+    }
+}
+
+void RecordReader::openChunk(const Record& chunk)
+{
+#if HAVE_ZLIB
+    auto oh = msgpack::unpack(chunk.value.data, chunk.value.size);
+    const auto value = oh.get().as<msg::RecordChunk>();
+    if (value.codec != "deflate")
+    {
+        MCF_THROW_RUNTIME(fmt::format("Unsupported chunk codec {} at offset {}", value.codec, chunk.offset));
+    }
+    // the uncompressed records are in fExtMem
+    if (chunk.extMem.data == fExtMem.data())
+    {
+        fChunk.swap(fExtMem);
+        fChunk.resize(chunk.extMem.size);
+    }
+    else
+    {
+        fChunk.assign(chunk.extMem.data, chunk.extMem.data + chunk.extMem.size);
+    }
+    fChunkOffset = chunk.offset;
+    fChunkPosition = 0;
+    fChunkRecords = value.records;
+#else
+    (void)chunk;
+    MCF_THROW_RUNTIME("Record chunks cannot be read. Make sure HAVE_ZLIB is set.");
+#endif
+}
+
+bool RecordReader::applyDelta(Record& record)
+{
+    Cursor cursor(record.value.data, record.value.size, 0);
+    View tid;
+    bool keyframe;
+    uint64_t valueSize;
+    uint64_t extMemSize;
+    bool extMemPresent;
+    try
+    {
+        if (cursor.readArray() < 5)
+        {
+            MCF_THROW_RUNTIME(fmt::format("Malformed delta record at offset {}", record.offset));
+        }
+        tid = cursor.readStr();
+        keyframe = cursor.readBool();
+        valueSize = cursor.readUint();
+        extMemSize = cursor.readUint();
+        extMemPresent = cursor.readBool();
+    }
+    catch (const Truncated&)
+    {
+        MCF_THROW_RUNTIME(fmt::format("Malformed delta record at offset {}", record.offset));
+    }
+    const size_t payloadSize = valueSize + (extMemPresent ? extMemSize : 0);
+
+    // the key buffer keeps its capacity, so that the lookup does not allocate
+    fDeltaTopic.assign(record.topic.data, record.topic.size);
+    auto it = fDeltas.find(fDeltaTopic);
+    if (it == fDeltas.end())
+    {
+        if (!keyframe)
+        {
+            return false;
+        }
+        it = fDeltas.emplace(fDeltaTopic, DeltaState()).first;
+    }
+    DeltaState& state = it->second;
+    const char* data = record.extMem.data;
+    const size_t size = record.extMem.size;
+    if (keyframe)
+    {
+        if (size != payloadSize)
+        {
+            MCF_THROW_RUNTIME(fmt::format("Malformed delta record at offset {}", record.offset));
+        }
+        state.payload.assign(data, data + size);
+    }
+    else
+    {
+        // unchanged runs are left in place, the payload is only resized
+        const size_t previousSize = state.payload.size();
+        state.payload.resize(payloadSize);
+        size_t offset = 0;
+        size_t position = 0;
+        while (position < payloadSize)
+        {
+            const uint64_t unchanged = readVarint(data, size, offset);
+            const uint64_t changed = readVarint(data, size, offset);
+            if (unchanged > payloadSize - position
+                || position + unchanged > previousSize
+                || changed > payloadSize - position - unchanged
+                || changed > size - offset)
+            {
+                MCF_THROW_RUNTIME(fmt::format("Malformed delta record at offset {}", record.offset));
+            }
+            position += unchanged;
+            std::memcpy(state.payload.data() + position, data + offset, changed);
+            offset += changed;
+            position += changed;
+        }
+    }
+    if (!(tid == state.tid))
+    {
+        state.tid.assign(tid.data, tid.size);
+    }
+
+    record.size = 0;
+    record.tid.data = state.tid.data();
+    record.tid.size = state.tid.size();
+    record.value.data = state.payload.data();
+    record.value.size = valueSize;
+    record.extMemSize = static_cast<uint32_t>(extMemSize);
+    record.extMem = View();
+    if (extMemPresent)
+    {
+        record.extMem.data = state.payload.data() + valueSize;
+        record.extMem.size = extMemSize;
+    }
+    return true;
+}
+
+bool RecordReader::accepted(const View& topic) const
+{
+    if (fTopics.empty())
+    {
+        return true;
+    }
+    auto it = std::lower_bound(fTopics.begin(), fTopics.end(), topic,
+        [](const std::string& a, const View& b) { return a.compare(0, a.size(), b.data, b.size) < 0; });
+    return it != fTopics.end() && topic == *it;
+}
+
+} // namespace mcf
@@ -0,0 +1,499 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/RecorderStorage.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mcf {
+
+constexpr size_t DirectFileStorage::ALIGNMENT;
+
+namespace {
+
+/// Maximum number of iovecs passed to a single writev()
+constexpr size_t MAX_IOV = 512;
+
+size_t alignUp(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+size_t alignDown(size_t size, size_t alignment) {
+    return size / alignment * alignment;
+}
+
+int reserve(int file, uint64_t bytes) {
+    if (file < 0) {
+        return EBADF;
+    }
+    while (fallocate(file, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes)) != 0) {
+        if (errno != EINTR) {
+            return errno;
+        }
+    }
+    return 0;
+}
+
+/// Release the reserved space behind the end of the file. Truncating frees the blocks behind the
+/// end even if the size does not change, punching a hole there is a no-op on ext4.
+int releaseReserved(int file, uint64_t size, uint64_t reserved) {
+    if (reserved > size && ftruncate(file, static_cast<off_t>(size)) != 0) {
+        return errno;
+    }
+    return 0;
+}
+
+} // anonymous namespace
+
+BufferedFileStorage::~BufferedFileStorage() {
+    close();
+}
+
+int BufferedFileStorage::open(const std::string& filename) {
+    fFile = ::open(filename.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0666);
+    fBytesWritten = 0;
+    fReserved = 0;
+    return fFile >= 0 ? 0 : errno;
+}
+
+int BufferedFileStorage::preallocate(uint64_t bytes) {
+    int result = reserve(fFile, bytes);
+    if (result == 0) {
+        fReserved = std::max(fReserved, bytes);
+    }
+    return result;
+}
+
+int BufferedFileStorage::write(const iovec* iov, size_t count) {
+    std::vector<iovec> pending(iov, iov + count);
+    size_t next = 0;
+    while (next < pending.size()) {
+        ssize_t written = writev(fFile, &pending[next], static_cast<int>(std::min(pending.size() - next, MAX_IOV)));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        fBytesWritten += written;
+        // skip the written iovecs and continue with a partial one
+        size_t remaining = static_cast<size_t>(written);
+        while (next < pending.size() && remaining >= pending[next].iov_len) {
+            remaining -= pending[next].iov_len;
+            ++next;
+        }
+        if (next < pending.size()) {
+            pending[next].iov_base = static_cast<char*>(pending[next].iov_base) + remaining;
+            pending[next].iov_len -= remaining;
+        }
+    }
+    return 0;
+}
+
+int BufferedFileStorage::sync() {
+    if (fFile < 0) {
+        return EBADF;
+    }
+    while (fdatasync(fFile) != 0) {
+        if (errno != EINTR) {
+            return errno;
+        }
+    }
+    return 0;
+}
+
+int BufferedFileStorage::close() {
+    if (fFile < 0) {
+        return 0;
+    }
+    int result = releaseReserved(fFile, fBytesWritten, fReserved);
+    if (::close(fFile) != 0 && result == 0) {
+        result = errno;
+    }
+    fFile = -1;
+    return result;
+}
+
+/**
+ * The mapped submission and completion rings of an io_uring instance
+ */
+struct DirectFileStorage::Ring {
+    int fd = -1;
+    void* sqRing = nullptr;
+    size_t sqRingSize = 0;
+    void* cqRing = nullptr;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    /// Set up a ring for the given number of entries, returns 0 or an errno value
+    int setup(unsigned entries) {
+        io_uring_params params{};
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return errno;
+        }
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            sqRing = nullptr;
+            return errno;
+        }
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            cqRing = sqRing;
+        }
+        else {
+            cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED) {
+                cqRing = nullptr;
+                return errno;
+            }
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqesMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqesMap == MAP_FAILED) {
+            return errno;
+        }
+        sqes = static_cast<io_uring_sqe*>(sqesMap);
+
+        char* sq = static_cast<char*>(sqRing);
+        char* cq = static_cast<char*>(cqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return 0;
+    }
+
+    ~Ring() {
+        if (sqes != nullptr) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqRing != nullptr && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != nullptr) {
+            munmap(sqRing, sqRingSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    /// Queue a write and submit it to the kernel, returns 0 or an errno value
+    int submitWrite(int file, const char* data, size_t length, uint64_t offset, uint64_t userData) {
+        // only this thread produces submissions, the kernel consumes them on io_uring_enter()
+        const unsigned tail = *sqTail;
+        const unsigned index = tail & *sqMask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.fd = file;
+        sqe.addr = reinterpret_cast<uint64_t>(data);
+        sqe.len = static_cast<uint32_t>(length);
+        sqe.off = offset;
+        sqe.user_data = userData;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        while (syscall(__NR_io_uring_enter, fd, 1, 0, 0, nullptr, 0) < 0) {
+            if (errno != EINTR) {
+                return errno;
+            }
+        }
+        return 0;
+    }
+
+    /// Wait until a completion is available, returns 0 or an errno value
+    int waitCompletion() {
+        while (__atomic_load_n(cqTail, __ATOMIC_ACQUIRE) == *cqHead) {
+            if (syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                return errno;
+            }
+        }
+        return 0;
+    }
+};
+
+DirectFileStorage::DirectFileStorage(size_t segmentSize, size_t queueDepth)
+: fSegmentSize(alignUp(std::max<size_t>(segmentSize, 1), ALIGNMENT))
+, fQueueDepth(std::max<size_t>(queueDepth, 1))
+{}
+
+DirectFileStorage::~DirectFileStorage() {
+    close();
+}
+
+int DirectFileStorage::open(const std::string& filename) {
+    close();
+    fFile = ::open(filename.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_DIRECT, 0666);
+    if (fFile < 0) {
+        return errno;
+    }
+    fRing = new Ring();
+    int result = fRing->setup(static_cast<unsigned>(fQueueDepth));
+    if (result == 0) {
+        fSegments.resize(fQueueDepth + 1);
+        for (auto& segment : fSegments) {
+            void* data = nullptr;
+            result = posix_memalign(&data, ALIGNMENT, fSegmentSize);
+            if (result != 0) {
+                break;
+            }
+            segment.data = static_cast<char*>(data);
+        }
+    }
+    if (result != 0) {
+        release();
+        return result;
+    }
+    fCurrent = 0;
+    fInFlight = 0;
+    fOffset = 0;
+    fError = 0;
+    fReserved = 0;
+    fSyncedTail = 0;
+    fBytesWritten = 0;
+    return 0;
+}
+
+int DirectFileStorage::preallocate(uint64_t bytes) {
+    int result = reserve(fFile, bytes);
+    if (result == 0) {
+        fReserved = std::max(fReserved, bytes);
+    }
+    return result;
+}
+
+int DirectFileStorage::write(const iovec* iov, size_t count) {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    if (fError != 0) {
+        return fError;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const char* data = static_cast<const char*>(iov[i].iov_base);
+        size_t size = iov[i].iov_len;
+        while (size > 0) {
+            Segment& segment = fSegments[fCurrent];
+            const size_t chunk = std::min(size, fSegmentSize - segment.used);
+            std::memcpy(segment.data + segment.used, data, chunk);
+            segment.used += chunk;
+            data += chunk;
+            size -= chunk;
+            if (segment.used == fSegmentSize) {
+                int result = submitCurrent();
+                if (result != 0) {
+                    return result;
+                }
+            }
+        }
+    }
+    return fError;
+}
+
+int DirectFileStorage::sync() {
+    {
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+        if (fFile < 0) {
+            return EBADF;
+        }
+        while (fInFlight > 0 && fError == 0) {
+            int result = reap();
+            if (result != 0) {
+                return result;
+            }
+        }
+        if (fError != 0) {
+            return fError;
+        }
+        int result = writeTail();
+        if (result != 0) {
+            return result;
+        }
+    }
+    while (fdatasync(fFile) != 0) {
+        if (errno != EINTR) {
+            return errno;
+        }
+    }
+    return 0;
+}
+
+int DirectFileStorage::close() {
+    if (fFile < 0) {
+        return 0;
+    }
+    // the last segment is padded, because O_DIRECT needs aligned lengths
+    Segment& last = fSegments[fCurrent];
+    const uint64_t fileSize = fOffset + last.used;
+    if (last.used > 0 && fError == 0) {
+        const size_t padded = alignUp(last.used, ALIGNMENT);
+        std::memset(last.data + last.used, 0, padded - last.used);
+        last.offset = fOffset;
+        last.length = padded;
+        int result = submit(last, fCurrent);
+        if (result != 0 && fError == 0) {
+            fError = result;
+        }
+    }
+    while (fInFlight > 0) {
+        int result = reap();
+        if (result != 0) {
+            fError = fError != 0 ? fError : result;
+            break;
+        }
+    }
+    if (fError == 0 && ftruncate(fFile, static_cast<off_t>(fileSize)) != 0) {
+        fError = errno;
+    }
+    releaseReserved(fFile, fileSize, fReserved);
+    if (fInFlight > 0) {
+        // the kernel may still access the buffers of writes in flight after an error, hence
+        // they are not freed
+        for (auto& segment : fSegments) {
+            if (segment.inFlight) {
+                segment.data = nullptr;
+            }
+        }
+    }
+    release();
+    return fError;
+}
+
+int DirectFileStorage::submitCurrent() {
+    Segment& segment = fSegments[fCurrent];
+    segment.offset = fOffset;
+    segment.length = segment.used;
+    int result = submit(segment, fCurrent);
+    if (result != 0) {
+        fError = result;
+        return result;
+    }
+    fOffset += segment.used;
+    fCurrent = (fCurrent + 1) % fSegments.size();
+    fSyncedTail = 0;
+    while (fSegments[fCurrent].inFlight) {
+        result = reap();
+        if (result != 0) {
+            fError = result;
+            return result;
+        }
+    }
+    return fError;
+}
+
+int DirectFileStorage::writeTail() {
+    Segment& segment = fSegments[fCurrent];
+    // the block holding the end of the previous sync is written again, with the data added since
+    const size_t begin = alignDown(fSyncedTail, ALIGNMENT);
+    const size_t end = alignUp(segment.used, ALIGNMENT);
+    if (segment.used == fSyncedTail || begin == end) {
+        return 0;
+    }
+    std::memset(segment.data + segment.used, 0, end - segment.used);
+    size_t done = 0;
+    while (begin + done < end) {
+        ssize_t written = pwrite(fFile, segment.data + begin + done, end - begin - done,
+                                 static_cast<off_t>(fOffset + begin + done));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        done += static_cast<size_t>(written);
+    }
+    fSyncedTail = segment.used;
+    return 0;
+}
+
+int DirectFileStorage::submit(Segment& segment, size_t index) {
+    int result = fRing->submitWrite(fFile, segment.data, segment.length, segment.offset, index);
+    if (result == 0) {
+        segment.inFlight = true;
+        ++fInFlight;
+    }
+    return result;
+}
+
+int DirectFileStorage::reap() {
+    int result = fRing->waitCompletion();
+    if (result != 0) {
+        return result;
+    }
+    unsigned head = *fRing->cqHead;
+    const unsigned tail = __atomic_load_n(fRing->cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = fRing->cqes[head & *fRing->cqMask];
+        Segment& segment = fSegments[cqe.user_data];
+        --fInFlight;
+        if (cqe.res < 0) {
+            segment.inFlight = false;
+            fError = fError != 0 ? fError : -cqe.res;
+        }
+        else if (static_cast<size_t>(cqe.res) < segment.length) {
+            // short write, e.g. at a signal, write the rest
+            segment.offset += cqe.res;
+            segment.length -= cqe.res;
+            const size_t done = static_cast<size_t>(cqe.res);
+            fBytesWritten += std::min(done, segment.used);
+            segment.used -= std::min(done, segment.used);
+            result = fRing->submitWrite(fFile, segment.data + (segment.offset % fSegmentSize), segment.length,
+                                        segment.offset, cqe.user_data);
+            if (result == 0) {
+                ++fInFlight;
+            }
+            else {
+                segment.inFlight = false;
+                fError = fError != 0 ? fError : result;
+            }
+        }
+        else {
+            fBytesWritten += segment.used;
+            segment.used = 0;
+            segment.inFlight = false;
+        }
+    }
+    __atomic_store_n(fRing->cqHead, head, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void DirectFileStorage::release() {
+    for (auto& segment : fSegments) {
+        std::free(segment.data);
+    }
+    fSegments.clear();
+    delete fRing;
+    fRing = nullptr;
+    if (fFile >= 0) {
+        ::close(fFile);
+        fFile = -1;
+    }
+}
+
+} // namespace mcf
@@ -0,0 +1,357 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/RecordingEventSource.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/IEventTimingController.h"
+#include "mcf_core/IExtMemValue.h"
+#include "mcf_core/LoggingMacros.h"
+#include "mcf_core/RecordReader.h"
+#include "mcf_core/ThreadName.h"
+#include "mcf_core/TimestampType.h"
+#include "mcf_core/ValueRecorder.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <unordered_map>
+
+namespace mcf {
+
+RecordingEventSource::RecordingEventSource(ValueStore& valueStore,
+                                           const std::string& filename,
+                                           std::weak_ptr<mcf::IEventTimingController> eventTimingController,
+                                           Params params)
+: RecordingEventSource(valueStore,
+                       std::vector<Recording>{Recording{filename, std::chrono::microseconds(0)}},
+                       std::move(eventTimingController),
+                       std::move(params))
+{
+}
+
+RecordingEventSource::RecordingEventSource(ValueStore& valueStore,
+                                           const std::vector<Recording>& recordings,
+                                           std::weak_ptr<mcf::IEventTimingController> eventTimingController,
+                                           Params params)
+: fValueStore(valueStore)
+, fEventTimingController(std::move(eventTimingController))
+, fParams(std::move(params))
+{
+    MCF_ASSERT(!recordings.empty(), "RecordingEventSource: no recording to replay");
+    for (const auto& recording : recordings)
+    {
+        auto stream = std::make_unique<Stream>();
+        stream->reader = std::make_unique<RecordReader>();
+        stream->reader->open(recording.filename);
+        stream->reader->setTopicFilter(fParams.topics);
+        stream->reader->setShareExtMem(fParams.shareExtMem);
+        stream->clockOffset = recording.clockOffset;
+        if (fParams.startTime > 0)
+        {
+            seekStream(*stream, fParams.startTime);
+        }
+        fStreams.push_back(std::move(stream));
+    }
+    startReading();
+}
+
+RecordingEventSource::~RecordingEventSource()
+{
+    stopReading();
+}
+
+bool RecordingEventSource::getNextEventInfo(TimestampType &nextEventTimestamp, std::string &nextEventTopic)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    Stream* stream = nextStream();
+    if (stream == nullptr)
+    {
+        return false;
+    }
+    nextEventTimestamp = TimestampType(stream->buffer.front().time);
+    nextEventTopic = *stream->buffer.front().topic;
+    return true;
+}
+
+void RecordingEventSource::fireEvent()
+{
+    Event event;
+    Stream* stream = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        stream = nextStream();
+        if (stream == nullptr)
+        {
+            return;
+        }
+        event = takeNextEvent(*stream);
+    }
+    stream->bufferSpace.notify_one();
+    // numbered per replayed recording, see ValueStore::injectValue()
+    fValueStore.injectValue(*event.topic, event.value, ValueOrigin{stream, event.seq});
+}
+
+bool RecordingEventSource::dropEvent()
+{
+    Stream* stream = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        stream = nextStream();
+        if (stream != nullptr)
+        {
+            takeNextEvent(*stream);
+        }
+    }
+    if (stream != nullptr)
+    {
+        stream->bufferSpace.notify_one();
+    }
+    return true;
+}
+
+bool RecordingEventSource::isFinished()
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    for (const auto& stream : fStreams)
+    {
+        if (!stream->readFinished || !stream->buffer.empty())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RecordingEventSource::seek(const TimestampType& time)
+{
+    stopReading();
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        for (auto& stream : fStreams)
+        {
+            stream->buffer.clear();
+            stream->bufferedBytes = 0;
+            stream->readFinished = false;
+        }
+        fStop = false;
+    }
+    // copy so we can use static_cast
+    TimestampType seekTime(time);
+    for (auto& stream : fStreams)
+    {
+        seekStream(*stream, static_cast<IntTimestamp>(seekTime) / 1000);
+    }
+    startReading();
+    return true;
+}
+
+void RecordingEventSource::getBufferInfo(std::size_t& events, std::size_t& bytes) const
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    events = 0;
+    bytes = 0;
+    for (const auto& stream : fStreams)
+    {
+        events += stream->buffer.size();
+        bytes += stream->bufferedBytes;
+    }
+}
+
+std::size_t RecordingEventSource::getPrefetchedCount() const
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    return fPrefetched;
+}
+
+void RecordingEventSource::seekStream(Stream& stream, uint64_t time)
+{
+    // the record times of the file are not corrected yet
+    const int64_t recordTime = static_cast<int64_t>(time)
+        - std::chrono::duration_cast<std::chrono::milliseconds>(stream.clockOffset).count();
+    stream.reader->seek(static_cast<uint64_t>(std::max<int64_t>(recordTime, 0)));
+}
+
+RecordingEventSource::Stream* RecordingEventSource::nextStream()
+{
+    // a linear scan, there are few recordings and their read threads insert before the fronts
+    Stream* next = nullptr;
+    for (const auto& stream : fStreams)
+    {
+        if (stream->buffer.empty())
+        {
+            if (!stream->readFinished)
+            {
+                // its next event may be the earliest one
+                return nullptr;
+            }
+            continue;
+        }
+        if (next == nullptr || stream->buffer.front().time < next->buffer.front().time)
+        {
+            next = stream.get();
+        }
+    }
+    return next;
+}
+
+RecordingEventSource::Event RecordingEventSource::takeNextEvent(Stream& stream)
+{
+    Event event = std::move(stream.buffer.front());
+    stream.buffer.pop_front();
+    stream.bufferedBytes -= event.bytes;
+    return event;
+}
+
+void RecordingEventSource::startReading()
+{
+    for (auto& stream : fStreams)
+    {
+        stream->readThread = std::thread(&RecordingEventSource::readAhead, this, std::ref(*stream));
+    }
+}
+
+void RecordingEventSource::stopReading()
+{
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fStop = true;
+    }
+    for (auto& stream : fStreams)
+    {
+        stream->bufferSpace.notify_all();
+    }
+    for (auto& stream : fStreams)
+    {
+        if (stream->readThread.joinable())
+        {
+            stream->readThread.join();
+        }
+    }
+}
+
+bool RecordingEventSource::bufferFull(const Stream& stream) const
+{
+    if (stream.buffer.empty())
+    {
+        return false;
+    }
+    const auto duration = std::chrono::microseconds(stream.buffer.back().time - stream.buffer.front().time);
+    return duration >= fParams.bufferDuration || stream.bufferedBytes >= fParams.bufferBytes;
+}
+
+bool RecordingEventSource::isPrefetched(const std::string& topic) const
+{
+    for (const auto& pattern : fParams.prefetchTopics)
+    {
+        if (ValueStore::matchesPattern(pattern, topic))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RecordingEventSource::readAhead(Stream& stream)
+{
+    setThreadName("RecordingES");
+    std::unordered_set<std::string> unknownTypes;
+    // by interned topic, false once a value of the topic could not be uploaded
+    std::unordered_map<const std::string*, bool> prefetchedTopics;
+    RecordReader::Record record;
+    try
+    {
+        while (stream.reader->next(record))
+        {
+            if (record.topic == ValueRecorder::INDEX_TOPIC
+                || record.topic == ValueRecorder::FOOTER_TOPIC
+                || record.topic == ValueRecorder::SYNC_TOPIC)
+            {
+                continue;
+            }
+            // deserialized without holding the lock, while events are fired
+            ValuePtr value = RecordReader::getValue(record, fValueStore);
+            if (!value)
+            {
+                if (unknownTypes.insert(record.tid.str()).second)
+                {
+                    MCF_WARN_NOFILELINE("Skipping recorded values of unregistered type {}", record.tid.str());
+                }
+                continue;
+            }
+            const int64_t time = static_cast<int64_t>(record.time) * 1000 + stream.clockOffset.count();
+            Event event;
+            event.time = static_cast<IntTimestamp>(std::max<int64_t>(time, 0));
+            event.topic = &*stream.topicNames.insert(record.topic.str()).first;
+            event.value = std::move(value);
+            event.seq = record.seq;
+            event.bytes = record.value.size + record.extMem.size;
+
+            bool prefetched = false;
+            if (!fParams.prefetchTopics.empty())
+            {
+                auto it = prefetchedTopics.find(event.topic);
+                if (it == prefetchedTopics.end())
+                {
+                    it = prefetchedTopics.emplace(event.topic, isPrefetched(*event.topic)).first;
+                }
+                if (it->second)
+                {
+                    // the value is not shared yet, the upload runs while it waits in the buffer
+                    const auto* extMemValue = dynamic_cast<const IExtMemValue*>(event.value.get());
+                    prefetched = extMemValue != nullptr && extMemValue->extMemUpload(fParams.prefetchDevice);
+                    if (!prefetched)
+                    {
+                        MCF_WARN_NOFILELINE("Cannot upload recorded values of topic {} to device {}",
+                                            *event.topic, fParams.prefetchDevice);
+                        it->second = false;
+                    }
+                }
+            }
+
+            bool first = false;
+            {
+                std::unique_lock<std::mutex> lock(fMutex);
+                stream.bufferSpace.wait(lock, [this, &stream] { return !bufferFull(stream) || fStop; });
+                if (fStop)
+                {
+                    return;
+                }
+                // records are about in time order, except e.g. those of chunks
+                auto it = stream.buffer.end();
+                while (it != stream.buffer.begin() && std::prev(it)->time > event.time)
+                {
+                    --it;
+                }
+                first = it == stream.buffer.begin();
+                stream.bufferedBytes += event.bytes;
+                fPrefetched += prefetched ? 1 : 0;
+                stream.buffer.insert(it, std::move(event));
+            }
+            if (first)
+            {
+                auto eventTimingController = fEventTimingController.lock();
+                if (eventTimingController)
+                {
+                    eventTimingController->triggerNewEventPushed(this);
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        MCF_ERROR_NOFILELINE("Cannot read recording: {}", e.what());
+    }
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        stream.readFinished = true;
+    }
+    // the event timing controller waits for the source to finish if it has fired all events,
+    // or for this recording if the others are ahead of it
+    auto eventTimingController = fEventTimingController.lock();
+    if (eventTimingController)
+    {
+        eventTimingController->triggerNewEventPushed(this);
+    }
+}
+
+} // namespace mcf
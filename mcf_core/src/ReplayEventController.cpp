@@ -13,7 +13,7 @@
 #include "json/json.h"
 #include "mcf_core/util/JsonLoader.h"
 #include "mcf_core/util/JsonValueExtractor.h"
-#include "mcf_core/util/MergeValues.h"
+#include "mcf_core/util/ConfigCache.h"
 
 namespace mcf {
 
@@ -99,6 +99,18 @@ void ReplayEventController::loadReplayEventControllerConfig(
     params.waitInputTopicName = valueExtractor.extractConfigString(config["WaitInputTopicName"], "WaitInputTopicName");
     params.stepTimeMicroSeconds = valueExtractor.extractConfigInt(config["StepTimeMicroSeconds"], "StepTimeMicroSeconds");
     startPaused = valueExtractor.extractConfigBool(config["StartPaused"], "StartPaused");
+    if (config.isMember("Unthrottled"))
+    {
+        params.unthrottled = valueExtractor.extractConfigBool(config["Unthrottled"], "Unthrottled");
+    }
+    if (config.isMember("Deterministic"))
+    {
+        params.deterministic = valueExtractor.extractConfigBool(config["Deterministic"], "Deterministic");
+    }
+    if (config.isMember("LookaheadMicroSeconds"))
+    {
+        params.lookaheadMicroSeconds = valueExtractor.extractConfigInt(config["LookaheadMicroSeconds"], "LookaheadMicroSeconds");
+    }
 
     if (speedFactor > 0)
     {
@@ -147,7 +159,7 @@ void ReplayEventController::loadReplayEventControllerConfig(
     }
 
     // obtain merged config
-    Json::Value config = mcf::util::json::mergeFiles(configFilePaths, true);
+    Json::Value config = mcf::util::json::ConfigCache::instance().mergeFiles(configFilePaths, true);
     loadReplayEventControllerConfig(config, params, speedFactor, startPaused);
 }
 
@@ -263,7 +275,9 @@ void ReplayEventController::runImpl()
 
         else if (getState() == UNINITIALIZED)
         {
-            std::this_thread::sleep_for(std::chrono::duration<unsigned int, std::micro>(10000));
+            // woken by setInitialisationComplete() or finishing playback
+            std::unique_lock<std::mutex> lockPlayback(fPlaybackMutex);
+            fPlaybackCondVar.wait(lockPlayback, [this]{ return fState != UNINITIALIZED; });
         }
 
         if (getState() == FINISHED)
@@ -385,6 +399,10 @@ void ReplayEventController::stepPlaybackOnceNonMutexed()
     // be woken to check them again after they're set since the topics won't be
     // republished.
     fExternalStepFlag = true;
+    if (fState == PLAYBACK && fRunMode != RunMode::CONTINUOUS)
+    {
+        fEventTimingController->beginStepLatency();
+    }
 
     fTopicTriggerFlags.manuallyTriggerEvent();
     fPlaybackCondVar.notify_all();
@@ -422,6 +440,11 @@ void ReplayEventController::finishPlaybackNonMutexed()
 {
     if (changeStateNonMutexed(FINISHED))
     {
+        if (fParams.unthrottled)
+        {
+            MCF_INFO_NOFILELINE("Unthrottled replay finished at {:.1f} times real time",
+                                fEventTimingController->getAchievedSpeedup());
+        }
         if (!fEventTimingController->isFinished())
         {
             fEventTimingController->finish();
@@ -463,6 +486,20 @@ void ReplayEventController::setParamsNonMutexed(ReplayEventController::Params pa
     {
         params.speedFactor = fParams.speedFactor;
     }
+
+    // stepping waits for simulation time, which does not pass while unthrottled
+    fEventTimingController->setUnthrottled(params.unthrottled && params.runMode != STEPTIME);
+
+    // values stamped by a replaced clock are still ordered by it
+    auto logicalClock = fEventTimingController->getLogicalClock();
+    if (!params.deterministic && logicalClock)
+    {
+        fEventTimingController->setLogicalClock(nullptr);
+    }
+    else if (params.deterministic && (!logicalClock || logicalClock->getLookahead() != params.lookaheadMicroSeconds))
+    {
+        fEventTimingController->setLogicalClock(std::make_shared<LogicalClock>(params.lookaheadMicroSeconds));
+    }
     
     // If ReplayEventController is initialised, use new parameters. Otherwise, only store them.
     if (fIsInitialised)
@@ -618,4 +655,34 @@ bool ReplayEventController::getTime(TimestampType& simulationTime) const
 }
 
 
+float ReplayEventController::getAchievedSpeedup() const
+{
+    return fEventTimingController->getAchievedSpeedup();
+}
+
+
+LatencyHistogram::Summary ReplayEventController::getStepLatency() const
+{
+    return fEventTimingController->getStepLatency();
+}
+
+bool ReplayEventController::seek(const TimestampType& time, std::chrono::microseconds preRoll)
+{
+    if (getState() == FINISHED)
+    {
+        MCF_WARN_NOFILELINE("Cannot seek, playback has finished");
+        return false;
+    }
+    if (!fEventTimingController->seek(time, preRoll))
+    {
+        return false;
+    }
+    if (getState() == PAUSED)
+    {
+        setPlaybackModifier(PlaybackModifier::RESUME);
+    }
+    return true;
+}
+
+
 } // namespace mcf
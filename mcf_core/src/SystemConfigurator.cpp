@@ -4,12 +4,103 @@
 #include "mcf_core/SystemConfigurator.h"
 
 #include "mcf_core/Mcf.h"
+#include "mcf_core/util/ConfigCache.h"
 #include "json/json.h"
 
+#include <cstdint>
 #include <fstream>
 
 namespace mcf
 {
+namespace
+{
+// accepts a CPU list string like "0-3,6" or an array of CPU indices
+CpuMask
+readCpuAffinity(const Json::Value& node)
+{
+    if (node.isNull())
+    {
+        return 0;
+    }
+    try
+    {
+        if (node.isString())
+        {
+            return parseCpuList(node.asString());
+        }
+        if (node.isArray())
+        {
+            CpuMask mask = 0;
+            for (const auto& cpu : node)
+            {
+                mask |= parseCpuList(std::to_string(cpu.asInt()));
+            }
+            return mask;
+        }
+    }
+    catch (const std::exception& error)
+    {
+        throw SystemConfigurationError(error.what());
+    }
+    throw SystemConfigurationError(
+        "Component CPU affinity must be a CPU list string or an array of CPU indices");
+}
+
+// a non-negative duration in microseconds, zero if absent
+std::chrono::nanoseconds
+readMicroseconds(const Json::Value& node, const std::string& name)
+{
+    const Json::Value& value = node.get(name, Json::Value());
+    if (value.isNull())
+    {
+        return std::chrono::nanoseconds(0);
+    }
+    if (!value.isNumeric() || value.asDouble() < 0.0)
+    {
+        throw SystemConfigurationError(
+            "Component scheduling parameter " + name + " must be a non-negative number");
+    }
+    return std::chrono::nanoseconds(static_cast<int64_t>(value.asDouble() * 1000.0));
+}
+
+// a non-negative size in KiB, returned in bytes, zero if absent
+size_t
+readKibibytes(const Json::Value& node, const std::string& name)
+{
+    const Json::Value& value = node.get(name, Json::Value());
+    if (value.isNull())
+    {
+        return 0;
+    }
+    if (!value.isIntegral() || value.asInt64() < 0)
+    {
+        throw SystemConfigurationError(
+            "Real-time memory parameter " + name + " must be a non-negative integer");
+    }
+    return static_cast<size_t>(value.asUInt64()) * 1024;
+}
+
+// the "ComponentSystemConfiguration" node of a configuration file
+Json::Value
+parseSystemConfiguration(std::istream& stream)
+{
+    auto reader               = Json::CharReaderBuilder();
+    reader["collectComments"] = false;
+
+    Json::Value root;
+    std::string errors;
+    bool success = Json::parseFromStream(reader, stream, &root, &errors);
+
+    if (success)
+    {
+        return root["ComponentSystemConfiguration"];
+    }
+    MCF_ERROR_NOFILELINE("System configuration JSON could not be parsed: {}", errors);
+    throw SystemConfigurationError("Could not parse system configuration JSON");
+}
+
+} // anonymous namespace
+
 system_configuration::ComponentSystem
 ComponentSystemConfigurator::readSystemConfiguration(const Json::Value& node)
 {
@@ -72,6 +163,10 @@ ComponentSystemConfigurator::readSystemConfiguration(const Json::Value& node)
             {
                 schedulingParameters.policy = IComponent::SchedulingPolicy::RoundRobin;
             }
+            else if (policy == "deadline")
+            {
+                schedulingParameters.policy = IComponent::SchedulingPolicy::Deadline;
+            }
             else if (policy == "default")
             {
                 schedulingParameters.policy = IComponent::SchedulingPolicy::Default;
@@ -79,7 +174,39 @@ ComponentSystemConfigurator::readSystemConfiguration(const Json::Value& node)
             else
             {
                 throw SystemConfigurationError("Component scheduling policy must be one of "
-                                               "'other', 'fifo', 'round-robin', 'default'");
+                                               "'other', 'fifo', 'round-robin', 'deadline', 'default'");
+            }
+
+            // deadline parameters in microseconds
+            schedulingParameters.runtime = readMicroseconds(parametersDeclaration, "runtimeUs");
+            schedulingParameters.deadline = readMicroseconds(parametersDeclaration, "deadlineUs");
+            schedulingParameters.period = readMicroseconds(parametersDeclaration, "periodUs");
+            // busy-polling before blocking, for components on dedicated CPUs
+            schedulingParameters.spin = readMicroseconds(parametersDeclaration, "spinUs");
+
+            schedulingParameters.cpuAffinity
+                = readCpuAffinity(parametersDeclaration.get("cpuAffinity", Json::Value()));
+
+            const Json::Value& parallelThreads = parametersDeclaration.get("parallelThreads", Json::Value());
+            if (!parallelThreads.isNull())
+            {
+                if (!parallelThreads.isIntegral() || parallelThreads.asInt64() < 1)
+                {
+                    throw SystemConfigurationError(
+                        "Component scheduling parameter parallelThreads must be a positive integer");
+                }
+                schedulingParameters.parallelThreads = parallelThreads.asUInt64();
+            }
+
+            const Json::Value& numaNode = parametersDeclaration.get("numaNode", Json::Value());
+            if (!numaNode.isNull())
+            {
+                if (!numaNode.isIntegral() || numaNode.asInt64() < 0)
+                {
+                    throw SystemConfigurationError(
+                        "Component scheduling parameter numaNode must be a non-negative integer");
+                }
+                schedulingParameters.numaNode = numaNode.asInt();
             }
         }
 
@@ -93,21 +220,278 @@ ComponentSystemConfigurator::readSystemConfiguration(const Json::Value& node)
 system_configuration::ComponentSystem
 ComponentSystemConfigurator::readSystemConfiguration(std::istream& stream)
 {
-    auto reader               = Json::CharReaderBuilder();
-    reader["collectComments"] = false;
+    return readSystemConfiguration(parseSystemConfiguration(stream));
+}
 
-    Json::Value root;
-    std::string errors;
-    bool success = Json::parseFromStream(reader, stream, &root, &errors);
+RealtimeMemoryOptions
+ComponentSystemConfigurator::readRealtimeMemoryConfiguration(const Json::Value& node)
+{
+    RealtimeMemoryOptions options;
+    const Json::Value& memory = node.get("RealtimeMemory", Json::Value());
+    if (memory.isNull())
+    {
+        return options;
+    }
+    if (!memory.isObject())
+    {
+        throw SystemConfigurationError("RealtimeMemory must be an object");
+    }
+    const Json::Value& lockMemory = memory.get("lockMemory", false);
+    if (!lockMemory.isBool())
+    {
+        throw SystemConfigurationError("Real-time memory parameter lockMemory must be a boolean");
+    }
+    options.lockMemory         = lockMemory.asBool();
+    options.stackPrefaultBytes = readKibibytes(memory, "stackPrefaultKiB");
+    options.heapPrefaultBytes  = readKibibytes(memory, "heapPrefaultKiB");
+    options.deferredFreeBytes  = readKibibytes(memory, "deferredFreeKiB");
+    return options;
+}
 
-    if (success)
+ParallelForConfig
+ComponentSystemConfigurator::readParallelForConfiguration(const Json::Value& node)
+{
+    ParallelForConfig config;
+    const Json::Value& parallelFor = node.get("ParallelFor", Json::Value());
+    if (parallelFor.isNull())
     {
-        system_configuration::ComponentSystem config;
-        Json::Value componentConfigs = root["ComponentSystemConfiguration"];
-        return readSystemConfiguration(componentConfigs);
+        return config;
     }
-    MCF_ERROR_NOFILELINE("System configuration JSON could not be parsed: {}", errors);
-    throw SystemConfigurationError("Could not parse system configuration JSON");
+    if (!parallelFor.isObject())
+    {
+        throw SystemConfigurationError("ParallelFor must be an object");
+    }
+    const Json::Value& numThreads = parallelFor.get("numThreads", 0);
+    if (!numThreads.isIntegral() || numThreads.asInt64() < 0)
+    {
+        throw SystemConfigurationError("Parallel for parameter numThreads must be a non-negative integer");
+    }
+    config.numThreads  = numThreads.asUInt64();
+    config.cpuAffinity = readCpuAffinity(parallelFor.get("cpuAffinity", Json::Value()));
+    return config;
+}
+
+LineageConfig
+ComponentSystemConfigurator::readLineageConfiguration(const Json::Value& node)
+{
+    LineageConfig config;
+    const Json::Value& lineage = node.get("Lineage", Json::Value());
+    if (lineage.isNull())
+    {
+        return config;
+    }
+    if (!lineage.isObject())
+    {
+        throw SystemConfigurationError("Lineage must be an object");
+    }
+    auto readTopics = [&lineage](const char* name, std::vector<std::string>& topics) {
+        const Json::Value& list = lineage.get(name, Json::Value());
+        if (list.isNull())
+        {
+            return;
+        }
+        if (!list.isArray())
+        {
+            throw SystemConfigurationError(fmt::format("Lineage parameter {} must be an array of topics", name));
+        }
+        topics.clear();
+        for (const auto& topic : list)
+        {
+            if (!topic.isString())
+            {
+                throw SystemConfigurationError(fmt::format("Lineage parameter {} must be an array of topics", name));
+            }
+            topics.push_back(topic.asString());
+        }
+    };
+    readTopics("sources", config.sources);
+    readTopics("sinks", config.sinks);
+    const Json::Value& tableSize = lineage.get("tableSize", Json::Value::UInt64(config.tableSize));
+    if (!tableSize.isIntegral() || tableSize.asInt64() <= 0)
+    {
+        throw SystemConfigurationError("Lineage parameter tableSize must be a positive integer");
+    }
+    config.tableSize = tableSize.asUInt64();
+    const Json::Value& interval = lineage.get("publishIntervalMs", Json::Value::Int64(config.publishInterval.count()));
+    if (!interval.isIntegral() || interval.asInt64() <= 0)
+    {
+        throw SystemConfigurationError("Lineage parameter publishIntervalMs must be a positive integer");
+    }
+    config.publishInterval = std::chrono::milliseconds(interval.asInt64());
+    return config;
+}
+
+std::string
+ComponentSystemConfigurator::readConfigCacheConfiguration(const Json::Value& node)
+{
+    const Json::Value& cacheFile = node.get("ConfigCache", "");
+    if (!cacheFile.isString())
+    {
+        throw SystemConfigurationError("ConfigCache must be the name of the cache file");
+    }
+    return cacheFile.asString();
+}
+
+ValueSnapshotConfig
+ComponentSystemConfigurator::readValueSnapshotConfiguration(const Json::Value& node)
+{
+    ValueSnapshotConfig config;
+    const Json::Value& snapshot = node.get("ValueSnapshot", Json::Value());
+    if (snapshot.isNull())
+    {
+        return config;
+    }
+    if (!snapshot.isObject())
+    {
+        throw SystemConfigurationError("ValueSnapshot must be an object");
+    }
+    const Json::Value& file = snapshot.get("file", Json::Value());
+    if (!file.isString() || file.asString().empty())
+    {
+        throw SystemConfigurationError("ValueSnapshot parameter file must be the name of the snapshot file");
+    }
+    config.file = file.asString();
+    const Json::Value& topics = snapshot.get("topics", Json::Value());
+    if (!topics.isArray() || topics.empty())
+    {
+        throw SystemConfigurationError("ValueSnapshot parameter topics must be a non-empty array of topics");
+    }
+    for (const auto& topic : topics)
+    {
+        if (!topic.isString())
+        {
+            throw SystemConfigurationError("ValueSnapshot parameter topics must be a non-empty array of topics");
+        }
+        config.topics.push_back(topic.asString());
+    }
+    auto readDuration = [&snapshot](const char* name) {
+        const Json::Value& duration = snapshot.get(name, Json::Value::Int64(0));
+        if (!duration.isIntegral() || duration.asInt64() < 0)
+        {
+            throw SystemConfigurationError(fmt::format("ValueSnapshot parameter {} must be a non-negative integer", name));
+        }
+        return std::chrono::milliseconds(duration.asInt64());
+    };
+    config.interval = readDuration("intervalMs");
+    config.maxAge = readDuration("maxAgeMs");
+    return config;
+}
+
+PreviewConfig
+ComponentSystemConfigurator::readPreviewConfiguration(const Json::Value& node)
+{
+    PreviewConfig config;
+    const Json::Value& previews = node.get("Previews", Json::Value());
+    if (previews.isNull())
+    {
+        return config;
+    }
+    if (!previews.isObject())
+    {
+        throw SystemConfigurationError("Previews must be an object");
+    }
+    const Json::Value& topics = previews.get("topics", Json::Value());
+    if (!topics.isArray() || topics.empty())
+    {
+        throw SystemConfigurationError("Previews parameter topics must be a non-empty array of topics");
+    }
+    for (const auto& topic : topics)
+    {
+        if (!topic.isString())
+        {
+            throw SystemConfigurationError("Previews parameter topics must be a non-empty array of topics");
+        }
+        config.topics.push_back(topic.asString());
+    }
+    auto readInteger = [&previews](const char* name, int64_t defaultValue, int64_t min, int64_t max) {
+        const Json::Value& value = previews.get(name, Json::Value::Int64(defaultValue));
+        if (!value.isIntegral() || value.asInt64() < min || value.asInt64() > max)
+        {
+            throw SystemConfigurationError(fmt::format("Previews parameter {} must be an integer from {} to {}", name, min, max));
+        }
+        return value.asInt64();
+    };
+    config.interval = std::chrono::milliseconds(readInteger("intervalMs", config.interval.count(), 1, INT32_MAX));
+    config.maxWidth = static_cast<uint32_t>(readInteger("maxWidth", config.maxWidth, 0, UINT16_MAX));
+    config.maxHeight = static_cast<uint32_t>(readInteger("maxHeight", config.maxHeight, 0, UINT16_MAX));
+    config.jpegQuality = static_cast<int>(readInteger("jpegQuality", config.jpegQuality, 0, 100));
+    return config;
+}
+
+TopicQosConfig
+ComponentSystemConfigurator::readQosConfiguration(const Json::Value& node)
+{
+    TopicQosConfig config;
+    const Json::Value& qos = node.get("Qos", Json::Value());
+    if (qos.isNull())
+    {
+        return config;
+    }
+    if (!qos.isObject())
+    {
+        throw SystemConfigurationError("Qos must be an object");
+    }
+    const Json::Value& profiles = qos.get("profiles", Json::Value(Json::objectValue));
+    if (!profiles.isObject())
+    {
+        throw SystemConfigurationError("Qos parameter profiles must be an object of named profiles");
+    }
+    for (const auto& name : profiles.getMemberNames())
+    {
+        const Json::Value& entry = profiles[name];
+        if (!entry.isObject())
+        {
+            throw SystemConfigurationError(fmt::format("QoS profile {} must be an object", name));
+        }
+        QosProfile profile;
+        auto readInteger = [&entry, &name](const char* parameter, int64_t defaultValue, int64_t maxValue) {
+            const Json::Value& value = entry.get(parameter, Json::Value::Int64(defaultValue));
+            if (!value.isIntegral() || value.asInt64() < 0 || value.asInt64() > maxValue)
+            {
+                throw SystemConfigurationError(fmt::format(
+                    "QoS profile {} parameter {} must be an integer between 0 and {}", name, parameter, maxValue));
+            }
+            return value.asInt64();
+        };
+        profile.depth = static_cast<size_t>(readInteger("depth", profile.depth, INT32_MAX));
+        profile.deadline = std::chrono::milliseconds(readInteger("deadlineMs", 0, INT32_MAX));
+        profile.lifespan = std::chrono::milliseconds(readInteger("lifespanMs", 0, INT32_MAX));
+        profile.priority = static_cast<uint8_t>(readInteger("priority", profile.priority, UINT8_MAX));
+        const std::string reliability = entry.get("reliability", "best_effort").asString();
+        if (reliability == "reliable")
+        {
+            profile.reliability = QosProfile::Reliability::RELIABLE;
+        }
+        else if (reliability == "best_effort")
+        {
+            profile.reliability = QosProfile::Reliability::BEST_EFFORT;
+        }
+        else
+        {
+            throw SystemConfigurationError(fmt::format(
+                "QoS profile {} parameter reliability must be one of 'reliable', 'best_effort'", name));
+        }
+        config.profiles.emplace(name, profile);
+    }
+    const Json::Value& topics = qos.get("topics", Json::Value(Json::arrayValue));
+    if (!topics.isArray())
+    {
+        throw SystemConfigurationError("Qos parameter topics must be an array of pattern and profile");
+    }
+    for (const auto& topic : topics)
+    {
+        if (!topic.isObject() || !topic["pattern"].isString() || !topic["profile"].isString())
+        {
+            throw SystemConfigurationError("Qos parameter topics must be an array of pattern and profile");
+        }
+        const std::string profile = topic["profile"].asString();
+        if (config.profiles.find(profile) == config.profiles.end())
+        {
+            throw SystemConfigurationError(fmt::format("Unknown QoS profile {}", profile));
+        }
+        config.assignments.push_back({topic["pattern"].asString(), profile});
+    }
+    return config;
 }
 
 void
@@ -232,20 +616,62 @@ void
 ComponentSystemConfigurator::configureFromFile(const std::string& fileName)
 {
     auto istream = std::ifstream(fileName, std::ios::in);
-    configure(readSystemConfiguration(istream));
+    configureFromJSONNode(parseSystemConfiguration(istream));
 }
 
 void
 ComponentSystemConfigurator::configureFromJSON(const std::string& jsonString)
 {
     auto istream = std::istringstream(jsonString);
-    configure(readSystemConfiguration(istream));
+    configureFromJSONNode(parseSystemConfiguration(istream));
 }
 
 void
 ComponentSystemConfigurator::configureFromJSONNode(const Json::Value& node)
 {
-    configure(readSystemConfiguration(node));
+    auto configuration = readSystemConfiguration(node);
+    if (node.isMember("RealtimeMemory"))
+    {
+        _manager.setRealtimeMemory(readRealtimeMemoryConfiguration(node));
+    }
+    if (node.isMember("ParallelFor"))
+    {
+        configureParallelFor(readParallelForConfiguration(node));
+    }
+    if (node.isMember("Lineage"))
+    {
+        _manager.enableLineageTracking(readLineageConfiguration(node));
+    }
+    if (node.isMember("ConfigCache"))
+    {
+        util::json::ConfigCache::instance().open(readConfigCacheConfiguration(node));
+    }
+    if (node.isMember("ValueSnapshot"))
+    {
+        _manager.enableValueSnapshot(readValueSnapshotConfiguration(node));
+    }
+    if (node.isMember("Previews"))
+    {
+        _manager.enablePreviews(readPreviewConfiguration(node));
+    }
+    if (node.isMember("Qos"))
+    {
+        _manager.setTopicQos(readQosConfiguration(node));
+    }
+    const std::string placement = node.get("NumaPlacement", "producer").asString();
+    if (placement == "consumer")
+    {
+        _manager.setNumaPlacement(NumaPlacement::CONSUMER);
+    }
+    else if (placement == "producer")
+    {
+        _manager.setNumaPlacement(NumaPlacement::PRODUCER);
+    }
+    else
+    {
+        throw SystemConfigurationError("NumaPlacement must be one of 'producer', 'consumer'");
+    }
+    configure(configuration);
 }
 
 } // namespace mcf
\ No newline at end of file
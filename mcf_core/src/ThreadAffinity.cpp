@@ -0,0 +1,138 @@
+/**
+ * Helpers for pinning threads to CPUs via pthread_setaffinity_np.
+ *
+ * Copyright (c) 2024 Accenture
+ *
+ */
+
+#include "mcf_core/ThreadAffinity.h"
+
+#include "spdlog/fmt/fmt.h"
+
+#include <sched.h>
+#include <stdexcept>
+
+namespace mcf
+{
+namespace
+{
+constexpr int MAX_CPUS = 64;
+
+int
+parseCpu(const std::string& list, const std::string& token)
+{
+    size_t length = 0;
+    int cpu       = -1;
+    try
+    {
+        cpu = std::stoi(token, &length);
+    }
+    catch (const std::exception&)
+    {
+        length = 0;
+    }
+    if (token.empty() || length != token.size() || cpu < 0 || cpu >= MAX_CPUS)
+    {
+        throw std::invalid_argument(fmt::format("Invalid CPU '{}' in CPU list '{}'", token, list));
+    }
+    return cpu;
+}
+
+} // anonymous namespace
+
+int
+setThreadCpuAffinity(pthread_t thread, CpuMask mask)
+{
+    if (mask == 0)
+    {
+        return 0;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu = 0; cpu < MAX_CPUS; ++cpu)
+    {
+        if ((mask >> cpu) & 1u)
+        {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+    return pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+}
+
+CpuMask
+getThreadCpuAffinity(pthread_t thread)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (pthread_getaffinity_np(thread, sizeof(cpus), &cpus) != 0)
+    {
+        return 0;
+    }
+    CpuMask mask = 0;
+    for (int cpu = 0; cpu < MAX_CPUS; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &cpus))
+        {
+            mask |= CpuMask(1) << cpu;
+        }
+    }
+    return mask;
+}
+
+std::string
+formatCpuMask(CpuMask mask)
+{
+    std::string result;
+    int cpu = 0;
+    while (cpu < MAX_CPUS)
+    {
+        if (!((mask >> cpu) & 1u))
+        {
+            ++cpu;
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < MAX_CPUS && ((mask >> (last + 1)) & 1u))
+        {
+            ++last;
+        }
+        if (!result.empty())
+        {
+            result += ",";
+        }
+        result += last == cpu ? std::to_string(cpu) : fmt::format("{}-{}", cpu, last);
+        cpu = last + 1;
+    }
+    return result;
+}
+
+CpuMask
+parseCpuList(const std::string& list)
+{
+    CpuMask mask = 0;
+    size_t begin = 0;
+    while (begin <= list.size())
+    {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos)
+        {
+            end = list.size();
+        }
+        const std::string range = list.substr(begin, end - begin);
+        const size_t dash       = range.find('-');
+        const int first         = parseCpu(list, range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : parseCpu(list, range.substr(dash + 1));
+        if (last < first)
+        {
+            throw std::invalid_argument(fmt::format("Invalid CPU range '{}' in CPU list '{}'", range, list));
+        }
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+            mask |= CpuMask(1) << cpu;
+        }
+        begin = end + 1;
+    }
+    return mask;
+}
+
+} // namespace mcf
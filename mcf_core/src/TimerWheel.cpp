@@ -0,0 +1,216 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/TimerWheel.h"
+
+#include "mcf_core/ThreadName.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace mcf {
+
+namespace {
+
+constexpr size_t SLOT_BITS = 6;
+static_assert(TimerWheel::SLOTS == size_t(1) << SLOT_BITS, "TimerWheel: SLOTS must match SLOT_BITS");
+
+/**
+ * The ticks covered by a slot of level
+ */
+constexpr uint64_t levelTicks(size_t level) {
+    return uint64_t(1) << (SLOT_BITS * level);
+}
+
+} // anonymous namespace
+
+constexpr std::chrono::milliseconds TimerWheel::DEFAULT_TICK;
+constexpr size_t TimerWheel::LEVELS;
+constexpr size_t TimerWheel::SLOTS;
+constexpr TimerWheel::TimerId TimerWheel::INVALID_TIMER;
+
+TimerWheel& TimerWheel::instance() {
+    // never destroyed, timers may still be cancelled during static destruction
+    static TimerWheel* wheel = new TimerWheel();
+    return *wheel;
+}
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick)
+: fTick(std::max(tick, std::chrono::milliseconds(1))), fStart(Clock::now()) {}
+
+TimerWheel::~TimerWheel() {
+    {
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+        fStopRequest = true;
+    }
+    fCv.notify_all();
+    if (fThread.joinable()) {
+        fThread.join();
+    }
+}
+
+TimerWheel::TimerId TimerWheel::schedule(Clock::time_point deadline, std::function<void()> callback) {
+    std::unique_lock<mutex::PriorityInheritanceMutex> lk(fMutex);
+    if (!fThread.joinable()) {
+        fThread = std::thread([this] { run(); });
+    }
+    const bool fromCallback = fRunning != INVALID_TIMER && std::this_thread::get_id() == fThread.get_id();
+    if (fTimers.empty() && fRunning == INVALID_TIMER) {
+        // the thread did not advance while it had nothing to do
+        const auto elapsed = Clock::now() - fStart;
+        fCurrentTick = std::max<uint64_t>(fCurrentTick, elapsed / fTick);
+    }
+    const TimerId id = fNextId++;
+    Timer& timer = fTimers[id];
+    // a timer scheduled by a callback fires with the next tick at the earliest, not in the current one
+    timer.expiry = std::max(tickOf(deadline), fCurrentTick + (fromCallback ? 1 : 0));
+    timer.callback = std::move(callback);
+    insert(id, timer);
+    ++fStatistics.scheduled;
+    lk.unlock();
+    if (!fromCallback) {
+        // the thread recomputes its wakeup after the callbacks anyway
+        fCv.notify_one();
+    }
+    return id;
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    if (id == INVALID_TIMER) {
+        return false;
+    }
+    std::unique_lock<mutex::PriorityInheritanceMutex> lk(fMutex);
+    auto it = fTimers.find(id);
+    if (it != fTimers.end()) {
+        fWheel[it->second.level][it->second.slot].erase(it->second.position);
+        fTimers.erase(it);
+        ++fStatistics.cancelled;
+        return true;
+    }
+    // a callback cancelling its own timer must not wait for itself
+    if (std::this_thread::get_id() != fThread.get_id()) {
+        fCallbackDoneCv.wait(lk, [this, id] { return fRunning != id; });
+    }
+    return false;
+}
+
+TimerWheel::Statistics TimerWheel::statistics() const {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    Statistics statistics = fStatistics;
+    statistics.pending = fTimers.size();
+    return statistics;
+}
+
+void TimerWheel::insert(TimerId id, Timer& timer) {
+    const uint64_t delta = timer.expiry - fCurrentTick;
+    size_t level = 0;
+    while (level + 1 < LEVELS && delta >= levelTicks(level + 1)) {
+        ++level;
+    }
+    uint64_t tick = timer.expiry;
+    if (delta >= levelTicks(LEVELS)) {
+        // beyond the range of the wheel: the last slot, cascaded again from there
+        tick = fCurrentTick + levelTicks(LEVELS) - 1;
+    }
+    timer.level = level;
+    timer.slot = (tick >> (SLOT_BITS * level)) % SLOTS;
+    Slot& slot = fWheel[level][timer.slot];
+    timer.position = slot.insert(slot.end(), id);
+}
+
+void TimerWheel::cascade(size_t level) {
+    Slot slot;
+    slot.swap(fWheel[level][(fCurrentTick >> (SLOT_BITS * level)) % SLOTS]);
+    for (TimerId id : slot) {
+        insert(id, fTimers.at(id));
+    }
+}
+
+uint64_t TimerWheel::nextWakeupTick() const {
+    if (fTimers.empty()) {
+        return UINT64_MAX;
+    }
+    auto cascadeDue = [this](uint64_t tick) {
+        for (size_t level = 1; level < LEVELS && tick % levelTicks(level) == 0; ++level) {
+            if (!fWheel[level][(tick >> (SLOT_BITS * level)) % SLOTS].empty()) {
+                return true;
+            }
+        }
+        return false;
+    };
+    // level 0 only holds the timers of the next SLOTS ticks
+    for (uint64_t tick = fCurrentTick; tick < fCurrentTick + SLOTS; ++tick) {
+        if (!fWheel[0][tick % SLOTS].empty() || cascadeDue(tick)) {
+            return tick;
+        }
+    }
+    // after that, only cascades bring timers closer
+    uint64_t tick = (fCurrentTick + SLOTS - 1) / SLOTS * SLOTS + SLOTS;
+    for (size_t i = 0; i < SLOTS; ++i, tick += SLOTS) {
+        if (cascadeDue(tick)) {
+            return tick;
+        }
+    }
+    return tick;
+}
+
+uint64_t TimerWheel::tickOf(Clock::time_point time) const {
+    if (time <= fStart) {
+        return 0;
+    }
+    const Clock::duration tick = fTick;
+    // rounded up, a timer never fires before its deadline
+    return static_cast<uint64_t>((time - fStart + tick - Clock::duration(1)) / tick);
+}
+
+void TimerWheel::run() {
+    setThreadName("TimerWheel");
+    std::unique_lock<mutex::PriorityInheritanceMutex> lk(fMutex);
+    while (!fStopRequest) {
+        const uint64_t wakeup = nextWakeupTick();
+        if (wakeup == UINT64_MAX) {
+            fCv.wait(lk);
+            continue;
+        }
+        const Clock::time_point wakeupTime = fStart + Clock::duration(fTick) * static_cast<Clock::rep>(wakeup);
+        if (Clock::now() < wakeupTime) {
+            // woken up early if an earlier timer is scheduled
+            fCv.wait_until(lk, wakeupTime);
+            continue;
+        }
+
+        const uint64_t nowTick = static_cast<uint64_t>((Clock::now() - fStart) / fTick);
+        bool fired = false;
+        while (fCurrentTick <= nowTick && !fStopRequest) {
+            for (size_t level = LEVELS - 1; level > 0; --level) {
+                if (fCurrentTick % levelTicks(level) == 0) {
+                    cascade(level);
+                }
+            }
+            Slot& slot = fWheel[0][fCurrentTick % SLOTS];
+            while (!slot.empty() && !fStopRequest) {
+                const TimerId id = slot.front();
+                slot.pop_front();
+                auto it = fTimers.find(id);
+                std::function<void()> callback = std::move(it->second.callback);
+                fTimers.erase(it);
+                fRunning = id;
+                ++fStatistics.fired;
+                fired = true;
+                lk.unlock();
+                callback();
+                // destroyed before the cancelling thread continues, it may hold references
+                callback = nullptr;
+                lk.lock();
+                fRunning = INVALID_TIMER;
+                fCallbackDoneCv.notify_all();
+            }
+            ++fCurrentTick;
+        }
+        if (fired) {
+            ++fStatistics.wakeups;
+        }
+    }
+}
+
+} // namespace mcf
@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/TopicQos.h"
+
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/ValueStore.h"
+
+#include "spdlog/fmt/fmt.h"
+
+#include <mutex>
+#include <shared_mutex>
+
+namespace mcf {
+
+void TopicQos::configure(const TopicQosConfig& config) {
+    std::map<std::string, std::shared_ptr<const QosProfile>> profiles;
+    for (const auto& profile : config.profiles) {
+        profiles.emplace(profile.first, std::make_shared<const QosProfile>(profile.second));
+    }
+    std::vector<std::pair<std::string, std::shared_ptr<const QosProfile>>> assignments;
+    for (const auto& assignment : config.assignments) {
+        auto it = profiles.find(assignment.profile);
+        MCF_ASSERT(it != profiles.end(),
+                   fmt::format("Unknown QoS profile '{}' for topics '{}'", assignment.profile, assignment.pattern));
+        assignments.emplace_back(assignment.pattern, it->second);
+    }
+
+    std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+    fAssignments.swap(assignments);
+    fTopics.clear();
+}
+
+std::shared_ptr<const QosProfile> TopicQos::find(const std::string& topic) const {
+    {
+        std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+        auto it = fTopics.find(topic);
+        if (it != fTopics.end()) {
+            return it->second;
+        }
+    }
+    std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+    std::shared_ptr<const QosProfile> profile;
+    for (const auto& assignment : fAssignments) {
+        if (ValueStore::matchesPattern(assignment.first, topic)) {
+            profile = assignment.second;
+            break;
+        }
+    }
+    fTopics.emplace(topic, profile);
+    return profile;
+}
+
+bool TopicQos::empty() const {
+    std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+    return fAssignments.empty();
+}
+
+} // namespace mcf
@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/TraceBuffer.h"
+
+#include <algorithm>
+
+namespace mcf {
+
+namespace {
+
+size_t roundUpToPowerOfTwo(size_t value)
+{
+    size_t power = 1;
+    while (power < value)
+    {
+        power *= 2;
+    }
+    return power;
+}
+
+// ids the calling thread has interned already
+thread_local std::unordered_map<std::string, uint32_t> tInternedIds;
+
+} // anonymous namespace
+
+TraceStringTable& TraceStringTable::instance()
+{
+    // intentionally leaked: threads may still trace during static destruction
+    static TraceStringTable* table = new TraceStringTable();
+    return *table;
+}
+
+uint32_t TraceStringTable::intern(const std::string& string)
+{
+    if (string.empty())
+    {
+        return 0;
+    }
+    auto cached = tInternedIds.find(string);
+    if (cached != tInternedIds.end())
+    {
+        return cached->second;
+    }
+
+    uint32_t id = 0;
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        auto it = fIds.find(string);
+        if (it == fIds.end())
+        {
+            id = static_cast<uint32_t>(fStrings.size());
+            fStrings.push_back(string);
+            fIds.emplace(string, id);
+        }
+        else
+        {
+            id = it->second;
+        }
+    }
+    tInternedIds.emplace(string, id);
+    return id;
+}
+
+std::string TraceStringTable::lookup(uint32_t id) const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return id < fStrings.size() ? fStrings[id] : std::string();
+}
+
+uint32_t TraceStringTable::size() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return static_cast<uint32_t>(fStrings.size());
+}
+
+TraceBuffer::TraceBuffer(size_t capacity)
+: fRecords(new TraceRecord[roundUpToPowerOfTwo(std::max<size_t>(capacity, 2))])
+, fMask(roundUpToPowerOfTwo(std::max<size_t>(capacity, 2)) - 1)
+{
+}
+
+bool TraceBuffer::push(const TraceRecord* records, size_t count)
+{
+    const size_t head = fHead.load(std::memory_order_relaxed);
+    const size_t tail = fTail.load(std::memory_order_acquire);
+    if (head - tail + count > capacity())
+    {
+        fDropped.fetch_add(count, std::memory_order_relaxed);
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        fRecords[(head + i) & fMask] = records[i];
+    }
+    fHead.store(head + count, std::memory_order_release);
+    return true;
+}
+
+size_t TraceBuffer::pop(TraceRecord* out, size_t maxCount)
+{
+    const size_t tail = fTail.load(std::memory_order_relaxed);
+    const size_t head = fHead.load(std::memory_order_acquire);
+    const size_t count = std::min(head - tail, maxCount);
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fRecords[(tail + i) & fMask];
+    }
+    fTail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+size_t TraceBuffer::size() const
+{
+    return fHead.load(std::memory_order_acquire) - fTail.load(std::memory_order_acquire);
+}
+
+} // namespace mcf
@@ -0,0 +1,189 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/TraceClock.h"
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define MCF_TRACE_TSC 1
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+// the thread id of the calling thread, 0 until first used
+thread_local int32_t tThreadId = 0;
+
+std::atomic<TraceClock::Source> gSource{TraceClock::Source::SYSTEM};
+
+// the calibration used by toMicroseconds(), and the reference it was derived from
+std::mutex gCalibrationMutex;
+TraceClock::Calibration gCalibration;
+TraceClock::Calibration gReference;
+
+// time the frequency of the TSC is measured by setSource()
+constexpr std::chrono::milliseconds CALIBRATION_TIME{10};
+
+uint64_t systemMicroseconds()
+{
+    // the clock of the time points passed to ComponentTraceEventGenerator
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+int32_t currentCpu()
+{
+    const int cpu = sched_getcpu();
+    return cpu >= 0 ? cpu : 0;
+}
+
+#ifdef MCF_TRACE_TSC
+// the TSC with the system time read in between
+TraceClock::Calibration sampleClocks()
+{
+    TraceClock::Calibration sample;
+    const uint64_t before = __rdtsc();
+    sample.microseconds = systemMicroseconds();
+    const uint64_t after = __rdtsc();
+    sample.ticks = before + (after - before) / 2;
+    return sample;
+}
+#endif
+
+} // anonymous namespace
+
+bool TraceClock::setSource(Source source)
+{
+    if (source == Source::TSC)
+    {
+#ifdef MCF_TRACE_TSC
+        if (!tscAvailable())
+        {
+            return false;
+        }
+        const Calibration start = sampleClocks();
+        std::this_thread::sleep_for(CALIBRATION_TIME);
+        Calibration end = sampleClocks();
+        end.ticksPerMicrosecond = double(end.ticks - start.ticks) / double(end.microseconds - start.microseconds);
+        {
+            std::lock_guard<std::mutex> lk(gCalibrationMutex);
+            gReference = end;
+            gCalibration = end;
+        }
+#else
+        return false;
+#endif
+    }
+    gSource = source;
+    return true;
+}
+
+TraceClock::Source TraceClock::source()
+{
+    return gSource;
+}
+
+bool TraceClock::tscAvailable()
+{
+#ifdef MCF_TRACE_TSC
+    unsigned int eax = 0;
+    unsigned int ebx = 0;
+    unsigned int ecx = 0;
+    unsigned int edx = 0;
+    // invariant TSC (advanced power management leaf), rdtscp (extended features leaf)
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0 || (edx & (1u << 8)) == 0)
+    {
+        return false;
+    }
+    return __get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) != 0 && (edx & (1u << 27)) != 0;
+#else
+    return false;
+#endif
+}
+
+void TraceClock::stamp(TraceRecord& record)
+{
+    record.threadId = threadId();
+#ifdef MCF_TRACE_TSC
+    if (gSource.load(std::memory_order_relaxed) == Source::TSC)
+    {
+        unsigned int aux = 0;
+        record.time = __rdtscp(&aux);
+        record.tscTime = 1;
+        // Linux sets TSC_AUX to the node and the CPU, the latter in the lower 12 bits
+        record.cpuId = static_cast<int32_t>(aux & 0xfff);
+        return;
+    }
+#endif
+    record.time = systemMicroseconds();
+    record.tscTime = 0;
+    record.cpuId = currentCpu();
+}
+
+void TraceClock::stampThread(TraceRecord& record)
+{
+    record.threadId = threadId();
+    record.cpuId = currentCpu();
+}
+
+int32_t TraceClock::threadId()
+{
+    if (tThreadId == 0)
+    {
+        tThreadId = static_cast<int32_t>(syscall(SYS_gettid));
+    }
+    return tThreadId;
+}
+
+uint64_t TraceClock::toMicroseconds(uint64_t ticks)
+{
+    return toMicroseconds(ticks, calibration());
+}
+
+uint64_t TraceClock::toMicroseconds(uint64_t ticks, const Calibration& calibration)
+{
+    if (calibration.ticksPerMicrosecond <= 0.)
+    {
+        return 0;
+    }
+    const double offset = (double(ticks) - double(calibration.ticks)) / calibration.ticksPerMicrosecond;
+    return static_cast<uint64_t>(double(calibration.microseconds) + offset + 0.5);
+}
+
+void TraceClock::recalibrate()
+{
+#ifdef MCF_TRACE_TSC
+    if (gSource != Source::TSC)
+    {
+        return;
+    }
+    Calibration now = sampleClocks();
+    std::lock_guard<std::mutex> lk(gCalibrationMutex);
+    // the longer the time since the reference, the smaller the error of the samples
+    if (now.microseconds > gReference.microseconds && now.ticks > gReference.ticks)
+    {
+        now.ticksPerMicrosecond = double(now.ticks - gReference.ticks)
+                                  / double(now.microseconds - gReference.microseconds);
+        gCalibration = now;
+    }
+#endif
+}
+
+TraceClock::Calibration TraceClock::calibration()
+{
+    std::lock_guard<std::mutex> lk(gCalibrationMutex);
+    return gCalibration;
+}
+
+} // namespace mcf
@@ -0,0 +1,198 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/TraceCollector.h"
+#include "mcf_core/TraceClock.h"
+#include "mcf_core/ThreadName.h"
+
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+// records moved from a buffer at once
+constexpr size_t BATCH_SIZE = 256;
+
+// marks the buffer of a thread as abandoned when the thread exits
+struct LocalBuffer {
+    std::shared_ptr<TraceBuffer> buffer;
+
+    ~LocalBuffer()
+    {
+        if (buffer)
+        {
+            buffer->close();
+        }
+    }
+};
+
+thread_local LocalBuffer tLocalBuffer;
+
+} // anonymous namespace
+
+TraceCollector& TraceCollector::instance()
+{
+    // intentionally leaked: the collector thread is never joined, threads may still trace
+    // during static destruction
+    static TraceCollector* collector = new TraceCollector();
+    return *collector;
+}
+
+TraceCollector::TraceCollector()
+: fBatch(BATCH_SIZE)
+{
+    std::thread([this] {
+        setThreadName("mcf_trace");
+        run();
+    }).detach();
+}
+
+uint32_t TraceCollector::addSink(ITraceSink& sink)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    const uint32_t id = fNextSinkId++;
+    fSinks[id] = &sink;
+    return id;
+}
+
+void TraceCollector::removeSink(uint32_t id)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    drain();
+    fSinks.erase(id);
+}
+
+bool TraceCollector::write(const TraceRecord* records, size_t count)
+{
+    TraceBuffer& buffer = localBuffer();
+    if (!buffer.push(records, count))
+    {
+        return false;
+    }
+    // wake the collector once, when the buffer gets half full
+    const size_t size = buffer.size();
+    const size_t half = buffer.capacity() / 2;
+    if (size >= half && size - count < half)
+    {
+        fWake.notify_one();
+    }
+    return true;
+}
+
+void TraceCollector::flush()
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    drain();
+}
+
+void TraceCollector::configure(std::chrono::milliseconds drainInterval, size_t bufferCapacity)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    fDrainInterval = drainInterval;
+    fBufferCapacity = bufferCapacity;
+    fWake.notify_one();
+}
+
+TraceCollector::Statistics TraceCollector::statistics() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    Statistics statistics;
+    statistics.records = fRecords;
+    statistics.dropped = fReleasedDropped;
+    for (const auto& buffer : fBuffers)
+    {
+        statistics.dropped += buffer->dropped();
+    }
+    statistics.buffers = fBuffers.size();
+    std::lock_guard<std::mutex> newLk(fNewBuffersMutex);
+    for (const auto& buffer : fNewBuffers)
+    {
+        statistics.dropped += buffer->dropped();
+    }
+    statistics.buffers += fNewBuffers.size();
+    return statistics;
+}
+
+TraceBuffer& TraceCollector::localBuffer()
+{
+    if (!tLocalBuffer.buffer)
+    {
+        auto buffer = std::make_shared<TraceBuffer>(fBufferCapacity);
+        {
+            std::lock_guard<std::mutex> lk(fNewBuffersMutex);
+            fNewBuffers.push_back(buffer);
+        }
+        tLocalBuffer.buffer = std::move(buffer);
+        fWake.notify_one();
+    }
+    return *tLocalBuffer.buffer;
+}
+
+void TraceCollector::drain()
+{
+    {
+        std::lock_guard<std::mutex> lk(fNewBuffersMutex);
+        fBuffers.insert(fBuffers.end(), fNewBuffers.begin(), fNewBuffers.end());
+        fNewBuffers.clear();
+    }
+    TraceClock::recalibrate();
+    const TraceClock::Calibration calibration = TraceClock::calibration();
+    for (auto it = fBuffers.begin(); it != fBuffers.end();)
+    {
+        TraceBuffer& buffer = **it;
+        // checked first: a closed buffer receives no further records
+        const bool closed = buffer.isClosed();
+        size_t count = 0;
+        while ((count = buffer.pop(fBatch.data(), fBatch.size())) > 0)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                TraceRecord& record = fBatch[i];
+                if (record.tscTime != 0)
+                {
+                    record.time = TraceClock::toMicroseconds(record.time, calibration);
+                    record.tscTime = 0;
+                }
+            }
+            // pass on runs of records with the same sink
+            for (size_t begin = 0; begin < count;)
+            {
+                size_t end = begin + 1;
+                while (end < count && fBatch[end].sink == fBatch[begin].sink)
+                {
+                    ++end;
+                }
+                auto sink = fSinks.find(fBatch[begin].sink);
+                if (sink != fSinks.end())
+                {
+                    sink->second->consume(&fBatch[begin], end - begin);
+                    fRecords += end - begin;
+                }
+                begin = end;
+            }
+        }
+        if (closed)
+        {
+            fReleasedDropped += buffer.dropped();
+            it = fBuffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void TraceCollector::run()
+{
+    std::unique_lock<std::mutex> lk(fMutex);
+    while (true)
+    {
+        // the wake up on the first buffer may be missed, it is notified without fMutex
+        fWake.wait_for(lk, fBuffers.empty() ? std::chrono::milliseconds(100) : fDrainInterval);
+        drain();
+    }
+}
+
+} // namespace mcf
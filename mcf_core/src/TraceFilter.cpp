@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/TraceFilter.h"
+#include "mcf_core/ErrorMacros.h"
+
+#include <fnmatch.h>
+
+namespace mcf {
+
+constexpr uint32_t TraceFilterRule::ALL_EVENT_TYPES;
+constexpr size_t TraceSelection::MAX_RULES;
+
+namespace {
+
+struct EventTypeName {
+    TraceEventType type;
+    const char* name;
+};
+
+// the event types a filter selects, INPUT_IDS records follow their event
+const EventTypeName EVENT_TYPE_NAMES[] = {
+    {TraceEventType::PORT_WRITE, "port_write"},
+    {TraceEventType::PORT_PEEK, "port_peek"},
+    {TraceEventType::PORT_READ, "port_read"},
+    {TraceEventType::EXEC_TIME, "exec_time"},
+    {TraceEventType::REMOTE_TRANSFER_TIME, "remote_transfer_time"},
+    {TraceEventType::TRIGGER_ACTIVATION, "trigger_activation"},
+    {TraceEventType::TRIGGER_EXEC, "trigger_exec"},
+    {TraceEventType::PROGRAM_FLOW, "program_flow"},
+    {TraceEventType::PERF_COUNTERS, "perf_counters"},
+};
+
+bool globMatch(const std::string& pattern, const std::string& string)
+{
+    return pattern == "*" || fnmatch(pattern.c_str(), string.c_str(), 0) == 0;
+}
+
+} // anonymous namespace
+
+uint32_t traceEventTypeMask(const std::vector<std::string>& names)
+{
+    uint32_t mask = 0;
+    for (const auto& name : names)
+    {
+        bool found = false;
+        for (const auto& typeName : EVENT_TYPE_NAMES)
+        {
+            if (name == typeName.name)
+            {
+                mask |= traceEventTypeBit(typeName.type);
+                found = true;
+            }
+        }
+        MCF_ASSERT(found, "Unknown trace event type: " + name);
+    }
+    return mask;
+}
+
+std::vector<std::string> traceEventTypeNames(uint32_t mask)
+{
+    std::vector<std::string> names;
+    for (const auto& typeName : EVENT_TYPE_NAMES)
+    {
+        if ((mask & traceEventTypeBit(typeName.type)) != 0)
+        {
+            names.emplace_back(typeName.name);
+        }
+    }
+    return names;
+}
+
+TraceSelection::TraceSelection(const std::vector<TraceFilterRule>& rules, const std::string& component)
+: fAll(rules.empty())
+{
+    MCF_ASSERT(rules.size() <= MAX_RULES, "Too many trace filter rules");
+    for (const auto& rule : rules)
+    {
+        if (globMatch(rule.component, component))
+        {
+            fRules.push_back(rule);
+            fTopicRules = fTopicRules || rule.topic != "*";
+        }
+    }
+    fCounters.reset(new std::atomic<uint64_t>[fRules.size()]);
+    for (size_t i = 0; i < fRules.size(); ++i)
+    {
+        fCounters[i] = 0;
+    }
+}
+
+bool TraceSelection::select(TraceEventType type, const std::string* topic)
+{
+    if (fAll)
+    {
+        return true;
+    }
+    const size_t i = findRule(type, topic);
+    if (i == fRules.size())
+    {
+        return false;
+    }
+    const TraceFilterRule& rule = fRules[i];
+    return rule.sampling <= 1 || fCounters[i].fetch_add(1, std::memory_order_relaxed) % rule.sampling == 0;
+}
+
+bool TraceSelection::matches(TraceEventType type, const std::string* topic)
+{
+    return fAll || findRule(type, topic) < fRules.size();
+}
+
+size_t TraceSelection::findRule(TraceEventType type, const std::string* topic)
+{
+    const uint32_t bit = traceEventTypeBit(type);
+    const uint64_t matches = (topic != nullptr && fTopicRules) ? topicMatches(*topic) : ~uint64_t(0);
+    for (size_t i = 0; i < fRules.size(); ++i)
+    {
+        const TraceFilterRule& rule = fRules[i];
+        const bool topicMatch = topic != nullptr ? ((matches >> i) & 1) != 0 : rule.topic == "*";
+        if ((rule.eventTypes & bit) != 0 && topicMatch)
+        {
+            return i;
+        }
+    }
+    return fRules.size();
+}
+
+uint64_t TraceSelection::topicMatches(const std::string& topic)
+{
+    std::lock_guard<std::mutex> lk(fTopicMutex);
+    auto it = fTopicMatches.find(topic);
+    if (it != fTopicMatches.end())
+    {
+        return it->second;
+    }
+    uint64_t matches = 0;
+    for (size_t i = 0; i < fRules.size(); ++i)
+    {
+        if (globMatch(fRules[i].topic, topic))
+        {
+            matches |= uint64_t(1) << i;
+        }
+    }
+    fTopicMatches.emplace(topic, matches);
+    return matches;
+}
+
+} // namespace mcf
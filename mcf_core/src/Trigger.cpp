@@ -0,0 +1,199 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/Trigger.h"
+
+#include <algorithm>
+#include <climits>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mcf {
+
+extern thread_local TriggerBatch* gTriggerBatch;
+extern thread_local InlineDispatch* gInlineDispatch;
+
+namespace {
+
+/**
+ * Guards the links between trigger sources and triggerables, which are changed rarely, so that
+ * neither side is destroyed while the other one unlinks it
+ */
+std::mutex& registrationMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+} // namespace
+
+void Trigger::waitBlocking()
+{
+    uint32_t state = fState.load(std::memory_order_acquire);
+    while (true) {
+        if (state == ACTIVE) {
+            if (fState.compare_exchange_weak(state, IDLE, std::memory_order_acquire)) {
+                return;
+            }
+            continue;
+        }
+        // announce the sleeper, so that trigger() issues the wake system call
+        if (state == IDLE && !fState.compare_exchange_weak(state, SLEEPING, std::memory_order_acquire)) {
+            continue;
+        }
+        // returns right away if the word is no longer SLEEPING
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&fState), FUTEX_WAIT_PRIVATE, SLEEPING, nullptr,
+                nullptr, 0);
+        state = fState.load(std::memory_order_acquire);
+    }
+}
+
+void Trigger::wakeSleepers()
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&fState), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void ITriggerable::detachTriggerSources()
+{
+    if (fSourceCount.load(std::memory_order_acquire) == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> registration(registrationMutex());
+    for (TriggerSource* source : fSources) {
+        // waits for a notification in progress
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(source->fMutex);
+        source->unlink(this);
+    }
+    fSources.clear();
+    fSourceCount.store(0, std::memory_order_release);
+}
+
+TriggerSource::~TriggerSource()
+{
+    std::lock_guard<std::mutex> registration(registrationMutex());
+    for (const auto& entry : fTriggerables) {
+        auto& sources = entry.triggerable->fSources;
+        sources.erase(std::remove(sources.begin(), sources.end(), this), sources.end());
+        entry.triggerable->fSourceCount.store(sources.size(), std::memory_order_release);
+    }
+}
+
+void TriggerSource::addTrigger(const std::shared_ptr<ITriggerable>& triggerable)
+{
+    if (triggerable == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> registration(registrationMutex());
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    auto it = std::find_if(fTriggerables.begin(), fTriggerables.end(), [&triggerable](const Registration& e) {
+        return e.triggerable == triggerable.get();
+    });
+    if (it == fTriggerables.end()) {
+        fTriggerables.push_back(Registration{triggerable.get(), triggerable});
+        triggerable->fSources.push_back(this);
+        triggerable->fSourceCount.store(triggerable->fSources.size(), std::memory_order_release);
+    }
+}
+
+void TriggerSource::removeTrigger(const std::shared_ptr<ITriggerable>& triggerable)
+{
+    if (triggerable == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> registration(registrationMutex());
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    unlink(triggerable.get());
+    auto& sources = triggerable->fSources;
+    sources.erase(std::remove(sources.begin(), sources.end(), this), sources.end());
+    triggerable->fSourceCount.store(sources.size(), std::memory_order_release);
+}
+
+void TriggerSource::unlink(ITriggerable* triggerable)
+{
+    fTriggerables.erase(std::remove_if(fTriggerables.begin(), fTriggerables.end(),
+                                       [triggerable](const Registration& e) { return e.triggerable == triggerable; }),
+                        fTriggerables.end());
+}
+
+TriggerBatch::TriggerBatch()
+: fOutermost(gTriggerBatch == nullptr)
+{
+    if (fOutermost) {
+        gTriggerBatch = this;
+    }
+}
+
+TriggerBatch::~TriggerBatch()
+{
+    if (!fOutermost) {
+        return;
+    }
+    gTriggerBatch = nullptr;
+    for (const auto& triggerable : fTriggerables) {
+        triggerable->trigger();
+    }
+}
+
+TriggerBatch* TriggerBatch::current()
+{
+    return gTriggerBatch;
+}
+
+void TriggerBatch::add(const std::shared_ptr<ITriggerable>& triggerable)
+{
+    // the number of triggers per batch is small, a linear search is sufficient
+    if (std::find(fTriggerables.begin(), fTriggerables.end(), triggerable) == fTriggerables.end()) {
+        fTriggerables.push_back(triggerable);
+    }
+}
+
+InlineDispatch::InlineDispatch()
+: fPrevious(gInlineDispatch)
+, fOpen(true)
+{
+    gInlineDispatch = this;
+}
+
+InlineDispatch::~InlineDispatch()
+{
+    close();
+    // not run, let the triggerables handle their events the usual way
+    for (const auto& triggerable : fTriggerables) {
+        triggerable->trigger();
+    }
+}
+
+InlineDispatch* InlineDispatch::current()
+{
+    return gInlineDispatch;
+}
+
+void InlineDispatch::add(const std::shared_ptr<ITriggerable>& triggerable)
+{
+    if (std::find(fTriggerables.begin(), fTriggerables.end(), triggerable) == fTriggerables.end()) {
+        fTriggerables.push_back(triggerable);
+    }
+}
+
+void InlineDispatch::run()
+{
+    close();
+    // an inline handler may open dispatches of its own, but never adds to this one
+    while (!fTriggerables.empty()) {
+        auto triggerable = std::move(fTriggerables.front());
+        fTriggerables.erase(fTriggerables.begin());
+        triggerable->triggerInline();
+    }
+}
+
+void InlineDispatch::close()
+{
+    if (fOpen) {
+        gInlineDispatch = fPrevious;
+        fOpen = false;
+    }
+}
+
+} // namespace mcf
@@ -0,0 +1,20 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+namespace mcf {
+
+class TriggerBatch;
+class InlineDispatch;
+
+/**
+ * Thread-local trigger batch collecting coalescable trigger events
+ */
+thread_local TriggerBatch* gTriggerBatch = nullptr;
+
+/**
+ * Thread-local dispatch collecting inline trigger events
+ */
+thread_local InlineDispatch* gInlineDispatch = nullptr;
+
+} // namespace mcf
@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/ValueReclaimer.h"
+
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/LoggingMacros.h"
+#include "mcf_core/ThreadName.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mcf {
+
+std::atomic<bool> gValueReclaimerActive(false);
+
+namespace {
+
+/// nice value of the reclaimer thread
+constexpr int RECLAIMER_NICE = 10;
+
+} // anonymous namespace
+
+ValueReclaimer& ValueReclaimer::instance() {
+    static ValueReclaimer* reclaimer = new ValueReclaimer();
+    return *reclaimer;
+}
+
+void ValueReclaimer::enable(const Config& config) {
+    MCF_ASSERT(config.capacity > 0, "ValueReclaimer: the queue needs a capacity");
+    // the queue is resized while no memory is waiting in it
+    disable();
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    fConfig = config;
+    fQueue = std::vector<Entry>(config.capacity);
+    fHead = 0;
+    fStatistics.queueDepth = 0;
+    fStatistics.queueBytes = 0;
+    fStopRequest = false;
+    fRunning = true;
+    fMinBytes.store(config.minBytes, std::memory_order_relaxed);
+    fThread = std::thread([this] { run(); });
+    gValueReclaimerActive.store(true, std::memory_order_relaxed);
+}
+
+void ValueReclaimer::disable() {
+    {
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+        if (!fRunning) {
+            return;
+        }
+        gValueReclaimerActive.store(false, std::memory_order_relaxed);
+        fRunning = false;
+        fStopRequest = true;
+    }
+    fCv.notify_all();
+    // the thread frees the memory still waiting before it ends
+    fThread.join();
+}
+
+ValueReclaimer::Config ValueReclaimer::config() const {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    return fConfig;
+}
+
+bool ValueReclaimer::reclaim(std::unique_ptr<Garbage> garbage, uint64_t bytes) {
+    if (!active() || garbage == nullptr || bytes < fMinBytes.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    std::unique_lock<mutex::PriorityInheritanceMutex> lk(fMutex);
+    if (!fRunning) {
+        lk.unlock();
+        garbage.reset();
+        return false;
+    }
+    if (fStatistics.queueDepth == fQueue.size()) {
+        ++fStatistics.overflows;
+        lk.unlock();
+        garbage.reset();
+        return false;
+    }
+    Entry& entry = fQueue[(fHead + fStatistics.queueDepth) % fQueue.size()];
+    entry.garbage = std::move(garbage);
+    entry.bytes = bytes;
+    ++fStatistics.queueDepth;
+    fStatistics.queueBytes += bytes;
+    ++fStatistics.deferred;
+    fStatistics.deferredBytes += bytes;
+    fStatistics.maxQueueDepth = std::max(fStatistics.maxQueueDepth, fStatistics.queueDepth);
+    // the thread only waits while the queue is empty
+    const bool wake = fStatistics.queueDepth == 1;
+    lk.unlock();
+    if (wake) {
+        fCv.notify_one();
+    }
+    return true;
+}
+
+void ValueReclaimer::flush() {
+    std::unique_lock<mutex::PriorityInheritanceMutex> lk(fMutex);
+    fFlushedCv.wait(lk, [this] { return fStatistics.queueDepth == 0 && !fBusy; });
+}
+
+ValueReclaimer::Statistics ValueReclaimer::statistics() const {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    return fStatistics;
+}
+
+void ValueReclaimer::run() {
+    setThreadName("ValueReclaimer");
+    // the thread inherits the scheduling of the enabling thread, which may be a real-time thread
+    sched_param parameters{};
+    parameters.sched_priority = 0;
+    int result = pthread_setschedparam(pthread_self(), SCHED_OTHER, &parameters);
+    if (result == 0 && setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), RECLAIMER_NICE) != 0) {
+        result = errno;
+    }
+    if (result != 0) {
+        MCF_WARN_NOFILELINE("ValueReclaimer: cannot lower the priority of the reclaimer thread: {}",
+                            std::strerror(result));
+    }
+
+    std::unique_lock<mutex::PriorityInheritanceMutex> lk(fMutex);
+    while (true) {
+        fCv.wait(lk, [this] { return fStopRequest || fStatistics.queueDepth > 0; });
+        if (fStatistics.queueDepth == 0) {
+            break;
+        }
+        Entry entry = std::move(fQueue[fHead]);
+        fHead = (fHead + 1) % fQueue.size();
+        --fStatistics.queueDepth;
+        fStatistics.queueBytes -= entry.bytes;
+        fBusy = true;
+        lk.unlock();
+        entry.garbage.reset();
+        lk.lock();
+        fBusy = false;
+        if (fStatistics.queueDepth == 0) {
+            fFlushedCv.notify_all();
+        }
+    }
+}
+
+} // namespace mcf
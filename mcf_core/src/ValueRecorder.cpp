@@ -2,15 +2,22 @@
  * Copyright (c) 2024 Accenture
  */
 #include "mcf_core/ValueRecorder.h"
+#include "mcf_core/ISerializedValue.h"
 #include "mcf_core/ValueStore.h"
 #include "mcf_core/ThreadName.h"
 #include "mcf_core/LoggingMacros.h"
+#include "mcf_core/ErrorMacros.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
 #include <fstream>
 #include <unistd.h>
 #include <fcntl.h>
 #include "sys/time.h"
 #include "sys/resource.h"
+#include "sys/uio.h"
 #if HAVE_ZLIB
 #include <zlib.h>
 #endif
@@ -21,6 +28,16 @@ namespace mcf
 namespace
 {
 
+/// Time the write thread waits for values before checking for a stop request
+constexpr std::chrono::milliseconds WAIT_TIMEOUT(100);
+
+/// Pending bytes and segments after which a batch is written out before it is complete
+constexpr size_t FLUSH_BYTES = 4 * 1024 * 1024;
+constexpr size_t FLUSH_SEGMENTS = 512;
+
+/// Unchanged bytes ending a changed run of a delta, shorter ones are recorded as changed
+constexpr size_t DELTA_MIN_UNCHANGED = 8;
+
 /*
  * calc diff t2 - t1 in seconds
  */
@@ -31,12 +48,84 @@ float timeDiffSeconds(struct timeval& t2, struct timeval& t1)
     return diff.tv_sec + ((float)diff.tv_usec)/1000000;
 }
 
+void appendVarint(std::vector<char>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/*
+ * encode next as runs of unchanged and changed bytes relative to previous, see msg::RecordDelta
+ */
+void encodeDeltaRuns(const std::vector<char>& previous, const std::vector<char>& next,
+                     std::vector<char>& runs)
+{
+    const size_t common = std::min(previous.size(), next.size());
+    size_t pos = 0;
+    while (pos < next.size())
+    {
+        const size_t start = pos;
+        while (pos < common && previous[pos] == next[pos])
+        {
+            ++pos;
+        }
+        const size_t changedStart = pos;
+        while (pos < next.size())
+        {
+            if (pos >= common)
+            {
+                // bytes beyond the previous payload
+                pos = next.size();
+                break;
+            }
+            if (previous[pos] != next[pos])
+            {
+                ++pos;
+                continue;
+            }
+            size_t same = pos;
+            while (same < common && previous[same] == next[same]
+                   && same - pos < DELTA_MIN_UNCHANGED)
+            {
+                ++same;
+            }
+            if (same - pos >= DELTA_MIN_UNCHANGED || same == next.size())
+            {
+                break;
+            }
+            pos = same;
+        }
+        appendVarint(runs, changedStart - start);
+        appendVarint(runs, pos - changedStart);
+        runs.insert(runs.end(), next.begin() + changedStart, next.begin() + pos);
+    }
+}
+
 } // anonymous namespace
 
+constexpr const char* ValueRecorder::INDEX_TOPIC;
+constexpr const char* ValueRecorder::FOOTER_TOPIC;
+constexpr const char* ValueRecorder::FOOTER_MAGIC;
+constexpr uint64_t ValueRecorder::CHECKPOINT_INTERVAL_MS;
+constexpr size_t ValueRecorder::INDEX_BLOCK_CHECKPOINTS;
+constexpr const char* ValueRecorder::CHUNK_TOPIC;
+constexpr size_t ValueRecorder::QUEUE_ENTRY_BYTES;
+constexpr size_t ValueRecorder::DEFAULT_CHUNK_SIZE;
+constexpr int ValueRecorder::CHUNK_LEVEL_FAST;
+constexpr int ValueRecorder::CHUNK_LEVEL_DENSE;
+constexpr int ValueRecorder::CHUNK_LEVEL_NONE;
+constexpr uint32_t ValueRecorder::DEFAULT_KEYFRAME_INTERVAL;
+constexpr const char* ValueRecorder::SYNC_TOPIC;
+constexpr const char* ValueRecorder::SYNC_MAGIC;
+
 ValueRecorder::ValueRecorder(ValueStore& valueStore) :
         fValueStore(valueStore),
-        fQueue(std::make_shared<Queue>()),
-        fFile(-1),
+        fQueue(std::make_shared<Queue>(valueStore)),
+        fStorage(std::make_unique<BufferedFileStorage>()),
         fStopRequest(false),
         fStatusMonitor(valueStore)
 {}
@@ -51,15 +140,60 @@ ValueRecorder::~ValueRecorder()
  */
 void ValueRecorder::start(const std::string& filename) 
 {
-    if (fFile >= 0)
+    if (fStarted)
     {
         std::cout << "ERROR: value recorder already started" << strerror(errno) << std::endl;
         return;
     }
 
-    fFile = open(filename.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0666 );
-    if (fFile >= 0) 
+    fFilename = filename;
+    fSegment = 0;
+    // the receiving recorder of a handoff rotates its files itself
+    const bool rotating = !fHandoff && (fRotationBytes > 0 || fRotationDuration.count() > 0);
+    const std::string firstFile = rotating ? segmentFilename(filename, 0) : filename;
+    int result = fHandoff ? fHandoff->open(filename) : openFile(firstFile);
+    if (result != 0 && !fHandoff && dynamic_cast<BufferedFileStorage*>(fStorage.get()) == nullptr)
     {
+        MCF_WARN_NOFILELINE("Cannot open record file with the configured storage: {}, "
+                            "falling back to buffered writes", strerror(result));
+        fStorage = std::make_unique<BufferedFileStorage>();
+        result = openFile(firstFile);
+    }
+    if (result == 0) 
+    {
+        {
+            std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+            if (fHandoff)
+            {
+                fRecordFiles.clear();
+            }
+            else
+            {
+                fRecordFiles.assign(1, firstFile);
+            }
+        }
+        fSegmentStart = std::chrono::steady_clock::now();
+        fStarted = true;
+        fReportedBytes = 0;
+        fStreamOffset = 0;
+        fIndex.reset();
+        fChunks.clear();
+        fDeltas.clear();
+        fSyncRequested = 0;
+        fMarkerEnd = 0;
+        fLastSyncRequest = std::chrono::steady_clock::now();
+        fDumpRequested = false;
+        fDumping = false;
+        fFlightTopics.clear();
+        if ((fSyncBytes > 0 || fSyncInterval.count() > 0) && !fHandoff)
+        {
+            fSync = std::make_unique<SyncThread>(*fStorage);
+        }
+        if (fWorkerCount > 0 && !fHandoff)
+        {
+            std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+            fWorkers = std::make_unique<WorkerPool>(*this, fWorkerCount, fCpuAffinity);
+        }
         fValueStore.addAllTopicReceiver(fQueue);
         fStopRequest = false;
 
@@ -67,20 +201,39 @@ void ValueRecorder::start(const std::string& filename)
     }
     else 
     {
-        std::cout << "ERROR: opening record file: " << strerror(errno) << std::endl;
+        std::cout << "ERROR: opening record file: " << strerror(result) << std::endl;
         return;
     }
 }
 
-void ValueRecorder::stop() {
-
-    if (fFile >= 0) 
+void ValueRecorder::requestStop()
+{
+    if (fStarted && !fStopRequest)
     {
         fStopRequest = true;
         fValueStore.removeAllTopicReceiver(fQueue);
+        fQueue->wakeUp();
+    }
+}
+
+void ValueRecorder::stop() {
+
+    if (fStarted) 
+    {
+        requestStop();
         fThread.join();
-        close(fFile);
-        fFile = -1;
+        // values kept by the flight recorder are not recorded
+        fFlightRing.clear();
+        fFlightBytes = 0;
+        fWorkers.reset();
+        fSync.reset();
+        fEffectiveCpuAffinity = 0;
+        int result = fHandoff ? fHandoff->close() : fStorage->close();
+        if (result != 0)
+        {
+            std::cout << "ERROR: closing record file: " << strerror(result) << std::endl;
+        }
+        fStarted = false;
     }
     else 
     {
@@ -117,255 +270,1630 @@ void ValueRecorder::enableExtMemCompression(const std::string& topic)
 #endif
 }
 
-void ValueRecorder::setWriteQueueSizeLimit(uint32_t limit)
+void ValueRecorder::enableChunkCompression(const std::string& topic, int level)
 {
+#if HAVE_ZLIB
+    if (level < CHUNK_LEVEL_FAST || level > CHUNK_LEVEL_DENSE)
+    {
+        MCF_THROW_RUNTIME(fmt::format(
+            "Invalid chunk compression level {} for topic '{}'", level, topic));
+    }
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    fQueueSizeLimit = limit;
+    fChunkTopics[topic] = level;
+#else
+    MCF_WARN_NOFILELINE(
+        "Setting chunk compression for topic '{}' has no effect. "
+        "Compression is not available. Make sure HAVE_ZLIB is set.",
+        topic);
+#endif
 }
 
-/*
- * disable serialization for a specific topic
- */
-void ValueRecorder::disableSerialization(const std::string& topic) 
+void ValueRecorder::setChunkSize(size_t size)
 {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    fDisabledTopics.insert(topic);
+    // the sizes of a chunk are recorded as uint32
+    fChunkSize = std::min<size_t>(std::max<size_t>(size, 1), UINT32_MAX / 2);
 }
 
-void ValueRecorder::writeThread() 
+void ValueRecorder::enableDeltaEncoding(const std::string& topic, uint32_t keyframeInterval)
 {
-    setThreadName("ValueRecorderW");
-    QueueEntry qe;
-    fStatusMonitor.start();
-    while(!fStopRequest) 
+    if (keyframeInterval == 0)
     {
-        size_t queueSize = fQueue->pop(qe);
-        while(qe.value != nullptr) 
-        {
-            size_t queueSizeLimit;
-            {
-                std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-                queueSizeLimit = fQueueSizeLimit;
-            }
-            if(queueSize < queueSizeLimit || qe.topic == "/mcf/recorder/status")
-            {
-                serialize(qe);
-            }
-            else
-            {
-                fStatusMonitor.reportDropped();
-            }
-            queueSize = fQueue->pop(qe);
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        MCF_THROW_RUNTIME(fmt::format("Invalid keyframe interval 0 for topic '{}'", topic));
     }
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    fDeltaTopics[topic] = keyframeInterval;
 }
 
-bool ValueRecorder::isExtMemEnabled(const std::string& topic) const 
+void ValueRecorder::setWriteQueueByteLimit(uint64_t bytes)
 {
-    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    return fEnabledExtMemTopics.find(topic) != fEnabledExtMemTopics.end();
+    fQueue->setByteLimit(bytes);
 }
 
-bool ValueRecorder::isExtMemCompressionEnabled(const std::string& topic) const 
+uint64_t ValueRecorder::getWriteQueueBytes() const
 {
-    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    return fCompressExtMemTopics.find(topic) != fCompressExtMemTopics.end();
+    return fQueue->queuedBytes();
 }
 
-bool ValueRecorder::isTopicEnabled(const std::string& topic) const 
+void ValueRecorder::setTopicPriority(const std::string& topic, Priority priority)
 {
-    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    return fDisabledTopics.find(topic) == fDisabledTopics.end();
+    fQueue->setPriority(topic, priority);
 }
 
-void ValueRecorder::serialize(QueueEntry& qe) 
+void ValueRecorder::setWriteQueueSizeLimit(uint32_t limit)
 {
-    auto typeinfoPtr = fValueStore.getTypeInfo(*qe.value);
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    fQueueSizeLimit = limit;
+}
 
-    if (isTopicEnabled(qe.topic)) 
+/*
+ * disable serialization for a specific topic
+ */
+void ValueRecorder::disableSerialization(const std::string& topic) 
+{
     {
-        if (typeinfoPtr != nullptr) 
-        {
-            fStatusMonitor.serializeBegin(fQueue->size(), qe.time);
-
-            msgpack::sbuffer buffer;
-            msgpack::packer<msgpack::sbuffer> pk(&buffer);
-
-            PacketHeader pHeader;
-            pHeader.time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                qe.time.time_since_epoch()).count();
-            pHeader.topic = qe.topic;
-            pHeader.tid = typeinfoPtr->id;
-            pHeader.vid = qe.value->id();
-            pk.pack(pHeader);
-
-            const void* ptr        = nullptr;
-            size_t uncompressedLen = 0;
-            size_t size            = 0;
-
-            bool extMemEnabled = isExtMemEnabled(qe.topic);
-            bool compressExtMem = isExtMemCompressionEnabled(qe.topic);
-
-            typeinfoPtr->packFunc(pk, qe.value, ptr, uncompressedLen, extMemEnabled);
-
-            bool packExtMem = (uncompressedLen > 0) && extMemEnabled;
-
-            ExtMemHeader mHeader{};
-            mHeader.extmemSize = uncompressedLen;
-            mHeader.extmemPresent = packExtMem;
-#if HAVE_ZLIB
-            std::unique_ptr<Bytef[]> compressed = nullptr;
-            if(packExtMem && compressExtMem)
-            {
-                uLongf compressedLen = uncompressedLen*2;
-                const Bytef* srcPtr = reinterpret_cast<const Bytef*>(ptr);
-                compressed = std::make_unique<Bytef[]>(compressedLen);
-
-                int ret = compress(compressed.get(), &compressedLen, srcPtr, uncompressedLen);
-                if(ret == Z_OK)
-                {
-                    size = compressedLen;
-                    mHeader.extmemSizeCompressed = compressedLen;
-                    ptr = compressed.get();
-                }
-                else
-                {
-                    std::string warning = fmt::format(
-                        "Could not compress extmem data on {}. "
-                        "Falling back to non-compressed recording.",
-                        qe.topic
-                    );
-                    fStatusMonitor.reportWriteError(warning);
-                    MCF_WARN(warning);
-                    size = uncompressedLen;
-                    mHeader.extmemSizeCompressed = 0;
-                }
-            }
-            else
-#endif
-            {
-                size = uncompressedLen;
-                mHeader.extmemSizeCompressed = 0;
-            }
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+        fDisabledTopics.insert(topic);
+    }
+    fQueue->disableTopic(topic);
+    fValueStore.notifySubscriptionsChanged();
+}
 
+void ValueRecorder::setRecordPolicy(const std::string& topic, const RecordPolicy& policy)
+{
+    if ((policy.mode == RecordPolicy::Mode::EVERY_NTH && policy.n == 0)
+        || (policy.mode == RecordPolicy::Mode::MAX_RATE && !(policy.rateHz > 0.0)))
+    {
+        MCF_THROW_RUNTIME(fmt::format("Invalid record policy for topic '{}'", topic));
+    }
+    fQueue->setPolicy(topic, policy);
+}
 
-            pk.pack(mHeader);
+void ValueRecorder::setStorage(std::unique_ptr<IRecorderStorage> storage)
+{
+    if (fStarted)
+    {
+        MCF_WARN_NOFILELINE("Cannot change the storage of a started value recorder");
+        return;
+    }
+    fStorage = std::move(storage);
+}
 
-            if (write(fFile, buffer.data(), buffer.size()) < 0) 
-            {
-                fStatusMonitor.reportWriteError(std::string(strerror(errno)));
-            }
-            else 
-            {
-                fStatusMonitor.incBytesWritten(buffer.size());
-            }
-            if (packExtMem)
-            {
-                if (write(fFile, static_cast<const char*>(ptr), size) < 0) 
-                {
-                    fStatusMonitor.reportWriteError(std::string(strerror(errno)));
-                }
-                else
-                {
-                    fStatusMonitor.incBytesWritten(size);
-                }
-            }
-            
-            fStatusMonitor.serializeEnd();
-        }
-        else
-        {
-            // ignoring value which can't be serialized
-        }
+void ValueRecorder::setHandoff(std::unique_ptr<IRecordHandoff> handoff)
+{
+    if (fStarted)
+    {
+        MCF_WARN_NOFILELINE("Cannot change the handoff of a started value recorder");
+        return;
     }
+    fHandoff = std::move(handoff);
 }
 
-ValueRecorder::Queue::Queue() : fMutex() 
-{}
+void ValueRecorder::recordValue(const std::string& topic, const ValuePtr& value,
+                                std::chrono::high_resolution_clock::time_point time, uint64_t seq)
+{
+    if (!fStarted)
+    {
+        return;
+    }
+    const std::string* key;
+    {
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+        key = &*fHandedOverTopics.insert(topic).first;
+    }
+    // lazily decoded values are decoded by prepare(), unless they are recorded serialized
+    fQueue->enqueue(*key, value, seq, time);
+}
 
-void ValueRecorder::Queue::receive(const std::string& topic, ValuePtr& value) 
+void ValueRecorder::setRotation(uint64_t maxBytes, std::chrono::milliseconds maxDuration)
 {
-    QueueValue qe;
-    qe.time = std::chrono::high_resolution_clock::now();
-    qe.value = value;
-    auto topicId = std::hash<std::string>{}(topic);
-    qe.topicId = topicId;
-    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    if (fTopicIdMap.find(topicId) == fTopicIdMap.end())
+    if (fStarted)
     {
-        fTopicIdMap[topicId] = topic;
+        MCF_WARN_NOFILELINE("Cannot change the rotation of a started value recorder");
+        return;
     }
+    fRotationBytes = maxBytes;
+    fRotationDuration = maxDuration;
+}
 
-    fDeque.push_back(qe);
+void ValueRecorder::setDurability(uint64_t syncBytes, std::chrono::milliseconds syncInterval)
+{
+    if (fStarted)
+    {
+        MCF_WARN_NOFILELINE("Cannot change the durability of a started value recorder");
+        return;
+    }
+    fSyncBytes = syncBytes;
+    fSyncInterval = syncInterval;
 }
 
-size_t ValueRecorder::Queue::pop(QueueEntry& qe) 
+void ValueRecorder::setFlightRecorder(const FlightRecorderConfig& config)
 {
-    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    if (!fDeque.empty()) 
+    if (fStarted)
     {
-        auto value = fDeque.front();
-        qe = QueueEntry{value.time, fTopicIdMap.at(value.topicId), value.value};
-        fDeque.pop_front();
-        return fDeque.size();
+        MCF_WARN_NOFILELINE("Cannot change the flight recorder of a started value recorder");
+        return;
     }
-    else 
+    fFlightConfig = std::make_unique<FlightRecorderConfig>(config);
+}
+
+void ValueRecorder::disableFlightRecorder()
+{
+    if (fStarted)
     {
-        qe = QueueEntry();
-        return 0;
+        MCF_WARN_NOFILELINE("Cannot change the flight recorder of a started value recorder");
+        return;
     }
+    fFlightConfig.reset();
 }
 
-size_t ValueRecorder::Queue::size() 
+void ValueRecorder::triggerDump()
+{
+    fDumpRequested = true;
+    fQueue->wakeUp();
+}
+
+std::vector<std::string> ValueRecorder::getRecordFiles() const
 {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    return fDeque.size();
+    return fRecordFiles;
 }
 
-ValueRecorder::StatusMonitor::StatusMonitor(ValueStore& valueStore)
-: fValueStore(valueStore)
-{}
+void ValueRecorder::setWorkerThreads(size_t count)
+{
+    if (fStarted)
+    {
+        MCF_WARN_NOFILELINE("Cannot change the worker threads of a started value recorder");
+        return;
+    }
+    fWorkerCount = count;
+}
 
-void ValueRecorder::StatusMonitor::start() 
+void ValueRecorder::setCpuAffinity(CpuMask cpuAffinity)
 {
-    fLastOutputTime = std::chrono::high_resolution_clock::now();
-    getrusage(RUSAGE_THREAD, &fResourceUsage);
-    initStatus();
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    fCpuAffinity = cpuAffinity;
 }
 
-void ValueRecorder::StatusMonitor::serializeBegin(
-        size_t queueSize,
-        std::chrono::high_resolution_clock::time_point& recordTime) 
+void ValueRecorder::writeThread() 
+{
+    setThreadName("ValueRecorderW");
+    CpuMask cpuAffinity;
+    {
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+        cpuAffinity = fCpuAffinity;
+    }
+    int result = setThreadCpuAffinity(pthread_self(), cpuAffinity);
+    if (result != 0)
+    {
+        std::cout << "ERROR: setting value recorder CPU affinity " << formatCpuMask(cpuAffinity)
+                  << ": " << strerror(result) << std::endl;
+    }
+    fEffectiveCpuAffinity = getThreadCpuAffinity(pthread_self());
+    std::deque<QueueEntry> batch;
+    fStatusMonitor.start();
+    while(!fStopRequest) 
+    {
+        // a requested dump is recorded also while no values are published
+        if (fQueue->popAll(batch, WAIT_TIMEOUT) > 0 || fDumpRequested)
         {
-    unsigned long latency = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now()-recordTime).count();
-    fTotalLatency += latency;
-    fNumWrites += 1;
-    if (latency > fRecorderStatus.maxLatencyMs) 
+            writeBatch(batch);
+        }
+        syncIfDue();
+    }
+    // values queued before stop() removed the receiver are still written
+    if (fQueue->popAll(batch, std::chrono::milliseconds(0)) > 0)
     {
-        fRecorderStatus.maxLatencyMs = latency;
+        writeBatch(batch);
     }
-    fTotalQueueSize += queueSize;
-    if (queueSize > fRecorderStatus.maxQueueSize) 
+    if (!fHandoff)
     {
-        fRecorderStatus.maxQueueSize = queueSize;
+        finishFile();
     }
 }
 
-void ValueRecorder::StatusMonitor::reportWriteError(const std::string& error) 
+int ValueRecorder::openFile(const std::string& filename)
 {
-    fRecorderStatus.errorFlag = true;
-    fRecorderStatus.errorDescs.insert(error);
+    int result = fStorage->open(filename);
+    if (result == 0 && fRotationBytes > 0)
+    {
+        // not needed for recording, only avoids allocating with each write
+        int reserved = fStorage->preallocate(fRotationBytes);
+        if (reserved != 0)
+        {
+            MCF_WARN_NOFILELINE("Cannot preallocate record file {}: {}", filename, strerror(reserved));
+        }
+    }
+    return result;
+}
+
+void ValueRecorder::finishFile()
+{
+    writeChunks();
+    writeIndexRecord(FOOTER_TOPIC, fIndex.footer(), FOOTER_MAGIC);
+    flush();
+    if (fSync)
+    {
+        // a complete file needs no sync marker
+        fSync->wait();
+        int result = fStorage->sync();
+        if (result != 0)
+        {
+            fStatusMonitor.reportWriteError(fmt::format("syncing record file: {}", strerror(result)));
+        }
+    }
 }
 
+bool ValueRecorder::rotationDue() const
+{
+    return (fRotationBytes > 0 && fStreamOffset >= fRotationBytes)
+        || (fRotationDuration.count() > 0
+            && std::chrono::steady_clock::now() - fSegmentStart >= fRotationDuration);
+}
 
-void ValueRecorder::StatusMonitor::reportDropped() 
+void ValueRecorder::rotate()
 {
-    fRecorderStatus.dropFlag = true;
-    if(fDropCount < UINT_MAX) // counter is not increased if UINT_MAX is reached.
+    finishFile();
+    int result = fStorage->close();
+    if (result != 0)
     {
-        fDropCount += 1;
+        fStatusMonitor.reportWriteError(fmt::format("closing record file: {}", strerror(result)));
     }
+    // the writes of asynchronous storages have completed now
+    fStatusMonitor.incBytesWritten(fStorage->bytesWritten() - fReportedBytes);
+    fReportedBytes = 0;
+    fStreamOffset = 0;
+    fIndex.reset();
+    // segments can be read independently
+    fDeltas.clear();
+    fSyncRequested = 0;
+    fMarkerEnd = 0;
+    if (fSync)
+    {
+        // the result of a sync of the previous file
+        uint64_t syncedSize;
+        int error;
+        fSync->takeResult(syncedSize, error);
+    }
+
+    const std::string filename = segmentFilename(fFilename, ++fSegment);
+    result = openFile(filename);
+    if (result != 0)
+    {
+        fStatusMonitor.reportWriteError(
+            fmt::format("opening record file {}: {}", filename, strerror(result)));
+    }
+    {
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+        fRecordFiles.push_back(filename);
+    }
+    fSegmentStart = std::chrono::steady_clock::now();
+}
+
+std::string ValueRecorder::segmentFilename(const std::string& filename, size_t segment)
+{
+    const size_t separator = filename.find_last_of('/');
+    size_t extension = filename.find_last_of('.');
+    if (extension == std::string::npos
+        || (separator != std::string::npos && extension < separator)
+        || extension == (separator == std::string::npos ? 0 : separator + 1))
+    {
+        extension = filename.size();
+    }
+    return fmt::format("{}_{:04d}{}", filename.substr(0, extension), segment, filename.substr(extension));
+}
+
+void ValueRecorder::writeBatch(std::deque<QueueEntry>& batch)
+{
+    size_t queueSizeLimit;
+    {
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+        queueSizeLimit = fQueueSizeLimit;
+    }
+    const uint32_t dropped = fQueue->takeDropped();
+    if (dropped > 0)
+    {
+        fStatusMonitor.reportDropped(dropped);
+    }
+    applyChangePolicies(batch);
+    if (fFlightConfig)
+    {
+        applyFlightRecorder(batch);
+    }
+    if (fHandoff)
+    {
+        handOffBatch(batch, queueSizeLimit);
+        return;
+    }
+    stageExtMem(batch);
+    if (fWorkers)
+    {
+        fWorkers->begin(batch, queueSizeLimit);
+    }
+    // the values behind the current one count as queued, like before they were taken at once
+    size_t queueSize = batch.size();
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        auto& qe = batch[i];
+        --queueSize;
+        Prepared* prepared = fWorkers ? &fWorkers->wait(i) : nullptr;
+        if (!isDropped(queueSize + 1, queueSizeLimit, fQueue->getPriority(*qe.topic)))
+        {
+            if (prepared == nullptr)
+            {
+                prepare(qe, fPrepared);
+                prepared = &fPrepared;
+            }
+            emit(qe, *prepared, queueSize);
+        }
+        else
+        {
+            fStatusMonitor.reportDropped();
+        }
+        if (fWorkers)
+        {
+            fWorkers->release(i);
+        }
+        if (rotationDue())
+        {
+            rotate();
+        }
+        if (fPendingBytes >= FLUSH_BYTES || fSegments.size() >= FLUSH_SEGMENTS)
+        {
+            flush();
+            syncIfDue();
+        }
+    }
+    if (fWorkers)
+    {
+        fWorkers->end();
+    }
+    flush();
+    // releases the values, whose ext mem may have been referenced by the flushed segments
+    batch.clear();
+}
+
+void ValueRecorder::stageExtMem(std::deque<QueueEntry>& batch) const
+{
+    for (auto& qe : batch)
+    {
+        const auto* extMemValue = dynamic_cast<const IExtMemValue*>(qe.value.get());
+        if (extMemValue == nullptr || !isTopicEnabled(*qe.topic) || !isExtMemEnabled(*qe.topic))
+        {
+            continue;
+        }
+        try
+        {
+            qe.staged = extMemValue->extMemStage();
+        }
+        catch (const std::exception&)
+        {
+            // the ext mem is copied by extMemPtr() when the value is serialized
+            qe.staged.reset();
+        }
+    }
+}
+
+void ValueRecorder::applyChangePolicies(std::deque<QueueEntry>& batch)
+{
+    // in queue order, so that each value is compared with the one recorded before it
+    batch.erase(std::remove_if(batch.begin(), batch.end(), [this](const QueueEntry& qe) {
+        if (qe.change == nullptr)
+        {
+            return false;
+        }
+        const uint64_t hash = hashValue(qe.value);
+        if (qe.change->recorded && qe.change->lastHash == hash)
+        {
+            return true;
+        }
+        qe.change->recorded = true;
+        qe.change->lastHash = hash;
+        return false;
+    }), batch.end());
+}
+
+uint64_t ValueRecorder::hashValue(const ValuePtr& value)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](const char* data, size_t size) {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+        }
+    };
+
+    // hashed as recorded, see prepare()
+    const auto* serializedValue = dynamic_cast<const ISerializedValue*>(value.get());
+    const auto* serialized = serializedValue != nullptr ? serializedValue->serializedForm() : nullptr;
+    if (serialized != nullptr)
+    {
+        add(serialized->typeId.data(), serialized->typeId.size());
+        add(reinterpret_cast<const char*>(&serialized->numericTypeId), sizeof(serialized->numericTypeId));
+        add(serialized->data, serialized->size);
+        if (serialized->extMem != nullptr)
+        {
+            add(serialized->extMem, serialized->extMemSize);
+        }
+        return hash;
+    }
+    const ValuePtr decoded = decodedValue(value);
+    const auto* typeinfoPtr = decoded != nullptr ? fValueStore.findTypeInfo(*decoded) : nullptr;
+    if (typeinfoPtr == nullptr)
+    {
+        return 0;
+    }
+    fHashBuffer.clear();
+    const void* extMem = nullptr;
+    size_t extMemSize = 0;
+    TypeRegistry::packValue(fHashBuffer, decoded, *typeinfoPtr, extMem, extMemSize, true);
+
+    add(typeinfoPtr->id.data(), typeinfoPtr->id.size());
+    add(fHashBuffer.data(), fHashBuffer.size());
+    if (extMem != nullptr)
+    {
+        add(static_cast<const char*>(extMem), extMemSize);
+    }
+    return hash;
+}
+
+void ValueRecorder::applyFlightRecorder(std::deque<QueueEntry>& batch)
+{
+    std::deque<QueueEntry> output;
+    const auto now = std::chrono::high_resolution_clock::now();
+    if (fDumpRequested.exchange(false))
+    {
+        startDump(output, now);
+    }
+    for (auto& qe : batch)
+    {
+        const bool trigger = *qe.topic == fFlightConfig->triggerTopic;
+        if (trigger)
+        {
+            startDump(output, qe.time);
+        }
+        else if (fDumping && qe.time > fDumpEnd)
+        {
+            fDumping = false;
+        }
+
+        if (!trigger && !isFlightTopic(*qe.topic))
+        {
+            continue;
+        }
+        if (fDumping)
+        {
+            output.push_back(std::move(qe));
+            continue;
+        }
+        const auto* extMemValue = dynamic_cast<const IExtMemValue*>(qe.value.get());
+        const uint64_t bytes = QUEUE_ENTRY_BYTES + (extMemValue != nullptr ? extMemValue->extMemSize() : 0);
+        fFlightRing.emplace_back(std::move(qe), bytes);
+        fFlightBytes += bytes;
+        const auto oldest = fFlightRing.back().first.time - fFlightConfig->preTrigger;
+        while (!fFlightRing.empty()
+               && (fFlightBytes > fFlightConfig->maxBytes || fFlightRing.front().first.time < oldest))
+        {
+            fFlightBytes -= fFlightRing.front().second;
+            fFlightRing.pop_front();
+        }
+    }
+    if (fDumping && now > fDumpEnd)
+    {
+        fDumping = false;
+    }
+    // releases the values not recorded
+    batch.swap(output);
+}
+
+void ValueRecorder::startDump(std::deque<QueueEntry>& output,
+                              std::chrono::high_resolution_clock::time_point time)
+{
+    const auto oldest = time - fFlightConfig->preTrigger;
+    for (auto& kept : fFlightRing)
+    {
+        if (kept.first.time >= oldest)
+        {
+            output.push_back(std::move(kept.first));
+        }
+    }
+    fFlightRing.clear();
+    fFlightBytes = 0;
+    const auto end = time + fFlightConfig->postTrigger;
+    fDumpEnd = fDumping ? std::max(fDumpEnd, end) : end;
+    fDumping = true;
+}
+
+bool ValueRecorder::isFlightTopic(const std::string& topic)
+{
+    auto it = fFlightTopics.find(&topic);
+    if (it == fFlightTopics.end())
+    {
+        const auto& patterns = fFlightConfig->topics;
+        const bool kept = patterns.empty() || std::any_of(patterns.begin(), patterns.end(),
+            [&topic](const std::string& pattern) { return ValueStore::matchesPattern(pattern, topic); });
+        it = fFlightTopics.emplace(&topic, kept).first;
+    }
+    return it->second;
+}
+
+void ValueRecorder::handOffBatch(std::deque<QueueEntry>& batch, size_t queueSizeLimit)
+{
+    size_t queueSize = batch.size();
+    for (auto& qe : batch)
+    {
+        --queueSize;
+        const std::string& topic = *qe.topic;
+        if (isDropped(queueSize + 1, queueSizeLimit, fQueue->getPriority(topic)))
+        {
+            fStatusMonitor.reportDropped();
+            continue;
+        }
+        // the handoff serializes the values itself
+        const ValuePtr value = decodedValue(qe.value);
+        const auto* typeinfoPtr = value != nullptr ? fValueStore.findTypeInfo(*value) : nullptr;
+        if (typeinfoPtr == nullptr || !isTopicEnabled(topic))
+        {
+            // ignoring value which can't or shall not be serialized
+            continue;
+        }
+        fStatusMonitor.serializeBegin(queueSize, qe.time);
+        const int result = fHandoff->handOff(topic, qe.time, value, qe.seq, *typeinfoPtr,
+                                             isExtMemEnabled(topic));
+        if (result == EAGAIN)
+        {
+            fStatusMonitor.reportDropped();
+        }
+        else if (result != 0)
+        {
+            fStatusMonitor.reportWriteError(
+                fmt::format("handing off value of {}: {}", topic, strerror(result)));
+        }
+        fStatusMonitor.serializeEnd();
+    }
+    batch.clear();
+}
+
+void ValueRecorder::flush()
+{
+    std::vector<iovec> iov;
+    iov.reserve(fSegments.size());
+    for (const auto& segment : fSegments)
+    {
+        const char* data = segment.data != nullptr ? segment.data : fWriteBuffer.data() + segment.offset;
+        iov.push_back(iovec{const_cast<char*>(data), segment.size});
+    }
+
+    int result = fStorage->write(iov.data(), iov.size());
+    if (result != 0)
+    {
+        fStatusMonitor.reportWriteError(std::string(strerror(result)));
+    }
+    // asynchronous storages report the bytes which have reached the file so far
+    const uint64_t written = fStorage->bytesWritten();
+    fStatusMonitor.incBytesWritten(written - fReportedBytes);
+    fReportedBytes = written;
+
+    // keeps the allocated capacity for the next batch
+    fWriteBuffer.clear();
+    fSegments.clear();
+    fCompressed.clear();
+    fPendingBytes = 0;
+}
+
+bool ValueRecorder::isExtMemEnabled(const std::string& topic) const 
+{
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    return fEnabledExtMemTopics.find(topic) != fEnabledExtMemTopics.end();
+}
+
+bool ValueRecorder::isExtMemCompressionEnabled(const std::string& topic) const 
+{
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    return fCompressExtMemTopics.find(topic) != fCompressExtMemTopics.end();
+}
+
+int ValueRecorder::chunkLevel(const std::string& topic) const
+{
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    auto it = fChunkTopics.find(topic);
+    return it != fChunkTopics.end() ? it->second : CHUNK_LEVEL_NONE;
+}
+
+uint32_t ValueRecorder::keyframeInterval(const std::string& topic) const
+{
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    auto it = fDeltaTopics.find(topic);
+    return it != fDeltaTopics.end() ? it->second : 0;
+}
+
+bool ValueRecorder::isTopicEnabled(const std::string& topic) const 
+{
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    return fDisabledTopics.find(topic) == fDisabledTopics.end();
+}
+
+void ValueRecorder::prepare(const QueueEntry& qe, Prepared& prepared) const
+{
+    prepared.buffer.clear();
+    prepared.extMem = nullptr;
+    prepared.extMemSize = 0;
+    prepared.compressed.reset();
+    prepared.error.clear();
+    prepared.valid = false;
+
+    // values kept in their serialized form are recorded as they are, other lazy values decoded
+    const auto* serializedValue = dynamic_cast<const ISerializedValue*>(qe.value.get());
+    const ISerializedValue::Serialized* serialized =
+        serializedValue != nullptr ? serializedValue->serializedForm() : nullptr;
+    const ValuePtr value = serialized != nullptr ? qe.value : decodedValue(qe.value);
+    const TypeRegistry::TypemapEntry* typeinfoPtr = nullptr;
+    const std::string* typeId = nullptr;
+    if (serialized != nullptr)
+    {
+        typeinfoPtr = serialized->typeId.empty() ? fValueStore.findTypeInfo(serialized->numericTypeId)
+                                                 : fValueStore.findTypeInfo(serialized->typeId);
+        // types not registered here are recorded with the id they were sent with
+        typeId = typeinfoPtr != nullptr ? &typeinfoPtr->id
+                                        : (serialized->typeId.empty() ? nullptr : &serialized->typeId);
+    }
+    else if (value != nullptr)
+    {
+        typeinfoPtr = fValueStore.findTypeInfo(*value);
+        typeId = typeinfoPtr != nullptr ? &typeinfoPtr->id : nullptr;
+    }
+    const std::string& topic = *qe.topic;
+
+    if (isTopicEnabled(topic)) 
+    {
+        if (typeId != nullptr) 
+        {
+            msgpack::packer<msgpack::sbuffer> pk(&prepared.buffer);
+
+            PacketHeader pHeader;
+            pHeader.time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                qe.time.time_since_epoch()).count();
+            pHeader.topic = topic;
+            pHeader.tid = *typeId;
+            pHeader.vid = qe.value->id();
+            pHeader.seq = qe.seq;
+            pk.pack(pHeader);
+            prepared.time = pHeader.time;
+            prepared.seq = pHeader.seq;
+            prepared.chunkLevel = chunkLevel(topic);
+            prepared.keyframeInterval = keyframeInterval(topic);
+            prepared.tid = typeId;
+            prepared.valueOffset = prepared.buffer.size();
+
+            const void* ptr        = nullptr;
+            size_t uncompressedLen = 0;
+            size_t size            = 0;
+
+            bool extMemEnabled = isExtMemEnabled(topic);
+            // chunks are compressed as a whole, deltas need the uncompressed data
+            bool compressExtMem = prepared.chunkLevel == CHUNK_LEVEL_NONE
+                && prepared.keyframeInterval == 0 && isExtMemCompressionEnabled(topic);
+
+            if (serialized != nullptr)
+            {
+                // no decode and encode round trip, the packed value is the one which was sent
+                prepared.buffer.write(serialized->data, serialized->size);
+                if (extMemEnabled && serialized->extMem != nullptr)
+                {
+                    ptr = serialized->extMem;
+                    uncompressedLen = serialized->extMemSize;
+                }
+            }
+            else if (qe.staged != nullptr)
+            {
+                // waits for the staged copy instead of copying in extMemPtr()
+                TypeRegistry::packValue(prepared.buffer, value, *typeinfoPtr, ptr, uncompressedLen, false);
+                ptr = qe.staged->data();
+                uncompressedLen = qe.staged->size();
+            }
+            else
+            {
+                TypeRegistry::packValue(prepared.buffer, value, *typeinfoPtr, ptr, uncompressedLen, extMemEnabled);
+            }
+            prepared.valueSize = prepared.buffer.size() - prepared.valueOffset;
+
+            bool packExtMem = (uncompressedLen > 0) && extMemEnabled;
+
+            ExtMemHeader mHeader{};
+            mHeader.extmemSize = uncompressedLen;
+            mHeader.extmemPresent = packExtMem;
+#if HAVE_ZLIB
+            if(packExtMem && compressExtMem)
+            {
+                uLongf compressedLen = compressBound(uncompressedLen);
+                const Bytef* srcPtr = reinterpret_cast<const Bytef*>(ptr);
+                prepared.compressed = std::make_unique<Bytef[]>(compressedLen);
+
+                int ret = compress(prepared.compressed.get(), &compressedLen, srcPtr, uncompressedLen);
+                if(ret == Z_OK)
+                {
+                    size = compressedLen;
+                    mHeader.extmemSizeCompressed = compressedLen;
+                    ptr = prepared.compressed.get();
+                }
+                else
+                {
+                    // reported by the write thread
+                    prepared.error = fmt::format(
+                        "Could not compress extmem data on {}. "
+                        "Falling back to non-compressed recording.",
+                        topic
+                    );
+                    prepared.compressed.reset();
+                    size = uncompressedLen;
+                    mHeader.extmemSizeCompressed = 0;
+                }
+            }
+            else
+#endif
+            {
+                size = uncompressedLen;
+                mHeader.extmemSizeCompressed = 0;
+            }
+
+
+            pk.pack(mHeader);
+            prepared.extMemHeader = mHeader;
+
+            if (packExtMem)
+            {
+                prepared.extMem = static_cast<const char*>(ptr);
+                prepared.extMemSize = size;
+            }
+            prepared.valid = true;
+        }
+        else
+        {
+            // ignoring value which can't be serialized
+        }
+    }
+}
+
+void ValueRecorder::emit(QueueEntry& qe, Prepared& prepared, size_t queueSize)
+{
+    if (!prepared.valid)
+    {
+        return;
+    }
+    fStatusMonitor.serializeBegin(queueSize, qe.time);
+    if (!prepared.error.empty())
+    {
+        fStatusMonitor.reportWriteError(prepared.error);
+        MCF_WARN(prepared.error);
+    }
+
+    // records before a checkpoint must not be held back in chunks
+    if (fIndex.checkpointDue(prepared.time))
+    {
+        writeChunks();
+        // reading from the checkpoint on needs no earlier values
+        fDeltas.clear();
+    }
+
+    if (prepared.keyframeInterval > 0)
+    {
+        encodeDelta(qe, prepared);
+    }
+
+    if (prepared.chunkLevel != CHUNK_LEVEL_NONE)
+    {
+        Chunk& chunk = fChunks[prepared.chunkLevel];
+        // the ext mem data is copied, the chunk outlives the batch
+        chunk.buffer.write(prepared.buffer.data(), prepared.buffer.size());
+        if (prepared.extMemSize > 0)
+        {
+            chunk.buffer.write(prepared.extMem, prepared.extMemSize);
+        }
+        if (chunk.records == 0)
+        {
+            chunk.startTime = prepared.time;
+        }
+        ++chunk.records;
+        // the chunk is recorded at or after the current offset
+        if (fIndex.add(*qe.topic, prepared.time, fStreamOffset))
+        {
+            writeIndexRecord(INDEX_TOPIC, fIndex.takeBlock(fStreamOffset), nullptr);
+        }
+        if (chunk.buffer.size() >= fChunkSize)
+        {
+            writeChunk(prepared.chunkLevel, chunk);
+        }
+    }
+    else
+    {
+        const size_t offset = fWriteBuffer.size();
+        fWriteBuffer.write(prepared.buffer.data(), prepared.buffer.size());
+        if (prepared.compressed != nullptr)
+        {
+            fCompressed.push_back(std::move(prepared.compressed));
+        }
+        const uint64_t recordOffset = appendRecord(offset, prepared.extMem, prepared.extMemSize);
+        if (fIndex.add(*qe.topic, prepared.time, recordOffset))
+        {
+            writeIndexRecord(INDEX_TOPIC, fIndex.takeBlock(fStreamOffset), nullptr);
+        }
+    }
+
+    fStatusMonitor.serializeEnd();
+}
+
+void ValueRecorder::encodeDelta(const QueueEntry& qe, Prepared& prepared)
+{
+    msg::RecordDelta delta;
+    const auto* typeinfoPtr = fValueStore.findTypeInfo(delta);
+    if (typeinfoPtr == nullptr)
+    {
+        return;
+    }
+    const char* value = prepared.buffer.data() + prepared.valueOffset;
+    fDeltaPayload.assign(value, value + prepared.valueSize);
+    if (prepared.extMemSize > 0)
+    {
+        fDeltaPayload.insert(fDeltaPayload.end(), prepared.extMem, prepared.extMem + prepared.extMemSize);
+    }
+
+    DeltaState& state = fDeltas[*qe.topic];
+    bool keyframe = state.tid != *prepared.tid || state.deltas + 1 >= prepared.keyframeInterval;
+    fDeltaRuns.clear();
+    if (!keyframe)
+    {
+        encodeDeltaRuns(state.payload, fDeltaPayload, fDeltaRuns);
+        keyframe = fDeltaRuns.size() >= fDeltaPayload.size();
+    }
+    state.deltas = keyframe ? 0 : state.deltas + 1;
+    const std::vector<char>& data = keyframe ? fDeltaPayload : fDeltaRuns;
+
+    // the data must outlive the next value of the topic until it is flushed
+    prepared.compressed = std::make_unique<unsigned char[]>(data.size());
+    std::memcpy(prepared.compressed.get(), data.data(), data.size());
+    prepared.extMem = reinterpret_cast<const char*>(prepared.compressed.get());
+    prepared.extMemSize = data.size();
+
+    delta.tid = *prepared.tid;
+    delta.keyframe = keyframe;
+    delta.valueSize = prepared.valueSize;
+    delta.extmemSize = prepared.extMemHeader.extmemSize;
+    delta.extmemPresent = prepared.extMemHeader.extmemPresent;
+
+    prepared.buffer.clear();
+    msgpack::packer<msgpack::sbuffer> pk(&prepared.buffer);
+    PacketHeader pHeader;
+    pHeader.time = prepared.time;
+    pHeader.topic = *qe.topic;
+    pHeader.tid = typeinfoPtr->id;
+    pHeader.vid = qe.value->id();
+    pHeader.seq = prepared.seq;
+    pk.pack(pHeader);
+    pk.pack(delta);
+    ExtMemHeader mHeader{};
+    mHeader.extmemSize = data.size();
+    mHeader.extmemPresent = true;
+    pk.pack(mHeader);
+
+    state.tid = *prepared.tid;
+    state.payload.swap(fDeltaPayload);
+}
+
+bool ValueRecorder::isDropped(uint64_t queued, uint64_t limit, Priority priority)
+{
+    switch (priority)
+    {
+    case Priority::BULK:
+        return queued > limit / 2;
+    case Priority::NORMAL:
+        return queued > limit;
+    default:
+        return false;
+    }
+}
+
+uint64_t ValueRecorder::appendRecord(size_t bufferOffset, const char* extMem, size_t extMemSize)
+{
+    // consecutive headers form a single segment of the write buffer
+    const size_t headerSize = fWriteBuffer.size() - bufferOffset;
+    if (!fSegments.empty() && fSegments.back().data == nullptr)
+    {
+        fSegments.back().size += headerSize;
+    }
+    else
+    {
+        fSegments.push_back(Segment{nullptr, bufferOffset, headerSize});
+    }
+    fPendingBytes += headerSize;
+    if (extMemSize > 0)
+    {
+        fSegments.push_back(Segment{extMem, 0, extMemSize});
+        fPendingBytes += extMemSize;
+    }
+    const uint64_t recordOffset = fStreamOffset;
+    fStreamOffset += headerSize + extMemSize;
+    return recordOffset;
+}
+
+void ValueRecorder::writeIndexRecord(const char* topic, const ValuePtr& value, const char* trailerMagic)
+{
+    const auto* typeinfoPtr = fValueStore.findTypeInfo(*value);
+    if (typeinfoPtr == nullptr)
+    {
+        return;
+    }
+    const size_t offset = fWriteBuffer.size();
+    msgpack::packer<msgpack::sbuffer> pk(&fWriteBuffer);
+
+    PacketHeader pHeader;
+    pHeader.time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    pHeader.topic = topic;
+    pHeader.tid = typeinfoPtr->id;
+    pHeader.vid = value->id();
+    pk.pack(pHeader);
+
+    TypeRegistry::pack(pk, *value, *typeinfoPtr);
+
+    ExtMemHeader mHeader{};
+    if (trailerMagic != nullptr)
+    {
+        // the trailer is recorded as ext mem data, so that readers without index support
+        // still see a valid stream
+        mHeader.extmemSize = 16;
+        mHeader.extmemPresent = true;
+    }
+    pk.pack(mHeader);
+    if (trailerMagic != nullptr)
+    {
+        const uint64_t recordOffset = fStreamOffset;
+        char trailer[16];
+        for (int i = 0; i < 8; ++i)
+        {
+            trailer[i] = static_cast<char>((recordOffset >> (8 * i)) & 0xff);
+        }
+        std::memcpy(trailer + 8, trailerMagic, 8);
+        fWriteBuffer.write(trailer, sizeof(trailer));
+    }
+    appendRecord(offset, nullptr, 0);
+}
+
+void ValueRecorder::syncIfDue()
+{
+    if (!fSync)
+    {
+        return;
+    }
+    uint64_t syncedSize = 0;
+    int error = 0;
+    if (fSync->takeResult(syncedSize, error))
+    {
+        if (error != 0)
+        {
+            fStatusMonitor.reportWriteError(fmt::format("syncing record file: {}", strerror(error)));
+        }
+        else if (syncedSize > fMarkerEnd)
+        {
+            // not only the previous marker has been synced
+            auto marker = std::make_shared<msg::RecordSyncMarker>();
+            marker->syncedSize = syncedSize;
+            writeIndexRecord(SYNC_TOPIC, marker, SYNC_MAGIC);
+            flush();
+            fMarkerEnd = fStreamOffset;
+        }
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const uint64_t unsynced = fStreamOffset - fSyncRequested;
+    const bool due = (fSyncBytes > 0 && unsynced >= fSyncBytes)
+        || (fSyncInterval.count() > 0 && now - fLastSyncRequest >= fSyncInterval);
+    // everything up to the stream offset has been passed to the storage
+    if (unsynced > 0 && due && fSync->request(fStreamOffset))
+    {
+        fSyncRequested = fStreamOffset;
+        fLastSyncRequest = now;
+    }
+}
+
+void ValueRecorder::writeChunk(int level, Chunk& chunk)
+{
+    if (chunk.records == 0)
+    {
+        return;
+    }
+#if HAVE_ZLIB
+    auto value = std::make_shared<msg::RecordChunk>();
+    value->codec = "deflate";
+    value->records = chunk.records;
+    const auto* typeinfoPtr = fValueStore.findTypeInfo(*value);
+
+    const uLong uncompressedLen = chunk.buffer.size();
+    uLongf compressedLen = compressBound(uncompressedLen);
+    auto compressed = std::make_unique<Bytef[]>(compressedLen);
+    int ret = compress2(compressed.get(), &compressedLen,
+        reinterpret_cast<const Bytef*>(chunk.buffer.data()), uncompressedLen, level);
+    if (ret == Z_OK && typeinfoPtr != nullptr)
+    {
+        const size_t offset = fWriteBuffer.size();
+        msgpack::packer<msgpack::sbuffer> pk(&fWriteBuffer);
+
+        PacketHeader pHeader;
+        pHeader.time = chunk.startTime;
+        pHeader.topic = CHUNK_TOPIC;
+        pHeader.tid = typeinfoPtr->id;
+        pHeader.vid = value->id();
+        pk.pack(pHeader);
+
+        TypeRegistry::pack(pk, *value, *typeinfoPtr);
+
+        ExtMemHeader mHeader{};
+        mHeader.extmemSize = uncompressedLen;
+        mHeader.extmemPresent = true;
+        mHeader.extmemSizeCompressed = compressedLen;
+        pk.pack(mHeader);
+
+        appendRecord(offset, reinterpret_cast<const char*>(compressed.get()), compressedLen);
+        fCompressed.push_back(std::move(compressed));
+    }
+    else
+#endif
+    {
+        // the chunk holds complete records, which are recorded as they are
+        const size_t offset = fWriteBuffer.size();
+        fWriteBuffer.write(chunk.buffer.data(), chunk.buffer.size());
+        appendRecord(offset, nullptr, 0);
+    }
+    chunk.buffer.clear();
+    chunk.records = 0;
+}
+
+void ValueRecorder::writeChunks()
+{
+    for (auto& chunk : fChunks)
+    {
+        writeChunk(chunk.first, chunk.second);
+    }
+}
+
+void ValueRecorder::RecordIndex::reset()
+{
+    *this = RecordIndex();
+}
+
+bool ValueRecorder::RecordIndex::checkpointDue(uint64_t time) const
+{
+    return fTimes.empty() || std::max(fEndTime, time) >= fTimes.back() + CHECKPOINT_INTERVAL_MS;
+}
+
+bool ValueRecorder::RecordIndex::add(const std::string& topic, uint64_t time, uint64_t offset)
+{
+    ++fCounts[topic];
+    const bool checkpoint = checkpointDue(time);
+    if (fEmpty)
+    {
+        fEmpty = false;
+        fStartTime = time;
+        fEndTime = time;
+    }
+    // receive times of concurrent writers may be slightly out of order, the checkpoint times
+    // must not decrease
+    fEndTime = std::max(fEndTime, time);
+    if (checkpoint)
+    {
+        fTimes.push_back(fEndTime);
+        fOffsets.push_back(offset);
+        return fTimes.size() - fBlockStart >= INDEX_BLOCK_CHECKPOINTS;
+    }
+    return false;
+}
+
+std::shared_ptr<msg::RecordIndexBlock> ValueRecorder::RecordIndex::takeBlock(uint64_t blockOffset)
+{
+    auto block = std::make_shared<msg::RecordIndexBlock>();
+    block->previousBlock = fBlocks.empty() ? UINT64_MAX : fBlocks.back();
+    block->times.assign(fTimes.begin() + fBlockStart, fTimes.end());
+    block->offsets.assign(fOffsets.begin() + fBlockStart, fOffsets.end());
+    fBlockStart = fTimes.size();
+    fBlocks.push_back(blockOffset);
+    return block;
+}
+
+std::shared_ptr<msg::RecordFooter> ValueRecorder::RecordIndex::footer() const
+{
+    auto footer = std::make_shared<msg::RecordFooter>();
+    for (const auto& count : fCounts)
+    {
+        footer->topics.push_back(count.first);
+        footer->counts.push_back(count.second);
+    }
+    footer->startTime = fStartTime;
+    footer->endTime = fEndTime;
+    footer->times = fTimes;
+    footer->offsets = fOffsets;
+    footer->indexBlocks = fBlocks;
+    return footer;
+}
+
+constexpr size_t ValueRecorder::WorkerPool::REORDER_WINDOW;
+
+ValueRecorder::WorkerPool::WorkerPool(ValueRecorder& recorder, size_t count, CpuMask cpuAffinity)
+: fRecorder(recorder)
+, fSlots(REORDER_WINDOW)
+, fSlotReady(REORDER_WINDOW, false)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        fThreads.emplace_back([this, i, cpuAffinity] { run(i, cpuAffinity); });
+    }
+}
+
+ValueRecorder::WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        fStop = true;
+    }
+    fWork.notify_all();
+    for (auto& thread : fThreads)
+    {
+        thread.join();
+    }
+}
+
+void ValueRecorder::WorkerPool::begin(std::deque<QueueEntry>& batch, size_t queueSizeLimit)
+{
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        fBatch = &batch;
+        fQueueSizeLimit = queueSizeLimit;
+        fNext = 0;
+        fConsumed = 0;
+    }
+    fWork.notify_all();
+}
+
+ValueRecorder::Prepared& ValueRecorder::WorkerPool::wait(size_t index)
+{
+    const size_t slot = index % REORDER_WINDOW;
+    std::unique_lock<std::mutex> lk(fMutex);
+    fReady.wait(lk, [this, slot] { return fSlotReady[slot]; });
+    return fSlots[slot];
+}
+
+void ValueRecorder::WorkerPool::release(size_t index)
+{
+    bool windowFull;
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        fSlotReady[index % REORDER_WINDOW] = false;
+        fConsumed = index + 1;
+        windowFull = fNext == index + REORDER_WINDOW;
+    }
+    // only a worker waiting for the window to move on needs to be woken
+    if (windowFull)
+    {
+        fWork.notify_one();
+    }
+}
+
+void ValueRecorder::WorkerPool::end()
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    fBatch = nullptr;
+}
+
+void ValueRecorder::WorkerPool::run(size_t worker, CpuMask cpuAffinity)
+{
+    setThreadName(fmt::format("ValueRecorder{}", worker));
+    int result = setThreadCpuAffinity(pthread_self(), cpuAffinity);
+    if (result != 0)
+    {
+        std::cout << "ERROR: setting value recorder CPU affinity " << formatCpuMask(cpuAffinity)
+                  << ": " << strerror(result) << std::endl;
+    }
+    std::unique_lock<std::mutex> lk(fMutex);
+    while (true)
+    {
+        fWork.wait(lk, [this] {
+            return fStop || (fBatch != nullptr && fNext < fBatch->size()
+                && fNext < fConsumed + REORDER_WINDOW);
+        });
+        if (fStop)
+        {
+            return;
+        }
+        const size_t index = fNext++;
+        QueueEntry& qe = (*fBatch)[index];
+        Prepared& prepared = fSlots[index % REORDER_WINDOW];
+        const bool dropped = isDropped(
+            fBatch->size() - index, fQueueSizeLimit, fRecorder.fQueue->getPriority(*qe.topic));
+        lk.unlock();
+
+        if (dropped)
+        {
+            prepared.valid = false;
+        }
+        else
+        {
+            fRecorder.prepare(qe, prepared);
+        }
+
+        lk.lock();
+        fSlotReady[index % REORDER_WINDOW] = true;
+        fReady.notify_one();
+    }
+}
+
+ValueRecorder::Queue::Queue(const ValueStore& valueStore)
+: fHead(&fStub), fTail(&fStub), fMutex(), fValueStore(valueStore)
+{
+    fPriorities["/mcf/recorder/status"] = Priority::CRITICAL;
+}
+
+ValueRecorder::Queue::~Queue()
+{
+    while (Node* node = pop())
+    {
+        delete node;
+    }
+}
+
+void ValueRecorder::Queue::receive(const std::string& topic, ValuePtr& value) 
+{
+    receive(topic, value, 0);
+}
+
+void ValueRecorder::Queue::receive(const std::string& topic, ValuePtr& value, uint64_t seq)
+{
+    ChangeState* change = nullptr;
+    // topics without a policy cost a null check, or a lookup once any topic has one
+    if (const PolicyMap* policies = fPolicies.load(std::memory_order_acquire))
+    {
+        auto it = policies->find(topic);
+        if (it != policies->end())
+        {
+            if (!admit(*it->second, value))
+            {
+                return;
+            }
+            if (it->second->policy.mode == RecordPolicy::Mode::ON_CHANGE)
+            {
+                change = &it->second->change;
+            }
+        }
+    }
+    enqueue(topic, value, seq, std::chrono::high_resolution_clock::now(), change);
+}
+
+void ValueRecorder::Queue::enqueue(const std::string& topic, const ValuePtr& value, uint64_t seq,
+                                   std::chrono::high_resolution_clock::time_point time,
+                                   ChangeState* change)
+{
+    Node* node = new Node();
+    node->entry.time = time;
+    node->entry.value = value;
+    node->entry.seq = seq;
+    node->entry.topic = &topic;
+    node->entry.change = change;
+
+    // counted without a limit as well, see getWriteQueueBytes()
+    const auto* extMemValue = dynamic_cast<const IExtMemValue*>(value.get());
+    node->bytes = QUEUE_ENTRY_BYTES + (extMemValue != nullptr ? extMemValue->extMemSize() : 0);
+    const uint64_t limit = fByteLimit.load(std::memory_order_relaxed);
+    if (limit > 0)
+    {
+        const uint64_t queued = fQueuedBytes.load(std::memory_order_relaxed) + node->bytes;
+        // the priority is only looked up under pressure
+        if (isDropped(queued, limit, Priority::BULK) && isDropped(queued, limit, getPriority(topic)))
+        {
+            delete node;
+            fDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    fQueuedBytes.fetch_add(node->bytes, std::memory_order_relaxed);
+    push(node);
+
+    if (fWaiting.load())
+    {
+        // only signalled if the write thread waits, so that busy topics make no extra system calls
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+        fNotEmpty.notify_one();
+    }
+}
+
+void ValueRecorder::Queue::push(Node* node)
+{
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* previous = fHead.exchange(node);
+    previous->next.store(node, std::memory_order_release);
+}
+
+ValueRecorder::Queue::Node* ValueRecorder::Queue::pop()
+{
+    Node* tail = fTail.load(std::memory_order_relaxed);
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (tail == &fStub)
+    {
+        if (next == nullptr)
+        {
+            return nullptr;
+        }
+        fTail.store(next, std::memory_order_relaxed);
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr)
+    {
+        fTail.store(next, std::memory_order_release);
+        return tail;
+    }
+    if (tail != fHead.load())
+    {
+        // a producer has exchanged fHead, but not yet linked its node
+        return nullptr;
+    }
+    push(&fStub);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next != nullptr)
+    {
+        fTail.store(next, std::memory_order_release);
+        return tail;
+    }
+    return nullptr;
+}
+
+size_t ValueRecorder::Queue::popAll(std::deque<QueueEntry>& entries, std::chrono::milliseconds timeout)
+{
+    if (empty() && timeout.count() > 0)
+    {
+        // the condition variable uses the realtime clock
+        timespec ts {};
+        clock_gettime(CLOCK_REALTIME, &ts);
+        const auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+        const long long nsec = ts.tv_nsec + wait % 1'000'000'000LL;
+        ts.tv_sec += static_cast<time_t>(wait / 1'000'000'000LL + nsec / 1'000'000'000LL);
+        ts.tv_nsec = static_cast<long>(nsec % 1'000'000'000LL);
+
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+        // producers check fWaiting after pushing, so either they signal or empty() sees their value
+        fWaiting.store(true);
+        int rc = 0;
+        while (empty() && !fWakeUp && rc == 0)
+        {
+            rc = pthread_cond_timedwait(fNotEmpty.native_handle(), fMutex.native_handle(), &ts);
+        }
+        fWaiting.store(false);
+        fWakeUp = false;
+    }
+    uint64_t bytes = 0;
+    while (Node* node = pop())
+    {
+        entries.push_back(std::move(node->entry));
+        bytes += node->bytes;
+        delete node;
+    }
+    if (bytes > 0)
+    {
+        fQueuedBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+    if (entries.empty() && !empty())
+    {
+        // a producer was interrupted between its two steps
+        std::this_thread::yield();
+    }
+    return entries.size();
+}
+
+void ValueRecorder::Queue::wakeUp()
+{
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    // also effective if the write thread is about to wait
+    fWakeUp = true;
+    fNotEmpty.notify_all();
+}
+
+void ValueRecorder::Queue::setPolicy(const std::string& topic, const RecordPolicy& policy)
+{
+    std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fPolicyMutex);
+    const PolicyMap* current = fPolicies.load(std::memory_order_relaxed);
+    std::unique_ptr<PolicyMap> policies(current != nullptr ? new PolicyMap(*current) : new PolicyMap());
+    if (policy.mode == RecordPolicy::Mode::ALL)
+    {
+        policies->erase(topic);
+    }
+    else
+    {
+        (*policies)[topic] = std::make_shared<PolicyState>(policy);
+    }
+    fPolicies.store(policies->empty() ? nullptr : policies.get(), std::memory_order_release);
+    fPolicyMaps.push_back(std::move(policies));
+}
+
+void ValueRecorder::Queue::disableTopic(const std::string& topic)
+{
+    std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fPolicyMutex);
+    fDisabledTopics.insert(topic);
+}
+
+bool ValueRecorder::Queue::wantsTopic(const std::string& topic) const
+{
+    std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fPolicyMutex);
+    return fDisabledTopics.find(topic) == fDisabledTopics.end();
+}
+
+bool ValueRecorder::Queue::admit(PolicyState& state, const ValuePtr& value)
+{
+    switch (state.policy.mode)
+    {
+    case RecordPolicy::Mode::EVERY_NTH:
+        return state.count.fetch_add(1, std::memory_order_relaxed) % state.policy.n == 0;
+    case RecordPolicy::Mode::MAX_RATE:
+    {
+        const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t next = state.nextTimeNs.load(std::memory_order_relaxed);
+        // of concurrent publishers only one takes the slot
+        return now >= next
+            && state.nextTimeNs.compare_exchange_strong(
+                next, now + static_cast<int64_t>(1e9 / state.policy.rateHz),
+                std::memory_order_relaxed);
+    }
+    case RecordPolicy::Mode::ON_CHANGE:
+    {
+        // a value published again is unchanged, the content is compared by applyChangePolicies()
+        return std::atomic_exchange(&state.last, value) != value;
+    }
+    default:
+        return true;
+    }
+}
+
+void ValueRecorder::Queue::setPriority(const std::string& topic, Priority priority)
+{
+    std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fPriorityMutex);
+    fPriorities[topic] = priority;
+}
+
+ValueRecorder::Priority ValueRecorder::Queue::getPriority(const std::string& topic) const
+{
+    {
+        std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fPriorityMutex);
+        auto it = fPriorities.find(topic);
+        if (it != fPriorities.end())
+        {
+            return it->second;
+        }
+    }
+    // reliable topics of the QoS profiles are never dropped
+    const auto profile = fValueStore.getTopicQos().find(topic);
+    return profile != nullptr && profile->reliability == QosProfile::Reliability::RELIABLE
+        ? Priority::CRITICAL : Priority::NORMAL;
+}
+
+bool ValueRecorder::Queue::empty() const
+{
+    // the stub is the tail only when all nodes before it have been taken
+    return fTail.load(std::memory_order_acquire) == &fStub
+        && fStub.next.load(std::memory_order_acquire) == nullptr
+        && fHead.load() == &fStub;
+}
+
+ValueRecorder::SyncThread::SyncThread(IRecorderStorage& storage)
+: fStorage(storage)
+{
+    fThread = std::thread([this] { run(); });
+}
+
+ValueRecorder::SyncThread::~SyncThread()
+{
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        fStop = true;
+    }
+    fCondition.notify_all();
+    fThread.join();
+}
+
+bool ValueRecorder::SyncThread::request(uint64_t size)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    if (fRequested || fRunning)
+    {
+        return false;
+    }
+    fRequested = true;
+    fSize = size;
+    fCondition.notify_all();
+    return true;
+}
+
+void ValueRecorder::SyncThread::wait()
+{
+    std::unique_lock<std::mutex> lk(fMutex);
+    fCondition.wait(lk, [this] { return (!fRequested && !fRunning) || fStop; });
+}
+
+bool ValueRecorder::SyncThread::takeResult(uint64_t& syncedSize, int& error)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    if (!fCompleted)
+    {
+        return false;
+    }
+    fCompleted = false;
+    syncedSize = fSyncedSize;
+    error = fError;
+    return true;
+}
+
+void ValueRecorder::SyncThread::run()
+{
+    setThreadName("ValueRecorderS");
+    std::unique_lock<std::mutex> lk(fMutex);
+    while (!fStop)
+    {
+        if (!fRequested)
+        {
+            fCondition.wait(lk);
+            continue;
+        }
+        fRequested = false;
+        fRunning = true;
+        const uint64_t size = fSize;
+        lk.unlock();
+        const int error = fStorage.sync();
+        lk.lock();
+        fRunning = false;
+        fCompleted = true;
+        fSyncedSize = size;
+        fError = error;
+        fCondition.notify_all();
+    }
+}
+
+ValueRecorder::StatusMonitor::StatusMonitor(ValueStore& valueStore)
+: fValueStore(valueStore)
+{}
+
+void ValueRecorder::StatusMonitor::start() 
+{
+    fLastOutputTime = std::chrono::high_resolution_clock::now();
+    getrusage(RUSAGE_THREAD, &fResourceUsage);
+    initStatus();
+}
+
+void ValueRecorder::StatusMonitor::serializeBegin(
+        size_t queueSize,
+        std::chrono::high_resolution_clock::time_point& recordTime) 
+        {
+    unsigned long latency = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now()-recordTime).count();
+    fTotalLatency += latency;
+    fNumWrites += 1;
+    if (latency > fRecorderStatus.maxLatencyMs) 
+    {
+        fRecorderStatus.maxLatencyMs = latency;
+    }
+    fTotalQueueSize += queueSize;
+    if (queueSize > fRecorderStatus.maxQueueSize) 
+    {
+        fRecorderStatus.maxQueueSize = queueSize;
+    }
+}
+
+void ValueRecorder::StatusMonitor::reportWriteError(const std::string& error) 
+{
+    fRecorderStatus.errorFlag = true;
+    fRecorderStatus.errorDescs.insert(error);
+}
+
+
+void ValueRecorder::StatusMonitor::reportDropped(uint32_t count) 
+{
+    fRecorderStatus.dropFlag = true;
+    // counter is not increased beyond UINT_MAX
+    fDropCount += std::min(count, UINT_MAX - fDropCount);
 }
 
 void ValueRecorder::StatusMonitor::initStatus() 
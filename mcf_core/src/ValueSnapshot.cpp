@@ -0,0 +1,269 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/ValueSnapshot.h"
+
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/LazyValue.h"
+#include "mcf_core/LoggingMacros.h"
+#include "mcf_core/ThreadName.h"
+#include "mcf_core/ValueStore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mcf {
+
+namespace {
+
+constexpr size_t MAGIC_SIZE = 8;
+
+struct Header {
+    char magic[MAGIC_SIZE];
+    /// bytes of the records following the header
+    uint64_t size;
+    /// time of the snapshot, microseconds since epoch
+    int64_t timeUs;
+};
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Write header and records to a file through a memory mapping
+ *
+ * @return 0 or the errno of the failed call
+ */
+int writeMapped(const std::string& file, const Header& header, const msgpack::sbuffer& records) {
+    const int fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return errno;
+    }
+    const size_t size = sizeof(Header) + records.size();
+    int result = 0;
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        result = errno;
+    }
+    else {
+        void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            result = errno;
+        }
+        else {
+            std::memcpy(mapping, &header, sizeof(Header));
+            if (records.size() > 0) {
+                std::memcpy(static_cast<char*>(mapping) + sizeof(Header), records.data(), records.size());
+            }
+            ::munmap(mapping, size);
+        }
+    }
+    ::close(fd);
+    return result;
+}
+
+} // anonymous namespace
+
+constexpr const char* ValueSnapshot::MAGIC;
+
+ValueSnapshot::ValueSnapshot(ValueStore& valueStore, const ValueSnapshotConfig& config)
+: fValueStore(valueStore)
+, fConfig(config) {
+    MCF_ASSERT(!fConfig.file.empty(), "Value snapshot requires a file");
+}
+
+ValueSnapshot::~ValueSnapshot() {
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        fStopRequest = true;
+    }
+    fCv.notify_all();
+    if (fThread.joinable()) {
+        fThread.join();
+    }
+}
+
+std::vector<std::string> ValueSnapshot::selectedTopics() const {
+    std::vector<std::string> topics;
+    for (const auto& topic : fValueStore.getKeys()) {
+        const bool selected = std::any_of(fConfig.topics.begin(), fConfig.topics.end(),
+            [&topic](const std::string& pattern) { return ValueStore::matchesPattern(pattern, topic); });
+        if (selected) {
+            topics.push_back(topic);
+        }
+    }
+    return topics;
+}
+
+size_t ValueSnapshot::write() {
+    msgpack::sbuffer records;
+    msgpack::packer<msgpack::sbuffer> packer(records);
+    size_t count = 0;
+    for (const auto& topic : selectedTopics()) {
+        if (!fValueStore.hasValue(topic)) {
+            continue;
+        }
+        const ValuePtr value = decodedValue(fValueStore.getValue<Value>(topic));
+        if (value == nullptr) {
+            continue;
+        }
+        const TypeRegistry::TypemapEntry* typeInfo = fValueStore.findTypeInfo(*value);
+        if (typeInfo == nullptr) {
+            MCF_WARN_NOFILELINE("Value snapshot: type of the value of {} is not registered, skipped", topic);
+            continue;
+        }
+        packer.pack_array(4);
+        packer.pack(topic);
+        packer.pack(typeInfo->id);
+        const void* ptr = nullptr;
+        size_t len = 0;
+        TypeRegistry::packValue(records, value, *typeInfo, ptr, len, true);
+        packer.pack_bin(static_cast<uint32_t>(len));
+        if (len > 0) {
+            packer.pack_bin_body(static_cast<const char*>(ptr), static_cast<uint32_t>(len));
+        }
+        ++count;
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, MAGIC_SIZE);
+    header.size = records.size();
+    header.timeUs = nowUs();
+
+    // the previous snapshot is only replaced by a complete one
+    const std::string tmpFile = fConfig.file + ".tmp";
+    std::lock_guard<std::mutex> lk(fWriteMutex);
+    int result = writeMapped(tmpFile, header, records);
+    if (result == 0 && std::rename(tmpFile.c_str(), fConfig.file.c_str()) != 0) {
+        result = errno;
+    }
+    if (result != 0) {
+        MCF_ERROR_NOFILELINE("Value snapshot: cannot write {}: {}", fConfig.file, std::strerror(result));
+        ::unlink(tmpFile.c_str());
+        return 0;
+    }
+    return count;
+}
+
+size_t ValueSnapshot::restore() {
+    const int fd = ::open(fConfig.file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            MCF_WARN_NOFILELINE("Value snapshot: cannot open {}: {}", fConfig.file, std::strerror(errno));
+        }
+        return 0;
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(Header)) {
+        MCF_WARN_NOFILELINE("Value snapshot: {} is no snapshot, not restored", fConfig.file);
+        ::close(fd);
+        return 0;
+    }
+    const size_t size = static_cast<size_t>(status.st_size);
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        MCF_WARN_NOFILELINE("Value snapshot: cannot map {}: {}", fConfig.file, std::strerror(errno));
+        return 0;
+    }
+    std::shared_ptr<void> unmap(mapping, [size](void* ptr) { ::munmap(ptr, size); });
+
+    Header header;
+    std::memcpy(&header, mapping, sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, MAGIC_SIZE) != 0 || header.size != size - sizeof(Header)) {
+        MCF_WARN_NOFILELINE("Value snapshot: {} is no snapshot or incomplete, not restored", fConfig.file);
+        return 0;
+    }
+    const auto age = std::chrono::microseconds(nowUs() - header.timeUs);
+    if (fConfig.maxAge.count() > 0 && age > fConfig.maxAge) {
+        MCF_INFO_NOFILELINE("Value snapshot: {} is {} ms old, not restored", fConfig.file,
+            std::chrono::duration_cast<std::chrono::milliseconds>(age).count());
+        return 0;
+    }
+
+    const char* records = static_cast<const char*>(mapping) + sizeof(Header);
+    size_t offset = 0;
+    size_t count = 0;
+    try {
+        while (offset < header.size) {
+            msgpack::object_handle handle = msgpack::unpack(records, header.size, offset);
+            const msgpack::object& record = handle.get();
+            if (record.type != msgpack::type::ARRAY || record.via.array.size != 4) {
+                MCF_WARN_NOFILELINE("Value snapshot: invalid record in {}, restore stopped", fConfig.file);
+                break;
+            }
+            const std::string topic = record.via.array.ptr[0].as<std::string>();
+            const std::string typeId = record.via.array.ptr[1].as<std::string>();
+            const msgpack::object& extMem = record.via.array.ptr[3];
+            if (extMem.type != msgpack::type::BIN) {
+                MCF_WARN_NOFILELINE("Value snapshot: invalid record in {}, restore stopped", fConfig.file);
+                break;
+            }
+            const auto* typeInfo = fValueStore.findTypeInfo(typeId);
+            if (typeInfo == nullptr) {
+                MCF_WARN_NOFILELINE("Value snapshot: type {} of {} is not registered, not restored", typeId, topic);
+                continue;
+            }
+            if (fValueStore.hasValue(topic)) {
+                // a live value arrived first
+                continue;
+            }
+            bool isExtMem = false;
+            ValuePtr value = TypeRegistry::unpackSharedValue(*typeInfo, record.via.array.ptr[2],
+                extMem.via.bin.ptr, extMem.via.bin.size, isExtMem);
+            if (value != nullptr && fValueStore.setValue(topic, value, false) == 0) {
+                ++count;
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        MCF_WARN_NOFILELINE("Value snapshot: cannot read {}: {}", fConfig.file, e.what());
+    }
+    MCF_INFO_NOFILELINE("Value snapshot: restored {} values from {} ({} ms old)", count, fConfig.file,
+        std::chrono::duration_cast<std::chrono::milliseconds>(age).count());
+    return count;
+}
+
+void ValueSnapshot::start() {
+    std::lock_guard<std::mutex> lk(fMutex);
+    if (fConfig.interval.count() <= 0 || fThread.joinable()) {
+        return;
+    }
+    fStopRequest = false;
+    fThread = std::thread([this] { run(); });
+}
+
+void ValueSnapshot::stop() {
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        fStopRequest = true;
+    }
+    fCv.notify_all();
+    if (fThread.joinable()) {
+        fThread.join();
+    }
+    write();
+}
+
+void ValueSnapshot::run() {
+    setThreadName("ValueSnapshot");
+    std::unique_lock<std::mutex> lk(fMutex);
+    while (!fStopRequest) {
+        if (fCv.wait_for(lk, fConfig.interval, [this] { return fStopRequest; })) {
+            break;
+        }
+        lk.unlock();
+        write();
+        lk.lock();
+    }
+}
+
+} // namespace mcf
@@ -7,15 +7,22 @@
 #include "mcf_core/ValueStore.h"
 
 #include "msgpack.hpp"
+#include "spdlog/fmt/fmt.h"
 
 #include <algorithm>
 #include <cerrno>
+#include <cmath>
 #include <condition_variable>
 #include <ctime>
 #include <deque>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace mcf {
@@ -23,42 +30,75 @@ namespace mcf {
 namespace
 {
 
-void waitBlockedReceivers(std::vector<std::weak_ptr<IValueReceiver>> &receivers,
-                          const std::string &key,
-                          const std::function<bool()>& checkAbort)
+using ReceiverList = ValueStore::ReceiverList;
+using ReceiverListPtr = ValueStore::ReceiverListPtr;
+
+/*
+ * Park on the first receiver blocking the topic until it unblocks. Returns false, if no
+ * receiver is blocking. The caller re-checks all receivers afterwards, since others may have
+ * become blocked in the meantime.
+ */
+bool waitBlockedReceiver(const ReceiverList& receivers,
+                         const std::string &key,
+                         const std::function<bool()>& checkAbort,
+                         std::chrono::steady_clock::time_point deadline)
+{
+    for (const auto &receiver : receivers)
+    {
+        auto sp_receiver = receiver.lock();
+        if (sp_receiver != nullptr && sp_receiver->isBlocked(key))
+        {
+            sp_receiver->waitBlocked(key, checkAbort, deadline);
+            return true;
+        }
+    }
+    return false;
+}
+
+void wakeReceivers(const ReceiverList& receivers)
 {
     for (const auto &receiver : receivers)
     {
         auto sp_receiver = receiver.lock();
         if (sp_receiver != nullptr)
         {
-            sp_receiver->waitBlocked(key, checkAbort);
+            sp_receiver->wakeBlocked();
         }
     }
 }
 
+/*
+ * Publish a copy of the receiver list without expired weak pointers,
+ * unless the list has been replaced in the meantime.
+ */
+void cleanupReceivers(ReceiverListPtr& receivers, ReceiverListPtr snapshot) {
+    auto cleaned = std::make_shared<ReceiverList>();
+    cleaned->reserve(snapshot->size());
+    std::copy_if(snapshot->begin(), snapshot->end(), std::back_inserter(*cleaned),
+                 [](const std::weak_ptr<IValueReceiver>& ptr){ return !ptr.expired(); });
+    std::atomic_compare_exchange_strong(&receivers, &snapshot, ReceiverListPtr(std::move(cleaned)));
+}
+
 // TODO: shouldn't ValuePtr become a const reference? => need to adapt receiver API
-void notifyReceiversAndCleanup(std::vector<std::weak_ptr<IValueReceiver>>& receivers,
-                               const std::string& key, ValuePtr vp) {
+void notifyReceiversAndCleanup(ReceiverListPtr& receivers, const std::string& key, ValuePtr vp,
+                               uint64_t seq) {
+    const ReceiverListPtr snapshot = std::atomic_load(&receivers);
     bool found_expired = false;
-    for (const auto& receiver : receivers) {
+    for (const auto& receiver : *snapshot) {
         auto sp_receiver = receiver.lock();
         if (sp_receiver != nullptr) {
-            sp_receiver->receive(key, vp);
+            sp_receiver->receive(key, vp, seq);
         }
         else {
             found_expired = true;
         }
     }
-    // cleanup expired weak pointers
     if (found_expired) {
-        receivers.erase(std::remove_if(receivers.begin(), receivers.end(),
-                                       [](const std::weak_ptr<IValueReceiver>& ptr){return ptr.expired();}), receivers.end());
+        cleanupReceivers(receivers, snapshot);
     }
 }
 
-bool isAnyReceiverBlocked(std::vector<std::weak_ptr<IValueReceiver>>& receivers,
-                                      const std::string& key) {
+bool isAnyReceiverBlocked(const ReceiverList& receivers, const std::string& key) {
     for (const auto& receiver : receivers) {
         auto sp_receiver = receiver.lock();
         if (sp_receiver != nullptr) {
@@ -70,6 +110,89 @@ bool isAnyReceiverBlocked(std::vector<std::weak_ptr<IValueReceiver>>& receivers,
     return false;
 }
 
+/*
+ * Copy-on-write update of a receiver list, the caller must serialize updates by holding
+ * the value store mutex. Expired weak pointers are dropped from the new list.
+ */
+void addToReceivers(ReceiverListPtr& receivers, const std::shared_ptr<IValueReceiver>& receiver) {
+    const ReceiverListPtr snapshot = std::atomic_load(&receivers);
+    auto it = std::find_if(snapshot->begin(), snapshot->end(),
+                           [&receiver](const std::weak_ptr<IValueReceiver>& e){ return e.lock() == receiver;});
+    if (it == snapshot->end()) {
+        auto updated = std::make_shared<ReceiverList>();
+        updated->reserve(snapshot->size() + 1);
+        std::copy_if(snapshot->begin(), snapshot->end(), std::back_inserter(*updated),
+                     [](const std::weak_ptr<IValueReceiver>& ptr){ return !ptr.expired(); });
+        updated->push_back(receiver);
+        std::atomic_store(&receivers, ReceiverListPtr(std::move(updated)));
+    }
+}
+
+void removeFromReceivers(ReceiverListPtr& receivers, const std::shared_ptr<IValueReceiver>& receiver) {
+    const ReceiverListPtr snapshot = std::atomic_load(&receivers);
+    auto updated = std::make_shared<ReceiverList>();
+    updated->reserve(snapshot->size());
+    std::copy_if(snapshot->begin(), snapshot->end(), std::back_inserter(*updated),
+                 [&receiver](const std::weak_ptr<IValueReceiver>& e){ auto sp = e.lock(); return sp != nullptr && sp != receiver;});
+    std::atomic_store(&receivers, ReceiverListPtr(std::move(updated)));
+}
+
+uint64_t nanosecondsBetween(std::chrono::high_resolution_clock::time_point start,
+                            std::chrono::high_resolution_clock::time_point end) {
+    // the high resolution clock is not guaranteed to be steady
+    if (end < start) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+uint64_t microsecondsSinceEpoch() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Locks the entries of a value batch in the order given and unlocks them in reverse order,
+ * so that the scheduling class of a thread holding priority ceiling mutexes is restored last.
+ */
+class EntryLocks {
+public:
+    explicit EntryLocks(std::vector<ValueStore::MapEntry*> entries)
+    : fEntries(std::move(entries))
+    {
+        lock();
+    }
+
+    ~EntryLocks() {
+        if (fLocked) {
+            unlock();
+        }
+    }
+
+    void lock() {
+        for (auto* entry : fEntries) {
+            entry->mutex.lock();
+        }
+        fLocked = true;
+    }
+
+    void unlock() {
+        for (auto it = fEntries.rbegin(); it != fEntries.rend(); ++it) {
+            (*it)->mutex.unlock();
+        }
+        fLocked = false;
+    }
+
+private:
+    std::vector<ValueStore::MapEntry*> fEntries;
+    bool fLocked = false;
+};
+
+int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 } // anonymous namespace
 
 
@@ -77,16 +200,48 @@ const char* QueueEmptyException::what() const noexcept {
     return "queue empty";
 }
 
+constexpr std::chrono::milliseconds ValueQueue::ABORT_POLL_INTERVAL;
+constexpr size_t ValueQueue::MAX_LENGTH_DECISIONS;
+
+ValueQueue::ValueQueue(int maxLength, bool blocking, Storage storage)
+    : fMaxLength(maxLength),
+      fBlocking(blocking),
+      fStorage(storage)
+{
+    if (fStorage == Storage::RING_BUFFER) {
+        MCF_ASSERT(fMaxLength > 0, "Ring buffer value queue requires a maximum length > 0");
+        resizeRingUnlocked(fMaxLength);
+    }
+    MCF_ASSERT(fStorage != Storage::CONFLATING, "Conflating value queue requires a conflation key");
+}
+
+ValueQueue::ValueQueue(ConflationKey conflationKey, int maxLength, bool blocking)
+    : fMaxLength(maxLength),
+      fBlocking(blocking),
+      fStorage(Storage::CONFLATING),
+      fConflationKey(std::move(conflationKey))
+{
+    MCF_ASSERT(fConflationKey, "Conflating value queue requires a conflation key");
+}
+
+ValueQueue::~ValueQueue()
+{
+    // release the logical times of the stamped values
+    while (fStamped > 0 && sizeUnlocked() > 0) {
+        popFrontUnlocked();
+    }
+}
+
 bool ValueQueue::empty()
 {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    return fQueue.empty();
+    return !frontVisibleUnlocked();
 }
 
 std::size_t ValueQueue::size()
 {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    return fQueue.size();
+    return visibleSizeUnlocked();
 }
 
 bool ValueQueue::getBlocking()
@@ -109,50 +264,530 @@ size_t ValueQueue::getMaxLength()
 
 void ValueQueue::setMaxLength(size_t maxLength) {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    setMaxLengthUnlocked(maxLength);
+}
+
+void ValueQueue::setMaxLengthUnlocked(size_t maxLength) {
+    if (fStorage == Storage::RING_BUFFER) {
+        MCF_ASSERT(maxLength > 0, "Ring buffer value queue requires a maximum length > 0");
+    }
     fMaxLength = maxLength;
-    while (fMaxLength > 0 && fQueue.size() > fMaxLength) {
-        fQueue.pop_front();
+    while (fMaxLength > 0 && sizeUnlocked() > fMaxLength) {
+        popFrontUnlocked();
+        ++fDropped;
+    }
+    if (fStorage == Storage::RING_BUFFER) {
+        resizeRingUnlocked(fMaxLength);
     }
     fUnblockCv.notify_all();
 }
 
 void ValueQueue::receive(const std::string& topic, ValuePtr& value)  {
+    receive(topic, value, 0);
+}
+
+void ValueQueue::receive(const std::string& topic, ValuePtr& value, uint64_t seq)  {
+    LogicalClock::Stamp stamp = LogicalClock::current();
+    if (stamp) {
+        // held until the value is popped
+        stamp.clock->hold(stamp.time);
+    }
+    if (fStorage == Storage::CONFLATING) {
+        // user code, called before locking
+        const uint64_t key = value ? fConflationKey(*value) : 0;
+        std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+        countGapsUnlocked(topic, seq);
+        conflateUnlocked(topic, value, key, seq, std::move(stamp));
+        countReceivedUnlocked();
+        notifyTriggers();
+        return;
+    }
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    if (fMaxLength > 0 && fQueue.size() >= fMaxLength) {
-        fQueue.pop_front();
+    countGapsUnlocked(topic, seq);
+    if (fMaxLength > 0 && sizeUnlocked() >= fMaxLength) {
+        popFrontUnlocked();
+        ++fDropped;
     }
-    fQueue.emplace_back(value, topic);
+    pushBackUnlocked(topic, value, seq, std::move(stamp));
+    countReceivedUnlocked();
     notifyTriggers();
 }
 
+void ValueQueue::countGapsUnlocked(const std::string& topic, uint64_t seq) {
+    if (seq == 0) {
+        return;
+    }
+    if (fLastSeq == nullptr || fLastSeq->first != topic) {
+        // nodes of the map are stable, so the cached entry survives later insertions
+        fLastSeq = &*fLastSeqs.emplace(topic, 0).first;
+    }
+    if (fLastSeq->second != 0 && seq > fLastSeq->second + 1) {
+        fGaps += seq - fLastSeq->second - 1;
+    }
+    fLastSeq->second = seq;
+}
+
+uint64_t ValueQueue::peekSequence() {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    return frontVisibleUnlocked() ? frontSequenceUnlocked() : 0;
+}
+
+uint64_t ValueQueue::getGaps() {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    return fGaps;
+}
+
+uint64_t ValueQueue::getDropped() {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    return fDropped;
+}
+
+void ValueQueue::enableAdaptiveLength(const AdaptiveLength& adaptive) {
+    MCF_ASSERT(adaptive.minLength > 0 && adaptive.minLength <= adaptive.maxLength,
+               fmt::format("Adaptive queue length bounds {}-{} are invalid", adaptive.minLength, adaptive.maxLength));
+    MCF_ASSERT(adaptive.targetDropRate >= 0.0 && adaptive.targetDropRate <= 1.0,
+               fmt::format("Adaptive queue target drop rate {} is not within 0-1", adaptive.targetDropRate));
+    MCF_ASSERT(adaptive.window.count() > 0, "Adaptive queue window must be positive");
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    fAdaptive = true;
+    fAdaptiveLength = adaptive;
+    const size_t length = fMaxLength == 0 ? adaptive.maxLength : fMaxLength;
+    setMaxLengthUnlocked(std::min(std::max(length, adaptive.minLength), adaptive.maxLength));
+    fWindow = {};
+    fWindow.startNs = steadyNowNs();
+    fWindow.droppedAtStart = fDropped;
+}
+
+void ValueQueue::disableAdaptiveLength() {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    fAdaptive = false;
+}
+
+std::vector<ValueQueue::LengthDecision> ValueQueue::takeLengthDecisions() {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    std::vector<LengthDecision> decisions(fLengthDecisions.begin(), fLengthDecisions.end());
+    fLengthDecisions.clear();
+    return decisions;
+}
+
+void ValueQueue::countReceivedUnlocked() {
+    if (!fAdaptive) {
+        return;
+    }
+    ++fWindow.received;
+    const size_t size = sizeUnlocked();
+    fWindow.peakSize = std::max(fWindow.peakSize, size);
+    if (fBlocking && fMaxLength > 0 && size >= fMaxLength) {
+        ++fWindow.full;
+    }
+    const int64_t nowNs = steadyNowNs();
+    if (nowNs - fWindow.startNs >= std::chrono::nanoseconds(fAdaptiveLength.window).count()) {
+        adaptLengthUnlocked(nowNs);
+    }
+}
+
+void ValueQueue::countPoppedUnlocked(size_t count) {
+    if (fAdaptive) {
+        fWindow.popped += count;
+        // the front value waited longest
+        fWindow.maxWaitNs = std::max(fWindow.maxWaitNs, steadyNowNs() - frontReceivedUnlocked());
+    }
+}
+
+void ValueQueue::adaptLengthUnlocked(int64_t nowNs) {
+    const double seconds = static_cast<double>(nowNs - fWindow.startNs) / 1e9;
+    const uint64_t dropped = fDropped - fWindow.droppedAtStart;
+    LengthDecision decision;
+    decision.previousLength = fMaxLength;
+    decision.arrivalRate = static_cast<double>(fWindow.received) / seconds;
+    decision.serviceRate = static_cast<double>(fWindow.popped) / seconds;
+    decision.dropRate = fWindow.received == 0
+        ? 0.0 : static_cast<double>(dropped + fWindow.full) / static_cast<double>(fWindow.received);
+    decision.maxWait = std::chrono::nanoseconds(fWindow.maxWaitNs);
+
+    const AdaptiveLength& adaptive = fAdaptiveLength;
+    // the longest queue the consumer works off within the target latency
+    size_t latencyLength = adaptive.maxLength;
+    if (adaptive.targetLatency.count() > 0) {
+        const double worked = decision.serviceRate * static_cast<double>(adaptive.targetLatency.count()) / 1e9;
+        latencyLength = static_cast<size_t>(std::min(worked, static_cast<double>(adaptive.maxLength)));
+    }
+    latencyLength = std::max(latencyLength, adaptive.minLength);
+
+    size_t length = fMaxLength;
+    if (adaptive.targetLatency.count() > 0 && decision.maxWait > adaptive.targetLatency) {
+        length = std::min(length, latencyLength);
+    }
+    else if (decision.dropRate > adaptive.targetDropRate) {
+        length = std::min(length * 2, latencyLength);
+    }
+    else if (fWindow.peakSize * 4 <= length) {
+        length = length - (length - fWindow.peakSize) / 2;
+    }
+    length = std::min(std::max(length, adaptive.minLength), adaptive.maxLength);
+
+    if (length != fMaxLength) {
+        setMaxLengthUnlocked(length);
+        decision.length = length;
+        fLengthDecisions.push_back(decision);
+        if (fLengthDecisions.size() > MAX_LENGTH_DECISIONS) {
+            fLengthDecisions.pop_front();
+        }
+    }
+    fWindow = {};
+    fWindow.startNs = nowNs;
+    fWindow.droppedAtStart = fDropped;
+}
+
+size_t ValueQueue::sizeUnlocked() const {
+    switch (fStorage) {
+    case Storage::RING_BUFFER:
+        return fRingCount;
+    case Storage::CONFLATING:
+        return fConflatedIndex.size();
+    default:
+        return fQueue.size();
+    }
+}
+
+const ValuePtr& ValueQueue::frontValueUnlocked() const {
+    switch (fStorage) {
+    case Storage::RING_BUFFER:
+        return fRing[fRingHead].value;
+    case Storage::CONFLATING:
+        return fConflated.front().value;
+    default:
+        return std::get<0>(fQueue.front());
+    }
+}
+
+const std::string& ValueQueue::frontTopicUnlocked() const {
+    switch (fStorage) {
+    case Storage::RING_BUFFER:
+        return fTopics[fRing[fRingHead].topicId];
+    case Storage::CONFLATING:
+        return fTopics[fConflated.front().topicId];
+    default:
+        return std::get<1>(fQueue.front());
+    }
+}
+
+int64_t ValueQueue::frontReceivedUnlocked() const {
+    switch (fStorage) {
+    case Storage::RING_BUFFER:
+        return fRing[fRingHead].received;
+    case Storage::CONFLATING:
+        return fConflated.front().received;
+    default:
+        return std::get<2>(fQueue.front());
+    }
+}
+
+const LogicalClock::Stamp& ValueQueue::frontStampUnlocked() const {
+    switch (fStorage) {
+    case Storage::RING_BUFFER:
+        return fRing[fRingHead].stamp;
+    case Storage::CONFLATING:
+        return fConflated.front().stamp;
+    default:
+        return std::get<3>(fQueue.front());
+    }
+}
+
+uint64_t ValueQueue::frontSequenceUnlocked() const {
+    switch (fStorage) {
+    case Storage::RING_BUFFER:
+        return fRing[fRingHead].seq;
+    case Storage::CONFLATING:
+        return fConflated.front().seq;
+    default:
+        return std::get<4>(fQueue.front());
+    }
+}
+
+bool ValueQueue::frontStamp(LogicalClock::Stamp& stamp) {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    if (sizeUnlocked() == 0 || !frontStampUnlocked()) {
+        return false;
+    }
+    stamp = frontStampUnlocked();
+    return true;
+}
+
+void ValueQueue::copyValues(std::vector<ValuePtr>& values) {
+    // reserved outside of the lock, the queue may have grown since
+    values.reserve(values.size() + size());
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    switch (fStorage) {
+    case Storage::RING_BUFFER:
+        for (size_t i = 0; i < fRingCount; ++i) {
+            values.push_back(fRing[(fRingHead + i) % fRing.size()].value);
+        }
+        break;
+    case Storage::CONFLATING:
+        for (const auto& entry : fConflated) {
+            values.push_back(entry.value);
+        }
+        break;
+    default:
+        for (const auto& entry : fQueue) {
+            values.push_back(std::get<0>(entry));
+        }
+    }
+}
+
+bool ValueQueue::frontVisibleUnlocked() const {
+    if (sizeUnlocked() == 0) {
+        return false;
+    }
+    const LogicalClock::Stamp& stamp = frontStampUnlocked();
+    return !stamp || stamp.clock->isSafe(stamp.time);
+}
+
+size_t ValueQueue::visibleSizeUnlocked() const {
+    if (fStamped == 0) {
+        return sizeUnlocked();
+    }
+    // stamped values are ordered by logical time, so the visible ones are at the front
+    size_t visible = 0;
+    auto isVisible = [&visible](const LogicalClock::Stamp& stamp) {
+        if (stamp && !stamp.clock->isSafe(stamp.time)) {
+            return false;
+        }
+        ++visible;
+        return true;
+    };
+    switch (fStorage) {
+    case Storage::RING_BUFFER:
+        for (size_t i = 0; i < fRingCount && isVisible(fRing[(fRingHead + i) % fRing.size()].stamp); ++i) {
+        }
+        break;
+    case Storage::CONFLATING:
+        for (auto it = fConflated.begin(); it != fConflated.end() && isVisible(it->stamp); ++it) {
+        }
+        break;
+    default:
+        for (auto it = fQueue.begin(); it != fQueue.end() && isVisible(std::get<3>(*it)); ++it) {
+        }
+        break;
+    }
+    return visible;
+}
+
+std::chrono::nanoseconds ValueQueue::getAge() {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    if (sizeUnlocked() == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::nanoseconds(std::max<int64_t>(0, steadyNowNs() - frontReceivedUnlocked()));
+}
+
+size_t ValueQueue::dropOlderThan(std::chrono::nanoseconds minAge, size_t keep) {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    const int64_t limit = steadyNowNs() - minAge.count();
+    size_t dropped = 0;
+    while (sizeUnlocked() > keep && frontReceivedUnlocked() <= limit) {
+        popFrontUnlocked();
+        ++dropped;
+    }
+    fDropped += dropped;
+    if (dropped > 0) {
+        fUnblockCv.notify_all();
+    }
+    return dropped;
+}
+
+void ValueQueue::popFrontUnlocked() {
+    LogicalClock::Stamp stamp;
+    switch (fStorage) {
+    case Storage::RING_BUFFER:
+        fRing[fRingHead].value.reset();
+        stamp = std::move(fRing[fRingHead].stamp);
+        fRing[fRingHead].stamp = LogicalClock::Stamp();
+        fRingHead = (fRingHead + 1) % fRing.size();
+        --fRingCount;
+        break;
+    case Storage::CONFLATING:
+        fConflatedIndex.erase(fConflated.front().key);
+        fConflated.front().value.reset();
+        stamp = std::move(fConflated.front().stamp);
+        fConflated.front().stamp = LogicalClock::Stamp();
+        fConflatedFree.splice(fConflatedFree.begin(), fConflated, fConflated.begin());
+        break;
+    default:
+        stamp = std::move(std::get<3>(fQueue.front()));
+        fQueue.pop_front();
+        break;
+    }
+    if (stamp) {
+        --fStamped;
+        stamp.clock->release(stamp.time);
+    }
+}
+
+namespace {
+
+/*
+ * Whether a stamped value is queued before another one, unstamped values keep their position
+ */
+bool stampedBefore(const LogicalClock::Stamp& stamp, const std::string& topic,
+                   const LogicalClock::Stamp& other, const std::string& otherTopic) {
+    if (!stamp || !other) {
+        return false;
+    }
+    return stamp.time < other.time || (stamp.time == other.time && topic < otherTopic);
+}
+
+} // anonymous namespace
+
+void ValueQueue::pushBackUnlocked(const std::string& topic, const ValuePtr& value, uint64_t seq,
+                                  LogicalClock::Stamp stamp) {
+    const bool stamped = static_cast<bool>(stamp);
+    if (fStorage == Storage::RING_BUFFER) {
+        size_t index = fRingCount;
+        auto at = [this](size_t i) -> RingEntry& { return fRing[(fRingHead + i) % fRing.size()]; };
+        auto& slot = at(index);
+        slot.value = value;
+        slot.topicId = internTopicUnlocked(topic);
+        slot.received = steadyNowNs();
+        slot.stamp = std::move(stamp);
+        slot.seq = seq;
+        ++fRingCount;
+        // values arrive almost in order, so only few entries are moved
+        while (index > 0 && stampedBefore(at(index).stamp, fTopics[at(index).topicId],
+                                          at(index - 1).stamp, fTopics[at(index - 1).topicId])) {
+            std::swap(at(index), at(index - 1));
+            --index;
+        }
+    }
+    else {
+        auto position = fQueue.end();
+        while (position != fQueue.begin()) {
+            const auto& previous = *std::prev(position);
+            if (!stampedBefore(stamp, topic, std::get<3>(previous), std::get<1>(previous))) {
+                break;
+            }
+            --position;
+        }
+        fQueue.emplace(position, value, topic, steadyNowNs(), std::move(stamp), seq);
+    }
+    if (stamped) {
+        ++fStamped;
+    }
+}
+
+size_t ValueQueue::internTopicUnlocked(const std::string& topic) {
+    // a queue usually receives from very few topics, so a linear search is sufficient
+    auto it = std::find(fTopics.begin(), fTopics.end(), topic);
+    size_t topicId = it - fTopics.begin();
+    if (it == fTopics.end()) {
+        fTopics.push_back(topic);
+    }
+    return topicId;
+}
+
+void ValueQueue::conflateUnlocked(const std::string& topic, const ValuePtr& value, uint64_t key,
+                                  uint64_t seq, LogicalClock::Stamp stamp) {
+    const size_t topicId = internTopicUnlocked(topic);
+    auto indexed = fConflatedIndex.find(key);
+    if (indexed != fConflatedIndex.end()) {
+        const auto entry = indexed->second;
+        entry->value = value;
+        entry->topicId = topicId;
+        entry->seq = seq;
+        // the replaced value keeps the earlier logical time of both
+        auto& queued = entry->stamp;
+        if (stamp && !queued) {
+            queued = std::move(stamp);
+            ++fStamped;
+        }
+        else if (stamp) {
+            if (stamp.time < queued.time) {
+                std::swap(stamp, queued);
+            }
+            stamp.clock->release(stamp.time);
+        }
+        // the entry keeps its place only if its logical time and topic still fit there
+        auto isBefore = [this](ConflatedList::const_iterator a, ConflatedList::const_iterator b) {
+            return stampedBefore(a->stamp, fTopics[a->topicId], b->stamp, fTopics[b->topicId]);
+        };
+        auto position = entry;
+        while (position != fConflated.begin() && isBefore(entry, std::prev(position))) {
+            --position;
+        }
+        if (position == entry) {
+            position = std::next(entry);
+            while (position != fConflated.end() && isBefore(position, entry)) {
+                ++position;
+            }
+        }
+        fConflated.splice(position, fConflated, entry);
+        return;
+    }
+    if (fMaxLength > 0 && sizeUnlocked() >= fMaxLength) {
+        popFrontUnlocked();
+    }
+    auto position = fConflated.end();
+    while (position != fConflated.begin() &&
+           stampedBefore(stamp, topic, std::prev(position)->stamp, fTopics[std::prev(position)->topicId])) {
+        --position;
+    }
+    if (fConflatedFree.empty()) {
+        fConflatedFree.emplace_back();
+    }
+    fConflated.splice(position, fConflatedFree, fConflatedFree.begin());
+    auto entry = std::prev(position);
+    entry->value = value;
+    entry->topicId = topicId;
+    entry->key = key;
+    entry->received = steadyNowNs();
+    entry->seq = seq;
+    if (stamp) {
+        ++fStamped;
+    }
+    entry->stamp = std::move(stamp);
+    fConflatedIndex.emplace(key, entry);
+}
+
+void ValueQueue::resizeRingUnlocked(size_t capacity) {
+    std::vector<RingEntry> ring(capacity);
+    for (size_t i = 0; i < fRingCount; ++i) {
+        ring[i] = std::move(fRing[(fRingHead + i) % fRing.size()]);
+    }
+    fRing.swap(ring);
+    fRingHead = 0;
+}
+
 bool ValueQueue::isBlocked(const std::string& /* topic */) {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
     return isBlockedInternal();
 }
 
-void ValueQueue::waitBlocked(const std::string& key, const std::function<bool()>& checkAbort) {
-    auto blockCondition = [this, &checkAbort] { return isBlockedInternal() && !checkAbort(); };
+void ValueQueue::waitBlocked(const std::string& key,
+                             const std::function<bool()>& checkAbort,
+                             std::chrono::steady_clock::time_point deadline) {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
-    timespec ts {};
 
-    while(blockCondition())
+    // The condition is signalled by pop() when the queue stops being full and by wakeBlocked().
+    // Waiting is still bounded by ABORT_POLL_INTERVAL for abort conditions nobody signals.
+    while (isBlockedInternal() && !checkAbort())
     {
-        // get current time
-        clock_gettime(CLOCK_REALTIME, &ts);
-
-        // add 10ms
-        ts.tv_nsec += 10'000'000L;  // 10 ms
-        if (ts.tv_nsec > 999'999'999UL)
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
         {
-            ts.tv_sec += 1;
-            ts.tv_nsec -= 1'000'000'000UL;
+            return;
         }
+        const auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::min<std::chrono::steady_clock::duration>(deadline - now, ABORT_POLL_INTERVAL));
 
-        int rc = 0;
-        while (blockCondition() && rc == 0 )  // avoid recalculation of polling end time for spurious wake-ups
-        {
-            rc = pthread_cond_timedwait(fUnblockCv.native_handle(), fMutex.native_handle(), &ts);
-        }
+        // the condition variable uses the realtime clock
+        timespec ts {};
+        clock_gettime(CLOCK_REALTIME, &ts);
+        const long long nsec = ts.tv_nsec + wait.count() % 1'000'000'000LL;
+        ts.tv_sec += static_cast<time_t>(wait.count() / 1'000'000'000LL + nsec / 1'000'000'000LL);
+        ts.tv_nsec = static_cast<long>(nsec % 1'000'000'000LL);
+
+        int rc = pthread_cond_timedwait(fUnblockCv.native_handle(), fMutex.native_handle(), &ts);
         if (rc != 0 && rc != ETIMEDOUT)
         {
             MCF_ERROR("Unexpected return value from pthread_cond_timedwait: {} ", rc);
@@ -161,6 +796,11 @@ void ValueQueue::waitBlocked(const std::string& key, const std::function<bool()>
     }
 }
 
+void ValueQueue::wakeBlocked() {
+    std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    fUnblockCv.notify_all();
+}
+
 
 bool EventQueue::empty() {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
@@ -213,8 +853,15 @@ void EventFlag::getLastTrigger(std::chrono::high_resolution_clock::time_point* l
 
 void
 EventFlag::receive(const std::string& topic, ValuePtr& /*value*/)
+{
+    activate(topic);
+}
+
+bool
+EventFlag::activate(const std::string& topic)
 {
     std::lock_guard<mutex::PriorityInheritanceMutex> lk(fMutex);
+    const bool wasActive = fActive;
     fActive = true;
     fTopic = topic;
 
@@ -222,6 +869,7 @@ EventFlag::receive(const std::string& topic, ValuePtr& /*value*/)
     fTime = std::chrono::high_resolution_clock::now();
 
     notifyTriggers();
+    return !wasActive;
 }
 
 void EventFlag::getLastTriggerUnlocked(std::chrono::high_resolution_clock::time_point* lastTime,
@@ -238,57 +886,339 @@ void EventFlag::getLastTriggerUnlocked(std::chrono::high_resolution_clock::time_
 
 
 void ValueStore::addReceiver(const std::string& key, const std::shared_ptr<IValueReceiver>& receiver) {
-    std::lock_guard<mutex::PriorityCeilingMutex> lk(fMutex);
-    std::lock_guard<mutex::PriorityCeilingMutex> entryLock(fMap[key].mutex);
-    auto& receivers = fMap[key].receivers;
-    auto it = std::find_if(receivers.begin(), receivers.end(),
-                           [receiver](const std::weak_ptr<IValueReceiver>& e){ return e.lock() == receiver;});
-    if (it == receivers.end()) {
-        receivers.push_back(receiver);
+    {
+        std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+        auto& entry = getEntryUnlocked(key).second;
+        addToReceivers(entry.receivers, receiver);
+        entry.elided.store(false, std::memory_order_relaxed);
     }
+    notifySubscriptionsChanged();
 }
 
 void ValueStore::removeReceiver(const std::string& key, const std::shared_ptr<IValueReceiver>& receiver) {
-    std::lock_guard<mutex::PriorityCeilingMutex> lk(fMutex);
-    std::lock_guard<mutex::PriorityCeilingMutex> entryLock(fMap[key].mutex);
-    auto& receivers = fMap[key].receivers;
-    receivers.erase(std::remove_if(receivers.begin(), receivers.end(),
-                                   [receiver](const std::weak_ptr<IValueReceiver>& e){ return e.lock() == receiver;}), receivers.end());
+    {
+        std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+        removeFromReceivers(getEntryUnlocked(key).second.receivers, receiver);
+    }
+    notifySubscriptionsChanged();
 }
 
 void ValueStore::addAllTopicReceiver(const std::shared_ptr<IValueReceiver>& receiver) {
-    std::lock_guard<mutex::PriorityCeilingMutex> lk(fMutex);
-    auto it = std::find_if(fAllTopicReceivers.begin(), fAllTopicReceivers.end(),
-                           [receiver](const std::weak_ptr<IValueReceiver>& e){ return e.lock() == receiver;});
-    if (it == fAllTopicReceivers.end()) {
-        fAllTopicReceivers.push_back(receiver);
+    {
+        std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+        addToReceivers(fAllTopicReceivers, receiver);
     }
+    notifySubscriptionsChanged();
 }
 
 void ValueStore::removeAllTopicReceiver(const std::shared_ptr<IValueReceiver>& receiver) {
-    std::lock_guard<mutex::PriorityCeilingMutex> lk(fMutex);
-    fAllTopicReceivers.erase(std::remove_if(fAllTopicReceivers.begin(), fAllTopicReceivers.end(),
-                                            [receiver](const std::weak_ptr<IValueReceiver>& e){ return e.lock() == receiver;}), fAllTopicReceivers.end());
+    {
+        std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+        removeFromReceivers(fAllTopicReceivers, receiver);
+    }
+    notifySubscriptionsChanged();
+}
+
+size_t ValueStore::getReceiverCount(const TopicHandle& handle) const {
+    MCF_ASSERT(handle.valid(), "Cannot count receivers via invalid topic handle");
+    const ReceiverListPtr receivers = std::atomic_load(&handle.fEntry->receivers);
+    return std::count_if(receivers->begin(), receivers->end(),
+                         [](const std::weak_ptr<IValueReceiver>& ptr){ return !ptr.expired(); });
+}
+
+bool ValueStore::hasSubscribers(const TopicHandle& handle) const {
+    MCF_ASSERT(handle.valid(), "Cannot query subscribers via invalid topic handle");
+    if (getReceiverCount(handle) > 0) {
+        return true;
+    }
+    {
+        std::lock_guard<mutex::PriorityCeilingMutex> entryLock(handle.fEntry->mutex);
+        if (handle.fEntry->history != nullptr) {
+            return true;
+        }
+    }
+    const ReceiverListPtr allTopicReceivers = std::atomic_load(&fAllTopicReceivers);
+    return std::any_of(allTopicReceivers->begin(), allTopicReceivers->end(),
+                       [&handle](const std::weak_ptr<IValueReceiver>& ptr) {
+                           const auto receiver = ptr.lock();
+                           return receiver != nullptr && receiver->wantsTopic(handle.topic());
+                       });
+}
+
+ValueStore::ObserverId ValueStore::addSubscriptionObserver(const TopicHandle& handle, SubscriptionObserver observer) {
+    MCF_ASSERT(handle.valid(), "Cannot observe subscribers via invalid topic handle");
+    std::lock_guard<std::mutex> lk(fObserverMutex);
+    const bool subscribed = hasSubscribers(handle);
+    fObservers.push_back(SubscriptionObserverEntry{fNextObserverId++, handle, std::move(observer), subscribed});
+    fObservers.back().observer(subscribed);
+    return fObservers.back().id;
+}
+
+void ValueStore::removeSubscriptionObserver(ObserverId id) {
+    std::lock_guard<std::mutex> lk(fObserverMutex);
+    fObservers.erase(std::remove_if(fObservers.begin(), fObservers.end(),
+                                    [id](const SubscriptionObserverEntry& e) { return e.id == id; }),
+                     fObservers.end());
+}
+
+void ValueStore::notifySubscriptionsChanged() {
+    std::lock_guard<std::mutex> lk(fObserverMutex);
+    for (auto& entry : fObservers) {
+        const bool subscribed = hasSubscribers(entry.handle);
+        if (subscribed != entry.subscribed) {
+            entry.subscribed = subscribed;
+            entry.observer(subscribed);
+        }
+    }
+}
+
+bool ValueStore::setElided(const TopicHandle& handle, bool elided) {
+    MCF_ASSERT(handle.valid(), "Cannot elide topic via invalid topic handle");
+    MapEntry& entry = *handle.fEntry;
+    // receivers are added with the map locked exclusively, the history with the entry locked
+    std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+    std::lock_guard<mutex::PriorityCeilingMutex> entryLock(entry.mutex);
+    const bool unread = entry.history == nullptr && getReceiverCount(handle) == 0;
+    entry.elided.store(elided && unread, std::memory_order_relaxed);
+    return elided && unread;
+}
+
+bool ValueStore::isElided(const TopicHandle& handle) const {
+    MCF_ASSERT(handle.valid(), "Cannot query topic via invalid topic handle");
+    return handle.fEntry->elided.load(std::memory_order_relaxed);
+}
+
+const TypeRegistry& ValueStore::messageTypes() {
+    // never destroyed, value stores may still be destroyed during static destruction
+    static const TypeRegistry* types = [] {
+        TypeRegistry* registry = new TypeRegistry();
+        msg::registerValueTypes(*registry);
+        return registry;
+    }();
+    return *types;
+}
+
+ValueStore::~ValueStore() {
+    {
+        std::lock_guard<std::mutex> lk(fExpiryMutex);
+        fStopExpiry = true;
+    }
+    fExpiryCv.notify_one();
+    if (fExpiryThread.joinable()) {
+        fExpiryThread.join();
+    }
+}
+
+ValueStore::TopicHandle ValueStore::getTopicHandle(const std::string& key) {
+    auto& element = getEntry(key);
+    return TopicHandle(&element.first, &element.second);
+}
+
+std::pair<const std::string, ValueStore::MapEntry>& ValueStore::getEntry(const std::string& key) {
+    {
+        std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+        auto it = fMap.find(key);
+        if (it != fMap.end()) {
+            return *it;
+        }
+    }
+    std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+    return getEntryUnlocked(key);
+}
+
+std::pair<const std::string, ValueStore::MapEntry>& ValueStore::getEntryUnlocked(const std::string& key) {
+    auto result = fMap.emplace(std::piecewise_construct,
+                               std::forward_as_tuple(key),
+                               std::forward_as_tuple());
+    if (result.second) {
+        for (const auto& patternReceiver : fPatternReceivers) {
+            auto receiver = patternReceiver.receiver.lock();
+            if (receiver != nullptr && patternReceiver.matches(key)) {
+                addToReceivers(result.first->second.receivers, receiver);
+            }
+        }
+    }
+    return *result.first;
+}
+
+void ValueStore::addPatternReceiver(const std::string& pattern,
+                                    const std::shared_ptr<IValueReceiver>& receiver,
+                                    const std::vector<std::string>& excludes) {
+    {
+        std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+        // drop expired pattern receivers
+        fPatternReceivers.erase(std::remove_if(fPatternReceivers.begin(), fPatternReceivers.end(),
+                                               [](const PatternReceiver& e){ return e.receiver.expired(); }),
+                                fPatternReceivers.end());
+        fPatternReceivers.push_back(PatternReceiver{pattern, excludes, receiver});
+        const auto& patternReceiver = fPatternReceivers.back();
+        for (auto& element : fMap) {
+            if (patternReceiver.matches(element.first)) {
+                addToReceivers(element.second.receivers, receiver);
+                element.second.elided.store(false, std::memory_order_relaxed);
+            }
+        }
+    }
+    notifySubscriptionsChanged();
+}
+
+void ValueStore::removePatternReceiver(const std::shared_ptr<IValueReceiver>& receiver) {
+    {
+        std::lock_guard<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+        auto it = std::partition(fPatternReceivers.begin(), fPatternReceivers.end(),
+                                 [&receiver](const PatternReceiver& e){ return e.receiver.lock() != receiver; });
+        for (auto removed = it; removed != fPatternReceivers.end(); ++removed) {
+            for (auto& element : fMap) {
+                if (removed->matches(element.first)) {
+                    removeFromReceivers(element.second.receivers, receiver);
+                }
+            }
+        }
+        fPatternReceivers.erase(it, fPatternReceivers.end());
+    }
+    notifySubscriptionsChanged();
+}
+
+bool ValueStore::matchesPattern(const std::string& pattern, const std::string& topic) {
+    // iterative glob matching with backtracking to the last '*'
+    size_t p = 0;
+    size_t t = 0;
+    size_t starP = std::string::npos;
+    size_t starT = 0;
+    while (t < topic.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == topic[t])) {
+            ++p;
+            ++t;
+        }
+        else if (p < pattern.size() && pattern[p] == '*') {
+            starP = p++;
+            starT = t;
+        }
+        else if (starP != std::string::npos) {
+            p = starP + 1;
+            t = ++starT;
+        }
+        else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+bool ValueStore::PatternReceiver::matches(const std::string& topic) const {
+    if (!matchesPattern(pattern, topic)) {
+        return false;
+    }
+    return std::none_of(excludes.begin(), excludes.end(),
+                        [&topic](const std::string& exclude){ return matchesPattern(exclude, topic); });
 }
 
 int ValueStore::setValue(const std::string& key, const ValuePtr& vp, bool blocking,
                          const std::function<bool()>& checkAbort)
 {
-    const auto entryTime = std::chrono::high_resolution_clock::now();
-    std::unique_lock<mutex::PriorityCeilingMutex> mapLock(fMutex);
-    auto& entry = fMap[key];
+    // Note: 'entry' stays valid after unlocking the map, since map entries are never erased
+    //       and references to elements of an unordered_map are not invalidated by rehashing.
+    //       Receivers get the key of the map, which has a stable address, see IValueReceiver.
+    auto& element = getEntry(key);
+    return setValueImpl(element.first, element.second, vp, nullptr, blocking, checkAbort);
+}
 
-    std::unique_lock<mutex::PriorityCeilingMutex> entryLock(entry.mutex);
-    mapLock.unlock();
+int ValueStore::setValue(const TopicHandle& handle, const ValuePtr& vp, bool blocking,
+                         const std::function<bool()>& checkAbort)
+{
+    MCF_ASSERT(handle.valid(), "Cannot set value via invalid topic handle");
+    return setValueImpl(*handle.fTopic, *handle.fEntry, vp, nullptr, blocking, checkAbort);
+}
+
+int ValueStore::setValue(const TopicHandle& handle, const ValuePtr& vp,
+                         std::chrono::nanoseconds timeout,
+                         const std::function<bool()>& checkAbort)
+{
+    MCF_ASSERT(handle.valid(), "Cannot set value via invalid topic handle");
+    const auto deadline = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+    return setValueImpl(*handle.fTopic, *handle.fEntry, vp, nullptr, true, checkAbort, deadline);
+}
 
-    // TODO: We probably have an issue here: 'entry' is a *reference* to an element of 'fMap' so it might
-    //                                       be modified or even become invalid after unlocking 'mapLock'.
+int ValueStore::injectValue(const std::string& key, const ValuePtr& vp, const ValueOrigin& origin,
+                            bool blocking, const std::function<bool()>& checkAbort)
+{
+    auto& element = getEntry(key);
+    return setValueImpl(element.first, element.second, vp, &origin, blocking, checkAbort);
+}
+
+int ValueStore::injectValue(const TopicHandle& handle, const ValuePtr& vp, const ValueOrigin& origin,
+                            bool blocking, const std::function<bool()>& checkAbort)
+{
+    MCF_ASSERT(handle.valid(), "Cannot set value via invalid topic handle");
+    return setValueImpl(*handle.fTopic, *handle.fEntry, vp, &origin, blocking, checkAbort);
+}
+
+int ValueStore::injectValue(const TopicHandle& handle, const ValuePtr& vp, const ValueOrigin& origin,
+                            std::chrono::nanoseconds timeout,
+                            const std::function<bool()>& checkAbort)
+{
+    MCF_ASSERT(handle.valid(), "Cannot set value via invalid topic handle");
+    const auto deadline = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+    return setValueImpl(*handle.fTopic, *handle.fEntry, vp, &origin, true, checkAbort, deadline);
+}
 
-    auto& receivers = entry.receivers;
+void ValueStore::wakeBlockedWriters(const TopicHandle& handle)
+{
+    if (!handle.valid())
+    {
+        return;
+    }
+    wakeReceivers(*std::atomic_load(&fAllTopicReceivers));
+    wakeReceivers(*std::atomic_load(&handle.fEntry->receivers));
+}
+
+bool ValueStore::waitUnblocked(const TopicHandle& handle,
+                               const std::function<bool()>& checkAbort,
+                               std::chrono::steady_clock::time_point deadline)
+{
+    if (!handle.valid())
+    {
+        return true;
+    }
+    const std::string& key = *handle.fTopic;
+    ReceiverListPtr receivers = std::atomic_load(&handle.fEntry->receivers);
+    while (isAnyReceiverBlocked(*receivers, key))
+    {
+        if (checkAbort() || std::chrono::steady_clock::now() >= deadline)
+        {
+            return false;
+        }
+        waitBlockedReceiver(*receivers, key, checkAbort, deadline);
+        receivers = std::atomic_load(&handle.fEntry->receivers);
+    }
+    return true;
+}
+
+int ValueStore::setValueImpl(const std::string& key, MapEntry& entry, const ValuePtr& vp,
+                             const ValueOrigin* origin, bool blocking, const std::function<bool()>& checkAbort,
+                             std::chrono::steady_clock::time_point deadline)
+{
+    const bool collectStatistics = fStatisticsEnabled.load(std::memory_order_relaxed);
+    const bool trace = TracePolicy::active();
+    const auto entryTime = (collectStatistics || trace) ? std::chrono::high_resolution_clock::now()
+                                                        : std::chrono::high_resolution_clock::time_point();
+    // fused receivers notified below run after the entry has been unlocked, see run()
+    InlineDispatch inlineDispatch;
+    std::unique_lock<mutex::PriorityCeilingMutex> entryLock(entry.mutex);
+    if (collectStatistics)
+    {
+        entry.statistics.lockWait.record(
+            nanosecondsBetween(entryTime, std::chrono::high_resolution_clock::now()));
+    }
 
     if(!blocking)
     {
-        if(isAnyReceiverBlocked(receivers, key))
+        if(isAnyReceiverBlocked(*std::atomic_load(&entry.receivers), key))
         {
             return EAGAIN;
         }
@@ -296,11 +1226,32 @@ int ValueStore::setValue(const std::string& key, const ValuePtr& vp, bool blocki
     else
     {
         // while there are blocked receivers and the user did not request to abort writing
-        while (isAnyReceiverBlocked(receivers, key) && !checkAbort()) {
-            auto receiversCopy = receivers;
+        ReceiverListPtr receivers = std::atomic_load(&entry.receivers);
+        std::chrono::high_resolution_clock::time_point blockedTime;
+        bool wasBlocked = false;
+        bool timedOut = false;
+        while (isAnyReceiverBlocked(*receivers, key) && !checkAbort()) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                timedOut = true;
+                break;
+            }
+            if (collectStatistics && !wasBlocked) {
+                blockedTime = std::chrono::high_resolution_clock::now();
+            }
+            wasBlocked = true;
             entryLock.unlock();
-            waitBlockedReceivers(receiversCopy, key, checkAbort);
+            waitBlockedReceiver(*receivers, key, checkAbort, deadline);
             entryLock.lock();
+            receivers = std::atomic_load(&entry.receivers);
+        }
+        if (collectStatistics && wasBlocked) {
+            entry.statistics.blockedWrites.fetch_add(1, std::memory_order_relaxed);
+            entry.statistics.blockedTimeNs.fetch_add(
+                nanosecondsBetween(blockedTime, std::chrono::high_resolution_clock::now()),
+                std::memory_order_relaxed);
+        }
+        if (timedOut && !checkAbort()) {
+            return ETIMEDOUT;
         }
     }
 
@@ -316,68 +1267,603 @@ int ValueStore::setValue(const std::string& key, const ValuePtr& vp, bool blocki
      * since deallocations can be blocking. This does not get rid of blocking, but defers it to a
      * non-time-critical part of the execution.
      */
-    ValuePtr temp = vp;
-    entry.value.swap(temp);
-    notifyReceiversAndCleanup(fAllTopicReceivers, key, vp);  // TODO: probably the map lock should be acquired before cleaning up fAllTopicReceivers
-    notifyReceiversAndCleanup(receivers, key, vp);
+    ValuePtr temp;
+    // an elided topic has neither receivers nor readers, see setElided()
+    const bool elided = entry.elided.load(std::memory_order_relaxed);
+    bool wakeExpiry = false;
+    const uint64_t seq = nextSequence(entry, origin);
+    if (!elided)
+    {
+        temp = retainValue(entry, vp, wakeExpiry);
+        if (entry.history != nullptr)
+        {
+            entry.history->push(microsecondsSinceEpoch(), vp);
+        }
+    }
+    const auto notifyTime = collectStatistics ? std::chrono::high_resolution_clock::now()
+                                              : std::chrono::high_resolution_clock::time_point();
+    notifyReceiversAndCleanup(fAllTopicReceivers, key, vp, seq);
+    if (!elided)
+    {
+        notifyReceiversAndCleanup(entry.receivers, key, vp, seq);
+    }
     entryLock.unlock();
-    const auto exitTime  = std::chrono::high_resolution_clock::now();
-    auto generator = ComponentTraceController::getLocalEventGenerator();
-    if (generator && !generator->isTracingTopic(key)) // avoid recursion
+    if (wakeExpiry)
+    {
+        wakeExpiryThread();
+    }
+    if (collectStatistics || trace)
     {
-        generator->traceExecutionTime(entryTime, exitTime, "valueStoreWrite");
+        const auto exitTime  = std::chrono::high_resolution_clock::now();
+        if (collectStatistics)
+        {
+            entry.statistics.fanOut.record(nanosecondsBetween(notifyTime, exitTime));
+            entry.statistics.writes.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (trace)
+        {
+            auto generator = ComponentTraceController::getLocalEventGenerator();
+            if (generator && !generator->isTracingTopic(key)) // avoid recursion
+            {
+                generator->traceExecutionTime(entryTime, exitTime, "valueStoreWrite");
+            }
+        }
     }
+    inlineDispatch.run();
 
     return 0;
 }
 
 
+void ValueStore::History::push(uint64_t time, const ValuePtr& value) {
+    if (count > 0) {
+        // keep the history ordered, even if the system clock jumps backwards
+        time = std::max(time, at(count - 1).time);
+    }
+    if (count == ring.size()) {
+        ring[head].value.reset();
+        head = (head + 1) % ring.size();
+        --count;
+    }
+    auto& slot = ring[(head + count) % ring.size()];
+    slot.time = time;
+    slot.value = value;
+    ++count;
+
+    if (maxAge.count() > 0) {
+        const uint64_t maxAgeUs = std::chrono::duration_cast<std::chrono::microseconds>(maxAge).count();
+        while (count > 1 && time - at(0).time > maxAgeUs) {
+            ring[head].value.reset();
+            head = (head + 1) % ring.size();
+            --count;
+        }
+    }
+}
+
+void ValueStore::DurationHistogram::record(uint64_t ns) {
+    // bucket i holds durations in [2^(i-1), 2^i) nanoseconds, bucket 0 holds zero durations
+    size_t bucket = 0;
+    while (ns > 0 && bucket < NUM_BUCKETS - 1) {
+        ns >>= 1;
+        ++bucket;
+    }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t ValueStore::DurationHistogram::percentile(double p) const {
+    std::array<uint64_t, NUM_BUCKETS> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const auto rank = static_cast<uint64_t>(std::ceil(p * static_cast<double>(total)));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        cumulative += counts[i];
+        if (cumulative >= rank && counts[i] > 0) {
+            return i == 0 ? 0 : (uint64_t(1) << i) - 1;
+        }
+    }
+    return (uint64_t(1) << (NUM_BUCKETS - 1)) - 1;
+}
+
+std::vector<ValueStore::TopicStatistics> ValueStore::getStatistics() const {
+    std::vector<TopicStatistics> result;
+    const auto allTopicReceivers = std::atomic_load(&fAllTopicReceivers)->size();
+    std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+    result.reserve(fMap.size());
+    for (const auto& element : fMap) {
+        const auto& stats = element.second.statistics;
+        const uint64_t writes = stats.writes.load(std::memory_order_relaxed);
+        if (writes == 0) {
+            continue;
+        }
+        TopicStatistics topicStats;
+        topicStats.topic = element.first;
+        topicStats.writes = writes;
+        topicStats.lockWaitP50Ns = stats.lockWait.percentile(0.5);
+        topicStats.lockWaitP99Ns = stats.lockWait.percentile(0.99);
+        topicStats.fanOutP50Ns = stats.fanOut.percentile(0.5);
+        topicStats.fanOutP99Ns = stats.fanOut.percentile(0.99);
+        topicStats.receivers = std::atomic_load(&element.second.receivers)->size() + allTopicReceivers;
+        topicStats.blockedWrites = stats.blockedWrites.load(std::memory_order_relaxed);
+        topicStats.blockedTimeNs = stats.blockedTimeNs.load(std::memory_order_relaxed);
+        result.push_back(std::move(topicStats));
+    }
+    return result;
+}
+
+namespace {
+
+void addValueQueues(const ValueStore::ReceiverList& receivers,
+                    std::vector<std::shared_ptr<ValueQueue>>& queues) {
+    for (const auto& weakReceiver : receivers) {
+        auto queue = std::dynamic_pointer_cast<ValueQueue>(weakReceiver.lock());
+        if (queue != nullptr) {
+            queues.push_back(std::move(queue));
+        }
+    }
+}
+
+} // anonymous namespace
+
+std::vector<ValueStore::HeldValues> ValueStore::getHeldValues() const {
+    std::vector<HeldValues> result;
+    std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+    result.reserve(fMap.size() + 1);
+    for (const auto& element : fMap) {
+        const MapEntry& entry = element.second;
+        HeldValues held;
+        held.value = entry.value.load();
+        size_t historySize = 0;
+        {
+            std::lock_guard<mutex::PriorityCeilingMutex> entryLock(entry.mutex);
+            historySize = entry.history != nullptr ? entry.history->count : 0;
+        }
+        if (historySize > 0) {
+            // allocated outside of the entry lock, which writers take
+            held.history.reserve(historySize);
+            std::lock_guard<mutex::PriorityCeilingMutex> entryLock(entry.mutex);
+            if (entry.history != nullptr) {
+                const History& history = *entry.history;
+                const size_t count = std::min(history.count, historySize);
+                for (size_t i = history.count - count; i < history.count; ++i) {
+                    held.history.push_back(history.at(i).value);
+                }
+            }
+        }
+        addValueQueues(*std::atomic_load(&entry.receivers), held.queues);
+        if (held.value != nullptr || !held.history.empty() || !held.queues.empty()) {
+            held.topic = element.first;
+            result.push_back(std::move(held));
+        }
+    }
+    HeldValues allTopics;
+    addValueQueues(*std::atomic_load(&fAllTopicReceivers), allTopics.queues);
+    if (!allTopics.queues.empty()) {
+        result.push_back(std::move(allTopics));
+    }
+    return result;
+}
+
+void ValueStore::enableHistory(const std::string& key, size_t maxCount, std::chrono::milliseconds maxAge) {
+    auto& entry = getEntry(key).second;
+
+    // create the new history outside of the critical section, since allocations can be blocking
+    std::unique_ptr<History> history;
+    if (maxCount > 0) {
+        history.reset(new History(maxCount, maxAge));
+    }
+    {
+        std::lock_guard<mutex::PriorityCeilingMutex> entryLock(entry.mutex);
+        if (history != nullptr) {
+            // the history reads the topic
+            entry.elided.store(false, std::memory_order_relaxed);
+        }
+        if (history != nullptr && entry.history != nullptr) {
+            // keep the most recent values of the previous history
+            const auto& previous = *entry.history;
+            for (size_t i = previous.count > maxCount ? previous.count - maxCount : 0; i < previous.count; ++i) {
+                history->push(previous.at(i).time, previous.at(i).value);
+            }
+        }
+        entry.history.swap(history);
+    }
+    notifySubscriptionsChanged();
+}
+
+void ValueStore::setRetention(const std::string& key, Retention retention, std::chrono::milliseconds duration) {
+    auto& entry = getEntry(key).second;
+    int64_t retentionNs = -1;
+    if (retention == Retention::NEVER || (retention == Retention::TIMED && duration.count() <= 0)) {
+        retentionNs = 0;
+    }
+    else if (retention == Retention::TIMED) {
+        retentionNs = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    }
+
+    // released outside of the critical section, see setValue()
+    ValuePtr released;
+    {
+        std::lock_guard<mutex::PriorityCeilingMutex> entryLock(entry.mutex);
+        entry.writtenNs.store(steadyNanoseconds(), std::memory_order_release);
+        entry.retentionNs.store(retentionNs, std::memory_order_relaxed);
+        if (retentionNs == 0) {
+            released = entry.value.exchange(nullptr);
+        }
+    }
+    if (retentionNs > 0) {
+        {
+            std::lock_guard<std::mutex> lk(fExpiryMutex);
+            if (std::find(fTimedEntries.begin(), fTimedEntries.end(), &entry) == fTimedEntries.end()) {
+                fTimedEntries.push_back(&entry);
+            }
+            if (!fExpiryThread.joinable()) {
+                fExpiryThread = std::thread(&ValueStore::releaseExpiredValues, this);
+            }
+        }
+        wakeExpiryThread();
+    }
+}
+
+ValuePtr ValueStore::retainValue(MapEntry& entry, const ValuePtr& vp, bool& wakeExpiry) {
+    const int64_t retentionNs = entry.retentionNs.load(std::memory_order_relaxed);
+    if (retentionNs == 0) {
+        return nullptr;
+    }
+    if (retentionNs > 0) {
+        // published before the value, so that readers of the value see its time, see isExpired()
+        entry.writtenNs.store(steadyNanoseconds(), std::memory_order_release);
+    }
+    ValuePtr previous = entry.value.exchange(vp);
+    // the expiry thread does not wait for topics without a value
+    wakeExpiry = wakeExpiry || (retentionNs > 0 && previous == nullptr);
+    return previous;
+}
+
+uint64_t ValueStore::nextSequence(MapEntry& entry, const ValueOrigin* origin) {
+    uint64_t step = 1;
+    if (origin != nullptr && origin->sequence != 0) {
+        // a topic is fed by very few origins, so a linear search is sufficient
+        auto it = std::find_if(entry.originSequences.begin(), entry.originSequences.end(),
+                               [origin](const std::pair<const void*, uint64_t>& o) { return o.first == origin->source; });
+        if (it == entry.originSequences.end()) {
+            entry.originSequences.emplace_back(origin->source, origin->sequence);
+        }
+        else {
+            if (origin->sequence > it->second + 1) {
+                step += origin->sequence - it->second - 1;
+            }
+            it->second = origin->sequence;
+        }
+    }
+    entry.sequence += step;
+    return entry.sequence;
+}
+
+void ValueStore::wakeExpiryThread() {
+    {
+        std::lock_guard<std::mutex> lk(fExpiryMutex);
+        ++fExpiryWakeups;
+    }
+    fExpiryCv.notify_one();
+}
+
+void ValueStore::releaseExpiredValues() {
+    std::vector<MapEntry*> entries;
+    std::vector<ValuePtr> released;
+    std::unique_lock<std::mutex> lk(fExpiryMutex);
+    while (!fStopExpiry) {
+        const uint64_t wakeups = fExpiryWakeups;
+        entries = fTimedEntries;
+        // entries are locked without fExpiryMutex, writers wake the thread with their entry locked
+        lk.unlock();
+        int64_t next = std::numeric_limits<int64_t>::max();
+        for (MapEntry* entry : entries) {
+            std::lock_guard<mutex::PriorityCeilingMutex> entryLock(entry->mutex);
+            const int64_t retentionNs = entry->retentionNs.load(std::memory_order_relaxed);
+            if (retentionNs <= 0 || !entry->value.hasValue()) {
+                continue;
+            }
+            const int64_t expiry = entry->writtenNs.load(std::memory_order_relaxed) + retentionNs;
+            if (expiry <= steadyNanoseconds()) {
+                released.push_back(entry->value.exchange(nullptr));
+            }
+            else {
+                next = std::min(next, expiry);
+            }
+        }
+        // e.g. ext mem buffers are returned to their pool here, without any lock held
+        released.clear();
+        lk.lock();
+        if (wakeups != fExpiryWakeups || fStopExpiry) {
+            continue;
+        }
+        if (next == std::numeric_limits<int64_t>::max()) {
+            fExpiryCv.wait(lk);
+        }
+        else {
+            fExpiryCv.wait_for(lk, std::chrono::nanoseconds(next - steadyNanoseconds()));
+        }
+    }
+}
+
+std::vector<ValueStore::HistoryEntry> ValueStore::getHistory(const std::string& key, size_t n) const {
+    std::vector<HistoryEntry> result;
+    std::shared_lock<mutex::PriorityInheritanceSharedMutex> mapLock(fMutex);
+    auto entry = fMap.find(key);
+    if (entry == fMap.end()) {
+        return result;
+    }
+    mapLock.unlock();
+
+    std::lock_guard<mutex::PriorityCeilingMutex> entryLock(entry->second.mutex);
+    const auto& history = entry->second.history;
+    if (history != nullptr) {
+        n = std::min(n, history->count);
+        result.reserve(n);
+        for (size_t i = history->count - n; i < history->count; ++i) {
+            result.push_back(history->at(i));
+        }
+    }
+    return result;
+}
+
+ValuePtr ValueStore::getHistoryValueAt(const std::string& key, uint64_t timestamp) const {
+    std::shared_lock<mutex::PriorityInheritanceSharedMutex> mapLock(fMutex);
+    auto entry = fMap.find(key);
+    if (entry == fMap.end()) {
+        return nullptr;
+    }
+    mapLock.unlock();
+
+    std::lock_guard<mutex::PriorityCeilingMutex> entryLock(entry->second.mutex);
+    const auto& history = entry->second.history;
+    if (history == nullptr || history->count == 0 || history->at(0).time > timestamp) {
+        return nullptr;
+    }
+    // binary search for the first entry later than timestamp
+    size_t lo = 0;
+    size_t hi = history->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (history->at(mid).time <= timestamp) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return history->at(lo - 1).value;
+}
+
+int ValueStore::setValues(const ValueBatch& batch, bool blocking,
+                          const std::function<bool()>& checkAbort)
+{
+    if (batch.empty())
+    {
+        return 0;
+    }
+    const bool trace = TracePolicy::active();
+    const auto entryTime = trace ? std::chrono::high_resolution_clock::now()
+                                 : std::chrono::high_resolution_clock::time_point();
+
+    // lock each entry once, ordered by address to avoid deadlocks between concurrent batches
+    std::vector<MapEntry*> entries;
+    entries.reserve(batch.size());
+    for (const auto& e : batch)
+    {
+        MCF_ASSERT(e.first.valid(), "Cannot set value via invalid topic handle");
+        entries.push_back(e.first.fEntry);
+    }
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    auto findBlocked = [&batch]() -> const TopicHandle* {
+        for (const auto& e : batch)
+        {
+            if (isAnyReceiverBlocked(*std::atomic_load(&e.first.fEntry->receivers), *e.first.fTopic))
+            {
+                return &e.first;
+            }
+        }
+        return nullptr;
+    };
+
+    EntryLocks entryLocks(std::move(entries));
+    const TopicHandle* blocked = findBlocked();
+    if (!blocking && blocked != nullptr)
+    {
+        return EAGAIN;
+    }
+
+    // while there are blocked receivers and the user did not request to abort writing
+    while (blocked != nullptr && !checkAbort())
+    {
+        ReceiverListPtr receivers = std::atomic_load(&blocked->fEntry->receivers);
+        entryLocks.unlock();
+        waitBlockedReceiver(*receivers, *blocked->fTopic, checkAbort,
+                            std::chrono::steady_clock::time_point::max());
+        entryLocks.lock();
+        blocked = findBlocked();
+    }
+
+    // cancel, if user has requested to abort writing
+    if (checkAbort())
+    {
+        return ECANCELED;
+    }
+
+    // fused receivers run after all entries have been unlocked, see setValue()
+    InlineDispatch inlineDispatch;
+    // previous values are deallocated outside of the critical section, see setValue()
+    std::vector<ValuePtr> previousValues;
+    previousValues.reserve(batch.size());
+    bool wakeExpiry = false;
+    {
+        // triggers collected during notification fire when leaving this scope, i.e. after
+        // all values have been written and all entries have been unlocked
+        TriggerBatch triggerBatch;
+        const uint64_t time = microsecondsSinceEpoch();
+        std::vector<uint64_t> sequences;
+        sequences.reserve(batch.size());
+        for (const auto& e : batch)
+        {
+            sequences.push_back(nextSequence(*e.first.fEntry, nullptr));
+            if (e.first.fEntry->elided.load(std::memory_order_relaxed))
+            {
+                continue;
+            }
+            previousValues.push_back(retainValue(*e.first.fEntry, e.second, wakeExpiry));
+            if (e.first.fEntry->history != nullptr)
+            {
+                e.first.fEntry->history->push(time, e.second);
+            }
+        }
+        const bool collectStatistics = fStatisticsEnabled.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            const auto& e = batch[i];
+            const auto notifyTime = collectStatistics ? std::chrono::high_resolution_clock::now()
+                                                      : std::chrono::high_resolution_clock::time_point();
+            notifyReceiversAndCleanup(fAllTopicReceivers, *e.first.fTopic, e.second, sequences[i]);
+            if (!e.first.fEntry->elided.load(std::memory_order_relaxed))
+            {
+                notifyReceiversAndCleanup(e.first.fEntry->receivers, *e.first.fTopic, e.second, sequences[i]);
+            }
+            if (collectStatistics)
+            {
+                auto& statistics = e.first.fEntry->statistics;
+                statistics.fanOut.record(
+                    nanosecondsBetween(notifyTime, std::chrono::high_resolution_clock::now()));
+                statistics.writes.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        entryLocks.unlock();
+    }
+    if (wakeExpiry)
+    {
+        wakeExpiryThread();
+    }
+
+    if (trace)
+    {
+        const auto exitTime  = std::chrono::high_resolution_clock::now();
+        auto generator = ComponentTraceController::getLocalEventGenerator();
+        if (generator && !generator->isTracingTopic(batch.front().first.topic())) // avoid recursion
+        {
+            generator->traceExecutionTime(entryTime, exitTime, "valueStoreWrite");
+        }
+    }
+    inlineDispatch.run();
+    return 0;
+}
+
 bool ValueStore::hasValue(const std::string& key) const {
-    std::lock_guard<mutex::PriorityCeilingMutex> lk(fMutex);
-    return fMap.find(key) != fMap.end();
+    std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+    auto entry = fMap.find(key);
+    if (entry == fMap.end()) {
+        return false;
+    }
+    lk.unlock();
+    return entry->second.value.hasValue() && !isExpired(entry->second);
 }
 
+bool ValueStore::hasValue(const TopicHandle& handle) const {
+    if (!handle.valid()) {
+        return false;
+    }
+    return handle.fEntry->value.hasValue() && !isExpired(*handle.fEntry);
+}
 
-msgpack::object ValueStore::getValueMsgpack(const std::string& key) const {
-    ValuePtr value = nullptr;
-    try {
-        std::unique_lock<mutex::PriorityCeilingMutex> mapLock(fMutex);
-        const auto& entry = fMap.at(key);
-        std::unique_lock<mutex::PriorityCeilingMutex> entryLock(entry.mutex);
-        mapLock.unlock();
-        value = entry.value;
+
+ValuePtr ValueStore::getValueWithTypeInfo(const std::string& key, const TypemapEntry*& typeInfo) const {
+    typeInfo = nullptr;
+    const MapEntry* entry = nullptr;
+    {
+        std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
+        auto it = fMap.find(key);
+        if (it == fMap.end()) {
+            return nullptr;
+        }
+        entry = &it->second;
+    }
+    // the entry may exist (e.g. by resolving a handle) without a value having been written yet
+    ValuePtr value = entry->value.load();
+    if (value != nullptr && isExpired(*entry)) {
+        value = nullptr;
     }
-    catch (std::out_of_range& e) {
-        return msgpack::object();
+    if (value != nullptr) {
+        typeInfo = findTypeInfo(*entry, *value);
     }
-    auto typeinfoPtr = getTypeInfo(*value);
+    return value;
+}
 
-    // TODO: make more efficient
-    msgpack::sbuffer buffer;
-    msgpack::packer<msgpack::sbuffer> pk(&buffer);
+bool ValueStore::getValuePacked(const std::string& key, msgpack::sbuffer& buffer) const {
+    const TypemapEntry* typeInfo = nullptr;
+    ValuePtr value = getValueWithTypeInfo(key, typeInfo);
+    if (typeInfo == nullptr) {
+        return false;
+    }
+    const void* ptr = nullptr;
+    size_t len{0};
+    packValue(buffer, value, *typeInfo, ptr, len, false);
+    return true;
+}
 
-    if (typeinfoPtr != nullptr) {
+msgpack::object_handle ValueStore::getValueMsgpackHandle(const std::string& key) const {
+    const TypemapEntry* typeInfo = nullptr;
+    ValuePtr value = getValueWithTypeInfo(key, typeInfo);
+    if (value == nullptr) {
+        return msgpack::object_handle();
+    }
+
+    msgpack::sbuffer buffer;
+    if (typeInfo != nullptr) {
         const void* ptr = nullptr;
         size_t len{0};
-        typeinfoPtr->packFunc(pk, value, ptr, len, false);
+        packValue(buffer, value, *typeInfo, ptr, len, false);
     }
     else {
+        msgpack::packer<msgpack::sbuffer> pk(&buffer);
         pk.pack("serialization error");
     }
+    // unpack directly from the serialization buffer, the handle owns the zone of the object
+    return msgpack::unpack(buffer.data(), buffer.size());
+}
 
-    msgpack::unpacker pac;
-    pac.reserve_buffer(buffer.size());
-    memcpy(pac.buffer(), buffer.data(), buffer.size());
-    pac.buffer_consumed(buffer.size());
+msgpack::object ValueStore::getValueMsgpack(const std::string& key) const {
+    return getValueMsgpackHandle(key).get();
+}
 
-    msgpack::object_handle oh;
-    pac.next(oh);
-    return oh.get();
+const TypeRegistry::TypemapEntry* ValueStore::findTypeInfo(const TopicHandle& handle, const Value& value) const {
+    if (!handle.valid()) {
+        return findTypeInfo(value);
+    }
+    return findTypeInfo(*handle.fEntry, value);
+}
+
+const TypeRegistry::TypemapEntry* ValueStore::findTypeInfo(const MapEntry& entry, const Value& value) const {
+    const TypemapEntry* cached = entry.typeInfo.load(std::memory_order_acquire);
+    if (cached != nullptr && *cached->type == typeid(value)) {
+        return cached;
+    }
+    // topics normally carry a single type, so the cache is only refreshed on the first value
+    // or when the type changes
+    const TypemapEntry* typeInfo = findTypeInfo(value);
+    if (typeInfo != nullptr) {
+        entry.typeInfo.store(typeInfo, std::memory_order_release);
+    }
+    return typeInfo;
 }
 
 std::vector<std::string> ValueStore::getKeys() const {
     std::vector<std::string> keys;
-    std::lock_guard<mutex::PriorityCeilingMutex> lk(fMutex);
+    std::shared_lock<mutex::PriorityInheritanceSharedMutex> lk(fMutex);
     for (auto const& e : fMap) {
         keys.push_back(e.first);
     }
@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/ValueStoreStatsPublisher.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+// granularity of the publishing loop, keeps shutdown responsive with long intervals
+constexpr std::chrono::milliseconds POLL_INTERVAL(10);
+
+} // anonymous namespace
+
+ValueStoreStatsPublisher::ValueStoreStatsPublisher(ValueStore& valueStore,
+                                                   std::chrono::milliseconds interval)
+: Component("ValueStoreStatsPublisher")
+, fValueStore(valueStore)
+, fInterval(interval)
+, fStatsPort(*this, "Stats")
+{}
+
+void ValueStoreStatsPublisher::configure(IComponentConfig& config) {
+    config.registerPort(fStatsPort, DEFAULT_TOPIC);
+}
+
+void ValueStoreStatsPublisher::startup() {
+    fWasEnabled = fValueStore.statisticsEnabled();
+    fValueStore.enableStatistics(true);
+    fLastPublish = std::chrono::steady_clock::now();
+    registerTriggerHandler(std::bind(&ValueStoreStatsPublisher::tick, this));
+    trigger();
+}
+
+void ValueStoreStatsPublisher::shutdown() {
+    fValueStore.enableStatistics(fWasEnabled);
+}
+
+void ValueStoreStatsPublisher::tick() {
+    if (std::chrono::steady_clock::now() - fLastPublish >= fInterval) {
+        publish();
+    }
+    std::this_thread::sleep_for(std::min(POLL_INTERVAL, fInterval));
+    trigger();
+}
+
+void ValueStoreStatsPublisher::publish() {
+    const auto now = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(now - fLastPublish).count();
+    fLastPublish = now;
+
+    auto stats = std::make_unique<msg::ValueStoreStats>();
+    for (const auto& topicStats : fValueStore.getStatistics()) {
+        msg::ValueStoreTopicStats entry;
+        entry.topic = topicStats.topic;
+        entry.writes = topicStats.writes;
+        uint64_t& lastWrites = fLastWrites[topicStats.topic];
+        entry.writeRate = seconds > 0.0 ? static_cast<float>((topicStats.writes - lastWrites) / seconds) : 0.0f;
+        lastWrites = topicStats.writes;
+        entry.lockWaitP50Ns = topicStats.lockWaitP50Ns;
+        entry.lockWaitP99Ns = topicStats.lockWaitP99Ns;
+        entry.fanOutP50Ns = topicStats.fanOutP50Ns;
+        entry.fanOutP99Ns = topicStats.fanOutP99Ns;
+        entry.receivers = topicStats.receivers;
+        entry.blockedWrites = topicStats.blockedWrites;
+        entry.blockedTimeNs = topicStats.blockedTimeNs;
+        stats->topics.push_back(std::move(entry));
+    }
+    fStatsPort.setValue(std::move(stats));
+}
+
+} // namespace mcf
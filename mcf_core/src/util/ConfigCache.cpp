@@ -0,0 +1,608 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#include "mcf_core/util/ConfigCache.h"
+#include "mcf_core/util/MergeValues.h"
+#include "mcf_core/LoggingMacros.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mcf
+{
+namespace util
+{
+namespace json
+{
+
+namespace
+{
+
+// identifies the format of the cache file, to be changed with any change of the encoding
+constexpr char CACHE_MAGIC[8] = {'M', 'C', 'F', 'C', 'F', 'G', '0', '1'};
+
+enum ValueTag : uint8_t
+{
+    TAG_NULL,
+    TAG_INT,
+    TAG_UINT,
+    TAG_REAL,
+    TAG_STRING,
+    TAG_FALSE,
+    TAG_TRUE,
+    TAG_ARRAY,
+    TAG_OBJECT
+};
+
+/*
+ * FNV-1a hash of the contents of a file
+ */
+uint64_t
+hashContents(const std::string& contents)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char c : contents)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+template <typename T>
+void
+append(std::string& out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void
+appendString(std::string& out, const std::string& value)
+{
+    append(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+/*
+ * Encode a Json value in the binary form of the cache file
+ */
+void
+encode(const Json::Value& value, std::string& out)
+{
+    switch (value.type())
+    {
+        case Json::nullValue:
+            append(out, TAG_NULL);
+            break;
+        case Json::intValue:
+            append(out, TAG_INT);
+            append(out, static_cast<int64_t>(value.asLargestInt()));
+            break;
+        case Json::uintValue:
+            append(out, TAG_UINT);
+            append(out, static_cast<uint64_t>(value.asLargestUInt()));
+            break;
+        case Json::realValue:
+            append(out, TAG_REAL);
+            append(out, value.asDouble());
+            break;
+        case Json::stringValue:
+            append(out, TAG_STRING);
+            appendString(out, value.asString());
+            break;
+        case Json::booleanValue:
+            append(out, value.asBool() ? TAG_TRUE : TAG_FALSE);
+            break;
+        case Json::arrayValue:
+            append(out, TAG_ARRAY);
+            append(out, static_cast<uint32_t>(value.size()));
+            for (const auto& element : value)
+            {
+                encode(element, out);
+            }
+            break;
+        case Json::objectValue:
+            append(out, TAG_OBJECT);
+            append(out, static_cast<uint32_t>(value.size()));
+            for (auto it = value.begin(); it != value.end(); ++it)
+            {
+                appendString(out, it.name());
+                encode(*it, out);
+            }
+            break;
+    }
+}
+
+/*
+ * Reads the binary form of the cache file, throws Json::RuntimeError if it is truncated
+ */
+class Decoder
+{
+public:
+    Decoder(const char* data, size_t size) : fData(data), fEnd(data + size) {}
+
+    bool atEnd() const
+    {
+        return fData == fEnd;
+    }
+
+    template <typename T>
+    T read()
+    {
+        T value;
+        std::memcpy(&value, take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    std::string readString()
+    {
+        const auto size = read<uint32_t>();
+        return std::string(take(size), size);
+    }
+
+    const char* take(size_t size)
+    {
+        if (static_cast<size_t>(fEnd - fData) < size)
+        {
+            throw Json::RuntimeError("Truncated config cache");
+        }
+        const char* data = fData;
+        fData += size;
+        return data;
+    }
+
+    Json::Value readValue()
+    {
+        switch (read<uint8_t>())
+        {
+            case TAG_NULL:
+                return Json::Value();
+            case TAG_INT:
+                return Json::Value(static_cast<Json::LargestInt>(read<int64_t>()));
+            case TAG_UINT:
+                return Json::Value(static_cast<Json::LargestUInt>(read<uint64_t>()));
+            case TAG_REAL:
+                return Json::Value(read<double>());
+            case TAG_STRING:
+                return Json::Value(readString());
+            case TAG_FALSE:
+                return Json::Value(false);
+            case TAG_TRUE:
+                return Json::Value(true);
+            case TAG_ARRAY:
+            {
+                Json::Value array(Json::arrayValue);
+                const auto size = read<uint32_t>();
+                for (uint32_t i = 0; i < size; ++i)
+                {
+                    array.append(readValue());
+                }
+                return array;
+            }
+            case TAG_OBJECT:
+            {
+                Json::Value object(Json::objectValue);
+                const auto size = read<uint32_t>();
+                for (uint32_t i = 0; i < size; ++i)
+                {
+                    std::string name = readString();
+                    object[name] = readValue();
+                }
+                return object;
+            }
+            default:
+                throw Json::RuntimeError("Invalid value in config cache");
+        }
+    }
+
+private:
+    const char* fData;
+    const char* const fEnd;
+};
+
+int64_t
+modificationTime(const struct stat& st)
+{
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+} // anonymous namespace
+
+ConfigCache&
+ConfigCache::instance()
+{
+    // intentionally leaked: components may read their config during static destruction
+    static ConfigCache* cache = new ConfigCache();
+    return *cache;
+}
+
+void
+ConfigCache::open(const std::string& cacheFile)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    closeCacheFile();
+    fCacheFile = cacheFile;
+    readCacheFile();
+
+    // files parsed before are written with the next save()
+    fDirty = false;
+    for (const auto& file : fFiles)
+    {
+        auto stored = fStored.find(file.first);
+        if (file.second.value
+            && (stored == fStored.end() || stored->second.mtime != file.second.mtime
+                || stored->second.size != file.second.size))
+        {
+            fDirty = true;
+        }
+    }
+}
+
+std::string
+ConfigCache::cacheFile() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return fCacheFile;
+}
+
+void
+ConfigCache::save()
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    if (fCacheFile.empty() || !fDirty)
+    {
+        return;
+    }
+
+    // entry: path, modification time, size, hash, length of the value, value
+    std::string data(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    std::string value;
+    for (const auto& file : fFiles)
+    {
+        if (!file.second.value)
+        {
+            continue;
+        }
+        value.clear();
+        encode(*file.second.value, value);
+        appendString(data, file.first);
+        append(data, file.second.mtime);
+        append(data, file.second.size);
+        append(data, file.second.hash);
+        append(data, static_cast<uint64_t>(value.size()));
+        data.append(value);
+    }
+    // keep the files used by other processes sharing the cache file
+    for (const auto& stored : fStored)
+    {
+        auto file = fFiles.find(stored.first);
+        if (file != fFiles.end() && file->second.value)
+        {
+            continue;
+        }
+        appendString(data, stored.first);
+        append(data, stored.second.mtime);
+        append(data, stored.second.size);
+        append(data, stored.second.hash);
+        append(data, stored.second.length);
+        data.append(fMapping.get() + stored.second.offset, stored.second.length);
+    }
+
+    // the mapping of the current file stays valid when it is replaced
+    const std::string tmpFile = fCacheFile + ".tmp";
+    {
+        std::ofstream stream(tmpFile, std::ios::binary | std::ios::trunc);
+        stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!stream)
+        {
+            throw Json::RuntimeError("Failed to write config cache " + tmpFile);
+        }
+    }
+    if (std::rename(tmpFile.c_str(), fCacheFile.c_str()) != 0)
+    {
+        throw Json::RuntimeError(
+            "Failed to replace config cache " + fCacheFile + ": " + std::strerror(errno));
+    }
+    fDirty = false;
+}
+
+Json::Value
+ConfigCache::loadFile(const std::string& filePath)
+{
+    ValuePtr value;
+    {
+        std::unique_lock<std::mutex> lk(fMutex);
+        value = lookup(lk, filePath, false);
+    }
+    return *value;
+}
+
+Json::Value
+ConfigCache::mergeFiles(const std::vector<std::string>& filePaths, bool skipMissing)
+{
+    ValuePtr merged;
+    {
+        std::unique_lock<std::mutex> lk(fMutex);
+        std::vector<ValuePtr> files;
+        files.reserve(filePaths.size());
+        for (const auto& filePath : filePaths)
+        {
+            files.push_back(lookup(lk, filePath, skipMissing));
+        }
+
+        // merge again only if one of the files changed
+        MergedEntry& entry = fMerged[filePaths];
+        if (!entry.value || entry.files != files)
+        {
+            entry.value.reset();
+            Json::Value value(Json::ValueType::objectValue);
+            for (size_t i = 0; i < files.size(); ++i)
+            {
+                if (!files[i])
+                {
+                    continue;
+                }
+                try
+                {
+                    updateValue(value, *files[i]);
+                }
+                catch (const Json::Exception& e)
+                {
+                    throw Json::RuntimeError(
+                        "Failed to merge Json file " + filePaths[i] + ": " + e.what());
+                }
+            }
+            entry.files = std::move(files);
+            entry.value = std::make_shared<const Json::Value>(std::move(value));
+        }
+        merged = entry.value;
+    }
+    return *merged;
+}
+
+uint64_t
+ConfigCache::filesParsed() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return fFilesParsed;
+}
+
+uint64_t
+ConfigCache::filesDecoded() const
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    return fFilesDecoded;
+}
+
+ConfigCache::ValuePtr
+ConfigCache::lookup(std::unique_lock<std::mutex>& lk, const std::string& filePath, bool skipMissing)
+{
+    int64_t mtime = 0;
+    uint64_t size = 0;
+    FileEntry* entry = nullptr;
+    for (;;)
+    {
+        struct stat st{};
+        if (stat(filePath.c_str(), &st) != 0)
+        {
+            if (!skipMissing)
+            {
+                throw Json::RuntimeError("Failed to open Json file " + filePath);
+            }
+            return nullptr;
+        }
+        mtime = modificationTime(st);
+        size = static_cast<uint64_t>(st.st_size);
+
+        // parsed before, also for another component
+        entry = &fFiles[filePath];
+        if (entry->value && entry->mtime == mtime && entry->size == size)
+        {
+            return entry->value;
+        }
+        if (!entry->loading)
+        {
+            break;
+        }
+        // another component reads the file at the moment
+        fLoaded.wait(lk);
+    }
+
+    // files are read without the mutex held, so that components configured in parallel do not
+    // wait for each other
+    entry->loading = true;
+    const std::shared_ptr<const char> mapping = fMapping;
+    auto stored = fStored.find(filePath);
+    const StoredEntry* storedEntry = nullptr;
+    StoredEntry storedCopy;
+    if (stored != fStored.end())
+    {
+        storedCopy = stored->second;
+        storedEntry = &storedCopy;
+    }
+    lk.unlock();
+    FileEntry loaded;
+    bool decoded = false;
+    try
+    {
+        loaded = load(filePath, mtime, size, mapping.get(), storedEntry, decoded);
+    }
+    catch (...)
+    {
+        lk.lock();
+        entry->loading = false;
+        fLoaded.notify_all();
+        throw;
+    }
+    lk.lock();
+    entry->loading = false;
+    fLoaded.notify_all();
+
+    if (!loaded.value)
+    {
+        if (!skipMissing)
+        {
+            throw Json::RuntimeError("Failed to open Json file " + filePath);
+        }
+        return nullptr;
+    }
+    *entry = loaded;
+    if (decoded)
+    {
+        ++fFilesDecoded;
+    }
+    else
+    {
+        ++fFilesParsed;
+    }
+    // the entry is written unless it was decoded for the same modification time
+    if (!decoded || storedEntry->mtime != mtime)
+    {
+        fDirty = true;
+    }
+    return entry->value;
+}
+
+ConfigCache::FileEntry
+ConfigCache::load(const std::string& filePath,
+                  int64_t mtime,
+                  uint64_t size,
+                  const char* mapping,
+                  const StoredEntry* stored,
+                  bool& decoded)
+{
+    decoded = false;
+    if (stored != nullptr && stored->mtime == mtime && stored->size == size)
+    {
+        ValuePtr value = decode(filePath, mapping, *stored);
+        if (value)
+        {
+            decoded = true;
+            return FileEntry{mtime, size, stored->hash, value};
+        }
+    }
+
+    std::ifstream stream(filePath, std::ios::binary);
+    if (!stream)
+    {
+        return FileEntry{};
+    }
+    const std::string contents(
+        (std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    const uint64_t hash = hashContents(contents);
+
+    // the file was touched, but has the same contents
+    if (stored != nullptr && stored->hash == hash && stored->size == contents.size())
+    {
+        ValuePtr value = decode(filePath, mapping, *stored);
+        if (value)
+        {
+            decoded = true;
+            return FileEntry{mtime, size, hash, value};
+        }
+    }
+
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    auto value = std::make_shared<Json::Value>();
+    std::string errors;
+    if (!reader->parse(contents.data(), contents.data() + contents.size(), value.get(), &errors))
+    {
+        throw Json::RuntimeError("Failed to parse Json file " + filePath + ": " + errors);
+    }
+    return FileEntry{mtime, size, hash, value};
+}
+
+ConfigCache::ValuePtr
+ConfigCache::decode(const std::string& filePath, const char* mapping, const StoredEntry& stored)
+{
+    try
+    {
+        Decoder decoder(mapping + stored.offset, stored.length);
+        auto value = std::make_shared<const Json::Value>(decoder.readValue());
+        if (decoder.atEnd())
+        {
+            return value;
+        }
+    }
+    catch (const Json::Exception&)
+    {
+    }
+    MCF_WARN_NOFILELINE("Invalid config cache entry of {}, parsing the file instead", filePath);
+    return nullptr;
+}
+
+void
+ConfigCache::readCacheFile()
+{
+    const int file = ::open(fCacheFile.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+    {
+        // written by the first save()
+        return;
+    }
+    struct stat st{};
+    void* data = MAP_FAILED;
+    if (fstat(file, &st) == 0 && st.st_size > 0)
+    {
+        data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    ::close(file);
+    if (data == MAP_FAILED)
+    {
+        MCF_WARN_NOFILELINE("Cannot map config cache {}, ignoring it", fCacheFile);
+        return;
+    }
+    const auto size = static_cast<size_t>(st.st_size);
+    fMapping = std::shared_ptr<const char>(static_cast<const char*>(data), [size](const char* mapping)
+    {
+        munmap(const_cast<char*>(mapping), size);
+    });
+    fMappingSize = size;
+
+    // index the entries, their values are decoded on use
+    try
+    {
+        Decoder decoder(fMapping.get(), fMappingSize);
+        if (std::memcmp(decoder.take(sizeof(CACHE_MAGIC)), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0)
+        {
+            throw Json::RuntimeError("Unknown config cache format");
+        }
+        while (!decoder.atEnd())
+        {
+            std::string path = decoder.readString();
+            StoredEntry stored;
+            stored.mtime = decoder.read<int64_t>();
+            stored.size = decoder.read<uint64_t>();
+            stored.hash = decoder.read<uint64_t>();
+            stored.length = decoder.read<uint64_t>();
+            stored.offset = static_cast<uint64_t>(decoder.take(stored.length) - fMapping.get());
+            fStored[std::move(path)] = stored;
+        }
+    }
+    catch (const Json::Exception& e)
+    {
+        MCF_WARN_NOFILELINE("Ignoring config cache {}: {}", fCacheFile, e.what());
+        closeCacheFile();
+    }
+}
+
+void
+ConfigCache::closeCacheFile()
+{
+    fStored.clear();
+    fMapping.reset();
+    fMappingSize = 0;
+}
+
+} // namespace json
+} // namespace util
+} // namespace mcf
@@ -6,9 +6,47 @@
 
 #include "mcf_core/ValueStore.h"
 
+#include <map>
+#include <string>
+#include <vector>
+
 namespace mcf
 {
 void waitForValue(const ValueStore& valueStore, const std::string& topic);
+
+/**
+ * A record of a file written by ValueRecorder: packet header, value and ext mem header
+ */
+struct RecordEntry
+{
+    msgpack::object_handle header;
+    msgpack::object_handle value;
+    msgpack::object_handle extMemHeader;
+    /// offset of the ext mem data in the file, if present
+    size_t extMemOffset = 0;
+
+    uint64_t time() const { return header.get().via.array.ptr[0].as<uint64_t>(); }
+    std::string topic() const { return header.get().via.array.ptr[1].as<std::string>(); }
+    std::string typeId() const { return header.get().via.array.ptr[2].as<std::string>(); }
+    uint64_t seq() const { return header.get().via.array.ptr[4].as<uint64_t>(); }
+
+    uint32_t extMemSize() const { return extMemHeader.get().via.array.ptr[0].as<uint32_t>(); }
+    bool extMemPresent() const { return extMemHeader.get().via.array.ptr[1].as<bool>(); }
+    uint32_t extMemSizeCompressed() const { return extMemHeader.get().via.array.ptr[2].as<uint32_t>(); }
+
+    /// the first element of a value packed as an array of ints, like the TestValues
+    int intValue() const { return value.get().as<std::vector<int>>()[0]; }
+};
+
+/**
+ * Read the record at off of a recording and advance off behind it and its ext mem data
+ */
+RecordEntry readRecord(const std::string& data, size_t& off);
+
+/**
+ * The intValue() of all records of a recording by topic, except those of the /mcf/ topics
+ */
+std::map<std::string, std::vector<int>> readRecordedInts(const std::string& data);
 } // namespace mcf
 
 #endif // MCF_TEST_UTILS_H
\ No newline at end of file
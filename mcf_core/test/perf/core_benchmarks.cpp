@@ -0,0 +1,259 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/Mcf.h"
+#include "mcf_core/Mutexes.h"
+#include "mcf_core/ValueRecorder.h"
+
+#include "benchmark/benchmark.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+
+/*
+ * Micro benchmarks of the core runtime, to compare optimizations against a baseline
+ *
+ * Built as McfCoreBenchmarks if Google Benchmark is found. Machine readable results are written
+ * with the options of Google Benchmark, e.g.
+ *
+ *   mcf_core_benchmarks --benchmark_format=json --benchmark_out=baseline.json
+ *
+ * and two result files are compared with compare.py of Google Benchmark.
+ */
+
+namespace {
+
+class BenchValue : public mcf::Value {
+public:
+    BenchValue(int val=0, size_t size=0) : val(val), data(size, 0.5f) {}
+    int val;
+    std::vector<float> data;
+    MSGPACK_DEFINE(val, data);
+};
+
+constexpr const char* TOPIC = "/bench/value";
+
+/*
+ * setValue() to a topic with range(0) queued receivers, from each benchmark thread
+ */
+void BM_ValueStoreSetValue(benchmark::State& state) {
+    static mcf::ValueStore* valueStore;
+    static std::vector<std::shared_ptr<mcf::ValueQueue>> queues;
+    if (state.thread_index() == 0) {
+        valueStore = new mcf::ValueStore();
+        queues.clear();
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            // bounded, so that the queues do not grow while nobody pops
+            queues.push_back(std::make_shared<mcf::ValueQueue>(
+                16, false, mcf::ValueQueue::Storage::RING_BUFFER));
+            valueStore->addReceiver(TOPIC, queues.back());
+        }
+    }
+    auto value = std::make_shared<const BenchValue>(1);
+    for (auto _ : state) {
+        valueStore->setValue(TOPIC, value);
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        queues.clear();
+        delete valueStore;
+    }
+}
+BENCHMARK(BM_ValueStoreSetValue)->Arg(0)->Arg(1)->Arg(4)->Arg(16)->ThreadRange(1, 8)->UseRealTime();
+
+/*
+ * getValue() of a topic read by all benchmark threads while it is not written
+ */
+void BM_ValueStoreGetValue(benchmark::State& state) {
+    static mcf::ValueStore* valueStore;
+    if (state.thread_index() == 0) {
+        valueStore = new mcf::ValueStore();
+        valueStore->setValue(TOPIC, BenchValue(1));
+    }
+    int64_t sum = 0;
+    for (auto _ : state) {
+        sum += valueStore->getValue<BenchValue>(TOPIC)->val;
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        delete valueStore;
+    }
+}
+BENCHMARK(BM_ValueStoreGetValue)->ThreadRange(1, 8)->UseRealTime();
+
+/*
+ * receive() and pop() of a ValueQueue, in batches of range(0) values
+ */
+void BM_ValueQueuePushPop(benchmark::State& state) {
+    const auto batch = static_cast<size_t>(state.range(0));
+    auto queue = std::make_shared<mcf::ValueQueue>(
+        static_cast<int>(batch), false, mcf::ValueQueue::Storage::RING_BUFFER);
+    // receive() is only public as a receiver of the value store
+    std::shared_ptr<mcf::IValueReceiver> receiver = queue;
+    const std::string topic = TOPIC;
+    const mcf::ValuePtr value = std::make_shared<const BenchValue>(1);
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; ++i) {
+            mcf::ValuePtr copy = value;
+            receiver->receive(topic, copy);
+        }
+        for (size_t i = 0; i < batch; ++i) {
+            benchmark::DoNotOptimize(queue->pop<BenchValue>());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batch));
+}
+BENCHMARK(BM_ValueQueuePushPop)->Arg(1)->Arg(64);
+
+class Echo : public mcf::Component {
+public:
+    Echo() : mcf::Component("Echo"), fPing(*this, "Ping"), fPong(*this, "Pong") {
+        fPing.registerHandler([this] {
+            BenchValue pong(fPing.getValue()->val);
+            fPong.setValue(pong);
+        });
+    }
+
+    void configure(mcf::IComponentConfig& config) override {
+        config.registerPort(fPing, "/bench/ping");
+        config.registerPort(fPong, "/bench/pong");
+    }
+
+private:
+    mcf::ReceiverPort<BenchValue> fPing;
+    mcf::SenderPort<BenchValue> fPong;
+};
+
+class Reply : public mcf::Component {
+public:
+    Reply() : mcf::Component("Reply"), fPong(*this, "Pong") {
+        fPong.registerHandler([this] { received.store(fPong.getValue()->val, std::memory_order_release); });
+    }
+
+    void configure(mcf::IComponentConfig& config) override {
+        config.registerPort(fPong, "/bench/pong");
+    }
+
+    std::atomic<int> received{0};
+
+private:
+    mcf::ReceiverPort<BenchValue> fPong;
+};
+
+/*
+ * Round trip from a port write to the handler of a component, which writes to the handler of
+ * a second component, i.e. two handler wakeups
+ */
+void BM_PortPingPong(benchmark::State& state) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto reply = std::make_shared<Reply>();
+    manager.registerComponent(std::make_shared<Echo>());
+    manager.registerComponent(reply);
+    manager.configure();
+    manager.startup();
+
+    auto handle = valueStore.getTopicHandle("/bench/ping");
+    int sequence = 0;
+    for (auto _ : state) {
+        ++sequence;
+        valueStore.setValue(handle, std::make_shared<const BenchValue>(sequence));
+        while (reply->received.load(std::memory_order_acquire) != sequence) {
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    manager.shutdown();
+}
+BENCHMARK(BM_PortPingPong)->UseRealTime();
+
+/*
+ * Packing and unpacking a value with range(0) floats through the codec of the TypeRegistry
+ */
+void BM_TypeRegistryPack(benchmark::State& state) {
+    mcf::ValueStore valueStore;
+    valueStore.registerType<BenchValue>("BenchValue");
+    const BenchValue value(1, static_cast<size_t>(state.range(0)));
+    const auto* typeInfo = valueStore.findTypeInfo(value);
+    msgpack::sbuffer buffer;
+    for (auto _ : state) {
+        buffer.clear();
+        msgpack::packer<msgpack::sbuffer> packer(buffer);
+        typeInfo->codec->packBuffer(packer, value);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(buffer.size()));
+}
+BENCHMARK(BM_TypeRegistryPack)->Arg(0)->Arg(1024)->Arg(65536);
+
+void BM_TypeRegistryUnpack(benchmark::State& state) {
+    mcf::ValueStore valueStore;
+    valueStore.registerType<BenchValue>("BenchValue");
+    const BenchValue value(1, static_cast<size_t>(state.range(0)));
+    const auto* typeInfo = valueStore.findTypeInfo(value);
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+    typeInfo->codec->packBuffer(packer, value);
+    for (auto _ : state) {
+        auto handle = msgpack::unpack(buffer.data(), buffer.size());
+        std::unique_ptr<mcf::Value> unpacked(typeInfo->codec->unpack(handle.get(), nullptr, 0));
+        benchmark::DoNotOptimize(unpacked.get());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(buffer.size()));
+}
+BENCHMARK(BM_TypeRegistryUnpack)->Arg(0)->Arg(1024)->Arg(65536);
+
+/*
+ * Uncontended lock and unlock, std::mutex as the reference
+ */
+void BM_PriorityCeilingMutex(benchmark::State& state) {
+    mcf::PriorityCeilingMutex mutex(sched_get_priority_max(SCHED_FIFO));
+    for (auto _ : state) {
+        std::lock_guard<mcf::PriorityCeilingMutex> lock(mutex);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PriorityCeilingMutex);
+
+void BM_StdMutex(benchmark::State& state) {
+    std::mutex mutex;
+    for (auto _ : state) {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StdMutex);
+
+/*
+ * setValue() of values with range(0) floats while a ValueRecorder records all topics, i.e. the
+ * cost the recorder adds to the writer, not the throughput of its file writer
+ */
+void BM_ValueRecorderIntake(benchmark::State& state) {
+    const std::string recordFile = "core_benchmarks_record.bin";
+    mcf::ValueStore valueStore;
+    valueStore.registerType<BenchValue>("BenchValue");
+    mcf::ValueRecorder recorder(valueStore);
+    // values beyond the limit are dropped, so that a slow disk does not block the writer
+    recorder.setWriteQueueSizeLimit(4096);
+    recorder.start(recordFile);
+
+    auto handle = valueStore.getTopicHandle(TOPIC);
+    auto value = std::make_shared<const BenchValue>(1, static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        valueStore.setValue(handle, value);
+    }
+    state.SetItemsProcessed(state.iterations());
+    recorder.stop();
+    std::remove(recordFile.c_str());
+}
+BENCHMARK(BM_ValueRecorderIntake)->Arg(16)->Arg(16384);
+
+} // anonymous namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/Mutexes.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+/*
+ * Measures the uncontended lock/unlock cost of the mcf mutexes compared to std::mutex, from a
+ * SCHED_OTHER thread and, if the process may use real-time scheduling, from a SCHED_FIFO thread.
+ *
+ * Usage: mutex_perf [iterations]
+ */
+
+namespace {
+
+template<typename Mutex>
+long long measure(Mutex& mutex, int iterations) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        mutex.lock();
+        mutex.unlock();
+    }
+    const auto duration = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / iterations;
+}
+
+void run(const char* thread, int iterations) {
+    std::mutex stdMutex;
+    mcf::mutex::PosixThreadMutex posixMutex;
+    mcf::mutex::PriorityInheritanceMutex inheritanceMutex;
+    mcf::mutex::PriorityCeilingMutex ceilingMutex(1);
+    std::printf("%-12s %12lld %18lld %26lld %22lld\n",
+                thread,
+                measure(stdMutex, iterations),
+                measure(posixMutex, iterations),
+                measure(inheritanceMutex, iterations),
+                measure(ceilingMutex, iterations));
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 200000;
+    if (iterations <= 0) {
+        std::fprintf(stderr, "Invalid number of iterations %s\n", argv[1]);
+        return 1;
+    }
+
+    std::printf("%-12s %12s %18s %26s %22s\n", "ns/lock", "std::mutex", "PosixThreadMutex",
+                "PriorityInheritanceMutex", "PriorityCeilingMutex");
+    std::thread([iterations] { run("SCHED_OTHER", iterations); }).join();
+    if (mcf::mutex::realtimeCapabilityAvailable()) {
+        std::thread([iterations] {
+            sched_param fifo{1};
+            if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &fifo) == 0) {
+                mcf::mutex::schedulingPolicyChanged();
+                run("SCHED_FIFO", iterations);
+            }
+        }).join();
+    }
+    return 0;
+}
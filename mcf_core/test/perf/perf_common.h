@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef PERF_COMMON_H
+#define PERF_COMMON_H
+
+#include "mcf_core/LatencyHistogram.h"
+#include "json/json.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Command line and result handling shared by the perf programs of mcf_core and mcf_remote
+ */
+namespace perf {
+
+/*
+ * Handlers of the options of a perf program by option name, e.g. "--json", each passed the
+ * argument following the option
+ */
+using OptionHandlers = std::map<std::string, std::function<void(const char*)>>;
+
+/*
+ * Parses options of the form --name argument
+ *
+ * @return false if an option has no handler, after printing it
+ */
+inline bool parseOptions(int argc, char** argv, const OptionHandlers& handlers) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        auto handler = handlers.find(argv[i]);
+        if (handler == handlers.end()) {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+        handler->second(argv[i + 1]);
+    }
+    return true;
+}
+
+/*
+ * Adds the options of the programs writing JSON results: --json names the file to write the
+ * results to and --duration the duration of a run in ms
+ */
+inline void addResultOptions(OptionHandlers& handlers, std::string& jsonFile, std::chrono::milliseconds& duration) {
+    handlers["--json"] = [&jsonFile](const char* arg) { jsonFile = arg; };
+    handlers["--duration"] = [&duration](const char* arg) { duration = std::chrono::milliseconds(std::atoi(arg)); };
+}
+
+/*
+ * Splits a comma separated list
+ */
+inline std::vector<std::string> parseNames(const char* arg) {
+    std::vector<std::string> names;
+    std::string list(arg);
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        names.push_back(list.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return names;
+}
+
+/*
+ * Parses a comma separated list of numbers
+ */
+template<typename T>
+std::vector<T> parseList(const char* arg) {
+    std::vector<T> values;
+    for (const auto& name : parseNames(arg)) {
+        values.push_back(static_cast<T>(std::atof(name.c_str())));
+    }
+    return values;
+}
+
+inline Json::Value toJson(const mcf::LatencyHistogram::Summary& summary) {
+    Json::Value json;
+    json["count"] = Json::UInt64(summary.count);
+    json["mean"] = summary.count > 0 ? Json::UInt64(summary.sum / summary.count) : Json::UInt64(0);
+    json["min"] = Json::UInt64(summary.min);
+    json["p50"] = Json::UInt64(summary.p50);
+    json["p99"] = Json::UInt64(summary.p99);
+    json["p999"] = Json::UInt64(summary.p999);
+    json["max"] = Json::UInt64(summary.max);
+    return json;
+}
+
+/*
+ * Writes the runs of a benchmark to a file, for comparison across builds
+ *
+ * @return false if the file could not be written, after printing its name
+ */
+inline bool writeJson(const std::string& jsonFile, const std::string& benchmark, const Json::Value& runs) {
+    Json::Value root;
+    root["benchmark"] = benchmark;
+    root["runs"] = runs;
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "  ";
+    std::ofstream out(jsonFile);
+    out << Json::writeString(builder, root) << std::endl;
+    if (!out) {
+        std::fprintf(stderr, "Cannot write %s\n", jsonFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace perf
+
+#endif
@@ -0,0 +1,514 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/Mcf.h"
+#include "mcf_core/LatencyHistogram.h"
+#include "json/json.h"
+#include "perf_common.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Runs synthetic component graphs and measures their end-to-end behaviour, to evaluate changes
+ * of the scheduling, the queues and the transport under a realistic load.
+ *
+ * Each configuration of the description is instantiated with a ComponentSystemConfigurator,
+ * run for a fixed time and reports
+ *  - the end-to-end latency distribution from the source to the sinks
+ *  - the throughput of the sources and the sinks in values/s
+ *  - the values lost on the way, and how many of them the receiver queues dropped
+ *  - the CPU use of the process in percent of one CPU
+ *
+ * Usage: pipeline_perf [--config pipelines.json] [--duration 2000] [--json results.json]
+ *
+ *  --config    description of the configurations, see below, a set of basic shapes if absent
+ *  --duration  measured time of each configuration in ms, overrides "durationMs"
+ *  --json      file to write the results to, for comparison across builds
+ *
+ * Description:
+ * {
+ *     "durationMs": 2000,
+ *     "warmupMs": 200,
+ *     "configurations": [
+ *         {
+ *             "name": "chain8",
+ *             "shape": "chain",
+ *             "count": 8,
+ *             "rateHz": 1000,
+ *             "payloadBytes": 4096,
+ *             "computeUs": 20,
+ *             "queueLength": 1
+ *         },
+ *         {
+ *             "name": "perception",
+ *             "SystemConfiguration": {
+ *                 "Qos": {...}
+ *             },
+ *             "components": {
+ *                 "camera": {"rateHz": 30, "payloadBytes": 2000000},
+ *                 "lidar": {"rateHz": 10, "payloadBytes": 1000000},
+ *                 "detector": {"inputs": ["camera"], "computeUs": 5000},
+ *                 "fusion": {"inputs": ["detector", "lidar"], "computeUs": 1000, "queueLength": 4,
+ *                            "schedulingParameters": {"policy": "fifo", "priority": 10}}
+ *             }
+ *         }
+ *     ]
+ * }
+ *
+ * A configuration either generates its components from a "shape" with "count" components
+ *  - "chain": a source followed by count - 1 stages, each consuming its predecessor
+ *  - "fan_out": a source consumed by count - 1 sinks
+ *  - "fan_in": count - 1 sources consumed by one sink
+ * or lists them in "components". Components without "inputs" are sources producing values at
+ * "rateHz", components nobody consumes are sinks. Every component spends "computeUs" on each
+ * value, busy like a real handler, and sends a value of "payloadBytes" carrying the origin time
+ * of the consumed value. "queueLength" is the length of its input queues, 0 for no limit.
+ * "schedulingParameters" are passed to the system configuration as they are, so are the settings
+ * of "SystemConfiguration", e.g. "Qos" profiles. The settings of a configuration are the defaults
+ * of its components.
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* DEFAULT_DESCRIPTION = R"({
+    "configurations": [
+        {"name": "chain8", "shape": "chain", "count": 8, "rateHz": 1000, "payloadBytes": 4096, "computeUs": 20},
+        {"name": "fan_out8", "shape": "fan_out", "count": 8, "rateHz": 1000, "payloadBytes": 4096, "computeUs": 20},
+        {"name": "fan_in8", "shape": "fan_in", "count": 8, "rateHz": 1000, "payloadBytes": 4096, "computeUs": 20},
+        {"name": "chain8_large", "shape": "chain", "count": 8, "rateHz": 100, "payloadBytes": 1048576, "computeUs": 200}
+    ]
+})";
+
+class SyntheticValue : public mcf::Value {
+public:
+    SyntheticValue(int64_t origin, size_t payloadBytes) : origin(origin), payload(payloadBytes, uint8_t(origin)) {}
+    /// steady clock time in ns at which the source produced the value this one derives from
+    int64_t origin;
+    std::vector<uint8_t> payload;
+};
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+struct ComponentSpec {
+    std::string name;
+    std::vector<std::string> inputs;
+    double rateHz = 100.;
+    size_t payloadBytes = 1024;
+    std::chrono::microseconds compute{0};
+    size_t queueLength = 1;
+    Json::Value schedulingParameters;
+    bool sink = false;
+};
+
+struct Pipeline {
+    std::string name;
+    std::vector<ComponentSpec> components;
+    Json::Value systemConfiguration{Json::objectValue};
+};
+
+/*
+ * State shared by the components of a run
+ */
+struct RunState {
+    struct Counters {
+        /// measured values sent by a source
+        std::atomic<uint64_t> produced{0};
+        /// values dropped by the input queues, set at shutdown
+        std::atomic<uint64_t> queueDrops{0};
+    };
+
+    /// by component, created before the components
+    std::map<std::string, std::unique_ptr<Counters>> counters;
+    std::atomic<bool> producing{true};
+    /// values originating before are not measured
+    std::atomic<int64_t> measureStart{INT64_MAX};
+    std::atomic<uint64_t> delivered{0};
+    mcf::LatencyHistogram latency;
+};
+
+/*
+ * Source, stage or sink of a synthetic pipeline, depending on its spec
+ */
+class SyntheticComponent : public mcf::Component {
+public:
+    SyntheticComponent(ComponentSpec spec, std::shared_ptr<RunState> state)
+    : mcf::Component("SyntheticComponent")
+    , fSpec(std::move(spec))
+    , fState(std::move(state))
+    , fCounters(*fState->counters.at(fSpec.name))
+    , fOut(*this, "out") {
+        for (size_t i = 0; i < fSpec.inputs.size(); ++i) {
+            fInputs.push_back(std::make_unique<mcf::QueuedReceiverPort<SyntheticValue>>(
+                *this, "in" + std::to_string(i), fSpec.queueLength));
+        }
+    }
+
+    void configure(mcf::IComponentConfig& config) override {
+        config.registerPort(fOut);
+        for (auto& input : fInputs) {
+            config.registerPort(*input);
+            mcf::QueuedReceiverPort<SyntheticValue>* port = input.get();
+            input->registerHandler([this, port] { port->drain([this](const std::shared_ptr<const SyntheticValue>& value) { consume(*value); }); });
+        }
+    }
+
+    void startup() override {
+        if (fInputs.empty() && fSpec.rateHz > 0.) {
+            fPeriod = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1. / fSpec.rateHz));
+            fNext = Clock::now();
+            produce();
+        }
+    }
+
+    void shutdown() override {
+        uint64_t dropped = 0;
+        for (const auto& input : fInputs) {
+            dropped += input->getQueue()->getDropped();
+        }
+        fCounters.queueDrops = dropped;
+    }
+
+private:
+    void produce() {
+        if (!fState->producing) {
+            return;
+        }
+        const int64_t origin = nowNs();
+        if (origin >= fState->measureStart) {
+            ++fCounters.produced;
+        }
+        process(origin);
+        // a fixed rate, a source behind schedule catches up without waiting
+        fNext += fPeriod;
+        postAfter(std::max(fNext - Clock::now(), Clock::duration::zero()), [this] { produce(); });
+    }
+
+    void consume(const SyntheticValue& value) {
+        // read the payload like a real consumer would
+        fChecksum += value.payload.empty() ? 0 : value.payload.front() + value.payload.back();
+        process(value.origin);
+    }
+
+    void process(int64_t origin) {
+        const auto end = Clock::now() + fSpec.compute;
+        while (Clock::now() < end) {
+            ++fChecksum;
+        }
+        if (fSpec.sink) {
+            if (origin >= fState->measureStart) {
+                fState->latency.record(static_cast<uint64_t>(std::max<int64_t>(nowNs() - origin, 0)));
+                ++fState->delivered;
+            }
+            return;
+        }
+        fOut.setValue(std::make_unique<SyntheticValue>(origin, fSpec.payloadBytes));
+    }
+
+    const ComponentSpec fSpec;
+    const std::shared_ptr<RunState> fState;
+    RunState::Counters& fCounters;
+    mcf::SenderPort<SyntheticValue> fOut;
+    std::vector<std::unique_ptr<mcf::QueuedReceiverPort<SyntheticValue>>> fInputs;
+    Clock::duration fPeriod{0};
+    Clock::time_point fNext;
+    uint64_t fChecksum = 0;
+};
+
+void readDefaults(const Json::Value& node, ComponentSpec& spec) {
+    spec.rateHz = node.get("rateHz", spec.rateHz).asDouble();
+    spec.payloadBytes = node.get("payloadBytes", Json::UInt64(spec.payloadBytes)).asUInt64();
+    spec.compute = std::chrono::microseconds(node.get("computeUs", Json::Int64(spec.compute.count())).asInt64());
+    spec.queueLength = node.get("queueLength", Json::UInt64(spec.queueLength)).asUInt64();
+    if (node.isMember("schedulingParameters")) {
+        spec.schedulingParameters = node["schedulingParameters"];
+    }
+}
+
+Pipeline readPipeline(const Json::Value& node) {
+    Pipeline pipeline;
+    pipeline.name = node.get("name", "").asString();
+    if (pipeline.name.empty()) {
+        throw std::runtime_error("Configuration without name");
+    }
+    if (node.isMember("SystemConfiguration")) {
+        pipeline.systemConfiguration = node["SystemConfiguration"];
+    }
+    ComponentSpec defaults;
+    readDefaults(node, defaults);
+
+    auto add = [&pipeline, &defaults](const std::string& name, std::vector<std::string> inputs) {
+        ComponentSpec spec = defaults;
+        spec.name = name;
+        spec.inputs = std::move(inputs);
+        pipeline.components.push_back(spec);
+    };
+    if (node.isMember("shape")) {
+        const std::string shape = node["shape"].asString();
+        const int count = node.get("count", 2).asInt();
+        if (count < 2) {
+            throw std::runtime_error(pipeline.name + ": a shape needs a count of at least 2");
+        }
+        if (shape == "chain") {
+            add("c0", {});
+            for (int i = 1; i < count; ++i) {
+                add("c" + std::to_string(i), {"c" + std::to_string(i - 1)});
+            }
+        } else if (shape == "fan_out") {
+            add("source", {});
+            for (int i = 1; i < count; ++i) {
+                add("sink" + std::to_string(i), {"source"});
+            }
+        } else if (shape == "fan_in") {
+            std::vector<std::string> sources;
+            for (int i = 1; i < count; ++i) {
+                sources.push_back("source" + std::to_string(i));
+                add(sources.back(), {});
+            }
+            add("sink", sources);
+        } else {
+            throw std::runtime_error(pipeline.name + ": shape must be one of 'chain', 'fan_out', 'fan_in'");
+        }
+    } else {
+        const Json::Value& components = node["components"];
+        for (auto it = components.begin(); it != components.end(); ++it) {
+            ComponentSpec spec = defaults;
+            spec.name = it.key().asString();
+            readDefaults(*it, spec);
+            for (const auto& input : (*it)["inputs"]) {
+                spec.inputs.push_back(input.asString());
+            }
+            pipeline.components.push_back(spec);
+        }
+    }
+    if (pipeline.components.empty()) {
+        throw std::runtime_error(pipeline.name + ": no components");
+    }
+    return pipeline;
+}
+
+/*
+ * The number of paths from each component to the sinks, i.e. the number of deliveries at the
+ * sinks per value it sends. Marks the sinks and checks that the graph has no cycles.
+ */
+std::map<std::string, uint64_t> pathsToSinks(Pipeline& pipeline) {
+    std::map<std::string, ComponentSpec*> byName;
+    std::map<std::string, std::vector<std::string>> consumers;
+    for (auto& spec : pipeline.components) {
+        byName[spec.name] = &spec;
+        consumers[spec.name];
+    }
+    for (const auto& spec : pipeline.components) {
+        for (const auto& input : spec.inputs) {
+            if (byName.count(input) == 0) {
+                throw std::runtime_error(pipeline.name + ": unknown input '" + input + "' of " + spec.name);
+            }
+            consumers[input].push_back(spec.name);
+        }
+    }
+
+    std::map<std::string, uint64_t> paths;
+    std::map<std::string, bool> visiting;
+    std::function<uint64_t(const std::string&)> count = [&](const std::string& name) -> uint64_t {
+        auto it = paths.find(name);
+        if (it != paths.end()) {
+            return it->second;
+        }
+        if (visiting[name]) {
+            throw std::runtime_error(pipeline.name + ": cycle through " + name);
+        }
+        visiting[name] = true;
+        uint64_t sum = 0;
+        for (const auto& consumer : consumers[name]) {
+            sum += count(consumer);
+        }
+        byName[name]->sink = consumers[name].empty();
+        return paths[name] = byName[name]->sink ? 1 : sum;
+    };
+    for (const auto& spec : pipeline.components) {
+        count(spec.name);
+    }
+    return paths;
+}
+
+struct RunResult {
+    uint64_t produced = 0;
+    uint64_t expected = 0;
+    uint64_t delivered = 0;
+    uint64_t queueDrops = 0;
+    double seconds = 0.;
+    double cpuPercent = 0.;
+    mcf::LatencyHistogram::Summary latency;
+};
+
+double cpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+std::string topicOf(const Pipeline& pipeline, const std::string& component) {
+    return "/perf/pipeline/" + pipeline.name + "/" + component;
+}
+
+RunResult run(Pipeline pipeline, std::chrono::milliseconds warmup, std::chrono::milliseconds duration) {
+    const auto paths = pathsToSinks(pipeline);
+    auto state = std::make_shared<RunState>();
+
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    mcf::ComponentInstantiator instantiator(manager);
+    mcf::ComponentSystemConfigurator configurator(manager, instantiator);
+
+    // one type per component binds its spec
+    Json::Value systemConfiguration = pipeline.systemConfiguration;
+    Json::Value& components = systemConfiguration["Components"];
+    for (const auto& spec : pipeline.components) {
+        state->counters[spec.name] = std::make_unique<RunState::Counters>();
+    }
+    for (const auto& spec : pipeline.components) {
+        const std::string type = "synthetic/" + spec.name;
+        instantiator.addComponentType(mcf::ComponentType::create<SyntheticComponent>(type, spec, state));
+        Json::Value& component = components[spec.name];
+        component["type"] = type;
+        component["portMapping"]["out"] = spec.sink ? Json::Value() : Json::Value(topicOf(pipeline, spec.name));
+        for (size_t i = 0; i < spec.inputs.size(); ++i) {
+            component["portMapping"]["in" + std::to_string(i)] = topicOf(pipeline, spec.inputs[i]);
+        }
+        if (!spec.schedulingParameters.isNull()) {
+            component["schedulingParameters"] = spec.schedulingParameters;
+        }
+    }
+    configurator.configureFromJSONNode(systemConfiguration);
+    manager.startup();
+
+    std::this_thread::sleep_for(warmup);
+    const auto start = Clock::now();
+    const double cpuStart = cpuSeconds();
+    state->measureStart = nowNs();
+    std::this_thread::sleep_for(duration);
+    state->producing = false;
+    const auto end = Clock::now();
+    const double cpuEnd = cpuSeconds();
+
+    // values in flight still arrive, up to a second
+    uint64_t delivered = state->delivered;
+    for (int i = 0; i < 10; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (state->delivered == delivered) {
+            break;
+        }
+        delivered = state->delivered;
+    }
+
+    manager.shutdown();
+
+    RunResult result;
+    result.delivered = state->delivered;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.cpuPercent = result.seconds > 0. ? 100. * (cpuEnd - cpuStart) / result.seconds : 0.;
+    result.latency = state->latency.summary();
+    for (const auto& counters : state->counters) {
+        result.produced += counters.second->produced;
+        result.expected += counters.second->produced * paths.at(counters.first);
+        result.queueDrops += counters.second->queueDrops;
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    std::string configFile;
+    std::string jsonFile;
+    // negative unless given, "durationMs" of the description applies then
+    std::chrono::milliseconds durationOption(-1);
+
+    perf::OptionHandlers options = {
+        {"--config", [&configFile](const char* arg) { configFile = arg; }},
+    };
+    perf::addResultOptions(options, jsonFile, durationOption);
+    if (!perf::parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    Json::Value description;
+    Json::CharReaderBuilder reader;
+    std::string errors;
+    std::ifstream file;
+    std::istringstream defaultDescription(DEFAULT_DESCRIPTION);
+    std::istream* in = &defaultDescription;
+    if (!configFile.empty()) {
+        file.open(configFile);
+        in = &file;
+    }
+    if (!*in || !Json::parseFromStream(reader, *in, &description, &errors)) {
+        std::fprintf(stderr, "Cannot read %s: %s\n", configFile.c_str(), errors.c_str());
+        return 1;
+    }
+    const std::chrono::milliseconds duration(
+        durationOption.count() >= 0 ? durationOption.count() : description.get("durationMs", 2000).asInt());
+    const std::chrono::milliseconds warmup(description.get("warmupMs", 200).asInt());
+
+    Json::Value runs(Json::arrayValue);
+    std::printf("%-20s %6s %12s %12s %10s %10s %12s %12s %12s %8s\n",
+                "configuration", "comps", "produced/s", "delivered/s", "lost", "q drops",
+                "lat p50 us", "lat p99 us", "lat max us", "cpu %");
+    for (const auto& node : description["configurations"]) {
+        Pipeline pipeline;
+        RunResult result;
+        try {
+            pipeline = readPipeline(node);
+            result = run(pipeline, warmup, duration);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+
+        const double seconds = std::max(result.seconds, 1e-9);
+        const uint64_t lost = result.expected > result.delivered ? result.expected - result.delivered : 0;
+        std::printf("%-20s %6zu %12.0f %12.0f %10llu %10llu %12.1f %12.1f %12.1f %8.1f\n",
+                    pipeline.name.c_str(), pipeline.components.size(),
+                    result.produced / seconds, result.delivered / seconds,
+                    static_cast<unsigned long long>(lost), static_cast<unsigned long long>(result.queueDrops),
+                    result.latency.p50 * 1e-3, result.latency.p99 * 1e-3, result.latency.max * 1e-3,
+                    result.cpuPercent);
+
+        Json::Value run;
+        run["name"] = pipeline.name;
+        run["components"] = Json::UInt64(pipeline.components.size());
+        run["seconds"] = result.seconds;
+        run["produced"] = Json::UInt64(result.produced);
+        run["expected"] = Json::UInt64(result.expected);
+        run["delivered"] = Json::UInt64(result.delivered);
+        run["lost"] = Json::UInt64(lost);
+        run["queue_drops"] = Json::UInt64(result.queueDrops);
+        run["produced_per_second"] = result.produced / seconds;
+        run["delivered_per_second"] = result.delivered / seconds;
+        run["latency_ns"] = perf::toJson(result.latency);
+        run["cpu_percent"] = result.cpuPercent;
+        runs.append(run);
+    }
+
+    if (!jsonFile.empty() && !perf::writeJson(jsonFile, "pipeline_perf", runs)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/Mcf.h"
+#include "mcf_core/LatencyHistogram.h"
+#include "mcf_core/QueuedEventSource.h"
+#include "mcf_core/ReplayEventController.h"
+#include "mcf_core/TimestampType.h"
+#include "json/json.h"
+#include "perf_common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Replays synthetic event streams through a ReplayEventController with one QueuedEventSource per
+ * topic and measures
+ *  - the throughput in events/s when replaying unthrottled
+ *  - the scheduling error (actual minus intended fire time) when replaying in real time
+ *
+ * Each combination of the given topic counts, rates and payload sizes is run once.
+ *
+ * Usage: replay_perf [--topics 1,16] [--rates 1000] [--payloads 16,65536]
+ *                    [--events 200000] [--duration 1000] [--json results.json]
+ *
+ *  --topics    number of topics, each replayed from its own event source
+ *  --rates     events per second of each topic
+ *  --payloads  payload bytes of each event
+ *  --events    number of events of an unthrottled run
+ *  --duration  duration of a real time run in ms
+ *  --json      file to write the results to, for comparison across builds
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+class ReplayPerfValue : public mcf::Value {
+public:
+    ReplayPerfValue(uint64_t time, std::shared_ptr<const std::vector<uint8_t>> payload)
+    : time(time), payload(std::move(payload)) {}
+    /// intended simulation time in microseconds
+    uint64_t time;
+    /// shared by all events of a run, so that large payloads do not exhaust the memory
+    std::shared_ptr<const std::vector<uint8_t>> payload;
+};
+
+/*
+ * Counts the fired events and records their scheduling error relative to the first one
+ */
+class FireCounter : public mcf::IValueReceiver {
+public:
+    FireCounter(uint64_t expected, float speed) : fExpected(expected), fSpeed(speed) {}
+
+    void receive(const std::string& topic, mcf::ValuePtr& value) override {
+        const auto now = Clock::now();
+        const auto& perfValue = static_cast<const ReplayPerfValue&>(*value);
+        // touch the payload like a consumer would
+        fChecksum += perfValue.payload->empty() ? 0 : perfValue.payload->back();
+
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (fFired == 0) {
+            fFirstWallTime = now;
+            fFirstTime = perfValue.time;
+        }
+        const auto intended = fFirstWallTime + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::micro>((perfValue.time - fFirstTime) / fSpeed));
+        const int64_t error = std::chrono::duration_cast<std::chrono::nanoseconds>(now - intended).count();
+        if (error < 0) {
+            ++fEarly;
+        }
+        fError.record(static_cast<uint64_t>(std::max<int64_t>(error, 0)));
+        fLastWallTime = now;
+        if (++fFired == fExpected) {
+            fDone.notify_all();
+        }
+    }
+
+    void waitTillDone() {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fDone.wait(lock, [this] { return fFired == fExpected; });
+    }
+
+    uint64_t early() const { return fEarly; }
+    Clock::time_point lastWallTime() const { return fLastWallTime; }
+    mcf::LatencyHistogram::Summary error() const { return fError.summary(); }
+
+private:
+    const uint64_t fExpected;
+    const float fSpeed;
+    std::mutex fMutex;
+    std::condition_variable fDone;
+    uint64_t fFired = 0;
+    uint64_t fEarly = 0;
+    uint64_t fChecksum = 0;
+    Clock::time_point fFirstWallTime;
+    Clock::time_point fLastWallTime;
+    uint64_t fFirstTime = 0;
+    mcf::LatencyHistogram fError;
+};
+
+struct RunConfig {
+    int topics;
+    double rate;
+    size_t payload;
+};
+
+struct RunResult {
+    uint64_t events = 0;
+    double seconds = 0.;
+    float achievedSpeedup = 0.f;
+    uint64_t early = 0;
+    mcf::LatencyHistogram::Summary error;
+};
+
+RunResult replay(const RunConfig& config, uint64_t eventsPerTopic, bool unthrottled) {
+    mcf::ValueStore valueStore;
+    mcf::ReplayEventController::Params params;
+    params.unthrottled = unthrottled;
+    mcf::ReplayEventController replayEventController(valueStore, params);
+
+    const uint64_t events = eventsPerTopic * config.topics;
+    auto counter = std::make_shared<FireCounter>(events, params.speedFactor);
+    auto payload = std::make_shared<const std::vector<uint8_t>>(config.payload, uint8_t(1));
+
+    // the topics are phase shifted against each other, so that the sources interleave
+    const double period = 1e6 / config.rate;
+    const uint64_t startTime = 1000000;
+    std::vector<std::shared_ptr<mcf::QueuedEventSource>> sources;
+    for (int t = 0; t < config.topics; ++t) {
+        const std::string topic = "/perf/topic" + std::to_string(t);
+        valueStore.addReceiver(topic, counter);
+        auto source = std::make_shared<mcf::QueuedEventSource>(
+            valueStore, replayEventController.getEventTimingController());
+        replayEventController.addEventSource(source, topic);
+        for (uint64_t i = 0; i < eventsPerTopic; ++i) {
+            const uint64_t time = startTime + static_cast<uint64_t>((i + double(t) / config.topics) * period);
+            source->pushNewEvent(mcf::TimestampType(time), topic, std::make_shared<const ReplayPerfValue>(time, payload));
+        }
+        sources.push_back(source);
+    }
+
+    const auto startWallTime = Clock::now();
+    replayEventController.run();
+    counter->waitTillDone();
+
+    RunResult result;
+    result.events = events;
+    result.seconds = std::chrono::duration<double>(counter->lastWallTime() - startWallTime).count();
+    result.achievedSpeedup = replayEventController.getAchievedSpeedup();
+    result.early = counter->early();
+    result.error = counter->error();
+
+    // queued event sources only finish when told to
+    for (auto& source : sources) {
+        source->setEventSourceFinished(true);
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    std::vector<int> topicCounts = {1, 16};
+    std::vector<double> rates = {1000.};
+    std::vector<size_t> payloads = {16, 65536};
+    uint64_t unthrottledEvents = 200000;
+    std::chrono::milliseconds duration(1000);
+    std::string jsonFile;
+
+    perf::OptionHandlers options = {
+        {"--topics", [&topicCounts](const char* arg) { topicCounts = perf::parseList<int>(arg); }},
+        {"--rates", [&rates](const char* arg) { rates = perf::parseList<double>(arg); }},
+        {"--payloads", [&payloads](const char* arg) { payloads = perf::parseList<size_t>(arg); }},
+        {"--events", [&unthrottledEvents](const char* arg) { unthrottledEvents = std::strtoull(arg, nullptr, 10); }},
+    };
+    perf::addResultOptions(options, jsonFile, duration);
+    if (!perf::parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    Json::Value runs(Json::arrayValue);
+    std::printf("%7s %9s %9s %14s %12s %14s %14s %14s %8s\n",
+                "topics", "rate/s", "payload", "events/s", "speedup", "err p50 ns", "err p99 ns", "err max ns", "early");
+    for (int topics : topicCounts) {
+        for (double rate : rates) {
+            for (size_t payload : payloads) {
+                if (topics <= 0 || rate <= 0.) {
+                    continue;
+                }
+                const RunConfig config{topics, rate, payload};
+
+                const uint64_t unthrottledPerTopic = std::max<uint64_t>(unthrottledEvents / topics, 1);
+                const RunResult throughput = replay(config, unthrottledPerTopic, true);
+
+                const uint64_t realTimePerTopic = std::max<uint64_t>(
+                    static_cast<uint64_t>(rate * std::chrono::duration<double>(duration).count()), 1);
+                const RunResult realTime = replay(config, realTimePerTopic, false);
+
+                const double eventsPerSecond = throughput.seconds > 0. ? throughput.events / throughput.seconds : 0.;
+                std::printf("%7d %9.0f %9zu %14.0f %12.1f %14llu %14llu %14llu %8llu\n",
+                            topics, rate, payload, eventsPerSecond, throughput.achievedSpeedup,
+                            static_cast<unsigned long long>(realTime.error.p50),
+                            static_cast<unsigned long long>(realTime.error.p99),
+                            static_cast<unsigned long long>(realTime.error.max),
+                            static_cast<unsigned long long>(realTime.early));
+
+                Json::Value run;
+                run["topics"] = topics;
+                run["rate"] = rate;
+                run["payload_bytes"] = Json::UInt64(payload);
+                run["unthrottled"]["events"] = Json::UInt64(throughput.events);
+                run["unthrottled"]["seconds"] = throughput.seconds;
+                run["unthrottled"]["events_per_second"] = eventsPerSecond;
+                run["unthrottled"]["achieved_speedup"] = throughput.achievedSpeedup;
+                run["real_time"]["events"] = Json::UInt64(realTime.events);
+                run["real_time"]["early_events"] = Json::UInt64(realTime.early);
+                run["real_time"]["scheduling_error_ns"] = perf::toJson(realTime.error);
+                runs.append(run);
+            }
+        }
+    }
+
+    if (!jsonFile.empty() && !perf::writeJson(jsonFile, "replay_perf", runs)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/Mcf.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+/*
+ * Measures how ValueStore::getValue() scales with the number of concurrent readers polling the
+ * same topic while a single writer keeps updating it.
+ *
+ * Usage: value_store_read_perf [duration per run in ms]
+ */
+
+namespace {
+
+class PerfValue : public mcf::Value {
+public:
+    PerfValue(int val=0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+constexpr const char* TOPIC = "/perf/value";
+
+template<typename Read>
+uint64_t runReaders(int numReaders, std::chrono::milliseconds duration, mcf::ValueStore& valueStore,
+                    const Read& read)
+{
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> totalReads(0);
+
+    std::thread writer([&valueStore, &stop] {
+        auto handle = valueStore.getTopicHandle(TOPIC);
+        int i = 0;
+        while (!stop) {
+            valueStore.setValue(handle, std::make_shared<const PerfValue>(++i));
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < numReaders; ++i) {
+        readers.emplace_back([&stop, &totalReads, &read] {
+            uint64_t reads = 0;
+            int64_t sum = 0;
+            while (!stop) {
+                sum += read()->val;
+                ++reads;
+            }
+            totalReads += reads;
+            // keep the compiler from removing the reads
+            if (sum == -1) {
+                std::printf(" ");
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    writer.join();
+    return totalReads;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 500);
+
+    mcf::ValueStore valueStore;
+    auto handle = valueStore.getTopicHandle(TOPIC);
+    valueStore.setValue(handle, std::make_shared<const PerfValue>(0));
+
+    std::printf("%8s %20s %20s %20s\n", "readers", "reads/s (handle)", "reads/s/thread", "reads/s (string)");
+    for (int numReaders : {1, 2, 4, 8, 16, 32}) {
+        const uint64_t byHandle = runReaders(numReaders, duration, valueStore, [&valueStore, &handle] {
+            return valueStore.getValue<PerfValue>(handle);
+        });
+        const uint64_t byString = runReaders(numReaders, duration, valueStore, [&valueStore] {
+            return valueStore.getValue<PerfValue>(TOPIC);
+        });
+        const double seconds = std::chrono::duration<double>(duration).count();
+        std::printf("%8d %20.0f %20.0f %20.0f\n",
+                    numReaders,
+                    byHandle / seconds,
+                    byHandle / seconds / numReaders,
+                    byString / seconds);
+    }
+    return 0;
+}
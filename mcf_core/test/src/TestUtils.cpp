@@ -22,4 +22,37 @@ waitForValue(const ValueStore& valueStore, const std::string& topic)
         }
     }
 }
+
+RecordEntry
+readRecord(const std::string& data, size_t& off)
+{
+    RecordEntry record;
+    record.header = msgpack::unpack(data.data(), data.size(), off);
+    record.value = msgpack::unpack(data.data(), data.size(), off);
+    record.extMemHeader = msgpack::unpack(data.data(), data.size(), off);
+    record.extMemOffset = off;
+    if (record.extMemPresent())
+    {
+        const uint32_t compressed = record.extMemHeader.get().via.array.size > 2 ? record.extMemSizeCompressed() : 0;
+        off += compressed != 0 ? compressed : record.extMemSize();
+    }
+    return record;
+}
+
+std::map<std::string, std::vector<int>>
+readRecordedInts(const std::string& data)
+{
+    std::map<std::string, std::vector<int>> recorded;
+    size_t off = 0;
+    while (off < data.size())
+    {
+        const RecordEntry record = readRecord(data, off);
+        const std::string topic = record.topic();
+        if (topic.compare(0, 5, "/mcf/") != 0)
+        {
+            recorded[topic].push_back(record.intValue());
+        }
+    }
+    return recorded;
+}
 } // namespace mcf
\ No newline at end of file
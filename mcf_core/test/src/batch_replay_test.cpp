@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/BatchReplay.h"
+#include "mcf_core/ValueRecorder.h"
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+
+namespace mcf {
+
+namespace {
+
+class TestValue : public mcf::Value {
+public:
+    TestValue(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+class Collector : public IValueReceiver {
+public:
+    void receive(const std::string& topic, ValuePtr& value) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        values.push_back(std::dynamic_pointer_cast<const TestValue>(value)->val);
+    }
+
+    std::mutex mutex;
+    std::vector<int> values;
+};
+
+void writeRecording(const std::string& filename, int offset, int n)
+{
+    ValueStore valueStore;
+    valueStore.registerType<TestValue>("TestValue");
+    ValueRecorder recorder(valueStore);
+    std::remove(filename.c_str());
+    recorder.start(filename);
+    for (int i = 0; i < n; ++i)
+    {
+        valueStore.setValue("/value", TestValue(offset + i));
+    }
+    recorder.stop();
+}
+
+} // anonymous namespace
+
+TEST(BatchReplayTest, IsolatedPipelines)
+{
+    const int numScenarios = 4;
+    const int n = 20;
+    std::vector<BatchReplay::Scenario> scenarios;
+    for (int s = 0; s < numScenarios; ++s)
+    {
+        BatchReplay::Scenario scenario;
+        scenario.name = "scenario" + std::to_string(s);
+        scenario.recording = "batch_replay_" + std::to_string(s) + ".bin";
+        writeRecording(scenario.recording, s * 1000, n);
+        scenarios.push_back(scenario);
+    }
+    BatchReplay::Scenario missing;
+    missing.name = "missing";
+    missing.recording = "batch_replay_missing.bin";
+    scenarios.push_back(missing);
+
+    BatchReplay::Params params;
+    // two unpinned workers
+    params.coreSets = {0, 0};
+    params.executorThreads = false;
+    params.replayParams.unthrottled = true;
+    BatchReplay batchReplay(params);
+    batchReplay.typeRegistry().registerType<TestValue>("TestValue");
+
+    std::mutex collectorsMutex;
+    std::map<std::string, std::shared_ptr<Collector>> collectors;
+    batchReplay.setSetupFunction([&](BatchReplay::Pipeline& pipeline)
+    {
+        auto collector = std::make_shared<Collector>();
+        pipeline.valueStore.addReceiver("/value", collector);
+        std::lock_guard<std::mutex> lock(collectorsMutex);
+        collectors[pipeline.scenario.name] = collector;
+    });
+
+    const auto results = batchReplay.run(scenarios);
+    ASSERT_EQ(scenarios.size(), results.size());
+    for (int s = 0; s < numScenarios; ++s)
+    {
+        EXPECT_EQ(scenarios[s].name, results[s].name);
+        EXPECT_TRUE(results[s].success) << results[s].error;
+
+        auto& collector = collectors.at(scenarios[s].name);
+        std::lock_guard<std::mutex> lock(collector->mutex);
+        ASSERT_EQ(static_cast<size_t>(n), collector->values.size());
+        for (int i = 0; i < n; ++i)
+        {
+            EXPECT_EQ(s * 1000 + i, collector->values[i]);
+        }
+        std::remove(scenarios[s].recording.c_str());
+    }
+    EXPECT_FALSE(results.back().success);
+    EXPECT_FALSE(results.back().error.empty());
+}
+
+} // end namespace mcf
@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/BatchingReceiverPort.h"
+
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mcf {
+
+class BatchingReceiverPortTest : public ::testing::Test {
+public:
+    class Frame : public mcf::Value {
+    public:
+        Frame(int val=0) : val(val) {};
+        int val;
+        MSGPACK_DEFINE(val);
+    };
+
+    // input index and value per batch entry
+    using Batches = std::vector<std::vector<std::pair<size_t, int>>>;
+
+    class DetectorComponent : public Component {
+    public:
+        DetectorComponent(size_t maxBatchSize, std::chrono::microseconds maxLatency) :
+            Component("DetectorComponent"),
+            fKickPort(*this, "Kick"),
+            fBatch(*this, "Batch", 3, maxBatchSize, maxLatency)
+        {
+            for (size_t i = 0; i < 3; ++i) {
+                fOut.emplace_back(new SenderPort<Frame>(*this, "Out" + std::to_string(i)));
+                fResults.emplace_back(new SenderPort<Frame>(*this, "Result" + std::to_string(i)));
+            }
+            // write a burst of frames from the component thread, so that they are all received
+            // before the batching port runs
+            fKickPort.registerHandler([this] {
+                std::vector<std::pair<size_t, int>> frames;
+                {
+                    std::lock_guard<std::mutex> lk(fMutex);
+                    frames = fFrames.at(fKickPort.getValue()->val);
+                }
+                for (const auto& frame : frames) {
+                    fOut[frame.first]->setValue(Frame(frame.second));
+                }
+            });
+            fBatch.registerHandler([this](const BatchingReceiverPort<Frame>::Batch& batch) {
+                std::vector<std::pair<size_t, int>> entries;
+                for (const auto& entry : batch) {
+                    entries.emplace_back(entry.input, entry.value->val);
+                    // results are scattered back to the sender port of the input
+                    fResults[entry.input]->setValue(Frame(entry.value->val * 10));
+                }
+                std::lock_guard<std::mutex> lk(fMutex);
+                fBatches.push_back(std::move(entries));
+            });
+        }
+
+        void configure(IComponentConfig& config) {
+            config.registerPort(fKickPort, "/batch/kick");
+            for (size_t i = 0; i < 3; ++i) {
+                config.registerPort(*fOut[i], "/batch/camera" + std::to_string(i));
+                config.registerPort(fBatch.input(i), "/batch/camera" + std::to_string(i));
+                config.registerPort(*fResults[i], "/batch/result" + std::to_string(i));
+            }
+        }
+
+        Batches batches() {
+            std::lock_guard<std::mutex> lk(fMutex);
+            return fBatches;
+        }
+
+        std::mutex fMutex;
+        std::vector<std::vector<std::pair<size_t, int>>> fFrames;
+        ReceiverPort<Frame> fKickPort;
+        std::vector<std::unique_ptr<SenderPort<Frame>>> fOut;
+        std::vector<std::unique_ptr<SenderPort<Frame>>> fResults;
+        BatchingReceiverPort<Frame> fBatch;
+        Batches fBatches;
+    };
+
+    /**
+     * Feed each burst of frames and return the delivered batches
+     */
+    Batches run(DetectorComponent& component, const std::vector<std::vector<std::pair<size_t, int>>>& bursts,
+                size_t expected, mcf::ValueStore& valueStore) {
+        {
+            std::lock_guard<std::mutex> lk(component.fMutex);
+            component.fFrames = bursts;
+        }
+        mcf::ComponentManager manager(valueStore);
+        std::shared_ptr<DetectorComponent> shared(&component, [](DetectorComponent*) {});
+        manager.registerComponent(shared);
+        manager.configure();
+        manager.startup();
+        for (size_t i = 0; i < bursts.size(); ++i) {
+            valueStore.setValue("/batch/kick", Frame(i));
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        for (int i = 0; i < 1000 && component.batches().size() < expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        manager.shutdown();
+        return component.batches();
+    }
+};
+
+TEST_F(BatchingReceiverPortTest, FullBatches)
+{
+    DetectorComponent component(3, std::chrono::seconds(10));
+    mcf::ValueStore valueStore;
+    auto batches = run(component, {{{0, 1}, {1, 2}, {2, 3}, {0, 4}, {1, 5}, {2, 6}}}, 2, valueStore);
+    EXPECT_EQ((Batches{{{0, 1}, {0, 4}, {1, 2}}, {{1, 5}, {2, 3}, {2, 6}}}), batches);
+    EXPECT_EQ(2u, component.fBatch.getBatches());
+    EXPECT_EQ(6u, component.fBatch.getBatchedValues());
+    EXPECT_EQ(0u, component.fBatch.getPartialBatches());
+    EXPECT_EQ(60, valueStore.getValue<Frame>("/batch/result2")->val);
+}
+
+TEST_F(BatchingReceiverPortTest, Deadline)
+{
+    DetectorComponent component(4, std::chrono::milliseconds(5));
+    mcf::ValueStore valueStore;
+    // the batches do not fill up, they are delivered at their deadline
+    auto batches = run(component, {{{0, 1}, {2, 2}}, {{1, 3}}}, 2, valueStore);
+    EXPECT_EQ((Batches{{{0, 1}, {2, 2}}, {{1, 3}}}), batches);
+    EXPECT_EQ(2u, component.fBatch.getPartialBatches());
+    EXPECT_EQ(30, valueStore.getValue<Frame>("/batch/result1")->val);
+}
+
+TEST_F(BatchingReceiverPortTest, SingleTopic)
+{
+    DetectorComponent component(2, std::chrono::milliseconds(5));
+    mcf::ValueStore valueStore;
+    // consecutive values of one topic are batched as well
+    auto batches = run(component, {{{0, 1}, {0, 2}, {0, 3}}}, 2, valueStore);
+    EXPECT_EQ((Batches{{{0, 1}, {0, 2}}, {{0, 3}}}), batches);
+    EXPECT_EQ(1u, component.fBatch.getPartialBatches());
+}
+
+} // namespace mcf
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/BulkArray.h"
+#include "mcf_core/Value.h"
+
+#include <string>
+#include <vector>
+
+namespace mcf {
+
+namespace {
+
+/*
+ * Bulk packed value as generated by the types generator for
+ * { name: string, ranges: vector<float>, ids: vector<uint64_t> }
+ */
+struct BulkTestValue : public Value {
+    std::string name;
+    std::vector<float> ranges;
+    std::vector<uint64_t> ids;
+
+    template<typename Packer>
+    void msgpack_pack(Packer& packer) const {
+        packer.pack_array(3);
+        packer.pack(name);
+        bulk::pack(packer, ranges);
+        bulk::pack(packer, ids);
+    }
+
+    void msgpack_unpack(const msgpack::object& object) {
+        const bulk::Reader reader(object);
+        reader.attribute(0, name);
+        reader.array(1, ranges);
+        reader.array(2, ids);
+    }
+};
+
+struct MsgpackTestValue : public Value {
+    std::string name;
+    MSGPACK_DEFINE(name)
+};
+
+} // anonymous namespace
+
+TEST(BulkArrayTest, RoundTrip) {
+    BulkTestValue value;
+    value.name = "radar";
+    for (int i = 0; i < 1000; ++i) {
+        value.ranges.push_back(0.5f * static_cast<float>(i));
+    }
+    value.ids = {1ull, 0x0123456789abcdefull};
+
+    msgpack::sbuffer buffer;
+    msgpack::pack(buffer, value);
+    // one bin per array instead of one number per element
+    EXPECT_GT(buffer.size(), 1000 * sizeof(float) + 2 * sizeof(uint64_t));
+    EXPECT_LT(buffer.size(), 1000 * sizeof(float) + 2 * sizeof(uint64_t) + 32);
+
+    msgpack::object_handle oh = msgpack::unpack(buffer.data(), buffer.size());
+    ASSERT_EQ(msgpack::type::BIN, oh.get().via.array.ptr[1].type);
+    const auto unpacked = oh.get().as<BulkTestValue>();
+    EXPECT_EQ(value.name, unpacked.name);
+    EXPECT_EQ(value.ranges, unpacked.ranges);
+    EXPECT_EQ(value.ids, unpacked.ids);
+}
+
+TEST(BulkArrayTest, MissingAttributes) {
+    // attributes missing at the end keep their value, like with MSGPACK_DEFINE
+    MsgpackTestValue shorter;
+    shorter.name = "lidar";
+    msgpack::sbuffer buffer;
+    msgpack::pack(buffer, shorter);
+
+    BulkTestValue value;
+    value.ids = {7ull};
+    msgpack::object_handle oh = msgpack::unpack(buffer.data(), buffer.size());
+    oh.get().convert(value);
+    EXPECT_EQ("lidar", value.name);
+    EXPECT_TRUE(value.ranges.empty());
+    EXPECT_EQ(std::vector<uint64_t>{7ull}, value.ids);
+}
+
+TEST(BulkArrayTest, Mismatch) {
+    // an array of numbers is not a bulk array
+    msgpack::sbuffer buffer;
+    msgpack::pack(buffer, std::vector<float>{1.f, 2.f});
+    msgpack::object_handle oh = msgpack::unpack(buffer.data(), buffer.size());
+    std::vector<float> value;
+    EXPECT_THROW(bulk::unpack(oh.get(), value), msgpack::type_error);
+
+    // a bin of incomplete elements neither
+    buffer.clear();
+    msgpack::packer<msgpack::sbuffer> packer(&buffer);
+    packer.pack_bin(6);
+    packer.pack_bin_body("abcdef", 6);
+    oh = msgpack::unpack(buffer.data(), buffer.size());
+    EXPECT_THROW(bulk::unpack(oh.get(), value), msgpack::type_error);
+}
+
+} // namespace mcf
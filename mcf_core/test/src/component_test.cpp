@@ -5,6 +5,7 @@
 #include "mcf_core/Mcf.h"
 #include "mcf_core/ExtMemValue.h"
 
+#include <set>
 #include <unistd.h>
 
 namespace mcf {
@@ -157,6 +158,395 @@ public:
         std::atomic<pthread_t> fThreadHandle;
     };
 
+    class BatchTestComponent : public Component {
+    public:
+        BatchTestComponent() :
+            Component("BatchTestComponent"),
+            fInPort(*this, "In", 0)
+        {}
+
+        void configure(IComponentConfig& config) {
+            config.registerPort(fInPort, "/batch/in");
+        }
+
+        QueuedReceiverPort<TestValue> fInPort;
+    };
+
+    class FusedStageComponent : public Component {
+    public:
+        FusedStageComponent(const std::string& name, const std::string& in, const std::string& out) :
+            Component(name),
+            fInTopic(in),
+            fOutTopic(out),
+            fInPort(*this, "In"),
+            fOutPort(*this, "Out")
+        {
+            fInPort.registerHandler([this] {
+                {
+                    std::lock_guard<std::mutex> lk(fMutex);
+                    fThreads.push_back(std::this_thread::get_id());
+                }
+                if (fInPort.getValue()->val < 0) {
+                    throw std::runtime_error("negative input");
+                }
+                fOutPort.setValue(TestValue(fInPort.getValue()->val + 1));
+                ++fHandled;
+            });
+        }
+
+        void configure(IComponentConfig& config) {
+            config.registerPort(fInPort, fInTopic);
+            config.registerPort(fOutPort, fOutTopic);
+        }
+
+        std::thread::id lastThread() {
+            std::lock_guard<std::mutex> lk(fMutex);
+            return fThreads.back();
+        }
+
+        std::atomic<int> fHandled{0};
+
+    private:
+        std::string fInTopic;
+        std::string fOutTopic;
+        ReceiverPort<TestValue> fInPort;
+        SenderPort<TestValue> fOutPort;
+        std::mutex fMutex;
+        std::vector<std::thread::id> fThreads;
+    };
+
+    class PriorityTestComponent : public Component {
+    public:
+        PriorityTestComponent() :
+            Component("PriorityTestComponent"),
+            fKickPort(*this, "Kick"),
+            fBulkPort(*this, "Bulk"),
+            fControlPort(*this, "Control"),
+            fBulkOutPort(*this, "BulkOut"),
+            fControlOutPort(*this, "ControlOut")
+        {
+            fKickPort.registerHandler([this] {
+                // both handlers become ready while the component is busy
+                fBulkOutPort.setValue(TestValue(0));
+                fControlOutPort.setValue(TestValue(0));
+                record("kick");
+            }, 20);
+            fBulkPort.registerHandler([this] {
+                record("bulk");
+                if (fBulkPort.getValue()->val > 0) {
+                    // a control value arrives while processing bulk data
+                    fControlOutPort.setValue(TestValue(0));
+                    preemptionPoint();
+                    record("bulk done");
+                }
+            });
+            fControlPort.registerHandler([this] { record("control"); }, 10);
+        }
+
+        void configure(IComponentConfig& config) {
+            config.registerPort(fKickPort, "/priority/kick");
+            config.registerPort(fBulkPort, "/priority/bulk");
+            config.registerPort(fControlPort, "/priority/control");
+            config.registerPort(fBulkOutPort, "/priority/bulk");
+            config.registerPort(fControlOutPort, "/priority/control");
+        }
+
+        std::vector<std::string> events() {
+            std::lock_guard<std::mutex> lk(fMutex);
+            return fEvents;
+        }
+
+    private:
+        void record(const std::string& event) {
+            std::lock_guard<std::mutex> lk(fMutex);
+            fEvents.push_back(event);
+        }
+
+        ReceiverPort<TestValue> fKickPort;
+        ReceiverPort<TestValue> fBulkPort;
+        ReceiverPort<TestValue> fControlPort;
+        SenderPort<TestValue> fBulkOutPort;
+        SenderPort<TestValue> fControlOutPort;
+        std::mutex fMutex;
+        std::vector<std::string> fEvents;
+    };
+
+    class AsyncRequestComponent : public Component {
+    public:
+        AsyncRequestComponent() :
+            Component("AsyncRequestComponent"),
+            fStartPort(*this, "Start"),
+            fReplyPort(*this, "Reply"),
+            fRequestPort(*this, "Request")
+        {
+            fStartPort.registerHandler([this] {
+                fHandlerThread = std::this_thread::get_id();
+                const int request = fStartPort.getValue()->val;
+                // wait for the reply before sending the request, so that it cannot be missed
+                fReplyPort.next([this, request](std::shared_ptr<const TestValue> reply) {
+                    if (!reply) {
+                        record("timeout " + std::to_string(request));
+                        return;
+                    }
+                    record("reply " + std::to_string(reply->val));
+                    postAfter(std::chrono::milliseconds(10), [this] { record("delayed"); });
+                }, std::chrono::milliseconds(50));
+                fRequestPort.setValue(TestValue(request));
+            });
+        }
+
+        void configure(IComponentConfig& config) {
+            config.registerPort(fStartPort, "/async/start");
+            config.registerPort(fReplyPort, "/async/reply");
+            config.registerPort(fRequestPort, "/async/request");
+        }
+
+        std::vector<std::string> events() {
+            std::lock_guard<std::mutex> lk(fMutex);
+            return fEvents;
+        }
+
+        void record(const std::string& event) {
+            std::lock_guard<std::mutex> lk(fMutex);
+            fEvents.push_back(event);
+            fThreads.insert(std::this_thread::get_id());
+        }
+
+        std::set<std::thread::id> fThreads;
+        std::thread::id fHandlerThread;
+
+    private:
+        ReceiverPort<TestValue> fStartPort;
+        ReceiverPort<TestValue> fReplyPort;
+        SenderPort<TestValue> fRequestPort;
+        std::mutex fMutex;
+        std::vector<std::string> fEvents;
+    };
+
+    class SlowHandlerComponent : public Component {
+    public:
+        SlowHandlerComponent() :
+            Component("SlowHandlerComponent"),
+            fInPort(*this, "In")
+        {
+            fInPort.registerHandler([this] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(fInPort.getValue()->val));
+                ++fHandled;
+            });
+        }
+
+        void configure(IComponentConfig& config) {
+            config.registerPort(fInPort, "/deadline/in");
+        }
+
+        std::atomic<int> fHandled{0};
+
+    private:
+        ReceiverPort<TestValue> fInPort;
+    };
+
+    class OverloadComponent : public Component {
+    public:
+        OverloadComponent() :
+            Component("OverloadComponent"),
+            fInPort(*this, "In", 16, true),
+            fOtherPort(*this, "Other", 16, true)
+        {
+            PortTriggerHandlerOptions options;
+            options.fallback = [this] {
+                fInPort.drain([this](const std::shared_ptr<const TestValue>& value) {
+                    record(-value->val);
+                });
+            };
+            // each value makes the handler run for val ms
+            fInPort.registerHandler([this] {
+                fInPort.drain([this](const std::shared_ptr<const TestValue>& value) {
+                    ++fStarted;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(value->val));
+                    record(value->val);
+                });
+            }, options);
+            fOtherPort.registerHandler([this] {
+                fOtherPort.drain([this](const std::shared_ptr<const TestValue>& value) {
+                    record(100 + value->val);
+                });
+            });
+        }
+
+        void configure(IComponentConfig& config) {
+            config.registerPort(fInPort, "/overload/in");
+            config.registerPort(fOtherPort, "/overload/other");
+        }
+
+        std::vector<int> handled() {
+            std::lock_guard<std::mutex> lk(fMutex);
+            return fHandled;
+        }
+
+        std::atomic<int> fStarted{0};
+
+    private:
+        void record(int value) {
+            std::lock_guard<std::mutex> lk(fMutex);
+            fHandled.push_back(value);
+        }
+
+        QueuedReceiverPort<TestValue> fInPort;
+        QueuedReceiverPort<TestValue> fOtherPort;
+        std::mutex fMutex;
+        std::vector<int> fHandled;
+    };
+
+    class SlowStartupComponent : public Component {
+    public:
+        SlowStartupComponent() : Component("SlowStartupComponent") {}
+
+        void startup() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    };
+
+    class ExecutorTestComponent : public Component {
+    public:
+        explicit ExecutorTestComponent(const std::string& name) :
+            Component(name),
+            fInPort(*this, "In")
+        {
+            fInPort.registerHandler(std::bind(&ExecutorTestComponent::onValue, this));
+        }
+
+        void configure(IComponentConfig& config) {
+            config.registerPort(fInPort, "/executor/in");
+        }
+
+        void startup() {
+            std::lock_guard<std::mutex> lk(fMutex);
+            fThreadIds.insert(std::this_thread::get_id());
+        }
+
+        void onValue() {
+            // handlers of one component must never run concurrently
+            EXPECT_FALSE(fInHandler.exchange(true));
+            fLastValue = fInPort.getValue()->val;
+            {
+                std::lock_guard<std::mutex> lk(fMutex);
+                fThreadIds.insert(std::this_thread::get_id());
+            }
+            fInHandler = false;
+        }
+
+        std::set<std::thread::id> threadIds() {
+            std::lock_guard<std::mutex> lk(fMutex);
+            return fThreadIds;
+        }
+
+        std::atomic<int> fLastValue{-1};
+        std::atomic<bool> fInHandler{false};
+        std::mutex fMutex;
+        std::set<std::thread::id> fThreadIds;
+        ReceiverPort<TestValue> fInPort;
+    };
+
+    class ReadyListTestComponent : public Component {
+    public:
+        ReadyListTestComponent() : Component("ReadyListTestComponent")
+        {
+            for (int i = 0; i < NUM_PORTS; ++i) {
+                fInPorts.emplace_back(new ReceiverPort<TestValue>(*this, "In" + std::to_string(i)));
+                fInPorts.back()->registerHandler([this, i] { ++fPortCalls[i]; });
+            }
+        }
+
+        void configure(IComponentConfig& config) {
+            for (int i = 0; i < NUM_PORTS; ++i) {
+                config.registerPort(*fInPorts[i], "/ready/" + std::to_string(i));
+            }
+            registerTriggerHandler([this] { ++fTriggerCalls; });
+        }
+
+        void triggerFromOutside() {
+            trigger();
+        }
+
+        static constexpr int NUM_PORTS = 16;
+        std::vector<std::unique_ptr<ReceiverPort<TestValue>>> fInPorts;
+        std::atomic<int> fPortCalls[NUM_PORTS] = {};
+        std::atomic<int> fTriggerCalls{0};
+    };
+
+    class ConcurrentTestComponent : public Component {
+    public:
+        ConcurrentTestComponent() :
+            Component("ConcurrentTestComponent"),
+            fInPortA(*this, "InA"),
+            fInPortB(*this, "InB")
+        {
+            PortTriggerHandlerOptions options;
+            options.concurrent = true;
+            fInPortA.registerHandler([this] { onValue(fInPortA, fInA, fLastA); }, options);
+            fInPortB.registerHandler([this] { onValue(fInPortB, fInB, fLastB); }, options);
+        }
+
+        void configure(IComponentConfig& config) {
+            config.registerPort(fInPortA, "/concurrent/a");
+            config.registerPort(fInPortB, "/concurrent/b");
+        }
+
+        void onValue(ReceiverPort<TestValue>& port, std::atomic<bool>& inHandler, std::atomic<int>& last) {
+            // a single handler never runs concurrently with itself
+            EXPECT_FALSE(inHandler.exchange(true));
+            if (fInA && fInB) {
+                fOverlapped = true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            last = port.getValue()->val;
+            inHandler = false;
+        }
+
+        std::atomic<bool> fInA{false};
+        std::atomic<bool> fInB{false};
+        std::atomic<bool> fOverlapped{false};
+        std::atomic<int> fLastA{-1};
+        std::atomic<int> fLastB{-1};
+        ReceiverPort<TestValue> fInPortA;
+        ReceiverPort<TestValue> fInPortB;
+    };
+
+    class LifecycleTestComponent : public Component {
+    public:
+        LifecycleTestComponent(const std::string& name, const std::string& topic, bool sender) :
+            Component(name),
+            fSendPort(*this, "Out"),
+            fReceiverPort(*this, "In"),
+            fTopic(topic),
+            fSender(sender)
+        {}
+
+        void configure(IComponentConfig& config) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            if (fSender) {
+                config.registerPort(fSendPort, fTopic);
+            }
+            else {
+                config.registerPort(fReceiverPort, fTopic);
+            }
+        }
+
+        void startup() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+
+        void shutdown() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+
+    private:
+        SenderPort<TestValue> fSendPort;
+        ReceiverPort<TestValue> fReceiverPort;
+        const std::string fTopic;
+        const bool fSender;
+    };
+
     class TestValue : public mcf::Value {
     public:
         TestValue(int val=0) : val(val) {};
@@ -381,7 +771,7 @@ TEST_F(ComponentTest, SimpleWithRestarts)
     manager.configure();
     manager.startup();
 
-    EXPECT_EQ(tc1Desc.ports().size(), 2 + 4); // two custom, log, log control, config in, config out
+    EXPECT_EQ(tc1Desc.ports().size(), 2 + 7); // two custom, log, log control, config in, config out, stats, stats control, overload
 
     for (const auto& p: tc1Desc.ports())
     {
@@ -630,4 +1020,601 @@ TEST_F(ComponentTest, ThreadPriority) {
     manager.shutdown();
 }
 
+TEST_F(ComponentTest, StartupDuration) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto component = std::make_shared<SlowStartupComponent>();
+    manager.registerComponent(component);
+    manager.configure();
+    EXPECT_EQ(0, component->getStartupDuration().count());
+
+    // startup() returns as soon as startup() of the component has finished
+    manager.startup();
+    EXPECT_NE(IComponent::STARTING_UP, component->getState());
+    EXPECT_GE(component->getStartupDuration(), std::chrono::milliseconds(20));
+    EXPECT_LT(component->getStartupDuration(), std::chrono::seconds(5));
+    manager.shutdown();
+    EXPECT_EQ(IComponent::STOPPED, component->getState());
+}
+
+TEST_F(ComponentTest, CpuAffinity) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto testComponent = std::make_shared<TestComponent4>();
+
+    const CpuMask allowed = getThreadCpuAffinity(pthread_self());
+    ASSERT_NE(0u, allowed);
+    const CpuMask lowest = allowed & (~allowed + 1);
+    testComponent->ctrlSetSchedulingParameters(
+        mcf::IComponent::SchedulingParameters{mcf::IComponent::Default, 0, lowest});
+
+    manager.registerComponent(testComponent);
+    manager.configure();
+    manager.startup();
+    while (testComponent->fThreadHandle.load() == 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(lowest, getThreadCpuAffinity(testComponent->fThreadHandle.load()));
+    EXPECT_EQ(lowest, testComponent->getEffectiveCpuAffinity());
+
+    // a running component is moved right away
+    const CpuMask others = allowed & ~lowest;
+    if (others != 0)
+    {
+        manager.getComponents()[0].setSchedulingParameters(
+            mcf::IComponent::SchedulingParameters{mcf::IComponent::Default, 0, others});
+        EXPECT_EQ(others, testComponent->getEffectiveCpuAffinity());
+    }
+    manager.shutdown();
+    EXPECT_EQ(0u, testComponent->getEffectiveCpuAffinity());
+}
+
+TEST_F(ComponentTest, QueuedPortBatch) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto component = std::make_shared<BatchTestComponent>();
+    manager.registerComponent(component);
+    manager.configure();
+    manager.startup();
+
+    EXPECT_TRUE(component->fInPort.getValues().empty());
+    for (int i = 0; i < 10; ++i) {
+        valueStore.setValue("/batch/in", TestValue(i));
+    }
+
+    auto batch = component->fInPort.getValues(4);
+    ASSERT_EQ(4u, batch.size());
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(i, batch[i]->val);
+    }
+    std::vector<int> drained;
+    EXPECT_EQ(6u, component->fInPort.drain([&drained](const std::shared_ptr<const TestValue>& value) {
+        drained.push_back(value->val);
+    }));
+    EXPECT_EQ((std::vector<int>{4, 5, 6, 7, 8, 9}), drained);
+    EXPECT_FALSE(component->fInPort.hasValue());
+
+    // a batch unblocks writers waiting for a full blocking queue
+    component->fInPort.setMaxQueueLength(2);
+    component->fInPort.setBlocking(true);
+    std::thread writer([&valueStore] {
+        for (int i = 0; i < 4; ++i) {
+            valueStore.setValue("/batch/in", TestValue(i), true);
+        }
+    });
+    size_t received = 0;
+    while (received < 4) {
+        received += component->fInPort.drain([](const std::shared_ptr<const Value>&) {});
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    writer.join();
+    EXPECT_EQ(4u, received);
+    manager.shutdown();
+}
+
+TEST_F(ComponentTest, FusedPipeline) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto head = std::make_shared<FusedStageComponent>("Head", "/fused/0", "/fused/1");
+    auto middle = std::make_shared<FusedStageComponent>("Middle", "/fused/1", "/fused/2");
+    auto tail = std::make_shared<FusedStageComponent>("Tail", "/fused/2", "/fused/3");
+    std::vector<ComponentProxy> chain{
+        manager.registerComponent(head),
+        manager.registerComponent(middle),
+        manager.registerComponent(tail)};
+    manager.fuse(chain);
+    manager.configure();
+    manager.startup();
+
+    auto waitHandled = [](FusedStageComponent& component, int count) {
+        while (component.fHandled < count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    // the fused stages run inside the setValue() of the head's handler
+    valueStore.setValue("/fused/0", TestValue(0));
+    waitHandled(*head, 1);
+    EXPECT_EQ(1, middle->fHandled);
+    EXPECT_EQ(1, tail->fHandled);
+    EXPECT_EQ(head->lastThread(), middle->lastThread());
+    EXPECT_EQ(head->lastThread(), tail->lastThread());
+    EXPECT_NE(std::this_thread::get_id(), head->lastThread());
+    EXPECT_EQ(3, valueStore.getValue<TestValue>("/fused/3")->val);
+
+    // a fused stage also runs inline on the thread of any other writer
+    valueStore.setValue("/fused/1", TestValue(10));
+    EXPECT_EQ(2, tail->fHandled);
+    EXPECT_EQ(std::this_thread::get_id(), middle->lastThread());
+    EXPECT_EQ(12, valueStore.getValue<TestValue>("/fused/3")->val);
+
+    // the error of an inline handler is logged, it does not fail the writer
+    EXPECT_NO_THROW(valueStore.setValue("/fused/1", TestValue(-1)));
+    EXPECT_EQ(2, tail->fHandled);
+    valueStore.setValue("/fused/1", TestValue(20));
+    EXPECT_EQ(3, tail->fHandled);
+
+    // without fusing, each stage runs on its own thread again
+    manager.fuse(chain, false);
+    valueStore.setValue("/fused/0", TestValue(0));
+    waitHandled(*tail, 4);
+    EXPECT_NE(head->lastThread(), middle->lastThread());
+    EXPECT_NE(middle->lastThread(), tail->lastThread());
+    manager.shutdown();
+}
+
+TEST_F(ComponentTest, HandlerPriority) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto component = std::make_shared<PriorityTestComponent>();
+    manager.registerComponent(component);
+    manager.configure();
+    manager.startup();
+
+    auto waitEvents = [&component](size_t count) {
+        while (component->events().size() < count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    // the control handler runs first, although the bulk handler became ready first
+    valueStore.setValue("/priority/kick", TestValue(0));
+    waitEvents(3);
+    EXPECT_EQ((std::vector<std::string>{"kick", "control", "bulk"}), component->events());
+
+    // the bulk handler lets the control handler run in between
+    valueStore.setValue("/priority/bulk", TestValue(1));
+    waitEvents(6);
+    EXPECT_EQ((std::vector<std::string>{"kick", "control", "bulk", "bulk", "control", "bulk done"}),
+              component->events());
+    manager.shutdown();
+}
+
+TEST_F(ComponentTest, AsyncContinuations) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto component = std::make_shared<AsyncRequestComponent>();
+    manager.registerComponent(component);
+    manager.configure();
+    manager.startup();
+
+    auto waitEvents = [&component](size_t count) {
+        while (component->events().size() < count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    // a reply arriving in time completes the request, the continuation then waits for a delay
+    valueStore.setValue("/async/start", TestValue(1));
+    while (!valueStore.hasValue("/async/request")) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    valueStore.setValue("/async/reply", TestValue(11));
+    waitEvents(1);
+    EXPECT_EQ((std::vector<std::string>{"reply 11"}), component->events());
+    waitEvents(2);
+    EXPECT_EQ((std::vector<std::string>{"reply 11", "delayed"}), component->events());
+
+    // without a reply, the continuation is called once on timeout; a late reply has no effect
+    valueStore.setValue("/async/start", TestValue(2));
+    waitEvents(3);
+    valueStore.setValue("/async/reply", TestValue(12));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ((std::vector<std::string>{"reply 11", "delayed", "timeout 2"}), component->events());
+
+    // functions posted from other threads run on the component thread as well
+    component->post([&component] { component->record("posted"); });
+    waitEvents(4);
+    EXPECT_EQ("posted", component->events().back());
+    manager.shutdown();
+    EXPECT_EQ(std::set<std::thread::id>{component->fHandlerThread}, component->fThreads);
+}
+
+TEST_F(ComponentTest, OverloadBudget) {
+    auto run = [](const Component::OverloadBudget& budget, const std::vector<std::vector<int>>& bursts) {
+        mcf::ValueStore valueStore;
+        mcf::ComponentManager manager(valueStore);
+        auto component = std::make_shared<OverloadComponent>();
+        component->setOverloadBudget(budget);
+        manager.registerComponent(component);
+        manager.configure();
+        manager.startup();
+        for (const auto& burst : bursts) {
+            // the first value of a burst keeps the handler busy while the others queue up
+            const int started = component->fStarted;
+            valueStore.setValue("/overload/in", TestValue(burst.front()));
+            while (component->fStarted == started) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            for (size_t i = 1; i < burst.size(); ++i) {
+                valueStore.setValue("/overload/in", TestValue(burst[i]));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        auto alarm = valueStore.hasValue("/mcf/overload/OverloadComponent")
+            ? valueStore.getValue<msg::OverloadAlarm>("/mcf/overload/OverloadComponent")
+            : nullptr;
+        manager.shutdown();
+        return std::make_tuple(component->handled(), component->getOverloadStatistics(), alarm);
+    };
+
+    // stale values are dropped, the handler catches up with the newest one
+    Component::OverloadBudget budget;
+    budget.maxQueueAge = std::chrono::milliseconds(20);
+    budget.policy = Component::OverloadPolicy::DROP_OLDEST;
+    auto result = run(budget, {{40, 1, 2, 3}});
+    EXPECT_EQ((std::vector<int>{40, 3}), std::get<0>(result));
+    EXPECT_EQ(1u, std::get<1>(result).queueAgeViolations);
+    EXPECT_EQ(2u, std::get<1>(result).droppedValues);
+    ASSERT_TRUE(std::get<2>(result));
+    EXPECT_EQ("queueAge", std::get<2>(result)->reason);
+    EXPECT_EQ(2u, std::get<2>(result)->dropped);
+
+    // the run after a handler overran its time budget is skipped
+    budget = Component::OverloadBudget();
+    budget.maxHandlerTime = std::chrono::milliseconds(10);
+    budget.policy = Component::OverloadPolicy::SKIP;
+    result = run(budget, {{30, 1}, {2}});
+    EXPECT_EQ((std::vector<int>{30, 2}), std::get<0>(result));
+    EXPECT_EQ(1u, std::get<1>(result).handlerTimeViolations);
+    EXPECT_EQ(1u, std::get<1>(result).skippedRuns);
+    EXPECT_EQ(1u, std::get<1>(result).droppedValues);
+    ASSERT_TRUE(std::get<2>(result));
+    EXPECT_EQ("handlerTime", std::get<2>(result)->reason);
+
+    // or degraded to the fallback handler
+    budget.policy = Component::OverloadPolicy::FALLBACK;
+    result = run(budget, {{30, 1}, {2}});
+    EXPECT_EQ((std::vector<int>{30, -1, 2}), std::get<0>(result));
+    EXPECT_EQ(1u, std::get<1>(result).fallbackRuns);
+
+    // alarms only
+    budget.policy = Component::OverloadPolicy::ALARM;
+    result = run(budget, {{30, 1}});
+    EXPECT_EQ((std::vector<int>{30, 1}), std::get<0>(result));
+    EXPECT_EQ(0u, std::get<1>(result).droppedValues);
+
+    // an overrun sheds the next run of the overrunning handler, not those of the others
+    budget.policy = Component::OverloadPolicy::SKIP;
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto component = std::make_shared<OverloadComponent>();
+    component->setOverloadBudget(budget);
+    manager.registerComponent(component);
+    manager.configure();
+    manager.startup();
+    valueStore.setValue("/overload/in", TestValue(30));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    valueStore.setValue("/overload/other", TestValue(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    valueStore.setValue("/overload/in", TestValue(2));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    manager.shutdown();
+    EXPECT_EQ((std::vector<int>{30, 101}), component->handled());
+    EXPECT_EQ(1u, component->getOverloadStatistics().skippedRuns);
+}
+
+TEST_F(ComponentTest, HandlerStatistics) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto component = std::make_shared<SlowHandlerComponent>();
+    component->setStatisticsInterval(std::chrono::milliseconds(200));
+    auto proxy = manager.registerComponent(component);
+    manager.configure();
+    manager.startup();
+    const std::string statsTopic = "/mcf/stats/" + proxy.name() + "/handlers";
+
+    auto handle = [&](int durationMs) {
+        const int handled = component->fHandled;
+        valueStore.setValue("/deadline/in", TestValue(durationMs));
+        while (component->fHandled == handled) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+    for (int i = 0; i < 9; ++i) {
+        handle(0);
+    }
+    handle(10);
+    auto stats = component->getStatistics();
+    ASSERT_EQ(1u, stats.entries.count("In"));
+    EXPECT_EQ(10, stats.entries["In"].count);
+    EXPECT_GE(stats.entries["In"].max, 10000);
+    EXPECT_FALSE(valueStore.hasValue(statsTopic));
+
+    // the first handler run after the end of the window publishes it
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    handle(0);
+    ASSERT_TRUE(valueStore.hasValue(statsTopic));
+    auto published = valueStore.getValue<msg::HandlerStats>(statsTopic);
+    EXPECT_EQ(proxy.name(), published->component);
+    EXPECT_GE(published->windowUs, 200000u);
+    auto it = std::find_if(published->handlers.begin(), published->handlers.end(),
+                           [](const msg::HandlerLatency& entry) { return entry.handler == "In"; });
+    ASSERT_NE(published->handlers.end(), it);
+    EXPECT_EQ(11u, it->count);
+    EXPECT_LT(it->p50Ns, 10000000u);
+    EXPECT_GE(it->maxNs, 10000000u);
+    EXPECT_LE(it->p50Ns, it->p99Ns);
+
+    // the published window was cleared, a reset clears the current one
+    handle(0);
+    EXPECT_LE(1, component->getStatistics().entries["In"].count);
+    msg::HandlerStatsControl control;
+    control.reset = true;
+    valueStore.setValue("/mcf/stats/" + proxy.name() + "/control", control);
+    for (int i = 0; i < 100 && component->getStatistics().entries["In"].count > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(0, component->getStatistics().entries["In"].count);
+    manager.shutdown();
+}
+
+TEST_F(ComponentTest, DeadlineMisses) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto component = std::make_shared<SlowHandlerComponent>();
+
+    // invalid deadline parameters are rejected
+    mcf::IComponent::SchedulingParameters parameters{mcf::IComponent::Deadline, 0};
+    EXPECT_THROW(component->ctrlSetSchedulingParameters(parameters), std::runtime_error);
+    parameters.runtime = std::chrono::milliseconds(2);
+    parameters.deadline = std::chrono::milliseconds(1);
+    EXPECT_THROW(component->ctrlSetSchedulingParameters(parameters), std::runtime_error);
+    parameters.deadline = std::chrono::milliseconds(4);
+    parameters.period = std::chrono::milliseconds(3);
+    EXPECT_THROW(component->ctrlSetSchedulingParameters(parameters), std::runtime_error);
+
+    // with the default policy, the deadline is only used for accounting
+    mcf::IComponent::SchedulingParameters accounting{mcf::IComponent::Default, 0};
+    accounting.deadline = std::chrono::milliseconds(20);
+    component->ctrlSetSchedulingParameters(accounting);
+
+    manager.registerComponent(component);
+    manager.configure();
+    manager.startup();
+    const int durations[] = {0, 50, 0, 50};
+    for (int i = 0; i < 4; ++i) {
+        valueStore.setValue("/deadline/in", TestValue(durations[i]));
+        while (component->fHandled < i + 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    // only the slow handler runs are counted
+    EXPECT_EQ(2u, component->getDeadlineMisses()["In"]);
+    manager.shutdown();
+}
+
+TEST_F(ComponentTest, Executor) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    manager.setExecutorThreads(2);
+    EXPECT_EQ(2u, manager.getExecutorThreads());
+
+    constexpr int NUM_COMPONENTS = 8;
+    std::vector<std::shared_ptr<ExecutorTestComponent>> components;
+    for (int i = 0; i < NUM_COMPONENTS; ++i) {
+        components.push_back(std::make_shared<ExecutorTestComponent>("Executor" + std::to_string(i)));
+    }
+    auto dedicated = std::make_shared<ExecutorTestComponent>("Dedicated");
+    for (const auto& component : components) {
+        manager.registerComponent(component);
+    }
+    manager.registerComponent(dedicated).setDedicatedThread(true);
+
+    manager.configure();
+    for (int round = 0; round < 2; ++round) {
+        manager.startup();
+        for (int i = 0; i <= 100; ++i) {
+            valueStore.setValue("/executor/in", TestValue(i));
+        }
+        auto allDone = [&components, &dedicated] {
+            for (const auto& component : components) {
+                if (component->fLastValue != 100) {
+                    return false;
+                }
+            }
+            return dedicated->fLastValue == 100;
+        };
+        for (int i = 0; i < 500 && !allDone(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        EXPECT_TRUE(allDone());
+        manager.shutdown();
+        for (const auto& component : components) {
+            EXPECT_EQ(IComponent::STOPPED, component->getState());
+            component->fLastValue = -1;
+        }
+        dedicated->fLastValue = -1;
+    }
+
+    // all pooled components ran on the two workers, the dedicated one on a thread of its own
+    std::set<std::thread::id> workers;
+    for (const auto& component : components) {
+        const auto ids = component->threadIds();
+        workers.insert(ids.begin(), ids.end());
+    }
+    EXPECT_LE(workers.size(), 2u);
+    for (const auto& id : dedicated->threadIds()) {
+        EXPECT_EQ(0u, workers.count(id));
+    }
+}
+
+TEST_F(ComponentTest, ReadyList) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto component = std::make_shared<ReadyListTestComponent>();
+    manager.registerComponent(component);
+    manager.configure();
+    manager.startup();
+
+    auto waitFor = [](const std::function<bool()>& condition) {
+        for (int i = 0; i < 200 && !condition(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return condition();
+    };
+
+    // only the handler of the port which received a value runs, the trigger handlers do not
+    valueStore.setValue("/ready/3", TestValue(1));
+    EXPECT_TRUE(waitFor([&component] { return component->fPortCalls[3] == 1; }));
+    valueStore.setValue("/ready/11", TestValue(2));
+    EXPECT_TRUE(waitFor([&component] { return component->fPortCalls[11] == 1; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int i = 0; i < ReadyListTestComponent::NUM_PORTS; ++i) {
+        EXPECT_EQ((i == 3 || i == 11) ? 1 : 0, component->fPortCalls[i]) << "port " << i;
+    }
+    EXPECT_EQ(0, component->fTriggerCalls);
+
+    // an explicit trigger runs the trigger handlers
+    component->triggerFromOutside();
+    EXPECT_TRUE(waitFor([&component] { return component->fTriggerCalls == 1; }));
+    EXPECT_EQ(1, component->fPortCalls[3]);
+
+    // handlers keep working after a restart
+    manager.shutdown();
+    manager.startup();
+    valueStore.setValue("/ready/5", TestValue(3));
+    EXPECT_TRUE(waitFor([&component] { return component->fPortCalls[5] == 1; }));
+    manager.shutdown();
+}
+
+TEST_F(ComponentTest, ParallelLifecycle) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto sender = std::make_shared<LifecycleTestComponent>("Sender", "/lifecycle/a", true);
+    auto receiver = std::make_shared<LifecycleTestComponent>("Receiver", "/lifecycle/a", false);
+    auto first = std::make_shared<LifecycleTestComponent>("First", "/lifecycle/b", true);
+    auto second = std::make_shared<LifecycleTestComponent>("Second", "/lifecycle/c", true);
+    auto other = std::make_shared<LifecycleTestComponent>("Other", "/lifecycle/d", true);
+
+    manager.setLifecycleThreads(4);
+    manager.registerComponent(sender);
+    manager.registerComponent(receiver);
+    manager.registerComponent(other);
+    auto firstProxy = manager.registerComponent(first);
+    auto secondProxy = manager.registerComponent(second);
+    manager.addDependency(secondProxy, firstProxy);
+
+    ASSERT_TRUE(manager.configure());
+    manager.startup();
+
+    std::map<std::pair<std::string, std::string>, ComponentManager::LifecycleTimelineEntry> timeline;
+    for (const auto& entry : manager.getLifecycleTimeline()) {
+        EXPECT_LE(entry.begin, entry.end);
+        timeline.emplace(std::make_pair(entry.phase, entry.component), entry);
+    }
+    ASSERT_EQ(10u, timeline.size());
+
+    // declared dependencies apply to configure and startup
+    for (const std::string phase : {"configure", "startup"}) {
+        EXPECT_GE(timeline.at({phase, "Second"}).begin, timeline.at({phase, "First"}).end);
+        EXPECT_FALSE(timeline.at({phase, "Other"}).critical);
+    }
+    // the only chain when configuring, port connections are not known yet
+    EXPECT_TRUE(timeline.at({"configure", "First"}).critical);
+    EXPECT_TRUE(timeline.at({"configure", "Second"}).critical);
+    EXPECT_FALSE(timeline.at({"configure", "Receiver"}).critical);
+    // receivers start after the senders of their topic
+    EXPECT_GE(timeline.at({"startup", "Receiver"}).begin, timeline.at({"startup", "Sender"}).end);
+
+    EXPECT_EQ(IComponent::RUNNING, sender->getState());
+    EXPECT_EQ(IComponent::RUNNING, receiver->getState());
+    ComponentManager::ShutdownOptions options;
+    options.numThreads = 4;
+    manager.setShutdownOptions(options);
+    manager.shutdown();
+    EXPECT_EQ(IComponent::STOPPED, sender->getState());
+    EXPECT_EQ(IComponent::STOPPED, receiver->getState());
+
+    // stopped in reverse order, the independent ones in parallel
+    timeline.clear();
+    for (const auto& entry : manager.getLifecycleTimeline()) {
+        timeline.emplace(std::make_pair(entry.phase, entry.component), entry);
+    }
+    ASSERT_EQ(15u, timeline.size());
+    EXPECT_GE(timeline.at({"shutdown", "Sender"}).begin, timeline.at({"shutdown", "Receiver"}).end);
+    EXPECT_GE(timeline.at({"shutdown", "First"}).begin, timeline.at({"shutdown", "Second"}).end);
+    EXPECT_LT(timeline.at({"shutdown", "Other"}).begin, timeline.at({"shutdown", "Receiver"}).end);
+}
+
+TEST_F(ComponentTest, ConcurrentHandlers) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    manager.setExecutorThreads(2);
+    auto component = std::make_shared<ConcurrentTestComponent>();
+    manager.registerComponent(component);
+    manager.configure();
+    manager.startup();
+
+    std::thread producerB([&valueStore] {
+        for (int i = 0; i <= 200; ++i) {
+            valueStore.setValue("/concurrent/b", TestValue(i));
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+    for (int i = 0; i <= 200; ++i) {
+        valueStore.setValue("/concurrent/a", TestValue(i));
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    producerB.join();
+    for (int i = 0; i < 500 && (component->fLastA != 200 || component->fLastB != 200); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(200, component->fLastA);
+    EXPECT_EQ(200, component->fLastB);
+    // the handlers of the two ports ran in parallel on the two workers
+    EXPECT_TRUE(component->fOverlapped);
+    manager.shutdown();
+    EXPECT_EQ(IComponent::STOPPED, component->getState());
+}
+
+TEST_F(ComponentTest, TopologyGeneration) {
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+
+    uint64_t generation = manager.getTopologyGeneration();
+    auto tcDesc = manager.registerComponent(std::make_shared<ComponentTest::TestComponent>());
+    EXPECT_NE(generation, manager.getTopologyGeneration());
+
+    // the ports are registered on configuration
+    generation = manager.getTopologyGeneration();
+    manager.configure();
+    EXPECT_NE(generation, manager.getTopologyGeneration());
+
+    // connecting ports does not change the topology
+    generation = manager.getTopologyGeneration();
+    manager.startup();
+    EXPECT_EQ(generation, manager.getTopologyGeneration());
+
+    manager.mapPort(tcDesc, "Tick", "/tock");
+    EXPECT_NE(generation, manager.getTopologyGeneration());
+
+    generation = manager.getTopologyGeneration();
+    manager.eraseComponent(tcDesc);
+    EXPECT_NE(generation, manager.getTopologyGeneration());
+
+    manager.shutdown();
+}
+
 }
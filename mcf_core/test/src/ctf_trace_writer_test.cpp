@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/CtfTraceWriter.h"
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace mcf {
+
+namespace {
+
+const std::string TRACE_DIR = "ctf_trace_test";
+
+std::string readFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+template<typename T>
+T readAt(const std::string& data, size_t offset)
+{
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+
+TraceRecord makeRecord(TraceEventType type, uint64_t time)
+{
+    TraceStringTable& strings = TraceStringTable::instance();
+    TraceRecord record{};
+    record.type = type;
+    record.time = time;
+    record.traceId = strings.intern("FLUX");
+    record.component = strings.intern("Component");
+    record.threadId = 42;
+    record.cpuId = 3;
+    return record;
+}
+
+void removeTrace()
+{
+    std::remove((TRACE_DIR + "/metadata").c_str());
+    std::remove((TRACE_DIR + "/channel0_0").c_str());
+    rmdir(TRACE_DIR.c_str());
+}
+
+} // anonymous namespace
+
+TEST(CtfTraceWriterTest, WritesStream) {
+    removeTrace();
+    TraceStringTable& strings = TraceStringTable::instance();
+    CtfTraceWriter writer(TRACE_DIR, "channel0_0", std::chrono::microseconds(100));
+
+    TraceRecord write = makeRecord(TraceEventType::PORT_WRITE, 1000);
+    write.topic = strings.intern("/topic");
+    write.connected = 1;
+    write.valueId = 7;
+    // ended last, started first
+    TraceRecord exec = makeRecord(TraceEventType::EXEC_TIME, 1050);
+    exec.name = strings.intern("handler");
+    exec.executionTime = 100.e-6f;
+    std::vector<TraceRecord> records = {write, exec};
+    writer.consume(records.data(), records.size());
+    // the exec start is written, the others are within the reorder window
+    EXPECT_EQ(1u, writer.eventsWritten());
+
+    // arrives too late for its time
+    TraceRecord flow = makeRecord(TraceEventType::PROGRAM_FLOW, 2000);
+    flow.name = strings.intern("event");
+    TraceRecord late = makeRecord(TraceEventType::PORT_READ, 900);
+    late.topic = write.topic;
+    records = {flow, late};
+    writer.consume(records.data(), records.size());
+    EXPECT_EQ(4u, writer.eventsWritten());
+    writer.close();
+    EXPECT_EQ(5u, writer.eventsWritten());
+    EXPECT_EQ(1u, writer.lateEvents());
+
+    EXPECT_EQ(CtfTraceWriter::metadata(), readFile(TRACE_DIR + "/metadata"));
+
+    const std::string stream = readFile(TRACE_DIR + "/channel0_0");
+    ASSERT_GE(stream.size(), 24u);
+    EXPECT_EQ(0xc1fc1fc1u, readAt<uint32_t>(stream, 0));
+    EXPECT_EQ(0u, readAt<uint32_t>(stream, 4));
+    EXPECT_EQ(950u, readAt<uint64_t>(stream, 8));
+    EXPECT_EQ(2000u, readAt<uint64_t>(stream, 16));
+
+    // exec_start
+    size_t offset = 24;
+    EXPECT_EQ(30u, readAt<uint16_t>(stream, offset));
+    EXPECT_EQ(950u, readAt<uint64_t>(stream, offset + 2));
+    offset += 10;
+    EXPECT_EQ(std::string("FLUX"), stream.c_str() + offset);
+    offset += 5;
+    EXPECT_EQ(std::string("FLUX:Component"), stream.c_str() + offset);
+    offset += 15;
+    EXPECT_EQ(std::string("handler"), stream.c_str() + offset);
+    offset += 8;
+    EXPECT_FLOAT_EQ(100.e-6f, readAt<float>(stream, offset));
+    EXPECT_EQ(42, readAt<int32_t>(stream, offset + 4));
+    EXPECT_EQ(3, readAt<int32_t>(stream, offset + 8));
+    offset += 12;
+
+    // port_read, written with the time of the exec start
+    EXPECT_EQ(20u, readAt<uint16_t>(stream, offset));
+    EXPECT_EQ(950u, readAt<uint64_t>(stream, offset + 2));
+    offset += 10 + 5 + 15 + 13 + 12 + 1 + 8 + 8;
+
+    // port_write
+    EXPECT_EQ(10u, readAt<uint16_t>(stream, offset));
+    EXPECT_EQ(1000u, readAt<uint64_t>(stream, offset + 2));
+    offset += 10 + 5 + 15;
+    EXPECT_EQ(std::string("FLUX:unnamed"), stream.c_str() + offset);
+    offset += 13;
+    EXPECT_EQ(std::string("FLUX:/topic"), stream.c_str() + offset);
+    offset += 12;
+    EXPECT_EQ(1u, readAt<uint8_t>(stream, offset));
+    EXPECT_EQ(7u, readAt<uint64_t>(stream, offset + 1));
+    offset += 1 + 8 + 8;
+
+    // exec_end
+    EXPECT_EQ(35u, readAt<uint16_t>(stream, offset));
+    EXPECT_EQ(1050u, readAt<uint64_t>(stream, offset + 2));
+    offset += 10 + 5 + 15 + 8 + 12;
+
+    // program_flow
+    EXPECT_EQ(80u, readAt<uint16_t>(stream, offset));
+    EXPECT_EQ(2000u, readAt<uint64_t>(stream, offset + 2));
+    offset += 10 + 5 + 15;
+    EXPECT_EQ(std::string("FLUX:event"), stream.c_str() + offset);
+    offset += 11 + 8;
+    EXPECT_EQ(stream.size(), offset);
+
+    removeTrace();
+}
+
+TEST(CtfTraceWriterTest, InvalidDirectory) {
+    EXPECT_THROW(CtfTraceWriter("/nonexistent/ctf_trace"), std::runtime_error);
+}
+
+} // namespace mcf
@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/ExtMemPool.h"
+#include "mcf_core/ExtMemValue.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace mcf {
+
+namespace {
+
+struct CameraImage : public ExtMemValue<uint8_t> {
+protected:
+    ExtMemPool& extMemPool() const override { return ExtMemPool::named("ExtMemPoolTest.camera"); }
+};
+
+} // anonymous namespace
+
+TEST(ExtMemPoolTest, SizeClass) {
+    EXPECT_EQ(4096u, ExtMemPool::sizeClass(1));
+    EXPECT_EQ(4096u, ExtMemPool::sizeClass(4096));
+    EXPECT_EQ(5120u, ExtMemPool::sizeClass(4097));
+    EXPECT_EQ(8192u, ExtMemPool::sizeClass(8000));
+    // images of slightly different size share a class
+    EXPECT_EQ(24u << 20, ExtMemPool::sizeClass(24000000));
+    EXPECT_EQ(24u << 20, ExtMemPool::sizeClass(25000000));
+}
+
+TEST(ExtMemPoolTest, Recycling) {
+    ExtMemPool& pool = ExtMemPool::named("ExtMemPoolTest.camera");
+    ExtMemPool::Config config;
+    config.maxCachedBytes = 1 << 20;
+    pool.configure(config);
+
+    const void* address = nullptr;
+    {
+        CameraImage image;
+        image.extMemInit(100000);
+        std::memset(image.extMemPtr(), 0xff, image.extMemSize());
+        address = image.extMemPtr();
+    }
+    EXPECT_EQ(ExtMemPool::sizeClass(100000), pool.statistics().cachedBytes);
+
+    // the buffer of the first image is reused and zeroed for the second one
+    CameraImage image;
+    image.extMemInit(99000);
+    EXPECT_EQ(address, image.extMemPtr());
+    EXPECT_EQ(0, image.extMemPtr()[98999]);
+    EXPECT_EQ(1u, pool.statistics().hits);
+    EXPECT_EQ(1u, pool.statistics().misses);
+    EXPECT_EQ(0u, pool.statistics().cachedBytes);
+
+    // values without own pool do not touch the camera pool
+    ExtMemValue<uint8_t> other;
+    other.extMemInit(100000);
+    EXPECT_NE(nullptr, other.extMemPtr());
+    EXPECT_EQ(1u, pool.statistics().misses);
+}
+
+TEST(ExtMemPoolTest, Limit) {
+    ExtMemPool& pool = ExtMemPool::named("ExtMemPoolTest.limit");
+    ExtMemPool::Config config;
+    config.maxCachedBytes = 8192;
+    pool.configure(config);
+
+    {
+        ExtMemPool::Buffer first = pool.allocate(4096);
+        ExtMemPool::Buffer second = pool.allocate(4096);
+        ExtMemPool::Buffer third = pool.allocate(4096);
+    }
+    EXPECT_EQ(3u, pool.statistics().misses);
+    EXPECT_EQ(1u, pool.statistics().dropped);
+    EXPECT_EQ(8192u, pool.statistics().cachedBytes);
+
+    config.maxCachedBytes = 4096;
+    pool.configure(config);
+    EXPECT_EQ(4096u, pool.statistics().cachedBytes);
+
+    pool.trim();
+    EXPECT_EQ(0u, pool.statistics().cachedBytes);
+}
+
+TEST(ExtMemPoolTest, NumaNodeKeptWhileRecycled) {
+    ExtMemPool& pool = ExtMemPool::named("ExtMemPoolTest.numa");
+    ExtMemPool::Config config;
+    config.maxCachedBytes = 1 << 20;
+    pool.configure(config);
+
+    {
+        ExtMemPool::Buffer buffer = pool.allocate(4096);
+        EXPECT_EQ(-1, buffer.numaNode());
+        buffer.setNumaNode(0);
+    }
+    // the recycled buffer need not be migrated again
+    EXPECT_EQ(0, pool.allocate(4096).numaNode());
+}
+
+TEST(ExtMemPoolTest, Alignment) {
+    ExtMemPool& pool = ExtMemPool::named("ExtMemPoolTest.alignment");
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(pool.allocate(100).data()) % 64);
+
+    ExtMemPool::Config config;
+    config.alignment = 4096;
+    pool.configure(config);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(pool.allocate(100).data()) % 4096);
+
+    config.alignment = 48;
+    EXPECT_THROW(pool.configure(config), std::runtime_error);
+}
+
+TEST(ExtMemPoolTest, HugePages) {
+    ExtMemPool& pool = ExtMemPool::named("ExtMemPoolTest.hugePages");
+    ExtMemPool::Config config;
+    config.maxCachedBytes = 16 << 20;
+    config.hugePages = ExtMemPool::HugePages::TRANSPARENT;
+    pool.configure(config);
+
+    // large buffers are whole huge pages, small ones are not affected
+    {
+        ExtMemPool::Buffer buffer = pool.allocate(5000000);
+        EXPECT_EQ(6u << 20, buffer.capacity());
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(buffer.data()) % ExtMemPool::HUGE_PAGE_SIZE);
+        EXPECT_EQ(0, static_cast<const char*>(buffer.data())[4999999]);
+    }
+    EXPECT_EQ(4096u, pool.allocate(100).capacity());
+
+    // changing the pages drops the cached buffers, explicit huge pages may not be reserved
+    config.hugePages = ExtMemPool::HugePages::EXPLICIT;
+    pool.configure(config);
+    EXPECT_EQ(0u, pool.statistics().cachedBytes);
+    {
+        ExtMemPool::Buffer buffer = pool.allocate(5000000);
+        EXPECT_NE(nullptr, buffer.data());
+        EXPECT_EQ(6u << 20, buffer.capacity());
+    }
+    ExtMemPool::Buffer buffer = pool.allocate(5000000);
+    EXPECT_EQ(1u, pool.statistics().hits);
+    EXPECT_LE(pool.statistics().hugePageFallbacks, 1u);
+}
+
+TEST(ExtMemPoolTest, Disabled) {
+    ExtMemPool& pool = ExtMemPool::named("ExtMemPoolTest.disabled");
+    {
+        ExtMemPool::Buffer buffer = pool.allocate(4096);
+        EXPECT_NE(nullptr, buffer.data());
+        EXPECT_EQ(4096u, buffer.capacity());
+    }
+    EXPECT_EQ(0u, pool.statistics().cachedBytes);
+    pool.allocate(4096);
+    EXPECT_EQ(0u, pool.statistics().hits);
+    EXPECT_EQ(2u, pool.statistics().misses);
+}
+
+} // namespace mcf
@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/ExtMemValue.h"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace mcf {
+
+namespace {
+
+std::shared_ptr<ExtMemValue<uint8_t>> makeImage(uint64_t width, uint64_t height) {
+    auto image = std::make_shared<ExtMemValue<uint8_t>>();
+    image->extMemInit(width * height);
+    uint8_t* data = image->extMemPtr();
+    for (uint64_t i = 0; i < width * height; ++i) {
+        data[i] = static_cast<uint8_t>(i);
+    }
+    return image;
+}
+
+} // anonymous namespace
+
+TEST(ExtMemViewTest, Contiguous) {
+    auto batch = makeImage(16, 4);
+    const uint8_t* batchData = static_cast<const ExtMemValue<uint8_t>&>(*batch).extMemPtr();
+
+    ExtMemValue<uint8_t> camera;
+    ASSERT_TRUE(camera.extMemInitView(batch, 32, 16));
+    EXPECT_EQ(16u, camera.extMemSize());
+
+    // refers to the memory of the parent, which it keeps alive
+    const auto& view = camera;
+    EXPECT_EQ(batchData + 32, view.extMemPtr());
+    std::weak_ptr<ExtMemValue<uint8_t>> parent = batch;
+    batch.reset();
+    EXPECT_FALSE(parent.expired());
+    EXPECT_EQ(32, view.extMemPtr()[0]);
+
+    // writing copies the view
+    camera.extMemPtr()[0] = 0xff;
+    EXPECT_TRUE(parent.expired());
+    EXPECT_EQ(0xff, view.extMemPtr()[0]);
+    EXPECT_EQ(33, view.extMemPtr()[1]);
+}
+
+TEST(ExtMemViewTest, Strided) {
+    auto image = makeImage(16, 8);
+    const uint8_t* imageData = static_cast<const ExtMemValue<uint8_t>&>(*image).extMemPtr();
+
+    // region of interest of 4x3 pixels at (2, 1)
+    ExtMemValue<uint8_t> roi;
+    ASSERT_TRUE(roi.extMemInitView(image, 16 + 2, 4, 16, 3));
+    EXPECT_EQ(12u, roi.extMemSize());
+    EXPECT_EQ(imageData + 3 * 16 + 2, roi.extMemRow(2));
+
+    // packed for serialization
+    const auto& view = roi;
+    const uint8_t* packed = view.extMemPtr();
+    EXPECT_EQ(18, packed[0]);
+    EXPECT_EQ(21, packed[3]);
+    EXPECT_EQ(34, packed[4]);
+    EXPECT_EQ(53, packed[11]);
+}
+
+TEST(ExtMemViewTest, Bounds) {
+    auto image = makeImage(16, 8);
+    ExtMemValue<uint8_t> view;
+    EXPECT_THROW(view.extMemInitView(image, 120, 16), std::runtime_error);
+    EXPECT_THROW(view.extMemInitView(image, 0, 8, 16, 9), std::runtime_error);
+    EXPECT_TRUE(view.extMemInitView(image, 0, 8, 16, 8));
+
+    ExtMemValue<uint16_t> misaligned;
+    EXPECT_FALSE(misaligned.extMemInitView(image, 1, 4));
+}
+
+} // namespace mcf
@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/FlatValue.h"
+#include "mcf_core/Value.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mcf {
+
+namespace {
+
+/*
+ * Flat packed value as generated by the types generator for
+ * { id: uint16_t, valid: bool, name: string, samples: vector<double>, tags: map<string, int> }
+ */
+struct FlatTestValue : public Value {
+    uint16_t id = 0;
+    bool valid = false;
+    std::string name;
+    std::vector<double> samples;
+    std::map<std::string, int> tags;
+
+    static constexpr std::size_t FLAT_FIXED_SIZE = 32;
+
+    class View {
+    public:
+        explicit View(const msgpack::object& object) : fReader(object, FLAT_FIXED_SIZE) {}
+        View(const char* data, std::size_t size) : fReader(data, size, FLAT_FIXED_SIZE) {}
+
+        uint16_t id() const { return fReader.scalar<uint16_t>(0); }
+        bool valid() const { return fReader.scalar<uint8_t>(2) != 0; }
+        flat::String name() const { return fReader.string(4); }
+        flat::Array<double> samples() const { return fReader.array<double>(12); }
+        std::map<std::string, int> tags() const { return fReader.unpacked<std::map<std::string, int>>(20); }
+
+    private:
+        flat::Reader fReader;
+    };
+
+    template<typename Packer>
+    void msgpack_pack(Packer& packer) const {
+        flat::Writer writer(FLAT_FIXED_SIZE);
+        writer.scalar<uint16_t>(0, id);
+        writer.scalar<uint8_t>(2, valid ? 1 : 0);
+        writer.string(4, name);
+        writer.array(12, samples);
+        writer.packed(20, tags);
+        writer.pack(packer);
+    }
+
+    void msgpack_unpack(const msgpack::object& object) {
+        const View view(object);
+        id = view.id();
+        valid = view.valid();
+        name = view.name().str();
+        samples = view.samples().vec();
+        tags = view.tags();
+    }
+};
+
+} // anonymous namespace
+
+TEST(FlatValueTest, RoundTrip) {
+    FlatTestValue value;
+    value.id = 4711;
+    value.valid = true;
+    value.name = "front";
+    value.samples = {1.5, -2.25, 1e300};
+    value.tags = {{"a", 1}, {"b", -2}};
+
+    msgpack::sbuffer buffer;
+    msgpack::pack(buffer, value);
+    auto handle = msgpack::unpack(buffer.data(), buffer.size());
+    ASSERT_EQ(msgpack::type::BIN, handle.get().type);
+
+    // read in place
+    const FlatTestValue::View view(handle.get());
+    EXPECT_EQ(4711, view.id());
+    EXPECT_TRUE(view.valid());
+    EXPECT_EQ("front", view.name().str());
+    ASSERT_EQ(3u, view.samples().size());
+    EXPECT_EQ(-2.25, view.samples()[1]);
+    EXPECT_EQ(-2, view.tags().at("b"));
+
+    // unpacked
+    const auto copy = handle.get().as<FlatTestValue>();
+    EXPECT_EQ(value.id, copy.id);
+    EXPECT_EQ(value.valid, copy.valid);
+    EXPECT_EQ(value.name, copy.name);
+    EXPECT_EQ(value.samples, copy.samples);
+    EXPECT_EQ(value.tags, copy.tags);
+}
+
+TEST(FlatValueTest, EmptyAttributes) {
+    FlatTestValue value;
+    msgpack::sbuffer buffer;
+    msgpack::pack(buffer, value);
+    auto handle = msgpack::unpack(buffer.data(), buffer.size());
+
+    const auto copy = handle.get().as<FlatTestValue>();
+    EXPECT_TRUE(copy.name.empty());
+    EXPECT_TRUE(copy.samples.empty());
+    EXPECT_TRUE(copy.tags.empty());
+}
+
+TEST(FlatValueTest, Bounds) {
+    // shorter than the fixed part
+    std::vector<char> data(FlatTestValue::FLAT_FIXED_SIZE - 1, 0);
+    EXPECT_THROW(FlatTestValue::View(data.data(), data.size()), std::runtime_error);
+
+    // the name refers beyond the end
+    flat::Writer writer(FlatTestValue::FLAT_FIXED_SIZE);
+    writer.string(4, "name");
+    data.assign(writer.data(), writer.data() + writer.size() - 1);
+    const FlatTestValue::View view(data.data(), data.size());
+    EXPECT_THROW(view.name(), std::runtime_error);
+    EXPECT_EQ(0, view.id());
+
+    // a msgpack object which is not a bin
+    msgpack::sbuffer buffer;
+    msgpack::pack(buffer, 42);
+    auto handle = msgpack::unpack(buffer.data(), buffer.size());
+    EXPECT_THROW(FlatTestValue::View view(handle.get()), msgpack::type_error);
+}
+
+} // namespace mcf
@@ -43,6 +43,20 @@ public:
         mcf::SenderPort<TestValue> fTackPort;
     };
 
+    class FailingComponent : public mcf::Component
+    {
+    public:
+        FailingComponent() : mcf::Component("FailingComponent"), fTickPort(*this, "Tick") {}
+
+        void configure(mcf::IComponentConfig& config)
+        {
+            config.registerPort(fTickPort, "/tick");
+            throw std::runtime_error("configuration failed");
+        }
+
+        mcf::ReceiverPort<TestValue> fTickPort;
+    };
+
     class CounterReceiver : public mcf::Component
     {
     public:
@@ -87,6 +101,40 @@ public:
         std::atomic<uint64_t> fCounter;
     };
 
+    class QueuedSummer : public mcf::Component
+    {
+    public:
+        QueuedSummer() : mcf::Component("QueuedSummer"), fNumberPort(*this, "Number", 0)
+        {
+            fNumberPort.registerHandler(std::bind(&QueuedSummer::add, this));
+            latest() = this;
+        }
+
+        static QueuedSummer*& latest()
+        {
+            static QueuedSummer* instance = nullptr;
+            return instance;
+        }
+
+        void configure(mcf::IComponentConfig& config)
+        {
+            config.registerPort(fNumberPort, "/number");
+        }
+
+        void add()
+        {
+            while (fNumberPort.hasValue())
+            {
+                fSum += fNumberPort.getValue()->val;
+                ++fCount;
+            }
+        }
+
+        mcf::QueuedReceiverPort<TestValue> fNumberPort;
+        std::atomic<int> fSum{0};
+        std::atomic<int> fCount{0};
+    };
+
     template <typename T>
     void waitForQueue(mcf::QueuedReceiverPort<T>& port)
     {
@@ -102,14 +150,14 @@ public:
             }
         }
     }
+
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager{valueStore};
+    mcf::ComponentInstantiator instantiator{manager};
 };
 
 TEST_F(InstantiatorTest, SimpleInstantiation)
 {
-    mcf::ValueStore valueStore;
-    mcf::ComponentManager manager(valueStore);
-    mcf::ComponentInstantiator instantiator(manager);
-
     instantiator.addComponentType(ComponentType::create<TestComponent>("esrlabs/Test"));
 
     auto loadedTypes = instantiator.listComponentTypes();
@@ -133,10 +181,6 @@ TEST_F(InstantiatorTest, SimpleInstantiation)
 
 TEST_F(InstantiatorTest, InstantiateAndCleanup)
 {
-    mcf::ValueStore valueStore;
-    mcf::ComponentManager manager(valueStore);
-    mcf::ComponentInstantiator instantiator(manager);
-
     instantiator.addComponentType(ComponentType::create<TestComponent>("esrlabs/Test"));
 
     auto loadedTypes = instantiator.listComponentTypes();
@@ -170,10 +214,6 @@ TEST_F(InstantiatorTest, InstantiateAndCleanup)
 
 TEST_F(InstantiatorTest, Restart)
 {
-    mcf::ValueStore valueStore;
-    mcf::ComponentManager manager(valueStore);
-    mcf::ComponentInstantiator instantiator(manager);
-
     instantiator.addComponentType(ComponentType::create<TestComponent3>("esrlabs/Test"));
 
     auto proxy    = instantiator.createComponent("esrlabs/Test", "test1");
@@ -219,12 +259,90 @@ TEST_F(InstantiatorTest, Restart)
     manager.shutdown();
 }
 
-TEST_F(InstantiatorTest, Exceptions)
+TEST_F(InstantiatorTest, HotReload)
 {
-    mcf::ValueStore valueStore;
-    mcf::ComponentManager manager(valueStore);
-    mcf::ComponentInstantiator instantiator(manager);
+    instantiator.addComponentType(ComponentType::create<QueuedSummer>("esrlabs/Summer"));
+    instantiator.createComponent("esrlabs/Summer", "summer");
+
+    manager.configure();
+    manager.startup();
+
+    // values written while the component is reloaded are handed over to the new instance
+    const int numValues = 2000;
+    std::thread writer([this, numValues] {
+        for (int i = 1; i <= numValues; ++i)
+        {
+            valueStore.setValue("/number", TestValue(i));
+            if (i % 100 == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    for (int reload = 0; reload < 3; ++reload)
+    {
+        instantiator.hotReloadComponent("summer", [](IComponent& previous, IComponent& next) {
+            auto& from = dynamic_cast<QueuedSummer&>(previous);
+            auto& to   = dynamic_cast<QueuedSummer&>(next);
+            to.fSum.store(from.fSum.load());
+            to.fCount.store(from.fCount.load());
+        });
+    }
+    writer.join();
+
+    ASSERT_EQ(1, manager.getComponents().size());
+    ASSERT_EQ(1, instantiator.listComponents().size());
+    auto* summer = QueuedSummer::latest();
+    for (int i = 0; i < 100 && summer->fCount < numValues; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(numValues, summer->fCount);
+    EXPECT_EQ(numValues * (numValues + 1) / 2, summer->fSum);
+
+    const auto statistics = manager.getReloadStatistics();
+    ASSERT_EQ(3, statistics.size());
+    EXPECT_EQ("summer", statistics[0].component);
+    EXPECT_EQ(1, statistics[0].handedOverQueues);
+    EXPECT_LE(statistics[0].stall, statistics[0].duration);
 
+    manager.shutdown();
+}
+
+TEST_F(InstantiatorTest, HotReloadFailingConfigure)
+{
+    instantiator.addComponentType(ComponentType::create<TestComponent>("esrlabs/Test"));
+    auto proxy = instantiator.createComponent("esrlabs/Test", "test1");
+    manager.configure();
+    manager.startup();
+
+    // the new instance is erased again, the previous one keeps running
+    EXPECT_THROW(manager.replaceComponent(proxy, std::make_shared<FailingComponent>(), "esrlabs/Failing"),
+                 std::runtime_error);
+    const auto components = manager.getComponents();
+    ASSERT_EQ(1, components.size());
+    EXPECT_EQ(proxy.id(), components[0].id());
+    EXPECT_TRUE(manager.getReloadStatistics().empty());
+
+    valueStore.setValue("/tick", TestValue(7));
+    for (int i = 0; i < 100 && !valueStore.hasValue("/tack"); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(valueStore.hasValue("/tack"));
+    EXPECT_EQ(7, valueStore.getValue<TestValue>("/tack")->val);
+
+    // and can still be replaced
+    instantiator.hotReloadComponent("test1");
+    EXPECT_EQ(1, manager.getReloadStatistics().size());
+
+    manager.shutdown();
+}
+
+TEST_F(InstantiatorTest, Exceptions)
+{
     instantiator.addComponentType(ComponentType::create<TestComponent>("esrlabs/Test"));
     EXPECT_THROW(
         instantiator.addComponentType(ComponentType::create<TestComponent>("esrlabs/Test")),
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/LatencyHistogram.h"
+
+#include <thread>
+#include <vector>
+
+namespace mcf {
+
+TEST(LatencyHistogramTest, Buckets) {
+    // small values are exact
+    for (uint64_t ns = 0; ns < LatencyHistogram::SUB_BUCKETS; ++ns) {
+        EXPECT_EQ(ns, LatencyHistogram::bucketIndex(ns));
+    }
+    // buckets are contiguous and every value lies within its bucket, accurate to about 3%
+    for (size_t i = 1; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+        EXPECT_EQ(LatencyHistogram::bucketUpperBound(i - 1) + 1, LatencyHistogram::bucketLowerBound(i));
+    }
+    for (uint64_t ns : std::vector<uint64_t>{64, 100, 1000, 123456, 999999999, LatencyHistogram::MAX_VALUE}) {
+        const size_t index = LatencyHistogram::bucketIndex(ns);
+        ASSERT_LT(index, LatencyHistogram::NUM_BUCKETS);
+        EXPECT_LE(LatencyHistogram::bucketLowerBound(index), ns);
+        EXPECT_GE(LatencyHistogram::bucketUpperBound(index), ns);
+        EXPECT_LE(LatencyHistogram::bucketUpperBound(index) - LatencyHistogram::bucketLowerBound(index),
+                  ns / 32);
+    }
+    EXPECT_EQ(LatencyHistogram::NUM_BUCKETS - 1, LatencyHistogram::bucketIndex(LatencyHistogram::MAX_VALUE));
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(0u, histogram.summary().count);
+    EXPECT_EQ(0u, histogram.summary().p99);
+
+    // 1..10000 us
+    for (uint64_t us = 1; us <= 10000; ++us) {
+        histogram.record(us * 1000);
+    }
+    const auto summary = histogram.summary();
+    EXPECT_EQ(10000u, summary.count);
+    EXPECT_EQ(uint64_t(50005000) * 1000, summary.sum);
+    EXPECT_NEAR(1000.0, summary.min, 1000.0 * 0.04);
+    EXPECT_NEAR(5000000.0, summary.p50, 5000000.0 * 0.04);
+    EXPECT_NEAR(9900000.0, summary.p99, 9900000.0 * 0.04);
+    EXPECT_NEAR(9990000.0, summary.p999, 9990000.0 * 0.04);
+    EXPECT_EQ(10000000u, summary.max);
+    EXPECT_LE(summary.p999, summary.max);
+
+    // a single outlier shows up in the maximum, not in the median
+    histogram.record(uint64_t(1) << 40);
+    EXPECT_EQ(LatencyHistogram::MAX_VALUE, histogram.summary().max);
+    EXPECT_NEAR(5000000.0, histogram.summary().p50, 5000000.0 * 0.04);
+
+    // taking the summary starts a new window
+    EXPECT_EQ(10001u, histogram.takeSummary().count);
+    EXPECT_EQ(0u, histogram.summary().count);
+    EXPECT_EQ(0u, histogram.summary().max);
+}
+
+TEST(LatencyHistogramTest, ConcurrentRecording) {
+    LatencyHistogram histogram;
+    constexpr int NUM_THREADS = 4;
+    constexpr int NUM_VALUES = 10000;
+    std::vector<std::thread> threads;
+    uint64_t taken = 0;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&histogram] {
+            for (int i = 0; i < NUM_VALUES; ++i) {
+                histogram.record(static_cast<uint64_t>(i));
+            }
+        });
+    }
+    for (int i = 0; i < 10; ++i) {
+        taken += histogram.takeSummary().count;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // no record gets lost between windows
+    taken += histogram.takeSummary().count;
+    EXPECT_EQ(static_cast<uint64_t>(NUM_THREADS * NUM_VALUES), taken);
+}
+
+} // namespace mcf
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/IdGeneratorInterface.h"
+#include "mcf_core/LineageTracker.h"
+#include "mcf_core/Messages.h"
+#include "mcf_core/ValueStore.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+class FixedIdGenerator : public IidGenerator {
+public:
+    void injectId(Value& value) const override { setId(value, fNextId); }
+
+    uint64_t fNextId = 0;
+};
+
+msg::String valueWithId(uint64_t id) {
+    FixedIdGenerator generator;
+    generator.fNextId = id;
+    msg::String value;
+    generator.injectId(value);
+    return value;
+}
+
+} // anonymous namespace
+
+TEST(LineageTrackerTest, SourceToSink) {
+    ValueStore valueStore;
+    LineageConfig config;
+    config.sources = {"/sensor/*"};
+    config.sinks = {"/actuator"};
+    config.tableSize = 16;
+    config.publishInterval = std::chrono::milliseconds(0);
+    LineageTracker& tracker = LineageTracker::instance();
+    tracker.enable(valueStore, config);
+    EXPECT_TRUE(LineageTracker::active());
+
+    tracker.recordWrite("/sensor/lidar", valueWithId(1), {});
+    tracker.recordWrite("/sensor/camera", valueWithId(2), {});
+    // no source, starts no lineage
+    tracker.recordWrite("/other", valueWithId(3), {});
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    tracker.recordWrite("/fusion", valueWithId(4), {1, 2, 3});
+    tracker.recordWrite("/actuator", valueWithId(5), {4});
+
+    auto statistics = tracker.statistics();
+    ASSERT_EQ(2u, statistics.size());
+    std::sort(statistics.begin(), statistics.end(), [](const LineageTracker::PathStatistics& a,
+                                                       const LineageTracker::PathStatistics& b) {
+        return a.source < b.source;
+    });
+    EXPECT_EQ("/sensor/camera", statistics[0].source);
+    EXPECT_EQ("/sensor/lidar", statistics[1].source);
+    for (const auto& path : statistics) {
+        EXPECT_EQ("/actuator", path.sink);
+        // published with the first sink value, the window starts anew
+        EXPECT_EQ(0u, path.latency.count);
+    }
+
+    ASSERT_TRUE(valueStore.hasValue("/mcf/lineage/actuator"));
+    auto latency = valueStore.getValue<msg::LineageLatency>("/mcf/lineage/actuator");
+    EXPECT_EQ("/actuator", latency->sink);
+    ASSERT_EQ(2u, latency->paths.size());
+    for (const auto& path : latency->paths) {
+        EXPECT_EQ(1u, path.count);
+        EXPECT_GE(path.maxNs, 2000000u);
+    }
+
+    // an unknown input, and the sink value itself written again without inputs
+    tracker.recordWrite("/actuator", valueWithId(6), {42});
+    tracker.recordWrite("/actuator", valueWithId(7), {});
+    EXPECT_EQ(latency, valueStore.getValue<msg::LineageLatency>("/mcf/lineage/actuator"));
+
+    tracker.disable();
+    EXPECT_FALSE(LineageTracker::active());
+}
+
+TEST(LineageTrackerTest, OverwrittenSlot) {
+    ValueStore valueStore;
+    LineageConfig config;
+    config.sinks = {"/sink"};
+    config.tableSize = 1;
+    config.publishInterval = std::chrono::hours(1);
+    LineageTracker& tracker = LineageTracker::instance();
+    tracker.enable(valueStore, config);
+
+    tracker.recordWrite("/source", valueWithId(1), {});
+    // takes over the only slot of the table
+    tracker.recordWrite("/source", valueWithId(2), {});
+    tracker.recordWrite("/sink", valueWithId(3), {1});
+    tracker.recordWrite("/sink", valueWithId(4), {2});
+
+    auto statistics = tracker.statistics();
+    ASSERT_EQ(1u, statistics.size());
+    EXPECT_EQ("/source", statistics[0].source);
+    EXPECT_EQ(1u, statistics[0].latency.count);
+    EXPECT_FALSE(valueStore.hasValue("/mcf/lineage/sink"));
+
+    tracker.disable();
+}
+
+} // namespace mcf
@@ -218,5 +218,47 @@ TEST_F(LogTest, SeverityChange) {
 
     manager.shutdown();
 }
+
+TEST_F(LogTest, AsyncLogging) {
+    AsyncLogConfig config;
+    config.queueSize = 64;
+    config.dropWhenFull = false;
+    ComponentLogger::enableAsyncLogging(config);
+    EXPECT_TRUE(ComponentLogger::getAsyncLogStatistics().enabled);
+    EXPECT_EQ(64u, ComponentLogger::getAsyncLogStatistics().queueSize);
+
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+
+    // the logger of the component is created asynchronous, later loggers are synchronous
+    auto testComponent = std::make_shared<LogTest::TestComponent>();
+    ComponentLogger::disableAsyncLogging();
+    EXPECT_FALSE(ComponentLogger::getAsyncLogStatistics().enabled);
+
+    manager.registerComponent(testComponent);
+    manager.configure();
+    manager.startup();
+
+    auto logMessages = std::make_shared<mcf::ValueQueue>();
+    valueStore.addReceiver("/mcf/log/TestComponent/message", logMessages);
+
+    valueStore.setValue("/logSomething", TestValue(1));
+    // the messages are published by the log thread
+    for (int tries = 0; tries < 100 && logMessages->size() < 2; ++tries)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    ASSERT_EQ(2u, logMessages->size());
+    auto msg = logMessages->pop<mcf::msg::LogMessage>();
+    EXPECT_EQ(3, msg->severity);
+    EXPECT_EQ("error", msg->message);
+    msg = logMessages->pop<mcf::msg::LogMessage>();
+    EXPECT_EQ(4, msg->severity);
+    EXPECT_EQ("fatal", msg->message);
+    EXPECT_EQ(0u, ComponentLogger::getAsyncLogStatistics().dropped);
+
+    manager.shutdown();
+}
 }
 
@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/LogicalClock.h"
+
+#include <chrono>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+class TestValue : public mcf::Value {
+public:
+    TestValue(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+} // anonymous namespace
+
+TEST(LogicalClockTest, QueueOrderAndVisibility)
+{
+    ValueStore valueStore;
+    auto clock = std::make_shared<LogicalClock>();
+    auto queue = std::make_shared<ValueQueue>();
+    valueStore.addReceiver("/a", queue);
+    valueStore.addReceiver("/b", queue);
+
+    // a handler of an earlier event is still running
+    clock->hold(LogicalTime{5, 0});
+
+    // written out of logical time order, e.g. by components on different threads
+    {
+        LogicalClock::Scope scope(clock.get(), LogicalTime{20, 1});
+        valueStore.setValue("/a", TestValue(3));
+    }
+    {
+        LogicalClock::Scope scope(clock.get(), LogicalTime{10, 0});
+        valueStore.setValue("/b", TestValue(2));
+        valueStore.setValue("/a", TestValue(1));
+    }
+    EXPECT_EQ(4u, clock->getHeldCount());
+    EXPECT_TRUE(queue->empty());
+    EXPECT_EQ(0u, queue->size());
+    EXPECT_THROW(queue->pop<TestValue>(), QueueEmptyException);
+
+    LogicalClock::Stamp stamp;
+    ASSERT_TRUE(queue->frontStamp(stamp));
+    EXPECT_TRUE(stamp.time == (LogicalTime{10, 0}));
+
+    clock->release(LogicalTime{5, 0});
+    EXPECT_EQ(3u, queue->size());
+    // equal logical times are ordered by topic
+    EXPECT_EQ(1, queue->pop<TestValue>()->val);
+    EXPECT_EQ(2, queue->pop<TestValue>()->val);
+    EXPECT_EQ(3, queue->pop<TestValue>()->val);
+    EXPECT_EQ(0u, clock->getHeldCount());
+
+    // unstamped values are visible right away
+    valueStore.setValue("/a", TestValue(4));
+    EXPECT_FALSE(queue->frontStamp(stamp));
+    EXPECT_EQ(4, queue->pop<TestValue>()->val);
+}
+
+TEST(LogicalClockTest, ConflationOrder)
+{
+    ValueStore valueStore;
+    auto clock = std::make_shared<LogicalClock>();
+    auto queue = std::make_shared<ValueQueue>([](const Value& value) -> uint64_t {
+        return dynamic_cast<const TestValue&>(value).val / 10;
+    });
+    valueStore.addReceiver("/a", queue);
+    clock->hold(LogicalTime{5, 0});
+
+    {
+        LogicalClock::Scope scope(clock.get(), LogicalTime{20, 0});
+        valueStore.setValue("/a", TestValue(10));
+    }
+    {
+        LogicalClock::Scope scope(clock.get(), LogicalTime{30, 0});
+        valueStore.setValue("/a", TestValue(20));
+    }
+    // replaces the value of key 2 with an earlier logical time, which moves it to the front
+    {
+        LogicalClock::Scope scope(clock.get(), LogicalTime{15, 0});
+        valueStore.setValue("/a", TestValue(21));
+    }
+    EXPECT_EQ(3u, clock->getHeldCount());
+    LogicalClock::Stamp stamp;
+    ASSERT_TRUE(queue->frontStamp(stamp));
+    EXPECT_TRUE(stamp.time == (LogicalTime{15, 0}));
+
+    clock->release(LogicalTime{5, 0});
+    EXPECT_EQ(2u, queue->size());
+    EXPECT_EQ(21, queue->pop<TestValue>()->val);
+    EXPECT_EQ(10, queue->pop<TestValue>()->val);
+    EXPECT_EQ(0u, clock->getHeldCount());
+}
+
+TEST(LogicalClockTest, Admission)
+{
+    auto clock = std::make_shared<LogicalClock>(10);
+    EXPECT_TRUE(clock->admits(1000));
+
+    clock->hold(LogicalTime{100, 2});
+    EXPECT_TRUE(clock->admits(110));
+    EXPECT_FALSE(clock->admits(111));
+    EXPECT_TRUE(clock->isSafe(LogicalTime{100, 2}));
+    EXPECT_FALSE(clock->isSafe(LogicalTime{100, 3}));
+
+    const uint64_t generation = clock->getGeneration();
+    std::thread releaser([&clock]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        clock->release(LogicalTime{100, 2});
+    });
+    clock->waitForAdmission(111, generation);
+    EXPECT_TRUE(clock->admits(111));
+    releaser.join();
+
+    // interrupting ends the wait without admission
+    clock->hold(LogicalTime{200, 0});
+    const uint64_t beforeInterrupt = clock->getGeneration();
+    std::thread interrupter([&clock]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        clock->interrupt();
+    });
+    clock->waitForAdmission(300, beforeInterrupt);
+    EXPECT_FALSE(clock->admits(300));
+    interrupter.join();
+    clock->release(LogicalTime{200, 0});
+}
+
+} // end namespace mcf
@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/ComponentManager.h"
+#include "mcf_core/ExtMemValue.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/MemoryStatsPublisher.h"
+#include "mcf_core/ValueRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+class SmallValue : public Value {
+public:
+    SmallValue(int val=0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+class ImageValue : public ExtMemValue<uint8_t> {
+public:
+    int val = 0;
+    MSGPACK_DEFINE(val);
+};
+
+const msg::MemoryUsage* findEntry(const msg::MemoryStats& stats, const std::string& kind, const std::string& name) {
+    auto it = std::find_if(stats.entries.begin(), stats.entries.end(), [&](const msg::MemoryUsage& usage) {
+        return usage.kind == kind && usage.name == name;
+    });
+    return it != stats.entries.end() ? &*it : nullptr;
+}
+
+class Sink : public Component {
+public:
+    Sink() : Component("Sink"), fInput(*this, "Input") {}
+
+    void configure(IComponentConfig& config) override {
+        config.registerPort(fInput, "/memory/input");
+    }
+
+private:
+    // no handler, so that received values stay queued
+    QueuedReceiverPort<SmallValue> fInput;
+};
+
+} // anonymous namespace
+
+TEST(MemoryStatsTest, TopicsQueuesAndTotal) {
+    ValueStore valueStore;
+    valueStore.registerType<SmallValue>("SmallValue");
+    valueStore.registerType<ImageValue>("ImageValue");
+    valueStore.enableHistory("/memory/images", 3);
+    auto queue = std::make_shared<ValueQueue>();
+    valueStore.addReceiver("/memory/images", queue);
+
+    for (int i = 0; i < 3; ++i) {
+        auto image = std::make_shared<ImageValue>();
+        image->extMemInit(1000);
+        valueStore.setValue("/memory/images", ValuePtr(image));
+    }
+    valueStore.setValue("/memory/small", SmallValue(1));
+
+    MemoryStatsPublisher publisher(valueStore);
+    publisher.setThreshold("queue", 2000);
+    auto stats = publisher.collect();
+
+    // the latest value is also part of the history
+    const auto* images = findEntry(*stats, "topic", "/memory/images");
+    ASSERT_NE(nullptr, images);
+    EXPECT_EQ(4u, images->values);
+    EXPECT_EQ(4000u, images->extMemBytes);
+    EXPECT_GT(images->bytes, images->extMemBytes);
+
+    const auto* small = findEntry(*stats, "topic", "/memory/small");
+    ASSERT_NE(nullptr, small);
+    EXPECT_EQ(1u, small->values);
+    EXPECT_EQ(0u, small->extMemBytes);
+    EXPECT_GT(small->bytes, 0u);
+
+    const auto* queued = findEntry(*stats, "queue", "/memory/images#0");
+    ASSERT_NE(nullptr, queued);
+    EXPECT_EQ(3u, queued->values);
+    EXPECT_EQ(3000u, queued->extMemBytes);
+    EXPECT_EQ(2000u, queued->thresholdBytes);
+    EXPECT_TRUE(queued->alert);
+
+    // values held by the topic and the queue are counted once
+    const auto* total = findEntry(*stats, "total", "");
+    ASSERT_NE(nullptr, total);
+    EXPECT_EQ(4u, total->values);
+    EXPECT_EQ(3000u, total->extMemBytes);
+    EXPECT_EQ(images->bytes / 4 * 3 + small->bytes, total->bytes);
+    EXPECT_FALSE(total->alert);
+
+    // the high-water mark stays when the queue is drained
+    const uint64_t highWater = queued->bytes;
+    while (!queue->empty()) {
+        queue->pop<Value>();
+    }
+    stats = publisher.collect();
+    queued = findEntry(*stats, "queue", "/memory/images#0");
+    ASSERT_NE(nullptr, queued);
+    EXPECT_EQ(0u, queued->values);
+    EXPECT_EQ(highWater, queued->highWaterBytes);
+    EXPECT_FALSE(queued->alert);
+}
+
+TEST(MemoryStatsTest, ComponentsAndRecorder) {
+    ValueStore valueStore;
+    valueStore.registerType<SmallValue>("SmallValue");
+    ValueRecorder recorder(valueStore);
+    ComponentManager manager(valueStore);
+    manager.registerComponent(std::make_shared<Sink>());
+    auto publisher = std::make_shared<MemoryStatsPublisher>(valueStore, std::chrono::milliseconds(20));
+    manager.registerComponent(publisher);
+    manager.configure();
+    manager.startup();
+
+    publisher->addComponentQueues(manager);
+    publisher->setRecorder(&recorder);
+    publisher->setThreshold("component", "Sink", 1);
+    valueStore.setValue("/memory/input", SmallValue(1));
+    valueStore.setValue("/memory/input", SmallValue(2));
+
+    auto stats = publisher->collect();
+    const auto* queued = findEntry(*stats, "queue", "Sink.Input");
+    ASSERT_NE(nullptr, queued);
+    EXPECT_EQ(2u, queued->values);
+    const auto* sink = findEntry(*stats, "component", "Sink");
+    ASSERT_NE(nullptr, sink);
+    EXPECT_EQ(queued->bytes, sink->bytes);
+    EXPECT_TRUE(sink->alert);
+    const auto* recorded = findEntry(*stats, "recorder", "");
+    ASSERT_NE(nullptr, recorded);
+    EXPECT_EQ(0u, recorded->bytes);
+
+    std::shared_ptr<const msg::MemoryStats> published;
+    for (int i = 0; i < 100 && published == nullptr; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (valueStore.hasValue(MemoryStatsPublisher::DEFAULT_TOPIC)) {
+            published = valueStore.getValue<msg::MemoryStats>(MemoryStatsPublisher::DEFAULT_TOPIC);
+        }
+    }
+    ASSERT_NE(nullptr, published);
+    EXPECT_NE(nullptr, findEntry(*published, "total", ""));
+
+    manager.shutdown();
+}
+
+} // namespace mcf
@@ -2,11 +2,19 @@
  * Copyright (c) 2024 Accenture
  */
 #include "gtest/gtest.h"
+#include "mcf_core/MutexProfile.h"
 #include "mcf_core/Mutexes.h"
 #include "spdlog/fmt/fmt.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
 #include <thread>
+#include <vector>
 
 namespace
 {
@@ -108,4 +116,214 @@ TEST(MutexTest, MutuallyExclusiveOwnership)
     }
 }
 
+TEST(MutexTest, CeilingRestoresScheduling)
+{
+    mcf::mutex::PriorityCeilingMutex outer(2);
+    mcf::mutex::PriorityCeilingMutex inner(3);
+
+    auto thread = std::thread([&outer, &inner]() {
+        int policy = -1;
+        sched_param parameters{};
+        // a non real-time thread is switched for the time it holds the mutexes, also when nested
+        for (int i = 0; i < 2; ++i)
+        {
+            outer.lock();
+            inner.lock();
+            inner.unlock();
+            outer.unlock();
+            pthread_getschedparam(pthread_self(), &policy, &parameters);
+            EXPECT_EQ(SCHED_OTHER, policy);
+        }
+        if (!mcf::mutex::realtimeCapabilityAvailable())
+        {
+            return;
+        }
+
+        // a real-time thread keeps its policy
+        sched_param fifo{1};
+        ASSERT_EQ(0, pthread_setschedparam(pthread_self(), SCHED_FIFO, &fifo));
+        mcf::mutex::schedulingPolicyChanged();
+        for (int i = 0; i < 2; ++i)
+        {
+            outer.lock();
+            outer.unlock();
+            pthread_getschedparam(pthread_self(), &policy, &parameters);
+            EXPECT_EQ(SCHED_FIFO, policy);
+        }
+
+        // back to non real-time, announced or not
+        sched_param other{0};
+        ASSERT_EQ(0, pthread_setschedparam(pthread_self(), SCHED_OTHER, &other));
+        mcf::mutex::schedulingPolicyChanged();
+        outer.lock();
+        EXPECT_TRUE(inner.try_lock());
+        inner.unlock();
+        outer.unlock();
+        pthread_getschedparam(pthread_self(), &policy, &parameters);
+        EXPECT_EQ(SCHED_OTHER, policy);
+    });
+    thread.join();
+}
+
+TEST(MutexTest, SharedMutex)
+{
+    mcf::mutex::PriorityInheritanceSharedMutex mutex;
+
+    // readers share the mutex, a writer is excluded while any reader owns it
+    mutex.lock_shared();
+    EXPECT_TRUE(std::async(std::launch::async, [&mutex]() {
+        bool shared = mutex.try_lock_shared();
+        if (shared)
+        {
+            mutex.unlock_shared();
+        }
+        return shared;
+    }).get());
+    EXPECT_FALSE(std::async(std::launch::async, [&mutex]() { return mutex.try_lock(); }).get());
+
+    // a pending writer waits for the reader and holds back new readers
+    std::atomic<bool> written(false);
+    std::thread writer([&mutex, &written]() {
+        std::lock_guard<mcf::mutex::PriorityInheritanceSharedMutex> lk(mutex);
+        written = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(written);
+    EXPECT_FALSE(std::async(std::launch::async, [&mutex]() { return mutex.try_lock_shared(); }).get());
+    mutex.unlock_shared();
+    writer.join();
+    EXPECT_TRUE(written);
+
+    EXPECT_TRUE(mutex.try_lock());
+    EXPECT_FALSE(std::async(std::launch::async, [&mutex]() { return mutex.try_lock_shared(); }).get());
+    mutex.unlock();
+    EXPECT_TRUE(mutex.try_lock_shared());
+    mutex.unlock_shared();
+}
+
+TEST(MutexTest, SharedMutexStress)
+{
+    mcf::mutex::PriorityInheritanceSharedMutex mutex;
+    // written in two halves by the writers, readers must never see them differ
+    uint64_t first = 0;
+    uint64_t second = 0;
+    std::atomic<bool> torn(false);
+    std::atomic<bool> stop(false);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&]() {
+            while (!stop)
+            {
+                std::shared_lock<mcf::mutex::PriorityInheritanceSharedMutex> lk(mutex);
+                if (first != second)
+                {
+                    torn = true;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 2; ++i)
+    {
+        threads.emplace_back([&]() {
+            for (int n = 0; n < 10000; ++n)
+            {
+                std::lock_guard<mcf::mutex::PriorityInheritanceSharedMutex> lk(mutex);
+                ++first;
+                ++second;
+            }
+        });
+    }
+    threads[4].join();
+    threads[5].join();
+    stop = true;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads[i].join();
+    }
+    EXPECT_FALSE(torn);
+    EXPECT_EQ(20000u, first);
+    EXPECT_EQ(20000u, second);
+}
+
+TEST(MutexTest, Profile)
+{
+    using mcf::mutex::MutexProfile;
+    int siteA = 0;
+    int siteB = 0;
+    MutexProfile& profile = MutexProfile::get("MutexTest.Profile");
+    EXPECT_EQ(&profile, &MutexProfile::get("MutexTest.Profile"));
+    profile.reset();
+    for (int i = 0; i < 3; ++i)
+    {
+        profile.recordAcquisition();
+        profile.recordHold(1000);
+    }
+    profile.recordContention(100, &siteB);
+    profile.recordContention(100, &siteA);
+    profile.recordContention(100, &siteA);
+    // failed try_lock() calls count without a waiting time
+    profile.recordContention(0, nullptr);
+
+    auto snapshot = profile.snapshot(5);
+    EXPECT_EQ("MutexTest.Profile", snapshot.name);
+    EXPECT_EQ(3u, snapshot.locks);
+    EXPECT_EQ(4u, snapshot.contentions);
+    EXPECT_EQ(3u, snapshot.wait.count);
+    EXPECT_EQ(300u, snapshot.wait.sum);
+    EXPECT_EQ(3u, snapshot.hold.count);
+    ASSERT_EQ(3u, snapshot.callSites.size());
+    EXPECT_EQ(2u, snapshot.callSites[0].contentions);
+    EXPECT_EQ(1u, snapshot.callSites[1].contentions);
+    EXPECT_EQ("<other>", snapshot.callSites[2].location);
+    EXPECT_EQ(1u, profile.snapshot(1).callSites.size());
+
+    // the profile waited for longest comes first
+    MutexProfile& longer = MutexProfile::get("MutexTest.ProfileLonger");
+    longer.reset();
+    longer.recordContention(1000000, &siteA);
+    auto snapshots = MutexProfile::snapshots();
+    auto position = [&snapshots](const std::string& name) {
+        return std::find_if(snapshots.begin(), snapshots.end(), [&name](const MutexProfile::Snapshot& s) {
+            return s.name == name;
+        }) - snapshots.begin();
+    };
+    EXPECT_LT(position("MutexTest.ProfileLonger"), position("MutexTest.Profile"));
+    EXPECT_NE(std::string::npos, MutexProfile::report().find("MutexTest.ProfileLonger"));
+
+    profile.reset();
+    snapshot = profile.snapshot(5);
+    EXPECT_EQ(0u, snapshot.locks);
+    EXPECT_EQ(0u, snapshot.contentions);
+    EXPECT_TRUE(snapshot.callSites.empty());
+}
+
+#if MCF_ENABLE_MUTEX_PROFILING
+TEST(MutexTest, ProfiledMutex)
+{
+    using mcf::mutex::MutexProfile;
+    MutexProfile::get("MutexTest.ProfiledMutex").reset();
+    mcf::mutex::PriorityInheritanceMutex mutex;
+    mutex.setName("MutexTest.ProfiledMutex");
+
+    mutex.lock();
+    std::thread other([&mutex]() {
+        std::lock_guard<mcf::mutex::PriorityInheritanceMutex> lk(mutex);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(std::async(std::launch::async, [&mutex]() { return mutex.try_lock(); }).get());
+    mutex.unlock();
+    other.join();
+
+    auto snapshot = MutexProfile::get("MutexTest.ProfiledMutex").snapshot(5);
+    EXPECT_EQ(2u, snapshot.locks);
+    EXPECT_EQ(2u, snapshot.contentions);
+    EXPECT_EQ(1u, snapshot.wait.count);
+    EXPECT_GE(snapshot.wait.max, 10000000u);
+    EXPECT_EQ(2u, snapshot.hold.count);
+    EXPECT_FALSE(snapshot.callSites.empty());
+}
+#endif
+
 } // namespace
\ No newline at end of file
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/Numa.h"
+#include "mcf_core/ThreadAffinity.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace mcf {
+
+namespace {
+
+class Kick : public mcf::Value {
+public:
+    int dummy = 0;
+    MSGPACK_DEFINE(dummy);
+};
+
+} // anonymous namespace
+
+TEST(NumaTest, Topology)
+{
+    const int nodes = getNumaNodeCount();
+    EXPECT_GE(nodes, 1);
+    EXPECT_NE(0u, getNumaNodeCpus(0));
+    EXPECT_EQ(0u, getNumaNodeCpus(nodes));
+    EXPECT_GE(getCurrentNumaNode(), 0);
+    EXPECT_LT(getCurrentNumaNode(), nodes);
+    EXPECT_EQ(static_cast<size_t>(nodes), getNumaStatistics().size());
+}
+
+TEST(NumaTest, DominantNode)
+{
+    EXPECT_EQ(-1, dominantNumaNode({}));
+    EXPECT_EQ(-1, dominantNumaNode({-1, -1}));
+    EXPECT_EQ(2, dominantNumaNode({-1, 2}));
+    EXPECT_EQ(1, dominantNumaNode({0, 1, 1}));
+    // ties go to the lower node
+    EXPECT_EQ(0, dominantNumaNode({1, 0}));
+}
+
+TEST(NumaTest, Migrate)
+{
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    std::vector<char> buffer(4 * pageSize, 1);
+    size_t migrated = migrateToNumaNode(buffer.data(), buffer.size(), 0);
+    // migration may not be permitted in restricted environments, it then moves nothing
+    if (migrated > 0)
+    {
+        // only whole pages within the buffer are migrated
+        EXPECT_LE(migrated, buffer.size());
+        EXPECT_EQ(0u, migrated % pageSize);
+        EXPECT_EQ(0, getMemoryNumaNode(buffer.data() + buffer.size() / 2));
+    }
+    EXPECT_EQ(0u, migrateToNumaNode(buffer.data(), pageSize / 2, 0));
+}
+
+TEST(NumaTest, ComponentNode)
+{
+    class NodeComponent : public Component {
+    public:
+        NodeComponent() : Component("NodeComponent"), fKickPort(*this, "Kick")
+        {
+            fKickPort.registerHandler([this] {
+                fAffinity = getThreadCpuAffinity(pthread_self());
+                fDone = true;
+            });
+        }
+
+        void configure(IComponentConfig& config) {
+            config.registerPort(fKickPort, "/numa/kick");
+        }
+
+        ReceiverPort<Kick> fKickPort;
+        std::atomic<CpuMask> fAffinity{0};
+        std::atomic<bool> fDone{false};
+    };
+
+    ValueStore valueStore;
+    ComponentManager manager(valueStore);
+    auto component = std::make_shared<NodeComponent>();
+    manager.registerComponent(component);
+    IComponent::SchedulingParameters parameters;
+    parameters.numaNode = 0;
+    component->ctrlSetSchedulingParameters(parameters);
+    EXPECT_EQ(0, component->getNumaNode());
+
+    parameters.numaNode = getNumaNodeCount();
+    EXPECT_THROW(component->ctrlSetSchedulingParameters(parameters), std::runtime_error);
+    EXPECT_EQ(0, component->getNumaNode());
+
+    manager.setNumaPlacement(NumaPlacement::CONSUMER);
+    manager.configure();
+    manager.startup();
+    valueStore.setValue("/numa/kick", Kick());
+    for (int i = 0; i < 1000 && !component->fDone; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    manager.shutdown();
+    ASSERT_TRUE(component->fDone);
+    // without explicit affinity the component runs on the CPUs of its node
+    EXPECT_EQ(getNumaNodeCpus(0) & getThreadCpuAffinity(pthread_self()), component->fAffinity.load());
+}
+
+} // namespace mcf
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/ParallelFor.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mcf {
+
+TEST(ParallelForTest, CoversRange) {
+    std::vector<std::atomic<int>> visits(1000);
+    for (auto& visit : visits) {
+        visit = 0;
+    }
+    parallelFor(10, 1000, 7, [&visits](size_t begin, size_t end) {
+        EXPECT_LE(end - begin, 7u);
+        for (size_t i = begin; i < end; ++i) {
+            ++visits[i];
+        }
+    });
+    for (size_t i = 0; i < visits.size(); ++i) {
+        EXPECT_EQ(i < 10 ? 0 : 1, visits[i].load()) << i;
+    }
+
+    // empty ranges do not call the body, the default grain covers the range as well
+    parallelFor(5, 5, 0, [](size_t, size_t) { FAIL(); });
+    std::atomic<size_t> count(0);
+    parallelFor(0, 12345, 0, [&count](size_t begin, size_t end) { count += end - begin; });
+    EXPECT_EQ(12345u, count.load());
+    EXPECT_GE(parallelForThreads(), 1u);
+}
+
+TEST(ParallelForTest, Nested) {
+    std::atomic<size_t> count(0);
+    parallelFor(0, 16, 1, [&count](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            parallelFor(0, 100, 10, [&count](size_t begin, size_t end) { count += end - begin; });
+        }
+    });
+    EXPECT_EQ(1600u, count.load());
+}
+
+TEST(ParallelForTest, Exception) {
+    std::atomic<size_t> count(0);
+    EXPECT_THROW(parallelFor(0, 100, 1, [&count](size_t begin, size_t end) {
+        count += end - begin;
+        if (begin <= 42 && 42 < end) {
+            throw std::runtime_error("chunk failed");
+        }
+    }), std::runtime_error);
+    // the remaining chunks still ran
+    EXPECT_EQ(100u, count.load());
+}
+
+TEST(ParallelForTest, Reduce) {
+    auto sum = [](size_t begin, size_t end) {
+        uint64_t sum = 0;
+        for (size_t i = begin; i < end; ++i) {
+            sum += i;
+        }
+        return sum;
+    };
+    auto add = [](uint64_t a, uint64_t b) { return a + b; };
+    EXPECT_EQ(499500u, parallelReduce(0, 1000, 0, uint64_t(0), sum, add));
+    EXPECT_EQ(7u, parallelReduce(5, 5, 3, uint64_t(7), sum, add));
+
+    // chunk results are combined in order
+    std::string order = parallelReduce(0, 10, 3, std::string(),
+        [](size_t begin, size_t) { return std::to_string(begin); },
+        [](std::string a, std::string b) { return a + "," + b; });
+    EXPECT_EQ(",0,3,6,9", order);
+}
+
+TEST(ParallelForTest, ThreadLimit) {
+    configureParallelFor(ParallelForConfig{4, 0});
+    EXPECT_EQ(4u, parallelForThreads());
+
+    auto maxConcurrency = [] {
+        std::atomic<int> active(0);
+        std::atomic<int> maxActive(0);
+        parallelFor(0, 64, 1, [&](size_t, size_t) {
+            const int current = ++active;
+            int previous = maxActive;
+            while (current > previous && !maxActive.compare_exchange_weak(previous, current)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            --active;
+        });
+        return maxActive.load();
+    };
+    setParallelForThreadLimit(2);
+    EXPECT_EQ(2u, getParallelForThreadLimit());
+    EXPECT_LE(maxConcurrency(), 2);
+    setParallelForThreadLimit(1);
+    EXPECT_EQ(1, maxConcurrency());
+    setParallelForThreadLimit(0);
+    EXPECT_LE(maxConcurrency(), 4);
+
+    configureParallelFor(ParallelForConfig());
+}
+
+} // namespace mcf
@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/ExtMemValue.h"
+#include "mcf_core/PartitionedRecordHandoff.h"
+#include "mcf_core/RecordReader.h"
+#include "mcf_core/ValueRecorder.h"
+
+#include <cstdio>
+#include <map>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+class TestValue : public mcf::Value {
+public:
+    TestValue(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+class TestValueExtMem : public mcf::ExtMemValue<uint8_t> {
+public:
+    TestValueExtMem(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+/**
+ * Count the records of the topics published by the test, skipping those of the recorders
+ */
+std::map<std::string, int> countRecords(const std::string& filename, size_t& extMemBytes)
+{
+    std::map<std::string, int> counts;
+    RecordReader reader;
+    reader.open(filename);
+    RecordReader::Record record;
+    while (reader.next(record))
+    {
+        const std::string topic = record.topic.str();
+        if (topic.compare(0, 5, "/mcf/") != 0)
+        {
+            ++counts[topic];
+            extMemBytes += record.extMem.size;
+        }
+    }
+    return counts;
+}
+
+} // anonymous namespace
+
+TEST(PartitionedRecordHandoffTest, RecordAndSelectPartitions)
+{
+    ValueStore valueStore;
+    valueStore.registerType<TestValue>("TestValue");
+    valueStore.registerType<TestValueExtMem>("TestValueExtMem");
+
+    auto handoff = std::make_unique<PartitionedRecordHandoff>(valueStore,
+        std::vector<PartitionedRecordHandoff::Partition>{{"lidar", {"/lidar/*"}, {}}, {"camera", {"/camera"}, {}}});
+    handoff->getRecorder("camera").setWorkerThreads(2);
+    ValueRecorder recorder(valueStore);
+    recorder.setHandoff(std::move(handoff));
+    recorder.enableExtMemSerialization("/camera");
+
+    const std::string filename = "partitioned_record.bin";
+    const std::string manifest = PartitionedRecordHandoff::manifestFilename(filename);
+    EXPECT_EQ("partitioned_record.partitions.json", manifest);
+    recorder.start(filename);
+    const int n = 20;
+    const size_t extMemSize = 100;
+    for (int i = 0; i < n; ++i)
+    {
+        valueStore.setValue("/lidar/front", TestValue(i));
+        valueStore.setValue("/lidar/rear", TestValue(i));
+        valueStore.setValue("/speed", TestValue(i));
+        auto image = TestValueExtMem(i);
+        image.extMemInit(extMemSize);
+        valueStore.setValue("/camera", std::move(image));
+    }
+    recorder.stop();
+
+    const auto partitions = PartitionedRecordHandoff::readManifest(manifest);
+    ASSERT_EQ(3u, partitions.size());
+    EXPECT_EQ("lidar", partitions[0].name);
+    EXPECT_EQ(std::vector<std::string>{"/lidar/*"}, partitions[0].topics);
+    EXPECT_EQ(std::vector<std::string>{"partitioned_record_lidar.bin"}, partitions[0].files);
+    EXPECT_EQ(PartitionedRecordHandoff::OTHER_PARTITION, partitions[2].name);
+    EXPECT_TRUE(partitions[2].topics.empty());
+
+    EXPECT_EQ(std::vector<std::string>{"partitioned_record_lidar.bin"},
+              PartitionedRecordHandoff::selectFiles(manifest, {"/lidar/rear"}));
+    EXPECT_EQ((std::vector<std::string>{"partitioned_record_camera.bin", "partitioned_record_other.bin"}),
+              PartitionedRecordHandoff::selectFiles(manifest, {"/speed", "/camera"}));
+
+    // each partition is read on a thread of its own
+    std::vector<std::map<std::string, int>> counts(partitions.size());
+    std::vector<size_t> extMemBytes(partitions.size(), 0);
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < partitions.size(); ++i)
+    {
+        ASSERT_EQ(1u, partitions[i].files.size());
+        readers.emplace_back([&, i] { counts[i] = countRecords(partitions[i].files[0], extMemBytes[i]); });
+    }
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ((std::map<std::string, int>{{"/lidar/front", n}, {"/lidar/rear", n}}), counts[0]);
+    EXPECT_EQ((std::map<std::string, int>{{"/camera", n}}), counts[1]);
+    EXPECT_EQ(n * extMemSize, extMemBytes[1]);
+    EXPECT_EQ((std::map<std::string, int>{{"/speed", n}}), counts[2]);
+
+    for (const auto& partition : partitions)
+    {
+        std::remove(partition.files[0].c_str());
+    }
+    std::remove(manifest.c_str());
+}
+
+TEST(PartitionedRecordHandoffTest, InvalidPartitions)
+{
+    ValueStore valueStore;
+    using Partitions = std::vector<PartitionedRecordHandoff::Partition>;
+    EXPECT_THROW(PartitionedRecordHandoff(valueStore, Partitions{{"", {"/a"}, {}}}), std::runtime_error);
+    EXPECT_THROW(PartitionedRecordHandoff(valueStore, Partitions{{"a/b", {"/a"}, {}}}), std::runtime_error);
+    EXPECT_THROW(PartitionedRecordHandoff(valueStore, Partitions{{"a", {"/a"}, {}}, {"a", {"/b"}, {}}}),
+                 std::runtime_error);
+    EXPECT_THROW(PartitionedRecordHandoff(valueStore, Partitions{{"other", {"/a"}, {}}}), std::runtime_error);
+    // a partition without patterns takes the remaining topics instead of the added one
+    PartitionedRecordHandoff handoff(valueStore, Partitions{{"rest", {}, {}}});
+    EXPECT_THROW(handoff.getRecorder(PartitionedRecordHandoff::OTHER_PARTITION), std::out_of_range);
+}
+
+} // namespace mcf
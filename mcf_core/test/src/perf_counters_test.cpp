@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/PerfCounters.h"
+
+#include <thread>
+
+namespace mcf {
+
+TEST(PerfCountersTest, Totals) {
+    PerfCounterTotals totals;
+    PerfCounterValues run;
+    run.cycles = 1000;
+    run.instructions = 2000;
+    run.cacheMisses = 3;
+    run.branchMisses = 4;
+    run.contextSwitches = 1;
+    totals.record(run);
+    totals.record(run);
+
+    auto summary = totals.summary();
+    EXPECT_EQ(2u, summary.runs);
+    EXPECT_EQ(2000u, summary.sum.cycles);
+    EXPECT_EQ(4000u, summary.sum.instructions);
+    EXPECT_EQ(6u, summary.sum.cacheMisses);
+    EXPECT_EQ(8u, summary.sum.branchMisses);
+    EXPECT_EQ(2u, summary.sum.contextSwitches);
+
+    summary = totals.takeSummary();
+    EXPECT_EQ(2u, summary.runs);
+    EXPECT_EQ(0u, totals.summary().runs);
+    EXPECT_EQ(0u, totals.summary().sum.cycles);
+}
+
+TEST(PerfCountersTest, DisabledSample) {
+    PerfCounterSample sample(false);
+    PerfCounterValues delta;
+    EXPECT_FALSE(sample.stop(delta));
+}
+
+TEST(PerfCountersTest, ThreadCounters) {
+    if (ThreadPerfCounters::current() == nullptr) {
+        GTEST_SKIP() << "perf events not available";
+    }
+    EXPECT_EQ(ThreadPerfCounters::current(), ThreadPerfCounters::current());
+
+    PerfCounterSample sample(true);
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i < 1000000; ++i) {
+        sum += i;
+    }
+    PerfCounterValues delta;
+    ASSERT_TRUE(sample.stop(delta));
+    EXPECT_GT(delta.cycles, 0u);
+    EXPECT_GT(delta.instructions, 1000000u);
+
+    // each thread counts with counters of its own
+    ThreadPerfCounters* other = nullptr;
+    std::thread([&other] { other = ThreadPerfCounters::current(); }).join();
+    EXPECT_NE(ThreadPerfCounters::current(), other);
+}
+
+} // namespace mcf
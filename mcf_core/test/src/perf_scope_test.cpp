@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Messages.h"
+#include "mcf_core/PerfScope.h"
+#include "mcf_core/ValueStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+const PerfScopes::TagSummary* find(const std::vector<PerfScopes::TagSummary>& summaries, const std::string& name)
+{
+    auto it = std::find_if(summaries.begin(), summaries.end(),
+                           [&name](const PerfScopes::TagSummary& summary) { return summary.name == name; });
+    return it != summaries.end() ? &*it : nullptr;
+}
+
+void sleepScope()
+{
+    MCF_PERF_SCOPE("PerfScopeTest::sleep");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+}
+
+} // anonymous namespace
+
+TEST(PerfScopeTest, RecordsScopes) {
+    PerfScopes::takeSummaries();
+    sleepScope();
+    std::thread(sleepScope).join();
+
+    auto summaries = PerfScopes::takeSummaries();
+    const auto* sleep = find(summaries, "PerfScopeTest::sleep");
+    ASSERT_NE(nullptr, sleep);
+    EXPECT_EQ(2u, sleep->latency.count);
+    EXPECT_GE(sleep->latency.max, 1900000u);
+    EXPECT_LT(sleep->latency.p50, 1000000000u);
+
+    // nothing recorded since
+    EXPECT_EQ(nullptr, find(PerfScopes::takeSummaries(), "PerfScopeTest::sleep"));
+    sleepScope();
+    summaries = PerfScopes::takeSummaries();
+    sleep = find(summaries, "PerfScopeTest::sleep");
+    ASSERT_NE(nullptr, sleep);
+    EXPECT_EQ(1u, sleep->latency.count);
+
+    // all scopes since the start
+    summaries = PerfScopes::summaries();
+    sleep = find(summaries, "PerfScopeTest::sleep");
+    ASSERT_NE(nullptr, sleep);
+    EXPECT_GE(sleep->latency.count, 3u);
+}
+
+TEST(PerfScopeTest, SharedTags) {
+    EXPECT_EQ(PerfScopes::registerTag("PerfScopeTest::shared"), PerfScopes::registerTag("PerfScopeTest::shared"));
+    EXPECT_NE(PerfScopes::registerTag("PerfScopeTest::shared"), PerfScopes::registerTag("PerfScopeTest::other"));
+}
+
+TEST(PerfScopeTest, Publishing) {
+    ValueStore valueStore;
+    PerfScopes::startPublishing(valueStore, std::chrono::milliseconds(10), "/test/scopes");
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    bool published = false;
+    while (!published && std::chrono::steady_clock::now() < deadline) {
+        sleepScope();
+        if (valueStore.hasValue("/test/scopes")) {
+            auto stats = valueStore.getValue<msg::PerfScopeStats>("/test/scopes");
+            published = std::any_of(stats->scopes.begin(), stats->scopes.end(),
+                                    [](const msg::PerfScopeLatency& scope) {
+                                        return scope.name == "PerfScopeTest::sleep" && scope.count > 0;
+                                    });
+        }
+    }
+    PerfScopes::stopPublishing();
+    EXPECT_TRUE(published);
+}
+
+} // namespace mcf
@@ -0,0 +1,216 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/PerfettoTraceWriter.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mcf {
+
+namespace {
+
+const std::string TRACE_FILE = "perfetto_trace_test.perfetto-trace";
+
+std::string readFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// the fields of a protobuf message, varints and fixed64 as numbers, the others as bytes
+struct Message {
+    std::multimap<uint32_t, uint64_t> numbers;
+    std::multimap<uint32_t, std::string> bytes;
+
+    uint64_t number(uint32_t field) const
+    {
+        auto it = numbers.find(field);
+        return it != numbers.end() ? it->second : 0;
+    }
+
+    std::string string(uint32_t field) const
+    {
+        auto it = bytes.find(field);
+        return it != bytes.end() ? it->second : std::string();
+    }
+};
+
+uint64_t readVarint(const std::string& data, size_t& offset)
+{
+    uint64_t value = 0;
+    for (unsigned shift = 0; offset < data.size(); shift += 7)
+    {
+        const auto byte = static_cast<uint8_t>(data[offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            break;
+        }
+    }
+    return value;
+}
+
+Message parse(const std::string& data)
+{
+    Message message;
+    size_t offset = 0;
+    while (offset < data.size())
+    {
+        const uint64_t tag = readVarint(data, offset);
+        const auto field = static_cast<uint32_t>(tag >> 3);
+        switch (tag & 7)
+        {
+            case 0:
+                message.numbers.emplace(field, readVarint(data, offset));
+                break;
+            case 1:
+            {
+                uint64_t value;
+                std::memcpy(&value, data.data() + offset, sizeof(value));
+                offset += sizeof(value);
+                message.numbers.emplace(field, value);
+                break;
+            }
+            case 2:
+            {
+                const uint64_t size = readVarint(data, offset);
+                message.bytes.emplace(field, data.substr(offset, size));
+                offset += size;
+                break;
+            }
+            default:
+                ADD_FAILURE() << "unexpected wire type " << (tag & 7);
+                return message;
+        }
+    }
+    EXPECT_EQ(data.size(), offset);
+    return message;
+}
+
+TraceRecord makeRecord(TraceEventType type, uint64_t time, const std::string& component, int32_t threadId)
+{
+    TraceStringTable& strings = TraceStringTable::instance();
+    TraceRecord record{};
+    record.type = type;
+    record.time = time;
+    record.traceId = strings.intern("FLUX");
+    record.component = strings.intern(component);
+    record.threadId = threadId;
+    return record;
+}
+
+} // anonymous namespace
+
+TEST(PerfettoTraceWriterTest, WritesTrace) {
+    std::remove(TRACE_FILE.c_str());
+    TraceStringTable& strings = TraceStringTable::instance();
+    PerfettoTraceWriter writer(TRACE_FILE, std::chrono::microseconds(100));
+
+    TraceRecord write = makeRecord(TraceEventType::PORT_WRITE, 1000, "Producer", 1);
+    write.topic = strings.intern("/topic");
+    write.connected = 1;
+    write.valueId = 7;
+    TraceRecord secondWrite = write;
+    secondWrite.time = 1010;
+    secondWrite.valueId = 8;
+    TraceRecord handler = makeRecord(TraceEventType::TRIGGER_EXEC, 1050, "Producer", 1);
+    handler.name = strings.intern("tick");
+    handler.topic = strings.intern("/trigger");
+    handler.executionTime = 100.e-6f;
+    // the read of the consumer arrives before the write, as its buffer was drained first
+    TraceRecord read = makeRecord(TraceEventType::PORT_READ, 1020, "Consumer", 2);
+    read.topic = write.topic;
+    read.connected = 1;
+    read.valueId = 7;
+    TraceRecord transfer = makeRecord(TraceEventType::REMOTE_TRANSFER_TIME, 1100, "Bridge", 3);
+    transfer.executionTime = 20.e-6f;
+    std::vector<TraceRecord> records = {read, write, secondWrite, handler, transfer};
+    writer.consume(records.data(), records.size());
+    writer.close();
+
+    // the port instants, the begins and ends of the handler and the transfer, the backlog
+    EXPECT_EQ(8u, writer.eventsWritten());
+    EXPECT_EQ(1u, writer.flowsWritten());
+    EXPECT_EQ(0u, writer.lateEvents());
+
+    const Message trace = parse(readFile(TRACE_FILE));
+    std::map<uint64_t, Message> tracks;
+    std::vector<std::pair<uint64_t, Message>> events;
+    for (auto it = trace.bytes.lower_bound(1); it != trace.bytes.upper_bound(1); ++it)
+    {
+        const Message packet = parse(it->second);
+        EXPECT_EQ(1u, packet.number(10));
+        if (packet.bytes.count(60) != 0)
+        {
+            const Message track = parse(packet.string(60));
+            tracks[track.number(1)] = track;
+        }
+        else
+        {
+            ASSERT_EQ(1u, packet.bytes.count(11));
+            events.emplace_back(packet.number(8), parse(packet.string(11)));
+        }
+    }
+    // the process, two threads, the remote transfer and the backlog track
+    ASSERT_EQ(5u, tracks.size());
+    ASSERT_EQ(8u, events.size());
+
+    // handler begin, written in time order
+    EXPECT_EQ(950000u, events[0].first);
+    EXPECT_EQ(1u, events[0].second.number(9));
+    EXPECT_EQ("tick", events[0].second.string(23));
+    const Message producer = parse(tracks[events[0].second.number(11)].string(4));
+    EXPECT_EQ(1u, producer.number(2));
+    EXPECT_EQ("Producer", producer.string(5));
+    EXPECT_EQ("FLUX", parse(tracks[producer.number(1)].string(3)).string(6));
+
+    // the write starts a flow the read terminates
+    EXPECT_EQ(1000000u, events[1].first);
+    EXPECT_EQ(3u, events[1].second.number(9));
+    EXPECT_EQ("write /topic", events[1].second.string(23));
+    ASSERT_EQ(1u, events[1].second.numbers.count(47));
+    const uint64_t flowId = events[1].second.number(47);
+
+    EXPECT_EQ(1010000u, events[2].first);
+    EXPECT_EQ(0u, events[2].second.numbers.count(47));
+
+    EXPECT_EQ(1020000u, events[3].first);
+    EXPECT_EQ("read /topic", events[3].second.string(23));
+    EXPECT_EQ(flowId, events[3].second.number(48));
+
+    // one value was written after the value read
+    EXPECT_EQ(1020000u, events[4].first);
+    EXPECT_EQ(4u, events[4].second.number(9));
+    EXPECT_EQ(1u, events[4].second.number(30));
+    const Message& backlog = tracks[events[4].second.number(11)];
+    EXPECT_EQ("Consumer backlog /topic", backlog.string(2));
+    EXPECT_EQ(1u, backlog.bytes.count(8));
+
+    // handler end
+    EXPECT_EQ(1050000u, events[5].first);
+    EXPECT_EQ(2u, events[5].second.number(9));
+    EXPECT_EQ(events[0].second.number(11), events[5].second.number(11));
+
+    // remote transfer span on a track of its own
+    EXPECT_EQ(1080000u, events[6].first);
+    EXPECT_EQ(1u, events[6].second.number(9));
+    EXPECT_EQ("Bridge remote transfers", tracks[events[6].second.number(11)].string(2));
+    EXPECT_EQ(1100000u, events[7].first);
+    EXPECT_EQ(2u, events[7].second.number(9));
+
+    std::remove(TRACE_FILE.c_str());
+}
+
+TEST(PerfettoTraceWriterTest, InvalidFile) {
+    EXPECT_THROW(PerfettoTraceWriter("/nonexistent/trace.perfetto-trace"), std::runtime_error);
+}
+
+} // namespace mcf
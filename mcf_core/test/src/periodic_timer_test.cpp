@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/PeriodicTimer.h"
+
+#include <atomic>
+#include <thread>
+
+namespace mcf {
+
+class PeriodicTimerTest : public ::testing::Test
+{
+public:
+    class PeriodicComponent : public Component
+    {
+    public:
+        PeriodicComponent(std::chrono::nanoseconds period, std::chrono::milliseconds work) :
+            Component("PeriodicComponent"),
+            fWork(work)
+        {
+            fTimer = registerPeriodicHandler(period, [this] {
+                std::this_thread::sleep_for(fWork);
+                ++fRuns;
+            });
+        }
+
+        std::shared_ptr<PeriodicTimer> fTimer;
+        std::atomic<uint64_t> fRuns{0};
+
+    private:
+        std::chrono::milliseconds fWork;
+    };
+};
+
+TEST_F(PeriodicTimerTest, PhaseAlignment)
+{
+    const std::chrono::nanoseconds period(std::chrono::milliseconds(10));
+    PeriodicTimer aligned(period, std::chrono::nanoseconds(0), std::make_shared<EventFlag>(), "aligned");
+    PeriodicTimer shifted(period, std::chrono::milliseconds(3), std::make_shared<EventFlag>(), "shifted");
+
+    EXPECT_EQ(10000000, aligned.nextExpiry(0));
+    EXPECT_EQ(20000000, aligned.nextExpiry(10000000));
+    EXPECT_EQ(130000000, aligned.nextExpiry(123456789));
+    EXPECT_EQ(3000000, shifted.nextExpiry(0));
+    EXPECT_EQ(13000000, shifted.nextExpiry(3000000));
+    EXPECT_EQ(123000000, shifted.nextExpiry(120000000));
+    // a phase beyond the period wraps around
+    PeriodicTimer wrapped(period, std::chrono::milliseconds(23), std::make_shared<EventFlag>(), "wrapped");
+    EXPECT_EQ(shifted.nextExpiry(123456789), wrapped.nextExpiry(123456789));
+}
+
+TEST_F(PeriodicTimerTest, PeriodicHandler)
+{
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    auto component = std::make_shared<PeriodicComponent>(std::chrono::milliseconds(2),
+                                                         std::chrono::milliseconds(0));
+    manager.registerComponent(component);
+    manager.configure();
+
+    // not armed before the component is running
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(0u, component->fTimer->getExpirations());
+
+    manager.startup();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    manager.shutdown();
+
+    const uint64_t expirations = component->fTimer->getExpirations();
+    EXPECT_GE(expirations, 40u);
+    EXPECT_LE(expirations, 60u);
+    // the last expiry may not have been handled before shutdown
+    EXPECT_NEAR(static_cast<double>(expirations),
+                static_cast<double>(component->fRuns + component->fTimer->getOverruns()), 1.0);
+
+    // disarmed after shutdown
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(expirations, component->fTimer->getExpirations());
+}
+
+TEST_F(PeriodicTimerTest, Overruns)
+{
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    // the handler takes longer than the period
+    auto component = std::make_shared<PeriodicComponent>(std::chrono::milliseconds(2),
+                                                         std::chrono::milliseconds(5));
+    manager.registerComponent(component);
+    manager.configure();
+    manager.startup();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    manager.shutdown();
+
+    EXPECT_GT(component->fTimer->getOverruns(), component->fRuns.load());
+    EXPECT_LE(component->fRuns, component->fTimer->getExpirations());
+}
+
+} // namespace mcf
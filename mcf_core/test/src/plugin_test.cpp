@@ -8,6 +8,8 @@
 #include "mcf_core/PluginManager.h"
 #include "test/TestValue.h"
 
+#include <cstdio>
+
 namespace
 {
 class PluginTest : public ::testing::Test
@@ -267,6 +269,66 @@ TEST_F(PluginTest, LoadPluginFromDSO)
     manager.shutdown();
 }
 
+TEST_F(PluginTest, LoadAllPluginsFromDSOs)
+{
+    mcf::PluginLoader loader;
+    auto plugins = loader.loadAll({PluginTest::PLUGIN_DSO_PATH});
+    ASSERT_EQ(plugins.size(), 1);
+    EXPECT_EQ(plugins[0].name(), "SimplePluginLibrary");
+
+    auto loadTimes = loader.loadTimes();
+    ASSERT_EQ(loadTimes.size(), 1);
+    EXPECT_EQ(loadTimes[0].filePath, PluginTest::PLUGIN_DSO_PATH);
+    EXPECT_FALSE(loadTimes[0].deferred);
+
+    mcf::PluginLoader failingLoader;
+    EXPECT_THROW(failingLoader.loadAll({PluginTest::PLUGIN_DSO_PATH, "missing.so"}), mcf::PluginError);
+}
+
+TEST_F(PluginTest, LoadDeferredPluginFromDSO)
+{
+    const std::string manifestFile = "plugin_test_manifest.json";
+    {
+        mcf::PluginLoader loader;
+        auto plugin = loader.load(PluginTest::PLUGIN_DSO_PATH);
+        mcf::PluginLoader::writeManifests(
+            manifestFile, {mcf::PluginLoader::manifest(PluginTest::PLUGIN_DSO_PATH, plugin)});
+    }
+    auto manifests = mcf::PluginLoader::readManifests(manifestFile);
+    std::remove(manifestFile.c_str());
+    ASSERT_EQ(manifests.size(), 1);
+    EXPECT_EQ(manifests[0].name, "SimplePluginLibrary");
+    EXPECT_EQ(manifests[0].typeNames, std::vector<std::string>({"com/esrlabs/TestComponent"}));
+
+    mcf::PluginLoader loader;
+    auto plugin = loader.loadDeferred(manifests[0]);
+
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    mcf::ComponentInstantiator instantiator(manager);
+    mcf::PluginManager pluginManager(instantiator);
+
+    auto types = pluginManager.registerPlugin(plugin);
+    EXPECT_EQ(loader.loadTimes().size(), 0);
+
+    for (const auto& type : types)
+    {
+        auto proxy = instantiator.createComponent(type, type);
+        proxy.configure();
+        proxy.startup();
+    }
+    auto loadTimes = loader.loadTimes();
+    ASSERT_EQ(loadTimes.size(), 1);
+    EXPECT_TRUE(loadTimes[0].deferred);
+
+    valueStore.setValue("/tick", TestValue(23));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    EXPECT_TRUE(valueStore.hasValue("/tack"));
+
+    manager.shutdown();
+}
+
 TEST_F(PluginTest, ReLoadPluginFromDSO)
 {
     mcf::PluginLoader loader;
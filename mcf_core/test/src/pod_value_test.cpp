@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/PodValue.h"
+#include "mcf_core/TypeRegistry.h"
+#include "mcf_core/Value.h"
+
+namespace mcf {
+
+namespace {
+
+enum PodTestMode {OFF, ON};
+
+/*
+ * POD packed value as generated by the types generator for
+ * { valid: bool, mode: PodTestMode, count: uint16_t, position: double }
+ */
+struct PodTestValue : public Value {
+    bool valid = false;
+    PodTestMode mode = OFF;
+    uint16_t count = 0;
+    double position = 0.;
+
+    static constexpr std::size_t POD_SIZE = 24;
+    static constexpr uint64_t POD_LAYOUT_HASH = 0x0123456789abcdefull;
+
+    template<typename Packer>
+    void msgpack_pack(Packer& packer) const {
+        pod::Writer<POD_SIZE> writer(POD_LAYOUT_HASH);
+        writer.put<uint8_t>(0, valid ? 1 : 0);
+        writer.put<int32_t>(4, static_cast<int32_t>(mode));
+        writer.put<uint16_t>(8, count);
+        writer.put<double>(16, position);
+        writer.pack(packer);
+    }
+
+    void msgpack_unpack(const msgpack::object& object) {
+        const pod::Reader reader(object, POD_LAYOUT_HASH, POD_SIZE);
+        valid = reader.get<uint8_t>(0) != 0;
+        mode = static_cast<PodTestMode>(reader.get<int32_t>(4));
+        count = reader.get<uint16_t>(8);
+        position = reader.get<double>(16);
+    }
+};
+
+struct MsgpackTestValue : public Value {
+    int number = 0;
+    MSGPACK_DEFINE(number)
+};
+
+} // anonymous namespace
+
+TEST(PodValueTest, RoundTrip) {
+    PodTestValue value;
+    value.valid = true;
+    value.mode = ON;
+    value.count = 4711;
+    value.position = -2.5;
+
+    msgpack::sbuffer buffer;
+    msgpack::pack(buffer, value);
+    constexpr std::size_t packedSize = pod::PackedSize<PodTestValue>::value;
+    EXPECT_EQ(packedSize, buffer.size());
+
+    auto handle = msgpack::unpack(buffer.data(), buffer.size());
+    ASSERT_EQ(msgpack::type::BIN, handle.get().type);
+    EXPECT_EQ(pod::HEADER_SIZE + PodTestValue::POD_SIZE, handle.get().via.bin.size);
+
+    const auto unpacked = handle.get().as<PodTestValue>();
+    EXPECT_TRUE(unpacked.valid);
+    EXPECT_EQ(ON, unpacked.mode);
+    EXPECT_EQ(4711, unpacked.count);
+    EXPECT_EQ(-2.5, unpacked.position);
+}
+
+TEST(PodValueTest, Mismatch) {
+    // other layout hash
+    msgpack::sbuffer buffer;
+    pod::Writer<PodTestValue::POD_SIZE> writer(PodTestValue::POD_LAYOUT_HASH + 1);
+    msgpack::packer<msgpack::sbuffer> packer(&buffer);
+    writer.pack(packer);
+    auto handle = msgpack::unpack(buffer.data(), buffer.size());
+    EXPECT_THROW(handle.get().as<PodTestValue>(), msgpack::type_error);
+
+    // other size
+    buffer.clear();
+    pod::Writer<PodTestValue::POD_SIZE + 8> longer(PodTestValue::POD_LAYOUT_HASH);
+    longer.pack(packer);
+    handle = msgpack::unpack(buffer.data(), buffer.size());
+    EXPECT_THROW(handle.get().as<PodTestValue>(), msgpack::type_error);
+
+    // no bin
+    buffer.clear();
+    packer.pack(42);
+    handle = msgpack::unpack(buffer.data(), buffer.size());
+    EXPECT_THROW(handle.get().as<PodTestValue>(), msgpack::type_error);
+}
+
+TEST(PodValueTest, Codec) {
+    EXPECT_TRUE(pod::IsPod<PodTestValue>::value);
+    EXPECT_FALSE(pod::IsPod<MsgpackTestValue>::value);
+
+    TypeRegistry registry;
+    registry.registerType<PodTestValue>("PodTestValue");
+    registry.registerType<MsgpackTestValue>("MsgpackTestValue");
+
+    PodTestValue value;
+    value.count = 3;
+    const auto* entry = registry.findTypeInfo(value);
+    ASSERT_NE(nullptr, entry);
+    constexpr std::size_t packedSize = pod::PackedSize<PodTestValue>::value;
+    EXPECT_EQ(packedSize, entry->codec->podSize);
+
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(&buffer);
+    TypeRegistry::pack(packer, value, *entry);
+    EXPECT_EQ(TypeRegistry::packedSize(value, *entry), buffer.size());
+
+    MsgpackTestValue other;
+    EXPECT_EQ(0u, registry.findTypeInfo(other)->codec->podSize);
+}
+
+} // namespace mcf
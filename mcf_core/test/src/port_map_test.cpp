@@ -6,6 +6,10 @@
 #include "test/TestUtils.h"
 #include "test/TestValue.h"
 
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
 namespace mcf
 {
 class PortMapTest : public ::testing::Test
@@ -140,6 +144,45 @@ TEST_F(PortMapTest, DynamicRemapping)
         valueStore.hasValue("/tack") && valueStore.getValue<TestValue>("/tack")->val == 42);
 }
 
+TEST_F(PortMapTest, RemapWhileWriting)
+{
+    /*
+     * Ports are accessed without locking, while they are remapped concurrently
+     */
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+
+    auto component = std::make_shared<TestComponent>();
+    auto proxy     = manager.registerComponent(component);
+    proxy.configure();
+    proxy.mapPort("tack", "/tackA");
+    proxy.startup();
+
+    std::atomic<bool> stop(false);
+    std::thread writer([&component, &stop]() {
+        int val = 0;
+        while (!stop)
+        {
+            component->fTackPort.setValue(TestValue(++val));
+        }
+    });
+    for (int i = 0; i < 200; ++i)
+    {
+        proxy.mapPort("tack", i % 2 == 0 ? "/tackB" : "/tackA");
+    }
+    // let the writer see the last mapping
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    stop = true;
+    writer.join();
+
+    EXPECT_EQ("/tackA", component->fTackPort.getTopic());
+    EXPECT_TRUE(valueStore.hasValue("/tackA"));
+    const int last = valueStore.getValue<TestValue>("/tackA")->val;
+    EXPECT_EQ(0, component->fTackPort.setValue(TestValue(last + 1)));
+    EXPECT_EQ(last + 1, valueStore.getValue<TestValue>("/tackA")->val);
+    manager.shutdown();
+}
+
 TEST_F(PortMapTest, Interface)
 {
     /*
@@ -175,4 +218,108 @@ TEST_F(PortMapTest, Interface)
     EXPECT_EQ(valueStore.getValue<TestValue>("/tack")->val, 17);
 }
 
+TEST_F(PortMapTest, RoutingTable)
+{
+    /*
+     * Topics nobody reads are elided at startup, until a receiver is added
+     */
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+    manager.setTopicElision(true);
+
+    auto component = std::make_shared<TestComponent>();
+    auto proxy     = manager.registerComponent(component);
+    manager.registerComponent(std::make_shared<Consumer>());
+    manager.configure();
+    proxy.mapPort("tick", "/tick");
+    proxy.mapPort("tack", "/tack");
+
+    auto allTopics = std::make_shared<mcf::ValueQueue>();
+    valueStore.addAllTopicReceiver(allTopics);
+    manager.startup();
+
+    auto routes = manager.getRoutingTable();
+    ASSERT_EQ(3u, routes.size());
+    EXPECT_EQ("/listener", routes[0].topic);
+    EXPECT_TRUE(routes[0].senders.empty());
+    EXPECT_EQ(std::vector<std::string>{"Consumer.Consumer"}, routes[0].receivers);
+    EXPECT_FALSE(routes[0].elided);
+    EXPECT_EQ("/tack", routes[1].topic);
+    EXPECT_EQ(std::vector<std::string>{"TestComponent.tack"}, routes[1].senders);
+    EXPECT_EQ(0u, routes[1].fanOut);
+    EXPECT_TRUE(routes[1].elided);
+    EXPECT_EQ("/tick", routes[2].topic);
+    EXPECT_EQ(1u, routes[2].fanOut);
+    EXPECT_FALSE(routes[2].elided);
+
+    // an elided topic keeps no value, receivers of all topics still see it
+    valueStore.setValue("/tick", TestValue(17));
+    std::string topic;
+    for (int i = 0; i < 200 && topic != "/tack"; ++i)
+    {
+        if (allTopics->empty())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        topic = std::get<1>(allTopics->popWithTopic<TestValue>());
+    }
+    EXPECT_EQ("/tack", topic);
+    EXPECT_FALSE(valueStore.hasValue("/tack"));
+
+    valueStore.addReceiver("/tack", std::make_shared<mcf::ValueQueue>());
+    EXPECT_FALSE(valueStore.isElided(valueStore.getTopicHandle("/tack")));
+    valueStore.setValue("/tick", TestValue(18));
+    waitForValue(valueStore, "/tack");
+    EXPECT_EQ(18, valueStore.getValue<TestValue>("/tack")->val);
+    manager.shutdown();
+}
+
+TEST_F(PortMapTest, SenderSubscribers)
+{
+    /*
+     * Sender ports know whether anyone receives or records their values
+     */
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager(valueStore);
+
+    auto component = std::make_shared<TestComponent>();
+    auto proxy     = manager.registerComponent(component);
+    manager.configure();
+    proxy.mapPort("tick", "/tick");
+    proxy.mapPort("tack", "/tack");
+    manager.startup();
+
+    mcf::SenderPort<TestValue>& port = component->fTackPort;
+    std::vector<bool> changes;
+    port.setSubscriptionCallback([&changes](bool subscribed) { changes.push_back(subscribed); });
+    EXPECT_FALSE(port.hasSubscribers());
+
+    auto receiver = std::make_shared<mcf::ValueQueue>();
+    valueStore.addReceiver("/tack", receiver);
+    EXPECT_TRUE(port.hasSubscribers());
+    valueStore.removeReceiver("/tack", receiver);
+    EXPECT_FALSE(port.hasSubscribers());
+
+    // a recorder subscribes the topics it does not exclude
+    const std::string filename = "sender_subscribers.bin";
+    mcf::ValueRecorder recorder(valueStore);
+    recorder.disableSerialization("/tack");
+    recorder.start(filename);
+    EXPECT_FALSE(port.hasSubscribers());
+    recorder.stop();
+    mcf::ValueRecorder tackRecorder(valueStore);
+    tackRecorder.start(filename);
+    EXPECT_TRUE(port.hasSubscribers());
+    tackRecorder.disableSerialization("/tack");
+    EXPECT_FALSE(port.hasSubscribers());
+    tackRecorder.stop();
+    std::remove(filename.c_str());
+
+    valueStore.addReceiver("/tack", receiver);
+    manager.shutdown();
+    EXPECT_FALSE(port.hasSubscribers());
+    EXPECT_EQ((std::vector<bool>{false, true, false, true, false, true, false}), changes);
+}
+
 } // namespace mcf
\ No newline at end of file
@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/ExtMemValue.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/PreviewService.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace mcf {
+
+namespace {
+
+class TestImage : public ExtMemValue<uint8_t> {
+public:
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t pitch = 0;
+    MSGPACK_DEFINE(width, height, pitch);
+};
+
+class OtherImage : public ExtMemValue<uint8_t> {
+public:
+    int val = 0;
+    MSGPACK_DEFINE(val);
+};
+
+/**
+ * A gray image whose pixels are their column plus their row times 10, with padding bytes of 255
+ */
+TestImage makeImage(uint32_t width, uint32_t height, uint32_t pitch) {
+    TestImage image;
+    image.width = width;
+    image.height = height;
+    image.pitch = pitch;
+    image.extMemInit(static_cast<uint64_t>(pitch) * height);
+    auto* pixels = static_cast<uint8_t*>(image.extMemPtr());
+    std::memset(pixels, 255, static_cast<size_t>(pitch) * height);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            pixels[y * pitch + x] = static_cast<uint8_t>(x + 10 * y);
+        }
+    }
+    return image;
+}
+
+void registerTestImage() {
+    PreviewService::registerImageType<TestImage>([](const TestImage& value, ImageView& image) {
+        image.data = value.extMemPtr();
+        image.width = value.width;
+        image.height = value.height;
+        image.pitch = value.pitch;
+        image.channels = 1;
+        return value.extMemSize() > 0;
+    });
+}
+
+} // anonymous namespace
+
+TEST(PreviewServiceTest, Downscale) {
+    // 2 x 2 rgb blocks averaged per channel, the incomplete last column and row are dropped
+    const uint32_t width = 5;
+    const uint32_t height = 3;
+    const uint32_t pitch = 16;
+    std::vector<uint8_t> pixels(pitch * height, 0);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            pixels[y * pitch + x * 3] = static_cast<uint8_t>(4 * x);
+            pixels[y * pitch + x * 3 + 1] = static_cast<uint8_t>(4 * y);
+            pixels[y * pitch + x * 3 + 2] = 200;
+        }
+    }
+    ImageView image;
+    image.data = pixels.data();
+    image.width = width;
+    image.height = height;
+    image.pitch = pitch;
+    image.channels = 3;
+
+    std::vector<uint8_t> out(2 * 1 * 3);
+    PreviewService::downscale(image, 2, out.data());
+    EXPECT_EQ(2, out[0]);
+    EXPECT_EQ(2, out[1]);
+    EXPECT_EQ(200, out[2]);
+    EXPECT_EQ(10, out[3]);
+    EXPECT_EQ(2, out[4]);
+    EXPECT_EQ(200, out[5]);
+
+    // factor 1 drops the padding only
+    std::vector<uint8_t> copy(width * height * 3);
+    PreviewService::downscale(image, 1, copy.data());
+    EXPECT_EQ(0, std::memcmp(copy.data() + width * 3, pixels.data() + pitch, width * 3));
+}
+
+TEST(PreviewServiceTest, PublishPreviews) {
+    registerTestImage();
+    ValueStore valueStore;
+    valueStore.registerType<TestImage>("TestImage");
+    valueStore.registerType<OtherImage>("OtherImage");
+
+    PreviewConfig config;
+    config.topics = {"/camera/*"};
+    config.maxWidth = 20;
+    config.maxHeight = 20;
+    PreviewService previews(valueStore, config);
+
+    valueStore.setValue("/camera/front", makeImage(64, 32, 80));
+    valueStore.setValue("/camera/other", OtherImage());
+    valueStore.setValue("/lidar", makeImage(8, 8, 8));
+    EXPECT_EQ(1u, previews.update());
+
+    const std::string topic = std::string(PreviewService::TOPIC_PREFIX) + "/camera/front";
+    auto preview = valueStore.getValue<msg::PreviewImage>(topic);
+    ASSERT_NE(nullptr, preview);
+    EXPECT_EQ("/camera/front", preview->topic);
+    // the smallest factor fitting 64 x 32 into 20 x 20
+    EXPECT_EQ(4u, preview->factor);
+    EXPECT_EQ(16u, preview->width);
+    EXPECT_EQ(8u, preview->height);
+    EXPECT_EQ(1u, preview->channels);
+    if (preview->encoding == "raw") {
+        ASSERT_EQ(16u * 8u, preview->extMemSize());
+        const auto* pixels = static_cast<const uint8_t*>(preview->extMemPtr());
+        // the average of columns 4 to 7 and rows 8 to 11
+        EXPECT_EQ(static_cast<uint8_t>(5.5 + 10 * 9.5 + 0.5), pixels[2 * 16 + 1]);
+    }
+    EXPECT_FALSE(valueStore.hasValue(std::string(PreviewService::TOPIC_PREFIX) + "/camera/other"));
+    EXPECT_FALSE(valueStore.hasValue(std::string(PreviewService::TOPIC_PREFIX) + "/lidar"));
+
+    // no new image, no new preview
+    EXPECT_EQ(0u, previews.update());
+    valueStore.setValue("/camera/front", makeImage(64, 32, 64));
+    EXPECT_EQ(1u, previews.update());
+}
+
+} // namespace mcf
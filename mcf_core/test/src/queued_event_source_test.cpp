@@ -0,0 +1,189 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/EventTimingController.h"
+#include "mcf_core/IEventTimingController.h"
+#include "mcf_core/QueuedEventSource.h"
+#include "mcf_core/TimestampType.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mcf {
+
+namespace {
+
+class TestValue : public mcf::Value {
+public:
+    TestValue(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+class NullEventTimingController : public IEventTimingController {
+public:
+    void triggerNewEventPushed(IDynamicEventSource*) override {}
+};
+
+class Collector : public IValueReceiver {
+public:
+    void receive(const std::string&, ValuePtr& value) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        values.push_back(static_cast<const TestValue&>(*value).val);
+    }
+
+    std::mutex mutex;
+    std::vector<int> values;
+};
+
+int fireNext(QueuedEventSource& eventSource, ValueStore& valueStore, const std::string& expectedTopic)
+{
+    TimestampType time;
+    std::string topic;
+    EXPECT_TRUE(eventSource.getNextEventInfo(time, topic));
+    EXPECT_EQ(expectedTopic, topic);
+    eventSource.fireEvent();
+    return valueStore.getValue<TestValue>(topic)->val;
+}
+
+} // anonymous namespace
+
+TEST(QueuedEventSourceTest, FireInTimeOrder)
+{
+    ValueStore valueStore;
+    auto eventTimingController = std::make_shared<NullEventTimingController>();
+    QueuedEventSource eventSource(valueStore, eventTimingController);
+
+    // in order, growing the ring
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 20; ++i)
+        {
+            eventSource.pushNewEvent(TimestampType(static_cast<uint64_t>(1000 + round * 100 + i)), "/ring", std::make_shared<TestValue>(i));
+        }
+        for (int i = 0; i < 20; ++i)
+        {
+            EXPECT_EQ(i, fireNext(eventSource, valueStore, "/ring"));
+        }
+    }
+
+    // out of order, events of the same time in push order
+    const std::vector<uint64_t> times = {50, 10, 30, 10, 70, 20, 30};
+    for (size_t i = 0; i < times.size(); ++i)
+    {
+        eventSource.pushNewEvent(TimestampType(times[i]), "/heap", std::make_shared<TestValue>(static_cast<int>(i)));
+    }
+    std::size_t size = 0;
+    QueuedEventSource::IntTimestamp firstTime = 0;
+    QueuedEventSource::IntTimestamp lastTime = 0;
+    eventSource.getEventQueueInfo(size, firstTime, lastTime);
+    EXPECT_EQ(times.size(), size);
+    EXPECT_EQ(10u, firstTime);
+    EXPECT_EQ(70u, lastTime);
+
+    for (int expected : {1, 3, 5})
+    {
+        EXPECT_EQ(expected, fireNext(eventSource, valueStore, "/heap"));
+    }
+    EXPECT_TRUE(eventSource.seekQueuedEvent(40));
+    for (int expected : {0, 4})
+    {
+        EXPECT_EQ(expected, fireNext(eventSource, valueStore, "/heap"));
+    }
+    TimestampType time;
+    std::string topic;
+    EXPECT_FALSE(eventSource.getNextEventInfo(time, topic));
+}
+
+TEST(QueuedEventSourceTest, PushBatch)
+{
+    ValueStore valueStore;
+    auto eventTimingController = std::make_shared<NullEventTimingController>();
+    QueuedEventSource eventSource(valueStore, eventTimingController);
+
+    std::vector<QueuedEventSource::NewEvent> events;
+    for (int i = 0; i < 3; ++i)
+    {
+        events.push_back({TimestampType(static_cast<uint64_t>(30 - i * 10)), "/batch", std::make_shared<TestValue>(i), "", ""});
+    }
+    eventSource.pushNewEvents(events);
+    eventSource.pushNewEvent(TimestampType(static_cast<uint64_t>(20)), "/single", std::make_shared<TestValue>(3));
+
+    // batched and single events are fired in time order, the same time in push order
+    EXPECT_EQ(2, fireNext(eventSource, valueStore, "/batch"));
+    EXPECT_EQ(1, fireNext(eventSource, valueStore, "/batch"));
+    EXPECT_EQ(3, fireNext(eventSource, valueStore, "/single"));
+    EXPECT_EQ(0, fireNext(eventSource, valueStore, "/batch"));
+}
+
+TEST(QueuedEventSourceTest, FinishWakesEventTimingController)
+{
+    ValueStore valueStore;
+    auto eventTimingController = std::make_shared<EventTimingController>();
+    eventTimingController->setUnthrottled(true);
+    auto eventSource = std::make_shared<QueuedEventSource>(valueStore, eventTimingController);
+    eventTimingController->addEventSource(eventSource, "queued");
+    eventTimingController->start();
+
+    // the event timing controller waits without events until the source pushes or finishes
+    const int n = 10;
+    for (int i = 0; i < n; ++i)
+    {
+        eventSource->pushNewEvent(TimestampType(static_cast<uint64_t>(1000 + i)), "/value", std::make_shared<TestValue>(i));
+    }
+    while (!valueStore.hasValue("/value") || valueStore.getValue<TestValue>("/value")->val != n - 1)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_FALSE(eventTimingController->isFinished());
+
+    eventSource->setEventSourceFinished(true);
+    eventTimingController->waitTillFinished();
+    EXPECT_TRUE(eventTimingController->isFinished());
+}
+
+TEST(QueuedEventSourceTest, SeekWithPreRoll)
+{
+    ValueStore valueStore;
+    auto collector = std::make_shared<Collector>();
+    valueStore.addReceiver("/value", collector);
+
+    auto eventTimingController = std::make_shared<EventTimingController>();
+    eventTimingController->setUnthrottled(true);
+    auto eventSource = std::make_shared<QueuedEventSource>(valueStore, eventTimingController);
+    eventTimingController->addEventSource(eventSource, "queued");
+    for (int i = 0; i < 10; ++i)
+    {
+        eventSource->pushNewEvent(TimestampType(static_cast<uint64_t>(1000 * (i + 1))), "/value", std::make_shared<TestValue>(i));
+    }
+
+    // playback starts the pre-roll before the seek target, the events before are dropped
+    EXPECT_TRUE(eventTimingController->seek(TimestampType(static_cast<uint64_t>(6000)), std::chrono::microseconds(2000)));
+    eventTimingController->start();
+    eventSource->setEventSourceFinished(true);
+    eventTimingController->waitTillFinished();
+    {
+        std::lock_guard<std::mutex> lock(collector->mutex);
+        EXPECT_EQ(std::vector<int>({3, 4, 5, 6, 7, 8, 9}), collector->values);
+    }
+
+    // fired events cannot be restored
+    EXPECT_FALSE(eventSource->seek(TimestampType(static_cast<uint64_t>(2000))));
+    eventSource->pushNewEvent(TimestampType(static_cast<uint64_t>(20000)), "/value", std::make_shared<TestValue>(20));
+    EXPECT_FALSE(eventSource->seek(TimestampType(static_cast<uint64_t>(5000))));
+    std::size_t size = 0;
+    QueuedEventSource::IntTimestamp firstTime = 0;
+    QueuedEventSource::IntTimestamp lastTime = 0;
+    eventSource->getEventQueueInfo(size, firstTime, lastTime);
+    EXPECT_EQ(1u, size);
+    EXPECT_TRUE(eventSource->seek(TimestampType(static_cast<uint64_t>(30000))));
+    eventSource->getEventQueueInfo(size, firstTime, lastTime);
+    EXPECT_EQ(0u, size);
+}
+
+} // end namespace mcf
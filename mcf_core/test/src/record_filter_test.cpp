@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/ExtMemValue.h"
+#include "mcf_core/RecordFilter.h"
+#include "mcf_core/RecordReader.h"
+#include "mcf_core/ValueRecorder.h"
+
+#include <cstdio>
+#include <map>
+
+namespace mcf {
+
+namespace {
+
+class TestValue : public mcf::Value {
+public:
+    TestValue(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+class TestValueExtMem : public mcf::ExtMemValue<uint8_t> {
+public:
+    TestValueExtMem(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+void registerTestTypes(TypeRegistry& registry)
+{
+    registry.registerType<TestValue>("TestValue");
+    registry.registerType<TestValueExtMem>("TestValueExtMem");
+}
+
+void publishExtMem(ValueStore& valueStore, const std::string& topic, int val, size_t size)
+{
+    auto value = TestValueExtMem(val);
+    value.extMemInit(size);
+    std::fill(value.extMemPtr(), value.extMemPtr() + size, static_cast<uint8_t>(val));
+    valueStore.setValue(topic, std::move(value));
+}
+
+} // anonymous namespace
+
+TEST(RecordFilterTest, FilterTopicsAndTypes)
+{
+    ValueStore valueStore;
+    registerTestTypes(valueStore);
+    ValueRecorder recorder(valueStore);
+    recorder.enableExtMemSerialization("/plain");
+    recorder.enableExtMemSerialization("/delta");
+    recorder.enableDeltaEncoding("/delta", 5);
+
+    const std::string input = "record_filter_in.bin";
+    const std::string output = "record_filter_out.bin";
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+    recorder.start(input);
+    const int n = 20;
+    const size_t extMemSize = 300;
+    for (int i = 0; i < n; ++i)
+    {
+        valueStore.setValue("/value", TestValue(i));
+        valueStore.setValue("/other", TestValue(i));
+        publishExtMem(valueStore, "/plain", i, extMemSize);
+        publishExtMem(valueStore, "/delta", i, extMemSize);
+    }
+    recorder.stop();
+
+    RecordFilter::Options options;
+    options.topics = {"/value", "/plain", "/delta"};
+    options.types = {"TestValueExtMem"};
+    options.reindex = true;
+    const auto statistics = RecordFilter::run(input, output, options);
+    EXPECT_EQ(static_cast<uint64_t>(2 * n), statistics.records);
+    // the plain records are copied, the delta encoded ones written with their values
+    EXPECT_GE(statistics.copiedBytes, n * extMemSize);
+    EXPECT_GT(statistics.writtenBytes, n * extMemSize);
+
+    RecordReader reader;
+    reader.open(output);
+    ASSERT_NE(nullptr, reader.getFooter());
+    EXPECT_EQ(std::vector<std::string>({"/delta", "/plain"}), reader.getFooter()->topics);
+
+    std::map<std::string, int> counts;
+    RecordReader::Record record;
+    while (reader.next(record))
+    {
+        const std::string topic = record.topic.str();
+        const int i = counts[topic]++;
+        if (topic == ValueRecorder::FOOTER_TOPIC)
+        {
+            continue;
+        }
+        auto value = std::dynamic_pointer_cast<const TestValueExtMem>(
+            RecordReader::getValue(record, valueStore));
+        ASSERT_NE(nullptr, value) << topic;
+        EXPECT_EQ(i, value->val);
+        ASSERT_EQ(extMemSize, value->extMemSize());
+        EXPECT_EQ(static_cast<uint8_t>(i), value->extMemPtr()[extMemSize - 1]);
+    }
+    EXPECT_EQ(3u, counts.size());
+    EXPECT_EQ(n, counts["/plain"]);
+    EXPECT_EQ(n, counts["/delta"]);
+    EXPECT_EQ(1, counts[ValueRecorder::FOOTER_TOPIC]);
+
+    // the input is never overwritten
+    EXPECT_THROW(RecordFilter::run(input, input, options), std::runtime_error);
+
+    reader.close();
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+}
+
+TEST(RecordFilterTest, FilterTime)
+{
+    ValueStore valueStore;
+    registerTestTypes(valueStore);
+    ValueRecorder recorder(valueStore);
+
+    const std::string input = "record_filter_time_in.bin";
+    const std::string output = "record_filter_time_out.bin";
+    std::remove(input.c_str());
+    recorder.start(input);
+    for (int i = 0; i < 10; ++i)
+    {
+        valueStore.setValue("/value", TestValue(i));
+    }
+    recorder.stop();
+
+    std::vector<uint64_t> times;
+    RecordReader reader;
+    reader.open(input);
+    RecordReader::Record record;
+    while (reader.next(record))
+    {
+        if (record.topic == "/value")
+        {
+            times.push_back(record.time);
+        }
+    }
+    reader.close();
+    ASSERT_EQ(10u, times.size());
+
+    RecordFilter::Options options;
+    options.endTime = times.front() - 1;
+    EXPECT_EQ(0u, RecordFilter::run(input, output, options).records);
+    options.startTime = times.front();
+    options.endTime = times.back();
+    EXPECT_EQ(10u, RecordFilter::run(input, output, options).records);
+
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+}
+
+} // end namespace mcf
@@ -0,0 +1,375 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/ExtMemValue.h"
+#include "mcf_core/RecordReader.h"
+#include "mcf_core/ValueRecorder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+class TestValue : public mcf::Value {
+public:
+    TestValue(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+class TestValueExtMem : public mcf::ExtMemValue<uint8_t> {
+public:
+    TestValueExtMem(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+void registerTestTypes(TypeRegistry& registry)
+{
+    registry.registerType<TestValue>("TestValue");
+    registry.registerType<TestValueExtMem>("TestValueExtMem");
+}
+
+void publishExtMem(ValueStore& valueStore, const std::string& topic, int val, size_t size)
+{
+    auto value = TestValueExtMem(val);
+    value.extMemInit(size);
+    std::fill(value.extMemPtr(), value.extMemPtr() + size, 1);
+    value.extMemPtr()[val % size] = static_cast<uint8_t>(val);
+    valueStore.setValue(topic, std::move(value));
+}
+
+void checkExtMem(const RecordReader::Record& record, int val, size_t size)
+{
+    ASSERT_EQ(size, record.extMemSize);
+    ASSERT_EQ(size, record.extMem.size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        ASSERT_EQ(i == val % size ? static_cast<char>(val) : 1, record.extMem.data[i]);
+    }
+}
+
+} // anonymous namespace
+
+TEST(RecordReaderTest, Read)
+{
+    ValueStore valueStore;
+    registerTestTypes(valueStore);
+    ValueRecorder recorder(valueStore);
+    recorder.enableExtMemSerialization("/plain");
+    recorder.enableExtMemSerialization("/compressed");
+    recorder.enableExtMemCompression("/compressed");
+    recorder.enableExtMemSerialization("/chunked");
+    recorder.enableChunkCompression("/chunked");
+    recorder.enableExtMemSerialization("/delta");
+    recorder.enableDeltaEncoding("/delta", 5);
+
+    const std::string testfile = "record_reader.bin";
+    std::remove(testfile.c_str());
+    recorder.start(testfile);
+    const int n = 20;
+    const size_t extMemSize = 300;
+    for (int i = 0; i < n; ++i)
+    {
+        valueStore.setValue("/value", TestValue(i));
+        publishExtMem(valueStore, "/plain", i, extMemSize);
+        publishExtMem(valueStore, "/compressed", i, extMemSize);
+        publishExtMem(valueStore, "/chunked", i, extMemSize);
+        publishExtMem(valueStore, "/delta", i, extMemSize);
+    }
+    recorder.stop();
+
+    RecordReader reader;
+    reader.open(testfile);
+    ASSERT_NE(nullptr, reader.getFooter());
+    EXPECT_EQ(static_cast<uint64_t>(n), reader.getFooter()->counts[0]);
+
+    std::map<std::string, int> counts;
+    RecordReader::Record record;
+    while (reader.next(record))
+    {
+        const std::string topic = record.topic.str();
+        if (topic.compare(0, 5, "/mcf/") == 0)
+        {
+            ++counts[topic];
+            continue;
+        }
+        const int i = counts[topic]++;
+        ValuePtr value = RecordReader::getValue(record, valueStore);
+        ASSERT_NE(nullptr, value);
+        if (topic == "/value")
+        {
+            EXPECT_EQ("TestValue", record.tid.str());
+            EXPECT_EQ(0u, record.extMem.size);
+            EXPECT_EQ(i, std::dynamic_pointer_cast<const TestValue>(value)->val);
+            continue;
+        }
+        // chunked and delta encoded records are expanded
+        EXPECT_EQ("TestValueExtMem", record.tid.str());
+        checkExtMem(record, i, extMemSize);
+        auto extMemValue = std::dynamic_pointer_cast<const TestValueExtMem>(value);
+        ASSERT_NE(nullptr, extMemValue);
+        EXPECT_EQ(i, extMemValue->val);
+        EXPECT_EQ(record.vid, value->id());
+        ASSERT_EQ(extMemSize, extMemValue->extMemSize());
+        EXPECT_EQ(static_cast<uint8_t>(i), extMemValue->extMemPtr()[i % extMemSize]);
+    }
+    for (const char* topic : {"/value", "/plain", "/compressed", "/chunked", "/delta"})
+    {
+        EXPECT_EQ(n, counts[topic]) << topic;
+    }
+    EXPECT_EQ(1, counts[ValueRecorder::FOOTER_TOPIC]);
+    EXPECT_EQ(0, counts[ValueRecorder::CHUNK_TOPIC]);
+
+    reader.setTopicFilter({"/delta", "/value"});
+    reader.rewind();
+    counts.clear();
+    while (reader.next(record))
+    {
+        ++counts[record.topic.str()];
+    }
+    EXPECT_EQ(2u, counts.size());
+    EXPECT_EQ(n, counts["/delta"]);
+    EXPECT_EQ(n, counts["/value"]);
+
+    reader.close();
+    std::remove(testfile.c_str());
+}
+
+TEST(RecordReaderTest, ShareExtMem)
+{
+    ValueStore valueStore;
+    registerTestTypes(valueStore);
+    ValueRecorder recorder(valueStore);
+    recorder.enableExtMemSerialization("/plain");
+
+    const std::string testfile = "record_reader_share.bin";
+    std::remove(testfile.c_str());
+    recorder.start(testfile);
+    const size_t extMemSize = 300;
+    publishExtMem(valueStore, "/plain", 7, extMemSize);
+    recorder.stop();
+
+    RecordReader reader;
+    reader.open(testfile);
+    reader.setTopicFilter({"/plain"});
+    RecordReader::Record record;
+
+    // copied by default
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(nullptr, record.extMemOwner);
+    auto copied = std::dynamic_pointer_cast<const TestValueExtMem>(RecordReader::getValue(record, valueStore));
+    ASSERT_NE(nullptr, copied);
+    EXPECT_NE(reinterpret_cast<const uint8_t*>(record.extMem.data), copied->extMemPtr());
+
+    reader.setShareExtMem(true);
+    reader.rewind();
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_NE(nullptr, record.extMemOwner);
+    auto shared = std::dynamic_pointer_cast<const TestValueExtMem>(RecordReader::getValue(record, valueStore));
+    ASSERT_NE(nullptr, shared);
+    EXPECT_EQ(reinterpret_cast<const uint8_t*>(record.extMem.data), shared->extMemPtr());
+
+    // the value keeps the mapping
+    reader.close();
+    record = RecordReader::Record();
+    ASSERT_EQ(extMemSize, shared->extMemSize());
+    EXPECT_EQ(7u, shared->extMemPtr()[7]);
+    EXPECT_EQ(1u, shared->extMemPtr()[8]);
+
+    // written values are copied first
+    auto value = std::const_pointer_cast<TestValueExtMem>(shared);
+    const uint8_t* mapped = shared->extMemPtr();
+    uint8_t* copy = value->extMemPtr();
+    EXPECT_NE(mapped, copy);
+    copy[8] = 2;
+    EXPECT_EQ(7u, copy[7]);
+    EXPECT_EQ(2u, copy[8]);
+
+    std::remove(testfile.c_str());
+}
+
+TEST(RecordReaderTest, Seek)
+{
+    ValueStore valueStore;
+    registerTestTypes(valueStore);
+    ValueRecorder recorder(valueStore);
+    recorder.enableExtMemSerialization("/delta");
+    recorder.enableDeltaEncoding("/delta");
+
+    const std::string testfile = "record_reader_seek.bin";
+    std::remove(testfile.c_str());
+    recorder.start(testfile);
+    for (int i = 0; i < 10; ++i)
+    {
+        valueStore.setValue("/value", TestValue(i));
+        publishExtMem(valueStore, "/delta", i, 100);
+    }
+    // the next values start a new checkpoint
+    std::this_thread::sleep_for(std::chrono::milliseconds(ValueRecorder::CHECKPOINT_INTERVAL_MS + 100));
+    for (int i = 10; i < 20; ++i)
+    {
+        valueStore.setValue("/value", TestValue(i));
+        publishExtMem(valueStore, "/delta", i, 100);
+    }
+    recorder.stop();
+
+    RecordReader reader;
+    reader.open(testfile);
+    ASSERT_NE(nullptr, reader.getFooter());
+    ASSERT_LE(2u, reader.getFooter()->times.size());
+    const uint64_t time = reader.getFooter()->times[1];
+    reader.setTopicFilter({"/delta", "/value"});
+    reader.seek(time);
+
+    RecordReader::Record record;
+    std::vector<int> values;
+    std::vector<int> deltas;
+    while (reader.next(record))
+    {
+        EXPECT_GE(record.time, time);
+        // starts at the checkpoint instead of the beginning of the file
+        EXPECT_GE(record.offset, reader.getFooter()->offsets[1]);
+        auto value = RecordReader::getValue(record, valueStore);
+        if (record.topic == "/value")
+        {
+            values.push_back(std::dynamic_pointer_cast<const TestValue>(value)->val);
+        }
+        else
+        {
+            const int i = std::dynamic_pointer_cast<const TestValueExtMem>(value)->val;
+            checkExtMem(record, i, 100);
+            deltas.push_back(i);
+        }
+    }
+    std::vector<int> expected{10, 11, 12, 13, 14, 15, 16, 17, 18, 19};
+    EXPECT_EQ(expected, values);
+    EXPECT_EQ(expected, deltas);
+
+    reader.close();
+    std::remove(testfile.c_str());
+}
+
+TEST(RecordReaderTest, Truncated)
+{
+    ValueStore valueStore;
+    registerTestTypes(valueStore);
+    ValueRecorder recorder(valueStore);
+
+    const std::string testfile = "record_reader_truncated.bin";
+    std::remove(testfile.c_str());
+    recorder.start(testfile);
+    for (int i = 0; i < 10; ++i)
+    {
+        valueStore.setValue("/value", TestValue(i));
+    }
+    recorder.stop();
+
+    std::string data;
+    {
+        std::ifstream in(testfile, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    // like a file of a running recorder: no footer and an incomplete last record
+    {
+        std::ofstream out(testfile, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size() / 2);
+    }
+
+    RecordReader reader;
+    reader.open(testfile);
+    EXPECT_EQ(nullptr, reader.getFooter());
+    RecordReader::Record record;
+    int count = 0;
+    while (reader.next(record))
+    {
+        if (record.topic == "/value")
+        {
+            EXPECT_EQ(count++, std::dynamic_pointer_cast<const TestValue>(
+                RecordReader::getValue(record, valueStore))->val);
+        }
+    }
+    EXPECT_GT(count, 0);
+    EXPECT_LT(count, 10);
+
+    EXPECT_THROW(reader.open("does_not_exist.bin"), std::runtime_error);
+    std::remove(testfile.c_str());
+}
+
+TEST(RecordReaderTest, RecoverSyncedSize)
+{
+    ValueStore valueStore;
+    registerTestTypes(valueStore);
+    ValueRecorder recorder(valueStore);
+    // sync after each batch
+    recorder.setDurability(1);
+
+    const std::string testfile = "record_reader_recover.bin";
+    const std::string crashfile = "record_reader_crash.bin";
+    std::remove(testfile.c_str());
+    recorder.start(testfile);
+    const int n = 50;
+    for (int i = 0; i < n; ++i)
+    {
+        valueStore.setValue("/test", TestValue(i));
+    }
+    // the marker is recorded after the sync has completed
+    std::string content;
+    for (int i = 0; i < 200 && content.find(ValueRecorder::SYNC_MAGIC) == std::string::npos; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::ifstream in(testfile, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    ASSERT_NE(std::string::npos, content.find(ValueRecorder::SYNC_MAGIC));
+
+    // a crash leaves the file without footer and possibly with garbage at its end
+    {
+        std::ofstream out(crashfile, std::ios::binary);
+        out << content << "garbage after the last record";
+    }
+    const uint64_t recovered = RecordReader::recover(crashfile);
+    EXPECT_LT(recovered, content.size());
+    EXPECT_GT(recovered, 0u);
+
+    RecordReader reader;
+    reader.open(crashfile);
+    EXPECT_EQ(recovered, reader.size());
+    EXPECT_EQ(nullptr, reader.getFooter());
+    RecordReader::Record record;
+    int next = 0;
+    while (reader.next(record))
+    {
+        if (record.topic == "/test")
+        {
+            auto value = std::dynamic_pointer_cast<const TestValue>(RecordReader::getValue(record, valueStore));
+            ASSERT_NE(nullptr, value);
+            EXPECT_EQ(next++, value->val);
+        }
+    }
+    // the values up to the synced size, at least those of the first batch
+    EXPECT_GT(next, 0);
+    EXPECT_LE(next, n);
+    reader.close();
+
+    // complete files are not changed
+    recorder.stop();
+    reader.open(testfile);
+    const uint64_t size = reader.size();
+    ASSERT_NE(nullptr, reader.getFooter());
+    reader.close();
+    EXPECT_EQ(size, RecordReader::recover(testfile));
+
+    std::remove(testfile.c_str());
+    std::remove(crashfile.c_str());
+}
+
+} // namespace mcf
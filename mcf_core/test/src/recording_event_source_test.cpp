@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/EventTimingController.h"
+#include "mcf_core/ExtMemValue.h"
+#include "mcf_core/RecordingEventSource.h"
+#include "mcf_core/TimestampType.h"
+#include "mcf_core/ValueRecorder.h"
+
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+class TestValue : public mcf::Value {
+public:
+    TestValue(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+class Collector : public IValueReceiver {
+public:
+    void receive(const std::string& topic, ValuePtr& value) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        values.push_back(std::dynamic_pointer_cast<const TestValue>(value)->val);
+    }
+
+    std::mutex mutex;
+    std::vector<int> values;
+};
+
+class UploadedValue : public ExtMemValue<uint8_t> {
+public:
+    UploadedValue(int val = 0) : val(val) {}
+    bool extMemUpload(int device) const override
+    {
+        uploadedTo = device;
+        return true;
+    }
+    int val;
+    mutable int uploadedTo = -1;
+    MSGPACK_DEFINE(val);
+};
+
+} // anonymous namespace
+
+TEST(RecordingEventSourceTest, ReplayRecording)
+{
+    const std::string testfile = "recording_event_source.bin";
+    const int n = 50;
+    {
+        ValueStore valueStore;
+        valueStore.registerType<TestValue>("TestValue");
+        ValueRecorder recorder(valueStore);
+        std::remove(testfile.c_str());
+        recorder.start(testfile);
+        for (int i = 0; i < n; ++i)
+        {
+            valueStore.setValue("/value", TestValue(i));
+            valueStore.setValue("/other", TestValue(-i));
+        }
+        recorder.stop();
+    }
+
+    ValueStore valueStore;
+    valueStore.registerType<TestValue>("TestValue");
+    auto collector = std::make_shared<Collector>();
+    valueStore.addReceiver("/value", collector);
+
+    auto eventTimingController = std::make_shared<EventTimingController>();
+    eventTimingController->setUnthrottled(true);
+    RecordingEventSource::Params params;
+    params.topics = {"/value"};
+    // smaller than the recording, so that reading has to wait for fired events
+    params.bufferBytes = 64;
+    auto eventSource = std::make_shared<RecordingEventSource>(
+        valueStore, testfile, eventTimingController, params);
+    eventTimingController->addEventSource(eventSource, "recording");
+    eventTimingController->start();
+    eventTimingController->waitTillFinished();
+
+    EXPECT_TRUE(eventSource->isFinished());
+    std::size_t events = 0;
+    std::size_t bytes = 0;
+    eventSource->getBufferInfo(events, bytes);
+    EXPECT_EQ(0u, events);
+    EXPECT_EQ(0u, bytes);
+
+    // the receiver is called from the firing thread, which has finished
+    std::lock_guard<std::mutex> lock(collector->mutex);
+    ASSERT_EQ(static_cast<size_t>(n), collector->values.size());
+    for (int i = 0; i < n; ++i)
+    {
+        EXPECT_EQ(i, collector->values[i]);
+    }
+    std::remove(testfile.c_str());
+}
+
+TEST(RecordingEventSourceTest, Seek)
+{
+    const std::string testfile = "recording_event_source_seek.bin";
+    const int n = 20;
+    {
+        ValueStore valueStore;
+        valueStore.registerType<TestValue>("TestValue");
+        ValueRecorder recorder(valueStore);
+        std::remove(testfile.c_str());
+        recorder.start(testfile);
+        for (int i = 0; i < n; ++i)
+        {
+            valueStore.setValue("/value", TestValue(i));
+            // records have a resolution of milliseconds
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        recorder.stop();
+    }
+
+    ValueStore valueStore;
+    valueStore.registerType<TestValue>("TestValue");
+    RecordingEventSource eventSource(valueStore, testfile, std::weak_ptr<IEventTimingController>());
+
+    // fires the remaining events, returns their times
+    auto fireAll = [&]()
+    {
+        std::vector<uint64_t> times;
+        while (!eventSource.isFinished())
+        {
+            TimestampType time;
+            std::string topic;
+            if (!eventSource.getNextEventInfo(time, topic))
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            times.push_back(static_cast<uint64_t>(time));
+            eventSource.fireEvent();
+        }
+        return times;
+    };
+
+    const auto times = fireAll();
+    ASSERT_EQ(static_cast<size_t>(n), times.size());
+
+    // back to the middle of the finished recording
+    const int target = n / 2;
+    EXPECT_TRUE(eventSource.seek(TimestampType(times[target])));
+    EXPECT_FALSE(eventSource.isFinished());
+    const auto seekedTimes = fireAll();
+    ASSERT_EQ(static_cast<size_t>(n - target), seekedTimes.size());
+    EXPECT_EQ(times[target], seekedTimes.front());
+    EXPECT_EQ(n - 1, valueStore.getValue<TestValue>("/value")->val);
+    std::remove(testfile.c_str());
+}
+
+TEST(RecordingEventSourceTest, MergeRecordings)
+{
+    const std::vector<std::string> testfiles = {"recording_event_source_merge0.bin",
+                                                "recording_event_source_merge1.bin"};
+    const int n = 20;
+    for (size_t file = 0; file < testfiles.size(); ++file)
+    {
+        ValueStore valueStore;
+        valueStore.registerType<TestValue>("TestValue");
+        ValueRecorder recorder(valueStore);
+        std::remove(testfiles[file].c_str());
+        recorder.start(testfiles[file]);
+        for (int i = 0; i < n; ++i)
+        {
+            valueStore.setValue("/value", TestValue(static_cast<int>(file) * 100 + i));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        recorder.stop();
+    }
+
+    ValueStore valueStore;
+    valueStore.registerType<TestValue>("TestValue");
+    auto collector = std::make_shared<Collector>();
+    valueStore.addReceiver("/value", collector);
+
+    // the clock of the second host is an hour ahead, so its values are replayed first
+    std::vector<RecordingEventSource::Recording> recordings = {
+        {testfiles[0], std::chrono::microseconds(0)},
+        {testfiles[1], std::chrono::hours(-1)}};
+    RecordingEventSource::Params params;
+    // smaller than the recordings, so that reading has to wait for fired events
+    params.bufferBytes = 64;
+    RecordingEventSource eventSource(valueStore, recordings, std::weak_ptr<IEventTimingController>(), params);
+
+    uint64_t lastTime = 0;
+    while (!eventSource.isFinished())
+    {
+        TimestampType time;
+        std::string topic;
+        if (!eventSource.getNextEventInfo(time, topic))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        EXPECT_LE(lastTime, static_cast<uint64_t>(time));
+        lastTime = static_cast<uint64_t>(time);
+        eventSource.fireEvent();
+    }
+
+    std::lock_guard<std::mutex> lock(collector->mutex);
+    ASSERT_EQ(static_cast<size_t>(2 * n), collector->values.size());
+    for (int i = 0; i < n; ++i)
+    {
+        EXPECT_EQ(100 + i, collector->values[i]);
+        EXPECT_EQ(i, collector->values[n + i]);
+    }
+    for (const auto& testfile : testfiles)
+    {
+        std::remove(testfile.c_str());
+    }
+}
+
+TEST(RecordingEventSourceTest, Prefetch)
+{
+    const std::string testfile = "recording_event_source_prefetch.bin";
+    const int n = 10;
+    {
+        ValueStore valueStore;
+        valueStore.registerType<TestValue>("TestValue");
+        valueStore.registerType<UploadedValue>("UploadedValue");
+        ValueRecorder recorder(valueStore);
+        std::remove(testfile.c_str());
+        recorder.start(testfile);
+        for (int i = 0; i < n; ++i)
+        {
+            UploadedValue image(i);
+            image.extMemInit(16);
+            valueStore.setValue("/image", std::move(image));
+            valueStore.setValue("/value", TestValue(i));
+        }
+        recorder.stop();
+    }
+
+    ValueStore valueStore;
+    valueStore.registerType<TestValue>("TestValue");
+    valueStore.registerType<UploadedValue>("UploadedValue");
+    RecordingEventSource::Params params;
+    // values without ext mem are not uploaded
+    params.prefetchTopics = {"/image", "/val*"};
+    params.prefetchDevice = 1;
+    RecordingEventSource eventSource(valueStore, testfile, std::weak_ptr<IEventTimingController>(), params);
+
+    int images = 0;
+    while (!eventSource.isFinished())
+    {
+        TimestampType time;
+        std::string topic;
+        if (!eventSource.getNextEventInfo(time, topic))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        eventSource.fireEvent();
+        if (topic == "/image")
+        {
+            EXPECT_EQ(1, valueStore.getValue<UploadedValue>("/image")->uploadedTo);
+            ++images;
+        }
+    }
+    EXPECT_EQ(n, images);
+    EXPECT_EQ(static_cast<size_t>(n), eventSource.getPrefetchedCount());
+    std::remove(testfile.c_str());
+}
+
+} // end namespace mcf
@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/SynchronizedReceiverPort.h"
+
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mcf {
+
+class SynchronizedReceiverPortTest : public ::testing::Test {
+public:
+    class Stamped : public mcf::Value {
+    public:
+        Stamped(uint64_t ts=0) : ts(ts) {};
+        uint64_t ts;
+        MSGPACK_DEFINE(ts);
+    };
+
+    using Samples = std::vector<std::pair<std::vector<uint64_t>, std::vector<uint64_t>>>;
+    using Tuples = std::vector<std::pair<uint64_t, uint64_t>>;
+
+    class FusionComponent : public Component {
+    public:
+        FusionComponent(SyncPolicy policy, std::chrono::microseconds tolerance, size_t ringSize) :
+            Component("FusionComponent"),
+            fKickPort(*this, "Kick"),
+            fOutA(*this, "OutA"),
+            fOutB(*this, "OutB"),
+            fSync(*this, "Sync", policy, tolerance, ringSize,
+                  [](const Stamped& v) { return v.ts; }, [](const Stamped& v) { return v.ts; })
+        {
+            // write a burst of samples from the component thread, so that they are all received
+            // before the synchronizer runs and the matching does not depend on thread timing
+            fKickPort.registerHandler([this] {
+                std::vector<uint64_t> a, b;
+                {
+                    std::lock_guard<std::mutex> lk(fMutex);
+                    a = fSamples.at(fKickPort.getValue()->ts).first;
+                    b = fSamples.at(fKickPort.getValue()->ts).second;
+                }
+                for (auto ts : a) {
+                    fOutA.setValue(Stamped(ts));
+                }
+                for (auto ts : b) {
+                    fOutB.setValue(Stamped(ts));
+                }
+            });
+            fSync.registerHandler([this](const SynchronizedReceiverPort<Stamped, Stamped>::Values& values) {
+                std::lock_guard<std::mutex> lk(fMutex);
+                fTuples.emplace_back(std::get<0>(values)->ts, std::get<1>(values)->ts);
+            });
+        }
+
+        void configure(IComponentConfig& config) {
+            config.registerPort(fKickPort, "/sync/kick");
+            config.registerPort(fOutA, "/sync/a");
+            config.registerPort(fOutB, "/sync/b");
+            config.registerPort(fSync.input<0>(), "/sync/a");
+            config.registerPort(fSync.input<1>(), "/sync/b");
+        }
+
+        Tuples tuples() {
+            std::lock_guard<std::mutex> lk(fMutex);
+            return fTuples;
+        }
+
+        std::mutex fMutex;
+        Samples fSamples;
+        ReceiverPort<Stamped> fKickPort;
+        SenderPort<Stamped> fOutA;
+        SenderPort<Stamped> fOutB;
+        SynchronizedReceiverPort<Stamped, Stamped> fSync;
+        Tuples fTuples;
+    };
+
+    /**
+     * Feed each burst of samples and return the matched tuples
+     */
+    Tuples run(FusionComponent& component, const Samples& bursts, size_t expected) {
+        {
+            std::lock_guard<std::mutex> lk(component.fMutex);
+            component.fSamples = bursts;
+        }
+        mcf::ValueStore valueStore;
+        mcf::ComponentManager manager(valueStore);
+        std::shared_ptr<FusionComponent> shared(&component, [](FusionComponent*) {});
+        manager.registerComponent(shared);
+        manager.configure();
+        manager.startup();
+        for (size_t i = 0; i < bursts.size(); ++i) {
+            valueStore.setValue("/sync/kick", Stamped(i));
+            // let the synchronizer run before the next burst
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        for (int i = 0; i < 1000 && component.tuples().size() < expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        manager.shutdown();
+        return component.tuples();
+    }
+};
+
+TEST_F(SynchronizedReceiverPortTest, Exact)
+{
+    FusionComponent component(SyncPolicy::EXACT, std::chrono::microseconds(5), 8);
+    auto tuples = run(component, {{{1, 2, 3, 5}, {2, 3, 4, 5}}}, 3);
+    EXPECT_EQ((Tuples{{2, 2}, {3, 3}, {5, 5}}), tuples);
+    EXPECT_EQ(3u, component.fSync.getMatched());
+    EXPECT_EQ(2u, component.fSync.getDropped());
+}
+
+TEST_F(SynchronizedReceiverPortTest, Approximate)
+{
+    FusionComponent component(SyncPolicy::APPROXIMATE, std::chrono::microseconds(2), 8);
+    auto tuples = run(component, {{{10, 20, 30}, {11, 19, 25, 31}}}, 3);
+    EXPECT_EQ((Tuples{{10, 11}, {20, 19}, {30, 31}}), tuples);
+    EXPECT_EQ(1u, component.fSync.getDropped());
+}
+
+TEST_F(SynchronizedReceiverPortTest, Nearest)
+{
+    FusionComponent component(SyncPolicy::NEAREST, std::chrono::microseconds(3), 8);
+    auto tuples = run(component, {{{10, 20, 30, 40}, {9, 12, 21, 35, 41}}}, 3);
+    // 30 has no neighbor within the tolerance
+    EXPECT_EQ((Tuples{{10, 9}, {20, 21}, {40, 41}}), tuples);
+    EXPECT_EQ(1u, component.fSync.getDropped());
+}
+
+TEST_F(SynchronizedReceiverPortTest, BoundedRing)
+{
+    FusionComponent component(SyncPolicy::EXACT, std::chrono::microseconds(0), 2);
+    // the first input runs ahead, its oldest value is evicted from the full ring
+    auto tuples = run(component, {{{1, 2}, {}}, {{3}, {3}}}, 1);
+    EXPECT_EQ((Tuples{{3, 3}}), tuples);
+    EXPECT_EQ(2u, component.fSync.getDropped());
+}
+
+} // namespace mcf
@@ -3,8 +3,10 @@
  */
 #include "gtest/gtest.h"
 #include "mcf_core/Mcf.h"
+#include "mcf_core/util/ConfigCache.h"
 #include "test/TestUtils.h"
 #include "test/TestValue.h"
+#include "json/json.h"
 
 namespace mcf
 {
@@ -119,15 +121,15 @@ public:
         mcf::SenderPort<TestValue> fCounterPort;
         mcf::ReceiverPort<TestValue> fTriggerPort;
     };
+
+    mcf::ValueStore valueStore;
+    mcf::ComponentManager manager{valueStore};
+    mcf::ComponentInstantiator instantiator{manager};
+    mcf::ComponentSystemConfigurator configurator{manager, instantiator};
 };
 
 TEST_F(SystemConfigurationTest, Initialize)
 {
-    mcf::ValueStore valueStore;
-    mcf::ComponentManager manager(valueStore);
-    mcf::ComponentInstantiator instantiator(manager);
-    mcf::ComponentSystemConfigurator configurator(manager, instantiator);
-
     instantiator.addComponentType(ComponentType::create<Producer>("esr/Producer"));
     instantiator.addComponentType(ComponentType::create<Consumer>("esr/Consumer"));
     instantiator.addComponentType(ComponentType::create<TestComponent>("esr/TestComponent"));
@@ -155,11 +157,6 @@ TEST_F(SystemConfigurationTest, Initialize)
 
 TEST_F(SystemConfigurationTest, DynamicRemapping)
 {
-    mcf::ValueStore valueStore;
-    mcf::ComponentManager manager(valueStore);
-    mcf::ComponentInstantiator instantiator(manager);
-    mcf::ComponentSystemConfigurator configurator(manager, instantiator);
-
     instantiator.addComponentType(ComponentType::create<Producer>("esr/Producer"));
     instantiator.addComponentType(ComponentType::create<Consumer>("esr/Consumer"));
     instantiator.addComponentType(ComponentType::create<TestComponent>("esr/TestComponent"));
@@ -202,11 +199,6 @@ TEST_F(SystemConfigurationTest, DynamicRemapping)
 
 TEST_F(SystemConfigurationTest, Errors)
 {
-    mcf::ValueStore valueStore;
-    mcf::ComponentManager manager(valueStore);
-    mcf::ComponentInstantiator instantiator(manager);
-    mcf::ComponentSystemConfigurator configurator(manager, instantiator);
-
     instantiator.addComponentType(ComponentType::create<Producer>("esr/Producer"));
     instantiator.addComponentType(ComponentType::create<Consumer>("esr/Consumer"));
     instantiator.addComponentType(ComponentType::create<StringConsumer>("esr/StringConsumer"));
@@ -307,11 +299,6 @@ TEST_F(SystemConfigurationTest, Errors)
 
 TEST_F(SystemConfigurationTest, InitializeFromJSON)
 {
-    mcf::ValueStore valueStore;
-    mcf::ComponentManager manager(valueStore);
-    mcf::ComponentInstantiator instantiator(manager);
-    mcf::ComponentSystemConfigurator configurator(manager, instantiator);
-
     instantiator.addComponentType(ComponentType::create<Producer>("esr/Producer"));
     instantiator.addComponentType(ComponentType::create<Consumer>("esr/Consumer"));
     instantiator.addComponentType(ComponentType::create<TestComponent>("esr/TestComponent"));
@@ -345,11 +332,6 @@ TEST_F(SystemConfigurationTest, InitializeFromJSON)
 
 TEST_F(SystemConfigurationTest, Scheduling)
 {
-    mcf::ValueStore valueStore;
-    mcf::ComponentManager manager(valueStore);
-    mcf::ComponentInstantiator instantiator(manager);
-    mcf::ComponentSystemConfigurator configurator(manager, instantiator);
-
     instantiator.addComponentType(
         ComponentType::create<SchedulableComponent>("esr/SchedulableComponent"));
 
@@ -369,13 +351,246 @@ TEST_F(SystemConfigurationTest, Scheduling)
     EXPECT_EQ(valueStore.getValue<TestValue>("/counter")->val, 1);
 }
 
-TEST_F(SystemConfigurationTest, NullTopics)
+TEST_F(SystemConfigurationTest, CpuAffinity)
 {
-    mcf::ValueStore valueStore;
-    mcf::ComponentManager manager(valueStore);
-    mcf::ComponentInstantiator instantiator(manager);
-    mcf::ComponentSystemConfigurator configurator(manager, instantiator);
+    auto readAffinity = [this](const std::string& affinity) {
+        std::istringstream stream(
+            "{\"ComponentSystemConfiguration\": { \"Components\": {\"test\": {\"type\": "
+            "\"esr/TestComponent\", \"schedulingParameters\": { \"policy\": \"default\", "
+            "\"cpuAffinity\": " + affinity + " } } } } }");
+        return configurator.readSystemConfiguration(stream).at(0).schedulingParameters.cpuAffinity;
+    };
+    EXPECT_EQ(0x2Fu, readAffinity("\"0-3,5\""));
+    EXPECT_EQ(0x0Au, readAffinity("[1, 3]"));
+    EXPECT_EQ(0x8000000000000000u, readAffinity("\"63\""));
+    EXPECT_THROW(readAffinity("\"3-1\""), SystemConfigurationError);
+    EXPECT_THROW(readAffinity("\"64\""), SystemConfigurationError);
+    EXPECT_THROW(readAffinity("\"1,,2\""), SystemConfigurationError);
+    EXPECT_THROW(readAffinity("true"), SystemConfigurationError);
+
+    EXPECT_EQ("0-3,5", formatCpuMask(0x2F));
+    EXPECT_EQ("1,3,63", formatCpuMask(0x800000000000000Au));
+    EXPECT_EQ("", formatCpuMask(0));
+}
+
+TEST_F(SystemConfigurationTest, DeadlineScheduling)
+{
+    auto readParameters = [this](const std::string& parameters) {
+        std::istringstream stream(
+            "{\"ComponentSystemConfiguration\": { \"Components\": {\"test\": {\"type\": "
+            "\"esr/TestComponent\", \"schedulingParameters\": " + parameters + " } } } }");
+        return configurator.readSystemConfiguration(stream).at(0).schedulingParameters;
+    };
+    auto parameters = readParameters(
+        "{ \"policy\": \"deadline\", \"runtimeUs\": 500, \"deadlineUs\": 2000, \"periodUs\": 10000 }");
+    EXPECT_EQ(IComponent::SchedulingPolicy::Deadline, parameters.policy);
+    EXPECT_EQ(std::chrono::microseconds(500), parameters.runtime);
+    EXPECT_EQ(std::chrono::milliseconds(2), parameters.deadline);
+    EXPECT_EQ(std::chrono::milliseconds(10), parameters.period);
+
+    parameters = readParameters("{ \"policy\": \"fifo\", \"priority\": 10 }");
+    EXPECT_EQ(0, parameters.deadline.count());
+    EXPECT_EQ(0, parameters.spin.count());
+    parameters = readParameters("{ \"policy\": \"fifo\", \"priority\": 10, \"spinUs\": 50 }");
+    EXPECT_EQ(std::chrono::microseconds(50), parameters.spin);
+    EXPECT_THROW(readParameters("{ \"policy\": \"default\", \"deadlineUs\": -1 }"),
+                 SystemConfigurationError);
+    EXPECT_THROW(readParameters("{ \"policy\": \"default\", \"deadlineUs\": \"1\" }"),
+                 SystemConfigurationError);
+
+    EXPECT_EQ(-1, parameters.numaNode);
+    parameters = readParameters("{ \"policy\": \"default\", \"numaNode\": 1 }");
+    EXPECT_EQ(1, parameters.numaNode);
+    EXPECT_THROW(readParameters("{ \"policy\": \"default\", \"numaNode\": -1 }"),
+                 SystemConfigurationError);
+
+    EXPECT_EQ(0u, parameters.parallelThreads);
+    parameters = readParameters("{ \"policy\": \"default\", \"parallelThreads\": 3 }");
+    EXPECT_EQ(3u, parameters.parallelThreads);
+    EXPECT_THROW(readParameters("{ \"policy\": \"default\", \"parallelThreads\": 0 }"),
+                 SystemConfigurationError);
+}
+
+TEST_F(SystemConfigurationTest, RealtimeMemory)
+{
+    instantiator.addComponentType(ComponentType::create<TestComponent>("esr/TestComponent"));
+
+    auto readOptions = [this](const std::string& memory) {
+        Json::Value node;
+        std::istringstream stream("{" + memory + "}");
+        stream >> node;
+        return configurator.readRealtimeMemoryConfiguration(node);
+    };
+    auto options = readOptions("");
+    EXPECT_FALSE(options.lockMemory);
+    EXPECT_EQ(0u, options.stackPrefaultBytes);
+    EXPECT_EQ(0u, options.heapPrefaultBytes);
+    EXPECT_EQ(0u, options.deferredFreeBytes);
+    options = readOptions(
+        "\"RealtimeMemory\": { \"lockMemory\": true, \"stackPrefaultKiB\": 256, \"heapPrefaultKiB\": 1024, "
+        "\"deferredFreeKiB\": 512 }");
+    EXPECT_TRUE(options.lockMemory);
+    EXPECT_EQ(256u * 1024, options.stackPrefaultBytes);
+    EXPECT_EQ(1024u * 1024, options.heapPrefaultBytes);
+    EXPECT_EQ(512u * 1024, options.deferredFreeBytes);
+    EXPECT_THROW(readOptions("\"RealtimeMemory\": { \"stackPrefaultKiB\": -1 }"), SystemConfigurationError);
+    EXPECT_THROW(readOptions("\"RealtimeMemory\": { \"lockMemory\": 1 }"), SystemConfigurationError);
+    EXPECT_THROW(readOptions("\"RealtimeMemory\": true"), SystemConfigurationError);
+
+    // pre-faulting only, locking would affect the whole test process
+    configurator.configureFromJSON(
+        "{\"ComponentSystemConfiguration\": { "
+        "\"RealtimeMemory\": { \"stackPrefaultKiB\": 256, \"heapPrefaultKiB\": 1024 }, "
+        "\"Components\": {\"test\": {\"type\": \"esr/TestComponent\", "
+        "\"portMapping\": { \"tick\": \"/tick\", \"tack\": \"/tack\" } } } } }");
+    manager.startup();
+    valueStore.setValue("/tick", TestValue(17));
+    waitForValue(valueStore, "/tack");
+    EXPECT_TRUE(valueStore.hasValue("/tack"));
+    manager.shutdown();
+}
+
+TEST_F(SystemConfigurationTest, ParallelFor)
+{
+    auto readConfig = [this](const std::string& parallelFor) {
+        Json::Value node;
+        std::istringstream stream("{" + parallelFor + "}");
+        stream >> node;
+        return configurator.readParallelForConfiguration(node);
+    };
+    auto config = readConfig("");
+    EXPECT_EQ(0u, config.numThreads);
+    EXPECT_EQ(0u, config.cpuAffinity);
+    config = readConfig("\"ParallelFor\": { \"numThreads\": 3, \"cpuAffinity\": \"0-1\" }");
+    EXPECT_EQ(3u, config.numThreads);
+    EXPECT_EQ(0x3u, config.cpuAffinity);
+    EXPECT_THROW(readConfig("\"ParallelFor\": { \"numThreads\": -1 }"), SystemConfigurationError);
+    EXPECT_THROW(readConfig("\"ParallelFor\": 4"), SystemConfigurationError);
+
+    configurator.configureFromJSON(
+        "{\"ComponentSystemConfiguration\": { \"ParallelFor\": { \"numThreads\": 3 }, \"Components\": {} } }");
+    EXPECT_EQ(3u, parallelForThreads());
+    configureParallelFor(ParallelForConfig());
+}
 
+TEST_F(SystemConfigurationTest, Lineage)
+{
+    auto readConfig = [this](const std::string& lineage) {
+        Json::Value node;
+        std::istringstream stream("{" + lineage + "}");
+        stream >> node;
+        return configurator.readLineageConfiguration(node);
+    };
+    auto config = readConfig("");
+    EXPECT_EQ(std::vector<std::string>{"*"}, config.sources);
+    EXPECT_TRUE(config.sinks.empty());
+    config = readConfig(
+        "\"Lineage\": { \"sources\": [\"/vehicle/*\"], \"sinks\": [\"/control/a\", \"/control/b\"], "
+        "\"tableSize\": 1024, \"publishIntervalMs\": 500 }");
+    EXPECT_EQ(std::vector<std::string>{"/vehicle/*"}, config.sources);
+    EXPECT_EQ((std::vector<std::string>{"/control/a", "/control/b"}), config.sinks);
+    EXPECT_EQ(1024u, config.tableSize);
+    EXPECT_EQ(std::chrono::milliseconds(500), config.publishInterval);
+    EXPECT_THROW(readConfig("\"Lineage\": { \"sinks\": \"/control/a\" }"), SystemConfigurationError);
+    EXPECT_THROW(readConfig("\"Lineage\": { \"tableSize\": 0 }"), SystemConfigurationError);
+    EXPECT_THROW(readConfig("\"Lineage\": []"), SystemConfigurationError);
+
+    configurator.configureFromJSON(
+        "{\"ComponentSystemConfiguration\": { \"Lineage\": { \"sinks\": [\"/control\"] }, \"Components\": {} } }");
+    EXPECT_TRUE(mcf::LineageTracker::active());
+    mcf::LineageTracker::instance().disable();
+}
+
+TEST_F(SystemConfigurationTest, ConfigCache)
+{
+    auto readConfig = [this](const std::string& cache) {
+        Json::Value node;
+        std::istringstream stream("{" + cache + "}");
+        stream >> node;
+        return configurator.readConfigCacheConfiguration(node);
+    };
+    EXPECT_EQ("", readConfig(""));
+    EXPECT_EQ("configs.cache", readConfig("\"ConfigCache\": \"configs.cache\""));
+    EXPECT_THROW(readConfig("\"ConfigCache\": true"), SystemConfigurationError);
+
+    configurator.configureFromJSON(
+        "{\"ComponentSystemConfiguration\": { \"ConfigCache\": \"configs.cache\", \"Components\": {} } }");
+    EXPECT_EQ("configs.cache", mcf::util::json::ConfigCache::instance().cacheFile());
+    mcf::util::json::ConfigCache::instance().open("");
+}
+
+TEST_F(SystemConfigurationTest, ValueSnapshot)
+{
+    auto readConfig = [this](const std::string& snapshot) {
+        Json::Value node;
+        std::istringstream stream("{" + snapshot + "}");
+        stream >> node;
+        return configurator.readValueSnapshotConfiguration(node);
+    };
+    EXPECT_EQ("", readConfig("").file);
+    auto config = readConfig(
+        "\"ValueSnapshot\": { \"file\": \"values.snapshot\", \"topics\": [\"/map/*\", \"/calibration\"], "
+        "\"intervalMs\": 10000, \"maxAgeMs\": 60000 }");
+    EXPECT_EQ("values.snapshot", config.file);
+    EXPECT_EQ((std::vector<std::string>{"/map/*", "/calibration"}), config.topics);
+    EXPECT_EQ(std::chrono::milliseconds(10000), config.interval);
+    EXPECT_EQ(std::chrono::milliseconds(60000), config.maxAge);
+    config = readConfig("\"ValueSnapshot\": { \"file\": \"values.snapshot\", \"topics\": [\"/map/*\"] }");
+    EXPECT_EQ(std::chrono::milliseconds(0), config.interval);
+    EXPECT_THROW(readConfig("\"ValueSnapshot\": { \"topics\": [\"/map/*\"] }"), SystemConfigurationError);
+    EXPECT_THROW(readConfig("\"ValueSnapshot\": { \"file\": \"values.snapshot\", \"topics\": [] }"),
+                 SystemConfigurationError);
+    EXPECT_THROW(readConfig("\"ValueSnapshot\": { \"file\": \"values.snapshot\", \"topics\": [\"/map/*\"], "
+                            "\"intervalMs\": -1 }"), SystemConfigurationError);
+    EXPECT_THROW(readConfig("\"ValueSnapshot\": \"values.snapshot\""), SystemConfigurationError);
+}
+
+TEST_F(SystemConfigurationTest, Qos)
+{
+    auto readConfig = [this](const std::string& qos) {
+        Json::Value node;
+        std::istringstream stream("{" + qos + "}");
+        stream >> node;
+        return configurator.readQosConfiguration(node);
+    };
+    EXPECT_TRUE(readConfig("").assignments.empty());
+    auto config = readConfig(
+        "\"Qos\": { \"profiles\": { \"sensor\": { \"depth\": 3, \"deadlineMs\": 10, \"lifespanMs\": 100, "
+        "\"priority\": 2 }, \"command\": { \"depth\": 0, \"reliability\": \"reliable\" } }, "
+        "\"topics\": [ { \"pattern\": \"/vehicle/*\", \"profile\": \"sensor\" }, "
+        "{ \"pattern\": \"/control/*\", \"profile\": \"command\" } ] }");
+    ASSERT_EQ(2u, config.profiles.size());
+    const mcf::QosProfile& sensor = config.profiles.at("sensor");
+    EXPECT_EQ(3u, sensor.depth);
+    EXPECT_EQ(mcf::QosProfile::Reliability::BEST_EFFORT, sensor.reliability);
+    EXPECT_EQ(std::chrono::milliseconds(10), sensor.deadline);
+    EXPECT_EQ(std::chrono::milliseconds(100), sensor.lifespan);
+    EXPECT_EQ(2, sensor.priority);
+    EXPECT_EQ(0u, config.profiles.at("command").depth);
+    EXPECT_EQ(mcf::QosProfile::Reliability::RELIABLE, config.profiles.at("command").reliability);
+    ASSERT_EQ(2u, config.assignments.size());
+    EXPECT_EQ("/vehicle/*", config.assignments[0].pattern);
+    EXPECT_EQ("command", config.assignments[1].profile);
+
+    EXPECT_THROW(readConfig("\"Qos\": { \"profiles\": { \"a\": { \"reliability\": \"sometimes\" } } }"),
+                 SystemConfigurationError);
+    EXPECT_THROW(readConfig("\"Qos\": { \"profiles\": { \"a\": { \"depth\": -1 } } }"), SystemConfigurationError);
+    EXPECT_THROW(readConfig("\"Qos\": { \"profiles\": { \"a\": { \"priority\": 256 } } }"),
+                 SystemConfigurationError);
+    EXPECT_THROW(readConfig("\"Qos\": { \"topics\": [ { \"pattern\": \"/a\", \"profile\": \"unknown\" } ] }"),
+                 SystemConfigurationError);
+    EXPECT_THROW(readConfig("\"Qos\": [ ]"), SystemConfigurationError);
+
+    configurator.configureFromJSON(
+        "{\"ComponentSystemConfiguration\": { \"Qos\": { \"profiles\": { \"sensor\": { \"depth\": 3 } }, "
+        "\"topics\": [ { \"pattern\": \"/vehicle/*\", \"profile\": \"sensor\" } ] }, \"Components\": {} } }");
+    ASSERT_NE(nullptr, valueStore.getTopicQos().find("/vehicle/speed"));
+    EXPECT_EQ(3u, valueStore.getTopicQos().find("/vehicle/speed")->depth);
+    EXPECT_EQ(nullptr, valueStore.getTopicQos().find("/control/steering"));
+}
+
+TEST_F(SystemConfigurationTest, NullTopics)
+{
     instantiator.addComponentType(ComponentType::create<Producer>("esr/Producer"));
     instantiator.addComponentType(ComponentType::create<Consumer>("esr/Consumer"));
     instantiator.addComponentType(ComponentType::create<TestComponent>("esr/TestComponent"));
@@ -410,11 +625,6 @@ TEST_F(SystemConfigurationTest, NullTopics)
 
 TEST_F(SystemConfigurationTest, DisabledPorts)
 {
-    mcf::ValueStore valueStore;
-    mcf::ComponentManager manager(valueStore);
-    mcf::ComponentInstantiator instantiator(manager);
-    mcf::ComponentSystemConfigurator configurator(manager, instantiator);
-
     instantiator.addComponentType(ComponentType::create<Producer>("esr/Producer"));
     instantiator.addComponentType(ComponentType::create<Consumer>("esr/Consumer"));
     instantiator.addComponentType(ComponentType::create<TestComponent>("esr/TestComponent"));
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/TimerWheel.h"
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mcf {
+
+TEST(TimerWheelTest, FiresInDeadlineOrder) {
+    TimerWheel wheel(std::chrono::milliseconds(1));
+    std::mutex mutex;
+    std::vector<int> fired;
+    std::promise<void> done;
+    const auto start = TimerWheel::Clock::now();
+    // the last one is moved down from the higher levels
+    for (int delay : {30, 10, 20, 150}) {
+        wheel.schedule(start + std::chrono::milliseconds(delay), [&, delay, start] {
+            EXPECT_GE(TimerWheel::Clock::now() - start, std::chrono::milliseconds(delay));
+            std::lock_guard<std::mutex> lk(mutex);
+            fired.push_back(delay);
+            if (fired.size() == 4) {
+                done.set_value();
+            }
+        });
+    }
+    ASSERT_EQ(std::future_status::ready, done.get_future().wait_for(std::chrono::seconds(5)));
+    std::lock_guard<std::mutex> lk(mutex);
+    EXPECT_EQ((std::vector<int>{10, 20, 30, 150}), fired);
+    EXPECT_EQ(4u, wheel.statistics().fired);
+    EXPECT_EQ(0u, wheel.statistics().pending);
+}
+
+TEST(TimerWheelTest, CoalescedWakeups) {
+    TimerWheel wheel(std::chrono::milliseconds(20));
+    std::atomic<int> fired{0};
+    const auto deadline = TimerWheel::Clock::now() + std::chrono::milliseconds(50);
+    // deadlines within one tick share a wakeup
+    for (int i = 0; i < 50; ++i) {
+        wheel.schedule(deadline + std::chrono::microseconds(100 * i), [&fired] { ++fired; });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_EQ(50, fired);
+    EXPECT_GE(2u, wheel.statistics().wakeups);
+}
+
+TEST(TimerWheelTest, CancelAndReschedule) {
+    TimerWheel wheel(std::chrono::milliseconds(1));
+    std::atomic<int> fired{0};
+    const TimerWheel::TimerId cancelled = wheel.scheduleAfter(std::chrono::milliseconds(20), [&fired] { fired += 100; });
+    EXPECT_TRUE(wheel.cancel(cancelled));
+    EXPECT_FALSE(wheel.cancel(cancelled));
+    EXPECT_FALSE(wheel.cancel(TimerWheel::INVALID_TIMER));
+
+    // a periodic timer reschedules itself from its callback
+    std::mutex mutex;
+    std::atomic<bool> stop{false};
+    TimerWheel::TimerId periodic = TimerWheel::INVALID_TIMER;
+    std::function<void()> tick = [&] {
+        if (stop) {
+            return;
+        }
+        ++fired;
+        std::lock_guard<std::mutex> lk(mutex);
+        periodic = wheel.scheduleAfter(std::chrono::milliseconds(5), tick);
+    };
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        periodic = wheel.scheduleAfter(std::chrono::milliseconds(5), tick);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    stop = true;
+    while (true) {
+        TimerWheel::TimerId last;
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            last = periodic;
+        }
+        // waits for a running callback, which may have scheduled one more
+        wheel.cancel(last);
+        std::lock_guard<std::mutex> lk(mutex);
+        if (periodic == last) {
+            break;
+        }
+    }
+    const int count = fired;
+    EXPECT_GE(count, 3);
+    EXPECT_LT(count, 100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_EQ(count, fired);
+    EXPECT_EQ(0u, wheel.statistics().pending);
+}
+
+} // namespace mcf
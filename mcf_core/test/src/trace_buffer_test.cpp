@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/TraceClock.h"
+#include "mcf_core/TraceCollector.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mcf {
+
+namespace {
+
+TraceRecord makeRecord(uint32_t sink, uint64_t valueId)
+{
+    TraceRecord record{};
+    record.type = TraceEventType::PORT_WRITE;
+    record.sink = sink;
+    record.valueId = valueId;
+    return record;
+}
+
+class TestSink : public ITraceSink {
+public:
+    void consume(const TraceRecord* records, size_t count) override {
+        for (size_t i = 0; i < count; ++i) {
+            EXPECT_EQ(fId, records[i].sink);
+            valueIds.push_back(records[i].valueId);
+            times.push_back(records[i].time);
+        }
+    }
+
+    uint32_t fId = 0;
+    std::vector<uint64_t> valueIds;
+    std::vector<uint64_t> times;
+};
+
+uint64_t nowMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+} // anonymous namespace
+
+TEST(TraceBufferTest, PushPop) {
+    TraceBuffer buffer(5);
+    EXPECT_EQ(8u, buffer.capacity());
+
+    std::vector<TraceRecord> records;
+    for (uint64_t i = 0; i < 6; ++i) {
+        records.push_back(makeRecord(1, i));
+    }
+    EXPECT_TRUE(buffer.push(records.data(), records.size()));
+    // all records or none
+    EXPECT_FALSE(buffer.push(records.data(), 3));
+    EXPECT_EQ(3u, buffer.dropped());
+    EXPECT_EQ(6u, buffer.size());
+
+    TraceRecord out[4];
+    EXPECT_EQ(4u, buffer.pop(out, 4));
+    EXPECT_EQ(0u, out[0].valueId);
+    EXPECT_EQ(3u, out[3].valueId);
+
+    // wraps around the end of the ring
+    EXPECT_TRUE(buffer.push(records.data(), 6));
+    EXPECT_EQ(4u, buffer.pop(out, 4));
+    EXPECT_EQ(4u, out[0].valueId);
+    EXPECT_EQ(5u, out[1].valueId);
+    EXPECT_EQ(0u, out[2].valueId);
+    EXPECT_EQ(4u, buffer.pop(out, 4));
+    EXPECT_EQ(5u, out[3].valueId);
+    EXPECT_EQ(0u, buffer.pop(out, 4));
+}
+
+TEST(TraceBufferTest, StringTable) {
+    TraceStringTable& strings = TraceStringTable::instance();
+    EXPECT_EQ(0u, strings.intern(""));
+    const uint32_t id = strings.intern("/trace/buffer/test");
+    EXPECT_NE(0u, id);
+    EXPECT_EQ(id, strings.intern("/trace/buffer/test"));
+
+    uint32_t otherThreadId = 0;
+    std::thread([&otherThreadId] {
+        otherThreadId = TraceStringTable::instance().intern("/trace/buffer/test");
+    }).join();
+    EXPECT_EQ(id, otherThreadId);
+
+    EXPECT_EQ("/trace/buffer/test", strings.lookup(id));
+    EXPECT_EQ("", strings.lookup(strings.size()));
+}
+
+TEST(TraceBufferTest, Collector) {
+    TraceCollector& collector = TraceCollector::instance();
+    TestSink sink;
+    TestSink otherSink;
+    sink.fId = collector.addSink(sink);
+    otherSink.fId = collector.addSink(otherSink);
+
+    std::thread([&] {
+        for (uint64_t i = 0; i < 100; ++i) {
+            TraceRecord record = makeRecord(i % 2 == 0 ? sink.fId : otherSink.fId, i);
+            EXPECT_TRUE(collector.write(&record, 1));
+        }
+    }).join();
+
+    // the records of the exited thread are still delivered, in order
+    collector.flush();
+    ASSERT_EQ(50u, sink.valueIds.size());
+    ASSERT_EQ(50u, otherSink.valueIds.size());
+    for (uint64_t i = 0; i < 50; ++i) {
+        EXPECT_EQ(2 * i, sink.valueIds[i]);
+        EXPECT_EQ(2 * i + 1, otherSink.valueIds[i]);
+    }
+
+    // records of removed sinks are discarded
+    collector.removeSink(otherSink.fId);
+    TraceRecord record = makeRecord(otherSink.fId, 100);
+    EXPECT_TRUE(collector.write(&record, 1));
+    collector.flush();
+    EXPECT_EQ(50u, otherSink.valueIds.size());
+    collector.removeSink(sink.fId);
+}
+
+TEST(TraceBufferTest, Clock) {
+    EXPECT_EQ(syscall(SYS_gettid), TraceClock::threadId());
+
+    TraceRecord record{};
+    TraceClock::stamp(record);
+    EXPECT_EQ(0, record.tscTime);
+    EXPECT_NEAR(nowMicroseconds(), record.time, 100000);
+
+    if (!TraceClock::tscAvailable()) {
+        EXPECT_FALSE(TraceClock::setSource(TraceClock::Source::TSC));
+        EXPECT_EQ(TraceClock::Source::SYSTEM, TraceClock::source());
+        return;
+    }
+    ASSERT_TRUE(TraceClock::setSource(TraceClock::Source::TSC));
+    EXPECT_GT(TraceClock::calibration().ticksPerMicrosecond, 0.);
+
+    // the collector converts the ticks
+    TraceCollector& collector = TraceCollector::instance();
+    TestSink sink;
+    sink.fId = collector.addSink(sink);
+    record = TraceRecord{};
+    record.sink = sink.fId;
+    TraceClock::stamp(record);
+    EXPECT_EQ(1, record.tscTime);
+    EXPECT_TRUE(collector.write(&record, 1));
+    collector.flush();
+    ASSERT_EQ(1u, sink.times.size());
+    EXPECT_NEAR(nowMicroseconds(), sink.times[0], 100000);
+    collector.removeSink(sink.fId);
+
+    EXPECT_TRUE(TraceClock::setSource(TraceClock::Source::SYSTEM));
+}
+
+} // namespace mcf
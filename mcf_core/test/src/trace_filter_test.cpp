@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/TraceFilter.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace mcf {
+
+TEST(TraceFilterTest, NoRules) {
+    TraceSelection selection({}, "Camera");
+    const std::string topic = "/camera/image";
+    EXPECT_TRUE(selection.select(TraceEventType::PORT_WRITE, &topic));
+    EXPECT_TRUE(selection.select(TraceEventType::EXEC_TIME, nullptr));
+}
+
+TEST(TraceFilterTest, ComponentAndTopic) {
+    TraceFilterRule camera;
+    camera.component = "Camera*";
+    TraceFilterRule images;
+    images.topic = "/*/image";
+    images.eventTypes = traceEventTypeMask({"port_write", "port_read"});
+    const std::vector<TraceFilterRule> rules = {camera, images};
+
+    // all events of the camera components
+    TraceSelection cameraSelection(rules, "CameraFront");
+    const std::string status = "/camera/status";
+    EXPECT_TRUE(cameraSelection.select(TraceEventType::PORT_WRITE, &status));
+    EXPECT_TRUE(cameraSelection.select(TraceEventType::EXEC_TIME, nullptr));
+
+    // only image port events of other components
+    TraceSelection filterSelection(rules, "Filter");
+    const std::string image = "/camera/image";
+    EXPECT_TRUE(filterSelection.select(TraceEventType::PORT_READ, &image));
+    EXPECT_TRUE(filterSelection.select(TraceEventType::PORT_READ, &image));
+    EXPECT_FALSE(filterSelection.select(TraceEventType::PORT_PEEK, &image));
+    EXPECT_FALSE(filterSelection.select(TraceEventType::PORT_READ, &status));
+    EXPECT_FALSE(filterSelection.select(TraceEventType::PORT_WRITE, nullptr));
+    EXPECT_FALSE(filterSelection.select(TraceEventType::EXEC_TIME, nullptr));
+}
+
+TEST(TraceFilterTest, Sampling) {
+    TraceFilterRule rule;
+    rule.eventTypes = traceEventTypeMask({"trigger_exec"});
+    rule.sampling = 4;
+    TraceSelection selection({rule}, "Filter");
+    const std::string topic = "/camera/image";
+    int selected = 0;
+    for (int i = 0; i < 40; ++i) {
+        selected += selection.select(TraceEventType::TRIGGER_EXEC, &topic) ? 1 : 0;
+    }
+    EXPECT_EQ(10, selected);
+    EXPECT_FALSE(selection.select(TraceEventType::TRIGGER_ACTIVATION, &topic));
+
+    // matching ignores the sampling and does not count
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(selection.matches(TraceEventType::TRIGGER_EXEC, &topic));
+    }
+    EXPECT_FALSE(selection.matches(TraceEventType::TRIGGER_ACTIVATION, &topic));
+    EXPECT_TRUE(selection.select(TraceEventType::TRIGGER_EXEC, &topic));
+}
+
+TEST(TraceFilterTest, EventTypeNames) {
+    const uint32_t mask = traceEventTypeMask({"port_peek", "program_flow"});
+    EXPECT_EQ(traceEventTypeBit(TraceEventType::PORT_PEEK) | traceEventTypeBit(TraceEventType::PROGRAM_FLOW), mask);
+    EXPECT_EQ(std::vector<std::string>({"port_peek", "program_flow"}), traceEventTypeNames(mask));
+    EXPECT_EQ(9u, traceEventTypeNames(TraceFilterRule::ALL_EVENT_TYPES).size());
+    EXPECT_THROW(traceEventTypeMask({"port_wrote"}), std::runtime_error);
+}
+
+} // namespace mcf
@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/util/ConfigCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+void writeFile(const std::string& filename, const std::string& contents)
+{
+    std::ofstream stream(filename, std::ios::trunc);
+    stream << contents;
+}
+
+const std::string BASE_FILE = "config_cache_test_base.json";
+const std::string OVERLAY_FILE = "config_cache_test_overlay.json";
+const std::string CACHE_FILE = "config_cache_test.cache";
+
+} // anonymous namespace
+
+TEST(config_cache, merges_and_shares_files)
+{
+    writeFile(BASE_FILE, "{\"a\": 1, \"nested\": {\"x\": [1, 2.5, \"s\"], \"y\": true}}");
+    writeFile(OVERLAY_FILE, "{\"a\": -2, \"nested\": {\"y\": null}, \"big\": 18446744073709551615}");
+
+    mcf::util::json::ConfigCache cache;
+    const Json::Value merged = cache.mergeFiles({BASE_FILE, OVERLAY_FILE, "missing.json"}, true);
+    EXPECT_EQ(-2, merged["a"].asInt());
+    EXPECT_EQ(2.5, merged["nested"]["x"][1].asDouble());
+    EXPECT_TRUE(merged["nested"]["y"].isNull());
+    EXPECT_EQ(18446744073709551615ull, merged["big"].asUInt64());
+    EXPECT_EQ(2u, cache.filesParsed());
+
+    // another component sharing the base file
+    EXPECT_EQ(1, cache.mergeFiles({BASE_FILE}, true)["a"].asInt());
+    EXPECT_EQ(2u, cache.filesParsed());
+
+    EXPECT_THROW(cache.mergeFiles({BASE_FILE, "missing.json"}), Json::RuntimeError);
+
+    std::remove(BASE_FILE.c_str());
+    std::remove(OVERLAY_FILE.c_str());
+}
+
+TEST(config_cache, parallel_components)
+{
+    writeFile(BASE_FILE, "{\"a\": 1}");
+    mcf::util::json::ConfigCache cache;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&cache] { EXPECT_EQ(1, cache.loadFile(BASE_FILE)["a"].asInt()); });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(1u, cache.filesParsed());
+    std::remove(BASE_FILE.c_str());
+}
+
+TEST(config_cache, binary_cache_file)
+{
+    std::remove(CACHE_FILE.c_str());
+    writeFile(BASE_FILE, "{\"a\": 1, \"nested\": {\"x\": [1, 2.5, \"s\"], \"y\": true}}");
+    writeFile(OVERLAY_FILE, "{\"a\": -2, \"s\": \"text\"}");
+    Json::Value expected;
+    {
+        mcf::util::json::ConfigCache cache;
+        cache.open(CACHE_FILE);
+        expected = cache.mergeFiles({BASE_FILE, OVERLAY_FILE});
+        cache.save();
+    }
+
+    {
+        mcf::util::json::ConfigCache cache;
+        cache.open(CACHE_FILE);
+        EXPECT_EQ(expected, cache.mergeFiles({BASE_FILE, OVERLAY_FILE}));
+        EXPECT_EQ(0u, cache.filesParsed());
+        EXPECT_EQ(2u, cache.filesDecoded());
+    }
+
+    // a changed file is parsed again
+    writeFile(OVERLAY_FILE, "{\"a\": 3}");
+    {
+        mcf::util::json::ConfigCache cache;
+        cache.open(CACHE_FILE);
+        EXPECT_EQ(3, cache.mergeFiles({BASE_FILE, OVERLAY_FILE})["a"].asInt());
+        EXPECT_EQ(1u, cache.filesParsed());
+        EXPECT_EQ(1u, cache.filesDecoded());
+    }
+
+    // an invalid cache file is ignored
+    writeFile(CACHE_FILE, "garbage");
+    {
+        mcf::util::json::ConfigCache cache;
+        cache.open(CACHE_FILE);
+        EXPECT_EQ(3, cache.loadFile(OVERLAY_FILE)["a"].asInt());
+        EXPECT_EQ(1u, cache.filesParsed());
+        cache.save();
+    }
+
+    std::remove(BASE_FILE.c_str());
+    std::remove(OVERLAY_FILE.c_str());
+    std::remove(CACHE_FILE.c_str());
+}
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/ValueFactory.h"
+
+#include <thread>
+#include <vector>
+
+namespace mcf {
+
+namespace {
+
+struct PooledValue : public mcf::Value {
+    using McfUseValuePool = void;
+    PooledValue(int val=0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+struct SpecializedPooledValue : public mcf::Value {
+    SpecializedPooledValue(int val=0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+struct UnpooledValue : public mcf::Value {
+    UnpooledValue(int val=0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+struct ReservedValue : public mcf::Value {
+    using McfUseValuePool = void;
+    ReservedValue(int val=0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+struct UnpackedValue : public mcf::Value {
+    using McfUseValuePool = void;
+    UnpackedValue(int val=0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+} // anonymous namespace
+
+template<>
+struct UseValuePool<SpecializedPooledValue> : std::true_type {};
+
+TEST(ValuePoolTest, Selection) {
+    EXPECT_TRUE(UseValuePool<PooledValue>::value);
+    EXPECT_TRUE(UseValuePool<SpecializedPooledValue>::value);
+    EXPECT_FALSE(UseValuePool<UnpooledValue>::value);
+
+    ValueFactory factory;
+    auto unpooled = factory.createValue(UnpooledValue(1));
+    EXPECT_EQ(1, unpooled->val);
+    EXPECT_EQ(0u, ValueFactory::poolStatistics<UnpooledValue>().hits);
+    EXPECT_EQ(0u, ValueFactory::poolStatistics<UnpooledValue>().misses);
+
+    auto specialized = factory.createValue(SpecializedPooledValue(2));
+    EXPECT_EQ(2, specialized->val);
+    EXPECT_EQ(1u, ValueFactory::poolStatistics<SpecializedPooledValue>().misses);
+}
+
+TEST(ValuePoolTest, Recycling) {
+    ValueFactory factory;
+    const auto before = ValueFactory::poolStatistics<PooledValue>();
+
+    const void* address = nullptr;
+    {
+        PooledValue value(5);
+        auto vp = factory.createValue(value);
+        EXPECT_EQ(5, vp->val);
+        address = vp.get();
+    }
+    auto vp = factory.createValue(PooledValue(6));
+    EXPECT_EQ(6, vp->val);
+    // the block freed by the first value is reused for the second one
+    EXPECT_EQ(address, vp.get());
+
+    const auto after = ValueFactory::poolStatistics<PooledValue>();
+    EXPECT_EQ(before.hits + before.misses + 2, after.hits + after.misses);
+    EXPECT_LE(before.hits + 1, after.hits);
+}
+
+TEST(ValuePoolTest, CrossThreadRelease) {
+    ValueFactory factory;
+    constexpr int NUM_VALUES = 1000;
+
+    // values created on this thread and released on another one find their way back
+    for (int round = 0; round < 3; ++round) {
+        std::vector<std::shared_ptr<const PooledValue>> values;
+        for (int i = 0; i < NUM_VALUES; ++i) {
+            values.push_back(factory.createValue(PooledValue(i)));
+        }
+        for (int i = 0; i < NUM_VALUES; ++i) {
+            EXPECT_EQ(i, values[i]->val);
+        }
+        std::thread consumer([&values] { values.clear(); });
+        consumer.join();
+    }
+
+    const auto stats = ValueFactory::poolStatistics<PooledValue>();
+    EXPECT_GT(stats.hits, static_cast<uint64_t>(NUM_VALUES));
+    EXPECT_LT(stats.misses, static_cast<uint64_t>(2 * NUM_VALUES));
+}
+
+TEST(ValuePoolTest, Reserve) {
+    constexpr size_t NUM_VALUES = 100;
+    ValueFactory::reservePool<ReservedValue>(NUM_VALUES);
+    EXPECT_EQ(NUM_VALUES, ValueFactory::poolStatistics<ReservedValue>().misses);
+
+    // all values come from the reserved blocks
+    ValueFactory factory;
+    std::vector<std::shared_ptr<const ReservedValue>> values;
+    for (size_t i = 0; i < NUM_VALUES; ++i) {
+        values.push_back(factory.createValue(ReservedValue(static_cast<int>(i))));
+    }
+    EXPECT_EQ(NUM_VALUES, ValueFactory::poolStatistics<ReservedValue>().hits);
+    EXPECT_EQ(NUM_VALUES, ValueFactory::poolStatistics<ReservedValue>().misses);
+}
+
+TEST(ValuePoolTest, ValueStore) {
+    ValueStore valueStore;
+    const auto before = ValueFactory::poolStatistics<PooledValue>();
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(0, valueStore.setValue("/pooled", PooledValue(i)));
+    }
+    EXPECT_EQ(9, valueStore.getValue<PooledValue>("/pooled")->val);
+    const auto after = ValueFactory::poolStatistics<PooledValue>();
+    EXPECT_EQ(before.hits + before.misses + 10, after.hits + after.misses);
+}
+
+TEST(ValuePoolTest, Unpack) {
+    TypeRegistry registry;
+    registry.registerType<UnpackedValue>("UnpackedValue");
+    registry.registerType<UnpooledValue>("UnpooledValue");
+
+    msgpack::sbuffer buffer;
+    msgpack::pack(buffer, UnpackedValue(7));
+    msgpack::object_handle oh = msgpack::unpack(buffer.data(), buffer.size());
+    msgpack::object obj = oh.get();
+    bool isExtMem = true;
+
+    // received values of pooled types are decoded into recycled blocks of the pool
+    const void* address = nullptr;
+    {
+        std::shared_ptr<Value> value = TypeRegistry::unpackSharedValue(
+            *registry.findTypeInfo("UnpackedValue"), obj, nullptr, 0, isExtMem);
+        EXPECT_FALSE(isExtMem);
+        EXPECT_EQ(7, std::dynamic_pointer_cast<UnpackedValue>(value)->val);
+        address = value.get();
+    }
+    std::shared_ptr<Value> value = TypeRegistry::unpackSharedValue(
+        *registry.findTypeInfo("UnpackedValue"), obj, nullptr, 0, isExtMem);
+    EXPECT_EQ(address, value.get());
+    EXPECT_EQ(1u, ValueFactory::poolStatistics<UnpackedValue>().hits);
+    EXPECT_EQ(1u, ValueFactory::poolStatistics<UnpackedValue>().misses);
+
+    std::shared_ptr<Value> unpooled = TypeRegistry::unpackSharedValue(
+        *registry.findTypeInfo("UnpooledValue"), obj, nullptr, 0, isExtMem);
+    EXPECT_EQ(7, std::dynamic_pointer_cast<UnpooledValue>(unpooled)->val);
+    EXPECT_EQ(0u, ValueFactory::poolStatistics<UnpooledValue>().misses);
+}
+
+} // namespace mcf
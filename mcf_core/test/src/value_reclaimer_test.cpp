@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/ExtMemValue.h"
+#include "mcf_core/ValueReclaimer.h"
+
+#include <future>
+#include <memory>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+class Frame : public ExtMemValue<uint8_t> {
+public:
+    int val = 0;
+    MSGPACK_DEFINE(val);
+};
+
+/**
+ * Garbage reporting the thread destroying it, optionally waiting for a release first
+ */
+class TracedGarbage : public ValueReclaimer::Garbage {
+public:
+    explicit TracedGarbage(std::thread::id& destroyedBy, std::shared_future<void> release = std::shared_future<void>())
+    : fDestroyedBy(destroyedBy), fRelease(std::move(release)) {}
+
+    ~TracedGarbage() override {
+        if (fRelease.valid()) {
+            fRelease.wait();
+        }
+        fDestroyedBy = std::this_thread::get_id();
+    }
+
+private:
+    std::thread::id& fDestroyedBy;
+    std::shared_future<void> fRelease;
+};
+
+ValueReclaimer::Config reclaimerConfig(uint64_t minBytes, size_t capacity) {
+    ValueReclaimer::Config config;
+    config.minBytes = minBytes;
+    config.capacity = capacity;
+    return config;
+}
+
+} // anonymous namespace
+
+TEST(ValueReclaimerTest, LargeExtMemIsDeferred) {
+    ValueReclaimer& reclaimer = ValueReclaimer::instance();
+    reclaimer.enable(reclaimerConfig(1000, 16));
+    EXPECT_TRUE(ValueReclaimer::active());
+    const auto before = reclaimer.statistics();
+
+    {
+        auto large = std::make_shared<Frame>();
+        large->extMemInit(4096);
+        auto small = std::make_shared<Frame>();
+        small->extMemInit(100);
+        // values without ext mem are not handed over
+        auto empty = std::make_shared<Frame>();
+    }
+    reclaimer.flush();
+    const auto after = reclaimer.statistics();
+    EXPECT_EQ(1u, after.deferred - before.deferred);
+    EXPECT_EQ(4096u, after.deferredBytes - before.deferredBytes);
+    EXPECT_EQ(0u, after.queueDepth);
+    EXPECT_EQ(0u, after.queueBytes);
+
+    std::thread::id destroyedBy;
+    EXPECT_TRUE(reclaimer.reclaim(std::make_unique<TracedGarbage>(destroyedBy), 2000));
+    reclaimer.flush();
+    EXPECT_NE(std::thread::id(), destroyedBy);
+    EXPECT_NE(std::this_thread::get_id(), destroyedBy);
+
+    reclaimer.disable();
+    EXPECT_FALSE(ValueReclaimer::active());
+    EXPECT_FALSE(reclaimer.reclaim(std::make_unique<TracedGarbage>(destroyedBy), 2000));
+    EXPECT_EQ(std::this_thread::get_id(), destroyedBy);
+}
+
+TEST(ValueReclaimerTest, FullQueueFreesRightAway) {
+    ValueReclaimer& reclaimer = ValueReclaimer::instance();
+    reclaimer.enable(reclaimerConfig(0, 1));
+    const auto before = reclaimer.statistics();
+
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::thread::id first, second, third;
+    // the first blocks the reclaimer thread, the second fills the queue
+    EXPECT_TRUE(reclaimer.reclaim(std::make_unique<TracedGarbage>(first, released), 1));
+    for (int i = 0; i < 1000 && reclaimer.statistics().queueDepth > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(reclaimer.reclaim(std::make_unique<TracedGarbage>(second), 1));
+    EXPECT_FALSE(reclaimer.reclaim(std::make_unique<TracedGarbage>(third), 1));
+    EXPECT_EQ(std::this_thread::get_id(), third);
+    EXPECT_EQ(1u, reclaimer.statistics().queueDepth);
+
+    release.set_value();
+    reclaimer.flush();
+    EXPECT_NE(std::this_thread::get_id(), first);
+    EXPECT_NE(std::this_thread::get_id(), second);
+    const auto after = reclaimer.statistics();
+    EXPECT_EQ(1u, after.overflows - before.overflows);
+    EXPECT_EQ(2u, after.deferred - before.deferred);
+    EXPECT_LE(1u, after.maxQueueDepth);
+    reclaimer.disable();
+}
+
+} // namespace mcf
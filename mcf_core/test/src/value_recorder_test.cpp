@@ -5,12 +5,21 @@
 #include "mcf_core/Mcf.h"
 #include "mcf_core/ValueRecorder.h"
 #include "mcf_core/ExtMemValue.h"
+#include "mcf_core/ISerializedValue.h"
+#include "test/TestUtils.h"
 #if HAVE_ZLIB
 #include "zlib.h"
+
+#include <sys/stat.h>
 #endif
 
+#include <algorithm>
 #include <fstream>
 #include <cstdio>
+#include <mutex>
+#include <map>
+#include <condition_variable>
+#include <thread>
 
 namespace mcf
 {
@@ -34,6 +43,28 @@ public:
         MSGPACK_DEFINE(val);
     };
 
+    /**
+     * A TestValue kept in its serialized form, like a value received on a remote relay rule
+     */
+    class SerializedTestValue : public mcf::Value, public mcf::ISerializedValue
+    {
+    public:
+        SerializedTestValue(int val, std::string typeId, uint64_t numericTypeId)
+        {
+            msgpack::pack(fBuffer, TestValue(val));
+            fSerialized.typeId = std::move(typeId);
+            fSerialized.numericTypeId = numericTypeId;
+            fSerialized.data = fBuffer.data();
+            fSerialized.size = fBuffer.size();
+        }
+
+        const Serialized* serializedForm() const override { return &fSerialized; }
+
+    private:
+        msgpack::sbuffer fBuffer;
+        Serialized fSerialized;
+    };
+
     template<typename T>
     inline void registerValueTypes(T& r)
     {
@@ -311,4 +342,821 @@ TEST_F(ValueRecorderTest, DataRace)
     std::remove(testfile.c_str());
 }
 
+TEST_F(ValueRecorderTest, ConcurrentProducers)
+{
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    mcf::ValueRecorder valueRecorder(valueStore);
+
+    const std::string testfile = "record_producers.bin";
+    std::remove(testfile.c_str());
+    valueRecorder.start(testfile);
+    const int producers = 4;
+    const int n = 5000;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&valueStore, p, n] {
+            const std::string topic = "/producer" + std::to_string(p);
+            for (int i = 0; i < n; ++i)
+            {
+                valueStore.setValue(topic, TestValue(i));
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    valueRecorder.stop();
+
+    // the values of each producer are recorded completely and in order
+    std::string str = readFile(testfile);
+    std::vector<int> next(producers, 0);
+    for (const auto& topic : readRecordedInts(str))
+    {
+        if (topic.first.compare(0, 9, "/producer") == 0)
+        {
+            const int producer = std::stoi(topic.first.substr(9));
+            for (int value : topic.second)
+            {
+                EXPECT_EQ(next[producer]++, value);
+            }
+        }
+    }
+    EXPECT_EQ(std::vector<int>(producers, n), next);
+
+    std::remove(testfile.c_str());
+}
+
+TEST_F(ValueRecorderTest, LargeBatches)
+{
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    mcf::ValueRecorder valueRecorder(valueStore);
+    valueRecorder.enableExtMemSerialization("/test1");
+
+    const std::string testfile = "record_batches.bin";
+    std::remove(testfile.c_str());
+    valueRecorder.start(testfile);
+
+    // more values and ext mem bytes than are written with a single system call
+    const int n = 2000;
+    const size_t extMemSize = 4096;
+    for (int i = 0; i < n; ++i)
+    {
+        auto val = TestValueExtMem(i);
+        val.extMemInit(extMemSize);
+        std::fill(val.extMemPtr(), val.extMemPtr() + extMemSize, static_cast<uint8_t>(i));
+        valueStore.setValue("/test1", std::move(val));
+    }
+    valueRecorder.stop();
+
+    std::string str = readFile(testfile);
+    size_t off = 0;
+    int i = 0;
+    while (off < str.size())
+    {
+        const RecordEntry record = readRecord(str, off);
+        // skip the recorder status, the index blocks and the footer with its trailer
+        if (record.topic() != "/test1")
+        {
+            continue;
+        }
+        EXPECT_EQ(i, record.intValue());
+        ASSERT_EQ(extMemSize, record.extMemSize());
+        ASSERT_LE(off, str.size());
+        EXPECT_EQ(static_cast<char>(i), str[record.extMemOffset]);
+        EXPECT_EQ(static_cast<char>(i), str[record.extMemOffset + extMemSize - 1]);
+        ++i;
+    }
+    // values queued when stopping are written as well
+    EXPECT_EQ(n, i);
+
+    std::remove(testfile.c_str());
+}
+
+TEST_F(ValueRecorderTest, WorkerThreads)
+{
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    mcf::ValueRecorder valueRecorder(valueStore);
+    valueRecorder.enableExtMemSerialization("/test1");
+#if HAVE_ZLIB
+    valueRecorder.enableExtMemCompression("/test1");
+#endif
+    valueRecorder.setWorkerThreads(4);
+
+    const std::string testfile = "record_workers.bin";
+    std::remove(testfile.c_str());
+    valueRecorder.start(testfile);
+
+    // more values than fit into the reorder window
+    const int n = 3000;
+    const size_t extMemSize = 2048;
+    for (int i = 0; i < n; ++i)
+    {
+        auto val = TestValueExtMem(i);
+        val.extMemInit(extMemSize);
+        std::fill(val.extMemPtr(), val.extMemPtr() + extMemSize, static_cast<uint8_t>(i));
+        valueStore.setValue("/test1", std::move(val));
+        valueStore.setValue("/test2", TestValue(i));
+    }
+    valueRecorder.stop();
+
+    std::string str = readFile(testfile);
+    size_t off = 0;
+    int test1 = 0;
+    int test2 = 0;
+    std::string order;
+    while (off < str.size())
+    {
+        const RecordEntry record = readRecord(str, off);
+        const auto topic = record.topic();
+        if (topic == "/test1")
+        {
+            EXPECT_EQ(test1, record.intValue());
+            ASSERT_EQ(extMemSize, record.extMemSize());
+            ASSERT_LE(off, str.size());
+            std::string extMem = str.substr(record.extMemOffset, off - record.extMemOffset);
+#if HAVE_ZLIB
+            EXPECT_NE(0u, record.extMemSizeCompressed());
+            extMem.assign(extMemSize, '\0');
+            uLongf len = extMemSize;
+            ASSERT_EQ(Z_OK, uncompress(reinterpret_cast<Bytef*>(&extMem[0]), &len,
+                reinterpret_cast<const Bytef*>(&str[record.extMemOffset]), record.extMemSizeCompressed()));
+#endif
+            EXPECT_EQ(std::string(extMemSize, static_cast<char>(test1)), extMem);
+            ++test1;
+            order += '1';
+        }
+        else if (topic == "/test2")
+        {
+            EXPECT_EQ(test2, record.intValue());
+            ++test2;
+            order += '2';
+        }
+    }
+    EXPECT_EQ(n, test1);
+    EXPECT_EQ(n, test2);
+    // the values are recorded in the order they were set
+    std::string expected;
+    for (int i = 0; i < n; ++i)
+    {
+        expected += "12";
+    }
+    EXPECT_EQ(expected, order);
+
+    std::remove(testfile.c_str());
+}
+
+TEST_F(ValueRecorderTest, DirectStorage)
+{
+    const std::string testfile = "record_direct.bin";
+    std::remove(testfile.c_str());
+    // small segments, so that writes span several segments and wait for free ones
+    mcf::DirectFileStorage storage(8192, 2);
+    int result = storage.open(testfile);
+    if (result != 0)
+    {
+        std::remove(testfile.c_str());
+        GTEST_SKIP() << "O_DIRECT or io_uring not available: " << strerror(result);
+    }
+
+    std::string expected;
+    for (int i = 0; i < 1000; ++i)
+    {
+        std::string a(i % 37, static_cast<char>('a' + i % 26));
+        std::string b(i % 101, static_cast<char>('A' + i % 26));
+        iovec iov[] = {{&a[0], a.size()}, {&b[0], b.size()}};
+        EXPECT_EQ(0, storage.write(iov, 2));
+        expected += a + b;
+        if (i == 500 || i == 501)
+        {
+            // the data of the current segment is written padded, twice in a row extending it
+            EXPECT_EQ(0, storage.sync());
+            std::string synced = readFile(testfile);
+            ASSERT_LE(expected.size(), synced.size());
+            EXPECT_EQ(expected, synced.substr(0, expected.size()));
+        }
+    }
+    EXPECT_EQ(0, storage.close());
+    EXPECT_EQ(expected.size(), storage.bytesWritten());
+    // the padding of the last segment is truncated
+    EXPECT_EQ(expected, readFile(testfile));
+
+    // the recorder writes the same stream with the direct storage or the fallback
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    mcf::ValueRecorder valueRecorder(valueStore);
+    valueRecorder.setStorage(std::make_unique<mcf::DirectFileStorage>());
+    valueRecorder.start(testfile);
+    valueStore.setValue("/test1", TestValue(5));
+    valueStore.setValue("/test1", TestValue(6));
+    valueRecorder.stop();
+
+    std::string str = readFile(testfile);
+    size_t off = 0;
+    for (int i = 5; i <= 6; ++i)
+    {
+        const RecordEntry record = readRecord(str, off);
+        EXPECT_EQ("/test1", record.topic());
+        EXPECT_EQ(i, record.intValue());
+    }
+    // followed only by the footer and its trailer
+    EXPECT_EQ(mcf::ValueRecorder::FOOTER_TOPIC, readRecord(str, off).topic());
+    EXPECT_EQ(str.size(), off);
+
+    std::remove(testfile.c_str());
+}
+
+#if HAVE_ZLIB
+TEST_F(ValueRecorderTest, Chunks)
+{
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    mcf::ValueRecorder valueRecorder(valueStore);
+    valueRecorder.enableExtMemSerialization("/test1");
+    valueRecorder.enableChunkCompression("/test1", mcf::ValueRecorder::CHUNK_LEVEL_DENSE);
+    valueRecorder.setChunkSize(16 * 1024);
+    EXPECT_THROW(valueRecorder.enableChunkCompression("/test2", 10), std::runtime_error);
+
+    const std::string testfile = "record_chunks.bin";
+    std::remove(testfile.c_str());
+    valueRecorder.start(testfile);
+    const int n = 500;
+    const size_t extMemSize = 1000;
+    for (int i = 0; i < n; ++i)
+    {
+        auto val = TestValueExtMem(i);
+        val.extMemInit(extMemSize);
+        std::fill(val.extMemPtr(), val.extMemPtr() + extMemSize, static_cast<uint8_t>(i));
+        valueStore.setValue("/test1", std::move(val));
+        valueStore.setValue("/test2", TestValue(i));
+    }
+    valueRecorder.stop();
+
+    std::string str = readFile(testfile);
+    // the repetitive ext mem data is compressed
+    EXPECT_LT(str.size(), n * extMemSize / 4);
+
+    int chunks = 0;
+    int test1 = 0;
+    int test2 = 0;
+    size_t off = 0;
+    while (off < str.size())
+    {
+        const RecordEntry record = readRecord(str, off);
+        const auto topic = record.topic();
+        if (topic == "/test2")
+        {
+            EXPECT_EQ(test2++, record.intValue());
+            continue;
+        }
+        if (topic != mcf::ValueRecorder::CHUNK_TOPIC)
+        {
+            continue;
+        }
+        ++chunks;
+        auto chunk = record.value.get().as<msg::RecordChunk>();
+        EXPECT_EQ("deflate", chunk.codec);
+        ASSERT_LE(off, str.size());
+        const uint32_t size = record.extMemSize();
+        std::string records(size, '\0');
+        uLongf len = size;
+        ASSERT_EQ(Z_OK, uncompress(reinterpret_cast<Bytef*>(&records[0]), &len,
+            reinterpret_cast<const Bytef*>(&str[record.extMemOffset]), record.extMemSizeCompressed()));
+        ASSERT_EQ(size, len);
+
+        size_t chunkOff = 0;
+        for (uint32_t r = 0; r < chunk.records; ++r)
+        {
+            const RecordEntry chunked = readRecord(records, chunkOff);
+            EXPECT_EQ("/test1", chunked.topic());
+            EXPECT_EQ(test1, chunked.intValue());
+            ASSERT_EQ(extMemSize, chunked.extMemSize());
+            // not compressed separately
+            EXPECT_EQ(0u, chunked.extMemSizeCompressed());
+            ASSERT_LE(chunkOff, records.size());
+            EXPECT_EQ(static_cast<char>(test1), records[chunked.extMemOffset]);
+            ++test1;
+        }
+        EXPECT_EQ(records.size(), chunkOff);
+    }
+    EXPECT_EQ(n, test1);
+    EXPECT_EQ(n, test2);
+    // chunks are recorded at the chunk size
+    EXPECT_GT(chunks, 10);
+
+    std::remove(testfile.c_str());
+}
+#endif
+
+TEST_F(ValueRecorderTest, DeltaEncoding)
+{
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    mcf::ValueRecorder valueRecorder(valueStore);
+    valueRecorder.enableExtMemSerialization("/grid");
+    valueRecorder.enableDeltaEncoding("/grid", 4);
+    EXPECT_THROW(valueRecorder.enableDeltaEncoding("/invalid", 0), std::runtime_error);
+
+    const std::string testfile = "record_delta.bin";
+    std::remove(testfile.c_str());
+    valueRecorder.start(testfile);
+    const int n = 10;
+    const size_t extMemSize = 1000;
+    for (int i = 0; i < n; ++i)
+    {
+        auto val = TestValueExtMem(i);
+        val.extMemInit(extMemSize);
+        std::fill(val.extMemPtr(), val.extMemPtr() + extMemSize, 7);
+        val.extMemPtr()[100 + i] = static_cast<uint8_t>(i);
+        valueStore.setValue("/grid", std::move(val));
+    }
+    valueRecorder.stop();
+
+    std::string str = readFile(testfile);
+    // three keyframes and small deltas
+    EXPECT_LT(str.size(), 4 * extMemSize);
+
+    std::vector<char> payload;
+    int keyframes = 0;
+    int values = 0;
+    size_t off = 0;
+    while (off < str.size())
+    {
+        const RecordEntry record = readRecord(str, off);
+        ASSERT_LE(off, str.size());
+        if (record.topic() != "/grid")
+        {
+            continue;
+        }
+        EXPECT_EQ("mcf::RecordDelta", record.typeId());
+        auto delta = record.value.get().as<msg::RecordDelta>();
+        EXPECT_EQ("TestValueExtMem", delta.tid);
+        EXPECT_EQ(extMemSize, delta.extmemSize);
+        EXPECT_TRUE(delta.extmemPresent);
+        ASSERT_TRUE(record.extMemPresent());
+        const uint32_t size = record.extMemSize();
+        const char* data = &str[record.extMemOffset];
+
+        if (delta.keyframe)
+        {
+            EXPECT_EQ(0, values % 4);
+            ++keyframes;
+            payload.assign(data, data + size);
+        }
+        else
+        {
+            ASSERT_FALSE(payload.empty());
+            EXPECT_LT(size, 32u);
+            std::vector<char> next(delta.valueSize + delta.extmemSize);
+            size_t pos = 0;
+            size_t runOff = 0;
+            auto varint = [&]() {
+                uint64_t result = 0;
+                for (int shift = 0; runOff < size; shift += 7)
+                {
+                    const auto byte = static_cast<uint8_t>(data[runOff++]);
+                    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                    if ((byte & 0x80) == 0)
+                    {
+                        break;
+                    }
+                }
+                return result;
+            };
+            while (pos < next.size())
+            {
+                const size_t unchanged = varint();
+                ASSERT_LE(pos + unchanged, payload.size());
+                std::copy(payload.begin() + pos, payload.begin() + pos + unchanged, next.begin() + pos);
+                pos += unchanged;
+                const size_t changed = varint();
+                ASSERT_LE(runOff + changed, size);
+                ASSERT_LE(pos + changed, next.size());
+                std::copy(data + runOff, data + runOff + changed, next.begin() + pos);
+                runOff += changed;
+                pos += changed;
+            }
+            EXPECT_EQ(size, runOff);
+            payload.swap(next);
+        }
+        ASSERT_EQ(delta.valueSize + extMemSize, payload.size());
+        EXPECT_EQ(values, msgpack::unpack(payload.data(), delta.valueSize).get().as<std::vector<int>>()[0]);
+        EXPECT_EQ(static_cast<char>(values), payload[delta.valueSize + 100 + values]);
+        EXPECT_EQ(7, payload[delta.valueSize + 100 + (values + 1) % n]);
+        ++values;
+    }
+    EXPECT_EQ(n, values);
+    EXPECT_EQ(3, keyframes);
+
+    std::remove(testfile.c_str());
+}
+
+TEST_F(ValueRecorderTest, Rotation)
+{
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    mcf::ValueRecorder valueRecorder(valueStore);
+    valueRecorder.setRotation(16 * 1024);
+
+    valueRecorder.start("record_rotation.bin");
+    const int n = 2000;
+    for (int i = 0; i < n; ++i)
+    {
+        valueStore.setValue("/test1", TestValue(i));
+    }
+    valueRecorder.stop();
+
+    const auto files = valueRecorder.getRecordFiles();
+    ASSERT_GT(files.size(), 2u);
+    EXPECT_EQ("record_rotation_0000.bin", files[0]);
+    EXPECT_EQ("record_rotation_0001.bin", files[1]);
+
+    // every segment is complete on its own and the values continue seamlessly
+    int next = 0;
+    for (const auto& file : files)
+    {
+        std::string str = readFile(file);
+        ASSERT_GT(str.size(), 16u);
+        EXPECT_EQ(std::string(mcf::ValueRecorder::FOOTER_MAGIC), str.substr(str.size() - 8));
+        size_t off = 0;
+        while (off < str.size())
+        {
+            const RecordEntry record = readRecord(str, off);
+            const auto topic = record.topic();
+            if (topic == "/test1")
+            {
+                EXPECT_EQ(next++, record.intValue());
+            }
+            else if (topic == mcf::ValueRecorder::FOOTER_TOPIC)
+            {
+                auto footer = record.value.get().as<msg::RecordFooter>();
+                EXPECT_EQ(0u, footer.offsets.front());
+            }
+        }
+        EXPECT_EQ(str.size(), off);
+        EXPECT_LT(str.size(), 32u * 1024);
+        std::remove(file.c_str());
+    }
+    EXPECT_EQ(n, next);
+
+    // the space preallocated for a segment is released if it ends short of the size limit
+    valueRecorder.setRotation(4 * 1024 * 1024);
+    valueRecorder.start("record_rotation.bin");
+    valueStore.setValue("/test1", TestValue(0));
+    valueRecorder.stop();
+
+    ASSERT_EQ(1u, valueRecorder.getRecordFiles().size());
+    const std::string file = valueRecorder.getRecordFiles()[0];
+    struct stat fileStat;
+    ASSERT_EQ(0, stat(file.c_str(), &fileStat));
+    EXPECT_LT(static_cast<uint64_t>(fileStat.st_size), 4096u);
+    // st_blocks counts 512 byte units
+    EXPECT_LT(static_cast<uint64_t>(fileStat.st_blocks) * 512, 1024u * 1024);
+    std::remove(file.c_str());
+}
+
+namespace
+{
+
+/**
+ * Storage keeping the stream in memory, whose writes can be held back
+ */
+class HeldStorage : public mcf::IRecorderStorage
+{
+public:
+    int open(const std::string&) override { return 0; }
+
+    int write(const iovec* iov, size_t count) override
+    {
+        std::unique_lock<std::mutex> lk(mutex);
+        ++writes;
+        changed.notify_all();
+        changed.wait(lk, [this] { return !held; });
+        for (size_t i = 0; i < count; ++i)
+        {
+            data.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+        }
+        return 0;
+    }
+
+    int close() override { return 0; }
+    uint64_t bytesWritten() const override { return 0; }
+
+    /**
+     * Hold back the next writes, returns the number of writes so far
+     */
+    int hold()
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        held = true;
+        return writes;
+    }
+
+    void waitForWrite(int previous)
+    {
+        std::unique_lock<std::mutex> lk(mutex);
+        changed.wait(lk, [this, previous] { return writes > previous; });
+    }
+
+    void release()
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        held = false;
+        changed.notify_all();
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool held = false;
+    int writes = 0;
+    std::string data;
+};
+
+} // anonymous namespace
+
+TEST_F(ValueRecorderTest, Priorities)
+{
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    auto storage = std::make_unique<HeldStorage>();
+    HeldStorage& held = *storage;
+    mcf::ValueRecorder valueRecorder(valueStore);
+    valueRecorder.setStorage(std::move(storage));
+    valueRecorder.setTopicPriority("/bulk", mcf::ValueRecorder::Priority::BULK);
+    valueRecorder.setTopicPriority("/critical", mcf::ValueRecorder::Priority::CRITICAL);
+    valueRecorder.start("unused");
+
+    // values queue up while the write thread is held in a write
+    auto hold = [&] {
+        const int writes = held.hold();
+        valueStore.setValue("/start", TestValue(-1));
+        held.waitForWrite(writes);
+    };
+
+    // the entry limit drops bulk values from half of the limit on
+    valueRecorder.setWriteQueueSizeLimit(10);
+    hold();
+    for (int i = 0; i < 20; ++i)
+    {
+        valueStore.setValue("/bulk", TestValue(i));
+    }
+    for (int i = 0; i < 20; ++i)
+    {
+        valueStore.setValue("/normal", TestValue(i));
+    }
+    valueStore.setValue("/critical", TestValue(0));
+    held.release();
+    while (!valueRecorder.writeQueueEmpty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // the byte limit drops values when they are published
+    valueRecorder.setWriteQueueSizeLimit(UINT_MAX);
+    const size_t extMemSize = 1000;
+    const uint64_t entryBytes = mcf::ValueRecorder::QUEUE_ENTRY_BYTES;
+    valueRecorder.setWriteQueueByteLimit(4 * (extMemSize + entryBytes));
+    valueRecorder.setTopicPriority("/bulkExtMem", mcf::ValueRecorder::Priority::BULK);
+    hold();
+    for (int i = 0; i < 10; ++i)
+    {
+        auto val = TestValueExtMem(i);
+        val.extMemInit(extMemSize);
+        valueStore.setValue("/bulkExtMem", std::move(val));
+    }
+    for (int i = 0; i < 100; ++i)
+    {
+        valueStore.setValue("/normal", TestValue(100 + i));
+    }
+    valueStore.setValue("/critical", TestValue(1));
+    held.release();
+    valueRecorder.stop();
+
+    auto recorded = readRecordedInts(held.data);
+    // 41 values were queued, the bulk ones all beyond half of the limit, the normal ones
+    // within the limit only from the 11th on
+    EXPECT_TRUE(recorded["/bulk"].empty());
+    std::vector<int> normal;
+    for (int i = 11; i < 20; ++i)
+    {
+        normal.push_back(i);
+    }
+    EXPECT_EQ((std::vector<int>{0, 1}), recorded["/critical"]);
+
+    // bulk values fit into half of the byte limit, normal values into the rest
+    EXPECT_EQ((std::vector<int>{0, 1}), recorded["/bulkExtMem"]);
+    const uint64_t limit = 4 * (extMemSize + entryBytes);
+    for (uint64_t i = 0; i < (limit - 2 * (extMemSize + entryBytes)) / entryBytes; ++i)
+    {
+        normal.push_back(100 + static_cast<int>(i));
+    }
+    EXPECT_EQ(normal, recorded["/normal"]);
+}
+
+TEST_F(ValueRecorderTest, RecordPolicies)
+{
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    mcf::ValueRecorder valueRecorder(valueStore);
+    using Policy = mcf::ValueRecorder::RecordPolicy;
+    valueRecorder.setRecordPolicy("/nth", Policy::everyNth(3));
+    valueRecorder.setRecordPolicy("/rate", Policy::maxRate(1.0));
+    valueRecorder.setRecordPolicy("/change", Policy::onChange());
+    valueRecorder.setRecordPolicy("/changeExtMem", Policy::onChange());
+    valueRecorder.setRecordPolicy("/republished", Policy::onChange());
+    valueRecorder.setRecordPolicy("/all", Policy::everyNth(2));
+    valueRecorder.setRecordPolicy("/all", Policy());
+    EXPECT_THROW(valueRecorder.setRecordPolicy("/invalid", Policy::everyNth(0)), std::runtime_error);
+    EXPECT_THROW(valueRecorder.setRecordPolicy("/invalid", Policy::maxRate(0.0)), std::runtime_error);
+
+    const std::string testfile = "record_policies.bin";
+    std::remove(testfile.c_str());
+    valueRecorder.start(testfile);
+    for (int i = 0; i < 10; ++i)
+    {
+        valueStore.setValue("/nth", TestValue(i));
+        valueStore.setValue("/rate", TestValue(i));
+        valueStore.setValue("/all", TestValue(i));
+    }
+    for (int val : {1, 1, 2, 2, 2, 3, 1})
+    {
+        valueStore.setValue("/change", TestValue(val));
+    }
+    // ext mem data counts as content
+    for (uint8_t val : {1, 1, 2})
+    {
+        auto extMem = TestValueExtMem(0);
+        extMem.extMemInit(10);
+        std::fill(extMem.extMemPtr(), extMem.extMemPtr() + 10, val);
+        valueStore.setValue("/changeExtMem", std::move(extMem));
+    }
+    // the same value published again is skipped before it is queued
+    const mcf::ValuePtr republished = std::make_shared<const TestValue>(5);
+    for (int i = 0; i < 3; ++i)
+    {
+        valueStore.setValue("/republished", republished);
+    }
+    valueRecorder.stop();
+
+    auto recorded = readRecordedInts(readFile(testfile));
+    EXPECT_EQ((std::vector<int>{0, 3, 6, 9}), recorded["/nth"]);
+    EXPECT_EQ(std::vector<int>{0}, recorded["/rate"]);
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), recorded["/all"]);
+    EXPECT_EQ((std::vector<int>{1, 2, 3, 1}), recorded["/change"]);
+    EXPECT_EQ(2u, recorded["/changeExtMem"].size());
+    EXPECT_EQ(std::vector<int>{5}, recorded["/republished"]);
+
+    std::remove(testfile.c_str());
+}
+
+TEST_F(ValueRecorderTest, Footer)
+{
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    mcf::ValueRecorder valueRecorder(valueStore);
+
+    const std::string testfile = "record_footer.bin";
+    std::remove(testfile.c_str());
+    valueRecorder.start(testfile);
+    const int n = 100;
+    for (int i = 0; i < n; ++i)
+    {
+        valueStore.setValue("/test1", TestValue(i));
+        if (i % 2 == 0)
+        {
+            valueStore.setValue("/test2", TestValue(i));
+        }
+    }
+    valueRecorder.stop();
+
+    std::string str = readFile(testfile);
+    ASSERT_GT(str.size(), 16u);
+    EXPECT_EQ(std::string(mcf::ValueRecorder::FOOTER_MAGIC), str.substr(str.size() - 8));
+    uint64_t footerOffset = 0;
+    for (int i = 7; i >= 0; --i)
+    {
+        footerOffset = (footerOffset << 8) | static_cast<uint8_t>(str[str.size() - 16 + i]);
+    }
+    ASSERT_LT(footerOffset, str.size());
+
+    size_t off = footerOffset;
+    const RecordEntry record = readRecord(str, off);
+    EXPECT_EQ(mcf::ValueRecorder::FOOTER_TOPIC, record.topic());
+    auto footer = record.value.get().as<msg::RecordFooter>();
+    EXPECT_EQ(16u, record.extMemSize());
+    EXPECT_EQ(str.size(), off);
+
+    auto test1 = std::find(footer.topics.begin(), footer.topics.end(), "/test1");
+    auto test2 = std::find(footer.topics.begin(), footer.topics.end(), "/test2");
+    ASSERT_NE(footer.topics.end(), test1);
+    ASSERT_NE(footer.topics.end(), test2);
+    EXPECT_EQ(n, footer.counts[test1 - footer.topics.begin()]);
+    EXPECT_EQ(n / 2, footer.counts[test2 - footer.topics.begin()]);
+    EXPECT_LE(footer.startTime, footer.endTime);
+
+    // the checkpoints point at records of their time, the first one at the start of the file
+    ASSERT_FALSE(footer.offsets.empty());
+    ASSERT_EQ(footer.times.size(), footer.offsets.size());
+    EXPECT_EQ(0u, footer.offsets[0]);
+    EXPECT_EQ(footer.startTime, footer.times[0]);
+    for (size_t i = 0; i < footer.offsets.size(); ++i)
+    {
+        off = footer.offsets[i];
+        ASSERT_LT(off, footerOffset);
+        EXPECT_LE(footer.times[i], readRecord(str, off).time());
+    }
+
+    std::remove(testfile.c_str());
+}
+
+TEST_F(ValueRecorderTest, FlightRecorder)
+{
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    mcf::ValueRecorder valueRecorder(valueStore);
+    mcf::ValueRecorder::FlightRecorderConfig config;
+    config.topics = {"/kept"};
+    // the last five values
+    config.maxBytes = 5 * mcf::ValueRecorder::QUEUE_ENTRY_BYTES;
+    config.triggerTopic = "/trigger";
+    config.postTrigger = std::chrono::milliseconds(200);
+    valueRecorder.setFlightRecorder(config);
+
+    const std::string testfile = "flight_recorder.bin";
+    std::remove(testfile.c_str());
+    valueRecorder.start(testfile);
+    for (int i = 0; i < 10; ++i)
+    {
+        valueStore.setValue("/kept", TestValue(i));
+        valueStore.setValue("/dropped", TestValue(i));
+    }
+    valueStore.setValue("/trigger", TestValue(100));
+    valueStore.setValue("/kept", TestValue(10));
+    valueStore.setValue("/kept", TestValue(11));
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    // after the window, kept until the next dump
+    valueStore.setValue("/kept", TestValue(12));
+    while (!valueRecorder.writeQueueEmpty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    valueRecorder.triggerDump();
+    valueStore.setValue("/kept", TestValue(13));
+    valueRecorder.stop();
+
+    auto recorded = readRecordedInts(readFile(testfile));
+    EXPECT_EQ((std::vector<int>{5, 6, 7, 8, 9, 10, 11, 12, 13}), recorded["/kept"]);
+    EXPECT_EQ(std::vector<int>{100}, recorded["/trigger"]);
+    EXPECT_TRUE(recorded["/dropped"].empty());
+
+    std::remove(testfile.c_str());
+}
+
+TEST_F(ValueRecorderTest, SerializedValues)
+{
+    mcf::ValueStore valueStore;
+    registerValueTypes(valueStore);
+    mcf::ValueRecorder valueRecorder(valueStore);
+
+    const std::string testfile = "serialized_values.bin";
+    std::remove(testfile.c_str());
+    valueRecorder.start(testfile);
+    // recorded as serialized, numeric type ids are resolved, unknown types keep their id, all are
+    // recorded with the numbers of their writes
+    valueStore.setValue("/test1", mcf::ValuePtr(std::make_shared<SerializedTestValue>(5, "TestValue", 0)));
+    valueStore.setValue("/test1", mcf::ValuePtr(std::make_shared<SerializedTestValue>(
+        6, "", TypeRegistry::hashTypeId("TestValue"))));
+    valueStore.setValue("/test2", mcf::ValuePtr(std::make_shared<SerializedTestValue>(7, "UnknownValue", 0)));
+    valueStore.setValue("/test2", TestValue(8));
+    while (!valueRecorder.writeQueueEmpty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    valueRecorder.stop();
+
+    std::vector<std::tuple<std::string, int, uint64_t>> recorded;
+    std::string str = readFile(testfile);
+    size_t off = 0;
+    while (off < str.size())
+    {
+        const RecordEntry record = readRecord(str, off);
+        if (record.topic().compare(0, 5, "/mcf/") != 0)
+        {
+            recorded.emplace_back(record.typeId(), record.intValue(), record.seq());
+            EXPECT_FALSE(record.extMemPresent());
+        }
+    }
+    ASSERT_EQ(4u, recorded.size());
+    EXPECT_EQ(std::make_tuple(std::string("TestValue"), 5, uint64_t(1)), recorded[0]);
+    EXPECT_EQ(std::make_tuple(std::string("TestValue"), 6, uint64_t(2)), recorded[1]);
+    EXPECT_EQ(std::make_tuple(std::string("UnknownValue"), 7, uint64_t(1)), recorded[2]);
+    EXPECT_EQ(std::make_tuple(std::string("TestValue"), 8, uint64_t(2)), recorded[3]);
+
+    std::remove(testfile.c_str());
+}
+
 }
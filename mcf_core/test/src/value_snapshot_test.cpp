@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_core/ComponentManager.h"
+#include "mcf_core/ExtMemValue.h"
+#include "mcf_core/Mcf.h"
+#include "mcf_core/ValueSnapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace mcf {
+
+namespace {
+
+const std::string SNAPSHOT_FILE = "value_snapshot_test.snapshot";
+
+class MapValue : public Value {
+public:
+    MapValue(int val=0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+class GridValue : public ExtMemValue<uint8_t> {
+public:
+    int val = 0;
+    MSGPACK_DEFINE(val);
+};
+
+class UnregisteredValue : public Value {
+public:
+    int val = 0;
+    MSGPACK_DEFINE(val);
+};
+
+void registerTypes(ValueStore& valueStore) {
+    valueStore.registerType<MapValue>("MapValue");
+    valueStore.registerType<GridValue>("GridValue");
+}
+
+ValueSnapshotConfig snapshotConfig() {
+    ValueSnapshotConfig config;
+    config.file = SNAPSHOT_FILE;
+    config.topics = {"/map/*", "/calibration"};
+    return config;
+}
+
+class Planner : public Component {
+public:
+    Planner() : Component("Planner"), fMap(*this, "Map", 10) {}
+
+    void configure(IComponentConfig& config) override {
+        config.registerPort(fMap, "/map/lanes");
+    }
+
+    // no handler, so that received values stay queued
+    QueuedReceiverPort<MapValue> fMap;
+};
+
+} // anonymous namespace
+
+TEST(ValueSnapshotTest, WriteAndRestore) {
+    std::remove(SNAPSHOT_FILE.c_str());
+    {
+        ValueStore valueStore;
+        registerTypes(valueStore);
+        valueStore.setValue("/map/lanes", MapValue(1));
+        valueStore.setValue("/calibration", MapValue(2));
+        valueStore.setValue("/vehicle/speed", MapValue(3));
+        valueStore.setValue("/map/unregistered", UnregisteredValue());
+        auto grid = std::make_shared<GridValue>();
+        grid->val = 4;
+        grid->extMemInit(100);
+        for (size_t i = 0; i < 100; ++i) {
+            grid->extMemPtr()[i] = static_cast<uint8_t>(i);
+        }
+        valueStore.setValue("/map/grid", ValuePtr(grid));
+
+        ValueSnapshot snapshot(valueStore, snapshotConfig());
+        EXPECT_EQ(3u, snapshot.write());
+    }
+
+    ValueStore valueStore;
+    registerTypes(valueStore);
+    // a live value is not replaced
+    valueStore.setValue("/calibration", MapValue(20));
+    ValueSnapshot snapshot(valueStore, snapshotConfig());
+    EXPECT_EQ(2u, snapshot.restore());
+    EXPECT_EQ(1, valueStore.getValue<MapValue>("/map/lanes")->val);
+    EXPECT_EQ(20, valueStore.getValue<MapValue>("/calibration")->val);
+    EXPECT_FALSE(valueStore.hasValue("/vehicle/speed"));
+    auto grid = valueStore.getValue<GridValue>("/map/grid");
+    EXPECT_EQ(4, grid->val);
+    ASSERT_EQ(100u, grid->extMemSize());
+    EXPECT_EQ(99, grid->extMemPtr()[99]);
+    std::remove(SNAPSHOT_FILE.c_str());
+}
+
+TEST(ValueSnapshotTest, InvalidOrOldSnapshot) {
+    std::remove(SNAPSHOT_FILE.c_str());
+    ValueStore valueStore;
+    registerTypes(valueStore);
+    ValueSnapshot snapshot(valueStore, snapshotConfig());
+    EXPECT_EQ(0u, snapshot.restore());
+
+    {
+        std::ofstream file(SNAPSHOT_FILE);
+        file << "no snapshot at all, but long enough for a header";
+    }
+    EXPECT_EQ(0u, snapshot.restore());
+
+    valueStore.setValue("/map/lanes", MapValue(1));
+    EXPECT_EQ(1u, snapshot.write());
+    ValueStore restored;
+    registerTypes(restored);
+    ValueSnapshotConfig config = snapshotConfig();
+    config.maxAge = std::chrono::milliseconds(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_EQ(0u, ValueSnapshot(restored, config).restore());
+    config.maxAge = std::chrono::milliseconds(0);
+    EXPECT_EQ(1u, ValueSnapshot(restored, config).restore());
+    std::remove(SNAPSHOT_FILE.c_str());
+}
+
+TEST(ValueSnapshotTest, WarmRestart) {
+    std::remove(SNAPSHOT_FILE.c_str());
+    {
+        ValueStore valueStore;
+        registerTypes(valueStore);
+        ComponentManager manager(valueStore);
+        manager.enableValueSnapshot(snapshotConfig());
+        manager.registerComponent(std::make_shared<Planner>());
+        manager.configure();
+        manager.startup();
+        valueStore.setValue("/map/lanes", MapValue(7));
+        // the snapshot is written at shutdown
+        manager.shutdown();
+    }
+
+    ValueStore valueStore;
+    registerTypes(valueStore);
+    ComponentManager manager(valueStore);
+    manager.enableValueSnapshot(snapshotConfig());
+    auto planner = std::make_shared<Planner>();
+    manager.registerComponent(planner);
+    manager.configure();
+    manager.startup();
+    // restored before the planner runs, into its queue as well
+    EXPECT_EQ(7, valueStore.getValue<MapValue>("/map/lanes")->val);
+    ASSERT_TRUE(planner->fMap.hasValue());
+    EXPECT_EQ(7, planner->fMap.getValue()->val);
+    manager.shutdown();
+    std::remove(SNAPSHOT_FILE.c_str());
+}
+
+} // namespace mcf
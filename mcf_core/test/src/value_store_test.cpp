@@ -5,6 +5,7 @@
 #include "gtest/gtest.h"
 #include "mcf_core/Mcf.h"
 #include "mcf_core/ExtMemValue.h"
+#include "mcf_core/ValueStoreStatsPublisher.h"
 
 namespace mcf {
 
@@ -63,6 +64,250 @@ TEST_F(ValueStoreTest, ReadWrite) {
   EXPECT_EQ(17, ptr->id());
 }
 
+TEST_F(ValueStoreTest, TopicHandle) {
+  mcf::ValueStore valueStore;
+
+  mcf::ValueStore::TopicHandle invalid;
+  EXPECT_FALSE(invalid.valid());
+  EXPECT_FALSE(valueStore.hasValue(invalid));
+  EXPECT_EQ(0, valueStore.getValue<TestValue>(invalid)->val);
+
+  auto handle = valueStore.getTopicHandle("/test1");
+  EXPECT_TRUE(handle.valid());
+  EXPECT_EQ("/test1", handle.topic());
+  EXPECT_FALSE(valueStore.hasValue(handle));
+  EXPECT_FALSE(valueStore.hasValue("/test1"));
+
+  auto queue = std::make_shared<mcf::ValueQueue>();
+  valueStore.addReceiver("/test1", queue);
+
+  // writing via handle is visible via topic name and vice versa
+  EXPECT_EQ(valueStore.setValue(handle, std::make_shared<const TestValue>(5)), 0);
+  EXPECT_TRUE(valueStore.hasValue(handle));
+  EXPECT_TRUE(valueStore.hasValue("/test1"));
+  EXPECT_EQ(5, valueStore.getValue<TestValue>("/test1")->val);
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(6)), 0);
+  EXPECT_EQ(6, valueStore.getValue<TestValue>(handle)->val);
+
+  // receivers are notified with the topic name
+  auto entry = queue->popWithTopic<TestValue>();
+  EXPECT_EQ(5, std::get<0>(entry)->val);
+  EXPECT_EQ("/test1", std::get<1>(entry));
+  EXPECT_EQ(6, queue->pop<TestValue>()->val);
+
+  // handles to the same topic refer to the same entry, also after adding more topics
+  for (int i = 0; i < 1000; ++i) {
+    valueStore.getTopicHandle("/other" + std::to_string(i));
+  }
+  auto handle2 = valueStore.getTopicHandle("/test1");
+  EXPECT_EQ(valueStore.setValue(handle2, std::make_shared<const TestValue>(7)), 0);
+  EXPECT_EQ(7, valueStore.getValue<TestValue>(handle)->val);
+}
+
+class CountingTrigger : public mcf::ITriggerable {
+public:
+    explicit CountingTrigger(bool coalescable) : fCoalescable(coalescable) {}
+    ~CountingTrigger() override { detachTriggerSources(); }
+    void trigger() override { ++count; }
+    bool isCoalescable() const override { return fCoalescable; }
+    std::atomic<int> count{0};
+private:
+    bool fCoalescable;
+};
+
+TEST_F(ValueStoreTest, SetValues) {
+  mcf::ValueStore valueStore;
+  auto coalescable = std::make_shared<CountingTrigger>(true);
+  auto nonCoalescable = std::make_shared<CountingTrigger>(false);
+
+  std::vector<std::shared_ptr<mcf::ValueQueue>> queues;
+  mcf::ValueStore::ValueBatch batch;
+  for (int i = 0; i < 3; ++i) {
+    auto topic = "/test" + std::to_string(i);
+    queues.push_back(std::make_shared<mcf::ValueQueue>());
+    queues.back()->addTrigger(coalescable);
+    queues.back()->addTrigger(nonCoalescable);
+    valueStore.addReceiver(topic, queues.back());
+    batch.emplace_back(valueStore.getTopicHandle(topic), std::make_shared<const TestValue>(i));
+  }
+  // the same topic twice in one batch
+  batch.emplace_back(valueStore.getTopicHandle("/test0"), std::make_shared<const TestValue>(10));
+
+  EXPECT_EQ(0, valueStore.setValues(mcf::ValueStore::ValueBatch()));
+  EXPECT_EQ(0, valueStore.setValues(batch));
+  EXPECT_EQ(1, coalescable->count);
+  EXPECT_EQ(4, nonCoalescable->count);
+
+  EXPECT_EQ(10, valueStore.getValue<TestValue>("/test0")->val);
+  EXPECT_EQ(1, valueStore.getValue<TestValue>("/test1")->val);
+  EXPECT_EQ(2, valueStore.getValue<TestValue>("/test2")->val);
+  EXPECT_EQ(0, queues[0]->pop<TestValue>()->val);
+  EXPECT_EQ(10, queues[0]->pop<TestValue>()->val);
+  EXPECT_EQ(1, queues[1]->pop<TestValue>()->val);
+  EXPECT_EQ(2, queues[2]->pop<TestValue>()->val);
+
+  // nothing is written if a single receiver blocks
+  auto blockingQueue = std::make_shared<mcf::ValueQueue>(1, true);
+  valueStore.addReceiver("/test2", blockingQueue);
+  EXPECT_EQ(0, valueStore.setValue("/test2", TestValue(20)));
+  EXPECT_EQ(EAGAIN, valueStore.setValues(batch, false));
+  EXPECT_EQ(ECANCELED, valueStore.setValues(batch, true, [] { return true; }));
+  EXPECT_EQ(10, valueStore.getValue<TestValue>("/test0")->val);
+  EXPECT_EQ(20, valueStore.getValue<TestValue>("/test2")->val);
+  EXPECT_EQ(2, coalescable->count);  // triggered by the single setValue() only
+}
+
+TEST_F(ValueStoreTest, SpinningTrigger) {
+  mcf::Trigger trigger;
+  EXPECT_EQ(0, trigger.getSpinDuration().count());
+  trigger.setSpinDuration(std::chrono::seconds(10));
+  std::atomic<int> woken{0};
+  std::thread waiter([&trigger, &woken] {
+    for (int i = 0; i < 3; ++i) {
+      trigger.wait();
+      ++woken;
+    }
+  });
+  // caught while spinning
+  trigger.trigger();
+  while (woken < 1) {
+    std::this_thread::yield();
+  }
+  // caught while blocked
+  trigger.setSpinDuration(std::chrono::nanoseconds(0));
+  trigger.trigger();
+  while (woken < 2) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(2, woken);
+  trigger.trigger();
+  waiter.join();
+  EXPECT_EQ(3, woken);
+}
+
+TEST_F(ValueStoreTest, LatestValueConcurrentReads) {
+  mcf::LatestValue latest;
+  EXPECT_FALSE(latest.hasValue());
+  EXPECT_EQ(nullptr, latest.load());
+
+  // readers never see a value older than one they have seen before, nor a destroyed one
+  std::atomic<bool> stop{false};
+  std::atomic<int> outOfOrder{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&latest, &stop, &outOfOrder] {
+      int last = -1;
+      while (!stop) {
+        auto value = std::dynamic_pointer_cast<const TestValue>(latest.load());
+        if (value != nullptr) {
+          if (value->val < last) {
+            ++outOfOrder;
+          }
+          last = value->val;
+        }
+      }
+    });
+  }
+  std::weak_ptr<const mcf::Value> replaced;
+  for (int i = 0; i < 100000; ++i) {
+    replaced = latest.exchange(std::make_shared<const TestValue>(i));
+  }
+  stop = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, outOfOrder);
+  // the store keeps no reference to replaced values
+  EXPECT_TRUE(replaced.expired());
+  EXPECT_TRUE(latest.hasValue());
+  EXPECT_EQ(99999, std::dynamic_pointer_cast<const TestValue>(latest.exchange(nullptr))->val);
+  EXPECT_FALSE(latest.hasValue());
+}
+
+TEST_F(ValueStoreTest, TriggerRegistration) {
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<mcf::ValueQueue>();
+  auto trigger = std::make_shared<CountingTrigger>(false);
+  auto other = std::make_shared<CountingTrigger>(false);
+  queue->addTrigger(trigger);
+  queue->addTrigger(trigger);  // registered once only
+  queue->addTrigger(other);
+  valueStore.addReceiver("/test", queue);
+
+  valueStore.setValue("/test", TestValue(1));
+  EXPECT_EQ(1, trigger->count);
+  EXPECT_EQ(1, other->count);
+
+  // a destroyed triggerable is unlinked from its sources
+  other.reset();
+  queue->removeTrigger(trigger);
+  valueStore.setValue("/test", TestValue(2));
+  EXPECT_EQ(1, trigger->count);
+
+  // a destroyed source is unlinked from its triggerables
+  queue->addTrigger(trigger);
+  valueStore.setValue("/test", TestValue(3));
+  EXPECT_EQ(2, trigger->count);
+  valueStore.removeReceiver("/test", queue);
+  queue.reset();
+  trigger.reset();
+}
+
+TEST_F(ValueStoreTest, History) {
+  mcf::ValueStore valueStore;
+  EXPECT_TRUE(valueStore.getHistory("/test1", 10).empty());
+
+  valueStore.enableHistory("/test1", 3);
+  std::vector<uint64_t> times;
+  for (int i = 1; i <= 5; ++i) {
+    EXPECT_EQ(valueStore.setValue("/test1", TestValue(i)), 0);
+    times.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+
+  auto history = valueStore.getHistory("/test1", 10);
+  ASSERT_EQ(3, history.size());
+  EXPECT_EQ(3, std::dynamic_pointer_cast<const TestValue>(history[0].value)->val);
+  EXPECT_EQ(5, std::dynamic_pointer_cast<const TestValue>(history[2].value)->val);
+  EXPECT_LE(history[0].time, history[1].time);
+  EXPECT_LE(history[1].time, history[2].time);
+  ASSERT_EQ(1, valueStore.getHistory("/test1", 1).size());
+  // history shares the values with the value store
+  EXPECT_EQ(valueStore.getValue<TestValue>("/test1").get(), valueStore.getHistory("/test1", 1)[0].value.get());
+
+  // lookup by time
+  EXPECT_EQ(0, valueStore.getValueAt<TestValue>("/test1", times[1])->val);  // history too short
+  EXPECT_EQ(3, valueStore.getValueAt<TestValue>("/test1", times[2])->val);
+  EXPECT_EQ(4, valueStore.getValueAt<TestValue>("/test1", times[3])->val);
+  EXPECT_EQ(5, valueStore.getValueAt<TestValue>("/test1", times[4] + 1000000)->val);
+  EXPECT_EQ(0, valueStore.getValueAt<TestValue>("/unknown", times[4])->val);
+
+  // shrinking keeps the most recent values
+  valueStore.enableHistory("/test1", 2);
+  history = valueStore.getHistory("/test1", 10);
+  ASSERT_EQ(2, history.size());
+  EXPECT_EQ(4, std::dynamic_pointer_cast<const TestValue>(history[0].value)->val);
+
+  valueStore.enableHistory("/test1", 0);
+  EXPECT_TRUE(valueStore.getHistory("/test1", 10).empty());
+}
+
+TEST_F(ValueStoreTest, HistoryMaxAge) {
+  mcf::ValueStore valueStore;
+  valueStore.enableHistory("/test1", 100, std::chrono::milliseconds(50));
+
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(1)), 0);
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(2)), 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(3)), 0);
+
+  auto history = valueStore.getHistory("/test1", 100);
+  ASSERT_EQ(1, history.size());
+  EXPECT_EQ(3, std::dynamic_pointer_cast<const TestValue>(history[0].value)->val);
+}
+
 TEST_F(ValueStoreTest, ReadWriteExtMemRValue) {
   mcf::ValueStore valueStore;
 
@@ -169,6 +414,139 @@ TEST_F(ValueStoreTest, QueueOverflow) {
   EXPECT_TRUE(queue->empty());
 }
 
+TEST_F(ValueStoreTest, RingBufferQueue) {
+  mcf::ValueStore valueStore;
+  EXPECT_THROW(mcf::ValueQueue(0, false, mcf::ValueQueue::Storage::RING_BUFFER), std::runtime_error);
+
+  auto queue = std::make_shared<mcf::ValueQueue>(3, false, mcf::ValueQueue::Storage::RING_BUFFER);
+  EXPECT_EQ(mcf::ValueQueue::Storage::RING_BUFFER, queue->getStorage());
+  EXPECT_TRUE(queue->empty());
+  EXPECT_THROW(queue->pop<TestValue>(), mcf::QueueEmptyException);
+
+  valueStore.addReceiver("/test1", queue);
+  valueStore.addReceiver("/test2", queue);
+
+  // wrap around several times, oldest values are dropped
+  for (int i = 1; i <= 10; ++i) {
+    EXPECT_EQ(valueStore.setValue(i % 2 ? "/test1" : "/test2", TestValue(i)), 0);
+  }
+  EXPECT_EQ(3, queue->size());
+  EXPECT_EQ(8, queue->peek<TestValue>()->val);
+  auto entry = queue->popWithTopic<TestValue>();
+  EXPECT_EQ(8, std::get<0>(entry)->val);
+  EXPECT_EQ("/test2", std::get<1>(entry));
+  auto entry2 = queue->popWithTopic<TestValue>();
+  EXPECT_EQ(9, std::get<0>(entry2)->val);
+  EXPECT_EQ("/test1", std::get<1>(entry2));
+
+  // shrinking keeps the newest values, growing keeps all
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(11)), 0);
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(12)), 0);
+  queue->setMaxLength(2);
+  EXPECT_EQ(2, queue->size());
+  queue->setMaxLength(4);
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(13)), 0);
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(14)), 0);
+  EXPECT_EQ(11, queue->pop<TestValue>()->val);
+  EXPECT_EQ(12, queue->pop<TestValue>()->val);
+  EXPECT_EQ(13, queue->pop<TestValue>()->val);
+  EXPECT_EQ(14, queue->pop<TestValue>()->val);
+  EXPECT_TRUE(queue->empty());
+  EXPECT_THROW(queue->setMaxLength(0), std::runtime_error);
+}
+
+TEST_F(ValueStoreTest, QueueAge) {
+  for (auto storage : {mcf::ValueQueue::Storage::DYNAMIC, mcf::ValueQueue::Storage::RING_BUFFER}) {
+    mcf::ValueStore valueStore;
+    auto queue = std::make_shared<mcf::ValueQueue>(4, true, storage);
+    valueStore.addReceiver("/test1", queue);
+    EXPECT_EQ(0, queue->getAge().count());
+
+    EXPECT_EQ(valueStore.setValue("/test1", TestValue(1)), 0);
+    EXPECT_EQ(valueStore.setValue("/test1", TestValue(2)), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(valueStore.setValue("/test1", TestValue(3)), 0);
+    EXPECT_EQ(valueStore.setValue("/test1", TestValue(4)), 0);
+    EXPECT_GE(queue->getAge(), std::chrono::milliseconds(20));
+
+    // the full queue no longer blocks once old values are dropped
+    EXPECT_EQ(valueStore.setValue("/test1", TestValue(5), false), EAGAIN);
+    EXPECT_EQ(2u, queue->dropOlderThan(std::chrono::milliseconds(10)));
+    EXPECT_LT(queue->getAge(), std::chrono::milliseconds(20));
+    EXPECT_EQ(valueStore.setValue("/test1", TestValue(5), false), 0);
+
+    // zero drops all values but the ones kept
+    EXPECT_EQ(2u, queue->dropOlderThan(std::chrono::nanoseconds(0), 1));
+    EXPECT_EQ(5, queue->pop<TestValue>()->val);
+    EXPECT_EQ(0u, queue->dropOlderThan(std::chrono::nanoseconds(0)));
+  }
+}
+
+TEST_F(ValueStoreTest, QueueAdaptiveLength) {
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<mcf::ValueQueue>(2);
+  valueStore.addReceiver("/test1", queue);
+
+  mcf::ValueQueue::AdaptiveLength adaptive;
+  adaptive.minLength = 4;
+  adaptive.maxLength = 2;
+  EXPECT_THROW(queue->enableAdaptiveLength(adaptive), std::runtime_error);
+  adaptive.minLength = 1;
+  adaptive.maxLength = 16;
+  adaptive.window = std::chrono::milliseconds(20);
+  queue->enableAdaptiveLength(adaptive);
+  EXPECT_EQ(2u, queue->getMaxLength());
+
+  // drops grow the queue at the end of the window
+  for (int i = 1; i <= 6; ++i) {
+    EXPECT_EQ(valueStore.setValue("/test1", TestValue(i)), 0);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(25));
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(7)), 0);
+  EXPECT_EQ(4u, queue->getMaxLength());
+  auto decisions = queue->takeLengthDecisions();
+  ASSERT_EQ(1u, decisions.size());
+  EXPECT_EQ(2u, decisions[0].previousLength);
+  EXPECT_EQ(4u, decisions[0].length);
+  EXPECT_GT(decisions[0].arrivalRate, 0.0);
+  EXPECT_DOUBLE_EQ(5.0 / 7.0, decisions[0].dropRate);
+  EXPECT_TRUE(queue->takeLengthDecisions().empty());
+
+  // values waiting longer than the target latency shrink it to what the consumer works off
+  adaptive.targetLatency = std::chrono::milliseconds(10);
+  queue->enableAdaptiveLength(adaptive);
+  std::this_thread::sleep_for(std::chrono::milliseconds(15));
+  EXPECT_EQ(6, queue->pop<TestValue>()->val);
+  EXPECT_EQ(7, queue->pop<TestValue>()->val);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(8)), 0);
+  EXPECT_EQ(1u, queue->getMaxLength());
+  decisions = queue->takeLengthDecisions();
+  ASSERT_EQ(1u, decisions.size());
+  EXPECT_GE(decisions[0].maxWait, std::chrono::milliseconds(15));
+  EXPECT_GT(decisions[0].serviceRate, 0.0);
+
+  // the length is kept once disabled
+  queue->disableAdaptiveLength();
+  std::this_thread::sleep_for(std::chrono::milliseconds(25));
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(9)), 0);
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(10)), 0);
+  EXPECT_EQ(1u, queue->getMaxLength());
+  EXPECT_EQ(10, queue->pop<TestValue>()->val);
+}
+
+TEST_F(ValueStoreTest, RingBufferQueueBlocking) {
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<mcf::ValueQueue>(1, true, mcf::ValueQueue::Storage::RING_BUFFER);
+
+  valueStore.addReceiver("/test1", queue);
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(1)), 0);
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(2), false), EAGAIN);
+  EXPECT_EQ(1, queue->pop<TestValue>()->val);
+  EXPECT_EQ(valueStore.setValue("/test1", TestValue(2), false), 0);
+  EXPECT_EQ(2, queue->pop<TestValue>()->val);
+}
+
 TEST_F(ValueStoreTest, QueueMulti) {
   mcf::ValueStore valueStore;
   auto queue1 = std::make_shared<mcf::ValueQueue>();
@@ -229,6 +607,368 @@ TEST_F(ValueStoreTest, QueueAutoRemove) {
   EXPECT_EQ(valueStore.setValue("/test1", TestValue(2)), 0);
 }
 
+TEST_F(ValueStoreTest, ReceiverRegistrationWhileWriting) {
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<mcf::ValueQueue>();
+  auto allTopicQueue = std::make_shared<mcf::ValueQueue>();
+  valueStore.addReceiver("/test1", queue);
+  valueStore.addAllTopicReceiver(allTopicQueue);
+
+  const int numValues = 10000;
+  std::thread writer([&valueStore] {
+    for (int i = 0; i < numValues; ++i) {
+      valueStore.setValue("/test1", TestValue(i));
+    }
+  });
+
+  // (un)register receivers concurrently, some of them expiring without being removed
+  for (int i = 0; i < 1000; ++i) {
+    auto tempQueue = std::make_shared<mcf::ValueQueue>();
+    valueStore.addReceiver("/test1", tempQueue);
+    valueStore.addAllTopicReceiver(tempQueue);
+    if (i % 2 == 0) {
+      valueStore.removeReceiver("/test1", tempQueue);
+      valueStore.removeAllTopicReceiver(tempQueue);
+    }
+  }
+  writer.join();
+
+  // receivers registered all the time have seen every value in order
+  EXPECT_EQ(numValues, queue->size());
+  EXPECT_EQ(numValues, allTopicQueue->size());
+  for (int i = 0; i < numValues; ++i) {
+    EXPECT_EQ(i, queue->pop<TestValue>()->val);
+    EXPECT_EQ(i, allTopicQueue->pop<TestValue>()->val);
+  }
+}
+
+TEST_F(ValueStoreTest, FindTypeInfo) {
+  mcf::ValueStore valueStore;
+  EXPECT_EQ(nullptr, valueStore.findTypeInfo(TestValue(1)));
+
+  valueStore.registerType<TestValue>("TestValue");
+  const auto* typeInfo = valueStore.findTypeInfo(TestValue(1));
+  ASSERT_NE(nullptr, typeInfo);
+  EXPECT_EQ("TestValue", typeInfo->id);
+  EXPECT_EQ(typeInfo, valueStore.findTypeInfo("TestValue"));
+  EXPECT_EQ(nullptr, valueStore.findTypeInfo("Unknown"));
+
+  // entries stay at the same address when further types are registered
+  valueStore.registerType<TestValueExtMem>("TestValueExtMem");
+  EXPECT_EQ(typeInfo, valueStore.findTypeInfo(TestValue(1)));
+  EXPECT_EQ("TestValueExtMem", valueStore.findTypeInfo(TestValueExtMem(1))->id);
+
+  // per topic lookup follows type changes on the topic
+  auto handle = valueStore.getTopicHandle("/typed");
+  EXPECT_EQ(typeInfo, valueStore.findTypeInfo(handle, TestValue(1)));
+  EXPECT_EQ(typeInfo, valueStore.findTypeInfo(handle, TestValue(2)));
+  EXPECT_EQ("TestValueExtMem", valueStore.findTypeInfo(handle, TestValueExtMem(1))->id);
+  EXPECT_EQ(nullptr, valueStore.findTypeInfo(handle, mcf::Value()));
+
+  // the allocating interface is still available
+  auto copy = valueStore.getTypeInfo(TestValue(1));
+  ASSERT_NE(nullptr, copy);
+  EXPECT_EQ("TestValue", copy->id);
+}
+
+TEST_F(ValueStoreTest, SharedTypes) {
+  // the message types are registered once and shared by all value stores
+  mcf::ValueStore first;
+  mcf::ValueStore second;
+  const auto* logMessage = first.findTypeInfo("mcf::LogMessage");
+  ASSERT_NE(nullptr, logMessage);
+  EXPECT_EQ(logMessage, second.findTypeInfo("mcf::LogMessage"));
+  EXPECT_EQ(logMessage, mcf::ValueStore::messageTypes().findTypeInfo(logMessage->numericId));
+
+  mcf::TypeRegistry types;
+  types.registerType<TestValue>("TestValue");
+  mcf::ValueStore valueStore(types);
+  const auto* typeInfo = valueStore.findTypeInfo(TestValue(1));
+  EXPECT_EQ(types.findTypeInfo("TestValue"), typeInfo);
+  EXPECT_EQ(logMessage, valueStore.findTypeInfo("mcf::LogMessage"));
+
+  // types registered in a value store and its serialization cache are its own
+  valueStore.registerType<TestValueExtMem>("TestValueExtMem");
+  EXPECT_EQ(nullptr, types.findTypeInfo("TestValueExtMem"));
+  valueStore.enableSerializationCache("TestValue");
+  EXPECT_TRUE(valueStore.findTypeInfo(TestValue(1))->cacheSerialization);
+  EXPECT_FALSE(types.findTypeInfo(TestValue(1))->cacheSerialization);
+
+  // copies take over the types of the bases as well
+  mcf::TypeRegistry copy;
+  copy.registerTypes(valueStore);
+  EXPECT_NE(nullptr, copy.findTypeInfo("TestValue"));
+  EXPECT_NE(nullptr, copy.findTypeInfo("TestValueExtMem"));
+  EXPECT_NE(nullptr, copy.findTypeInfo("mcf::LogMessage"));
+}
+
+TEST_F(ValueStoreTest, ValueMsgpack) {
+  mcf::ValueStore valueStore;
+  valueStore.registerType<TestValue>("TestValue");
+  msgpack::sbuffer buffer;
+
+  // unknown topic and topic without value
+  EXPECT_TRUE(valueStore.getValueMsgpackHandle("/test").get().is_nil());
+  valueStore.getTopicHandle("/test");
+  EXPECT_TRUE(valueStore.getValueMsgpackHandle("/test").get().is_nil());
+  EXPECT_FALSE(valueStore.getValuePacked("/test", buffer));
+  EXPECT_EQ(0, buffer.size());
+
+  EXPECT_EQ(valueStore.setValue("/test", TestValue(42)), 0);
+  auto handle = valueStore.getValueMsgpackHandle("/test");
+  EXPECT_EQ(42, handle.get().as<TestValue>().val);
+  EXPECT_TRUE(valueStore.getValueMsgpack("/unknown").is_nil());
+
+  ASSERT_TRUE(valueStore.getValuePacked("/test", buffer));
+  auto unpacked = msgpack::unpack(buffer.data(), buffer.size());
+  EXPECT_EQ(42, unpacked.get().as<TestValue>().val);
+
+  // unregistered type
+  EXPECT_EQ(valueStore.setValue("/unregistered", TestValueExtMem(1)), 0);
+  EXPECT_FALSE(valueStore.getValuePacked("/unregistered", buffer));
+  EXPECT_EQ("serialization error",
+            valueStore.getValueMsgpackHandle("/unregistered").get().as<std::string>());
+}
+
+namespace {
+
+class CountingValue : public mcf::Value {
+public:
+    CountingValue(int val = 0) : val(val) {}
+    int val;
+    static std::atomic<int> packs;
+
+    template<typename Packer>
+    void msgpack_pack(Packer& pk) const {
+        ++packs;
+        pk.pack_array(1);
+        pk.pack(val);
+    }
+    void msgpack_unpack(const msgpack::object& o) {
+        val = o.via.array.ptr[0].as<int>();
+    }
+};
+
+std::atomic<int> CountingValue::packs{0};
+
+} // anonymous namespace
+
+TEST_F(ValueStoreTest, SerializationCache) {
+  mcf::ValueStore valueStore;
+  valueStore.registerType<CountingValue>("CountingValue");
+  msgpack::sbuffer buffer;
+
+  // without cache each consumer serializes
+  CountingValue::packs = 0;
+  EXPECT_EQ(valueStore.setValue("/test", CountingValue(1)), 0);
+  EXPECT_EQ(1, valueStore.getValueMsgpackHandle("/test").get().as<CountingValue>().val);
+  ASSERT_TRUE(valueStore.getValuePacked("/test", buffer));
+  EXPECT_EQ(2, CountingValue::packs);
+
+  EXPECT_THROW(valueStore.enableSerializationCache("Unknown"), std::runtime_error);
+  valueStore.enableSerializationCache("CountingValue");
+  CountingValue::packs = 0;
+  EXPECT_EQ(valueStore.setValue("/test", CountingValue(2)), 0);
+  EXPECT_EQ(2, valueStore.getValueMsgpackHandle("/test").get().as<CountingValue>().val);
+  buffer.clear();
+  ASSERT_TRUE(valueStore.getValuePacked("/test", buffer));
+  EXPECT_EQ(2, msgpack::unpack(buffer.data(), buffer.size()).get().as<CountingValue>().val);
+  auto value = valueStore.getValue<CountingValue>("/test");
+  const auto* typeInfo = valueStore.findTypeInfo(*value);
+  buffer.clear();
+  const void* ptr = nullptr;
+  size_t len = 0;
+  TypeRegistry::packValue(buffer, value, *typeInfo, ptr, len, true);
+  EXPECT_EQ(nullptr, ptr);
+  EXPECT_EQ(1, CountingValue::packs);
+
+  // a copy is serialized on its own, it may be changed before it is published
+  CountingValue copy(*value);
+  copy.val = 3;
+  EXPECT_EQ(valueStore.setValue("/test", copy), 0);
+  EXPECT_EQ(3, valueStore.getValueMsgpackHandle("/test").get().as<CountingValue>().val);
+  EXPECT_EQ(2, CountingValue::packs);
+}
+
+TEST_F(ValueStoreTest, Codec) {
+  mcf::ValueStore valueStore;
+  valueStore.registerType<TestValue>("TestValue");
+  valueStore.registerType<TestValueExtMem>("TestValueExtMem");
+
+  // packing into a preallocated span gives the same bytes as into a buffer
+  TestValue value(42);
+  const auto* typeInfo = valueStore.findTypeInfo(value);
+  ASSERT_NE(nullptr, typeInfo);
+  ASSERT_NE(nullptr, typeInfo->codec);
+  msgpack::sbuffer buffer;
+  msgpack::packer<msgpack::sbuffer> pk(&buffer);
+  TypeRegistry::pack(pk, value, *typeInfo);
+  const size_t size = TypeRegistry::packedSize(value, *typeInfo);
+  ASSERT_EQ(buffer.size(), size);
+  std::vector<char> span(size);
+  SpanWriter writer(span.data(), span.size());
+  msgpack::packer<SpanWriter> spanPk(&writer);
+  TypeRegistry::pack(spanPk, value, *typeInfo);
+  EXPECT_EQ(size, writer.size());
+  EXPECT_EQ(0, std::memcmp(buffer.data(), span.data(), size));
+
+  SpanWriter small(span.data(), size - 1);
+  msgpack::packer<SpanWriter> smallPk(&small);
+  EXPECT_THROW(TypeRegistry::pack(smallPk, value, *typeInfo), std::runtime_error);
+
+  // ext mem data is handed out and copied back by the codec
+  auto extMemValue = std::make_shared<TestValueExtMem>(7);
+  extMemValue->extMemInit(3);
+  extMemValue->extMemPtr()[2] = 5;
+  const auto* extMemInfo = valueStore.findTypeInfo(*extMemValue);
+  ASSERT_NE(nullptr, extMemInfo);
+  buffer.clear();
+  const void* ptr = nullptr;
+  size_t len = 0;
+  TypeRegistry::packValue(buffer, extMemValue, *extMemInfo, ptr, len, true);
+  EXPECT_EQ(extMemValue->extMemPtr(), ptr);
+  EXPECT_EQ(3u, len);
+
+  auto handle = msgpack::unpack(buffer.data(), buffer.size());
+  msgpack::object obj = handle.get();
+  bool isExtMem = false;
+  std::unique_ptr<Value> unpacked(TypeRegistry::unpackValue(*extMemInfo, obj, ptr, len, isExtMem));
+  EXPECT_TRUE(isExtMem);
+  const auto* copy = dynamic_cast<const TestValueExtMem*>(unpacked.get());
+  ASSERT_NE(nullptr, copy);
+  EXPECT_EQ(7, copy->val);
+  ASSERT_EQ(3u, copy->extMemSize());
+  EXPECT_EQ(5, copy->extMemPtr()[2]);
+}
+
+TEST_F(ValueStoreTest, DurationHistogram) {
+  mcf::ValueStore::DurationHistogram histogram;
+  EXPECT_EQ(0u, histogram.percentile(0.5));
+  for (int i = 0; i < 98; ++i) {
+    histogram.record(100);
+  }
+  histogram.record(0);
+  histogram.record(1000000);
+  // 100ns fall into the bucket [64, 128)
+  EXPECT_EQ(127u, histogram.percentile(0.5));
+  EXPECT_EQ(127u, histogram.percentile(0.99));
+  EXPECT_EQ((1u << 20) - 1, histogram.percentile(1.0));
+  EXPECT_EQ(0u, histogram.percentile(0.0));
+}
+
+TEST_F(ValueStoreTest, Statistics) {
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<mcf::ValueQueue>(1, true);
+  valueStore.addReceiver("/stats/blocked", queue);
+
+  // nothing is collected while disabled
+  EXPECT_FALSE(valueStore.statisticsEnabled());
+  EXPECT_EQ(valueStore.setValue("/stats/plain", TestValue(1)), 0);
+  EXPECT_TRUE(valueStore.getStatistics().empty());
+
+  valueStore.enableStatistics(true);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(valueStore.setValue("/stats/plain", TestValue(i)), 0);
+  }
+  EXPECT_EQ(valueStore.setValue("/stats/blocked", TestValue(1)), 0);
+  std::thread reader([&queue] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue->pop<TestValue>();
+  });
+  EXPECT_EQ(valueStore.setValue("/stats/blocked", TestValue(2)), 0);
+  reader.join();
+
+  auto stats = valueStore.getStatistics();
+  ASSERT_EQ(2u, stats.size());
+  std::sort(stats.begin(), stats.end(),
+            [](const mcf::ValueStore::TopicStatistics& a, const mcf::ValueStore::TopicStatistics& b) {
+              return a.topic < b.topic;
+            });
+  EXPECT_EQ("/stats/blocked", stats[0].topic);
+  EXPECT_EQ(2u, stats[0].writes);
+  EXPECT_EQ(1u, stats[0].receivers);
+  EXPECT_EQ(1u, stats[0].blockedWrites);
+  EXPECT_GE(stats[0].blockedTimeNs, 10000000u);
+  EXPECT_EQ("/stats/plain", stats[1].topic);
+  EXPECT_EQ(10u, stats[1].writes);
+  EXPECT_EQ(0u, stats[1].receivers);
+  EXPECT_EQ(0u, stats[1].blockedWrites);
+  EXPECT_LE(stats[1].lockWaitP50Ns, stats[1].lockWaitP99Ns);
+  EXPECT_LE(stats[1].fanOutP50Ns, stats[1].fanOutP99Ns);
+}
+
+TEST_F(ValueStoreTest, StatisticsPublisher) {
+  mcf::ValueStore valueStore;
+  mcf::ComponentManager manager(valueStore);
+  auto publisher = std::make_shared<mcf::ValueStoreStatsPublisher>(
+      valueStore, std::chrono::milliseconds(20));
+  manager.registerComponent(publisher);
+  manager.configure();
+  manager.startup();
+  EXPECT_TRUE(valueStore.statisticsEnabled());
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(valueStore.setValue("/stats/topic", TestValue(i)), 0);
+  }
+  std::shared_ptr<const mcf::msg::ValueStoreStats> stats;
+  for (int i = 0; i < 100; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (valueStore.hasValue(mcf::ValueStoreStatsPublisher::DEFAULT_TOPIC)) {
+      stats = valueStore.getValue<mcf::msg::ValueStoreStats>(mcf::ValueStoreStatsPublisher::DEFAULT_TOPIC);
+      auto it = std::find_if(stats->topics.begin(), stats->topics.end(),
+                             [](const mcf::msg::ValueStoreTopicStats& e) { return e.topic == "/stats/topic"; });
+      if (it != stats->topics.end()) {
+        EXPECT_EQ(10u, it->writes);
+        break;
+      }
+    }
+    stats.reset();
+  }
+  EXPECT_NE(nullptr, stats);
+
+  manager.shutdown();
+  EXPECT_FALSE(valueStore.statisticsEnabled());
+}
+
+TEST_F(ValueStoreTest, PatternMatching) {
+  EXPECT_TRUE(mcf::ValueStore::matchesPattern("/sensors/*", "/sensors/camera/front"));
+  EXPECT_TRUE(mcf::ValueStore::matchesPattern("/sensors/*", "/sensors/"));
+  EXPECT_FALSE(mcf::ValueStore::matchesPattern("/sensors/*", "/sensors"));
+  EXPECT_TRUE(mcf::ValueStore::matchesPattern("/*/front", "/camera/front"));
+  EXPECT_TRUE(mcf::ValueStore::matchesPattern("/cam?", "/cam1"));
+  EXPECT_FALSE(mcf::ValueStore::matchesPattern("/cam?", "/cam"));
+  EXPECT_TRUE(mcf::ValueStore::matchesPattern("*", ""));
+  EXPECT_TRUE(mcf::ValueStore::matchesPattern("/a*b*c", "/aXXbYYbc"));
+  EXPECT_FALSE(mcf::ValueStore::matchesPattern("/a*b*c", "/aXXbYYbd"));
+  EXPECT_TRUE(mcf::ValueStore::matchesPattern("/exact", "/exact"));
+  EXPECT_FALSE(mcf::ValueStore::matchesPattern("/exact", "/exact/more"));
+}
+
+TEST_F(ValueStoreTest, PatternReceiver) {
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<mcf::ValueQueue>();
+
+  // topic existing before the receiver is added
+  EXPECT_EQ(valueStore.setValue("/sensors/lidar", TestValue(1)), 0);
+  valueStore.addPatternReceiver("/sensors/*", queue, {"/sensors/debug/*"});
+
+  EXPECT_EQ(valueStore.setValue("/sensors/lidar", TestValue(2)), 0);
+  EXPECT_EQ(valueStore.setValue("/sensors/camera", TestValue(3)), 0);  // new topic
+  EXPECT_EQ(valueStore.setValue("/sensors/debug/camera", TestValue(4)), 0);  // excluded
+  EXPECT_EQ(valueStore.setValue("/actuators/brake", TestValue(5)), 0);  // no match
+
+  ASSERT_EQ(2, queue->size());
+  auto entry = queue->popWithTopic<TestValue>();
+  EXPECT_EQ(2, std::get<0>(entry)->val);
+  EXPECT_EQ("/sensors/lidar", std::get<1>(entry));
+  EXPECT_EQ(3, queue->pop<TestValue>()->val);
+
+  valueStore.removePatternReceiver(queue);
+  EXPECT_EQ(valueStore.setValue("/sensors/lidar", TestValue(6)), 0);
+  EXPECT_EQ(valueStore.setValue("/sensors/radar", TestValue(7)), 0);
+  EXPECT_TRUE(queue->empty());
+}
+
 TEST_F(ValueStoreTest, QueuePopWithTopic) {
   mcf::ValueStore valueStore;
   auto queue = std::make_shared<mcf::ValueQueue>();
@@ -354,5 +1094,291 @@ TEST_F(ValueStoreTest, BlockingReceiverMulti) {
   EXPECT_TRUE(queue2->empty());
   EXPECT_TRUE(queue3->empty());
 }
+
+TEST_F(ValueStoreTest, BlockingReceiverTimeout) {
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<mcf::ValueQueue>(1, true);
+  auto handle = valueStore.getTopicHandle("/test1");
+  valueStore.addReceiver("/test1", queue);
+  EXPECT_EQ(valueStore.setValue(handle, std::make_shared<const TestValue>(1)), 0);
+
+  auto startTime = std::chrono::steady_clock::now();
+  EXPECT_EQ(ETIMEDOUT, valueStore.setValue(handle, std::make_shared<const TestValue>(2),
+                                           std::chrono::milliseconds(50)));
+  auto elapsed = std::chrono::steady_clock::now() - startTime;
+  EXPECT_GE(elapsed, std::chrono::milliseconds(50));
+  EXPECT_LT(elapsed, std::chrono::milliseconds(50) + mcf::ValueQueue::ABORT_POLL_INTERVAL);
+
+  // the value is written, if the receiver unblocks before the timeout expires
+  std::thread thread(blockingReceiverDelayedPop, queue, std::chrono::milliseconds(20));
+  EXPECT_EQ(0, valueStore.setValue(handle, std::make_shared<const TestValue>(3),
+                                   std::chrono::milliseconds(2000)));
+  thread.join();
+  EXPECT_EQ(3, queue->pop<TestValue>()->val);
+}
+
+TEST_F(ValueStoreTest, BlockingReceiverWakeup) {
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<mcf::ValueQueue>(1, true);
+  auto handle = valueStore.getTopicHandle("/test1");
+  valueStore.addReceiver("/test1", queue);
+  EXPECT_EQ(valueStore.setValue(handle, std::make_shared<const TestValue>(1)), 0);
+
+  // a changed abort condition is noticed as soon as the writers are woken
+  std::atomic<bool> abort(false);
+  std::thread thread([&valueStore, &handle, &abort] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    abort = true;
+    valueStore.wakeBlockedWriters(handle);
+  });
+  auto startTime = std::chrono::steady_clock::now();
+  EXPECT_EQ(ECANCELED, valueStore.setValue(handle, std::make_shared<const TestValue>(2), true,
+                                           [&abort] { return abort.load(); }));
+  EXPECT_LT(std::chrono::steady_clock::now() - startTime, mcf::ValueQueue::ABORT_POLL_INTERVAL);
+  thread.join();
+  EXPECT_EQ(1, queue->pop<TestValue>()->val);
+}
+
+TEST_F(ValueStoreTest, WaitUnblocked) {
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<mcf::ValueQueue>(1, true);
+  auto handle = valueStore.getTopicHandle("/test1");
+  valueStore.addReceiver("/test1", queue);
+  EXPECT_TRUE(valueStore.waitUnblocked(handle, [] { return false; }));
+  EXPECT_EQ(valueStore.setValue(handle, std::make_shared<const TestValue>(1)), 0);
+
+  EXPECT_FALSE(valueStore.waitUnblocked(handle, [] { return false; },
+                                        std::chrono::steady_clock::now() + std::chrono::milliseconds(20)));
+
+  // the wait ends as soon as the receiver pops, without writing a value
+  std::thread thread(blockingReceiverDelayedPop, queue, std::chrono::milliseconds(20));
+  auto startTime = std::chrono::steady_clock::now();
+  EXPECT_TRUE(valueStore.waitUnblocked(handle, [] { return false; }));
+  EXPECT_LT(std::chrono::steady_clock::now() - startTime, mcf::ValueQueue::ABORT_POLL_INTERVAL);
+  thread.join();
+  EXPECT_TRUE(queue->empty());
+}
+
+TEST_F(ValueStoreTest, TracePolicy) {
+  ValueStore valueStore;
+  const std::string traceTopic = ComponentTraceController::DEFAULT_TRACE_EVENTS_TOPIC;
+  const bool compiled = TracePolicy::COMPILED;
+  auto controller = std::make_unique<ComponentTraceController>("test", valueStore);
+  std::shared_ptr<ComponentTraceEventGenerator> generator = controller->createEventGenerator("test");
+  ComponentTraceController::setLocalEventGenerator(generator);
+
+  // tracing off: no trace events and the hooks are skipped
+  EXPECT_FALSE(TracePolicy::active());
+  valueStore.setValue("/topic", TestValue(1));
+  EXPECT_EQ(1, valueStore.getValue<TestValue>("/topic")->val);
+  EXPECT_FALSE(valueStore.hasValue(traceTopic));
+
+  controller->enableTrace(true);
+  controller->enableTrace(true);
+  EXPECT_EQ(compiled, TracePolicy::active());
+  valueStore.setValue("/topic", TestValue(2));
+  // trace events are published by the trace collector
+  controller->flush();
+  EXPECT_EQ(compiled, valueStore.hasValue(traceTopic));
+
+  controller->enableTrace(false);
+  EXPECT_FALSE(TracePolicy::active());
+
+  // destroying an enabled controller releases its share of the runtime switch
+  controller->enableTrace(true);
+  ComponentTraceController::setLocalEventGenerator(nullptr);
+  generator.reset();
+  controller.reset();
+  EXPECT_FALSE(TracePolicy::active());
+}
+
+TEST_F(ValueStoreTest, ConflatingQueue) {
+  ValueStore valueStore;
+  auto queue = std::make_shared<ValueQueue>([](const Value& value) -> uint64_t {
+      return dynamic_cast<const TestValue&>(value).val / 10;
+  });
+  EXPECT_EQ(ValueQueue::Storage::CONFLATING, queue->getStorage());
+  valueStore.addReceiver("/tracks", queue);
+
+  // newest value per key replaces the queued one in place
+  valueStore.setValue("/tracks", TestValue(10));
+  valueStore.setValue("/tracks", TestValue(20));
+  valueStore.setValue("/tracks", TestValue(11));
+  valueStore.setValue("/tracks", TestValue(12));
+  EXPECT_EQ(2u, queue->size());
+  EXPECT_EQ(12, queue->pop<TestValue>()->val);
+  valueStore.setValue("/tracks", TestValue(13));
+  EXPECT_EQ(20, queue->pop<TestValue>()->val);
+  auto entry = queue->popWithTopic<TestValue>();
+  EXPECT_EQ(13, std::get<0>(entry)->val);
+  EXPECT_EQ("/tracks", std::get<1>(entry));
+  EXPECT_TRUE(queue->empty());
+
+  // maxLength limits the number of keys, the oldest key is dropped
+  queue->setMaxLength(2);
+  for (int i = 0; i < 3; ++i) {
+      valueStore.setValue("/tracks", TestValue(10 * i));
+      valueStore.setValue("/tracks", TestValue(10 * i + 1));
+  }
+  EXPECT_EQ(2u, queue->size());
+  EXPECT_EQ(11, queue->pop<TestValue>()->val);
+  EXPECT_EQ(21, queue->pop<TestValue>()->val);
+  EXPECT_THROW(queue->pop<TestValue>(), QueueEmptyException);
+}
+
+TEST_F(ValueStoreTest, LazyValue) {
+  class LazyTestValue : public LazyValue {
+  public:
+      explicit LazyTestValue(int val) : val(val) {}
+      int val;
+      mutable int decodeCount = 0;
+  protected:
+      ValuePtr decode() const override {
+          ++decodeCount;
+          return std::make_shared<const TestValue>(val);
+      }
+  };
+
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<ValueQueue>();
+  valueStore.addReceiver("/lazy", queue);
+  auto lazy = std::make_shared<const LazyTestValue>(5);
+  valueStore.setValue("/lazy", ValuePtr(lazy));
+
+  // reads as Value get the lazy value, without decoding it
+  EXPECT_EQ(lazy, valueStore.getValue<Value>("/lazy"));
+  EXPECT_EQ(0, lazy->decodeCount);
+
+  // typed reads decode it once
+  EXPECT_EQ(5, valueStore.getValue<TestValue>("/lazy")->val);
+  EXPECT_EQ(5, queue->pop<TestValue>()->val);
+  EXPECT_EQ(valueStore.getValue<TestValue>("/lazy"), decodedValue(lazy));
+  EXPECT_EQ(1, lazy->decodeCount);
+}
+
+TEST_F(ValueStoreTest, TypedReads) {
+  class DerivedValue : public TestValue {
+  public:
+    DerivedValue(int val=0) : TestValue(val) {}
+  };
+
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<ValueQueue>();
+  valueStore.addReceiver("/typed", queue);
+  auto value = std::make_shared<const TestValue>(3);
+  valueStore.setValue("/typed", ValuePtr(value));
+  valueStore.setValue("/typed", DerivedValue(4));
+
+  EXPECT_EQ(value, queue->pop<TestValue>());
+  EXPECT_EQ(4, queue->peek<TestValue>()->val);
+  EXPECT_NE(nullptr, queue->pop<DerivedValue>());
+  EXPECT_EQ(4, valueStore.getValue<TestValue>("/typed")->val);
+  EXPECT_EQ(nullptr, castValue<DerivedValue>(value));
+
+  // reads without a value share one default instance
+  auto missing = valueStore.getValue<TestValue>("/missing");
+  EXPECT_EQ(0, missing->val);
+  EXPECT_EQ(missing, valueStore.getValue<TestValue>("/missing"));
+  EXPECT_EQ(missing, valueStore.getValue<TestValue>(ValueStore::TopicHandle()));
+}
+
+TEST_F(ValueStoreTest, Retention) {
+  mcf::ValueStore valueStore;
+  auto queue = std::make_shared<ValueQueue>();
+  valueStore.addReceiver("/frames", queue);
+
+  // a value held when the retention is changed is released at once
+  valueStore.setValue("/frames", TestValueExtMem(1));
+  valueStore.setRetention("/frames", ValueStore::Retention::NEVER);
+  EXPECT_FALSE(valueStore.hasValue("/frames"));
+
+  // without retention, the receivers hold the only reference
+  std::weak_ptr<const TestValueExtMem> frame = queue->pop<TestValueExtMem>();
+  valueStore.setValue("/frames", TestValueExtMem(2));
+  EXPECT_FALSE(valueStore.hasValue("/frames"));
+  EXPECT_EQ(0, valueStore.getValue<TestValueExtMem>("/frames")->val);
+  frame = queue->pop<TestValueExtMem>();
+  EXPECT_TRUE(frame.expired());
+
+  valueStore.setRetention("/frames", ValueStore::Retention::TIMED, std::chrono::milliseconds(20));
+  valueStore.setValue("/frames", TestValueExtMem(3));
+  EXPECT_EQ(3, valueStore.getValue<TestValueExtMem>("/frames")->val);
+  frame = queue->pop<TestValueExtMem>();
+  for (int i = 0; i < 100 && !frame.expired(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_TRUE(frame.expired());
+  EXPECT_FALSE(valueStore.hasValue("/frames"));
+
+  // a later value is kept again
+  valueStore.setValue("/frames", TestValueExtMem(4));
+  EXPECT_TRUE(valueStore.hasValue("/frames"));
+
+  valueStore.setRetention("/frames", ValueStore::Retention::ALWAYS);
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  EXPECT_EQ(4, valueStore.getValue<TestValueExtMem>("/frames")->val);
+}
+
+TEST_F(ValueStoreTest, SequenceGaps) {
+  mcf::ValueStore valueStore;
+  auto dropping = std::make_shared<ValueQueue>(2);
+  valueStore.addReceiver("/seq", dropping);
+  for (int i = 0; i < 5; ++i) {
+    valueStore.setValue("/seq", TestValue(i));
+  }
+  // the queue dropped the oldest values itself, none went missing before reaching it
+  EXPECT_EQ(3u, dropping->getDropped());
+  EXPECT_EQ(0u, dropping->getGaps());
+  EXPECT_EQ(4u, dropping->peekSequence());
+
+  // one value forwarded to two topics gets the numbers of each topic
+  auto first = std::make_shared<ValueQueue>();
+  auto second = std::make_shared<ValueQueue>();
+  valueStore.addReceiver("/first", first);
+  valueStore.addReceiver("/second", second);
+  const ValuePtr value = std::make_shared<const TestValue>(5);
+  valueStore.setValue("/first", value);
+  valueStore.setValue("/second", TestValue(6));
+  valueStore.setValue("/second", value);
+  valueStore.setValue("/first", value);
+  auto popSequences = [](ValueQueue& queue) {
+    std::vector<uint64_t> sequences;
+    while (!queue.empty()) {
+      sequences.push_back(queue.peekSequence());
+      queue.pop<TestValue>();
+    }
+    return sequences;
+  };
+  EXPECT_EQ((std::vector<uint64_t>{1, 2}), popSequences(*first));
+  EXPECT_EQ((std::vector<uint64_t>{1, 2}), popSequences(*second));
+  EXPECT_EQ(0u, first->peekSequence());
+
+  // a batch numbers each of its writes
+  const auto handle = valueStore.getTopicHandle("/first");
+  valueStore.setValues({{handle, value}, {handle, value}});
+  EXPECT_EQ((std::vector<uint64_t>{3, 4}), popSequences(*first));
+  EXPECT_EQ(0u, first->getGaps());
+  EXPECT_EQ(0u, second->getGaps());
+
+  // injected values advance the numbers by the gaps of their origin, origins are told apart
+  auto injected = std::make_shared<ValueQueue>();
+  valueStore.addReceiver("/injected", injected);
+  const int linkA = 0;
+  const int linkB = 0;
+  valueStore.injectValue("/injected", value, ValueOrigin{&linkA, 10});
+  valueStore.injectValue("/injected", value, ValueOrigin{&linkB, 100});
+  valueStore.injectValue("/injected", value, ValueOrigin{&linkA, 13});
+  valueStore.setValue("/injected", value);
+  valueStore.injectValue("/injected", value, ValueOrigin{&linkB, 101});
+  EXPECT_EQ(2u, injected->getGaps());
+
+  // a restarted origin and unknown origin numbers count no gaps
+  valueStore.injectValue("/injected", value, ValueOrigin{&linkA, 1});
+  valueStore.injectValue("/injected", value, ValueOrigin{&linkA, 0});
+  valueStore.injectValue("/injected", value, ValueOrigin{&linkA, 2});
+  EXPECT_EQ(2u, injected->getGaps());
+  EXPECT_EQ((std::vector<uint64_t>{1, 2, 5, 6, 7, 8, 9, 10}), popSequences(*injected));
+  EXPECT_EQ(0u, injected->getDropped());
+}
 }
 
@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_CUDA_CUDAALLOCATORSTATSPUBLISHER_H
+#define MCF_CUDA_CUDAALLOCATORSTATSPUBLISHER_H
+
+#if HAVE_CUDA
+#include "mcf_core/Mcf.h"
+
+#include <chrono>
+#include <vector>
+
+namespace mcf
+{
+namespace msg
+{
+/**
+ * Usage of the CUDA device memory allocator on one device, see mcf::cuda::GpuAllocatorStatistics
+ */
+class CudaAllocatorStatsEntry {
+public:
+    int device;
+    uint64_t cachedBytes;
+    uint64_t liveBytes;
+    uint64_t hits;
+    uint64_t misses;
+    MSGPACK_DEFINE(device, cachedBytes, liveBytes, hits, misses)
+};
+
+/**
+ * CUDA device memory allocator usage, published by CudaAllocatorStatsPublisher
+ */
+class CudaAllocatorStats : public Value {
+public:
+    std::vector<CudaAllocatorStatsEntry> devices;
+    MSGPACK_DEFINE(devices)
+};
+} // namespace msg
+
+/**
+ * Component periodically publishing the usage of mcf::cuda::gpuAllocator
+ *
+ * Publishes a msg::CudaAllocatorStats value on DEFAULT_TOPIC (or the topic the port is mapped to),
+ * with an entry per device which has been allocated on.
+ */
+class CudaAllocatorStatsPublisher : public Component {
+
+public:
+    static constexpr const char* DEFAULT_TOPIC = "/mcf/cuda/allocator/stats";
+
+    /**
+     * Constructor
+     *
+     * @param interval     Time between two statistics messages
+     */
+    explicit CudaAllocatorStatsPublisher(std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+
+    void configure(IComponentConfig& config) override;
+
+private:
+    void publish();
+
+    SenderPort<msg::CudaAllocatorStats> fStatsPort;
+};
+
+} // namespace mcf
+#endif
+
+#endif // MCF_CUDA_CUDAALLOCATORSTATSPUBLISHER_H
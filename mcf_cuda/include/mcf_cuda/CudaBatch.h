@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_CUDA_CUDABATCH_H
+#define MCF_CUDA_CUDABATCH_H
+
+#if HAVE_CUDA
+#include "mcf_core/BatchingReceiverPort.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_cuda/CudaErrorHelper.h"
+#include "mcf_cuda/CudaExtMemValue.h"
+#include "mcf_cuda/GenArray.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace mcf
+{
+
+namespace detail
+{
+
+// the element type of the ext mem of a value type, only used in unevaluated context
+template<typename T>
+T cudaExtMemElement(const CudaExtMemValue<T>*);
+
+template<typename V>
+using CudaExtMemElement = decltype(cudaExtMemElement(std::declval<const V*>()));
+
+} // namespace detail
+
+/**
+ * Gather the ext mem of the values of a batch into one contiguous array on a device, in the
+ * order of the batch, see BatchingReceiverPort
+ *
+ * The copies are enqueued on the stream without waiting for them, values not yet held on the
+ * device are uploaded on the stream first. Work enqueued on the stream afterwards sees the
+ * gathered batch.
+ *
+ * @param batch       the batch, must not be empty
+ * @param cudaDevice  the cuda device to gather on, or -1 for the cpu
+ * @param stream      the stream to copy in, e.g. CudaComponent::stream()
+ */
+template<typename V>
+gen_array<detail::CudaExtMemElement<V>> gatherBatch(const std::vector<BatchEntry<V>>& batch, int cudaDevice,
+                                                   cudaStream_t stream)
+{
+    using T = detail::CudaExtMemElement<V>;
+    MCF_ASSERT(!batch.empty(), "Cannot gather an empty batch");
+    uint64_t bytes = 0;
+    for (const auto& entry : batch)
+    {
+        bytes += entry.value->extMemSize();
+    }
+    MCF_ASSERT(bytes % sizeof(T) == 0, "Ext mem of batched values is not a multiple of its element size");
+
+    gen_array<T> gathered;
+    T* target = gathered.init(deviceIdFromCuda(cudaDevice), bytes / sizeof(T));
+    for (const auto& entry : batch)
+    {
+        const uint64_t size = entry.value->extMemSize();
+        const T* source = static_cast<const T*>(entry.value->extMemPtr(cudaDevice, stream));
+        MCF_CHECK_CUDA(cudaMemcpyAsync(target, source, size, cudaMemcpyDefault, stream));
+        target += size / sizeof(T);
+    }
+    return gathered;
+}
+
+/**
+ * Split the batched result of an inference into one value per entry of its batch, as views onto
+ * equally sized parts of its ext mem, without copying, see CudaExtMemValue::extMemInitView()
+ *
+ * The values are in the order of the batch, so that value i is sent to the sender port belonging
+ * to the input of entry i. Further attributes of the values are left to the caller.
+ *
+ * @param result  the batched result, its ext mem holding count parts of the same size
+ * @param count   the number of entries of the batch
+ */
+template<typename R>
+std::vector<std::shared_ptr<R>> scatterBatch(const std::shared_ptr<const R>& result, size_t count)
+{
+    MCF_ASSERT(count > 0 && result->extMemSize() % count == 0,
+               "Batched result cannot be split into equally sized parts");
+    const uint64_t part = result->extMemSize() / count;
+    std::vector<std::shared_ptr<R>> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto value = std::make_shared<R>();
+        if (!value->extMemInitView(result, i * part, part))
+        {
+            MCF_THROW_RUNTIME("Parts of a batched result are not aligned to their element size");
+        }
+        values.push_back(std::move(value));
+    }
+    return values;
+}
+
+} // namespace mcf
+#endif
+
+#endif // MCF_CUDA_CUDABATCH_H
@@ -9,14 +9,172 @@
 #include "cuda_runtime.h"
 #include "cub/util_allocator.cuh"
 
+#include "json/forwards.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 namespace mcf
 {
 namespace cuda
 {
+/**
+ * Bin settings of the device memory allocator, see cub::CachingDeviceAllocator
+ *
+ * Blocks are rounded up to a power of binGrowth between binGrowth^minBin and binGrowth^maxBin
+ * bytes and cached for reuse. Larger blocks are allocated with their exact size and not cached,
+ * so maxBin should cover the largest buffers of the application, e.g. camera frames.
+ */
+struct GpuAllocatorConfig
+{
+    unsigned int binGrowth = 4u;
+    unsigned int minBin = 4u;
+    unsigned int maxBin = 12u;
+    /// limit of the cached bytes, per device
+    size_t maxCachedBytes = 1073741824u;
+};
+
+/**
+ * Usage of the device memory allocator on one device
+ */
+struct GpuAllocatorStatistics
+{
+    int device = 0;
+    size_t cachedBytes = 0;     ///< bytes of the blocks kept for reuse
+    size_t liveBytes = 0;       ///< bytes of the blocks in use
+    uint64_t hits = 0;          ///< allocations served from cached blocks
+    uint64_t misses = 0;        ///< allocations which had to call cudaMalloc
+};
+
+/**
+ * Caching allocator for device memory, a cub::CachingDeviceAllocator which can be
+ * reconfigured and counts its cache hits
+ *
+ * Allocations and frees are serialized to count the hits. This costs little, since the
+ * cudaMalloc and cudaFree calls of misses synchronize the device anyway.
+ */
+class GpuAllocator : public cub::CachingDeviceAllocator
+{
+public:
+    explicit GpuAllocator(const GpuAllocatorConfig& config);
+
+    /**
+     * Change the bin settings, frees all cached blocks
+     *
+     * Should be called before the first allocation: blocks in use are cached under the old
+     * bins when they are freed and are only released by FreeAllCached().
+     */
+    void configure(const GpuAllocatorConfig& config);
+
+    GpuAllocatorConfig config();
+
+    /**
+     * Usage per device which has been allocated on
+     */
+    std::vector<GpuAllocatorStatistics> statistics();
+
+    cudaError_t DeviceAllocate(int device, void** d_ptr, size_t bytes, cudaStream_t active_stream = 0);
+    cudaError_t DeviceAllocate(void** d_ptr, size_t bytes, cudaStream_t active_stream = 0);
+    cudaError_t DeviceFree(int device, void* d_ptr);
+    cudaError_t DeviceFree(void* d_ptr);
+
+private:
+    struct Counters
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    // bytes cached for the device
+    size_t cachedBytes(int device);
+
+    std::mutex fStatsMutex;
+    std::map<int, Counters> fCounters;
+};
+
 /**
  * Declaration of caching allocator for device memory
  */
-extern cub::CachingDeviceAllocator gpuAllocator;
+extern GpuAllocator gpuAllocator;
+
+/**
+ * Read the optional "CudaAllocator" settings from a "SystemConfiguration" node, defaults if
+ * they are absent
+ *
+ * "CudaAllocator": {
+ *     "binGrowth": 2,
+ *     "minBin": 8,
+ *     "maxBin": 26,
+ *     "maxCachedBytesPerDevice": 536870912
+ * }
+ *
+ * Throws mcf::SystemConfigurationError for invalid settings. The result is applied with
+ * gpuAllocator.configure().
+ */
+GpuAllocatorConfig readGpuAllocatorConfiguration(const Json::Value& node);
+
+/**
+ * Caching allocator for pinned (page-locked) host memory, the host counterpart of gpuAllocator
+ *
+ * Copies between pinned host memory and device memory are done by DMA at full bandwidth,
+ * while pageable memory is copied through a staging buffer. Since allocating pinned memory
+ * is expensive, freed blocks are cached for reuse in the size classes of mcf::ExtMemPool,
+ * up to the given number of bytes.
+ */
+class CachingHostAllocator
+{
+public:
+    explicit CachingHostAllocator(size_t maxCachedBytes);
+
+    /**
+     * Frees all cached blocks, blocks still in use are leaked
+     */
+    ~CachingHostAllocator();
+
+    CachingHostAllocator(const CachingHostAllocator&) = delete;
+    CachingHostAllocator& operator=(const CachingHostAllocator&) = delete;
+
+    /**
+     * Provide a block of at least bytes pinned host memory, reusing a cached one if possible
+     */
+    cudaError_t HostAllocate(void** ptr, size_t bytes);
+
+    /**
+     * Return a block provided by HostAllocate(), it is cached unless the cache is full
+     */
+    cudaError_t HostFree(void* ptr);
+
+    /**
+     * Free all cached blocks
+     */
+    cudaError_t FreeAllCached();
+
+    /**
+     * Change the limit of cached bytes, blocks freed afterwards are cached up to the new limit
+     */
+    void SetMaxCachedBytes(size_t maxCachedBytes);
+
+private:
+    // called with fMutex held
+    cudaError_t FreeAllCachedLocked();
+
+    std::mutex fMutex;
+    size_t fMaxCachedBytes;
+    size_t fCachedBytes = 0;
+    // cached blocks by capacity
+    std::map<size_t, std::vector<void*>> fFree;
+    // capacity of the blocks in use
+    std::unordered_map<void*, size_t> fLive;
+};
+
+/**
+ * Declaration of caching allocator for pinned host memory, see gen_array_base::setHostMemory()
+ */
+extern CachingHostAllocator hostAllocator;
 } // namespace cuda
 } // namespace mcf
 #endif
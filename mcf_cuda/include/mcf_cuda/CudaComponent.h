@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_CUDA_CUDACOMPONENT_H
+#define MCF_CUDA_CUDACOMPONENT_H
+
+#if HAVE_CUDA
+#include "cuda_runtime.h"
+#include "mcf_core/Mcf.h"
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace mcf
+{
+
+/**
+ * Base class for components running GPU work
+ *
+ * Each component enqueues its work on a stream of its own, so that kernels of independent
+ * components overlap on the device instead of serializing on the default stream. The stream
+ * is non-blocking, i.e. it does not synchronize with the legacy default stream, and its
+ * priority follows the real-time priority of the component thread.
+ *
+ * Optionally, the steady-state kernel sequence of a handler can be captured into a CUDA graph
+ * and replayed without the launch overhead of the individual kernels, see launchGraph().
+ */
+class CudaComponent : public Component {
+
+public:
+    /// calls of launchGraph() before the sequence is captured, to let allocators warm up
+    static constexpr unsigned int GRAPH_WARMUP_RUNS = 2;
+
+    CudaComponent(const std::string& name, int priority = 1);
+
+    /**
+     * Destroys the stream and the graphs, after waiting for the enqueued work
+     */
+    ~CudaComponent() override;
+
+protected:
+    /**
+     * The stream of the component, created on the current CUDA device on first use
+     *
+     * The stream priority is taken from the scheduling parameters at that time: real-time
+     * policies map their priority linearly onto the stream priority range of the device, the
+     * deadline policy gets the greatest stream priority and other policies the least one.
+     */
+    cudaStream_t stream();
+
+    /**
+     * Enable capturing kernel sequences into CUDA graphs, see launchGraph()
+     */
+    void setGraphCapture(bool enabled);
+
+    /**
+     * Enqueue the kernel sequence of a handler on the component stream
+     *
+     * Without graph capture, enqueue is simply called with the stream. With graph capture, the
+     * sequence enqueued by the call after GRAPH_WARMUP_RUNS calls is captured into a graph
+     * (named by name), which is launched instead of calling enqueue from then on.
+     *
+     * The captured sequence must be the same in each call, including its kernel arguments and
+     * buffers, and must not allocate device memory or synchronize. If it changes, e.g. since
+     * the buffers were reallocated, resetGraph() forces a new capture.
+     */
+    void launchGraph(const std::string& name, const std::function<void(cudaStream_t)>& enqueue);
+
+    /**
+     * Discard the graph captured for name, the next calls of launchGraph() warm up and capture
+     * again
+     */
+    void resetGraph(const std::string& name);
+
+private:
+    struct Graph {
+        unsigned int runs = 0;
+        cudaGraphExec_t exec = nullptr;
+    };
+
+    static void destroy(Graph& graph);
+
+    std::mutex fMutex;
+    cudaStream_t fStream = nullptr;
+    bool fGraphCapture = false;
+    std::map<std::string, Graph> fGraphs;
+};
+
+} // namespace mcf
+#endif
+
+#endif // MCF_CUDA_CUDACOMPONENT_H
@@ -9,6 +9,9 @@
 #include <array>
 
 // forward declarations
+// same as in driver_types.h, which is not included to keep CUDA headers out of this header
+typedef struct CUstream_st* cudaStream_t;
+
 namespace mcf { namespace cuda {
 template<typename T>
 class unique_array;
@@ -115,6 +118,33 @@ public:
      */
     void extMemInit(const void *src, uint64_t len, int dstDevice=-1, int srcDevice=-1);
 
+    /**
+     * initialize ext mem value as a view onto len bytes of the ext mem of parent from offset on,
+     * without copying, e.g. to split a batched tensor into per-camera values
+     *
+     * the view refers to the memory of the parent on a cuda device holding it, or on the cpu
+     * otherwise, and keeps that memory alive. it must not be written through the view.
+     *
+     * returns false if the region is not aligned for T, throws if it exceeds the parent
+     *
+     * shall not be called after sharing on value store (no thread protection)
+     */
+    bool extMemInitView(std::shared_ptr<const CudaExtMemValue<T>> parent, uint64_t offset, uint64_t len);
+
+    /**
+     * initialize ext mem value as a view onto rows of rowLen bytes, which are stride bytes apart
+     * in the ext mem of parent, starting at offset, e.g. a region of interest of an image
+     *
+     * unlike contiguous views, the rows are gathered into memory of the view on the device
+     * holding the parent (with a single cudaMemcpy2D), since kernels expect packed data
+     *
+     * returns false if the region is not aligned for T, throws if it exceeds the parent
+     *
+     * shall not be called after sharing on value store (no thread protection)
+     */
+    bool extMemInitView(std::shared_ptr<const CudaExtMemValue<T>> parent, uint64_t offset, uint64_t rowLen,
+                        uint64_t stride, uint64_t rows);
+
     /**
      * query size of the ext mem value in bytes
      */
@@ -169,23 +199,89 @@ public:
      * the receiver of the ext mem value may access memory for a different device
      * and at that point, the content will be copied automatically.
      *
+     * The copies are shared by all consumers of the value, so a copy for the cpu is only made
+     * once, by the first consumer reading the value on the cpu, and not at all if no consumer
+     * does. Producers should therefore not copy to the cpu in advance.
+     *
+     * The non-const version is for writing: it drops the copies on all other devices, which are
+     * created again from the written one when they are accessed.
+     *
      * It is an error to call this on an uninitialized ext mem value.
      */
     const Ptr extMemPtr(int device) const;
     Ptr extMemPtr(int device);
 
+    /**
+     * check if the ext mem is held on the given cuda device id or cpu (-1), without copying it
+     */
+    bool extMemHasCopy(int device) const;
+
+    /**
+     * Get ext mem pointer for given cuda device id or cpu (-1), for use in the given stream.
+     *
+     * Like extMemPtr(int), but the copy from another device is enqueued on the stream
+     * instead of blocking the calling thread, see gen_array::get(Device, cudaStream_t).
+     */
+    const Ptr extMemPtr(int device, cudaStream_t stream) const;
+
+    /**
+     * Start copying the ext mem to the given cuda device id or cpu (-1) on the stream,
+     * e.g. to upload the next frame while the current one is processed.
+     */
+    void extMemPrefetch(int device, cudaStream_t stream) const;
+
     /**
      * check if ext mem is initialized
      */
     bool extMemInitialized() const;
 
+    /**
+     * Export the ext mem as CUDA IPC handle, if it is held on a cuda device. The memory stays
+     * valid until the importing process released it, see mcf::cuda::exportDeviceMemory().
+     *
+     * @return false if the ext mem is not held on a cuda device or cannot be exported
+     */
+    bool extMemExport(std::string& handle) const override;
+
+    /**
+     * Withdraw an export which will not be imported, see mcf::cuda::withdrawDeviceMemory()
+     */
+    void extMemWithdraw(const std::string& handle) const override;
+
+    /**
+     * Refer to ext mem exported by extMemExport() in another process, without copying it.
+     *
+     * re-initialization discards previous contents
+     *
+     * shall not be called after sharing on value store (no thread protection)
+     */
+    bool extMemImport(const std::string& handle) override;
+
+    /**
+     * Start copying the ext mem from a cuda device into pinned host memory, on a stream
+     * separate from the streams of the pipeline, see IExtMemValue::extMemStage()
+     *
+     * @return nullptr if the ext mem is already held on the cpu
+     */
+    std::shared_ptr<IExtMemStaging> extMemStage() const override;
+
+    /**
+     * Start copying the ext mem from the cpu to the given cuda device id on a stream separate
+     * from the streams of the pipeline, see IExtMemValue::extMemUpload(). Pageable cpu memory is
+     * first copied into pinned host memory, which the value keeps as its cpu copy.
+     *
+     * shall not be called after sharing on value store (no thread protection)
+     */
+    bool extMemUpload(int device) const override;
+
 private:
 
     class ExtMem;
 
     static const int NUM_GPUS = 2;
 
-    T* extMemPtrImpl(int device) const;
+    T* extMemPtrImpl(int device, bool write = false) const;
+    T* extMemPtrImpl(int device, cudaStream_t stream) const;
 
     std::unique_ptr<ExtMem> fExtMem;
 
@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_CUDA_CUDAIPC_H_
+#define MCF_CUDA_CUDAIPC_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace mcf
+{
+namespace cuda
+{
+
+/**
+ * Device memory imported from another process, see importDeviceMemory()
+ */
+struct ImportedDeviceMemory
+{
+    /// pointer to the memory, which is released once the last copy is destroyed
+    std::shared_ptr<void> ptr;
+    /// size of the memory in bytes
+    uint64_t size = 0;
+    /// CUDA device holding the memory
+    int device = -1;
+};
+
+/**
+ * Export device memory to another process on the same machine
+ *
+ * The returned handle carries a CUDA IPC memory handle and an interprocess event, which is
+ * recorded on the default stream of the device, so that the importer does not use the memory
+ * before the work submitted so far has completed.
+ *
+ * Every export holds one slot of a reference table in shared memory until the importing process
+ * released the memory. The owner is kept until then, released slots are reclaimed by later
+ * exports. Exports which have not been imported within 10 s, e.g. since their message was lost,
+ * are withdrawn by later exports, others can be withdrawn with withdrawDeviceMemory(). A withdrawn
+ * export cannot be imported anymore. Only processes of the same user can import the exports.
+ *
+ * @param owner   keeps the memory alive while it is exported
+ * @param ptr     device pointer to the memory
+ * @param size    size of the memory in bytes
+ * @param device  CUDA device holding the memory
+ *
+ * @return the handle, empty if the memory cannot be exported, e.g. since all slots are in use
+ */
+std::string exportDeviceMemory(
+    std::shared_ptr<const void> owner, const void* ptr, uint64_t size, int device);
+
+/**
+ * Withdraw an export of this process which will not be imported, e.g. since its message has been
+ * rejected, releasing its slot and owner. Has no effect if the export has already been imported.
+ *
+ * @param handle  handle returned by exportDeviceMemory()
+ */
+void withdrawDeviceMemory(const std::string& handle);
+
+/**
+ * Map device memory exported by exportDeviceMemory() in another process
+ *
+ * Work submitted to the default stream of the device afterwards waits for the work the exporter
+ * submitted before exporting. Both processes must see the device under the same CUDA device ID.
+ *
+ * @param handle  handle returned by exportDeviceMemory()
+ *
+ * @return the memory, with null pointer if the handle cannot be imported, e.g. since it has
+ *         been withdrawn
+ */
+ImportedDeviceMemory importDeviceMemory(const std::string& handle);
+
+} // namespace cuda
+} // namespace mcf
+
+#endif // MCF_CUDA_CUDAIPC_H_
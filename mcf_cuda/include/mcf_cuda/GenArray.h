@@ -10,6 +10,9 @@
 /*
  * forward declarations
  */
+// same as in driver_types.h, which is not included to keep CUDA headers out of this header
+typedef struct CUstream_st* cudaStream_t;
+
 namespace mcf { namespace cuda {
 template<typename T> class unique_array;
 } }
@@ -47,6 +50,28 @@ public:
     static constexpr size_t NUM_DEVICES =
             static_cast<ssize_t>(Device::LAST_ID) -
             static_cast<ssize_t>(Device::FIRST_ID);
+
+    /**
+     * Kinds of memory for the CPU side of arrays
+     */
+    enum class HostMemory
+    {
+        PAGEABLE,   ///< regular heap memory
+        PINNED      ///< page-locked memory from mcf::cuda::hostAllocator, copied to and
+                    ///< from the GPU by DMA without staging
+    };
+
+    /**
+     * Select the memory of CPU arrays allocated from now on, including the CPU copies
+     * of arrays created on a GPU (default: PAGEABLE)
+     *
+     * Pinned memory speeds up the transfers of arrays exchanged with the GPU, but is
+     * taken from the physical memory of the system, so it should be used for arrays
+     * which are actually transferred.
+     */
+    static void setHostMemory(HostMemory hostMemory);
+
+    static HostMemory hostMemory();
 };
 
 /**
@@ -97,6 +122,16 @@ public:
      */
     gen_array(mcf::cuda::unique_array<T>&& source);
 
+    /**
+     * Constructor sharing memory on the given device, e.g. device memory imported from another
+     * process. The memory is kept alive by the shared pointer and released with its deleter.
+     *
+     * @param source    shared pointer to the memory
+     * @param device    the device holding the memory
+     * @param numElems  the number of elements in the array
+     */
+    gen_array(std::shared_ptr<T> source, Device device, size_t numElems);
+
     /**
      * Destructor
      */
@@ -134,6 +169,29 @@ public:
      */
     T* init(Device device, size_t numElems);
 
+    /**
+     * Create a new array with given number of elements in managed memory
+     * (cudaMallocManaged), which is accessible from the CPU and all CUDA devices.
+     * Resets the object, frees any previously allocated memory.
+     *
+     * For arrays touched sparsely on several devices, managed memory only
+     * migrates the pages actually accessed, instead of copying the whole
+     * array. get() returns the same pointer for all devices and prefetches
+     * the memory to the requested device instead of copying it.
+     *
+     * @param numElems          The number of elements
+     * @param preferredLocation The device where the pages should preferably
+     *                          reside, see cudaMemAdviseSetPreferredLocation
+     *
+     * @return  pointer to the managed memory
+     */
+    T* initManaged(size_t numElems, Device preferredLocation = Device::CPU);
+
+    /**
+     * Check if the array is held in managed memory, see initManaged()
+     */
+    bool isManaged() const;
+
     /**
      * Return a pointer to a const array on the desired device.
      *
@@ -150,6 +208,51 @@ public:
      */
     const T* get(Device device) const;
 
+    /**
+     * Return a pointer to a const array on the desired device, for use in the given stream.
+     *
+     * Like get(Device), but a required copy is enqueued asynchronously on the
+     * stream instead of blocking the calling thread. Work enqueued on the stream
+     * afterwards sees the copied contents. If the contents is still being copied
+     * to the device by another stream, the stream waits for that copy.
+     *
+     * The returned CPU memory must not be read before the stream is synchronized,
+     * get(Device) waits for pending copies.
+     *
+     * @param device    the device
+     * @param stream    the CUDA stream to copy in
+     *
+     * @return  pointer or null-pointer
+     */
+    const T* get(Device device, cudaStream_t stream) const;
+
+    /**
+     * Start copying the contents to the desired device on the given stream,
+     * without waiting for the copy, see get(Device, cudaStream_t).
+     *
+     * E.g. the upload of the next frame can be prefetched on a copy stream
+     * while kernels still work on the current frame.
+     *
+     * @param device    the device
+     * @param stream    the CUDA stream to copy in
+     */
+    void prefetch(Device device, cudaStream_t stream) const;
+
+    /**
+     * Return a pointer to the array on the desired device for writing.
+     *
+     * Like get(Device), but the copies on all other devices are dropped,
+     * since they become stale once the contents is written. They are
+     * created again from the written copy when they are requested.
+     *
+     * Note: This affects all gen_arrays sharing the memory.
+     *
+     * @param device    the device
+     *
+     * @return  pointer or null-pointer
+     */
+    T* getForWrite(Device device);
+
     /**
      * Check if a copy for the specified device is already available
      * (without creating one, in case it is not)
@@ -172,6 +275,16 @@ private:
      */
     void copyToTarget(size_t tgtIndex) const;
 
+    /**
+     * Enqueue a copy of the memory content to the specified target device on the stream
+     *
+     * Note: mutex of fPtrContainer must be locked before calling
+     *
+     * @param tgtIndex   Index of the target device, i.e. deviceId - FIRST_ID
+     * @param stream     the CUDA stream to copy in
+     */
+    void copyToTargetAsync(size_t tgtIndex, cudaStream_t stream) const;
+
     /**
      * The number of elements in the array
      */
@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#if HAVE_CUDA
+#include "mcf_cuda/CudaAllocatorStatsPublisher.h"
+#include "mcf_cuda/CudaCachingAllocator.h"
+
+#include <memory>
+
+namespace mcf
+{
+
+CudaAllocatorStatsPublisher::CudaAllocatorStatsPublisher(std::chrono::milliseconds interval)
+: Component("CudaAllocatorStatsPublisher")
+, fStatsPort(*this, "Stats")
+{
+    registerPeriodicHandler(interval, std::bind(&CudaAllocatorStatsPublisher::publish, this));
+}
+
+void CudaAllocatorStatsPublisher::configure(IComponentConfig& config)
+{
+    config.registerPort(fStatsPort, DEFAULT_TOPIC);
+}
+
+void CudaAllocatorStatsPublisher::publish()
+{
+    auto stats = std::make_unique<msg::CudaAllocatorStats>();
+    for (const auto& device : cuda::gpuAllocator.statistics())
+    {
+        msg::CudaAllocatorStatsEntry entry;
+        entry.device = device.device;
+        entry.cachedBytes = device.cachedBytes;
+        entry.liveBytes = device.liveBytes;
+        entry.hits = device.hits;
+        entry.misses = device.misses;
+        stats->devices.push_back(entry);
+    }
+    fStatsPort.setValue(std::move(stats));
+}
+
+} // namespace mcf
+
+#endif // HAVE_CUDA
@@ -3,20 +3,276 @@
  */
 
 #if HAVE_CUDA
-#include "cuda_runtime.h"
-#include "cub/util_allocator.cuh"
+#include "mcf_cuda/CudaCachingAllocator.h"
+#include "mcf_core/ExtMemPool.h"
+#include "mcf_core/SystemConfigurator.h"
+
+#include "json/json.h"
 
 namespace mcf
 {
 namespace cuda
 {
 
+namespace
+{
+
+unsigned int readUInt(const Json::Value& node, const std::string& name, unsigned int defaultValue)
+{
+    const Json::Value& value = node.get(name, Json::Value());
+    if (value.isNull())
+    {
+        return defaultValue;
+    }
+    if (!value.isIntegral() || value.asInt64() < 0)
+    {
+        throw SystemConfigurationError(
+            "CUDA allocator parameter " + name + " must be a non-negative integer");
+    }
+    return value.asUInt();
+}
+
+} // anonymous namespace
+
 /**
- * Instantiation of CachingDeviceAllocator to be used for all
+ * Instantiation of GpuAllocator to be used for all
  * CUDA device memory allocations in the project by declaring
- * an extern cub::CachingDeviceAllocator gpuAllocator
+ * an extern GpuAllocator gpuAllocator
+ */
+GpuAllocator gpuAllocator{GpuAllocatorConfig()};
+
+GpuAllocator::GpuAllocator(const GpuAllocatorConfig& config)
+: cub::CachingDeviceAllocator(config.binGrowth, config.minBin, config.maxBin, config.maxCachedBytes)
+{
+}
+
+void GpuAllocator::configure(const GpuAllocatorConfig& config)
+{
+    std::lock_guard<std::mutex> statsLock(fStatsMutex);
+    FreeAllCached();
+    std::lock_guard<std::mutex> lock(mutex);
+    bin_growth = config.binGrowth;
+    min_bin = config.minBin;
+    max_bin = config.maxBin;
+    min_bin_bytes = IntPow(bin_growth, min_bin);
+    max_bin_bytes = IntPow(bin_growth, max_bin);
+    max_cached_bytes = config.maxCachedBytes;
+}
+
+GpuAllocatorConfig GpuAllocator::config()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    GpuAllocatorConfig config;
+    config.binGrowth = bin_growth;
+    config.minBin = min_bin;
+    config.maxBin = max_bin;
+    config.maxCachedBytes = max_cached_bytes;
+    return config;
+}
+
+std::vector<GpuAllocatorStatistics> GpuAllocator::statistics()
+{
+    std::lock_guard<std::mutex> statsLock(fStatsMutex);
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<GpuAllocatorStatistics> result;
+    for (const auto& entry : fCounters)
+    {
+        GpuAllocatorStatistics stats;
+        stats.device = entry.first;
+        stats.hits = entry.second.hits;
+        stats.misses = entry.second.misses;
+        auto bytes = cached_bytes.find(entry.first);
+        if (bytes != cached_bytes.end())
+        {
+            stats.cachedBytes = bytes->second.free;
+            stats.liveBytes = bytes->second.live;
+        }
+        result.push_back(stats);
+    }
+    return result;
+}
+
+cudaError_t GpuAllocator::DeviceAllocate(int device, void** d_ptr, size_t bytes, cudaStream_t active_stream)
+{
+    if (device == INVALID_DEVICE_ORDINAL)
+    {
+        const cudaError_t error = cudaGetDevice(&device);
+        if (error != cudaSuccess)
+        {
+            return error;
+        }
+    }
+
+    std::lock_guard<std::mutex> statsLock(fStatsMutex);
+    const size_t cachedBefore = cachedBytes(device);
+    const cudaError_t error = cub::CachingDeviceAllocator::DeviceAllocate(device, d_ptr, bytes, active_stream);
+    if (error == cudaSuccess)
+    {
+        // a hit takes its block from the cache
+        Counters& counters = fCounters[device];
+        if (cachedBytes(device) < cachedBefore)
+        {
+            ++counters.hits;
+        }
+        else
+        {
+            ++counters.misses;
+        }
+    }
+    return error;
+}
+
+cudaError_t GpuAllocator::DeviceAllocate(void** d_ptr, size_t bytes, cudaStream_t active_stream)
+{
+    return DeviceAllocate(INVALID_DEVICE_ORDINAL, d_ptr, bytes, active_stream);
+}
+
+cudaError_t GpuAllocator::DeviceFree(int device, void* d_ptr)
+{
+    std::lock_guard<std::mutex> statsLock(fStatsMutex);
+    return cub::CachingDeviceAllocator::DeviceFree(device, d_ptr);
+}
+
+cudaError_t GpuAllocator::DeviceFree(void* d_ptr)
+{
+    std::lock_guard<std::mutex> statsLock(fStatsMutex);
+    return cub::CachingDeviceAllocator::DeviceFree(d_ptr);
+}
+
+size_t GpuAllocator::cachedBytes(int device)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto bytes = cached_bytes.find(device);
+    return bytes != cached_bytes.end() ? bytes->second.free : 0;
+}
+
+GpuAllocatorConfig readGpuAllocatorConfiguration(const Json::Value& node)
+{
+    GpuAllocatorConfig config;
+    const Json::Value& allocator = node.get("CudaAllocator", Json::Value());
+    if (allocator.isNull())
+    {
+        return config;
+    }
+    if (!allocator.isObject())
+    {
+        throw SystemConfigurationError("CudaAllocator must be an object");
+    }
+    config.binGrowth = readUInt(allocator, "binGrowth", config.binGrowth);
+    config.minBin = readUInt(allocator, "minBin", config.minBin);
+    config.maxBin = readUInt(allocator, "maxBin", config.maxBin);
+    const Json::Value& maxCachedBytes = allocator.get("maxCachedBytesPerDevice", Json::Value());
+    if (!maxCachedBytes.isNull())
+    {
+        if (!maxCachedBytes.isIntegral() || maxCachedBytes.asInt64() < 0)
+        {
+            throw SystemConfigurationError(
+                "CUDA allocator parameter maxCachedBytesPerDevice must be a non-negative integer");
+        }
+        config.maxCachedBytes = static_cast<size_t>(maxCachedBytes.asUInt64());
+    }
+    if (config.binGrowth < 2 || config.minBin > config.maxBin)
+    {
+        throw SystemConfigurationError(
+            "CUDA allocator requires binGrowth of at least 2 and minBin not above maxBin");
+    }
+    return config;
+}
+
+/**
+ * Instantiation of CachingHostAllocator for the pinned host memory of gen_arrays
  */
-cub::CachingDeviceAllocator gpuAllocator(4u, 4u, 12u, 1073741824u);
+CachingHostAllocator hostAllocator(1073741824u);
+
+CachingHostAllocator::CachingHostAllocator(size_t maxCachedBytes)
+: fMaxCachedBytes(maxCachedBytes)
+{
+}
+
+CachingHostAllocator::~CachingHostAllocator()
+{
+    FreeAllCached();
+}
+
+cudaError_t CachingHostAllocator::HostAllocate(void** ptr, size_t bytes)
+{
+    const size_t capacity = mcf::ExtMemPool::sizeClass(bytes);
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto it = fFree.find(capacity);
+    if (it != fFree.end() && !it->second.empty())
+    {
+        *ptr = it->second.back();
+        it->second.pop_back();
+        fCachedBytes -= capacity;
+    }
+    else
+    {
+        cudaError_t error = cudaHostAlloc(ptr, capacity, cudaHostAllocPortable);
+        if (error != cudaSuccess)
+        {
+            // retry after releasing the cached blocks
+            FreeAllCachedLocked();
+            error = cudaHostAlloc(ptr, capacity, cudaHostAllocPortable);
+            if (error != cudaSuccess)
+            {
+                *ptr = nullptr;
+                return error;
+            }
+        }
+    }
+    fLive[*ptr] = capacity;
+    return cudaSuccess;
+}
+
+cudaError_t CachingHostAllocator::HostFree(void* ptr)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    auto live = fLive.find(ptr);
+    if (live == fLive.end())
+    {
+        return cudaErrorInvalidValue;
+    }
+    const size_t capacity = live->second;
+    fLive.erase(live);
+    if (fCachedBytes + capacity <= fMaxCachedBytes)
+    {
+        fFree[capacity].push_back(ptr);
+        fCachedBytes += capacity;
+        return cudaSuccess;
+    }
+    return cudaFreeHost(ptr);
+}
+
+cudaError_t CachingHostAllocator::FreeAllCached()
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    return FreeAllCachedLocked();
+}
+
+void CachingHostAllocator::SetMaxCachedBytes(size_t maxCachedBytes)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    fMaxCachedBytes = maxCachedBytes;
+}
+
+cudaError_t CachingHostAllocator::FreeAllCachedLocked()
+{
+    cudaError_t result = cudaSuccess;
+    for (auto& entry : fFree)
+    {
+        for (void* ptr : entry.second)
+        {
+            const cudaError_t error = cudaFreeHost(ptr);
+            if (error != cudaSuccess)
+            {
+                result = error;
+            }
+        }
+    }
+    fFree.clear();
+    fCachedBytes = 0;
+    return result;
+}
 
 } // namespace cuda
 } // namespace mcf
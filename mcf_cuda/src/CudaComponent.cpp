@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#if HAVE_CUDA
+#include "mcf_cuda/CudaComponent.h"
+#include "mcf_cuda/CudaErrorHelper.h"
+
+#include <sched.h>
+
+namespace mcf
+{
+
+namespace
+{
+
+/**
+ * Stream priority for the scheduling parameters of a component thread
+ *
+ * In CUDA, numerically lower values are greater priorities.
+ */
+int streamPriority(const IComponent::SchedulingParameters& parameters)
+{
+    int leastPriority = 0;
+    int greatestPriority = 0;
+    MCF_CHECK_CUDA(cudaDeviceGetStreamPriorityRange(&leastPriority, &greatestPriority));
+
+    switch (parameters.policy)
+    {
+    case IComponent::Fifo:
+    case IComponent::RoundRobin:
+    {
+        const int minPriority = sched_get_priority_min(parameters.policy);
+        const int maxPriority = sched_get_priority_max(parameters.policy);
+        if (maxPriority <= minPriority)
+        {
+            return leastPriority;
+        }
+        return leastPriority
+            + (greatestPriority - leastPriority) * (parameters.priority - minPriority)
+                / (maxPriority - minPriority);
+    }
+    case IComponent::Deadline:
+        return greatestPriority;
+    default:
+        return leastPriority;
+    }
+}
+
+} // anonymous namespace
+
+CudaComponent::CudaComponent(const std::string& name, int priority)
+: Component(name, priority)
+{
+}
+
+CudaComponent::~CudaComponent()
+{
+    if (fStream != nullptr)
+    {
+        cudaStreamSynchronize(fStream);
+    }
+    for (auto& entry : fGraphs)
+    {
+        destroy(entry.second);
+    }
+    if (fStream != nullptr)
+    {
+        cudaStreamDestroy(fStream);
+    }
+}
+
+cudaStream_t CudaComponent::stream()
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    if (fStream == nullptr)
+    {
+        MCF_CHECK_CUDA(cudaStreamCreateWithPriority(
+            &fStream, cudaStreamNonBlocking, streamPriority(getSchedulingParameters())));
+    }
+    return fStream;
+}
+
+void CudaComponent::setGraphCapture(bool enabled)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    fGraphCapture = enabled;
+}
+
+void CudaComponent::launchGraph(const std::string& name, const std::function<void(cudaStream_t)>& enqueue)
+{
+    cudaStream_t componentStream = stream();
+    Graph* graph = nullptr;
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        if (fGraphCapture)
+        {
+            graph = &fGraphs[name];
+        }
+    }
+
+    if (graph == nullptr || graph->runs < GRAPH_WARMUP_RUNS)
+    {
+        if (graph != nullptr)
+        {
+            ++graph->runs;
+        }
+        enqueue(componentStream);
+        return;
+    }
+
+    if (graph->exec == nullptr)
+    {
+        cudaGraph_t captured = nullptr;
+        MCF_CHECK_CUDA(cudaStreamBeginCapture(componentStream, cudaStreamCaptureModeThreadLocal));
+        try
+        {
+            enqueue(componentStream);
+        }
+        catch (...)
+        {
+            // end the capture, so that the stream can be used again
+            if (cudaStreamEndCapture(componentStream, &captured) == cudaSuccess)
+            {
+                cudaGraphDestroy(captured);
+            }
+            throw;
+        }
+        MCF_CHECK_CUDA(cudaStreamEndCapture(componentStream, &captured));
+        const cudaError_t error = cudaGraphInstantiateWithFlags(&graph->exec, captured, 0);
+        cudaGraphDestroy(captured);
+        MCF_CHECK_CUDA(error);
+    }
+    MCF_CHECK_CUDA(cudaGraphLaunch(graph->exec, componentStream));
+}
+
+void CudaComponent::resetGraph(const std::string& name)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    auto it = fGraphs.find(name);
+    if (it != fGraphs.end())
+    {
+        destroy(it->second);
+        fGraphs.erase(it);
+    }
+}
+
+void CudaComponent::destroy(Graph& graph)
+{
+    if (graph.exec != nullptr)
+    {
+        cudaGraphExecDestroy(graph.exec);
+        graph.exec = nullptr;
+    }
+}
+
+} // namespace mcf
+
+#endif // HAVE_CUDA
@@ -7,9 +7,138 @@
 #include "mcf_core/ErrorMacros.h"
 #include "mcf_cuda/GenArray.h"
 #include "mcf_cuda/CudaMemory.h"
+#include "mcf_cuda/CudaIpc.h"
+#include "mcf_cuda/CudaCachingAllocator.h"
+
+#include <cstring>
+#include <mutex>
 
 namespace mcf {
 
+namespace {
+
+/**
+ * Convert a cuda device id or cpu (-1) to a gen_array device ID
+ */
+// TODO: Use same device IDs for CudaExtMemValue and gen_array
+gen_array_base::Device toDeviceId(int device)
+{
+    if (device == -1)
+    {
+        return gen_array_base::Device::CPU;
+    }
+    else if (device == 0)
+    {
+        return gen_array_base::Device::CUDA_0;
+    }
+    else if (device == 1)
+    {
+        return gen_array_base::Device::CUDA_1;
+    }
+    MCF_THROW_RUNTIME("Invalid device ID");
+}
+
+/**
+ * Stream of the staging copies of all values, separate from the streams of the pipeline
+ */
+cudaStream_t stagingStream()
+{
+    static cudaStream_t stream = []() {
+        cudaStream_t created = nullptr;
+        MCF_CHECK_CUDA(cudaStreamCreateWithFlags(&created, cudaStreamNonBlocking));
+        return created;
+    }();
+    return stream;
+}
+
+/**
+ * Stream of the uploads of all values to a device, separate from the streams of the pipeline
+ *
+ * Instantiated with CudaExtMemValue::NUM_GPUS, so that all value types share the streams.
+ */
+template<int NumGpus>
+cudaStream_t uploadStream(int device)
+{
+    static cudaStream_t streams[NumGpus] = {};
+    static std::once_flag created[NumGpus];
+    std::call_once(created[device], [device]() {
+        // streams belong to the device current at their creation
+        int currentDevice;
+        MCF_CHECK_CUDA(cudaGetDevice(&currentDevice));
+        MCF_CHECK_CUDA(cudaSetDevice(device));
+        MCF_CHECK_CUDA(cudaStreamCreateWithFlags(&streams[device], cudaStreamNonBlocking));
+        MCF_CHECK_CUDA(cudaSetDevice(currentDevice));
+    });
+    return streams[device];
+}
+
+/**
+ * True if ptr points to page-locked host memory, which is copied to the device by DMA without
+ * blocking the caller
+ */
+bool isPinned(const void* ptr)
+{
+    cudaPointerAttributes attributes;
+    if (cudaPointerGetAttributes(&attributes, ptr) != cudaSuccess)
+    {
+        cudaGetLastError();
+        return false;
+    }
+    return attributes.type == cudaMemoryTypeHost;
+}
+
+/**
+ * Copy of device memory into pinned host memory from mcf::cuda::hostAllocator, which
+ * recycles the buffers of earlier copies of the same size class
+ */
+class PinnedStaging : public IExtMemStaging
+{
+public:
+    /**
+     * @param source    keeps the device memory alive until the copy has completed
+     */
+    PinnedStaging(std::shared_ptr<const void> source, uint64_t size)
+    : fSource(std::move(source))
+    , fSize(size)
+    {
+        MCF_CHECK_CUDA(mcf::cuda::hostAllocator.HostAllocate(&fData, size));
+        MCF_CHECK_CUDA(cudaEventCreateWithFlags(&fEvent, cudaEventDisableTiming));
+    }
+
+    ~PinnedStaging() override
+    {
+        // the copy must not write into a recycled buffer
+        cudaEventSynchronize(fEvent);
+        cudaEventDestroy(fEvent);
+        mcf::cuda::hostAllocator.HostFree(fData);
+    }
+
+    void copy(const void* src, cudaStream_t stream)
+    {
+        MCF_CHECK_CUDA(cudaMemcpyAsync(fData, src, fSize, cudaMemcpyDeviceToHost, stream));
+        MCF_CHECK_CUDA(cudaEventRecord(fEvent, stream));
+    }
+
+    const uint8_t* data() override
+    {
+        MCF_CHECK_CUDA(cudaEventSynchronize(fEvent));
+        return static_cast<const uint8_t*>(fData);
+    }
+
+    uint64_t size() const override
+    {
+        return fSize;
+    }
+
+private:
+    std::shared_ptr<const void> fSource;
+    uint64_t fSize;
+    void* fData = nullptr;
+    cudaEvent_t fEvent = nullptr;
+};
+
+} // anonymous namespace
+
 // TODO: use instance of gen_array directly instead of ExtMem
 template<typename T>
 class CudaExtMemValue<T>::ExtMem {
@@ -113,6 +242,57 @@ void CudaExtMemValue<T>::extMemInit(const void *src, uint64_t len, int dstDevice
     }
 };
 
+template<typename T>
+bool CudaExtMemValue<T>::extMemInitView(
+    std::shared_ptr<const CudaExtMemValue<T>> parent, uint64_t offset, uint64_t len)
+{
+    return extMemInitView(std::move(parent), offset, len, len, 1);
+}
+
+template<typename T>
+bool CudaExtMemValue<T>::extMemInitView(std::shared_ptr<const CudaExtMemValue<T>> parent, uint64_t offset,
+                                        uint64_t rowLen, uint64_t stride, uint64_t rows)
+{
+    MCF_ASSERT(parent != nullptr && parent->extMemInitialized(), "CudaExtMemValue: view without parent");
+    MCF_ASSERT(rows > 0 && rowLen > 0, "CudaExtMemValue: empty view");
+    MCF_ASSERT((rows == 1 || stride >= rowLen)
+                   && offset + (rows - 1) * stride + rowLen <= parent->extMemSize(),
+               "CudaExtMemValue: view exceeds the ext mem of its parent");
+    if (offset % sizeof(T) != 0 || rowLen % sizeof(T) != 0 || (rows > 1 && stride % sizeof(T) != 0))
+    {
+        return false;
+    }
+
+    // a view onto the same shared data keeps the memory of the parent alive
+    auto parentArray = std::make_shared<const mcf::gen_array<T>>(
+        static_cast<const mcf::gen_array<T>>(*parent));
+
+    // refer to a cuda device holding the parent, the cpu only if none does
+    const gen_array_base::Device devices[] = {
+        gen_array_base::Device::CUDA_0, gen_array_base::Device::CUDA_1, gen_array_base::Device::CPU};
+    for (const auto device : devices)
+    {
+        if (!parentArray->hasCopyOnDevice(device))
+        {
+            continue;
+        }
+        const T* base = parentArray->get(device) + offset / sizeof(T);
+        if (rows == 1 || stride == rowLen)
+        {
+            extMemInit(rows * rowLen);
+            std::shared_ptr<T> view(parentArray, const_cast<T*>(base));
+            fExtMem->genArray = mcf::gen_array<T>(std::move(view), device, rows * rowLen / sizeof(T));
+            return true;
+        }
+
+        extMemInit(rows * rowLen);
+        T* gathered = fExtMem->genArray.init(device, rows * rowLen / sizeof(T));
+        MCF_CHECK_CUDA(cudaMemcpy2D(gathered, rowLen, base, stride, rowLen, rows, cudaMemcpyDefault));
+        return true;
+    }
+    return false;
+}
+
 template<typename T>
 uint64_t CudaExtMemValue<T>::extMemSize() const {
     return fExtMem->len;
@@ -125,7 +305,25 @@ const typename CudaExtMemValue<T>::Ptr CudaExtMemValue<T>::extMemPtr(int device)
 
 template<typename T>
 typename CudaExtMemValue<T>::Ptr CudaExtMemValue<T>::extMemPtr(int device) {
-    return extMemPtrImpl(device);
+    return extMemPtrImpl(device, true);
+}
+
+template<typename T>
+bool CudaExtMemValue<T>::extMemHasCopy(int device) const {
+    return extMemInitialized() && fExtMem->genArray.hasCopyOnDevice(toDeviceId(device));
+}
+
+template<typename T>
+const typename CudaExtMemValue<T>::Ptr CudaExtMemValue<T>::extMemPtr(int device, cudaStream_t stream) const {
+    return extMemPtrImpl(device, stream);
+}
+
+template<typename T>
+void CudaExtMemValue<T>::extMemPrefetch(int device, cudaStream_t stream) const {
+    if (extMemInitialized())
+    {
+        fExtMem->genArray.prefetch(toDeviceId(device), stream);
+    }
 }
 
 
@@ -149,7 +347,7 @@ CudaExtMemValue<T>::operator const mcf::gen_array<T>() const
 
 
 template<typename T>
-T* CudaExtMemValue<T>::extMemPtrImpl(int device) const {
+T* CudaExtMemValue<T>::extMemPtrImpl(int device, bool write) const {
 
     if (!extMemInitialized())
     {
@@ -157,27 +355,10 @@ T* CudaExtMemValue<T>::extMemPtrImpl(int device) const {
     }
 
     // determine gen_array device ID
-    // TODO: Use same device IDs for CudaExtMemValue and gen_array
-    typename mcf::gen_array<T>::Device deviceId(mcf::gen_array<T>::Device::CPU);
-    if (device == -1)
-    {
-        deviceId = mcf::gen_array<T>::Device::CPU;
-    }
-    else if (device == 0)
-    {
-        deviceId = mcf::gen_array<T>::Device::CUDA_0;
-    }
-    else if (device == 1)
-    {
-        deviceId = mcf::gen_array<T>::Device::CUDA_1;
-    }
-    else
-    {
-        MCF_THROW_RUNTIME("Invalid device ID");
-    }
+    const auto deviceId = toDeviceId(device);
 
-    // get pointer to memory on requested device
-    const T* memPtr = fExtMem->genArray.get(deviceId);
+    // get pointer to memory on requested device, copied from another device on first access
+    const T* memPtr = write ? fExtMem->genArray.getForWrite(deviceId) : fExtMem->genArray.get(deviceId);
 
     // if already allocated, return pointer
     if (memPtr != nullptr)
@@ -192,12 +373,138 @@ T* CudaExtMemValue<T>::extMemPtrImpl(int device) const {
     return fExtMem->genArray.init(deviceId, (fExtMem->len)/sizeof(T));
 }
 
+template<typename T>
+T* CudaExtMemValue<T>::extMemPtrImpl(int device, cudaStream_t stream) const {
+
+    if (!extMemInitialized())
+    {
+        return nullptr;
+    }
+
+    const auto deviceId = toDeviceId(device);
+
+    // get pointer to memory on requested device, copying on the stream if needed
+    const T* memPtr = fExtMem->genArray.get(deviceId, stream);
+    if (memPtr != nullptr)
+    {
+        // TODO: see extMemPtrImpl(int)
+        return const_cast<T*>(memPtr);
+    }
+
+    // otherwise allocate and return pointer to new memory
+    return fExtMem->genArray.init(deviceId, (fExtMem->len)/sizeof(T));
+}
+
 
 template<typename T>
 bool CudaExtMemValue<T>::extMemInitialized() const {
     return fExtMem->len > 0;
 }
 
+template<typename T>
+bool CudaExtMemValue<T>::extMemExport(std::string& handle) const {
+    if (!extMemInitialized())
+    {
+        return false;
+    }
+
+    for (int device = 0; device < NUM_GPUS; ++device)
+    {
+        const auto deviceId = mcf::deviceIdFromCuda(device);
+        if (!fExtMem->genArray.hasCopyOnDevice(deviceId))
+        {
+            continue;
+        }
+
+        // a view onto the same shared data keeps the memory alive while it is exported
+        const T* ptr = fExtMem->genArray.get(deviceId);
+        auto owner = std::make_shared<const mcf::gen_array<T>>(fExtMem->genArray);
+        handle = mcf::cuda::exportDeviceMemory(owner, ptr, fExtMem->len, device);
+        return !handle.empty();
+    }
+    return false;
+}
+
+template<typename T>
+void CudaExtMemValue<T>::extMemWithdraw(const std::string& handle) const {
+    mcf::cuda::withdrawDeviceMemory(handle);
+}
+
+template<typename T>
+std::shared_ptr<IExtMemStaging> CudaExtMemValue<T>::extMemStage() const {
+    if (!extMemInitialized() || fExtMem->genArray.hasCopyOnDevice(gen_array_base::Device::CPU))
+    {
+        return nullptr;
+    }
+
+    for (int device = 0; device < NUM_GPUS; ++device)
+    {
+        const auto deviceId = mcf::deviceIdFromCuda(device);
+        if (!fExtMem->genArray.hasCopyOnDevice(deviceId))
+        {
+            continue;
+        }
+
+        // the staging stream waits for a pending copy to the device
+        const cudaStream_t stream = stagingStream();
+        const T* ptr = fExtMem->genArray.get(deviceId, stream);
+        auto staging = std::make_shared<PinnedStaging>(
+            std::make_shared<const mcf::gen_array<T>>(fExtMem->genArray), fExtMem->len);
+        staging->copy(ptr, stream);
+        return staging;
+    }
+    return nullptr;
+}
+
+template<typename T>
+bool CudaExtMemValue<T>::extMemUpload(int device) const {
+    if (!extMemInitialized() || device < 0 || device >= NUM_GPUS)
+    {
+        return false;
+    }
+    const auto deviceId = toDeviceId(device);
+    if (fExtMem->genArray.hasCopyOnDevice(deviceId))
+    {
+        return true;
+    }
+    if (!fExtMem->genArray.hasCopyOnDevice(gen_array_base::Device::CPU))
+    {
+        return false;
+    }
+
+    const T* host = fExtMem->genArray.get(gen_array_base::Device::CPU);
+    if (!isPinned(host))
+    {
+        // the copy from pageable memory would be staged by the driver, blocking the caller
+        T* pinned = nullptr;
+        MCF_CHECK_CUDA(mcf::cuda::hostAllocator.HostAllocate((void**)&pinned, fExtMem->len));
+        std::memcpy(pinned, host, fExtMem->len);
+        std::shared_ptr<T> array(pinned, [](T* ptr) { mcf::cuda::hostAllocator.HostFree(ptr); });
+        fExtMem->genArray = mcf::gen_array<T>(
+            std::move(array), gen_array_base::Device::CPU, fExtMem->len / sizeof(T));
+    }
+
+    // readers of the device copy wait for the upload
+    fExtMem->genArray.prefetch(deviceId, uploadStream<NUM_GPUS>(device));
+    return true;
+}
+
+template<typename T>
+bool CudaExtMemValue<T>::extMemImport(const std::string& handle) {
+    mcf::cuda::ImportedDeviceMemory memory = mcf::cuda::importDeviceMemory(handle);
+    if (memory.ptr == nullptr || memory.device < 0 || memory.device >= NUM_GPUS
+        || memory.size % sizeof(T) != 0)
+    {
+        return false;
+    }
+
+    extMemInit(memory.size);
+    std::shared_ptr<T> array(memory.ptr, static_cast<T*>(memory.ptr.get()));
+    fExtMem->genArray = mcf::gen_array<T>(
+        std::move(array), mcf::deviceIdFromCuda(memory.device), memory.size / sizeof(T));
+    return true;
+}
+
 
 
 /**
@@ -0,0 +1,506 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#if HAVE_CUDA
+#include "mcf_cuda/CudaIpc.h"
+#include "mcf_core/LoggingMacros.h"
+
+#include "cuda.h"
+#include "cuda_runtime.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace mcf
+{
+namespace cuda
+{
+
+namespace
+{
+
+constexpr uint32_t HANDLE_MAGIC = 0x4d434950; // "MCIP"
+
+/**
+ * Number of exports a process may have in flight or imported at the same time
+ */
+constexpr uint32_t TABLE_SLOTS = 256;
+
+/**
+ * Time after which an export which has not been imported is withdrawn
+ */
+constexpr std::chrono::seconds IMPORT_TIMEOUT(10);
+
+// states of a slot, in the low bits of its word, the generation of the export in the others
+constexpr uint32_t SLOT_FREE = 0;
+constexpr uint32_t SLOT_EXPORTED = 1;
+constexpr uint32_t SLOT_IMPORTED = 2;
+constexpr uint32_t STATE_BITS = 2;
+constexpr uint32_t STATE_MASK = (1u << STATE_BITS) - 1;
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "RefTable needs lock-free 32 bit atomics");
+
+/**
+ * States of the exports of a process, lives in shared memory. The exporter marks a slot as
+ * exported, the importer claims it before mapping the memory and frees it once it released the
+ * memory. An export which has not been claimed can be withdrawn by the exporter instead. The
+ * generation in the word of a slot keeps handles of previous exports of the slot from claiming it.
+ */
+struct RefTable
+{
+    std::atomic<uint32_t> slot[TABLE_SLOTS];
+};
+
+uint32_t slotWord(uint32_t generation, uint32_t state)
+{
+    return generation << STATE_BITS | state;
+}
+
+/**
+ * Content of an export handle
+ */
+struct WireHandle
+{
+    uint32_t magic;
+    int32_t pid;
+    uint32_t slot;
+    uint32_t generation;
+    int32_t device;
+    uint64_t offset;
+    uint64_t size;
+    cudaIpcMemHandle_t memHandle;
+    cudaIpcEventHandle_t eventHandle;
+};
+
+std::string tableName(int32_t pid)
+{
+    return "/mcf_cuda_ipc_" + std::to_string(pid);
+}
+
+bool parseHandle(const std::string& wire, WireHandle& handle)
+{
+    if (wire.size() != sizeof(handle))
+    {
+        return false;
+    }
+    std::memcpy(&handle, wire.data(), sizeof(handle));
+    return handle.magic == HANDLE_MAGIC && handle.slot < TABLE_SLOTS;
+}
+
+bool succeeded(cudaError_t result, const char* what)
+{
+    if (result != cudaSuccess)
+    {
+        MCF_WARN_NOFILELINE("CudaIpc: {} failed: {}", what, cudaGetErrorString(result));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Selects a CUDA device until destroyed
+ */
+class DeviceGuard
+{
+public:
+    explicit DeviceGuard(int device)
+    {
+        fValid = succeeded(cudaGetDevice(&fPrevious), "cudaGetDevice")
+            && succeeded(cudaSetDevice(device), "cudaSetDevice");
+    }
+
+    ~DeviceGuard()
+    {
+        if (fValid)
+        {
+            cudaSetDevice(fPrevious);
+        }
+    }
+
+    bool valid() const { return fValid; }
+
+private:
+    int fPrevious = 0;
+    bool fValid = false;
+};
+
+/**
+ * Owner of the reference table of this process and the memory exported through it
+ */
+class Exporter
+{
+public:
+    static Exporter& instance()
+    {
+        static Exporter exporter;
+        return exporter;
+    }
+
+    std::string exportMemory(
+        std::shared_ptr<const void> owner, const void* ptr, uint64_t size, int device)
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (fTable == nullptr)
+        {
+            return std::string();
+        }
+
+        // reclaim the slots released by their importers or not imported in time
+        const auto now = std::chrono::steady_clock::now();
+        uint32_t free = TABLE_SLOTS;
+        for (uint32_t i = 0; i < TABLE_SLOTS; ++i)
+        {
+            if (fSlots[i].owner != nullptr)
+            {
+                reclaim(i, now);
+            }
+            if (fSlots[i].owner == nullptr && free == TABLE_SLOTS)
+            {
+                free = i;
+            }
+        }
+        if (free == TABLE_SLOTS)
+        {
+            MCF_WARN_NOFILELINE("CudaIpc: all {} export slots are in use", TABLE_SLOTS);
+            return std::string();
+        }
+        Slot& slot = fSlots[free];
+
+        DeviceGuard guard(device);
+        if (!guard.valid())
+        {
+            return std::string();
+        }
+
+        // IPC handles refer to whole allocations, e.g. the blocks of the caching allocator
+        CUdeviceptr base = 0;
+        size_t allocationSize = 0;
+        if (cuMemGetAddressRange(&base, &allocationSize, reinterpret_cast<CUdeviceptr>(ptr))
+            != CUDA_SUCCESS)
+        {
+            MCF_WARN_NOFILELINE("CudaIpc: cuMemGetAddressRange failed");
+            return std::string();
+        }
+
+        WireHandle handle{};
+        handle.magic = HANDLE_MAGIC;
+        handle.pid = static_cast<int32_t>(getpid());
+        handle.slot = free;
+        handle.generation = slot.generation + 1;
+        handle.device = device;
+        handle.offset = reinterpret_cast<CUdeviceptr>(ptr) - base;
+        handle.size = size;
+        if (!succeeded(cudaIpcGetMemHandle(&handle.memHandle, reinterpret_cast<void*>(base)),
+                       "cudaIpcGetMemHandle"))
+        {
+            return std::string();
+        }
+
+        if (slot.event == nullptr
+            && !succeeded(cudaEventCreateWithFlags(
+                              &slot.event, cudaEventDisableTiming | cudaEventInterprocess),
+                          "cudaEventCreateWithFlags"))
+        {
+            return std::string();
+        }
+        if (!succeeded(cudaEventRecord(slot.event, 0), "cudaEventRecord")
+            || !succeeded(cudaIpcGetEventHandle(&handle.eventHandle, slot.event),
+                          "cudaIpcGetEventHandle"))
+        {
+            return std::string();
+        }
+
+        slot.generation = handle.generation;
+        slot.exported = now;
+        fTable->slot[free].store(slotWord(slot.generation, SLOT_EXPORTED));
+        slot.owner = std::move(owner);
+        return std::string(reinterpret_cast<const char*>(&handle), sizeof(handle));
+    }
+
+    void withdrawMemory(const std::string& wire)
+    {
+        WireHandle handle;
+        if (!parseHandle(wire, handle) || handle.pid != static_cast<int32_t>(getpid()))
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (fTable == nullptr)
+        {
+            return;
+        }
+        // fails if the export has been imported meanwhile, or withdrawn before
+        uint32_t word = slotWord(handle.generation, SLOT_EXPORTED);
+        if (fTable->slot[handle.slot].compare_exchange_strong(word, slotWord(handle.generation, SLOT_FREE)))
+        {
+            fSlots[handle.slot].owner.reset();
+        }
+    }
+
+private:
+    struct Slot
+    {
+        std::shared_ptr<const void> owner;
+        cudaEvent_t event = nullptr;
+        uint32_t generation = 0;
+        std::chrono::steady_clock::time_point exported;
+    };
+
+    Exporter() : fName(tableName(static_cast<int32_t>(getpid())))
+    {
+        // only processes of the same user may import, or forge releases
+        const int fd = shm_open(fName.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0600);
+        if (fd < 0)
+        {
+            MCF_WARN_NOFILELINE("CudaIpc: cannot create reference table {}", fName);
+            return;
+        }
+        if (ftruncate(fd, sizeof(RefTable)) == 0)
+        {
+            void* mapped = mmap(nullptr, sizeof(RefTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mapped != MAP_FAILED)
+            {
+                fTable = static_cast<RefTable*>(mapped);
+            }
+        }
+        close(fd);
+        if (fTable == nullptr)
+        {
+            MCF_WARN_NOFILELINE("CudaIpc: cannot map reference table {}", fName);
+            shm_unlink(fName.c_str());
+        }
+    }
+
+    ~Exporter()
+    {
+        for (Slot& slot : fSlots)
+        {
+            slot.owner.reset();
+            if (slot.event != nullptr)
+            {
+                cudaEventDestroy(slot.event);
+            }
+        }
+        if (fTable != nullptr)
+        {
+            munmap(fTable, sizeof(RefTable));
+            shm_unlink(fName.c_str());
+        }
+    }
+
+    /**
+     * Releases the owner of a slot once the export has been released by its importer, or
+     * withdraws the export if it has not been imported in time
+     *
+     * Note: fMutex must be locked before calling
+     */
+    void reclaim(uint32_t index, std::chrono::steady_clock::time_point now)
+    {
+        Slot& slot = fSlots[index];
+        uint32_t word = fTable->slot[index].load();
+        if (word == slotWord(slot.generation, SLOT_EXPORTED) && now - slot.exported > IMPORT_TIMEOUT
+            && fTable->slot[index].compare_exchange_strong(word, slotWord(slot.generation, SLOT_FREE)))
+        {
+            MCF_WARN_NOFILELINE("CudaIpc: export in slot {} has not been imported within {} s, withdrawn",
+                                index, IMPORT_TIMEOUT.count());
+            word = slotWord(slot.generation, SLOT_FREE);
+        }
+        if ((word & STATE_MASK) == SLOT_FREE)
+        {
+            slot.owner.reset();
+        }
+    }
+
+    const std::string fName;
+    std::mutex fMutex;
+    RefTable* fTable = nullptr;
+    std::array<Slot, TABLE_SLOTS> fSlots;
+};
+
+/**
+ * Keeps the reference tables of the exporting processes and the memory mapped from them
+ */
+class Importer
+{
+public:
+    static Importer& instance()
+    {
+        static Importer importer;
+        return importer;
+    }
+
+    ImportedDeviceMemory importMemory(const std::string& wire)
+    {
+        ImportedDeviceMemory result;
+
+        WireHandle handle;
+        if (!parseHandle(wire, handle))
+        {
+            return result;
+        }
+
+        std::lock_guard<std::mutex> lock(fMutex);
+        RefTable* table = openTable(handle.pid);
+        if (table == nullptr)
+        {
+            return result;
+        }
+        const uint32_t slot = handle.slot;
+        const uint32_t generation = handle.generation;
+        uint32_t word = slotWord(generation, SLOT_EXPORTED);
+        if (!table->slot[slot].compare_exchange_strong(word, slotWord(generation, SLOT_IMPORTED)))
+        {
+            MCF_WARN_NOFILELINE("CudaIpc: export of process {} has been withdrawn", handle.pid);
+            return result;
+        }
+        // the claim of the export is dropped unless it is passed to the imported memory
+        std::shared_ptr<void> reference(nullptr, [table, slot, generation](void*) {
+            table->slot[slot].store(slotWord(generation, SLOT_FREE));
+        });
+
+        DeviceGuard guard(handle.device);
+        if (!guard.valid())
+        {
+            return result;
+        }
+
+        std::shared_ptr<void> mapping = openMemory(handle);
+        if (mapping == nullptr)
+        {
+            return result;
+        }
+
+        // wait for the work the exporter submitted before exporting
+        cudaEvent_t event = nullptr;
+        if (!succeeded(cudaIpcOpenEventHandle(&event, handle.eventHandle), "cudaIpcOpenEventHandle"))
+        {
+            return result;
+        }
+        const bool waiting = succeeded(cudaStreamWaitEvent(0, event, 0), "cudaStreamWaitEvent");
+        cudaEventDestroy(event);
+        if (!waiting)
+        {
+            return result;
+        }
+
+        // the mapping is closed before the reference is dropped
+        void* ptr = static_cast<char*>(mapping.get()) + handle.offset;
+        result.ptr = std::shared_ptr<void>(ptr, [mapping, reference](void*) mutable {
+            mapping.reset();
+            reference.reset();
+        });
+        result.size = handle.size;
+        result.device = handle.device;
+        return result;
+    }
+
+private:
+    Importer() = default;
+
+    ~Importer()
+    {
+        for (auto& table : fTables)
+        {
+            munmap(table.second, sizeof(RefTable));
+        }
+    }
+
+    /**
+     * Note: fMutex must be locked before calling
+     */
+    RefTable* openTable(int32_t pid)
+    {
+        auto table = fTables.find(pid);
+        if (table != fTables.end())
+        {
+            return table->second;
+        }
+
+        const std::string name = tableName(pid);
+        const int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0)
+        {
+            MCF_WARN_NOFILELINE("CudaIpc: cannot open reference table {}", name);
+            return nullptr;
+        }
+        void* mapped = mmap(nullptr, sizeof(RefTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            MCF_WARN_NOFILELINE("CudaIpc: cannot map reference table {}", name);
+            return nullptr;
+        }
+        return fTables[pid] = static_cast<RefTable*>(mapped);
+    }
+
+    /**
+     * Opens the allocation of a handle, or shares it if it is already open, since an allocation
+     * can be opened only once per process
+     *
+     * Note: fMutex must be locked before calling
+     */
+    std::shared_ptr<void> openMemory(const WireHandle& handle)
+    {
+        const std::string key(reinterpret_cast<const char*>(&handle.memHandle), sizeof(handle.memHandle));
+        std::shared_ptr<void> mapping = fMappings[key].lock();
+        if (mapping != nullptr)
+        {
+            return mapping;
+        }
+
+        // forget the allocations closed in the meantime
+        for (auto it = fMappings.begin(); it != fMappings.end();)
+        {
+            it = it->second.expired() && it->first != key ? fMappings.erase(it) : std::next(it);
+        }
+
+        void* base = nullptr;
+        if (!succeeded(cudaIpcOpenMemHandle(&base, handle.memHandle, cudaIpcMemLazyEnablePeerAccess),
+                       "cudaIpcOpenMemHandle"))
+        {
+            fMappings.erase(key);
+            return nullptr;
+        }
+        mapping = std::shared_ptr<void>(base, [](void* p) { cudaIpcCloseMemHandle(p); });
+        fMappings[key] = mapping;
+        return mapping;
+    }
+
+    std::mutex fMutex;
+    std::map<int32_t, RefTable*> fTables;
+    std::map<std::string, std::weak_ptr<void>> fMappings;
+};
+
+} // anonymous namespace
+
+std::string exportDeviceMemory(
+    std::shared_ptr<const void> owner, const void* ptr, uint64_t size, int device)
+{
+    return Exporter::instance().exportMemory(std::move(owner), ptr, size, device);
+}
+
+void withdrawDeviceMemory(const std::string& handle)
+{
+    Exporter::instance().withdrawMemory(handle);
+}
+
+ImportedDeviceMemory importDeviceMemory(const std::string& handle)
+{
+    return Importer::instance().importMemory(handle);
+}
+
+} // namespace cuda
+} // namespace mcf
+
+#endif // HAVE_CUDA
@@ -4,7 +4,9 @@
 
 #if HAVE_CUDA
 
+#include <atomic>
 #include <cstring>
+#include <limits>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
@@ -21,6 +23,11 @@ namespace mcf {
 namespace
 {
 
+/**
+ * Memory of newly allocated CPU arrays
+ */
+std::atomic<gen_array_base::HostMemory> hostMemoryKind(gen_array_base::HostMemory::PAGEABLE);
+
 /**
  * Returns an ID, representing the device which holds the memory this pointer is pointing to
  * @return -1 or -2 if the memory resides on the CPU
@@ -73,6 +80,30 @@ inline size_t getDeviceIndex(gen_array_base::Device device)
 template<typename T>
 inline std::shared_ptr<T> createCpuArray(size_t numElems)
 {
+    if (hostMemoryKind.load() == gen_array_base::HostMemory::PINNED)
+    {
+        T* ptr = nullptr;
+        MCF_CHECK_CUDA(
+            mcf::cuda::hostAllocator.HostAllocate((void**)&ptr, numElems * sizeof(T)));
+        // zero like make_unique<T[]>() does, blocks may be recycled
+        std::memset(ptr, 0, numElems * sizeof(T));
+        return std::shared_ptr<T>(ptr, [](T* ptr) {
+            try
+            {
+                if (ptr)
+                {
+                    MCF_CHECK_CUDA(mcf::cuda::hostAllocator.HostFree(ptr));
+                }
+            }
+            catch (mcf::cuda::cuda_error cudaError)
+            {
+                std::cerr << "GenArray: Deallocation failed." << std::endl;
+                std::cerr << cudaError.what() << std::endl;
+                return;
+            }
+        });
+    }
+
     // create unique array and convert to shared pointer with custom deleter
     std::unique_ptr<T[]> alloced = std::make_unique<T[]>(numElems);
     return std::shared_ptr<T>(alloced.release(), std::default_delete<T[]>());
@@ -119,6 +150,68 @@ std::shared_ptr<T> createCudaArray(int cudaDevice, size_t numElems)
     });
 }
 
+/**
+ * Helper function converting a device index to the device ID used by the CUDA
+ * managed memory functions (cudaCpuDeviceId for the CPU)
+ */
+inline int getManagedLocation(size_t deviceIndex)
+{
+    const size_t cudaIndex = getDeviceIndex(gen_array_base::Device::CUDA_0);
+    return deviceIndex < cudaIndex ? cudaCpuDeviceId : static_cast<int>(deviceIndex - cudaIndex);
+}
+
+/**
+ * Create managed array of requested size
+ *
+ * @param numElems          the number of elements to allocate
+ * @param preferredIndex    index of the device where the pages should preferably reside
+ *
+ * @return shared pointer with correct custom deleter to free managed memory
+ */
+template<typename T>
+std::shared_ptr<T> createManagedArray(size_t numElems, size_t preferredIndex)
+{
+    T* ptr = nullptr;
+    MCF_CHECK_CUDA(cudaMallocManaged((void**)&ptr, numElems * sizeof(T)));
+
+    // the advice is a hint only, not supported on all platforms
+    if (cudaMemAdvise(ptr, numElems * sizeof(T), cudaMemAdviseSetPreferredLocation,
+                      getManagedLocation(preferredIndex)) != cudaSuccess)
+    {
+        cudaGetLastError();
+    }
+
+    return std::shared_ptr<T>(ptr, [](T* ptr) {
+        try
+        {
+            if (ptr)
+            {
+                MCF_CHECK_CUDA(cudaFree(ptr));
+            }
+        }
+        catch (mcf::cuda::cuda_error cudaError)
+        {
+            std::cerr << "GenArray: Deallocation failed." << std::endl;
+            std::cerr << cudaError.what() << std::endl;
+            return;
+        }
+    });
+}
+
+/**
+ * Prefetch managed memory to a device
+ *
+ * Prefetching is a hint only, it is not supported on all platforms (e.g. without
+ * concurrent managed access), where the pages migrate on access instead.
+ */
+inline void prefetchManaged(const void* ptr, size_t numBytes, size_t deviceIndex, cudaStream_t stream)
+{
+    if (cudaMemPrefetchAsync(ptr, numBytes, getManagedLocation(deviceIndex), stream) != cudaSuccess)
+    {
+        cudaGetLastError();
+    }
+}
+
 /**
  * Create array of requested size on requested device
  */
@@ -223,6 +316,17 @@ void memcpyCpuToCpu(void* tgt, const void* src, size_t numBytes)
     memcpy(tgt, src, numBytes);
 }
 
+/**
+ * Table of copy kinds for asynchronous copies, indexed like COPY_FCT
+ */
+const cudaMemcpyKind COPY_KIND[gen_array_base::NUM_DEVICES][gen_array_base::NUM_DEVICES] =
+{ // source
+  // Device::CPU         | Device::CUDA_0         | Device::CUDA_1
+  {cudaMemcpyHostToHost,   cudaMemcpyDeviceToHost,   cudaMemcpyDeviceToHost},   // target Device::CPU
+  {cudaMemcpyHostToDevice, cudaMemcpyDeviceToDevice, cudaMemcpyDeviceToDevice}, // target Device::CUDA_0
+  {cudaMemcpyHostToDevice, cudaMemcpyDeviceToDevice, cudaMemcpyDeviceToDevice}, // target Device::CUDA_1
+};
+
 /**
  * Memcopy function type
  */
@@ -241,9 +345,144 @@ const CopyFct COPY_FCT[gen_array_base::NUM_DEVICES][gen_array_base::NUM_DEVICES]
   {memcpyCpuToCuda, memcpyCudaToCuda, memcpyCudaToCuda}, // target Device::CUDA_1
 };
 
+/**
+ * Helper function converting a CUDA device index to the CUDA device ID
+ */
+inline int getCudaDevice(size_t deviceIndex)
+{
+    return static_cast<int>(deviceIndex - getDeviceIndex(gen_array_base::Device::CUDA_0));
+}
+
+/**
+ * Check if a CUDA device index refers to a different CUDA device than another one
+ */
+inline bool isOtherCudaDevice(size_t deviceIndex, size_t otherIndex)
+{
+    const size_t cpuIndex = getDeviceIndex(gen_array_base::Device::CPU);
+    return deviceIndex != cpuIndex && otherIndex != cpuIndex && deviceIndex != otherIndex;
+}
+
+/**
+ * Table of direct peer access between the CUDA devices, by device index
+ *
+ * On first use, peer access is enabled for all pairs of devices whose topology allows it.
+ */
+class PeerAccess
+{
+public:
+    static const PeerAccess& instance()
+    {
+        static const PeerAccess peerAccess;
+        return peerAccess;
+    }
+
+    /**
+     * Check if tgtIndex can directly access the memory of srcIndex
+     */
+    bool enabled(size_t tgtIndex, size_t srcIndex) const
+    {
+        return fEnabled[tgtIndex][srcIndex];
+    }
+
+private:
+    PeerAccess()
+    {
+        int numDevices = 0;
+        if (cudaGetDeviceCount(&numDevices) != cudaSuccess)
+        {
+            cudaGetLastError();
+            return;
+        }
+        int currentDevice = 0;
+        MCF_CHECK_CUDA(cudaGetDevice(&currentDevice));
+
+        for (size_t tgtIndex = 0; tgtIndex < gen_array_base::NUM_DEVICES; ++tgtIndex)
+        {
+            for (size_t srcIndex = 0; srcIndex < gen_array_base::NUM_DEVICES; ++srcIndex)
+            {
+                if (!isOtherCudaDevice(tgtIndex, srcIndex)
+                    || getCudaDevice(tgtIndex) >= numDevices || getCudaDevice(srcIndex) >= numDevices)
+                {
+                    continue;
+                }
+                int canAccess = 0;
+                MCF_CHECK_CUDA(cudaDeviceCanAccessPeer(&canAccess, getCudaDevice(tgtIndex), getCudaDevice(srcIndex)));
+                if (!canAccess)
+                {
+                    continue;
+                }
+                MCF_CHECK_CUDA(cudaSetDevice(getCudaDevice(tgtIndex)));
+                const cudaError_t error = cudaDeviceEnablePeerAccess(getCudaDevice(srcIndex), 0);
+                if (error == cudaErrorPeerAccessAlreadyEnabled)
+                {
+                    // enabled by the application, clear the error state
+                    cudaGetLastError();
+                }
+                else
+                {
+                    MCF_CHECK_CUDA(error);
+                }
+                fEnabled[tgtIndex][srcIndex] = true;
+            }
+        }
+
+        // restore original cuda device
+        MCF_CHECK_CUDA(cudaSetDevice(currentDevice));
+    }
+
+    bool fEnabled[gen_array_base::NUM_DEVICES][gen_array_base::NUM_DEVICES] = {};
+};
+
+/**
+ * Relative cost of copying to the target device from the source device
+ *
+ * Copies within a device or between peers are cheapest, then copies over the bus between CPU
+ * and a CUDA device, while copies between CUDA devices without peer access are staged through
+ * CPU memory.
+ */
+inline int copyCost(size_t tgtIndex, size_t srcIndex)
+{
+    if (tgtIndex == srcIndex)
+    {
+        return 0;
+    }
+    if (!isOtherCudaDevice(tgtIndex, srcIndex))
+    {
+        return 2;
+    }
+    return PeerAccess::instance().enabled(tgtIndex, srcIndex) ? 1 : 3;
+}
+
+/**
+ * Select the device holding a copy which is cheapest to copy to the target device
+ *
+ * @param ptrs      the memory per device, null if the device holds no copy
+ * @param tgtIndex  target device index (i.e. device ID - FIRST_ID)
+ *
+ * @return  the source device index, NUM_DEVICES if no device holds a copy
+ */
+template<typename T>
+size_t cheapestSource(const std::shared_ptr<const T> (&ptrs)[gen_array_base::NUM_DEVICES], size_t tgtIndex)
+{
+    size_t result = gen_array_base::NUM_DEVICES;
+    int resultCost = std::numeric_limits<int>::max();
+    for (size_t srcIndex = 0; srcIndex < gen_array_base::NUM_DEVICES; ++srcIndex)
+    {
+        if (ptrs[srcIndex] && copyCost(tgtIndex, srcIndex) < resultCost)
+        {
+            result = srcIndex;
+            resultCost = copyCost(tgtIndex, srcIndex);
+        }
+    }
+    return result;
+}
+
 /**
  * Memcopy between devices
  *
+ * Copies between different CUDA devices are peer copies, which are direct if peer access
+ * is enabled.
+ *
  * @param tgtPtr        pointer to target memory on target device
  * @param tgtDevIndex   target device index (i.e. device ID - FIRST_ID)
  * @param srcPtr        pointer to source memory on source device
@@ -253,12 +492,51 @@ const CopyFct COPY_FCT[gen_array_base::NUM_DEVICES][gen_array_base::NUM_DEVICES]
 inline void deviceMemcopy(void* tgtPtr, size_t tgtDevIndex,
         const void* srcPtr, size_t srcDevIndex, size_t size)
 {
+    if (isOtherCudaDevice(tgtDevIndex, srcDevIndex))
+    {
+        MCF_CHECK_CUDA(cudaMemcpyPeer(tgtPtr, getCudaDevice(tgtDevIndex),
+                                      srcPtr, getCudaDevice(srcDevIndex), size));
+        return;
+    }
+
     // call copy function
     COPY_FCT[tgtDevIndex][srcDevIndex](tgtPtr, srcPtr, size);
 }
 
+/**
+ * Memcopy between devices, enqueued on a stream
+ *
+ * @param tgtPtr        pointer to target memory on target device
+ * @param tgtDevIndex   target device index (i.e. device ID - FIRST_ID)
+ * @param srcPtr        pointer to source memory on source device
+ * @param srcDevIndex   source device index (i.e. device ID - FIRST_ID)
+ * @param size          number of bytes to copy
+ * @param stream        the CUDA stream to copy in
+ */
+inline void deviceMemcopyAsync(void* tgtPtr, size_t tgtDevIndex,
+        const void* srcPtr, size_t srcDevIndex, size_t size, cudaStream_t stream)
+{
+    if (isOtherCudaDevice(tgtDevIndex, srcDevIndex))
+    {
+        MCF_CHECK_CUDA(cudaMemcpyPeerAsync(tgtPtr, getCudaDevice(tgtDevIndex),
+                                           srcPtr, getCudaDevice(srcDevIndex), size, stream));
+        return;
+    }
+    MCF_CHECK_CUDA(cudaMemcpyAsync(tgtPtr, srcPtr, size, COPY_KIND[tgtDevIndex][srcDevIndex], stream));
+}
+
 } // anonymous namespace
 
+void gen_array_base::setHostMemory(HostMemory hostMemory)
+{
+    hostMemoryKind.store(hostMemory);
+}
+
+gen_array_base::HostMemory gen_array_base::hostMemory()
+{
+    return hostMemoryKind.load();
+}
+
 
 /**
  * Pointer Container helper class
@@ -268,6 +546,55 @@ class gen_array_ptrs
 {
 public:
 
+    /**
+     * Wait for pending copies before the memory is released
+     */
+    ~gen_array_ptrs()
+    {
+        for (cudaEvent_t event : fCopyEvents)
+        {
+            if (event != nullptr)
+            {
+                cudaEventSynchronize(event);
+                cudaEventDestroy(event);
+            }
+        }
+    }
+
+    /**
+     * Block until an asynchronous copy to the device has completed
+     */
+    void waitForCopy(size_t index) const
+    {
+        if (fCopyEvents[index] != nullptr)
+        {
+            MCF_CHECK_CUDA(cudaEventSynchronize(fCopyEvents[index]));
+        }
+    }
+
+    /**
+     * Make later work on the stream wait for an asynchronous copy to the device
+     */
+    void streamWaitForCopy(size_t index, cudaStream_t stream) const
+    {
+        if (fCopyEvents[index] != nullptr)
+        {
+            MCF_CHECK_CUDA(cudaStreamWaitEvent(stream, fCopyEvents[index], 0));
+        }
+    }
+
+    /**
+     * Record the completion of an asynchronous copy to the device enqueued on the stream
+     */
+    void recordCopy(size_t index, cudaStream_t stream)
+    {
+        if (fCopyEvents[index] == nullptr)
+        {
+            MCF_CHECK_CUDA(cudaEventCreateWithFlags(&fCopyEvents[index], cudaEventDisableTiming));
+        }
+        MCF_CHECK_CUDA(cudaEventRecord(fCopyEvents[index], stream));
+    }
+
     /**
      * Shared pointers to the allocated memory locations per device.
      * Null, if not yet allocated.
@@ -291,6 +618,23 @@ public:
      */
     mutable std::mutex fPtrMutex;
 
+    /**
+     * Events marking the completion of asynchronous copies to the devices.
+     * Null, if the memory has been filled synchronously.
+     */
+    cudaEvent_t fCopyEvents[gen_array_base::NUM_DEVICES] = {};
+
+    /**
+     * Whether all devices share one managed array, see gen_array::initManaged()
+     */
+    bool fManaged = false;
+
+    /**
+     * Index of the device the managed array has last been prefetched to,
+     * NUM_DEVICES if not yet prefetched
+     */
+    size_t fManagedLocation = gen_array_base::NUM_DEVICES;
+
 };
 
 
@@ -374,6 +718,17 @@ gen_array<T>::gen_array(mcf::cuda::unique_array<T>&& source)
     fPtrContainer->fPtrs[getDeviceIndex(deviceId)] = array;
 }
 
+/*
+ * Constructor sharing memory on the given device
+ */
+template<typename T>
+gen_array<T>::gen_array(std::shared_ptr<T> source, Device device, size_t numElems)
+: fNumElems(numElems)
+, fPtrContainer(std::make_shared<gen_array_ptrs<T>>())
+{
+    fPtrContainer->fPtrs[getDeviceIndex(device)] = std::move(source);
+}
+
 /*
  * Destructor
  */
@@ -422,6 +777,42 @@ T* gen_array<T>::init(Device device, size_t numElems)
     return array.get();
 }
 
+/*
+ * Create a new array with given number of elements in managed memory
+ */
+template<typename T>
+T* gen_array<T>::initManaged(size_t numElems, Device preferredLocation)
+{
+    // create a new generic array
+    gen_array<T> genArray;
+
+    // create a managed array shared by all devices
+    std::shared_ptr<T> array = createManagedArray<T>(numElems, getDeviceIndex(preferredLocation));
+    for (auto& ptr : genArray.fPtrContainer->fPtrs)
+    {
+        ptr = array;
+    }
+    genArray.fPtrContainer->fManaged = true;
+    genArray.fNumElems = numElems;
+
+    // swap new array with this array
+    this->swap(genArray);
+
+    return array.get();
+}
+
+/*
+ * Check if the array is held in managed memory
+ */
+template<typename T>
+bool gen_array<T>::isManaged() const
+{
+    // prevent concurrent access to pointers
+    const std::lock_guard<std::mutex> lock(fPtrContainer->fPtrMutex);
+
+    return fPtrContainer->fManaged;
+}
+
 /**
  * Return a shared pointer to a const array on the desired device.
  *
@@ -448,6 +839,33 @@ const T* gen_array<T>::get(Device device) const
     return fPtrContainer->fPtrs[tgtIndex].get();
 }
 
+/*
+ * Return a pointer to a const array on the desired device, for use in the given stream.
+ */
+template<typename T>
+const T* gen_array<T>::get(Device device, cudaStream_t stream) const
+{
+    size_t tgtIndex = getDeviceIndex(device);
+
+    // prevent concurrent access to pointers
+    const std::lock_guard<std::mutex> lock(fPtrContainer->fPtrMutex);
+
+    // enqueue copy of data to desired device
+    copyToTargetAsync(tgtIndex, stream);
+
+    // return resulting pointer
+    return fPtrContainer->fPtrs[tgtIndex].get();
+}
+
+/*
+ * Start copying the contents to the desired device on the given stream
+ */
+template<typename T>
+void gen_array<T>::prefetch(Device device, cudaStream_t stream) const
+{
+    get(device, stream);
+}
+
 
 /*
  * Copy memory content to the specified target device
@@ -457,35 +875,123 @@ const T* gen_array<T>::get(Device device) const
 template<typename T>
 void gen_array<T>::copyToTarget(size_t tgtIndex) const
 {
-    // if data already on target device, do nothing
+    // managed memory is only prefetched, accesses before it completes migrate on demand
+    if (fPtrContainer->fManaged)
+    {
+        if (fPtrContainer->fManagedLocation != tgtIndex)
+        {
+            prefetchManaged(fPtrContainer->fPtrs[tgtIndex].get(), fNumElems * sizeof(T), tgtIndex, 0);
+            fPtrContainer->fManagedLocation = tgtIndex;
+        }
+        return;
+    }
+
+    // if data already on target device, only wait for a pending copy
     if (fPtrContainer->fPtrs[tgtIndex])
     {
+        fPtrContainer->waitForCopy(tgtIndex);
         return;
     }
 
-    // otherwise, copy from first device already having the data
-    // TODO: could possibly be optimized so that same device types (e.g CUDA)
-    //       are checked first
-    for (size_t srcIndex = 0; srcIndex < NUM_DEVICES; ++srcIndex)
+    // otherwise, copy from the device having the data which is cheapest to copy
+    const size_t srcIndex = cheapestSource(fPtrContainer->fPtrs, tgtIndex);
+    if (srcIndex == NUM_DEVICES)
     {
-        if (fPtrContainer->fPtrs[srcIndex])
+        // no data on any device, the target device remains null
+        return;
+    }
+
+    // source may still be filled by an asynchronous copy
+    fPtrContainer->waitForCopy(srcIndex);
+
+    // create array on target device
+    std::shared_ptr<T> array = makeArrayForDevIndex<T>(tgtIndex, fNumElems);
+
+    // copy data to target array
+    deviceMemcopy(array.get(), tgtIndex,
+            fPtrContainer->fPtrs[srcIndex].get(), srcIndex, fNumElems * sizeof(T));
+
+    // store pointer to copied array
+    fPtrContainer->fPtrs[tgtIndex] = array;
+}
+
+/*
+ * Enqueue a copy of the memory content to the specified target device on the stream
+ *
+ * Note: mutex of fPtrContainer must be locked before calling
+ */
+template<typename T>
+void gen_array<T>::copyToTargetAsync(size_t tgtIndex, cudaStream_t stream) const
+{
+    // managed memory is prefetched in stream order instead of copied
+    if (fPtrContainer->fManaged)
+    {
+        if (fPtrContainer->fManagedLocation != tgtIndex)
         {
-            // create array on target device
-            std::shared_ptr<T> array = makeArrayForDevIndex<T>(tgtIndex, fNumElems);
+            prefetchManaged(fPtrContainer->fPtrs[tgtIndex].get(), fNumElems * sizeof(T), tgtIndex, stream);
+            fPtrContainer->fManagedLocation = tgtIndex;
+        }
+        return;
+    }
+
+    // if data already on target device, only wait for a pending copy
+    if (fPtrContainer->fPtrs[tgtIndex])
+    {
+        fPtrContainer->streamWaitForCopy(tgtIndex, stream);
+        return;
+    }
 
-            // copy data to target array
-            deviceMemcopy(array.get(), tgtIndex,
-                    fPtrContainer->fPtrs[srcIndex].get(), srcIndex, fNumElems * sizeof(T));
+    // otherwise, copy from the device having the data which is cheapest to copy
+    const size_t srcIndex = cheapestSource(fPtrContainer->fPtrs, tgtIndex);
+    if (srcIndex == NUM_DEVICES)
+    {
+        return;
+    }
+
+    // source may still be filled by a copy on another stream
+    fPtrContainer->streamWaitForCopy(srcIndex, stream);
 
-            // store pointer to copied array
-            fPtrContainer->fPtrs[tgtIndex] = array;
+    // create array on target device
+    std::shared_ptr<T> array = makeArrayForDevIndex<T>(tgtIndex, fNumElems);
+
+    // enqueue copy of data to target array and record its completion
+    deviceMemcopyAsync(array.get(), tgtIndex,
+            fPtrContainer->fPtrs[srcIndex].get(), srcIndex, fNumElems * sizeof(T), stream);
+    fPtrContainer->fPtrs[tgtIndex] = array;
+    fPtrContainer->recordCopy(tgtIndex, stream);
+}
 
-            // exit loop
-            break;
+
+/*
+ * Return a pointer to the array on the desired device for writing.
+ */
+template<typename T>
+T* gen_array<T>::getForWrite(Device device)
+{
+    size_t tgtIndex = getDeviceIndex(device);
+
+    // prevent concurrent access to pointers
+    const std::lock_guard<std::mutex> lock(fPtrContainer->fPtrMutex);
+
+    // copy data to desired device
+    copyToTarget(tgtIndex);
+
+    // drop the other copies, managed memory is shared by all devices
+    if (!fPtrContainer->fManaged)
+    {
+        for (size_t index = 0; index < NUM_DEVICES; ++index)
+        {
+            if (index != tgtIndex && fPtrContainer->fPtrs[index])
+            {
+                // the copy may still be in progress
+                fPtrContainer->waitForCopy(index);
+                fPtrContainer->fPtrs[index].reset();
+            }
         }
     }
 
-    // at this point, the data have been copied to the target device remains null
+    // TODO: the pointers are stored as const, the container owns the memory
+    return const_cast<T*>(fPtrContainer->fPtrs[tgtIndex].get());
 }
 
 
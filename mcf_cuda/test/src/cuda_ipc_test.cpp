@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "gtest/gtest.h"
+#include "mcf_cuda/CudaIpc.h"
+
+#include "cuda_runtime.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mcf
+{
+namespace cuda
+{
+
+namespace
+{
+
+/// Number of exports a process may hold at the same time, see CudaIpc.cpp
+constexpr size_t TABLE_SLOTS = 256;
+
+/**
+ * Device memory freed once the last owner is gone, nullptr if there is no device
+ */
+std::shared_ptr<void> allocateDeviceMemory(size_t size)
+{
+    int count = 0;
+    void* ptr = nullptr;
+    if (cudaGetDeviceCount(&count) != cudaSuccess || count == 0
+        || cudaSetDevice(0) != cudaSuccess || cudaMalloc(&ptr, size) != cudaSuccess)
+    {
+        return nullptr;
+    }
+    return std::shared_ptr<void>(ptr, [](void* p) { cudaFree(p); });
+}
+
+} // anonymous namespace
+
+TEST(CudaIpcTest, WithdrawnExport)
+{
+    auto memory = allocateDeviceMemory(4096);
+    if (memory == nullptr)
+    {
+        GTEST_SKIP() << "no cuda device";
+    }
+
+    const std::string handle = exportDeviceMemory(memory, memory.get(), 4096, 0);
+    ASSERT_FALSE(handle.empty());
+    // the export keeps the memory alive
+    EXPECT_EQ(2, memory.use_count());
+
+    withdrawDeviceMemory(handle);
+    EXPECT_EQ(1, memory.use_count());
+    // a withdrawn export is rejected before its memory is mapped
+    EXPECT_EQ(nullptr, importDeviceMemory(handle).ptr);
+    // withdrawing again has no effect
+    withdrawDeviceMemory(handle);
+}
+
+TEST(CudaIpcTest, SlotsReclaimed)
+{
+    auto memory = allocateDeviceMemory(4096);
+    if (memory == nullptr)
+    {
+        GTEST_SKIP() << "no cuda device";
+    }
+
+    // exports which are never imported hold their slots
+    std::vector<std::string> handles;
+    for (size_t i = 0; i < TABLE_SLOTS; ++i)
+    {
+        handles.push_back(exportDeviceMemory(memory, memory.get(), 4096, 0));
+        ASSERT_FALSE(handles.back().empty());
+    }
+    EXPECT_TRUE(exportDeviceMemory(memory, memory.get(), 4096, 0).empty());
+
+    // until they are withdrawn
+    withdrawDeviceMemory(handles.front());
+    const std::string handle = exportDeviceMemory(memory, memory.get(), 4096, 0);
+    EXPECT_FALSE(handle.empty());
+    // the handle of the previous export of the slot does not refer to the new one
+    withdrawDeviceMemory(handles.front());
+    EXPECT_EQ(TABLE_SLOTS + 1, static_cast<size_t>(memory.use_count()));
+
+    withdrawDeviceMemory(handle);
+    for (const auto& withdrawn : handles)
+    {
+        withdrawDeviceMemory(withdrawn);
+    }
+    EXPECT_EQ(1, memory.use_count());
+}
+
+} // namespace cuda
+} // namespace mcf
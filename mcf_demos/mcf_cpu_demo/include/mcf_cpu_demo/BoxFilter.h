@@ -0,0 +1,40 @@
+/**
+ * Box filter kernel used by the ImageFilterComponent.
+ * 
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCFCPUDEMO_BOXFILTER_H__
+#define MCFCPUDEMO_BOXFILTER_H__
+
+
+#include <cstdint>
+
+
+namespace mcf_cpu_demo {
+
+/**
+ * Blurs an interleaved 8 bit image with a box filter of kernelSize x kernelSize pixels. The output
+ * is cropped by kernelSize - 1 pixels in each direction, i.e. output pixel (x, y) is the rounded
+ * average of the input pixels (x .. x + kernelSize - 1, y .. y + kernelSize - 1) of its channel.
+ *
+ * The filter is separable: each output row is computed from running sums over the rows and
+ * columns of the kernel, so that the cost per pixel does not depend on the kernel size. Column
+ * sums are updated with AVX2 or NEON if the build targets them. Bands of output rows are
+ * processed in parallel with mcf::parallelFor().
+ *
+ * @param src           first pixel of the input image
+ * @param srcPitch      bytes per input row
+ * @param dst           first pixel of the output image
+ * @param dstPitch      bytes per output row, at least outputWidth * numChannels
+ * @param outputWidth   output pixels per row, input width - kernelSize + 1
+ * @param outputHeight  output rows, input height - kernelSize + 1
+ * @param numChannels   interleaved channels per pixel
+ * @param kernelSize    kernel width and height, odd
+ */
+void boxFilter(const uint8_t* src, uint32_t srcPitch, uint8_t* dst, uint32_t dstPitch,
+               uint16_t outputWidth, uint16_t outputHeight, int numChannels, int kernelSize);
+
+} // namespace mcf_cpu_demo
+
+
+#endif // MCFCPUDEMO_BOXFILTER_H__
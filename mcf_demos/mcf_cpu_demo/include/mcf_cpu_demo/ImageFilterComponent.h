@@ -1,7 +1,7 @@
 /**
- * Receives images on a QueuedReceiverPort. Every time a new image is received, it convolves each 
- * pixel in the image sequentially with a [box filter](https://en.wikipedia.org/wiki/Box_blur) 
- * kernel. It then sends the blurred image on a SenderPort.
+ * Receives images on a QueuedReceiverPort. Every time a new image is received, it convolves the 
+ * image with a [box filter](https://en.wikipedia.org/wiki/Box_blur) kernel, see boxFilter(). It 
+ * then sends the blurred image on a SenderPort.
  * 
  * Copyright (c) 2024 Accenture
  */
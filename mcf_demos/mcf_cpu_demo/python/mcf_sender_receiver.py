@@ -53,21 +53,22 @@ class McfImageSender(McfValueCommunicator):
     """
     Send an image to MCF via the remote control.
     """
-    def send_img_uint8(self, image_data: np.ndarray, topic: str) -> None:
+    def send_img_uint8(self, image_data: np.ndarray, topic: str, timestamp: int = 0) -> None:
         """
         Send the given image to the given topic on the value store
 
         :param image_data:         image data, may be grayscale, RGB or None
         :param topic:              the value store topic
+        :param timestamp:          timestamp of the image value
         """
-        processed_img = self.process_raw_image(image_data)
+        processed_img = self.process_raw_image(image_data, timestamp)
         self.send_value(
             value=processed_img,
             value_type=DemoImageUint8,
             topic=topic)
 
     @staticmethod
-    def process_raw_image(image: np.ndarray) -> DemoImageUint8:
+    def process_raw_image(image: np.ndarray, timestamp: int = 0) -> DemoImageUint8:
         # If image is None, create dummy value with image format NONE (= 0);
         # otherwise create image value from given data
         if image is None:
@@ -99,7 +100,6 @@ class McfImageSender(McfValueCommunicator):
             height, width = image.shape[:2]
             pitch = width * pixel_size
             img_data = np.reshape(image, [-1]).astype(np.uint8)
-            timestamp = 0
             img_data = img_data.tobytes()
             value = DemoImageUint8(
                 width,
@@ -7,6 +7,7 @@ Copyright (c) 2024 Accenture
 """
 import os
 import argparse
+import time
 from PIL import Image
 import numpy as np
 import typing
@@ -16,6 +17,7 @@ from mcf import RemoteControl
 from mcf_sender_receiver import McfValueCommunicator, McfImageSender, McfImageReceiver
 
 from value_types.mcf_cpu_demo_value_types.demo_types.DemoImageFilterParams import DemoImageFilterParams
+from value_types.mcf_cpu_demo_value_types.demo_types.DemoImageUint8 import DemoImageUint8
 
 
 class McfCpuDemo:
@@ -24,7 +26,7 @@ class McfCpuDemo:
     filter_params_topic = "/filter/params"
     blurred_img_topic = "/image/blurred"
     
-    def __init__(self, target_ip: str, target_port: int):
+    def __init__(self, target_ip: str, target_port: int, blurred_only: bool = False):
         self.remote_control = RemoteControl()
         self.remote_control.connect(target_ip, target_port)
 
@@ -32,12 +34,14 @@ class McfCpuDemo:
         self.mcf_image_receiver = McfImageReceiver(self.remote_control)
         self.mcf_value_communicator = McfValueCommunicator(self.remote_control)
 
-        self._initialise_port_queues()
+        self._initialise_port_queues(blurred_only)
 
-    def _initialise_port_queues(self):
-        # Set queue size
-        self.remote_control.set_queue(McfCpuDemo.raw_img_topic, 1, blocking=True)
-        self.remote_control.set_queue(McfCpuDemo.inverted_img_topic, 1, blocking=True)
+    def _initialise_port_queues(self, blurred_only: bool):
+        # Set queue size. The benchmark only receives the blurred images, so that it does not
+        # measure the transfer of the intermediate images.
+        if not blurred_only:
+            self.remote_control.set_queue(McfCpuDemo.raw_img_topic, 1, blocking=True)
+            self.remote_control.set_queue(McfCpuDemo.inverted_img_topic, 1, blocking=True)
         self.remote_control.set_queue(McfCpuDemo.blurred_img_topic, 1, blocking=True)
 
     def send_image_filter_params(self, kernel_size: int):
@@ -47,8 +51,15 @@ class McfCpuDemo:
             value_type=DemoImageFilterParams,
             topic=McfCpuDemo.filter_params_topic)
 
-    def send_raw_image(self, image: np.ndarray):
-        self.mcf_image_sender.send_img_uint8(image, McfCpuDemo.raw_img_topic)
+    def send_raw_image(self, image: np.ndarray, timestamp: int = 0):
+        self.mcf_image_sender.send_img_uint8(image, McfCpuDemo.raw_img_topic, timestamp)
+
+    def wait_for_blurred_image(self, timestamp: int):
+        # The timestamp is passed through the pipeline, skip results of earlier images.
+        while True:
+            blurred_img = self.mcf_image_receiver.get_value(DemoImageUint8, McfCpuDemo.blurred_img_topic)
+            if blurred_img is not None and blurred_img.timestamp == timestamp:
+                return
 
     def wait_for_received_images(self) -> typing.Tuple[np.ndarray, np.ndarray, np.ndarray]:
         raw_img = None
@@ -67,12 +78,39 @@ class McfCpuDemo:
         return raw_img, inverted_img, blurred_img
 
 
-def main(target_ip: str, target_port: int, input_img_path: str, kernel_size: int):
+def benchmark(mcf_demo: McfCpuDemo, input_img: np.ndarray, num_frames: int):
+    """
+    Sends num_frames images one after the other, each after the result of the previous one has been
+    received, and prints the throughput and the end-to-end latency from sending an image to receiving
+    its blurred image.
+    """
+    input_img = np.asarray(input_img)
+    latencies = []
+    start = time.perf_counter()
+    for frame in range(1, num_frames + 1):
+        send_time = time.perf_counter()
+        mcf_demo.send_raw_image(input_img, timestamp=frame)
+        mcf_demo.wait_for_blurred_image(timestamp=frame)
+        latencies.append(time.perf_counter() - send_time)
+    duration = time.perf_counter() - start
+
+    latencies_ms = np.array(latencies) * 1000.0
+    print("Frames:       {} ({}x{})".format(num_frames, input_img.shape[1], input_img.shape[0]))
+    print("Throughput:   {:.1f} frames/s".format(num_frames / duration))
+    print("Latency [ms]: mean {:.2f}, median {:.2f}, p99 {:.2f}, max {:.2f}".format(
+        latencies_ms.mean(), np.median(latencies_ms), np.percentile(latencies_ms, 99), latencies_ms.max()))
+
+
+def main(target_ip: str, target_port: int, input_img_path: str, kernel_size: int, benchmark_frames: int):
     assert os.path.exists(input_img_path), "Input image does not exist."
     input_img = Image.open(input_img_path)
 
-    mcf_demo = McfCpuDemo(target_ip, target_port)
+    mcf_demo = McfCpuDemo(target_ip, target_port, blurred_only=benchmark_frames > 0)
     mcf_demo.send_image_filter_params(kernel_size)
+    if benchmark_frames > 0:
+        benchmark(mcf_demo, input_img, benchmark_frames)
+        return
+
     mcf_demo.send_raw_image(input_img)
     raw_img, inverted_img, blurred_img = mcf_demo.wait_for_received_images()
 
@@ -95,10 +133,16 @@ if __name__ == '__main__':
         default=3,
         type=int,
         help="Size of box filter kernel used by ImageFilterComponent")
+    parser.add_argument(
+        "--benchmark",
+        default=0,
+        type=int,
+        metavar="NUM_FRAMES",
+        help="Send the image NUM_FRAMES times and report frames/s and latency instead of showing the results")
     args = parser.parse_args()
 
     target_ip = args.target_ip
     target_port = args.target_port
     input_img_path = args.input_img_path
     kernel_size = args.kernel_size
-    main(target_ip, target_port, input_img_path, kernel_size)
+    main(target_ip, target_port, input_img_path, kernel_size, args.benchmark)
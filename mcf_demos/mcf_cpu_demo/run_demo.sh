@@ -9,12 +9,20 @@ echo_in_yellow() {
 }
 SCRIPT_DIR=$(dirname -- $0)
 
-# Parse input kernel size argument
+# Parse the optional benchmark argument and the input kernel size argument
+BENCHMARK_ARGS=()
+if [ "$1" == "--benchmark" ]
+then
+  BENCHMARK_ARGS=(--benchmark $2)
+  shift 2
+fi
+
 if [ "$#" -eq 1 ]
 then
   KERNEL_SIZE=$1
 else
   echo_in_yellow "Optional: Pass an integer for the box filter kernel size";
+  echo_in_yellow "Optional: Pass --benchmark <num_frames> before it to report frames/s and latency instead of showing the images";
 fi
 
 # Add the generated python value types and mcf_tools to the python path
@@ -27,9 +35,9 @@ ${SCRIPT_DIR}/build/McfCpuDemo ${SCRIPT_DIR}/config &
 # results. Uses KERNEL_SIZE if it's been set.
 if [ -z ${KERNEL_SIZE+x} ]
 then
-  python ${SCRIPT_DIR}/python/process_images.py 127.0.0.1 6666 ${SCRIPT_DIR}/data/test_image.jpg
+  python ${SCRIPT_DIR}/python/process_images.py 127.0.0.1 6666 ${SCRIPT_DIR}/data/test_image.jpg "${BENCHMARK_ARGS[@]}"
 else
-  python ${SCRIPT_DIR}/python/process_images.py 127.0.0.1 6666 ${SCRIPT_DIR}/data/test_image.jpg  --kernel_size ${KERNEL_SIZE}
+  python ${SCRIPT_DIR}/python/process_images.py 127.0.0.1 6666 ${SCRIPT_DIR}/data/test_image.jpg  --kernel_size ${KERNEL_SIZE} "${BENCHMARK_ARGS[@]}"
 fi
 
 # Kill the main demo executable
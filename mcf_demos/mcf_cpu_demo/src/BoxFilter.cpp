@@ -0,0 +1,161 @@
+/**
+ * See header file for documentation.
+ * 
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_cpu_demo/BoxFilter.h"
+#include "mcf_core/ParallelFor.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+namespace {
+
+// Minimum number of output rows per parallel band. Each band first sums kernelSize input rows,
+// so bands much shorter than the kernel would mostly repeat that work.
+constexpr size_t MIN_ROWS_PER_BAND = 16;
+
+
+/**
+ * Divides sums of up to 2^24 by a fixed divisor of up to 2^16 with a multiplication, exactly
+ * rounding down for all such sums.
+ */
+class Divider
+{
+public:
+    explicit Divider(uint32_t divisor)
+    : fMultiplier(((uint64_t(1) << SHIFT) + divisor - 1) / divisor) {}
+
+    uint32_t operator()(uint32_t value) const
+    {
+        return static_cast<uint32_t>((value * fMultiplier) >> SHIFT);
+    }
+
+private:
+    static constexpr int SHIFT = 40;
+    uint64_t fMultiplier;
+};
+
+
+/**
+ * Sums kernelSize neighbouring pixels of each channel along a row:
+ * rowSums[x] = src[x] + src[x + numChannels] + ... + src[x + (kernelSize - 1) * numChannels]
+ */
+void sumRow(const uint8_t* src, uint32_t* rowSums, size_t rowLength, int numChannels, int kernelSize)
+{
+    const size_t span = static_cast<size_t>(kernelSize) * numChannels;
+    for (int c = 0; c < numChannels; ++c)
+    {
+        uint32_t sum = 0;
+        for (size_t i = c; i < span; i += numChannels)
+        {
+            sum += src[i];
+        }
+        rowSums[c] = sum;
+    }
+    for (size_t x = numChannels; x < rowLength; ++x)
+    {
+        rowSums[x] = rowSums[x - numChannels] + src[x - numChannels + span] - src[x - numChannels];
+    }
+}
+
+
+/**
+ * columnSums[x] += add[x] - subtract[x], subtract may be nullptr
+ */
+void updateColumnSums(uint32_t* columnSums, const uint32_t* add, const uint32_t* subtract, size_t length)
+{
+    size_t x = 0;
+#if defined(__AVX2__)
+    for (; x + 8 <= length; x += 8)
+    {
+        __m256i sums = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(columnSums + x));
+        sums = _mm256_add_epi32(sums, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(add + x)));
+        if (subtract != nullptr)
+        {
+            sums = _mm256_sub_epi32(sums, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(subtract + x)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(columnSums + x), sums);
+    }
+#elif defined(__ARM_NEON)
+    for (; x + 4 <= length; x += 4)
+    {
+        uint32x4_t sums = vaddq_u32(vld1q_u32(columnSums + x), vld1q_u32(add + x));
+        if (subtract != nullptr)
+        {
+            sums = vsubq_u32(sums, vld1q_u32(subtract + x));
+        }
+        vst1q_u32(columnSums + x, sums);
+    }
+#endif
+    for (; x < length; ++x)
+    {
+        columnSums[x] += add[x] - (subtract != nullptr ? subtract[x] : 0);
+    }
+}
+
+
+/**
+ * Computes the output rows [rowBegin, rowEnd), keeping the row sums of the last kernelSize input
+ * rows and of the next one in a ring buffer.
+ */
+void boxFilterRows(const uint8_t* src, uint32_t srcPitch, uint8_t* dst, uint32_t dstPitch,
+                   size_t rowLength, int numChannels, int kernelSize, size_t rowBegin, size_t rowEnd)
+{
+    const size_t ringSize = kernelSize + 1;
+    std::vector<uint32_t> rowSums(ringSize * rowLength);
+    std::vector<uint32_t> columnSums(rowLength, 0);
+    const Divider divide(static_cast<uint32_t>(kernelSize * kernelSize));
+    const uint32_t half = static_cast<uint32_t>(kernelSize * kernelSize) / 2;
+
+    for (int i = 0; i < kernelSize; ++i)
+    {
+        uint32_t* sums = &rowSums[i * rowLength];
+        sumRow(src + (rowBegin + i) * srcPitch, sums, rowLength, numChannels, kernelSize);
+        updateColumnSums(columnSums.data(), sums, nullptr, rowLength);
+    }
+
+    for (size_t row = rowBegin; row < rowEnd; ++row)
+    {
+        uint8_t* out = dst + row * dstPitch;
+        for (size_t x = 0; x < rowLength; ++x)
+        {
+            out[x] = static_cast<uint8_t>(divide(columnSums[x] + half));
+        }
+
+        if (row + 1 < rowEnd)
+        {
+            // Move the kernel down by one row: add the row below it, remove its first row.
+            const uint32_t* firstSums = &rowSums[((row - rowBegin) % ringSize) * rowLength];
+            uint32_t* nextSums = &rowSums[((row - rowBegin + kernelSize) % ringSize) * rowLength];
+            sumRow(src + (row + kernelSize) * srcPitch, nextSums, rowLength, numChannels, kernelSize);
+            updateColumnSums(columnSums.data(), nextSums, firstSums, rowLength);
+        }
+    }
+}
+
+} // namespace
+
+
+namespace mcf_cpu_demo {
+
+void boxFilter(const uint8_t* src, uint32_t srcPitch, uint8_t* dst, uint32_t dstPitch,
+               uint16_t outputWidth, uint16_t outputHeight, int numChannels, int kernelSize)
+{
+    const size_t rowLength = static_cast<size_t>(outputWidth) * numChannels;
+    const size_t rowsPerBand = std::max(MIN_ROWS_PER_BAND, static_cast<size_t>(4 * kernelSize));
+    mcf::parallelFor(0, outputHeight, rowsPerBand, [&](size_t rowBegin, size_t rowEnd)
+    {
+        boxFilterRows(src, srcPitch, dst, dstPitch, rowLength, numChannels, kernelSize, rowBegin, rowEnd);
+    });
+}
+
+} // namespace mcf_cpu_demo
@@ -4,6 +4,7 @@
  * Copyright (c) 2024 Accenture
  */
 #include "mcf_cpu_demo/ImageFilterComponent.h"
+#include "mcf_cpu_demo/BoxFilter.h"
 #include "mcf_core/util/JsonValueExtractor.h"
 #include "mcf_core/LoggingMacros.h"
 #include "mcf_core/ErrorMacros.h"
@@ -12,14 +13,6 @@
 
 namespace {
 
-size_t getBufferIdx(const size_t rowIdx, const size_t colIdx, const uint32_t pitch, uint16_t height)
-{
-    MCF_ASSERT(rowIdx >= 0 && rowIdx < height);
-    MCF_ASSERT(colIdx >= 0 && colIdx < pitch);
-    return rowIdx * pitch + colIdx;
-}
-
-
 void validateKernelSize(const int kernelSize)
 {
     MCF_ASSERT(kernelSize % 2 != 0, "Kernel size should be odd.");
@@ -97,26 +90,27 @@ void ImageFilterComponent::updateImageFilterParams()
 
 void ImageFilterComponent::onNewImage()
 {
-    // Check if the port queue currently has a value.
-    while (fInvertedImageInPort.hasValue())
+    // Take all values currently in the port queue at once, oldest first. This consumes the values.
+    fInvertedImageInPort.drain([this](const std::shared_ptr<const DemoImageUint8>& image)
     {
         MCF_DEBUG("New image received.");
 
         updateImageFilterParams();
 
-        // Get the oldest value in the port queue. This operation consumes the value.
-        const std::shared_ptr<const DemoImageUint8> image = fInvertedImageInPort.getValue();
         DemoImageUint8 blurredImage = blurImage(*image);
 
         // Write the output MCF value to the sender port.
         fBlurredImageOutPort.setValue(std::move(blurredImage));
-    }
+    });
 }
 
 
 values::mcf_cpu_demo_value_types::demo_types::DemoImageUint8 ImageFilterComponent::blurImage(const DemoImageUint8& image) const
 {
     int numChannels = (image.format == values::mcf_cpu_demo_value_types::demo_types::GRAY) ? 1 : 3;
+    MCF_ASSERT(image.width >= fKernelSize && image.height >= fKernelSize, "Kernel size exceeds the image size.");
+    MCF_ASSERT(image.pitch >= image.width * numChannels && image.extMemSize() >= image.pitch * image.height,
+               "Image buffer is smaller than its size.");
 
     // Output image will be cropped according to the size of the box filter kernel.
     const uint16_t outputWidth = image.width - fKernelSize + 1;
@@ -126,35 +120,10 @@ values::mcf_cpu_demo_value_types::demo_types::DemoImageUint8 ImageFilterComponen
 
     std::unique_ptr<uint8_t[]> blurredImageBuffer = std::make_unique<uint8_t[]>(outputImageBufferLength);
 
-    const uint8_t* imageBuffer = image.extMemPtr();
-    const int halfSize = fKernelSize / 2;
-    for (size_t rowIdx=0; rowIdx<outputHeight; ++rowIdx)
-    {
-        for (size_t colIdx=0; colIdx<outputPitch; ++colIdx)
-        {
-            const size_t outputIdx = getBufferIdx(rowIdx, colIdx, outputPitch, outputHeight);
-
-            const size_t inputImgRowIdx = rowIdx + halfSize;
-            const size_t inputImgColIdx = colIdx + (halfSize * numChannels);
-
-            // Get the average of the pixels in the kernel neighbourhood in the original image.
-            int pixelSum = 0;
-            for (int i=-halfSize; i<halfSize + 1; ++i)
-            {
-                for (int j=-halfSize; j<halfSize + 1; ++j)
-                {
-                    const size_t inputIdx = getBufferIdx(
-                        inputImgRowIdx + j,
-                        inputImgColIdx + (i * numChannels),
-                        image.pitch,
-                        image.height);
-                    pixelSum += imageBuffer[inputIdx];
-                }
-
-            }
-            blurredImageBuffer[outputIdx] = round(static_cast<float>(pixelSum) / (fKernelSize * fKernelSize));
-        }
-    }
+    // Each output pixel is the rounded average of the pixels in its kernel neighbourhood in the
+    // original image.
+    boxFilter(image.extMemPtr(), image.pitch, blurredImageBuffer.get(), outputPitch,
+              outputWidth, outputHeight, numChannels, fKernelSize);
 
     // Initialise the output MCF value.
     DemoImageUint8 blurredImage(outputWidth, outputHeight, outputPitch, image.format, image.timestamp);
@@ -0,0 +1,31 @@
+"""
+Packing of vectors of numbers in the bulk wire format of generated value types, see
+mcf_core/BulkArray.h
+
+Copyright (c) 2024 Accenture
+"""
+import array
+import sys
+
+
+# the bulk format is little endian
+_SWAP_BYTES = sys.byteorder != "little"
+
+
+def pack_array(fmt: str, values) -> bytes:
+    """ Returns the little endian elements of values as bytes, fmt is their struct format """
+    elements = array.array(fmt, values)
+    if _SWAP_BYTES:
+        elements.byteswap()
+    return elements.tobytes()
+
+
+def unpack_array(fmt: str, data) -> list:
+    """ Returns the elements of bytes packed by pack_array() as list """
+    elements = array.array(fmt)
+    if len(data) % elements.itemsize != 0:
+        raise ValueError("Bulk array of incomplete elements")
+    elements.frombytes(data)
+    if _SWAP_BYTES:
+        elements.byteswap()
+    return elements.tolist()
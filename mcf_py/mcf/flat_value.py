@@ -0,0 +1,93 @@
+"""
+Reader and writer of the flat wire format of generated value types, see mcf_core/FlatValue.h
+
+Copyright (c) 2024 Accenture
+"""
+import enum
+import struct
+import sys
+
+import msgpack
+
+from mcf.value import Value
+
+
+# the flat format is little endian, arrays are only viewed in place on little endian hosts
+_VIEW_ARRAYS = sys.byteorder == "little"
+
+
+def _encode_serializable(o):
+    if isinstance(o, Value):
+        return o.serialize()[0]
+    elif isinstance(o, enum.Enum):
+        return o.value
+    return o
+
+
+class FlatWriter:
+    """ Builds the packed form of a flat value """
+
+    def __init__(self, fixed_size: int):
+        self._buffer = bytearray(fixed_size)
+
+    def scalar(self, offset: int, fmt: str, value) -> None:
+        struct.pack_into("<" + fmt, self._buffer, offset, value)
+
+    def string(self, offset: int, value: str) -> None:
+        data = value.encode("utf-8")
+        self._reference(offset, self._append(data, 1), len(data))
+
+    def array(self, offset: int, fmt: str, values) -> None:
+        data = struct.pack(f"<{len(values)}{fmt}", *values)
+        self._reference(offset, self._append(data, struct.calcsize(fmt)), len(values))
+
+    def packed(self, offset: int, value) -> None:
+        data = msgpack.packb(value, default=_encode_serializable)
+        self._reference(offset, self._append(data, 1), len(data))
+
+    def data(self) -> bytes:
+        return bytes(self._buffer)
+
+    def _append(self, data: bytes, alignment: int) -> int:
+        offset = (len(self._buffer) + alignment - 1) // alignment * alignment
+        self._buffer.extend(bytes(offset - len(self._buffer)))
+        self._buffer.extend(data)
+        return offset
+
+    def _reference(self, offset: int, target: int, size: int) -> None:
+        struct.pack_into("<II", self._buffer, offset, target, size)
+
+
+class FlatReader:
+    """
+    Reads the attributes of a flat value in place from its packed form, which must not be
+    changed while the reader and the arrays read from it are in use
+    """
+
+    def __init__(self, data, fixed_size: int):
+        self._data = memoryview(data).cast("B")
+        if len(self._data) < fixed_size:
+            raise ValueError("Flat value shorter than its fixed part")
+
+    def scalar(self, offset: int, fmt: str):
+        return struct.unpack_from("<" + fmt, self._data, offset)[0]
+
+    def string(self, offset: int) -> str:
+        return str(self._target(offset, 1), "utf-8")
+
+    def array(self, offset: int, fmt: str):
+        """ Returns a memoryview of the elements, or a list on big endian hosts """
+        data = self._target(offset, struct.calcsize(fmt))
+        if _VIEW_ARRAYS:
+            return data.cast(fmt)
+        return [element[0] for element in struct.iter_unpack("<" + fmt, data)]
+
+    def unpacked(self, offset: int):
+        return msgpack.unpackb(self._target(offset, 1), raw=False, strict_map_key=False)
+
+    def _target(self, offset: int, element_size: int) -> memoryview:
+        start, size = struct.unpack_from("<II", self._data, offset)
+        end = start + size * element_size
+        if end > len(self._data):
+            raise ValueError("Flat value reference out of bounds")
+        return self._data[start:end]
@@ -19,11 +19,30 @@ Example usage without indexing (can be considerably faster than with indexing):
     for record in record_generator:
         # process record
 
+Recordings of a stopped ValueRecorder end with a footer holding the record counts per topic
+and time checkpoints, see read_footer(). records_generator() uses it to start at a given time
+without reading the file up to there.
+
+Records of topics with chunk compression are stored in compressed chunks on CHUNK_TOPIC. The
+reader decompresses them one chunk at a time and returns the contained records in their place.
+
+Records of topics with delta encoding (typeid mcf::RecordDelta) are reconstructed and returned
+with the type id, value and ext mem data of the recorded value. Reconstruction starts at a
+keyframe, delta records without a preceding keyframe are skipped.
+
 Copyright (c) 2024 Accenture
 """
+import bisect
 import msgpack
+import os
+import struct
 import zlib
 
+FOOTER_TOPIC = '/mcf/recorder/footer'
+FOOTER_MAGIC = b'MCFINDX1'
+CHUNK_TOPIC = '/mcf/recorder/chunk'
+DELTA_TYPEID = 'mcf::RecordDelta'
+
 class RecordReader:
 
     class Record:
@@ -32,6 +51,8 @@ class RecordReader:
             self.topic = None
             self.typeid = None
             self.valueid = None
+            # sequence number of the write of the value to its topic, 0 in recordings which do not have it
+            self.seq = 0
             self.value = None
             self.value_size = None
             self.value_index = None
@@ -39,6 +60,8 @@ class RecordReader:
             self.extmem_index = None
             self.extmem_present = None
             self.extmem_size_compressed = 0
+            # ext mem data of records from a chunk, which cannot be read from the file
+            self.extmem_data = None
 
     def __init__(self):
         pass
@@ -48,6 +71,9 @@ class RecordReader:
 
     def index(self, filter=None, unpack_value=False):
         self._index = []
+        # previous payloads and record locations since the keyframe per delta encoded topic
+        payloads = {}
+        chains = {}
         self.file.seek(0, 0)
         unpacker = msgpack.Unpacker(self.file, raw=False)
         unpacker_file_start_pos = self.file.tell()
@@ -58,7 +84,10 @@ class RecordReader:
                 p_header = unpacker.unpack()
 
                 value_start = unpacker.tell()
-                value = unpacker.unpack() if unpack_value else unpacker.skip()
+                if unpack_value or p_header[1] == CHUNK_TOPIC or p_header[2] == DELTA_TYPEID:
+                    value = unpacker.unpack()
+                else:
+                    value = unpacker.skip()
                 value_size = unpacker.tell() - value_start
 
                 m_header = unpacker.unpack()
@@ -83,16 +112,34 @@ class RecordReader:
                 record.topic = p_header[1]
                 record.typeid = p_header[2]
                 record.valueid = p_header[3]
+                record.seq = p_header[4] if len(p_header) > 4 else 0
                 record.value_size = value_size
                 record.value_index = value_start
                 record.extmem_size = extmem_size
                 record.extmem_index = extmem_start
                 record.extmem_present = extmem_present
                 record.extmem_size_compressed = extmem_size_compressed
-                record.value = value if unpack_value else None
+                record.value = value
 
-                if filter is None or filter(record):
-                    self._index.append(idx)
+                if record.topic == CHUNK_TOPIC:
+                    # records in chunks are indexed by the chunk offset and their position
+                    for i, chunk_record in enumerate(self._chunk_records(record)):
+                        entry = (idx, i)
+                        if chunk_record.typeid == DELTA_TYPEID:
+                            chunk_record, entry = self._index_delta(
+                                chunk_record, entry, payloads, chains)
+                        if chunk_record is not None and (filter is None or filter(chunk_record)):
+                            self._index.append(entry)
+                    self.file.seek(unpacker_file_start_pos + unpacker.tell(), 0)
+                    continue
+
+                entry = idx
+                if record.typeid == DELTA_TYPEID:
+                    position = unpacker_file_start_pos + unpacker.tell()
+                    record, entry = self._index_delta(record, entry, payloads, chains)
+                    self.file.seek(position, 0)
+                if record is not None and (filter is None or filter(record)):
+                    self._index.append(entry)
 
             except msgpack.exceptions.OutOfData:
                 break
@@ -107,6 +154,17 @@ class RecordReader:
         for idx in range(start_idx, end_idx):
             if idx >= len(self._index):
                 break
+            if isinstance(self._index[idx], tuple) and self._index[idx][0] == 'delta':
+                _, chain, length = self._index[idx]
+                payloads = {}
+                for location in chain[:length]:
+                    record = self._resolve_delta(self._record_at_location(location), payloads)
+                records.append(record)
+                continue
+            if isinstance(self._index[idx], tuple):
+                chunk_offset, position = self._index[idx]
+                records.append(self._read_chunk(chunk_offset)[position])
+                continue
             self.file.seek(self._index[idx], 0)
             unpacker = msgpack.Unpacker(self.file, raw=False)
             unpacker_file_start_pos = self.file.tell()
@@ -136,6 +194,7 @@ class RecordReader:
                 record.topic = p_header[1]
                 record.typeid = p_header[2]
                 record.valueid = p_header[3]
+                record.seq = p_header[4] if len(p_header) > 4 else 0
                 record.value = value
                 record.value_size = value_size
                 record.extmem_size = extmem_size
@@ -148,8 +207,64 @@ class RecordReader:
                 break
         return records
 
-    def records_generator(self, filter=None):
-        self.file.seek(0, 0)
+    def read_footer(self):
+        """
+        Return the footer of the file as dict, or None for files of an older or still running
+        recorder.
+        """
+        self.file.seek(0, os.SEEK_END)
+        file_size = self.file.tell()
+        if file_size < 16:
+            return None
+        self.file.seek(file_size - 16, 0)
+        trailer = self.file.read(16)
+        if trailer[8:] != FOOTER_MAGIC:
+            return None
+        footer_offset = struct.unpack('<Q', trailer[:8])[0]
+        if footer_offset >= file_size:
+            return None
+        self.file.seek(footer_offset, 0)
+        unpacker = msgpack.Unpacker(self.file, raw=False)
+        try:
+            p_header = unpacker.unpack()
+            if p_header[1] != FOOTER_TOPIC:
+                return None
+            value = unpacker.unpack()
+        except msgpack.exceptions.OutOfData:
+            return None
+        topics, counts, start_time, end_time, times, offsets, index_blocks = value
+        return {
+            'topics': dict(zip(topics, counts)),
+            'start_time': start_time,
+            'end_time': end_time,
+            'times': times,
+            'offsets': offsets,
+            'index_blocks': index_blocks,
+        }
+
+    def topics(self):
+        """
+        Return the number of records per topic from the footer, or None without footer.
+        """
+        footer = self.read_footer()
+        return footer['topics'] if footer is not None else None
+
+    def _seek_offset(self, start_time):
+        footer = self.read_footer()
+        if footer is None or not footer['times']:
+            return 0
+        # last checkpoint not after start_time, records before it are older
+        pos = bisect.bisect_right(footer['times'], start_time) - 1
+        return footer['offsets'][pos] if pos >= 0 else 0
+
+    def records_generator(self, filter=None, start_time=None):
+        """
+        Yield the records of the file, from the first record at or after start_time (ms) if given.
+        """
+        offset = self._seek_offset(start_time) if start_time is not None else 0
+        # each checkpoint is followed by keyframes of the delta encoded topics
+        payloads = {}
+        self.file.seek(offset, 0)
         unpacker = msgpack.Unpacker(self.file, raw=False)
         unpacker_file_start_pos = self.file.tell()
         while True:
@@ -182,6 +297,7 @@ class RecordReader:
                 record.topic = p_header[1]
                 record.typeid = p_header[2]
                 record.valueid = p_header[3]
+                record.seq = p_header[4] if len(p_header) > 4 else 0
                 record.value_size = value_size
                 record.extmem_size = extmem_size
                 record.extmem_index = extmem_start
@@ -189,13 +305,149 @@ class RecordReader:
                 record.extmem_size_compressed = extmem_size_compressed
                 record.value = value
 
+                if record.topic == CHUNK_TOPIC:
+                    chunk_records = self._chunk_records(record)
+                    # continue after the chunk, the generator may be paused in between
+                    position = unpacker_file_start_pos + unpacker.tell()
+                    for chunk_record in chunk_records:
+                        if chunk_record.typeid == DELTA_TYPEID:
+                            chunk_record = self._resolve_delta(chunk_record, payloads)
+                            if chunk_record is None:
+                                continue
+                        if start_time is not None and chunk_record.timestamp < start_time:
+                            continue
+                        if filter is None or filter(chunk_record):
+                            yield chunk_record
+                    self.file.seek(position, 0)
+                    continue
+
+                if record.typeid == DELTA_TYPEID:
+                    position = unpacker_file_start_pos + unpacker.tell()
+                    record = self._resolve_delta(record, payloads)
+                    self.file.seek(position, 0)
+                    if record is None:
+                        continue
+                if start_time is not None and record.timestamp < start_time:
+                    continue
                 if filter is None or filter(record):
                     yield record
 
             except msgpack.exceptions.OutOfData:
                 break
 
+    def _chunk_records(self, chunk):
+        """
+        Return the records of a chunk record, whose file position is changed.
+        """
+        if chunk.value[0] != 'deflate':
+            raise ValueError(f'Unsupported chunk codec {chunk.value[0]}')
+        data = self.get_extmem(chunk)
+        unpacker = msgpack.Unpacker(raw=False, max_buffer_size=len(data) + 1)
+        unpacker.feed(data)
+        records = []
+        for _ in range(chunk.value[1]):
+            p_header = unpacker.unpack()
+            value_start = unpacker.tell()
+            value = unpacker.unpack()
+            value_size = unpacker.tell() - value_start
+            m_header = unpacker.unpack()
+
+            record = RecordReader.Record()
+            record.timestamp = p_header[0]
+            record.topic = p_header[1]
+            record.typeid = p_header[2]
+            record.valueid = p_header[3]
+            record.seq = p_header[4] if len(p_header) > 4 else 0
+            record.value = value
+            record.value_size = value_size
+            record.extmem_size = m_header[0]
+            record.extmem_present = m_header[1]
+            if record.extmem_present:
+                record.extmem_data = unpacker.read_bytes(record.extmem_size)
+            records.append(record)
+        return records
+
+    def _resolve_delta(self, delta, payloads):
+        """
+        Return the record reconstructed from a delta record and the previous payloads per topic,
+        which are updated, or None without keyframe. The file position is changed.
+        """
+        tid, keyframe, value_size, extmem_size, extmem_present = delta.value
+        data = self.get_extmem(delta)
+        if keyframe:
+            payload = data
+        elif delta.topic in payloads:
+            payload = _apply_delta_runs(
+                payloads[delta.topic], data, value_size + (extmem_size if extmem_present else 0))
+        else:
+            return None
+        payloads[delta.topic] = payload
+
+        record = RecordReader.Record()
+        record.timestamp = delta.timestamp
+        record.topic = delta.topic
+        record.typeid = tid
+        record.valueid = delta.valueid
+        record.seq = delta.seq
+        record.value = msgpack.unpackb(payload[:value_size], raw=False)
+        record.value_size = value_size
+        record.extmem_size = extmem_size
+        record.extmem_present = extmem_present
+        if extmem_present:
+            record.extmem_data = payload[value_size:]
+        return record
+
+    def _index_delta(self, delta, location, payloads, chains):
+        """
+        Return the reconstructed record of a delta record and its index entry, which refers to
+        the locations of the records needed to reconstruct it.
+        """
+        record = self._resolve_delta(delta, payloads)
+        if record is None:
+            return None, None
+        if delta.value[1]:
+            chains[delta.topic] = [location]
+        else:
+            chains[delta.topic].append(location)
+        chain = chains[delta.topic]
+        return record, ('delta', chain, len(chain))
+
+    def _record_at_location(self, location):
+        if isinstance(location, tuple):
+            return self._read_chunk(location[0])[location[1]]
+        return self.record_at(location)
+
+    def _read_chunk(self, offset):
+        if getattr(self, '_chunk_cache', (None, None))[0] != offset:
+            chunk = self.record_at(offset)
+            self._chunk_cache = (offset, self._chunk_records(chunk))
+        return self._chunk_cache[1]
+
+    def record_at(self, offset):
+        """
+        Return the record at a file offset, without expanding chunks.
+        """
+        self.file.seek(offset, 0)
+        unpacker = msgpack.Unpacker(self.file, raw=False)
+        p_header = unpacker.unpack()
+        value = unpacker.unpack()
+        m_header = unpacker.unpack()
+        record = RecordReader.Record()
+        record.timestamp = p_header[0]
+        record.topic = p_header[1]
+        record.typeid = p_header[2]
+        record.valueid = p_header[3]
+        record.seq = p_header[4] if len(p_header) > 4 else 0
+        record.value = value
+        record.extmem_size = m_header[0]
+        record.extmem_present = m_header[1]
+        record.extmem_size_compressed = m_header[2] if len(m_header) > 2 else 0
+        record.extmem_index = offset + unpacker.tell()
+        return record
+
     def get_extmem(self, record):
+        if record.extmem_data is not None:
+            return record.extmem_data
         if record.extmem_present:
             self.file.seek(record.extmem_index, 0)
             if record.extmem_size_compressed != 0:
@@ -210,3 +462,33 @@ class RecordReader:
 
     def close(self):
         self.file.close()
+
+
+def _read_varint(data, pos):
+    result = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        result |= (byte & 0x7f) << shift
+        if byte & 0x80 == 0:
+            return result, pos
+        shift += 7
+
+
+def _apply_delta_runs(previous, runs, size):
+    """
+    Return the payload of size bytes encoded by runs relative to the previous payload.
+    """
+    payload = bytearray(size)
+    pos = 0
+    run_pos = 0
+    while pos < size:
+        unchanged, run_pos = _read_varint(runs, run_pos)
+        payload[pos:pos + unchanged] = previous[pos:pos + unchanged]
+        pos += unchanged
+        changed, run_pos = _read_varint(runs, run_pos)
+        payload[pos:pos + changed] = runs[run_pos:run_pos + changed]
+        run_pos += changed
+        pos += changed
+    return bytes(payload)
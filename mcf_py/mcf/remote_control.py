@@ -4,7 +4,7 @@ Copyright (c) 2024 Accenture
 from mcf.value import Value
 
 from enum import Enum, IntEnum
-from typing import Type, Optional, Tuple, List, Iterator, TYPE_CHECKING
+from typing import Type, Optional, Tuple, List, Dict, Iterator, TYPE_CHECKING
 import zmq
 import msgpack
 from io import BytesIO
@@ -43,7 +43,8 @@ class ReplayParams(object):
 
     def __init__(self, run_mode, run_without_drops, speed_factor, pipeline_end_trigger_names,
                  wait_input_event_name, wait_input_event_topic,
-                 step_time_microseconds):
+                 step_time_microseconds, unthrottled=False, deterministic=False,
+                 lookahead_microseconds=0):
         self.run_mode = ReplayParams.RunMode(run_mode)
         self.run_without_drops = run_without_drops
         self.speed_factor = speed_factor
@@ -51,6 +52,9 @@ class ReplayParams(object):
         self.wait_input_event_name = wait_input_event_name
         self.wait_input_event_topic = wait_input_event_topic
         self.step_time_microseconds = step_time_microseconds
+        self.unthrottled = unthrottled
+        self.deterministic = deterministic
+        self.lookahead_microseconds = lookahead_microseconds
 
     def __eq__(self, other):
         if not isinstance(other, ReplayParams):
@@ -62,7 +66,10 @@ class ReplayParams(object):
                self.pipeline_end_trigger_names == other.pipeline_end_trigger_names and \
                self.wait_input_event_name == other.wait_input_event_name and \
                self.wait_input_event_topic == other.wait_input_event_topic and \
-               self.step_time_microseconds == other.step_time_microseconds
+               self.step_time_microseconds == other.step_time_microseconds and \
+               self.unthrottled == other.unthrottled and \
+               self.deterministic == other.deterministic and \
+               self.lookahead_microseconds == other.lookahead_microseconds
 
     def __str__(self):
         return "run_mode : {}\n" \
@@ -71,9 +78,14 @@ class ReplayParams(object):
                "trigger names : {}\n" \
                "wait name : {}\n" \
                "wait topic : {}\n" \
-               "step time : {}".format(self.run_mode, self.run_without_drops, self.speed_factor,
+               "step time : {}\n" \
+               "unthrottled : {}\n" \
+               "deterministic : {}\n" \
+               "lookahead : {}".format(self.run_mode, self.run_without_drops, self.speed_factor,
                                        self.pipeline_end_trigger_names, self.wait_input_event_name,
-                                       self.wait_input_event_topic, self.step_time_microseconds)
+                                       self.wait_input_event_topic, self.step_time_microseconds,
+                                       self.unthrottled, self.deterministic,
+                                       self.lookahead_microseconds)
 
 
 class RemoteControl:
@@ -90,8 +102,16 @@ class RemoteControl:
         """
 
         self.communicator = ZmqCommunicator(timeout, own_thread)
+        self._ip = None
+        # SUB socket for the values of subscribed topics, connected on the first subscription
+        self._subscriber = None
+        # PUSH socket for streaming values, see open_injection()
+        self._injector = None
 
     def connect(self, ip: str, port: int) -> bool:
+        self._close_subscriber()
+        self.close_injection()
+        self._ip = ip
         self.communicator.connect(ip, port)
 
         # try a test command to check the connection
@@ -112,6 +132,8 @@ class RemoteControl:
         return self.communicator.is_connected()
 
     def disconnect(self) -> None:
+        self._close_subscriber()
+        self.close_injection()
         self.communicator.disconnect()
 
     def get_info(self) -> bool or dict:
@@ -197,6 +219,62 @@ class RemoteControl:
     def disable_event_queue(self) -> None:
         self.enable_event_queue(enabled=False)
 
+    def open_injection(self, max_queued: int=0, high_water_mark: int=1000) -> bool:
+        """
+        Open a stream for writing values with inject_value(), which does not wait for a response
+        per value like write_value(). inject_value() blocks once +high_water_mark+ values are on
+        their way, the flux process stops reading the stream while its event queue holds
+        +max_queued+ (0: no limit) events or more.
+        """
+        response = self._send(msgpack.packb({'command': 'inject_port', 'max_queued': max_queued}))
+        if not RemoteControl.check_response(response):
+            return False
+        if self._injector is None:
+            self._injector = zmq.Context.instance().socket(zmq.PUSH)
+            self._injector.setsockopt(zmq.SNDHWM, high_water_mark)
+            self._injector.connect('tcp://{}:{}'.format(self._ip, response['content']['port']))
+        return True
+
+    def inject_value(
+        self,
+        topic: str,
+        clazz: str,
+        value: list,
+        extmem: Optional[bytes]=None,
+        timestamp: Optional[int]=None,
+        valueId: int=0,
+        component: str="",
+        port: str="") -> None:
+        """
+        Stream a value opened by open_injection(), the arguments are the same as for write_value().
+        Errors are not reported per value, but counted by get_event_queue_state() along with the
+        number of injected values.
+        """
+        def encode_serializable(o):
+            if isinstance(o, Value):
+                return o.serialize()[0]
+            elif isinstance(o, Enum):
+                return o.value
+            return o
+
+        if self._injector is None:
+            raise RcError('injection is not open')
+        header = {'topic': topic, 'component': component, 'port': port}
+        if timestamp is not None:
+            header['timestamp'] = timestamp
+        packed = msgpack.packb(clazz) + msgpack.packb(value, default=encode_serializable)
+        if valueId != 0:
+            packed = msgpack.packb(valueId) + packed
+        self._injector.send_multipart([msgpack.packb(header), packed, extmem or b''])
+
+    def close_injection(self) -> None:
+        """
+        Close the stream opened by open_injection(), values not yet sent are sent first
+        """
+        if self._injector is not None:
+            self._injector.close()
+            self._injector = None
+
     def _unpack_msgpack(self, data: bytes) -> dict:
         if data is None: return data
         unpacked = msgpack.unpackb(data, raw=False)
@@ -206,28 +284,32 @@ class RemoteControl:
         packed = self.communicator.send(msg)
         return self._unpack_msgpack(packed)
 
+    @staticmethod
+    def _unpack_value(packed_value: bytes, extmem: Optional[bytes], withId: bool) -> Tuple:
+        io = BytesIO(packed_value)
+        try:
+            unpacker = msgpack.Unpacker(io, raw=False)
+            valueId = unpacker.unpack()
+            typename = unpacker.unpack()
+            value = unpacker.unpack()
+        except:
+            raise RcError('read failed: Value did not have the expected format.')
+
+        if withId:
+            return valueId, value, typename, extmem
+        else:
+            return value, typename, extmem
+
     def _decode_value(self, packed_value: bytes, extmem: bytes, withId: bool, packedResponse: bytes
     ) -> Tuple[Optional[Tuple], bool]:
         response = self._unpack_msgpack(packedResponse)
         if response is not None and response['type'] == 'response':
             if packed_value is not None:
-                io = BytesIO(packed_value)
-                try:
-                    unpacker = msgpack.Unpacker(io, raw=False)
-                    valueId = unpacker.unpack()
-                    typename = unpacker.unpack()
-                    value = unpacker.unpack()
-
-                    if withId:
-                        retVal = (valueId, value, typename, extmem)
-                    else:
-                        retVal = (value, typename, extmem)
-                    if 'has_more' in response['content']:
-                        return retVal, response['content']['has_more']
-                    else:
-                        return retVal, False
-                except:
-                    raise RcError('read failed: Value did not have the expected format.')
+                retVal = RemoteControl._unpack_value(packed_value, extmem, withId)
+                if 'has_more' in response['content']:
+                    return retVal, response['content']['has_more']
+                else:
+                    return retVal, False
             else:
                 # the has_more attribute indicates that a queue is present
                 if 'has_more' in response['content']:
@@ -257,10 +339,77 @@ class RemoteControl:
                 break
         return values
 
+    def read_values(self, topics: List[str], withId: bool=False) -> Dict[str, 'ValueT']:
+        """
+        Read the latest values of several topics in a single round trip. Topics without value or
+        with a type unknown to the flux process map to None. Queues set with set_queue() are
+        not read, use read_value() for them.
+        """
+        cmd = msgpack.packb({'command': 'read_values', 'topics': topics})
+        packed_response, frames = self.communicator.read_frames(cmd)
+        response = self._unpack_msgpack(packed_response)
+        if response is None or response['type'] != 'response':
+            raise RcError('read failed: ' + (response['content'] if response else 'no response'))
+
+        values = {}
+        # every value found is sent as packed value and ext mem frame, which may be empty
+        frame_iter = iter(frames)
+        for topic, found in zip(topics, response['content']['found']):
+            if found:
+                packed_value = next(frame_iter)
+                extmem = next(frame_iter)
+                values[topic] = RemoteControl._unpack_value(packed_value, extmem or None, withId)
+            else:
+                values[topic] = None
+        return values
+
     def listen(self, topic: str) -> Iterator['ValueT']:
         while True:
             yield self.read_value(topic)
 
+    def subscribe(self, topic: str, max_rate: float=0.) -> bool:
+        """
+        Let the flux process publish the values of +topic+ whenever they change, at most
+        +max_rate+ times per second (0: every change). The published values are received with
+        receive_published(). Subscriptions are shared by all clients of the flux process, the
+        last max_rate requested for a topic applies.
+        """
+        if self._subscriber is None:
+            response = self._send(msgpack.packb({'command': 'publish_port'}))
+            if not RemoteControl.check_response(response):
+                return False
+            self._subscriber = zmq.Context.instance().socket(zmq.SUB)
+            self._subscriber.setsockopt(zmq.LINGER, 0)
+            self._subscriber.connect('tcp://{}:{}'.format(self._ip, response['content']['port']))
+
+        self._subscriber.setsockopt(zmq.SUBSCRIBE, topic.encode())
+        cmd = msgpack.packb({'command': 'subscribe', 'topic': topic, 'max_rate': max_rate})
+        response = self._send(cmd)
+        return RemoteControl.check_response(response)
+
+    def unsubscribe(self, topic: str) -> bool:
+        if self._subscriber is not None:
+            self._subscriber.setsockopt(zmq.UNSUBSCRIBE, topic.encode())
+        cmd = msgpack.packb({'command': 'unsubscribe', 'topic': topic})
+        response = self._send(cmd)
+        return RemoteControl.check_response(response)
+
+    def receive_published(self, timeout: int=1000, withId: bool=False
+    ) -> Optional[Tuple[str, 'ValueT']]:
+        """
+        Wait up to +timeout+ ms for the next value published for a subscription.
+        Returns the topic and the value, or None on timeout.
+        """
+        if self._subscriber is None or self._subscriber.poll(timeout) == 0:
+            return None
+        topic, packed_value, extmem = self._subscriber.recv_multipart()
+        return topic.decode(), RemoteControl._unpack_value(packed_value, extmem or None, withId)
+
+    def _close_subscriber(self) -> None:
+        if self._subscriber is not None:
+            self._subscriber.close()
+            self._subscriber = None
+
     def disconnect_port(self, component: str, port: str) -> bool:
         cmd = msgpack.packb({'command': 'disconnect_port', 'component': component, 'port': port})
         response = self._send(cmd)
@@ -373,7 +522,10 @@ class RemoteControl:
                              'pipeline_end_trigger_names': replay_params.pipeline_end_trigger_names,
                              'wait_input_event_name': replay_params.wait_input_event_name,
                              'wait_input_event_topic': replay_params.wait_input_event_topic,
-                             'step_time_microseconds': replay_params.step_time_microseconds})
+                             'step_time_microseconds': replay_params.step_time_microseconds,
+                             'unthrottled': replay_params.unthrottled,
+                             'deterministic': replay_params.deterministic,
+                             'lookahead_microseconds': replay_params.lookahead_microseconds})
 
         response = self._send(cmd)
         return RemoteControl.check_response(response)
@@ -391,13 +543,97 @@ class RemoteControl:
                                          params['pipeline_end_trigger_names'],
                                          params['wait_input_event_name'],
                                          params['wait_input_event_topic'],
-                                         params['step_time_microseconds'])
+                                         params['step_time_microseconds'],
+                                         params.get('unthrottled', False),
+                                         params.get('deterministic', False),
+                                         params.get('lookahead_microseconds', 0))
 
             return replay_params
         else:
             print('ERROR: ' + response['content'])
             return False
 
+    def get_value_store_stats(self) -> bool or dict:
+        """
+        Per topic value store statistics. Statistics are only collected while enabled on the
+        value store, e.g. by running a ValueStoreStatsPublisher.
+        """
+        cmd = msgpack.packb({'command': 'value_store_stats'})
+        response = self._send(cmd)
+        if response is None:
+            return False
+        elif response['type'] == 'response':
+            return response['content']
+        else:
+            print('ERROR: ' + response['content'])
+            return False
+
+    def get_trace_filter(self) -> bool or dict:
+        """
+        Whether component tracing is enabled, and the rules of the trace filter. No rules trace
+        all events.
+        """
+        cmd = msgpack.packb({'command': 'get_trace_filter'})
+        response = self._send(cmd)
+        if response is None:
+            return False
+        elif response['type'] == 'response':
+            return response['content']
+        else:
+            print('ERROR: ' + response['content'])
+            return False
+
+    def set_trace_filter(self, rules: Optional[List[dict]] = None, enabled: Optional[bool] = None) -> bool:
+        """
+        Select the traced events and enable or disable tracing, None keeps the current state.
+        Each rule is a dict with the optional keys 'component' and 'topic' (glob patterns,
+        default '*'), 'events' (event type names such as 'port_write' or 'trigger_exec',
+        default all) and 'sampling' (trace every n-th matching event, default 1). An event is
+        traced if any rule selects it, an empty list traces all events.
+        """
+        request = {'command': 'set_trace_filter'}
+        if rules is not None:
+            request['rules'] = rules
+        if enabled is not None:
+            request['enabled'] = enabled
+        response = self._send(msgpack.packb(request))
+        return RemoteControl.check_response(response)
+
+    def reset_handler_stats(self, component: str, interval_ms: int = 0) -> bool:
+        """
+        Discard the current handler statistics window of a component instance. A non-zero
+        interval_ms also changes the window length. The statistics are published as
+        mcf::HandlerStats on /mcf/stats/<component>/handlers.
+        """
+        return self.write_value('/mcf/stats/' + component + '/control',
+                                'mcf::HandlerStatsControl', [True, interval_ms])
+
+    def seek(self, time: int, pre_roll_microseconds: int = 0) -> bool:
+        """
+        Jump to a simulation time in microseconds. The events of pre_roll_microseconds before
+        time are fired right away to warm up the component state, then playback continues.
+        """
+        cmd = msgpack.packb({'command': 'seek',
+                             'time': time,
+                             'pre_roll_microseconds': pre_roll_microseconds})
+        response = self._send(cmd)
+        return RemoteControl.check_response(response)
+
+    def get_step_latency(self) -> bool or dict:
+        """
+        Latency of the replay steps requested with set_playback_modifier(STEPONCE), from the
+        request to the first event fired after it: count, p50_ns, p99_ns and max_ns.
+        """
+        cmd = msgpack.packb({'command': 'get_sim_time'})
+        response = self._send(cmd)
+        if response is None:
+            return False
+        elif response['type'] == 'response':
+            return response['content']['step_latency']
+        else:
+            print('ERROR: ' + response['content'])
+            return False
+
     def get_sim_time(self) -> bool or int:
         cmd = msgpack.packb({'command': 'get_sim_time'})
         response = self._send(cmd)
@@ -111,6 +111,19 @@ class ZmqCommunicator:
     def read_value(self, topic: str):
         return self.worker.submit(self._read_value, topic)
 
+    def _read_frames(self, cmd: bytes):
+        response = self._send(cmd)
+        frames = []
+        while self.socket.getsockopt(zmq.RCVMORE) > 0:
+            frames.append(self._receive())
+        return response, frames
+
+    def read_frames(self, cmd: bytes):
+        """
+        Send a command and return its response along with all frames following it
+        """
+        return self.worker.submit(self._read_frames, cmd)
+
     def _send(self, msg: bytes) -> bytes:
         if type(msg) == list:
             for part in msg:
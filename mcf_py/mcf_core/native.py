@@ -0,0 +1,274 @@
+"""
+ValueStore, ValueQueue and ComponentManager backed by the C++ mcf_core
+
+The classes have the API of their pure python counterparts in value_store.py, which they replace
+if the native module _mcf_native is built (cmake option BUILD_PYTHON, see mcf_py/native). Python
+objects are passed between python components as they are, values of C++ components are converted
+into the python value types passed to the ValueStore, their ExtMem data is a memoryview of the
+C++ value without copying.
+
+Copyright (c) 2024 Accenture
+"""
+import msgpack
+
+from mcf_core import _mcf_native
+
+
+class ValueStore:
+
+    def __init__(self, list_of_types=()):
+        """
+        :param list_of_types: python value types generated by the types_generator, which are
+                              converted to and from their C++ type if it is registered in the
+                              value store, e.g. by a plugin loaded by the NativeComponentManager
+        """
+        self._native = _mcf_native.ValueStore()
+        self._types_lookup = {}
+        for tp in list_of_types:
+            self._types_lookup[tp().serialize()[1]] = tp
+
+    @property
+    def native(self):
+        return self._native
+
+    def add_receiver(self, key, receiver):
+        """
+        Add a receiver for the given key
+        :param key:         the key (= "topic")
+        :param receiver:    the receiver (e.g. a ValueQueue)
+        """
+        if isinstance(receiver, ValueQueue):
+            receiver.attach(self, key)
+        else:
+            self._native.add_receiver(key, receiver)
+
+    def add_all_topic_receiver(self, receiver):
+        """
+        Add a receiver listening to all topic
+        :param receiver: the receiver (e.g. a ValueQueue)
+        """
+        if isinstance(receiver, ValueQueue):
+            receiver.attach(self, None)
+        else:
+            self._native.add_all_topic_receiver(receiver)
+
+    def set_value(self, key, value):
+        """
+        Set the given value into the value store for the given key. (For now: only non-blocking access supported)
+
+        Values of a python value type whose C++ type is registered are converted, so that C++
+        components can read them.
+        """
+        if value is None:
+            raise RuntimeError("Value store does not accept setting None values")
+
+        serialize = getattr(value, "serialize", None)
+        if serialize is not None:
+            serialized = serialize()
+            if self._native.has_type(serialized[1]):
+                self._native.set_packed(key,
+                                        serialized[1],
+                                        msgpack.packb(serialized[0], use_bin_type=True),
+                                        serialized[2] if len(serialized) > 2 else None,
+                                        getattr(value, "id", 0))
+                return
+
+        self._native.set_value(key, value)
+
+    def get_value(self, key: str):
+        """
+        Return the current value stored for the given key. May return None.
+        """
+        return self.from_native(self._native.get_value(key))
+
+    def get_keys(self):
+        return self._native.get_keys()
+
+    def from_native(self, value):
+        """
+        Convert a value of a C++ type to its python type, or to the list [attributes, type name,
+        ExtMem] if no python type was passed for it
+        """
+        if not isinstance(value, _mcf_native.NativeValue):
+            return value
+
+        fields, type_name, extmem = value.pack()
+        serialized = [msgpack.unpackb(fields, raw=False), type_name]
+        if extmem is not None:
+            serialized.append(memoryview(extmem))
+
+        tp = self._types_lookup.get(type_name, None)
+        if tp is None:
+            return serialized
+
+        converted = tp.deserialize(serialized)
+        converted.inject_id(value.id)
+        return converted
+
+
+class ValueQueue:
+    """
+    A Value Queue can be registered at the ValueStore as a receiver so that
+    value updates for a specific topic are pushed into the queue.
+
+    The queue holds both, the actual value and the topic it came from.
+    Each queue entry consists of a pair (value, topic).
+
+    If triggers are registered to the queue, they will be activated whenever
+    the queue receives a new value.
+    """
+
+    def __init__(self, maxlen=0, ctrace_event_gen=None):
+        """
+        @param maxlen:           Maximal number of items in the queue; 0 means infinite.
+                                 When the queue is full, oldest entries will be dropped upon reception of new values.
+        @param ctrace_event_gen: An optional component trace event generator for tracing value store access events.
+        """
+        self._native = _mcf_native.ValueQueue(maxlen)
+        self._trace_generator = ctrace_event_gen
+        self._value_store = None
+        self._registrations = []
+        self._expired = False
+
+    def attach(self, value_store, key):
+        """
+        Called by the ValueStore when the queue is added for the given key, None for all topics
+        """
+        if (value_store, key) in self._registrations:
+            return
+        if key is None:
+            value_store.native.add_all_topic_queue(self._native)
+        else:
+            value_store.native.add_queue(key, self._native)
+        self._value_store = value_store
+        self._registrations.append((value_store, key))
+
+    @property
+    def empty(self):
+        return self._native.empty
+
+    @property
+    def size(self):
+        return self._native.size
+
+    @property
+    def maxlen(self):
+        return self._native.maxlen
+
+    @maxlen.setter
+    def maxlen(self, value):
+        self._native.maxlen = value
+
+    @property
+    def component_trace_event_generator(self):
+        return self._trace_generator
+
+    def peek(self):
+        """
+        :return: the value (without topic) at the front (oldest entry) of the queue without removing it from the queue
+        """
+        return self.peek_with_topic()[0]
+
+    def pop(self):
+        """
+        :return: the value (without topic) at the front (oldest entry) of the queue and remove the entry from the queue
+        """
+        return self.pop_with_topic()[0]
+
+    def peek_with_topic(self):
+        """
+        :return: the value-topic pair at the front (oldest entry) of the queue without removing it from the queue
+        """
+        topic_value = self._convert(self._native.peek_with_topic())
+        if topic_value is not None and self._trace_generator is not None:
+            self._trace_generator.trace_peek_port_value(topic_value[1], True, topic_value[0])
+        return topic_value
+
+    def pop_with_topic(self):
+        """
+        :return: the value-topic pair at the front (oldest entry) of the queue and remove the entry from the queue
+        """
+        topic_value = self._convert(self._native.pop_with_topic())
+        if topic_value is not None and self._trace_generator is not None:
+            self._trace_generator.trace_get_port_value(topic_value[1], True, topic_value[0])
+        return topic_value
+
+    def receive(self, topic, value):
+        """
+        Receive the given topic and value, if receiver is not expired
+        :param topic: the topic
+        :param value: the value
+        :return: whether the receiver is expired
+        """
+        if not self._expired:
+            self._native.receive(topic, value)
+        return self._expired
+
+    def add_event(self, event):
+        """
+        Add the given event to be notified
+        """
+        self._native.add_event(event)
+
+    def expire(self):
+        """
+        "Destructor": Invalidate the trigger, i.e. disable it and remove it from the value store
+        """
+        self._expired = True
+        for value_store, key in self._registrations:
+            if key is None:
+                value_store.native.remove_all_topic_queue(self._native)
+            else:
+                value_store.native.remove_queue(key, self._native)
+        self._registrations = []
+
+    @property
+    def expired(self):
+        return self._expired
+
+    @property
+    def last_topic_and_time(self):
+        return self._native.last_topic_and_time
+
+    def _convert(self, topic_value):
+        if topic_value is None or self._value_store is None:
+            return topic_value
+        return self._value_store.from_native(topic_value[0]), topic_value[1]
+
+
+class NativeComponentManager:
+    """
+    Runs C++ components loaded from plugins (see mcf_core/PluginInterface.h) in the value store
+    of the python components
+
+    A plugin may additionally export
+        extern "C" void mcfRegisterValueTypes(mcf::TypeRegistry&);
+    registering the value types of its components, so that they are exchanged with python.
+    """
+
+    def __init__(self, value_store: ValueStore, config_dirs=()):
+        self._native = _mcf_native.ComponentManager(value_store.native, list(config_dirs))
+
+    def load_plugin(self, file_name):
+        """
+        :return: the qualified names of the component types of the plugin
+        """
+        return self._native.load_plugin(file_name)
+
+    def create_component(self, type_name, instance_name):
+        """
+        :return: the id of the component instance
+        """
+        return self._native.create_component(type_name, instance_name)
+
+    def map_port(self, comp_id, port_name, topic):
+        self._native.map_port(comp_id, port_name, topic)
+
+    def configure(self):
+        return self._native.configure()
+
+    def startup(self):
+        self._native.startup()
+
+    def shutdown(self):
+        self._native.shutdown()
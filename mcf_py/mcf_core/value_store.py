@@ -4,6 +4,7 @@ Copyright (c) 2024 Accenture
 
 import collections
 from datetime import datetime
+import os
 import threading
 
 from mcf_core.events import EventSource
@@ -255,4 +256,16 @@ class ValueQueue(EventSource):
     @property
     def last_topic_and_time(self):
         with self._lock:
-            return self._last_receive_topic, self._last_receive_time
\ No newline at end of file
+            return self._last_receive_topic, self._last_receive_time
+
+
+# The pure python implementation is replaced by the native backing if it is built, unless the
+# environment variable MCF_PY_NATIVE is set to 0, see mcf_core/native.py
+PyValueStore = ValueStore
+PyValueQueue = ValueQueue
+
+if os.environ.get("MCF_PY_NATIVE", "1") != "0":
+    try:
+        from mcf_core.native import ValueStore, ValueQueue
+    except ImportError:
+        pass
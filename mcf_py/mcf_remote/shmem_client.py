@@ -0,0 +1,126 @@
+"""
+Copyright (c) 2024 Accenture
+"""
+
+import ctypes
+import mmap
+import os
+import struct
+import weakref
+
+import msgpack
+
+
+SHMEM_PREFIX = "shm://"
+SHMEM_DIRECTORY = "/dev/shm"
+# prefix of the names of the buffers of a C++ MemfdShmem, see ShmemMemfd.h
+MEMFD_PREFIX = "memfd:"
+
+# distance between the start of a slot and its payload, see ShmemSlotHeader in ShmemSlot.h
+SLOT_HEADER_SIZE = 64
+
+
+def parse_connection(connection):
+    """
+    Splits a connection into the zmq socket name and the name of the shared memory file,
+    mirroring parseConnectionName() in ZmqMsgPackUtils.h
+
+    :param connection:  "shm://[filename]" or any other zmq connection
+    :return:            Tuple of the socket name and the shared memory file name, which is None
+                        if the connection does not use shared memory
+    """
+    if not connection.startswith(SHMEM_PREFIX):
+        return connection, None
+
+    shmem_file = connection[len(SHMEM_PREFIX):]
+    return f"ipc:///tmp/{shmem_file}", shmem_file
+
+
+class ShmemClient:
+    """
+    Accesses the shared memory allocated by a C++ ShmemKeeper, the Python counterpart of the C++
+    ShmemClient. It is used on the receiving side of a shm:// connection.
+
+    ExtMem parts are not copied out of the shared memory, they are returned as memoryviews of the
+    slot they were sent in, e.g. to be wrapped with numpy.frombuffer(). The slot is handed back to
+    the sender once the last view referring to it has been garbage collected, so values should
+    not be held longer than needed, otherwise the sender runs out of slots.
+    """
+
+    def __init__(self):
+        # senders with a C++ SegmentedShmem use several segments
+        self._segments = {}
+
+    def close(self):
+        """
+        Drops the mappings of the segments, each is unmapped once no received views refer to it
+        any more
+        """
+        self._segments = {}
+
+    def partition(self, segment_name, handle, length, release=False):
+        """
+        Returns a memoryview of a partition in a shared memory file
+
+        :param segment_name:    The name of the shared memory file in which to find the partition,
+                                or its absolute path, e.g. for the segments of a SegmentedShmem
+        :param handle:          The handle of the partition, i.e. its offset in the file
+        :param length:          The size of the partition in bytes
+        :param release:         The partition is a slot handed out by ShmemKeeper::acquireSlot(),
+                                whose reference is dropped once the returned view is garbage
+                                collected
+        """
+        segment = self._open_segment(segment_name)
+        if handle < SLOT_HEADER_SIZE or handle + length > len(segment):
+            raise RuntimeError(f"Partition {handle} of size {length} exceeds shared memory file {segment_name}")
+
+        partition = (ctypes.c_ubyte * length).from_buffer(segment, handle)
+        if release:
+            # the finalizer holds the mapping, so the slot stays valid until it has run
+            weakref.finalize(partition, ShmemClient._release_slot, segment, handle)
+
+        # views derived from the memoryview keep the partition alive
+        return memoryview(partition).cast("B")
+
+    def extmem(self, reference):
+        """
+        Returns a memoryview of the ExtMem part of a value received over a shm:// connection
+
+        :param reference:   The ExtMem frame of the message, the shared memory file name, the
+                            handle and the length of the partition and an optional release flag,
+                            packed one after another with msgpack
+        """
+        unpacker = msgpack.Unpacker(raw=False)
+        unpacker.feed(reference)
+        fields = list(unpacker)
+        if len(fields) < 3:
+            raise RuntimeError(f"Invalid shared memory reference with {len(fields)} fields")
+
+        # senders without slot rings do not send the flag
+        release = len(fields) > 3 and bool(fields[3])
+        return self.partition(fields[0], fields[1], fields[2], release)
+
+    def _open_segment(self, segment_name):
+        segment = self._segments.get(segment_name)
+        if segment is not None:
+            return segment
+
+        if segment_name.startswith(MEMFD_PREFIX):
+            raise RuntimeError(f"Cannot open {segment_name}, memfd buffers are not supported, "
+                               "use a SingleFileShmem or SegmentedShmem on the sending side")
+
+        # absolute paths are kept as they are
+        path = os.path.join(SHMEM_DIRECTORY, segment_name)
+        try:
+            with open(path, "r+b") as file:
+                segment = mmap.mmap(file.fileno(), 0)
+        except OSError as e:
+            raise RuntimeError(f"Cannot open shared memory file {segment_name}\n    {e}")
+
+        self._segments[segment_name] = segment
+        return segment
+
+    @staticmethod
+    def _release_slot(segment, handle):
+        # the receiver holds exactly one reference to a slot, so dropping it leaves zero
+        struct.pack_into("=I", segment, handle - SLOT_HEADER_SIZE, 0)
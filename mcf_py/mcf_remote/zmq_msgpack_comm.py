@@ -10,6 +10,7 @@ import zmq
 
 from mcf.value import Value
 from mcf_core.logger import get_logger
+from mcf_remote.shmem_client import ShmemClient, parse_connection
 
 
 def zmq_send(zmq_socket, msg_bytes):  # TODO: align with C++ method transferData()
@@ -38,6 +39,8 @@ class ZmqMsgPackSender:
         """
         :param connection:      A string describing the zmq connection that shall be created
                                 Currently only tcp connections are supported: "tcp://[ip]:[port]"
+                                Values cannot be sent over shm://, because the shared memory is
+                                allocated by the C++ ShmemKeeper
         :param send_timeout:    Time in milliseconds the system waits for an ack after a send before
                                 the send function returns TIMEOUT
         """
@@ -53,6 +56,9 @@ class ZmqMsgPackSender:
     def connect(self):
         self.disconnect()
 
+        if parse_connection(self._connection)[1] is not None:
+            raise RuntimeError(f"ZmqMsgPackSender cannot send over shared memory: {self._connection}")
+
         self._zmq_context = zmq.Context()
         self._socket = self._zmq_context.socket(zmq.REQ)
 
@@ -192,8 +198,13 @@ class ZmqMsgPackReceiver:
         """
         :param connection:      A string describing the zmq connection that shall be created
                             Currently only tcp connections are supported: "tcp://[ip]:[port]"
+                            or "shm://[filename]", using 0MQ inter process communication for
+                            values and a shared memory file for their ExtMem parts, which are
+                            received as memoryviews of the shared memory without copying
         """
         self._connection = connection
+        self._socket_name, self._shmem_file = parse_connection(connection)
+        self._shmem_client = ShmemClient() if self._shmem_file is not None else None
         self._timeout = timeout
         self._socket = None
         self._zmq_context = None
@@ -214,7 +225,7 @@ class ZmqMsgPackReceiver:
         self._zmq_context = zmq.Context()
         self._socket = self._zmq_context.socket(zmq.REP)
 
-        self._socket.bind(self._connection)
+        self._socket.bind(self._socket_name)
 
     def disconnect(self):
         if self._socket is not None:
@@ -227,6 +238,9 @@ class ZmqMsgPackReceiver:
             self._zmq_context.destroy(linger=0)
             self._zmq_context = None
 
+        if self._shmem_client is not None:
+            self._shmem_client.close()
+
     def _receive(self):
         return zmq_receive(self._socket, self._timeout)
 
@@ -301,6 +315,16 @@ class ZmqMsgPackReceiver:
         typename = unpacker.unpack()
         value_data = unpacker.unpack()
 
+        # over shm the frame only refers to the ExtMem part in the shared memory, mapping it
+        # also makes sure its slot is released if the value is rejected
+        if extmem is not None and self._shmem_client is not None:
+            try:
+                extmem = self._shmem_client.extmem(extmem)
+            except RuntimeError as e:
+                self._logger.warning(f"Cannot access ExtMem of value on topic {topic}: {e}")
+                self._send_response("REJECTED")
+                return
+
         mcf_type = self._type_registry.get(typename)
 
         if mcf_type is None:
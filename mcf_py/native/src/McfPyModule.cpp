@@ -0,0 +1,603 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/ComponentInstantiator.h"
+#include "mcf_core/ComponentManager.h"
+#include "mcf_core/IdGeneratorInterface.h"
+#include "mcf_core/IExtMemValue.h"
+#include "mcf_core/Plugin.h"
+#include "mcf_core/PluginLoader.h"
+#include "mcf_core/PluginManager.h"
+#include "mcf_core/ValueStore.h"
+
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Native backing of the python ValueStore, ValueQueue and of C++ components, see
+ * mcf_py/mcf_core/native.py for the python API on top of it
+ *
+ * Python objects are stored in the C++ value store as they are, wrapped into a PyObjectValue,
+ * so that python components exchange values without converting them. Values of C++ components
+ * are returned to python as NativeValue, which the python side converts into the generated
+ * python type, their ExtMem data is exposed without copying through the buffer protocol.
+ */
+
+namespace py = pybind11;
+
+namespace mcf {
+namespace py_native {
+
+namespace {
+
+/**
+ * A python object stored in the value store
+ */
+class PyObjectValue : public Value {
+public:
+    explicit PyObjectValue(py::object object) : fObject(std::move(object)) {}
+
+    ~PyObjectValue() override {
+        // released by any thread, e.g. the one of a C++ component popping the value
+        if (Py_IsInitialized()) {
+            py::gil_scoped_acquire gil;
+            fObject = py::object();
+        } else {
+            fObject.release();
+        }
+    }
+
+    const py::object& object() const { return fObject; }
+
+private:
+    py::object fObject;
+};
+
+/**
+ * A value of a C++ type, see ValueStore.set_packed() for the opposite direction
+ */
+struct NativeValue {
+    ValuePtr value;
+    const TypeRegistry* types;
+};
+
+/**
+ * The ExtMem data of a value, kept alive as long as python refers to it
+ */
+struct ExtMem {
+    ValuePtr value;
+    const uint8_t* data;
+    size_t size;
+};
+
+class IdInjector : public IidGenerator {
+public:
+    explicit IdInjector(uint64_t id) : fId(id) {}
+    void injectId(Value& value) const override { setId(value, fId); }
+private:
+    const uint64_t fId;
+};
+
+/**
+ * Called with the GIL held
+ */
+py::object toPython(const ValuePtr& value, const TypeRegistry* types) {
+    if (!value) {
+        return py::none();
+    }
+    if (auto object = dynamic_cast<const PyObjectValue*>(value.get())) {
+        return object->object();
+    }
+    return py::cast(NativeValue{value, types});
+}
+
+uint64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Forwards the values to the receive() method of a python receiver
+ *
+ * Like with the python value store, the receiver is expired once receive() returns True and
+ * does not receive values anymore.
+ */
+class PyReceiver : public IValueReceiver {
+public:
+    PyReceiver(py::object receiver, const TypeRegistry& types) : fReceiver(std::move(receiver)), fTypes(types) {}
+
+    ~PyReceiver() {
+        if (Py_IsInitialized()) {
+            py::gil_scoped_acquire gil;
+            fReceiver = py::object();
+        } else {
+            fReceiver.release();
+        }
+    }
+
+    void receive(const std::string& topic, ValuePtr& value) override {
+        if (fExpired.load(std::memory_order_relaxed)) {
+            return;
+        }
+        py::gil_scoped_acquire gil;
+        try {
+            py::object expired = fReceiver.attr("receive")(topic, toPython(value, &fTypes));
+            if (!expired.is_none() && expired.cast<bool>()) {
+                fExpired.store(true, std::memory_order_relaxed);
+            }
+        } catch (py::error_already_set& e) {
+            e.discard_as_unraisable(__func__);
+        }
+    }
+
+    const py::object& receiver() const { return fReceiver; }
+    bool expired() const { return fExpired.load(std::memory_order_relaxed); }
+
+private:
+    py::object fReceiver;
+    const TypeRegistry& fTypes;
+    std::atomic<bool> fExpired{false};
+};
+
+/**
+ * Triggers a python event (see mcf_core/events.py) whenever the queue receives a value
+ */
+class PyEventTrigger : public ITriggerable {
+public:
+    explicit PyEventTrigger(py::object event) : fEvent(std::move(event)) {}
+
+    ~PyEventTrigger() {
+        // a notification in progress may wait for the GIL, so it is not held while waiting for it
+        if (Py_IsInitialized() && PyGILState_Check()) {
+            py::gil_scoped_release release;
+            detachTriggerSources();
+        } else {
+            detachTriggerSources();
+        }
+        if (Py_IsInitialized()) {
+            py::gil_scoped_acquire gil;
+            fEvent = py::object();
+        } else {
+            fEvent.release();
+        }
+    }
+
+    void trigger() override {
+        py::gil_scoped_acquire gil;
+        try {
+            fEvent.attr("trigger")();
+        } catch (py::error_already_set& e) {
+            e.discard_as_unraisable(__func__);
+        }
+    }
+
+private:
+    py::object fEvent;
+};
+
+/*
+ * Python triggers are notified and python values are dropped with the lock of the queue held, so
+ * the bindings release the GIL before calling methods of the queue which lock it.
+ */
+
+/**
+ * ValueQueue additionally remembering the topic and time of the last value received, for the
+ * component tracing of the python components
+ */
+class PyValueQueue : public ValueQueue {
+public:
+    explicit PyValueQueue(int maxLength) : ValueQueue(maxLength) {}
+
+    void receive(const std::string& topic, ValuePtr& value) override {
+        {
+            std::lock_guard<std::mutex> lk(fLastMutex);
+            fLastTopic = topic;
+            fLastTime = nowMicros();
+        }
+        ValueQueue::receive(topic, value);
+    }
+
+    std::pair<std::string, uint64_t> lastTopicAndTime() {
+        std::lock_guard<std::mutex> lk(fLastMutex);
+        return {fLastTopic, fLastTime};
+    }
+
+    void addEvent(py::object event) {
+        auto trigger = std::make_shared<PyEventTrigger>(std::move(event));
+        // the trigger source only keeps weak references
+        fEvents.push_back(trigger);
+        py::gil_scoped_release release;
+        addTrigger(trigger);
+    }
+
+    /// the registry of the value store the queue was added to, to pack C++ values
+    std::atomic<const TypeRegistry*> types{nullptr};
+
+private:
+    std::mutex fLastMutex;
+    std::string fLastTopic;
+    uint64_t fLastTime = 0;
+    std::vector<std::shared_ptr<PyEventTrigger>> fEvents;
+};
+
+/**
+ * ValueStore shared by python and C++ components
+ */
+class PyValueStore {
+public:
+    ValueStore& store() { return fStore; }
+
+    int setValue(const std::string& key, py::object value, bool blocking) {
+        if (value.is_none()) {
+            throw py::value_error("Value store does not accept setting None values");
+        }
+        ValuePtr vp = std::make_shared<const PyObjectValue>(std::move(value));
+        py::gil_scoped_release release;
+        return fStore.setValue(key, vp, blocking);
+    }
+
+    /**
+     * Set a value of a C++ type from its msgpack serialization and ExtMem data, which are copied
+     */
+    int setPacked(const std::string& key,
+                  const std::string& typeName,
+                  py::bytes fields,
+                  py::object extMem,
+                  uint64_t valueId,
+                  bool blocking) {
+        const auto* typeInfo = fStore.findTypeInfo(typeName);
+        if (typeInfo == nullptr) {
+            throw py::value_error("Type " + typeName + " is not registered in the value store");
+        }
+
+        std::shared_ptr<Value> value;
+        {
+            char* data = nullptr;
+            Py_ssize_t size = 0;
+            PyBytes_AsStringAndSize(fields.ptr(), &data, &size);
+            msgpack::object_handle handle = msgpack::unpack(data, static_cast<size_t>(size));
+            msgpack::object obj = handle.get();
+
+            bool isExtMem = false;
+            if (extMem.is_none()) {
+                value = TypeRegistry::unpackSharedValue(*typeInfo, obj, nullptr, 0, isExtMem);
+            } else {
+                py::buffer_info buffer = py::buffer(extMem).request();
+                value = TypeRegistry::unpackSharedValue(
+                    *typeInfo, obj, buffer.ptr, static_cast<size_t>(buffer.size * buffer.itemsize), isExtMem);
+            }
+        }
+        if (valueId != 0) {
+            IdInjector(valueId).injectId(*value);
+        }
+
+        py::gil_scoped_release release;
+        return fStore.setValue(key, ValuePtr(std::move(value)), blocking);
+    }
+
+    py::object getValue(const std::string& key) {
+        ValuePtr value;
+        {
+            py::gil_scoped_release release;
+            if (fStore.hasValue(key)) {
+                value = fStore.getValue<Value>(key);
+            }
+        }
+        return toPython(value, &fStore);
+    }
+
+    std::vector<std::string> getKeys() const {
+        py::gil_scoped_release release;
+        return fStore.getKeys();
+    }
+
+    bool hasType(const std::string& typeName) const {
+        return fStore.findTypeInfo(typeName) != nullptr;
+    }
+
+    /*
+     * The receivers are added and removed without the GIL held: writers of C++ components may
+     * notify python receivers, which wait for the GIL, while holding locks of the value store.
+     */
+
+    void addQueue(const std::string& key, const std::shared_ptr<PyValueQueue>& queue) {
+        queue->types.store(&fStore);
+        py::gil_scoped_release release;
+        fStore.addReceiver(key, queue);
+    }
+
+    void removeQueue(const std::string& key, const std::shared_ptr<PyValueQueue>& queue) {
+        py::gil_scoped_release release;
+        fStore.removeReceiver(key, queue);
+    }
+
+    void addAllTopicQueue(const std::shared_ptr<PyValueQueue>& queue) {
+        queue->types.store(&fStore);
+        py::gil_scoped_release release;
+        fStore.addAllTopicReceiver(queue);
+    }
+
+    void removeAllTopicQueue(const std::shared_ptr<PyValueQueue>& queue) {
+        py::gil_scoped_release release;
+        fStore.removeAllTopicReceiver(queue);
+    }
+
+    void addReceiver(const std::string& key, py::object receiver) {
+        addPyReceiver(std::move(receiver), std::make_shared<std::string>(key));
+    }
+
+    void addAllTopicReceiver(py::object receiver) {
+        addPyReceiver(std::move(receiver), nullptr);
+    }
+
+private:
+    struct ReceiverEntry {
+        // nullptr for receivers of all topics
+        std::shared_ptr<const std::string> key;
+        std::shared_ptr<PyReceiver> receiver;
+    };
+
+    /**
+     * Called with the GIL held, which protects fReceivers
+     */
+    void addPyReceiver(py::object receiver, std::shared_ptr<const std::string> key) {
+        // expired receivers are removed from the value store when the next one is added
+        std::vector<ReceiverEntry> expired;
+        for (auto it = fReceivers.begin(); it != fReceivers.end();) {
+            if (it->receiver->expired()) {
+                expired.push_back(std::move(*it));
+                it = fReceivers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        const bool registered = std::any_of(fReceivers.begin(), fReceivers.end(), [&](const ReceiverEntry& entry) {
+            return entry.receiver->receiver().is(receiver)
+                && (key && entry.key ? *entry.key == *key : key == entry.key);
+        });
+        ReceiverEntry added;
+        if (!registered) {
+            added = ReceiverEntry{key, std::make_shared<PyReceiver>(std::move(receiver), fStore)};
+            fReceivers.push_back(added);
+        }
+
+        py::gil_scoped_release release;
+        for (const auto& entry : expired) {
+            if (entry.key) {
+                fStore.removeReceiver(*entry.key, entry.receiver);
+            } else {
+                fStore.removeAllTopicReceiver(entry.receiver);
+            }
+        }
+        if (added.receiver) {
+            if (added.key) {
+                fStore.addReceiver(*added.key, added.receiver);
+            } else {
+                fStore.addAllTopicReceiver(added.receiver);
+            }
+        }
+    }
+
+    ValueStore fStore;
+    std::vector<ReceiverEntry> fReceivers;
+};
+
+/**
+ * Optional function of a plugin registering the value types of its components, so that they are
+ * exchanged with python as NativeValue
+ */
+using RegisterValueTypesFunc = void (*)(TypeRegistry&);
+constexpr const char* REGISTER_VALUE_TYPES_SYMBOL = "mcfRegisterValueTypes";
+
+/**
+ * C++ components loaded from plugins, sharing the value store with the python components
+ */
+class PyComponentManager {
+public:
+    PyComponentManager(PyValueStore& valueStore, std::vector<std::string> configDirs)
+    : fValueStore(valueStore)
+    , fManager(valueStore.store(),
+               configDirs.empty()
+                   ? std::vector<std::string>(1, ComponentManager::DEFAULT_CONFIG_DIR)
+                   : std::move(configDirs))
+    , fInstantiator(fManager)
+    , fPlugins(fInstantiator)
+    {}
+
+    std::vector<std::string> loadPlugin(const std::string& fileName) {
+        Plugin plugin = fLoader.load(fileName);
+
+        // the loader keeps the library open, this only looks up the optional symbol
+        void* handle = dlopen(fileName.c_str(), RTLD_NOW | RTLD_NOLOAD);
+        if (handle != nullptr) {
+            auto registerValueTypes =
+                reinterpret_cast<RegisterValueTypesFunc>(dlsym(handle, REGISTER_VALUE_TYPES_SYMBOL));
+            if (registerValueTypes != nullptr) {
+                registerValueTypes(fValueStore.store());
+            }
+            dlclose(handle);
+        }
+        return fPlugins.registerPlugin(plugin);
+    }
+
+    uint64_t createComponent(const std::string& typeName, const std::string& instanceName) {
+        return fInstantiator.createComponent(typeName, instanceName).id();
+    }
+
+    void mapPort(uint64_t componentId, const std::string& portName, const std::string& topic) {
+        fManager.getComponent(componentId).mapPort(portName, topic);
+    }
+
+    bool configure() {
+        py::gil_scoped_release release;
+        return fManager.configure();
+    }
+
+    void startup() {
+        py::gil_scoped_release release;
+        fManager.startup();
+    }
+
+    void shutdown() {
+        py::gil_scoped_release release;
+        fManager.shutdown();
+    }
+
+private:
+    PyValueStore& fValueStore;
+    // declared in the order of their dependencies: components are destroyed before their plugins
+    PluginLoader fLoader;
+    ComponentManager fManager;
+    ComponentInstantiator fInstantiator;
+    PluginManager fPlugins;
+};
+
+/**
+ * (value, topic) at the front of the queue or None, like the python ValueQueue
+ */
+py::object frontWithTopic(PyValueQueue& queue, bool pop) {
+    ValuePtr value;
+    std::string topic;
+    bool found = true;
+    {
+        py::gil_scoped_release release;
+        try {
+            auto entry = pop ? queue.popWithTopic<Value>() : queue.peekWithTopic<Value>();
+            value = std::move(std::get<0>(entry));
+            topic = std::get<1>(entry);
+        } catch (const QueueEmptyException&) {
+            found = false;
+        }
+    }
+    if (!found) {
+        return py::none();
+    }
+    return py::make_tuple(toPython(value, queue.types.load()), topic);
+}
+
+} // anonymous namespace
+
+} // namespace py_native
+} // namespace mcf
+
+PYBIND11_MODULE(_mcf_native, m) {
+    using namespace mcf;
+    using namespace mcf::py_native;
+
+    m.doc() = "Native backing of the mcf_core python package";
+
+    py::class_<ExtMem>(m, "ExtMem", py::buffer_protocol())
+        .def_buffer([](ExtMem& extMem) {
+            return py::buffer_info(const_cast<uint8_t*>(extMem.data),
+                                   1,
+                                   py::format_descriptor<uint8_t>::format(),
+                                   1,
+                                   {static_cast<py::ssize_t>(extMem.size)},
+                                   {static_cast<py::ssize_t>(1)},
+                                   true);
+        })
+        .def("__len__", [](const ExtMem& extMem) { return extMem.size; });
+
+    py::class_<NativeValue>(m, "NativeValue")
+        .def_property_readonly("id", [](const NativeValue& native) { return native.value->id(); })
+        .def_property_readonly("type_name", [](const NativeValue& native) -> py::object {
+            const auto* typeInfo = native.types ? native.types->findTypeInfo(*native.value) : nullptr;
+            return typeInfo ? py::cast(typeInfo->id) : py::none();
+        })
+        // (msgpack serialization of the attributes, type name, ExtMem or None)
+        .def("pack", [](const NativeValue& native) {
+            const auto* typeInfo = native.types ? native.types->findTypeInfo(*native.value) : nullptr;
+            if (typeInfo == nullptr) {
+                throw py::type_error("Value of an unregistered C++ type");
+            }
+            msgpack::sbuffer buffer;
+            const void* ptr = nullptr;
+            size_t len = 0;
+            {
+                py::gil_scoped_release release;
+                TypeRegistry::packValue(buffer, native.value, *typeInfo, ptr, len, true);
+            }
+            py::object extMem = py::none();
+            if (dynamic_cast<const IExtMemValue*>(native.value.get()) != nullptr) {
+                extMem = py::cast(ExtMem{native.value, static_cast<const uint8_t*>(ptr), len});
+            }
+            return py::make_tuple(py::bytes(buffer.data(), buffer.size()), typeInfo->id, extMem);
+        });
+
+    py::class_<PyValueQueue, std::shared_ptr<PyValueQueue>>(m, "ValueQueue")
+        .def(py::init<int>(), py::arg("maxlen") = 0)
+        .def_property_readonly("empty", [](PyValueQueue& queue) {
+            py::gil_scoped_release release;
+            return queue.empty();
+        })
+        .def_property_readonly("size", [](PyValueQueue& queue) {
+            py::gil_scoped_release release;
+            return queue.size();
+        })
+        .def_property("maxlen",
+                      [](PyValueQueue& queue) {
+                          py::gil_scoped_release release;
+                          return queue.getMaxLength();
+                      },
+                      [](PyValueQueue& queue, size_t maxLength) {
+                          py::gil_scoped_release release;
+                          queue.setMaxLength(maxLength);
+                      })
+        // (value, topic) or None, like the python ValueQueue
+        .def("peek_with_topic", [](PyValueQueue& queue) { return frontWithTopic(queue, false); })
+        .def("pop_with_topic", [](PyValueQueue& queue) { return frontWithTopic(queue, true); })
+        .def("receive", [](PyValueQueue& queue, const std::string& topic, py::object value) {
+            ValuePtr vp = std::make_shared<const PyObjectValue>(std::move(value));
+            py::gil_scoped_release release;
+            queue.receive(topic, vp);
+        })
+        .def("add_event", &PyValueQueue::addEvent)
+        .def_property_readonly("last_topic_and_time", [](PyValueQueue& queue) {
+            std::pair<std::string, uint64_t> last;
+            {
+                py::gil_scoped_release release;
+                last = queue.lastTopicAndTime();
+            }
+            return last;
+        });
+
+    py::class_<PyValueStore>(m, "ValueStore")
+        .def(py::init<>())
+        .def("set_value", &PyValueStore::setValue,
+             py::arg("key"), py::arg("value"), py::arg("blocking") = false)
+        .def("set_packed", &PyValueStore::setPacked,
+             py::arg("key"), py::arg("type_name"), py::arg("fields"), py::arg("extmem") = py::none(),
+             py::arg("value_id") = 0, py::arg("blocking") = false)
+        .def("get_value", &PyValueStore::getValue)
+        .def("get_keys", &PyValueStore::getKeys)
+        .def("has_type", &PyValueStore::hasType)
+        .def("add_queue", &PyValueStore::addQueue)
+        .def("remove_queue", &PyValueStore::removeQueue)
+        .def("add_all_topic_queue", &PyValueStore::addAllTopicQueue)
+        .def("remove_all_topic_queue", &PyValueStore::removeAllTopicQueue)
+        .def("add_receiver", &PyValueStore::addReceiver)
+        .def("add_all_topic_receiver", &PyValueStore::addAllTopicReceiver);
+
+    py::class_<PyComponentManager>(m, "ComponentManager")
+        .def(py::init<PyValueStore&, std::vector<std::string>>(),
+             py::arg("value_store"), py::arg("config_dirs") = std::vector<std::string>(),
+             py::keep_alive<1, 2>())
+        .def("load_plugin", &PyComponentManager::loadPlugin)
+        .def("create_component", &PyComponentManager::createComponent)
+        .def("map_port", &PyComponentManager::mapPort)
+        .def("configure", &PyComponentManager::configure)
+        .def("startup", &PyComponentManager::startup)
+        .def("shutdown", &PyComponentManager::shutdown);
+}
@@ -0,0 +1,97 @@
+"""
+Copyright (c) 2024 Accenture
+"""
+
+import inspect
+import os
+import sys
+
+import msgpack
+import pytest
+
+# path of python mcf module, relative to location of this script
+_MCF_PY_RELATIVE_PATH = "../../"
+
+# directory of this script and relative path of mcf python tools
+_SCRIPT_DIRECTORY = os.path.dirname(os.path.abspath(inspect.getfile(inspect.currentframe())))
+
+sys.path.append(f"{_SCRIPT_DIRECTORY}/{_MCF_PY_RELATIVE_PATH}")
+
+# the native backing is built with the cmake option BUILD_PYTHON
+pytest.importorskip("mcf_core._mcf_native")
+
+from mcf_core.native import ValueStore, ValueQueue
+from mcf_core.value_store import PyValueQueue
+
+
+class StringValue:
+    """ python type of the C++ type mcf::msg::String, which every value store registers """
+
+    def __init__(self, value=""):
+        self.value = value
+        self.id = 0
+
+    def serialize(self):
+        return [[self.value], "String"]
+
+    @staticmethod
+    def deserialize(array):
+        return StringValue(array[0][0])
+
+    def inject_id(self, value_id):
+        self.id = value_id
+
+
+def test_python_objects_are_not_converted():
+    value_store = ValueStore()
+    queue = ValueQueue()
+    value_store.add_receiver("topic", queue)
+
+    value = {"a": [1, 2]}
+    value_store.set_value("topic", value)
+    assert value_store.get_value("topic") is value, "Python object not stored as it is"
+    assert queue.pop() is value, "Python object not queued as it is"
+    assert value_store.get_value("missing") is None, "Value of unset topic not None"
+
+
+def test_cpp_types_are_converted():
+    value_store = ValueStore([StringValue])
+    queue = ValueQueue()
+    value_store.add_receiver("topic", queue)
+
+    value = StringValue("text")
+    value.inject_id(42)
+    value_store.set_value("topic", value)
+
+    stored = value_store.get_value("topic")
+    assert isinstance(stored, StringValue), "Value not converted to its python type"
+    assert stored.value == "text", "Wrong value converted"
+    assert stored.id == 42, "Value id not kept"
+    assert queue.pop().value == "text", "Wrong value queued"
+
+    # without a python type, the serialization is returned
+    value_store = ValueStore()
+    value_store.native.set_packed("topic", "String", msgpack.packb(["raw"], use_bin_type=True))
+    assert value_store.get_value("topic") == [["raw"], "String"], "Wrong serialization returned"
+
+
+def test_python_receivers():
+    value_store = ValueStore()
+    python_queue = PyValueQueue()
+    value_store.add_receiver("topic", python_queue)
+    value_store.add_receiver("topic", python_queue)
+
+    value_store.set_value("topic", "s1")
+    assert python_queue.size == 1, "Python receiver not called once"
+
+    # expired receivers are not called anymore
+    python_queue.expire()
+    value_store.set_value("topic", "s2")
+    value_store.set_value("topic", "s3")
+    assert python_queue.size == 2, "Expired python receiver called"
+
+    queue = ValueQueue()
+    value_store.add_receiver("topic", queue)
+    queue.expire()
+    value_store.set_value("topic", "s4")
+    assert queue.empty, "Expired queue received a value"
@@ -0,0 +1,92 @@
+"""
+Copyright (c) 2024 Accenture
+"""
+
+import gc
+import inspect
+import os
+import struct
+import sys
+
+import msgpack
+import pytest
+
+# path of python mcf module, relative to location of this script
+_MCF_PY_RELATIVE_PATH = "../../"
+
+# directory of this script and relative path of mcf python tools
+_SCRIPT_DIRECTORY = os.path.dirname(os.path.abspath(inspect.getfile(inspect.currentframe())))
+
+sys.path.append(f"{_SCRIPT_DIRECTORY}/{_MCF_PY_RELATIVE_PATH}")
+
+from mcf_remote.shmem_client import SHMEM_DIRECTORY, SLOT_HEADER_SIZE, ShmemClient, parse_connection
+
+
+SEGMENT_NAME = "mcf_py_shmem_client_test"
+SEGMENT_SIZE = 4096
+PAYLOAD_HANDLE = 2 * SLOT_HEADER_SIZE
+
+
+@pytest.fixture
+def segment():
+    # stand-in for a segment of a ShmemKeeper with a single slot in flight
+    path = os.path.join(SHMEM_DIRECTORY, SEGMENT_NAME)
+    content = bytearray(SEGMENT_SIZE)
+    struct.pack_into("=I", content, PAYLOAD_HANDLE - SLOT_HEADER_SIZE, 1)
+    content[PAYLOAD_HANDLE:PAYLOAD_HANDLE + 4] = b"mcf!"
+    with open(path, "wb") as file:
+        file.write(content)
+    yield path
+    os.remove(path)
+
+
+def ref_count(path):
+    with open(path, "rb") as file:
+        file.seek(PAYLOAD_HANDLE - SLOT_HEADER_SIZE)
+        return struct.unpack("=I", file.read(4))[0]
+
+
+def test_parse_connection():
+    assert parse_connection("shm://test") == ("ipc:///tmp/test", "test")
+    assert parse_connection("tcp://127.0.0.1:5560") == ("tcp://127.0.0.1:5560", None)
+
+
+def test_extmem_without_release(segment):
+    client = ShmemClient()
+    reference = msgpack.packb(SEGMENT_NAME) + msgpack.packb(PAYLOAD_HANDLE) + msgpack.packb(4)
+    data = client.extmem(reference)
+    assert bytes(data) == b"mcf!", "Wrong ExtMem read from shared memory"
+
+    del data
+    gc.collect()
+    assert ref_count(segment) == 1, "Slot released although the sender did not ask for it"
+
+
+def test_extmem_released_with_last_view(segment):
+    client = ShmemClient()
+    reference = (msgpack.packb(SEGMENT_NAME) + msgpack.packb(PAYLOAD_HANDLE) +
+                 msgpack.packb(4) + msgpack.packb(True))
+    data = client.extmem(reference)
+    part = data[1:3]
+    del data
+    gc.collect()
+    assert ref_count(segment) == 1, "Slot released while a view still refers to it"
+    assert bytes(part) == b"cf", "Wrong ExtMem read from shared memory"
+
+    del part
+    gc.collect()
+    assert ref_count(segment) == 0, "Slot not released after the last view is gone"
+
+
+def test_segments_by_path(segment):
+    # segment files of a SegmentedShmem are referred to by their absolute path
+    client = ShmemClient()
+    assert bytes(client.partition(segment, PAYLOAD_HANDLE, 4)) == b"mcf!", "Wrong partition read by path"
+    assert bytes(client.partition(SEGMENT_NAME, PAYLOAD_HANDLE + 1, 2)) == b"cf", "Wrong partition read by name"
+    assert bytes(client.partition(segment, PAYLOAD_HANDLE + 3, 1)) == b"!", "Wrong partition read by path"
+
+
+def test_partition_out_of_segment(segment):
+    client = ShmemClient()
+    with pytest.raises(RuntimeError):
+        client.partition(SEGMENT_NAME, SEGMENT_SIZE - 2, 4)
@@ -8,6 +8,8 @@
 #include "mcf_core/Mcf.h"
 
 #include <chrono>
+#include <set>
+#include <string>
 
 namespace mcf{
 
@@ -84,6 +86,14 @@ public:
      */
     virtual bool connected() const = 0;
 
+    /**
+     * Sets the topics whose values shall be passed to the listener in their wire format instead
+     * of being decoded, see RelayedValue. Receivers which do not support this decode all values.
+     * Shall only be called while the receiver is not connected.
+     *
+     * @param topics The relayed topics
+     */
+    virtual void setRelayTopics(const std::set<std::string>& topics) {}
 
 protected:
 
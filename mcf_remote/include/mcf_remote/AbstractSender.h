@@ -10,21 +10,79 @@
 #include "mcf_core/ErrorMacros.h"
 
 #include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace mcf{
 
 namespace remote {
 
+class SerializationCache;
+
 /**
  * Abstract interface for classes intended to implement the sending functionality of
  * RemotePair.
  * Implementations of this class are not considered to be thread safe. In particular, the
  * functions connect, disconnect, as well as all sending functions shall only be called
- * from the same thread (called sending thread in the following documentation).
+ * from the same thread (called sending thread in the following documentation). The functions
+ * configuring the sender, e.g. setCompression(), may be called from other threads, but not
+ * concurrently with the sending functions.
  */
 class AbstractSender
 {
 public:
+    /**
+     * Response of the receiver to a value sent with sendValueAsync()
+     */
+    struct Ack
+    {
+        std::string topic;
+        /// one of the results of sendValue()
+        std::string result;
+    };
+
+    /**
+     * Compression of the values sent on a topic, see setCompression()
+     */
+    struct Compression
+    {
+        /// compression level from 1 (fastest) to 9 (smallest), 0 disables compression
+        int level = 0;
+        /// frames of a value smaller than this are sent uncompressed
+        std::size_t minSize = 0;
+    };
+
+    /**
+     * Observer of compressed values, called from the sending thread with the topic, the size of
+     * the value before and after compression and the time spent compressing it
+     */
+    using CompressionObserver = std::function<void(
+        const std::string& topic,
+        std::size_t rawBytes,
+        std::size_t wireBytes,
+        std::chrono::nanoseconds duration)>;
+
+    /**
+     * Times of a ping and its response, the receive and response times are read from the clock
+     * of the receiver, the others from the local clock
+     */
+    struct ClockSample
+    {
+        std::chrono::system_clock::time_point pingSent;
+        std::chrono::system_clock::time_point pingReceived;
+        std::chrono::system_clock::time_point responseSent;
+        std::chrono::system_clock::time_point responseReceived;
+    };
+
+    /**
+     * Observer of the clock of the receiver, called from the sending thread for every ping
+     * whose response carries the clock of the receiver
+     */
+    using ClockObserver = std::function<void(const ClockSample& sample)>;
+
     virtual ~AbstractSender() = default;
 
     /**
@@ -52,6 +110,8 @@ public:
 
      * @param topic  Topic of the value to be transferred
      * @param value  The value to be transferred
+     * @param seq    Sequence number of the value in its topic (see IValueReceiver::receive()),
+     *               passed on to the receiver, 0 if unknown
      *
      * @return Returns one of
      *    - TIMEOUT   no response from receiver within timeout
@@ -59,7 +119,111 @@ public:
      *    - RECEIVED  the value was received but not yet injected into the target value store
      *    - INJECTED  the value was received and injected into the target value store
      */
-    virtual std::string sendValue(const std::string& topic, ValuePtr value) = 0;
+    virtual std::string sendValue(const std::string& topic, ValuePtr value, uint64_t seq = 0) = 0;
+
+    /**
+     * Sends several Values like sendValue(), but may coalesce them into fewer messages with a
+     * single response each. The default implementation sends every value on its own.
+     * This function shall only be called from the sending thread.
+     *
+     * @param values    Topics and values to be transferred
+     * @param maxBytes  Maximum size of the serialized values coalesced into one message
+     * @param seqs      Sequence numbers of the values, see sendValue(), empty if unknown
+     *
+     * @return The result of every value like returned by sendValue(), in the order of values
+     */
+    virtual std::vector<std::string> sendValues(
+        const std::vector<std::pair<std::string, ValuePtr>>& values, size_t maxBytes,
+        const std::vector<uint64_t>& seqs = std::vector<uint64_t>())
+    {
+        std::vector<std::string> results;
+        results.reserve(values.size());
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            results.push_back(sendValue(values[i].first, values[i].second, i < seqs.size() ? seqs[i] : 0));
+        }
+        return results;
+    }
+
+    /**
+     * Checks if values may be sent with sendValueAsync(), i.e. without waiting for the response
+     * of the receiver before sending the next message.
+     *
+     * @returns  true if the sender supports pipelined sending, false otherwise
+     */
+    virtual bool supportsPipelining() const { return false; }
+
+    /**
+     * Sends a Value like sendValue(), but returns without waiting for the response of the
+     * receiver. The response is returned later by pollAcks().
+     * Must only be called if supportsPipelining() returns true.
+     * This function shall only be called from the sending thread.
+     *
+     * @param topic  Topic of the value to be transferred
+     * @param value  The value to be transferred
+     * @param seq    Sequence number of the value in its topic, see sendValue()
+     *
+     * @return Returns one of
+     *    - SENT      the value was sent, its response will be returned by pollAcks()
+     *    - REJECTED  the value cannot be sent (e.g. because its type is unknown)
+     */
+    virtual std::string sendValueAsync(const std::string& topic, ValuePtr value, uint64_t seq = 0)
+    {
+        MCF_THROW_RUNTIME("Pipelined sending is not supported by this sender");
+    }
+
+    /**
+     * Collects the responses to values sent with sendValueAsync(), in the order the values have
+     * been sent. Values without response within the send timeout are acknowledged with TIMEOUT.
+     * This function shall only be called from the sending thread.
+     *
+     * @param acks     Vector the responses are appended to
+     * @param timeout  Maximum time to wait for a response if none has arrived yet
+     */
+    virtual void pollAcks(std::vector<Ack>& acks, std::chrono::milliseconds timeout) {}
+
+    /**
+     * Compresses the payload and ExtMem frames of the values sent on a topic. The receiver
+     * decompresses them transparently.
+     *
+     * @param topic        Topic of the values to be compressed
+     * @param compression  Compression level and size threshold, level 0 disables compression
+     */
+    virtual void setCompression(const std::string& topic, const Compression& compression)
+    {
+        if (compression.level > 0)
+        {
+            MCF_THROW_RUNTIME("Compression is not supported by this sender");
+        }
+    }
+
+    /**
+     * Sets the observer called for every compressed value, see setCompression()
+     */
+    virtual void setCompressionObserver(CompressionObserver observer) {}
+
+    /**
+     * Shares the serialization of the values with other senders, so that values sent by several
+     * of them are serialized once. Senders which do not support sharing ignore the cache.
+     *
+     * @param cache  The cache shared by the senders, nullptr stops sharing
+     */
+    virtual void setSerializationCache(std::shared_ptr<SerializationCache> cache) {}
+
+    /**
+     * Sends the ExtMem parts of values which can export them (see IExtMemValue::extMemExport()),
+     * e.g. device memory, as handles the receiving process maps instead of copying them through
+     * host memory. Requires sender and receiver to run on the same machine. Senders which do not
+     * support this send the ExtMem parts as usual.
+     */
+    virtual void setExtMemExport(bool enable) {}
+
+    /**
+     * Sets the observer called for every ping answered with the clock of the receiver. Senders
+     * which support it stamp the values with their send time once the receiver has answered
+     * this way, so that the receiver can determine their transport latency.
+     */
+    virtual void setClockObserver(ClockObserver observer) {}
 
     /**
      * Sends a ping message containing a freshness value to a receiver over an implementation
@@ -87,6 +251,31 @@ public:
      */
     virtual void sendRequestAll() = 0;
 
+    /**
+     * Sends a control message requesting the values the receiver of this message holds newer
+     * values of than the passed ones, i.e. one value on every sendRule whose latest value has an
+     * id different from the one passed for its remote topic.
+     * Senders which cannot send the message, or whose receiver does not acknowledge it, fall back
+     * to sendRequestAll().
+     * This function shall only be called from the sending thread.
+     *
+     * @param heldIds  Per remote topic, the id of the latest value held on this side
+     */
+    virtual void sendRequestStale(const std::map<std::string, uint64_t>& heldIds)
+    {
+        sendRequestAll();
+    }
+
+    /**
+     * Sends a control message announcing per remote topic of the local receive rules whether it
+     * has local subscribers, so that the receiver of this message pauses the send rules of the
+     * topics without subscribers. Senders which cannot send the message ignore it.
+     * This function shall only be called from the sending thread.
+     *
+     * @param subscribed  Per remote topic, whether the topic has local subscribers
+     */
+    virtual void sendSubscriptions(const std::map<std::string, bool>& subscribed) {}
+
     /**
      * Sends a message which indicates that a previously received Value on a certain topic has
      * been injected in the local value store.
@@ -8,9 +8,13 @@
 #include "mcf_remote/AbstractReceiver.h"
 #include "mcf_remote/IComEventListener.h"
 #include "mcf_remote/ShmemClient.h"
+#include "mcf_remote/ZmqContext.h"
 #include "mcf_remote/ZmqMsgPackUtils.h"
 #include "zmq.hpp"
 
+#include <set>
+#include <vector>
+
 namespace mcf
 {
 namespace remote
@@ -90,6 +94,10 @@ ZmqMsgPackReader<std::string>::receiveAndUnpackData()
  * Implements the functions connect, disconnect, receive, and connected of AbstractReceiver.
  * It adds the abstract function decodeValue to be implemented by subclasses.
  *
+ * A routed receiver uses a ROUTER socket instead of a REP socket, for senders which send every
+ * message behind a sequence number frame and do not wait for the response, see
+ * ZmqMsgPackAsyncSender. The response is returned behind the sequence number of its message.
+ *
  * @tparam ValuePtrType The datatype that is encoded in the 0MQ messages to be received.
  */
 template <typename ValuePtrType>
@@ -97,7 +105,9 @@ class AbstractZmqMsgPackReceiver : public AbstractReceiver<ValuePtrType>
 {
 public:
     explicit AbstractZmqMsgPackReceiver(
-        const std::string& connection, std::shared_ptr<ShmemClient> shmemClient = nullptr);
+        const std::string& connection,
+        std::shared_ptr<ShmemClient> shmemClient = nullptr,
+        bool routed = false);
 
     virtual ~AbstractZmqMsgPackReceiver() = default;
 
@@ -125,11 +135,17 @@ public:
      */
     bool connected() const override { return _socketRec != nullptr; }
 
+    /*
+     * See base class
+     */
+    void setRelayTopics(const std::set<std::string>& topics) override { _relayTopics = topics; }
+
 private:
     /**
      * Function to decode the received message. To support different kind of functions
      * (e.g. mcf values, binary blobs, etc.), this function is abstract so it can be implemented
-     * for different data types in derived classes.
+     * for different data types in derived classes. Sets the sequence number of the message, if
+     * the data type carries one, see ZmqMessage::seq.
      *
      * @param message A 0MQ message
      *
@@ -137,11 +153,52 @@ private:
      */
     virtual ValuePtrType decodeValue(ZmqMessage& message) = 0;
 
+    /**
+     * Function to keep a received message of a relayed topic in its wire format, see
+     * setRelayTopics(). Decodes the message by default.
+     *
+     * @param message A 0MQ message
+     *
+     * @return The message in its wire format
+     */
+    virtual ValuePtrType relayValue(ZmqMessage& message) { return decodeValue(message); }
+
+    /**
+     * Relays or decodes a received message, depending on its topic
+     */
+    ValuePtrType decodeOrRelayValue(const std::string& topic, ZmqMessage& message);
+
     void receivePing();
     void receivePong();
     void receiveCommand();
     void receiveValue();
 
+    /**
+     * Receives a value whose topic is followed by its send time, see toWireTime()
+     */
+    void receiveStampedValue();
+
+    /**
+     * Receives a value sent with sendCompressedValue()
+     */
+    void receiveCompressedValue();
+
+    /**
+     * Receives a value sent with sendExportedValue()
+     */
+    void receiveExportedValue();
+
+    /**
+     * Decodes a received value message, passes the value to the listener and responds
+     */
+    void handleValueMessage(const std::string& topic, ZmqMessage& message);
+
+    /**
+     * Receives a batch message, see packBatchEntry(), and responds with the results of all its
+     * values in one array
+     */
+    void receiveBatch();
+
     /**
      * Receives a zmq message serialized using msgpack and unpacks it to the desired type.
      * The function throws an exception if either receiving or unpacking fails.
@@ -157,55 +214,41 @@ private:
     }
 
     void sendResponse(const std::string& response = "");
+    void sendResponse(const std::vector<std::string>& responses);
+
+    template <typename T>
+    void sendPackedResponse(const T& response);
 
-    zmq::context_t _context;
+    /**
+     * Receives the routing identity and sequence number in front of a message of a routed
+     * receiver
+     *
+     * @return false if the message does not start with an envelope
+     */
+    bool receiveEnvelope();
+
+    // shared by all endpoints of the process, see ZmqContext
+    std::shared_ptr<zmq::context_t> _context;
     std::string _connection;
     std::unique_ptr<zmq::socket_t> _socketRec;
 
+    const bool _routed;
+    // routing identity and sequence number of the message being received
+    std::vector<zmq::message_t> _envelope;
+
     // for access to shared memory segment for inter process communication
     std::string _shmemFileName;
     std::shared_ptr<ShmemClient> _shmemClient;
+
+    std::set<std::string> _relayTopics;
 };
 
 template <typename ValuePtrType>
 AbstractZmqMsgPackReceiver<ValuePtrType>::AbstractZmqMsgPackReceiver(
-    const std::string& connection, std::shared_ptr<ShmemClient> shmemClient)
-: _context(1), _shmemClient(std::move(shmemClient))
+    const std::string& connection, std::shared_ptr<ShmemClient> shmemClient, bool routed)
+: _context(ZmqContext::shared()), _shmemClient(std::move(shmemClient)), _routed(routed)
 {
     parseConnectionName(connection, _connection, _shmemFileName);
-
-    int policy = 0;
-    sched_param parameters{-1};
-    pthread_getschedparam(pthread_self(), &policy, &parameters);
-
-    if (policy == SCHED_FIFO)
-    {
-        int priority = 36;
-        void* ptr    = (void*)_context;
-        zmq_ctx_set(ptr, ZMQ_THREAD_SCHED_POLICY, SCHED_FIFO);
-        int res = zmq_ctx_set(ptr, ZMQ_THREAD_PRIORITY, priority);
-
-        // setting a thread name prefix only work with zmq 4.3 and higher
-        // int prefix = std::stoi(_connection.substr(_connection.size()-4));
-        // res = zmq_ctx_set(ptr, ZMQ_THREAD_NAME_PREFIX, prefix);
-
-        if (res != 0)
-        {
-            MCF_THROW_RUNTIME(fmt::format(
-                "ERROR: cannot set ZMQ_THREAD_PRIORITY to '{}': {}", priority, strerror(errno)));
-        }
-        else
-        {
-            MCF_INFO_NOFILELINE(
-                "SET ZmqMsgPackReceiver scheduling parameters: policy {}, priority {}",
-                policy,
-                priority);
-        }
-    }
-    else
-    {
-        MCF_INFO_NOFILELINE("Cannot change scheduling of ZmqMsgPackReceiver");
-    }
 }
 
 template <typename ValuePtrType>
@@ -214,7 +257,8 @@ AbstractZmqMsgPackReceiver<ValuePtrType>::connect()
 {
     try
     {
-        _socketRec = std::make_unique<zmq::socket_t>(_context, ZMQ_REP);
+        _socketRec = std::make_unique<zmq::socket_t>(*_context, _routed ? ZMQ_ROUTER : ZMQ_REP);
+        ZmqContext::configureSocket(*_socketRec);
         // int timeout = 100;    // in milliseconds
         // _socketRec->setsockopt(ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
 
@@ -239,6 +283,7 @@ template <typename ValuePtrType>
 void
 AbstractZmqMsgPackReceiver<ValuePtrType>::receivePing()
 {
+    const auto received = std::chrono::system_clock::now();
     uint64_t freshnessValue = 0u;
 
     try
@@ -251,7 +296,8 @@ AbstractZmqMsgPackReceiver<ValuePtrType>::receivePing()
         return;
     }
 
-    sendResponse();
+    // lets the sender estimate the offset between the clocks, see AbstractSender::ClockSample
+    sendResponse(packClockResponse(received, std::chrono::system_clock::now()));
 
     if (this->_listener)
         this->_listener->pingReceived(freshnessValue);
@@ -294,6 +340,24 @@ AbstractZmqMsgPackReceiver<ValuePtrType>::receiveCommand()
             return;
         }
 
+        if (command == "sendStale")
+        {
+            auto heldIds = receiveAndUnpackData<std::map<std::string, uint64_t> >();
+            sendResponse("OK");
+            if (this->_listener)
+                this->_listener->requestStaleReceived(heldIds);
+            return;
+        }
+
+        if (command == "subscriptions")
+        {
+            auto subscribed = receiveAndUnpackData<std::map<std::string, bool> >();
+            sendResponse("OK");
+            if (this->_listener)
+                this->_listener->subscriptionsReceived(subscribed);
+            return;
+        }
+
         if (command == "valueInjected")
         {
             std::string topic = receiveAndUnpackData<std::string>();
@@ -333,16 +397,7 @@ AbstractZmqMsgPackReceiver<ValuePtrType>::receiveValue()
         ValuePtrType value = ValuePtrType();
         ZmqMsgPackMessageReceiver(*_socketRec, _shmemClient.get(), _shmemFileName)
             .receive(topic, [this, &topic](ZmqMessage& message) {
-                ValuePtrType value = this->decodeValue(message);
-                if (value != nullptr && this->_listener)
-                {
-                    std::string retVal = this->_listener->valueReceived(topic, value);
-                    sendResponse(retVal);
-                }
-                else
-                {
-                    sendResponse("REJECTED");
-                }
+                handleValueMessage(topic, message);
             });
     }
     catch (std::exception& e)
@@ -351,6 +406,157 @@ AbstractZmqMsgPackReceiver<ValuePtrType>::receiveValue()
     }
 }
 
+template <typename ValuePtrType>
+void
+AbstractZmqMsgPackReceiver<ValuePtrType>::receiveStampedValue()
+{
+    const auto received = std::chrono::system_clock::now();
+    try
+    {
+        const std::string topic = receiveAndUnpackData<std::string>();
+        const auto sent = fromWireTime(receiveAndUnpackData<int64_t>());
+        if (this->_listener)
+        {
+            this->_listener->valueStampReceived(topic, sent, received);
+        }
+
+        ZmqMsgPackMessageReceiver(*_socketRec, _shmemClient.get(), _shmemFileName)
+            .receive(topic, [this, &topic](ZmqMessage& message) {
+                handleValueMessage(topic, message);
+            });
+    }
+    catch (std::exception& e)
+    {
+        MCF_ERROR_NOFILELINE("In RemoteService receiveStampedValue: {}", e.what());
+    }
+}
+
+template <typename ValuePtrType>
+void
+AbstractZmqMsgPackReceiver<ValuePtrType>::receiveCompressedValue()
+{
+    bool handled = false;
+    try
+    {
+        const std::string topic = receiveAndUnpackData<std::string>();
+        receiveCompressedMessage(
+            [this, &topic, &handled](ZmqMessage& message) {
+                handled = true;
+                handleValueMessage(topic, message);
+            },
+            *_socketRec);
+    }
+    catch (std::exception& e)
+    {
+        MCF_ERROR_NOFILELINE("In RemoteService receiveCompressedValue: {}", e.what());
+        if (!handled)
+        {
+            // e.g. a frame which cannot be decompressed
+            sendResponse("REJECTED");
+        }
+    }
+}
+
+template <typename ValuePtrType>
+void
+AbstractZmqMsgPackReceiver<ValuePtrType>::receiveExportedValue()
+{
+    try
+    {
+        const std::string topic = receiveAndUnpackData<std::string>();
+
+        zmq::message_t request;
+        zmq::message_t handle;
+        if (!_socketRec->recv(&request) || !_socketRec->recv(&handle))
+            throw zmq::error_t();
+
+        ZmqMessage message{request, nullptr, 0};
+        message.extMemHandle.assign(static_cast<const char*>(handle.data()), handle.size());
+        handleValueMessage(topic, message);
+    }
+    catch (std::exception& e)
+    {
+        // e.g. a handle which cannot be imported
+        MCF_ERROR_NOFILELINE("In RemoteService receiveExportedValue: {}", e.what());
+        sendResponse("REJECTED");
+    }
+}
+
+template <typename ValuePtrType>
+ValuePtrType
+AbstractZmqMsgPackReceiver<ValuePtrType>::decodeOrRelayValue(
+    const std::string& topic, ZmqMessage& message)
+{
+    // an exported ExtMem part is imported, its handle is only valid on this machine
+    if (message.extMemHandle.empty() && _relayTopics.count(topic) != 0)
+    {
+        return this->relayValue(message);
+    }
+    return this->decodeValue(message);
+}
+
+template <typename ValuePtrType>
+void
+AbstractZmqMsgPackReceiver<ValuePtrType>::handleValueMessage(
+    const std::string& topic, ZmqMessage& message)
+{
+    ValuePtrType value = decodeOrRelayValue(topic, message);
+    if (value != nullptr && this->_listener)
+    {
+        std::string retVal = this->_listener->valueReceived(topic, value, message.seq);
+        sendResponse(retVal);
+    }
+    else
+    {
+        sendResponse("REJECTED");
+    }
+}
+
+template <typename ValuePtrType>
+void
+AbstractZmqMsgPackReceiver<ValuePtrType>::receiveBatch()
+{
+    std::vector<std::string> results;
+    try
+    {
+        zmq::message_t batch;
+        if (!_socketRec->recv(&batch))
+            throw zmq::error_t();
+
+        // the whole batch is unpacked from the one frame
+        const char* data = static_cast<const char*>(batch.data());
+        std::size_t offset = 0;
+        while (offset < batch.size())
+        {
+            const std::string topic = msgpack::unpack(data, batch.size(), offset).get().as<std::string>();
+            auto entry = msgpack::unpack(data, batch.size(), offset);
+            if (entry.get().type != msgpack::type::BIN)
+            {
+                throw ReceiveError("batch entry is not binary");
+            }
+
+            zmq::message_t request(entry.get().via.bin.ptr, entry.get().via.bin.size);
+            ZmqMessage message{request, nullptr, 0};
+            ValuePtrType value = decodeOrRelayValue(topic, message);
+            if (value != nullptr && this->_listener)
+            {
+                results.push_back(this->_listener->valueReceived(topic, value, message.seq));
+            }
+            else
+            {
+                results.push_back("REJECTED");
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        // the sender treats values without result as rejected
+        MCF_ERROR_NOFILELINE("In RemoteService receiveBatch: {}", e.what());
+    }
+
+    sendResponse(results);
+}
+
 template <typename ValuePtrType>
 bool
 AbstractZmqMsgPackReceiver<ValuePtrType>::receive(const std::chrono::milliseconds timeout)
@@ -367,6 +573,11 @@ AbstractZmqMsgPackReceiver<ValuePtrType>::receive(const std::chrono::millisecond
         return false;
     }
 
+    if (_routed && !receiveEnvelope())
+    {
+        return false;
+    }
+
     std::string kind;
     try
     {
@@ -394,6 +605,22 @@ AbstractZmqMsgPackReceiver<ValuePtrType>::receive(const std::chrono::millisecond
     {
         receiveValue();
     }
+    else if (kind == "stampedValue")
+    {
+        receiveStampedValue();
+    }
+    else if (kind == "compressedValue")
+    {
+        receiveCompressedValue();
+    }
+    else if (kind == "exportedValue")
+    {
+        receiveExportedValue();
+    }
+    else if (kind == "batch")
+    {
+        receiveBatch();
+    }
     else
     {
         MCF_ERROR_NOFILELINE("RemoteService received unexpected message kind: {}", kind);
@@ -402,12 +629,65 @@ AbstractZmqMsgPackReceiver<ValuePtrType>::receive(const std::chrono::millisecond
     return true;
 }
 
+template <typename ValuePtrType>
+bool
+AbstractZmqMsgPackReceiver<ValuePtrType>::receiveEnvelope()
+{
+    _envelope.clear();
+    try
+    {
+        // routing identity and sequence number
+        for (int i = 0; i < 2; ++i)
+        {
+            _envelope.emplace_back();
+            if (!_socketRec->recv(&_envelope.back()) || !_socketRec->getsockopt<int>(ZMQ_RCVMORE))
+            {
+                throw zmq::error_t();
+            }
+        }
+    }
+    catch (zmq::error_t& e)
+    {
+        MCF_WARN_NOFILELINE("in ZmqMsgPackReceiver receive: incomplete message envelope");
+        // drop the rest of the message
+        zmq::message_t part;
+        while (_socketRec->getsockopt<int>(ZMQ_RCVMORE) && _socketRec->recv(&part))
+        {
+        }
+        _envelope.clear();
+        return false;
+    }
+    return true;
+}
+
 template <typename ValuePtrType>
 void
 AbstractZmqMsgPackReceiver<ValuePtrType>::sendResponse(const std::string& response)
+{
+    sendPackedResponse(response);
+}
+
+template <typename ValuePtrType>
+void
+AbstractZmqMsgPackReceiver<ValuePtrType>::sendResponse(const std::vector<std::string>& responses)
+{
+    sendPackedResponse(responses);
+}
+
+template <typename ValuePtrType>
+template <typename T>
+void
+AbstractZmqMsgPackReceiver<ValuePtrType>::sendPackedResponse(const T& response)
 {
     try
     {
+        for (auto& frame : _envelope)
+        {
+            zmq::message_t copy;
+            copy.copy(&frame);
+            _socketRec->send(copy, ZMQ_SNDMORE);
+        }
+
         msgpack::sbuffer buffer;
         msgpack::packer<msgpack::sbuffer> pk(&buffer);
         pk.pack(response);
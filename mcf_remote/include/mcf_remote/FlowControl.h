@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_REMOTE_FLOWCONTROL_H
+#define MCF_REMOTE_FLOWCONTROL_H
+
+#include "mcf_core/Value.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace mcf {
+
+namespace remote {
+
+/**
+ * Flow control of the values sent over one remote link.
+ *
+ * The bandwidth of the link is estimated from the responses to the sent values: the bytes
+ * delivered per time the sender spent waiting for responses. Values are shaped by a token bucket,
+ * i.e. a value is only sent once the bucket holds enough bytes, which are refilled at the send
+ * rate.
+ *
+ * If the flow control is adaptive, the link is considered congested while values time out or are
+ * rejected, or while the smoothed response time is more than twice the lowest one seen recently.
+ * On congestion, the send rate is reduced below the estimated bandwidth and the congestion level
+ * rises by one per adaptation interval, on recovery the rate is raised step by step and the level
+ * falls again. The congestion level decimates the values of low priority send lanes, see
+ * decimationShift(), so that the link keeps serving the high priority lanes with low latency.
+ *
+ * All methods are thread safe.
+ */
+class FlowControl
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config
+    {
+        /// maximum send rate in bytes per second, 0 for no fixed limit
+        uint64_t maxRate = 0;
+        /// bytes which may be sent at once without waiting for the rate
+        uint64_t burst = 1024 * 1024;
+        /// adapt the send rate and decimate low priority lanes on congestion
+        bool adaptive = false;
+    };
+
+    struct Statistics
+    {
+        /// estimated bandwidth of the link in bytes per second, 0 until values have been acked
+        double bandwidth = 0.;
+        /// current send rate in bytes per second, 0 if not limited
+        double rate = 0.;
+        /// smoothed time from sending a value until its response
+        std::chrono::nanoseconds ackTime{0};
+        /// lowest smoothed response time seen recently
+        std::chrono::nanoseconds baseAckTime{0};
+        unsigned congestionLevel = 0;
+        /// values dropped by decimation
+        uint64_t decimated = 0;
+        /// number of times a value waited for the token bucket
+        uint64_t delayed = 0;
+    };
+
+    explicit FlowControl(const Config& config);
+
+    /**
+     * Takes the tokens for sending a value of the passed size from the bucket if they are
+     * available. Values larger than the burst are sent once the bucket is full.
+     *
+     * @return zero if the value may be sent now, otherwise the time until the tokens are available
+     */
+    Clock::duration acquire(std::size_t bytes, Clock::time_point now = Clock::now());
+
+    /**
+     * Records the response to a sent value and adapts the send rate and the congestion level
+     * once per adaptation interval
+     *
+     * @param bytes    Size of the value, see estimateWireSize()
+     * @param duration Time from sending the value until its response
+     * @param result   The response, e.g. "INJECTED" or "TIMEOUT"
+     */
+    void valueAcked(
+        std::size_t bytes,
+        Clock::duration duration,
+        const std::string& result,
+        Clock::time_point now = Clock::now());
+
+    /**
+     * Records a value dropped by decimation
+     */
+    void valueDecimated();
+
+    /**
+     * Returns by how many powers of two the values of a send lane are decimated at the current
+     * congestion level, i.e. only every (1 << shift)-th value is sent. The lowest lane is decimated
+     * from congestion level one on, every higher lane one level later. The highest lane is never
+     * decimated.
+     *
+     * @param lane  Index of the lane in descending priority
+     * @param lanes Number of lanes
+     */
+    unsigned decimationShift(std::size_t lane, std::size_t lanes) const;
+
+    Statistics statistics() const;
+
+    /**
+     * Size of a value on the wire as used for the shaping: the wire format of relayed values, the
+     * ExtMem part of other values plus a fixed allowance for their serialized members
+     */
+    static std::size_t estimateWireSize(const Value& value);
+
+private:
+    /**
+     * Adapts the rate and congestion level to the responses since the last adaptation
+     */
+    void adapt(Clock::time_point now);
+
+    const Config _config;
+
+    mutable std::mutex _mtx;
+
+    // token bucket
+    double _rate;
+    double _tokens;
+    Clock::time_point _refilled;
+
+    // responses since the last adaptation
+    Clock::time_point _adapted;
+    uint64_t _intervalBytes = 0;
+    Clock::duration _intervalBusy{0};
+    bool _intervalFailed = false;
+
+    double _bandwidth = 0.;
+    double _ackTime = 0.;
+    double _baseAckTime = 0.;
+    Clock::time_point _baseUpdated;
+    unsigned _congestionLevel = 0;
+    uint64_t _decimated = 0;
+    uint64_t _delayed = 0;
+};
+
+} // end namespace remote
+
+} // end namespace mcf
+
+#endif
@@ -7,6 +7,9 @@
 
 #include "mcf_core/Mcf.h"
 
+#include <chrono>
+#include <map>
+
 namespace mcf{
 
 namespace remote {
@@ -35,6 +38,21 @@ public:
      */
     virtual std::string valueReceived(const std::string& topic, ValuePtrType value) = 0;
 
+    /**
+     * Function to be called by an AbstractReceiver when it received a Value together with the
+     * sequence number of its write to the topic at the sender (see AbstractSender::sendValue()).
+     * The default implementation ignores the number.
+     * @param topic  The topic to which the value shall be written
+     * @param value  A shared_ptr with the received Value
+     * @param seq    Sequence number of the value in its topic at the sender, 0 if not sent
+     *
+     * @return See valueReceived() above
+     */
+    virtual std::string valueReceived(const std::string& topic, ValuePtrType value, uint64_t seq)
+    {
+        return valueReceived(topic, std::move(value));
+    }
+
     /**
      * Function to be called by an AbstractReceiver when it received a ping message.
      * @param freshnessValue  The freshnessValue that has been received with the ping
@@ -53,6 +71,23 @@ public:
      */
     virtual void requestAllReceived() = 0;
 
+    /**
+     * Function to be called by an AbstractReceiver when it received a message with a sendStale
+     * command. Listeners which cannot compare value ids treat it like a requestAll command.
+     * @param heldIds  Per remote topic, the id of the latest value the remote side holds
+     */
+    virtual void requestStaleReceived(const std::map<std::string, uint64_t>& heldIds)
+    {
+        requestAllReceived();
+    }
+
+    /**
+     * Function to be called by an AbstractReceiver when it received a message with a
+     * subscriptions command. Listeners which cannot pause sending ignore it.
+     * @param subscribed  Per remote topic, whether the remote side has subscribers for it
+     */
+    virtual void subscriptionsReceived(const std::map<std::string, bool>& subscribed) {}
+
     /**
      * Function to be called by an AbstractReceiver when it received a message with a valueInjected
      * command.
@@ -69,6 +104,18 @@ public:
      */
     virtual void blockedValueRejectedReceived(const std::string& topic) = 0;
 
+    /**
+     * Function to be called by an AbstractReceiver when it received a value stamped with its
+     * send time, before valueReceived() is called for the value.
+     * @param topic     The topic of the value
+     * @param sent      Time the value was sent, read from the clock of the sender
+     * @param received  Time the value was received, read from the local clock
+     */
+    virtual void valueStampReceived(
+        const std::string& topic,
+        std::chrono::system_clock::time_point sent,
+        std::chrono::system_clock::time_point received) {}
+
 };
 
 
@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#ifndef MCF_REMOTE_RELAYEDVALUE_H
+#define MCF_REMOTE_RELAYEDVALUE_H
+
+#include "mcf_core/ISerializedValue.h"
+#include "mcf_core/LazyValue.h"
+#include "mcf_remote/SerializedValue.h"
+
+#include <mutex>
+
+namespace mcf
+{
+class TypeRegistry;
+
+namespace remote
+{
+/**
+ * @brief A value received on a relay rule, kept in its wire format
+ *
+ * RemoteServices forward a RelayedValue as is instead of serializing it, see
+ * RemoteService::addRelayRule(). It carries the id of the value it was received as.
+ *
+ * Components reading the topic of a relay rule as the type of the value get the value decoded
+ * on first access, see LazyValue. Reads as Value get the RelayedValue. Value recorders record
+ * its serialized form without decoding it, see ISerializedValue.
+ */
+class RelayedValue : public LazyValue, public ISerializedValue
+{
+public:
+    /**
+     * @param serialized   The received message
+     * @param typeRegistry Registry to decode the value with, which must outlive the value.
+     *                     Without registry, the value cannot be decoded.
+     */
+    explicit RelayedValue(SerializedValue serialized, TypeRegistry* typeRegistry = nullptr)
+    : _serialized(std::move(serialized))
+    , _typeRegistry(typeRegistry)
+    {}
+
+    /**
+     * The value as received: the packed value and its ExtMem part, if any
+     */
+    const SerializedValue& serialized() const { return _serialized; }
+
+    /**
+     * The packed value within the received message, parsed on first access
+     */
+    const Serialized* serializedForm() const override;
+
+protected:
+    ValuePtr decode() const override;
+
+private:
+    SerializedValue _serialized;
+    TypeRegistry* _typeRegistry;
+    mutable std::once_flag _parseOnce;
+    mutable Serialized _serializedForm;
+    mutable bool _parsed = false;
+};
+
+} // namespace remote
+} // namespace mcf
+
+#endif // MCF_REMOTE_RELAYEDVALUE_H
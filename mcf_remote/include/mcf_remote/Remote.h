@@ -5,9 +5,14 @@
 #define MCF_REMOTE_H
 
 #include "mcf_core/Mcf.h"
+#include "mcf_remote/RelayedValue.h"
 #include "mcf_remote/SerializedValue.h"
 #include "zmq.hpp"
+#include <atomic>
+#include <chrono>
 #include <mutex>
+#include <string>
+#include <vector>
 
 namespace mcf {
 
@@ -64,17 +69,57 @@ struct ZmqMessage
     const void* extMem;
     /// Length of extmem
     const std::size_t extMemSize;
+    /// Keeps extmem alive beyond the scope of the message if set, e.g. a shared memory slot
+    std::shared_ptr<const void> extMemOwner = nullptr;
+    /// Handle of the extmem exported by the sender instead of sending it, see sendExportedValue()
+    std::string extMemHandle;
+    /// Sequence number of the value at the sender, 0 if not sent, set when the value is decoded
+    uint64_t seq = 0;
 };
 
 namespace impl {
 
+/**
+ * Packed values of at least this size are handed over to 0MQ instead of being copied
+ */
+constexpr std::size_t ZERO_COPY_MIN_SIZE = 4096;
+
+inline void freeSbufferData(void* data, void*)
+{
+    ::free(data);
+}
+
+/**
+ * Packs the type of a value message: the numeric id of the type (see
+ * TypeRegistry::numericTypeId()) if the receiver supports it, otherwise the type name
+ */
+template <typename Stream>
+void packTypeId(msgpack::packer<Stream>& pk, const TypeRegistry::TypemapEntry& typeInfo, bool numericTypeId)
+{
+    if (numericTypeId)
+    {
+        pk.pack(typeInfo.numericId);
+    }
+    else
+    {
+        pk.pack(typeInfo.id);
+    }
+}
+
+/**
+ * Tells whether a value message in its wire format carries the numeric id of its type
+ */
+bool hasNumericTypeId(const SerializedValue& serialized);
+
 template <typename F>
 void sendValueBase(
        ValuePtr value,
+       uint64_t seq,
        const TypeRegistry::TypemapEntry& typeInfo,
        zmq::socket_t& socket,
        bool sendMore,
-       F& extmemHandling)
+       F& extmemHandling,
+       bool numericTypeId = false)
 {
     using namespace std::placeholders;
 
@@ -82,16 +127,28 @@ void sendValueBase(
     msgpack::packer<msgpack::sbuffer> pk(&buffer);
 
     pk.pack(value->id());
-    pk.pack(typeInfo.id);
+    packTypeId(pk, typeInfo, numericTypeId);
 
     const void* ptr;
     size_t len;
 
-    typeInfo.packFunc(pk, value, ptr, len, true);
+    TypeRegistry::packValue(buffer, value, typeInfo, ptr, len, true);
+    // trailing, so that receivers which do not know it ignore it, see unpackMessage()
+    pk.pack(seq);
 
-    zmq::message_t request(buffer.data(), buffer.size());
-
-    socket.send(request, ptr != NULL ? ZMQ_SNDMORE : 0);
+    if (buffer.size() < ZERO_COPY_MIN_SIZE)
+    {
+        // reusing the buffer is cheaper than a separate allocation for small values
+        zmq::message_t request(buffer.data(), buffer.size());
+        socket.send(request, ptr != NULL ? ZMQ_SNDMORE : 0);
+    }
+    else
+    {
+        // the buffer's memory is allocated with malloc and released by 0MQ once sent
+        const std::size_t size = buffer.size();
+        zmq::message_t request(buffer.release(), size, freeSbufferData);
+        socket.send(request, ptr != NULL ? ZMQ_SNDMORE : 0);
+    }
 
     if (ptr != NULL) {
         extmemHandling(value, socket, sendMore, ptr, len);
@@ -99,14 +156,41 @@ void sendValueBase(
     buffer.clear();
 }
 
+/**
+ * msgpack reference function letting unpacked strings and binaries refer to the unpacked buffer
+ * instead of copying them into the zone. The buffer must outlive the unpacked objects.
+ */
+inline bool referenceBuffer(msgpack::type::object_type, std::size_t, void*)
+{
+    return true;
+}
+
+/**
+ * Unpacks a value message. If an owner of the extmem is passed, the value refers to the extmem
+ * instead of copying it, if its type supports this (see IExtMemValue::extMemShare()). If an
+ * extmem handle is passed, the value imports the extmem exported by the sender instead, see
+ * IExtMemValue::extMemImport(). If seq is passed, it is set to the sequence number the value
+ * was sent with, see sendValue().
+ */
 ValuePtr unpackMessage(
         TypeRegistry& typeRegistry,
         zmq::message_t& request,
         const void* ptr,
-        size_t len);
+        size_t len,
+        const std::shared_ptr<const void>& extMemOwner = nullptr,
+        const std::string& extMemHandle = std::string(),
+        uint64_t* seq = nullptr);
 
 SerializedValue getSerializedMessage(zmq::message_t& request, const void* p, size_t len);
 
+/**
+ * Keeps a value message in its wire format instead of unpacking it, see RelayedValue. Only the
+ * id of the value is unpacked and taken over by the RelayedValue, which decodes the value with
+ * the passed registry on first typed access. If seq is passed, it is set like by unpackMessage().
+ */
+ValuePtr relayMessage(zmq::message_t& request, const void* ptr, size_t len,
+                      TypeRegistry* typeRegistry = nullptr, uint64_t* seq = nullptr);
+
 template <typename F>
 void
 receiveMessageBase(
@@ -162,13 +246,17 @@ receiveMessageBase(
 
 /**
  * Used by the sender to keep shared pointers alive until sending is done.
+ *
+ * Each kept value gets its own heap allocated copy of the shared pointer, which serves as the
+ * handle, so that keeping and releasing values does not synchronize the sending threads and the
+ * 0MQ I/O threads beyond the reference count.
  */
 class ValueKeeper {
 public:
 
     typedef const void* HandleType;
     /**
-     * Add a pointer to a Value to the list of pointers to keep.
+     * Keep a Value alive until removeValue() is called with the returned handle.
      *
      * @param value ValuePtr that should not be deleted
      * @return a handle to be used for removing it later
@@ -176,8 +264,7 @@ public:
     HandleType addValue(const ValuePtr& value);
 
     /**
-     * Remove shared pointer identified by the handle returned by addValue from the list
-     * of shared pointers that should not be deleted.
+     * Release the shared pointer identified by the handle returned by addValue.
      * @param handle The handle obtained from the function addValue
      */
     void removeValue(HandleType handle);
@@ -187,20 +274,67 @@ public:
      * constructor call of a zmq::message_t.
      *
      * @param data A pointer to the allocated data (unused)
-     * @param hint A handle to the entry that shall be removed from in fMap
+     * @param hint The handle of the value to be released
      */
     static void zmqFreeFunction(void* data, void* hint);
 
     /**
-     * Set the number of entries in ValueKeeper map
+     * Get the number of values kept
      *
-     * @return number of entries in ValueKeeper map
+     * @return number of values kept
      */
-    int getSize() { return fMap.size(); };
+    int getSize() { return fSize.load(std::memory_order_relaxed); };
 
 private:
-    std::map<HandleType, ValuePtr> fMap;
+    std::atomic<int> fSize{0};
+};
+
+/**
+ * Serialized first frames of recently sent values, shared by the senders of several connections
+ * (see AbstractSender::setSerializationCache()), so that a value forwarded to several peers is
+ * serialized once. The senders send copies of the cached frame, which share its buffer by
+ * reference counting instead of copying it.
+ *
+ * Values are identified by their shared pointer, i.e. a copy of a value is serialized again.
+ * Up to capacity frames are kept, the oldest ones are replaced first.
+ */
+class SerializationCache {
+public:
+    explicit SerializationCache(std::size_t capacity = 8);
+
+    /**
+     * Look up the serialized frame of a value
+     *
+     * @param value     The value
+     * @param frame     Set to a copy of the cached frame sharing its buffer
+     * @param extMemPtr Set to the ExtMem part of the value, nullptr if it has none
+     * @param extMemLen Set to the size of the ExtMem part
+     * @return false if the value is not cached
+     */
+    bool find(const ValuePtr& value, zmq::message_t& frame, const void*& extMemPtr, std::size_t& extMemLen,
+              bool numericTypeId = false, uint64_t seq = 0);
+
+    /**
+     * Add the serialized frame of a value, see find(). Frames carrying the numeric id of the type
+     * are kept apart from frames carrying its name, and frames of different sequence numbers
+     * apart from each other, see sendValue().
+     */
+    void insert(const ValuePtr& value, zmq::message_t&& frame, const void* extMemPtr, std::size_t extMemLen,
+                bool numericTypeId = false, uint64_t seq = 0);
+
+private:
+    struct Entry {
+        std::weak_ptr<const Value> value;
+        zmq::message_t frame;
+        const void* extMemPtr = nullptr;
+        std::size_t extMemLen = 0;
+        bool numericTypeId = false;
+        uint64_t seq = 0;
+    };
+
     std::mutex fMutex;
+    std::vector<Entry> fEntries;
+    std::size_t fNext = 0;
 };
 
 // forward declarations
@@ -209,16 +343,231 @@ private:
  * Sends a Value to a receiver over a socket using messagepack (for serialization) and
  * 0MQ (to transfer).
  *
+ * The value message carries the type of the value by its name, or by its numeric id if the
+ * receiver supports this, which it announces in its response to pings (see packClockResponse()).
+ * Numeric ids shrink the message of small values and are looked up faster by the receiver.
+ *
+ * The value message also carries the sequence number of the write of the value to its topic
+ * (see IValueReceiver::receive()), so that the receiver can tell values lost on the way.
+ *
+ * @param value         The value to be transferred
+ * @param seq           Sequence number of the value in its topic, 0 if unknown
+ * @param typeInfo      Type information indicating the actual (sub)type of value
+ * @param socket        The socket to be used for data transfer
+ * @param sendMore      A flag indicating if more data will be appended to the current communication
+ * @param numericTypeId Send the numeric id of the type instead of its name
+ */
+extern void sendValue(
+    ValuePtr value,
+    uint64_t seq,
+    const TypeRegistry::TypemapEntry& typeInfo,
+    zmq::socket_t& socket,
+    bool sendMore=false,
+    bool numericTypeId=false);
+
+/**
+ * Sends a Value like sendValue(), but instead of its ExtMem part, a handle to the ExtMem part
+ * exported by the value (see IExtMemValue::extMemExport()), so that the receiving process on the
+ * same machine maps it without copying, e.g. device memory.
+ *
  * @param value    The value to be transferred
+ * @param seq      Sequence number of the value in its topic, see sendValue()
  * @param typeInfo Type information indicating the actual (sub)type of value
  * @param socket   The socket to be used for data transfer
+ * @param handle   The handle of the exported ExtMem part
+ * @param numericTypeId Send the numeric id of the type instead of its name, see sendValue()
+ */
+extern void sendExportedValue(
+    ValuePtr value,
+    uint64_t seq,
+    const TypeRegistry::TypemapEntry& typeInfo,
+    zmq::socket_t& socket,
+    const std::string& handle,
+    bool numericTypeId=false);
+
+/**
+ * Sends a RelayedValue in the frames sendValue() sent the value it was received as, without
+ * serializing it again. Only the trailing sequence number of the first frame is replaced.
+ *
+ * @param value    The value to be transferred
+ * @param seq      Sequence number of the value in its topic, see sendValue()
+ * @param socket   The socket to be used for data transfer
  * @param sendMore A flag indicating if more data will be appended to the current communication
  */
+extern void sendRelayedValue(
+    const std::shared_ptr<const RelayedValue>& value,
+    uint64_t seq,
+    zmq::socket_t& socket,
+    bool sendMore=false);
+
+/**
+ * Unpacks the value a RelayedValue was received as, for transfers which cannot forward the wire
+ * format, e.g. over shared memory or with compression.
+ * Throws a ReceiveError if the type of the value is not present in the type registry.
+ *
+ * @param typeRegistry A registry holding the type information of the value
+ * @param value        The relayed value
+ */
+extern ValuePtr decodeRelayedValue(TypeRegistry& typeRegistry, const RelayedValue& value);
+
+/**
+ * Sends a Value like sendValue(), but takes its serialized first frame from the cache if another
+ * sender has already serialized the value, or adds it to the cache otherwise.
+ *
+ * @param value    The value to be transferred
+ * @param seq      Sequence number of the value in its topic, see sendValue()
+ * @param typeInfo Type information indicating the actual (sub)type of value
+ * @param socket   The socket to be used for data transfer
+ * @param cache    The cache shared by the senders of the value
+ * @param numericTypeId Send the numeric id of the type instead of its name, see sendValue()
+ */
 extern void sendValue(
     ValuePtr value,
+    uint64_t seq,
     const TypeRegistry::TypemapEntry& typeInfo,
     zmq::socket_t& socket,
-    bool sendMore=false);
+    SerializationCache& cache,
+    bool numericTypeId=false);
+
+/**
+ * Appends a Value to the payload of a batch message, which carries several values in a single
+ * frame. Per value, the payload holds the topic and, as a binary, the same serialization as the
+ * first frame of a value message.
+ *
+ * @param buffer   The batch payload
+ * @param topic    Topic of the value
+ * @param value    The value to be transferred
+ * @param seq      Sequence number of the value in its topic, see sendValue()
+ * @param typeInfo Type information indicating the actual (sub)type of value
+ * @param numericTypeId Send the numeric id of the type instead of its name, see sendValue()
+ *
+ * @return false if the value has an ExtMem part and cannot be batched, the buffer is unchanged
+ */
+extern bool packBatchEntry(
+    msgpack::sbuffer& buffer,
+    const std::string& topic,
+    ValuePtr value,
+    uint64_t seq,
+    const TypeRegistry::TypemapEntry& typeInfo,
+    bool numericTypeId=false);
+
+/**
+ * Appends a RelayedValue to the payload of a batch message in its wire format, see
+ * packBatchEntry() above.
+ *
+ * @return false if the value has an ExtMem part and cannot be batched, the buffer is unchanged
+ */
+extern bool packBatchEntry(
+    msgpack::sbuffer& buffer,
+    const std::string& topic,
+    const RelayedValue& value,
+    uint64_t seq);
+
+/**
+ * Sizes of a value sent by sendCompressedValue()
+ */
+struct CompressionResult
+{
+    /// serialized size of the value including its ExtMem part
+    std::size_t rawBytes = 0;
+    /// size of the value frames sent
+    std::size_t wireBytes = 0;
+};
+
+/**
+ * Sends a Value like sendValue(), but compresses its frames with deflate. A header frame in
+ * front of the value frames holds the uncompressed size of each value frame, or 0 if the frame is
+ * sent uncompressed because it is smaller than minSize or does not shrink.
+ *
+ * Throws a std::runtime_error if the library has been built without HAVE_ZLIB.
+ *
+ * @param value    The value to be transferred
+ * @param seq      Sequence number of the value in its topic, see sendValue()
+ * @param typeInfo Type information indicating the actual (sub)type of value
+ * @param socket   The socket to be used for data transfer
+ * @param level    The compression level from 1 (fastest) to 9 (smallest)
+ * @param minSize  Frames smaller than this are sent uncompressed
+ * @param numericTypeId Send the numeric id of the type instead of its name, see sendValue()
+ *
+ * @return The size of the value before and after compression
+ */
+extern CompressionResult sendCompressedValue(
+    ValuePtr value,
+    uint64_t seq,
+    const TypeRegistry::TypemapEntry& typeInfo,
+    zmq::socket_t& socket,
+    int level,
+    std::size_t minSize,
+    bool numericTypeId=false);
+
+/**
+ * @brief Receives a value message sent with sendCompressedValue() and decompresses its frames
+ *
+ * A decompressed ExtMem part is owned by the message (see ZmqMessage::extMemOwner), so that
+ * values can refer to it instead of copying it.
+ *
+ * @param messageHandler A handler of a locally allocated value message that should decode and pass
+ *                       the message on
+ * @param socket         0MQ connection
+ */
+extern void receiveCompressedMessage(
+    const std::function<void(ZmqMessage&)>& messageHandler,
+    zmq::socket_t& socket);
+
+/**
+ * @brief Converts a time to the representation exchanged with the peer, i.e. the nanoseconds
+ *        since the epoch of the system clock
+ */
+inline int64_t toWireTime(std::chrono::system_clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+/**
+ * @brief Converts a time received from the peer, see toWireTime()
+ */
+inline std::chrono::system_clock::time_point fromWireTime(int64_t time)
+{
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(time)));
+}
+
+/**
+ * @brief Creates the response to a ping, which carries the clock of the responding side and
+ *        announces that it accepts numeric type ids in value messages and imports exported
+ *        values sent from its host (see hostId() and sendExportedValue())
+ *
+ * The response is a string like any other response, so that senders not evaluating it are not
+ * affected.
+ *
+ * @param pingReceived Time the ping was received
+ * @param responseSent Time the response is sent
+ */
+extern std::string packClockResponse(
+    std::chrono::system_clock::time_point pingReceived,
+    std::chrono::system_clock::time_point responseSent);
+
+/**
+ * @brief Parses a response created by packClockResponse()
+ *
+ * @param numericTypeIds   Set to whether the peer accepts numeric type ids, see sendValue()
+ * @param extMemImportHost Set to the host id of the peer if it imports exported values, empty
+ *                         otherwise
+ *
+ * @return false if the response carries no clock, e.g. because the peer does not send it
+ */
+extern bool unpackClockResponse(
+    const std::string& response,
+    std::chrono::system_clock::time_point& pingReceived,
+    std::chrono::system_clock::time_point& responseSent,
+    bool& numericTypeIds,
+    std::string& extMemImportHost);
+
+/**
+ * @brief Identifies the machine and its current boot, exported values can only be imported by
+ *        processes with the same id
+ */
+extern const std::string& hostId();
 
 /**
  * Receives a Value from a sender over a socket using messagepack (for serialization)
@@ -252,6 +601,7 @@ class ShmemClient;
  * (to transfer) and boost shared memory to transfer the ExtMem part of ExtMemValues
  *
  * @param Value       The value to be transferred
+ * @param seq         Sequence number of the value in its topic, see sendValue()
  * @param typeInfo    Type information indicating the actual (sub)type of value
  * @param socket      The socket to be used for data transfer of the non-ExtMem part of the value
  * @param connection  A string naming the shared memory channel to be used for transfering
@@ -259,14 +609,17 @@ class ShmemClient;
  * @param shmemKeeper Pointer to a data structure that owns the shared memory used to transfer
  *                    ExtMem parts of values. Unused if a non-ExtMemValue is transferred
  * @param sendMore    A flag indicating if more data will be appended to the current communication
+ * @param numericTypeId Send the numeric id of the type instead of its name, see sendValue()
  */
 extern void sendValue(
     ValuePtr value,
+    uint64_t seq,
     const TypeRegistry::TypemapEntry& typeInfo,
     zmq::socket_t& socket,
     const std::string& connection,
     ShmemKeeper* shmemKeeper,
-    bool sendMore=false);
+    bool sendMore=false,
+    bool numericTypeId=false);
 
 /**
  * receives a Value from a sender over a socket using messagepack (for serialization) and 0MQ
@@ -6,29 +6,56 @@
 #define MCF_REMOTE_CONTROL_H
 
 #include "mcf_core/Mcf.h"
+#include "mcf_core/QueuedEventSource.h"
 #include "mcf_remote/Remote.h"
+#include "mcf_remote/ZmqContext.h"
 #include "zmq.hpp"
 
 #include <ratio>
 #include <atomic>
+#include <chrono>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace mcf {
 
 // forward declarations
 class ReplayEventController;
-class QueuedEventSource;
 
 namespace remote {
 
 /**
  * The RemoteControl class allows various commands to be sent via the python interface in
  * remote_control.py to control MCF using msgpack and zmq. It can:
- *      - Read and write values directly to the value store.
+ *      - Read and write values directly to the value store, also several topics per request.
+ *      - Publish the values of subscribed topics on a PUB socket when they change.
  *      - Connect and disconnect ports.
  *      - Get information about components.
  *      - Control replay playback via the ReplayEventController.
  *      - Manage dynamic events via an event source queue.
+ *      - Enable component tracing and select the traced components, topics and events.
+ *
+ * Subscriptions are published on a PUB socket bound to an ephemeral port, which is reported by
+ * the command publish_port. Every message consists of the topic frame, the packed value and the
+ * ext mem frame, which is empty for values without ext mem. Each subscription limits the rate at
+ * which its topic is published; changes in between are skipped. Subscriptions are shared by all
+ * clients and only checked between requests, i.e. at most every POLL_INTERVAL.
+ *
+ * Values can also be streamed in without a response per value, e.g. by playback tools: the
+ * command inject_port binds a PULL socket to an ephemeral port and reports it. Every message on it
+ * consists of a header frame, a packed map with the topic and optionally the timestamp, component
+ * and port as for write_value, the packed value and the ext mem frame, which is empty for values
+ * without ext mem. Values with a timestamp are pushed to the event source queue in batches of up
+ * to INJECT_BATCH_SIZE while event queueing is enabled, the others are written to the value store
+ * at once. Flow control is left to 0MQ: the socket is not read while the event source queue holds
+ * max_queued events or more (if given), so a sender blocks once its send high-water mark is
+ * reached. The number of injected values is reported by event_queue_info.
+ *
+ * Components and ports are taken from a snapshot which is refreshed when the topology generation
+ * of the component manager changes. Ports are addressed by the component id and port name, or
+ * by their indices in the get_info response.
  */
 class RemoteControl : public Component {
 
@@ -101,13 +128,56 @@ public:
 
 private:
 
+    /**
+     * State of a subscribed topic
+     */
+    struct Subscription
+    {
+        /// minimum time between two publications, zero for no limit
+        std::chrono::steady_clock::duration minInterval;
+        std::chrono::steady_clock::time_point nextDue;
+        /// value published last, to skip unchanged values
+        ValuePtr lastValue;
+    };
+
+    /**
+     * Components and ports as of a topology generation of the component manager, along with the
+     * serialized get_info response and the port connection states it was built for
+     */
+    struct TopologySnapshot
+    {
+        uint64_t generation;
+        std::vector<ComponentProxy> components;
+        /// ports per component, in the order of components
+        std::vector<std::vector<PortProxy>> ports;
+        std::map<uint64_t, size_t> componentIndices;
+        /// port indices by name, per component
+        std::vector<std::map<std::string, size_t>> portIndices;
+        std::vector<bool> connected;
+        msgpack::sbuffer info;
+    };
+
+    /// interval in which changes of subscribed topics are checked at most
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{10};
+    /// time the loop waits for requests without subscriptions
+    static constexpr std::chrono::milliseconds RECEIVE_TIMEOUT{100};
+    /// maximum number of injected values handled per loop, between requests
+    static constexpr size_t INJECT_BATCH_SIZE = 256;
+
     void run();
     void getReplayParams(msgpack::zone& zone);
     void getSimTime(msgpack::zone& zone);
+    void getValueStoreStats(msgpack::zone& zone);
+    void getTraceFilter(msgpack::zone& zone);
+    void setTraceFilter(const msgpack::object& request, msgpack::zone& zone);
     void setPlaybackModifier(const msgpack::object& request, msgpack::zone& zone);
     void setReplayParams(const msgpack::object& request, msgpack::zone& zone);
+    void seekReplay(const msgpack::object& request, msgpack::zone& zone);
     void processRequest(const msgpack::object& request);
-    msgpack::object commandGetInfo(const msgpack::object& request, msgpack::zone& zone);
+    TopologySnapshot& topology();
+    void getInfo(msgpack::zone& zone);
+    msgpack::object commandGetInfo(
+        const TopologySnapshot& topology, const std::vector<bool>& connected, msgpack::zone& zone);
     mcf::PortProxy findPort( const msgpack::object& request, msgpack::zone& zone);
     void connectPort(const msgpack::object& request, msgpack::zone& zone, bool connect);
     void getPortBlocking(const msgpack::object& request, msgpack::zone& zone);
@@ -115,11 +185,45 @@ private:
     void getPortMaxQueueLength(const msgpack::object& request, msgpack::zone& zone);
     void setPortMaxQueueLength(const msgpack::object& request, msgpack::zone& zone);
     void readValue(const msgpack::object& request, msgpack::zone& zone);
+    void readValues(const msgpack::object& request, msgpack::zone& zone);
+    void publishPort(msgpack::zone& zone);
+    void subscribe(const msgpack::object& request, msgpack::zone& zone);
+    void unsubscribe(const msgpack::object& request, msgpack::zone& zone);
+    void injectPort(const msgpack::object& request, msgpack::zone& zone);
+
+    /**
+     * Whether the injection socket is to be read, i.e. it is bound and the event source queue is
+     * below the limit of queued events
+     */
+    bool acceptsInjected() const;
+
+    /**
+     * Receives up to INJECT_BATCH_SIZE messages from the injection socket without waiting
+     */
+    void receiveInjected();
+
+    /**
+     * Publishes the subscribed topics whose values have changed and are due
+     *
+     * @return time until the next subscription is to be checked
+     */
+    std::chrono::milliseconds publishSubscriptions();
+
+    /**
+     * Sends the packed value followed by its ext mem frame, which is empty if the value has no
+     * ext mem, so that the frames of several values can be told apart.
+     */
+    void sendValueFrames(
+        zmq::socket_t& socket,
+        ValuePtr value,
+        const TypeRegistry::TypemapEntry& typeInfo,
+        bool sendMore);
     void writeValue(const msgpack::object& request, msgpack::zone& zone);
     void setQueue(const msgpack::object& request, msgpack::zone& zone);
     msgpack::object commandEventQueueInfo(msgpack::zone& zone);
     void commandEnableEventQueue(const msgpack::object& request, msgpack::zone& zone);
     void sendResponse(const msgpack::object& responseObj, bool sendMore=false);
+    void sendPackedResponse(const msgpack::sbuffer& buffer, bool sendMore=false);
     void sendErrorResponse(const std::string& message, msgpack::zone& zone);
     void sendEmptyResponse(msgpack::zone& zone, bool sendMore=false);
 
@@ -131,9 +235,25 @@ private:
     std::shared_ptr<ReplayEventController> fReplayEventController;
     std::shared_ptr<QueuedEventSource> fRemoteControlEventSource;
     int fServerPort;
-    zmq::context_t fContext;
+    // shared by all endpoints of the process, see remote::ZmqContext
+    std::shared_ptr<zmq::context_t> fContext;
     zmq::socket_t fSocket;
+    zmq::socket_t fPublishSocket;
+    // port of fPublishSocket, 0 until it is bound on the first request for it
+    int fPublishPort;
+    zmq::socket_t fInjectSocket;
+    // port of fInjectSocket, 0 until it is bound on the first request for it
+    int fInjectPort;
+    // events in the event source queue above which injected values are not read, 0 for no limit
+    size_t fInjectQueueLimit;
+    uint64_t fInjected;
+    uint64_t fInjectErrors;
+    std::vector<QueuedEventSource::NewEvent> fInjectBatch;
     std::map<std::string, std::shared_ptr<mcf::ValueQueue>> fQueueMap;
+    std::map<std::string, Subscription> fSubscriptions;
+    std::unique_ptr<TopologySnapshot> fTopology;
+    // reused for unpacking the requests
+    msgpack::zone fRequestZone;
 
     std::atomic<bool> fIsEventQueueEnabled;
 };
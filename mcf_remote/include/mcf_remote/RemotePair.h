@@ -9,7 +9,12 @@
 #include "mcf_remote/IComEventListener.h"
 #include "mcf_remote/RemoteStatusTracker.h"
 
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
 
 namespace mcf
 {
@@ -33,12 +38,40 @@ public:
      */
     virtual std::string valueReceived(const std::string& topic, ValuePtrType value) = 0;
 
+    /**
+     * @brief Value reception handler for values sent with their sequence number, see
+     *        IComEventListener::valueReceived(). By default, the number is ignored.
+     *
+     * @param topic The topic of the received value
+     * @param value The actual received value
+     * @param seq   Sequence number of the value in its topic at the sender, 0 if not sent
+     * @return A stringly-typed response
+     */
+    virtual std::string valueReceived(const std::string& topic, ValuePtrType value, uint64_t seq)
+    {
+        return valueReceived(topic, std::move(value));
+    }
+
     /**
      * @brief Handler for the request for all available values.
      *
      */
     virtual void sendAll() = 0;
 
+    /**
+     * @brief Handler for the request for the values the remote side does not hold yet.
+     *
+     * @param heldIds Per remote topic, the id of the latest value held by the remote side
+     */
+    virtual void sendStale(const std::map<std::string, uint64_t>& heldIds) { sendAll(); }
+
+    /**
+     * @brief Handler for the topics the remote side announced to have subscribers for.
+     *
+     * @param subscribed Per remote topic, whether the remote side has subscribers for it
+     */
+    virtual void subscriptionsReceived(const std::map<std::string, bool>& subscribed) {}
+
     /**
      * @brief Handler that resets pending values.
      *
@@ -99,6 +132,7 @@ public:
      */
     RemotePair(RemotePair&& other)
     : _sender(std::move(other._sender))
+    , _workers(std::move(other._workers))
     , _receiver(std::move(other._receiver))
     , _artificialJitter(std::move(other._artificialJitter))
     , _remoteStatusTracker(
@@ -106,6 +140,8 @@ public:
         [this](uint64_t fv) -> void { _sender->sendPing(fv); })
     {
         _receiver->setEventListener(this);
+        observeCompression();
+        observeClock();
     }
 
     virtual ~RemotePair();
@@ -122,10 +158,139 @@ public:
      *
      * @param topic The topic to send on
      * @param value The value to send
+     * @param seq   Sequence number of the value in its topic, see AbstractSender::sendValue()
      * @return A (stringly-typed) result of the sending operation. Can be one of "INJECTED",
      * "REJECTED", "TIMEOUT"
      */
-    std::string sendValue(const std::string& topic, ValuePtr value);
+    std::string sendValue(const std::string& topic, ValuePtr value, uint64_t seq = 0);
+
+    /**
+     * @brief Adds a sender with its own connection to the remote side. Values sent through it
+     * with sendValue(worker, ...) do not wait for the main sender or the other workers, so that
+     * several threads may serialize and send values at the same time. Pings and control
+     * messages are only sent by the main sender.
+     *
+     * Shall only be called before the sender is connected.
+     *
+     * @param sender Sender connected to the same remote receiver as the main sender
+     */
+    void addSendWorker(std::unique_ptr<AbstractSender> sender);
+
+    /**
+     * @brief Number of senders added with addSendWorker()
+     */
+    size_t sendWorkers() const { return _workers.size(); }
+
+    /**
+     * @brief Sends a value over the sender of a worker, see addSendWorker()
+     *
+     * @param worker Index of the worker, in the order the workers were added
+     * @param topic  The topic to send on
+     * @param value  The value to send
+     * @param seq    Sequence number of the value in its topic, see sendValue()
+     * @return The result of the sending operation, see sendValue()
+     */
+    std::string sendValue(size_t worker, const std::string& topic, ValuePtr value, uint64_t seq = 0);
+
+    /**
+     * @brief Sends several values over the wire, coalescing them into as few messages as possible
+     *
+     * @param values   The topics and values to send
+     * @param maxBytes Maximum size of the serialized values coalesced into one message
+     * @param seqs     Sequence numbers of the values, see sendValue(), empty if unknown
+     * @return The result of every value, see sendValue()
+     */
+    std::vector<std::string> sendValues(
+        const std::vector<std::pair<std::string, ValuePtr>>& values, size_t maxBytes,
+        const std::vector<uint64_t>& seqs = std::vector<uint64_t>());
+
+    /**
+     * @brief Checks if values may be sent with sendValueAsync()
+     */
+    bool supportsPipelining() const { return _sender->supportsPipelining(); }
+
+    /**
+     * @brief Sends a value over the wire without waiting for the response, see pollAcks()
+     *
+     * @param topic The topic to send on
+     * @param value The value to send
+     * @param seq   Sequence number of the value in its topic, see sendValue()
+     * @return "SENT" or "REJECTED"
+     */
+    std::string sendValueAsync(const std::string& topic, ValuePtr value, uint64_t seq = 0);
+
+    /**
+     * @brief Collects the responses to values sent with sendValueAsync()
+     *
+     * @param acks    Vector the responses are appended to
+     * @param timeout Maximum time to wait for a response if none has arrived yet
+     */
+    void pollAcks(std::vector<AbstractSender::Ack>& acks, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Compresses the values sent on a topic, see AbstractSender::setCompression()
+     *
+     * @param topic       The topic whose values shall be compressed
+     * @param compression Compression level and size threshold
+     */
+    void setCompression(const std::string& topic, const AbstractSender::Compression& compression);
+
+    /**
+     * @brief Shares the serialization of sent values with other remote pairs, see
+     * AbstractSender::setSerializationCache()
+     */
+    void setSerializationCache(std::shared_ptr<SerializationCache> cache)
+    {
+        std::lock_guard<std::mutex> lk(_mtxS);
+        for (auto& worker : _workers)
+        {
+            std::lock_guard<std::mutex> lkWorker(*worker.mtx);
+            worker.sender->setSerializationCache(cache);
+        }
+        _sender->setSerializationCache(std::move(cache));
+    }
+
+    /**
+     * @brief Sends exportable ExtMem parts as handles, see AbstractSender::setExtMemExport()
+     */
+    void setExtMemExport(bool enable)
+    {
+        for (auto& worker : _workers)
+        {
+            worker.sender->setExtMemExport(enable);
+        }
+        _sender->setExtMemExport(enable);
+    }
+
+    /**
+     * @brief Receives the values of the passed topics in their wire format, see
+     * AbstractReceiver::setRelayTopics()
+     */
+    void setRelayTopics(const std::set<std::string>& topics) { _receiver->setRelayTopics(topics); }
+
+    /**
+     * @brief Returns the compression statistics of all topics with compressed values
+     */
+    std::map<std::string, RemoteStatusTracker::CompressionStatistics> compressionStatistics() const
+    {
+        return _remoteStatusTracker.getCompressionStatistics();
+    }
+
+    /**
+     * @brief Returns the estimate of the clock of the other side
+     */
+    RemoteStatusTracker::ClockEstimate clockEstimate() const
+    {
+        return _remoteStatusTracker.getClockEstimate();
+    }
+
+    /**
+     * @brief Returns the transport latency statistics of all topics with stamped values
+     */
+    std::map<std::string, RemoteStatusTracker::LatencyStatistics> latencyStatistics() const
+    {
+        return _remoteStatusTracker.getLatencyStatistics();
+    }
 
     /**
      * @brief Communicates to the remote point that a previously blocked value has been injected.
@@ -151,6 +316,25 @@ public:
         return _endpoint->valueReceived(topic, value);
     }
 
+    /*
+     * See base class IComEventListener
+     */
+    std::string valueReceived(const std::string& topic, ValuePtrType value, uint64_t seq) override
+    {
+        return _endpoint->valueReceived(topic, value, seq);
+    }
+
+    /*
+     * See base class IComEventListener
+     */
+    void valueStampReceived(
+        const std::string& topic,
+        std::chrono::system_clock::time_point sent,
+        std::chrono::system_clock::time_point received) override
+    {
+        _remoteStatusTracker.valueStampReceived(topic, sent, received);
+    }
+
     /*
      * See base class IComEventListener
      */
@@ -166,6 +350,26 @@ public:
      */
     void requestAllReceived() override;
 
+    /*
+     * See base class IComEventListener
+     */
+    void requestStaleReceived(const std::map<std::string, uint64_t>& heldIds) override
+    {
+        if (_endpoint) {
+            _endpoint->sendStale(heldIds);
+        }
+    }
+
+    /*
+     * See base class IComEventListener
+     */
+    void subscriptionsReceived(const std::map<std::string, bool>& subscribed) override
+    {
+        if (_endpoint) {
+            _endpoint->subscriptionsReceived(subscribed);
+        }
+    }
+
     /*
      * See base class IComEventListener
      */
@@ -196,6 +400,24 @@ public:
      */
     void sendRequestAll() { _sender->sendRequestAll(); }
 
+    /**
+     * Sends a control message requesting the values whose latest ids on the remote side differ
+     * from the passed ones, see AbstractSender::sendRequestStale()
+     */
+    void sendRequestStale(const std::map<std::string, uint64_t>& heldIds)
+    {
+        _sender->sendRequestStale(heldIds);
+    }
+
+    /**
+     * Announces which remote topics have local subscribers, see
+     * AbstractSender::sendSubscriptions()
+     */
+    void sendSubscriptions(const std::map<std::string, bool>& subscribed)
+    {
+        _sender->sendSubscriptions(subscribed);
+    }
+
     /**
      * Returns the remote state, i.e. the current assumption if the other side of this remote pair
      * (i.e. the process we want to communicate with) is up/down or the state is not known.
@@ -252,6 +474,15 @@ public:
      */
     void waitForEvent(){ _remoteStatusTracker.waitForEvent(); }
 
+    /**
+     * Sets a function called on every change of the remote state, see
+     * RemoteStatusTracker::setEventObserver()
+     */
+    void setEventObserver(std::function<void()> observer)
+    {
+        _remoteStatusTracker.setEventObserver(std::move(observer));
+    }
+
     /**
      * Returns a string that represents the currently assumed remote state.
      *
@@ -271,7 +502,18 @@ public:
     void cycle();
 
 private:
+    /**
+     * Sender added with addSendWorker(), used by one thread at a time
+     */
+    struct SendWorker
+    {
+        std::unique_ptr<AbstractSender> sender;
+        std::unique_ptr<std::mutex> mtx;
+    };
+
     void sendPongs();
+    void observeCompression();
+    void observeClock();
     void changeFromUp(RemoteStatusTracker::RemoteState);
 
     void traceDataTransferDuration(
@@ -280,6 +522,7 @@ private:
         const std::string& name);
 
     std::unique_ptr<AbstractSender> _sender;
+    std::vector<SendWorker> _workers;
     std::unique_ptr<AbstractReceiver<ValuePtrType> > _receiver;
 
     IRemoteEndpoint<ValuePtrType>* _endpoint;
@@ -305,6 +548,8 @@ RemotePair<ValuePtrType>::RemotePair(
 {
     _sender->connect();
     _receiver->setEventListener(this);
+    observeCompression();
+    observeClock();
 }
 
 template <typename ValuePtrType>
@@ -323,6 +568,11 @@ void
 RemotePair<ValuePtrType>::connectSender()
 {
     _sender->connect();
+    for (auto& worker : _workers)
+    {
+        std::lock_guard<std::mutex> lk(*worker.mtx);
+        worker.sender->connect();
+    }
 }
 
 template <typename ValuePtrType>
@@ -338,6 +588,11 @@ void
 RemotePair<ValuePtrType>::disconnectSender()
 {
     _sender->disconnect();
+    for (auto& worker : _workers)
+    {
+        std::lock_guard<std::mutex> lk(*worker.mtx);
+        worker.sender->disconnect();
+    }
 }
 
 template <typename ValuePtrType>
@@ -361,7 +616,7 @@ RemotePair<ValuePtrType>::receive(std::chrono::milliseconds timeout)
 
 template <typename ValuePtrType>
 std::string
-RemotePair<ValuePtrType>::sendValue(const std::string& topic, ValuePtr value)
+RemotePair<ValuePtrType>::sendValue(const std::string& topic, ValuePtr value, uint64_t seq)
 {
     std::lock_guard<std::mutex> lk(_mtxS);
     if(_artificialJitter.count() > 0)
@@ -369,7 +624,7 @@ RemotePair<ValuePtrType>::sendValue(const std::string& topic, ValuePtr value)
         std::this_thread::sleep_for(std::chrono::milliseconds(
             std::rand() % (_artificialJitter.count() + 1)));
     }
-    auto result = _sender->sendValue(topic, std::move(value));
+    auto result = _sender->sendValue(topic, std::move(value), seq);
     if (result == "TIMEOUT")
     {
         _remoteStatusTracker.sendingTimeout();
@@ -377,6 +632,129 @@ RemotePair<ValuePtrType>::sendValue(const std::string& topic, ValuePtr value)
     return result;
 }
 
+template <typename ValuePtrType>
+void
+RemotePair<ValuePtrType>::addSendWorker(std::unique_ptr<AbstractSender> sender)
+{
+    sender->connect();
+    _workers.push_back({std::move(sender), std::make_unique<std::mutex>()});
+    observeCompression();
+}
+
+template <typename ValuePtrType>
+std::string
+RemotePair<ValuePtrType>::sendValue(size_t worker, const std::string& topic, ValuePtr value, uint64_t seq)
+{
+    SendWorker& sendWorker = _workers.at(worker);
+    std::lock_guard<std::mutex> lk(*sendWorker.mtx);
+    if(_artificialJitter.count() > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(
+            std::rand() % (_artificialJitter.count() + 1)));
+    }
+    auto result = sendWorker.sender->sendValue(topic, std::move(value), seq);
+    if (result == "TIMEOUT")
+    {
+        _remoteStatusTracker.sendingTimeout();
+    }
+    return result;
+}
+
+template <typename ValuePtrType>
+std::vector<std::string>
+RemotePair<ValuePtrType>::sendValues(
+    const std::vector<std::pair<std::string, ValuePtr>>& values, size_t maxBytes,
+    const std::vector<uint64_t>& seqs)
+{
+    std::lock_guard<std::mutex> lk(_mtxS);
+    if(_artificialJitter.count() > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(
+            std::rand() % (_artificialJitter.count() + 1)));
+    }
+    auto results = _sender->sendValues(values, maxBytes, seqs);
+    if (std::find(results.begin(), results.end(), "TIMEOUT") != results.end())
+    {
+        _remoteStatusTracker.sendingTimeout();
+    }
+    return results;
+}
+
+template <typename ValuePtrType>
+std::string
+RemotePair<ValuePtrType>::sendValueAsync(const std::string& topic, ValuePtr value, uint64_t seq)
+{
+    std::lock_guard<std::mutex> lk(_mtxS);
+    if(_artificialJitter.count() > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(
+            std::rand() % (_artificialJitter.count() + 1)));
+    }
+    return _sender->sendValueAsync(topic, std::move(value), seq);
+}
+
+template <typename ValuePtrType>
+void
+RemotePair<ValuePtrType>::pollAcks(
+    std::vector<AbstractSender::Ack>& acks, std::chrono::milliseconds timeout)
+{
+    std::lock_guard<std::mutex> lk(_mtxS);
+    const size_t first = acks.size();
+    _sender->pollAcks(acks, timeout);
+    for (size_t i = first; i < acks.size(); ++i)
+    {
+        if (acks[i].result == "TIMEOUT")
+        {
+            // the values in flight time out together
+            _remoteStatusTracker.sendingTimeout();
+            break;
+        }
+    }
+}
+
+template <typename ValuePtrType>
+void
+RemotePair<ValuePtrType>::setCompression(
+    const std::string& topic, const AbstractSender::Compression& compression)
+{
+    std::lock_guard<std::mutex> lk(_mtxS);
+    _sender->setCompression(topic, compression);
+    for (auto& worker : _workers)
+    {
+        std::lock_guard<std::mutex> lkWorker(*worker.mtx);
+        worker.sender->setCompression(topic, compression);
+    }
+}
+
+template <typename ValuePtrType>
+void
+RemotePair<ValuePtrType>::observeCompression()
+{
+    auto observer =
+        [this](const std::string& topic,
+               std::size_t rawBytes,
+               std::size_t wireBytes,
+               std::chrono::nanoseconds duration) {
+            _remoteStatusTracker.valueCompressed(topic, rawBytes, wireBytes, duration);
+        };
+    _sender->setCompressionObserver(observer);
+    for (auto& worker : _workers)
+    {
+        worker.sender->setCompressionObserver(observer);
+    }
+}
+
+template <typename ValuePtrType>
+void
+RemotePair<ValuePtrType>::observeClock()
+{
+    _sender->setClockObserver(
+        [this](const AbstractSender::ClockSample& sample) {
+            _remoteStatusTracker.clockSampled(
+                sample.pingSent, sample.pingReceived, sample.responseSent, sample.responseReceived);
+        });
+}
+
 template <typename ValuePtrType>
 std::string
 RemotePair<ValuePtrType>::sendBlockedValueInjected(const std::string& topic)
@@ -484,6 +862,12 @@ RemotePair<ValuePtrType>::changeFromUp(const RemoteStatusTracker::RemoteState)
     // reset connection
     _sender->disconnect();
     _sender->connect();
+    for (auto& worker : _workers)
+    {
+        std::lock_guard<std::mutex> lk(*worker.mtx);
+        worker.sender->disconnect();
+        worker.sender->connect();
+    }
 
     if (_endpoint) {
         _endpoint->resetPendingValues();
@@ -7,7 +7,6 @@
 
 
 #include "mcf_core/Mcf.h"
-#include "mcf_core/PerfLogger.h"
 
 #include "zmq.hpp"
 #include "spdlog/spdlog.h"
@@ -91,12 +90,11 @@ private:
     ValueStore& fValueStore;
     std::string fServerPort;
     std::string fShmConnection;
-    zmq::context_t fContext;
+    // shared by all endpoints of the process, see ZmqContext
+    std::shared_ptr<zmq::context_t> fContext;
     zmq::socket_t fSocket;
     std::map<std::string, std::unique_ptr<GenericSenderPort>> fRoutingMap;
 
-    std::shared_ptr<spdlog::logger> _logger;
-
     std::shared_ptr<ShmemClient> fShmemClient;
 };
 
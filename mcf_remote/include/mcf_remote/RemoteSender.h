@@ -7,7 +7,8 @@
 
 
 #include "mcf_core/Mcf.h"
-#include "mcf_core/PerfLogger.h"
+
+#include "mcf_remote/ZmqContext.h"
 
 #include "zmq.hpp"
 #include "spdlog/spdlog.h"
@@ -78,11 +79,10 @@ private:
     void parseTarget(const std::string& target, std::string& socketName, std::string& shmemFile);
 
     ValueStore& fValueStore;
+    // shared by all endpoints of the process, see ZmqContext, outlives the sockets
+    std::shared_ptr<zmq::context_t> fContext;
     std::map<std::string, RoutingMapEntry> fRoutingMap;
     std::map<std::string, std::shared_ptr<zmq::socket_t>> fRequestSockets;
-    zmq::context_t fContext;
-
-    std::shared_ptr<spdlog::logger> _logger;
 
     // for access to shared memory segment for inter process communication
     std::shared_ptr<ShmemKeeper> fShmemKeeper;
@@ -98,7 +98,8 @@ void RemoteSender::addSendRule(const std::string& topic, const std::string& targ
         sockPtr = fRequestSockets.at(socketName);
     }
     catch (std::out_of_range& e) {
-        sockPtr = std::make_shared<zmq::socket_t>(fContext, ZMQ_REQ);
+        sockPtr = std::make_shared<zmq::socket_t>(*fContext, ZMQ_REQ);
+        ZmqContext::configureSocket(*sockPtr);
         sockPtr->connect(socketName);
         fRequestSockets[socketName] = sockPtr;
     }
@@ -6,6 +6,7 @@
 #define MCF_REMOTE_SERVICE_H
 
 #include "mcf_core/Component.h"
+#include "mcf_remote/FlowControl.h"
 #include "mcf_remote/IComEventListener.h"
 #include "mcf_remote/RemotePair.h"
 
@@ -16,9 +17,12 @@
 #include "mcf_remote/RemoteReceiver.h"
 
 #include "mcf_core/Mcf.h"
+#include "mcf_core/TimerWheel.h"
 
 #include <chrono>
+#include <deque>
 #include <mutex>
+#include <set>
 #include <condition_variable>
 
 namespace mcf {
@@ -27,13 +31,69 @@ namespace remote {
 
 /**
  * Component to exchange mcf Values between processes.
+ *
+ * If the sender supports pipelining, values are sent without waiting for the response of the
+ * receiver, up to the window of their send rule. The responses are processed as they arrive, a
+ * RECEIVED response blocks the topic until the remote side reports the value as injected or
+ * rejected, like in lockstep sending.
+ *
+ * With batching, the values available on the send rules are coalesced into batch messages with
+ * a single response each instead of being sent one by one, see setBatching().
+ *
+ * Send rules of the same priority form a lane. Higher lanes are served first, either strictly or
+ * weighted by their priority, see setSendScheduling(), so that bursts of large values on low
+ * priority rules do not delay small high priority values queued behind them.
+ *
+ * Whenever the connection comes up, the ids of the latest values on the receive rules are sent to
+ * the remote side, which then resends only the values of its send rules that differ from them.
+ * Resent values are released in priority order, see setResyncLimit().
+ *
+ * A RemoteService can announce which topics of its receive rules have local subscribers, see
+ * setAnnounceSubscriptions(). The remote side then pauses its send rules of the topics nobody
+ * subscribes to, dropping their values, and resends the latest value of a rule as soon as its
+ * topic gets a subscriber again. Paused rules are resumed when the connection goes down.
+ *
+ * Values received on relay rules are put into the value store in their wire format, see
+ * addRelayRule(), and forwarded by the send rules of other RemoteServices without being
+ * serialized again.
+ *
+ * If the transceiver has send workers, see RemotePair::addSendWorker(), the send rules are
+ * distributed over one thread per worker, which serialize and send the values of their rules on
+ * their own connection. Every rule is served by a single worker, so the values of a topic keep
+ * their order. Workers serve their rules in priority order, one value per rule and cycle, and are
+ * not used with pipelining or batching.
+ *
+ * Lockstep sending can be shaped and adapted to the bandwidth of the link, see setFlowControl().
+ *
+ * The send options, e.g. setBatching() or setFlowControl(), are read by the threads of the
+ * service without synchronization and shall only be changed while it is not running.
  */
 class RemoteService final: public Component, IRemoteEndpoint<ValuePtr>
 {
+public:
+    /**
+     * How send lanes of different priority share the connection
+     */
+    enum class SendScheduling
+    {
+        /// a lane is only served while all higher lanes have no values ready
+        STRICT,
+        /// in every send cycle, each rule of a lane sends up to its priority + 1 values
+        WEIGHTED
+    };
+
+private:
     struct SendState
     {
         bool forcedSend = false;
+        bool resyncPending = false; // latest value to be resent, not yet released to forcedSend
         bool sendPending = false; // sent without ack
+        // pipelined sending: per value sent without response, whether it is still held in the port
+        std::deque<bool> inFlight;
+        // queued values seen while the lane of the rule was decimated by the flow control
+        uint64_t decimated = 0;
+        // the remote side announced that it has no subscribers for the topic
+        bool paused = false;
     };
 
     struct SendRule
@@ -42,13 +102,38 @@ class RemoteService final: public Component, IRemoteEndpoint<ValuePtr>
         size_t queueLength;
         uint8_t prio;
         bool blocking;
+        size_t window;
         SendState state;
         std::unique_ptr<GenericQueuedReceiverPort> port;
     };
 
+    /**
+     * Send rules of the same priority
+     */
+    struct SendLane
+    {
+        uint8_t prio;
+        std::vector<std::pair<const std::string, SendRule>*> rules;
+    };
+
+    /**
+     * Thread sending the values of a share of the send rules over a send worker of the transceiver
+     */
+    struct SendWorker
+    {
+        // the send rules of the worker by descending priority
+        std::vector<std::pair<const std::string, SendRule>*> rules;
+        std::mutex mtx;
+        std::condition_variable cvar;
+        bool wake = false;
+        std::unique_ptr<std::thread, std::function<void (std::thread *)>> thread;
+    };
+
     struct ReceiveState
     {
         ValuePtr pendingValue = nullptr;
+        // sequence number the pending value was sent with
+        uint64_t pendingSeq = 0;
     };
 
     struct ReceiveRule
@@ -76,16 +161,23 @@ public:
      * @param topic           The topic whose values shall be forwarded to the target, using topic
      *                        as both local and remote topic
      * @param queueLength     Maximum number of values that are queued before forwarding
-     * @param prio            The sending priority of this rule
+     * @param prio            The sending priority of this rule, higher priorities are served
+     *                        first, see setSendScheduling()
      * @param blocking        If true the sender will be blocked blocked if the queue is full
      *                                until at least one Value has been taken from the queue
      *                        If false new Values will be dropped if the queue is full
+     * @param window          Maximum number of values sent without response if the sender
+     *                        supports pipelining. Blocking rules always use a window of 1, so
+     *                        that values which time out are sent again
+     * @param compression     Compression of the values on the wire, disabled by default
      */
     void addSendRule(
         const std::string& topic,
         size_t queueLength=1,
         bool blocking=false,
-        uint8_t prio=0);
+        uint8_t prio=0,
+        size_t window=1,
+        const AbstractSender::Compression& compression=AbstractSender::Compression());
 
     /**
      * Add a sending rule.
@@ -97,17 +189,39 @@ public:
      * @param tropicRemote    The topic name used to forward the values from topicLocal to the
      *                        target. Only one send rule for a topicRemote shall be added.
      * @param queueLength     Maximum number of values that are queued before forwarding
-     * @param prio            The sending priority of this rule
+     * @param prio            The sending priority of this rule, higher priorities are served
+     *                        first, see setSendScheduling()
      * @param blocking        If true the sender will be blocked if the queue is full
      *                                until at least one Value has been taken from the queue
      *                        If false new Values will be dropped if the queue is full
+     * @param window          Maximum number of values sent without response if the sender
+     *                        supports pipelining. Blocking rules always use a window of 1, so
+     *                        that values which time out are sent again
+     * @param compression     Compression of the values on the wire, disabled by default. The
+     *                        ratio and time are reported by getCompressionStatistics()
+     *
+     * If a QoS profile applies to topicLocal, its depth, reliability and priority replace
+     * queueLength, blocking and prio, see TopicQos.
      */
     void addSendRule(
         const std::string& topicLocal,
         const std::string& topicRemote,
         size_t queueLength=1,
         bool blocking=false,
-        uint8_t prio=0);
+        uint8_t prio=0,
+        size_t window=1,
+        const AbstractSender::Compression& compression=AbstractSender::Compression());
+
+    /**
+     * Let the queue of a send rule adjust its length to the observed arrival and sending rates,
+     * within the given bounds, see ValueQueue::enableAdaptiveLength()
+     *
+     * The length changes are published with the handler statistics of the service.
+     *
+     * @param topicRemote     The remote topic of a send rule added before
+     * @param adaptive        Bounds of the queue length, target latency and drop rate
+     */
+    void setAdaptiveQueueLength(const std::string& topicRemote, const ValueQueue::AdaptiveLength& adaptive);
 
     /**
      * Add a receiving rule.
@@ -130,6 +244,25 @@ public:
      */
     void addReceiveRule(const std::string& topicLocal, const std::string& topicRemote);
 
+    /**
+     * Add a receiving rule which keeps the received values in their wire format, as
+     * RelayedValue, instead of decoding them. Send rules of other RemoteServices on topicLocal
+     * forward them as they were received, e.g. in gateways routing values between networks.
+     * Values are only decoded if the forwarding connection uses shared memory or compression.
+     *
+     * Values are decoded lazily on the first typed read, e.g. getValue<T>() or a port of T on
+     * topicLocal, so that large values only consumed by some components are decoded once and
+     * only if needed. Reads as Value get the RelayedValue.
+     *
+     * MUST be called before ComponentManager configure() call
+     *
+     * @param topicLocal  The topic name under which the received values will be put into the local
+     *                    value store
+     * @param topicRemote The topic whose values shall be received from the sender. Only one
+     *                    receive rule per topicRemote shall be added.
+     */
+    void addRelayRule(const std::string& topicLocal, const std::string& topicRemote);
+
     /**
      * See base class Component
      */
@@ -148,6 +281,12 @@ public:
      */
     std::string valueReceived(const std::string& topic, ValuePtr value) override;
 
+    /**
+     * See base class IComEventListener. The value is injected with the sending service as its
+     * origin, see ValueStore::injectValue().
+     */
+    std::string valueReceived(const std::string& topic, ValuePtr value, uint64_t seq) override;
+
     /*
      * See base class IRemoteEndpoint
      */
@@ -169,6 +308,18 @@ public:
      */
     void sendAll() override;
 
+    /**
+     * Sends the latest value of every send rule whose id differs from the one held by the
+     * remote side
+     */
+    void sendStale(const std::map<std::string, uint64_t>& heldIds) override;
+
+    /**
+     * Pauses the send rules of the topics the remote side has no subscribers for and resumes the
+     * others, resending their latest value
+     */
+    void subscriptionsReceived(const std::map<std::string, bool>& subscribed) override;
+
     /**
      * Checks if a connection to the remote side is currently established
      *
@@ -177,6 +328,118 @@ public:
      */
     bool connected() const;
 
+    /**
+     * Set the CPUs the helper threads (receiving, pending values) may run on.
+     *
+     * Takes effect on the next startup. By default the helper threads inherit the affinity of
+     * the component thread.
+     *
+     * @param cpuAffinity  CPU mask, the empty mask keeps the inherited affinity
+     */
+    void setHelperThreadCpuAffinity(CpuMask cpuAffinity) { _helperCpuAffinity = cpuAffinity; }
+
+    /**
+     * Coalesce the values available in a send cycle into batch messages, one value per send rule
+     * and batch. A batch is sent as soon as the available values are collected, it does not wait
+     * for further values. Values with ExtMem part are sent on their own. Has no effect if the
+     * sender supports pipelining.
+     *
+     * @param maxValues  Maximum number of values per send cycle, 0 disables batching
+     * @param maxBytes   Maximum size of the serialized values of one batch message
+     */
+    void setBatching(size_t maxValues, size_t maxBytes);
+
+    /**
+     * Set how the send lanes of different priority share the connection, STRICT by default.
+     * Batched and pipelined sending fill their batches and windows in priority order.
+     */
+    void setSendScheduling(SendScheduling scheduling) { _sendScheduling = scheduling; }
+
+    /**
+     * Limit the number of send rules resending their latest value at the same time after the
+     * remote side requested them, so that a resynchronization does not flood the connection.
+     * The rules are released in priority order.
+     *
+     * @param maxRules  Maximum number of rules resending at the same time, 0 for no limit
+     */
+    void setResyncLimit(size_t maxRules) { _resyncLimit = maxRules; }
+
+    /**
+     * Announce to the remote side which topics of the receive rules have local subscribers, see
+     * ValueStore::hasSubscribers(), whenever the connection comes up and the subscribers change.
+     * The remote side pauses sending the topics without subscribers, which saves bandwidth and
+     * serialization for optional topics, e.g. debug images.
+     *
+     * Only values delivered to subscribers are kept up to date, so topics which are only read
+     * with ValueStore::getValue() should not be received with announced subscriptions.
+     * Disabled by default.
+     *
+     * MUST be called before ComponentManager configure() call
+     */
+    void setAnnounceSubscriptions(bool announce) { _announceSubscriptions = announce; }
+
+    /**
+     * Fan out values to several peers with a single serialization. RemoteServices sharing a cache
+     * serialize each value forwarded by more than one of them once and send the same buffer to
+     * all their peers.
+     *
+     * @param cache  The cache shared with the other RemoteServices of the fan out
+     */
+    void setSerializationCache(std::shared_ptr<SerializationCache> cache)
+    {
+        _transceiver.setSerializationCache(std::move(cache));
+    }
+
+    /**
+     * Send the ExtMem parts of values which can export them, e.g. CudaExtMemValues held on a
+     * cuda device, as handles which the remote process maps instead of copying the memory
+     * through host memory. Requires the remote process to run on the same machine.
+     */
+    void setExtMemExport(bool enable) { _transceiver.setExtMemExport(enable); }
+
+    /**
+     * Shape the values sent in lockstep or by the send workers to the bandwidth of the link, see
+     * FlowControl. An adaptive flow control decimates the queued values of non-blocking send rules
+     * in low priority lanes while the link is congested, starting with the lowest lane. The values
+     * of the highest lane and of blocking rules are never dropped. Batched and pipelined sending
+     * are not shaped.
+     */
+    void setFlowControl(const FlowControl::Config& config);
+
+    /**
+     * Statistics of the flow control, all zero if no flow control is set
+     */
+    FlowControl::Statistics getFlowControlStatistics() const;
+
+    /**
+     * Compression statistics of the remote topics of send rules with compression
+     */
+    std::map<std::string, RemoteStatusTracker::CompressionStatistics> getCompressionStatistics() const
+    {
+        return _transceiver.compressionStatistics();
+    }
+
+    /**
+     * Estimate of the offset between the clocks of this and the remote side, taken from the pings
+     * answered by the remote side
+     */
+    RemoteStatusTracker::ClockEstimate getClockEstimate() const
+    {
+        return _transceiver.clockEstimate();
+    }
+
+    /**
+     * One-way transport latency statistics of the remote topics of receive rules, i.e. the time
+     * from sending a value on the remote side until receiving it, corrected by the clock offset.
+     * The remote side stamps its values once this side has answered one of its pings, they are
+     * recorded once the remote side has answered a ping of this side. Compressed and batched
+     * values are not stamped.
+     */
+    std::map<std::string, RemoteStatusTracker::LatencyStatistics> getLatencyStatistics() const
+    {
+        return _transceiver.latencyStatistics();
+    }
+
 private:
     /**
      * Utility function to set a name for the current thread. The name will consist of a maximum
@@ -194,11 +457,22 @@ private:
     void setThreadName(const std::string& threadNamePrefix);
 
     /**
-     * Function runs in own thread to cyclic call the trigger function so pings will be sent even
-     * if no values trigger its execution
+     * Apply the helper thread CPU affinity to the current thread and log the effective placement
+     */
+    void pinHelperThread(const std::string& threadName);
+
+    /**
+     * Timer callback of the process wide TimerWheel to cyclic call the trigger function so pings
+     * will be sent and timeouts detected even if no values trigger its execution. Reschedules
+     * itself with the current ping interval.
      */
     void triggerCyclic();
 
+    /**
+     * Cancel the timer of triggerCyclic(), waiting for a running callback
+     */
+    void stopTriggerCyclic();
+
     /**
      * Function runs in own thread constantly queries the _receiver to receive values
      */
@@ -215,9 +489,141 @@ private:
      */
     void handleInjectedRejected();
 
+    /**
+     * Requests the values the remote side holds newer values of than this side, whenever the
+     * connection comes up
+     */
+    void requestResync();
+
+    /**
+     * Marks the send rules with a pending resync for forced sending, in priority order and up to
+     * the resync limit
+     * Note: the mutex `_mtxSend` must be locked before calling this method
+     *
+     * @return true if resyncs are still pending
+     */
+    bool releaseResync();
+
+    /**
+     * Announces the subscribers of the receive rules whenever the connection comes up and after
+     * they changed, see setAnnounceSubscriptions()
+     */
+    void announceSubscriptions();
+
+    /**
+     * Drops the queued values of paused send rules, or resumes all rules if the connection is
+     * down
+     * Note: the mutex `_mtxSend` must be locked before calling this method
+     */
+    void handlePaused();
+
 
     void handleSend();
-    void handleSendTopic(const std::string& topic, SendRule& sendRule);
+
+    /**
+     * Sends the next value of a send rule
+     * Note: the mutex `_mtxSend` must be locked before calling this method
+     *
+     * @param lane Index of the lane of the rule in `_sendLanes`
+     */
+    void handleSendTopic(const std::string& topic, SendRule& sendRule, size_t lane);
+
+    /**
+     * Takes the tokens for sending a value from the flow control
+     *
+     * @param wait Set to the time until the value may be sent if it may not be sent now
+     * @return true if the value may be sent now
+     */
+    bool shapeValue(const ValuePtr& value, std::chrono::steady_clock::duration& wait);
+
+    /**
+     * Sleeps for the time the flow control held back the last value of the component thread
+     */
+    void waitShaping();
+
+    /**
+     * Drops the next queued value of a rule if its lane is decimated by the flow control
+     * Note: the mutex `_mtxSend` must be locked before calling this method
+     *
+     * @return true if the value has been dropped
+     */
+    bool decimateValue(SendRule& sendRule, size_t lane);
+
+    /**
+     * Passes the response to a sent value to the flow control
+     */
+    void valueAcked(
+        const ValuePtr& value,
+        std::chrono::high_resolution_clock::duration duration,
+        const std::string& result);
+
+    /**
+     * Index of the lane of a priority in `_sendLanes`
+     */
+    size_t laneIndex(uint8_t prio) const;
+
+    /**
+     * Distributes the send rules over the send workers of the transceiver and starts their threads
+     */
+    void startSendWorkers(const std::shared_ptr<ComponentTraceEventGenerator>& eventGenerator);
+
+    /**
+     * Wakes the send worker threads and waits for them to finish
+     */
+    void stopSendWorkers();
+
+    /**
+     * Wakes the send worker threads to send the values available on their rules
+     */
+    void wakeSendWorkers();
+
+    /**
+     * Main function of a send worker thread
+     */
+    void runSendWorker(size_t index, const std::shared_ptr<ComponentTraceEventGenerator>& eventGenerator);
+
+    /**
+     * Sends the next value of every send rule of a send worker
+     * Note: must only be called by the thread of the worker, locks the mutex `_mtxSend`
+     *
+     * @return true if more values are waiting to be sent
+     */
+    bool handleSendWorker(size_t index);
+
+    /**
+     * Runs one send cycle over the send lanes according to the send scheduling
+     * Note: the mutex `_mtxSend` must be locked before calling this method
+     *
+     * @return true if more values are waiting to be sent
+     */
+    bool handleSendLanes();
+
+    /**
+     * Sends the next value of every send rule in batches
+     * Note: the mutex `_mtxSend` must be locked before calling this method
+     *
+     * @return true if more values are waiting to be sent
+     */
+    bool handleSendBatch();
+
+    /**
+     * Sends values within the windows of the send rules and processes their responses. Waits for
+     * responses while a window is full.
+     * Note: the mutex `_mtxSend` must be locked before calling this method
+     */
+    void handleSendPipelined();
+
+    /**
+     * Sends values of a send rule until its window is full
+     *
+     * @return true if more values are waiting to be sent
+     */
+    bool handleSendTopicPipelined(const std::string& topic, SendRule& sendRule);
+
+    /**
+     * Processes the responses to values sent with pipelining
+     */
+    void handleAcks(std::chrono::milliseconds timeout);
 
     /**
      * Main function of thread handling injection of values into temporarily blocked topics
@@ -232,6 +638,12 @@ private:
      */
     bool isReceivedValuePending() const;
 
+    /**
+     * Wake the pending values thread after a value became pending or the state changed
+     * Note: the mutex `_mtxReceive` must be locked before calling this method
+     */
+    void wakePendingValues();
+
     void resetPendingValues() override;
 
     /**
@@ -250,7 +662,22 @@ private:
     RemotePair<ValuePtr> _transceiver;
 
     std::map<std::string, SendRule> _sendRules;
+    // the send rules by descending priority
+    std::vector<SendLane> _sendLanes;
+    SendScheduling _sendScheduling = SendScheduling::STRICT;
+    size_t _resyncLimit = 0;
+    // set while the connection is up and the remote side has been asked to resync
+    bool _resyncRequested = false;
+    bool _announceSubscriptions = false;
+    // set while the connection is up and the subscribers have been announced
+    bool _subscriptionsAnnounced = false;
+    // set by the subscription callbacks of the receive rule ports
+    std::atomic<bool> _subscriptionsChanged{false};
+    // number of paused send rules, guarded by `_mtxSend`
+    size_t _pausedRules = 0;
     std::map<std::string, ReceiveRule> _receiveRules;
+    // remote topics of the receive rules added by addRelayRule()
+    std::set<std::string> _relayTopics;
 
     /**
      * Topics of pending received values that have been successfully injected into the value store
@@ -267,16 +694,43 @@ private:
     std::mutex _mtxReceive;
     std::mutex _mtxTopics;
     std::atomic<bool> _initialized;
+    std::atomic<CpuMask> _helperCpuAffinity{0};
+
+    size_t _maxBatchValues = 0;
+    size_t _maxBatchBytes = 0;
+
+    std::unique_ptr<FlowControl> _flowControl;
+    // time until the flow control lets the last value of the component thread pass
+    std::chrono::steady_clock::duration _shapingWait{0};
 
     /**
      * Condition variable for waiting on pending received values
      */
     std::condition_variable _cvar_pendR;
 
-    std::unique_ptr<std::thread, std::function<void (std::thread *)>> _triggerCyclicThread;
+    /**
+     * Incremented by wakePendingValues(), aborts waiting for a blocked topic
+     */
+    std::atomic<uint64_t> _pendingGeneration{0};
+
+    /**
+     * Port of the blocked topic the pending values thread waits for, guarded by `_mtxReceive`
+     */
+    GenericSenderPort* _awaitedPort = nullptr;
+
+    /**
+     * Timer of triggerCyclic() while running, both guarded by `_mtxCyclic`
+     */
+    TimerWheel::TimerId _triggerCyclicTimer = TimerWheel::INVALID_TIMER;
+    bool _triggerCyclicActive = false;
+    std::mutex _mtxCyclic;
+
     std::unique_ptr<std::thread, std::function<void (std::thread *)>> _receivingThread;
     std::unique_ptr<std::thread, std::function<void (std::thread *)>> _pendingValuesThread;
 
+    // one per send worker of the transceiver while running, empty if the workers are not used
+    std::vector<std::unique_ptr<SendWorker>> _sendWorkers;
+
 };
 
 } // end namespace remote
@@ -8,6 +8,8 @@
 
 #include "json/forwards.h"
 
+#include <chrono>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -26,6 +28,7 @@ namespace remote
 class RemoteService;
 class ShmemClient;
 class ShmemKeeper;
+struct ZmqContextConfig;
 
 
 /**
@@ -36,6 +39,30 @@ class RemoteServiceConfigurator
 
 public:
 
+    /**
+     * Arguments passed to a transport factory when an instance is configured
+     */
+    struct TransportParameters
+    {
+        std::string sendConnection;
+        std::string receiveConnection;
+        ValueStore& valueStore;
+        std::shared_ptr<ShmemKeeper> shmemKeeper;
+        std::shared_ptr<ShmemClient> shmemClient;
+        std::chrono::milliseconds sendTimeout;
+        std::chrono::milliseconds artificialJitter;
+        bool pipelined;
+        /// number of threads sending values in parallel, see RemotePair::addSendWorker()
+        size_t sendWorkers;
+        /// JSON config node of the instance, for options specific to the transport
+        const Json::Value& config;
+    };
+
+    /**
+     * Builds the RemoteService of an instance for a transport
+     */
+    using TransportFactory = std::function<std::shared_ptr<RemoteService>(const TransportParameters&)>;
+
     /**
      * Constructor
      *
@@ -65,11 +92,38 @@ public:
     std::map<std::string, std::shared_ptr<RemoteService>>
     configureFromJSONNode(const Json::Value &config);
 
+    /**
+     * Registers a transport, which instances select with the config item "transport".
+     *
+     * The transports "reqrep" and "async" are registered by the constructor. Registering
+     * a transport with the name of an existing one replaces it.
+     *
+     * @param name      Name of the transport in the config
+     * @param factory   Function building the RemoteService of an instance
+     */
+    void registerTransport(const std::string& name, TransportFactory factory);
+
+    /**
+     * Reads the settings of the 0MQ context shared by all endpoints from a JSON node
+     *
+     * The node, typically the root of the system configuration, may contain an optional
+     * "ZmqContext" object with the items "ioThreads", "cpuAffinity" (a CPU list string like
+     * "2-3" or an array of CPU indices), "priority", "sendBufferSize" and "receiveBufferSize",
+     * see ZmqContextConfig. The default settings are returned if it is absent. The settings
+     * take effect with ZmqContext::configure(), before the first endpoint is created.
+     *
+     * @param node JSON object containing the "ZmqContext" object
+     *
+     * @return The context settings
+     */
+    static ZmqContextConfig readZmqContextConfiguration(const Json::Value &node);
+
 private:
 
     ValueStore &fValueStore;
     std::shared_ptr<ShmemKeeper> fShmemKeeper;
     std::shared_ptr<ShmemClient> fShmemClient;
+    std::map<std::string, TransportFactory> fTransports;
 };
 
 } // namespace remote
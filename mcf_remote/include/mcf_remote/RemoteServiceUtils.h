@@ -6,6 +6,7 @@
 #define MCF_REMOTE_SERVICE_UTILS_H
 
 #include "mcf_remote/RemoteService.h"
+#include "mcf_remote/ZmqMsgPackAsyncSender.h"
 #include "mcf_remote/ZmqMsgPackSender.h"
 #include "mcf_remote/ZmqMsgPackValueReceiver.h"
 
@@ -33,6 +34,11 @@ namespace remote
  *                          the send function returns TIMEOUT
  * @param artificialJitter  Maximum amount of jitter that is artificially added to simulate a slower
  *                          connection
+ * @param pipelined         If true, values are sent without waiting for the response to the
+ *                          previous one, up to the window of their send rule
+ * @param sendWorkers       Number of threads sending values in parallel, each with its own
+ *                          connection, see RemotePair::addSendWorker(). With 0, the values are
+ *                          sent by the component thread. Not used if pipelined is true.
  *
  * @return A shared_ptr to the constructed RemoteService
  */
@@ -44,16 +50,53 @@ buildZmqRemoteService(
     std::shared_ptr<ShmemKeeper> shmemKeeper = nullptr,
     std::shared_ptr<ShmemClient> shmemClient = nullptr,
     std::chrono::milliseconds sendTimeout = std::chrono::milliseconds(100),
-    std::chrono::milliseconds artificialJitter = std::chrono::milliseconds(0))
+    std::chrono::milliseconds artificialJitter = std::chrono::milliseconds(0),
+    bool pipelined = false,
+    size_t sendWorkers = 0)
 {
     std::unique_ptr<AbstractSender> sender(new mcf::remote::ZmqMsgPackSender(
-        connectionSend, valueStore, sendTimeout, shmemKeeper));
+        connectionSend, valueStore, sendTimeout, shmemKeeper, pipelined));
 
     std::unique_ptr<AbstractReceiver<ValuePtr>> receiver(
         new mcf::remote::ZmqMsgPackValueReceiver(connectionReceive, valueStore, shmemClient));
 
+    RemotePair<ValuePtr> transceiver(std::move(sender), std::move(receiver), artificialJitter);
+    for (size_t i = 0; !pipelined && i < sendWorkers; ++i)
+    {
+        transceiver.addSendWorker(std::unique_ptr<AbstractSender>(new mcf::remote::ZmqMsgPackSender(
+            connectionSend, valueStore, sendTimeout, shmemKeeper)));
+    }
+
+    return std::make_shared<mcf::remote::RemoteService>(valueStore, std::move(transceiver));
+}
+
+/**
+ * Constructs a RemoteService using asynchronous 0MQ communication and msgpack for value
+ * serialization, see ZmqMsgPackAsyncSender. The remote side must use the asynchronous
+ * communication as well.
+ *
+ * The parameters are the same as for buildZmqRemoteService().
+ *
+ * @return A shared_ptr to the constructed RemoteService
+ */
+inline std::shared_ptr<mcf::remote::RemoteService>
+buildZmqAsyncRemoteService(
+    const std::string& connectionSend,
+    const std::string& connectionReceive,
+    ValueStore& valueStore,
+    std::shared_ptr<ShmemKeeper> shmemKeeper = nullptr,
+    std::shared_ptr<ShmemClient> shmemClient = nullptr,
+    std::chrono::milliseconds sendTimeout = std::chrono::milliseconds(100),
+    std::chrono::milliseconds artificialJitter = std::chrono::milliseconds(0))
+{
+    std::unique_ptr<AbstractSender> sender(new mcf::remote::ZmqMsgPackAsyncSender(
+        connectionSend, valueStore, sendTimeout, shmemKeeper));
+
+    std::unique_ptr<AbstractReceiver<ValuePtr>> receiver(
+        new mcf::remote::ZmqMsgPackValueReceiver(connectionReceive, valueStore, shmemClient, true));
+
     return std::make_shared<mcf::remote::RemoteService>(
-        valueStore, 
+        valueStore,
         RemotePair<ValuePtr>(std::move(sender), std::move(receiver), artificialJitter));
 }
 
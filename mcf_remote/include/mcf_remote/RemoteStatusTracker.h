@@ -6,9 +6,12 @@
 #define MCF_REMOTE_REMOTESTATUSTRACKER_H
 
 #include <chrono>
+#include <deque>
 #include <functional>
+#include <map>
 #include <mutex>
 #include <condition_variable>
+#include <string>
 
 namespace mcf{
 
@@ -50,6 +53,62 @@ public:
         STATE_UP     = 2
     };
 
+    /**
+     * Statistics of the values compressed on a topic
+     */
+    struct CompressionStatistics
+    {
+        uint64_t values = 0;
+        /// bytes before compression
+        uint64_t rawBytes = 0;
+        /// bytes sent
+        uint64_t wireBytes = 0;
+        /// time spent compressing
+        std::chrono::nanoseconds time{0};
+
+        /**
+         * Ratio of the raw to the sent bytes, 1 if nothing has been sent
+         */
+        double ratio() const
+        {
+            return wireBytes > 0 ? static_cast<double>(rawBytes) / wireBytes : 1.;
+        }
+    };
+
+    /**
+     * Estimate of the clock of the other side, from the pings answered with its clock
+     */
+    struct ClockEstimate
+    {
+        /// number of pings the estimate is based on, the estimate is invalid without any
+        uint64_t samples = 0;
+        /// time of the other side minus the local time
+        std::chrono::nanoseconds offset{0};
+        /// round trip time of a ping without the time the other side took to respond
+        std::chrono::nanoseconds roundTrip{0};
+    };
+
+    /**
+     * Statistics of the one-way transport latency of the stamped values received on a topic,
+     * i.e. the time from sending until receiving corrected by the clock offset
+     */
+    struct LatencyStatistics
+    {
+        uint64_t values = 0;
+        std::chrono::nanoseconds last{0};
+        std::chrono::nanoseconds min = std::chrono::nanoseconds::max();
+        std::chrono::nanoseconds max{0};
+        std::chrono::nanoseconds total{0};
+
+        /**
+         * Mean latency, 0 if no value has been received
+         */
+        std::chrono::nanoseconds mean() const
+        {
+            return values > 0 ? total / static_cast<std::chrono::nanoseconds::rep>(values) : std::chrono::nanoseconds(0);
+        }
+    };
+
     /**
      * Constructor
      *
@@ -114,12 +173,73 @@ public:
      */
     void sendingTimeout();
 
+    /**
+     * Sets a function called on every change of the remote state, e.g. to run runCyclic() right
+     * away instead of waiting for the next ping interval. It is called with the internal lock
+     * held, so it must not call back into the tracker. It is not taken over by the move
+     * constructor.
+     */
+    void setEventObserver(std::function<void()> observer);
+
     /**
      * Blocks the calling thread until an event is triggered in the RemoteStatusTracker.
      * This event is either as change of the remote state or the expiration of _pingInterval
      */
     void waitForEvent();
 
+    /**
+     * Records a value compressed by the sender, see AbstractSender::CompressionObserver
+     */
+    void valueCompressed(
+        const std::string& topic,
+        std::size_t rawBytes,
+        std::size_t wireBytes,
+        std::chrono::nanoseconds duration);
+
+    /**
+     * Query the compression statistics of all topics with compressed values
+     */
+    std::map<std::string, CompressionStatistics> getCompressionStatistics() const;
+
+    /**
+     * Records a ping answered with the clock of the other side, see
+     * AbstractSender::ClockObserver. Like NTP, the offset is taken from the recent ping with the
+     * shortest round trip, whose offset is the least distorted by asymmetric delays.
+     *
+     * @param pingSent         Local time the ping was sent
+     * @param pingReceived     Time of the other side the ping was received
+     * @param responseSent     Time of the other side the response was sent
+     * @param responseReceived Local time the response was received
+     */
+    void clockSampled(
+        std::chrono::system_clock::time_point pingSent,
+        std::chrono::system_clock::time_point pingReceived,
+        std::chrono::system_clock::time_point responseSent,
+        std::chrono::system_clock::time_point responseReceived);
+
+    /**
+     * Query the current estimate of the clock of the other side
+     */
+    ClockEstimate getClockEstimate() const;
+
+    /**
+     * Records the transport latency of a stamped value, see IComEventListener::valueStampReceived.
+     * Values received before the clock of the other side has been estimated are not recorded.
+     *
+     * @param topic    The topic of the value
+     * @param sent     Time the value was sent, read from the clock of the other side
+     * @param received Local time the value was received
+     */
+    void valueStampReceived(
+        const std::string& topic,
+        std::chrono::system_clock::time_point sent,
+        std::chrono::system_clock::time_point received);
+
+    /**
+     * Query the latency statistics of all topics with stamped values
+     */
+    std::map<std::string, LatencyStatistics> getLatencyStatistics() const;
+
 private:
     void setState(RemoteState state);
     void sendPing();
@@ -132,10 +252,18 @@ private:
     std::chrono::time_point<std::chrono::system_clock> _lastPingTime; // set to 01.01.1970
     std::chrono::time_point<std::chrono::system_clock> _lastPongTime; // set to 01.01.1970
     std::function<void(uint64_t)> _pingSender;
+    std::function<void()> _eventObserver;
     uint64_t _pingFreshnessValue;
 
     std::mutex _mtx;
     std::condition_variable _notifierCv;
+
+    std::map<std::string, CompressionStatistics> _compressionStatistics;
+    // recent clock samples, see clockSampled()
+    std::deque<ClockEstimate> _clockSamples;
+    ClockEstimate _clockEstimate;
+    std::map<std::string, LatencyStatistics> _latencyStatistics;
+    mutable std::mutex _statisticsMtx;
 };
 
 } // end namespace remote
@@ -7,7 +7,10 @@
 
 #include "mcf_core/Mcf.h"
 #include "zmq.hpp"
+#include <map>
+#include <memory>
 #include <mutex>
+#include <string>
 
 #define BOOST_DATE_TIME_NO_LIB
 #include <boost/interprocess/managed_shared_memory.hpp>
@@ -48,12 +51,49 @@ public:
      * partitionHandle
      * @warning While the returned pointer to the partition is used, it must not be destroyed by
      *          threads/processes accessing the same shared memory file
-     * @param shmemFileName   The name of the shared memory file in which to find the partition
+     * @param shmemFileName   The name of the shared memory file in which to find the partition,
+     *                        an absolute path for the segment files of SegmentedShmem, which are
+     *                        mapped as they are, or the name of a buffer of MemfdShmem, which is
+     *                        requested from the keeper and mapped read-only
      * @param partitionHandle The handle to the partition that shall be returned
      */
     void* partitionPtr(const std::string& shmemFileName, bip::managed_shared_memory::handle_t partitionHandle);
 
+    /**
+     * Returns an owner of a slot handed out by ShmemKeeper::acquireSlot(), which drops the
+     * receiver's reference to the slot, so that the sender may reuse it, once its last copy is
+     * destroyed. Values may refer to the slot instead of copying it as long as they hold the
+     * owner, see IExtMemValue::extMemShare(). The owner also keeps the shared memory file mapped.
+     * Memfd buffers are released by a message to their keeper instead.
+     * Shall be called exactly once per received slot, after partitionPtr() returned it
+     * @param payload  The pointer to the payload of the slot, as returned by partitionPtr()
+     */
+    std::shared_ptr<const void> slotOwner(const void* payload);
+
+    /**
+     * Drops the reference to a slot handed out by ShmemKeeper::acquireSlot() right away, instead
+     * of using slotOwner()
+     * @param payload  The pointer to the payload of the slot, as returned by partitionPtr()
+     */
+    static void releaseSlot(const void* payload);
+
 private:
+    /**
+     * The unix socket to a MemfdShmem, shared with the owners of the slots received from it
+     */
+    class MemfdConnection;
+
+    struct Segment
+    {
+        // shared with the owners of received slots, which may outlive this client
+        std::shared_ptr<void> mapping;
+        // address of handle 0
+        char* base = nullptr;
+        // the keeper of a memfd buffer and the id of the buffer
+        std::shared_ptr<MemfdConnection> memfd;
+        uint64_t buffer = 0ul;
+    };
+
     /**
      * Checks if the shared memory segment of the passed file name is already opened. If not it
      * tries to open it.
@@ -61,8 +101,26 @@ private:
      */
     void openSegment(const std::string& shmemFileName);
 
-    bip::managed_shared_memory _segment;
+    /**
+     * Requests a buffer from a MemfdShmem and maps it
+     */
+    Segment openMemfdBuffer(const std::string& socketName, uint64_t buffer);
+
+    /**
+     * Handles the messages of a MemfdShmem, waits for the reply of a request for the passed
+     * buffer if it is not 0
+     * @return the file descriptor of the buffer passed with the reply, -1 if it does not exist
+     */
+    int receiveMemfdMessages(const std::string& socketName, MemfdConnection& connection, uint64_t buffer);
+
+    void forgetSegment(const std::string& shmemFileName);
+
+    // the segments opened so far, senders with SegmentedShmem use several
+    std::map<std::string, Segment> _segments;
+    // the segment of the last partition returned
+    Segment* _segment = nullptr;
     std::string _segmentName;
+    std::map<std::string, std::shared_ptr<MemfdConnection>> _memfdConnections;
 };
 
 
@@ -7,9 +7,16 @@
 
 #include "mcf_core/Mcf.h"
 #include "zmq.hpp"
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #define BOOST_DATE_TIME_NO_LIB
+#include <boost/interprocess/managed_external_buffer.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
 #include <boost/interprocess/sync/named_mutex.hpp>
 namespace bip = boost::interprocess;
@@ -18,6 +25,23 @@ namespace mcf {
 
 namespace remote {
 
+/**
+ * Usage of the shared memory managed by a ShmemKeeper, see ShmemKeeper::usage()
+ */
+struct ShmemUsage
+{
+    /// number of shared memory segments
+    size_t segments = 0ul;
+    /// total size of the segments in bytes
+    size_t size = 0ul;
+    /// bytes allocated in the segments, including the allocator's bookkeeping
+    size_t used = 0ul;
+    /// number of partitions and slots allocated
+    uint64_t allocations = 0ul;
+    /// number of allocations which failed, e.g. because a segment was full or a limit reached
+    uint64_t failedAllocations = 0ul;
+};
+
 /**
  * Manages shared memory used for inter-process communication. A ShmemKeeper is typically used
  * on the sending side of the communication to allocate/keep track of data in shared memory.
@@ -68,10 +92,33 @@ public:
 
     /**
      * Returns the name of the shared memory file in which the partition associated with the passed
-     * partitionId is located
+     * partitionId is located, or the slot last handed out by acquireSlot() for it
      * @param partitionId  The id of the partition whose file name shall be returned
      */
     virtual std::string shmemFileName(const std::string& partitionId) = 0;
+
+    /**
+     * Hands out a slot of at least the passed size from the ring of slots belonging to
+     * partitionId, e.g. one per connection. Each slot starts with a ShmemSlotHeader whose
+     * reference count is set to one; the receiver releases the slot with
+     * ShmemClient::releaseSlot() once it has copied the data. Slots are reused round-robin, so
+     * several values can be in flight without allocating shared memory for every value.
+     * @warning This function shall not be called concurrently from multiple threads for the same
+     *          partitionId
+     * @param partitionId  The id of the slot ring
+     * @param size         The minimal size in bytes of the payload of the returned slot
+     * @param handle       Set to the handle of the payload, to be passed to the receiver
+     * @return A pointer to the payload of the slot, nullptr if no memory could be allocated
+     */
+    virtual void* acquireSlot(
+        const std::string& partitionId,
+        size_t size,
+        bip::managed_shared_memory::handle_t& handle) = 0;
+
+    /**
+     * Returns the usage of the shared memory managed by this ShmemKeeper
+     */
+    virtual ShmemUsage usage() const = 0;
 };
 
 /**
@@ -87,6 +134,13 @@ class SingleFileShmem: public ShmemKeeper {
         size_t size = 0ul;
     };
 
+    struct SlotRing
+    {
+        std::vector<PartitionPtr> slots;
+        size_t next = 0ul;
+        bool overrunReported = false;
+    };
+
 public:
     /**
      * Constructor. Allocates one byte in this file whose sole purpose is to
@@ -94,13 +148,19 @@ public:
      *
      * @param filesize Determines the size of the file 'McfSharedMemory' if it was not
      *                 allocated before this call
+     * @param slotsPerRing Expected number of slots per ring handed out by acquireSlot(). Slots are
+     *                 allocated on demand, i.e. only as many as values are in flight or held by
+     *                 the receiver at once. A warning is issued if a ring grows beyond this
      */
-    SingleFileShmem(const size_t filesize = 1024*1024*256); // allocate a 256 MB shared memory file per default
+    SingleFileShmem(
+        const size_t filesize = 1024*1024*256, // allocate a 256 MB shared memory file per default
+        const size_t slotsPerRing = 8);
 
     /**
      * Deallocates all partitions created by this instance in the shared memory file
-     * 'McfSharedMemory', including the one allocated in the constructor. If no more memory is
-     * allocated in 'McfSharedMemory' after that, it removes the file.
+     * 'McfSharedMemory', including the one allocated in the constructor, except for slots still
+     * referred to by a receiver. If no more memory is allocated in 'McfSharedMemory' after that,
+     * it removes the file.
      */
     virtual ~SingleFileShmem();
 
@@ -124,6 +184,20 @@ public:
      */
     virtual std::string shmemFileName(const std::string& partitionId);
 
+    /**
+     * See base class. Slots still referenced by the receiver are never reused, if all are, a
+     * new slot is added to the ring
+     */
+    virtual void* acquireSlot(
+        const std::string& partitionId,
+        size_t size,
+        bip::managed_shared_memory::handle_t& handle);
+
+    /**
+     * See base class. The segment is shared by all processes using this class
+     */
+    virtual ShmemUsage usage() const;
+
 private:
     /**
      * Checks if the current size of mem is bigger or equal to sizeNeeded and increases its
@@ -136,7 +210,261 @@ private:
 
     bip::managed_shared_memory _segment;
     std::map<std::string, PartitionPtr> _partitionPtrs;
+    const size_t _slotsPerRing;
+    std::map<std::string, SlotRing> _slotRings;
     void* flag;
+    uint64_t _allocations = 0ul;
+    uint64_t _failedAllocations = 0ul;
+};
+
+/**
+ * A ShmemKeeper allocating from shared memory segments owned by this instance, instead of the
+ * single fixed segment all processes allocate from with SingleFileShmem.
+ *
+ * Segments are created on demand, one set per partition id, i.e. per connection, or one set per
+ * size class of the allocations, see Placement. Whenever the segments of a set are full, another
+ * one is added, as large as the allocation requires, up to the configured limits; segments which
+ * become empty are removed again, except for the first one of each set. The segments are files
+ * in /dev/shm or, to reduce the TLB misses on large ext mem, in a hugetlbfs mount. Receivers get
+ * their absolute paths as file names, see ShmemClient::partitionPtr().
+ *
+ * The segments are removed by the destructor, receivers which mapped a segment already keep
+ * their mapping. Unlike SingleFileShmem, an instance may be shared by several senders.
+ */
+class SegmentedShmem: public ShmemKeeper {
+public:
+    /**
+     * Assignment of allocations to sets of segments
+     */
+    enum class Placement
+    {
+        /// one set of segments per partition id, i.e. per connection
+        PER_PARTITION,
+        /// one set of segments per power of two of the allocation size, at least 64 KB
+        PER_SIZE_CLASS
+    };
+
+    struct Config
+    {
+        Placement placement = Placement::PER_PARTITION;
+        /// minimal size of a segment in bytes, larger allocations get a segment of their own size
+        size_t segmentSize = 64ul * 1024 * 1024;
+        /// maximum number of segments, 0 for no limit
+        size_t maxSegments = 64ul;
+        /// maximum total size of the segments in bytes, 0 for no limit
+        size_t maxTotalSize = 1024ul * 1024 * 1024;
+        /// directory of the segment files, e.g. the hugetlbfs mount "/dev/hugepages", segment
+        /// sizes are rounded up to its block size, i.e. the huge page size
+        std::string directory = "/dev/shm";
+        /// prefix of the segment file names, which are unique per instance
+        std::string prefix = "McfShmem";
+        /// expected number of slots per ring, see SingleFileShmem::SingleFileShmem()
+        size_t slotsPerRing = 8ul;
+    };
+
+    /**
+     * Constructor, segments are only created once memory is allocated
+     *
+     * @throws std::runtime_error if the directory of the segment files cannot be accessed
+     */
+    SegmentedShmem();
+    explicit SegmentedShmem(const Config& config);
+
+    /**
+     * Removes all segments
+     */
+    virtual ~SegmentedShmem();
+
+    /**
+     * See base class
+     */
+    virtual void* partitionPtr(const std::string& partitionId);
+
+    /**
+     * See base class, returns nullptr if no memory can be allocated within the limits
+     */
+    virtual void* createOrGetPartitionPtr(const std::string& partitionId, size_t size);
+
+    /**
+     * See base class
+     */
+    virtual bip::managed_shared_memory::handle_t partitionHandle(const std::string& partitionId);
+
+    /**
+     * See base class, the absolute path of the segment file
+     */
+    virtual std::string shmemFileName(const std::string& partitionId);
+
+    /**
+     * See base class. Slots still referenced by the receiver are never reused, if all are, a
+     * new slot is added to the ring
+     */
+    virtual void* acquireSlot(
+        const std::string& partitionId,
+        size_t size,
+        bip::managed_shared_memory::handle_t& handle);
+
+    /**
+     * See base class
+     */
+    virtual ShmemUsage usage() const;
+
+private:
+    struct Segment;
+
+    struct Partition
+    {
+        void* ptr = nullptr;
+        size_t size = 0ul;
+        Segment* segment = nullptr;
+    };
+
+    struct SlotRing
+    {
+        std::vector<Partition> slots;
+        size_t next = 0ul;
+        bool overrunReported = false;
+        // segment of the slot handed out last
+        Segment* last = nullptr;
+    };
+
+    /**
+     * Re-allocates mem in the segments of partitionId if it is smaller than sizeNeeded
+     * @return false if no memory could be allocated, mem is empty then
+     */
+    bool increasePartitionIfNecessary(const std::string& partitionId, size_t sizeNeeded, Partition& mem);
+
+    void deallocate(Partition& mem);
+
+    /**
+     * Adds a segment with room for an allocation of size bytes to a set, nullptr if that would
+     * exceed the limits or the segment cannot be created
+     */
+    Segment* createSegment(const std::string& set, size_t size);
+
+    const Config _config;
+    const std::string _pathPrefix;
+    size_t _pageSize = 0ul;
+
+    mutable std::mutex _mutex;
+    std::map<std::string, std::vector<std::unique_ptr<Segment>>> _segments;
+    std::map<std::string, Partition> _partitions;
+    std::map<std::string, SlotRing> _slotRings;
+    size_t _segmentCount = 0ul;
+    size_t _totalSize = 0ul;
+    uint64_t _nextSegment = 0ul;
+    uint64_t _allocations = 0ul;
+    uint64_t _failedAllocations = 0ul;
+    bool _limitReported = false;
+};
+
+/**
+ * A ShmemKeeper handing out every slot as a memfd buffer of its own, instead of allocating
+ * slots in a managed segment.
+ *
+ * The buffers are pooled, a buffer released by its receiver is reused for the next value it fits
+ * into. A receiver gets the file descriptor of a buffer once, over a unix socket with
+ * SCM_RIGHTS, maps it read-only and keeps it mapped, so that values only carry the name of
+ * their buffer. The release of a buffer is sent back over the same socket, see memfd::Message
+ * in ShmemMemfd.h. Used with shm:// connections like the other keepers, the receivers' ShmemClient
+ * recognizes memfd buffers by their names.
+ *
+ * Only slots are supported, partitions, which receivers write to as well, cannot be created.
+ * The unix socket is served by a thread of this instance, only processes of the same user are
+ * accepted. An instance may be shared by several senders.
+ */
+class MemfdShmem: public ShmemKeeper {
+public:
+    struct Config
+    {
+        /// maximum number of buffers in the pool, 0 for no limit
+        size_t maxBuffers = 64ul;
+        /// maximum total size of the buffers in bytes, 0 for no limit
+        size_t maxTotalSize = 1024ul * 1024 * 1024;
+    };
+
+    /**
+     * Constructor, starts listening on the unix socket
+     *
+     * @throws std::runtime_error if the socket cannot be created
+     */
+    MemfdShmem();
+    explicit MemfdShmem(const Config& config);
+
+    /**
+     * Closes all buffers, receivers keep the ones they mapped until they release them
+     */
+    virtual ~MemfdShmem();
+
+    /**
+     * Not supported, returns nullptr
+     */
+    virtual void* partitionPtr(const std::string& partitionId);
+
+    /**
+     * Not supported, returns nullptr
+     */
+    virtual void* createOrGetPartitionPtr(const std::string& partitionId, size_t size);
+
+    /**
+     * Not supported, returns 0
+     */
+    virtual bip::managed_shared_memory::handle_t partitionHandle(const std::string& partitionId);
+
+    /**
+     * See base class, the name of the buffer last handed out for partitionId
+     */
+    virtual std::string shmemFileName(const std::string& partitionId);
+
+    /**
+     * See base class. Hands out the smallest released buffer the value fits into, or a new one.
+     * Released buffers too small for any value are dropped if the pool reached its limits
+     */
+    virtual void* acquireSlot(
+        const std::string& partitionId,
+        size_t size,
+        bip::managed_shared_memory::handle_t& handle);
+
+    /**
+     * See base class, the segments are the buffers of the pool, the used bytes the size of the
+     * buffers not yet released
+     */
+    virtual ShmemUsage usage() const;
+
+private:
+    struct Buffer;
+
+    /**
+     * Creates a buffer of at least size bytes, nullptr if the limits do not allow it
+     */
+    Buffer* createBuffer(size_t size);
+
+    void dropBuffer(uint64_t id);
+
+    /**
+     * Serves the unix socket
+     */
+    void run();
+
+    /**
+     * Handles a message of a receiver, false if the connection is closed
+     */
+    bool serve(int connection);
+
+    const Config _config;
+    std::string _socketName;
+    int _listenSocket = -1;
+    int _stopEvent = -1;
+    std::thread _thread;
+
+    mutable std::mutex _mutex;
+    std::map<uint64_t, std::unique_ptr<Buffer>> _buffers;
+    std::map<std::string, uint64_t> _lastBuffers;
+    std::vector<int> _connections;
+    uint64_t _nextBuffer = 1ul;
+    size_t _totalSize = 0ul;
+    uint64_t _allocations = 0ul;
+    uint64_t _failedAllocations = 0ul;
 };
 
 
@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_SHMEMMEMFD_H
+#define MCF_SHMEMMEMFD_H
+
+#include <cstdint>
+#include <string>
+
+namespace mcf {
+
+namespace remote {
+
+/**
+ * Protocol between MemfdShmem and ShmemClient
+ *
+ * The keeper listens on a unix socket in the abstract namespace. A receiver seeing a buffer for
+ * the first time connects, if it has not yet, and requests its file descriptor, which is passed
+ * back with SCM_RIGHTS. The receiver keeps the buffer mapped, later values in it only carry its
+ * name. Once a value does not refer to its buffer any more, the receiver sends a release, and
+ * the keeper tells receivers about buffers it removed from its pool.
+ */
+namespace memfd {
+
+/// prefix of the file names of memfd buffers, "memfd:<socket name>#<buffer id>"
+extern const char* const NAME_PREFIX;
+
+enum class MessageType : uint32_t
+{
+    /// receiver asks for the file descriptor of a buffer
+    REQUEST = 1,
+    /// keeper passes the file descriptor of a buffer, none if the buffer does not exist
+    REPLY = 2,
+    /// receiver releases a buffer for reuse
+    RELEASE = 3,
+    /// keeper removed a buffer from its pool
+    DROP = 4
+};
+
+struct Message
+{
+    MessageType type;
+    uint64_t buffer;
+};
+
+/**
+ * Returns the file name of a buffer of the keeper listening on socketName
+ */
+std::string bufferName(const std::string& socketName, uint64_t buffer);
+
+/**
+ * Splits a file name into the socket name and the buffer id, false if it does not name a memfd
+ * buffer
+ */
+bool parseBufferName(const std::string& name, std::string& socketName, uint64_t& buffer);
+
+/**
+ * Creates a SOCK_SEQPACKET unix socket listening on, or connected to, a name in the abstract
+ * namespace
+ *
+ * @return the socket, -1 with errno set on error
+ */
+int listenSocket(const std::string& socketName);
+int connectSocket(const std::string& socketName);
+
+/**
+ * Sends a message, with a file descriptor attached if fd >= 0
+ *
+ * @param flags  flags of sendmsg(2), e.g. MSG_DONTWAIT
+ * @return false with errno set on error
+ */
+bool sendMessage(int socket, const Message& message, int fd = -1, int flags = 0);
+
+/**
+ * Receives a message and the file descriptor attached to it, fd is -1 if there is none
+ *
+ * @param flags  flags of recvmsg(2), e.g. MSG_DONTWAIT
+ * @return false with errno set on error, or with errno 0 if the peer closed the connection
+ */
+bool receiveMessage(int socket, Message& message, int& fd, int flags = 0);
+
+} // end namespace memfd
+
+} // end namespace remote
+
+} // end namespace mcf
+
+#endif
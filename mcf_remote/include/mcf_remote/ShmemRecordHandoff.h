@@ -0,0 +1,204 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_SHMEMRECORDHANDOFF_H
+#define MCF_SHMEMRECORDHANDOFF_H
+
+#include "mcf_core/RecordHandoff.h"
+#include "mcf_core/ValueRecorder.h"
+#include "mcf_remote/ShmemClient.h"
+#include "mcf_remote/ShmemKeeper.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <sys/uio.h>
+
+namespace mcf {
+
+namespace remote {
+
+/**
+ * Single producer single consumer ring of entries in a shared memory partition, between a
+ * ShmemRecordHandoff and a ShmemRecordReceiver
+ *
+ * The positions of both sides count the bytes written and consumed since the ring was
+ * initialized. An entry is a uint32 size followed by its data and padded to ENTRY_ALIGNMENT.
+ * Entries do not wrap around: if an entry does not fit before the end of the ring, the size
+ * WRAP marks the rest of the ring as unused.
+ */
+class ShmemRecordRing {
+public:
+    static constexpr size_t ENTRY_ALIGNMENT = 8;
+    static constexpr uint32_t WRAP = UINT32_MAX;
+
+    /**
+     * Kinds of entries, each starts with a msgpack EntryHeader
+     */
+    enum Kind : uint8_t {
+        /// a value: the header is followed by the msgpack value and its ext mem data
+        VALUE,
+        /// start recording into the file name
+        OPEN,
+        /// stop recording
+        CLOSE
+    };
+
+    struct EntryHeader {
+        uint8_t kind;
+        /// the topic of a value or the file name to open
+        std::string name;
+        int64_t timeNs;
+        std::string tid;
+        uint64_t vid;
+        uint64_t valueSize;
+        uint64_t extMemSize;
+        /// sequence number of the write of the value to its topic, see IValueReceiver::receive()
+        uint64_t seq = 0;
+        MSGPACK_DEFINE(kind, name, timeNs, tid, vid, valueSize, extMemSize, seq)
+    };
+
+    /**
+     * The bytes of a partition holding a ring of capacity bytes
+     */
+    static size_t partitionSize(size_t capacity);
+
+    /**
+     * Initialize an empty ring in a partition of partitionSize(capacity) bytes
+     */
+    static void init(void* partition, size_t capacity);
+
+    /**
+     * Attach to a ring initialized in partition
+     */
+    explicit ShmemRecordRing(void* partition = nullptr);
+
+    /**
+     * Append the gathered data as one entry, producer side
+     *
+     * @return 0 on success, EAGAIN if the ring has not enough free space, EMSGSIZE if the entry
+     *         can never fit into the ring
+     */
+    int write(const iovec* iov, size_t count);
+
+    /**
+     * Get the oldest entry without consuming it, consumer side
+     *
+     * @return false if the ring is empty
+     */
+    bool peek(const char*& data, size_t& size);
+
+    /**
+     * Consume the entry returned by the last peek(), its data must not be used any more
+     */
+    void release();
+
+private:
+    struct Control;
+
+    static size_t entrySize(size_t dataSize);
+
+    Control* fControl = nullptr;
+    char* fData = nullptr;
+    size_t fPeeked = 0;
+};
+
+/**
+ * Hands the values of a ValueRecorder to a ShmemRecordReceiver in another process through a
+ * ShmemRecordRing, see ValueRecorder::setHandoff()
+ *
+ * Only the msgpack serialization of a value is done by the handing process, its ext mem data is
+ * copied into the ring as it is. Values which do not fit into the ring because the receiving
+ * process does not keep up are dropped, so a stalled recorder does not hold memory of the
+ * handing process. The receiving process attaches with shmemFileName() and partitionHandle().
+ */
+class ShmemRecordHandoff : public IRecordHandoff {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024 * 1024;
+    /// Time open() and close() wait for free space in the ring
+    static constexpr std::chrono::milliseconds CONTROL_TIMEOUT{1000};
+
+    /**
+     * Constructor, creates the ring in a partition of the shared memory
+     *
+     * @param keeper       keeps the partition, must outlive the handoff
+     * @param partitionId  the id of the partition of the ring
+     * @param capacity     the bytes of the ring
+     */
+    ShmemRecordHandoff(ShmemKeeper& keeper, const std::string& partitionId,
+                       size_t capacity = DEFAULT_CAPACITY);
+
+    std::string shmemFileName() const;
+
+    bip::managed_shared_memory::handle_t partitionHandle() const;
+
+    int open(const std::string& filename) override;
+
+    int handOff(const std::string& topic,
+                std::chrono::high_resolution_clock::time_point time,
+                const ValuePtr& value,
+                uint64_t seq,
+                const TypeRegistry::TypemapEntry& typeInfo,
+                bool extMem) override;
+
+    int close() override;
+
+private:
+    /**
+     * Write an OPEN or CLOSE entry, waiting up to CONTROL_TIMEOUT for free space
+     */
+    int writeControl(ShmemRecordRing::Kind kind, const std::string& name);
+
+    ShmemKeeper& fKeeper;
+    const std::string fPartitionId;
+    ShmemRecordRing fRing;
+    // reused by the write thread of the recorder
+    msgpack::sbuffer fHeaderBuffer;
+    msgpack::sbuffer fValueBuffer;
+};
+
+/**
+ * Records the values handed over by a ShmemRecordHandoff of another process with a ValueRecorder
+ *
+ * A thread takes the entries of the ring: it starts and stops the recorder like the handing
+ * recorder is started and stopped, and passes the values to ValueRecorder::recordValue(). The
+ * types of the values must be registered in the type registry. While the ring is empty, the
+ * thread polls it every POLL_INTERVAL.
+ */
+class ShmemRecordReceiver {
+public:
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{1};
+
+    ShmemRecordReceiver(const TypeRegistry& typeRegistry,
+                        ValueRecorder& recorder,
+                        const std::string& shmemFileName,
+                        bip::managed_shared_memory::handle_t partitionHandle);
+
+    /**
+     * Stop the thread, the recorder keeps recording until it is stopped
+     */
+    ~ShmemRecordReceiver();
+
+    ShmemRecordReceiver(const ShmemRecordReceiver&) = delete;
+    ShmemRecordReceiver& operator=(const ShmemRecordReceiver&) = delete;
+
+private:
+    void run();
+
+    void receive(const char* data, size_t size);
+
+    const TypeRegistry& fTypeRegistry;
+    ValueRecorder& fRecorder;
+    ShmemClient fClient;
+    ShmemRecordRing fRing;
+    std::atomic<bool> fStop{false};
+    std::thread fThread;
+};
+
+} // end namespace remote
+
+} // end namespace mcf
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_SHMEMSLOT_H
+#define MCF_SHMEMSLOT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mcf {
+
+namespace remote {
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "ShmemSlotHeader needs lock-free 32 bit atomics");
+
+/**
+ * Header in front of every slot handed out by ShmemKeeper::acquireSlot()
+ *
+ * The keeper sets the reference count to one when it hands the slot to a sender; the receiving
+ * process drops that reference once it has copied the data out of the slot. Only slots without
+ * references are reused, so a slot is never overwritten while a value in it is still in flight.
+ * The header lives in shared memory and is accessed from both processes.
+ */
+struct ShmemSlotHeader
+{
+    /// distance between the start of a slot and its payload, keeps the payload cache line aligned
+    static constexpr std::size_t SIZE = 64;
+
+    std::atomic<uint32_t> refCount;
+
+    /**
+     * Returns the header of the slot whose payload starts at the passed address
+     */
+    static ShmemSlotHeader* fromPayload(void* payload)
+    {
+        return reinterpret_cast<ShmemSlotHeader*>(static_cast<char*>(payload) - SIZE);
+    }
+
+    void* payload()
+    {
+        return reinterpret_cast<char*>(this) + SIZE;
+    }
+};
+
+static_assert(sizeof(ShmemSlotHeader) <= ShmemSlotHeader::SIZE, "ShmemSlotHeader exceeds its size");
+
+} // end namespace remote
+
+} // end namespace mcf
+
+#endif
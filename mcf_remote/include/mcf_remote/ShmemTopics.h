@@ -0,0 +1,263 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_SHMEMTOPICS_H
+#define MCF_SHMEMTOPICS_H
+
+#include "mcf_core/Mcf.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mcf {
+
+namespace remote {
+
+/**
+ * Segment of POSIX shared memory holding the latest values of topics shared by the processes of
+ * one host, see ShmemTopicBridge
+ *
+ * Each topic is a ring of fixed size slots. A writer claims the next sequence number of the topic
+ * and fills the slot of that number, the slot is guarded by a seqlock stamp: odd while it is
+ * written, twice the sequence number once the entry is complete. Readers copy an entry out of its
+ * slot and check the stamp again afterwards, so neither side takes a lock and a reader never
+ * delays a writer. A reader which falls behind by more than the slots of a topic loses the oldest
+ * entries. Writers bump a counter in the segment header after each entry, readers wait on it with
+ * a futex; the futex is only woken while a reader waits, so writing does not cost a system call
+ * otherwise.
+ *
+ * The first process creates the segment, the last one detaching removes it; a segment left
+ * behind by crashed processes is reused as it is and can be removed from /dev/shm. Topics are
+ * added under a robust process shared mutex, which is recovered if a process died holding it.
+ * The slot of a writer dying in the middle of an entry is taken over by the next writer of the
+ * slot, once the slot has been busy for SLOT_TAKEOVER_TIMEOUT and its process is gone.
+ */
+class ShmemTopicSegment {
+public:
+    static constexpr size_t DEFAULT_SIZE = 64 * 1024 * 1024;
+    static constexpr size_t MAX_TOPICS = 256;
+    static constexpr size_t MAX_TOPIC_LENGTH = 191;
+    static constexpr std::chrono::milliseconds SLOT_TAKEOVER_TIMEOUT{10};
+
+    /**
+     * Result of read()
+     */
+    enum class ReadResult {
+        OK,
+        /// the entry is not complete yet
+        PENDING,
+        /// the entry has been overwritten by a later one
+        LOST
+    };
+
+    /**
+     * A slot claimed by beginWrite(), to be passed to commitWrite()
+     */
+    struct WriteTicket {
+        uint32_t topic = 0;
+        uint64_t seq = 0;
+        void* slot = nullptr;
+    };
+
+    /**
+     * Open the segment of the passed name, e.g. "/mcf_topics", creating it with the passed size
+     * if it does not exist. Processes attaching later use the size of the existing segment.
+     */
+    explicit ShmemTopicSegment(const std::string& name, size_t size = DEFAULT_SIZE);
+
+    /**
+     * Unmap the segment, remove it if no other process is attached any more
+     */
+    ~ShmemTopicSegment();
+
+    ShmemTopicSegment(const ShmemTopicSegment&) = delete;
+    ShmemTopicSegment& operator=(const ShmemTopicSegment&) = delete;
+
+    const std::string& name() const { return fName; }
+
+    /**
+     * Return the index of a topic, adding it with the passed layout if no process added it yet
+     *
+     * The layout of the process adding a topic first is kept, a warning is logged if the layout
+     * passed by a later process differs. Throws std::runtime_error if the topic name is too long,
+     * or if the segment has no room for another topic.
+     *
+     * @param slotSize  the bytes of the largest entry of the topic
+     * @param slots     the number of entries kept per topic
+     */
+    uint32_t addTopic(const std::string& topic, size_t slotSize, uint32_t slots);
+
+    /**
+     * Claim the slot of the next entry of a topic
+     *
+     * @param data  set to the memory of size bytes to fill
+     * @return 0 on success, EMSGSIZE if size exceeds the slot size of the topic, EAGAIN if the slot
+     *         has already been claimed by a writer of a later entry
+     */
+    int beginWrite(uint32_t topic, size_t size, WriteTicket& ticket, void*& data);
+
+    /**
+     * Publish the entry of a slot claimed by beginWrite() and notify the readers
+     *
+     * @param writerId  tells readers who wrote the entry
+     * @param size      the bytes filled, 0 discards the entry
+     */
+    void commitWrite(const WriteTicket& ticket, uint64_t writerId, size_t size);
+
+    /**
+     * The number of entries kept by a topic
+     */
+    uint32_t slots(uint32_t topic) const;
+
+    /**
+     * The sequence number of the latest complete entry of a topic, 0 if there is none yet.
+     * Entries are numbered from 1.
+     */
+    uint64_t lastSeq(uint32_t topic) const;
+
+    /**
+     * Copy the entry of a sequence number out of its slot
+     *
+     * @param data      receives the entry, empty for discarded entries
+     * @param writerId  receives the writer id passed to commitWrite()
+     */
+    ReadResult read(uint32_t topic, uint64_t seq, std::vector<char>& data, uint64_t& writerId) const;
+
+    /**
+     * The notification counter, to be passed to wait() before checking the topics for new entries
+     */
+    uint32_t notifications() const;
+
+    /**
+     * Wait until an entry is written after notifications() returned seen, or the timeout expires
+     */
+    void wait(uint32_t seen, std::chrono::milliseconds timeout) const;
+
+    /**
+     * Wake all waiting readers, e.g. to stop a thread blocked in wait()
+     */
+    void notify();
+
+private:
+    struct Header;
+    struct Topic;
+    struct Slot;
+
+    Topic& topic(uint32_t index) const;
+    Slot& slot(const Topic& topic, uint64_t seq) const;
+
+    const std::string fName;
+    const int32_t fPid;
+    void* fMemory = nullptr;
+    size_t fSize = 0;
+    Header* fHeader = nullptr;
+};
+
+/**
+ * Shares topics of a value store with the value stores of other processes on the same host
+ * through a ShmemTopicSegment, instead of sending them through a RemoteService
+ *
+ * Values written to a shared topic by any component of the process are copied into the segment,
+ * the values written by other processes are set into the value store by a thread of the bridge.
+ * Ports of components are used unchanged. Values are packed with the codec of their registered
+ * type straight into their slot, for types in the POD format (see mcf_core/PodValue.h) this is a
+ * single memcpy of their attributes, ext mem data is copied as it is. There is no socket, no
+ * acknowledgement and no intermediate buffer; the reading side copies an entry out of its slot
+ * before decoding it, as a writer may reuse the slot meanwhile. Values of types which are not
+ * registered in the value store are not shared.
+ *
+ * A process sharing a topic first receives the latest value of the topic, if there is one, and
+ * all values written afterwards, as long as the thread of the bridge does not fall behind by more
+ * than the slots of the topic. The values keep their ids.
+ */
+class ShmemTopicBridge {
+public:
+    static constexpr uint32_t DEFAULT_SLOTS = 8;
+    /// Time the thread waits for a notification before checking the topics anyway
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{100};
+    /// Time after which an entry claimed but not completed by its writer is considered lost
+    static constexpr std::chrono::milliseconds PENDING_TIMEOUT{100};
+
+    /**
+     * Constructor, attaches to the segment and starts the thread
+     *
+     * @param valueStore   the value store of the process, must outlive the bridge
+     * @param segmentName  the name of the segment, the same for all processes sharing topics
+     * @param segmentSize  the bytes of the segment if this process creates it
+     */
+    ShmemTopicBridge(ValueStore& valueStore, const std::string& segmentName,
+                     size_t segmentSize = ShmemTopicSegment::DEFAULT_SIZE);
+
+    /**
+     * Stop the thread and stop sharing the topics
+     */
+    ~ShmemTopicBridge();
+
+    ShmemTopicBridge(const ShmemTopicBridge&) = delete;
+    ShmemTopicBridge& operator=(const ShmemTopicBridge&) = delete;
+
+    /**
+     * Share a topic with the other processes, in both directions
+     *
+     * @param slotSize  the bytes of the largest packed value of the topic including its ext mem
+     *                  data, larger values are not shared
+     * @param slots     the number of values of the topic a slow process may fall behind
+     */
+    void share(const std::string& topic, size_t slotSize, uint32_t slots = DEFAULT_SLOTS);
+
+private:
+    class Writer;
+
+    struct SharedTopic {
+        uint32_t index;
+        ValueStore::TopicHandle handle;
+        std::shared_ptr<Writer> writer;
+        uint64_t nextSeq;
+        bool pending;
+        std::chrono::steady_clock::time_point pendingSince;
+        bool reported;
+    };
+
+    void run();
+
+    /**
+     * Set the new entries of a topic into the value store
+     *
+     * @return false if an entry is not complete yet
+     */
+    bool receive(SharedTopic& topic);
+
+    /**
+     * Sets a value received from the segment, numbered by the topic of the writing bridge
+     */
+    void deliver(SharedTopic& topic, const std::vector<char>& entry, uint64_t writerId);
+
+    ValueStore& fValueStore;
+    const std::shared_ptr<ShmemTopicSegment> fSegment;
+    const uint64_t fWriterId;
+
+    // protects the topics added by share() while the thread runs, the thread takes them over
+    std::mutex fMutex;
+    std::vector<SharedTopic> fNewTopics;
+    std::vector<uint32_t> fIndices;
+    // owned by the thread
+    std::vector<SharedTopic> fTopics;
+    std::vector<char> fEntry;
+
+    std::atomic<bool> fStop{false};
+    std::thread fThread;
+};
+
+} // end namespace remote
+
+} // end namespace mcf
+
+#endif
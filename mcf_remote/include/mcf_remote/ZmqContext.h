@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_ZMQCONTEXT_H
+#define MCF_ZMQCONTEXT_H
+
+#include "mcf_core/ThreadAffinity.h"
+
+#include "zmq.hpp"
+
+#include <memory>
+
+namespace mcf {
+
+namespace remote {
+
+/**
+ * Settings of the 0MQ context shared by the remote endpoints of a process, see ZmqContext
+ */
+struct ZmqContextConfig
+{
+    /// number of 0MQ I/O threads
+    int ioThreads = 1;
+    /// the CPUs the I/O threads may run on, the empty mask leaves them unpinned
+    CpuMask cpuAffinity = 0;
+    /// SCHED_FIFO priority of the I/O threads, 0 for DEFAULT_PRIORITY if the thread creating the
+    /// context runs with SCHED_FIFO and the default scheduling otherwise, -1 for the default
+    /// scheduling in any case
+    int priority = 0;
+    /// kernel send buffer size of the sockets in bytes (SO_SNDBUF), -1 for the OS default
+    int sendBufferSize = -1;
+    /// kernel receive buffer size of the sockets in bytes (SO_RCVBUF), -1 for the OS default
+    int receiveBufferSize = -1;
+};
+
+/**
+ * The 0MQ context shared by all senders, receivers and RemoteControl instances of a process
+ *
+ * A context per endpoint brings its own I/O threads, so that a process with many remote links
+ * ran as many I/O threads floating across all CPUs. The shared context is created with the
+ * settings passed to configure() when the first endpoint is created, and terminated once the
+ * last endpoint holding it is destroyed. The settings are typically read from the optional
+ * "ZmqContext" object of the system configuration, e.g.
+ *
+ *     "ZmqContext": {
+ *         "ioThreads": 2,
+ *         "cpuAffinity": "2-3",
+ *         "priority": 35,
+ *         "sendBufferSize": 4194304,
+ *         "receiveBufferSize": 4194304
+ *     }
+ *
+ * see RemoteServiceConfigurator::readZmqContextConfiguration().
+ */
+class ZmqContext
+{
+public:
+    /// SCHED_FIFO priority of the I/O threads if the creating thread runs with SCHED_FIFO
+    static constexpr int DEFAULT_PRIORITY = 35;
+
+    /**
+     * Set the settings of the shared context
+     *
+     * The settings apply to the context created next, a warning is logged if a context is in
+     * use already, so they should be configured before the first endpoint is created. The socket
+     * buffer sizes apply to all sockets configured afterwards.
+     */
+    static void configure(const ZmqContextConfig& config);
+
+    /**
+     * The settings passed to configure()
+     */
+    static ZmqContextConfig config();
+
+    /**
+     * The shared context, created on first use
+     *
+     * @throws std::runtime_error if the settings cannot be applied to a new context
+     */
+    static std::shared_ptr<zmq::context_t> shared();
+
+    /**
+     * Apply the socket buffer sizes of the settings to a socket, before it is bound or connected
+     */
+    static void configureSocket(zmq::socket_t& socket);
+};
+
+} // end namespace remote
+
+} // end namespace mcf
+
+#endif
@@ -0,0 +1,231 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#ifndef MCF_REMOTE_ZMQMSGPACKASYNCSENDER_H
+#define MCF_REMOTE_ZMQMSGPACKASYNCSENDER_H
+
+#include "zmq.hpp"
+
+#include "mcf_remote/AbstractSender.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace mcf{
+
+namespace remote {
+
+class ShmemKeeper;
+
+/**
+ * Implementation of AbstractSender that never waits for the receiver on the sending thread.
+ *
+ * Messages are handed over to an I/O thread, which owns a DEALER socket connected to a routed
+ * ZmqMsgPackValueReceiver. Every message is sent behind a sequence number, which the receiver
+ * returns with the response, so that responses are assigned to their messages regardless of
+ * their order and late responses do not disturb later ones.
+ *
+ * The responses to values sent with sendValueAsync() are passed to the completion handler, or,
+ * if none is set, returned by pollAcks(). Values without response within the send timeout
+ * complete with TIMEOUT. Pings, pongs and commands do not wait for their response either.
+ */
+class ZmqMsgPackAsyncSender : public AbstractSender
+{
+public:
+    /**
+     * Handler of the response to a value, called from the I/O thread
+     */
+    using CompletionHandler = std::function<void(const Ack&)>;
+
+    /**
+     * Constructs a new ZmqMsgPackAsyncSender and stores the passed arguments.
+     * The connection will not be established until the function connect() is called
+     *
+     * @param connection   A string describing the zmq connection, see ZmqMsgPackSender
+     * @param typeRegistry A type registry to query the type info for msgpack serialization
+     * @param sendTimeout  Time in milliseconds after which a message without response completes
+     *                     with TIMEOUT
+     * @param shmemKeeper  Class to manage shared memory in case it is used. Only needs to be set
+     *                     if the connection uses the shm protocol
+     */
+    ZmqMsgPackAsyncSender(
+        std::string connection,
+        TypeRegistry& typeRegistry,
+        std::chrono::milliseconds sendTimeout = std::chrono::milliseconds(100),
+        std::shared_ptr<ShmemKeeper> shmemKeeper = nullptr);
+
+    ~ZmqMsgPackAsyncSender() override;
+
+    /**
+     * Sets the handler of the responses to values sent with sendValueAsync(). Without handler,
+     * the responses are returned by pollAcks().
+     * Shall only be called while the sender is not connected.
+     */
+    void setCompletionHandler(CompletionHandler handler);
+
+    /*
+     * See base class
+     */
+    void connect() override;
+
+    /*
+     * See base class
+     */
+    void disconnect() override;
+
+    /*
+     * See base class. Waits for the response, unlike sendValueAsync()
+     */
+    std::string sendValue(const std::string& topic, ValuePtr value, uint64_t seq = 0) override;
+
+    /*
+     * See base class
+     */
+    bool supportsPipelining() const override { return true; }
+
+    /*
+     * See base class
+     */
+    std::string sendValueAsync(const std::string& topic, ValuePtr value, uint64_t seq = 0) override;
+
+    /*
+     * See base class
+     */
+    void pollAcks(std::vector<Ack>& acks, std::chrono::milliseconds timeout) override;
+
+    /*
+     * See base class
+     */
+    void sendPing(uint64_t freshnessValue) override;
+
+    /*
+     * See base class
+     */
+    void sendPong(uint64_t freshnessValue) override;
+
+    /*
+     * See base class
+     */
+    void sendRequestAll() override;
+
+    /*
+     * See base class. Returns SENT without waiting for the response
+     */
+    std::string sendBlockedValueInjected(const std::string& topic) override;
+
+    /*
+     * See base class. Returns SENT without waiting for the response
+     */
+    std::string sendBlockedValueRejected(const std::string& topic) override;
+
+    /*
+     * See base class
+     */
+    bool connected() const override { return _socketQueue != nullptr; }
+
+    /*
+     * See base class
+     */
+    std::string connectionStr() const override { return _connectionStr; };
+
+private:
+    /**
+     * Message whose response has not arrived yet
+     */
+    struct InFlight
+    {
+        /// topic of a value, kind of other messages
+        std::string topic;
+        bool isValue;
+        std::chrono::steady_clock::time_point sent;
+        /// set if the sending thread waits for the response
+        std::shared_ptr<std::promise<std::string>> promise;
+    };
+
+    /**
+     * Registers a new message and starts it with its sequence number
+     */
+    void beginMessage(
+        const std::string& topic,
+        bool isValue,
+        std::shared_ptr<std::promise<std::string>> promise = nullptr);
+
+    template<typename T>
+    void transferData(const T& message, const int flags = 0);
+
+    /**
+     * Sends the frames of a value message
+     *
+     * @param seq Sequence number of the value in its topic, see sendValue()
+     *
+     * @return false if the value cannot be sent
+     */
+    bool transferValue(
+        const std::string& topic,
+        ValuePtr value,
+        uint64_t seq,
+        std::shared_ptr<std::promise<std::string>> promise = nullptr);
+
+    /**
+     * Main function of the I/O thread
+     */
+    void run(std::unique_ptr<zmq::socket_t> socketPull, std::unique_ptr<zmq::socket_t> socketSend);
+
+    /**
+     * Forwards the messages queued by the sending thread to the receiver
+     */
+    void forwardMessages(zmq::socket_t& socketPull, zmq::socket_t& socketSend);
+
+    /**
+     * Receives the available responses and completes their messages
+     */
+    void receiveResponses(zmq::socket_t& socketSend);
+
+    /**
+     * Completes the messages without response within the send timeout
+     *
+     * @return time until the next message times out
+     */
+    std::chrono::milliseconds expireMessages();
+
+    void complete(InFlight& message, const std::string& result);
+
+    // shared by all endpoints of the process, see ZmqContext
+    std::shared_ptr<zmq::context_t> _context;
+    const std::string _queueEndpoint;
+    std::string _connectionStr;
+    std::string _connection;
+    // sending thread side of the queue to the I/O thread
+    std::unique_ptr<zmq::socket_t> _socketQueue;
+
+    TypeRegistry& _typeRegistry;
+    const std::chrono::milliseconds _sendTimeout;
+
+    // for access to shared memory segment for inter process communication
+    std::string _shmemName;
+    std::shared_ptr<ShmemKeeper> _shmemKeeper;
+
+    CompletionHandler _completionHandler;
+
+    std::mutex _mutex;
+    std::condition_variable _acksAvailable;
+    std::map<uint64_t, InFlight> _inFlight;
+    std::deque<Ack> _acks;
+    uint64_t _nextSequence = 0;
+
+    std::atomic<bool> _running{false};
+    std::thread _ioThread;
+};
+
+} // end namespace remote
+
+} // end namespace mcf
+
+#endif
@@ -9,6 +9,9 @@
 
 #include "mcf_remote/AbstractSender.h"
 
+#include <deque>
+#include <map>
+
 namespace mcf{
 
 namespace remote {
@@ -19,6 +22,19 @@ class ShmemKeeper;
  * Implementation of AbstractSender that uses 0MQ for message sending and MessagePack for data
  * serialization. If the shm protocol is used, additional, unserialized, extMem data may be passed
  * along with the message over boost shared memory.
+ *
+ * In pipelined mode, the sender uses a DEALER socket instead of a REQ socket, so that several
+ * values may be sent before their responses have arrived. The REP socket of the receiver answers
+ * the messages in the order they have been sent, which assigns the responses to the values.
+ *
+ * Values on topics with compression (see setCompression()) are sent compressed with deflate,
+ * unless the shm protocol is used. This requires the library to be built with HAVE_ZLIB.
+ *
+ * With ExtMem export (see setExtMemExport()), values whose ExtMem part can be exported are sent
+ * with the handle of the exported ExtMem part instead, once the receiver has announced in its
+ * answer to a ping that it imports such values and runs on the same host (see hostId()). A value
+ * whose export the receiver rejects is sent again with its ExtMem part copied. If the copy is
+ * accepted, the receiver cannot import the exports, which are no longer sent over the connection.
  */
 class ZmqMsgPackSender : public AbstractSender
 {
@@ -41,12 +57,14 @@ public:
      * @param shmemKeeper  Class to manage shared memory in case it is used. Only needs to be set
      *                     if the connection uses the shm protocol. Using the default argument
      *                     will result in errors if the shm protocol is used
+     * @param pipelined    If true, values may be sent with sendValueAsync()
      */
     ZmqMsgPackSender(
         std::string connection,
         TypeRegistry& typeRegistry,
         std::chrono::milliseconds sendTimeout = std::chrono::milliseconds(100),
-        std::shared_ptr<ShmemKeeper> shmemKeeper = nullptr);
+        std::shared_ptr<ShmemKeeper> shmemKeeper = nullptr,
+        bool pipelined = false);
 
     /*
      * See base class
@@ -61,7 +79,64 @@ public:
     /*
      * See base class
      */
-    std::string sendValue(const std::string& topic, ValuePtr value) override;
+    std::string sendValue(const std::string& topic, ValuePtr value, uint64_t seq = 0) override;
+
+    /*
+     * See base class. Values without ExtMem part are coalesced into batch messages, except in
+     * pipelined mode
+     */
+    std::vector<std::string> sendValues(
+        const std::vector<std::pair<std::string, ValuePtr>>& values, size_t maxBytes,
+        const std::vector<uint64_t>& seqs = std::vector<uint64_t>()) override;
+
+    /*
+     * See base class
+     */
+    bool supportsPipelining() const override { return _pipelined; }
+
+    /*
+     * See base class
+     */
+    std::string sendValueAsync(const std::string& topic, ValuePtr value, uint64_t seq = 0) override;
+
+    /*
+     * See base class
+     */
+    void pollAcks(std::vector<Ack>& acks, std::chrono::milliseconds timeout) override;
+
+    /*
+     * See base class. Has no effect on shm connections, whose ExtMem parts are not copied
+     */
+    void setCompression(const std::string& topic, const Compression& compression) override;
+
+    /*
+     * See base class
+     */
+    void setCompressionObserver(CompressionObserver observer) override
+    {
+        _compressionObserver = std::move(observer);
+    }
+
+    /*
+     * See base class. Used for values sent without compression over non-shm connections
+     */
+    void setSerializationCache(std::shared_ptr<SerializationCache> cache) override
+    {
+        _serializationCache = std::move(cache);
+    }
+
+    /*
+     * See base class
+     */
+    void setExtMemExport(bool enable) override { _extMemExport = enable; }
+
+    /*
+     * See base class. Values are stamped unless they are compressed or sent in batches
+     */
+    void setClockObserver(ClockObserver observer) override
+    {
+        _clockObserver = std::move(observer);
+    }
 
     /*
      * See base class
@@ -78,6 +153,16 @@ public:
      */
     void sendRequestAll() override;
 
+    /*
+     * See base class
+     */
+    void sendRequestStale(const std::map<std::string, uint64_t>& heldIds) override;
+
+    /*
+     * See base class
+     */
+    void sendSubscriptions(const std::map<std::string, bool>& subscribed) override;
+
     /*
      * See base class
      */
@@ -99,20 +184,119 @@ public:
     std::string connectionStr() const override { return _connectionStr; };
 
 private:
+    /**
+     * Message sent in pipelined mode whose response has not arrived yet
+     */
+    struct InFlight
+    {
+        /// topic of a value, empty for other messages
+        std::string topic;
+        bool isValue;
+        std::chrono::steady_clock::time_point sent;
+        /// value sent with its ExtMem part exported, kept to copy it if the export is rejected
+        ValuePtr exported = nullptr;
+        std::string exportHandle;
+        /// set if the value is the copy of a rejected export
+        bool copied = false;
+        /// sequence number of the exported value, sent again with its copy
+        uint64_t seq = 0;
+    };
+
+    /**
+     * Starts a new message once the socket is ready for sending. In pipelined mode, this sends the
+     * empty delimiter frame which a REP socket expects in front of the message.
+     */
+    void beginMessage();
+
     template<typename T>
     void transferData(const T& message, const int flags = 0);
 
     /**
-     * Tries to receive a response to a previously sent message containing a zmq serialized string,
-     * unpacks and returns that string.
-     * The function will block until something has been received or the timeout has been reached.
+     * Sends a frame packed in advance, e.g. the kind of a message
+     */
+    void transferFrame(const std::string& frame, const int flags = 0);
+
+    /**
+     * Sends the frames of a value message
+     *
+     * @param seq          Sequence number of the value in its topic, see sendValue()
+     * @param exportExtMem Send the handle of the exported ExtMem part if possible, see
+     *                     setExtMemExport()
+     * @param exportHandle Set to the handle of the exported ExtMem part, empty if not exported
+     *
+     * @return false if the value cannot be sent
+     */
+    bool transferValue(const std::string& topic, ValuePtr value, uint64_t seq, bool exportExtMem,
+                       std::string& exportHandle);
+
+    /**
+     * Passes the response to a value sent in pipelined mode on to acks, unless the value has
+     * been sent exported and is rejected. It is then sent again with its ExtMem part copied.
+     * The exports of values rejected or timed out are withdrawn.
+     */
+    void acknowledge(const InFlight& message, const std::string& response, std::vector<Ack>& acks);
+
+    /**
+     * Releases the ExtMem part of a value exported for a message which has been rejected or timed
+     * out, see IExtMemValue::extMemWithdraw()
+     */
+    static void withdrawExport(const Value& value, const std::string& exportHandle);
+
+    /**
+     * Stops exporting if the receiver has accepted the copy of a rejected export
+     */
+    void checkCopiedResponse(const std::string& topic, const std::string& response);
+
+    /**
+     * Sends the kind and topic frames in front of the frames of a value
+     */
+    void transferValueHeader(const std::string& topic);
+
+    /**
+     * Sends a batch message and waits for its response
+     *
+     * @param batch  The payload, see packBatchEntry()
+     * @param count  The number of values in the batch
+     *
+     * @return The result of every value in the batch
+     */
+    std::vector<std::string> sendBatch(const msgpack::sbuffer& batch, size_t count);
+
+    /**
+     * Waits for the response to the message sent last, unpacks and returns the string it contains.
+     * In pipelined mode, the responses to values sent before are collected for pollAcks().
+     * The function will block until the response has been received or the timeout has been
+     * reached.
      *
      * @return The string contained in the response. In case of a timeout, the string 'TIMEOUT' is
      *         returned
      */
     std::string checkForResponse(const std::chrono::milliseconds& timeout);
 
-    zmq::context_t _context;
+    /**
+     * Tries to receive the next response containing a zmq serialized string and unpacks it.
+     *
+     * @return false if no response has been received within the timeout
+     */
+    bool receiveResponse(const std::chrono::milliseconds& timeout, std::string& response);
+
+    /**
+     * Tries to receive the next response without unpacking it. Throws a zmq::error_t if
+     * receiving fails.
+     *
+     * @return false if no response has been received within the timeout
+     */
+    bool receiveResponseFrame(const std::chrono::milliseconds& timeout, zmq::message_t& frame);
+
+    /**
+     * Reconnects in pipelined mode after a response did not arrive in time, as the order of the
+     * responses does not assign them to the messages anymore. The values in flight are
+     * acknowledged with TIMEOUT.
+     */
+    void resynchronize();
+
+    // shared by all endpoints of the process, see ZmqContext
+    std::shared_ptr<zmq::context_t> _context;
     std::string _connectionStr;
     std::string _connection;
     std::unique_ptr<zmq::socket_t> _socketSend;
@@ -124,6 +308,37 @@ private:
     std::string _shmemName;
     std::shared_ptr<ShmemKeeper> _shmemKeeper;
 
+    const bool _pipelined;
+    // messages sent in pipelined mode, in the order of their responses
+    std::deque<InFlight> _inFlight;
+    // responses to values received while waiting for the response of another message
+    std::vector<Ack> _acks;
+
+    // reused for packing the frames of the messages
+    msgpack::sbuffer _frameBuffer;
+
+    // compression of the values per topic, see setCompression()
+    std::map<std::string, Compression> _compression;
+    CompressionObserver _compressionObserver;
+
+    // serialization shared with the senders to other peers, see setSerializationCache()
+    std::shared_ptr<SerializationCache> _serializationCache;
+
+    ClockObserver _clockObserver;
+    // set once the receiver answered a ping with its clock, i.e. understands stamped values,
+    // exported values and the sendStale and subscriptions commands
+    bool _stampValues = false;
+    // set once the receiver announced in its answer to a ping that it accepts numeric type ids
+    bool _numericTypeIds = false;
+
+    // send handles of exported ExtMem parts, see setExtMemExport()
+    bool _extMemExport = false;
+    // set once the receiver announced in its answer to a ping that it imports exported values
+    // and runs on the same host
+    bool _extMemImporter = false;
+    // set once the receiver accepted the copy of a rejected export, i.e. cannot import them
+    bool _extMemImportFailed = false;
+
 };
 
 } // end namespace remote
@@ -42,17 +42,20 @@ public:
      * @param shmemClient  Helper class to give reading access to a shared memory file.
      *                     Only used if the protocol shm is specified in connection.  Using the
      *                     default argument will result in errors if the shm protocol is used
+     * @param routed       If true, the receiver accepts messages of a ZmqMsgPackAsyncSender
      */
     ZmqMsgPackValueReceiver(
         const std::string& connection,
         TypeRegistry& typeRegistry,
-        std::shared_ptr<ShmemClient> shmemClient = nullptr);
+        std::shared_ptr<ShmemClient> shmemClient = nullptr,
+        bool routed = false);
 
     virtual ~ZmqMsgPackValueReceiver() = default;
 
 private:
     /**
-     * Unpacks the received message and constructs a ValuePtr from it.
+     * Unpacks the received message and constructs a ValuePtr from it. Sets the sequence number
+     * of the message.
      *
      * @param message The received ZmqMessage
      *
@@ -60,6 +63,16 @@ private:
      */
     virtual ValuePtr decodeValue(ZmqMessage& message) override;
 
+    /**
+     * Keeps the received message in its wire format as RelayedValue. Sets the sequence number
+     * of the message.
+     *
+     * @param message The received ZmqMessage
+     *
+     * @return A RelayedValue holding a copy of message
+     */
+    virtual ValuePtr relayValue(ZmqMessage& message) override;
+
     TypeRegistry& _typeRegistry;
 };
 
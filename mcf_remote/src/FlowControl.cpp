@@ -0,0 +1,214 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#include "mcf_remote/FlowControl.h"
+#include "mcf_remote/RelayedValue.h"
+
+#include "mcf_core/IExtMemValue.h"
+
+#include <algorithm>
+
+namespace mcf {
+
+namespace remote {
+
+namespace {
+
+// the rate and congestion level are adapted at most once per interval
+constexpr std::chrono::milliseconds ADAPT_INTERVAL{100};
+// the lowest response time is forgotten after this time, so that it follows route changes
+constexpr std::chrono::seconds BASE_ACK_TIME_WINDOW{10};
+// weight of a new response time in the smoothed response time
+constexpr double ACK_TIME_GAIN = 0.125;
+// weight of a new interval in the bandwidth estimate
+constexpr double BANDWIDTH_GAIN = 0.25;
+// the link is congested while the smoothed response time exceeds the lowest one by this factor
+constexpr double CONGESTION_ACK_TIME_FACTOR = 2.;
+// on congestion, the rate drops to this share of the estimated bandwidth
+constexpr double CONGESTION_RATE_FACTOR = 0.85;
+// per interval without congestion, the rate rises by this factor
+constexpr double RECOVERY_RATE_FACTOR = 1.1;
+// without fixed limit, the rate is lifted once it exceeds the estimated bandwidth by this factor
+constexpr double UNLIMITED_RATE_FACTOR = 2.;
+constexpr unsigned MAX_CONGESTION_LEVEL = 16;
+constexpr unsigned MAX_DECIMATION_SHIFT = 6;
+// allowance for the serialized members of a value
+constexpr std::size_t VALUE_OVERHEAD = 256;
+
+double seconds(FlowControl::Clock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::duration<double>>(duration).count();
+}
+
+} // anonymous namespace
+
+FlowControl::FlowControl(const Config& config)
+: _config(config)
+, _rate(static_cast<double>(config.maxRate))
+, _tokens(static_cast<double>(config.burst))
+, _refilled(Clock::now())
+, _adapted(_refilled)
+, _baseUpdated(_refilled)
+{
+}
+
+FlowControl::Clock::duration FlowControl::acquire(const std::size_t bytes, const Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    if(_rate <= 0.)
+    {
+        return Clock::duration::zero();
+    }
+
+    const double burst = static_cast<double>(_config.burst);
+    _tokens = std::min(burst, _tokens + _rate * seconds(now - _refilled));
+    _refilled = now;
+
+    // values larger than the burst are sent from a full bucket, leaving it in debt
+    const double needed = std::min(static_cast<double>(bytes), burst);
+    if(_tokens >= needed)
+    {
+        _tokens -= static_cast<double>(bytes);
+        return Clock::duration::zero();
+    }
+
+    ++_delayed;
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>((needed - _tokens) / _rate));
+}
+
+void FlowControl::valueAcked(
+    const std::size_t bytes,
+    const Clock::duration duration,
+    const std::string& result,
+    const Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    if(result == "TIMEOUT" || result == "REJECTED")
+    {
+        _intervalFailed = true;
+    }
+    else
+    {
+        _intervalBytes += bytes;
+        _intervalBusy += duration;
+
+        const double ackTime = seconds(duration);
+        _ackTime = _ackTime > 0. ? _ackTime + ACK_TIME_GAIN * (ackTime - _ackTime) : ackTime;
+        if(_baseAckTime <= 0. || _ackTime < _baseAckTime || now - _baseUpdated > BASE_ACK_TIME_WINDOW)
+        {
+            _baseAckTime = _ackTime;
+            _baseUpdated = now;
+        }
+    }
+
+    if(now - _adapted >= ADAPT_INTERVAL)
+    {
+        adapt(now);
+    }
+}
+
+void FlowControl::adapt(const Clock::time_point now)
+{
+    if(_intervalBusy > Clock::duration::zero())
+    {
+        const double delivered = static_cast<double>(_intervalBytes) / seconds(_intervalBusy);
+        _bandwidth = _bandwidth > 0. ? _bandwidth + BANDWIDTH_GAIN * (delivered - _bandwidth) : delivered;
+    }
+
+    if(_config.adaptive)
+    {
+        const bool congested =
+            _intervalFailed || (_baseAckTime > 0. && _ackTime > CONGESTION_ACK_TIME_FACTOR * _baseAckTime);
+        const double maxRate = static_cast<double>(_config.maxRate);
+        if(congested)
+        {
+            _congestionLevel = std::min(_congestionLevel + 1, MAX_CONGESTION_LEVEL);
+            if(_bandwidth > 0.)
+            {
+                const double reduced = CONGESTION_RATE_FACTOR * _bandwidth;
+                _rate = maxRate > 0. ? std::min(maxRate, reduced) : reduced;
+            }
+        }
+        else
+        {
+            if(_congestionLevel > 0)
+            {
+                --_congestionLevel;
+            }
+            if(_rate > 0.)
+            {
+                _rate *= RECOVERY_RATE_FACTOR;
+                if(maxRate > 0. && _rate >= maxRate)
+                {
+                    _rate = maxRate;
+                }
+                else if(maxRate <= 0. && _rate >= UNLIMITED_RATE_FACTOR * _bandwidth)
+                {
+                    _rate = 0.;
+                }
+            }
+        }
+    }
+
+    _intervalBytes = 0;
+    _intervalBusy = Clock::duration::zero();
+    _intervalFailed = false;
+    _adapted = now;
+}
+
+void FlowControl::valueDecimated()
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    ++_decimated;
+}
+
+unsigned FlowControl::decimationShift(const std::size_t lane, const std::size_t lanes) const
+{
+    if(lane == 0 || lane >= lanes)
+    {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(_mtx);
+    const std::size_t fromBottom = lanes - 1 - lane;
+    if(_congestionLevel <= fromBottom)
+    {
+        return 0;
+    }
+    return std::min<unsigned>(_congestionLevel - static_cast<unsigned>(fromBottom), MAX_DECIMATION_SHIFT);
+}
+
+FlowControl::Statistics FlowControl::statistics() const
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    Statistics statistics;
+    statistics.bandwidth = _bandwidth;
+    statistics.rate = _rate;
+    statistics.ackTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(_ackTime));
+    statistics.baseAckTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(_baseAckTime));
+    statistics.congestionLevel = _congestionLevel;
+    statistics.decimated = _decimated;
+    statistics.delayed = _delayed;
+    return statistics;
+}
+
+std::size_t FlowControl::estimateWireSize(const Value& value)
+{
+    if(const auto* relayed = dynamic_cast<const RelayedValue*>(&value))
+    {
+        return relayed->serialized().valueBufferSize() + relayed->serialized().extMemSize();
+    }
+    if(const auto* extMemValue = dynamic_cast<const IExtMemValue*>(&value))
+    {
+        return extMemValue->extMemSize() + VALUE_OVERHEAD;
+    }
+    return VALUE_OVERHEAD;
+}
+
+} // end namespace remote
+
+} // end namespace mcf
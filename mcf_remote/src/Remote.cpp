@@ -7,8 +7,18 @@
 #endif
 #include "mcf_core/ErrorMacros.h"
 
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 
+#include <unistd.h>
+
 namespace mcf {
 
 namespace remote {
@@ -17,18 +27,13 @@ namespace remote {
 ValueKeeper valueKeeper;
 
 ValueKeeper::HandleType ValueKeeper::addValue(const ValuePtr& value) {
-    std::lock_guard<std::mutex> lk(fMutex);
-    auto handle = reinterpret_cast<HandleType>(value.get());
-    fMap[handle] = value;
-    return handle;
+    fSize.fetch_add(1, std::memory_order_relaxed);
+    return new ValuePtr(value);
 }
 
 void ValueKeeper::removeValue(HandleType handle) {
-    std::lock_guard<std::mutex> lk(fMutex);
-    auto it = fMap.find(handle);
-    if (it != fMap.end()) {
-        fMap.erase(it);
-    }
+    delete static_cast<const ValuePtr*>(handle);
+    fSize.fetch_sub(1, std::memory_order_relaxed);
 };
 
 void ValueKeeper::zmqFreeFunction(void* data, void* hint) {
@@ -36,6 +41,104 @@ void ValueKeeper::zmqFreeFunction(void* data, void* hint) {
     valueKeeper.removeValue(hint);
 }
 
+SerializationCache::SerializationCache(std::size_t capacity)
+: fEntries(std::max<std::size_t>(capacity, 1))
+{
+}
+
+bool SerializationCache::find(
+    const ValuePtr& value, zmq::message_t& frame, const void*& extMemPtr, std::size_t& extMemLen,
+    bool numericTypeId, uint64_t seq)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    for (auto& entry : fEntries)
+    {
+        // an expired entry keeps its control block, so no new value can be equivalent to it
+        if (entry.numericTypeId == numericTypeId && entry.seq == seq &&
+            !entry.value.owner_before(value) && !value.owner_before(entry.value) && !entry.value.expired())
+        {
+            frame.copy(&entry.frame);
+            extMemPtr = entry.extMemPtr;
+            extMemLen = entry.extMemLen;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SerializationCache::insert(
+    const ValuePtr& value, zmq::message_t&& frame, const void* extMemPtr, std::size_t extMemLen,
+    bool numericTypeId, uint64_t seq)
+{
+    std::lock_guard<std::mutex> lk(fMutex);
+    Entry& entry = fEntries[fNext];
+    fNext = (fNext + 1) % fEntries.size();
+    entry.value = value;
+    entry.frame = std::move(frame);
+    entry.extMemPtr = extMemPtr;
+    entry.extMemLen = extMemLen;
+    entry.numericTypeId = numericTypeId;
+    entry.seq = seq;
+}
+
+namespace {
+
+#if HAVE_ZLIB
+/*
+ * Compresses a frame of a value message, returns false if it does not shrink
+ */
+bool compressFrame(const void* data, std::size_t size, int level, std::vector<char>& out)
+{
+    uLongf compressedLen = compressBound(size);
+    out.resize(compressedLen);
+    if (compress2(reinterpret_cast<Bytef*>(out.data()), &compressedLen,
+            static_cast<const Bytef*>(data), size, level) != Z_OK)
+    {
+        throw SendError("Cannot compress value frame");
+    }
+    out.resize(compressedLen);
+    return compressedLen < size;
+}
+#endif
+
+void decompressFrame(const void* data, std::size_t size, void* out, std::size_t rawSize)
+{
+#if HAVE_ZLIB
+    uLongf rawLen = rawSize;
+    if (uncompress(static_cast<Bytef*>(out), &rawLen, static_cast<const Bytef*>(data), size) != Z_OK
+        || rawLen != rawSize)
+    {
+        throw ReceiveError("Cannot decompress value frame");
+    }
+#else
+    throw ReceiveError("Compressed value received. Make sure HAVE_ZLIB is set.");
+#endif
+}
+
+void freeFrameBuffer(void*, void* hint)
+{
+    delete static_cast<std::vector<char>*>(hint);
+}
+
+/*
+ * Sends a compressed frame without copying it, 0MQ releases the buffer once sent
+ */
+void sendFrameBuffer(zmq::socket_t& socket, std::vector<char>&& frame, int flags)
+{
+    auto* buffer = new std::vector<char>(std::move(frame));
+    zmq::message_t request(buffer->data(), buffer->size(), freeFrameBuffer, buffer);
+    socket.send(request, flags);
+}
+
+// prefix of the response to a ping, followed by the receive and the send time of the peer
+const std::string CLOCK_RESPONSE_PREFIX = "CLOCK ";
+// announcement following the times in the response to a ping, see sendValue()
+const std::string TYPE_IDS_ANNOUNCEMENT = "TYPEIDS";
+// announcement of the host of a peer which imports exported values, see sendExportedValue()
+const std::string EXT_MEM_IMPORT_ANNOUNCEMENT = "EXTMEM=";
+
+} // anonymous namespace
+
 namespace impl {
 
 class IdInjector : public IidGenerator
@@ -55,24 +158,27 @@ ValuePtr unpackMessage(
         TypeRegistry& typeRegistry,
         zmq::message_t& request,
         const void* ptr,
-        size_t len)
+        size_t len,
+        const std::shared_ptr<const void>& extMemOwner,
+        const std::string& extMemHandle,
+        uint64_t* seq)
 {
-    msgpack::unpacker pac;
-
-    // feeds the buffer.
-    pac.reserve_buffer(request.size());
-    memcpy(pac.buffer(), request.data(), request.size());
-    pac.buffer_consumed(request.size());
-
-    // now starts streaming deserialization.
-    msgpack::object_handle oh;
+    // decoded in place from the message, into a zone reused by all messages of this thread
+    static thread_local msgpack::zone zone;
+    zone.clear();
+    const char* data = static_cast<const char*>(request.data());
+    std::size_t offset = 0;
+    bool referenced = false;
+    auto next = [&]() {
+        return msgpack::unpack(zone, data, request.size(), offset, referenced, &referenceBuffer);
+    };
 
     uint64_t id = 0ul;
-    pac.next(oh);
+    msgpack::object o = next();
     try // some values may come without a valid id (e.g. from pyton via RemoteControl)
     {
-        id = oh.get().as<uint64_t>();
-        pac.next(oh);
+        id = o.as<uint64_t>();
+        o = next();
     }
     catch(const std::exception&)
     {
@@ -83,23 +189,57 @@ ValuePtr unpackMessage(
         id = val.id();
     }
 
-    auto classname = oh.get().as<std::string>();
+    // the numeric id of the type, if the sender knows that this receiver supports it
+    const msgpack::object type = o;
+    const bool numericTypeId = type.type == msgpack::type::POSITIVE_INTEGER;
+    auto typeName = [&type, numericTypeId]() {
+        return numericTypeId ? fmt::format("{:#018x}", type.as<uint64_t>()) : type.as<std::string>();
+    };
 
-    pac.next(oh);
-    msgpack::object o = oh.get();
+    o = next();
 
-    auto typeinfoPtr = typeRegistry.getTypeInfo(classname);
+    const auto* typeinfoPtr = numericTypeId ? typeRegistry.findTypeInfo(type.as<uint64_t>())
+                                            : typeRegistry.findTypeInfo(type.as<std::string>());
     if (typeinfoPtr == nullptr) {
         throw ReceiveError(
-            fmt::format("Type of received message not present in type registry: {}", classname));
+            fmt::format("Type of received message not present in type registry: {}", typeName()));
     }
 
     bool isExtMem;
 
-    Value* value;
+    // values of pooled types are decoded directly into memory of their pool
+    std::shared_ptr<Value> value;
     try
     {
-        value = typeinfoPtr->unpackFunc(o, ptr, len, isExtMem);
+        if (!extMemHandle.empty())
+        {
+            // unpacked without ext mem data, which is then mapped from the sending process
+            value = TypeRegistry::unpackSharedValue(*typeinfoPtr, o, nullptr, 0, isExtMem);
+            auto* extMemValue = dynamic_cast<IExtMemValue*>(value.get());
+            if (extMemValue == nullptr || !extMemValue->extMemImport(extMemHandle))
+            {
+                throw ReceiveError(fmt::format("Cannot import exported ext mem of {}", typeinfoPtr->id));
+            }
+        }
+        else if (extMemOwner != nullptr && ptr != nullptr)
+        {
+            // unpacked without ext mem data, which is then shared if the type supports it
+            value = TypeRegistry::unpackSharedValue(*typeinfoPtr, o, nullptr, 0, isExtMem);
+            auto* extMemValue = dynamic_cast<IExtMemValue*>(value.get());
+            if (extMemValue == nullptr || !extMemValue->extMemShare(extMemOwner, ptr, len))
+            {
+                value.reset();
+            }
+        }
+        if (value == nullptr)
+        {
+            value = TypeRegistry::unpackSharedValue(*typeinfoPtr, o, ptr, len, isExtMem);
+        }
+        // the sequence number of the value at the sender follows the value, if sent
+        if (seq != nullptr)
+        {
+            *seq = offset < request.size() ? next().as<uint64_t>() : 0;
+        }
         IdInjector idInjector(id);
         idInjector.injectId(*value);
     }
@@ -108,7 +248,7 @@ ValuePtr unpackMessage(
         throw ReceiveError("msgpack::v1::type_error: " + std::string(e.what()));
     }
 
-    return std::shared_ptr<const Value>(value);
+    return std::shared_ptr<const Value>(std::move(value));
 }
 
 SerializedValue
@@ -131,9 +271,230 @@ getSerializedMessage(zmq::message_t& request, const void* p, size_t len)
         std::move(dataBuffer), request.size(), std::move(extMemBuffer), extMemSize);
 }
 
+bool hasNumericTypeId(const SerializedValue& serialized)
+{
+    const char* data = serialized.valueBuffer();
+    const std::size_t size = serialized.valueBufferSize();
+    std::size_t offset = 0;
+    // values without id start with the name of their type, see unpackMessage()
+    if (msgpack::unpack(data, size, offset).get().type != msgpack::type::POSITIVE_INTEGER)
+    {
+        return false;
+    }
+    return msgpack::unpack(data, size, offset).get().type == msgpack::type::POSITIVE_INTEGER;
+}
+
+ValuePtr relayMessage(zmq::message_t& request, const void* ptr, size_t len, TypeRegistry* typeRegistry,
+                      uint64_t* seq)
+{
+    // skipped elements refer to the message instead of being copied, see unpackMessage()
+    static thread_local msgpack::zone zone;
+    zone.clear();
+    const char* data = static_cast<const char*>(request.data());
+    std::size_t offset = 0;
+    bool referenced = false;
+    auto next = [&]() {
+        return msgpack::unpack(zone, data, request.size(), offset, referenced, &referenceBuffer);
+    };
+
+    uint64_t id = 0ul;
+    const msgpack::object idObject = next();
+    const bool hasId = idObject.type == msgpack::type::POSITIVE_INTEGER;
+    if (hasId)
+    {
+        id = idObject.as<uint64_t>();
+    }
+    else
+    {
+        // value without id, see unpackMessage()
+        DefaultIdGenerator dig;
+        Value val;
+        dig.injectId(val);
+        id = val.id();
+    }
+
+    if (seq != nullptr)
+    {
+        // type and value precede the sequence number, see sendValue()
+        if (hasId)
+        {
+            next();
+        }
+        next();
+        *seq = offset < request.size() ? next().as<uint64_t>() : 0;
+    }
+
+    auto value = std::make_shared<RelayedValue>(getSerializedMessage(request, ptr, len), typeRegistry);
+    IdInjector idInjector(id);
+    idInjector.injectId(*value);
+    return value;
+}
+
+/*
+ * Packs the first frame of a relayed value with the sequence number replaced, see
+ * sendRelayedValue(). Returns false if the frame is forwarded as is, because it carries the
+ * sequence number already or cannot be parsed.
+ */
+bool packRelayedFrame(const RelayedValue& value, uint64_t seq, msgpack::sbuffer& buffer)
+{
+    const auto* form = value.serializedForm();
+    if (form == nullptr)
+    {
+        return false;
+    }
+    const SerializedValue& serialized = value.serialized();
+    const char* begin = serialized.valueBuffer();
+    const std::size_t prefix = form->data + form->size - begin;
+    if (prefix < serialized.valueBufferSize())
+    {
+        std::size_t offset = 0;
+        const msgpack::object_handle sent =
+            msgpack::unpack(begin + prefix, serialized.valueBufferSize() - prefix, offset);
+        if (sent.get().type == msgpack::type::POSITIVE_INTEGER && sent.get().as<uint64_t>() == seq)
+        {
+            return false;
+        }
+    }
+    buffer.write(begin, prefix);
+    msgpack::packer<msgpack::sbuffer> pk(&buffer);
+    pk.pack(seq);
+    return true;
+}
+
 } // end namespace impl
 
-void sendValue(ValuePtr value, const TypeRegistry::TypemapEntry& typeInfo, zmq::socket_t& socket, bool sendMore) {
+void sendExportedValue(
+        ValuePtr value,
+        uint64_t seq,
+        const TypeRegistry::TypemapEntry& typeInfo,
+        zmq::socket_t& socket,
+        const std::string& handle,
+        bool numericTypeId)
+{
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> pk(&buffer);
+    pk.pack(value->id());
+    impl::packTypeId(pk, typeInfo, numericTypeId);
+
+    // packed without asking for the ext mem, which would copy it to host memory
+    TypeRegistry::pack(pk, *value, typeInfo);
+    pk.pack(seq);
+
+    zmq::message_t request(buffer.data(), buffer.size());
+    socket.send(request, ZMQ_SNDMORE);
+    zmq::message_t handleFrame(handle.data(), handle.size());
+    socket.send(handleFrame);
+}
+
+void sendRelayedValue(
+        const std::shared_ptr<const RelayedValue>& value,
+        uint64_t seq,
+        zmq::socket_t& socket,
+        bool sendMore)
+{
+    const SerializedValue& serialized = value->serialized();
+    const bool extMem = serialized.extMemPresent();
+    const int flags = (extMem || sendMore) ? ZMQ_SNDMORE : 0;
+
+    // the sequence number is the one of this sender's topic, not the one the value arrived with
+    msgpack::sbuffer buffer;
+    if (impl::packRelayedFrame(*value, seq, buffer))
+    {
+        const std::size_t size = buffer.size();
+        zmq::message_t request(buffer.release(), size, impl::freeSbufferData);
+        socket.send(request, flags);
+    }
+    else if (serialized.valueBufferSize() < impl::ZERO_COPY_MIN_SIZE)
+    {
+        zmq::message_t request(serialized.valueBuffer(), serialized.valueBufferSize());
+        socket.send(request, flags);
+    }
+    else
+    {
+        // sent without copying, see sendValue()
+        auto handle = valueKeeper.addValue(value);
+        zmq::message_t request(serialized.valueBuffer(), serialized.valueBufferSize(),
+                               ValueKeeper::zmqFreeFunction, const_cast<void*>(handle));
+        socket.send(request, flags);
+    }
+
+    if (extMem)
+    {
+        auto handle = valueKeeper.addValue(value);
+        zmq::message_t memreq(serialized.extMem(), serialized.extMemSize(),
+                              ValueKeeper::zmqFreeFunction, const_cast<void*>(handle));
+        socket.send(memreq, sendMore ? ZMQ_SNDMORE : 0);
+    }
+}
+
+const ISerializedValue::Serialized* RelayedValue::serializedForm() const
+{
+    std::call_once(_parseOnce, [this]()
+    {
+        // id, type id and value, followed by the sequence number, see sendValue()
+        const char* data = _serialized.valueBuffer();
+        const std::size_t size = _serialized.valueBufferSize();
+        std::size_t offset = 0;
+        try
+        {
+            msgpack::object_handle type = msgpack::unpack(data, size, offset);
+            if (type.get().type == msgpack::type::POSITIVE_INTEGER)
+            {
+                type = msgpack::unpack(data, size, offset);
+            }
+            // values without id start with the name of their type, see unpackMessage()
+            if (type.get().type == msgpack::type::POSITIVE_INTEGER)
+            {
+                _serializedForm.numericTypeId = type.get().as<uint64_t>();
+            }
+            else
+            {
+                _serializedForm.typeId = type.get().as<std::string>();
+            }
+            const std::size_t begin = offset;
+            msgpack::unpack(data, size, offset);
+            _serializedForm.data = data + begin;
+            _serializedForm.size = offset - begin;
+            if (_serialized.extMemPresent())
+            {
+                _serializedForm.extMem = _serialized.extMem();
+                _serializedForm.extMemSize = _serialized.extMemSize();
+            }
+            _parsed = true;
+        }
+        catch (const std::exception&)
+        {
+            // malformed message, recorded decoded if at all
+        }
+    });
+    return _parsed ? &_serializedForm : nullptr;
+}
+
+ValuePtr RelayedValue::decode() const
+{
+    return _typeRegistry != nullptr ? decodeRelayedValue(*_typeRegistry, *this) : nullptr;
+}
+
+ValuePtr decodeRelayedValue(TypeRegistry& typeRegistry, const RelayedValue& value)
+{
+    const SerializedValue& serialized = value.serialized();
+    // refers to the buffer of the relayed value, which outlives the message
+    zmq::message_t request(serialized.valueBuffer(), serialized.valueBufferSize(), nullptr);
+    return impl::unpackMessage(
+        typeRegistry,
+        request,
+        serialized.extMemPresent() ? serialized.extMem() : nullptr,
+        serialized.extMemSize());
+}
+
+void sendValue(
+    ValuePtr value,
+    uint64_t seq,
+    const TypeRegistry::TypemapEntry& typeInfo,
+    zmq::socket_t& socket,
+    bool sendMore,
+    bool numericTypeId)
+{
 
     auto extmemHandling = [](ValuePtr& value, zmq::socket_t& socket, bool sendMore, const void* ptr, size_t len)
             {
@@ -148,12 +509,299 @@ void sendValue(ValuePtr value, const TypeRegistry::TypemapEntry& typeInfo, zmq::
 
     impl::sendValueBase(
        value,
+       seq,
        typeInfo,
        socket,
        sendMore,
-       extmemHandling);
+       extmemHandling,
+       numericTypeId);
+}
+
+void sendValue(
+    ValuePtr value,
+    uint64_t seq,
+    const TypeRegistry::TypemapEntry& typeInfo,
+    zmq::socket_t& socket,
+    SerializationCache& cache,
+    bool numericTypeId)
+{
+    zmq::message_t request;
+    const void* ptr = nullptr;
+    size_t len = 0;
+    if (!cache.find(value, request, ptr, len, numericTypeId, seq))
+    {
+        msgpack::sbuffer buffer;
+        msgpack::packer<msgpack::sbuffer> pk(&buffer);
+
+        pk.pack(value->id());
+        impl::packTypeId(pk, typeInfo, numericTypeId);
+
+        TypeRegistry::packValue(buffer, value, typeInfo, ptr, len, true);
+        pk.pack(seq);
+
+        // the cached frame owns the buffer, the sent one shares it
+        const std::size_t size = buffer.size();
+        zmq::message_t packed(buffer.release(), size, impl::freeSbufferData);
+        request.copy(&packed);
+        cache.insert(value, std::move(packed), ptr, len, numericTypeId, seq);
+    }
+    socket.send(request, ptr != NULL ? ZMQ_SNDMORE : 0);
+
+    if (ptr != NULL)
+    {
+        // sent without copying, see sendValue()
+        auto handle = valueKeeper.addValue(value);
+        zmq::message_t memreq(const_cast<void*>(ptr), len, ValueKeeper::zmqFreeFunction, const_cast<void*>(handle));
+        socket.send(memreq, 0);
+    }
+}
+
+bool packBatchEntry(
+    msgpack::sbuffer& buffer,
+    const std::string& topic,
+    ValuePtr value,
+    uint64_t seq,
+    const TypeRegistry::TypemapEntry& typeInfo,
+    bool numericTypeId)
+{
+    static thread_local msgpack::sbuffer valueBuffer;
+    valueBuffer.clear();
+    msgpack::packer<msgpack::sbuffer> pk(&valueBuffer);
+
+    pk.pack(value->id());
+    impl::packTypeId(pk, typeInfo, numericTypeId);
+
+    const void* ptr;
+    size_t len;
+
+    TypeRegistry::packValue(valueBuffer, value, typeInfo, ptr, len, true);
+    if (ptr != NULL) {
+        return false;
+    }
+    pk.pack(seq);
+
+    msgpack::packer<msgpack::sbuffer> batch(&buffer);
+    batch.pack(topic);
+    batch.pack_bin(valueBuffer.size());
+    batch.pack_bin_body(valueBuffer.data(), valueBuffer.size());
+    return true;
+}
+
+bool packBatchEntry(
+    msgpack::sbuffer& buffer,
+    const std::string& topic,
+    const RelayedValue& value,
+    uint64_t seq)
+{
+    const SerializedValue& serialized = value.serialized();
+    if (serialized.extMemPresent()) {
+        return false;
+    }
+
+    // with the sequence number replaced, see sendRelayedValue()
+    static thread_local msgpack::sbuffer valueBuffer;
+    valueBuffer.clear();
+    const bool repacked = impl::packRelayedFrame(value, seq, valueBuffer);
+    const char* data = repacked ? valueBuffer.data() : serialized.valueBuffer();
+    const std::size_t size = repacked ? valueBuffer.size() : serialized.valueBufferSize();
+
+    msgpack::packer<msgpack::sbuffer> batch(&buffer);
+    batch.pack(topic);
+    batch.pack_bin(size);
+    batch.pack_bin_body(data, size);
+    return true;
 }
 
+CompressionResult sendCompressedValue(
+    ValuePtr value,
+    uint64_t seq,
+    const TypeRegistry::TypemapEntry& typeInfo,
+    zmq::socket_t& socket,
+    int level,
+    std::size_t minSize,
+    bool numericTypeId)
+{
+#if HAVE_ZLIB
+    static thread_local msgpack::sbuffer buffer;
+    buffer.clear();
+    msgpack::packer<msgpack::sbuffer> pk(&buffer);
+
+    pk.pack(value->id());
+    impl::packTypeId(pk, typeInfo, numericTypeId);
+
+    const void* ptr;
+    size_t len;
+
+    TypeRegistry::packValue(buffer, value, typeInfo, ptr, len, true);
+    pk.pack(seq);
+
+    std::vector<char> payload;
+    std::vector<char> extMem;
+    const bool payloadCompressed =
+        buffer.size() >= minSize && compressFrame(buffer.data(), buffer.size(), level, payload);
+    const bool extMemCompressed =
+        ptr != NULL && len >= minSize && compressFrame(ptr, len, level, extMem);
+
+    CompressionResult result;
+    result.rawBytes = buffer.size() + (ptr != NULL ? len : 0);
+    result.wireBytes = (payloadCompressed ? payload.size() : buffer.size())
+                     + (ptr != NULL ? (extMemCompressed ? extMem.size() : len) : 0);
+
+    msgpack::sbuffer header;
+    msgpack::pack(header, std::vector<uint64_t>{
+        payloadCompressed ? buffer.size() : 0,
+        extMemCompressed ? len : 0});
+    zmq::message_t headerFrame(header.data(), header.size());
+    socket.send(headerFrame, ZMQ_SNDMORE);
+
+    const int payloadFlags = ptr != NULL ? ZMQ_SNDMORE : 0;
+    if (payloadCompressed)
+    {
+        sendFrameBuffer(socket, std::move(payload), payloadFlags);
+    }
+    else
+    {
+        zmq::message_t request(buffer.data(), buffer.size());
+        socket.send(request, payloadFlags);
+    }
+
+    if (extMemCompressed)
+    {
+        sendFrameBuffer(socket, std::move(extMem), 0);
+    }
+    else if (ptr != NULL)
+    {
+        // sent without copying, see sendValue()
+        auto handle = valueKeeper.addValue(value);
+        zmq::message_t memreq(const_cast<void*>(ptr), len, ValueKeeper::zmqFreeFunction, const_cast<void*>(handle));
+        socket.send(memreq, 0);
+    }
+
+    return result;
+#else
+    MCF_THROW_RUNTIME("Values cannot be compressed. Make sure HAVE_ZLIB is set.");
+#endif
+}
+
+void receiveCompressedMessage(
+    const std::function<void(ZmqMessage&)>& messageHandler,
+    zmq::socket_t& socket)
+{
+    // all frames are received before decompressing, so that none is left on failure
+    zmq::message_t header;
+    zmq::message_t payload;
+    zmq::message_t memreq;
+    if (!socket.recv(&header) || !socket.getsockopt<int>(ZMQ_RCVMORE) || !socket.recv(&payload))
+    {
+        throw ReceiveError("incomplete compressed value");
+    }
+    const bool haveExtMem = socket.getsockopt<int>(ZMQ_RCVMORE) && socket.recv(&memreq);
+
+    const auto sizes = msgpack::unpack(static_cast<const char*>(header.data()), header.size())
+        .get().as<std::vector<uint64_t>>();
+    if (sizes.size() != 2)
+    {
+        throw ReceiveError("invalid header of compressed value");
+    }
+
+    zmq::message_t request;
+    if (sizes[0] > 0)
+    {
+        request.rebuild(sizes[0]);
+        decompressFrame(payload.data(), payload.size(), request.data(), sizes[0]);
+    }
+    else
+    {
+        request = std::move(payload);
+    }
+
+    const void* ptr = nullptr;
+    size_t len = 0;
+    std::shared_ptr<const void> owner = nullptr;
+    if (haveExtMem && sizes[1] > 0)
+    {
+        std::shared_ptr<char> extMem(new char[sizes[1]], std::default_delete<char[]>());
+        decompressFrame(memreq.data(), memreq.size(), extMem.get(), sizes[1]);
+        ptr = extMem.get();
+        len = sizes[1];
+        owner = std::move(extMem);
+    }
+    else if (haveExtMem)
+    {
+        ptr = memreq.data();
+        len = memreq.size();
+    }
+
+    ZmqMessage message{request, ptr, len, owner};
+    messageHandler(message);
+}
+
+std::string packClockResponse(
+    std::chrono::system_clock::time_point pingReceived,
+    std::chrono::system_clock::time_point responseSent)
+{
+    return CLOCK_RESPONSE_PREFIX + std::to_string(toWireTime(pingReceived)) + " " +
+           std::to_string(toWireTime(responseSent)) + " " + TYPE_IDS_ANNOUNCEMENT + " " +
+           EXT_MEM_IMPORT_ANNOUNCEMENT + hostId();
+}
+
+bool unpackClockResponse(
+    const std::string& response,
+    std::chrono::system_clock::time_point& pingReceived,
+    std::chrono::system_clock::time_point& responseSent,
+    bool& numericTypeIds,
+    std::string& extMemImportHost)
+{
+    if (response.compare(0, CLOCK_RESPONSE_PREFIX.size(), CLOCK_RESPONSE_PREFIX) != 0)
+    {
+        return false;
+    }
+
+    const char* begin = response.c_str() + CLOCK_RESPONSE_PREFIX.size();
+    char* end = nullptr;
+    const long long received = std::strtoll(begin, &end, 10);
+    if (end == begin || *end != ' ')
+    {
+        return false;
+    }
+    begin = end + 1;
+    const long long sent = std::strtoll(begin, &end, 10);
+    if (end == begin || (*end != '\0' && *end != ' '))
+    {
+        return false;
+    }
+    // announcements of the peer follow the times, separated by spaces
+    numericTypeIds = std::strstr(end, TYPE_IDS_ANNOUNCEMENT.c_str()) != nullptr;
+    extMemImportHost.clear();
+    const char* host = std::strstr(end, (" " + EXT_MEM_IMPORT_ANNOUNCEMENT).c_str());
+    if (host != nullptr)
+    {
+        host += EXT_MEM_IMPORT_ANNOUNCEMENT.size() + 1;
+        extMemImportHost.assign(host, std::strcspn(host, " "));
+    }
+
+    pingReceived = fromWireTime(received);
+    responseSent = fromWireTime(sent);
+    return true;
+}
+
+const std::string& hostId()
+{
+    static const std::string id = []()
+    {
+        // differs between machines and between boots, unlike the host name
+        std::string bootId;
+        std::ifstream file("/proc/sys/kernel/random/boot_id");
+        if (std::getline(file, bootId) && !bootId.empty())
+        {
+            return bootId;
+        }
+        char name[256] = {};
+        gethostname(name, sizeof(name) - 1);
+        return std::string(name);
+    }();
+    return id;
+}
 
 ValuePtr receiveValue(TypeRegistry& typeRegistry, zmq::socket_t& socket) {
     auto extmemHandling =
@@ -189,11 +837,13 @@ receiveMessage(const std::function<void(ZmqMessage&)>& messageHandler, zmq::sock
 
 void sendValue(
         ValuePtr value,
+        uint64_t seq,
         const TypeRegistry::TypemapEntry& typeInfo,
         zmq::socket_t& socket,
         const std::string& connection,
         ShmemKeeper* shmemKeeper,
-        bool sendMore)
+        bool sendMore,
+        bool numericTypeId)
 {
     auto extmemHandling = [&shmemKeeper, &connection](
         ValuePtr& value,
@@ -202,7 +852,10 @@ void sendValue(
         const void* ptr,
         size_t len)
         {
-            void* shmemPtr = shmemKeeper->createOrGetPartitionPtr(connection, len);
+            // a slot of the connection's ring stays untouched until the receiver released it,
+            // so several values may be in flight at once
+            bip::managed_shared_memory::handle_t handle;
+            void* shmemPtr = shmemKeeper->acquireSlot(connection, len, handle);
             if(!shmemPtr)
             {
                 throw SendError("Could not allocate shared memory to send value");
@@ -212,8 +865,10 @@ void sendValue(
             msgpack::sbuffer buffer;
             msgpack::packer<msgpack::sbuffer> pk(&buffer);
             pk.pack(shmemKeeper->shmemFileName(connection));
-            pk.pack(shmemKeeper->partitionHandle(connection));
+            pk.pack(handle);
             pk.pack(len);
+            // the receiver releases the slot after copying the data
+            pk.pack(true);
             zmq::message_t memreq(buffer.data(), buffer.size());
 
             socket.send(memreq, sendMore ? ZMQ_SNDMORE : 0);
@@ -221,41 +876,46 @@ void sendValue(
 
     impl::sendValueBase(
        value,
+       seq,
        typeInfo,
        socket,
        sendMore,
-       extmemHandling);
+       extmemHandling,
+       numericTypeId);
 }
 
 void
-extMemShmemHandler(ShmemClient* shmemClient, zmq::message_t& memreq, const void*& ptr, size_t& len)
+extMemShmemHandler(
+    ShmemClient* shmemClient,
+    zmq::message_t& memreq,
+    const void*& ptr,
+    size_t& len,
+    std::shared_ptr<const void>& owner)
 {
-    msgpack::unpacker pac;
-    // feeds the buffer.
-    pac.reserve_buffer(memreq.size());
-    memcpy(pac.buffer(), memreq.data(), memreq.size());
-    pac.buffer_consumed(memreq.size());
-    msgpack::object_handle oh;
-    pac.next(oh);
-    std::string shmName = oh.get().as<std::string>();
-    pac.next(oh);
-    bip::managed_shared_memory::handle_t handle
-        = oh.get().as<bip::managed_shared_memory::handle_t>();
+    const char* data = static_cast<const char*>(memreq.data());
+    std::size_t offset = 0;
+    std::string shmName = msgpack::unpack(data, memreq.size(), offset).get().as<std::string>();
+    bip::managed_shared_memory::handle_t handle = msgpack::unpack(data, memreq.size(), offset)
+        .get().as<bip::managed_shared_memory::handle_t>();
     ptr = shmemClient->partitionPtr(shmName, handle);
-    pac.next(oh);
-    len = oh.get().as<size_t>();
+    len = msgpack::unpack(data, memreq.size(), offset).get().as<size_t>();
+    // senders without slot rings do not send the flag
+    if (offset < memreq.size() && msgpack::unpack(data, memreq.size(), offset).get().as<bool>())
+    {
+        // the slot is released once neither the message nor a value refers to it any more
+        owner = shmemClient->slotOwner(ptr);
+    }
 }
 
 ValuePtr receiveValue(TypeRegistry& typeRegistry, zmq::socket_t& socket, ShmemClient* shmemClient) {
-    auto lambda = [&shmemClient](zmq::message_t& memreq, const void*& ptr, size_t& len) {
-        extMemShmemHandler(shmemClient, memreq, ptr, len);
-    };
-
     ValuePtr value;
-    impl::receiveMessageBase<decltype(lambda)>(
-        socket, lambda, [&typeRegistry, &value](ZmqMessage& message) {
-            value = impl::unpackMessage(typeRegistry, message.request, message.extMem, message.extMemSize);
-        });
+    receiveMessage(
+        [&typeRegistry, &value](ZmqMessage& message) {
+            value = impl::unpackMessage(
+                typeRegistry, message.request, message.extMem, message.extMemSize, message.extMemOwner);
+        },
+        socket,
+        shmemClient);
 
     return value;
 }
@@ -266,11 +926,16 @@ receiveMessage(
     zmq::socket_t& socket,
     ShmemClient* shmemClient)
 {
-    auto lambda = [&shmemClient](zmq::message_t& memreq, const void*& ptr, size_t& len) {
-        extMemShmemHandler(shmemClient, memreq, ptr, len);
+    std::shared_ptr<const void> owner;
+    auto lambda = [&shmemClient, &owner](zmq::message_t& memreq, const void*& ptr, size_t& len) {
+        extMemShmemHandler(shmemClient, memreq, ptr, len, owner);
     };
 
-    impl::receiveMessageBase<decltype(lambda)>(socket, lambda, messageHandler);
+    impl::receiveMessageBase<decltype(lambda)>(
+        socket, lambda, [&messageHandler, &owner](ZmqMessage& message) {
+            message.extMemOwner = std::move(owner);
+            messageHandler(message);
+        });
 }
 
 #endif
@@ -3,6 +3,7 @@
  */
 
 #include "mcf_remote/RemoteControl.h"
+#include "mcf_core/ComponentTraceController.h"
 #include "mcf_core/TimestampType.h"
 #include "mcf_core/QueuedEventSource.h"
 #include "mcf_core/ReplayEventController.h"
@@ -10,17 +11,30 @@
 #include "mcf_core/LoggingMacros.h"
 #include "mcf_core/ErrorMacros.h"
 
+#include <algorithm>
+
 namespace mcf {
 
 namespace remote {
 
+constexpr std::chrono::milliseconds RemoteControl::POLL_INTERVAL;
+constexpr std::chrono::milliseconds RemoteControl::RECEIVE_TIMEOUT;
+constexpr size_t RemoteControl::INJECT_BATCH_SIZE;
+
 RemoteControl::RemoteControl(int port, ComponentManager& componentManager, ValueStore& valueStore)
         : Component("RemoteControl"+std::to_string(port)),
         fComponentManager(componentManager),
         fValueStore(valueStore),
         fServerPort(port),
-        fContext(1),
-        fSocket(fContext, ZMQ_REP),
+        fContext(remote::ZmqContext::shared()),
+        fSocket(*fContext, ZMQ_REP),
+        fPublishSocket(*fContext, ZMQ_PUB),
+        fPublishPort(0),
+        fInjectSocket(*fContext, ZMQ_PULL),
+        fInjectPort(0),
+        fInjectQueueLimit(0),
+        fInjected(0),
+        fInjectErrors(0),
         fIsEventQueueEnabled(false)
 {}
 
@@ -32,8 +46,15 @@ RemoteControl::RemoteControl(int port,
         fComponentManager(componentManager),
         fValueStore(valueStore),
         fServerPort(port),
-        fContext(1),
-        fSocket(fContext, ZMQ_REP),
+        fContext(remote::ZmqContext::shared()),
+        fSocket(*fContext, ZMQ_REP),
+        fPublishSocket(*fContext, ZMQ_PUB),
+        fPublishPort(0),
+        fInjectSocket(*fContext, ZMQ_PULL),
+        fInjectPort(0),
+        fInjectQueueLimit(0),
+        fInjected(0),
+        fInjectErrors(0),
         fReplayEventController(std::move(replayEventController)),
         fIsEventQueueEnabled(false)
 {}
@@ -49,13 +70,18 @@ void RemoteControl::startup()
 
 void RemoteControl::shutdown() {
     fSocket.close();
+    fPublishSocket.close();
+    fInjectSocket.close();
 }
 
 void RemoteControl::sendResponse(const msgpack::object& responseObj, bool sendMore) {
     msgpack::sbuffer buffer;
     msgpack::packer<msgpack::sbuffer> pk(&buffer);
     pk.pack(responseObj);
+    sendPackedResponse(buffer, sendMore);
+}
 
+void RemoteControl::sendPackedResponse(const msgpack::sbuffer& buffer, bool sendMore) {
     zmq::message_t response(buffer.data(), buffer.size());
     try {
         fSocket.send(response, sendMore ? ZMQ_SNDMORE : 0);
@@ -84,46 +110,111 @@ void RemoteControl::sendErrorResponse(const std::string& message, msgpack::zone&
 
 
 void RemoteControl::run() {
+    std::chrono::milliseconds timeout = publishSubscriptions();
+
+    zmq_pollitem_t items[2];
+    items[0].socket = fSocket;
+    items[0].events = ZMQ_POLLIN;
+    items[0].revents = 0;
+    int numItems = 1;
+    if (acceptsInjected()) {
+        items[1].socket = fInjectSocket;
+        items[1].events = ZMQ_POLLIN;
+        items[1].revents = 0;
+        numItems = 2;
+    }
+    else if (fInjectPort != 0) {
+        // check again once the event source queue has been drained
+        timeout = std::min(timeout, POLL_INTERVAL);
+    }
+
     zmq::message_t request;
     int len = 0;
     try {
-        len = fSocket.recv(&request);
+        if (zmq_poll(items, numItems, static_cast<long>(timeout.count())) > 0) {
+            if (items[0].revents & ZMQ_POLLIN) {
+                len = fSocket.recv(&request);
+            }
+            if (numItems == 2 && (items[1].revents & ZMQ_POLLIN)) {
+                receiveInjected();
+            }
+        }
     }
     catch (zmq::error_t& e) {
         // TODO: handle EINTR
         MCF_ERROR_NOFILELINE("On receive: {}", e.what());
     }
     if (len > 0) {
-        msgpack::unpacker pac;
+        // decoded in place from the request, which outlives the request object
+        fRequestZone.clear();
+        std::size_t offset = 0;
+        bool referenced = false;
+        msgpack::object requestObj = msgpack::unpack(
+            fRequestZone, static_cast<const char*>(request.data()), request.size(), offset,
+            referenced, &impl::referenceBuffer);
+        processRequest(requestObj);
+    }
+    trigger();
+}
+
+RemoteControl::TopologySnapshot& RemoteControl::topology() {
+    // read first, a change while querying is picked up by the next call
+    const uint64_t generation = fComponentManager.getTopologyGeneration();
+    if (fTopology == nullptr || fTopology->generation != generation) {
+        auto topology = std::make_unique<TopologySnapshot>();
+        topology->generation = generation;
+        for (const auto& c : fComponentManager.getComponents()) {
+            topology->componentIndices[c.id()] = topology->components.size();
+            topology->components.push_back(c);
+            topology->ports.push_back(fComponentManager.getPorts(c));
+            topology->portIndices.emplace_back();
+            for (size_t i = 0; i < topology->ports.back().size(); ++i) {
+                topology->portIndices.back()[topology->ports.back()[i].name()] = i;
+            }
+        }
+        fTopology = std::move(topology);
+    }
+    return *fTopology;
+}
 
-        // feeds the buffer.
-        pac.reserve_buffer(request.size());
-        memcpy(pac.buffer(), request.data(), request.size());
-        pac.buffer_consumed(request.size());
+void RemoteControl::getInfo(msgpack::zone& zone) {
+    TopologySnapshot& topology = this->topology();
 
-        msgpack::object_handle oh;
+    // the connection states are the only part which changes without a new generation
+    std::vector<bool> connected;
+    for (const auto& ports : topology.ports) {
+        for (const auto& p : ports) {
+            connected.push_back(p.isConnected());
+        }
+    }
 
-        pac.next(oh);
-        msgpack::object requestObj = oh.get();
-        processRequest(requestObj);
+    if (topology.info.size() == 0 || connected != topology.connected) {
+        std::map<std::string, msgpack::object> result;
+        result["type"] = msgpack::object("response", zone);
+        result["content"] = commandGetInfo(topology, connected, zone);
+        topology.info.clear();
+        msgpack::pack(topology.info, msgpack::object(result, zone));
+        topology.connected = std::move(connected);
     }
-    trigger();
+    sendPackedResponse(topology.info);
 }
 
-msgpack::object RemoteControl::commandGetInfo(const msgpack::object& request, msgpack::zone& zone) {
-    (void)request;
+msgpack::object RemoteControl::commandGetInfo(
+        const TopologySnapshot& topology, const std::vector<bool>& connected, msgpack::zone& zone) {
     std::vector<msgpack::object> compDescs;
-    for (auto c : fComponentManager.getComponents()) {
+    size_t portNum = 0;
+    for (size_t i = 0; i < topology.components.size(); ++i) {
+        const auto& c = topology.components[i];
         std::map<std::string, msgpack::object> compDesc;
         compDesc["name"] = msgpack::object(c.name(), zone);
         compDesc["id"]   = msgpack::object(c.id(), zone);
         std::vector<msgpack::object> portDescs;
-        for (auto p : fComponentManager.getPorts(c)) {
+        for (const auto& p : topology.ports[i]) {
             std::map<std::string, msgpack::object> portDesc;
             portDesc["topic"] = msgpack::object(p.topic(), zone);
             portDesc["name"]  = msgpack::object(p.name(), zone);
             portDesc["direction"] = msgpack::object(p.direction() == Port::sender ? "sender" : "receiver", zone);
-            portDesc["connected"] = msgpack::object(p.isConnected(), zone);
+            portDesc["connected"] = msgpack::object(static_cast<bool>(connected[portNum++]), zone);
             portDescs.emplace_back(portDesc, zone);
         }
         compDesc["ports"] = msgpack::object(portDescs, zone);
@@ -136,32 +227,48 @@ msgpack::object RemoteControl::commandGetInfo(const msgpack::object& request, ms
 mcf::PortProxy RemoteControl::findPort(
         const msgpack::object& request, msgpack::zone& zone) {
     auto map = request.as<std::map<std::string, msgpack::object>>();
-    if (map.find("component") != map.end()) {
-        if (map.find("port") != map.end()) {
-            auto comps = fComponentManager.getComponents();
-            size_t compIdx = map["component"].as<size_t>();
-            if (compIdx < comps.size()) {
-                auto ports = fComponentManager.getPorts(comps[compIdx]);
-                size_t portIdx = map["port"].as<size_t>();
-                if (portIdx < ports.size()) {
-                    return ports[portIdx];
-                }
-                else {
-                    sendErrorResponse("port not found", zone);
-                }
-            }
-            else {
-                sendErrorResponse("component not found", zone);
-            }
-        }
-        else {
-            sendErrorResponse("no port given", zone);
+    const TopologySnapshot& topology = this->topology();
+
+    size_t compIdx = topology.components.size();
+    if (map.find("component_id") != map.end()) {
+        auto it = topology.componentIndices.find(map["component_id"].as<uint64_t>());
+        if (it != topology.componentIndices.end()) {
+            compIdx = it->second;
         }
     }
+    else if (map.find("component") != map.end()) {
+        compIdx = map["component"].as<size_t>();
+    }
     else {
         sendErrorResponse("no component given", zone);
+        throw std::runtime_error("Could not find port");
+    }
+    if (compIdx >= topology.components.size()) {
+        sendErrorResponse("component not found", zone);
+        throw std::runtime_error("Could not find port");
+    }
+
+    const auto& ports = topology.ports[compIdx];
+    size_t portIdx = ports.size();
+    if (map.find("port_name") != map.end()) {
+        const auto& portIndices = topology.portIndices[compIdx];
+        auto it = portIndices.find(map["port_name"].as<std::string>());
+        if (it != portIndices.end()) {
+            portIdx = it->second;
+        }
+    }
+    else if (map.find("port") != map.end()) {
+        portIdx = map["port"].as<size_t>();
+    }
+    else {
+        sendErrorResponse("no port given", zone);
+        throw std::runtime_error("Could not find port");
     }
-    throw std::runtime_error("Could not find port");
+    if (portIdx >= ports.size()) {
+        sendErrorResponse("port not found", zone);
+        throw std::runtime_error("Could not find port");
+    }
+    return ports[portIdx];
 }
 
 void RemoteControl::connectPort(
@@ -325,12 +432,13 @@ void RemoteControl::readValue(const msgpack::object& request, msgpack::zone& zon
         if (fQueueMap.find(topic) != fQueueMap.end()) {
             auto queue = fQueueMap[topic];
             if (!queue->empty()) {
-                value = queue->pop<Value>();
+                const uint64_t seq = queue->peekSequence();
+                value = decodedValue(queue->pop<Value>());
 
-                auto typeInfoPtr = fValueStore.getTypeInfo(*value);
+                const auto* typeInfoPtr = fValueStore.findTypeInfo(*value);
                 if (typeInfoPtr != nullptr) {
                     sendResponseWithValue(zone, true, "has_more", !queue->empty());
-                    remote::sendValue(value, *typeInfoPtr, fSocket, false);
+                    remote::sendValue(value, seq, *typeInfoPtr, fSocket, false);
                 }
                 else {
                     // could not serialize unknown type
@@ -343,11 +451,11 @@ void RemoteControl::readValue(const msgpack::object& request, msgpack::zone& zon
         }
         else {
             if (fValueStore.hasValue(topic)) {
-                value = fValueStore.getValue<Value>(topic);
-                auto typeInfoPtr = fValueStore.getTypeInfo(*value);
+                value = decodedValue(fValueStore.getValue<Value>(topic));
+                const auto* typeInfoPtr = fValueStore.findTypeInfo(*value);
                 if (typeInfoPtr != nullptr) {
                     sendEmptyResponse(zone, true);
-                    remote::sendValue(value, *typeInfoPtr, fSocket, false);
+                    remote::sendValue(value, 0, *typeInfoPtr, fSocket, false);
                 }
                 else {
                     // could not serialize unknown type
@@ -364,6 +472,261 @@ void RemoteControl::readValue(const msgpack::object& request, msgpack::zone& zon
     }
 }
 
+void RemoteControl::readValues(const msgpack::object& request, msgpack::zone& zone) {
+    auto map = request.as<std::map<std::string, msgpack::object>>();
+
+    if (map.find("topics") != map.end()) {
+        auto topics = map["topics"].as<std::vector<std::string>>();
+
+        // the latest values, queues are left to read_value
+        std::vector<std::pair<ValuePtr, const TypeRegistry::TypemapEntry*>> values;
+        std::vector<bool> found;
+        for (const auto& topic : topics) {
+            ValuePtr value = fValueStore.hasValue(topic) ? decodedValue(fValueStore.getValue<Value>(topic)) : nullptr;
+            const auto* typeInfoPtr = value ? fValueStore.findTypeInfo(*value) : nullptr;
+            if (typeInfoPtr != nullptr) {
+                values.emplace_back(value, typeInfoPtr);
+            }
+            found.push_back(typeInfoPtr != nullptr);
+        }
+
+        sendResponseWithValue(zone, !values.empty(), "found", found);
+        for (size_t i = 0; i < values.size(); ++i) {
+            sendValueFrames(fSocket, values[i].first, *values[i].second, i + 1 < values.size());
+        }
+    }
+    else {
+        sendErrorResponse("no topics given", zone);
+    }
+}
+
+void RemoteControl::sendValueFrames(
+        zmq::socket_t& socket,
+        ValuePtr value,
+        const TypeRegistry::TypemapEntry& typeInfo,
+        bool sendMore) {
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> pk(&buffer);
+    pk.pack(value->id());
+    pk.pack(typeInfo.id);
+
+    const void* ptr = nullptr;
+    size_t len = 0;
+    TypeRegistry::packValue(buffer, value, typeInfo, ptr, len, true);
+
+    zmq::message_t packed(buffer.data(), buffer.size());
+    socket.send(packed, ZMQ_SNDMORE);
+
+    if (ptr != nullptr) {
+        // sent without copying, the value is kept alive until 0MQ has sent the frame
+        auto* keeper = new ValuePtr(std::move(value));
+        zmq::message_t extMem(
+            const_cast<void*>(ptr), len,
+            [](void*, void* hint) { delete static_cast<ValuePtr*>(hint); },
+            keeper);
+        socket.send(extMem, sendMore ? ZMQ_SNDMORE : 0);
+    }
+    else {
+        zmq::message_t extMem;
+        socket.send(extMem, sendMore ? ZMQ_SNDMORE : 0);
+    }
+}
+
+void RemoteControl::publishPort(msgpack::zone& zone) {
+    if (fPublishPort == 0) {
+        try {
+            fPublishSocket.setsockopt(ZMQ_LINGER, 0);
+            remote::ZmqContext::configureSocket(fPublishSocket);
+            fPublishSocket.bind("tcp://*:*");
+
+            char endpoint[256];
+            size_t size = sizeof(endpoint);
+            fPublishSocket.getsockopt(ZMQ_LAST_ENDPOINT, endpoint, &size);
+            const std::string endpointStr(endpoint);
+            fPublishPort = std::stoi(endpointStr.substr(endpointStr.rfind(':') + 1));
+        }
+        catch (std::exception& e) {
+            sendErrorResponse(std::string("cannot bind publish socket: ") + e.what(), zone);
+            return;
+        }
+    }
+    sendResponseWithValue(zone, false, "port", fPublishPort);
+}
+
+void RemoteControl::injectPort(const msgpack::object& request, msgpack::zone& zone) {
+    auto map = request.as<std::map<std::string, msgpack::object>>();
+    if (map.find("max_queued") != map.end()) {
+        fInjectQueueLimit = map["max_queued"].as<size_t>();
+    }
+    if (fInjectPort == 0) {
+        try {
+            fInjectSocket.setsockopt(ZMQ_LINGER, 0);
+            remote::ZmqContext::configureSocket(fInjectSocket);
+            fInjectSocket.bind("tcp://*:*");
+
+            char endpoint[256];
+            size_t size = sizeof(endpoint);
+            fInjectSocket.getsockopt(ZMQ_LAST_ENDPOINT, endpoint, &size);
+            const std::string endpointStr(endpoint);
+            fInjectPort = std::stoi(endpointStr.substr(endpointStr.rfind(':') + 1));
+        }
+        catch (std::exception& e) {
+            sendErrorResponse(std::string("cannot bind inject socket: ") + e.what(), zone);
+            return;
+        }
+    }
+    sendResponseWithValue(zone, false, "port", fInjectPort);
+}
+
+bool RemoteControl::acceptsInjected() const {
+    if (fInjectPort == 0) {
+        return false;
+    }
+    if (fInjectQueueLimit == 0 || !fIsEventQueueEnabled.load()) {
+        return true;
+    }
+    std::size_t queueSize = 0;
+    QueuedEventSource::IntTimestamp firstTime = 0UL;
+    QueuedEventSource::IntTimestamp lastTime = 0UL;
+    fRemoteControlEventSource->getEventQueueInfo(queueSize, firstTime, lastTime);
+    return queueSize < fInjectQueueLimit;
+}
+
+void RemoteControl::receiveInjected() {
+    const bool queueing = fIsEventQueueEnabled.load();
+    fInjectBatch.clear();
+    for (size_t i = 0; i < INJECT_BATCH_SIZE; ++i) {
+        zmq::message_t header;
+        zmq::message_t packedValue;
+        auto extMem = std::make_shared<zmq::message_t>();
+        try {
+            if (!fInjectSocket.recv(&header, ZMQ_DONTWAIT)) {
+                break;
+            }
+            // messages are delivered as a whole, so the remaining frames are there already
+            if (!fInjectSocket.getsockopt<int>(ZMQ_RCVMORE)
+                || !fInjectSocket.recv(&packedValue)
+                || !fInjectSocket.getsockopt<int>(ZMQ_RCVMORE)
+                || !fInjectSocket.recv(extMem.get())) {
+                throw ReceiveError("incomplete message");
+            }
+            while (fInjectSocket.getsockopt<int>(ZMQ_RCVMORE)) {
+                zmq::message_t surplus;
+                fInjectSocket.recv(&surplus);
+            }
+
+            msgpack::object_handle headerHandle = msgpack::unpack(
+                static_cast<const char*>(header.data()), header.size());
+            auto map = headerHandle.get().as<std::map<std::string, msgpack::object>>();
+            if (map.find("topic") == map.end()) {
+                throw ReceiveError("no topic given");
+            }
+            QueuedEventSource::NewEvent event;
+            event.topic = map["topic"].as<std::string>();
+            // the ext mem frame is shared by the value instead of being copied, if its type allows
+            event.value = extMem->size() > 0
+                ? impl::unpackMessage(fValueStore, packedValue, extMem->data(), extMem->size(), extMem)
+                : impl::unpackMessage(fValueStore, packedValue, nullptr, 0);
+
+            auto timeEntry = map.find("timestamp");
+            if (!queueing || timeEntry == map.end()) {
+                fValueStore.setValue(event.topic, event.value);
+            }
+            else {
+                event.timestamp = TimestampType(timeEntry->second.as<QueuedEventSource::IntTimestamp>());
+                if (map.find("component") != map.end()) {
+                    event.component = map["component"].as<std::string>();
+                }
+                if (map.find("port") != map.end()) {
+                    event.port = map["port"].as<std::string>();
+                }
+                fInjectBatch.push_back(std::move(event));
+            }
+            ++fInjected;
+        }
+        catch (std::exception& e) {
+            // the stream has no responses, errors are counted and the first one is logged
+            if (fInjectErrors++ == 0) {
+                MCF_ERROR_NOFILELINE("In RemoteControl receiveInjected: {}", e.what());
+            }
+        }
+    }
+    if (!fInjectBatch.empty()) {
+        fRemoteControlEventSource->pushNewEvents(fInjectBatch);
+    }
+}
+
+void RemoteControl::subscribe(const msgpack::object& request, msgpack::zone& zone) {
+    auto map = request.as<std::map<std::string, msgpack::object>>();
+
+    if (map.find("topic") != map.end()) {
+        double maxRate = 0.;
+        if (map.find("max_rate") != map.end()) {
+            maxRate = map["max_rate"].as<double>();
+        }
+        if (maxRate >= 0.) {
+            Subscription subscription;
+            subscription.minInterval = maxRate > 0.
+                ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>(1. / maxRate))
+                : std::chrono::steady_clock::duration::zero();
+            // (re)subscribing publishes the current value right away
+            subscription.nextDue = std::chrono::steady_clock::now();
+            fSubscriptions[map["topic"].as<std::string>()] = subscription;
+            sendEmptyResponse(zone);
+        }
+        else {
+            sendErrorResponse("negative max_rate", zone);
+        }
+    }
+    else {
+        sendErrorResponse("no topic given", zone);
+    }
+}
+
+void RemoteControl::unsubscribe(const msgpack::object& request, msgpack::zone& zone) {
+    auto map = request.as<std::map<std::string, msgpack::object>>();
+
+    if (map.find("topic") != map.end()) {
+        fSubscriptions.erase(map["topic"].as<std::string>());
+        sendEmptyResponse(zone);
+    }
+    else {
+        sendErrorResponse("no topic given", zone);
+    }
+}
+
+std::chrono::milliseconds RemoteControl::publishSubscriptions() {
+    std::chrono::milliseconds wait = RECEIVE_TIMEOUT;
+    const auto now = std::chrono::steady_clock::now();
+    for (auto& entry : fSubscriptions) {
+        Subscription& subscription = entry.second;
+        if (now >= subscription.nextDue && fValueStore.hasValue(entry.first)) {
+            ValuePtr value = decodedValue(fValueStore.getValue<Value>(entry.first));
+            if (value != subscription.lastValue) {
+                const auto* typeInfoPtr = fValueStore.findTypeInfo(*value);
+                if (typeInfoPtr != nullptr) {
+                    try {
+                        // dropped by 0MQ instead of blocking if the subscribers do not keep up
+                        zmq::message_t topic(entry.first.data(), entry.first.size());
+                        fPublishSocket.send(topic, ZMQ_SNDMORE);
+                        sendValueFrames(fPublishSocket, value, *typeInfoPtr, false);
+                    }
+                    catch (zmq::error_t& e) {
+                        MCF_ERROR_NOFILELINE("On publish of {}: {}", entry.first, e.what());
+                    }
+                }
+                subscription.lastValue = value;
+                subscription.nextDue = now + subscription.minInterval;
+            }
+        }
+        const auto due = std::chrono::duration_cast<std::chrono::milliseconds>(
+            subscription.nextDue - now);
+        wait = std::min(wait, std::max(due, POLL_INTERVAL));
+    }
+    return wait;
+}
+
 void RemoteControl::processRequest(const msgpack::object& request) {
     msgpack::zone zone;
     std::map<std::string, msgpack::object> result;
@@ -372,9 +735,7 @@ void RemoteControl::processRequest(const msgpack::object& request) {
         if (map.find("command") != map.end()) {
             auto cmd = map.at("command").as<std::string>();
             if (cmd == "get_info") {
-                result["type"] = msgpack::object("response", zone);
-                result["content"] = commandGetInfo(request, zone);
-                sendResponse(msgpack::object(result, zone));
+                getInfo(zone);
             }
             else if (cmd == "connect_port") {
                 connectPort(request, zone, true);
@@ -385,6 +746,21 @@ void RemoteControl::processRequest(const msgpack::object& request) {
             else if (cmd == "read_value") {
                 readValue(request, zone);
             }
+            else if (cmd == "read_values") {
+                readValues(request, zone);
+            }
+            else if (cmd == "publish_port") {
+                publishPort(zone);
+            }
+            else if (cmd == "inject_port") {
+                injectPort(request, zone);
+            }
+            else if (cmd == "subscribe") {
+                subscribe(request, zone);
+            }
+            else if (cmd == "unsubscribe") {
+                unsubscribe(request, zone);
+            }
             else if (cmd == "write_value") {
                 writeValue(request, zone);
             }
@@ -417,6 +793,22 @@ void RemoteControl::processRequest(const msgpack::object& request) {
             {
                 getSimTime(zone);
             }
+            else if (cmd == "seek")
+            {
+                seekReplay(request, zone);
+            }
+            else if (cmd == "value_store_stats")
+            {
+                getValueStoreStats(zone);
+            }
+            else if (cmd == "get_trace_filter")
+            {
+                getTraceFilter(zone);
+            }
+            else if (cmd == "set_trace_filter")
+            {
+                setTraceFilter(request, zone);
+            }
             else if (cmd == "get_port_blocking") {
                 getPortBlocking(request, zone);
             }
@@ -511,6 +903,8 @@ msgpack::object RemoteControl::commandEventQueueInfo(msgpack::zone& zone)
     queueState["enabled"] = msgpack::object(fIsEventQueueEnabled.load(), zone);
     queueState["first_time"] = msgpack::object(firstTime, zone);
     queueState["last_time"] = msgpack::object(lastTime, zone);
+    queueState["injected"] = msgpack::object(fInjected, zone);
+    queueState["inject_errors"] = msgpack::object(fInjectErrors, zone);
 
     return { queueState, zone };
 }
@@ -648,6 +1042,17 @@ void RemoteControl::setReplayParams(const msgpack::object& request, msgpack::zon
                             if (map.find("step_time_microseconds") != map.end()) {
                                 params.stepTimeMicroSeconds = map["step_time_microseconds"].as<uint64_t>();
 
+                                // optional, clients not knowing it replay throttled
+                                if (map.find("unthrottled") != map.end()) {
+                                    params.unthrottled = map["unthrottled"].as<bool>();
+                                }
+                                if (map.find("deterministic") != map.end()) {
+                                    params.deterministic = map["deterministic"].as<bool>();
+                                }
+                                if (map.find("lookahead_microseconds") != map.end()) {
+                                    params.lookaheadMicroSeconds = map["lookahead_microseconds"].as<uint64_t>();
+                                }
+
                                 fReplayEventController->setParams(params);
                                 sendEmptyResponse(zone);
                             }
@@ -698,6 +1103,9 @@ void RemoteControl::getReplayParams(msgpack::zone& zone)
     replayParams["wait_input_event_name"] = msgpack::object(params.waitInputEventName, zone);
     replayParams["wait_input_event_topic"] = msgpack::object(params.waitInputTopicName, zone);
     replayParams["step_time_microseconds"] = msgpack::object(params.stepTimeMicroSeconds, zone);
+    replayParams["unthrottled"] = msgpack::object(params.unthrottled, zone);
+    replayParams["deterministic"] = msgpack::object(params.deterministic, zone);
+    replayParams["lookahead_microseconds"] = msgpack::object(params.lookaheadMicroSeconds, zone);
 
     std::map<std::string, msgpack::object> result;
     result["type"] = msgpack::object("response", zone);
@@ -726,6 +1134,15 @@ void RemoteControl::getSimTime(msgpack::zone& zone)
     std::map<std::string, msgpack::object> simTimeMsgPack;
     simTimeMsgPack["is_initialised"] = msgpack::object(isInitialised, zone);
     simTimeMsgPack["sim_time"] = msgpack::object(simTimeInt, zone);
+    simTimeMsgPack["achieved_speedup"] = msgpack::object(fReplayEventController->getAchievedSpeedup(), zone);
+
+    const auto stepLatency = fReplayEventController->getStepLatency();
+    std::map<std::string, msgpack::object> stepLatencyMsgPack;
+    stepLatencyMsgPack["count"] = msgpack::object(stepLatency.count, zone);
+    stepLatencyMsgPack["p50_ns"] = msgpack::object(stepLatency.p50, zone);
+    stepLatencyMsgPack["p99_ns"] = msgpack::object(stepLatency.p99, zone);
+    stepLatencyMsgPack["max_ns"] = msgpack::object(stepLatency.max, zone);
+    simTimeMsgPack["step_latency"] = msgpack::object(stepLatencyMsgPack, zone);
 
     std::map<std::string, msgpack::object> result;
     result["type"] = msgpack::object("response", zone);
@@ -733,6 +1150,148 @@ void RemoteControl::getSimTime(msgpack::zone& zone)
     sendResponse(msgpack::object(result, zone));
 }
 
+void RemoteControl::seekReplay(const msgpack::object& request, msgpack::zone& zone)
+{
+    if(!fReplayEventController)
+    {
+        sendErrorResponse("no ReplayEventController", zone);
+        return;
+    }
+
+    auto map = request.as<std::map<std::string, msgpack::object>>();
+
+    if (map.find("time") == map.end()) {
+        sendErrorResponse("no time given", zone);
+        return;
+    }
+    const TimestampType time(map["time"].as<uint64_t>());
+
+    std::chrono::microseconds preRoll(0);
+    if (map.find("pre_roll_microseconds") != map.end()) {
+        preRoll = std::chrono::microseconds(map["pre_roll_microseconds"].as<uint64_t>());
+    }
+
+    if (fReplayEventController->seek(time, preRoll)) {
+        sendEmptyResponse(zone);
+    }
+    else {
+        sendErrorResponse("cannot seek", zone);
+    }
+}
+
+void RemoteControl::getValueStoreStats(msgpack::zone& zone)
+{
+    std::vector<msgpack::object> topics;
+    for (const auto& topicStats : fValueStore.getStatistics())
+    {
+        std::map<std::string, msgpack::object> entry;
+        entry["topic"] = msgpack::object(topicStats.topic, zone);
+        entry["writes"] = msgpack::object(topicStats.writes, zone);
+        entry["lock_wait_p50_ns"] = msgpack::object(topicStats.lockWaitP50Ns, zone);
+        entry["lock_wait_p99_ns"] = msgpack::object(topicStats.lockWaitP99Ns, zone);
+        entry["fan_out_p50_ns"] = msgpack::object(topicStats.fanOutP50Ns, zone);
+        entry["fan_out_p99_ns"] = msgpack::object(topicStats.fanOutP99Ns, zone);
+        entry["receivers"] = msgpack::object(topicStats.receivers, zone);
+        entry["blocked_writes"] = msgpack::object(topicStats.blockedWrites, zone);
+        entry["blocked_time_ns"] = msgpack::object(topicStats.blockedTimeNs, zone);
+        topics.push_back(msgpack::object(entry, zone));
+    }
+
+    std::map<std::string, msgpack::object> content;
+    content["enabled"] = msgpack::object(fValueStore.statisticsEnabled(), zone);
+    content["topics"] = msgpack::object(topics, zone);
+
+    std::map<std::string, msgpack::object> result;
+    result["type"] = msgpack::object("response", zone);
+    result["content"] = msgpack::object(content, zone);
+    sendResponse(msgpack::object(result, zone));
+}
+
+void RemoteControl::getTraceFilter(msgpack::zone& zone)
+{
+    ComponentTraceController* controller = fComponentManager.getComponentTraceController();
+    if (controller == nullptr)
+    {
+        sendErrorResponse("no component trace controller", zone);
+        return;
+    }
+
+    std::vector<msgpack::object> rules;
+    for (const auto& rule : controller->getTraceFilter())
+    {
+        std::map<std::string, msgpack::object> entry;
+        entry["component"] = msgpack::object(rule.component, zone);
+        entry["topic"] = msgpack::object(rule.topic, zone);
+        entry["events"] = msgpack::object(traceEventTypeNames(rule.eventTypes), zone);
+        entry["sampling"] = msgpack::object(rule.sampling, zone);
+        rules.push_back(msgpack::object(entry, zone));
+    }
+
+    std::map<std::string, msgpack::object> content;
+    content["enabled"] = msgpack::object(controller->isTraceEnabled(), zone);
+    content["rules"] = msgpack::object(rules, zone);
+
+    std::map<std::string, msgpack::object> result;
+    result["type"] = msgpack::object("response", zone);
+    result["content"] = msgpack::object(content, zone);
+    sendResponse(msgpack::object(result, zone));
+}
+
+void RemoteControl::setTraceFilter(const msgpack::object& request, msgpack::zone& zone)
+{
+    ComponentTraceController* controller = fComponentManager.getComponentTraceController();
+    if (controller == nullptr)
+    {
+        sendErrorResponse("no component trace controller", zone);
+        return;
+    }
+
+    auto map = request.as<std::map<std::string, msgpack::object>>();
+    try
+    {
+        if (map.find("rules") != map.end())
+        {
+            std::vector<TraceFilterRule> rules;
+            for (const auto& entry : map["rules"].as<std::vector<std::map<std::string, msgpack::object>>>())
+            {
+                TraceFilterRule rule;
+                auto it = entry.find("component");
+                if (it != entry.end())
+                {
+                    rule.component = it->second.as<std::string>();
+                }
+                it = entry.find("topic");
+                if (it != entry.end())
+                {
+                    rule.topic = it->second.as<std::string>();
+                }
+                it = entry.find("events");
+                if (it != entry.end())
+                {
+                    rule.eventTypes = traceEventTypeMask(it->second.as<std::vector<std::string>>());
+                }
+                it = entry.find("sampling");
+                if (it != entry.end())
+                {
+                    rule.sampling = std::max(1u, it->second.as<uint32_t>());
+                }
+                rules.push_back(std::move(rule));
+            }
+            controller->setTraceFilter(std::move(rules));
+        }
+        if (map.find("enabled") != map.end())
+        {
+            controller->enableTrace(map["enabled"].as<bool>());
+        }
+    }
+    catch (const std::exception& e)
+    {
+        sendErrorResponse(std::string("invalid trace filter: ") + e.what(), zone);
+        return;
+    }
+    sendEmptyResponse(zone);
+}
+
 } // end namespace remote
 
 } // end namespace mcf
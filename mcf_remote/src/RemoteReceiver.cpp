@@ -4,6 +4,8 @@
 
 #include "mcf_remote/RemoteReceiver.h"
 #include "mcf_remote/Remote.h"
+#include "mcf_remote/ZmqContext.h"
+#include "mcf_core/PerfScope.h"
 
 namespace mcf {
 
@@ -15,18 +17,13 @@ RemoteReceiver::RemoteReceiver(
         std::shared_ptr<remote::ShmemClient> shmemClient) :
     mcf::Component("RemoteReceiver"+receiver),
     fValueStore(valueStore),
-    fContext(1),
-    fSocket(fContext, ZMQ_REP)
+    fContext(ZmqContext::shared()),
+    fSocket(*fContext, ZMQ_REP)
 #ifdef HAVE_SHMEM
     , fShmemClient(shmemClient)
 #endif
 {
     parseTarget(receiver);
-
-#if PROFILING
-    _logger = spdlog::basic_logger_mt(getName(), "logs/remoteReceiver.log", true);
-    _logger->set_level(spdlog::level::trace);
-#endif
 }
 
 void RemoteReceiver::configure(IComponentConfig& config) {
@@ -40,6 +37,7 @@ void RemoteReceiver::startup() {
     trigger();
     int timeout = 100;  // in milliseconds
     fSocket.setsockopt(ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+    ZmqContext::configureSocket(fSocket);
     fSocket.bind(fServerPort);
 }
 
@@ -53,15 +51,15 @@ void RemoteReceiver::run() {
         MCF_WARN_NOFILELINE("in RemoteReceiver recv: {}", e.what());
     }
     if (success) {
-        PerfLogger startReceiving("startReceiving", _logger);
+        MCF_PERF_SCOPE("RemoteReceiver::receive");
 
         auto oh = msgpack::unpack((const char *)request.data(), request.size());
         auto topic = oh.get().as<std::string>();
 
-        PerfLogger startUnpacking("startUnpacking", _logger);
         // TODO: check if there is another message part
         ValuePtr value = nullptr;
         try {
+            MCF_PERF_SCOPE("RemoteReceiver::unpack");
             if(fShmConnection.empty())
             {
                 value = remote::receiveValue(fValueStore, fSocket);
@@ -87,8 +85,6 @@ void RemoteReceiver::run() {
         catch (remote::ReceiveError& e) {
             MCF_ERROR_NOFILELINE("In RemoteReceiver receiveValue: receive error: {}", e.what());
         }
-        PerfLogger doneUnpacking("doneUnpacking", value->id(), topic, _logger);
-
         zmq::message_t memresp;
         try {
             fSocket.send(memresp);
@@ -101,11 +97,6 @@ void RemoteReceiver::run() {
                 fRoutingMap.at(topic)->setValue(value);
             }
         }
-
-        PerfLogger doneReceiving("doneReceiving", value->id(), topic, _logger);
-
-        startReceiving.setData(value->id(), topic);
-        startUnpacking.setData(value->id(), topic);
     }
     trigger();
 }
@@ -4,6 +4,8 @@
 
 #include "mcf_remote/RemoteSender.h"
 #include "mcf_remote/Remote.h"
+#include "mcf_remote/ZmqContext.h"
+#include "mcf_core/PerfScope.h"
 
 #include <regex>
 #include <random>
@@ -15,15 +17,11 @@ namespace remote {
 RemoteSender::RemoteSender(ValueStore& valueStore, std::shared_ptr<remote::ShmemKeeper> shmemKeeper) :
     mcf::Component("RemoteSender"),
     fValueStore(valueStore),
-    fContext(1)
+    fContext(ZmqContext::shared())
 #ifdef HAVE_SHMEM
     , fShmemKeeper(shmemKeeper)
 #endif
 {
-#if PROFILING
-    _logger = spdlog::basic_logger_mt(getName(), "logs/remoteSender.log", true);
-    _logger->set_level(spdlog::level::trace);
-#endif
 }
 
 void RemoteSender::configure(mcf::IComponentConfig& config) {
@@ -38,21 +36,19 @@ void RemoteSender::route(const std::string& topic) {
         auto& me = fRoutingMap.at(topic);
 
         while (me.port->hasValue()) {
-            auto value = me.port->getValue();
+            const uint64_t seq = me.port->peekSequence();
+            auto value = decodedValue(me.port->getValue());
 
-            PerfLogger startSending("startSending", value->id(), topic, _logger);
+            MCF_PERF_SCOPE("RemoteSender::send");
 
-            auto typeInfoPtr = fValueStore.getTypeInfo(*value);
+            const auto* typeInfoPtr = fValueStore.findTypeInfo(*value);
             if (typeInfoPtr != nullptr) {
 
-                // if the value is sent over multiple sockets, only
-                // the times of the last socket will be recorded
-                PerfLogger startPacking("startPacking", value->id(), topic, _logger);
-                PerfLogger donePacking("donePacking", value->id(), topic, _logger);
                 for (auto socket : me.sockets) {
+                    // packing, sending and the acknowledgement of the receiver
+                    MCF_PERF_SCOPE("RemoteSender::sendToSocket");
                     auto sockPtr = socket.first;
                     std::string shmemConnection = socket.second;
-                    startPacking.tick();
 
                     msgpack::sbuffer buffer;
                     msgpack::packer<msgpack::sbuffer> pk(&buffer);
@@ -63,7 +59,7 @@ void RemoteSender::route(const std::string& topic) {
 
                     if(shmemConnection.empty())
                     {
-                        remote::sendValue(value, *typeInfoPtr, *sockPtr);
+                        remote::sendValue(value, seq, *typeInfoPtr, *sockPtr);
                     }
                     else
                     {
@@ -79,12 +75,10 @@ void RemoteSender::route(const std::string& topic) {
                             continue;
                         }
 #ifdef HAVE_SHMEM
-                        remote::sendValue(value, *typeInfoPtr, *sockPtr, shmemConnection, fShmemKeeper.get());
+                        remote::sendValue(value, seq, *typeInfoPtr, *sockPtr, shmemConnection, fShmemKeeper.get());
 #endif
                     }
 
-                    donePacking.tick();
-
                     zmq::message_t resp;
                     sockPtr->recv(&resp);
                 }
@@ -92,8 +86,6 @@ void RemoteSender::route(const std::string& topic) {
             else {
                 MCF_ERROR_NOFILELINE("in RemoteSender route: can't serialize unknown type for topic: {}", topic);
             }
-
-            PerfLogger doneSending("doneSending", value->id(), topic, _logger);
         }
     }
     catch (const std::out_of_range& e) {
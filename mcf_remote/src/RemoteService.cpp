@@ -3,10 +3,13 @@
  */
 #include "mcf_remote/RemoteService.h"
 #include "mcf_core/ThreadName.h"
+#include "mcf_core/ThreadAffinity.h"
 
 #include "mcf_core/ErrorMacros.h"
 
+#include <algorithm>
 #include <chrono>
+#include <thread>
 
 namespace mcf {
 
@@ -23,6 +26,15 @@ void joinAndDelete(std::thread* t)
         delete t;
     }
 };
+
+// while several received topics are blocked, only the first one is waited for, the others are
+// retried at this interval
+constexpr std::chrono::milliseconds PENDING_RETRY_INTERVAL{10};
+
+// longest time the sending thread sleeps at once while the flow control holds back a value, so
+// that it keeps handling the other events of the connection
+constexpr std::chrono::milliseconds MAX_SHAPING_WAIT{10};
+
 } // anonymous namespace;
 
 // prefix to Component's name
@@ -38,24 +50,31 @@ RemoteService::RemoteService(
 {
 }
 
-RemoteService::~RemoteService() = default;
+RemoteService::~RemoteService()
+{
+    stopTriggerCyclic();
+}
 
 
 void RemoteService::addSendRule(
     const std::string& topic,
     const size_t queueLength,
     const bool blocking,
-    const uint8_t prio)
+    const uint8_t prio,
+    const size_t window,
+    const AbstractSender::Compression& compression)
 {
-    addSendRule(topic, topic, queueLength, blocking, prio);
+    addSendRule(topic, topic, queueLength, blocking, prio, window, compression);
 }
 
 void RemoteService::addSendRule(
     const std::string& topicLocal,
     const std::string& topicRemote,
-    const size_t queueLength,
-    const bool blocking,
-    const uint8_t prio)
+    size_t queueLength,
+    bool blocking,
+    uint8_t prio,
+    const size_t window,
+    const AbstractSender::Compression& compression)
 {
     // send only once, even if send rule is specified multiple times
     if(_sendRules.find(topicRemote) != _sendRules.end())
@@ -67,6 +86,15 @@ void RemoteService::addSendRule(
         );
     }
 
+    // the QoS profile of the topic replaces the settings of the rule, see TopicQos
+    const auto profile = _valueStore.getTopicQos().find(topicLocal);
+    if(profile != nullptr)
+    {
+        queueLength = profile->depth;
+        blocking = profile->reliability == QosProfile::Reliability::RELIABLE;
+        prio = profile->priority;
+    }
+
     //TODO Find a way to avoid using QueuedReceiverPort<Value> here
     //     Ideally, GenericQueuedReceiverPort (now abstract) should be used directly
     std::unique_ptr<GenericQueuedReceiverPort> port = std::make_unique<QueuedReceiverPort<Value>>(
@@ -80,9 +108,42 @@ void RemoteService::addSendRule(
         queueLength,
         prio,
         blocking,
+        std::max<size_t>(window, 1),
         SendState(),
         std::move(port)
     };
+
+    // lanes are kept in descending priority
+    auto lane = std::find_if(_sendLanes.begin(), _sendLanes.end(),
+        [prio](const SendLane& l) { return l.prio <= prio; });
+    if(lane == _sendLanes.end() || lane->prio != prio)
+    {
+        lane = _sendLanes.insert(lane, SendLane{prio, {}});
+    }
+    lane->rules.push_back(&*_sendRules.find(topicRemote));
+
+    if(compression.level > 0)
+    {
+        _transceiver.setCompression(topicRemote, compression);
+    }
+}
+
+void RemoteService::setAdaptiveQueueLength(
+    const std::string& topicRemote,
+    const ValueQueue::AdaptiveLength& adaptive)
+{
+    auto rule = _sendRules.find(topicRemote);
+    if(rule == _sendRules.end())
+    {
+        MCF_THROW_RUNTIME(fmt::format("No send rule for remote topic '{}' defined for {}", topicRemote, getName()));
+    }
+    rule->second.port->setAdaptiveQueueLength(adaptive);
+}
+
+void RemoteService::setBatching(const size_t maxValues, const size_t maxBytes)
+{
+    _maxBatchValues = maxValues;
+    _maxBatchBytes = maxBytes;
 }
 
 void RemoteService::addReceiveRule(const std::string& topic)
@@ -116,6 +177,13 @@ void RemoteService::addReceiveRule(const std::string& topicLocal, const std::str
     };
 }
 
+void RemoteService::addRelayRule(const std::string& topicLocal, const std::string& topicRemote)
+{
+    addReceiveRule(topicLocal, topicRemote);
+    _relayTopics.insert(topicRemote);
+    _transceiver.setRelayTopics(_relayTopics);
+}
+
 void RemoteService::configure(IComponentConfig& config)
 {
     for (auto& sendRule : _sendRules) {
@@ -124,6 +192,12 @@ void RemoteService::configure(IComponentConfig& config)
     }
     for (auto& receiveRule : _receiveRules) {
         config.registerPort(*receiveRule.second.port, receiveRule.second.topic);
+        if (_announceSubscriptions) {
+            receiveRule.second.port->setSubscriptionCallback([this](bool) {
+                _subscriptionsChanged = true;
+                trigger();
+            });
+        }
     }
 
     registerTriggerHandler([this] { handleTriggers(); });
@@ -139,10 +213,16 @@ void RemoteService::startup()
 
     _transceiver.connectSender();
 
-    _triggerCyclicThread =
-            std::unique_ptr<std::thread, std::function<void (std::thread *)>>(
-                    new std::thread(&RemoteService::triggerCyclic, this),
-                    joinAndDelete);
+    startSendWorkers(ComponentTraceEventGenerator::getLocalInstance());
+
+    // state changes are handled right away, not with the next ping interval
+    _transceiver.setEventObserver([this] { if(getState() == RUNNING) trigger(); });
+    {
+        std::lock_guard<std::mutex> lck(_mtxCyclic);
+        _triggerCyclicActive = true;
+        _triggerCyclicTimer = TimerWheel::instance().scheduleAfter(
+            std::chrono::milliseconds(0), [this] { triggerCyclic(); });
+    }
 
     _receivingThread =
             std::unique_ptr<std::thread, std::function<void (std::thread *)>>(
@@ -168,13 +248,195 @@ void RemoteService::startup()
 
 void RemoteService::shutdown()
 {
+    // all threads are woken before waiting for any of them, so that they finish in parallel
     std::unique_lock<std::mutex> lock(_mtxReceive);
-    _cvar_pendR.notify_all(); // wake up sleeping threads
+    wakePendingValues();
+    lock.unlock();
+    wakeSendWorkers();
+
+    stopTriggerCyclic();
+
+    // the workers use the senders until they have stopped
+    stopSendWorkers();
 
     _transceiver.disconnectSender();
 }
 
+void RemoteService::startSendWorkers(const std::shared_ptr<ComponentTraceEventGenerator>& eventGenerator)
+{
+    _sendWorkers.clear();
+
+    const size_t workers = _transceiver.sendWorkers();
+    if(workers == 0) return;
+    if(_transceiver.supportsPipelining() || _maxBatchValues > 0)
+    {
+        MCF_WARN_NOFILELINE(
+            "{}: send workers are not used with pipelining or batching", getName());
+        return;
+    }
+
+    for(size_t i = 0; i < workers; ++i)
+    {
+        _sendWorkers.push_back(std::make_unique<SendWorker>());
+    }
+
+    // deal the rules in priority order, so that every worker gets a share of each lane
+    size_t next = 0;
+    for(auto& lane : _sendLanes)
+    {
+        for(auto* sendRule : lane.rules)
+        {
+            _sendWorkers[next]->rules.push_back(sendRule);
+            next = (next + 1) % workers;
+        }
+    }
+
+    for(size_t i = 0; i < workers; ++i)
+    {
+        _sendWorkers[i]->thread =
+                std::unique_ptr<std::thread, std::function<void (std::thread *)>>(
+                        new std::thread(&RemoteService::runSendWorker, this, i, eventGenerator),
+                        joinAndDelete);
+    }
+}
+
+void RemoteService::stopSendWorkers()
+{
+    wakeSendWorkers();
+    for(auto& worker : _sendWorkers)
+    {
+        worker->thread.reset();
+    }
+}
+
+void RemoteService::wakeSendWorkers()
+{
+    for(auto& worker : _sendWorkers)
+    {
+        std::lock_guard<std::mutex> lock(worker->mtx);
+        worker->wake = true;
+        worker->cvar.notify_one();
+    }
+}
+
+void RemoteService::runSendWorker(
+    const size_t index,
+    const std::shared_ptr<ComponentTraceEventGenerator>& eventGenerator)
+{
+    setThreadName(fmt::format("RW{}", index));
+    ComponentTraceController::setLocalEventGenerator(eventGenerator);
+
+    waitRunning();
+
+    SendWorker& worker = *_sendWorkers[index];
+    while(getState() == RUNNING)
+    {
+        {
+            std::unique_lock<std::mutex> lock(worker.mtx);
+            worker.cvar.wait(lock, [this, &worker] { return worker.wake || getState() != RUNNING; });
+            worker.wake = false;
+        }
+
+        while(getState() == RUNNING && handleSendWorker(index))
+        {
+        }
+    }
+}
+
+bool RemoteService::handleSendWorker(const size_t index)
+{
+    bool moreValuesToSend = false;
+    for(auto* sendRule : _sendWorkers[index]->rules)
+    {
+        // check remote state and send only in STATE_UP
+        if(!_transceiver.connected())
+        {
+            return false;
+        }
+
+        const std::string& topic = sendRule->first;
+        SendRule& rule = sendRule->second;
+
+        // take the value under the lock, but send it without, so that the workers send in parallel
+        ValuePtr value;
+        // values sent by force are not written anew, so they have no sequence number
+        uint64_t seq = 0;
+        bool queued = false;
+        std::chrono::steady_clock::duration shapingWait;
+        {
+            std::lock_guard<std::mutex> lck(_mtxSend);
+            if(rule.state.sendPending || rule.state.paused) continue;
+
+            if(rule.port->hasValue())
+            {
+                if(decimateValue(rule, laneIndex(rule.prio)))
+                {
+                    moreValuesToSend = true;
+                    continue;
+                }
+                value = rule.port->peekValue();
+                seq = rule.port->peekSequence();
+                queued = true;
+            }
+            else if(rule.state.forcedSend)
+            {
+                value = _valueStore.getValue<Value>(rule.topic);
+                if(value->id() == 0)
+                {
+                    rule.state.forcedSend = false;
+                    continue;
+                }
+            }
+            else
+            {
+                continue;
+            }
+        }
+
+        if(!shapeValue(value, shapingWait))
+        {
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(shapingWait, MAX_SHAPING_WAIT));
+            moreValuesToSend = true;
+            continue;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        const std::string result = _transceiver.sendValue(index, topic, value, seq);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        traceDataTransferDuration(start, end,
+                fmt::format("{} value on {}->{}: {}", queued ? "send" : "forced send",
+                            rule.topic, topic, result));
+        valueAcked(value, end - start, result);
+
+        std::lock_guard<std::mutex> lck(_mtxSend);
+        if(result == "INJECTED" || result == "RECEIVED" || result == "REJECTED")
+        {
+            if(queued)
+            {
+                rule.port->getValue();
+            }
+            rule.state.forcedSend = false;
+            if(result == "RECEIVED")
+            {
+                rule.state.sendPending = true;
+            }
+        }
+        if(!rule.state.sendPending && (rule.state.forcedSend || rule.port->hasValue()))
+        {
+            moreValuesToSend = true;
+        }
+    }
+    return moreValuesToSend;
+}
+
 std::string RemoteService::valueReceived(const std::string& topic, ValuePtr value)
+{
+    return valueReceived(topic, std::move(value), 0);
+}
+
+std::string RemoteService::valueReceived(const std::string& topic, ValuePtr value, uint64_t seq)
 {
     if(!_initialized) return "REJECTED";
 
@@ -194,13 +456,15 @@ std::string RemoteService::valueReceived(const std::string& topic, ValuePtr valu
 
     auto& port = receiveRule.port;
 
-    int inserted = port->setValue(value, false);
+    // gaps in the numbering of the remote side are passed on to the local receivers
+    int inserted = port->injectValue(value, ValueOrigin{this, seq}, false);
 
     if(inserted == EAGAIN)
     {
         // ValueStore: port is blocked => store value and inform pending value handler thread
         receiveRule.state.pendingValue = value;
-        _cvar_pendR.notify_all();
+        receiveRule.state.pendingSeq = seq;
+        wakePendingValues();
         return "RECEIVED";
     }
 
@@ -253,21 +517,52 @@ void RemoteService::setThreadName(const std::string& threadNamePrefix)
     mcf::setThreadName(threadName);
 }
 
-void RemoteService::triggerCyclic()
+void RemoteService::pinHelperThread(const std::string& threadName)
 {
-    auto state = getState();
-    while(state == INIT || state == STARTING_UP || state == STARTED)
+    const CpuMask cpuAffinity = _helperCpuAffinity;
+    int result = setThreadCpuAffinity(pthread_self(), cpuAffinity);
+    if (result != 0)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        state = getState();
+        MCF_ERROR_NOFILELINE(
+            "Could not set CPU affinity {} of {} {}, error: {}",
+            formatCpuMask(cpuAffinity),
+            getName(),
+            threadName,
+            strerror(result));
     }
+    MCF_INFO_NOFILELINE(
+        "{} {} running on CPUs {}",
+        getName(),
+        threadName,
+        formatCpuMask(getThreadCpuAffinity(pthread_self())));
+}
 
-    while(getState() == RUNNING)
+void RemoteService::triggerCyclic()
+{
+    std::lock_guard<std::mutex> lck(_mtxCyclic);
+    if(!_triggerCyclicActive) return;
+
+    // before running, the first ping is sent with the next interval
+    if(getState() == RUNNING)
     {
         trigger();
+    }
+    _triggerCyclicTimer = TimerWheel::instance().scheduleAfter(
+        _transceiver.pingInterval(), [this] { triggerCyclic(); });
+}
 
-        _transceiver.waitForEvent();
+void RemoteService::stopTriggerCyclic()
+{
+    TimerWheel::TimerId timer;
+    {
+        std::lock_guard<std::mutex> lck(_mtxCyclic);
+        _triggerCyclicActive = false;
+        timer = _triggerCyclicTimer;
+        _triggerCyclicTimer = TimerWheel::INVALID_TIMER;
     }
+    // a running callback returns without rescheduling
+    TimerWheel::instance().cancel(timer);
+    _transceiver.setEventObserver(nullptr);
 }
 
 void RemoteService::receive(
@@ -298,17 +593,13 @@ void RemoteService::receive(
     }
 
     setThreadName("RR");
+    pinHelperThread("receiver");
     ComponentTraceController::setLocalEventGenerator(eventGenerator);
 
     // connect receiver
     _transceiver.connectReceiver(this);
 
-    auto state = getState();
-    while(state == INIT || state == STARTING_UP || state == STARTED)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        state = getState();
-    }
+    waitRunning();
 
     while(getState() == RUNNING)
     {
@@ -323,15 +614,120 @@ void RemoteService::sendAll()
     std::lock_guard<std::mutex> lck(_mtxSend);
     for(auto& sendRule : _sendRules)
     {
-        sendRule.second.state.forcedSend = true;
+        sendRule.second.state.resyncPending = true;
+    }
+    trigger();
+}
+
+void RemoteService::sendStale(const std::map<std::string, uint64_t>& heldIds)
+{
+    std::lock_guard<std::mutex> lck(_mtxSend);
+    for(auto& sendRule : _sendRules)
+    {
+        const uint64_t id = _valueStore.getValue<Value>(sendRule.second.topic)->id();
+        const auto held = heldIds.find(sendRule.first);
+        if(id != 0 && (held == heldIds.end() || held->second != id))
+        {
+            sendRule.second.state.resyncPending = true;
+        }
+    }
+    trigger();
+}
+
+void RemoteService::subscriptionsReceived(const std::map<std::string, bool>& subscribed)
+{
+    std::lock_guard<std::mutex> lck(_mtxSend);
+    for(const auto& topic : subscribed)
+    {
+        auto sendRule = _sendRules.find(topic.first);
+        if(sendRule == _sendRules.end()) continue;
+
+        SendState& state = sendRule->second.state;
+        const bool paused = !topic.second;
+        if(paused == state.paused) continue;
+
+        state.paused = paused;
+        if(paused)
+        {
+            ++_pausedRules;
+            MCF_INFO_NOFILELINE("{}: pausing send rule {}->{}, the remote side has no subscribers",
+                getName(), sendRule->second.topic, topic.first);
+        }
+        else
+        {
+            --_pausedRules;
+            // the new subscriber gets the latest value
+            state.resyncPending = true;
+            MCF_INFO_NOFILELINE("{}: resuming send rule {}->{}",
+                getName(), sendRule->second.topic, topic.first);
+        }
     }
     trigger();
 }
 
+void RemoteService::handlePaused()
+{
+    if(_pausedRules == 0) return;
+
+    const bool connected = _transceiver.connected();
+    for(auto& sendRule : _sendRules)
+    {
+        SendState& state = sendRule.second.state;
+        if(!state.paused) continue;
+
+        if(!connected)
+        {
+            // the remote side announces its subscribers again when it reconnects
+            state.paused = false;
+            continue;
+        }
+        // values nobody wants are dropped, which also releases writers blocked by a full queue
+        sendRule.second.port->getValues();
+        state.forcedSend = false;
+    }
+    if(!connected)
+    {
+        _pausedRules = 0;
+    }
+}
+
+bool RemoteService::releaseResync()
+{
+    size_t resyncing = 0;
+    for(const auto& sendRule : _sendRules)
+    {
+        if(sendRule.second.state.forcedSend) ++resyncing;
+    }
+
+    bool pending = false;
+    for(auto& lane : _sendLanes)
+    {
+        for(auto* sendRule : lane.rules)
+        {
+            SendState& state = sendRule->second.state;
+            // paused rules resend their latest value when they are resumed
+            if(!state.resyncPending || state.paused) continue;
+
+            if(_resyncLimit > 0 && resyncing >= _resyncLimit)
+            {
+                pending = true;
+                continue;
+            }
+            state.resyncPending = false;
+            if(!state.forcedSend)
+            {
+                state.forcedSend = true;
+                ++resyncing;
+            }
+        }
+    }
+    return pending;
+}
+
 void RemoteService::handlePorts()
 {
-    // nothing to be done, main component trigger handler will always be called
-    // and handle the port event
+    // port events are handled by the main component trigger handler
+    trigger();
 }
 
 void RemoteService::handleTriggers()
@@ -341,13 +737,15 @@ void RemoteService::handleTriggers()
     if(!_initialized && _transceiver.connected())
     {
         _initialized = true;
+    }
+    requestResync();
+    announceSubscriptions();
 
-        auto start = std::chrono::high_resolution_clock::now();
-
-        _transceiver.sendRequestAll();
-
-        auto end = std::chrono::high_resolution_clock::now();
-        traceDataTransferDuration(start, end, "send requestAll");
+    bool resyncPending = false;
+    {
+        std::lock_guard<std::mutex> lck(_mtxSend);
+        handlePaused();
+        resyncPending = releaseResync();
     }
 
     // TODO: should do this only, if initialized
@@ -355,6 +753,68 @@ void RemoteService::handleTriggers()
     handleInjectedRejected();
 
     _transceiver.cycle();
+
+    if(resyncPending && _transceiver.connected())
+    {
+        // release the next rules once the current ones are sent
+        trigger();
+    }
+}
+
+void RemoteService::requestResync()
+{
+    if(!_transceiver.connected())
+    {
+        _resyncRequested = false;
+        return;
+    }
+    if(_resyncRequested) return;
+    _resyncRequested = true;
+
+    std::map<std::string, uint64_t> heldIds;
+    for(const auto& receiveRule : _receiveRules)
+    {
+        const uint64_t id = _valueStore.getValue<Value>(receiveRule.second.topic)->id();
+        if(id != 0)
+        {
+            heldIds[receiveRule.first] = id;
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    _transceiver.sendRequestStale(heldIds);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    traceDataTransferDuration(start, end, "send requestStale");
+}
+
+void RemoteService::announceSubscriptions()
+{
+    if(!_announceSubscriptions) return;
+
+    if(!_transceiver.connected())
+    {
+        _subscriptionsAnnounced = false;
+        return;
+    }
+    // cleared before reading the subscribers, so that no change is missed
+    const bool changed = _subscriptionsChanged.exchange(false);
+    if(_subscriptionsAnnounced && !changed) return;
+    _subscriptionsAnnounced = true;
+
+    std::map<std::string, bool> subscribed;
+    for(const auto& receiveRule : _receiveRules)
+    {
+        subscribed[receiveRule.first] = receiveRule.second.port->hasSubscribers();
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    _transceiver.sendSubscriptions(subscribed);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    traceDataTransferDuration(start, end, "send subscriptions");
 }
 
 void RemoteService::handleInjectedRejected()
@@ -394,46 +854,195 @@ void RemoteService::handleSend()
 {
     if(!_initialized) return;
 
-    bool moreValuesToSend = true;
-    while(moreValuesToSend)
+    if(!_sendWorkers.empty())
+    {
+        wakeSendWorkers();
+        return;
+    }
+
+    if(_transceiver.supportsPipelining())
     {
-        moreValuesToSend = false;
         std::lock_guard<std::mutex> lck(_mtxSend);
-        for(auto& sendRule : /*prio_sorted*/(_sendRules))
+        handleSendPipelined();
+        return;
+    }
+
+    bool moreValuesToSend = true;
+    if(_maxBatchValues > 0)
+    {
+        while(moreValuesToSend)
         {
-            // check remote state and send only in STATE_UP
-            if(!_transceiver.connected())
             {
-                break;
+                std::lock_guard<std::mutex> lck(_mtxSend);
+                moreValuesToSend = _transceiver.connected() && handleSendBatch();
             }
-            else
-            {
-                handleSendTopic(sendRule.first, sendRule.second);
+            waitShaping();
+        }
+        return;
+    }
+
+    while(moreValuesToSend)
+    {
+        {
+            std::lock_guard<std::mutex> lck(_mtxSend);
+            moreValuesToSend = handleSendLanes();
+        }
+        waitShaping();
+    }
+}
+
+void RemoteService::waitShaping()
+{
+    if(_shapingWait > std::chrono::steady_clock::duration::zero())
+    {
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(_shapingWait, MAX_SHAPING_WAIT));
+        _shapingWait = std::chrono::steady_clock::duration::zero();
+    }
+}
 
-                SendState& state = sendRule.second.state;
-                if(state.forcedSend || sendRule.second.port->hasValue())
+bool RemoteService::shapeValue(const ValuePtr& value, std::chrono::steady_clock::duration& wait)
+{
+    wait = std::chrono::steady_clock::duration::zero();
+    if(_flowControl)
+    {
+        wait = _flowControl->acquire(FlowControl::estimateWireSize(*value));
+    }
+    return wait == std::chrono::steady_clock::duration::zero();
+}
+
+bool RemoteService::decimateValue(SendRule& sendRule, const size_t lane)
+{
+    if(!_flowControl || sendRule.blocking)
+    {
+        return false;
+    }
+
+    const unsigned shift = _flowControl->decimationShift(lane, _sendLanes.size());
+    if(shift == 0)
+    {
+        return false;
+    }
+
+    // keep every (1 << shift)-th value
+    const uint64_t mask = (uint64_t(1) << shift) - 1;
+    if((sendRule.state.decimated++ & mask) == 0)
+    {
+        return false;
+    }
+
+    sendRule.port->getValue();
+    _flowControl->valueDecimated();
+    return true;
+}
+
+size_t RemoteService::laneIndex(const uint8_t prio) const
+{
+    for(size_t lane = 0; lane < _sendLanes.size(); ++lane)
+    {
+        if(_sendLanes[lane].prio == prio)
+        {
+            return lane;
+        }
+    }
+    return 0;
+}
+
+void RemoteService::setFlowControl(const FlowControl::Config& config)
+{
+    _flowControl = std::make_unique<FlowControl>(config);
+}
+
+void RemoteService::valueAcked(
+    const ValuePtr& value,
+    const std::chrono::high_resolution_clock::duration duration,
+    const std::string& result)
+{
+    if(_flowControl)
+    {
+        _flowControl->valueAcked(
+            FlowControl::estimateWireSize(*value),
+            std::chrono::duration_cast<FlowControl::Clock::duration>(duration),
+            result);
+    }
+}
+
+FlowControl::Statistics RemoteService::getFlowControlStatistics() const
+{
+    return _flowControl ? _flowControl->statistics() : FlowControl::Statistics();
+}
+
+bool RemoteService::handleSendLanes()
+{
+    auto isReady = [](const SendRule& rule)
+    {
+        return !rule.state.sendPending && !rule.state.paused
+            && (rule.state.forcedSend || rule.port->hasValue());
+    };
+    auto laneReady = [&isReady](const SendLane& lane)
+    {
+        return std::any_of(lane.rules.begin(), lane.rules.end(),
+            [&isReady](const std::pair<const std::string, SendRule>* rule) { return isReady(rule->second); });
+    };
+
+    bool moreValuesToSend = false;
+    for(size_t laneIdx = 0; laneIdx < _sendLanes.size(); ++laneIdx)
+    {
+        auto& lane = _sendLanes[laneIdx];
+        const size_t passes = _sendScheduling == SendScheduling::WEIGHTED ? lane.prio + 1ul : 1ul;
+        for(size_t pass = 0; pass < passes && laneReady(lane); ++pass)
+        {
+            for(auto* sendRule : lane.rules)
+            {
+                // check remote state and send only in STATE_UP
+                if(!_transceiver.connected())
                 {
-                    moreValuesToSend = true;
+                    return false;
+                }
+                handleSendTopic(sendRule->first, sendRule->second, laneIdx);
+                if(_shapingWait > std::chrono::steady_clock::duration::zero())
+                {
+                    // the cycle continues once the flow control lets the value pass
+                    return true;
                 }
             }
         }
+
+        for(auto* sendRule : lane.rules)
+        {
+            SendState& state = sendRule->second.state;
+            if(!state.paused && (state.forcedSend || sendRule->second.port->hasValue()))
+            {
+                moreValuesToSend = true;
+            }
+        }
+
+        if(_sendScheduling == SendScheduling::STRICT && laneReady(lane))
+        {
+            // lower lanes wait until this one has no values ready any more
+            return true;
+        }
     }
+    return moreValuesToSend;
 }
 
-void RemoteService::handleSendTopic(const std::string& topic, SendRule& sendRule)
+void RemoteService::handleSendTopic(const std::string& topic, SendRule& sendRule, const size_t lane)
 {
     SendState& state = sendRule.state;
     auto& port = sendRule.port;
 
-    // do not send anything if an old send is still pending
-    if(state.sendPending) return;
+    // do not send anything if an old send is still pending or the rule is paused
+    if(state.sendPending || state.paused) return;
 
     auto start = std::chrono::high_resolution_clock::now();
 
     if(port->hasValue())
     {
+        if(decimateValue(sendRule, lane)) return;
+
         auto value = port->peekValue();
-        std::string result = _transceiver.sendValue(topic, value);
+        if(!shapeValue(value, _shapingWait)) return;
+
+        std::string result = _transceiver.sendValue(topic, value, port->peekSequence());
 
         if(result == "INJECTED" || result == "RECEIVED" || result == "REJECTED")
         {
@@ -452,6 +1061,7 @@ void RemoteService::handleSendTopic(const std::string& topic, SendRule& sendRule
         auto end = std::chrono::high_resolution_clock::now();
         traceDataTransferDuration(start, end,
                 fmt::format("send value on {}->{}: {}", sendRule.topic, topic, result));
+        valueAcked(value, end - start, result);
 
     }
     else if(state.forcedSend)
@@ -464,6 +1074,7 @@ void RemoteService::handleSendTopic(const std::string& topic, SendRule& sendRule
               state.forcedSend = false;
               return; // TODO get rid of early exits
             }
+            if(!shapeValue(value, _shapingWait)) return;
 
             std::string result = _transceiver.sendValue(topic, value);
 
@@ -479,6 +1090,7 @@ void RemoteService::handleSendTopic(const std::string& topic, SendRule& sendRule
             auto end = std::chrono::high_resolution_clock::now();
             traceDataTransferDuration(start, end,
                     fmt::format("forced send value on {}->{}: {}", sendRule.topic, topic, result));
+            valueAcked(value, end - start, result);
         }
         else
         {
@@ -498,6 +1110,7 @@ void RemoteService::handlePendingValues(
 {
     // setup event tracing and policy
     setThreadName("RP");
+    pinHelperThread("pending values");
     ComponentTraceController::setLocalEventGenerator(eventGenerator);
     if(policy == SCHED_FIFO)
     {
@@ -521,39 +1134,42 @@ void RemoteService::handlePendingValues(
         }
     }
 
-    // wait until end of stratup phase
-    auto state = getState();
-    while(state == INIT || state == STARTING_UP || state == STARTED)
-    {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        state = getState();
-    }
+    // wait until end of startup phase
+    waitRunning();
 
     // loop while component is running
     while(getState() == RUNNING)
     {
         // lock mutex
         std::unique_lock<std::mutex> lock(_mtxReceive);
+        _awaitedPort = nullptr;
 
         // wait until there is at least one pending value, or we need to shut down
         _cvar_pendR.wait(lock, [this] { return isReceivedValuePending() || (getState() != RUNNING); });
 
         std::vector<std::string> insertedTopics;
         std::vector<std::string> rejectedTopics;
+        GenericSenderPort* blockedPort = nullptr;
+        size_t blockedCount = 0;
         for(auto& receiveRule : _receiveRules)
         {
             auto& pendingValue = receiveRule.second.state.pendingValue;
             if(pendingValue != nullptr)
             {
-                int inserted = receiveRule.second.port->setValue(pendingValue, false);
+                int inserted = receiveRule.second.port->injectValue(
+                    pendingValue, ValueOrigin{this, receiveRule.second.state.pendingSeq}, false);
                 if(inserted == 0)  // value has been injected successfully
                 {
                     pendingValue = nullptr;
                     insertedTopics.push_back(receiveRule.first);
                 }
-                else if (inserted == EAGAIN) // value not injected, retry later
+                else if (inserted == EAGAIN) // value not injected, retry when the topic unblocks
                 {
-                    // nothing to be done here
+                    if(blockedPort == nullptr)
+                    {
+                        blockedPort = receiveRule.second.port.get();
+                    }
+                    ++blockedCount;
                 }
                 else if (inserted == ENOTCONN || inserted == ECANCELED)  // value cannot be inserted
                 {
@@ -563,27 +1179,242 @@ void RemoteService::handlePendingValues(
                 else // unexpected return code => handle like "rejected"
                 {
                     MCF_ERROR("Unexpected return code from output port: {}", inserted);
+                    pendingValue = nullptr;
                     rejectedTopics.push_back(receiveRule.first);
                 }
             }
         }
 
+        // values received from now on abort waiting for the blocked topic below
+        _awaitedPort = blockedPort;
+        const uint64_t generation = _pendingGeneration;
+
         // unlock the mutex
         lock.unlock();
 
-        // lock the mutex for _insertedTopics and _rejectedTopics
-        std::unique_lock<std::mutex> lockTopics(_mtxTopics);
-        _insertedTopics.insert(_insertedTopics.end(), insertedTopics.begin(), insertedTopics.end());
-        _rejectedTopics.insert(_rejectedTopics.end(), rejectedTopics.begin(), rejectedTopics.end());
-        lockTopics.unlock();
+        if(!insertedTopics.empty() || !rejectedTopics.empty())
+        {
+            // lock the mutex for _insertedTopics and _rejectedTopics
+            std::unique_lock<std::mutex> lockTopics(_mtxTopics);
+            _insertedTopics.insert(_insertedTopics.end(), insertedTopics.begin(), insertedTopics.end());
+            _rejectedTopics.insert(_rejectedTopics.end(), rejectedTopics.begin(), rejectedTopics.end());
+            lockTopics.unlock();
+
+            // wake up main task to handle received and rejected topics (inform sender side)
+            // Note: this has to be done by the main thread, because sockets (e.g. ZMQ) cannot
+            //       easily be shared between threads.
+            trigger();
+        }
 
-        // wake up main task to handle received and rejected topics (inform sender side)
-        // Note: this has to be done by the main thread, because sockets (e.g. ZMQ) cannot
-        //       easily be shared between threads.
-        trigger();
+        // wait until the receiver of a blocked topic pops a value instead of polling
+        if(blockedPort != nullptr)
+        {
+            const auto deadline = blockedCount > 1
+                    ? std::chrono::steady_clock::now() + PENDING_RETRY_INTERVAL
+                    : std::chrono::steady_clock::time_point::max();
+            blockedPort->waitUnblocked(
+                    [this, generation]
+                    {
+                        return _pendingGeneration != generation || getState() != RUNNING;
+                    },
+                    deadline);
+        }
+    }
+}
 
-        // sleep to avoid high-frequency polling when receiver ports are continuously blocked
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+bool RemoteService::handleSendBatch()
+{
+    std::vector<std::pair<std::string, ValuePtr>> batch;
+    std::vector<uint64_t> batchSeqs;
+    std::vector<SendRule*> batchRules;
+    bool moreValuesToSend = false;
+
+    for(auto& lane : _sendLanes)
+    {
+        for(auto* sendRule : lane.rules)
+        {
+            SendRule& rule = sendRule->second;
+            if(rule.state.sendPending || rule.state.paused)
+            {
+                continue;
+            }
+
+            if(!rule.port->hasValue())
+            {
+                // forced sends are rare and not batched
+                if(rule.state.forcedSend && _transceiver.connected())
+                {
+                    handleSendTopic(sendRule->first, rule, 0);
+                    moreValuesToSend = moreValuesToSend || rule.state.forcedSend || rule.port->hasValue();
+                }
+            }
+            else if(batch.size() < _maxBatchValues)
+            {
+                batch.emplace_back(sendRule->first, rule.port->peekValue());
+                batchSeqs.push_back(rule.port->peekSequence());
+                batchRules.push_back(&rule);
+            }
+            else
+            {
+                moreValuesToSend = true;
+            }
+        }
+    }
+
+    if(batch.empty() || !_transceiver.connected())
+    {
+        return moreValuesToSend;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    const auto results = _transceiver.sendValues(batch, _maxBatchBytes, batchSeqs);
+    auto end = std::chrono::high_resolution_clock::now();
+    traceDataTransferDuration(start, end, fmt::format("send batch of {} values", batch.size()));
+
+    for(size_t i = 0; i < batchRules.size(); ++i)
+    {
+        SendRule& rule = *batchRules[i];
+        const std::string& result = results[i];
+        if(result == "INJECTED" || result == "RECEIVED" || result == "REJECTED")
+        {
+            rule.port->getValue();
+            rule.state.forcedSend = false;
+            if(result == "RECEIVED")
+            {
+                rule.state.sendPending = true;
+            }
+        }
+
+        if(rule.state.forcedSend || rule.port->hasValue())
+        {
+            moreValuesToSend = true;
+        }
+    }
+    return moreValuesToSend;
+}
+
+void RemoteService::handleSendPipelined()
+{
+    // time to wait for a response while a window is full
+    static constexpr std::chrono::milliseconds ackWait(10);
+
+    auto ackTimeout = std::chrono::milliseconds(0);
+    while(_transceiver.connected())
+    {
+        handleAcks(ackTimeout);
+
+        bool windowFull = false;
+        for(auto& lane : _sendLanes)
+        {
+            for(auto* sendRule : lane.rules)
+            {
+                if(!_transceiver.connected())
+                {
+                    break;
+                }
+                windowFull = handleSendTopicPipelined(sendRule->first, sendRule->second) || windowFull;
+            }
+        }
+
+        if(!windowFull)
+        {
+            // the remaining responses are processed when the next values are sent
+            break;
+        }
+        ackTimeout = ackWait;
+    }
+}
+
+bool RemoteService::handleSendTopicPipelined(const std::string& topic, SendRule& sendRule)
+{
+    SendState& state = sendRule.state;
+    auto& port = sendRule.port;
+
+    // do not send anything if an old send is still pending or the rule is paused
+    if(state.sendPending || state.paused) return false;
+
+    // blocking rules keep the value in the port until its response has arrived, so that it is
+    // sent again if it times out
+    const size_t window = sendRule.blocking ? 1 : sendRule.window;
+
+    while(state.inFlight.size() < window && port->hasValue())
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // taken before a non blocking rule pops the value
+        const uint64_t seq = port->peekSequence();
+        auto value = sendRule.blocking ? port->peekValue() : port->getValue();
+        std::string result = _transceiver.sendValueAsync(topic, value, seq);
+        if(result == "SENT")
+        {
+            state.inFlight.push_back(sendRule.blocking);
+        }
+        else if(sendRule.blocking)
+        {
+            port->getValue();
+        }
+        state.forcedSend = false;
+
+        auto end = std::chrono::high_resolution_clock::now();
+        traceDataTransferDuration(start, end,
+                fmt::format("send value on {}->{}: {}", sendRule.topic, topic, result));
+    }
+
+    if(state.forcedSend && state.inFlight.empty() && !port->hasValue())
+    {
+        state.forcedSend = false;
+        auto value = _valueStore.getValue<Value>(sendRule.topic);
+        if(value->id() != 0)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+
+            std::string result = _transceiver.sendValueAsync(topic, value);
+            if(result == "SENT")
+            {
+                state.inFlight.push_back(false);
+            }
+
+            auto end = std::chrono::high_resolution_clock::now();
+            traceDataTransferDuration(start, end,
+                    fmt::format("forced send value on {}->{}: {}", sendRule.topic, topic, result));
+        }
+    }
+
+    return (port->hasValue() || state.forcedSend) && state.inFlight.size() >= window;
+}
+
+void RemoteService::handleAcks(std::chrono::milliseconds timeout)
+{
+    std::vector<AbstractSender::Ack> acks;
+    _transceiver.pollAcks(acks, timeout);
+
+    for(const auto& ack : acks)
+    {
+        auto sendRuleIt = _sendRules.find(ack.topic);
+        if(sendRuleIt == _sendRules.end() || sendRuleIt->second.state.inFlight.empty())
+        {
+            // sent before the pending values have been reset
+            continue;
+        }
+
+        SendRule& sendRule = sendRuleIt->second;
+        const bool heldInPort = sendRule.state.inFlight.front();
+        sendRule.state.inFlight.pop_front();
+
+        if(ack.result == "TIMEOUT")
+        {
+            // a value held in the port is sent again
+            continue;
+        }
+
+        if(heldInPort && sendRule.port->hasValue())
+        {
+            sendRule.port->getValue();
+        }
+        if(ack.result == "RECEIVED")
+        {
+            sendRule.state.sendPending = true;
+        }
     }
 }
 
@@ -593,6 +1424,7 @@ void RemoteService::resetPendingValues()
     for(auto& sendRule : _sendRules)
     {
         sendRule.second.state.sendPending = false;
+        sendRule.second.state.inFlight.clear();
     }
 }
 
@@ -622,6 +1454,16 @@ void RemoteService::traceDataTransferDuration(
     }
 }
 
+void RemoteService::wakePendingValues()
+{
+    ++_pendingGeneration;
+    _cvar_pendR.notify_all();
+    if(_awaitedPort != nullptr)
+    {
+        _awaitedPort->wakeBlockedWriters();
+    }
+}
+
 bool RemoteService::isReceivedValuePending() const
 {
     return std::any_of(_receiveRules.begin(), _receiveRules.end(),
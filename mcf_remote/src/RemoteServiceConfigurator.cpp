@@ -4,11 +4,13 @@
 
 #include "mcf_core/ComponentInstantiator.h"
 #include "mcf_core/ComponentManager.h"
+#include "mcf_remote/Remote.h"
 #include "mcf_remote/RemoteService.h"
 #include "mcf_remote/RemoteServiceUtils.h"
 #include "mcf_remote/RemoteServiceConfigurator.h"
 #include "mcf_remote/ShmemClient.h"
 #include "mcf_remote/ShmemKeeper.h"
+#include "mcf_remote/ZmqContext.h"
 
 #include "mcf_core/ErrorMacros.h"
 #include "json/json.h"
@@ -31,10 +33,45 @@ const char *SEND_RULES_CONFIG_ITEM = "sendRules";
 const char *RECEIVE_RULES_CONFIG_ITEM = "receiveRules";
 const char *SENDER_TIMEOUT = "sendTimeout";
 const char *SENDER_ARTIFICIAL_JITTER = "artificialJitter";
+const char *SENDER_PIPELINED = "pipelined";
+const char *SENDER_MAX_BATCH_VALUES = "maxBatchValues";
+const char *SENDER_MAX_BATCH_BYTES = "maxBatchBytes";
+const char *SENDER_WORKERS = "sendWorkers";
+const char *TRANSPORT_CONFIG_ITEM = "transport";
+const char *TRANSPORT_REQ_REP = "reqrep";
+const char *TRANSPORT_ASYNC = "async";
+const char *SEND_SCHEDULING_CONFIG_ITEM = "sendScheduling";
+const char *SEND_SCHEDULING_STRICT = "strict";
+const char *SEND_SCHEDULING_WEIGHTED = "weighted";
+const char *RESYNC_LIMIT_CONFIG_ITEM = "resyncLimit";
+const char *ANNOUNCE_SUBSCRIPTIONS_CONFIG_ITEM = "announceSubscriptions";
+const char *EXT_MEM_EXPORT_CONFIG_ITEM = "extMemExport";
+const char *FAN_OUT_GROUP_CONFIG_ITEM = "fanOutGroup";
+const char *FLOW_CONTROL_CONFIG_ITEM = "flowControl";
+const char *FLOW_CONTROL_MAX_RATE_ITEM = "maxRate";
+const char *FLOW_CONTROL_BURST_ITEM = "burst";
+const char *FLOW_CONTROL_ADAPTIVE_ITEM = "adaptive";
 const char *TOPIC_LOCAL_CONFIG_ITEM = "topic_local";
 const char *TOPIC_REMOTE_CONFIG_ITEM = "topic_remote";
 const char *SENDER_BLOCKING_CONFIG_ITEM = "blocking";
 const char *SENDER_QUEUE_LENGTH_ITEM = "queue_length";
+const char *SENDER_WINDOW_ITEM = "window";
+const char *SENDER_PRIO_ITEM = "prio";
+const char *SENDER_COMPRESSION_LEVEL_ITEM = "compression_level";
+const char *SENDER_COMPRESSION_MIN_SIZE_ITEM = "compression_min_size";
+const char *SENDER_ADAPTIVE_QUEUE_ITEM = "adaptive_queue";
+const char *ADAPTIVE_MIN_LENGTH_ITEM = "min_length";
+const char *ADAPTIVE_MAX_LENGTH_ITEM = "max_length";
+const char *ADAPTIVE_TARGET_LATENCY_ITEM = "target_latency_ms";
+const char *ADAPTIVE_TARGET_DROP_RATE_ITEM = "target_drop_rate";
+const char *ADAPTIVE_WINDOW_ITEM = "window_ms";
+const char *RECEIVER_RELAY_ITEM = "relay";
+const char *ZMQ_CONTEXT_CONFIG_ITEM = "ZmqContext";
+const char *ZMQ_IO_THREADS_ITEM = "ioThreads";
+const char *ZMQ_CPU_AFFINITY_ITEM = "cpuAffinity";
+const char *ZMQ_PRIORITY_ITEM = "priority";
+const char *ZMQ_SEND_BUFFER_SIZE_ITEM = "sendBufferSize";
+const char *ZMQ_RECEIVE_BUFFER_SIZE_ITEM = "receiveBufferSize";
 
 
 /**
@@ -46,6 +83,11 @@ struct SendRule
     std::string topicRemote;
     bool isBlocking = false;
     size_t queueLength = 1UL;
+    size_t window = 1UL;
+    uint8_t prio = 0;
+    AbstractSender::Compression compression;
+    bool adaptiveQueue = false;
+    ValueQueue::AdaptiveLength adaptiveLength;
 };
 
 /**
@@ -55,6 +97,7 @@ struct ReceiveRule
 {
     std::string topicRemote;
     std::string topicLocal;
+    bool relay = false;
 };
 
 /**
@@ -68,6 +111,19 @@ struct RemoteServiceInstanceConfig
     std::vector<ReceiveRule> receiveRules;
     std::chrono::milliseconds sendTimeout = std::chrono::milliseconds(100);
     std::chrono::milliseconds artificialJitter = std::chrono::milliseconds(0);
+    bool pipelined = false;
+    std::string transport = TRANSPORT_REQ_REP;
+    size_t maxBatchValues = 0UL;
+    size_t maxBatchBytes = 65536UL;
+    size_t sendWorkers = 0UL;
+    RemoteService::SendScheduling sendScheduling = RemoteService::SendScheduling::STRICT;
+    size_t resyncLimit = 0UL;
+    bool announceSubscriptions = false;
+    bool extMemExport = false;
+    // instances of the same group serialize values once, see RemoteService::setSerializationCache()
+    std::string fanOutGroup;
+    bool flowControl = false;
+    FlowControl::Config flowControlConfig;
 };
 
 /**
@@ -134,6 +190,116 @@ std::vector<SendRule> decodeSendRules(const Json::Value &config)
             rule.queueLength = ruleJson[SENDER_QUEUE_LENGTH_ITEM].asUInt();
         }
 
+        // get window of pipelined sending (or use default 1)
+        if (ruleJson.isMember(SENDER_WINDOW_ITEM))
+        {
+            if (!ruleJson[SENDER_WINDOW_ITEM].isUInt() || ruleJson[SENDER_WINDOW_ITEM].asUInt() == 0)
+            {
+                throw Json::RuntimeError(SEND_RULES_CONFIG_ITEM +
+                                         std::string(": '") +
+                                         SENDER_WINDOW_ITEM +
+                                         std::string("' is not a positive integer"));
+            }
+            rule.window = ruleJson[SENDER_WINDOW_ITEM].asUInt();
+        }
+
+        // get sending priority (or use default 0)
+        if (ruleJson.isMember(SENDER_PRIO_ITEM))
+        {
+            if (!ruleJson[SENDER_PRIO_ITEM].isUInt() || ruleJson[SENDER_PRIO_ITEM].asUInt() > 255)
+            {
+                throw Json::RuntimeError(SEND_RULES_CONFIG_ITEM +
+                                         std::string(": '") +
+                                         SENDER_PRIO_ITEM +
+                                         std::string("' is not an integer from 0 to 255"));
+            }
+            rule.prio = static_cast<uint8_t>(ruleJson[SENDER_PRIO_ITEM].asUInt());
+        }
+
+        // get compression level (or use default 0, i.e. uncompressed)
+        if (ruleJson.isMember(SENDER_COMPRESSION_LEVEL_ITEM))
+        {
+            if (!ruleJson[SENDER_COMPRESSION_LEVEL_ITEM].isUInt() ||
+                ruleJson[SENDER_COMPRESSION_LEVEL_ITEM].asUInt() > 9)
+            {
+                throw Json::RuntimeError(SEND_RULES_CONFIG_ITEM +
+                                         std::string(": '") +
+                                         SENDER_COMPRESSION_LEVEL_ITEM +
+                                         std::string("' is not an integer from 0 to 9"));
+            }
+            rule.compression.level = static_cast<int>(ruleJson[SENDER_COMPRESSION_LEVEL_ITEM].asUInt());
+        }
+
+        // get minimum size of compressed frames (or use default 0)
+        if (ruleJson.isMember(SENDER_COMPRESSION_MIN_SIZE_ITEM))
+        {
+            if (!ruleJson[SENDER_COMPRESSION_MIN_SIZE_ITEM].isUInt())
+            {
+                throw Json::RuntimeError(SEND_RULES_CONFIG_ITEM +
+                                         std::string(": '") +
+                                         SENDER_COMPRESSION_MIN_SIZE_ITEM +
+                                         std::string("' is not a non-negative integer"));
+            }
+            rule.compression.minSize = ruleJson[SENDER_COMPRESSION_MIN_SIZE_ITEM].asUInt();
+        }
+
+        // get bounds and targets of the adaptive queue length (or keep queue_length)
+        if (ruleJson.isMember(SENDER_ADAPTIVE_QUEUE_ITEM))
+        {
+            const Json::Value& adaptiveJson = ruleJson[SENDER_ADAPTIVE_QUEUE_ITEM];
+            auto invalid = [](const char* item, const char* what)
+            {
+                return Json::RuntimeError(SEND_RULES_CONFIG_ITEM +
+                                          std::string(": '") +
+                                          SENDER_ADAPTIVE_QUEUE_ITEM +
+                                          std::string(".") +
+                                          item +
+                                          std::string("' is not ") +
+                                          what);
+            };
+            if (!adaptiveJson.isObject())
+            {
+                throw Json::RuntimeError(SEND_RULES_CONFIG_ITEM +
+                                         std::string(": '") +
+                                         SENDER_ADAPTIVE_QUEUE_ITEM +
+                                         std::string("' is not an object"));
+            }
+            auto& adaptive = rule.adaptiveLength;
+            for (const char* item : {ADAPTIVE_MIN_LENGTH_ITEM, ADAPTIVE_MAX_LENGTH_ITEM, ADAPTIVE_WINDOW_ITEM})
+            {
+                if (adaptiveJson.isMember(item) && (!adaptiveJson[item].isUInt() || adaptiveJson[item].asUInt() == 0))
+                {
+                    throw invalid(item, "a positive integer");
+                }
+            }
+            adaptive.minLength = adaptiveJson.get(ADAPTIVE_MIN_LENGTH_ITEM, Json::UInt64(adaptive.minLength)).asUInt();
+            adaptive.maxLength = adaptiveJson.get(ADAPTIVE_MAX_LENGTH_ITEM, Json::UInt64(adaptive.maxLength)).asUInt();
+            adaptive.window = std::chrono::milliseconds(
+                adaptiveJson.get(ADAPTIVE_WINDOW_ITEM, Json::UInt64(adaptive.window.count())).asUInt());
+            if (adaptive.minLength > adaptive.maxLength)
+            {
+                throw invalid(ADAPTIVE_MIN_LENGTH_ITEM, "at most max_length");
+            }
+            if (adaptiveJson.isMember(ADAPTIVE_TARGET_LATENCY_ITEM))
+            {
+                if (!adaptiveJson[ADAPTIVE_TARGET_LATENCY_ITEM].isUInt())
+                {
+                    throw invalid(ADAPTIVE_TARGET_LATENCY_ITEM, "a non-negative integer");
+                }
+                adaptive.targetLatency = std::chrono::milliseconds(adaptiveJson[ADAPTIVE_TARGET_LATENCY_ITEM].asUInt());
+            }
+            if (adaptiveJson.isMember(ADAPTIVE_TARGET_DROP_RATE_ITEM))
+            {
+                const Json::Value& dropRate = adaptiveJson[ADAPTIVE_TARGET_DROP_RATE_ITEM];
+                if (!dropRate.isNumeric() || dropRate.asDouble() < 0.0 || dropRate.asDouble() > 1.0)
+                {
+                    throw invalid(ADAPTIVE_TARGET_DROP_RATE_ITEM, "a number from 0 to 1");
+                }
+                adaptive.targetDropRate = dropRate.asDouble();
+            }
+            rule.adaptiveQueue = true;
+        }
+
         rules.push_back(rule);
     }
 
@@ -178,6 +344,19 @@ std::vector<ReceiveRule> decodeReceiveRules(const Json::Value &config)
             rule.topicLocal = rule.topicRemote;
         }
 
+        // get relay flag (or use default false)
+        if (ruleJson.isMember(RECEIVER_RELAY_ITEM))
+        {
+            if (!ruleJson[RECEIVER_RELAY_ITEM].isBool())
+            {
+                throw Json::RuntimeError(RECEIVE_RULES_CONFIG_ITEM +
+                                         std::string(": '") +
+                                         RECEIVER_RELAY_ITEM +
+                                         std::string("' is not boolean"));
+            }
+            rule.relay = ruleJson[RECEIVER_RELAY_ITEM].asBool();
+        }
+
         rules.push_back(rule);
     }
 
@@ -204,9 +383,150 @@ RemoteServiceInstanceConfig decodeInstanceConfig(const Json::Value &config)
         decodedConfig.artificialJitter = 
             std::chrono::milliseconds(config[SENDER_ARTIFICIAL_JITTER].asUInt());
     }
+    if(config.isMember(SENDER_PIPELINED))
+    {
+        if(!config[SENDER_PIPELINED].isBool())
+        {
+            throw Json::RuntimeError(SENDER_PIPELINED + std::string(" is not boolean"));
+        }
+        decodedConfig.pipelined = config[SENDER_PIPELINED].asBool();
+    }
+    if(config.isMember(SENDER_MAX_BATCH_VALUES))
+    {
+        decodedConfig.maxBatchValues = config[SENDER_MAX_BATCH_VALUES].asUInt();
+    }
+    if(config.isMember(SENDER_MAX_BATCH_BYTES))
+    {
+        decodedConfig.maxBatchBytes = config[SENDER_MAX_BATCH_BYTES].asUInt();
+    }
+    if(config.isMember(SENDER_WORKERS))
+    {
+        if(!config[SENDER_WORKERS].isUInt())
+        {
+            throw Json::RuntimeError(SENDER_WORKERS + std::string(" is not an unsigned integer"));
+        }
+        decodedConfig.sendWorkers = config[SENDER_WORKERS].asUInt();
+    }
+    if(config.isMember(TRANSPORT_CONFIG_ITEM))
+    {
+        if(!config[TRANSPORT_CONFIG_ITEM].isString())
+        {
+            throw Json::RuntimeError(TRANSPORT_CONFIG_ITEM + std::string(" is not a string"));
+        }
+        decodedConfig.transport = config[TRANSPORT_CONFIG_ITEM].asString();
+    }
+    if(config.isMember(SEND_SCHEDULING_CONFIG_ITEM))
+    {
+        const std::string scheduling = config[SEND_SCHEDULING_CONFIG_ITEM].asString();
+        if(scheduling == SEND_SCHEDULING_STRICT)
+        {
+            decodedConfig.sendScheduling = RemoteService::SendScheduling::STRICT;
+        }
+        else if(scheduling == SEND_SCHEDULING_WEIGHTED)
+        {
+            decodedConfig.sendScheduling = RemoteService::SendScheduling::WEIGHTED;
+        }
+        else
+        {
+            throw Json::RuntimeError(SEND_SCHEDULING_CONFIG_ITEM +
+                                     std::string(": unknown scheduling '") + scheduling + "'");
+        }
+    }
+    if(config.isMember(RESYNC_LIMIT_CONFIG_ITEM))
+    {
+        decodedConfig.resyncLimit = config[RESYNC_LIMIT_CONFIG_ITEM].asUInt();
+    }
+    if(config.isMember(ANNOUNCE_SUBSCRIPTIONS_CONFIG_ITEM))
+    {
+        decodedConfig.announceSubscriptions = config[ANNOUNCE_SUBSCRIPTIONS_CONFIG_ITEM].asBool();
+    }
+    if(config.isMember(EXT_MEM_EXPORT_CONFIG_ITEM))
+    {
+        decodedConfig.extMemExport = config[EXT_MEM_EXPORT_CONFIG_ITEM].asBool();
+    }
+    if(config.isMember(FAN_OUT_GROUP_CONFIG_ITEM))
+    {
+        if(!config[FAN_OUT_GROUP_CONFIG_ITEM].isString())
+        {
+            throw Json::RuntimeError(FAN_OUT_GROUP_CONFIG_ITEM + std::string(" is not a string"));
+        }
+        decodedConfig.fanOutGroup = config[FAN_OUT_GROUP_CONFIG_ITEM].asString();
+    }
+    if(config.isMember(FLOW_CONTROL_CONFIG_ITEM))
+    {
+        const Json::Value& flowControl = config[FLOW_CONTROL_CONFIG_ITEM];
+        if(!flowControl.isObject())
+        {
+            throw Json::RuntimeError(FLOW_CONTROL_CONFIG_ITEM + std::string(" is not an object"));
+        }
+        decodedConfig.flowControl = true;
+        if(flowControl.isMember(FLOW_CONTROL_MAX_RATE_ITEM))
+        {
+            decodedConfig.flowControlConfig.maxRate = flowControl[FLOW_CONTROL_MAX_RATE_ITEM].asUInt64();
+        }
+        if(flowControl.isMember(FLOW_CONTROL_BURST_ITEM))
+        {
+            decodedConfig.flowControlConfig.burst = flowControl[FLOW_CONTROL_BURST_ITEM].asUInt64();
+        }
+        if(flowControl.isMember(FLOW_CONTROL_ADAPTIVE_ITEM))
+        {
+            if(!flowControl[FLOW_CONTROL_ADAPTIVE_ITEM].isBool())
+            {
+                throw Json::RuntimeError(FLOW_CONTROL_CONFIG_ITEM + std::string(": '") +
+                                         FLOW_CONTROL_ADAPTIVE_ITEM + "' is not boolean");
+            }
+            decodedConfig.flowControlConfig.adaptive = flowControl[FLOW_CONTROL_ADAPTIVE_ITEM].asBool();
+        }
+    }
     return decodedConfig;
 };
 
+/**
+ * Decode an integer item of the ZmqContext object, keeping the default if it is absent
+ */
+void decodeContextInt(const Json::Value &config, const char *item, int minimum, int &value)
+{
+    if (!config.isMember(item))
+    {
+        return;
+    }
+    if (!config[item].isInt() || config[item].asInt() < minimum)
+    {
+        throw Json::RuntimeError(ZMQ_CONTEXT_CONFIG_ITEM + std::string(": '") + item +
+                                 "' must be an integer >= " + std::to_string(minimum));
+    }
+    value = config[item].asInt();
+}
+
+/**
+ * Decode the CPUs of the ZmqContext object, a CPU list string or an array of CPU indices
+ */
+CpuMask decodeCpuAffinity(const Json::Value &config)
+{
+    try
+    {
+        if (config.isString())
+        {
+            return parseCpuList(config.asString());
+        }
+        if (config.isArray())
+        {
+            CpuMask mask = 0;
+            for (const auto& cpu : config)
+            {
+                mask |= parseCpuList(std::to_string(cpu.asInt()));
+            }
+            return mask;
+        }
+    }
+    catch (const std::invalid_argument &e)
+    {
+        throw Json::RuntimeError(ZMQ_CONTEXT_CONFIG_ITEM + std::string(": ") + e.what());
+    }
+    throw Json::RuntimeError(ZMQ_CONTEXT_CONFIG_ITEM + std::string(": '") + ZMQ_CPU_AFFINITY_ITEM +
+                             "' is not a CPU list string or an array of CPU indices");
+}
+
 } // anonymous namespace;
 
 
@@ -217,12 +537,64 @@ RemoteServiceConfigurator::RemoteServiceConfigurator(ValueStore &valueStore,
         , fShmemKeeper(std::move(shmemKeeper))
         , fShmemClient(std::move(shmemClient))
 {
+    registerTransport(TRANSPORT_REQ_REP, [](const TransportParameters& params)
+    {
+        return buildZmqRemoteService(params.sendConnection,
+                                     params.receiveConnection,
+                                     params.valueStore,
+                                     params.shmemKeeper,
+                                     params.shmemClient,
+                                     params.sendTimeout,
+                                     params.artificialJitter,
+                                     params.pipelined,
+                                     params.sendWorkers);
+    });
+    registerTransport(TRANSPORT_ASYNC, [](const TransportParameters& params)
+    {
+        return buildZmqAsyncRemoteService(params.sendConnection,
+                                          params.receiveConnection,
+                                          params.valueStore,
+                                          params.shmemKeeper,
+                                          params.shmemClient,
+                                          params.sendTimeout,
+                                          params.artificialJitter);
+    });
+}
+
+void RemoteServiceConfigurator::registerTransport(const std::string& name, TransportFactory factory)
+{
+    MCF_ASSERT(factory, "Transport '" + name + "' has no factory");
+    fTransports[name] = std::move(factory);
+}
+
+ZmqContextConfig RemoteServiceConfigurator::readZmqContextConfiguration(const Json::Value &node)
+{
+    ZmqContextConfig config;
+    const Json::Value &context = node.get(ZMQ_CONTEXT_CONFIG_ITEM, Json::Value());
+    if (context.isNull())
+    {
+        return config;
+    }
+    if (!context.isObject())
+    {
+        throw Json::RuntimeError(ZMQ_CONTEXT_CONFIG_ITEM + std::string(" is not an object"));
+    }
+    decodeContextInt(context, ZMQ_IO_THREADS_ITEM, 1, config.ioThreads);
+    decodeContextInt(context, ZMQ_PRIORITY_ITEM, -1, config.priority);
+    decodeContextInt(context, ZMQ_SEND_BUFFER_SIZE_ITEM, -1, config.sendBufferSize);
+    decodeContextInt(context, ZMQ_RECEIVE_BUFFER_SIZE_ITEM, -1, config.receiveBufferSize);
+    if (context.isMember(ZMQ_CPU_AFFINITY_ITEM))
+    {
+        config.cpuAffinity = decodeCpuAffinity(context[ZMQ_CPU_AFFINITY_ITEM]);
+    }
+    return config;
 }
 
 std::map<std::string, std::shared_ptr<mcf::remote::RemoteService>>
 RemoteServiceConfigurator::configureFromJSONNode(const Json::Value &config)
 {
     std::map<std::string, std::shared_ptr<mcf::remote::RemoteService>> instances;
+    std::map<std::string, std::shared_ptr<SerializationCache>> fanOutGroups;
 
     try
     {
@@ -253,25 +625,72 @@ RemoteServiceConfigurator::configureFromJSONNode(const Json::Value &config)
                 throw Json::RuntimeError("Instance '" + name + "': " + e.what());
             }
 
-            // create remote service instance
-            auto instance = buildZmqRemoteService(instanceConfig.sendConnection,
-                                                  instanceConfig.receiveConnection,
-                                                  fValueStore,
-                                                  fShmemKeeper,
-                                                  fShmemClient,
-                                                  instanceConfig.sendTimeout,
-                                                  instanceConfig.artificialJitter);
+            // create remote service instance with the selected transport
+            const auto transport = fTransports.find(instanceConfig.transport);
+            if (transport == fTransports.end())
+            {
+                throw Json::RuntimeError("Instance '" + name + "': " + TRANSPORT_CONFIG_ITEM +
+                                         ": unknown transport '" + instanceConfig.transport + "'");
+            }
+            const TransportParameters params{instanceConfig.sendConnection,
+                                             instanceConfig.receiveConnection,
+                                             fValueStore,
+                                             fShmemKeeper,
+                                             fShmemClient,
+                                             instanceConfig.sendTimeout,
+                                             instanceConfig.artificialJitter,
+                                             instanceConfig.pipelined,
+                                             instanceConfig.sendWorkers,
+                                             cfgNode};
+            std::shared_ptr<mcf::remote::RemoteService> instance = transport->second(params);
+            if (instance == nullptr)
+            {
+                throw Json::RuntimeError("Instance '" + name + "': transport '" +
+                                         instanceConfig.transport + "' built no remote service");
+            }
+
+            instance->setBatching(instanceConfig.maxBatchValues, instanceConfig.maxBatchBytes);
+            instance->setSendScheduling(instanceConfig.sendScheduling);
+            instance->setResyncLimit(instanceConfig.resyncLimit);
+            instance->setAnnounceSubscriptions(instanceConfig.announceSubscriptions);
+            instance->setExtMemExport(instanceConfig.extMemExport);
+            if (instanceConfig.flowControl)
+            {
+                instance->setFlowControl(instanceConfig.flowControlConfig);
+            }
+            if (!instanceConfig.fanOutGroup.empty())
+            {
+                auto& cache = fanOutGroups[instanceConfig.fanOutGroup];
+                if (cache == nullptr)
+                {
+                    cache = std::make_shared<SerializationCache>();
+                }
+                instance->setSerializationCache(cache);
+            }
 
             // add send rules
             for (const auto& rule: instanceConfig.sendRules)
             {
-                instance->addSendRule(rule.topicLocal, rule.topicRemote, rule.queueLength, rule.isBlocking);
+                instance->addSendRule(
+                    rule.topicLocal, rule.topicRemote, rule.queueLength, rule.isBlocking, rule.prio, rule.window,
+                    rule.compression);
+                if (rule.adaptiveQueue)
+                {
+                    instance->setAdaptiveQueueLength(rule.topicRemote, rule.adaptiveLength);
+                }
             }
 
             // add receive rules
             for (const auto& rule: instanceConfig.receiveRules)
             {
-                instance->addReceiveRule(rule.topicLocal, rule.topicRemote);
+                if (rule.relay)
+                {
+                    instance->addRelayRule(rule.topicLocal, rule.topicRemote);
+                }
+                else
+                {
+                    instance->addReceiveRule(rule.topicLocal, rule.topicRemote);
+                }
             }
 
             // store instance
@@ -8,12 +8,20 @@
 
 #include "spdlog/spdlog.h"
 
+#include <algorithm>
 #include <random>
 
 namespace mcf{
 
 namespace remote {
 
+namespace {
+
+// number of recent pings the clock estimate is selected from
+constexpr std::size_t CLOCK_FILTER_SIZE = 8;
+
+} // anonymous namespace
+
 RemoteStatusTracker::RemoteStatusTracker(
     std::function<void(uint64_t)> pingSender,
     std::chrono::milliseconds pingInterval,
@@ -47,6 +55,10 @@ RemoteStatusTracker::RemoteStatusTracker(
 , _lastPingTime(other._lastPingTime)
 , _lastPongTime(other._lastPongTime)
 , _pingFreshnessValue(other._pingFreshnessValue)
+, _compressionStatistics(std::move(other._compressionStatistics))
+, _clockSamples(std::move(other._clockSamples))
+, _clockEstimate(other._clockEstimate)
+, _latencyStatistics(std::move(other._latencyStatistics))
 {}
 
 void RemoteStatusTracker::pongReceived(uint64_t freshnessValue)
@@ -116,6 +128,13 @@ void RemoteStatusTracker::sendingTimeout()
     setState(STATE_UNSURE);
 }
 
+void RemoteStatusTracker::setEventObserver(std::function<void()> observer)
+{
+    std::lock_guard<std::mutex> lck(_mtx);
+
+    _eventObserver = std::move(observer);
+}
+
 void RemoteStatusTracker::waitForEvent() {
     std::unique_lock<std::mutex> lk(_mtx);
     // couldn't verify if the argument rel_time is evaluated before lock is released
@@ -124,6 +143,91 @@ void RemoteStatusTracker::waitForEvent() {
     _notifierCv.wait_for(lk, waitMs);
 }
 
+void RemoteStatusTracker::valueCompressed(
+    const std::string& topic,
+    std::size_t rawBytes,
+    std::size_t wireBytes,
+    std::chrono::nanoseconds duration)
+{
+    std::lock_guard<std::mutex> lck(_statisticsMtx);
+    auto& statistics = _compressionStatistics[topic];
+    statistics.values++;
+    statistics.rawBytes += rawBytes;
+    statistics.wireBytes += wireBytes;
+    statistics.time += duration;
+}
+
+std::map<std::string, RemoteStatusTracker::CompressionStatistics>
+RemoteStatusTracker::getCompressionStatistics() const
+{
+    std::lock_guard<std::mutex> lck(_statisticsMtx);
+    return _compressionStatistics;
+}
+
+void RemoteStatusTracker::clockSampled(
+    std::chrono::system_clock::time_point pingSent,
+    std::chrono::system_clock::time_point pingReceived,
+    std::chrono::system_clock::time_point responseSent,
+    std::chrono::system_clock::time_point responseReceived)
+{
+    ClockEstimate sample;
+    sample.samples = 1;
+    sample.offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        ((pingReceived - pingSent) + (responseSent - responseReceived)) / 2);
+    sample.roundTrip = std::max(std::chrono::nanoseconds(0),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            (responseReceived - pingSent) - (responseSent - pingReceived)));
+
+    std::lock_guard<std::mutex> lck(_statisticsMtx);
+    _clockSamples.push_back(sample);
+    if(_clockSamples.size() > CLOCK_FILTER_SIZE)
+    {
+        _clockSamples.pop_front();
+    }
+
+    const auto best = std::min_element(_clockSamples.begin(), _clockSamples.end(),
+        [](const ClockEstimate& a, const ClockEstimate& b) { return a.roundTrip < b.roundTrip; });
+    const uint64_t samples = _clockEstimate.samples + 1;
+    _clockEstimate = *best;
+    _clockEstimate.samples = samples;
+}
+
+RemoteStatusTracker::ClockEstimate RemoteStatusTracker::getClockEstimate() const
+{
+    std::lock_guard<std::mutex> lck(_statisticsMtx);
+    return _clockEstimate;
+}
+
+void RemoteStatusTracker::valueStampReceived(
+    const std::string& topic,
+    std::chrono::system_clock::time_point sent,
+    std::chrono::system_clock::time_point received)
+{
+    std::lock_guard<std::mutex> lck(_statisticsMtx);
+    if(_clockEstimate.samples == 0)
+    {
+        return;
+    }
+
+    // an error of the estimate may result in slightly negative latencies
+    const auto latency = std::max(std::chrono::nanoseconds(0),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(received - sent) + _clockEstimate.offset);
+
+    auto& statistics = _latencyStatistics[topic];
+    statistics.values++;
+    statistics.last = latency;
+    statistics.min = std::min(statistics.min, latency);
+    statistics.max = std::max(statistics.max, latency);
+    statistics.total += latency;
+}
+
+std::map<std::string, RemoteStatusTracker::LatencyStatistics>
+RemoteStatusTracker::getLatencyStatistics() const
+{
+    std::lock_guard<std::mutex> lck(_statisticsMtx);
+    return _latencyStatistics;
+}
+
 void RemoteStatusTracker::setState(RemoteState state)
 {
     if(state == STATE_UNSURE)
@@ -139,6 +243,10 @@ void RemoteStatusTracker::setState(RemoteState state)
     _remoteState = state;
 
     _notifierCv.notify_all();
+    if(_eventObserver)
+    {
+        _eventObserver();
+    }
 }
 
 
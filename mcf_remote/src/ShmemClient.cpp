@@ -3,33 +3,239 @@
  */
 
 #include "mcf_remote/ShmemClient.h"
+#include "mcf_remote/ShmemMemfd.h"
+#include "mcf_remote/ShmemSlot.h"
 #include "mcf_remote/Remote.h"
 #include "mcf_core/ErrorMacros.h"
+#include "mcf_core/LoggingMacros.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace mcf {
 
 namespace remote {
 
+namespace
+{
+
+// time a MemfdShmem may take to reply to a request for a buffer
+constexpr timeval MEMFD_REPLY_TIMEOUT{1, 0};
+
+} // anonymous namespace
+
+class ShmemClient::MemfdConnection
+{
+public:
+    explicit MemfdConnection(int socket) : socket(socket) {}
+
+    ~MemfdConnection()
+    {
+        close(socket);
+    }
+
+    void release(uint64_t buffer)
+    {
+        if(!memfd::sendMessage(socket, memfd::Message{memfd::MessageType::RELEASE, buffer}, -1, MSG_DONTWAIT))
+        {
+            MCF_WARN("Cannot release memfd buffer {}: {}", buffer, strerror(errno));
+        }
+    }
+
+    const int socket;
+};
+
 void* ShmemClient::partitionPtr(const std::string& segmentName, bip::managed_shared_memory::handle_t handle)
 {
     openSegment(segmentName);
-    return _segment.get_address_from_handle(handle);
+    return _segment->base + handle;
+}
+
+std::shared_ptr<const void> ShmemClient::slotOwner(const void* payload)
+{
+    if(_segment && _segment->memfd)
+    {
+        // the buffer is mapped read-only, its keeper is told to reuse it
+        std::shared_ptr<void> mapping = _segment->mapping;
+        std::shared_ptr<MemfdConnection> connection = _segment->memfd;
+        const uint64_t buffer = _segment->buffer;
+        return std::shared_ptr<const void>(payload, [mapping, connection, buffer](const void*) {
+            connection->release(buffer);
+        });
+    }
+
+    std::shared_ptr<void> segment = _segment ? _segment->mapping : nullptr;
+    // the deleter keeps the segment mapped while the slot is referred to
+    return std::shared_ptr<const void>(payload, [segment](const void* ptr) {
+        (void)segment;
+        releaseSlot(ptr);
+    });
+}
+
+void ShmemClient::releaseSlot(const void* payload)
+{
+    ShmemSlotHeader::fromPayload(const_cast<void*>(payload))
+        ->refCount.fetch_sub(1, std::memory_order_release);
 }
 
 void ShmemClient::openSegment(const std::string& segmentName)
 {
     if(segmentName == _segmentName) return;
 
-    try
+    std::string socketName;
+    uint64_t buffer = 0ul;
+    const bool isMemfd = memfd::parseBufferName(segmentName, socketName, buffer);
+    const auto connection = isMemfd ? _memfdConnections.find(socketName) : _memfdConnections.end();
+    if(connection != _memfdConnections.end())
     {
-        _segment = bip::managed_shared_memory(bip::open_only, segmentName.c_str());
+        // buffers dropped by the keeper are unmapped once no value refers to them any more
+        receiveMemfdMessages(socketName, *connection->second, 0ul);
+    }
+
+    const auto known = _segments.find(segmentName);
+    if(known != _segments.end())
+    {
+        _segment = &known->second;
         _segmentName = segmentName;
+        return;
+    }
+
+    Segment segment;
+    if(isMemfd)
+    {
+        segment = openMemfdBuffer(socketName, buffer);
+    }
+    else if(!segmentName.empty() && segmentName[0] == '/')
+    {
+        // a segment file of a SegmentedShmem, its handles are offsets in the file
+        const int fd = open(segmentName.c_str(), O_RDWR);
+        struct stat status;
+        if(fd < 0 || fstat(fd, &status) != 0)
+        {
+            const int error = errno;
+            if(fd >= 0) close(fd);
+            throw std::runtime_error(fmt::format("Cannot open shared memory file {}\n    {}", segmentName, strerror(error)));
+        }
+        const size_t size = static_cast<size_t>(status.st_size);
+        void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        const int error = errno;
+        close(fd);
+        if(mapping == MAP_FAILED)
+        {
+            throw std::runtime_error(fmt::format("Cannot map shared memory file {}\n    {}", segmentName, strerror(error)));
+        }
+        segment.mapping = std::shared_ptr<void>(mapping, [size](void* ptr) { munmap(ptr, size); });
+        segment.base = static_cast<char*>(mapping);
     }
-    catch(const bip::interprocess_exception& ipe)
+    else
     {
-        throw std::runtime_error(fmt::format("Cannot open shared memory file {}\n    {}", segmentName, ipe.what()));
+        try
+        {
+            auto shmem = std::make_shared<bip::managed_shared_memory>(bip::open_only, segmentName.c_str());
+            segment.base = static_cast<char*>(shmem->get_address());
+            segment.mapping = std::move(shmem);
+        }
+        catch(const bip::interprocess_exception& ipe)
+        {
+            throw std::runtime_error(fmt::format("Cannot open shared memory file {}\n    {}", segmentName, ipe.what()));
+        }
     }
 
+    _segment = &(_segments[segmentName] = std::move(segment));
+    _segmentName = segmentName;
+}
+
+ShmemClient::Segment ShmemClient::openMemfdBuffer(const std::string& socketName, uint64_t buffer)
+{
+    std::shared_ptr<MemfdConnection>& connection = _memfdConnections[socketName];
+    if(!connection)
+    {
+        const int socket = memfd::connectSocket(socketName);
+        if(socket < 0)
+        {
+            _memfdConnections.erase(socketName);
+            throw std::runtime_error(fmt::format("Cannot connect to memfd socket @{}\n    {}", socketName, strerror(errno)));
+        }
+        setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &MEMFD_REPLY_TIMEOUT, sizeof(MEMFD_REPLY_TIMEOUT));
+        connection = std::make_shared<MemfdConnection>(socket);
+    }
+    std::shared_ptr<MemfdConnection> keeper = connection;
+
+    // the file descriptor is passed once, the buffer stays mapped for later values
+    if(!memfd::sendMessage(keeper->socket, memfd::Message{memfd::MessageType::REQUEST, buffer}))
+    {
+        _memfdConnections.erase(socketName);
+        throw std::runtime_error(fmt::format("Cannot request memfd buffer {} from @{}\n    {}", buffer, socketName, strerror(errno)));
+    }
+    const int fd = receiveMemfdMessages(socketName, *keeper, buffer);
+    if(fd < 0)
+    {
+        throw std::runtime_error(fmt::format("memfd buffer {} of @{} does not exist", buffer, socketName));
+    }
+
+    struct stat status;
+    void* mapping = MAP_FAILED;
+    size_t size = 0ul;
+    if(fstat(fd, &status) == 0)
+    {
+        size = static_cast<size_t>(status.st_size);
+        mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    const int error = errno;
+    close(fd);
+    if(mapping == MAP_FAILED)
+    {
+        throw std::runtime_error(fmt::format("Cannot map memfd buffer {} of @{}\n    {}", buffer, socketName, strerror(error)));
+    }
+
+    Segment segment;
+    segment.mapping = std::shared_ptr<void>(mapping, [size](void* ptr) { munmap(ptr, size); });
+    segment.base = static_cast<char*>(mapping);
+    segment.memfd = std::move(keeper);
+    segment.buffer = buffer;
+    return segment;
+}
+
+int ShmemClient::receiveMemfdMessages(const std::string& socketName, MemfdConnection& connection, uint64_t buffer)
+{
+    while(true)
+    {
+        memfd::Message message;
+        int fd = -1;
+        if(!memfd::receiveMessage(connection.socket, message, fd, buffer == 0ul ? MSG_DONTWAIT : 0))
+        {
+            if(buffer == 0ul && (errno == EAGAIN || errno == EWOULDBLOCK)) return -1;
+            const int error = errno;
+            _memfdConnections.erase(socketName);
+            throw std::runtime_error(fmt::format("Lost memfd socket @{}\n    {}",
+                socketName,
+                error != 0 ? strerror(error) : "closed by the keeper"));
+        }
+        if(message.type == memfd::MessageType::REPLY && message.buffer == buffer)
+        {
+            return fd;
+        }
+        if(fd >= 0) close(fd);
+        if(message.type == memfd::MessageType::DROP)
+        {
+            forgetSegment(memfd::bufferName(socketName, message.buffer));
+        }
+    }
+}
+
+void ShmemClient::forgetSegment(const std::string& segmentName)
+{
+    if(segmentName == _segmentName)
+    {
+        _segment = nullptr;
+        _segmentName.clear();
+    }
+    _segments.erase(segmentName);
 }
 
 } // end namespace remote
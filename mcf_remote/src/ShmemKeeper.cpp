@@ -3,16 +3,27 @@
  */
 
 #include "mcf_remote/ShmemKeeper.h"
+#include "mcf_remote/ShmemSlot.h"
 #include "mcf_remote/Remote.h"
 #include "mcf_core/ErrorMacros.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
 
 namespace mcf {
 
 namespace remote {
 
-SingleFileShmem::SingleFileShmem(const size_t filesize)
+SingleFileShmem::SingleFileShmem(const size_t filesize, const size_t slotsPerRing)
+: _slotsPerRing(std::max(slotsPerRing, size_t(1)))
 {
     // Create a managed shared memory segment
     try
@@ -33,6 +44,18 @@ SingleFileShmem::~SingleFileShmem()
 {
     // free owned memory
     for(auto& mem : _partitionPtrs) _segment.deallocate(mem.second.ptr);
+    for(auto& ring : _slotRings)
+    {
+        for(auto& slot : ring.second.slots)
+        {
+            // slots still referred to by received values are left to the receiver
+            if(slot.ptr
+                && static_cast<ShmemSlotHeader*>(slot.ptr)->refCount.load(std::memory_order_acquire) == 0)
+            {
+                _segment.deallocate(slot.ptr);
+            }
+        }
+    }
 
     // release flag to indicate we are not using this shared memory file any more
     _segment.deallocate(flag);
@@ -64,6 +87,51 @@ std::string SingleFileShmem::shmemFileName(const std::string& partitionid)
     return std::string("McfSharedMemory");
 }
 
+void* SingleFileShmem::acquireSlot(
+    const std::string& partitionid,
+    size_t size,
+    bip::managed_shared_memory::handle_t& handle)
+{
+    SlotRing& ring = _slotRings[partitionid];
+
+    // the first unreferenced slot, starting at the least recently handed out one
+    PartitionPtr* slot = nullptr;
+    for(size_t i = 0; i < ring.slots.size() && !slot; ++i)
+    {
+        const size_t index = (ring.next + i) % ring.slots.size();
+        PartitionPtr& candidate = ring.slots[index];
+        if(!candidate.ptr
+            || static_cast<ShmemSlotHeader*>(candidate.ptr)->refCount.load(std::memory_order_acquire) == 0)
+        {
+            slot = &candidate;
+            ring.next = (index + 1) % ring.slots.size();
+        }
+    }
+
+    if(!slot)
+    {
+        // received values may refer to their slots for as long as they live, so referenced
+        // slots are never overwritten and the ring grows instead
+        if(ring.slots.size() >= _slotsPerRing && !ring.overrunReported)
+        {
+            MCF_WARN("All {} shared memory slots of {} are in use, adding more",
+                ring.slots.size(), partitionid);
+            ring.overrunReported = true;
+        }
+        ring.slots.emplace_back();
+        slot = &ring.slots.back();
+        ring.next = 0;
+    }
+
+    increasePartitionIfNecessary(size + ShmemSlotHeader::SIZE, *slot);
+    if(!slot->ptr) return nullptr;
+
+    auto* header = new (slot->ptr) ShmemSlotHeader;
+    header->refCount.store(1, std::memory_order_release);
+    handle = _segment.get_handle_from_address(header->payload());
+    return header->payload();
+}
+
 
 void SingleFileShmem::increasePartitionIfNecessary(size_t sizeNeeded, PartitionPtr& mem)
 {
@@ -74,16 +142,300 @@ void SingleFileShmem::increasePartitionIfNecessary(size_t sizeNeeded, PartitionP
             if(mem.size > 0) _segment.deallocate(mem.ptr);
             mem.ptr = _segment.allocate(sizeNeeded + 512); // allocate extra 512 bytes to avoid frequent re-allocations
             mem.size = sizeNeeded + 512;
+            ++_allocations;
         }
         catch(const std::exception& e)
         {
             MCF_ERROR("Shared memory resize failed: {}", e.what());
             mem.size = 0ul;
             mem.ptr = nullptr;
+            ++_failedAllocations;
         }
     }
 }
 
+ShmemUsage SingleFileShmem::usage() const
+{
+    ShmemUsage usage;
+    usage.segments = 1ul;
+    usage.size = _segment.get_size();
+    usage.used = usage.size - _segment.get_free_memory();
+    usage.allocations = _allocations;
+    usage.failedAllocations = _failedAllocations;
+    return usage;
+}
+
+namespace
+{
+
+// segments are only accessed by the keeper's process under its mutex, receivers do not allocate
+using SegmentBuffer = bip::managed_external_buffer;
+
+// smallest size class of SegmentedShmem::Placement::PER_SIZE_CLASS, as power of two
+constexpr size_t MIN_SIZE_CLASS = 16ul;
+
+size_t roundUp(size_t size, size_t multiple)
+{
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+std::string sizeClass(size_t size)
+{
+    size_t bits = MIN_SIZE_CLASS;
+    while(bits < 63 && (size_t(1) << bits) < size) ++bits;
+    return "size" + std::to_string(bits);
+}
+
+} // anonymous namespace
+
+/**
+ * A segment file mapped by the keeper, unlinked on destruction
+ */
+struct SegmentedShmem::Segment
+{
+    std::string set;
+    std::string path;
+    void* mapping = MAP_FAILED;
+    size_t size = 0ul;
+    std::unique_ptr<SegmentBuffer> buffer;
+
+    ~Segment()
+    {
+        buffer.reset();
+        if(mapping != MAP_FAILED) munmap(mapping, size);
+        if(!path.empty()) unlink(path.c_str());
+    }
+};
+
+SegmentedShmem::SegmentedShmem()
+: SegmentedShmem(Config())
+{
+}
+
+SegmentedShmem::SegmentedShmem(const Config& config)
+: _config(config)
+, _pathPrefix(fmt::format("{}/{}.{}.{:x}.",
+    config.directory,
+    config.prefix,
+    getpid(),
+    // names of segments removed by a previous process with the same pid may still be mapped
+    // by long running receivers
+    std::chrono::system_clock::now().time_since_epoch().count()))
+{
+    struct statvfs fs;
+    if(statvfs(_config.directory.c_str(), &fs) != 0)
+    {
+        throw std::runtime_error(fmt::format("Cannot access shared memory directory {}: {}",
+            _config.directory,
+            strerror(errno)));
+    }
+    // the huge page size on hugetlbfs, the page size on tmpfs
+    _pageSize = std::max(static_cast<size_t>(fs.f_bsize), static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+}
+
+SegmentedShmem::~SegmentedShmem() = default;
+
+void* SegmentedShmem::partitionPtr(const std::string& partitionid)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _partitions[partitionid].ptr;
+}
+
+void* SegmentedShmem::createOrGetPartitionPtr(const std::string& partitionid, size_t size)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Partition& mem = _partitions[partitionid];
+    increasePartitionIfNecessary(partitionid, size, mem);
+    return mem.ptr;
+}
+
+bip::managed_shared_memory::handle_t SegmentedShmem::partitionHandle(const std::string& partitionid)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const Partition& mem = _partitions[partitionid];
+    return mem.segment ? mem.segment->buffer->get_handle_from_address(mem.ptr) : 0;
+}
+
+std::string SegmentedShmem::shmemFileName(const std::string& partitionid)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto partition = _partitions.find(partitionid);
+    if(partition != _partitions.end() && partition->second.segment)
+    {
+        return partition->second.segment->path;
+    }
+    const auto ring = _slotRings.find(partitionid);
+    if(ring != _slotRings.end() && ring->second.last)
+    {
+        return ring->second.last->path;
+    }
+    return std::string();
+}
+
+void* SegmentedShmem::acquireSlot(
+    const std::string& partitionid,
+    size_t size,
+    bip::managed_shared_memory::handle_t& handle)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    SlotRing& ring = _slotRings[partitionid];
+
+    // the first unreferenced slot, starting at the least recently handed out one
+    Partition* slot = nullptr;
+    for(size_t i = 0; i < ring.slots.size() && !slot; ++i)
+    {
+        const size_t index = (ring.next + i) % ring.slots.size();
+        Partition& candidate = ring.slots[index];
+        if(!candidate.ptr
+            || static_cast<ShmemSlotHeader*>(candidate.ptr)->refCount.load(std::memory_order_acquire) == 0)
+        {
+            slot = &candidate;
+            ring.next = (index + 1) % ring.slots.size();
+        }
+    }
+
+    if(!slot)
+    {
+        if(ring.slots.size() >= std::max(_config.slotsPerRing, size_t(1)) && !ring.overrunReported)
+        {
+            MCF_WARN("All {} shared memory slots of {} are in use, adding more",
+                ring.slots.size(), partitionid);
+            ring.overrunReported = true;
+        }
+        ring.slots.emplace_back();
+        slot = &ring.slots.back();
+        ring.next = 0;
+    }
+
+    if(!increasePartitionIfNecessary(partitionid, size + ShmemSlotHeader::SIZE, *slot)) return nullptr;
+
+    auto* header = new (slot->ptr) ShmemSlotHeader;
+    header->refCount.store(1, std::memory_order_release);
+    handle = slot->segment->buffer->get_handle_from_address(header->payload());
+    ring.last = slot->segment;
+    return header->payload();
+}
+
+ShmemUsage SegmentedShmem::usage() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ShmemUsage usage;
+    usage.segments = _segmentCount;
+    usage.size = _totalSize;
+    for(const auto& set : _segments)
+    {
+        for(const auto& segment : set.second)
+        {
+            usage.used += segment->size - segment->buffer->get_free_memory();
+        }
+    }
+    usage.allocations = _allocations;
+    usage.failedAllocations = _failedAllocations;
+    return usage;
+}
+
+bool SegmentedShmem::increasePartitionIfNecessary(const std::string& partitionid, size_t sizeNeeded, Partition& mem)
+{
+    if(mem.size >= sizeNeeded) return true;
+
+    deallocate(mem);
+    // allocate extra 512 bytes to avoid frequent re-allocations
+    const size_t size = sizeNeeded + 512;
+    const std::string set = _config.placement == Placement::PER_SIZE_CLASS ? sizeClass(size) : partitionid;
+
+    // the most recently added segments of the set are the least full ones
+    auto& segments = _segments[set];
+    for(auto it = segments.rbegin(); it != segments.rend() && !mem.ptr; ++it)
+    {
+        mem.ptr = (*it)->buffer->allocate(size, std::nothrow);
+        mem.segment = mem.ptr ? it->get() : nullptr;
+    }
+    if(!mem.ptr)
+    {
+        mem.segment = createSegment(set, size);
+        mem.ptr = mem.segment ? mem.segment->buffer->allocate(size, std::nothrow) : nullptr;
+    }
+    if(!mem.ptr)
+    {
+        ++_failedAllocations;
+        mem.segment = nullptr;
+        return false;
+    }
+    mem.size = size;
+    ++_allocations;
+    return true;
+}
+
+void SegmentedShmem::deallocate(Partition& mem)
+{
+    Segment* segment = mem.segment;
+    if(segment && mem.ptr) segment->buffer->deallocate(mem.ptr);
+    mem = Partition();
+    if(!segment || !segment->buffer->all_memory_deallocated()) return;
+
+    // empty segments other than the first one of their set are given back
+    auto& segments = _segments[segment->set];
+    if(segments.size() > 1 && segments.front().get() != segment)
+    {
+        for(auto& ring : _slotRings)
+        {
+            if(ring.second.last == segment) ring.second.last = nullptr;
+        }
+        _totalSize -= segment->size;
+        --_segmentCount;
+        segments.erase(std::find_if(segments.begin(), segments.end(),
+            [segment](const std::unique_ptr<Segment>& s) { return s.get() == segment; }));
+    }
+}
+
+SegmentedShmem::Segment* SegmentedShmem::createSegment(const std::string& set, size_t size)
+{
+    // room for the allocator's bookkeeping next to the allocation
+    const size_t segmentSize = roundUp(std::max(_config.segmentSize, size + size / 8 + 64 * 1024), _pageSize);
+    if((_config.maxSegments > 0 && _segmentCount >= _config.maxSegments)
+        || (_config.maxTotalSize > 0 && _totalSize + segmentSize > _config.maxTotalSize))
+    {
+        if(!_limitReported)
+        {
+            MCF_ERROR("Shared memory limit reached, {} segments of {} bytes in total, cannot add {} bytes for {}",
+                _segmentCount, _totalSize, segmentSize, set);
+            _limitReported = true;
+        }
+        return nullptr;
+    }
+
+    auto segment = std::make_unique<Segment>();
+    segment->set = set;
+    segment->size = segmentSize;
+    const std::string path = _pathPrefix + std::to_string(_nextSegment++);
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if(fd < 0)
+    {
+        MCF_ERROR("Cannot create shared memory file {}: {}", path, strerror(errno));
+        return nullptr;
+    }
+    segment->path = path;
+    if(ftruncate(fd, static_cast<off_t>(segmentSize)) == 0)
+    {
+        segment->mapping = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    const int error = errno;
+    close(fd);
+    if(segment->mapping == MAP_FAILED)
+    {
+        MCF_ERROR("Cannot map {} bytes of shared memory file {}: {}", segmentSize, segment->path, strerror(error));
+        return nullptr;
+    }
+    // handles are offsets in the file, as the allocator starts at the beginning of the mapping
+    segment->buffer = std::make_unique<SegmentBuffer>(bip::create_only, segment->mapping, segmentSize);
+
+    _totalSize += segmentSize;
+    ++_segmentCount;
+    _limitReported = false;
+    _segments[set].push_back(std::move(segment));
+    return _segments[set].back().get();
+}
+
 } // end namespace remote
 
 } // end namespace mcf
\ No newline at end of file
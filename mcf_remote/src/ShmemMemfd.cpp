@@ -0,0 +1,425 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#include "mcf_remote/ShmemMemfd.h"
+#include "mcf_remote/ShmemKeeper.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/LoggingMacros.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace mcf {
+
+namespace remote {
+
+namespace memfd {
+
+const char* const NAME_PREFIX = "memfd:";
+
+namespace {
+
+// abstract socket names start with a null byte, shown as '@'
+socklen_t socketAddress(const std::string& socketName, sockaddr_un& address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    const size_t length = std::min(socketName.size(), sizeof(address.sun_path) - 2);
+    std::memcpy(address.sun_path + 1, socketName.data(), length);
+    return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + length);
+}
+
+} // anonymous namespace
+
+std::string bufferName(const std::string& socketName, uint64_t buffer)
+{
+    return NAME_PREFIX + socketName + "#" + std::to_string(buffer);
+}
+
+bool parseBufferName(const std::string& name, std::string& socketName, uint64_t& buffer)
+{
+    const size_t prefix = std::strlen(NAME_PREFIX);
+    const size_t separator = name.rfind('#');
+    if(name.compare(0, prefix, NAME_PREFIX) != 0 || separator == std::string::npos || separator < prefix)
+    {
+        return false;
+    }
+    socketName = name.substr(prefix, separator - prefix);
+    try
+    {
+        buffer = std::stoull(name.substr(separator + 1));
+    }
+    catch(const std::exception&)
+    {
+        return false;
+    }
+    return true;
+}
+
+int listenSocket(const std::string& socketName)
+{
+    const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if(fd < 0) return -1;
+    sockaddr_un address;
+    const socklen_t length = socketAddress(socketName, address);
+    if(bind(fd, reinterpret_cast<sockaddr*>(&address), length) != 0 || listen(fd, 16) != 0)
+    {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+int connectSocket(const std::string& socketName)
+{
+    const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if(fd < 0) return -1;
+    sockaddr_un address;
+    const socklen_t length = socketAddress(socketName, address);
+    if(connect(fd, reinterpret_cast<sockaddr*>(&address), length) != 0)
+    {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+bool sendMessage(int socket, const Message& message, int fd, int flags)
+{
+    iovec data{const_cast<Message*>(&message), sizeof(message)};
+    msghdr header{};
+    header.msg_iov = &data;
+    header.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    if(fd >= 0)
+    {
+        header.msg_control = control;
+        header.msg_controllen = sizeof(control);
+        cmsghdr* rights = CMSG_FIRSTHDR(&header);
+        rights->cmsg_level = SOL_SOCKET;
+        rights->cmsg_type = SCM_RIGHTS;
+        rights->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(rights), &fd, sizeof(int));
+    }
+    return sendmsg(socket, &header, flags | MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(message));
+}
+
+bool receiveMessage(int socket, Message& message, int& fd, int flags)
+{
+    fd = -1;
+    iovec data{&message, sizeof(message)};
+    msghdr header{};
+    header.msg_iov = &data;
+    header.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    const ssize_t size = recvmsg(socket, &header, flags | MSG_CMSG_CLOEXEC);
+    for(cmsghdr* rights = CMSG_FIRSTHDR(&header); size > 0 && rights; rights = CMSG_NXTHDR(&header, rights))
+    {
+        if(rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS)
+        {
+            std::memcpy(&fd, CMSG_DATA(rights), sizeof(int));
+        }
+    }
+    if(size == 0) errno = 0;
+    if(size != static_cast<ssize_t>(sizeof(message)))
+    {
+        if(fd >= 0) close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+} // end namespace memfd
+
+/**
+ * A buffer of the pool, guarded by the keeper's mutex
+ */
+struct MemfdShmem::Buffer
+{
+    uint64_t id = 0ul;
+    int fd = -1;
+    void* mapping = MAP_FAILED;
+    size_t size = 0ul;
+    // handed out and not yet released by the receiver
+    bool inUse = false;
+
+    ~Buffer()
+    {
+        if(mapping != MAP_FAILED) munmap(mapping, size);
+        if(fd >= 0) close(fd);
+    }
+};
+
+MemfdShmem::MemfdShmem()
+: MemfdShmem(Config())
+{
+}
+
+MemfdShmem::MemfdShmem(const Config& config)
+: _config(config)
+{
+    static std::atomic<uint64_t> instances{0};
+    _socketName = fmt::format("mcf-memfd.{}.{}", getpid(), instances.fetch_add(1));
+    _listenSocket = memfd::listenSocket(_socketName);
+    _stopEvent = eventfd(0, EFD_CLOEXEC);
+    if(_listenSocket < 0 || _stopEvent < 0)
+    {
+        const int error = errno;
+        if(_listenSocket >= 0) close(_listenSocket);
+        if(_stopEvent >= 0) close(_stopEvent);
+        throw std::runtime_error(fmt::format("Cannot listen on memfd socket @{}: {}", _socketName, strerror(error)));
+    }
+    _thread = std::thread(&MemfdShmem::run, this);
+}
+
+MemfdShmem::~MemfdShmem()
+{
+    const uint64_t one = 1;
+    if(write(_stopEvent, &one, sizeof(one)) != sizeof(one))
+    {
+        MCF_ERROR("Cannot stop memfd socket thread: {}", strerror(errno));
+    }
+    _thread.join();
+    for(int connection : _connections) close(connection);
+    close(_listenSocket);
+    close(_stopEvent);
+}
+
+void* MemfdShmem::partitionPtr(const std::string& partitionid)
+{
+    return nullptr;
+}
+
+void* MemfdShmem::createOrGetPartitionPtr(const std::string& partitionid, size_t size)
+{
+    // partitions are written by the receiver as well, e.g. by ShmemRecordHandoff, which the
+    // read-only mappings of the receivers do not allow
+    MCF_ERROR("MemfdShmem only hands out slots, cannot create partition {}", partitionid);
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_failedAllocations;
+    return nullptr;
+}
+
+bip::managed_shared_memory::handle_t MemfdShmem::partitionHandle(const std::string& partitionid)
+{
+    return 0;
+}
+
+std::string MemfdShmem::shmemFileName(const std::string& partitionid)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto last = _lastBuffers.find(partitionid);
+    return last != _lastBuffers.end() ? memfd::bufferName(_socketName, last->second) : std::string();
+}
+
+void* MemfdShmem::acquireSlot(
+    const std::string& partitionid,
+    size_t size,
+    bip::managed_shared_memory::handle_t& handle)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // the smallest released buffer the value fits into
+    Buffer* buffer = nullptr;
+    for(auto& candidate : _buffers)
+    {
+        Buffer& b = *candidate.second;
+        if(!b.inUse && b.size >= size && (!buffer || b.size < buffer->size)) buffer = &b;
+    }
+    if(!buffer) buffer = createBuffer(size);
+    if(!buffer)
+    {
+        ++_failedAllocations;
+        return nullptr;
+    }
+
+    buffer->inUse = true;
+    _lastBuffers[partitionid] = buffer->id;
+    // a buffer holds one value at its start
+    handle = 0;
+    return buffer->mapping;
+}
+
+ShmemUsage MemfdShmem::usage() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ShmemUsage usage;
+    usage.segments = _buffers.size();
+    usage.size = _totalSize;
+    for(const auto& buffer : _buffers)
+    {
+        if(buffer.second->inUse) usage.used += buffer.second->size;
+    }
+    usage.allocations = _allocations;
+    usage.failedAllocations = _failedAllocations;
+    return usage;
+}
+
+MemfdShmem::Buffer* MemfdShmem::createBuffer(size_t size)
+{
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    // some headroom, so that the buffer can be reused for slightly larger values
+    const size_t bufferSize = (size + size / 8 + pageSize - 1) / pageSize * pageSize;
+
+    // released buffers too small for the value make room for it, the smallest first
+    auto exceedsLimits = [this, bufferSize] {
+        return (_config.maxBuffers > 0 && _buffers.size() >= _config.maxBuffers)
+            || (_config.maxTotalSize > 0 && _totalSize + bufferSize > _config.maxTotalSize);
+    };
+    while(exceedsLimits())
+    {
+        auto smallest = _buffers.end();
+        for(auto it = _buffers.begin(); it != _buffers.end(); ++it)
+        {
+            if(!it->second->inUse && (smallest == _buffers.end() || it->second->size < smallest->second->size))
+            {
+                smallest = it;
+            }
+        }
+        if(smallest == _buffers.end())
+        {
+            MCF_ERROR("memfd buffer limit reached, {} buffers of {} bytes in total are in use",
+                _buffers.size(), _totalSize);
+            return nullptr;
+        }
+        dropBuffer(smallest->first);
+    }
+
+    auto buffer = std::make_unique<Buffer>();
+    buffer->id = _nextBuffer++;
+    buffer->size = bufferSize;
+    buffer->fd = memfd_create(("mcf-" + std::to_string(buffer->id)).c_str(), MFD_CLOEXEC);
+    if(buffer->fd < 0 || ftruncate(buffer->fd, static_cast<off_t>(bufferSize)) != 0)
+    {
+        MCF_ERROR("Cannot create memfd buffer of {} bytes: {}", bufferSize, strerror(errno));
+        return nullptr;
+    }
+    buffer->mapping = mmap(nullptr, bufferSize, PROT_READ | PROT_WRITE, MAP_SHARED, buffer->fd, 0);
+    if(buffer->mapping == MAP_FAILED)
+    {
+        MCF_ERROR("Cannot map memfd buffer of {} bytes: {}", bufferSize, strerror(errno));
+        return nullptr;
+    }
+
+    _totalSize += bufferSize;
+    ++_allocations;
+    Buffer* created = buffer.get();
+    _buffers[created->id] = std::move(buffer);
+    return created;
+}
+
+void MemfdShmem::dropBuffer(uint64_t id)
+{
+    const auto buffer = _buffers.find(id);
+    _totalSize -= buffer->second->size;
+    _buffers.erase(buffer);
+    // receivers unmap the buffer once their values do not refer to it any more
+    for(int connection : _connections)
+    {
+        memfd::sendMessage(connection, memfd::Message{memfd::MessageType::DROP, id}, -1, MSG_DONTWAIT);
+    }
+}
+
+void MemfdShmem::run()
+{
+    std::vector<pollfd> fds;
+    while(true)
+    {
+        fds.clear();
+        fds.push_back(pollfd{_stopEvent, POLLIN, 0});
+        fds.push_back(pollfd{_listenSocket, POLLIN, 0});
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for(int connection : _connections) fds.push_back(pollfd{connection, POLLIN, 0});
+        }
+        if(poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if(errno == EINTR) continue;
+            MCF_ERROR("memfd socket thread stopped: {}", strerror(errno));
+            return;
+        }
+        if(fds[0].revents) return;
+
+        if(fds[1].revents & POLLIN)
+        {
+            const int connection = accept4(_listenSocket, nullptr, nullptr, SOCK_CLOEXEC);
+            ucred credentials{};
+            socklen_t length = sizeof(credentials);
+            if(connection >= 0)
+            {
+                // only processes of the same user get the buffers
+                if(getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0
+                    && credentials.uid == geteuid())
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _connections.push_back(connection);
+                }
+                else
+                {
+                    MCF_WARN("Rejected memfd connection of process {}", credentials.pid);
+                    close(connection);
+                }
+            }
+        }
+
+        for(size_t i = 2; i < fds.size(); ++i)
+        {
+            if(fds[i].revents && !serve(fds[i].fd))
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _connections.erase(std::find(_connections.begin(), _connections.end(), fds[i].fd));
+                close(fds[i].fd);
+            }
+        }
+    }
+}
+
+bool MemfdShmem::serve(int connection)
+{
+    memfd::Message message;
+    int fd = -1;
+    if(!memfd::receiveMessage(connection, message, fd, MSG_DONTWAIT))
+    {
+        return errno == EAGAIN || errno == EINTR;
+    }
+    if(fd >= 0) close(fd);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto buffer = _buffers.find(message.buffer);
+    switch(message.type)
+    {
+    case memfd::MessageType::REQUEST:
+        // the file descriptor is passed once, the receiver keeps the buffer mapped
+        return memfd::sendMessage(connection,
+            memfd::Message{memfd::MessageType::REPLY, message.buffer},
+            buffer != _buffers.end() ? buffer->second->fd : -1);
+    case memfd::MessageType::RELEASE:
+        if(buffer != _buffers.end()) buffer->second->inUse = false;
+        return true;
+    default:
+        MCF_WARN("Unexpected memfd message {}", static_cast<uint32_t>(message.type));
+        return false;
+    }
+}
+
+} // end namespace remote
+
+} // end namespace mcf
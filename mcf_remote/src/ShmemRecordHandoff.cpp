@@ -0,0 +1,332 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#include "mcf_remote/ShmemRecordHandoff.h"
+#include "mcf_remote/Remote.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/IdGeneratorInterface.h"
+#include "mcf_core/ThreadName.h"
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+namespace mcf {
+
+namespace remote {
+
+namespace {
+
+class IdInjector : public IidGenerator {
+public:
+    explicit IdInjector(uint64_t id) : fId(id) {}
+    void injectId(Value& value) const override { setId(value, fId); }
+
+private:
+    const uint64_t fId;
+};
+
+} // anonymous namespace
+
+// shared between processes, the atomics must not depend on a lock of one process
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "ShmemRecordRing needs lock-free 64 bit atomics");
+
+struct ShmemRecordRing::Control {
+    std::atomic<uint64_t> head;
+    // the positions are written by different processes, keep them on different cache lines
+    char headPadding[56];
+    std::atomic<uint64_t> tail;
+    char tailPadding[56];
+    uint64_t capacity;
+};
+
+constexpr size_t ShmemRecordRing::ENTRY_ALIGNMENT;
+constexpr uint32_t ShmemRecordRing::WRAP;
+constexpr size_t ShmemRecordHandoff::DEFAULT_CAPACITY;
+constexpr std::chrono::milliseconds ShmemRecordHandoff::CONTROL_TIMEOUT;
+constexpr std::chrono::milliseconds ShmemRecordReceiver::POLL_INTERVAL;
+
+size_t ShmemRecordRing::partitionSize(size_t capacity)
+{
+    return sizeof(Control) + entrySize(capacity);
+}
+
+void ShmemRecordRing::init(void* partition, size_t capacity)
+{
+    auto* control = new (partition) Control();
+    control->head.store(0);
+    control->tail.store(0);
+    control->capacity = entrySize(capacity);
+}
+
+ShmemRecordRing::ShmemRecordRing(void* partition)
+: fControl(static_cast<Control*>(partition))
+, fData(partition != nullptr ? static_cast<char*>(partition) + sizeof(Control) : nullptr)
+{}
+
+size_t ShmemRecordRing::entrySize(size_t dataSize)
+{
+    return (dataSize + ENTRY_ALIGNMENT - 1) / ENTRY_ALIGNMENT * ENTRY_ALIGNMENT;
+}
+
+int ShmemRecordRing::write(const iovec* iov, size_t count)
+{
+    size_t dataSize = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        dataSize += iov[i].iov_len;
+    }
+    const uint64_t capacity = fControl->capacity;
+    const uint64_t size = entrySize(sizeof(uint32_t) + dataSize);
+    if (size > capacity || dataSize >= WRAP)
+    {
+        return EMSGSIZE;
+    }
+
+    uint64_t head = fControl->head.load(std::memory_order_relaxed);
+    const uint64_t tail = fControl->tail.load(std::memory_order_acquire);
+    uint64_t offset = head % capacity;
+    const uint64_t contiguous = capacity - offset;
+    const uint64_t needed = size <= contiguous ? size : size + contiguous;
+    if (head + needed - tail > capacity)
+    {
+        return EAGAIN;
+    }
+    if (size > contiguous)
+    {
+        // the entries are aligned, so there is always room for the marker
+        const uint32_t wrap = WRAP;
+        std::memcpy(fData + offset, &wrap, sizeof(wrap));
+        head += contiguous;
+        offset = 0;
+    }
+
+    const uint32_t size32 = static_cast<uint32_t>(dataSize);
+    std::memcpy(fData + offset, &size32, sizeof(size32));
+    char* out = fData + offset + sizeof(size32);
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::memcpy(out, iov[i].iov_base, iov[i].iov_len);
+        out += iov[i].iov_len;
+    }
+    fControl->head.store(head + size, std::memory_order_release);
+    return 0;
+}
+
+bool ShmemRecordRing::peek(const char*& data, size_t& size)
+{
+    const uint64_t capacity = fControl->capacity;
+    uint64_t tail = fControl->tail.load(std::memory_order_relaxed);
+    const uint64_t head = fControl->head.load(std::memory_order_acquire);
+    if (tail == head)
+    {
+        return false;
+    }
+    uint64_t offset = tail % capacity;
+    uint32_t size32;
+    std::memcpy(&size32, fData + offset, sizeof(size32));
+    if (size32 == WRAP)
+    {
+        // the entry following the marker was published together with it
+        tail += capacity - offset;
+        fControl->tail.store(tail, std::memory_order_release);
+        offset = 0;
+        std::memcpy(&size32, fData, sizeof(size32));
+    }
+    data = fData + offset + sizeof(size32);
+    size = size32;
+    fPeeked = entrySize(sizeof(size32) + size32);
+    return true;
+}
+
+void ShmemRecordRing::release()
+{
+    const uint64_t tail = fControl->tail.load(std::memory_order_relaxed);
+    fControl->tail.store(tail + fPeeked, std::memory_order_release);
+    fPeeked = 0;
+}
+
+ShmemRecordHandoff::ShmemRecordHandoff(ShmemKeeper& keeper, const std::string& partitionId,
+                                       size_t capacity)
+: fKeeper(keeper)
+, fPartitionId(partitionId)
+{
+    void* partition = fKeeper.createOrGetPartitionPtr(
+        fPartitionId, ShmemRecordRing::partitionSize(capacity));
+    if (partition == nullptr)
+    {
+        MCF_THROW_RUNTIME(fmt::format(
+            "Cannot allocate {} bytes of shared memory for the record handoff", capacity));
+    }
+    ShmemRecordRing::init(partition, capacity);
+    fRing = ShmemRecordRing(partition);
+}
+
+std::string ShmemRecordHandoff::shmemFileName() const
+{
+    return fKeeper.shmemFileName(fPartitionId);
+}
+
+bip::managed_shared_memory::handle_t ShmemRecordHandoff::partitionHandle() const
+{
+    return fKeeper.partitionHandle(fPartitionId);
+}
+
+int ShmemRecordHandoff::open(const std::string& filename)
+{
+    return writeControl(ShmemRecordRing::OPEN, filename);
+}
+
+int ShmemRecordHandoff::close()
+{
+    return writeControl(ShmemRecordRing::CLOSE, "");
+}
+
+int ShmemRecordHandoff::handOff(const std::string& topic,
+                                std::chrono::high_resolution_clock::time_point time,
+                                const ValuePtr& value,
+                                uint64_t seq,
+                                const TypeRegistry::TypemapEntry& typeInfo,
+                                bool extMem)
+{
+    fValueBuffer.clear();
+    const void* ptr = nullptr;
+    size_t len = 0;
+    TypeRegistry::packValue(fValueBuffer, value, typeInfo, ptr, len, extMem);
+    if (ptr == nullptr)
+    {
+        len = 0;
+    }
+
+    ShmemRecordRing::EntryHeader header;
+    header.kind = ShmemRecordRing::VALUE;
+    header.name = topic;
+    header.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    header.tid = typeInfo.id;
+    header.vid = value->id();
+    header.seq = seq;
+    header.valueSize = fValueBuffer.size();
+    header.extMemSize = len;
+    fHeaderBuffer.clear();
+    msgpack::pack(fHeaderBuffer, header);
+
+    const iovec iov[] = {
+        iovec{fHeaderBuffer.data(), fHeaderBuffer.size()},
+        iovec{fValueBuffer.data(), fValueBuffer.size()},
+        iovec{const_cast<void*>(ptr), len}
+    };
+    return fRing.write(iov, len > 0 ? 3 : 2);
+}
+
+int ShmemRecordHandoff::writeControl(ShmemRecordRing::Kind kind, const std::string& name)
+{
+    ShmemRecordRing::EntryHeader header{kind, name, 0, "", 0, 0, 0};
+    fHeaderBuffer.clear();
+    msgpack::pack(fHeaderBuffer, header);
+    const iovec iov{fHeaderBuffer.data(), fHeaderBuffer.size()};
+
+    const auto deadline = std::chrono::steady_clock::now() + CONTROL_TIMEOUT;
+    int result = fRing.write(&iov, 1);
+    while (result == EAGAIN && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(ShmemRecordReceiver::POLL_INTERVAL);
+        result = fRing.write(&iov, 1);
+    }
+    return result == EAGAIN ? ETIMEDOUT : result;
+}
+
+ShmemRecordReceiver::ShmemRecordReceiver(const TypeRegistry& typeRegistry,
+                                         ValueRecorder& recorder,
+                                         const std::string& shmemFileName,
+                                         bip::managed_shared_memory::handle_t partitionHandle)
+: fTypeRegistry(typeRegistry)
+, fRecorder(recorder)
+{
+    fRing = ShmemRecordRing(fClient.partitionPtr(shmemFileName, partitionHandle));
+    fThread = std::thread([this] { run(); });
+}
+
+ShmemRecordReceiver::~ShmemRecordReceiver()
+{
+    fStop = true;
+    fThread.join();
+}
+
+void ShmemRecordReceiver::run()
+{
+    setThreadName("ShmemRecordR");
+    while (!fStop)
+    {
+        const char* data = nullptr;
+        size_t size = 0;
+        if (!fRing.peek(data, size))
+        {
+            std::this_thread::sleep_for(POLL_INTERVAL);
+            continue;
+        }
+        receive(data, size);
+        // the value has been copied out of the ring
+        fRing.release();
+    }
+}
+
+void ShmemRecordReceiver::receive(const char* data, size_t size)
+{
+    try
+    {
+        size_t offset = 0;
+        auto headerHandle = msgpack::unpack(data, size, offset);
+        const auto header = headerHandle.get().as<ShmemRecordRing::EntryHeader>();
+        switch (header.kind)
+        {
+        case ShmemRecordRing::OPEN:
+            fRecorder.start(header.name);
+            break;
+        case ShmemRecordRing::CLOSE:
+            fRecorder.stop();
+            break;
+        case ShmemRecordRing::VALUE:
+        {
+            if (header.valueSize > size - offset || header.extMemSize > size - offset - header.valueSize)
+            {
+                MCF_ERROR("Malformed value of {} in the record handoff", header.name);
+                break;
+            }
+            const auto* typeinfoPtr = fTypeRegistry.findTypeInfo(header.tid);
+            if (typeinfoPtr == nullptr)
+            {
+                MCF_ERROR("Type of handed over value not present in type registry: {}", header.tid);
+                break;
+            }
+            // decoded into a zone reused by all handed over values of this thread
+            static thread_local msgpack::zone zone;
+            zone.clear();
+            size_t valueOffset = 0;
+            bool referenced = false;
+            msgpack::object obj = msgpack::unpack(
+                zone, data + offset, header.valueSize, valueOffset, referenced, &impl::referenceBuffer);
+            const char* extMem = header.extMemSize > 0 ? data + offset + header.valueSize : nullptr;
+            bool isExtMem = false;
+            std::shared_ptr<Value> value =
+                TypeRegistry::unpackSharedValue(*typeinfoPtr, obj, extMem, header.extMemSize, isExtMem);
+            IdInjector(header.vid).injectId(*value);
+            const std::chrono::high_resolution_clock::time_point time(
+                std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+                    std::chrono::nanoseconds(header.timeNs)));
+            fRecorder.recordValue(header.name, ValuePtr(std::move(value)), time, header.seq);
+            break;
+        }
+        default:
+            MCF_ERROR("Unknown entry kind {} in the record handoff", static_cast<int>(header.kind));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        MCF_ERROR("Cannot receive handed over value: {}", e.what());
+    }
+}
+
+} // end namespace remote
+
+} // end namespace mcf
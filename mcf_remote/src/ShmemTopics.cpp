@@ -0,0 +1,775 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#include "mcf_remote/ShmemTopics.h"
+#include "mcf_remote/Remote.h"
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/IdGeneratorInterface.h"
+#include "mcf_core/LoggingMacros.h"
+#include "mcf_core/ThreadName.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iterator>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace mcf {
+
+namespace remote {
+
+namespace {
+
+// "McfTop02", changes with the layout of the segment
+constexpr uint64_t MAGIC = 0x3230706f5466634dull;
+constexpr size_t CACHE_LINE = 64;
+// time a process opening an existing segment waits for its creator to initialize it
+constexpr std::chrono::milliseconds INIT_TIMEOUT(1000);
+constexpr int OPEN_ATTEMPTS = 10;
+
+size_t roundUp(size_t size)
+{
+    return (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+/**
+ * Locks the robust mutex of the segment, recovering it from a process which died holding it
+ */
+class SegmentLock
+{
+public:
+    explicit SegmentLock(pthread_mutex_t& mutex) : fMutex(mutex)
+    {
+        const int result = pthread_mutex_lock(&fMutex);
+        if (result == EOWNERDEAD)
+        {
+            // every change made under the lock is a single store of the header, nothing to repair
+            pthread_mutex_consistent(&fMutex);
+        }
+        else if (result != 0)
+        {
+            MCF_THROW_RUNTIME(fmt::format("Cannot lock the shared topic segment: {}", std::strerror(result)));
+        }
+    }
+
+    ~SegmentLock()
+    {
+        pthread_mutex_unlock(&fMutex);
+    }
+
+    SegmentLock(const SegmentLock&) = delete;
+    SegmentLock& operator=(const SegmentLock&) = delete;
+
+private:
+    pthread_mutex_t& fMutex;
+};
+
+bool processGone(int32_t pid)
+{
+    return pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+class IdInjector : public IidGenerator {
+public:
+    explicit IdInjector(uint64_t id) : fId(id) {}
+    void injectId(Value& value) const override { setId(value, fId); }
+
+private:
+    const uint64_t fId;
+};
+
+/**
+ * Header of an entry, followed by the packed value and its ext mem data
+ */
+struct EntryHeader
+{
+    uint64_t typeId;
+    uint64_t valueId;
+    uint64_t valueSeq;
+    uint64_t valueSize;
+    uint64_t extMemSize;
+};
+
+// set on the thread of a bridge while it sets values received from the segment
+thread_local const void* tDelivering = nullptr;
+
+uint64_t nextWriterId()
+{
+    static std::atomic<uint32_t> counter{0};
+    return (static_cast<uint64_t>(getpid()) << 32) | counter.fetch_add(1);
+}
+
+} // anonymous namespace
+
+// shared between processes, the atomics must not depend on a lock of one process
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "ShmemTopicSegment needs lock-free 64 bit atomics");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words must be plain 32 bit");
+
+struct ShmemTopicSegment::Slot
+{
+    std::atomic<uint64_t> stamp;
+    // atomics, so that reading them concurrently with a writer is defined
+    std::atomic<uint64_t> writerId;
+    std::atomic<uint64_t> size;
+    std::atomic<int32_t> pid;
+    char padding[CACHE_LINE - 3 * sizeof(uint64_t) - sizeof(int32_t)];
+
+    char* data()
+    {
+        return reinterpret_cast<char*>(this) + sizeof(Slot);
+    }
+
+    const char* data() const
+    {
+        return reinterpret_cast<const char*>(this) + sizeof(Slot);
+    }
+};
+
+struct ShmemTopicSegment::Topic
+{
+    char name[MAX_TOPIC_LENGTH + 1];
+    uint64_t offset;
+    // bytes of a slot including its header
+    uint64_t slotSize;
+    uint32_t slots;
+    // written by all writers of the topic, keep them away from the layout read by everyone
+    alignas(CACHE_LINE) std::atomic<uint64_t> claimed;
+    alignas(CACHE_LINE) std::atomic<uint64_t> committed;
+};
+
+struct ShmemTopicSegment::Header
+{
+    std::atomic<uint64_t> magic;
+    uint64_t size;
+    pthread_mutex_t mutex;
+    // protected by the mutex
+    uint32_t attached;
+    uint32_t topicCount;
+    uint64_t used;
+    alignas(CACHE_LINE) std::atomic<uint32_t> notifications;
+    std::atomic<uint32_t> waiters;
+    alignas(CACHE_LINE) Topic topics[MAX_TOPICS];
+};
+
+constexpr size_t ShmemTopicSegment::DEFAULT_SIZE;
+constexpr size_t ShmemTopicSegment::MAX_TOPICS;
+constexpr size_t ShmemTopicSegment::MAX_TOPIC_LENGTH;
+constexpr std::chrono::milliseconds ShmemTopicSegment::SLOT_TAKEOVER_TIMEOUT;
+constexpr uint32_t ShmemTopicBridge::DEFAULT_SLOTS;
+constexpr std::chrono::milliseconds ShmemTopicBridge::POLL_INTERVAL;
+constexpr std::chrono::milliseconds ShmemTopicBridge::PENDING_TIMEOUT;
+
+ShmemTopicSegment::ShmemTopicSegment(const std::string& name, size_t size)
+: fName(name)
+, fPid(static_cast<int32_t>(getpid()))
+{
+    static_assert(sizeof(Slot) == CACHE_LINE, "slot payloads must be cache line aligned");
+    if (size < roundUp(sizeof(Header)))
+    {
+        MCF_THROW_RUNTIME(fmt::format("Shared topic segment {} needs at least {} bytes", fName, roundUp(sizeof(Header))));
+    }
+
+    for (int attempt = 0; fHeader == nullptr; ++attempt)
+    {
+        if (attempt == OPEN_ATTEMPTS)
+        {
+            MCF_THROW_RUNTIME(fmt::format("Cannot attach to the shared topic segment {}", fName));
+        }
+
+        bool created = true;
+        int fd = shm_open(fName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660);
+        if (fd < 0 && errno == EEXIST)
+        {
+            created = false;
+            fd = shm_open(fName.c_str(), O_RDWR, 0);
+            if (fd < 0 && errno == ENOENT)
+            {
+                // removed by the last process detaching in the meantime
+                continue;
+            }
+        }
+        if (fd < 0)
+        {
+            MCF_THROW_RUNTIME(fmt::format("Cannot open the shared topic segment {}: {}", fName, std::strerror(errno)));
+        }
+
+        if (created)
+        {
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                const int error = errno;
+                close(fd);
+                shm_unlink(fName.c_str());
+                MCF_THROW_RUNTIME(fmt::format("Cannot size the shared topic segment {}: {}", fName, std::strerror(error)));
+            }
+            fSize = size;
+        }
+        else
+        {
+            // the creator sizes the segment right after creating it
+            const auto deadline = std::chrono::steady_clock::now() + INIT_TIMEOUT;
+            struct stat status{};
+            while (fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) < sizeof(Header)
+                   && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            fSize = static_cast<size_t>(status.st_size);
+            if (fSize < sizeof(Header))
+            {
+                close(fd);
+                continue;
+            }
+        }
+
+        fMemory = mmap(nullptr, fSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        const int error = errno;
+        close(fd);
+        if (fMemory == MAP_FAILED)
+        {
+            fMemory = nullptr;
+            if (created)
+            {
+                shm_unlink(fName.c_str());
+            }
+            MCF_THROW_RUNTIME(fmt::format("Cannot map the shared topic segment {}: {}", fName, std::strerror(error)));
+        }
+        auto* header = static_cast<Header*>(fMemory);
+
+        if (created)
+        {
+            // the memory of a new segment is zeroed, which is the initial state of all atomics
+            header->size = fSize;
+            pthread_mutexattr_t attributes;
+            pthread_mutexattr_init(&attributes);
+            pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+            pthread_mutex_init(&header->mutex, &attributes);
+            pthread_mutexattr_destroy(&attributes);
+            header->attached = 1;
+            header->topicCount = 0;
+            header->used = roundUp(sizeof(Header));
+            header->magic.store(MAGIC, std::memory_order_release);
+            fHeader = header;
+            break;
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + INIT_TIMEOUT;
+        while (header->magic.load(std::memory_order_acquire) != MAGIC && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (header->magic.load(std::memory_order_acquire) != MAGIC || header->size != fSize)
+        {
+            munmap(fMemory, fSize);
+            fMemory = nullptr;
+            MCF_THROW_RUNTIME(fmt::format("{} is no shared topic segment of this version", fName));
+        }
+
+        bool removed = false;
+        {
+            SegmentLock lock(header->mutex);
+            // the last process detaching removes the segment while holding the lock
+            removed = header->attached == 0;
+            if (!removed)
+            {
+                ++header->attached;
+                fHeader = header;
+            }
+        }
+        if (removed)
+        {
+            munmap(fMemory, fSize);
+            fMemory = nullptr;
+        }
+    }
+}
+
+ShmemTopicSegment::~ShmemTopicSegment()
+{
+    try
+    {
+        SegmentLock lock(fHeader->mutex);
+        if (--fHeader->attached == 0)
+        {
+            shm_unlink(fName.c_str());
+        }
+    }
+    catch (const std::exception& e)
+    {
+        MCF_ERROR("Cannot detach from the shared topic segment {}: {}", fName, e.what());
+    }
+    munmap(fMemory, fSize);
+}
+
+uint32_t ShmemTopicSegment::addTopic(const std::string& topic, size_t slotSize, uint32_t slots)
+{
+    if (topic.size() > MAX_TOPIC_LENGTH)
+    {
+        MCF_THROW_RUNTIME(fmt::format("Topic {} is too long to be shared, {} characters at most", topic, MAX_TOPIC_LENGTH));
+    }
+    MCF_ASSERT(slots > 0, "A shared topic needs at least one slot");
+
+    SegmentLock lock(fHeader->mutex);
+    for (uint32_t index = 0; index < fHeader->topicCount; ++index)
+    {
+        const Topic& entry = fHeader->topics[index];
+        if (topic != entry.name)
+        {
+            continue;
+        }
+        if (entry.slotSize - sizeof(Slot) < slotSize || entry.slots != slots)
+        {
+            MCF_WARN_NOFILELINE("Topic {} is shared with {} slots of {} bytes, not with {} slots of {} bytes",
+                                topic, entry.slots, entry.slotSize - sizeof(Slot), slots, slotSize);
+        }
+        return index;
+    }
+
+    const uint64_t slotBytes = roundUp(sizeof(Slot) + slotSize);
+    if (fHeader->topicCount == MAX_TOPICS || slotBytes * slots > fHeader->size - fHeader->used)
+    {
+        MCF_THROW_RUNTIME(fmt::format("No room left in the shared topic segment {} for topic {}", fName, topic));
+    }
+    // the memory was never used before, its slots are zeroed
+    Topic& entry = fHeader->topics[fHeader->topicCount];
+    std::strncpy(entry.name, topic.c_str(), sizeof(entry.name));
+    entry.offset = fHeader->used;
+    entry.slotSize = slotBytes;
+    entry.slots = slots;
+    fHeader->used += slotBytes * slots;
+    return fHeader->topicCount++;
+}
+
+ShmemTopicSegment::Topic& ShmemTopicSegment::topic(uint32_t index) const
+{
+    return fHeader->topics[index];
+}
+
+ShmemTopicSegment::Slot& ShmemTopicSegment::slot(const Topic& topic, uint64_t seq) const
+{
+    char* memory = static_cast<char*>(fMemory) + topic.offset + (seq % topic.slots) * topic.slotSize;
+    return *reinterpret_cast<Slot*>(memory);
+}
+
+int ShmemTopicSegment::beginWrite(uint32_t index, size_t size, WriteTicket& ticket, void*& data)
+{
+    Topic& entry = topic(index);
+    if (size > entry.slotSize - sizeof(Slot))
+    {
+        return EMSGSIZE;
+    }
+    const uint64_t seq = entry.claimed.fetch_add(1, std::memory_order_relaxed) + 1;
+    Slot& target = slot(entry, seq);
+    const uint64_t busy = 2 * seq - 1;
+
+    uint64_t stamp = target.stamp.load(std::memory_order_relaxed);
+    std::chrono::steady_clock::time_point busySince;
+    uint64_t busyStamp = 0;
+    for (;;)
+    {
+        if (stamp >= busy)
+        {
+            return EAGAIN;
+        }
+        if (stamp % 2 == 1)
+        {
+            // the writer of an earlier entry of the slot is not done, it only loses the slot if it died
+            const auto now = std::chrono::steady_clock::now();
+            if (stamp != busyStamp)
+            {
+                busyStamp = stamp;
+                busySince = now;
+            }
+            if (now - busySince < SLOT_TAKEOVER_TIMEOUT
+                || !processGone(target.pid.load(std::memory_order_relaxed)))
+            {
+                std::this_thread::yield();
+                stamp = target.stamp.load(std::memory_order_relaxed);
+                continue;
+            }
+        }
+        if (target.stamp.compare_exchange_weak(stamp, busy, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+    // the odd stamp must be visible before any byte of the entry
+    std::atomic_thread_fence(std::memory_order_release);
+    target.pid.store(fPid, std::memory_order_relaxed);
+
+    ticket.topic = index;
+    ticket.seq = seq;
+    ticket.slot = &target;
+    data = target.data();
+    return 0;
+}
+
+void ShmemTopicSegment::commitWrite(const WriteTicket& ticket, uint64_t writerId, size_t size)
+{
+    Topic& entry = topic(ticket.topic);
+    Slot& target = *static_cast<Slot*>(ticket.slot);
+    target.writerId.store(writerId, std::memory_order_relaxed);
+    target.size.store(size, std::memory_order_relaxed);
+    uint64_t busy = 2 * ticket.seq - 1;
+    if (!target.stamp.compare_exchange_strong(busy, 2 * ticket.seq, std::memory_order_release,
+                                              std::memory_order_relaxed))
+    {
+        // taken over by another writer
+        return;
+    }
+
+    uint64_t committed = entry.committed.load(std::memory_order_relaxed);
+    while (committed < ticket.seq
+           && !entry.committed.compare_exchange_weak(committed, ticket.seq, std::memory_order_release,
+                                                     std::memory_order_relaxed))
+    {
+    }
+    notify();
+}
+
+uint32_t ShmemTopicSegment::slots(uint32_t index) const
+{
+    return topic(index).slots;
+}
+
+uint64_t ShmemTopicSegment::lastSeq(uint32_t index) const
+{
+    return topic(index).committed.load(std::memory_order_acquire);
+}
+
+ShmemTopicSegment::ReadResult ShmemTopicSegment::read(uint32_t index, uint64_t seq, std::vector<char>& data,
+                                                      uint64_t& writerId) const
+{
+    const Topic& entry = topic(index);
+    const Slot& source = slot(entry, seq);
+    const uint64_t complete = 2 * seq;
+    const uint64_t stamp = source.stamp.load(std::memory_order_acquire);
+    if (stamp < complete)
+    {
+        return ReadResult::PENDING;
+    }
+    if (stamp > complete)
+    {
+        return ReadResult::LOST;
+    }
+
+    writerId = source.writerId.load(std::memory_order_relaxed);
+    const size_t size = std::min<size_t>(source.size.load(std::memory_order_relaxed), entry.slotSize - sizeof(Slot));
+    // may race with a writer taking over the slot, which the stamp tells afterwards
+    data.assign(source.data(), source.data() + size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (source.stamp.load(std::memory_order_relaxed) != stamp)
+    {
+        return ReadResult::LOST;
+    }
+    return ReadResult::OK;
+}
+
+uint32_t ShmemTopicSegment::notifications() const
+{
+    return fHeader->notifications.load(std::memory_order_seq_cst);
+}
+
+void ShmemTopicSegment::wait(uint32_t seen, std::chrono::milliseconds timeout) const
+{
+    // paired with notify(): either the writer sees the waiter or the waiter sees the new count
+    fHeader->waiters.fetch_add(1, std::memory_order_seq_cst);
+    if (fHeader->notifications.load(std::memory_order_seq_cst) == seen)
+    {
+        const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        const timespec relative{
+            static_cast<time_t>(seconds.count()),
+            static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(timeout - seconds).count())};
+        // not FUTEX_PRIVATE_FLAG, the word is shared between processes
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&fHeader->notifications), FUTEX_WAIT, seen, &relative,
+                nullptr, 0);
+    }
+    fHeader->waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void ShmemTopicSegment::notify()
+{
+    fHeader->notifications.fetch_add(1, std::memory_order_seq_cst);
+    if (fHeader->waiters.load(std::memory_order_seq_cst) > 0)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&fHeader->notifications), FUTEX_WAKE, INT_MAX, nullptr,
+                nullptr, 0);
+    }
+}
+
+/**
+ * Receives the values written to a shared topic in this process and writes them into the segment
+ *
+ * Holds everything it needs by itself, as the value store may still notify it after the bridge
+ * removed it.
+ */
+class ShmemTopicBridge::Writer : public IValueReceiver
+{
+public:
+    Writer(const ValueStore& valueStore, const ValueStore::TopicHandle& handle,
+           std::shared_ptr<ShmemTopicSegment> segment, uint32_t index, uint64_t writerId, const void* bridge)
+    : fValueStore(valueStore)
+    , fHandle(handle)
+    , fSegment(std::move(segment))
+    , fIndex(index)
+    , fWriterId(writerId)
+    , fBridge(bridge)
+    {}
+
+    void receive(const std::string& topic, ValuePtr& value) override
+    {
+        receive(topic, value, 0);
+    }
+
+    void receive(const std::string& topic, ValuePtr& value, uint64_t seq) override
+    {
+        if (tDelivering == fBridge)
+        {
+            // received from the segment by the bridge
+            return;
+        }
+        const auto* typeInfo = fValueStore.findTypeInfo(fHandle, *value);
+        if (typeInfo == nullptr || typeInfo->codec == nullptr)
+        {
+            reportOnce(fmt::format("Value of unregistered type on shared topic {} is not shared", topic));
+            return;
+        }
+
+        EntryHeader header;
+        header.typeId = typeInfo->numericId;
+        header.valueId = value->id();
+        header.valueSeq = seq;
+        header.valueSize = TypeRegistry::packedSize(*value, *typeInfo);
+        const void* extMem = typeInfo->codec->extMemPtr(*value);
+        header.extMemSize = extMem != nullptr ? typeInfo->codec->extMemSize(*value) : 0;
+        const size_t size = sizeof(header) + header.valueSize + header.extMemSize;
+
+        ShmemTopicSegment::WriteTicket ticket;
+        void* data = nullptr;
+        const int result = fSegment->beginWrite(fIndex, size, ticket, data);
+        if (result == EMSGSIZE)
+        {
+            reportOnce(fmt::format("Value of {} bytes exceeds the slots of shared topic {}", size, topic));
+            return;
+        }
+        if (result != 0)
+        {
+            // a later value of the topic got the slot
+            return;
+        }
+
+        size_t written = 0;
+        try
+        {
+            char* out = static_cast<char*>(data);
+            std::memcpy(out, &header, sizeof(header));
+            SpanWriter writer(out + sizeof(header), header.valueSize);
+            msgpack::packer<SpanWriter> packer(writer);
+            TypeRegistry::pack(packer, *value, *typeInfo);
+            if (header.extMemSize > 0)
+            {
+                std::memcpy(out + sizeof(header) + header.valueSize, extMem, header.extMemSize);
+            }
+            written = size;
+        }
+        catch (const std::exception& e)
+        {
+            MCF_ERROR("Cannot share value of {}: {}", topic, e.what());
+        }
+        fSegment->commitWrite(ticket, fWriterId, written);
+    }
+
+private:
+    void reportOnce(const std::string& message)
+    {
+        if (!fReported.exchange(true))
+        {
+            MCF_WARN_NOFILELINE("{}", message);
+        }
+    }
+
+    const ValueStore& fValueStore;
+    const ValueStore::TopicHandle fHandle;
+    const std::shared_ptr<ShmemTopicSegment> fSegment;
+    const uint32_t fIndex;
+    const uint64_t fWriterId;
+    const void* const fBridge;
+    std::atomic<bool> fReported{false};
+};
+
+ShmemTopicBridge::ShmemTopicBridge(ValueStore& valueStore, const std::string& segmentName, size_t segmentSize)
+: fValueStore(valueStore)
+, fSegment(std::make_shared<ShmemTopicSegment>(segmentName, segmentSize))
+, fWriterId(nextWriterId())
+{
+    fThread = std::thread([this] { run(); });
+}
+
+ShmemTopicBridge::~ShmemTopicBridge()
+{
+    fStop = true;
+    fSegment->notify();
+    fThread.join();
+    for (const auto* topics : {&fTopics, &fNewTopics})
+    {
+        for (const auto& topic : *topics)
+        {
+            fValueStore.removeReceiver(topic.handle.topic(), topic.writer);
+        }
+    }
+}
+
+void ShmemTopicBridge::share(const std::string& topic, size_t slotSize, uint32_t slots)
+{
+    const uint32_t index = fSegment->addTopic(topic, slotSize, slots);
+    const auto handle = fValueStore.getTopicHandle(topic);
+    auto writer = std::make_shared<Writer>(fValueStore, handle, fSegment, index, fWriterId, this);
+    {
+        std::lock_guard<std::mutex> lk(fMutex);
+        if (std::find(fIndices.begin(), fIndices.end(), index) != fIndices.end())
+        {
+            return;
+        }
+        fIndices.push_back(index);
+        // starts with the latest value, unless there is none yet
+        const uint64_t last = fSegment->lastSeq(index);
+        fNewTopics.push_back(SharedTopic{index, handle, writer, std::max<uint64_t>(last, 1), false, {}, false});
+    }
+    fValueStore.addReceiver(topic, writer);
+    fSegment->notify();
+}
+
+void ShmemTopicBridge::run()
+{
+    setThreadName("ShmemTopics");
+    tDelivering = this;
+    while (!fStop)
+    {
+        const uint32_t seen = fSegment->notifications();
+        {
+            std::lock_guard<std::mutex> lk(fMutex);
+            std::move(fNewTopics.begin(), fNewTopics.end(), std::back_inserter(fTopics));
+            fNewTopics.clear();
+        }
+        bool pending = false;
+        for (auto& topic : fTopics)
+        {
+            pending |= !receive(topic);
+        }
+        // incomplete entries are checked again after a while, not woken by their writer
+        fSegment->wait(seen, pending ? std::chrono::milliseconds(1) : POLL_INTERVAL);
+    }
+}
+
+bool ShmemTopicBridge::receive(SharedTopic& topic)
+{
+    const uint64_t last = fSegment->lastSeq(topic.index);
+    while (topic.nextSeq <= last && !fStop)
+    {
+        uint64_t writerId = 0;
+        switch (fSegment->read(topic.index, topic.nextSeq, fEntry, writerId))
+        {
+        case ShmemTopicSegment::ReadResult::PENDING:
+        {
+            // claimed by a writer which has not completed it, but a later entry is complete
+            const auto now = std::chrono::steady_clock::now();
+            if (!topic.pending)
+            {
+                topic.pending = true;
+                topic.pendingSince = now;
+            }
+            if (now - topic.pendingSince < PENDING_TIMEOUT)
+            {
+                return false;
+            }
+            topic.pending = false;
+            ++topic.nextSeq;
+            break;
+        }
+        case ShmemTopicSegment::ReadResult::LOST:
+        {
+            // continue with the oldest entry still kept
+            const uint32_t slots = fSegment->slots(topic.index);
+            topic.pending = false;
+            topic.nextSeq = std::max(topic.nextSeq + 1, last >= slots ? last - slots + 1 : 1);
+            break;
+        }
+        case ShmemTopicSegment::ReadResult::OK:
+            topic.pending = false;
+            ++topic.nextSeq;
+            if (writerId != fWriterId && !fEntry.empty())
+            {
+                deliver(topic, fEntry, writerId);
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+void ShmemTopicBridge::deliver(SharedTopic& topic, const std::vector<char>& entry, uint64_t writerId)
+{
+    EntryHeader header;
+    if (entry.size() < sizeof(header))
+    {
+        MCF_ERROR("Malformed value of {} in the shared topic segment", topic.handle.topic());
+        return;
+    }
+    std::memcpy(&header, entry.data(), sizeof(header));
+    const size_t size = entry.size() - sizeof(header);
+    if (header.valueSize > size || header.extMemSize > size - header.valueSize)
+    {
+        MCF_ERROR("Malformed value of {} in the shared topic segment", topic.handle.topic());
+        return;
+    }
+    const auto* typeInfo = fValueStore.findTypeInfo(header.typeId);
+    if (typeInfo == nullptr)
+    {
+        if (!topic.reported)
+        {
+            topic.reported = true;
+            MCF_ERROR("Type of value shared on {} not present in type registry: {}", topic.handle.topic(), header.typeId);
+        }
+        return;
+    }
+
+    try
+    {
+        // decoded into a zone reused by all values received by this thread
+        static thread_local msgpack::zone zone;
+        zone.clear();
+        const char* data = entry.data() + sizeof(header);
+        size_t offset = 0;
+        bool referenced = false;
+        msgpack::object obj = msgpack::unpack(
+            zone, data, header.valueSize, offset, referenced, &impl::referenceBuffer);
+        const char* extMem = header.extMemSize > 0 ? data + header.valueSize : nullptr;
+        bool isExtMem = false;
+        std::shared_ptr<Value> value =
+            TypeRegistry::unpackSharedValue(*typeInfo, obj, extMem, header.extMemSize, isExtMem);
+        IdInjector(header.valueId).injectId(*value);
+        // several processes may write to the topic, each with its own numbering
+        const ValueOrigin origin{reinterpret_cast<const void*>(static_cast<uintptr_t>(writerId)), header.valueSeq};
+        fValueStore.injectValue(topic.handle, ValuePtr(std::move(value)), origin, true, [this] { return fStop.load(); });
+    }
+    catch (const std::exception& e)
+    {
+        MCF_ERROR("Cannot receive value of {} from the shared topic segment: {}", topic.handle.topic(), e.what());
+    }
+}
+
+} // end namespace remote
+
+} // end namespace mcf
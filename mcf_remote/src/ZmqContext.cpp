@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#include "mcf_remote/ZmqContext.h"
+
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/LoggingMacros.h"
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace mcf {
+
+namespace remote {
+
+namespace {
+
+std::mutex& contextMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+// guarded by contextMutex()
+ZmqContextConfig& contextConfig()
+{
+    static ZmqContextConfig config;
+    return config;
+}
+
+// guarded by contextMutex()
+std::weak_ptr<zmq::context_t>& sharedContext()
+{
+    static std::weak_ptr<zmq::context_t> context;
+    return context;
+}
+
+void setContextOption(zmq::context_t& context, int option, int value, const char* name)
+{
+    if (zmq_ctx_set(static_cast<void*>(context), option, value) != 0)
+    {
+        MCF_THROW_RUNTIME(fmt::format("Cannot set {} of zmq context to '{}': {}", name, value, std::strerror(errno)));
+    }
+}
+
+void applyConfig(zmq::context_t& context, const ZmqContextConfig& config)
+{
+    if (config.ioThreads != 1)
+    {
+        setContextOption(context, ZMQ_IO_THREADS, config.ioThreads, "ZMQ_IO_THREADS");
+    }
+
+    int priority = config.priority;
+    if (priority == 0)
+    {
+        // keep the I/O threads of real time processes in the real time class
+        int policy = 0;
+        sched_param parameters{-1};
+        pthread_getschedparam(pthread_self(), &policy, &parameters);
+        priority = policy == SCHED_FIFO ? ZmqContext::DEFAULT_PRIORITY : -1;
+    }
+    if (priority > 0)
+    {
+        setContextOption(context, ZMQ_THREAD_SCHED_POLICY, SCHED_FIFO, "ZMQ_THREAD_SCHED_POLICY");
+        setContextOption(context, ZMQ_THREAD_PRIORITY, priority, "ZMQ_THREAD_PRIORITY");
+    }
+
+    if (config.cpuAffinity != 0)
+    {
+#ifdef ZMQ_THREAD_AFFINITY_CPU_ADD
+        for (int cpu = 0; cpu < 64; ++cpu)
+        {
+            if (config.cpuAffinity & (CpuMask(1) << cpu))
+            {
+                setContextOption(context, ZMQ_THREAD_AFFINITY_CPU_ADD, cpu, "ZMQ_THREAD_AFFINITY_CPU_ADD");
+            }
+        }
+#else
+        MCF_WARN_NOFILELINE("zmq {}.{}.{} cannot pin its I/O threads, cpuAffinity ignored",
+            ZMQ_VERSION_MAJOR, ZMQ_VERSION_MINOR, ZMQ_VERSION_PATCH);
+#endif
+    }
+
+    MCF_INFO_NOFILELINE("Created zmq context: {} I/O threads, priority {}, cpu affinity {}",
+        config.ioThreads,
+        priority > 0 ? std::to_string(priority) : std::string("default"),
+        config.cpuAffinity != 0 ? formatCpuMask(config.cpuAffinity) : std::string("none"));
+}
+
+} // anonymous namespace
+
+void ZmqContext::configure(const ZmqContextConfig& config)
+{
+    MCF_ASSERT(config.ioThreads > 0, "zmq context requires at least one I/O thread");
+    std::lock_guard<std::mutex> lock(contextMutex());
+    if (!sharedContext().expired())
+    {
+        MCF_WARN_NOFILELINE("zmq context is in use already, its settings apply once it is created again");
+    }
+    contextConfig() = config;
+}
+
+ZmqContextConfig ZmqContext::config()
+{
+    std::lock_guard<std::mutex> lock(contextMutex());
+    return contextConfig();
+}
+
+std::shared_ptr<zmq::context_t> ZmqContext::shared()
+{
+    std::lock_guard<std::mutex> lock(contextMutex());
+    auto context = sharedContext().lock();
+    if (!context)
+    {
+        context = std::make_shared<zmq::context_t>(1);
+        applyConfig(*context, contextConfig());
+        sharedContext() = context;
+    }
+    return context;
+}
+
+void ZmqContext::configureSocket(zmq::socket_t& socket)
+{
+    const ZmqContextConfig settings = config();
+    if (settings.sendBufferSize >= 0)
+    {
+        socket.setsockopt(ZMQ_SNDBUF, &settings.sendBufferSize, sizeof(int));
+    }
+    if (settings.receiveBufferSize >= 0)
+    {
+        socket.setsockopt(ZMQ_RCVBUF, &settings.receiveBufferSize, sizeof(int));
+    }
+}
+
+} // end namespace remote
+
+} // end namespace mcf
@@ -0,0 +1,456 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+
+#include "mcf_remote/ZmqMsgPackAsyncSender.h"
+#include "mcf_remote/ZmqMsgPackUtils.h"
+#include "mcf_remote/Remote.h"
+#include "mcf_remote/ShmemKeeper.h"
+#include "mcf_remote/ZmqContext.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace mcf {
+
+namespace remote {
+
+namespace
+{
+
+// queue of messages from the sending thread to the I/O thread, numbered per sender as inproc
+// endpoints are shared by all senders of the process context
+std::string queueEndpoint()
+{
+    static std::atomic<uint64_t> counter{0};
+    return "inproc://ZmqMsgPackAsyncSenderQueue" + std::to_string(counter.fetch_add(1));
+}
+
+// maximum time the I/O thread waits before checking whether it shall stop
+constexpr std::chrono::milliseconds MAX_POLL_INTERVAL(10);
+
+} // anonymous namespace
+
+ZmqMsgPackAsyncSender::ZmqMsgPackAsyncSender(
+    std::string connection,
+    TypeRegistry& typeRegistry,
+    std::chrono::milliseconds sendTimeout,
+    std::shared_ptr<ShmemKeeper> shmemKeeper) :
+    _context(ZmqContext::shared()),
+    _queueEndpoint(queueEndpoint()),
+    _connectionStr(std::move(connection)),
+    _typeRegistry(typeRegistry),
+    _sendTimeout(sendTimeout),
+    _shmemKeeper(std::move(shmemKeeper))
+{
+    parseConnectionName(_connectionStr, _connection, _shmemName);
+}
+
+ZmqMsgPackAsyncSender::~ZmqMsgPackAsyncSender()
+{
+    if(connected())
+    {
+        disconnect();
+    }
+}
+
+void ZmqMsgPackAsyncSender::setCompletionHandler(CompletionHandler handler)
+{
+    MCF_ASSERT(!connected(), "trying to set the completion handler of a connected ZmqMsgPackAsyncSender");
+    _completionHandler = std::move(handler);
+}
+
+void ZmqMsgPackAsyncSender::connect()
+{
+    if(connected())
+    {
+        disconnect();
+    }
+
+    try
+    {
+        const int one = 1;
+
+        auto socketPull = std::make_unique<zmq::socket_t>(*_context, ZMQ_PULL);
+        socketPull->bind(_queueEndpoint);
+
+        auto socketSend = std::make_unique<zmq::socket_t>(*_context, ZMQ_DEALER);
+        ZmqContext::configureSocket(*socketSend);
+        // allow destruction of port/context even if there are still some message in flight
+        socketSend->setsockopt(ZMQ_LINGER, &one, sizeof(int));
+        socketSend->connect(_connection);
+
+        _socketQueue = std::make_unique<zmq::socket_t>(*_context, ZMQ_PUSH);
+        _socketQueue->setsockopt(ZMQ_LINGER, &one, sizeof(int));
+        _socketQueue->connect(_queueEndpoint);
+
+        _running = true;
+        _ioThread = std::thread(
+            &ZmqMsgPackAsyncSender::run, this, std::move(socketPull), std::move(socketSend));
+    }
+    catch(const zmq::error_t& e)
+    {
+        _socketQueue.reset();
+        MCF_THROW_RUNTIME(
+            fmt::format(
+                "ERROR: ZmqMsgPackAsyncSender cannot connect to '{}': {}",
+                _connection,
+                e.what()
+            )
+        );
+    }
+}
+
+void ZmqMsgPackAsyncSender::disconnect()
+{
+    _running = false;
+    if(_ioThread.joinable())
+    {
+        _ioThread.join();
+    }
+    _socketQueue.reset();
+
+    // responses to messages sent over this connection will not arrive
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(auto& message : _inFlight)
+    {
+        if(message.second.promise)
+        {
+            message.second.promise->set_value("TIMEOUT");
+        }
+    }
+    _inFlight.clear();
+    _acks.clear();
+}
+
+std::string ZmqMsgPackAsyncSender::sendValue(const std::string& topic, ValuePtr value, uint64_t seq)
+{
+    MCF_ASSERT(connected(), "trying to send a Value before ZmqMsgPackAsyncSender was connected");
+
+    auto promise = std::make_shared<std::promise<std::string>>();
+    auto response = promise->get_future();
+    if(!transferValue(topic, std::move(value), seq, std::move(promise)))
+    {
+        return "REJECTED";
+    }
+
+    // the I/O thread completes the value with TIMEOUT after the send timeout
+    return response.get();
+}
+
+std::string ZmqMsgPackAsyncSender::sendValueAsync(const std::string& topic, ValuePtr value, uint64_t seq)
+{
+    MCF_ASSERT(connected(), "trying to send a Value before ZmqMsgPackAsyncSender was connected");
+
+    if(!transferValue(topic, std::move(value), seq))
+    {
+        return "REJECTED";
+    }
+    return "SENT";
+}
+
+void ZmqMsgPackAsyncSender::pollAcks(std::vector<Ack>& acks, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _acksAvailable.wait_for(lock, timeout, [this] { return !_acks.empty(); });
+    acks.insert(acks.end(), _acks.begin(), _acks.end());
+    _acks.clear();
+}
+
+void ZmqMsgPackAsyncSender::sendPing(uint64_t freshnessValue)
+{
+    MCF_ASSERT(connected(), "trying to send a Ping before ZmqMsgPackAsyncSender was connected");
+
+    beginMessage("ping", false);
+    transferData("ping", ZMQ_SNDMORE);
+    transferData(freshnessValue);
+}
+
+void ZmqMsgPackAsyncSender::sendPong(uint64_t freshnessValue)
+{
+    MCF_ASSERT(connected(), "trying to send a Pong before ZmqMsgPackAsyncSender was connected");
+
+    beginMessage("pong", false);
+    transferData("pong", ZMQ_SNDMORE);
+    transferData(freshnessValue);
+}
+
+void ZmqMsgPackAsyncSender::sendRequestAll()
+{
+    MCF_ASSERT(connected(), "trying to send a Command before ZmqMsgPackAsyncSender was connected");
+
+    beginMessage("sendAll", false);
+    transferData("command", ZMQ_SNDMORE);
+    transferData("sendAll");
+}
+
+std::string ZmqMsgPackAsyncSender::sendBlockedValueInjected(const std::string& topic)
+{
+    MCF_ASSERT(connected(), "trying to send a Command before ZmqMsgPackAsyncSender was connected");
+
+    beginMessage("valueInjected", false);
+    transferData("command", ZMQ_SNDMORE);
+    transferData("valueInjected", ZMQ_SNDMORE);
+    transferData(topic);
+    return "SENT";
+}
+
+std::string ZmqMsgPackAsyncSender::sendBlockedValueRejected(const std::string& topic)
+{
+    MCF_ASSERT(connected(), "trying to send a Command before ZmqMsgPackAsyncSender was connected");
+
+    beginMessage("valueRejected", false);
+    transferData("command", ZMQ_SNDMORE);
+    transferData("valueRejected", ZMQ_SNDMORE);
+    transferData(topic);
+    return "SENT";
+}
+
+void ZmqMsgPackAsyncSender::beginMessage(
+    const std::string& topic,
+    bool isValue,
+    std::shared_ptr<std::promise<std::string>> promise)
+{
+    uint64_t sequence = 0;
+    {
+        // registered before sending, so that the response always finds its message
+        std::lock_guard<std::mutex> lock(_mutex);
+        sequence = _nextSequence++;
+        _inFlight[sequence] = InFlight{topic, isValue, std::chrono::steady_clock::now(), std::move(promise)};
+    }
+    transferData(sequence, ZMQ_SNDMORE);
+}
+
+template<typename T>
+void ZmqMsgPackAsyncSender::transferData(const T& message, const int flags)
+{
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> pk(&buffer);
+    pk.pack(message);
+
+    zmq::message_t request(buffer.data(), buffer.size());
+    _socketQueue->send(request, flags);
+}
+
+bool ZmqMsgPackAsyncSender::transferValue(
+    const std::string& topic,
+    ValuePtr value,
+    uint64_t seq,
+    std::shared_ptr<std::promise<std::string>> promise)
+{
+    auto relayed = std::dynamic_pointer_cast<const RelayedValue>(value);
+    if (relayed != nullptr)
+    {
+        if (_shmemName.empty())
+        {
+            beginMessage(topic, true, std::move(promise));
+            transferData("value", ZMQ_SNDMORE);
+            transferData(topic, ZMQ_SNDMORE);
+            remote::sendRelayedValue(relayed, seq, *_socketQueue);
+            return true;
+        }
+
+        // the wire format is not placed in shared memory
+        try
+        {
+            value = remote::decodeRelayedValue(_typeRegistry, *relayed);
+        }
+        catch (std::exception& e)
+        {
+            MCF_ERROR_NOFILELINE("Cannot decode relayed value on {}: {}", topic, e.what());
+            return false;
+        }
+    }
+
+    const auto* typeInfoPtr = _typeRegistry.findTypeInfo(*value);
+
+    if (typeInfoPtr == nullptr)
+    {
+        return false;
+    }
+
+    if(!_shmemName.empty())
+    {
+#ifdef HAVE_SHMEM
+        if(!_shmemKeeper.get())
+#endif
+        {
+            MCF_ERROR_NOFILELINE(
+                    "No ShmemKeeper was set. Cannot send value on {} over shm://{}",
+                            topic,
+                            _shmemName
+                    );
+            return false;
+        }
+    }
+
+    beginMessage(topic, true, std::move(promise));
+    transferData("value", ZMQ_SNDMORE);
+    transferData(topic, ZMQ_SNDMORE);
+
+    if(_shmemName.empty())
+    {
+        remote::sendValue(value, seq, *typeInfoPtr, *_socketQueue);
+    }
+#ifdef HAVE_SHMEM
+    else
+    {
+        remote::sendValue(value, seq, *typeInfoPtr, *_socketQueue, _shmemName, _shmemKeeper.get());
+    }
+#endif
+
+    return true;
+}
+
+void ZmqMsgPackAsyncSender::run(
+    std::unique_ptr<zmq::socket_t> socketPull, std::unique_ptr<zmq::socket_t> socketSend)
+{
+    zmq_pollitem_t items[2];
+    items[0].socket = *socketPull;
+    items[0].events = ZMQ_POLLIN;
+    items[1].socket = *socketSend;
+    items[1].events = ZMQ_POLLIN;
+
+    while(_running)
+    {
+        const auto timeout = std::min(expireMessages(), MAX_POLL_INTERVAL);
+        try
+        {
+            zmq_poll(items, 2, timeout.count());
+            if(items[0].revents & ZMQ_POLLIN)
+            {
+                forwardMessages(*socketPull, *socketSend);
+            }
+            if(items[1].revents & ZMQ_POLLIN)
+            {
+                receiveResponses(*socketSend);
+            }
+        }
+        catch(const zmq::error_t& e)
+        {
+            MCF_WARN_NOFILELINE("in ZmqMsgPackAsyncSender: {}", e.what());
+        }
+    }
+}
+
+void ZmqMsgPackAsyncSender::forwardMessages(zmq::socket_t& socketPull, zmq::socket_t& socketSend)
+{
+    zmq::message_t part;
+    while(socketPull.recv(&part, ZMQ_DONTWAIT))
+    {
+        // the parts of a message are queued atomically
+        bool more = socketPull.getsockopt<int>(ZMQ_RCVMORE) != 0;
+        socketSend.send(part, more ? ZMQ_SNDMORE : 0);
+        while(more)
+        {
+            socketPull.recv(&part);
+            more = socketPull.getsockopt<int>(ZMQ_RCVMORE) != 0;
+            socketSend.send(part, more ? ZMQ_SNDMORE : 0);
+        }
+    }
+}
+
+void ZmqMsgPackAsyncSender::receiveResponses(zmq::socket_t& socketSend)
+{
+    zmq::message_t frame;
+    while(socketSend.recv(&frame, ZMQ_DONTWAIT))
+    {
+        uint64_t sequence = 0;
+        std::string result;
+        try
+        {
+            sequence = msgpack::unpack((const char*)frame.data(), frame.size()).get().as<uint64_t>();
+            if(!socketSend.getsockopt<int>(ZMQ_RCVMORE) || !socketSend.recv(&frame))
+            {
+                MCF_WARN_NOFILELINE("in ZmqMsgPackAsyncSender: response {} without result", sequence);
+                continue;
+            }
+
+            // see ZmqMsgPackSender::checkForResponse() on unpacking empty strings
+            if(frame.size() > 1)
+            {
+                result = msgpack::unpack((const char*)frame.data(), frame.size()).get().as<std::string>();
+            }
+        }
+        catch(const std::exception& e)
+        {
+            MCF_WARN_NOFILELINE("in ZmqMsgPackAsyncSender receiveResponses: {}", e.what());
+            result = "REJECTED";
+        }
+
+        InFlight message;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _inFlight.find(sequence);
+            if(it == _inFlight.end())
+            {
+                // the message has timed out before
+                continue;
+            }
+            message = std::move(it->second);
+            _inFlight.erase(it);
+        }
+        complete(message, result);
+    }
+}
+
+std::chrono::milliseconds ZmqMsgPackAsyncSender::expireMessages()
+{
+    const auto now = std::chrono::steady_clock::now();
+    auto next = MAX_POLL_INTERVAL;
+    std::vector<InFlight> expired;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(auto it = _inFlight.begin(); it != _inFlight.end();)
+        {
+            const auto age = std::chrono::duration_cast<std::chrono::milliseconds>(now - it->second.sent);
+            if(age >= _sendTimeout)
+            {
+                expired.push_back(std::move(it->second));
+                it = _inFlight.erase(it);
+            }
+            else
+            {
+                next = std::min(next, _sendTimeout - age);
+                ++it;
+            }
+        }
+    }
+
+    for(auto& message : expired)
+    {
+        complete(message, "TIMEOUT");
+    }
+    return next;
+}
+
+void ZmqMsgPackAsyncSender::complete(InFlight& message, const std::string& result)
+{
+    if(message.promise)
+    {
+        message.promise->set_value(result);
+    }
+    else if(!message.isValue)
+    {
+        if(result == "TIMEOUT")
+        {
+            MCF_WARN_NOFILELINE("{} timed out", message.topic);
+        }
+    }
+    else if(_completionHandler)
+    {
+        _completionHandler(Ack{message.topic, result});
+    }
+    else
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _acks.push_back(Ack{message.topic, result});
+        }
+        _acksAvailable.notify_all();
+    }
+}
+
+} // end namespace remote
+
+} // end namespace mcf
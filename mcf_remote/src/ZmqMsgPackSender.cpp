@@ -6,76 +6,83 @@
 #include "mcf_remote/ZmqMsgPackUtils.h"
 #include "mcf_remote/Remote.h"
 #include "mcf_remote/ShmemKeeper.h"
+#include "mcf_remote/ZmqContext.h"
+
+#include <algorithm>
 
 namespace mcf {
 
 namespace remote {
 
+namespace {
+
+template<typename T>
+std::string packFrame(const T& data)
+{
+    msgpack::sbuffer buffer;
+    msgpack::pack(buffer, data);
+    return std::string(buffer.data(), buffer.size());
+}
+
+// frames which are the same in every message, packed once
+const std::string VALUE_FRAME = packFrame("value");
+const std::string PING_FRAME = packFrame("ping");
+const std::string PONG_FRAME = packFrame("pong");
+const std::string COMMAND_FRAME = packFrame("command");
+const std::string SEND_ALL_FRAME = packFrame("sendAll");
+const std::string SEND_STALE_FRAME = packFrame("sendStale");
+const std::string SUBSCRIPTIONS_FRAME = packFrame("subscriptions");
+const std::string VALUE_INJECTED_FRAME = packFrame("valueInjected");
+const std::string VALUE_REJECTED_FRAME = packFrame("valueRejected");
+const std::string BATCH_FRAME = packFrame("batch");
+const std::string COMPRESSED_VALUE_FRAME = packFrame("compressedValue");
+const std::string STAMPED_VALUE_FRAME = packFrame("stampedValue");
+const std::string EXPORTED_VALUE_FRAME = packFrame("exportedValue");
+
+} // anonymous namespace
+
 ZmqMsgPackSender::ZmqMsgPackSender(
     std::string connection,
     TypeRegistry& typeRegistry,
     std::chrono::milliseconds sendTimeout,
-    std::shared_ptr<ShmemKeeper> shmemKeeper) :
-    _context(1),
+    std::shared_ptr<ShmemKeeper> shmemKeeper,
+    bool pipelined) :
+    _context(ZmqContext::shared()),
     _connectionStr(std::move(connection)),
     _typeRegistry(typeRegistry),
     _sendTimeout(sendTimeout),
-    _shmemKeeper(std::move(shmemKeeper))
+    _shmemKeeper(std::move(shmemKeeper)),
+    _pipelined(pipelined)
 {
     parseConnectionName(_connectionStr, _connection, _shmemName);
-
-    int policy = 0;
-    sched_param parameters{-1};
-    pthread_getschedparam(pthread_self(), &policy, &parameters);
-
-    if(policy == SCHED_FIFO)
-    {
-        int priority =  35;
-        void* ptr = (void*)_context;
-        zmq_ctx_set(ptr, ZMQ_THREAD_SCHED_POLICY, SCHED_FIFO);
-        int res = zmq_ctx_set(ptr, ZMQ_THREAD_PRIORITY, priority);
-
-        // setting a thread name prefix only work with zmq 4.3 and higher
-        //int prefix = std::stoi(_connectionStr.substr(_connectionStr.size()-4));
-        //res = zmq_ctx_set(ptr, ZMQ_THREAD_NAME_PREFIX, prefix);
-
-        if(res != 0)
-        {
-            MCF_THROW_RUNTIME(
-                fmt::format(
-                    "ERROR: cannot set ZMQ_THREAD_PRIORITY to '{}': {}",
-                    priority,
-                    strerror(errno)
-                )
-            );
-        }
-        else
-        {
-            MCF_INFO_NOFILELINE("SET ZmqMsgPackSender scheduling parameters: policy {}, priority {}",
-                policy,
-                priority
-            );
-        }
-    }
-    else
-    {
-        MCF_INFO_NOFILELINE("Cannot change scheduling of ZmqMsgPackSender");
-    }
 }
 
 void ZmqMsgPackSender::connect()
 {
     try
     {
-        _socketSend = std::make_unique<zmq::socket_t>(_context, ZMQ_REQ);
+        _socketSend = std::make_unique<zmq::socket_t>(*_context, _pipelined ? ZMQ_DEALER : ZMQ_REQ);
+        ZmqContext::configureSocket(*_socketSend);
         const int one = 1;
-        // enabling sending another message even though the response of the previous one did not arrive (yet)
-        _socketSend->setsockopt(ZMQ_REQ_RELAXED, &one, sizeof(int));
+        if(!_pipelined)
+        {
+            // enabling sending another message even though the response of the previous one did not arrive (yet)
+            _socketSend->setsockopt(ZMQ_REQ_RELAXED, &one, sizeof(int));
+        }
         // _socketSend->setsockopt(ZMQ_REQ_CORRELATE, &one, sizeof(int));
         // allow destruction of port/context even if there are still some message in flight
         _socketSend->setsockopt(ZMQ_LINGER, &one, sizeof(int));
 
         _socketSend->connect(_connection);
+
+        // responses to messages sent over a previous connection will not arrive
+        _inFlight.clear();
+        _acks.clear();
+        // the receiver may have been replaced by one not understanding stamped values
+        _stampValues = false;
+        _numericTypeIds = false;
+        _extMemImporter = false;
+        _extMemImportFailed = false;
     }
     catch(const zmq::error_t& e)
     {
@@ -96,23 +103,252 @@ void ZmqMsgPackSender::disconnect()
     _socketSend.reset();
 }
 
-std::string ZmqMsgPackSender::sendValue(const std::string& topic, ValuePtr value)
+std::string ZmqMsgPackSender::sendValue(const std::string& topic, ValuePtr value, uint64_t seq)
 {
     MCF_ASSERT(connected(), "trying to send a Value before ZmqMsgPackSender was connected");
 
-    auto typeInfoPtr = _typeRegistry.getTypeInfo(*value);
+    std::string exportHandle;
+    if(!transferValue(topic, value, seq, true, exportHandle))
+    {
+        return "REJECTED";
+    }
 
-    if (typeInfoPtr != nullptr)
+    const std::string response = checkForResponse(_sendTimeout);
+    if(exportHandle.empty() || (response != "REJECTED" && response != "TIMEOUT"))
     {
-        transferData("value", ZMQ_SNDMORE);
+        return response;
+    }
 
-        transferData(topic, ZMQ_SNDMORE);
+    // released unless the receiver has imported it nevertheless
+    withdrawExport(*value, exportHandle);
+    if(response == "TIMEOUT")
+    {
+        return response;
+    }
 
-        if(_shmemName.empty())
+    // e.g. the receiver cannot map the exported memory
+    if(!transferValue(topic, std::move(value), seq, false, exportHandle))
+    {
+        return "REJECTED";
+    }
+    const std::string copiedResponse = checkForResponse(_sendTimeout);
+    checkCopiedResponse(topic, copiedResponse);
+    return copiedResponse;
+}
+
+std::vector<std::string> ZmqMsgPackSender::sendValues(
+    const std::vector<std::pair<std::string, ValuePtr>>& values, size_t maxBytes,
+    const std::vector<uint64_t>& seqs)
+{
+    if(_pipelined)
+    {
+        // batch responses cannot be told apart from value responses in flight
+        return AbstractSender::sendValues(values, maxBytes, seqs);
+    }
+
+    MCF_ASSERT(connected(), "trying to send a Value before ZmqMsgPackSender was connected");
+
+    std::vector<std::string> results(values.size());
+    msgpack::sbuffer batch;
+    msgpack::sbuffer entry;
+    // indices of the values in the batch
+    std::vector<size_t> entries;
+
+    auto flush = [&]()
+    {
+        if(entries.empty())
         {
-            remote::sendValue(value, *typeInfoPtr, *_socketSend);
+            return;
         }
-        else
+        const auto batchResults = sendBatch(batch, entries.size());
+        for(size_t i = 0; i < entries.size(); ++i)
+        {
+            results[entries[i]] = batchResults[i];
+        }
+        batch.clear();
+        entries.clear();
+    };
+
+    for(size_t i = 0; i < values.size(); ++i)
+    {
+        const auto& topic = values[i].first;
+        const auto& value = values[i].second;
+        const uint64_t seq = i < seqs.size() ? seqs[i] : 0;
+        const auto* relayed = dynamic_cast<const RelayedValue*>(value.get());
+        if(relayed != nullptr && !_numericTypeIds && impl::hasNumericTypeId(relayed->serialized()))
+        {
+            // decoded by sendValue() to be sent with the name of its type
+            results[i] = sendValue(topic, value, seq);
+            continue;
+        }
+        const auto* typeInfoPtr = relayed == nullptr ? _typeRegistry.findTypeInfo(*value) : nullptr;
+        if(relayed == nullptr && typeInfoPtr == nullptr)
+        {
+            results[i] = "REJECTED";
+            continue;
+        }
+
+        entry.clear();
+        if(_compression.count(topic) != 0 ||
+           !(relayed != nullptr ? packBatchEntry(entry, topic, *relayed, seq)
+                                : packBatchEntry(entry, topic, value, seq, *typeInfoPtr, _numericTypeIds)))
+        {
+            // values with ExtMem part keep their zero copy transfer, compressed ones their
+            // compression
+            results[i] = sendValue(topic, value, seq);
+            continue;
+        }
+
+        if(!entries.empty() && batch.size() + entry.size() > maxBytes)
+        {
+            flush();
+        }
+        batch.write(entry.data(), entry.size());
+        entries.push_back(i);
+    }
+    flush();
+
+    return results;
+}
+
+std::string ZmqMsgPackSender::sendValueAsync(const std::string& topic, ValuePtr value, uint64_t seq)
+{
+    MCF_ASSERT(connected(), "trying to send a Value before ZmqMsgPackSender was connected");
+    MCF_ASSERT(_pipelined, "trying to send a Value asynchronously with a ZmqMsgPackSender not in pipelined mode");
+
+    std::string exportHandle;
+    if(!transferValue(topic, value, seq, true, exportHandle))
+    {
+        return "REJECTED";
+    }
+
+    if(exportHandle.empty())
+    {
+        value = nullptr;
+    }
+    _inFlight.push_back(
+        InFlight{topic, true, std::chrono::steady_clock::now(), std::move(value), exportHandle, false, seq});
+    return "SENT";
+}
+
+void ZmqMsgPackSender::pollAcks(std::vector<Ack>& acks, std::chrono::milliseconds timeout)
+{
+    // responses received while waiting for the response of another message
+    acks.insert(acks.end(), _acks.begin(), _acks.end());
+    _acks.clear();
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while(!_inFlight.empty())
+    {
+        // wait only as long as there is no response to return yet
+        auto wait = std::chrono::milliseconds(0);
+        if(acks.empty())
+        {
+            wait = std::max(wait, std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()));
+        }
+
+        std::string response;
+        if(!receiveResponse(wait, response))
+        {
+            break;
+        }
+
+        // other messages wait for their response, so only values can be in flight here
+        const InFlight message = _inFlight.front();
+        _inFlight.pop_front();
+        acknowledge(message, response, acks);
+    }
+
+    if(!_inFlight.empty() &&
+       std::chrono::steady_clock::now() - _inFlight.front().sent > _sendTimeout)
+    {
+        MCF_WARN_NOFILELINE("Value on {} timed out", _inFlight.front().topic);
+        resynchronize();
+        acks.insert(acks.end(), _acks.begin(), _acks.end());
+        _acks.clear();
+    }
+}
+
+void ZmqMsgPackSender::acknowledge(const InFlight& message, const std::string& response, std::vector<Ack>& acks)
+{
+    if(message.exported != nullptr && (response == "REJECTED" || response == "TIMEOUT"))
+    {
+        withdrawExport(*message.exported, message.exportHandle);
+    }
+    if(message.exported != nullptr && response == "REJECTED")
+    {
+        // its response follows the responses of the messages sent meanwhile
+        std::string exportHandle;
+        if(transferValue(message.topic, message.exported, message.seq, false, exportHandle))
+        {
+            _inFlight.push_back(
+                InFlight{message.topic, true, std::chrono::steady_clock::now(), nullptr, std::string(), true});
+            return;
+        }
+    }
+    else if(message.copied)
+    {
+        checkCopiedResponse(message.topic, response);
+    }
+    acks.push_back(Ack{message.topic, response});
+}
+
+void ZmqMsgPackSender::checkCopiedResponse(const std::string& topic, const std::string& response)
+{
+    if(response == "REJECTED" || response == "TIMEOUT" || _extMemImportFailed)
+    {
+        return;
+    }
+    MCF_WARN_NOFILELINE("{} cannot import the exported ExtMem on {}, copying it from now on",
+                        _connectionStr, topic);
+    _extMemImporter = false;
+    _extMemImportFailed = true;
+}
+
+void ZmqMsgPackSender::withdrawExport(const Value& value, const std::string& exportHandle)
+{
+    const auto* extMemValue = dynamic_cast<const IExtMemValue*>(&value);
+    if(extMemValue != nullptr)
+    {
+        extMemValue->extMemWithdraw(exportHandle);
+    }
+}
+
+bool ZmqMsgPackSender::transferValue(
+    const std::string& topic, ValuePtr value, uint64_t seq, bool exportExtMem, std::string& exportHandle)
+{
+    exportHandle.clear();
+    auto relayed = std::dynamic_pointer_cast<const RelayedValue>(value);
+    if (relayed != nullptr)
+    {
+        if(_shmemName.empty() && _compression.find(topic) == _compression.end() &&
+           (_numericTypeIds || !impl::hasNumericTypeId(relayed->serialized())))
+        {
+            beginMessage();
+            transferValueHeader(topic);
+            remote::sendRelayedValue(relayed, seq, *_socketSend);
+            return true;
+        }
+
+        // the wire format is neither placed in shared memory nor compressed, nor does it carry
+        // the type name for receivers not accepting numeric type ids
+        try
+        {
+            value = remote::decodeRelayedValue(_typeRegistry, *relayed);
+        }
+        catch (std::exception& e)
+        {
+            MCF_ERROR_NOFILELINE("Cannot decode relayed value on {}: {}", topic, e.what());
+            return false;
+        }
+    }
+
+    const auto* typeInfoPtr = _typeRegistry.findTypeInfo(*value);
+
+    if (typeInfoPtr != nullptr)
+    {
+        if(!_shmemName.empty())
         {
 #ifdef HAVE_SHMEM
             if(!_shmemKeeper.get())
@@ -123,19 +359,82 @@ std::string ZmqMsgPackSender::sendValue(const std::string& topic, ValuePtr value
                                 topic,
                                 _shmemName
                         );
-                return "REJECTED";
+                return false;
             }
-#ifdef HAVE_SHMEM
-            remote::sendValue(value, *typeInfoPtr, *_socketSend, _shmemName, _shmemKeeper.get());
-#endif
         }
 
-        std::string response = checkForResponse(_sendTimeout);
+        // exported before the message is begun, values which cannot be exported are sent as usual
+        const auto* extMemValue = dynamic_cast<const IExtMemValue*>(value.get());
+        if(exportExtMem && _extMemExport && _extMemImporter && extMemValue != nullptr &&
+           extMemValue->extMemExport(exportHandle))
+        {
+            beginMessage();
+            transferFrame(EXPORTED_VALUE_FRAME, ZMQ_SNDMORE);
+            transferData(topic, ZMQ_SNDMORE);
+            remote::sendExportedValue(value, seq, *typeInfoPtr, *_socketSend, exportHandle, _numericTypeIds);
+            return true;
+        }
+        exportHandle.clear();
 
-        return response;
+        beginMessage();
+
+        const auto compression = _shmemName.empty() ? _compression.find(topic) : _compression.end();
+        if(compression != _compression.end())
+        {
+            transferFrame(COMPRESSED_VALUE_FRAME, ZMQ_SNDMORE);
+            transferData(topic, ZMQ_SNDMORE);
+
+            const auto start = std::chrono::steady_clock::now();
+            const auto result = remote::sendCompressedValue(
+                value, seq, *typeInfoPtr, *_socketSend, compression->second.level, compression->second.minSize,
+                _numericTypeIds);
+            if(_compressionObserver)
+            {
+                _compressionObserver(topic, result.rawBytes, result.wireBytes,
+                                     std::chrono::steady_clock::now() - start);
+            }
+            return true;
+        }
+
+        transferValueHeader(topic);
+
+        if(_shmemName.empty() && _serializationCache)
+        {
+            remote::sendValue(value, seq, *typeInfoPtr, *_socketSend, *_serializationCache, _numericTypeIds);
+        }
+        else if(_shmemName.empty())
+        {
+            remote::sendValue(value, seq, *typeInfoPtr, *_socketSend, false, _numericTypeIds);
+        }
+#ifdef HAVE_SHMEM
+        else
+        {
+            remote::sendValue(value, seq, *typeInfoPtr, *_socketSend, _shmemName, _shmemKeeper.get(), false,
+                              _numericTypeIds);
+        }
+#endif
+
+        return true;
     }
 
-    return "REJECTED";
+    return false;
+}
+
+void ZmqMsgPackSender::setCompression(const std::string& topic, const Compression& compression)
+{
+    if(compression.level <= 0)
+    {
+        _compression.erase(topic);
+        return;
+    }
+    if(compression.level > 9)
+    {
+        MCF_THROW_RUNTIME(fmt::format("Invalid compression level {} for {}", compression.level, topic));
+    }
+#if !HAVE_ZLIB
+    MCF_THROW_RUNTIME("Values cannot be compressed. Make sure HAVE_ZLIB is set.");
+#endif
+    _compression[topic] = compression;
 }
 
 void ZmqMsgPackSender::sendPing(uint64_t freshnessValue)
@@ -143,14 +442,30 @@ void ZmqMsgPackSender::sendPing(uint64_t freshnessValue)
     MCF_ASSERT(connected(), "trying to send a Ping before ZmqMspPackSender was connected");
 
     // send a ping signal to the other end to let them know we are here
-    transferData("ping", ZMQ_SNDMORE);
+    beginMessage();
+    AbstractSender::ClockSample sample;
+    std::string extMemImportHost;
+    sample.pingSent = std::chrono::system_clock::now();
+    transferFrame(PING_FRAME, ZMQ_SNDMORE);
     transferData(freshnessValue);
 
     // check if the ping has been received
-    if(checkForResponse(_sendTimeout) == "TIMEOUT")
+    const std::string response = checkForResponse(_sendTimeout);
+    sample.responseReceived = std::chrono::system_clock::now();
+    if(response == "TIMEOUT")
     {
         MCF_WARN_NOFILELINE("Ping {} timed out", freshnessValue);
     }
+    else if(unpackClockResponse(
+                response, sample.pingReceived, sample.responseSent, _numericTypeIds, extMemImportHost))
+    {
+        _stampValues = true;
+        _extMemImporter = !_extMemImportFailed && !extMemImportHost.empty() && extMemImportHost == hostId();
+        if(_clockObserver)
+        {
+            _clockObserver(sample);
+        }
+    }
 }
 
 void ZmqMsgPackSender::sendPong(uint64_t freshnessValue)
@@ -158,7 +473,8 @@ void ZmqMsgPackSender::sendPong(uint64_t freshnessValue)
     MCF_ASSERT(connected(), "trying to send a Pong before ZmqMspPackSender was connected");
 
     // send a pong signal to the other end to let them know we are here
-    transferData("pong", ZMQ_SNDMORE);
+    beginMessage();
+    transferFrame(PONG_FRAME, ZMQ_SNDMORE);
     transferData(freshnessValue);
 
     // check if the pong has been received
@@ -172,19 +488,64 @@ void ZmqMsgPackSender::sendRequestAll()
 {
     MCF_ASSERT(connected(), "trying to send a Command before ZmqMspPackSender was connected");
 
-    transferData("command", ZMQ_SNDMORE);
-    transferData("sendAll");
+    beginMessage();
+    transferFrame(COMMAND_FRAME, ZMQ_SNDMORE);
+    transferFrame(SEND_ALL_FRAME);
 
     // check if command has been received
     checkForResponse(_sendTimeout);
 }
 
+void ZmqMsgPackSender::sendRequestStale(const std::map<std::string, uint64_t>& heldIds)
+{
+    MCF_ASSERT(connected(), "trying to send a Command before ZmqMspPackSender was connected");
+
+    // older receivers do not know the command, they get the full request instead
+    if (!_stampValues)
+    {
+        sendRequestAll();
+        return;
+    }
+
+    beginMessage();
+    transferFrame(COMMAND_FRAME, ZMQ_SNDMORE);
+    transferFrame(SEND_STALE_FRAME, ZMQ_SNDMORE);
+    transferData(heldIds);
+
+    if (checkForResponse(_sendTimeout) != "OK")
+    {
+        sendRequestAll();
+    }
+}
+
+void ZmqMsgPackSender::sendSubscriptions(const std::map<std::string, bool>& subscribed)
+{
+    MCF_ASSERT(connected(), "trying to send a Command before ZmqMspPackSender was connected");
+
+    // older receivers do not know the command, their senders keep sending all topics
+    if (!_stampValues)
+    {
+        return;
+    }
+
+    beginMessage();
+    transferFrame(COMMAND_FRAME, ZMQ_SNDMORE);
+    transferFrame(SUBSCRIPTIONS_FRAME, ZMQ_SNDMORE);
+    transferData(subscribed);
+
+    if (checkForResponse(_sendTimeout) != "OK")
+    {
+        MCF_WARN_NOFILELINE("subscriptions have not been acknowledged");
+    }
+}
+
 std::string ZmqMsgPackSender::sendBlockedValueInjected(const std::string& topic)
 {
     MCF_ASSERT(connected(), "trying to send a Command before ZmqMspPackSender was connected");
 
-    transferData("command", ZMQ_SNDMORE);
-    transferData("valueInjected", ZMQ_SNDMORE);
+    beginMessage();
+    transferFrame(COMMAND_FRAME, ZMQ_SNDMORE);
+    transferFrame(VALUE_INJECTED_FRAME, ZMQ_SNDMORE);
     transferData(topic);
 
     // check if command has been received
@@ -195,89 +556,229 @@ std::string ZmqMsgPackSender::sendBlockedValueRejected(const std::string& topic)
 {
     MCF_ASSERT(connected(), "trying to send a Command before ZmqMspPackSender was connected");
 
-    transferData("command", ZMQ_SNDMORE);
-    transferData("valueRejected", ZMQ_SNDMORE);
+    beginMessage();
+    transferFrame(COMMAND_FRAME, ZMQ_SNDMORE);
+    transferFrame(VALUE_REJECTED_FRAME, ZMQ_SNDMORE);
     transferData(topic);
 
     // check if command has been received
     return checkForResponse(_sendTimeout);
 }
 
-
-template<typename T>
-void ZmqMsgPackSender::transferData(const T& message, const int flags)
+void ZmqMsgPackSender::beginMessage()
 {
-    msgpack::sbuffer buffer;
-    msgpack::packer<msgpack::sbuffer> pk(&buffer);
-    pk.pack(message);
-
-    // make sure the socket is ready to send data
-    zmq::message_t resp;
+    // the following frames of a message can always be sent once the first one can
     zmq_pollitem_t item;
     item.socket = *_socketSend;
     item.events = ZMQ_POLLOUT;
-    int rc = zmq_poll(&item, 1, 0);
-    if(rc == 0)
+    if(_pipelined)
+    {
+        // the send queue is full if the receiver does not keep up, give it time to drain
+        MCF_ASSERT(zmq_poll(&item, 1, 100) != 0, "socket is not ready for sending");
+
+        zmq::message_t delimiter;
+        _socketSend->send(delimiter, ZMQ_SNDMORE);
+    }
+    else if(zmq_poll(&item, 1, 0) == 0)
     {
         // try to clear a dangling response from the socket
-        checkForResponse(std::chrono::milliseconds(100));
+        std::string response;
+        receiveResponse(std::chrono::milliseconds(100), response);
         MCF_ASSERT(zmq_poll(&item, 1, 0) != 0, "socket is not ready for sending");
     }
+}
 
-    zmq::message_t request(buffer.data(), buffer.size());
+template<typename T>
+void ZmqMsgPackSender::transferData(const T& message, const int flags)
+{
+    _frameBuffer.clear();
+    msgpack::pack(_frameBuffer, message);
+
+    zmq::message_t request(_frameBuffer.data(), _frameBuffer.size());
+    _socketSend->send(request, flags);
+}
+
+void ZmqMsgPackSender::transferValueHeader(const std::string& topic)
+{
+    if(_stampValues)
+    {
+        transferFrame(STAMPED_VALUE_FRAME, ZMQ_SNDMORE);
+        transferData(topic, ZMQ_SNDMORE);
+        transferData(toWireTime(std::chrono::system_clock::now()), ZMQ_SNDMORE);
+    }
+    else
+    {
+        transferFrame(VALUE_FRAME, ZMQ_SNDMORE);
+        transferData(topic, ZMQ_SNDMORE);
+    }
+}
+
+void ZmqMsgPackSender::transferFrame(const std::string& frame, const int flags)
+{
+    // copied rather than referenced, as 0MQ stores small messages inline but would allocate
+    // for referencing them
+    zmq::message_t request(frame.data(), frame.size());
     _socketSend->send(request, flags);
 }
 
 std::string ZmqMsgPackSender::checkForResponse(const std::chrono::milliseconds& timeout)
 {
+    std::string response;
+    if(!_pipelined)
+    {
+        return receiveResponse(timeout, response) ? response : "TIMEOUT";
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    _inFlight.push_back(InFlight{std::string(), false, std::chrono::steady_clock::now()});
+    while(true)
+    {
+        const auto wait = std::max(std::chrono::milliseconds(0),
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()));
+        if(!receiveResponse(wait, response))
+        {
+            resynchronize();
+            return "TIMEOUT";
+        }
+
+        const InFlight message = _inFlight.front();
+        _inFlight.pop_front();
+        if(!message.isValue)
+        {
+            return response;
+        }
+        acknowledge(message, response, _acks);
+    }
+}
+
+void ZmqMsgPackSender::resynchronize()
+{
+    std::deque<InFlight> lost;
+    lost.swap(_inFlight);
+    std::vector<Ack> acks;
+    acks.swap(_acks);
+
+    disconnect();
+    connect();
+
+    for(const auto& message : lost)
+    {
+        if(message.exported != nullptr)
+        {
+            withdrawExport(*message.exported, message.exportHandle);
+        }
+        if(message.isValue)
+        {
+            acks.push_back(Ack{message.topic, "TIMEOUT"});
+        }
+    }
+    _acks = std::move(acks);
+}
+
+std::vector<std::string> ZmqMsgPackSender::sendBatch(const msgpack::sbuffer& batch, size_t count)
+{
+    beginMessage();
+    transferFrame(BATCH_FRAME, ZMQ_SNDMORE);
+    zmq::message_t request(batch.data(), batch.size());
+    _socketSend->send(request);
+
     zmq::message_t resp;
+    try
+    {
+        if(!receiveResponseFrame(_sendTimeout, resp))
+        {
+            return std::vector<std::string>(count, "TIMEOUT");
+        }
+    }
+    catch (zmq::error_t& e)
+    {
+        MCF_WARN_NOFILELINE("in ZmqMsgPackSender sendBatch: {}", e.what());
+        return std::vector<std::string>(count, "REJECTED");
+    }
+
+    std::vector<std::string> results;
+    try
+    {
+        auto oh = msgpack::unpack((const char *)resp.data(), resp.size());
+        results = oh.get().as<std::vector<std::string>>();
+    }
+    catch(const std::exception& e)
+    {
+        MCF_WARN_NOFILELINE("in ZmqMsgPackSender sendBatch: {}", e.what());
+    }
+    // the receiver stops at a value it cannot unpack
+    results.resize(count, "REJECTED");
+    return results;
+}
+
+bool ZmqMsgPackSender::receiveResponseFrame(const std::chrono::milliseconds& timeout, zmq::message_t& frame)
+{
     zmq_pollitem_t item;
     item.socket = *_socketSend;
     item.events = ZMQ_POLLIN;
     int rc = zmq_poll(&item, 1, timeout.count());
-    if(rc)
+    if(rc == 0)
     {
-        try
-        {
-            bool result = _socketSend->recv(&resp);
-            if(result == false) throw zmq::error_t();
-        }
-        catch (zmq::error_t& e)
+        return false;
+    }
+
+    bool result = _socketSend->recv(&frame);
+    // in pipelined mode, the response follows an empty delimiter frame
+    if(result && _pipelined && frame.size() == 0 &&
+       _socketSend->getsockopt<int>(ZMQ_RCVMORE))
+    {
+        result = _socketSend->recv(&frame);
+    }
+    if(result == false) throw zmq::error_t();
+    return true;
+}
+
+bool ZmqMsgPackSender::receiveResponse(const std::chrono::milliseconds& timeout, std::string& response)
+{
+    zmq::message_t resp;
+
+    try
+    {
+        if(!receiveResponseFrame(timeout, resp))
         {
-            MCF_WARN_NOFILELINE("in ZmqMsgPackSender checkForResponse: {}", e.what());
-            return "REJECTED";
+            return false;
         }
+    }
+    catch (zmq::error_t& e)
+    {
+        MCF_WARN_NOFILELINE("in ZmqMsgPackSender checkForResponse: {}", e.what());
+        response = "REJECTED";
+        return true;
+    }
 
-        try
+    try
+    {
+        std::string result;
+
+        // msgpack produces an error unpacking strings which contain only the terminating
+        // character:
+        // msgpack-c/include/msgpack/v2/create_object_visitor.hpp:119:24:
+        // runtime error: null pointer passed as argument 2, which is declared to never be null
+        // Therefore we avoid unpacking such strings
+        if(resp.size() > 1)
         {
-            std::string result;
-
-            // msgpack produces an error unpacking strings which contain only the terminating
-            // character:
-            // msgpack-c/include/msgpack/v2/create_object_visitor.hpp:119:24:
-            // runtime error: null pointer passed as argument 2, which is declared to never be null
-            // Therefore we avoid unpacking such strings
-            if(resp.size() > 1)
-            {
-                auto oh = msgpack::unpack((const char *)resp.data(), resp.size());
-                result = oh.get().as<std::string>();
-            }
-            else
-            {
-                result = "";
-            }
-
-            return result;
+            auto oh = msgpack::unpack((const char *)resp.data(), resp.size());
+            result = oh.get().as<std::string>();
         }
-        catch(const std::exception& e)
+        else
         {
-            MCF_WARN_NOFILELINE("in ZmqMsgPackSender checkForResponse: {}", e.what());
-            return "REJECTED";
+            result = "";
         }
 
+        response = result;
     }
-
-    return "TIMEOUT";
+    catch(const std::exception& e)
+    {
+        MCF_WARN_NOFILELINE("in ZmqMsgPackSender checkForResponse: {}", e.what());
+        response = "REJECTED";
+    }
+    return true;
 }
 
 
@@ -18,15 +18,30 @@ namespace remote
 ZmqMsgPackValueReceiver::ZmqMsgPackValueReceiver(
     const std::string& connection,
     TypeRegistry& typeRegistry,
-    std::shared_ptr<ShmemClient> shmemClient)
-: AbstractZmqMsgPackReceiver(connection, shmemClient), _typeRegistry(typeRegistry)
+    std::shared_ptr<ShmemClient> shmemClient,
+    bool routed)
+: AbstractZmqMsgPackReceiver(connection, shmemClient, routed), _typeRegistry(typeRegistry)
 {
 }
 
 ValuePtr
 ZmqMsgPackValueReceiver::decodeValue(ZmqMessage& message)
 {
-    return remote::impl::unpackMessage(_typeRegistry, message.request, message.extMem, message.extMemSize);
+    return remote::impl::unpackMessage(
+        _typeRegistry,
+        message.request,
+        message.extMem,
+        message.extMemSize,
+        message.extMemOwner,
+        message.extMemHandle,
+        &message.seq);
+}
+
+ValuePtr
+ZmqMsgPackValueReceiver::relayValue(ZmqMessage& message)
+{
+    return remote::impl::relayMessage(
+        message.request, message.extMem, message.extMemSize, &_typeRegistry, &message.seq);
 }
 
 } // end namespace remote
@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/LatencyHistogram.h"
+#include "mcf_remote/IComEventListener.h"
+#include "mcf_remote/ZmqMsgPackSender.h"
+#include "mcf_remote/ZmqMsgPackValueReceiver.h"
+#include "perf_common.h"
+#include "perf_messages.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Measures the cost of sending single values with a ZmqMsgPackSender to a ZmqMsgPackValueReceiver
+ * in the same process, i.e. the time from calling sendValue() until its response has arrived.
+ *
+ * Each payload size is sent once as a msgpack serialized vector (TestValue) and once as the
+ * ExtMem part of an Image, which is sent without copying.
+ *
+ * Usage: send_perf [--sizes 16,4096,65536,1048576] [--count 10000]
+ *                  [--connection ipc:///tmp/mcf_send_perf]
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+class AcceptingListener : public mcf::remote::IComEventListener<mcf::ValuePtr> {
+public:
+    std::string valueReceived(const std::string&, mcf::ValuePtr) override { return "INJECTED"; }
+    void pingReceived(uint64_t) override {}
+    void pongReceived(uint64_t) override {}
+    void requestAllReceived() override {}
+    void blockedValueInjectedReceived(const std::string&) override {}
+    void blockedValueRejectedReceived(const std::string&) override {}
+};
+
+/*
+ * Sends the value count times after a short warm up and returns the durations of the sends
+ */
+mcf::LatencyHistogram::Summary measure(
+        mcf::remote::ZmqMsgPackSender& sender,
+        const std::string& topic,
+        mcf::ValuePtr value,
+        uint64_t count,
+        uint64_t& failed) {
+    for (int i = 0; i < 100; ++i) {
+        sender.sendValue(topic, value);
+    }
+
+    mcf::LatencyHistogram histogram;
+    failed = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        const auto start = Clock::now();
+        const std::string result = sender.sendValue(topic, value);
+        histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        if (result != "INJECTED") {
+            ++failed;
+        }
+    }
+    return histogram.summary();
+}
+
+void print(const char* kind, size_t size, const mcf::LatencyHistogram::Summary& summary, uint64_t failed) {
+    const double mean = summary.count > 0 ? static_cast<double>(summary.sum) / summary.count : 0.;
+    std::printf("%-8s %10zu %10llu %12.2f %12.2f %12.2f %12.0f %8llu\n",
+                kind, size,
+                static_cast<unsigned long long>(summary.count),
+                mean / 1000.,
+                summary.p50 / 1000.,
+                summary.p99 / 1000.,
+                mean > 0. ? 1e9 / mean : 0.,
+                static_cast<unsigned long long>(failed));
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {16, 4096, 65536, 1048576};
+    uint64_t count = 10000;
+    std::string connection = "ipc:///tmp/mcf_send_perf";
+
+    perf::OptionHandlers options = {
+        {"--sizes", [&sizes](const char* arg) { sizes = perf::parseList<size_t>(arg); }},
+        {"--count", [&count](const char* arg) { count = std::strtoull(arg, nullptr, 10); }},
+        {"--connection", [&connection](const char* arg) { connection = arg; }},
+    };
+    if (!perf::parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    mcf::ValueStore vs;
+    perf_msg::registerValueTypes(vs);
+
+    AcceptingListener listener;
+    mcf::remote::ZmqMsgPackValueReceiver receiver(connection, vs);
+    receiver.setEventListener(&listener);
+    receiver.connect();
+
+    std::atomic<bool> running(true);
+    std::thread receiving([&receiver, &running] {
+        while (running) {
+            receiver.receive(std::chrono::milliseconds(10));
+        }
+    });
+
+    mcf::remote::ZmqMsgPackSender sender(connection, vs, std::chrono::milliseconds(1000));
+    sender.connect();
+
+    std::printf("%-8s %10s %10s %12s %12s %12s %12s %8s\n",
+                "kind", "payload", "sends", "mean us", "p50 us", "p99 us", "sends/s", "failed");
+    for (size_t size : sizes) {
+        uint64_t failed = 0;
+
+        auto testValue = std::make_shared<perf_msg::TestValue>();
+        testValue->time = 0;
+        testValue->data.resize(size);
+        print("msgpack", size, measure(sender, "/perf/msgpack", testValue, count, failed), failed);
+
+        if (size > 0) {
+            auto image = std::make_shared<perf_msg::Image>();
+            image->width = 0;
+            image->height = 0;
+            image->extMemInit(size);
+            print("extmem", size, measure(sender, "/perf/extmem", image, count, failed), failed);
+        }
+    }
+
+    sender.disconnect();
+    running = false;
+    receiving.join();
+    receiver.disconnect();
+    return 0;
+}
@@ -0,0 +1,336 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/ErrorMacros.h"
+#include "mcf_core/LatencyHistogram.h"
+#include "mcf_remote/IComEventListener.h"
+#include "mcf_remote/ShmemClient.h"
+#include "mcf_remote/ShmemKeeper.h"
+#include "mcf_remote/ZmqMsgPackSender.h"
+#include "mcf_remote/ZmqMsgPackValueReceiver.h"
+#include "perf_common.h"
+#include "perf_messages.h"
+#include "json/json.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Sends values from a ZmqMsgPackSender to a ZmqMsgPackValueReceiver over the tcp, ipc and shm
+ * transports and measures
+ *  - the throughput in values/s and MB/s, from the first send until the last arrival
+ *  - the one-way latency, i.e. the time from calling sendValue() until the value is passed to
+ *    the event listener of the receiver
+ *  - the CPU time of the process per GB of payload, which covers both ends of the link since
+ *    sender and receiver run in this process
+ *
+ * Each combination of the given transports, kinds, payload sizes and rates is run once. The kind
+ * "msgpack" sends the payload as a msgpack serialized vector (TestValue), the kind "extmem" as
+ * the ExtMem part of an Image. A rate of 0 sends as fast as the sender allows. Since
+ * ZmqMsgPackSender waits for the response of each value, a rate above the round trip rate
+ * results in back to back sends, the achieved rate is reported along with the requested one.
+ *
+ * Usage: transport_perf [--transports tcp,ipc,shm] [--kinds msgpack,extmem]
+ *                       [--sizes 16,4096,65536,1048576,5000000] [--rates 0,100]
+ *                       [--count 1000] [--duration 1000] [--port 5560] [--json results.json]
+ *
+ *  --transports  transports to run, shm requires shared memory support of the build
+ *  --kinds       how the payload is carried, see above
+ *  --sizes       payload bytes of each value
+ *  --rates       values per second, 0 for unthrottled
+ *  --count       number of values of an unthrottled run
+ *  --duration    duration of a run with a rate in ms
+ *  --port        tcp port of the receiver
+ *  --json        file to write the results to, for comparison across builds
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* TOPIC_MSGPACK = "/perf/msgpack";
+const char* TOPIC_EXTMEM = "/perf/extmem";
+
+double processCpuSeconds() {
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/*
+ * Records the arrival of the values of a run. The values carry their sequence number, which
+ * indexes the send times written by the sending thread.
+ */
+class ArrivalListener : public mcf::remote::IComEventListener<mcf::ValuePtr> {
+public:
+    void start(uint64_t count) {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fSendTimes.reset(new std::atomic<int64_t>[count]);
+        for (uint64_t i = 0; i < count; ++i) {
+            fSendTimes[i] = 0;
+        }
+        fCount = count;
+        fReceived = 0;
+        fLatency.reset(new mcf::LatencyHistogram());
+    }
+
+    void sending(uint64_t sequence) {
+        fSendTimes[sequence] = Clock::now().time_since_epoch().count();
+    }
+
+    std::string valueReceived(const std::string& topic, mcf::ValuePtr value) override {
+        const int64_t now = Clock::now().time_since_epoch().count();
+        const uint64_t sequence = topic == TOPIC_MSGPACK
+            ? static_cast<const perf_msg::TestValue&>(*value).time
+            : static_cast<const perf_msg::Image&>(*value).width;
+
+        std::lock_guard<std::mutex> lock(fMutex);
+        if (sequence < fCount && fSendTimes[sequence] != 0) {
+            fLatency->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::duration(now - fSendTimes[sequence])).count());
+            fLastArrival = Clock::time_point(Clock::duration(now));
+            ++fReceived;
+            fArrived.notify_all();
+        }
+        return "INJECTED";
+    }
+
+    /*
+     * Waits until the expected number of values has arrived or the timeout has passed
+     */
+    uint64_t waitForArrivals(uint64_t expected, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(fMutex);
+        fArrived.wait_for(lock, timeout, [this, expected] { return fReceived >= expected; });
+        return fReceived;
+    }
+
+    Clock::time_point lastArrival() {
+        std::lock_guard<std::mutex> lock(fMutex);
+        return fLastArrival;
+    }
+
+    mcf::LatencyHistogram::Summary latency() {
+        std::lock_guard<std::mutex> lock(fMutex);
+        return fLatency->summary();
+    }
+
+    void pingReceived(uint64_t) override {}
+    void pongReceived(uint64_t) override {}
+    void requestAllReceived() override {}
+    void blockedValueInjectedReceived(const std::string&) override {}
+    void blockedValueRejectedReceived(const std::string&) override {}
+
+private:
+    std::mutex fMutex;
+    std::condition_variable fArrived;
+    std::unique_ptr<std::atomic<int64_t>[]> fSendTimes;
+    uint64_t fCount = 0;
+    uint64_t fReceived = 0;
+    Clock::time_point fLastArrival;
+    std::unique_ptr<mcf::LatencyHistogram> fLatency{new mcf::LatencyHistogram()};
+};
+
+/*
+ * Sender and receiver connected over one transport, with the thread driving the receiver
+ */
+class Link {
+public:
+    Link(const std::string& transport, uint16_t port, mcf::ValueStore& valueStore) {
+        std::string sendConnection;
+        std::string receiveConnection;
+        std::shared_ptr<mcf::remote::ShmemKeeper> shmemKeeper;
+        std::shared_ptr<mcf::remote::ShmemClient> shmemClient;
+        if (transport == "tcp") {
+            sendConnection = "tcp://127.0.0.1:" + std::to_string(port);
+            receiveConnection = "tcp://*:" + std::to_string(port);
+        } else if (transport == "ipc") {
+            sendConnection = receiveConnection = "ipc:///tmp/mcf_transport_perf";
+        } else if (transport == "shm") {
+            sendConnection = receiveConnection = "shm://mcf_transport_perf";
+            shmemKeeper = std::make_shared<mcf::remote::SingleFileShmem>();
+            shmemClient = std::make_shared<mcf::remote::ShmemClient>();
+        } else {
+            MCF_THROW_RUNTIME("Unknown transport " + transport);
+        }
+
+        fReceiver.reset(new mcf::remote::ZmqMsgPackValueReceiver(receiveConnection, valueStore, shmemClient));
+        fReceiver->setEventListener(&fListener);
+        fReceiver->connect();
+        fReceiving = std::thread([this] {
+            while (fRunning) {
+                fReceiver->receive(std::chrono::milliseconds(10));
+            }
+        });
+
+        fSender.reset(new mcf::remote::ZmqMsgPackSender(
+            sendConnection, valueStore, std::chrono::milliseconds(1000), shmemKeeper));
+        fSender->connect();
+    }
+
+    ~Link() {
+        fSender->disconnect();
+        fRunning = false;
+        fReceiving.join();
+        fReceiver->disconnect();
+    }
+
+    mcf::remote::ZmqMsgPackSender& sender() { return *fSender; }
+    ArrivalListener& listener() { return fListener; }
+
+private:
+    ArrivalListener fListener;
+    std::unique_ptr<mcf::remote::ZmqMsgPackValueReceiver> fReceiver;
+    std::unique_ptr<mcf::remote::ZmqMsgPackSender> fSender;
+    std::atomic<bool> fRunning{true};
+    std::thread fReceiving;
+};
+
+struct RunResult {
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t failed = 0;
+    double seconds = 0.;
+    double cpuSeconds = 0.;
+    mcf::LatencyHistogram::Summary latency;
+};
+
+mcf::ValuePtr makeValue(const std::string& kind, size_t size, uint64_t sequence) {
+    if (kind == "extmem") {
+        auto image = std::make_shared<perf_msg::Image>();
+        image->width = static_cast<unsigned int>(sequence);
+        image->height = 0;
+        image->extMemInit(size);
+        return image;
+    }
+    auto testValue = std::make_shared<perf_msg::TestValue>();
+    testValue->time = sequence;
+    testValue->data.resize(size);
+    return testValue;
+}
+
+RunResult run(Link& link, const std::string& kind, size_t size, double rate, uint64_t count) {
+    const std::string topic = kind == "extmem" ? TOPIC_EXTMEM : TOPIC_MSGPACK;
+
+    // warm up the connection, e.g. the shared memory of the payload size, outside of the run
+    link.listener().start(0);
+    for (int i = 0; i < 10; ++i) {
+        link.sender().sendValue(topic, makeValue(kind, size, 0));
+    }
+
+    link.listener().start(count);
+    RunResult result;
+    const double cpuStart = processCpuSeconds();
+    const auto start = Clock::now();
+    for (uint64_t i = 0; i < count; ++i) {
+        if (rate > 0.) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(i / rate)));
+        }
+        mcf::ValuePtr value = makeValue(kind, size, i);
+        link.listener().sending(i);
+        if (link.sender().sendValue(topic, std::move(value)) != "INJECTED") {
+            ++result.failed;
+        }
+        ++result.sent;
+    }
+    result.received = link.listener().waitForArrivals(count - result.failed, std::chrono::milliseconds(1000));
+    result.cpuSeconds = processCpuSeconds() - cpuStart;
+    if (result.received > 0) {
+        result.seconds = std::chrono::duration<double>(link.listener().lastArrival() - start).count();
+    }
+    result.latency = link.listener().latency();
+    return result;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::string> transports = {"tcp", "ipc", "shm"};
+    std::vector<std::string> kinds = {"msgpack", "extmem"};
+    std::vector<size_t> sizes = {16, 4096, 65536, 1048576, 5000000};
+    std::vector<double> rates = {0., 100.};
+    uint64_t unthrottledCount = 1000;
+    std::chrono::milliseconds duration(1000);
+    uint16_t port = 5560;
+    std::string jsonFile;
+
+    perf::OptionHandlers options = {
+        {"--transports", [&transports](const char* arg) { transports = perf::parseNames(arg); }},
+        {"--kinds", [&kinds](const char* arg) { kinds = perf::parseNames(arg); }},
+        {"--sizes", [&sizes](const char* arg) { sizes = perf::parseList<size_t>(arg); }},
+        {"--rates", [&rates](const char* arg) { rates = perf::parseList<double>(arg); }},
+        {"--count", [&unthrottledCount](const char* arg) { unthrottledCount = std::strtoull(arg, nullptr, 10); }},
+        {"--port", [&port](const char* arg) { port = static_cast<uint16_t>(std::atoi(arg)); }},
+    };
+    perf::addResultOptions(options, jsonFile, duration);
+    if (!perf::parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    mcf::ValueStore valueStore;
+    perf_msg::registerValueTypes(valueStore);
+
+    Json::Value runs(Json::arrayValue);
+    std::printf("%-9s %-8s %10s %8s %10s %10s %12s %12s %12s %10s %8s\n",
+                "transport", "kind", "payload", "rate/s", "values/s", "MB/s",
+                "p50 us", "p99 us", "max us", "cpu s/GB", "lost");
+    for (const auto& transport : transports) {
+        Link link(transport, port, valueStore);
+        for (const auto& kind : kinds) {
+            for (size_t size : sizes) {
+                for (double rate : rates) {
+                    if (rate < 0.) {
+                        continue;
+                    }
+                    const uint64_t count = rate > 0.
+                        ? std::max<uint64_t>(static_cast<uint64_t>(
+                            rate * std::chrono::duration<double>(duration).count()), 1)
+                        : std::max<uint64_t>(unthrottledCount, 1);
+                    const RunResult result = run(link, kind, size, rate, count);
+
+                    const double gigabytes = static_cast<double>(size) * result.received / 1e9;
+                    const double valuesPerSecond = result.seconds > 0. ? result.received / result.seconds : 0.;
+                    const double megabytesPerSecond = result.seconds > 0. ? gigabytes * 1e3 / result.seconds : 0.;
+                    const double cpuPerGigabyte = gigabytes > 0. ? result.cpuSeconds / gigabytes : 0.;
+                    const uint64_t lost = result.sent - result.received;
+                    std::printf("%-9s %-8s %10zu %8.0f %10.0f %10.1f %12.1f %12.1f %12.1f %10.3f %8llu\n",
+                                transport.c_str(), kind.c_str(), size, rate,
+                                valuesPerSecond, megabytesPerSecond,
+                                result.latency.p50 / 1000., result.latency.p99 / 1000., result.latency.max / 1000.,
+                                cpuPerGigabyte, static_cast<unsigned long long>(lost));
+
+                    Json::Value json;
+                    json["transport"] = transport;
+                    json["kind"] = kind;
+                    json["payload_bytes"] = Json::UInt64(size);
+                    json["rate"] = rate;
+                    json["sent"] = Json::UInt64(result.sent);
+                    json["received"] = Json::UInt64(result.received);
+                    json["failed"] = Json::UInt64(result.failed);
+                    json["seconds"] = result.seconds;
+                    json["values_per_second"] = valuesPerSecond;
+                    json["megabytes_per_second"] = megabytesPerSecond;
+                    json["cpu_seconds"] = result.cpuSeconds;
+                    json["cpu_seconds_per_gigabyte"] = cpuPerGigabyte;
+                    json["latency_ns"] = perf::toJson(result.latency);
+                    runs.append(json);
+                }
+            }
+        }
+    }
+
+    if (!jsonFile.empty() && !perf::writeJson(jsonFile, "transport_perf", runs)) {
+        return 1;
+    }
+    return 0;
+}
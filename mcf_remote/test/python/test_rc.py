@@ -428,6 +428,47 @@ def test_mcf_rc_read_queued():
         assert_value(tgt_rc, '/points_connected', [ 2, 2 ])
         assert_value(tgt_rc, '/points_connected', [ 3, 3 ])
 
+def test_mcf_rc_read_values_and_subscribe():
+
+    with ProcessRunner([str(_EXECUTABLE_ABS_PATH)]):
+
+        # create and open target connection
+        tgt_rc = RemoteControl()
+        tgt_rc.connect(_TARGET_IP, _TARGET_PORT)
+
+        tgt_rc.write_value('/points_tc1_in', 'mcf_remote_test_value_types::mcf_remote_test::TestPointXY', [ 1, 2 ])
+        time.sleep(0.1)
+
+        # all topics in one request, missing ones map to None
+        values = tgt_rc.read_values(['/points_tc1_in', '/no_such_topic', '/points_tc1_in'])
+        assert values['/points_tc1_in'][0] == [ 1, 2 ]
+        assert values['/no_such_topic'] is None
+
+        # the current value is published right after subscribing
+        assert tgt_rc.subscribe('/points_tc1_in', max_rate=5.)
+        published = tgt_rc.receive_published(timeout=1000)
+        assert published is not None
+        assert published[0] == '/points_tc1_in'
+        assert published[1][0] == [ 1, 2 ]
+
+        # unchanged values are not published again
+        assert tgt_rc.receive_published(timeout=300) is None
+
+        # changes within the rate limit are skipped, the latest one is published once due
+        for i in range(5):
+            tgt_rc.write_value('/points_tc1_in', 'mcf_remote_test_value_types::mcf_remote_test::TestPointXY', [ i, 0 ])
+        received = []
+        published = tgt_rc.receive_published(timeout=1000)
+        while published is not None:
+            received.append(published[1][0])
+            published = tgt_rc.receive_published(timeout=500)
+        assert 0 < len(received) <= 2
+        assert received[-1] == [ 4, 0 ]
+
+        assert tgt_rc.unsubscribe('/points_tc1_in')
+        tgt_rc.write_value('/points_tc1_in', 'mcf_remote_test_value_types::mcf_remote_test::TestPointXY', [ 5, 0 ])
+        assert tgt_rc.receive_published(timeout=300) is None
+
 def test_mcf_value_accessor():
     with ProcessRunner([str(_EXECUTABLE_ABS_PATH)]):
 
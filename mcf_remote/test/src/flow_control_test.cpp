@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_remote/FlowControl.h"
+
+#include "gtest/gtest.h"
+
+namespace mcf {
+
+namespace remote {
+
+using std::chrono::milliseconds;
+
+TEST(FlowControlTest, Unlimited)
+{
+    FlowControl flowControl(FlowControl::Config{});
+    const auto now = FlowControl::Clock::now();
+
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_EQ(FlowControl::Clock::duration::zero(), flowControl.acquire(10 * 1024 * 1024, now));
+    }
+    EXPECT_EQ(0u, flowControl.statistics().delayed);
+}
+
+TEST(FlowControlTest, TokenBucket)
+{
+    FlowControl::Config config;
+    config.maxRate = 1000;
+    config.burst = 1000;
+    FlowControl flowControl(config);
+    const auto now = FlowControl::Clock::now();
+
+    EXPECT_EQ(FlowControl::Clock::duration::zero(), flowControl.acquire(600, now));
+
+    // 400 bytes left, the missing 200 bytes take 200 ms
+    const auto wait = flowControl.acquire(600, now);
+    EXPECT_NEAR(200., std::chrono::duration<double, std::milli>(wait).count(), 1.);
+    EXPECT_EQ(FlowControl::Clock::duration::zero(), flowControl.acquire(600, now + milliseconds(200)));
+
+    // values larger than the burst wait for a full bucket and leave it in debt
+    EXPECT_GT(flowControl.acquire(5000, now + milliseconds(500)), FlowControl::Clock::duration::zero());
+    EXPECT_EQ(FlowControl::Clock::duration::zero(), flowControl.acquire(5000, now + milliseconds(1200)));
+    EXPECT_GT(flowControl.acquire(100, now + milliseconds(2200)), FlowControl::Clock::duration::zero());
+
+    EXPECT_EQ(3u, flowControl.statistics().delayed);
+}
+
+TEST(FlowControlTest, AdaptiveCongestion)
+{
+    FlowControl::Config config;
+    config.adaptive = true;
+    FlowControl flowControl(config);
+    const auto now = FlowControl::Clock::now();
+
+    // 1000 bytes acked per millisecond
+    for (int i = 1; i <= 100; ++i)
+    {
+        flowControl.valueAcked(1000, milliseconds(1), "INJECTED", now + milliseconds(i));
+    }
+    auto statistics = flowControl.statistics();
+    EXPECT_NEAR(1e6, statistics.bandwidth, 1e3);
+    EXPECT_EQ(0., statistics.rate);
+    EXPECT_EQ(0u, statistics.congestionLevel);
+    EXPECT_EQ(0u, flowControl.decimationShift(2, 3));
+
+    // a time out congests the link: the rate drops below the bandwidth, the lowest lane decimates
+    flowControl.valueAcked(1000, milliseconds(100), "TIMEOUT", now + milliseconds(200));
+    statistics = flowControl.statistics();
+    EXPECT_EQ(1u, statistics.congestionLevel);
+    EXPECT_NEAR(850e3, statistics.rate, 1e3);
+    EXPECT_EQ(0u, flowControl.decimationShift(0, 3));
+    EXPECT_EQ(0u, flowControl.decimationShift(1, 3));
+    EXPECT_EQ(1u, flowControl.decimationShift(2, 3));
+    EXPECT_EQ(1u, flowControl.decimationShift(1, 2));
+
+    // recovery raises the rate step by step
+    for (int i = 201; i <= 300; ++i)
+    {
+        flowControl.valueAcked(1000, milliseconds(1), "INJECTED", now + milliseconds(i));
+    }
+    statistics = flowControl.statistics();
+    EXPECT_EQ(0u, statistics.congestionLevel);
+    EXPECT_NEAR(935e3, statistics.rate, 1e3);
+    EXPECT_EQ(0u, flowControl.decimationShift(2, 3));
+}
+
+} // end namespace remote
+
+} // end namespace mcf
@@ -4,17 +4,70 @@
 #include "gtest/gtest.h"
 #include "mcf_remote/RemoteControl.h"
 
+#include <chrono>
+#include <thread>
+
 namespace mcf {
 
 namespace remote {
 
 class RemoteControlTest : public ::testing::Test {
 public:
+    class TestValue : public mcf::Value {
+    public:
+        TestValue(int val=0) : val(val) {}
+        int val;
+        MSGPACK_DEFINE(val);
+    };
 };
 
 TEST_F(RemoteControlTest, Simple) {
 }
 
+TEST_F(RemoteControlTest, InjectValues) {
+    const int port = 16380;
+    ValueStore valueStore;
+    valueStore.registerType<TestValue>("TestValue");
+    ComponentManager manager(valueStore);
+    manager.registerComponent(std::make_shared<RemoteControl>(port, manager, valueStore));
+    manager.configure();
+    manager.startup();
+
+    zmq::context_t context(1);
+    zmq::socket_t client(context, ZMQ_REQ);
+    client.connect("tcp://localhost:" + std::to_string(port));
+    msgpack::sbuffer request;
+    msgpack::pack(request, std::map<std::string, std::string>{{"command", "inject_port"}});
+    client.send(request.data(), request.size());
+    zmq::message_t response;
+    client.recv(&response);
+    auto responseHandle = msgpack::unpack(static_cast<const char*>(response.data()), response.size());
+    auto responseMap = responseHandle.get().as<std::map<std::string, msgpack::object>>();
+    ASSERT_EQ("response", responseMap["type"].as<std::string>());
+    const int injectPort = responseMap["content"].as<std::map<std::string, int>>()["port"];
+
+    // without event queueing, injected values are written to the value store at once
+    zmq::socket_t injector(context, ZMQ_PUSH);
+    injector.connect("tcp://localhost:" + std::to_string(injectPort));
+    const int n = 1000;
+    for (int i = 1; i <= n; ++i) {
+        msgpack::sbuffer header;
+        msgpack::pack(header, std::map<std::string, std::string>{{"topic", "/injected"}});
+        msgpack::sbuffer value;
+        msgpack::pack(value, std::string("TestValue"));
+        msgpack::pack(value, TestValue(i));
+        injector.send(header.data(), header.size(), ZMQ_SNDMORE);
+        injector.send(value.data(), value.size(), ZMQ_SNDMORE);
+        injector.send(nullptr, 0);
+    }
+    for (int i = 0; i < 500 && !(valueStore.hasValue("/injected")
+                                  && valueStore.getValue<TestValue>("/injected")->val == n); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(n, valueStore.getValue<TestValue>("/injected")->val);
+    manager.shutdown();
+}
+
 }
 
 }
\ No newline at end of file
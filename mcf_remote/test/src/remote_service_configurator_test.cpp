@@ -7,6 +7,8 @@
 #include "mcf_core/Component.h"
 #include "mcf_remote/RemoteService.h"
 #include "mcf_remote/RemoteServiceConfigurator.h"
+#include "mcf_remote/RemoteServiceUtils.h"
+#include "mcf_remote/ZmqContext.h"
 
 #include "json/json.h"
 
@@ -201,6 +203,93 @@ TEST_F(RemoteServiceConfiguratorTest, Simple) {
     cm2.shutdown();
 }
 
+TEST_F(RemoteServiceConfiguratorTest, RegisteredTransport) {
+    mcf::ValueStore vs;
+    registerValueTypes(vs);
+
+    mcf::remote::RemoteServiceConfigurator rsc(vs);
+
+    std::string sendConnection;
+    std::string option;
+    rsc.registerTransport("custom", [&sendConnection, &option](
+        const RemoteServiceConfigurator::TransportParameters& params)
+    {
+        sendConnection = params.sendConnection;
+        option = params.config["customOption"].asString();
+        return buildZmqRemoteService(params.sendConnection,
+                                     params.receiveConnection,
+                                     params.valueStore,
+                                     params.shmemKeeper,
+                                     params.shmemClient,
+                                     params.sendTimeout,
+                                     params.artificialJitter,
+                                     params.pipelined);
+    });
+
+    std::string strJson(
+        "{"
+        "    \"bridge\": {"
+        "        \"sendConnection\": \"tcp://127.0.0.1:5552\","
+        "        \"receiveConnection\": \"tcp://127.0.0.1:5553\","
+        "        \"transport\": \"custom\","
+        "        \"customOption\": \"value\","
+        "        \"sendRules\": [],"
+        "        \"receiveRules\": []"
+        "    }"
+        "}"
+    );
+    Json::Value config;
+    Json::Reader reader;
+    reader.parse( strJson.c_str(), config );
+
+    auto instances = rsc.configureFromJSONNode(config);
+    EXPECT_EQ(1u, instances.size());
+    EXPECT_NE(nullptr, instances["bridge"]);
+    EXPECT_EQ("tcp://127.0.0.1:5552", sendConnection);
+    EXPECT_EQ("value", option);
+
+    config["bridge"]["transport"] = "unknown";
+    EXPECT_THROW(rsc.configureFromJSONNode(config), std::runtime_error);
+}
+
+TEST_F(RemoteServiceConfiguratorTest, ZmqContext)
+{
+    std::string strJson(
+        "{"
+        "    \"ZmqContext\": {"
+        "        \"ioThreads\": 2,"
+        "        \"cpuAffinity\": \"2-3\","
+        "        \"priority\": 30,"
+        "        \"sendBufferSize\": 65536"
+        "    }"
+        "}"
+    );
+    Json::Value config;
+    Json::Reader reader;
+    reader.parse( strJson.c_str(), config );
+
+    ZmqContextConfig contextConfig = RemoteServiceConfigurator::readZmqContextConfiguration(config);
+    EXPECT_EQ(2, contextConfig.ioThreads);
+    EXPECT_EQ(0xcu, contextConfig.cpuAffinity);
+    EXPECT_EQ(30, contextConfig.priority);
+    EXPECT_EQ(65536, contextConfig.sendBufferSize);
+    EXPECT_EQ(-1, contextConfig.receiveBufferSize);
+
+    // the context is only configured if the object is present
+    EXPECT_EQ(1, RemoteServiceConfigurator::readZmqContextConfiguration(Json::Value()).ioThreads);
+
+    config["ZmqContext"]["ioThreads"] = 0;
+    EXPECT_THROW(RemoteServiceConfigurator::readZmqContextConfiguration(config), Json::Exception);
+    config["ZmqContext"]["ioThreads"] = 1;
+    config["ZmqContext"]["cpuAffinity"] = "3-x";
+    EXPECT_THROW(RemoteServiceConfigurator::readZmqContextConfiguration(config), Json::Exception);
+
+    // all endpoints share one context while it is in use
+    auto context = ZmqContext::shared();
+    EXPECT_EQ(context, ZmqContext::shared());
+    ZmqContext::configure(ZmqContextConfig());
+}
+
 } // end namespace remote
 
 } // end namespace mcf
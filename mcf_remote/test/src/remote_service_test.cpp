@@ -289,6 +289,70 @@ TEST_F(RemoteServiceTest, ExtMemValue) {
     cm2.shutdown();
 }
 
+TEST_F(RemoteServiceTest, SendWorkers) {
+    mcf::ValueStore vs1;
+    mcf::ValueStore vs2;
+
+    registerValueTypes(vs1);
+    registerValueTypes(vs2);
+
+    mcf::ComponentManager cm1(vs1);
+    mcf::ComponentManager cm2(vs2);
+
+    auto sender = buildZmqRemoteService(
+        "ipc:///tmp/0", "ipc:///tmp/1", vs1, nullptr, nullptr,
+        std::chrono::milliseconds(100), std::chrono::milliseconds(0), false, 2);
+    auto receiver = buildZmqRemoteService("ipc:///tmp/1", "ipc:///tmp/0", vs2);
+
+    const std::vector<std::string> topics = {"/test1", "/test2", "/test3"};
+    std::vector<std::shared_ptr<mcf::ValueQueue>> queues;
+    for (const auto& topic : topics) {
+        sender->addSendRule(topic, 1000, true);
+        receiver->addReceiveRule(topic);
+        queues.push_back(std::make_shared<mcf::ValueQueue>());
+        vs2.addReceiver(topic, queues.back());
+    }
+
+    cm1.registerComponent(sender);
+    cm2.registerComponent(receiver);
+
+    cm1.configure();
+    cm2.configure();
+
+    cm1.startup();
+    cm2.startup();
+
+    // wait for remote services to connect
+    for(int i = 0; i < 100; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if(sender->connected() && receiver->connected()) break;
+    }
+    EXPECT_TRUE(sender->connected());
+    EXPECT_TRUE(receiver->connected());
+
+    // the topics are sent by different workers, each keeps the order of its values
+    const int numTestItems = 100;
+    for (int i=0; i<numTestItems; i++) {
+        for (const auto& topic : topics) {
+            vs1.setValue(topic, TestValue(i));
+        }
+    }
+
+    for (auto& queue : queues) {
+        for (int i=0; i<numTestItems; i++) {
+            for (int j=0; j<1000 && queue->empty(); j++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            ASSERT_FALSE(queue->empty());
+            EXPECT_EQ(i, queue->pop<TestValue>()->val);
+        }
+    }
+
+    cm1.shutdown();
+    cm2.shutdown();
+}
+
 } // end namespace remote
 
 } // end namespace mcf
@@ -17,7 +17,7 @@ public:
     class TestSender : public AbstractSender
     {
     public:
-        std::string sendValue(const std::string& topic, ValuePtr value) override
+        std::string sendValue(const std::string& topic, ValuePtr value, uint64_t seq) override
         {
             return "";
         }
@@ -180,6 +180,64 @@ TEST_F(RemoteStatusTrackerTest, MultiThreaded)
     cyclicRunner.join();
 }
 
+TEST_F(RemoteStatusTrackerTest, CompressionStatistics)
+{
+    RemoteStatusTracker rst([](uint64_t) {});
+    EXPECT_TRUE(rst.getCompressionStatistics().empty());
+
+    rst.valueCompressed("/a", 1000, 250, std::chrono::microseconds(10));
+    rst.valueCompressed("/a", 1000, 250, std::chrono::microseconds(30));
+    rst.valueCompressed("/b", 100, 100, std::chrono::microseconds(1));
+
+    auto statistics = rst.getCompressionStatistics();
+    ASSERT_EQ(2u, statistics.size());
+    EXPECT_EQ(2u, statistics["/a"].values);
+    EXPECT_EQ(2000u, statistics["/a"].rawBytes);
+    EXPECT_EQ(500u, statistics["/a"].wireBytes);
+    EXPECT_EQ(std::chrono::microseconds(40), statistics["/a"].time);
+    EXPECT_DOUBLE_EQ(4., statistics["/a"].ratio());
+    EXPECT_DOUBLE_EQ(1., statistics["/b"].ratio());
+}
+
+TEST_F(RemoteStatusTrackerTest, ClockEstimate)
+{
+    using std::chrono::milliseconds;
+    RemoteStatusTracker rst([](uint64_t) {});
+    const auto local = std::chrono::system_clock::now();
+    // the clock of the other side is 5ms ahead
+    const auto remote = local + milliseconds(5);
+
+    // values received without clock estimate are not recorded
+    rst.valueStampReceived("/a", remote, local + milliseconds(3));
+    EXPECT_TRUE(rst.getLatencyStatistics().empty());
+    EXPECT_EQ(0u, rst.getClockEstimate().samples);
+
+    // 2ms each way, 1ms to respond
+    rst.clockSampled(local, remote + milliseconds(2), remote + milliseconds(3), local + milliseconds(5));
+    auto estimate = rst.getClockEstimate();
+    EXPECT_EQ(1u, estimate.samples);
+    EXPECT_EQ(milliseconds(5), estimate.offset);
+    EXPECT_EQ(milliseconds(4), estimate.roundTrip);
+
+    // asymmetric delays of a slower round trip do not distort the estimate
+    rst.clockSampled(local + milliseconds(100), remote + milliseconds(110),
+                     remote + milliseconds(110), local + milliseconds(112));
+    estimate = rst.getClockEstimate();
+    EXPECT_EQ(2u, estimate.samples);
+    EXPECT_EQ(milliseconds(5), estimate.offset);
+    EXPECT_EQ(milliseconds(4), estimate.roundTrip);
+
+    rst.valueStampReceived("/a", remote + milliseconds(200), local + milliseconds(203));
+    rst.valueStampReceived("/a", remote + milliseconds(300), local + milliseconds(301));
+    auto statistics = rst.getLatencyStatistics();
+    ASSERT_EQ(1u, statistics.size());
+    EXPECT_EQ(2u, statistics["/a"].values);
+    EXPECT_EQ(milliseconds(1), statistics["/a"].last);
+    EXPECT_EQ(milliseconds(1), statistics["/a"].min);
+    EXPECT_EQ(milliseconds(3), statistics["/a"].max);
+    EXPECT_EQ(milliseconds(2), statistics["/a"].mean());
+}
+
 } // end namespace remote
 
 } // end namespace mcf
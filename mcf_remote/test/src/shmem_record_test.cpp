@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_remote/ShmemRecordHandoff.h"
+
+#include "mcf_core/ExtMemValue.h"
+#include "mcf_core/RecordReader.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <thread>
+
+namespace mcf {
+
+namespace remote {
+
+namespace {
+
+class TestValue : public mcf::Value {
+public:
+    TestValue(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+class TestValueExtMem : public mcf::ExtMemValue<uint8_t> {
+public:
+    TestValueExtMem(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+void registerTestTypes(TypeRegistry& registry)
+{
+    registry.registerType<TestValue>("TestValue");
+    registry.registerType<TestValueExtMem>("TestValueExtMem");
+}
+
+} // anonymous namespace
+
+TEST(ShmemRecordTest, RingWrapsAround)
+{
+    const size_t capacity = 64;
+    std::vector<char> memory(ShmemRecordRing::partitionSize(capacity));
+    ShmemRecordRing::init(memory.data(), capacity);
+    ShmemRecordRing producer(memory.data());
+    ShmemRecordRing consumer(memory.data());
+
+    char data[40];
+    std::fill(data, data + sizeof(data), 'a');
+    iovec iov{data, 20};
+    const char* entry = nullptr;
+    size_t size = 0;
+    EXPECT_FALSE(consumer.peek(entry, size));
+    EXPECT_EQ(0, producer.write(&iov, 1));
+    EXPECT_EQ(0, producer.write(&iov, 1));
+    // 2 entries of 24 bytes, the third one does not fit
+    EXPECT_EQ(EAGAIN, producer.write(&iov, 1));
+    iov.iov_len = sizeof(data) + capacity;
+    EXPECT_EQ(EMSGSIZE, producer.write(&iov, 1));
+
+    ASSERT_TRUE(consumer.peek(entry, size));
+    EXPECT_EQ(20u, size);
+    consumer.release();
+
+    // does not fit before the end of the ring, but after the released entry
+    std::fill(data, data + sizeof(data), 'b');
+    iov.iov_len = 20;
+    EXPECT_EQ(0, producer.write(&iov, 1));
+    ASSERT_TRUE(consumer.peek(entry, size));
+    EXPECT_EQ('a', entry[0]);
+    consumer.release();
+    ASSERT_TRUE(consumer.peek(entry, size));
+    EXPECT_EQ(20u, size);
+    EXPECT_EQ(std::string(20, 'b'), std::string(entry, size));
+    consumer.release();
+    EXPECT_FALSE(consumer.peek(entry, size));
+}
+
+TEST(ShmemRecordTest, RecordHandedOverValues)
+{
+    SingleFileShmem keeper(16 * 1024 * 1024);
+    ValueStore valueStore;
+    registerTestTypes(valueStore);
+    ValueRecorder handingRecorder(valueStore);
+    handingRecorder.enableExtMemSerialization("/extmem");
+    auto handoff = std::make_unique<ShmemRecordHandoff>(keeper, "RecordHandoffTest", 1024 * 1024);
+
+    // the recording side, usually in another process
+    ValueStore recorderStore;
+    registerTestTypes(recorderStore);
+    ValueRecorder recorder(recorderStore);
+    ShmemRecordReceiver receiver(
+        recorderStore, recorder, handoff->shmemFileName(), handoff->partitionHandle());
+    handingRecorder.setHandoff(std::move(handoff));
+
+    const std::string testfile = "shmem_record.bin";
+    std::remove(testfile.c_str());
+    handingRecorder.start(testfile);
+    const int n = 20;
+    for (int i = 0; i < n; ++i)
+    {
+        valueStore.setValue("/plain", TestValue(i));
+        auto value = TestValueExtMem(i);
+        value.extMemInit(100);
+        std::fill(value.extMemPtr(), value.extMemPtr() + 100, static_cast<uint8_t>(i));
+        valueStore.setValue("/extmem", std::move(value));
+    }
+    handingRecorder.stop();
+    EXPECT_TRUE(handingRecorder.getRecordFiles().empty());
+
+    // the receiving recorder writes the footer when it has received the stop
+    RecordReader reader;
+    for (int i = 0; i < 500; ++i)
+    {
+        reader.close();
+        reader.open(testfile);
+        if (reader.getFooter() != nullptr)
+        {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_NE(nullptr, reader.getFooter());
+
+    int plain = 0;
+    int extMem = 0;
+    RecordReader::Record record;
+    while (reader.next(record))
+    {
+        if (record.topic == "/plain")
+        {
+            auto value = std::dynamic_pointer_cast<const TestValue>(
+                RecordReader::getValue(record, recorderStore));
+            ASSERT_NE(nullptr, value);
+            EXPECT_EQ(plain++, value->val);
+        }
+        else if (record.topic == "/extmem")
+        {
+            auto value = std::dynamic_pointer_cast<const TestValueExtMem>(
+                RecordReader::getValue(record, recorderStore));
+            ASSERT_NE(nullptr, value);
+            EXPECT_EQ(extMem, value->val);
+            ASSERT_EQ(100u, value->extMemSize());
+            EXPECT_EQ(static_cast<uint8_t>(extMem), value->extMemPtr()[99]);
+            ++extMem;
+        }
+    }
+    EXPECT_EQ(n, plain);
+    EXPECT_EQ(n, extMem);
+}
+
+} // end namespace remote
+
+} // end namespace mcf
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_remote/ShmemTopics.h"
+
+#include "mcf_core/ExtMemValue.h"
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <thread>
+
+#include <unistd.h>
+
+namespace mcf {
+
+namespace remote {
+
+namespace {
+
+class TestValue : public mcf::Value {
+public:
+    TestValue(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+class TestValueExtMem : public mcf::ExtMemValue<uint8_t> {
+public:
+    TestValueExtMem(int val = 0) : val(val) {}
+    int val;
+    MSGPACK_DEFINE(val);
+};
+
+void registerTestTypes(TypeRegistry& registry)
+{
+    registry.registerType<TestValue>("TestValue");
+    registry.registerType<TestValueExtMem>("TestValueExtMem");
+}
+
+// unique per test process, so that tests running in parallel do not share segments
+std::string segmentName(const std::string& test)
+{
+    return "/mcf_" + test + "_" + std::to_string(getpid());
+}
+
+void writeInt(ShmemTopicSegment& segment, uint32_t topic, int value)
+{
+    ShmemTopicSegment::WriteTicket ticket;
+    void* data = nullptr;
+    ASSERT_EQ(0, segment.beginWrite(topic, sizeof(value), ticket, data));
+    std::memcpy(data, &value, sizeof(value));
+    segment.commitWrite(ticket, 1, sizeof(value));
+}
+
+template<typename T>
+std::shared_ptr<const T> waitForValue(ValueStore& valueStore, const std::string& topic, int val)
+{
+    for (int i = 0; i < 500; ++i)
+    {
+        if (valueStore.hasValue(topic))
+        {
+            auto value = valueStore.getValue<T>(topic);
+            if (value->val == val)
+            {
+                return value;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return nullptr;
+}
+
+} // anonymous namespace
+
+TEST(ShmemTopicsTest, RingKeepsLatestEntries)
+{
+    ShmemTopicSegment writer(segmentName("ring"), 1024 * 1024);
+    ShmemTopicSegment reader(segmentName("ring"));
+    const uint32_t topic = writer.addTopic("/ring", 16, 4);
+    EXPECT_EQ(topic, reader.addTopic("/ring", 16, 4));
+    EXPECT_EQ(0u, reader.lastSeq(topic));
+
+    for (int i = 1; i <= 6; ++i)
+    {
+        writeInt(writer, topic, i);
+    }
+    ShmemTopicSegment::WriteTicket ticket;
+    void* data = nullptr;
+    EXPECT_EQ(EMSGSIZE, writer.beginWrite(topic, 17, ticket, data));
+
+    std::vector<char> entry;
+    uint64_t writerId = 0;
+    EXPECT_EQ(6u, reader.lastSeq(topic));
+    // the first two entries have been overwritten by the last two
+    EXPECT_EQ(ShmemTopicSegment::ReadResult::LOST, reader.read(topic, 2, entry, writerId));
+    ASSERT_EQ(ShmemTopicSegment::ReadResult::OK, reader.read(topic, 3, entry, writerId));
+    EXPECT_EQ(1u, writerId);
+    ASSERT_EQ(sizeof(int), entry.size());
+    int value = 0;
+    std::memcpy(&value, entry.data(), sizeof(value));
+    EXPECT_EQ(3, value);
+    EXPECT_EQ(ShmemTopicSegment::ReadResult::PENDING, reader.read(topic, 7, entry, writerId));
+
+    // a waiting reader is woken by the next entry
+    const uint32_t seen = reader.notifications();
+    std::thread thread([&writer, topic] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        writeInt(writer, topic, 7);
+    });
+    reader.wait(seen, std::chrono::seconds(5));
+    thread.join();
+    EXPECT_NE(seen, reader.notifications());
+    EXPECT_EQ(ShmemTopicSegment::ReadResult::OK, reader.read(topic, 7, entry, writerId));
+}
+
+TEST(ShmemTopicsTest, ShareTopicsBetweenValueStores)
+{
+    // each bridge stands for a process
+    ValueStore storeA;
+    registerTestTypes(storeA);
+    ShmemTopicBridge bridgeA(storeA, segmentName("share"), 1024 * 1024);
+    bridgeA.share("/plain", 64);
+    bridgeA.share("/extmem", 1024);
+
+    ValueStore storeB;
+    registerTestTypes(storeB);
+    ShmemTopicBridge bridgeB(storeB, segmentName("share"));
+    bridgeB.share("/plain", 64);
+    bridgeB.share("/extmem", 1024);
+
+    auto plain = std::make_shared<TestValue>(1);
+    storeA.setValue("/plain", ValuePtr(plain));
+    auto extMem = std::make_shared<TestValueExtMem>(2);
+    extMem->extMemInit(100);
+    std::fill(extMem->extMemPtr(), extMem->extMemPtr() + 100, static_cast<uint8_t>(2));
+    storeA.setValue("/extmem", ValuePtr(extMem));
+
+    auto receivedPlain = waitForValue<TestValue>(storeB, "/plain", 1);
+    ASSERT_NE(nullptr, receivedPlain);
+    EXPECT_EQ(plain->id(), receivedPlain->id());
+    auto receivedExtMem = waitForValue<TestValueExtMem>(storeB, "/extmem", 2);
+    ASSERT_NE(nullptr, receivedExtMem);
+    ASSERT_EQ(100u, receivedExtMem->extMemSize());
+    EXPECT_EQ(2u, receivedExtMem->extMemPtr()[99]);
+
+    // the other way round, values are not echoed back to their writer
+    storeB.setValue("/plain", TestValue(3));
+    ASSERT_NE(nullptr, waitForValue<TestValue>(storeA, "/plain", 3));
+    EXPECT_EQ(extMem, storeA.getValue<TestValueExtMem>("/extmem"));
+
+    // values exceeding the slots are not shared
+    auto large = std::make_shared<TestValueExtMem>(4);
+    large->extMemInit(2048);
+    storeA.setValue("/extmem", ValuePtr(large));
+    storeA.setValue("/plain", TestValue(5));
+    ASSERT_NE(nullptr, waitForValue<TestValue>(storeB, "/plain", 5));
+    EXPECT_EQ(2, storeB.getValue<TestValueExtMem>("/extmem")->val);
+
+    // a process sharing a topic later starts with its latest value
+    ValueStore storeC;
+    registerTestTypes(storeC);
+    ShmemTopicBridge bridgeC(storeC, segmentName("share"));
+    bridgeC.share("/plain", 64);
+    EXPECT_NE(nullptr, waitForValue<TestValue>(storeC, "/plain", 5));
+}
+
+} // end namespace remote
+
+} // end namespace mcf
@@ -3,6 +3,9 @@
  */
 #include "mcf_core/LoggingMacros.h"
 
+#include "mcf_remote/RelayedValue.h"
+#include "mcf_remote/Remote.h"
+#include "mcf_remote/ZmqMsgPackAsyncSender.h"
 #include "mcf_remote/ZmqMsgPackSender.h"
 #include "mcf_remote/ZmqMsgPackValueReceiver.h"
 #include "mcf_remote/IComEventListener.h"
@@ -13,6 +16,8 @@
 
 #include "gtest/gtest.h"
 
+#include <cstring>
+#include <map>
 #include <thread>
 
 namespace mcf {
@@ -33,6 +38,46 @@ public:
         MSGPACK_DEFINE();
     };
 
+    /**
+     * Stands in for device memory: the exported handle carries a copy of the ext mem
+     */
+    class ExportedTestValue : public mcf::ExtMemValue<int32_t> {
+    public:
+        bool extMemExport(std::string& handle) const override
+        {
+            handle.assign(reinterpret_cast<const char*>(extMemPtr()), extMemSize());
+            return true;
+        }
+
+        bool extMemImport(const std::string& handle) override
+        {
+            extMemInit(handle.size());
+            std::memcpy(extMemPtr(), handle.data(), handle.size());
+            imported = true;
+            return true;
+        }
+
+        void extMemWithdraw(const std::string& handle) const override
+        {
+            withdrawn = true;
+        }
+
+        bool imported = false;
+        mutable bool withdrawn = false;
+        MSGPACK_DEFINE();
+    };
+
+    /**
+     * Stands in for device memory the receiving process cannot map
+     */
+    class UnimportableTestValue : public ExportedTestValue {
+    public:
+        bool extMemImport(const std::string& handle) override
+        {
+            return false;
+        }
+    };
+
     void initExtMem(ExtMemTestValue& emtv, const uint64_t len)
     {
         emtv.extMemInit(len * sizeof(int32_t));
@@ -82,6 +127,17 @@ public:
             requestedAll = true;
         }
 
+        void requestStaleReceived(const std::map<std::string, uint64_t>& ids) override
+        {
+            requestedStale = true;
+            heldIds = ids;
+        }
+
+        void subscriptionsReceived(const std::map<std::string, bool>& topics) override
+        {
+            subscribed = topics;
+        }
+
         void blockedValueInjectedReceived(const std::string& topic) override
         {
             injected = topic;
@@ -92,6 +148,16 @@ public:
             rejected = topic;
         }
 
+        void valueStampReceived(
+            const std::string& topic,
+            std::chrono::system_clock::time_point sent,
+            std::chrono::system_clock::time_point received) override
+        {
+            stampedTopic = topic;
+            stampSent = sent;
+            stampReceived = received;
+        }
+
         uint64_t freshnessValue()
         {
             return _pingValue.load();
@@ -101,8 +167,14 @@ public:
         ValuePtr testValue = nullptr;
         ValuePtr extMemTestValue = nullptr;
         bool requestedAll = false;
+        bool requestedStale = false;
+        std::map<std::string, uint64_t> heldIds;
+        std::map<std::string, bool> subscribed;
         std::string injected;
         std::string rejected;
+        std::string stampedTopic;
+        std::chrono::system_clock::time_point stampSent;
+        std::chrono::system_clock::time_point stampReceived;
 
     private:
         std::atomic<uint64_t> _pingValue;
@@ -113,6 +185,8 @@ public:
     {
         r.template registerType<TestValue>("TestValue");
         r.template registerType<ExtMemTestValue>("ExtMemTestValue");
+        r.template registerType<ExportedTestValue>("ExportedTestValue");
+        r.template registerType<UnimportableTestValue>("UnimportableTestValue");
     }
 };
 
@@ -244,6 +318,58 @@ TEST_F(ZmqMsgPackTest, PingPong)
     ASSERT_EQ(freshnessValue, cel.pongFreshnessValue);
 }
 
+TEST_F(ZmqMsgPackTest, StampedValue)
+{
+    ValueStore vs;
+    registerValueTypes(vs);
+
+    ZmqMsgPackSender sender("ipc:///tmp/0", vs, std::chrono::milliseconds(1000));
+    ZmqMsgPackValueReceiver receiver("ipc:///tmp/0", vs);
+
+    ComEventListener cel;
+    receiver.setEventListener(&cel);
+
+    std::vector<AbstractSender::ClockSample> samples;
+    sender.setClockObserver([&samples](const AbstractSender::ClockSample& sample) {
+        samples.push_back(sample);
+    });
+
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    sender.connect();
+
+    std::thread receiveMsgs(&receive, std::ref(receiver), 3, std::ref(cv));
+
+    // wait for receiver to be set up;
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk);
+    }
+
+    // values are not stamped before the receiver has answered a ping with its clock
+    std::shared_ptr<const TestValue> value = std::make_shared<TestValue>(1);
+    EXPECT_EQ("INJECTED", sender.sendValue("TestValue", value));
+    EXPECT_TRUE(cel.stampedTopic.empty());
+
+    sender.sendPing(1ul);
+    ASSERT_EQ(1u, samples.size());
+    EXPECT_LE(samples[0].pingSent, samples[0].pingReceived);
+    EXPECT_LE(samples[0].pingReceived, samples[0].responseSent);
+    EXPECT_LE(samples[0].responseSent, samples[0].responseReceived);
+
+    const auto beforeSend = std::chrono::system_clock::now();
+    EXPECT_EQ("INJECTED", sender.sendValue("TestValue", value));
+    EXPECT_EQ("TestValue", cel.stampedTopic);
+    EXPECT_LE(beforeSend, cel.stampSent);
+    EXPECT_LE(cel.stampSent, cel.stampReceived);
+    ASSERT_NE(nullptr, cel.testValue);
+    EXPECT_EQ(1, std::dynamic_pointer_cast<const TestValue>(cel.testValue)->val);
+
+    receiveMsgs.join();
+    sender.disconnect();
+}
+
 TEST_F(ZmqMsgPackTest, Value)
 {
     ValueStore vs;
@@ -305,6 +431,559 @@ TEST_F(ZmqMsgPackTest, Value)
     checkExtMem(celExtMemTestValue, len);
 }
 
+TEST_F(ZmqMsgPackTest, Relay)
+{
+    ValueStore vs;
+    registerValueTypes(vs);
+
+    ZmqMsgPackSender sender("ipc:///tmp/0", vs);
+    ZmqMsgPackValueReceiver relayReceiver("ipc:///tmp/0", vs);
+    relayReceiver.setRelayTopics({"TestValue", "ExtMemTestValue"});
+    ZmqMsgPackSender relaySender("ipc:///tmp/1", vs);
+    ZmqMsgPackValueReceiver receiver("ipc:///tmp/1", vs);
+
+    ComEventListener relayCel;
+    relayReceiver.setEventListener(&relayCel);
+    ComEventListener cel;
+    receiver.setEventListener(&cel);
+
+    std::mutex cv_m;
+    std::condition_variable relayCv;
+    std::condition_variable cv;
+
+    std::thread relayValues(&receive, std::ref(relayReceiver), 2, std::ref(relayCv));
+    std::thread receiveValues(&receive, std::ref(receiver), 2, std::ref(cv));
+
+    // wait for receivers to be set up;
+    {
+        std::unique_lock<std::mutex> lk(cv_m);
+        relayCv.wait(lk);
+        cv.wait(lk);
+    }
+
+    sender.connect();
+    relaySender.connect();
+
+    std::shared_ptr<const TestValue> value = std::make_shared<const TestValue>(940824);
+    EXPECT_EQ("INJECTED", sender.sendValue("TestValue", value));
+
+    const uint64_t len = 768;
+    ExtMemTestValue extMemValue;
+    initExtMem(extMemValue, len);
+    EXPECT_EQ("INJECTED", sender.sendValue(
+        "ExtMemTestValue",
+        std::make_shared<const ExtMemTestValue>(std::move(extMemValue))));
+
+    // the relay receiver keeps the values in their wire format
+    auto relayedTestValue = std::dynamic_pointer_cast<const RelayedValue>(relayCel.testValue);
+    auto relayedExtMemValue = std::dynamic_pointer_cast<const RelayedValue>(relayCel.extMemTestValue);
+    ASSERT_NE(nullptr, relayedTestValue.get());
+    ASSERT_NE(nullptr, relayedExtMemValue.get());
+
+    // their serialized form is what the value recorder writes
+    const auto* serialized = relayedTestValue->serializedForm();
+    ASSERT_NE(nullptr, serialized);
+    EXPECT_EQ(value->val, msgpack::unpack(serialized->data, serialized->size).get().as<std::vector<int>>()[0]);
+    EXPECT_EQ(nullptr, serialized->extMem);
+    serialized = relayedExtMemValue->serializedForm();
+    ASSERT_NE(nullptr, serialized);
+    EXPECT_NE(nullptr, serialized->extMem);
+    EXPECT_EQ(len * sizeof(int32_t), serialized->extMemSize);
+
+    // and forwards them as received
+    EXPECT_EQ("INJECTED", relaySender.sendValue("TestValue", relayedTestValue));
+    EXPECT_EQ("INJECTED", relaySender.sendValue("ExtMemTestValue", relayedExtMemValue));
+
+    relayValues.join();
+    receiveValues.join();
+    sender.disconnect();
+    relaySender.disconnect();
+
+    std::shared_ptr<const TestValue> celTestValue =
+        std::dynamic_pointer_cast<const TestValue>(cel.testValue);
+    ASSERT_NE(nullptr, celTestValue.get());
+    EXPECT_EQ(value->val, celTestValue->val);
+    EXPECT_EQ(relayedTestValue->id(), celTestValue->id());
+
+    std::shared_ptr<const ExtMemTestValue> celExtMemTestValue =
+        std::dynamic_pointer_cast<const ExtMemTestValue>(cel.extMemTestValue);
+    checkExtMem(celExtMemTestValue, len);
+    EXPECT_EQ(relayedExtMemValue->id(), celExtMemTestValue->id());
+}
+
+TEST_F(ZmqMsgPackTest, NumericTypeId)
+{
+    ValueStore vs;
+    registerValueTypes(vs);
+
+    const TypeRegistry::TypemapEntry* typeInfo = vs.findTypeInfo(TestValue(0));
+    ASSERT_NE(nullptr, typeInfo);
+    EXPECT_EQ(TypeRegistry::hashTypeId("TestValue"), typeInfo->numericId);
+    EXPECT_EQ(typeInfo, vs.findTypeInfo(typeInfo->numericId));
+
+    ZmqMsgPackSender sender("ipc:///tmp/0", vs, std::chrono::milliseconds(1000));
+    ZmqMsgPackValueReceiver relayReceiver("ipc:///tmp/0", vs);
+    relayReceiver.setRelayTopics({"TestValue"});
+    ZmqMsgPackSender relaySender("ipc:///tmp/1", vs);
+    ZmqMsgPackValueReceiver receiver("ipc:///tmp/1", vs);
+
+    ComEventListener relayCel;
+    relayReceiver.setEventListener(&relayCel);
+    ComEventListener cel;
+    receiver.setEventListener(&cel);
+
+    std::mutex cv_m;
+    std::condition_variable relayCv;
+    std::condition_variable cv;
+
+    std::thread relayValues(&receive, std::ref(relayReceiver), 2, std::ref(relayCv));
+    std::thread receiveValues(&receive, std::ref(receiver), 1, std::ref(cv));
+
+    // wait for receivers to be set up;
+    {
+        std::unique_lock<std::mutex> lk(cv_m);
+        relayCv.wait(lk);
+        cv.wait(lk);
+    }
+
+    sender.connect();
+    relaySender.connect();
+
+    // the relay receiver announces numeric type ids in its ping response
+    sender.sendPing(1ul);
+    std::shared_ptr<const TestValue> value = std::make_shared<const TestValue>(190315);
+    EXPECT_EQ("INJECTED", sender.sendValue("TestValue", value));
+
+    auto relayedTestValue = std::dynamic_pointer_cast<const RelayedValue>(relayCel.testValue);
+    ASSERT_NE(nullptr, relayedTestValue.get());
+    EXPECT_TRUE(impl::hasNumericTypeId(relayedTestValue->serialized()));
+
+    // the relay sender has not pinged its receiver, so it falls back to the type name
+    EXPECT_EQ("INJECTED", relaySender.sendValue("TestValue", relayedTestValue));
+
+    relayValues.join();
+    receiveValues.join();
+    sender.disconnect();
+    relaySender.disconnect();
+
+    std::shared_ptr<const TestValue> celTestValue =
+        std::dynamic_pointer_cast<const TestValue>(cel.testValue);
+    ASSERT_NE(nullptr, celTestValue.get());
+    EXPECT_EQ(value->val, celTestValue->val);
+}
+
+TEST_F(ZmqMsgPackTest, ExportedExtMem)
+{
+    ValueStore vs;
+    registerValueTypes(vs);
+
+    ZmqMsgPackSender sender("ipc:///tmp/0", vs, std::chrono::milliseconds(1000));
+    ZmqMsgPackValueReceiver receiver("ipc:///tmp/0", vs);
+    sender.setExtMemExport(true);
+
+    ComEventListener cel;
+    receiver.setEventListener(&cel);
+
+    std::mutex cv_m;
+    std::condition_variable cv;
+
+    sender.connect();
+
+    std::thread receiveValues(&receive, std::ref(receiver), 3, std::ref(cv));
+
+    // wait for receiver to be set up;
+    {
+        std::unique_lock<std::mutex> lk(cv_m);
+        cv.wait(lk);
+    }
+
+    const uint64_t len = 768;
+    auto makeValue = [len]() {
+        auto value = std::make_shared<ExportedTestValue>();
+        value->extMemInit(len * sizeof(int32_t));
+        int32_t* extMemPtr = reinterpret_cast<int32_t*>(value->extMemPtr());
+        for(uint64_t i = 0; i < len; ++i) {
+            extMemPtr[i] = i;
+        }
+        return value;
+    };
+
+    // the ext mem is sent as usual before the receiver has announced that it imports exports
+    EXPECT_EQ("INJECTED", sender.sendValue("ExtMemTestValue", makeValue()));
+    auto received = std::dynamic_pointer_cast<const ExportedTestValue>(cel.extMemTestValue);
+    ASSERT_NE(nullptr, received);
+    EXPECT_FALSE(received->imported);
+
+    sender.sendPing(1ul);
+    EXPECT_EQ("INJECTED", sender.sendValue("ExtMemTestValue", makeValue()));
+
+    receiveValues.join();
+    sender.disconnect();
+
+    received = std::dynamic_pointer_cast<const ExportedTestValue>(cel.extMemTestValue);
+    ASSERT_NE(nullptr, received);
+    EXPECT_TRUE(received->imported);
+    ASSERT_EQ(len * sizeof(int32_t), received->extMemSize());
+    const int32_t* extMemPtr = reinterpret_cast<const int32_t*>(received->extMemPtr());
+    for(uint64_t i = 0; i < len; ++i) {
+        EXPECT_EQ(i, extMemPtr[i]);
+    }
+}
+
+TEST_F(ZmqMsgPackTest, ExportedExtMemFallback)
+{
+    ValueStore vs;
+    registerValueTypes(vs);
+
+    ZmqMsgPackSender sender("ipc:///tmp/0", vs, std::chrono::milliseconds(1000));
+    ZmqMsgPackValueReceiver receiver("ipc:///tmp/0", vs);
+    sender.setExtMemExport(true);
+
+    ComEventListener cel;
+    receiver.setEventListener(&cel);
+
+    std::mutex cv_m;
+    std::condition_variable cv;
+
+    sender.connect();
+
+    // the ping, the rejected export, its copy and the next value
+    std::thread receiveValues(&receive, std::ref(receiver), 4, std::ref(cv));
+
+    // wait for receiver to be set up;
+    {
+        std::unique_lock<std::mutex> lk(cv_m);
+        cv.wait(lk);
+    }
+
+    sender.sendPing(1ul);
+
+    auto unimportable = std::make_shared<UnimportableTestValue>();
+    unimportable->extMemInit(16 * sizeof(int32_t));
+    // the receiver rejects the export and accepts the copy sent then
+    EXPECT_EQ("INJECTED", sender.sendValue("ExtMemTestValue", unimportable));
+    EXPECT_TRUE(unimportable->withdrawn);
+    auto received = std::dynamic_pointer_cast<const ExportedTestValue>(cel.extMemTestValue);
+    ASSERT_NE(nullptr, received);
+    EXPECT_FALSE(received->imported);
+    EXPECT_EQ(16 * sizeof(int32_t), received->extMemSize());
+
+    // values which could be exported are copied from now on
+    auto exportable = std::make_shared<ExportedTestValue>();
+    exportable->extMemInit(16 * sizeof(int32_t));
+    EXPECT_EQ("INJECTED", sender.sendValue("ExtMemTestValue", exportable));
+
+    receiveValues.join();
+    sender.disconnect();
+
+    received = std::dynamic_pointer_cast<const ExportedTestValue>(cel.extMemTestValue);
+    ASSERT_NE(nullptr, received);
+    EXPECT_FALSE(received->imported);
+}
+
+#if HAVE_ZLIB
+TEST_F(ZmqMsgPackTest, Compressed)
+{
+    ValueStore vs;
+    registerValueTypes(vs);
+
+    ZmqMsgPackSender sender("ipc:///tmp/0", vs);
+    ZmqMsgPackValueReceiver receiver("ipc:///tmp/0", vs);
+
+    ComEventListener cel;
+    receiver.setEventListener(&cel);
+
+    std::mutex cv_m;
+    std::condition_variable cv;
+
+    std::thread receiveValues(&receive, std::ref(receiver), 2, std::ref(cv));
+
+    // wait for receiver to be set up;
+    {
+        std::unique_lock<std::mutex> lk(cv_m);
+        cv.wait(lk);
+    }
+
+    sender.connect();
+
+    // the small value stays below the threshold and is sent uncompressed
+    sender.setCompression("TestValue", AbstractSender::Compression{6, 1024});
+    sender.setCompression("ExtMemTestValue", AbstractSender::Compression{6, 1024});
+    std::map<std::string, std::pair<size_t, size_t>> sizes;
+    sender.setCompressionObserver(
+        [&sizes](const std::string& topic, size_t rawBytes, size_t wireBytes, std::chrono::nanoseconds)
+        {
+            sizes[topic] = std::make_pair(rawBytes, wireBytes);
+        });
+
+    std::shared_ptr<const TestValue> value = std::make_shared<const TestValue>(940824);
+    EXPECT_EQ("INJECTED", sender.sendValue("TestValue", value));
+
+    const uint64_t len = 768;
+    ExtMemTestValue extMemValue;
+    initExtMem(extMemValue, len);
+    EXPECT_EQ("INJECTED", sender.sendValue(
+        "ExtMemTestValue",
+        std::make_shared<const ExtMemTestValue>(std::move(extMemValue))));
+
+    receiveValues.join();
+    sender.disconnect();
+
+    std::shared_ptr<const TestValue> celTestValue =
+        std::dynamic_pointer_cast<const TestValue>(cel.testValue);
+    ASSERT_NE(nullptr, celTestValue.get());
+    EXPECT_EQ(value->val, celTestValue->val);
+    checkExtMem(std::dynamic_pointer_cast<const ExtMemTestValue>(cel.extMemTestValue), len);
+
+    ASSERT_EQ(2u, sizes.size());
+    EXPECT_EQ(sizes["TestValue"].first, sizes["TestValue"].second);
+    EXPECT_GT(sizes["ExtMemTestValue"].first, len * sizeof(int32_t));
+    EXPECT_LT(sizes["ExtMemTestValue"].second, sizes["ExtMemTestValue"].first);
+}
+#endif
+
+TEST_F(ZmqMsgPackTest, FanOut)
+{
+    ValueStore vs;
+    registerValueTypes(vs);
+
+    auto cache = std::make_shared<SerializationCache>();
+    ZmqMsgPackSender sender0("ipc:///tmp/0", vs);
+    ZmqMsgPackSender sender1("ipc:///tmp/1", vs);
+    sender0.setSerializationCache(cache);
+    sender1.setSerializationCache(cache);
+    ZmqMsgPackValueReceiver receiver0("ipc:///tmp/0", vs);
+    ZmqMsgPackValueReceiver receiver1("ipc:///tmp/1", vs);
+
+    ComEventListener cel0;
+    ComEventListener cel1;
+    receiver0.setEventListener(&cel0);
+    receiver1.setEventListener(&cel1);
+
+    std::mutex cv_m;
+    std::condition_variable cv0;
+    std::condition_variable cv1;
+
+    std::thread receiveValues0(&receive, std::ref(receiver0), 2, std::ref(cv0));
+    std::thread receiveValues1(&receive, std::ref(receiver1), 2, std::ref(cv1));
+
+    // wait for receivers to be set up;
+    {
+        std::unique_lock<std::mutex> lk(cv_m);
+        cv0.wait(lk);
+        cv1.wait(lk);
+    }
+
+    sender0.connect();
+    sender1.connect();
+
+    // both peers get the same values, serialized once
+    std::shared_ptr<const TestValue> value = std::make_shared<const TestValue>(940824);
+    const uint64_t len = 768;
+    ExtMemTestValue extMemValue;
+    initExtMem(extMemValue, len);
+    auto extMemTestValue = std::make_shared<const ExtMemTestValue>(std::move(extMemValue));
+
+    EXPECT_EQ("INJECTED", sender0.sendValue("TestValue", value));
+    EXPECT_EQ("INJECTED", sender0.sendValue("ExtMemTestValue", extMemTestValue));
+
+    zmq::message_t frame;
+    const void* ptr = nullptr;
+    size_t size = 0;
+    EXPECT_TRUE(cache->find(value, frame, ptr, size));
+    EXPECT_EQ(nullptr, ptr);
+    EXPECT_TRUE(cache->find(extMemTestValue, frame, ptr, size));
+    EXPECT_EQ(extMemTestValue->extMemPtr(), ptr);
+    EXPECT_FALSE(cache->find(std::make_shared<const TestValue>(940824), frame, ptr, size));
+
+    EXPECT_EQ("INJECTED", sender1.sendValue("TestValue", value));
+    EXPECT_EQ("INJECTED", sender1.sendValue("ExtMemTestValue", extMemTestValue));
+
+    receiveValues0.join();
+    receiveValues1.join();
+    sender0.disconnect();
+    sender1.disconnect();
+
+    for (auto* cel : {&cel0, &cel1})
+    {
+        std::shared_ptr<const TestValue> celTestValue =
+            std::dynamic_pointer_cast<const TestValue>(cel->testValue);
+        ASSERT_NE(nullptr, celTestValue.get());
+        EXPECT_EQ(value->val, celTestValue->val);
+        EXPECT_EQ(value->id(), celTestValue->id());
+        checkExtMem(std::dynamic_pointer_cast<const ExtMemTestValue>(cel->extMemTestValue), len);
+    }
+}
+
+TEST_F(ZmqMsgPackTest, Pipelined)
+{
+    ValueStore vs;
+    registerValueTypes(vs);
+
+    ZmqMsgPackSender sender("ipc:///tmp/0", vs, std::chrono::milliseconds(1000), nullptr, true);
+    ZmqMsgPackValueReceiver receiver("ipc:///tmp/0", vs);
+    EXPECT_TRUE(sender.supportsPipelining());
+
+    ComEventListener cel;
+    receiver.setEventListener(&cel);
+
+    std::mutex cv_m;
+    std::condition_variable cv;
+
+    const int numValues = 5;
+    std::thread receiveValues(&receive, std::ref(receiver), numValues + 1, std::ref(cv));
+
+    // wait for receiver to be set up;
+    {
+        std::unique_lock<std::mutex> lk(cv_m);
+        cv.wait(lk);
+    }
+
+    sender.connect();
+
+    // send values without waiting for their responses
+    for(int i = 0; i < numValues; ++i)
+    {
+        EXPECT_EQ("SENT", sender.sendValueAsync("TestValue", std::make_shared<const TestValue>(i)));
+    }
+
+    // a ping waits for its own response, the responses to the values are kept
+    sender.sendPing(77ul);
+
+    std::vector<AbstractSender::Ack> acks;
+    sender.pollAcks(acks, std::chrono::milliseconds(1000));
+    ASSERT_EQ(static_cast<size_t>(numValues), acks.size());
+    for(const auto& ack : acks)
+    {
+        EXPECT_EQ("TestValue", ack.topic);
+        EXPECT_EQ("INJECTED", ack.result);
+    }
+
+    receiveValues.join();
+    sender.disconnect();
+
+    EXPECT_EQ(77ul, cel.freshnessValue());
+    std::shared_ptr<const TestValue> celTestValue =
+        std::dynamic_pointer_cast<const TestValue>(cel.testValue);
+    ASSERT_NE(nullptr, celTestValue.get());
+    EXPECT_EQ(numValues - 1, celTestValue->val);
+}
+
+TEST_F(ZmqMsgPackTest, Batch)
+{
+    ValueStore vs;
+    registerValueTypes(vs);
+
+    ZmqMsgPackSender sender("ipc:///tmp/0", vs, std::chrono::milliseconds(1000));
+    ZmqMsgPackValueReceiver receiver("ipc:///tmp/0", vs);
+
+    ComEventListener cel;
+    receiver.setEventListener(&cel);
+
+    std::mutex cv_m;
+    std::condition_variable cv;
+
+    // the small values in one batch, the extMem value on its own
+    std::thread receiveValues(&receive, std::ref(receiver), 2, std::ref(cv));
+
+    // wait for receiver to be set up;
+    {
+        std::unique_lock<std::mutex> lk(cv_m);
+        cv.wait(lk);
+    }
+
+    sender.connect();
+
+    const uint64_t len = 16;
+    ExtMemTestValue extMemValue;
+    initExtMem(extMemValue, len);
+    std::vector<std::pair<std::string, ValuePtr>> values = {
+        {"TestValue", std::make_shared<const TestValue>(1)},
+        {"ExtMemTestValue", std::make_shared<const ExtMemTestValue>(std::move(extMemValue))},
+        {"TestValue", std::make_shared<const TestValue>(2)}};
+
+    const auto results = sender.sendValues(values, 65536);
+    ASSERT_EQ(values.size(), results.size());
+    for(const auto& result : results)
+    {
+        EXPECT_EQ("INJECTED", result);
+    }
+
+    receiveValues.join();
+    sender.disconnect();
+
+    std::shared_ptr<const TestValue> celTestValue =
+        std::dynamic_pointer_cast<const TestValue>(cel.testValue);
+    ASSERT_NE(nullptr, celTestValue.get());
+    EXPECT_EQ(2, celTestValue->val);
+    checkExtMem(std::dynamic_pointer_cast<const ExtMemTestValue>(cel.extMemTestValue), len);
+}
+
+TEST_F(ZmqMsgPackTest, Async)
+{
+    ValueStore vs;
+    registerValueTypes(vs);
+
+    ZmqMsgPackAsyncSender sender("ipc:///tmp/0", vs, std::chrono::milliseconds(1000));
+    ZmqMsgPackValueReceiver receiver("ipc:///tmp/0", vs, nullptr, true);
+
+    ComEventListener cel;
+    receiver.setEventListener(&cel);
+
+    std::mutex ackMutex;
+    std::condition_variable ackCv;
+    std::vector<AbstractSender::Ack> acks;
+    sender.setCompletionHandler([&](const AbstractSender::Ack& ack)
+    {
+        std::lock_guard<std::mutex> lk(ackMutex);
+        acks.push_back(ack);
+        ackCv.notify_all();
+    });
+
+    std::mutex cv_m;
+    std::condition_variable cv;
+
+    const int numValues = 5;
+    std::thread receiveValues(&receive, std::ref(receiver), numValues + 1, std::ref(cv));
+
+    // wait for receiver to be set up;
+    {
+        std::unique_lock<std::mutex> lk(cv_m);
+        cv.wait(lk);
+    }
+
+    sender.connect();
+    EXPECT_TRUE(sender.connected());
+
+    // neither values nor pings wait for their responses
+    for(int i = 0; i < numValues; ++i)
+    {
+        EXPECT_EQ("SENT", sender.sendValueAsync("TestValue", std::make_shared<const TestValue>(i)));
+    }
+    sender.sendPing(77ul);
+
+    {
+        std::unique_lock<std::mutex> lk(ackMutex);
+        ackCv.wait_for(lk, std::chrono::milliseconds(2000), [&] { return acks.size() >= static_cast<size_t>(numValues); });
+        ASSERT_EQ(static_cast<size_t>(numValues), acks.size());
+        for(const auto& ack : acks)
+        {
+            EXPECT_EQ("TestValue", ack.topic);
+            EXPECT_EQ("INJECTED", ack.result);
+        }
+    }
+
+    receiveValues.join();
+    sender.disconnect();
+    EXPECT_FALSE(sender.connected());
+
+    EXPECT_EQ(77ul, cel.freshnessValue());
+    std::shared_ptr<const TestValue> celTestValue =
+        std::dynamic_pointer_cast<const TestValue>(cel.testValue);
+    ASSERT_NE(nullptr, celTestValue.get());
+    EXPECT_EQ(numValues - 1, celTestValue->val);
+}
+
 TEST_F(ZmqMsgPackTest, Commands) {
     ValueStore vs;
 
@@ -356,6 +1035,86 @@ TEST_F(ZmqMsgPackTest, Commands) {
     ASSERT_EQ(topicToReject, cel.rejected);
 }
 
+TEST_F(ZmqMsgPackTest, RequestStale)
+{
+    ValueStore vs;
+
+    ZmqMsgPackSender sender("ipc:///tmp/0", vs, std::chrono::milliseconds(1000));
+    ZmqMsgPackValueReceiver receiver("ipc:///tmp/0", vs);
+
+    ComEventListener cel;
+    receiver.setEventListener(&cel);
+
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    sender.connect();
+
+    std::thread receiveMsgs(&receive, std::ref(receiver), 3, std::ref(cv));
+
+    // wait for receiver to be set up;
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk);
+    }
+
+    const std::map<std::string, uint64_t> heldIds = {{"/topic/a", 5ul}, {"/topic/b", 7ul}};
+
+    // before the receiver has answered a ping with its clock, all values are requested
+    sender.sendRequestStale(heldIds);
+    EXPECT_TRUE(cel.requestedAll);
+    EXPECT_FALSE(cel.requestedStale);
+
+    cel.requestedAll = false;
+    sender.sendPing(1ul);
+    sender.sendRequestStale(heldIds);
+
+    receiveMsgs.join();
+    sender.disconnect();
+
+    EXPECT_FALSE(cel.requestedAll);
+    EXPECT_TRUE(cel.requestedStale);
+    EXPECT_EQ(heldIds, cel.heldIds);
+}
+
+TEST_F(ZmqMsgPackTest, Subscriptions)
+{
+    ValueStore vs;
+
+    ZmqMsgPackSender sender("ipc:///tmp/0", vs, std::chrono::milliseconds(1000));
+    ZmqMsgPackValueReceiver receiver("ipc:///tmp/0", vs);
+
+    ComEventListener cel;
+    receiver.setEventListener(&cel);
+
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    sender.connect();
+
+    std::thread receiveMsgs(&receive, std::ref(receiver), 2, std::ref(cv));
+
+    // wait for receiver to be set up;
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk);
+    }
+
+    const std::map<std::string, bool> subscribed = {{"/topic/a", true}, {"/topic/b", false}};
+
+    // before the receiver has answered a ping with its clock, nothing is announced
+    sender.sendSubscriptions(subscribed);
+    EXPECT_TRUE(cel.subscribed.empty());
+
+    sender.sendPing(1ul);
+    sender.sendSubscriptions(subscribed);
+
+    receiveMsgs.join();
+    sender.disconnect();
+
+    EXPECT_EQ(subscribed, cel.subscribed);
+}
+
 TEST_F(ZmqMsgPackTest, ValueShm)
 {
     ValueStore vs;
@@ -426,6 +1185,129 @@ TEST_F(ZmqMsgPackTest, ValueShm)
     checkExtMem(celExtMemTestValue, len);
 }
 
+TEST_F(ZmqMsgPackTest, ShmemSlotRing)
+{
+    SingleFileShmem shmemKeeper(1024*1024, 2);
+    ShmemClient shmemClient;
+    bip::managed_shared_memory::handle_t handleA, handleB, handleC;
+
+    // slots still referenced by the receiver are not reused
+    void* slotA = shmemKeeper.acquireSlot("ring", 100, handleA);
+    void* slotB = shmemKeeper.acquireSlot("ring", 100, handleB);
+    ASSERT_NE(nullptr, slotA);
+    ASSERT_NE(nullptr, slotB);
+    EXPECT_NE(slotA, slotB);
+    EXPECT_EQ(slotA, shmemClient.partitionPtr(shmemKeeper.shmemFileName("ring"), handleA));
+
+    // a released slot is reused
+    ShmemClient::releaseSlot(slotA);
+    void* slotC = shmemKeeper.acquireSlot("ring", 100, handleC);
+    EXPECT_EQ(slotA, slotC);
+    EXPECT_EQ(handleA, handleC);
+
+    // rings of other partitions are independent
+    void* other = shmemKeeper.acquireSlot("other", 100, handleC);
+    EXPECT_NE(slotA, other);
+    EXPECT_NE(slotB, other);
+
+    // a full ring grows rather than overwriting a referenced slot
+    void* slotD = shmemKeeper.acquireSlot("ring", 100, handleC);
+    EXPECT_NE(slotA, slotD);
+    EXPECT_NE(slotB, slotD);
+
+    // the receiver's reference lasts as long as the owner
+    std::shared_ptr<const void> owner = shmemClient.slotOwner(slotB);
+    std::shared_ptr<const void> copy = owner;
+    owner.reset();
+    EXPECT_NE(slotB, shmemKeeper.acquireSlot("ring", 100, handleC));
+    copy.reset();
+    EXPECT_EQ(slotB, shmemKeeper.acquireSlot("ring", 100, handleC));
+}
+
+TEST_F(ZmqMsgPackTest, SegmentedShmem)
+{
+    SegmentedShmem::Config config;
+    config.segmentSize = 1024*1024;
+    config.maxSegments = 3;
+    config.maxTotalSize = 0;
+    SegmentedShmem shmemKeeper(config);
+    ShmemClient shmemClient;
+    bip::managed_shared_memory::handle_t handleA, handleB, handleC;
+    EXPECT_EQ(0u, shmemKeeper.usage().segments);
+
+    // the first segment of a connection is created on demand
+    void* slotA = shmemKeeper.acquireSlot("connectionA", 600*1024, handleA);
+    ASSERT_NE(nullptr, slotA);
+    const std::string segmentA = shmemKeeper.shmemFileName("connectionA");
+    EXPECT_EQ('/', segmentA[0]);
+    EXPECT_EQ(slotA, shmemClient.partitionPtr(segmentA, handleA));
+
+    // a full segment is followed by another one rather than failing the send
+    void* slotB = shmemKeeper.acquireSlot("connectionA", 600*1024, handleB);
+    ASSERT_NE(nullptr, slotB);
+    const std::string segmentB = shmemKeeper.shmemFileName("connectionA");
+    EXPECT_NE(segmentA, segmentB);
+    EXPECT_EQ(slotB, shmemClient.partitionPtr(segmentB, handleB));
+    EXPECT_EQ(slotA, shmemClient.partitionPtr(segmentA, handleA));
+
+    // other connections get segments of their own, up to the limit
+    ASSERT_NE(nullptr, shmemKeeper.acquireSlot("connectionB", 100, handleC));
+    EXPECT_NE(segmentA, shmemKeeper.shmemFileName("connectionB"));
+    EXPECT_EQ(nullptr, shmemKeeper.acquireSlot("connectionA", 600*1024, handleC));
+
+    ShmemUsage usage = shmemKeeper.usage();
+    EXPECT_EQ(3u, usage.segments);
+    EXPECT_GE(usage.size, 3u*1024*1024);
+    EXPECT_GT(usage.used, 1200u*1024);
+    EXPECT_EQ(3u, usage.allocations);
+    EXPECT_EQ(1u, usage.failedAllocations);
+
+    // released slots are reused, segments without allocations are given back
+    ShmemClient::releaseSlot(slotB);
+    ASSERT_NE(nullptr, shmemKeeper.acquireSlot("connectionA", 2*1024*1024, handleC));
+    EXPECT_EQ(3u, shmemKeeper.usage().segments);
+}
+
+TEST_F(ZmqMsgPackTest, MemfdShmem)
+{
+    MemfdShmem shmemKeeper;
+    ShmemClient shmemClient;
+    bip::managed_shared_memory::handle_t handle;
+    EXPECT_EQ(nullptr, shmemKeeper.createOrGetPartitionPtr("partition", 100));
+
+    // the receiver gets the buffer over the keeper's socket
+    char* slotA = static_cast<char*>(shmemKeeper.acquireSlot("connection", 100, handle));
+    ASSERT_NE(nullptr, slotA);
+    std::strcpy(slotA, "memfd");
+    const std::string bufferA = shmemKeeper.shmemFileName("connection");
+    const char* receivedA = static_cast<const char*>(shmemClient.partitionPtr(bufferA, handle));
+    EXPECT_STREQ("memfd", receivedA);
+    std::shared_ptr<const void> owner = shmemClient.slotOwner(receivedA);
+
+    // a buffer not yet released is not reused
+    ASSERT_NE(nullptr, shmemKeeper.acquireSlot("connection", 100, handle));
+    const std::string bufferB = shmemKeeper.shmemFileName("connection");
+    EXPECT_NE(bufferA, bufferB);
+    shmemClient.slotOwner(shmemClient.partitionPtr(bufferB, handle)).reset();
+    EXPECT_EQ(2u, shmemKeeper.usage().segments);
+
+    // the release is acknowledged asynchronously
+    owner.reset();
+    for(int i = 0; i < 500 && shmemKeeper.usage().used > 0; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(0u, shmemKeeper.usage().used);
+
+    // later values in a buffer only carry its name, the mapping shows the new content
+    char* slotC = static_cast<char*>(shmemKeeper.acquireSlot("connection", 100, handle));
+    std::strcpy(slotC, "reused");
+    const std::string bufferC = shmemKeeper.shmemFileName("connection");
+    EXPECT_TRUE(bufferC == bufferA || bufferC == bufferB);
+    EXPECT_STREQ("reused", static_cast<const char*>(shmemClient.partitionPtr(bufferC, handle)));
+    EXPECT_EQ(2u, shmemKeeper.usage().segments);
+}
+
 } // end namespace remote
 
 } // end namespace mcf
@@ -261,4 +261,22 @@ event {
     };
 };
 
+event {
+    id = 85;
+    name = "perf_counters";
+    stream_id = 0;
+    fields := struct {
+        string trace_id;
+        string component;
+        string handler;
+        uint64_t cycles;
+        uint64_t instructions;
+        uint64_t cache_misses;
+        uint64_t branch_misses;
+        uint64_t context_switches;
+        int32_t thread_id;
+        int32_t cpu_id;
+    };
+};
+
 ''')
\ No newline at end of file
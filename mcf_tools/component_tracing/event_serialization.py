@@ -147,6 +147,27 @@ def parse_program_flow(value, event_type):
     }
 
 
+def parse_perf_counters(value, event_type):
+    """
+    Parse perf counters event from mcf recording
+    """
+    trace_id = value[0]
+    return {
+        'recording_id': trace_id,
+        'timestamp': value[1],
+        'type': event_type,
+        'component': {'name': f'{trace_id}:{value[2]}'},
+        'handler': value[3],
+        'cycles': value[4],
+        'instructions': value[5],
+        'cache_misses': value[6],
+        'branch_misses': value[7],
+        'context_switches': value[8],
+        'thread_id': value[9],
+        'cpu_id': value[10]
+    }
+
+
 def null_term_string(string):
     """
     Convert input string to null-terminated binary utf-8 representation
@@ -390,6 +411,30 @@ def program_flow_to_ctf(event):
     return [[timestamp, bdata]]
 
 
+def perf_counters_to_ctf(event):
+    """
+    Serialize perf counters event to common trace format
+    """
+    event_id = 85
+    timestamp = event['timestamp']
+    trace_id = event['recording_id']
+    component_name = event['component']['name']
+    handler = event['handler']
+    thread_id = event['thread_id']
+    cpu_id = event['cpu_id']
+
+    bdata = (struct.pack('<HQ', event_id, timestamp) +
+             null_term_string(trace_id) +
+             null_term_string(component_name) +
+             null_term_string(handler) +
+             struct.pack('<QQQQQ', event['cycles'], event['instructions'], event['cache_misses'],
+                         event['branch_misses'], event['context_switches']) +
+             struct.pack('<l', thread_id) +
+             struct.pack('<l', cpu_id))
+
+    return [[timestamp, bdata]]
+
+
 # serialize time box event to common trace format
 def time_box_to_ctf(event):
     """
@@ -432,7 +477,8 @@ EVENT_DESERIALIZERS_MCF = {'mcf::ComponentTracePortWrite': ['port_write', parse_
                            'mcf::ComponentTraceRemoteTransferTime': ['remote_transfer_time', parse_remote_transfer_time],
                            'mcf::ComponentTracePortTriggerActivation': ['trigger_act', parse_trigger_act],
                            'mcf::ComponentTracePortTriggerExec': ['trigger_exec', parse_trigger_exec],
-                           'mcf::ComponentTraceProgramFlowEvent': ['program_flow', parse_program_flow]}
+                           'mcf::ComponentTraceProgramFlowEvent': ['program_flow', parse_program_flow],
+                           'mcf::ComponentTracePerfCounters': ['perf_counters', parse_perf_counters]}
 
 # MCF event serialization map for Common Trace Format
 EVENT_SERIALIZERS_CTF = {'port_write': port_write_to_ctf,
@@ -443,6 +489,7 @@ EVENT_SERIALIZERS_CTF = {'port_write': port_write_to_ctf,
                          'trigger_act': port_trigger_act_to_ctf,
                          'trigger_exec': port_trigger_exec_to_ctf,
                          'program_flow': program_flow_to_ctf,
+                         'perf_counters': perf_counters_to_ctf,
                          'time_box': time_box_to_ctf}
 
 
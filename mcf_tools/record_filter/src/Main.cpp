@@ -0,0 +1,51 @@
+/**
+ * Command line tool copying the records of a record file selected by topic, type and time into a
+ * new record file, see mcf::RecordFilter
+ *
+ * Copyright (c) 2024 Accenture
+ */
+#include "mcf_core/RecordFilter.h"
+
+#include "CLI/CLI.hpp"
+
+#include <exception>
+#include <iostream>
+
+
+int main(int argc, char **argv)
+{
+    CLI::App app("Filter and convert Mcf record files");
+
+    std::string input;
+    app.add_option("input", input, "Record file to read")->required()->check(CLI::ExistingFile);
+
+    std::string output;
+    app.add_option("output", output, "Record file to write")->required();
+
+    mcf::RecordFilter::Options options;
+    app.add_option("-t,--topic", options.topics, "Topic to copy, may be repeated (default: all topics)");
+    app.add_option("--type", options.types, "Type id to copy, may be repeated (default: all types)");
+    app.add_option("--start", options.startTime, "Time of the first record to copy in milliseconds");
+    app.add_option("--end", options.endTime, "Time of the last record to copy in milliseconds");
+    app.add_flag("--reindex", options.reindex, "Write a footer for seeking");
+    app.add_option("--compress", options.compressionLevel,
+                   "Collect the records into chunks compressed with this zlib level (1-9)")
+        ->check(CLI::Range(1, 9));
+    app.add_option("--chunk-size", options.chunkSize, "Uncompressed size of the chunks in bytes");
+
+    CLI11_PARSE(app, argc, argv);
+
+    try
+    {
+        const auto statistics = mcf::RecordFilter::run(input, output, options);
+        std::cout << "Copied " << statistics.records << " records: "
+                  << statistics.copiedBytes << " bytes as they are, "
+                  << statistics.writtenBytes << " bytes serialized" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
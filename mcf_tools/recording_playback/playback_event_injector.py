@@ -37,6 +37,11 @@ def main(trace_files: typing.List[str],
     tgt_rc.connect(target_ip, target_port)
 
     tgt_rc.set_playback_modifier(PlaybackModifier.PAUSE)
+    # values are streamed instead of being written one request at a time
+    if not tgt_rc.open_injection():
+        raise RuntimeError('cannot open the injection stream of the target')
+    queue_state = tgt_rc.get_event_queue_state()
+    injected = queue_state['injected'] + queue_state['inject_errors']
 
     # Write all events with timestamps while playback is paused. This allows all events to
     # be written, regardless of the size of the messages and network bandwidth, without
@@ -66,14 +71,15 @@ def main(trace_files: typing.List[str],
                 current_simulation_time_offset = trace_timestamp - end_wait_time
 
             offset_timestamp = trace_timestamp - current_simulation_time_offset
-            tgt_rc.write_value(topic=value_record.topic,
-                               clazz=value_record.typeid,
-                               value=value_record.value,
-                               extmem=value_record.extmem_value,
-                               timestamp=offset_timestamp,
-                               valueId=value_record.valueid,
-                               component=component_name,
-                               port=port_name)
+            tgt_rc.inject_value(topic=value_record.topic,
+                                clazz=value_record.typeid,
+                                value=value_record.value,
+                                extmem=value_record.extmem_value,
+                                timestamp=offset_timestamp,
+                                valueId=value_record.valueid,
+                                component=component_name,
+                                port=port_name)
+            injected += 1
 
         wait_time_micro_seconds = event_time_slice_params.wait_time_ms * 1000
 
@@ -81,6 +87,15 @@ def main(trace_files: typing.List[str],
                          - current_simulation_time_offset
                          + wait_time_micro_seconds)
 
+    # resume once the target has received all injected values
+    queue_state = tgt_rc.get_event_queue_state()
+    while queue_state['injected'] + queue_state['inject_errors'] < injected:
+        time.sleep(0.05)
+        queue_state = tgt_rc.get_event_queue_state()
+    if queue_state['inject_errors'] > 0:
+        print('Values which could not be injected so far: ', queue_state['inject_errors'])
+    tgt_rc.close_injection()
+
     tgt_rc.set_playback_modifier(PlaybackModifier.RESUME)
 
     queue_state = tgt_rc.get_event_queue_state()
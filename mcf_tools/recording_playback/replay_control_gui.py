@@ -113,7 +113,12 @@ class ReplayControlGui(object):
 
     def _create_sections(self):
         sim_time_section = [[sg.Text('Simulation Time (s): '),
-                             sg.Text('0', key='-SIMTIMETEXT-', size=(20, 1))]]
+                             sg.Text('0', key='-SIMTIMETEXT-', size=(20, 1))],
+                            [sg.Text('Seek to (s):'),
+                             sg.Input(default_text='', key='-SEEKTIME-', size=(20, 1)),
+                             sg.Text('Pre-roll (s):'),
+                             sg.Input(default_text='0', key='-PREROLL-', size=(6, 1)),
+                             sg.Button('Seek', key='-SEEK-')]]
 
         run_mode_section = \
             [[sg.Text('Run Mode:'), sg.Text(size=(5, 1)),
@@ -226,6 +231,13 @@ class ReplayControlGui(object):
                 plaback_modifier = PlaybackModifier(PlaybackModifier.STEPONCE)
                 self.remote_control.set_playback_modifier(plaback_modifier)
 
+            elif event == '-SEEK-':
+                seek_time = int(float(values['-SEEKTIME-']) * 10 ** 6)
+                pre_roll = int(float(values['-PREROLL-']) * 10 ** 6)
+                if self.remote_control.seek(seek_time, pre_roll):
+                    self.is_playback_paused = False
+                    self.run_state_led.set_led(self.window, 'green')
+
             elif event == '-RUNWITHOUTDROPS-':
                 self.replay_params.run_without_drops = values['-RUNWITHOUTDROPS-']
                 self.remote_control.set_replay_params(self.replay_params)
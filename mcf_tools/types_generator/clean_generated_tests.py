@@ -36,6 +36,10 @@ def clean_value_tests(output_directory: str):
     test_main_path = output_directory_path / 'main_test'
     remove_subfolders(test_main_path)
 
+    # clean generated cpp benchmark
+    benchmark_path = output_directory_path / 'benchmark'
+    remove_subfolders(benchmark_path)
+
     # clean generated cpp test src
     test_src_path = output_directory_path / 'src'
     if test_src_path.exists():
@@ -29,11 +29,16 @@ def remove_subfolders(path: 'Path'):
     return removed_folder
 
 
-def clean_value_types(output_cpp_dir: 'Path', output_py_dir: 'Path', input_dir: 'Path'):
+def clean_value_types(output_cpp_dir: 'Path', output_py_dir: 'Path', input_dir: 'Path',
+                      output_src_dir: typing.Optional['Path'] = None):
     # clean generated cpp headers
     if remove_subfolders(output_cpp_dir):
         print(f'Removed C++ generated value types:    {output_cpp_dir}')
 
+    # clean generated cpp sources of the split layout
+    if output_src_dir is not None and remove_subfolders(output_src_dir):
+        print(f'Removed C++ generated value sources:  {output_src_dir}')
+
     # clean generated python
     if remove_subfolders(output_py_dir):
         print(f'Removed python generated value types: {output_py_dir}')
@@ -54,6 +59,10 @@ def main():
     parser.add_argument('-o_py', '--output_py_dir', required=True,
                         help='Base output directory where python files were generated. '
                              'Should be the same value used in value_type_generator.py')
+    parser.add_argument('-o_src', '--output_src_dir', required=False, default=None,
+                        help='Base output directory where cpp source files were generated, if different '
+                             'from the cpp header directory. Should be the same value used in '
+                             'value_type_generator.py')
     parser.add_argument('-i', '--input_dir', required=True,
                         help='Input directory containing json description files for '
                              'classes that were generated. Should be the same value '
@@ -63,7 +72,8 @@ def main():
     output_cpp_dir = Path(args.output_cpp_dir)
     output_py_dir = Path(args.output_py_dir)
     input_dir = Path(args.input_dir)
-    clean_value_types(output_cpp_dir, output_py_dir, input_dir)
+    output_src_dir = Path(args.output_src_dir) if args.output_src_dir else None
+    clean_value_types(output_cpp_dir, output_py_dir, input_dir, output_src_dir)
 
 
 if __name__ == '__main__':
@@ -10,7 +10,8 @@ import os
 import mcf_python_path.type_generator_paths
 from type_generator.cpp_indiv_generator import write_individual_header_file
 from type_generator.python_type_generator import write_python_type_file
-from type_generator.common import TypesData, Scalar, Type, Template, ConfigurationError
+from type_generator.common import TypesData, Scalar, Type, Template, ConfigurationError, LAYOUT_SPLIT
+from type_generator.cpp_split_generator import write_codec_header_file, write_codec_source_file
 
 
 system_types = {'SystemTypes': {'bool': {'CppName': 'bool', 'PyName': 'bool', 'FlatBufferName': 'bool', 'Type': 'Primitive'}, 'double': {'CppName': 'double', 'PyName': 'float', 'FlatBufferName': 'double', 'Type': 'Primitive'}, 'float': {'CppName': 'float', 'PyName': 'float', 'FlatBufferName': 'float', 'Type': 'Primitive'}, 'int': {'CppName': 'int', 'PyName': 'int', 'FlatBufferName': 'int32', 'Type': 'Primitive'}, 'map': {'CppName': 'std::map', 'CppInclude': 'map', 'PyName': 'Dict', 'PyInclude': 'Dict', 'FlatBufferName': 'Map', 'Type': 'Container'}, 'pair': {'CppName': 'std::pair', 'CppInclude': 'utility', 'PyName': 'Tuple', 'PyInclude': 'Tuple', 'FlatBufferName': 'Tuple', 'Type': 'Container'}, 'set': {'CppName': 'std::set', 'CppInclude': 'set', 'PyName': 'List', 'PyInclude': 'List', 'FlatBufferName': 'List', 'Type': 'Container'}, 'string': {'CppName': 'std::string', 'CppInclude': 'string', 'FlatBufferName': 'string', 'PyName': 'str', 'Type': 'Primitive'}, 'size_t': {'CppName': 'std::size_t', 'CppInclude': 'cstddef', 'FlatBufferName': 'uint64', 'PyName': 'int', 'Type': 'Primitive'}, 'int8_t': {'CppName': 'int8_t', 'PyName': 'int', 'FlatBufferName': 'int8', 'Type': 'Primitive'}, 'uint8_t': {'CppName': 'uint8_t', 'PyName': 'int', 'FlatBufferName': 'uint8', 'Type': 'Primitive'}, 'int16_t': {'CppName': 'int16_t', 'PyName': 'int', 'FlatBufferName': 'int16', 'Type': 'Primitive'}, 'uint16_t': {'CppName': 'uint16_t', 'PyName': 'int', 'FlatBufferName': 'uint16', 'Type': 'Primitive'}, 'int32_t': {'CppName': 'int32_t', 'PyName': 'int', 'FlatBufferName': 'int32', 'Type': 'Primitive'}, 'uint32_t': {'CppName': 'uint32_t', 'PyName': 'int', 'FlatBufferName': 'uint32', 'Type': 'Primitive'}, 'int64_t': {'CppName': 'int64_t', 'PyName': 'int', 'FlatBufferName': 'int64', 'Type': 'Primitive'}, 'uint64_t': {'CppName': 'uint64_t', 'PyName': 'int', 'FlatBufferName': 'uint64', 'Type': 'Primitive'}, 'vector': {'CppName': 'std::vector', 'CppInclude': 'vector', 'PyName': 'List', 'PyInclude': 'List', 'FlatBufferName': 'List', 'Type': 'Container'}}}
@@ -580,3 +581,34 @@ def test_types_config_error(output_dir_path, project_types_list):
 
                 with pytest.raises(ConfigurationError):
                     write_python_type_file(output_dir_path, types_data)
+
+
+@pytest.mark.parametrize('project_types_list', project_types_list_pass,
+                         ids=[i.__name__ for i in project_types_list_pass])
+def test_types_split_layout(output_dir_path, project_types_list):
+    for project_types in project_types_list():
+        for indiv_class in project_types.values():
+            indiv_class["Layout"] = LAYOUT_SPLIT
+        project_names = list(project_types.keys())
+        for type_name, indiv_class in project_types.items():
+            types_data = TypesData(
+                indiv_class,
+                project_types,
+                system_types,
+                project_names,
+                {},
+                [])
+            write_individual_header_file(output_dir_path, types_data)
+            write_codec_header_file(output_dir_path, types_data)
+            write_codec_source_file(output_dir_path, types_data)
+
+            # the types compile without msgpack, their codec is compiled once
+            with open(output_dir_path / f"{type_name}.h") as header:
+                assert "msgpack" not in header.read()
+            with open(output_dir_path / f"{type_name}Codec.h") as codec:
+                assert "#include \"msgpack.hpp\"" in codec.read()
+            if type_name != enum_type.type_name_no_ns:
+                with open(output_dir_path / f"{type_name}Codec.cpp") as source:
+                    source_text = source.read()
+                    assert f"template void register{type_name}<mcf::ValueStore>" in source_text
+                    assert "msgpack_unpack(object)" in source_text
@@ -0,0 +1,336 @@
+""""
+Copyright (c) 2024 Accenture
+"""
+import os
+from typing import TextIO, TYPE_CHECKING
+
+if TYPE_CHECKING:
+    from pathlib import Path
+
+
+def add_includes(file: TextIO, project_definitions: dict) -> None:
+    file.write("#include \"mcf_core/Mcf.h\"\n")
+    file.write("#include \"mcf_core/IExtMemValue.h\"\n")
+    file.write("#include \"mcf_core/TypeRegistry.h\"\n")
+    file.write(f"#include \"{project_definitions['PackageNamespace']}/{project_definitions['ProjectName']}.h\"\n\n")
+
+    file.write("#include <atomic>\n")
+    file.write("#include <chrono>\n")
+    file.write("#include <cstdio>\n")
+    file.write("#include <cstdlib>\n")
+    file.write("#include <cstring>\n")
+    file.write("#include <limits>\n")
+    file.write("#include <map>\n")
+    file.write("#include <new>\n")
+    file.write("#include <set>\n")
+    file.write("#include <string>\n")
+    file.write("#include <tuple>\n")
+    file.write("#include <type_traits>\n")
+    file.write("#include <utility>\n")
+    file.write("#include <vector>\n\n")
+
+
+def add_description(file: TextIO) -> None:
+    file.write("/*\n")
+    file.write(" * Measures the codec of each value type: encoded size, pack and unpack throughput and heap\n")
+    file.write(" * allocations per operation, for values whose strings and containers hold 1, 32 and 1024\n")
+    file.write(" * elements (ext mem: KiB). Elements of nested containers hold 4 elements each.\n")
+    file.write(" *\n")
+    file.write(" * Values are packed like transports pack them, without serialization cache and ext mem data,\n")
+    file.write(" * and unpacked from a reused zone like receivers unpack them. Allocations count calls of\n")
+    file.write(" * operator new, chunks of the msgpack zone are allocated by malloc and not counted.\n")
+    file.write(" *\n")
+    file.write(" * Usage: benchmark [duration per measurement in ms] [--csv]\n")
+    file.write(" */\n\n")
+
+
+def add_allocation_counter(file: TextIO) -> None:
+    file.write("namespace {\n\n")
+    file.write("std::atomic<uint64_t> allocations(0);\n\n")
+    file.write("} // anonymous namespace\n\n")
+
+    file.write("void* operator new(std::size_t size)\n")
+    file.write("{\n")
+    file.write("    ++allocations;\n")
+    file.write("    if (void* ptr = std::malloc(size == 0 ? 1 : size))\n")
+    file.write("    {\n")
+    file.write("        return ptr;\n")
+    file.write("    }\n")
+    file.write("    throw std::bad_alloc();\n")
+    file.write("}\n\n")
+    file.write("void operator delete(void* ptr) noexcept\n")
+    file.write("{\n")
+    file.write("    std::free(ptr);\n")
+    file.write("}\n\n")
+    file.write("void operator delete(void* ptr, std::size_t) noexcept\n")
+    file.write("{\n")
+    file.write("    std::free(ptr);\n")
+    file.write("}\n\n")
+
+
+def add_fill_declarations(file: TextIO, project_types: dict) -> None:
+    file.write("// elements of containers nested in an attribute\n")
+    file.write("constexpr std::size_t NESTED_SIZE = 4;\n")
+    file.write("// ext mem data per size step\n")
+    file.write("constexpr std::size_t EXTMEM_BYTES = 1024;\n\n")
+
+    file.write("// all overloads are declared first, so that the templates find each other\n")
+    file.write("void fill(bool& value, std::size_t size);\n")
+    file.write("void fill(std::string& value, std::size_t size);\n")
+    file.write("void fill(std::vector<bool>& value, std::size_t size);\n")
+    file.write("template<typename T>\n")
+    file.write("typename std::enable_if<std::is_arithmetic<T>::value>::type fill(T& value, std::size_t size);\n")
+    file.write("template<typename T>\n")
+    file.write("typename std::enable_if<std::is_enum<T>::value>::type fill(T& value, std::size_t size);\n")
+    file.write("template<typename T>\n")
+    file.write("typename std::enable_if<std::is_class<T>::value>::type fill(T& value, std::size_t size);\n")
+    file.write("template<typename T>\n")
+    file.write("void fill(std::vector<T>& value, std::size_t size);\n")
+    file.write("template<typename T>\n")
+    file.write("void fill(std::set<T>& value, std::size_t size);\n")
+    file.write("template<typename K, typename V>\n")
+    file.write("void fill(std::map<K, V>& value, std::size_t size);\n")
+    file.write("template<typename A, typename B>\n")
+    file.write("void fill(std::pair<A, B>& value, std::size_t size);\n")
+
+    for type_name in sorted(project_types):
+        if project_types[type_name]["Kind"].type_name_no_ns != "Enum":
+            file.write(f"void fill(values::{type_name}& value, std::size_t size);\n")
+    file.write("\n")
+
+
+def add_fill_templates(file: TextIO) -> None:
+    file.write("// distinct keys of maps and sets, other keys result in a single element\n")
+    file.write("template<typename K>\n")
+    file.write("typename std::enable_if<std::is_arithmetic<K>::value, K>::type key(std::size_t i)\n")
+    file.write("{\n")
+    file.write("    return static_cast<K>(i);\n")
+    file.write("}\n\n")
+    file.write("template<typename K>\n")
+    file.write("typename std::enable_if<std::is_same<K, std::string>::value, K>::type key(std::size_t i)\n")
+    file.write("{\n")
+    file.write("    return std::to_string(i);\n")
+    file.write("}\n\n")
+    file.write("template<typename K>\n")
+    file.write("typename std::enable_if<!std::is_arithmetic<K>::value && !std::is_same<K, std::string>::value, K>::type\n")
+    file.write("key(std::size_t)\n")
+    file.write("{\n")
+    file.write("    return K();\n")
+    file.write("}\n\n")
+
+    file.write("void fill(bool& value, std::size_t)\n")
+    file.write("{\n")
+    file.write("    value = true;\n")
+    file.write("}\n\n")
+    file.write("void fill(std::string& value, std::size_t size)\n")
+    file.write("{\n")
+    file.write("    value.assign(size, 'x');\n")
+    file.write("}\n\n")
+    file.write("void fill(std::vector<bool>& value, std::size_t size)\n")
+    file.write("{\n")
+    file.write("    value.assign(size, true);\n")
+    file.write("}\n\n")
+
+    file.write("// numbers of full width, so that msgpack does not pack them into a single byte\n")
+    file.write("template<typename T>\n")
+    file.write("typename std::enable_if<std::is_arithmetic<T>::value>::type fill(T& value, std::size_t)\n")
+    file.write("{\n")
+    file.write("    value = std::numeric_limits<T>::is_integer ? std::numeric_limits<T>::max() / 3 : static_cast<T>(1. / 3.);\n")
+    file.write("}\n\n")
+    file.write("template<typename T>\n")
+    file.write("typename std::enable_if<std::is_enum<T>::value>::type fill(T&, std::size_t)\n")
+    file.write("{\n")
+    file.write("}\n\n")
+    file.write("// types of other packages keep their default value\n")
+    file.write("template<typename T>\n")
+    file.write("typename std::enable_if<std::is_class<T>::value>::type fill(T&, std::size_t)\n")
+    file.write("{\n")
+    file.write("}\n\n")
+
+    file.write("template<typename T>\n")
+    file.write("void fill(std::vector<T>& value, std::size_t size)\n")
+    file.write("{\n")
+    file.write("    value.resize(size);\n")
+    file.write("    for (auto& element : value)\n")
+    file.write("    {\n")
+    file.write("        fill(element, NESTED_SIZE);\n")
+    file.write("    }\n")
+    file.write("}\n\n")
+    file.write("template<typename T>\n")
+    file.write("void fill(std::set<T>& value, std::size_t size)\n")
+    file.write("{\n")
+    file.write("    for (std::size_t i = 0; i < size; ++i)\n")
+    file.write("    {\n")
+    file.write("        value.insert(key<T>(i));\n")
+    file.write("    }\n")
+    file.write("}\n\n")
+    file.write("template<typename K, typename V>\n")
+    file.write("void fill(std::map<K, V>& value, std::size_t size)\n")
+    file.write("{\n")
+    file.write("    for (std::size_t i = 0; i < size; ++i)\n")
+    file.write("    {\n")
+    file.write("        fill(value[key<K>(i)], NESTED_SIZE);\n")
+    file.write("    }\n")
+    file.write("}\n\n")
+    file.write("template<typename A, typename B>\n")
+    file.write("void fill(std::pair<A, B>& value, std::size_t size)\n")
+    file.write("{\n")
+    file.write("    fill(value.first, size);\n")
+    file.write("    fill(value.second, size);\n")
+    file.write("}\n\n")
+
+
+def add_fill_definitions(file: TextIO, project_types: dict) -> None:
+    for type_name, type_ in sorted(project_types.items()):
+        kind = type_["Kind"].type_name_no_ns
+        if kind == "Enum":
+            continue
+
+        file.write(f"void fill(values::{type_name}& value, std::size_t size)\n")
+        file.write("{\n")
+        if kind == "ExtMemValue":
+            file.write("    value.extMemInit(size * EXTMEM_BYTES);\n")
+        for attribute in type_["Attributes"]:
+            file.write(f"    fill(value.{attribute}, size);\n")
+        if not type_["Attributes"] and kind != "ExtMemValue":
+            file.write("    (void)value;\n")
+            file.write("    (void)size;\n")
+        file.write("}\n\n")
+
+
+def add_measure(file: TextIO) -> None:
+    file.write("struct Result\n")
+    file.write("{\n")
+    file.write("    std::size_t encodedSize = 0;\n")
+    file.write("    double packNs = 0.;\n")
+    file.write("    double unpackNs = 0.;\n")
+    file.write("    double packAllocations = 0.;\n")
+    file.write("    double unpackAllocations = 0.;\n")
+    file.write("};\n\n")
+
+    file.write("// runs op until the duration has passed, returns ns and allocations per run\n")
+    file.write("template<typename Op>\n")
+    file.write("std::pair<double, double> run(const Op& op, std::chrono::milliseconds duration)\n")
+    file.write("{\n")
+    file.write("    using Clock = std::chrono::steady_clock;\n")
+    file.write("    op();  // warm up, e.g. buffers and zone chunks\n")
+    file.write("    const uint64_t allocationsBefore = allocations;\n")
+    file.write("    const auto start = Clock::now();\n")
+    file.write("    const auto end = start + duration;\n")
+    file.write("    uint64_t runs = 0;\n")
+    file.write("    auto now = start;\n")
+    file.write("    while (now < end)\n")
+    file.write("    {\n")
+    file.write("        for (int i = 0; i < 16; ++i)\n")
+    file.write("        {\n")
+    file.write("            op();\n")
+    file.write("        }\n")
+    file.write("        runs += 16;\n")
+    file.write("        now = Clock::now();\n")
+    file.write("    }\n")
+    file.write("    const double ns = std::chrono::duration<double, std::nano>(now - start).count();\n")
+    file.write("    return {ns / runs, static_cast<double>(allocations - allocationsBefore) / runs};\n")
+    file.write("}\n\n")
+
+    file.write("template<typename T>\n")
+    file.write("Result measure(const mcf::ValueStore& valueStore, std::size_t size, std::chrono::milliseconds duration)\n")
+    file.write("{\n")
+    file.write("    auto value = std::make_shared<T>();\n")
+    file.write("    fill(*value, size);\n")
+    file.write("    const mcf::ValuePtr valuePtr = value;\n")
+    file.write("    const auto* typeInfo = valueStore.findTypeInfo(*valuePtr);\n")
+    file.write("    MCF_ASSERT(typeInfo != nullptr, \"value type not registered\");\n\n")
+
+    file.write("    const void* extMemPtr = nullptr;\n")
+    file.write("    std::size_t extMemSize = 0;\n")
+    file.write("    if (const auto* extMemValue = dynamic_cast<const mcf::IExtMemValue*>(valuePtr.get()))\n")
+    file.write("    {\n")
+    file.write("        extMemPtr = extMemValue->extMemPtr();\n")
+    file.write("        extMemSize = extMemValue->extMemSize();\n")
+    file.write("    }\n\n")
+
+    file.write("    Result result;\n")
+    file.write("    msgpack::sbuffer buffer;\n")
+    file.write("    std::tie(result.packNs, result.packAllocations) = run([&buffer, &valuePtr, typeInfo] {\n")
+    file.write("        buffer.clear();\n")
+    file.write("        msgpack::packer<msgpack::sbuffer> packer(buffer);\n")
+    file.write("        mcf::TypeRegistry::pack(packer, *valuePtr, *typeInfo);\n")
+    file.write("    }, duration);\n")
+    file.write("    result.encodedSize = buffer.size() + extMemSize;\n\n")
+
+    file.write("    msgpack::zone zone;\n")
+    file.write("    std::tie(result.unpackNs, result.unpackAllocations) = run([&] {\n")
+    file.write("        zone.clear();\n")
+    file.write("        msgpack::object object = msgpack::unpack(zone, buffer.data(), buffer.size());\n")
+    file.write("        bool isExtMem = false;\n")
+    file.write("        mcf::TypeRegistry::unpackSharedValue(*typeInfo, object, extMemPtr, extMemSize, isExtMem);\n")
+    file.write("    }, duration);\n")
+    file.write("    return result;\n")
+    file.write("}\n\n")
+
+    file.write("void report(const char* name, std::size_t size, const Result& result, bool csv)\n")
+    file.write("{\n")
+    file.write("    const double mb = static_cast<double>(result.encodedSize) / 1e6;\n")
+    file.write("    const char* format = csv\n")
+    file.write("        ? \"%s,%zu,%zu,%.1f,%.1f,%.1f,%.1f,%.2f,%.2f\\n\"\n")
+    file.write("        : \"%-48s %6zu %12zu %12.1f %12.1f %10.1f %10.1f %8.2f %8.2f\\n\";\n")
+    file.write("    std::printf(format, name, size, result.encodedSize,\n")
+    file.write("                result.packNs, result.unpackNs,\n")
+    file.write("                mb / (result.packNs * 1e-9), mb / (result.unpackNs * 1e-9),\n")
+    file.write("                result.packAllocations, result.unpackAllocations);\n")
+    file.write("}\n\n")
+
+
+def add_main(file: TextIO, project_types: dict, project_definitions: dict) -> None:
+    file.write("int main(int argc, char** argv)\n")
+    file.write("{\n")
+    file.write("    std::chrono::milliseconds duration(100);\n")
+    file.write("    bool csv = false;\n")
+    file.write("    for (int i = 1; i < argc; ++i)\n")
+    file.write("    {\n")
+    file.write("        if (std::strcmp(argv[i], \"--csv\") == 0)\n")
+    file.write("        {\n")
+    file.write("            csv = true;\n")
+    file.write("        }\n")
+    file.write("        else\n")
+    file.write("        {\n")
+    file.write("            duration = std::chrono::milliseconds(std::atoi(argv[i]));\n")
+    file.write("        }\n")
+    file.write("    }\n\n")
+
+    file.write("    mcf::ValueStore valueStore;\n")
+    file.write(f"    values::{project_definitions['PackageNamespace']}::register{project_definitions['ProjectName']}(valueStore);\n\n")
+
+    file.write("    const char* header = csv\n")
+    file.write("        ? \"%s,%s,%s,%s,%s,%s,%s,%s,%s\\n\"\n")
+    file.write("        : \"%-48s %6s %12s %12s %12s %10s %10s %8s %8s\\n\";\n")
+    file.write("    std::printf(header, \"type\", \"size\", \"bytes\", \"pack ns\", \"unpack ns\",\n")
+    file.write("                \"pack MB/s\", \"unpack MB/s\", \"allocs/p\", \"allocs/u\");\n")
+    file.write("    for (std::size_t size : {1, 32, 1024})\n")
+    file.write("    {\n")
+    for type_name, type_ in sorted(project_types.items()):
+        if type_["Kind"].type_name_no_ns in ["Value", "ExtMemValue"]:
+            file.write(f"        report(\"{type_name}\", size, measure<values::{type_name}>(valueStore, size, duration), csv);\n")
+    file.write("    }\n")
+    file.write("    return 0;\n")
+    file.write("}\n")
+
+
+def write_benchmark_src_file(filename: 'Path', project_types: dict, project_definitions: dict) -> None:
+    execution_dir = os.getcwd()
+    with open(filename, "w") as output_file:
+        output_file.write("// WARNING: This file is generated automatically in the build process by mcf_tools/types_generator/tester_generator.py.\n")
+        output_file.write("// Any changes that you make will be overwritten whenever the project is built.\n")
+        output_file.write("// To make changes either edit mcf_tools/types_generator/test_generator/cpp_benchmark_generator.py or disable the generation in: \n"
+                          f"// {execution_dir}\n\n\n")
+
+        add_includes(output_file, project_definitions)
+        add_description(output_file)
+        add_allocation_counter(output_file)
+        output_file.write("namespace {\n\n")
+        add_fill_declarations(output_file, project_types)
+        add_fill_templates(output_file)
+        add_fill_definitions(output_file, project_types)
+        add_measure(output_file)
+        output_file.write("} // anonymous namespace\n\n")
+        add_main(output_file, project_types, project_definitions)
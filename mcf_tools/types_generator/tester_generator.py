@@ -16,6 +16,7 @@ from pathlib import Path
 from test_generator.cpp_header_generator import write_cpp_header_file
 from test_generator.cpp_src_generator import write_cpp_src_file
 from test_generator.cpp_main_generator import write_main_src_file
+from test_generator.cpp_benchmark_generator import write_benchmark_src_file
 from test_generator.python_test_generator import write_python_test_file
 from test_generator.python_main_generator import write_main_python_file
 from type_generator.parse_definitions import parse_project_definitions, load_project_files
@@ -81,9 +82,13 @@ def generate_value_type_tests(output_directory: Path,
                               system_types)
 
     cpp_main_filename = cpp_main_src_directory / "main.cpp"
+    cpp_benchmark_src_directory = output_directory / "benchmark" / "src"
+    os.makedirs(cpp_benchmark_src_directory, exist_ok=True)
+    cpp_benchmark_filename = cpp_benchmark_src_directory / "benchmark.cpp"
     python_main_filename = output_directory / "python" / ("test_" + project_definitions['PackageNamespace'] + ".py")
 
     write_main_src_file(cpp_main_filename, project_types, group_names, project_definitions)
+    write_benchmark_src_file(cpp_benchmark_filename, project_types, project_definitions)
     write_main_python_file(
         python_main_filename,
         group_names,
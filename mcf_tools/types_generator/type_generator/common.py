@@ -3,11 +3,19 @@ Common definitions of abstract syntax objects and useful classes
 
 Copyright (c) 2024 Accenture
 """
-from typing import List, NamedTuple, Union, Any
+from typing import List, NamedTuple, Union, Any, Iterator, TextIO
+from contextlib import contextmanager
+import io
+import os
 import re
 import abc
 import builtins
 
+# C++ file layouts of a value type package, selected by the Layout of ProjectDefinitions.json
+LAYOUT_HEADER = "header"
+LAYOUT_SPLIT = "split"
+LAYOUTS = [LAYOUT_HEADER, LAYOUT_SPLIT]
+
 
 class ConfigurationError(Exception):
     pass
@@ -252,6 +260,37 @@ class TypesData(NamedTuple):
     linked_names: list
 
 
+def validate_layout(layout: str, error_prefix_str: str) -> None:
+    if layout not in LAYOUTS:
+        raise ConfigurationError(f"{error_prefix_str}: unknown Layout {layout}, expected one of {LAYOUTS}")
+
+
+def uses_split_layout(current_type: dict) -> bool:
+    """
+    Returns if the C++ type is generated without msgpack, with its codec and registration in separate files
+    """
+    return current_type.get("Layout", LAYOUT_HEADER) == LAYOUT_SPLIT
+
+
+@contextmanager
+def generated_file(filename: Union[str, 'os.PathLike']) -> Iterator[TextIO]:
+    """
+    Opens a generated file for writing, which is only replaced if its content changed
+
+    Keeps the modification time of unchanged files, so that regenerating a package after changing
+    a single definition only recompiles the translation units depending on the changed files.
+    """
+    content = io.StringIO()
+    yield content
+    text = content.getvalue()
+    if os.path.exists(filename):
+        with open(filename, "r") as existing_file:
+            if existing_file.read() == text:
+                return
+    with open(filename, "w") as output_file:
+        output_file.write(text)
+
+
 def is_enum_type(value_type: Type, types_data: TypesData) -> bool:
     """
     Returns if a type is an enumeration
@@ -267,6 +306,30 @@ def is_enum_type(value_type: Type, types_data: TypesData) -> bool:
     return project_enum or linked_enum
 
 
+def fnv1a_64(text: str) -> int:
+    """
+    Returns the 64 bit FNV-1a hash of the utf-8 encoded text, like mcf::TypeRegistry::hashTypeId()
+    """
+    result = 0xcbf29ce484222325
+    for byte in text.encode("utf-8"):
+        result = ((result ^ byte) * 0x100000001b3) & 0xffffffffffffffff
+    return result
+
+
+def numeric_type_id(types_data: TypesData) -> int:
+    """
+    Returns the stable numeric id of the current type (see mcf::TypeRegistry::numericTypeId()), a
+    hash of its name, kind and the names and types of its attributes
+    """
+    current_type = types_data.current_type
+    system_types = types_data.system_types
+    schema = f"{current_type['PackageNamespace']}::{current_type['Directory']}::{current_type['Name']}"
+    schema += f"|{current_type['Kind'].as_cpp_type(system_types)}"
+    for name, attribute in current_type["Attributes"].items():
+        schema += f"|{name}:{attribute['Type'].as_cpp_type(system_types)}"
+    return fnv1a_64(schema)
+
+
 def is_primitive_type(type_name: Union[str, List[str]], system_types: dict) -> bool:
     if isinstance(type_name, list):
         type_name = type_name[-1]
@@ -433,8 +496,42 @@ def assert_default_values_valid(value_type: dict, types_data: 'TypesData', error
     assert_default_init_value_types_valid(value_type, types_data, error_prefix_str)
 
 
+def assert_reserve_valid(value_type: dict, error_prefix_str: str) -> None:
+    """
+    Returns if there is no Reserve value or if it is a positive integer given for a vector or
+    string. Otherwise, raises an exception.
+    """
+    if "Reserve" not in value_type:
+        return
+
+    reserve = value_type["Reserve"]
+    if type(reserve) != int or reserve <= 0:
+        raise ConfigurationError(f"{error_prefix_str}. Reserve should be a positive integer.")
+
+    if value_type["Type"].type_name_no_ns not in ["vector", "string"]:
+        raise ConfigurationError(f"{error_prefix_str}. Reserve can only be set for vectors and strings.")
+
+
+def assert_ext_mem_pool_valid(current_type: dict) -> None:
+    """
+    Returns if there is no ExtMemPool value or if it is a pool name given for an ExtMemValue.
+    Otherwise, raises an exception.
+    """
+    if "ExtMemPool" not in current_type:
+        return
+
+    error_prefix_str = f"Error in {current_type['Name']}"
+    pool = current_type["ExtMemPool"]
+    if type(pool) != str or not pool:
+        raise ConfigurationError(f"{error_prefix_str}. ExtMemPool should be a non-empty pool name.")
+
+    if current_type["Kind"].type_name_no_ns != "ExtMemValue":
+        raise ConfigurationError(f"{error_prefix_str}. ExtMemPool can only be set for ExtMemValues.")
+
+
 def assert_types_validity(types_data: 'TypesData') -> None:
     for group in types_data.project_types.values():
+        assert_ext_mem_pool_valid(group)
         if group["Kind"].type_name_no_ns != "Enum":
             for value_name, value_type in group["Attributes"].items():
                 error_prefix_str = f"Error in {group['Name']}::{value_name}"
@@ -442,3 +539,4 @@ def assert_types_validity(types_data: 'TypesData') -> None:
                 assert_map_key_string(value_type, error_prefix_str)
                 assert_container_type_valid(value_type, types_data.system_types, error_prefix_str)
                 assert_default_values_valid(value_type, types_data, error_prefix_str)
+                assert_reserve_valid(value_type, error_prefix_str)
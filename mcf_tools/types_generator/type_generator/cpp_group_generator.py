@@ -1,6 +1,9 @@
 """"
 Copyright (c) 2024 Accenture
 """
+from type_generator.common import uses_split_layout, generated_file
+from type_generator.cpp_split_generator import add_register_declarations, is_registered
+
 import os
 from typing import TextIO, TYPE_CHECKING
 
@@ -21,6 +24,9 @@ def add_register_types(file: TextIO, group_names: list, class_name: str, project
         # Only register values and extmemvalues in value store
         if kind == "Value" or kind == "ExtMemValue":
             type_name_no_ns = type_name.split("::")[-1]
+            if uses_split_layout(project_types[type_name]):
+                file.write(f"    register{type_name_no_ns}(r);\n")
+                continue
             file.write(f"    r.template registerType<{type_name_no_ns}>(\"{project_namespace}::{type_namespace}::{type_name_no_ns}\");\n")
 
     file.write("}\n\n")
@@ -31,6 +37,11 @@ def add_namespace(file: TextIO, group_names: list, group_type: dict, class_name:
     file.write(f"namespace {group_type['PackageNamespace']} {{\n\n")
     file.write(f"namespace {group_type['Directory']} {{\n\n")
 
+    if uses_split_layout(group_type):
+        # the registration functions of the types are compiled in their <Name>Codec.cpp
+        for type_name in sorted(group_names):
+            if is_registered(project_types[type_name]):
+                add_register_declarations(file, project_types[type_name])
     add_register_types(file, group_names, class_name, project_types)
 
     file.write(f"}}   // namespace {group_type['Directory']}\n\n")
@@ -38,7 +49,22 @@ def add_namespace(file: TextIO, group_names: list, group_type: dict, class_name:
     file.write("}   // namespace values\n\n")
 
 
+def add_split_includes(file: TextIO, group_names: list, group_type: dict, class_name: str, project_types: dict) -> None:
+    # only the declarations, the types are included where they are used
+    file.write(f"#include \"{group_type['PackageNamespace']}/{group_type['Directory']}/{class_name}Fwd.h\"\n\n")
+    file.write("namespace mcf {\n")
+    file.write("class TypeRegistry;\n")
+    file.write("class ValueStore;\n")
+    file.write("}   // namespace mcf\n\n")
+
+    add_namespace(file, group_names, group_type, class_name, project_types)
+
+
 def add_includes(file: TextIO, group_names: list, group_type: dict, class_name: str, project_types: dict) -> None:
+    if uses_split_layout(group_type):
+        add_split_includes(file, group_names, group_type, class_name, project_types)
+        return
+
     file.write("#include \"msgpack.hpp\"\n")
 
     for el in sorted(group_names):
@@ -62,7 +88,7 @@ def add_include_guard(file: TextIO, group_names: list, group_type: dict, class_n
 
 def write_group_header_file(filename: 'Path', group_names: list, group_type: dict, class_name: str, project_types: dict) -> None:
     execution_dir = os.getcwd()
-    with open(filename, "w") as output_file:
+    with generated_file(filename) as output_file:
         output_file.write("// WARNING: This file is generated automatically in the build process by mcf_tools/types_generator/value_type_generator.py.\n")
         output_file.write("// Any changes that you make will be overwritten whenever the project is built.\n")
         output_file.write("// To make changes either edit mcf_tools/types_generator/type_generator/cpp_group_generator.py or disable the generation in: \n"
@@ -3,7 +3,9 @@ Copyright (c) 2024 Accenture
 """
 from type_generator.common import TypesData, ConfigurationError
 from type_generator.common import is_enum_type, is_primitive_type, is_container_type
-from type_generator.common import assert_types_validity
+from type_generator.common import assert_types_validity, numeric_type_id, uses_split_layout, generated_file
+from type_generator.flat_layout import flat_layout, uses_flat_format, pod_layout, uses_pod_format
+from type_generator.flat_layout import bulk_arrays, uses_bulk_format
 
 import os
 from typing import TextIO, TYPE_CHECKING
@@ -18,6 +20,134 @@ def add_msg_pack_define(file: TextIO, current_type: dict) -> None:
     file.write(msgpack_define_string)
 
 
+def add_flat_view(file: TextIO, types_data: 'TypesData', slots: list) -> None:
+    attributes = types_data.current_type["Attributes"]
+    file.write("    /**\n")
+    file.write(f"     * Reads the attributes of a flat packed {types_data.current_type['Name']} in place, see mcf_core/FlatValue.h\n")
+    file.write("     */\n")
+    file.write("    class View\n")
+    file.write("    {\n")
+    file.write("    public:\n")
+    file.write("        explicit View(const msgpack::object& object) : fReader(object, FLAT_FIXED_SIZE) {}\n")
+    file.write("        View(const char* data, std::size_t size) : fReader(data, size, FLAT_FIXED_SIZE) {}\n\n")
+    for slot in slots:
+        cpp_type = attributes[slot.name]["Type"].as_cpp_type(types_data.system_types)
+        if slot.kind == "scalar" and slot.cpp_type == "bool":
+            file.write(f"        bool {slot.name}() const {{ return fReader.scalar<uint8_t>({slot.offset}) != 0; }}\n")
+        elif slot.kind == "scalar":
+            file.write(f"        {cpp_type} {slot.name}() const {{ return fReader.scalar<{cpp_type}>({slot.offset}); }}\n")
+        elif slot.kind == "enum":
+            file.write(f"        {cpp_type} {slot.name}() const {{ return static_cast<{cpp_type}>(fReader.scalar<int32_t>({slot.offset})); }}\n")
+        elif slot.kind == "string":
+            file.write(f"        mcf::flat::String {slot.name}() const {{ return fReader.string({slot.offset}); }}\n")
+        elif slot.kind == "array":
+            file.write(f"        mcf::flat::Array<{slot.cpp_type}> {slot.name}() const {{ return fReader.array<{slot.cpp_type}>({slot.offset}); }}\n")
+        else:
+            file.write(f"        {cpp_type} {slot.name}() const {{ return fReader.unpacked<{cpp_type}>({slot.offset}); }}\n")
+    file.write("\n")
+    file.write("    private:\n")
+    file.write("        mcf::flat::Reader fReader;\n")
+    file.write("    };\n\n")
+
+
+def add_flat_pack(file: TextIO, types_data: 'TypesData') -> None:
+    slots, fixed_size = flat_layout(types_data)
+    file.write(f"    static constexpr std::size_t FLAT_FIXED_SIZE = {fixed_size};  ///< size of the fixed part of the flat wire format\n\n")
+    add_flat_view(file, types_data, slots)
+
+    file.write("    template<typename Packer>\n")
+    file.write("    void msgpack_pack(Packer& packer) const\n")
+    file.write("    {\n")
+    file.write("        mcf::flat::Writer writer(FLAT_FIXED_SIZE);\n")
+    for slot in slots:
+        if slot.kind == "scalar" and slot.cpp_type == "bool":
+            file.write(f"        writer.scalar<uint8_t>({slot.offset}, {slot.name} ? 1 : 0);\n")
+        elif slot.kind == "scalar":
+            file.write(f"        writer.scalar<{slot.cpp_type}>({slot.offset}, {slot.name});\n")
+        elif slot.kind == "enum":
+            file.write(f"        writer.scalar<int32_t>({slot.offset}, static_cast<int32_t>({slot.name}));\n")
+        elif slot.kind == "string":
+            file.write(f"        writer.string({slot.offset}, {slot.name});\n")
+        elif slot.kind == "array":
+            file.write(f"        writer.array({slot.offset}, {slot.name});\n")
+        else:
+            file.write(f"        writer.packed({slot.offset}, {slot.name});\n")
+    file.write("        writer.pack(packer);\n")
+    file.write("    }\n\n")
+
+    file.write("    void msgpack_unpack(const msgpack::object& object)\n")
+    file.write("    {\n")
+    file.write("        const View view(object);\n")
+    for slot in slots:
+        if slot.kind == "string":
+            file.write(f"        {slot.name} = view.{slot.name}().str();\n")
+        elif slot.kind == "array":
+            file.write(f"        {slot.name} = view.{slot.name}().vec();\n")
+        else:
+            file.write(f"        {slot.name} = view.{slot.name}();\n")
+    file.write("    }\n")
+
+
+def add_pod_pack(file: TextIO, types_data: 'TypesData') -> None:
+    slots, size, layout_hash = pod_layout(types_data)
+    file.write(f"    static constexpr std::size_t POD_SIZE = {size};  ///< size of the attributes in the POD wire format\n")
+    file.write(f"    static constexpr uint64_t POD_LAYOUT_HASH = {layout_hash:#018x}ull;  ///< hash of the type name and layout, see mcf_core/PodValue.h\n\n")
+
+    file.write("    template<typename Packer>\n")
+    file.write("    void msgpack_pack(Packer& packer) const\n")
+    file.write("    {\n")
+    file.write("        mcf::pod::Writer<POD_SIZE> writer(POD_LAYOUT_HASH);\n")
+    for slot in slots:
+        if slot.kind == "scalar" and slot.cpp_type == "bool":
+            file.write(f"        writer.put<uint8_t>({slot.offset}, {slot.name} ? 1 : 0);\n")
+        elif slot.kind == "scalar":
+            file.write(f"        writer.put<{slot.cpp_type}>({slot.offset}, {slot.name});\n")
+        else:
+            file.write(f"        writer.put<int32_t>({slot.offset}, static_cast<int32_t>({slot.name}));\n")
+    file.write("        writer.pack(packer);\n")
+    file.write("    }\n\n")
+
+    attributes = types_data.current_type["Attributes"]
+    file.write("    void msgpack_unpack(const msgpack::object& object)\n")
+    file.write("    {\n")
+    file.write("        const mcf::pod::Reader reader(object, POD_LAYOUT_HASH, POD_SIZE);\n")
+    for slot in slots:
+        cpp_type = attributes[slot.name]["Type"].as_cpp_type(types_data.system_types)
+        if slot.kind == "scalar" and slot.cpp_type == "bool":
+            file.write(f"        {slot.name} = reader.get<uint8_t>({slot.offset}) != 0;\n")
+        elif slot.kind == "scalar":
+            file.write(f"        {slot.name} = reader.get<{cpp_type}>({slot.offset});\n")
+        else:
+            file.write(f"        {slot.name} = static_cast<{cpp_type}>(reader.get<int32_t>({slot.offset}));\n")
+    file.write("    }\n")
+
+
+def add_bulk_pack(file: TextIO, types_data: 'TypesData') -> None:
+    attributes = types_data.current_type["Attributes"]
+    arrays = bulk_arrays(types_data)
+
+    file.write("    template<typename Packer>\n")
+    file.write("    void msgpack_pack(Packer& packer) const\n")
+    file.write("    {\n")
+    file.write(f"        packer.pack_array({len(attributes)});\n")
+    for name in attributes:
+        if name in arrays:
+            file.write(f"        mcf::bulk::pack(packer, {name});\n")
+        else:
+            file.write(f"        packer.pack({name});\n")
+    file.write("    }\n\n")
+
+    file.write("    void msgpack_unpack(const msgpack::object& object)\n")
+    file.write("    {\n")
+    file.write("        const mcf::bulk::Reader reader(object);\n")
+    for index, name in enumerate(attributes):
+        if name in arrays:
+            file.write(f"        reader.array({index}, {name});\n")
+        else:
+            file.write(f"        reader.attribute({index}, {name});\n")
+    file.write("    }\n")
+
+
 def add_operators(file: TextIO, current_type: dict) -> None:
     attribute_names = current_type["Attributes"].keys()
     lhs_string = ", ".join(attribute_names)
@@ -100,7 +230,27 @@ def add_empty_constructor(file: TextIO, types_data: 'TypesData') -> None:
             )
         ))
 
-    file.write(" {};\n\n")
+    # capacity hints, so that building a value does not reallocate its vectors and strings
+    reserve = [(key, value["Reserve"]) for (key, value) in types_data.current_type["Attributes"].items()
+               if "Reserve" in value]
+    if reserve:
+        file.write("\n    {\n")
+        for (key, capacity) in reserve:
+            file.write(f"        {key}.reserve({capacity});\n")
+        file.write("    }\n\n")
+    else:
+        file.write(" {};\n\n")
+
+
+def add_copy_and_move(file: TextIO, current_type: dict) -> None:
+    # noexcept, so that containers of values and nested structs move their elements when growing
+    # instead of copying them. For ExtMemValues, which can only be move constructed, the defaulted
+    # copy and assignment operators are deleted.
+    name = current_type["Name"]
+    file.write(f"    {name}(const {name}&) = default;\n")
+    file.write(f"    {name}({name}&&) noexcept = default;\n")
+    file.write(f"    {name}& operator=(const {name}&) = default;\n")
+    file.write(f"    {name}& operator=({name}&&) noexcept = default;\n\n")
 
 
 def add_description(file: TextIO, current_type: dict) -> None:
@@ -109,12 +259,47 @@ def add_description(file: TextIO, current_type: dict) -> None:
     file.write(" */\n")
 
 
+def add_value_pool_tag(file: TextIO, current_type: dict) -> None:
+    if current_type.get("Pooled", False):
+        file.write("    using McfUseValuePool = void;  ///< allocate values of this type from a mcf::ValuePool\n\n")
+
+
+def add_ext_mem_pool(file: TextIO, current_type: dict) -> None:
+    # CudaExtMemValues manage device memory, which is not pooled
+    if "ExtMemPool" in current_type:
+        file.write("#if !HAVE_CUDA\n")
+        file.write("    /// recycle the ext mem buffers of this type in their own mcf::ExtMemPool\n")
+        file.write("    mcf::ExtMemPool& extMemPool() const override\n")
+        file.write(f"    {{ return mcf::ExtMemPool::named(\"{current_type['ExtMemPool']}\"); }}\n")
+        file.write("#endif // !HAVE_CUDA\n\n")
+
+
+def add_type_id(file: TextIO, types_data: 'TypesData') -> None:
+    file.write(f"    static constexpr uint64_t MCF_TYPE_ID = {numeric_type_id(types_data):#018x}ull;"
+               "  ///< hash of the type name and attributes, see mcf::TypeRegistry::numericTypeId()\n\n")
+
+
 def write_class(file: TextIO, types_data: 'TypesData') -> None:
+    if types_data.current_type["Kind"].type_name_no_ns != "Struct":
+        add_type_id(file, types_data)
+        add_value_pool_tag(file, types_data.current_type)
+        add_ext_mem_pool(file, types_data.current_type)
     add_empty_constructor(file, types_data)
     add_value_init_constructor(file, types_data.current_type, types_data.system_types)
+    add_copy_and_move(file, types_data.current_type)
     add_operators(file, types_data.current_type)
     add_attributes(file, types_data.current_type, types_data.system_types)
-    add_msg_pack_define(file, types_data.current_type)
+    if uses_pod_format(types_data.current_type):
+        file.write("\n")
+        add_pod_pack(file, types_data)
+    elif uses_flat_format(types_data.current_type):
+        file.write("\n")
+        add_flat_pack(file, types_data)
+    elif uses_bulk_format(types_data.current_type):
+        file.write("\n")
+        add_bulk_pack(file, types_data)
+    elif not uses_split_layout(types_data.current_type):
+        add_msg_pack_define(file, types_data.current_type)
     file.write("};\n\n")
 
 
@@ -194,6 +379,7 @@ def add_includes(file: TextIO, types_data: 'TypesData') -> None:
     system_includes = set()
     project_includes = set()
     linked_includes = set()
+    linked_msgpack = False
     main_string = ""
     for value in types_data.current_type["Attributes"].values():
         type_list = value["Type"].as_generic_type_list()
@@ -215,18 +401,26 @@ def add_includes(file: TextIO, types_data: 'TypesData') -> None:
             # add includes for linked project types
             if type_name in types_data.linked_names:
                 linked_includes.add(f"#include \"{types_data.linked_types[type_name]['Include']}\"")
+                linked_msgpack = linked_msgpack or not uses_split_layout(types_data.linked_types[type_name])
 
             # add includes for cpp-system-types if needed, e.g. <vector>. And also replace names with the cpp names.
             if type_name in types_data.system_types["SystemTypes"]:
                 if "CppInclude" in types_data.system_types["SystemTypes"][type_name]:
                     system_includes.add(f"#include <{types_data.system_types['SystemTypes'][type_name]['CppInclude']}>")
 
+    if uses_split_layout(types_data.current_type):
+        # provided by msgpack.hpp in the header layout
+        system_includes.update({"#include <cstdint>", "#include <tuple>"})
+
     if len(system_includes) > 0:
         for el in sorted(system_includes):
             main_string += el + "\n"
     main_string += "\n"
 
     if len(linked_includes) > 0:
+        # linked packages of the header layout define their msgpack adaptors in their types
+        if uses_split_layout(types_data.current_type) and linked_msgpack:
+            file.write("#include \"msgpack.hpp\"\n")
         for el in sorted(linked_includes):
             file.write(el + "\n")
 
@@ -234,11 +428,19 @@ def add_includes(file: TextIO, types_data: 'TypesData') -> None:
         for el in sorted(project_includes):
             main_string += el + "\n"
 
+    if uses_flat_format(types_data.current_type):
+        main_string += "#include \"mcf_core/FlatValue.h\"\n"
+    if uses_pod_format(types_data.current_type):
+        main_string += "#include \"mcf_core/PodValue.h\"\n"
+    if uses_bulk_format(types_data.current_type):
+        main_string += "#include \"mcf_core/BulkArray.h\"\n"
+
     kind = types_data.current_type["Kind"].type_name_no_ns
     if kind == "Value":
         main_string += "#include \"mcf_core/Value.h\"\n\n"
     elif kind == "ExtMemValue":
-        main_string += "#include \"mcf_core/ValueStore.h\"\n\n"
+        if not uses_split_layout(types_data.current_type):
+            main_string += "#include \"mcf_core/ValueStore.h\"\n\n"
         main_string += "#if HAVE_CUDA\n"
         main_string += "#include \"mcf_cuda/CudaExtMemValue.h\"\n"
         main_string += "#else\n"
@@ -261,7 +463,9 @@ def add_include_guard(file: TextIO, types_data: 'TypesData') -> None:
 
     if types_data.current_type["Kind"].type_name_no_ns == "Enum":
         add_namespace(file, types_data)
-        file.write(f"MSGPACK_ADD_ENUM(values::{project_namespace}::{type_namespace}::{type_name})\n\n")
+        # the split layout adds the enum to msgpack in its codec header
+        if not uses_split_layout(types_data.current_type):
+            file.write(f"MSGPACK_ADD_ENUM(values::{project_namespace}::{type_namespace}::{type_name})\n\n")
     else:
         add_includes(file, types_data)
 
@@ -272,7 +476,7 @@ def write_individual_header_file(header_dir: 'Path', types_data: 'TypesData') ->
     assert_types_validity(types_data)
     filename = header_dir / (types_data.current_type["Name"] + ".h")
     execution_dir = os.getcwd()
-    with open(filename, "w") as output_file:
+    with generated_file(filename) as output_file:
         output_file.write("// WARNING: This file is generated automatically in the build process by mcf_tools/types_generator/value_type_generator.py.\n")
         output_file.write("// Any changes that you make will be overwritten whenever the project is built.\n")
         output_file.write("// To make changes either edit mcf_tools/types_generator/type_generator/cpp_indiv_generator.py or disable the generation in: \n"
@@ -1,6 +1,8 @@
 """"
 Copyright (c) 2024 Accenture
 """
+from type_generator.common import generated_file
+
 import os
 from typing import TextIO, TYPE_CHECKING
 
@@ -41,7 +43,7 @@ def add_include_guard(file: TextIO, project_definitions: dict) -> None:
 
 def write_register_header_file(filename: 'Path', project_definitions: dict) -> None:
     execution_dir = os.getcwd()
-    with open(filename / (project_definitions["ProjectName"] + ".h"), "w") as output_file:
+    with generated_file(filename / (project_definitions["ProjectName"] + ".h")) as output_file:
         output_file.write("// WARNING: This file is generated automatically in the build process by mcf_tools/types_generator/value_type_generator.py.\n")
         output_file.write("// Any changes that you make will be overwritten whenever the project is built.\n")
         output_file.write("// To make changes either edit mcf_tools/types_generator/type_generator/cpp_register_generator.py or disable the generation in: \n"
@@ -0,0 +1,245 @@
+""""
+Copyright (c) 2024 Accenture
+"""
+from type_generator.common import TypesData, uses_split_layout, generated_file
+from type_generator.flat_layout import uses_flat_format, uses_pod_format, uses_bulk_format
+
+import os
+from typing import TextIO, TYPE_CHECKING
+if TYPE_CHECKING:
+    from pathlib import Path
+
+
+def codec_include(include: str) -> str:
+    return include[:-len(".h")] + "Codec.h"
+
+
+def full_type_name(current_type: dict) -> str:
+    return f"values::{current_type['PackageNamespace']}::{current_type['Directory']}::{current_type['Name']}"
+
+
+def has_separate_codec(current_type: dict) -> bool:
+    # types of the flat, pod and bulk wire formats pack themselves, their headers include msgpack anyway
+    kind = current_type["Kind"].type_name_no_ns
+    return kind == "Enum" or not (uses_flat_format(current_type) or uses_pod_format(current_type)
+                                  or uses_bulk_format(current_type))
+
+
+def is_registered(current_type: dict) -> bool:
+    return current_type["Kind"].type_name_no_ns in ["Value", "ExtMemValue"]
+
+
+def write_generated_warning(file: TextIO, generator: str) -> None:
+    execution_dir = os.getcwd()
+    file.write("// WARNING: This file is generated automatically in the build process by mcf_tools/types_generator/value_type_generator.py.\n")
+    file.write("// Any changes that you make will be overwritten whenever the project is built.\n")
+    file.write(f"// To make changes either edit mcf_tools/types_generator/type_generator/{generator} or disable the generation in: \n"
+               f"// {execution_dir}\n\n\n")
+
+
+def open_namespaces(file: TextIO, current_type: dict) -> None:
+    file.write("namespace values {\n\n")
+    file.write(f"namespace {current_type['PackageNamespace']} {{\n\n")
+    file.write(f"namespace {current_type['Directory']} {{\n\n")
+
+
+def close_namespaces(file: TextIO, current_type: dict) -> None:
+    file.write(f"}}   // namespace {current_type['Directory']}\n\n")
+    file.write(f"}}   // namespace {current_type['PackageNamespace']}\n\n")
+    file.write("}   // namespace values\n\n")
+
+
+def open_adaptor_namespaces(file: TextIO) -> None:
+    file.write("namespace msgpack {\n\n")
+    file.write("MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS) {\n\n")
+    file.write("namespace adaptor {\n\n")
+
+
+def close_adaptor_namespaces(file: TextIO) -> None:
+    file.write("}   // namespace adaptor\n\n")
+    file.write("}   // MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS)\n\n")
+    file.write("}   // namespace msgpack\n\n")
+
+
+def define_array(current_type: dict) -> str:
+    attributes = ", ".join(f"value.{name}" for name in current_type["Attributes"].keys())
+    return f"msgpack::type::make_define_array({attributes})"
+
+
+def pack_declaration(name: str, stream: str) -> str:
+    return (f"msgpack::packer<{stream}>& pack<{name}>::operator()(msgpack::packer<{stream}>& packer, "
+            f"const {name}& value) const")
+
+
+def add_register_declarations(file: TextIO, current_type: dict) -> None:
+    name = current_type["Name"]
+    file.write("template<typename T>\n")
+    file.write(f"void register{name}(T& r);\n")
+    file.write(f"extern template void register{name}<mcf::TypeRegistry>(mcf::TypeRegistry& r);\n")
+    file.write(f"extern template void register{name}<mcf::ValueStore>(mcf::ValueStore& r);\n\n")
+
+
+def add_codec_includes(file: TextIO, types_data: 'TypesData') -> None:
+    codec_includes = set()
+    for value in types_data.current_type["Attributes"].values():
+        for t in value["Type"].as_generic_type_list():
+            type_name = "::".join(t)
+            if type_name in types_data.project_names:
+                attribute_type = types_data.project_types[type_name]
+            elif type_name in types_data.linked_names:
+                attribute_type = types_data.linked_types[type_name]
+            else:
+                continue
+            # the codecs of attributes are needed before the non-template convert functions are declared
+            if uses_split_layout(attribute_type) and has_separate_codec(attribute_type):
+                codec_includes.add(f"#include \"{codec_include(attribute_type['Include'])}\"")
+
+    for el in sorted(codec_includes):
+        file.write(el + "\n")
+
+
+def add_adaptors(file: TextIO, types_data: 'TypesData') -> None:
+    name = full_type_name(types_data.current_type)
+    open_adaptor_namespaces(file)
+
+    file.write("template<>\n")
+    file.write(f"struct convert<{name}>\n")
+    file.write("{\n")
+    file.write(f"    const msgpack::object& operator()(const msgpack::object& object, {name}& value) const;\n")
+    file.write("};\n\n")
+
+    file.write("template<>\n")
+    file.write(f"struct pack<{name}>\n")
+    file.write("{\n")
+    file.write("    template<typename Stream>\n")
+    file.write(f"    msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& packer, const {name}& value) const;\n")
+    file.write("};\n\n")
+
+    file.write("template<>\n")
+    file.write(f"struct object_with_zone<{name}>\n")
+    file.write("{\n")
+    file.write(f"    void operator()(msgpack::object::with_zone& object, const {name}& value) const;\n")
+    file.write("};\n\n")
+
+    file.write("template<typename Stream>\n")
+    file.write(pack_declaration(name, "Stream") + "\n")
+    file.write("{\n")
+    file.write(f"    {define_array(types_data.current_type)}.msgpack_pack(packer);\n")
+    file.write("    return packer;\n")
+    file.write("}\n\n")
+
+    file.write(f"// instantiated in {types_data.current_type['Name']}Codec.cpp\n")
+    file.write("extern template " + pack_declaration(name, "msgpack::sbuffer") + ";\n\n")
+
+    close_adaptor_namespaces(file)
+
+
+def write_codec_header_file(header_dir: 'Path', types_data: 'TypesData') -> None:
+    """
+    Writes the msgpack codec of a type of the split layout, <Name>Codec.h
+
+    Only translation units packing or unpacking the type directly need to include it, the ValueStore
+    and the remote endpoints use the functions registered with register<Name>().
+    """
+    current_type = types_data.current_type
+    guard_string = (f"{current_type['PackageNamespace'].upper()}_{current_type['Directory'].upper()}_"
+                    f"{current_type['Name'].upper()}CODEC_H_")
+    with generated_file(header_dir / (current_type["Name"] + "Codec.h")) as file:
+        write_generated_warning(file, "cpp_split_generator.py")
+        file.write(f"#ifndef {guard_string}\n")
+        file.write(f"#define {guard_string}\n\n")
+        file.write(f"#include \"{current_type['Include']}\"\n")
+        if has_separate_codec(current_type):
+            file.write("\n#include \"msgpack.hpp\"\n\n")
+            if current_type["Kind"].type_name_no_ns == "Enum":
+                file.write(f"MSGPACK_ADD_ENUM({full_type_name(current_type)})\n\n")
+            else:
+                add_codec_includes(file, types_data)
+                file.write("\n")
+                add_adaptors(file, types_data)
+        else:
+            file.write("\n")
+        file.write("#endif   // " + guard_string)
+
+
+def add_adaptor_definitions(file: TextIO, types_data: 'TypesData') -> None:
+    name = full_type_name(types_data.current_type)
+    open_adaptor_namespaces(file)
+
+    file.write(f"const msgpack::object& convert<{name}>::operator()(const msgpack::object& object, {name}& value) const\n")
+    file.write("{\n")
+    file.write(f"    {define_array(types_data.current_type)}.msgpack_unpack(object);\n")
+    file.write("    return object;\n")
+    file.write("}\n\n")
+
+    file.write(f"void object_with_zone<{name}>::operator()(msgpack::object::with_zone& object, const {name}& value) const\n")
+    file.write("{\n")
+    file.write(f"    {define_array(types_data.current_type)}.msgpack_object(&object, object.zone);\n")
+    file.write("}\n\n")
+
+    file.write("template " + pack_declaration(name, "msgpack::sbuffer") + ";\n\n")
+
+    close_adaptor_namespaces(file)
+
+
+def add_register_definition(file: TextIO, current_type: dict) -> None:
+    name = current_type["Name"]
+    open_namespaces(file, current_type)
+    file.write("template<typename T>\n")
+    file.write(f"void register{name}(T& r) {{\n")
+    file.write(f"    r.template registerType<{name}>(\"{current_type['PackageNamespace']}::{current_type['Directory']}::{name}\");\n")
+    file.write("}\n\n")
+    file.write(f"template void register{name}<mcf::TypeRegistry>(mcf::TypeRegistry& r);\n")
+    file.write(f"template void register{name}<mcf::ValueStore>(mcf::ValueStore& r);\n\n")
+    close_namespaces(file, current_type)
+
+
+def write_codec_source_file(source_dir: 'Path', types_data: 'TypesData') -> None:
+    """
+    Writes the compiled codec and the registration of a type of the split layout, <Name>Codec.cpp
+
+    Enums and structs which pack themselves have nothing to compile, no file is written for them.
+    """
+    current_type = types_data.current_type
+    kind = current_type["Kind"].type_name_no_ns
+    adaptors = kind != "Enum" and has_separate_codec(current_type)
+    if not adaptors and not is_registered(current_type):
+        return
+
+    with generated_file(source_dir / (current_type["Name"] + "Codec.cpp")) as file:
+        write_generated_warning(file, "cpp_split_generator.py")
+        file.write(f"#include \"{codec_include(current_type['Include'])}\"\n\n")
+        if is_registered(current_type):
+            file.write("#include \"mcf_core/TypeRegistry.h\"\n")
+            file.write("#include \"mcf_core/ValueStore.h\"\n\n")
+        if adaptors:
+            add_adaptor_definitions(file, types_data)
+        if is_registered(current_type):
+            add_register_definition(file, current_type)
+
+
+def write_forward_header_file(filename: 'Path', group_names: list, group_type: dict, class_name: str,
+                              project_types: dict) -> None:
+    """
+    Writes the forward declarations of the types of a group of the split layout, <Group>Fwd.h
+    """
+    guard_string = f"{group_type['PackageNamespace'].upper()}_{class_name.upper()}FWD_H_"
+    with generated_file(filename) as file:
+        write_generated_warning(file, "cpp_split_generator.py")
+        file.write(f"#ifndef {guard_string}\n")
+        file.write(f"#define {guard_string}\n\n")
+
+        # unscoped enums without an underlying type cannot be declared, their headers are small
+        enums = sorted(name for name in group_names if project_types[name]["Kind"].type_name_no_ns == "Enum")
+        for name in enums:
+            file.write(f"#include \"{project_types[name]['Include']}\"\n")
+        file.write("\n")
+
+        open_namespaces(file, group_type)
+        for name in sorted(group_names):
+            if name not in enums:
+                file.write(f"struct {project_types[name]['Name']};\n")
+        file.write("\n")
+        close_namespaces(file, group_type)
+
+        file.write("#endif   // " + guard_string)
@@ -0,0 +1,197 @@
+"""
+Layout of the flat wire format, shared by the C++ and the Python generator
+
+The format is described in mcf_core/FlatValue.h: every attribute has a slot in the fixed part
+of the packed value, strings, vectors of numbers and msgpack packed attributes are stored in
+the variable part behind it.
+
+Types of numbers only may opt in to the POD format with "Pod": true, see mcf_core/PodValue.h,
+which is the fixed part alone behind a hash of the layout.
+
+The bulk format keeps the msgpack array of attributes, but packs vectors of numbers as bin, see
+mcf_core/BulkArray.h.
+
+Copyright (c) 2024 Accenture
+"""
+from type_generator.common import Scalar, Template, TypesData, ConfigurationError, is_enum_type, fnv1a_64
+
+from typing import List, NamedTuple, Optional
+
+
+WIRE_FORMAT_MSGPACK = "msgpack"
+WIRE_FORMAT_FLAT = "flat"
+WIRE_FORMAT_BULK = "bulk"
+WIRE_FORMATS = [WIRE_FORMAT_MSGPACK, WIRE_FORMAT_FLAT, WIRE_FORMAT_BULK]
+
+# python struct format and size of the numbers by their FlatBufferName in AllowedTypes.json
+FLAT_NUMBERS = {
+    "bool": ("?", 1),
+    "int8": ("b", 1),
+    "uint8": ("B", 1),
+    "int16": ("h", 2),
+    "uint16": ("H", 2),
+    "int32": ("i", 4),
+    "uint32": ("I", 4),
+    "int64": ("q", 8),
+    "uint64": ("Q", 8),
+    "float": ("f", 4),
+    "double": ("d", 8),
+}
+
+FLAT_SIZES = {fmt: size for fmt, size in FLAT_NUMBERS.values()}
+
+# slot of a string, vector or msgpack packed attribute: uint32 offset and uint32 size
+REF_SIZE = 8
+REF_ALIGNMENT = 4
+
+
+class FlatSlot(NamedTuple):
+    name: str
+    # "scalar", "enum", "string", "array" or "packed"
+    kind: str
+    offset: int
+    # struct format of scalars and array elements, None otherwise
+    fmt: Optional[str]
+    # C++ type of scalars and array elements, None otherwise
+    cpp_type: Optional[str]
+
+
+# size of the layout hash in front of the attributes of a POD packed value
+POD_HEADER_SIZE = 8
+
+
+def uses_pod_format(current_type: dict) -> bool:
+    return current_type.get("Pod", False) and current_type["Kind"].type_name_no_ns != "Enum"
+
+
+def uses_flat_format(current_type: dict) -> bool:
+    """
+    Values of packages with "WireFormat": "flat" are packed flat, structs nested in them and enums
+    keep their msgpack format. The POD format takes precedence.
+    """
+    return (current_type.get("WireFormat", WIRE_FORMAT_MSGPACK) == WIRE_FORMAT_FLAT
+            and current_type["Kind"].type_name_no_ns in ["Value", "ExtMemValue"]
+            and not uses_pod_format(current_type))
+
+
+def uses_bulk_format(current_type: dict) -> bool:
+    """
+    Values and structs of packages with "WireFormat": "bulk" pack their vectors of numbers as bin.
+    The POD format takes precedence.
+    """
+    return (current_type.get("WireFormat", WIRE_FORMAT_MSGPACK) == WIRE_FORMAT_BULK
+            and current_type["Kind"].type_name_no_ns in ["Value", "ExtMemValue", "Struct"]
+            and not uses_pod_format(current_type))
+
+
+def _number(type_name: str, system_types: dict):
+    system_type = system_types["SystemTypes"].get(type_name)
+    if system_type is None or system_type["Type"] != "Primitive":
+        return None
+    number = FLAT_NUMBERS.get(system_type.get("FlatBufferName"))
+    if number is None:
+        return None
+    return number[0], number[1], system_type["CppName"]
+
+
+def _number_array(parsed_type: 'Type', system_types: dict):
+    """
+    Returns the struct format, size and C++ type of the elements of a vector of numbers other than
+    bools, None for other types
+    """
+    if (type(parsed_type) == Template and parsed_type.type_name_no_ns == "vector"
+            and type(parsed_type.args[0]) == Scalar
+            and parsed_type.args[0].type_name_no_ns != "bool"):
+        return _number(parsed_type.args[0].type_name_no_ns, system_types)
+    return None
+
+
+def bulk_arrays(types_data: 'TypesData') -> dict:
+    """
+    Returns the struct format of the elements of the attributes of the current type which are
+    packed as bin in the bulk format, by attribute name. Vectors of uint8 are left out, msgpack
+    already packs them as bin.
+    """
+    arrays = {}
+    for name, attribute in types_data.current_type["Attributes"].items():
+        number = _number_array(attribute["Type"], types_data.system_types)
+        if number is not None and number[0] != "B":
+            arrays[name] = number[0]
+    return arrays
+
+
+def _align(offset: int, alignment: int) -> int:
+    return (offset + alignment - 1) // alignment * alignment
+
+
+def flat_layout(types_data: 'TypesData') -> (List[FlatSlot], int):
+    """
+    Returns the slots of the attributes of the current type in declaration order and the size of
+    the fixed part
+    """
+    system_types = types_data.system_types
+    slots = []
+    offset = 0
+    for name, attribute in types_data.current_type["Attributes"].items():
+        parsed_type = attribute["Type"]
+        fmt = None
+        cpp_type = None
+        if type(parsed_type) == Scalar and is_enum_type(parsed_type, types_data):
+            kind, size, fmt, cpp_type = "enum", 4, "i", "int32_t"
+        elif type(parsed_type) == Scalar and parsed_type.type_name_no_ns == "string":
+            kind, size = "string", REF_SIZE
+        elif type(parsed_type) == Scalar and _number(parsed_type.type_name_no_ns, system_types):
+            fmt, size, cpp_type = _number(parsed_type.type_name_no_ns, system_types)
+            kind = "scalar"
+        elif _number_array(parsed_type, system_types):
+            fmt, _, cpp_type = _number_array(parsed_type, system_types)
+            kind, size = "array", REF_SIZE
+        else:
+            kind, size = "packed", REF_SIZE
+
+        offset = _align(offset, size if kind in ["scalar", "enum"] else REF_ALIGNMENT)
+        slots.append(FlatSlot(name, kind, offset, fmt, cpp_type))
+        offset += size
+
+    return slots, _align(offset, 8)
+
+
+def pod_layout(types_data: 'TypesData') -> (List[FlatSlot], int, int):
+    """
+    Returns the slots of the attributes of the current type, the size of the attributes and the
+    hash of the layout. Raises a ConfigurationError if an attribute is not a number or an enum.
+    """
+    current_type = types_data.current_type
+    slots, size = flat_layout(types_data)
+    for slot in slots:
+        if slot.kind not in ["scalar", "enum"]:
+            raise ConfigurationError(f"Error in {current_type['Name']}::{slot.name}. \"Pod\" types may "
+                                     f"only contain numbers, bools and enums.")
+
+    # FNV-1a of the type name and the layout, changes whenever the packed form changes
+    description = f"{current_type['PackageNamespace']}::{current_type['Directory']}::{current_type['Name']}"
+    description += "".join(f"|{slot.name}:{slot.fmt}@{slot.offset}" for slot in slots)
+
+    return slots, size, fnv1a_64(description)
+
+
+def pod_struct_format(slots: List[FlatSlot], size: int) -> str:
+    """
+    Returns the python struct format of a POD packed value, including the layout hash
+    """
+    fmt = "<Q"
+    position = 0
+    for slot in slots:
+        if slot.offset > position:
+            fmt += f"{slot.offset - position}x"
+        fmt += slot.fmt
+        position = slot.offset + FLAT_SIZES[slot.fmt]
+    if size > position:
+        fmt += f"{size - position}x"
+    return fmt
+
+
+def validate_wire_format(wire_format: str, error_prefix_str: str) -> None:
+    if wire_format not in WIRE_FORMATS:
+        raise ConfigurationError(f"{error_prefix_str}: unknown WireFormat {wire_format}, "
+                                 f"expected one of {WIRE_FORMATS}")
@@ -2,6 +2,8 @@
 Copyright (c) 2024 Accenture
 """
 from type_generator.common import TypeNameParser, Scalar, Type, ConfigurationError
+from type_generator.common import LAYOUT_HEADER, validate_layout
+from type_generator.flat_layout import WIRE_FORMAT_MSGPACK, validate_wire_format
 from collections import OrderedDict
 import json
 import os
@@ -98,6 +100,8 @@ def parse_project_definitions(project_definitions: dict, system_types: dict, val
             project_types[indiv_namespace_type]["Directory"] = value["Directory"]
             project_types[indiv_namespace_type]["GroupName"] = key
             project_types[indiv_namespace_type]["PackageNamespace"] = project_definitions["PackageNamespace"]
+            project_types[indiv_namespace_type]["WireFormat"] = project_definitions.get("WireFormat", WIRE_FORMAT_MSGPACK)
+            project_types[indiv_namespace_type]["Layout"] = project_definitions.get("Layout", LAYOUT_HEADER)
 
             indiv_namespace_types.append(indiv_namespace_type)
 
@@ -143,10 +147,17 @@ def get_project_name_from_namespace(project_definitions: dict) -> str:
 
 
 def validate_project_definitions(project_definitions: dict, project_definitions_file: 'Path'):
-    allowed_key = 'PackageNamespace'
-    if len(project_definitions) == 1 and allowed_key in project_definitions:
+    required_key = 'PackageNamespace'
+    optional_keys = ['WireFormat', 'Layout']
+    if (required_key in project_definitions
+            and all(key == required_key or key in optional_keys for key in project_definitions)):
+        if 'WireFormat' in project_definitions:
+            validate_wire_format(project_definitions['WireFormat'], str(project_definitions_file.resolve()))
+        if 'Layout' in project_definitions:
+            validate_layout(project_definitions['Layout'], str(project_definitions_file.resolve()))
         return
-    raise ConfigurationError(f"{project_definitions_file.resolve()} should contain a single key: {allowed_key}")
+    raise ConfigurationError(f"{project_definitions_file.resolve()} should contain the key {required_key} "
+                             f"and optionally {', '.join(optional_keys)}")
 
 
 def load_project_files(
@@ -6,6 +6,9 @@ Copyright (c) 2024 Accenture
 from type_generator.common import Template, Type, TypeNameParser, TypesData, Scalar
 from type_generator.common import python_type_from_system_type, is_enum_type, is_primitive_type
 from type_generator.common import is_container_type, assert_types_validity, ConfigurationError
+from type_generator.flat_layout import flat_layout, uses_flat_format
+from type_generator.flat_layout import pod_layout, pod_struct_format, uses_pod_format
+from type_generator.flat_layout import bulk_arrays, uses_bulk_format
 
 from typing import TextIO, Set, TYPE_CHECKING
 import os
@@ -164,10 +167,15 @@ def add_serialize(file: TextIO, types_data: 'TypesData') -> None:
     file.write(" " * 8 + "return [[\n")
 
     current_type = types_data.current_type
+    arrays = bulk_arrays(types_data) if uses_bulk_format(current_type) else {}
     for key, value in current_type["Attributes"].items():
 
         file.write(" " * 12)
 
+        if key in arrays:
+            file.write(f"pack_array(\"{arrays[key]}\", self.{key}),\n")
+            continue
+
         parsed_type = value["Type"]
 
         # Message pack treats vector<uint8_t> and vector<char> as binary so special
@@ -205,6 +213,109 @@ def add_serialize(file: TextIO, types_data: 'TypesData') -> None:
     file.write(" " * 8 + "]\n\n")
 
 
+def add_flat_serialize(file: TextIO, types_data: 'TypesData') -> None:
+    current_type = types_data.current_type
+    slots, _ = flat_layout(types_data)
+    file.write("    def serialize(self) -> Sequence:\n")
+    file.write(" " * 8 + "writer = FlatWriter(_FLAT_FIXED_SIZE)\n")
+    for slot in slots:
+        if slot.kind == "scalar":
+            file.write(f"{' ' * 8}writer.scalar({slot.offset}, \"{slot.fmt}\", self.{slot.name})\n")
+        elif slot.kind == "enum":
+            file.write(f"{' ' * 8}writer.scalar({slot.offset}, \"{slot.fmt}\", int(self.{slot.name}))\n")
+        elif slot.kind == "string":
+            file.write(f"{' ' * 8}writer.string({slot.offset}, self.{slot.name})\n")
+        elif slot.kind == "array":
+            file.write(f"{' ' * 8}writer.array({slot.offset}, \"{slot.fmt}\", self.{slot.name})\n")
+        else:
+            file.write(f"{' ' * 8}writer.packed({slot.offset}, self.{slot.name})\n")
+    file.write(" " * 8 + "return [\n")
+    file.write(" " * 12 + "writer.data(),\n")
+    file.write(f"{' ' * 12}\"{current_type['PackageNamespace']}::{current_type['Directory']}::{current_type['Name']}\",\n")
+    if current_type["Kind"].type_name_no_ns == "ExtMemValue":
+        file.write(" " * 12 + "self.data\n")
+    file.write(" " * 8 + "]\n\n")
+
+
+def add_flat_unpack(file: TextIO, types_data: 'TypesData') -> None:
+    name = types_data.current_type["Name"]
+    slots, _ = flat_layout(types_data)
+    file.write("    @staticmethod\n")
+    file.write("    def __unpack(data: bytes) -> \"" + name + "\":\n\n")
+    file.write(" " * 8 + "view = " + name + "View(data)\n")
+    file.write(" " * 8 + "return " + name + "(\n")
+    for slot in slots:
+        file.write(" " * 12 + slot.name + "=")
+        if slot.kind == "array":
+            file.write("list(view." + slot.name + ")")
+        else:
+            recursive_unpack(file, 0, "view." + slot.name,
+                             types_data.current_type["Attributes"][slot.name]["Type"], types_data)
+        file.write(",\n")
+    file.write(" " * 8 + ")\n\n")
+
+
+def add_flat_view(file: TextIO, types_data: 'TypesData') -> None:
+    name = types_data.current_type["Name"]
+    slots, _ = flat_layout(types_data)
+    file.write("\n\n")
+    file.write("class " + name + "View:\n")
+    file.write(" " * 4 + '""" Reads the attributes of a flat packed ' + name + ' in place, see mcf/flat_value.py """\n\n')
+    file.write(" " * 4 + "__slots__ = (\"_reader\",)\n\n")
+    file.write(" " * 4 + "def __init__(self, data):\n")
+    file.write(" " * 8 + "self._reader = FlatReader(data, _FLAT_FIXED_SIZE)\n")
+    for slot in slots:
+        file.write("\n")
+        file.write(" " * 4 + "@property\n")
+        file.write(" " * 4 + "def " + slot.name + "(self):\n")
+        if slot.kind in ["scalar", "enum"]:
+            file.write(f"{' ' * 8}return self._reader.scalar({slot.offset}, \"{slot.fmt}\")\n")
+        elif slot.kind == "string":
+            file.write(f"{' ' * 8}return self._reader.string({slot.offset})\n")
+        elif slot.kind == "array":
+            file.write(f"{' ' * 8}return self._reader.array({slot.offset}, \"{slot.fmt}\")\n")
+        else:
+            file.write(f"{' ' * 8}return self._reader.unpacked({slot.offset})\n")
+
+
+def add_pod_serialize(file: TextIO, types_data: 'TypesData') -> None:
+    current_type = types_data.current_type
+    slots, _, _ = pod_layout(types_data)
+    file.write("    def serialize(self) -> Sequence:\n")
+    file.write(" " * 8 + "return [\n")
+    file.write(" " * 12 + "_POD_STRUCT.pack(\n")
+    file.write(" " * 16 + "_POD_LAYOUT_HASH,\n")
+    for slot in slots:
+        if slot.kind == "enum":
+            file.write(f"{' ' * 16}int(self.{slot.name}),\n")
+        else:
+            file.write(f"{' ' * 16}self.{slot.name},\n")
+    file.write(" " * 12 + "),\n")
+    file.write(f"{' ' * 12}\"{current_type['PackageNamespace']}::{current_type['Directory']}::{current_type['Name']}\",\n")
+    if current_type["Kind"].type_name_no_ns == "ExtMemValue":
+        file.write(" " * 12 + "self.data\n")
+    file.write(" " * 8 + "]\n\n")
+
+
+def add_pod_unpack(file: TextIO, types_data: 'TypesData') -> None:
+    name = types_data.current_type["Name"]
+    slots, _, _ = pod_layout(types_data)
+    file.write("    @staticmethod\n")
+    file.write("    def __unpack(data: bytes) -> \"" + name + "\":\n\n")
+    file.write(" " * 8 + "if len(data) != _POD_STRUCT.size:\n")
+    file.write(" " * 12 + "raise ValueError(\"Received " + name + " of incompatible size\")\n")
+    file.write(" " * 8 + "fields = _POD_STRUCT.unpack(data)\n")
+    file.write(" " * 8 + "if fields[0] != _POD_LAYOUT_HASH:\n")
+    file.write(" " * 12 + "raise ValueError(\"Received " + name + " of incompatible layout\")\n")
+    file.write(" " * 8 + "return " + name + "(\n")
+    for index, slot in enumerate(slots):
+        file.write(" " * 12 + slot.name + "=")
+        recursive_unpack(file, 0, f"fields[{index + 1}]",
+                         types_data.current_type["Attributes"][slot.name]["Type"], types_data)
+        file.write(",\n")
+    file.write(" " * 8 + ")\n\n")
+
+
 def add_deserialize(file: TextIO, current_type: dict) -> None:
     file.write("    @staticmethod\n")
     file.write("    def deserialize(array: Sequence) -> \"" + current_type["Name"] + "\":\n\n")
@@ -376,12 +487,16 @@ def add_unpack(file: TextIO, types_data: 'TypesData') -> None:
     file.write("    def __unpack(array: Sequence) -> \"" + types_data.current_type["Name"] + "\":\n\n")
     file.write(" " * 8 + "return " + types_data.current_type["Name"] + "(\n")
 
+    arrays = bulk_arrays(types_data) if uses_bulk_format(types_data.current_type) else {}
     for idx, (key, value) in enumerate(types_data.current_type["Attributes"].items()):
 
         file.write(" " * 12 + key + "=")
         unpack_name = "array[" + str(idx) + "]"
 
-        recursive_unpack(file, 0, unpack_name, value["Type"], types_data)
+        if key in arrays:
+            file.write(f"unpack_array(\"{arrays[key]}\", {unpack_name})")
+        else:
+            recursive_unpack(file, 0, unpack_name, value["Type"], types_data)
         file.write(",\n")
 
     file.write(" " * 8 + ")\n\n")
@@ -558,6 +673,12 @@ def add_imports(file: TextIO, types_data: 'TypesData') -> None:
     file.write("from typing import Sequence\n")
     file.write("from enum import IntEnum\n")
     file.write("from mcf import Value\n")
+    if uses_pod_format(types_data.current_type):
+        file.write("import struct\n")
+    if uses_flat_format(types_data.current_type):
+        file.write("from mcf.flat_value import FlatReader, FlatWriter\n")
+    if uses_bulk_format(types_data.current_type) and bulk_arrays(types_data):
+        file.write("from mcf.bulk_array import pack_array, unpack_array\n")
 
     class_type_name = types_data.current_type["Name"]
 
@@ -624,13 +745,30 @@ def add_class(file: TextIO, types_data: 'TypesData') -> None:
         add_enum(file, types_data.current_type)
     else:
         add_imports(file, types_data)
+        flat = uses_flat_format(types_data.current_type)
+        pod = uses_pod_format(types_data.current_type)
+        if flat:
+            file.write(f"_FLAT_FIXED_SIZE = {flat_layout(types_data)[1]}  # size of the fixed part of the flat wire format\n\n\n")
+        if pod:
+            slots, size, layout_hash = pod_layout(types_data)
+            file.write(f"_POD_LAYOUT_HASH = {layout_hash:#018x}  # hash of the type name and layout of the POD wire format\n")
+            file.write(f"_POD_STRUCT = struct.Struct(\"{pod_struct_format(slots, size)}\")  # layout hash and attributes\n\n\n")
         file.write("class " + types_data.current_type["Name"] + "(Value):\n")
         add_init(file, types_data)
         add_repr(file, types_data.current_type)
         add_deserialize(file, types_data.current_type)
-        add_unpack(file, types_data)
-        add_serialize(file, types_data)
+        if pod:
+            add_pod_unpack(file, types_data)
+            add_pod_serialize(file, types_data)
+        elif flat:
+            add_flat_unpack(file, types_data)
+            add_flat_serialize(file, types_data)
+        else:
+            add_unpack(file, types_data)
+            add_serialize(file, types_data)
         add_gen_test_type(file, types_data)
+        if flat:
+            add_flat_view(file, types_data)
 
 
 def write_python_type_file(py_dir: 'Path', types_data: 'TypesData') -> None:
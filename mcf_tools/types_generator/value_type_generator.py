@@ -9,11 +9,13 @@ from typing import List, Optional
 from type_generator.cpp_group_generator import write_group_header_file
 from type_generator.cpp_indiv_generator import write_individual_header_file
 from type_generator.cpp_register_generator import write_register_header_file
+from type_generator.cpp_split_generator import write_forward_header_file, write_codec_header_file
+from type_generator.cpp_split_generator import write_codec_source_file
 from type_generator.python_type_generator import write_python_type_file
 from type_generator.parse_definitions import parse_project_definitions, load_project_files
 from type_generator.parse_definitions import is_cache_valid, dump_cache
 from type_generator.parse_definitions import find_value_type_definition_dirs
-from type_generator.common import TypesData
+from type_generator.common import TypesData, uses_split_layout
 
 
 def create_group_header_files(group_names, cpp_header_directory, project_types):
@@ -25,6 +27,9 @@ def create_group_header_files(group_names, cpp_header_directory, project_types):
 
         write_group_header_file(combined_filename, value, project_types[value[0]], key,
                                 project_types)
+        if uses_split_layout(project_types[value[0]]):
+            write_forward_header_file(output_cpp_directory / (key + "Fwd.h"), value, project_types[value[0]], key,
+                                      project_types)
 
 
 def create_register_header_file(cpp_header_directory, project_definitions):
@@ -35,13 +40,18 @@ def create_register_header_file(cpp_header_directory, project_definitions):
     write_register_header_file(output_cpp_directory, project_definitions)
 
 
-def create_individual_type_file(types_data, cpp_header_directory, py_directory, indiv_class):
+def create_individual_type_file(types_data, cpp_header_directory, cpp_source_directory, py_directory, indiv_class):
     output_py_directory = py_directory / indiv_class["PackageNamespace"] / indiv_class["Directory"]
     os.makedirs(output_py_directory, exist_ok=True)
 
     output_cpp_directory = cpp_header_directory / indiv_class["PackageNamespace"] / indiv_class["Directory"]
 
     write_individual_header_file(output_cpp_directory, types_data)
+    if uses_split_layout(indiv_class):
+        output_src_directory = cpp_source_directory / indiv_class["PackageNamespace"] / indiv_class["Directory"]
+        os.makedirs(output_src_directory, exist_ok=True)
+        write_codec_header_file(output_cpp_directory, types_data)
+        write_codec_source_file(output_src_directory, types_data)
     write_python_type_file(output_py_directory, types_data)
 
 
@@ -50,7 +60,10 @@ def generate_value_types(
         py_directory: Path,
         value_types_definition_directory: Path,
         allowed_types_file: Path,
-        linked_search_dirs: Optional[List[Path]]):
+        linked_search_dirs: Optional[List[Path]],
+        cpp_source_directory: Optional[Path] = None):
+    if cpp_source_directory is None:
+        cpp_source_directory = cpp_header_directory
     project_definitions, system_types = load_project_files(
         value_types_definition_directory,
         allowed_types_file)
@@ -101,7 +114,8 @@ def generate_value_types(
         for _, current_type in project_types.items():
             types_data = TypesData(current_type, project_types, system_types, project_names,
                                    linked_types, linked_names)
-            create_individual_type_file(types_data, cpp_header_directory, py_directory, current_type)
+            create_individual_type_file(types_data, cpp_header_directory, cpp_source_directory, py_directory,
+                                        current_type)
 
         dump_cache(cache_filename, project_types, linked_types)
 
@@ -113,6 +127,9 @@ if __name__ == '__main__':
                         help='base output directory where cpp header files will be stored')
     parser.add_argument('-o_py', '--output_py_dir', required=True,
                         help='base output directory where python files will be stored')
+    parser.add_argument('-o_src', '--output_src_dir', required=False, default=None,
+                        help='base output directory where the cpp source files of packages with the split '
+                             'layout will be stored, defaults to the cpp header directory')
     parser.add_argument('-i', '--input_dir', required=True,
                         help='input directory containing json description files for classes that should be generated')
     parser.add_argument('-i_link', '--linked_search_dirs', required=False,  action='append', default=None,
@@ -129,4 +146,5 @@ if __name__ == '__main__':
     linked_search_dirs = None
     if args.linked_search_dirs:
         linked_search_dirs = [Path(dir) for dir in args.linked_search_dirs]
-    generate_value_types(cpp_dir, py_dir, value_types_dir, allowed_types_file, linked_search_dirs)
+    src_dir = Path(args.output_src_dir) if args.output_src_dir else None
+    generate_value_types(cpp_dir, py_dir, value_types_dir, allowed_types_file, linked_search_dirs, src_dir)
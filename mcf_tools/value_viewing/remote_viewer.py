@@ -14,6 +14,15 @@ try:
 except ImportError:
     vp = None
 
+try:
+    import io
+    from PIL import Image, ImageTk
+except ImportError:
+    Image = None
+
+# topics of the previews of image topics, see mcf_core/PreviewService.h
+PREVIEW_PREFIX = '/mcf/preview'
+
 
 class Selection():
 
@@ -243,6 +252,28 @@ class DetailsView():
             if vp is not None:
                 vp.view(topic, typeid, content, extmem)
 
+    def _show_preview(self):
+        topic = self.topic_var.get()
+        value = self.app_state.read_value(PREVIEW_PREFIX + topic)
+        if value is None or value[1] != 'mcf::PreviewImage':
+            self.preview_label.config(image='', text='No preview of {}'.format(topic))
+            return
+        _, width, height, channels, _, encoding = value[0]
+        pixels = bytes(value[2])
+        if encoding == 'jpeg':
+            if Image is None:
+                self.preview_label.config(image='', text='Install Pillow to show JPEG previews')
+                return
+            self.preview_image = ImageTk.PhotoImage(Image.open(io.BytesIO(pixels)))
+        elif channels in (1, 3):
+            # portable graymap or pixmap, which tk reads without further packages
+            header = '{} {} {} 255\n'.format('P5' if channels == 1 else 'P6', width, height)
+            self.preview_image = tk.PhotoImage(data=header.encode() + pixels, format='PPM')
+        else:
+            self.preview_label.config(image='', text='Cannot show previews of {} channels'.format(channels))
+            return
+        self.preview_label.config(image=self.preview_image, text='')
+
     def _write_value(self):
         val = self.value_text_field.get(1.0, 'end')
         try:
@@ -283,6 +314,12 @@ class DetailsView():
         self.read_button.pack(fill='x')
         self.write_button = tk.Button(rw_container, text='Write', command=lambda: self._write_value())
         self.write_button.pack(fill='x')
+        self.preview_button = tk.Button(rw_container, text='Preview', command=lambda: self._show_preview())
+        self.preview_button.pack(fill='x')
+
+        self.preview_image = None
+        self.preview_label = tk.Label(container, anchor='w')
+        self.preview_label.pack(fill='x')
 
         self.value_text_field = tk.Text(container)
         self.value_text_field.pack(fill='both')